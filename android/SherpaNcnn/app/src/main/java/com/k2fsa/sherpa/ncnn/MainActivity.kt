@@ -12,6 +12,8 @@ import android.widget.Button
 import android.widget.TextView
 import androidx.appcompat.app.AppCompatActivity
 import androidx.core.app.ActivityCompat
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
 import kotlin.concurrent.thread
 
 private const val TAG = "sherpa-ncnn"
@@ -117,18 +119,17 @@ class MainActivity : AppCompatActivity() {
 
         val interval = 0.1 // i.e., 100 ms
         val bufferSize = (interval * sampleRateInHz).toInt() // in samples
-        val buffer = ShortArray(bufferSize)
+        // 16-bit samples that are passed to the model without copying them
+        val buffer = ByteBuffer.allocateDirect(2 * bufferSize).order(ByteOrder.nativeOrder())
+        var text = ""
 
         while (isRecording) {
-            val ret = audioRecord?.read(buffer, 0, buffer.size)
+            val ret = audioRecord?.read(buffer, buffer.capacity())
             if (ret != null && ret > 0) {
-                val samples = FloatArray(ret) { buffer[it] / 32768.0f }
-                model.acceptSamples(samples)
-                while (model.isReady()) {
-                    model.decode()
-                }
+                model.acceptSamplesDirect(buffer, ret / 2)
+                model.decodeUntilNotReady()
                 val isEndpoint = model.isEndpoint()
-                val text = model.text
+                text = model.getTextIfChanged() ?: text
                 var textToDisplay = lastText
 
                 if (text.isNotBlank()) {
@@ -1,6 +1,7 @@
 package com.k2fsa.sherpa.ncnn
 
 import android.content.res.AssetManager
+import java.nio.ByteBuffer
 
 data class FeatureExtractorConfig(
     var sampleRate: Float,
@@ -18,6 +19,22 @@ data class ModelConfig(
     var tokens: String,
     var numThreads: Int = 1,
     var useGPU: Boolean = true, // If there is a GPU and useGPU true, we will use GPU
+
+    // CPU cores of each network: 0 for all cores, 1 for the little cores
+    // and 2 for the big cores
+    var encoderPowersave: Int = 0,
+    var decoderPowersave: Int = 0,
+    var joinerPowersave: Int = 0,
+
+    // Optional. Comma separated ids of the CPU cores all networks run on,
+    // e.g., "4,5,6,7". If not empty, it overrides the powersave options
+    var cpuCores: String = "",
+
+    // Optional. Precision of the networks: "accuracy" (fp32), "balanced"
+    // (fp16 or bf16 storage, fp32 arithmetic) or "speed" (also fp16
+    // arithmetic where supported, e.g., on ARMv8.2). Empty for the
+    // defaults of ncnn
+    var precision: String = "",
 )
 
 data class DecoderConfig(
@@ -37,17 +54,22 @@ data class RecognizerConfig(
     var hotwordsScore: Float = 1.5f,
 )
 
+// If loadAsync is true, the constructor returns immediately and the model
+// is loaded and warmed up on a background thread. Use isLoaded() to check
+// whether it is ready; the other methods wait for it.
 class SherpaNcnn(
     var config: RecognizerConfig,
     assetManager: AssetManager? = null,
+    loadAsync: Boolean = false,
 ) {
     private val ptr: Long
 
     init {
         if (assetManager != null) {
-            ptr = newFromAsset(assetManager, config)
+            ptr = if (loadAsync) newFromAssetAsync(assetManager, config)
+            else newFromAsset(assetManager, config)
         } else {
-            ptr = newFromFile(config)
+            ptr = if (loadAsync) newFromFileAsync(config) else newFromFile(config)
         }
     }
 
@@ -58,10 +80,31 @@ class SherpaNcnn(
     fun acceptSamples(samples: FloatArray) =
         acceptWaveform(ptr, samples = samples, sampleRate = config.featConfig.sampleRate)
 
+    // buffer is a direct ByteBuffer in the native byte order, e.g., the one
+    // given to AudioRecord.read(). It contains numSamples 16-bit PCM samples
+    // if isInt16 is true or floats otherwise. The samples are not copied.
+    fun acceptSamplesDirect(buffer: ByteBuffer, numSamples: Int, isInt16: Boolean = true) =
+        acceptWaveformDirect(
+            ptr,
+            buffer = buffer,
+            numSamples = numSamples,
+            isInt16 = isInt16,
+            sampleRate = config.featConfig.sampleRate
+        )
+
     fun isReady() = isReady(ptr)
 
+    fun isLoaded() = isLoaded(ptr)
+
+    // Run the networks once so that the first decode() is not slow
+    fun warmUp() = warmUp(ptr)
+
     fun decode() = decode(ptr)
 
+    // Same as calling decode() while isReady(), in one native call.
+    // Return the number of decoded chunks
+    fun decodeUntilNotReady(): Int = decodeUntilNotReady(ptr)
+
     fun inputFinished() = inputFinished(ptr)
     fun isEndpoint(): Boolean = isEndpoint(ptr)
     fun reset(recreate: Boolean = false) = reset(ptr, recreate = recreate)
@@ -69,6 +112,9 @@ class SherpaNcnn(
     val text: String
         get() = getText(ptr)
 
+    // Return null if the text has not changed since the last call
+    fun getTextIfChanged(): String? = getTextIfChanged(ptr)
+
     private external fun newFromAsset(
         assetManager: AssetManager,
         config: RecognizerConfig,
@@ -78,14 +124,34 @@ class SherpaNcnn(
         config: RecognizerConfig,
     ): Long
 
+    private external fun newFromAssetAsync(
+        assetManager: AssetManager,
+        config: RecognizerConfig,
+    ): Long
+
+    private external fun newFromFileAsync(
+        config: RecognizerConfig,
+    ): Long
+
+    private external fun isLoaded(ptr: Long): Boolean
+    private external fun warmUp(ptr: Long)
     private external fun delete(ptr: Long)
     private external fun acceptWaveform(ptr: Long, samples: FloatArray, sampleRate: Float)
+    private external fun acceptWaveformDirect(
+        ptr: Long,
+        buffer: ByteBuffer,
+        numSamples: Int,
+        isInt16: Boolean,
+        sampleRate: Float
+    )
     private external fun inputFinished(ptr: Long)
     private external fun isReady(ptr: Long): Boolean
     private external fun decode(ptr: Long)
+    private external fun decodeUntilNotReady(ptr: Long): Int
     private external fun isEndpoint(ptr: Long): Boolean
     private external fun reset(ptr: Long, recreate: Boolean)
     private external fun getText(ptr: Long): String
+    private external fun getTextIfChanged(ptr: Long): String?
 
     companion object {
         init {
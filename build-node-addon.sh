@@ -0,0 +1,47 @@
+#!/usr/bin/env bash
+# Copyright (c)  2025  Xiaomi Corporation
+#
+# This script is to build the native Node.js addon of sherpa-ncnn.
+# Unlike ./build-wasm-simd-for-nodejs.sh, ncnn runs with all of its
+# threads and the addon decodes on the thread pool of libuv.
+#
+# The headers of Node-API are taken from the installation of node. You can
+# also pass -DSHERPA_NCNN_NODE_INCLUDE_DIR=/path/to/include/node to cmake.
+#
+# The package is in ./build-node-addon/sherpa-ncnn-node. Please see
+# ./nodejs-examples/decode-files-native.js for how to use it.
+
+set -ex
+
+if ! command -v node &> /dev/null; then
+  echo "Please install node first"
+  exit 1
+fi
+
+mkdir -p build-node-addon
+pushd build-node-addon
+
+cmake \
+  -DCMAKE_INSTALL_PREFIX=./install \
+  -DCMAKE_BUILD_TYPE=Release \
+  -DBUILD_SHARED_LIBS=OFF \
+  -DSHERPA_NCNN_ENABLE_NODE_ADDON=ON \
+  -DSHERPA_NCNN_ENABLE_C_API=ON \
+  -DSHERPA_NCNN_ENABLE_PYTHON=OFF \
+  -DSHERPA_NCNN_ENABLE_PORTAUDIO=OFF \
+  -DSHERPA_NCNN_ENABLE_JNI=OFF \
+  -DSHERPA_NCNN_ENABLE_BINARY=OFF \
+  -DSHERPA_NCNN_ENABLE_TEST=OFF \
+  -DSHERPA_NCNN_ENABLE_GENERATE_INT8_SCALE_TABLE=OFF \
+  -DSHERPA_NCNN_ENABLE_FFMPEG_EXAMPLES=OFF \
+  ..
+
+make -j4 sherpa-ncnn-node
+
+mkdir -p sherpa-ncnn-node
+cp -v ./lib/sherpa-ncnn-node.node sherpa-ncnn-node/
+cp -v ../scripts/node-addon/index.js sherpa-ncnn-node/
+cp -v ../scripts/node-addon/package.json sherpa-ncnn-node/
+cp -v ../scripts/node-addon/README.md sherpa-ncnn-node/
+
+ls -lh sherpa-ncnn-node
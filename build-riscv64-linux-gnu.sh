@@ -11,7 +11,18 @@ if ! command -v riscv64-linux-gnu-g++  &> /dev/null; then
   exit 1
 fi
 
+# Set it to rv64gcv for boards with the vector extension 1.0, e.g.,
+#
+#   SHERPA_NCNN_RISCV_MARCH=rv64gcv ./build-riscv64-linux-gnu.sh
+#
+# The RVV kernels of sherpa-ncnn need riscv64-linux-gnu-g++ >= 14.
+# Older compilers build the scalar ones.
+march=${SHERPA_NCNN_RISCV_MARCH:-rv64gc}
+
 dir=build-riscv64-linux-gnu
+if [ $march != rv64gc ]; then
+  dir=build-riscv64-linux-gnu-$march
+fi
 mkdir -p $dir
 cd $dir
 
@@ -44,6 +55,7 @@ cmake \
   -DSHERPA_NCNN_ENABLE_BINARY=ON \
   -DSHERPA_NCNN_ENABLE_TEST=OFF \
   -DCMAKE_TOOLCHAIN_FILE=../toolchains/riscv64-linux-gnu.toolchain.cmake \
+  -DRISCV_MARCH=$march \
   ..
 
 make VERBOSE=1 -j4
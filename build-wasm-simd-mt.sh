@@ -0,0 +1,85 @@
+#!/usr/bin/env bash
+# Copyright (c)  2025  Xiaomi Corporation
+#
+# This script is to build sherpa-ncnn for WebAssembly with SIMD and threads.
+# ncnn runs the models on 4 threads and the microphone is recorded by an
+# AudioWorklet into the heap, which is a SharedArrayBuffer.
+#
+# Browsers share the memory only if the page is served with the headers
+#
+#   Cross-Origin-Opener-Policy: same-origin
+#   Cross-Origin-Embedder-Policy: require-corp
+#
+# Otherwise, please use ./build-wasm-simd.sh
+#
+# See also
+# https://github.com/Tencent/ncnn/wiki/how-to-build#build-for-webassembly
+#
+# Please refer to
+# https://k2-fsa.github.io/sherpa/ncnn/wasm/index.html
+# for more details.
+
+set -ex
+
+if [ x"$EMSCRIPTEN" == x"" ]; then
+  if ! command -v emcc &> /dev/null; then
+    echo "Please install emscripten first"
+    echo ""
+    echo "You can use the following commands to install it:"
+    echo ""
+    echo "git clone https://github.com/emscripten-core/emsdk.git"
+    echo "cd emsdk"
+    echo "git pull"
+    echo "./emsdk install latest"
+    echo "./emsdk activate latest"
+    echo "source ./emsdk_env.sh"
+    exit 1
+  else
+    EMSCRIPTEN=$(dirname $(realpath $(which emcc)))
+  fi
+fi
+
+export EMSCRIPTEN=$EMSCRIPTEN
+echo "EMSCRIPTEN: $EMSCRIPTEN"
+if [ ! -f $EMSCRIPTEN/cmake/Modules/Platform/Emscripten.cmake ]; then
+  echo "Cannot find $EMSCRIPTEN/cmake/Modules/Platform/Emscripten.cmake"
+  echo "Please make sure you have installed emsdk correctly"
+  exit 1
+fi
+
+mkdir -p build-wasm-simd-mt
+pushd build-wasm-simd-mt
+
+export SHERPA_NCNN_IS_USING_BUILD_WASM_SH=ON
+
+cmake \
+  -DCMAKE_INSTALL_PREFIX=./install \
+  -DCMAKE_BUILD_TYPE=Release \
+  -DCMAKE_TOOLCHAIN_FILE=$EMSCRIPTEN/cmake/Modules/Platform/Emscripten.cmake \
+  -DNCNN_THREADS=ON \
+  -DNCNN_OPENMP=ON \
+  -DNCNN_SIMPLEOMP=ON \
+  -DNCNN_RUNTIME_CPU=OFF \
+  -DNCNN_SSE2=ON \
+  -DNCNN_AVX2=OFF \
+  -DNCNN_AVX=OFF \
+  -DNCNN_BUILD_TOOLS=OFF \
+  -DNCNN_BUILD_EXAMPLES=OFF \
+  -DNCNN_BUILD_BENCHMARK=OFF \
+  \
+  -DSHERPA_NCNN_ENABLE_WASM=ON \
+  -DSHERPA_NCNN_ENABLE_WASM_THREADS=ON \
+  -DBUILD_SHARED_LIBS=OFF \
+  -DSHERPA_NCNN_ENABLE_PYTHON=OFF \
+  -DSHERPA_NCNN_ENABLE_PORTAUDIO=OFF \
+  -DSHERPA_NCNN_ENABLE_JNI=OFF \
+  -DSHERPA_NCNN_ENABLE_BINARY=OFF \
+  -DSHERPA_NCNN_ENABLE_TEST=OFF \
+  -DSHERPA_NCNN_ENABLE_C_API=ON \
+  -DSHERPA_NCNN_ENABLE_GENERATE_INT8_SCALE_TABLE=OFF \
+  -DSHERPA_NCNN_ENABLE_FFMPEG_EXAMPLES=OFF \
+  ..
+
+make -j2
+make install
+ls -lh install/bin/wasm
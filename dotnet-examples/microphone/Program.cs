@@ -2,7 +2,6 @@
 using System;
 using System.Threading;
 using PortAudioSharp;
-using System.Runtime.InteropServices;
 
 class Microphone
 {
@@ -112,10 +111,11 @@ class Microphone
             IntPtr userData
             ) =>
         {
-            float[] samples = new float[frameCount];
-            Marshal.Copy(input, samples, 0, (Int32)frameCount);
-
-            s.AcceptWaveform(16000, samples);
+            // Read the samples in place instead of copying them to an array
+            unsafe
+            {
+                s.AcceptWaveform(16000, new ReadOnlySpan<float>((void*)input, (Int32)frameCount));
+            }
 
             return StreamCallbackResult.Continue;
         };
@@ -133,6 +133,7 @@ class Microphone
         stream.Start();
 
         String lastText = "";
+        int revision = -1;
         int segmentIndex = 0;
 
         while (true)
@@ -142,21 +143,23 @@ class Microphone
                 recognizer.Decode(s);
             }
 
-            var text = recognizer.GetResult(s).Text;
+            // It is null if the result has not changed since last time
+            var result = recognizer.GetResultIfChanged(s, ref revision);
             bool isEndpoint = recognizer.IsEndpoint(s);
-            if (!string.IsNullOrWhiteSpace(text) && lastText != text)
+            if (result != null && !string.IsNullOrWhiteSpace(result.Text))
             {
-                lastText = text;
+                lastText = result.Text;
                 Console.Write($"\r{segmentIndex}: {lastText}");
             }
 
             if (isEndpoint)
             {
-                if (!string.IsNullOrWhiteSpace(text))
+                if (!string.IsNullOrWhiteSpace(lastText))
                 {
                     ++segmentIndex;
                     Console.WriteLine();
                 }
+                lastText = "";
                 recognizer.Reset(s);
             }
 
@@ -0,0 +1,464 @@
+// ffmpeg-examples/ffmpeg-ingest.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "ffmpeg-examples/ffmpeg-ingest.h"
+
+#include <stdio.h>
+
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <functional>
+#include <mutex>  // NOLINT
+#include <sstream>
+#include <thread>  // NOLINT
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/macros.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavfilter/buffersink.h>
+#include <libavfilter/buffersrc.h>
+#include <libavformat/avformat.h>
+#include <libavutil/channel_layout.h>
+#include <libavutil/samplefmt.h>
+}
+
+namespace sherpa_ncnn {
+
+namespace {
+
+constexpr int32_t kSampleRate = 16000;
+
+// Seconds of silence appended to each input, as in sherpa-ncnn-ffmpeg.cc
+constexpr float kTailPadding = 0.3;
+
+// Returned by AudioReader::Read() if the callback asked to stop
+constexpr int32_t kStopped = 1;
+
+std::string AvError(int32_t errnum) {
+  char buf[AV_ERROR_MAX_STRING_SIZE] = {0};
+  av_make_error_string(buf, sizeof(buf), errnum);
+  return buf;
+}
+
+// Demux, decode and resample the audio of one input to mono 16-bit PCM
+// at kSampleRate
+class AudioReader {
+ public:
+  // Return false to stop reading
+  using SamplesCallback = std::function<bool(const int16_t *, int32_t)>;
+
+  AudioReader() = default;
+  AudioReader(const AudioReader &) = delete;
+  AudioReader &operator=(const AudioReader &) = delete;
+
+  ~AudioReader() {
+    avfilter_graph_free(&graph_);
+    av_frame_free(&filt_frame_);
+    av_frame_free(&frame_);
+    av_packet_free(&packet_);
+    avcodec_free_context(&dec_ctx_);
+    avformat_close_input(&fmt_ctx_);
+  }
+
+  // Return 0 on success or a negative AVERROR
+  int32_t Open(const std::string &url) {
+    int32_t ret = avformat_open_input(&fmt_ctx_, url.c_str(), nullptr,
+                                      nullptr);
+    if (ret < 0) return ret;
+
+    ret = avformat_find_stream_info(fmt_ctx_, nullptr);
+    if (ret < 0) return ret;
+
+    const AVCodec *dec = nullptr;
+    ret = av_find_best_stream(fmt_ctx_, AVMEDIA_TYPE_AUDIO, -1, -1, &dec, 0);
+    if (ret < 0) return ret;
+    stream_index_ = ret;
+
+    AVStream *stream = fmt_ctx_->streams[stream_index_];
+    dec_ctx_ = avcodec_alloc_context3(dec);
+    packet_ = av_packet_alloc();
+    frame_ = av_frame_alloc();
+    filt_frame_ = av_frame_alloc();
+    if (!dec_ctx_ || !packet_ || !frame_ || !filt_frame_) {
+      return AVERROR(ENOMEM);
+    }
+
+    ret = avcodec_parameters_to_context(dec_ctx_, stream->codecpar);
+    if (ret < 0) return ret;
+
+    ret = avcodec_open2(dec_ctx_, dec, nullptr);
+    if (ret < 0) return ret;
+
+    return InitFilters(stream->time_base);
+  }
+
+  /** Pass the samples of the whole input to on_samples in order.
+   *
+   * @return Return 0 at the end of the input, kStopped if on_samples
+   *         returned false, or a negative AVERROR.
+   */
+  int32_t Read(const SamplesCallback &on_samples) {
+    int32_t ret = 0;
+    while ((ret = av_read_frame(fmt_ctx_, packet_)) >= 0) {
+      if (packet_->stream_index != stream_index_) {
+        av_packet_unref(packet_);
+        continue;
+      }
+
+      ret = avcodec_send_packet(dec_ctx_, packet_);
+      av_packet_unref(packet_);
+
+      // Skip a corrupted packet instead of dropping the whole input
+      if (ret == AVERROR_INVALIDDATA) continue;
+      if (ret < 0) return ret;
+
+      ret = ReceiveFrames(on_samples);
+      if (ret != 0) return ret;
+    }
+
+    if (ret != AVERROR_EOF) return ret;
+
+    // Flush the decoder and then the filters
+    ret = avcodec_send_packet(dec_ctx_, nullptr);
+    if (ret < 0) return ret;
+
+    return ReceiveFrames(on_samples);
+  }
+
+ private:
+  int32_t InitFilters(AVRational time_base) {
+    graph_ = avfilter_graph_alloc();
+    if (!graph_) return AVERROR(ENOMEM);
+
+    if (dec_ctx_->ch_layout.order == AV_CHANNEL_ORDER_UNSPEC) {
+      av_channel_layout_default(&dec_ctx_->ch_layout,
+                                dec_ctx_->ch_layout.nb_channels);
+    }
+
+    char layout[256];
+    av_channel_layout_describe(&dec_ctx_->ch_layout, layout, sizeof(layout));
+
+    char args[512];
+    snprintf(args, sizeof(args),
+             "time_base=%d/%d:sample_rate=%d:sample_fmt=%s:channel_layout=%s",
+             time_base.num, time_base.den, dec_ctx_->sample_rate,
+             av_get_sample_fmt_name(dec_ctx_->sample_fmt), layout);
+
+    int32_t ret = avfilter_graph_create_filter(
+        &src_ctx_, avfilter_get_by_name("abuffer"), "in", args, nullptr,
+        graph_);
+    if (ret < 0) return ret;
+
+    ret = avfilter_graph_create_filter(&sink_ctx_,
+                                       avfilter_get_by_name("abuffersink"),
+                                       "out", nullptr, nullptr, graph_);
+    if (ret < 0) return ret;
+
+    // The labels "in" and "out" of the description below refer to the
+    // source and the sink
+    AVFilterInOut *outputs = avfilter_inout_alloc();
+    AVFilterInOut *inputs = avfilter_inout_alloc();
+    if (!outputs || !inputs) {
+      avfilter_inout_free(&outputs);
+      avfilter_inout_free(&inputs);
+      return AVERROR(ENOMEM);
+    }
+
+    outputs->name = av_strdup("in");
+    outputs->filter_ctx = src_ctx_;
+    outputs->pad_idx = 0;
+    outputs->next = nullptr;
+
+    inputs->name = av_strdup("out");
+    inputs->filter_ctx = sink_ctx_;
+    inputs->pad_idx = 0;
+    inputs->next = nullptr;
+
+    char filters[128];
+    snprintf(filters, sizeof(filters),
+             "aresample=%d,aformat=sample_fmts=s16:channel_layouts=mono",
+             kSampleRate);
+
+    ret = avfilter_graph_parse_ptr(graph_, filters, &inputs, &outputs,
+                                   nullptr);
+    avfilter_inout_free(&inputs);
+    avfilter_inout_free(&outputs);
+    if (ret < 0) return ret;
+
+    return avfilter_graph_config(graph_, nullptr);
+  }
+
+  // Move the decoded frames through the filters
+  int32_t ReceiveFrames(const SamplesCallback &on_samples) {
+    while (true) {
+      int32_t ret = avcodec_receive_frame(dec_ctx_, frame_);
+      if (ret == AVERROR(EAGAIN)) return 0;
+
+      if (ret == AVERROR_EOF) {
+        // The decoder is flushed. Flush the filters.
+        ret = av_buffersrc_add_frame(src_ctx_, nullptr);
+        if (ret < 0) return ret;
+
+        return ReceiveSamples(on_samples);
+      }
+
+      if (ret < 0) return ret;
+
+      // It takes the data of frame_ and resets it
+      ret = av_buffersrc_add_frame(src_ctx_, frame_);
+      if (ret < 0) return ret;
+
+      ret = ReceiveSamples(on_samples);
+      if (ret != 0) return ret;
+    }
+  }
+
+  int32_t ReceiveSamples(const SamplesCallback &on_samples) {
+    while (true) {
+      int32_t ret = av_buffersink_get_frame(sink_ctx_, filt_frame_);
+      if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) return 0;
+      if (ret < 0) return ret;
+
+      bool go_on =
+          on_samples(reinterpret_cast<const int16_t *>(filt_frame_->data[0]),
+                     filt_frame_->nb_samples);
+      av_frame_unref(filt_frame_);
+
+      if (!go_on) return kStopped;
+    }
+  }
+
+ private:
+  AVFormatContext *fmt_ctx_ = nullptr;
+  AVCodecContext *dec_ctx_ = nullptr;
+  AVFilterGraph *graph_ = nullptr;
+
+  // They are owned by graph_
+  AVFilterContext *src_ctx_ = nullptr;
+  AVFilterContext *sink_ctx_ = nullptr;
+
+  AVPacket *packet_ = nullptr;
+  AVFrame *frame_ = nullptr;
+  AVFrame *filt_frame_ = nullptr;
+  int32_t stream_index_ = -1;
+};
+
+}  // namespace
+
+std::string FFmpegIngestConfig::ToString() const {
+  std::ostringstream os;
+
+  os << "FFmpegIngestConfig(";
+  os << "scheduler_config=" << scheduler_config.ToString() << ", ";
+  os << "num_threads=" << num_threads << ", ";
+  os << "max_backlog=" << max_backlog << ")";
+
+  return os.str();
+}
+
+class FFmpegIngest::Impl {
+  struct Input {
+    int32_t id = 0;
+    std::unique_ptr<Stream> stream;
+  };
+
+ public:
+  Impl(const Recognizer *recognizer, const FFmpegIngestConfig &config,
+       Callback callback)
+      : recognizer_(recognizer),
+        config_(config),
+        callback_(std::move(callback)),
+        scheduler_(recognizer, config.scheduler_config,
+                   [this](Stream *s, const RecognitionResult &r,
+                          bool is_final, bool is_last) {
+                     OnResult(s, r, is_final, is_last);
+                   }) {
+    if (config_.num_threads < 1 || config_.max_backlog <= 0) {
+      SHERPA_NCNN_LOGE("Invalid config: %s", config_.ToString().c_str());
+      SHERPA_NCNN_EXIT(-1);
+    }
+
+    for (int32_t i = 0; i != config_.num_threads; ++i) {
+      threads_.emplace_back([this]() { Run(); });
+    }
+  }
+
+  ~Impl() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+
+    for (auto &t : threads_) {
+      t.join();
+    }
+  }
+
+  int32_t Add(const std::string &url) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int32_t id = next_id_++;
+    pending_.emplace_back(id, url);
+    ++num_unfinished_;
+    cv_.notify_one();
+
+    return id;
+  }
+
+  void Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this]() { return num_unfinished_ == 0; });
+  }
+
+ private:
+  void Run() {
+    while (true) {
+      std::pair<int32_t, std::string> p;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return stop_ || !pending_.empty(); });
+        if (stop_) return;
+
+        p = std::move(pending_.front());
+        pending_.pop_front();
+      }
+
+      Process(p.first, p.second);
+    }
+  }
+
+  void Process(int32_t id, const std::string &url) {
+    AudioReader reader;
+    int32_t ret = reader.Open(url);
+    if (ret < 0) {
+      Fail(id, "Failed to open " + url + ": " + AvError(ret));
+      return;
+    }
+
+    std::unique_ptr<Stream> stream = recognizer_->CreateStream();
+    if (!stream) {
+      Fail(id, "The memory budget cannot afford a stream for " + url);
+      return;
+    }
+
+    Stream *s = stream.get();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      inputs_[s] = Input{id, std::move(stream)};
+    }
+    scheduler_.AddStream(s);
+
+    ret = reader.Read([this, s](const int16_t *samples, int32_t n) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stop_) return false;
+      }
+
+      scheduler_.WaitBacklog(s, config_.max_backlog);
+      scheduler_.AcceptWaveformInt16(s, kSampleRate, samples, n);
+      return true;
+    });
+
+    if (ret != 0) {
+      // The stream is freed here, so only the error is delivered
+      scheduler_.RemoveStream(s);
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        inputs_.erase(s);
+      }
+
+      if (ret == kStopped) return;
+
+      Fail(id, "Failed to read " + url + ": " + AvError(ret));
+      return;
+    }
+
+    std::vector<int16_t> tail_paddings(
+        static_cast<int32_t>(kTailPadding * kSampleRate));
+    scheduler_.AcceptWaveformInt16(s, kSampleRate, tail_paddings.data(),
+                                   tail_paddings.size());
+    scheduler_.InputFinished(s);
+  }
+
+  void OnResult(Stream *s, const RecognitionResult &r, bool is_final,
+                bool is_last) {
+    FFmpegIngestResult ans;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ans.id = inputs_.at(s).id;
+    }
+    ans.result = r;
+    ans.is_final = is_final;
+    ans.is_last = is_last;
+
+    callback_(ans);
+
+    if (is_last) {
+      // The scheduler no longer refers to s, so it can be freed
+      std::lock_guard<std::mutex> lock(mutex_);
+      inputs_.erase(s);
+      --num_unfinished_;
+      done_cv_.notify_all();
+    }
+  }
+
+  void Fail(int32_t id, const std::string &error) {
+    FFmpegIngestResult ans;
+    ans.id = id;
+    ans.is_final = true;
+    ans.is_last = true;
+    ans.error = error;
+
+    callback_(ans);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    --num_unfinished_;
+    done_cv_.notify_all();
+  }
+
+ private:
+  const Recognizer *recognizer_;
+  FFmpegIngestConfig config_;
+  Callback callback_;
+
+  // Protects the members below it
+  std::mutex mutex_;
+
+  // Signaled when an input is added or stop_ is set
+  std::condition_variable cv_;
+
+  // Signaled when an input is finished
+  std::condition_variable done_cv_;
+
+  std::deque<std::pair<int32_t, std::string>> pending_;
+
+  // Inputs that are being read or recognized
+  std::unordered_map<Stream *, Input> inputs_;
+
+  int32_t next_id_ = 0;
+  int32_t num_unfinished_ = 0;
+  bool stop_ = false;
+
+  // It refers to the streams in inputs_, so it is destroyed before them
+  StreamScheduler scheduler_;
+  std::vector<std::thread> threads_;
+};
+
+FFmpegIngest::FFmpegIngest(const Recognizer *recognizer,
+                           const FFmpegIngestConfig &config,
+                           Callback callback)
+    : impl_(std::make_unique<Impl>(recognizer, config, std::move(callback))) {
+}
+
+FFmpegIngest::~FFmpegIngest() = default;
+
+int32_t FFmpegIngest::Add(const std::string &url) { return impl_->Add(url); }
+
+void FFmpegIngest::Wait() { impl_->Wait(); }
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,88 @@
+// ffmpeg-examples/ffmpeg-ingest.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef FFMPEG_EXAMPLES_FFMPEG_INGEST_H_
+#define FFMPEG_EXAMPLES_FFMPEG_INGEST_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "sherpa-ncnn/csrc/recognizer.h"
+#include "sherpa-ncnn/csrc/stream-scheduler.h"
+
+namespace sherpa_ncnn {
+
+struct FFmpegIngestConfig {
+  StreamSchedulerConfig scheduler_config;
+
+  // Number of inputs that are demuxed and decoded at the same time, each
+  // on its own thread. Use at least scheduler_config.max_batch_size so
+  // that the batches of the scheduler can be filled.
+  int32_t num_threads = 8;
+
+  // A thread stops reading its input while this many seconds of it are
+  // not recognized yet, so memory stays bounded for long inputs
+  float max_backlog = 10;
+
+  std::string ToString() const;
+};
+
+struct FFmpegIngestResult {
+  // The value returned by FFmpegIngest::Add()
+  int32_t id = 0;
+
+  // As in StreamScheduler::Callback
+  RecognitionResult result;
+  bool is_final = false;
+  bool is_last = false;
+
+  // Not empty if the input could not be read. is_last is then true.
+  std::string error;
+};
+
+/** Recognize many media files or network URLs that FFmpeg can read, e.g.,
+ * MP4 or Opus files.
+ *
+ * Each input is demuxed, decoded and resampled to mono 16-bit PCM on an
+ * ingest thread and fed to its own stream. The streams of all inputs are
+ * decoded by one StreamScheduler, so demuxing and recognition overlap and
+ * streams of different inputs share batches.
+ *
+ * Usage:
+ *
+ *   FFmpegIngest ingest(&recognizer, config, [](const auto &r) { ... });
+ *   for (const auto &url : urls) ingest.Add(url);
+ *   ingest.Wait();
+ */
+class FFmpegIngest {
+ public:
+  // It runs on a worker thread of the scheduler, or on an ingest thread
+  // if the input could not be read. Calls for one input never overlap.
+  using Callback = std::function<void(const FFmpegIngestResult &r)>;
+
+  FFmpegIngest(const Recognizer *recognizer, const FFmpegIngestConfig &config,
+               Callback callback);
+
+  // Inputs that are not finished are dropped
+  ~FFmpegIngest();
+
+  FFmpegIngest(const FFmpegIngest &) = delete;
+  FFmpegIngest &operator=(const FFmpegIngest &) = delete;
+
+  // Queue an input. Return its id, which increases from 0.
+  int32_t Add(const std::string &url);
+
+  // Wait until the last callback of every added input has returned
+  void Wait();
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // FFMPEG_EXAMPLES_FFMPEG_INGEST_H_
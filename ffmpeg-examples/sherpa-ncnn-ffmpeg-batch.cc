@@ -0,0 +1,145 @@
+// ffmpeg-examples/sherpa-ncnn-ffmpeg-batch.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <stdio.h>
+
+#include <cstdint>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "ffmpeg-examples/ffmpeg-ingest.h"
+#include "sherpa-ncnn/csrc/parse-options.h"
+#include "sherpa-ncnn/csrc/recognizer.h"
+
+int32_t main(int32_t argc, char *argv[]) {
+  const char *kUsageMessage = R"usage(
+Recognize many media files or URLs that FFmpeg can read.
+
+Up to --num-ingest-threads inputs are demuxed, decoded and resampled at
+the same time, while --num-workers threads recognize their streams in
+batches. An input with more than --max-backlog seconds of audio that is
+not recognized yet is not read from until it has caught up.
+
+The final results of each input are printed as "<id> <url>: <text>".
+
+Usage:
+
+  ./bin/sherpa-ncnn-ffmpeg-batch \
+    --tokens=/path/to/tokens.txt \
+    --encoder-param=/path/to/encoder.ncnn.param \
+    --encoder-bin=/path/to/encoder.ncnn.bin \
+    --decoder-param=/path/to/decoder.ncnn.param \
+    --decoder-bin=/path/to/decoder.ncnn.bin \
+    --joiner-param=/path/to/joiner.ncnn.param \
+    --joiner-bin=/path/to/joiner.ncnn.bin \
+    --num-workers=4 \
+    --num-ingest-threads=8 \
+    foo.mp4 bar.opus rtmp://127.0.0.1/live/livestream
+)usage";
+
+  sherpa_ncnn::ParseOptions po(kUsageMessage);
+
+  sherpa_ncnn::RecognizerConfig config;
+  sherpa_ncnn::FFmpegIngestConfig ingest_config;
+  int32_t num_threads = 1;
+
+  auto &model_config = config.model_config;
+  po.Register("tokens", &model_config.tokens, "Path to tokens.txt");
+  po.Register("encoder-param", &model_config.encoder_param,
+              "Path to encoder.ncnn.param");
+  po.Register("encoder-bin", &model_config.encoder_bin,
+              "Path to encoder.ncnn.bin");
+  po.Register("decoder-param", &model_config.decoder_param,
+              "Path to decoder.ncnn.param");
+  po.Register("decoder-bin", &model_config.decoder_bin,
+              "Path to decoder.ncnn.bin");
+  po.Register("joiner-param", &model_config.joiner_param,
+              "Path to joiner.ncnn.param");
+  po.Register("joiner-bin", &model_config.joiner_bin,
+              "Path to joiner.ncnn.bin");
+  po.Register("bundle", &model_config.bundle,
+              "Path to a model bundle. If given, the paths above are "
+              "ignored");
+  po.Register("num-threads", &num_threads,
+              "Number of threads of each network");
+  po.Register("decoding-method", &config.decoder_config.method,
+              "greedy_search or modified_beam_search");
+  po.Register("num-active-paths", &config.decoder_config.num_active_paths,
+              "Used only for modified_beam_search");
+  po.Register("enable-endpoint", &config.enable_endpoint,
+              "Print a final result at each endpoint");
+
+  auto &scheduler_config = ingest_config.scheduler_config;
+  po.Register("num-workers", &scheduler_config.num_threads,
+              "Number of threads that recognize streams");
+  po.Register("max-batch-size", &scheduler_config.max_batch_size,
+              "A worker decodes at most this many streams together");
+  po.Register("max-latency-ms", &scheduler_config.max_latency_ms,
+              "How long a ready stream may wait for others to join its "
+              "batch");
+
+  po.Register("num-ingest-threads", &ingest_config.num_threads,
+              "Number of inputs that are read at the same time");
+  po.Register("max-backlog", &ingest_config.max_backlog,
+              "Stop reading an input while it has more seconds of audio "
+              "that are not recognized yet");
+
+  po.Read(argc, argv);
+  if (po.NumArgs() == 0) {
+    po.PrintUsage();
+    exit(EXIT_FAILURE);
+  }
+
+  model_config.encoder_opt.num_threads = num_threads;
+  model_config.decoder_opt.num_threads = num_threads;
+  model_config.joiner_opt.num_threads = num_threads;
+
+  fprintf(stderr, "%s\n", config.ToString().c_str());
+  fprintf(stderr, "%s\n", ingest_config.ToString().c_str());
+
+  sherpa_ncnn::Recognizer recognizer(config);
+  if (!recognizer.GetModel()) {
+    fprintf(stderr, "Failed to create the recognizer\n");
+    return -1;
+  }
+  recognizer.WarmUp();
+
+  std::vector<std::string> urls;
+  for (int32_t i = 1; i <= po.NumArgs(); ++i) {
+    urls.push_back(po.GetArg(i));
+  }
+
+  std::mutex mutex;
+  int32_t num_failed = 0;
+
+  sherpa_ncnn::FFmpegIngest ingest(
+      &recognizer, ingest_config,
+      [&](const sherpa_ncnn::FFmpegIngestResult &r) {
+        if (!r.is_final) return;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!r.error.empty()) {
+          fprintf(stderr, "%d %s\n", r.id, r.error.c_str());
+          ++num_failed;
+          return;
+        }
+
+        if (r.result.text.empty()) return;
+
+        fprintf(stdout, "%d %s: %s\n", r.id, urls[r.id].c_str(),
+                r.result.text.c_str());
+        fflush(stdout);
+      });
+
+  for (const auto &url : urls) {
+    ingest.Add(url);
+  }
+  ingest.Wait();
+
+  fprintf(stderr, "Recognized %d inputs, %d failed\n",
+          static_cast<int32_t>(urls.size()) - num_failed, num_failed);
+
+  return num_failed == 0 ? 0 : -1;
+}
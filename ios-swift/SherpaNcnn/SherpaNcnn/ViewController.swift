@@ -8,18 +8,6 @@
 import AVFoundation
 import UIKit
 
-extension AudioBuffer {
-    func array() -> [Float] {
-        return Array(UnsafeBufferPointer(self))
-    }
-}
-
-extension AVAudioPCMBuffer {
-    func array() -> [Float] {
-        return self.audioBufferList.pointee.mBuffers.array()
-    }
-}
-
 class ViewController: UIViewController {
     @IBOutlet weak var resultLabel: UILabel!
     @IBOutlet weak var recordBtn: UIButton!
@@ -34,6 +22,9 @@ class ViewController: UIViewController {
         }
     }
     var lastSentence: String = ""
+
+    /// Revision of the result that lastSentence is from
+    var revision: Int32 = -1
     let maxSentence: Int = 20
     var results: String {
         if sentences.isEmpty && lastSentence.isEmpty {
@@ -159,23 +150,24 @@ class ViewController: UIViewController {
 
             // TODO(fangjun): Handle status != haveData
 
-            let array = convertedBuffer.array()
-            if !array.isEmpty {
-                self.recognizer.acceptWaveform(samples: array)
+            if convertedBuffer.frameLength > 0 {
+                self.recognizer.acceptWaveform(buffer: convertedBuffer)
                 while (self.recognizer.isReady()){
                     self.recognizer.decode()
                 }
                 let isEndpoint = self.recognizer.isEndpoint()
-                let text = self.recognizer.getResult().text
 
-                if !text.isEmpty && self.lastSentence != text {
+                // It is nil if the result has not changed
+                if let text = self.recognizer.getTextIfChanged(
+                    revision: &self.revision),
+                   !text.isEmpty {
                     self.lastSentence = text
                     self.updateLabel()
                     print(text)
                 }
 
                 if isEndpoint{
-                    if !text.isEmpty {
+                    if !self.lastSentence.isEmpty {
                         let tmp = self.lastSentence
                         self.lastSentence = ""
                         self.sentences.append(tmp)
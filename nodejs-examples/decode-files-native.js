@@ -0,0 +1,88 @@
+// Copyright (c)  2025  Xiaomi Corporation
+//
+// It decodes several wave files in one batch with a SenseVoice model and
+// the native addon, which is built by ../build-node-addon.sh
+//
+// Usage:
+//   node ./decode-files-native.js [a.wav b.wav ...]
+const fs = require('fs');
+
+const sherpa_ncnn =
+    require('../build-node-addon/sherpa-ncnn-node/index.js');
+
+const modelDir = './sherpa-ncnn-sense-voice-zh-en-ja-ko-yue-2024-07-17';
+
+// Return the samples of a 16-bit mono wave file as a Buffer. The Buffer is
+// passed to the addon as it is, without converting it to float.
+function readWave(filename) {
+  const buf = fs.readFileSync(filename);
+
+  let sampleRate = 0;
+  let offset = 12;
+  while (offset + 8 <= buf.length) {
+    const id = buf.toString('ascii', offset, offset + 4);
+    const size = buf.readUInt32LE(offset + 4);
+
+    if (id == 'fmt ') {
+      const audioFormat = buf.readUInt16LE(offset + 8);
+      const channels = buf.readUInt16LE(offset + 10);
+      const bitDepth = buf.readUInt16LE(offset + 22);
+      if (audioFormat != 1 || channels != 1 || bitDepth != 16) {
+        throw new Error(`${filename}: only 16-bit mono PCM is supported`);
+      }
+      sampleRate = buf.readUInt32LE(offset + 12);
+    } else if (id == 'data') {
+      return {
+        sampleRate: sampleRate,
+        samples: buf.subarray(offset + 8, offset + 8 + size),
+      };
+    }
+
+    offset += 8 + size;
+  }
+
+  throw new Error(`${filename}: no data chunk`);
+}
+
+async function main() {
+  const recognizer = sherpa_ncnn.createOfflineRecognizer({
+    modelConfig: {
+      senseVoice: {
+        modelDir: modelDir,
+        language: 'auto',
+        useInverseTextNormalization: 1,
+      },
+      tokens: `${modelDir}/tokens.txt`,
+      numThreads: 4,
+    },
+  });
+
+  let filenames = process.argv.slice(2);
+  if (filenames.length == 0) {
+    filenames = ['zh.wav', 'en.wav', 'ja.wav', 'ko.wav', 'yue.wav'].map(
+        (f) => `${modelDir}/test_wavs/${f}`);
+  }
+
+  const streams = filenames.map((f) => {
+    const wave = readWave(f);
+    const stream = recognizer.createStream();
+    stream.acceptWaveform(wave.sampleRate, wave.samples);
+    return stream;
+  });
+
+  // The event loop keeps running while the streams are decoded
+  const start = Date.now();
+  await recognizer.decodeAsync(streams);
+  const elapsed = (Date.now() - start) / 1000;
+
+  for (let i = 0; i < streams.length; ++i) {
+    console.log(filenames[i], recognizer.getResult(streams[i]));
+    streams[i].free();
+  }
+
+  console.log(`Decoded ${streams.length} files in ${elapsed} seconds`);
+
+  recognizer.free();
+}
+
+main();
@@ -1,5 +1,6 @@
 // Copyright (c)  2023  Xiaomi Corporation (authors: Fangjun Kuang)
 
+using System.Collections.Generic;
 using System.Runtime.InteropServices;
 using System;
 using System.Text;
@@ -34,6 +35,55 @@ namespace SherpaNcnn
         public int UseVulkanCompute;
 
         public int NumThreads;
+
+        // 0 to use NumThreads
+        public int DecoderNumThreads;
+        public int JoinerNumThreads;
+
+        // 0 for all cores, 1 for the little cores and 2 for the big cores
+        public int EncoderPowersave;
+        public int DecoderPowersave;
+        public int JoinerPowersave;
+
+        // Optional. Comma separated ids of the CPU cores all networks run on
+        [MarshalAs(UnmanagedType.LPStr)]
+        public string CpuCores;
+
+        // Optional. A pointer to NumBuffers SherpaNcnnModelBuffer, i.e.,
+        // name, data and size of the files of the model in memory. If
+        // NumBuffers is positive, the paths above are ignored
+        public IntPtr Buffers;
+        public int NumBuffers;
+
+        // Optional. Comma separated .param and .bin of the encoder exported
+        // with other chunk sizes
+        [MarshalAs(UnmanagedType.LPStr)]
+        public string EncoderVariants;
+
+        // Optional. Precision of each network: "accuracy" (fp32),
+        // "balanced" (fp16 or bf16 storage, fp32 arithmetic) or "speed"
+        // (also fp16 arithmetic where supported). Empty for the defaults
+        // of ncnn
+        [MarshalAs(UnmanagedType.LPStr)]
+        public string EncoderPrecision;
+        [MarshalAs(UnmanagedType.LPStr)]
+        public string DecoderPrecision;
+        [MarshalAs(UnmanagedType.LPStr)]
+        public string JoinerPrecision;
+
+        // Optional. If positive, the networks allocate their intermediate
+        // memory from a fixed arena of this many MB instead of the heap
+        public int ArenaMb;
+
+        // Optional. "host:port" of a sherpa-ncnn-encoder-server with the
+        // same model. If not empty, the encoder runs on that server
+        [MarshalAs(UnmanagedType.LPStr)]
+        public string RemoteEncoder;
+
+        // Optional. Path to a profile written by sherpa-ncnn-autotune. If
+        // not empty, the options of each network are taken from it
+        [MarshalAs(UnmanagedType.LPStr)]
+        public string PerfProfile;
     }
 
     [StructLayout(LayoutKind.Sequential)]
@@ -68,6 +118,15 @@ namespace SherpaNcnn
         public string HotwordsFile;
 
         public float HotwordsScore;
+
+        public int EnableProfiling;
+
+        // 1 to publish the result of each stream after each decoded chunk
+        // so that it can be read from other threads
+        public int PublishResults;
+
+        // Maximum number of streams kept for reuse. 0 disables the pool
+        public int StreamPoolSize;
     }
 
     // please see
@@ -107,6 +166,43 @@ namespace SherpaNcnn
             Decode(_handle.Handle, stream.Handle);
         }
 
+        // Return the streams that are ready for decoding, in their order
+        // in streams
+        public OnlineStream[] IsReady(OnlineStream[] streams)
+        {
+            IntPtr[] ptrs = GetHandles(streams);
+            byte[] ready = new byte[(streams.Length + 7) / 8];
+            IsReadyMultiple(_handle.Handle, ptrs, ptrs.Length, ready);
+
+            List<OnlineStream> ans = new List<OnlineStream>();
+            for (int i = 0; i != streams.Length; ++i)
+            {
+                if ((ready[i / 8] & (1 << (i % 8))) != 0)
+                {
+                    ans.Add(streams[i]);
+                }
+            }
+            return ans.ToArray();
+        }
+
+        // Decode the streams in one batch, which is faster than calling
+        // Decode() for each of them. Each stream must be ready.
+        public void Decode(OnlineStream[] streams)
+        {
+            IntPtr[] ptrs = GetHandles(streams);
+            DecodeMultipleStreams(_handle.Handle, ptrs, ptrs.Length);
+        }
+
+        private static IntPtr[] GetHandles(OnlineStream[] streams)
+        {
+            IntPtr[] ptrs = new IntPtr[streams.Length];
+            for (int i = 0; i != streams.Length; ++i)
+            {
+                ptrs[i] = streams[i].Handle;
+            }
+            return ptrs;
+        }
+
         public OnlineRecognizerResult GetResult(OnlineStream stream)
         {
             IntPtr h = GetResult(_handle.Handle, stream.Handle);
@@ -115,6 +211,47 @@ namespace SherpaNcnn
             return result;
         }
 
+        // It increases whenever the result of the stream changes
+        public int GetResultRevision(OnlineStream stream)
+        {
+            return GetResultRevision(stream.Handle);
+        }
+
+        // Return the result if its revision differs from revision, which is
+        // then updated, and null otherwise. The native result is owned by
+        // the stream, so nothing is allocated for an unchanged result, e.g.,
+        // when polling after every Decode().
+        public OnlineRecognizerResult GetResultIfChanged(OnlineStream stream, ref int revision)
+        {
+            if (GetResultRevision(stream.Handle) == revision)
+            {
+                return null;
+            }
+
+            IntPtr h = GetBorrowedResult(_handle.Handle, stream.Handle, out revision);
+            return new OnlineRecognizerResult(h);
+        }
+
+#if NETCOREAPP2_1_OR_GREATER
+        // Return the UTF-8 text of the result without allocating anything.
+        // It is valid until the next call of it, GetResultIfChanged() or
+        // Decode() for the stream.
+        public unsafe ReadOnlySpan<byte> GetResultUtf8(OnlineStream stream)
+        {
+            int revision;
+            IntPtr h = GetBorrowedResult(_handle.Handle, stream.Handle, out revision);
+
+            // The text is the first field of the result
+            byte* text = *(byte**)h;
+            int n = 0;
+            while (text[n] != 0)
+            {
+                ++n;
+            }
+            return new ReadOnlySpan<byte>(text, n);
+        }
+#endif
+
         public void Dispose()
         {
             Cleanup();
@@ -137,6 +274,7 @@ namespace SherpaNcnn
         }
 
         private HandleRef _handle;
+        internal IntPtr Handle => _handle.Handle;
 
         private const string dllName = "sherpa-ncnn-c-api";
 
@@ -161,11 +299,23 @@ namespace SherpaNcnn
         [DllImport(dllName, EntryPoint = "Decode")]
         private static extern void Decode(IntPtr handle, IntPtr stream);
 
+        [DllImport(dllName)]
+        private static extern int IsReadyMultiple(IntPtr handle, IntPtr[] streams, int n, byte[] ready);
+
+        [DllImport(dllName)]
+        private static extern void DecodeMultipleStreams(IntPtr handle, IntPtr[] streams, int n);
+
         [DllImport(dllName)]
         private static extern IntPtr GetResult(IntPtr handle, IntPtr stream);
 
         [DllImport(dllName)]
         private static extern void DestroyResult(IntPtr result);
+
+        [DllImport(dllName)]
+        private static extern int GetResultRevision(IntPtr stream);
+
+        [DllImport(dllName)]
+        private static extern IntPtr GetBorrowedResult(IntPtr handle, IntPtr stream, out int revision);
     }
 
 
@@ -180,6 +330,35 @@ namespace SherpaNcnn
         {
             AcceptWaveform(Handle, sampleRate, samples, samples.Length);
         }
+
+        // 16-bit PCM samples, e.g., from a wave file or a microphone. They
+        // are converted to float in native code.
+        public void AcceptWaveform(float sampleRate, short[] samples)
+        {
+            AcceptWaveformInt16(Handle, sampleRate, samples, samples.Length);
+        }
+
+#if NETCOREAPP2_1_OR_GREATER
+        // The samples are pinned and read in place, so a slice of a larger
+        // buffer or native memory of an audio device needs no copy to an
+        // array.
+        public unsafe void AcceptWaveform(float sampleRate, ReadOnlySpan<float> samples)
+        {
+            fixed (float* p = samples)
+            {
+                AcceptWaveform(Handle, sampleRate, p, samples.Length);
+            }
+        }
+
+        public unsafe void AcceptWaveform(float sampleRate, ReadOnlySpan<short> samples)
+        {
+            fixed (short* p = samples)
+            {
+                AcceptWaveformInt16(Handle, sampleRate, p, samples.Length);
+            }
+        }
+#endif
+
         public void InputFinished()
         {
             InputFinished(Handle);
@@ -217,6 +396,15 @@ namespace SherpaNcnn
         [DllImport(dllName)]
         private static extern void AcceptWaveform(IntPtr handle, float sampleRate, float[] samples, int n);
 
+        [DllImport(dllName)]
+        private static extern unsafe void AcceptWaveform(IntPtr handle, float sampleRate, float* samples, int n);
+
+        [DllImport(dllName)]
+        private static extern void AcceptWaveformInt16(IntPtr handle, float sampleRate, short[] samples, int n);
+
+        [DllImport(dllName)]
+        private static extern unsafe void AcceptWaveformInt16(IntPtr handle, float sampleRate, short* samples, int n);
+
         [DllImport(dllName)]
         private static extern void InputFinished(IntPtr handle);
     }
@@ -261,4 +449,126 @@ namespace SherpaNcnn
 
     }
 
+    // It is called on the thread of an OnlineDecodeWorker for the results of
+    // its streams. isFinal is true if an endpoint is detected or the input of
+    // the stream is finished and fully decoded. Otherwise, the result is a
+    // partial one and differs from the last result of the stream.
+    //
+    // The stream is reset after the callback returns at an endpoint.
+    public delegate void OnlineDecodeCallback(OnlineStream stream, OnlineRecognizerResult result, bool isFinal);
+
+    // A native thread that decodes the streams added to it, in batches,
+    // whenever they are ready. No thread is needed to poll the streams.
+    //
+    // While a stream is in a worker, only AcceptWaveform() and
+    // InputFinished() may be called for it, followed by Notify().
+    public class OnlineDecodeWorker : IDisposable
+    {
+        // The recognizer must not be disposed before the worker
+        public OnlineDecodeWorker(OnlineRecognizer recognizer, OnlineDecodeCallback callback)
+        {
+            _recognizer = recognizer;
+            _callback = callback;
+
+            // Keep the delegate alive while the native code uses it
+            _nativeCallback = OnResult;
+
+            IntPtr h = SherpaNcnnStartDecodeWorker(recognizer.Handle, _nativeCallback, IntPtr.Zero);
+            _handle = new HandleRef(this, h);
+        }
+
+        // Decode the stream on the worker from now on. Do not dispose the
+        // stream before calling RemoveStream()
+        public void AddStream(OnlineStream stream)
+        {
+            lock (_streams)
+            {
+                _streams[stream.Handle] = stream;
+            }
+            SherpaNcnnDecodeWorkerAddStream(_handle.Handle, stream.Handle);
+        }
+
+        // When it returns, the worker no longer uses the stream. A stream is
+        // removed automatically after its input is finished and fully
+        // decoded, but it is still fine to call it for the stream.
+        public void RemoveStream(OnlineStream stream)
+        {
+            SherpaNcnnDecodeWorkerRemoveStream(_handle.Handle, stream.Handle);
+            lock (_streams)
+            {
+                _streams.Remove(stream.Handle);
+            }
+        }
+
+        // Wake up the worker after feeding audio to its streams or calling
+        // InputFinished()
+        public void Notify()
+        {
+            SherpaNcnnDecodeWorkerNotify(_handle.Handle);
+        }
+
+        private void OnResult(IntPtr s, IntPtr r, int isFinal, IntPtr userData)
+        {
+            OnlineStream stream;
+            lock (_streams)
+            {
+                if (!_streams.TryGetValue(s, out stream))
+                {
+                    return;
+                }
+            }
+            _callback(stream, new OnlineRecognizerResult(r), isFinal != 0);
+        }
+
+        public void Dispose()
+        {
+            Cleanup();
+            // Prevent the object from being placed on the
+            // finalization queue
+            System.GC.SuppressFinalize(this);
+        }
+
+        ~OnlineDecodeWorker()
+        {
+            Cleanup();
+        }
+
+        private void Cleanup()
+        {
+            if (_handle.Handle != IntPtr.Zero)
+            {
+                SherpaNcnnStopDecodeWorker(_handle.Handle);
+            }
+
+            // Don't permit the handle to be used again.
+            _handle = new HandleRef(this, IntPtr.Zero);
+        }
+
+        private HandleRef _handle;
+        private OnlineRecognizer _recognizer;
+        private OnlineDecodeCallback _callback;
+        private NativeCallback _nativeCallback;
+        private Dictionary<IntPtr, OnlineStream> _streams = new Dictionary<IntPtr, OnlineStream>();
+
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        private delegate void NativeCallback(IntPtr stream, IntPtr result, int isFinal, IntPtr userData);
+
+        private const string dllName = "sherpa-ncnn-c-api";
+
+        [DllImport(dllName)]
+        private static extern IntPtr SherpaNcnnStartDecodeWorker(IntPtr recognizer, NativeCallback callback, IntPtr userData);
+
+        [DllImport(dllName)]
+        private static extern void SherpaNcnnDecodeWorkerAddStream(IntPtr handle, IntPtr stream);
+
+        [DllImport(dllName)]
+        private static extern void SherpaNcnnDecodeWorkerRemoveStream(IntPtr handle, IntPtr stream);
+
+        [DllImport(dllName)]
+        private static extern void SherpaNcnnDecodeWorkerNotify(IntPtr handle);
+
+        [DllImport(dllName)]
+        private static extern void SherpaNcnnStopDecodeWorker(IntPtr handle);
+    }
+
 }
@@ -31,8 +31,15 @@ package sherpa_ncnn
 
 // #include <stdlib.h>
 // #include "c-api.h"
+//
+// extern void sherpaNcnnGoDecodeCallback(SherpaNcnnStream *s,
+//                                        SherpaNcnnResult *r,
+//                                        int32_t is_final, void *user_data);
 import "C"
-import "unsafe"
+import (
+	"sync"
+	"unsafe"
+)
 
 // Please refer to
 // https://k2-fsa.github.io/sherpa/ncnn/pretrained_models/
@@ -46,6 +53,26 @@ type ModelConfig struct {
 	JoinerBin    string // Path to the joiner.ncnn.bin
 	Tokens       string // Path to tokens.txt
 	NumThreads   int    // Number of threads to use for neural network computation
+
+	// The CPU cores of the encoder, decoder and joiner: 0 for all cores,
+	// 1 for the little cores and 2 for the big cores
+	EncoderPowersave int
+	DecoderPowersave int
+	JoinerPowersave  int
+
+	// Optional. Comma separated ids of the CPU cores all networks run on,
+	// e.g., "4,5,6,7". If not empty, it overrides the powersave options
+	CpuCores string
+
+	// Optional. Precision of all networks: "accuracy" (fp32), "balanced"
+	// (fp16 or bf16 storage, fp32 arithmetic) or "speed" (also fp16
+	// arithmetic where supported, e.g., on ARMv8.2). Empty for the
+	// defaults of ncnn
+	Precision string
+
+	// Optional. If positive, the networks allocate their intermediate
+	// memory from a fixed arena of this many MB instead of the heap
+	ArenaMb int
 }
 
 // Configuration for the feature extractor
@@ -87,6 +114,8 @@ type RecognizerConfig struct {
 
 	HotwordsFile  string
 	HotwordsScore float32
+
+	EnableProfiling int // 1 to enable per-stage latency statistics
 }
 
 // It contains the recognition result for a online stream.
@@ -141,6 +170,21 @@ func NewRecognizer(config *RecognizerConfig) *Recognizer {
 	c.model_config.use_vulkan_compute = C.int(0)
 	c.model_config.num_threads = C.int(config.Model.NumThreads)
 
+	c.model_config.encoder_powersave = C.int(config.Model.EncoderPowersave)
+	c.model_config.decoder_powersave = C.int(config.Model.DecoderPowersave)
+	c.model_config.joiner_powersave = C.int(config.Model.JoinerPowersave)
+
+	c.model_config.cpu_cores = C.CString(config.Model.CpuCores)
+	defer C.free(unsafe.Pointer(c.model_config.cpu_cores))
+
+	precision := C.CString(config.Model.Precision)
+	defer C.free(unsafe.Pointer(precision))
+	c.model_config.encoder_precision = precision
+	c.model_config.decoder_precision = precision
+	c.model_config.joiner_precision = precision
+
+	c.model_config.arena_mb = C.int(config.Model.ArenaMb)
+
 	c.decoder_config.decoding_method = C.CString(config.Decoder.DecodingMethod)
 	defer C.free(unsafe.Pointer(c.decoder_config.decoding_method))
 
@@ -156,6 +200,8 @@ func NewRecognizer(config *RecognizerConfig) *Recognizer {
 
 	c.hotwords_score = C.float(config.HotwordsScore)
 
+	c.enable_profiling = C.int(config.EnableProfiling)
+
 	recognizer := &Recognizer{}
 	recognizer.impl = C.CreateRecognizer(&c)
 
@@ -240,6 +286,53 @@ func (recognizer *Recognizer) Decode(s *Stream) {
 	C.Decode(recognizer.impl, s.impl)
 }
 
+// Decode the streams in one batch, which is faster than calling Decode()
+// for each of them. Each stream must be ready, see IsReadyMultiple().
+//
+// You usually use it like below:
+//
+//	ready := recognizer.IsReadyMultiple(streams)
+//	for len(ready) > 0 {
+//	  recognizer.DecodeMultipleStreams(ready)
+//	  ready = recognizer.IsReadyMultiple(ready)
+//	}
+func (recognizer *Recognizer) DecodeMultipleStreams(ss []*Stream) {
+	if len(ss) == 0 {
+		return
+	}
+
+	impl := make([]*C.struct_SherpaNcnnStream, len(ss))
+	for i, s := range ss {
+		impl[i] = s.impl
+	}
+
+	C.DecodeMultipleStreams(recognizer.impl, &impl[0], C.int(len(ss)))
+}
+
+// Return the streams that are ready for decoding, in their order in ss
+func (recognizer *Recognizer) IsReadyMultiple(ss []*Stream) []*Stream {
+	if len(ss) == 0 {
+		return nil
+	}
+
+	impl := make([]*C.struct_SherpaNcnnStream, len(ss))
+	for i, s := range ss {
+		impl[i] = s.impl
+	}
+
+	bitmap := make([]C.uint8_t, (len(ss)+7)/8)
+	C.IsReadyMultiple(recognizer.impl, &impl[0], C.int(len(ss)), &bitmap[0])
+
+	var ready []*Stream
+	for i, s := range ss {
+		if bitmap[i/8]&(1<<uint(i%8)) != 0 {
+			ready = append(ready, s)
+		}
+	}
+
+	return ready
+}
+
 // Get the current result of stream since the last invoke of Reset()
 func (recognizer *Recognizer) GetResult(s *Stream) *RecognizerResult {
 	p := C.GetResult(recognizer.impl, s.impl)
@@ -249,3 +342,129 @@ func (recognizer *Recognizer) GetResult(s *Stream) *RecognizerResult {
 
 	return result
 }
+
+// It is called on the thread of a [DecodeWorker] for the results of its
+// streams. isFinal is true if an endpoint is detected or the input of the
+// stream is finished and fully decoded. Otherwise, the result is a partial
+// one and differs from the last result of the stream.
+//
+// The stream is reset after the callback returns at an endpoint.
+type DecodeCallback func(s *Stream, result *RecognizerResult, isFinal bool)
+
+// A native thread that decodes the streams added to it, in batches,
+// whenever they are ready. Results are reported through a [DecodeCallback],
+// so no goroutine is needed to poll the streams.
+//
+// While a stream is in a worker, only [Stream.AcceptWaveform] and
+// [Stream.InputFinished] may be called for it, followed by
+// [DecodeWorker.Notify].
+type DecodeWorker struct {
+	impl     *C.struct_SherpaNcnnDecodeWorker
+	id       *C.int
+	callback DecodeCallback
+
+	mutex   sync.Mutex
+	streams map[*C.struct_SherpaNcnnStream]*Stream
+}
+
+// The C callback gets the id of a worker, since Go pointers cannot be kept
+// by C code
+var (
+	decodeWorkersMutex sync.Mutex
+	decodeWorkers      = map[C.int]*DecodeWorker{}
+	nextDecodeWorkerId C.int
+)
+
+//export sherpaNcnnGoDecodeCallback
+func sherpaNcnnGoDecodeCallback(s *C.SherpaNcnnStream, r *C.SherpaNcnnResult,
+	isFinal C.int32_t, userData unsafe.Pointer) {
+	decodeWorkersMutex.Lock()
+	w := decodeWorkers[*(*C.int)(userData)]
+	decodeWorkersMutex.Unlock()
+
+	w.mutex.Lock()
+	stream := w.streams[s]
+	w.mutex.Unlock()
+
+	if stream == nil {
+		return
+	}
+
+	result := &RecognizerResult{}
+	result.Text = C.GoString(r.text)
+
+	w.callback(stream, result, isFinal != 0)
+}
+
+// The user is responsible to invoke [DeleteDecodeWorker]() to stop
+// the returned worker. The recognizer must not be deleted before it.
+//
+// You usually use it like below:
+//
+//	worker := NewDecodeWorker(recognizer, func(s *Stream, r *RecognizerResult, isFinal bool) {
+//	  // do your own stuff with the result
+//	})
+//	worker.AddStream(s)
+//
+//	// for each chunk of audio
+//	s.AcceptWaveform(sampleRate, samples)
+//	worker.Notify()
+func NewDecodeWorker(recognizer *Recognizer, callback DecodeCallback) *DecodeWorker {
+	w := &DecodeWorker{}
+	w.callback = callback
+	w.streams = make(map[*C.struct_SherpaNcnnStream]*Stream)
+
+	decodeWorkersMutex.Lock()
+	nextDecodeWorkerId += 1
+	w.id = (*C.int)(C.malloc(C.size_t(unsafe.Sizeof(C.int(0)))))
+	*w.id = nextDecodeWorkerId
+	decodeWorkers[*w.id] = w
+	decodeWorkersMutex.Unlock()
+
+	w.impl = C.SherpaNcnnStartDecodeWorker(recognizer.impl,
+		C.SherpaNcnnDecodeCallback(C.sherpaNcnnGoDecodeCallback),
+		unsafe.Pointer(w.id))
+
+	return w
+}
+
+// Stop the thread of the worker. The callback is not called after it
+// returns. The streams are not deleted.
+func DeleteDecodeWorker(w *DecodeWorker) {
+	C.SherpaNcnnStopDecodeWorker(w.impl)
+	w.impl = nil
+
+	decodeWorkersMutex.Lock()
+	delete(decodeWorkers, *w.id)
+	decodeWorkersMutex.Unlock()
+
+	C.free(unsafe.Pointer(w.id))
+	w.id = nil
+}
+
+// Decode the stream on the worker from now on. Do not delete the stream
+// before calling [DecodeWorker.RemoveStream].
+func (w *DecodeWorker) AddStream(s *Stream) {
+	w.mutex.Lock()
+	w.streams[s.impl] = s
+	w.mutex.Unlock()
+
+	C.SherpaNcnnDecodeWorkerAddStream(w.impl, s.impl)
+}
+
+// Stop decoding the stream. When it returns, the worker no longer uses the
+// stream. A stream is removed automatically after its input is finished and
+// fully decoded, but it is still fine to call this function for it.
+func (w *DecodeWorker) RemoveStream(s *Stream) {
+	C.SherpaNcnnDecodeWorkerRemoveStream(w.impl, s.impl)
+
+	w.mutex.Lock()
+	delete(w.streams, s.impl)
+	w.mutex.Unlock()
+}
+
+// Wake up the worker after feeding audio to its streams or calling
+// [Stream.InputFinished]
+func (w *DecodeWorker) Notify() {
+	C.SherpaNcnnDecodeWorkerNotify(w.impl)
+}
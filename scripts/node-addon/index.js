@@ -0,0 +1,164 @@
+// Copyright (c)  2025  Xiaomi Corporation
+//
+// The native addon of sherpa-ncnn. It has the same API as the WASM package
+// sherpa-ncnn, but it runs with all the threads of ncnn, accepts audio
+// without copying it and can decode many streams in one batch in a worker
+// thread of libuv.
+'use strict'
+
+const addon = require('./sherpa-ncnn-node.node');
+
+class Stream {
+  constructor(handle) {
+    this.handle = handle;
+  }
+
+  free() {
+    if (this.handle) {
+      addon.freeStream(this.handle);
+      this.handle = null;
+    }
+  }
+
+  // samples is a Float32Array normalized to [-1, 1], an Int16Array or a
+  // Buffer of 16-bit PCM samples. It is read in place.
+  acceptWaveform(sampleRate, samples) {
+    addon.acceptWaveform(this.handle, sampleRate, samples);
+  }
+
+  inputFinished() {
+    addon.inputFinished(this.handle);
+  }
+}
+
+class Recognizer {
+  constructor(config) {
+    this.config = config;
+    this.handle = addon.createRecognizer(config);
+  }
+
+  // The model is freed after the last stream of it
+  free() {
+    if (this.handle) {
+      addon.freeRecognizer(this.handle);
+      this.handle = null;
+    }
+  }
+
+  createStream() {
+    return new Stream(addon.createStream(this.handle));
+  }
+
+  isReady(stream) {
+    return addon.isReady(stream.handle);
+  }
+
+  isEndpoint(stream) {
+    return addon.isEndpoint(stream.handle);
+  }
+
+  // Decode all ready chunks of the stream
+  decode(stream) {
+    return addon.decode(this.handle, [stream.handle]);
+  }
+
+  // Decode all ready chunks of the streams in batches, which is faster than
+  // calling decode() for each of them
+  decodeMultipleStreams(streams) {
+    return addon.decode(this.handle, streams.map((s) => s.handle));
+  }
+
+  // Like decodeMultipleStreams(), but it runs in a worker thread. It
+  // returns a promise of the number of decoded chunks. The streams must
+  // not be used until it is settled.
+  decodeAsync(streams) {
+    return addon.decodeAsync(this.handle, streams.map((s) => s.handle));
+  }
+
+  reset(stream) {
+    addon.reset(stream.handle);
+  }
+
+  // Return {text, tokens, timestamps}
+  getResult(stream) {
+    return addon.getResult(stream.handle);
+  }
+}
+
+class OfflineStream {
+  constructor(handle) {
+    this.handle = handle;
+  }
+
+  free() {
+    if (this.handle) {
+      addon.freeOfflineStream(this.handle);
+      this.handle = null;
+    }
+  }
+
+  // See Stream.acceptWaveform()
+  acceptWaveform(sampleRate, samples) {
+    addon.acceptWaveformOffline(this.handle, sampleRate, samples);
+  }
+}
+
+class OfflineRecognizer {
+  constructor(config) {
+    this.config = config;
+    this.handle = addon.createOfflineRecognizer(config);
+  }
+
+  free() {
+    if (this.handle) {
+      addon.freeOfflineRecognizer(this.handle);
+      this.handle = null;
+    }
+  }
+
+  createStream() {
+    return new OfflineStream(addon.createOfflineStream(this.handle));
+  }
+
+  decode(stream) {
+    addon.decodeOffline(this.handle, [stream.handle]);
+  }
+
+  // The streams are decoded in batches of modelConfig.numThreads
+  decodeMultipleStreams(streams) {
+    addon.decodeOffline(this.handle, streams.map((s) => s.handle));
+  }
+
+  // Like decodeMultipleStreams(), but it runs in a worker thread and
+  // returns a promise. The streams must not be used until it is settled.
+  decodeAsync(streams) {
+    return addon.decodeOfflineAsync(this.handle, streams.map((s) => s.handle));
+  }
+
+  // Return {text, tokens, timestamps, lang, emotion, event}
+  getResult(stream) {
+    return JSON.parse(addon.getOfflineResult(stream.handle));
+  }
+}
+
+function createRecognizer(config) {
+  return new Recognizer(config);
+}
+
+// config is
+// {
+//   modelConfig: {
+//     senseVoice: {modelDir, language, useInverseTextNormalization},
+//     tokens, numThreads,
+//   },
+//   decodingMethod, maxActivePaths, hotwordsFile, hotwordsScore,
+//   chunkDuration, chunkOverlap, lengthBucket,
+// }
+function createOfflineRecognizer(config) {
+  return new OfflineRecognizer(config);
+}
+
+module.exports = {
+  createRecognizer,
+  createOfflineRecognizer,
+};
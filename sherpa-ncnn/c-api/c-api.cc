@@ -19,26 +19,102 @@
 #include "sherpa-ncnn/c-api/c-api.h"
 
 #include <algorithm>
+#include <chrono>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <future>  // NOLINT
 #include <memory>
+#include <mutex>  // NOLINT
 #include <string>
+#include <thread>  // NOLINT
 #include <utility>
+#include <vector>
 
+#include "sherpa-ncnn/csrc/autotune.h"
 #include "sherpa-ncnn/csrc/display.h"
+#include "sherpa-ncnn/csrc/metrics.h"
 #include "sherpa-ncnn/csrc/model.h"
 #include "sherpa-ncnn/csrc/recognizer.h"
+#include "sherpa-ncnn/csrc/text-utils.h"
+#include "sherpa-ncnn/csrc/trace.h"
 #include "sherpa-ncnn/csrc/version.h"
+
+// The functions of the model families that are not compiled into
+// sherpa-ncnn-core are not defined, see SHERPA_NCNN_ENABLE_TTS, etc. in
+// CMakeLists.txt
+#ifndef SHERPA_NCNN_DISABLE_SENSE_VOICE
+#include "sherpa-ncnn/csrc/offline-recognizer.h"
+#endif
+
+#ifndef SHERPA_NCNN_DISABLE_TTS
+#include "sherpa-ncnn/csrc/offline-tts.h"
+#endif
+
+#ifndef SHERPA_NCNN_DISABLE_VAD
 #include "sherpa-ncnn/csrc/voice-activity-detector.h"
+#endif
+
+#if !defined(SHERPA_NCNN_DISABLE_SENSE_VOICE) && \
+    !defined(SHERPA_NCNN_DISABLE_VAD)
+#include "sherpa-ncnn/csrc/simulated-streaming-asr.h"
+#endif
 
 const char *SherpaNcnnGetVersionStr() { return sherpa_ncnn::GetVersionStr(); }
 const char *SherpaNcnnGetGitSha1() { return sherpa_ncnn::GetGitSha1(); }
 const char *SherpaNcnnGetGitDate() { return sherpa_ncnn::GetGitDate(); }
 
+void SherpaNcnnStartTrace(const char *filename) {
+  sherpa_ncnn::Tracer::Start(filename);
+}
+
+int32_t SherpaNcnnStopTrace() { return sherpa_ncnn::Tracer::Stop(); }
+
+void SherpaNcnnEnableMetrics(int32_t enabled) {
+  sherpa_ncnn::Metrics::Enable(enabled);
+}
+
+const char *SherpaNcnnGetMetrics() {
+  std::string text = sherpa_ncnn::Metrics::ToOpenMetrics();
+
+  char *ans = new char[text.size() + 1];
+  std::copy(text.begin(), text.end(), ans);
+  ans[text.size()] = 0;
+
+  return ans;
+}
+
+void SherpaNcnnDestroyMetrics(const char *metrics) { delete[] metrics; }
+
+struct SherpaNcnnModel {
+  std::shared_ptr<sherpa_ncnn::Model> model;
+};
+
 struct SherpaNcnnRecognizer {
   std::unique_ptr<sherpa_ncnn::Recognizer> recognizer;
 };
 
 struct SherpaNcnnStream {
   std::unique_ptr<sherpa_ncnn::Stream> stream;
+
+  // The decoded tokens when the revision was last updated
+  std::vector<int32_t> last_tokens;
+  int32_t revision = 0;
+
+  // The result of GetBorrowedResult() and the memory it points to, which
+  // is reused across calls
+  SherpaNcnnResult result = {};
+  int32_t result_revision = -1;
+  std::string text;
+  std::string tokens;
+  std::vector<float> timestamps;
+
+  // The result of GetResultUpdate() and the memory it points to
+  SherpaNcnnResultUpdate update = {};
+  sherpa_ncnn::RecognitionResultUpdate update_data;
+  std::string update_tokens;
+};
+
+struct SherpaNcnnRecognizerLoader {
+  std::future<std::unique_ptr<sherpa_ncnn::Recognizer>> future;
 };
 
 struct SherpaNcnnDisplay {
@@ -47,28 +123,83 @@ struct SherpaNcnnDisplay {
 
 #define SHERPA_NCNN_OR(x, y) (x ? x : y)
 
-SherpaNcnnRecognizer *CreateRecognizer(
-    const SherpaNcnnRecognizerConfig *in_config) {
-  // model_config
-  sherpa_ncnn::RecognizerConfig config;
-  config.model_config.encoder_param = in_config->model_config.encoder_param;
-  config.model_config.encoder_bin = in_config->model_config.encoder_bin;
+// Return nullptr if there are no buffers
+static std::shared_ptr<const sherpa_ncnn::ModelBundle> GetModelBuffers(
+    const SherpaNcnnModelBuffer *buffers, int32_t num_buffers) {
+  if (!buffers || num_buffers <= 0) {
+    return nullptr;
+  }
+
+  std::vector<sherpa_ncnn::ModelBuffer> v(num_buffers);
+  for (int32_t i = 0; i != num_buffers; ++i) {
+    v[i].name = SHERPA_NCNN_OR(buffers[i].name, "");
+    v[i].data = buffers[i].data;
+    v[i].size = buffers[i].size;
+  }
+
+  return sherpa_ncnn::ModelBundle::FromBuffers(v);
+}
+
+static sherpa_ncnn::ModelConfig GetModelConfig(
+    const SherpaNcnnModelConfig *in_config) {
+  sherpa_ncnn::ModelConfig config;
+  config.buffers =
+      GetModelBuffers(in_config->buffers, in_config->num_buffers);
+
+  // The paths may be NULL if the buffers are given
+  config.encoder_param = SHERPA_NCNN_OR(in_config->encoder_param, "");
+  config.encoder_bin = SHERPA_NCNN_OR(in_config->encoder_bin, "");
 
-  config.model_config.decoder_param = in_config->model_config.decoder_param;
-  config.model_config.decoder_bin = in_config->model_config.decoder_bin;
+  config.decoder_param = SHERPA_NCNN_OR(in_config->decoder_param, "");
+  config.decoder_bin = SHERPA_NCNN_OR(in_config->decoder_bin, "");
 
-  config.model_config.joiner_param = in_config->model_config.joiner_param;
-  config.model_config.joiner_bin = in_config->model_config.joiner_bin;
+  config.joiner_param = SHERPA_NCNN_OR(in_config->joiner_param, "");
+  config.joiner_bin = SHERPA_NCNN_OR(in_config->joiner_bin, "");
+
+  config.tokens = SHERPA_NCNN_OR(in_config->tokens, "");
+  config.use_vulkan_compute = in_config->use_vulkan_compute;
+
+  int32_t num_threads = SHERPA_NCNN_OR(in_config->num_threads, 1);
+
+  config.encoder_opt.num_threads = num_threads;
+  config.decoder_opt.num_threads =
+      SHERPA_NCNN_OR(in_config->decoder_num_threads, num_threads);
+  config.joiner_opt.num_threads =
+      SHERPA_NCNN_OR(in_config->joiner_num_threads, num_threads);
+
+  config.encoder_powersave = in_config->encoder_powersave;
+  config.decoder_powersave = in_config->decoder_powersave;
+  config.joiner_powersave = in_config->joiner_powersave;
+  config.cpu_cores = SHERPA_NCNN_OR(in_config->cpu_cores, "");
+  config.encoder_precision =
+      SHERPA_NCNN_OR(in_config->encoder_precision, "");
+  config.decoder_precision =
+      SHERPA_NCNN_OR(in_config->decoder_precision, "");
+  config.joiner_precision = SHERPA_NCNN_OR(in_config->joiner_precision, "");
+  config.arena_mb = in_config->arena_mb;
+  config.remote_encoder = SHERPA_NCNN_OR(in_config->remote_encoder, "");
+  config.perf_profile = SHERPA_NCNN_OR(in_config->perf_profile, "");
+
+  std::vector<std::string> variants;
+  sherpa_ncnn::SplitStringToVector(
+      SHERPA_NCNN_OR(in_config->encoder_variants, ""), ",", true, &variants);
+  if (variants.size() % 2 != 0) {
+    NCNN_LOGE("encoder_variants must be pairs of .param and .bin: %s",
+              in_config->encoder_variants);
+    variants.pop_back();
+  }
 
-  config.model_config.tokens = in_config->model_config.tokens;
-  config.model_config.use_vulkan_compute =
-      in_config->model_config.use_vulkan_compute;
+  for (std::size_t i = 0; i < variants.size(); i += 2) {
+    config.encoder_variants.push_back({variants[i], variants[i + 1]});
+  }
 
-  int32_t num_threads = SHERPA_NCNN_OR(in_config->model_config.num_threads, 1);
+  return config;
+}
 
-  config.model_config.encoder_opt.num_threads = num_threads;
-  config.model_config.decoder_opt.num_threads = num_threads;
-  config.model_config.joiner_opt.num_threads = num_threads;
+static sherpa_ncnn::RecognizerConfig GetRecognizerConfig(
+    const SherpaNcnnRecognizerConfig *in_config) {
+  sherpa_ncnn::RecognizerConfig config;
+  config.model_config = GetModelConfig(&in_config->model_config);
 
   // decoder_config
   config.decoder_config.method = in_config->decoder_config.decoding_method;
@@ -78,6 +209,10 @@ SherpaNcnnRecognizer *CreateRecognizer(
   config.hotwords_file = SHERPA_NCNN_OR(in_config->hotwords_file, "");
   config.hotwords_score = SHERPA_NCNN_OR(in_config->hotwords_score, 1.5);
 
+  config.enable_profiling = in_config->enable_profiling;
+  config.publish_results = in_config->publish_results;
+  config.stream_pool_size = in_config->stream_pool_size;
+
   config.enable_endpoint = in_config->enable_endpoint;
 
   config.endpoint_config.rule1.min_trailing_silence =
@@ -95,6 +230,52 @@ SherpaNcnnRecognizer *CreateRecognizer(
   config.feat_config.feature_dim =
       SHERPA_NCNN_OR(in_config->feat_config.feature_dim, 80);
 
+#if SHERPA_NCNN_ENABLE_ACCELERATE
+  // Compute fbank with vDSP on iOS and macOS, see BatchFbank
+  config.feat_config.use_batch_fbank = true;
+#endif
+
+  return config;
+}
+
+SherpaNcnnModel *SherpaNcnnCreateModel(const SherpaNcnnModelConfig *in_config) {
+  sherpa_ncnn::ModelConfig config = GetModelConfig(in_config);
+
+  std::shared_ptr<sherpa_ncnn::Model> model =
+      sherpa_ncnn::Model::Create(config);
+  if (!model) {
+    NCNN_LOGE("Failed to create the model! Please check your config: %s",
+              config.ToString().c_str());
+    return nullptr;
+  }
+
+  auto ans = new SherpaNcnnModel;
+  ans->model = std::move(model);
+  return ans;
+}
+
+int32_t SherpaNcnnAutoTune(const SherpaNcnnModelConfig *in_config,
+                           const char *filename, int32_t num_runs) {
+  sherpa_ncnn::ModelConfig config = GetModelConfig(in_config);
+
+  sherpa_ncnn::AutoTuneConfig tune_config;
+  tune_config.num_runs = SHERPA_NCNN_OR(num_runs, 10);
+
+  sherpa_ncnn::PerfProfile profile = sherpa_ncnn::AutoTune(config, tune_config);
+  if (profile.Empty()) {
+    NCNN_LOGE("Failed to tune the model: %s", config.ToString().c_str());
+    return 0;
+  }
+
+  return profile.Write(SHERPA_NCNN_OR(filename, "")) ? 1 : 0;
+}
+
+void SherpaNcnnDestroyModel(const SherpaNcnnModel *p) { delete p; }
+
+SherpaNcnnRecognizer *CreateRecognizer(
+    const SherpaNcnnRecognizerConfig *in_config) {
+  sherpa_ncnn::RecognizerConfig config = GetRecognizerConfig(in_config);
+
   auto recognizer = std::make_unique<sherpa_ncnn::Recognizer>(config);
 
   if (!recognizer->GetModel()) {
@@ -108,21 +289,159 @@ SherpaNcnnRecognizer *CreateRecognizer(
   return ans;
 }
 
+SherpaNcnnRecognizer *CreateRecognizerWithModel(
+    const SherpaNcnnRecognizerConfig *in_config, const SherpaNcnnModel *model) {
+  if (!model || !model->model) {
+    NCNN_LOGE("Please pass a model returned by SherpaNcnnCreateModel()");
+    return nullptr;
+  }
+
+  sherpa_ncnn::RecognizerConfig config = GetRecognizerConfig(in_config);
+
+  auto ans = new SherpaNcnnRecognizer;
+  ans->recognizer =
+      std::make_unique<sherpa_ncnn::Recognizer>(config, model->model);
+  return ans;
+}
+
 void DestroyRecognizer(SherpaNcnnRecognizer *p) { delete p; }
 
+void WarmUpRecognizer(const SherpaNcnnRecognizer *p) {
+  p->recognizer->WarmUp();
+}
+
+SherpaNcnnRecognizerLoader *CreateRecognizerAsync(
+    const SherpaNcnnRecognizerConfig *in_config) {
+  auto ans = new SherpaNcnnRecognizerLoader;
+  ans->future =
+      sherpa_ncnn::CreateRecognizerAsync(GetRecognizerConfig(in_config));
+  return ans;
+}
+
+int32_t IsRecognizerLoaded(const SherpaNcnnRecognizerLoader *loader) {
+  return loader->future.valid() &&
+         loader->future.wait_for(std::chrono::seconds(0)) ==
+             std::future_status::ready;
+}
+
+SherpaNcnnRecognizer *GetLoadedRecognizer(SherpaNcnnRecognizerLoader *loader) {
+  if (!loader->future.valid()) {
+    NCNN_LOGE("GetLoadedRecognizer() can be called only once for a loader");
+    return nullptr;
+  }
+
+  auto recognizer = loader->future.get();
+  if (!recognizer->GetModel()) {
+    NCNN_LOGE("Failed to create the recognizer! Please check your config");
+    return nullptr;
+  }
+
+  auto ans = new SherpaNcnnRecognizer;
+  ans->recognizer = std::move(recognizer);
+  return ans;
+}
+
+void DestroyRecognizerLoader(SherpaNcnnRecognizerLoader *loader) {
+  delete loader;
+}
+
 SherpaNcnnStream *CreateStream(SherpaNcnnRecognizer *p) {
+  auto stream = p->recognizer->CreateStream();
+  if (!stream) {
+    return nullptr;
+  }
+
   auto ans = new SherpaNcnnStream;
-  ans->stream = p->recognizer->CreateStream();
+  ans->stream = std::move(stream);
   return ans;
 }
 
+SherpaNcnnStream *CreateStreamWithHotwords(SherpaNcnnRecognizer *p,
+                                           const char *hotwords) {
+  auto stream = p->recognizer->CreateStream(SHERPA_NCNN_OR(hotwords, ""));
+  if (!stream) {
+    return nullptr;
+  }
+
+  auto ans = new SherpaNcnnStream;
+  ans->stream = std::move(stream);
+  return ans;
+}
+
+SherpaNcnnStream *CreateStreamWithChunkSize(SherpaNcnnRecognizer *p,
+                                            int32_t chunk_size,
+                                            const char *hotwords) {
+  std::unique_ptr<sherpa_ncnn::Stream> stream;
+  if (hotwords) {
+    auto context_graph = p->recognizer->CreateContextGraph(hotwords);
+    if (!context_graph && hotwords[0] != '\0') {
+      return nullptr;
+    }
+
+    stream = p->recognizer->CreateStreamWithChunkSize(
+        chunk_size, std::move(context_graph));
+  } else {
+    stream = p->recognizer->CreateStreamWithChunkSize(chunk_size);
+  }
+
+  if (!stream) {
+    return nullptr;
+  }
+
+  auto ans = new SherpaNcnnStream;
+  ans->stream = std::move(stream);
+  return ans;
+}
+
+int32_t SetStreamHotwords(SherpaNcnnRecognizer *p, SherpaNcnnStream *s,
+                          const char *hotwords) {
+  return p->recognizer->SetHotwords(s->stream.get(),
+                                    SHERPA_NCNN_OR(hotwords, ""));
+}
+
 void DestroyStream(SherpaNcnnStream *s) { delete s; }
 
+void RecycleStream(SherpaNcnnRecognizer *p, SherpaNcnnStream *s) {
+  p->recognizer->RecycleStream(std::move(s->stream));
+  delete s;
+}
+
+void ParkStream(SherpaNcnnStream *s) { s->stream->Park(); }
+
 void AcceptWaveform(SherpaNcnnStream *s, float sample_rate,
                     const float *samples, int32_t n) {
   s->stream->AcceptWaveform(sample_rate, samples, n);
 }
 
+void AcceptWaveformInt16(SherpaNcnnStream *s, float sample_rate,
+                         const int16_t *samples, int32_t n) {
+  s->stream->AcceptWaveformInt16(sample_rate, samples, n);
+}
+
+void AcceptWaveformInterleaved(SherpaNcnnStream **streams,
+                               int32_t num_channels, float sample_rate,
+                               const float *samples, int32_t n) {
+  std::vector<sherpa_ncnn::Stream *> ss(num_channels);
+  for (int32_t c = 0; c != num_channels; ++c) {
+    ss[c] = streams[c]->stream.get();
+  }
+
+  sherpa_ncnn::Stream::AcceptInterleavedWaveform(ss.data(), num_channels,
+                                                 sample_rate, samples, n);
+}
+
+void AcceptWaveformInterleavedInt16(SherpaNcnnStream **streams,
+                                    int32_t num_channels, float sample_rate,
+                                    const int16_t *samples, int32_t n) {
+  std::vector<sherpa_ncnn::Stream *> ss(num_channels);
+  for (int32_t c = 0; c != num_channels; ++c) {
+    ss[c] = streams[c]->stream.get();
+  }
+
+  sherpa_ncnn::Stream::AcceptInterleavedWaveformInt16(
+      ss.data(), num_channels, sample_rate, samples, n);
+}
+
 int32_t IsReady(SherpaNcnnRecognizer *p, SherpaNcnnStream *s) {
   return p->recognizer->IsReady(s->stream.get());
 }
@@ -131,27 +450,76 @@ void Decode(SherpaNcnnRecognizer *p, SherpaNcnnStream *s) {
   p->recognizer->DecodeStream(s->stream.get());
 }
 
-SherpaNcnnResult *GetResult(SherpaNcnnRecognizer *p, SherpaNcnnStream *s) {
-  std::string text = p->recognizer->GetResult(s->stream.get()).text;
-  auto res = p->recognizer->GetResult(s->stream.get());
+int32_t IsReadyMultiple(SherpaNcnnRecognizer *p, SherpaNcnnStream **streams,
+                        int32_t n, uint8_t *ready) {
+  std::fill(ready, ready + (n + 7) / 8, 0);
+
+  int32_t num_ready = 0;
+  for (int32_t i = 0; i != n; ++i) {
+    if (p->recognizer->IsReady(streams[i]->stream.get())) {
+      ready[i / 8] |= 1 << (i % 8);
+      ++num_ready;
+    }
+  }
+
+  return num_ready;
+}
+
+void DecodeMultipleStreams(SherpaNcnnRecognizer *p, SherpaNcnnStream **streams,
+                           int32_t n) {
+  std::vector<sherpa_ncnn::Stream *> ss(n);
+  for (int32_t i = 0; i != n; ++i) {
+    ss[i] = streams[i]->stream.get();
+  }
+
+  p->recognizer->DecodeStreams(ss.data(), n);
+}
+
+int32_t DecodeReadyStreams(SherpaNcnnRecognizer *p, SherpaNcnnStream **streams,
+                           int32_t n) {
+  std::vector<sherpa_ncnn::Stream *> ss(n);
+  for (int32_t i = 0; i != n; ++i) {
+    ss[i] = streams[i]->stream.get();
+  }
+
+  return p->recognizer->DecodeReadyStreams(ss.data(), n);
+}
+
+int32_t DecodeRemainingFrames(SherpaNcnnRecognizer *p,
+                              SherpaNcnnStream **streams, int32_t n) {
+  std::vector<sherpa_ncnn::Stream *> ss(n);
+  for (int32_t i = 0; i != n; ++i) {
+    ss[i] = streams[i]->stream.get();
+  }
 
+  return p->recognizer->DecodeRemainingFrames(ss.data(), n);
+}
+
+// The tokens are \0 separated in one array
+static SherpaNcnnResult *CreateResult(
+    const std::string &text, const std::vector<std::string> &tokens,
+    const std::vector<float> &timestamps) {
   auto r = new SherpaNcnnResult;
   r->text = new char[text.size() + 1];
   std::copy(text.begin(), text.end(), const_cast<char *>(r->text));
   const_cast<char *>(r->text)[text.size()] = 0;
-  r->count = res.tokens.size();
+  r->count = tokens.size();
   if (r->count > 0) {
+    int32_t size = 0;
+    for (const auto &t : tokens) {
+      size += t.size() + 1;
+    }
+
     // Each word ends with nullptr
-    r->tokens = new char[text.size() + r->count];
-    memset(reinterpret_cast<void *>(const_cast<char *>(r->tokens)), 0,
-           text.size() + r->count);
+    r->tokens = new char[size];
+    memset(reinterpret_cast<void *>(const_cast<char *>(r->tokens)), 0, size);
     r->timestamps = new float[r->count];
     int pos = 0;
     for (int32_t i = 0; i < r->count; ++i) {
       memcpy(reinterpret_cast<void *>(const_cast<char *>(r->tokens + pos)),
-             res.stokens[i].c_str(), res.stokens[i].size());
-      pos += res.stokens[i].size() + 1;
-      r->timestamps[i] = res.timestamps[i];
+             tokens[i].c_str(), tokens[i].size());
+      pos += tokens[i].size() + 1;
+      r->timestamps[i] = timestamps[i];
     }
   } else {
     r->timestamps = nullptr;
@@ -161,6 +529,92 @@ SherpaNcnnResult *GetResult(SherpaNcnnRecognizer *p, SherpaNcnnStream *s) {
   return r;
 }
 
+SherpaNcnnResult *GetResult(SherpaNcnnRecognizer *p, SherpaNcnnStream *s) {
+  auto res = p->recognizer->GetResult(s->stream.get());
+  return CreateResult(res.text, res.stokens, res.timestamps);
+}
+
+SherpaNcnnResult *GetResultSnapshot(SherpaNcnnRecognizer *p,
+                                    SherpaNcnnStream *s) {
+  auto res = p->recognizer->GetResultSnapshot(s->stream.get());
+  return CreateResult(res->text, res->stokens, res->timestamps);
+}
+
+// The result changes if and only if the decoded tokens change
+static void UpdateRevision(SherpaNcnnStream *s) {
+  const auto &tokens = s->stream->GetResult().tokens;
+  if (tokens != s->last_tokens) {
+    s->last_tokens = tokens;
+    ++s->revision;
+  }
+}
+
+int32_t GetResultRevision(SherpaNcnnStream *s) {
+  UpdateRevision(s);
+  return s->revision;
+}
+
+const SherpaNcnnResult *GetBorrowedResult(SherpaNcnnRecognizer *p,
+                                          SherpaNcnnStream *s,
+                                          int32_t *revision) {
+  // At an endpoint, GetResult() may change the tokens, e.g., when there
+  // are hotwords
+  bool endpoint = p->recognizer->IsEndpoint(s->stream.get());
+
+  UpdateRevision(s);
+  if (endpoint || s->revision != s->result_revision) {
+    auto res = p->recognizer->GetResult(s->stream.get());
+    UpdateRevision(s);
+
+    s->text = res.text;
+
+    s->tokens.clear();
+    for (const auto &t : res.stokens) {
+      s->tokens.append(t);
+
+      // Each token ends with a NUL
+      s->tokens.push_back(0);
+    }
+
+    s->timestamps = res.timestamps;
+
+    s->result.text = s->text.c_str();
+    s->result.count = res.stokens.size();
+    s->result.tokens = s->result.count ? s->tokens.data() : nullptr;
+    s->result.timestamps = s->result.count ? s->timestamps.data() : nullptr;
+
+    s->result_revision = s->revision;
+  }
+
+  if (revision) {
+    *revision = s->revision;
+  }
+
+  return &s->result;
+}
+
+const SherpaNcnnResultUpdate *GetResultUpdate(SherpaNcnnRecognizer *p,
+                                              SherpaNcnnStream *s) {
+  s->update_data = p->recognizer->GetResultUpdate(s->stream.get());
+  const auto &u = s->update_data;
+
+  s->update_tokens.clear();
+  for (const auto &t : u.stokens) {
+    s->update_tokens.append(t);
+    s->update_tokens.push_back(0);
+  }
+
+  s->update.revision = u.revision;
+  s->update.start = u.start;
+  s->update.num_stable = u.num_stable;
+  s->update.text = u.text.c_str();
+  s->update.count = u.stokens.size();
+  s->update.tokens = s->update.count ? s->update_tokens.data() : nullptr;
+  s->update.timestamps = s->update.count ? u.timestamps.data() : nullptr;
+
+  return &s->update;
+}
+
 void DestroyResult(const SherpaNcnnResult *r) {
   delete[] r->text;
   delete[] r->timestamps;  // it is ok to delete a nullptr
@@ -178,6 +632,230 @@ int32_t IsEndpoint(SherpaNcnnRecognizer *p, SherpaNcnnStream *s) {
   return p->recognizer->IsEndpoint(s->stream.get());
 }
 
+const uint8_t *SaveStream(SherpaNcnnRecognizer *p, SherpaNcnnStream *s,
+                          int32_t *size) {
+  std::string snapshot = p->recognizer->SaveStream(s->stream.get());
+  if (snapshot.empty()) {
+    *size = 0;
+    return nullptr;
+  }
+
+  auto ans = new uint8_t[snapshot.size()];
+  std::copy(snapshot.begin(), snapshot.end(), ans);
+  *size = snapshot.size();
+
+  return ans;
+}
+
+void DestroyStreamSnapshot(const uint8_t *snapshot) { delete[] snapshot; }
+
+SherpaNcnnStream *RestoreStream(SherpaNcnnRecognizer *p,
+                                const uint8_t *snapshot, int32_t size,
+                                const char *hotwords) {
+  auto stream = hotwords ? p->recognizer->CreateStream(std::string(hotwords))
+                         : p->recognizer->CreateStream();
+  if (!stream ||
+      !p->recognizer->RestoreStream(snapshot, size, stream.get())) {
+    return nullptr;
+  }
+
+  auto ans = new SherpaNcnnStream;
+  ans->stream = std::move(stream);
+  return ans;
+}
+
+static const SherpaNcnnLatencyStats *ConvertLatencyStats(
+    const sherpa_ncnn::LatencyStats *stats) {
+  if (!stats) {
+    return nullptr;
+  }
+
+  auto stages = new SherpaNcnnStageStats[sherpa_ncnn::kNumStages];
+  for (int32_t i = 0; i != sherpa_ncnn::kNumStages; ++i) {
+    auto stage = static_cast<sherpa_ncnn::Stage>(i);
+    auto summary = stats->Summary(stage);
+
+    stages[i].name = sherpa_ncnn::GetStageName(stage);
+    stages[i].count = summary.count;
+    stages[i].total_ms = summary.total_ms;
+    stages[i].mean_ms = summary.mean_ms;
+    stages[i].p50_ms = summary.p50_ms;
+    stages[i].p99_ms = summary.p99_ms;
+    stages[i].max_ms = summary.max_ms;
+  }
+
+  auto ans = new SherpaNcnnLatencyStats;
+  ans->stages = stages;
+  ans->num_stages = sherpa_ncnn::kNumStages;
+  return ans;
+}
+
+const SherpaNcnnLatencyStats *GetLatencyStats(SherpaNcnnRecognizer *p) {
+  return ConvertLatencyStats(p->recognizer->GetLatencyStats());
+}
+
+const SherpaNcnnLatencyStats *GetStreamLatencyStats(SherpaNcnnStream *s) {
+  return ConvertLatencyStats(s->stream->GetLatencyStats());
+}
+
+void DestroyLatencyStats(const SherpaNcnnLatencyStats *s) {
+  if (!s) return;
+
+  delete[] s->stages;
+  delete s;
+}
+
+struct SherpaNcnnDecodeWorker {
+  SherpaNcnnRecognizer *recognizer;
+  SherpaNcnnDecodeCallback callback;
+  void *user_data;
+
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable idle;
+
+  // The fields below are protected by mutex
+  std::vector<SherpaNcnnStream *> streams;
+  bool notified = false;
+  bool stop = false;
+
+  // True while the thread decodes a copy of streams
+  bool busy = false;
+
+  std::thread thread;
+};
+
+// Return true if the input of s is finished and all of it is decoded
+static bool IsInputDone(SherpaNcnnRecognizer *p, SherpaNcnnStream *s) {
+  int32_t n = s->stream->NumFramesReady();
+  return n > 0 && s->stream->IsLastFrame(n - 1) &&
+         !p->recognizer->IsReady(s->stream.get());
+}
+
+// Report the result of s. Return true if the input of s is done
+static bool ReportResult(SherpaNcnnDecodeWorker *w, SherpaNcnnStream *s) {
+  bool endpoint = w->recognizer->recognizer->IsEndpoint(s->stream.get());
+  bool done = IsInputDone(w->recognizer, s);
+
+  int32_t last_revision = s->result_revision;
+  int32_t revision = 0;
+  const SherpaNcnnResult *r = GetBorrowedResult(w->recognizer, s, &revision);
+
+  if (endpoint || done || revision != last_revision) {
+    w->callback(s, r, endpoint || done, w->user_data);
+  }
+
+  if (endpoint && !done) {
+    w->recognizer->recognizer->Reset(s->stream.get());
+  }
+
+  return done;
+}
+
+static void RunDecodeWorker(SherpaNcnnDecodeWorker *w) {
+  std::vector<SherpaNcnnStream *> streams;
+  std::vector<SherpaNcnnStream *> done;
+  std::vector<sherpa_ncnn::Stream *> ready;
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(w->mutex);
+
+      for (auto s : done) {
+        w->streams.erase(
+            std::remove(w->streams.begin(), w->streams.end(), s),
+            w->streams.end());
+      }
+      done.clear();
+
+      w->busy = false;
+      w->idle.notify_all();
+
+      w->wake.wait(lock, [w] { return w->notified || w->stop; });
+      if (w->stop) {
+        return;
+      }
+
+      w->notified = false;
+      w->busy = true;
+      streams = w->streams;
+    }
+
+    // Decode all available audio, in batches of the ready streams
+    while (true) {
+      ready.clear();
+      for (auto s : streams) {
+        if (w->recognizer->recognizer->IsReady(s->stream.get())) {
+          ready.push_back(s->stream.get());
+        }
+      }
+
+      if (ready.empty()) {
+        break;
+      }
+
+      w->recognizer->recognizer->DecodeStreams(ready.data(), ready.size());
+    }
+
+    for (auto s : streams) {
+      if (ReportResult(w, s)) {
+        done.push_back(s);
+      }
+    }
+  }
+}
+
+SherpaNcnnDecodeWorker *SherpaNcnnStartDecodeWorker(
+    SherpaNcnnRecognizer *p, SherpaNcnnDecodeCallback callback,
+    void *user_data) {
+  auto ans = new SherpaNcnnDecodeWorker;
+  ans->recognizer = p;
+  ans->callback = callback;
+  ans->user_data = user_data;
+  ans->thread = std::thread(RunDecodeWorker, ans);
+  return ans;
+}
+
+void SherpaNcnnDecodeWorkerAddStream(SherpaNcnnDecodeWorker *w,
+                                     SherpaNcnnStream *s) {
+  std::lock_guard<std::mutex> lock(w->mutex);
+  if (std::find(w->streams.begin(), w->streams.end(), s) ==
+      w->streams.end()) {
+    w->streams.push_back(s);
+  }
+  w->notified = true;
+  w->wake.notify_one();
+}
+
+void SherpaNcnnDecodeWorkerRemoveStream(SherpaNcnnDecodeWorker *w,
+                                        SherpaNcnnStream *s) {
+  std::unique_lock<std::mutex> lock(w->mutex);
+  w->streams.erase(std::remove(w->streams.begin(), w->streams.end(), s),
+                   w->streams.end());
+
+  // From the callback, the worker does not use s after it returns
+  if (std::this_thread::get_id() != w->thread.get_id()) {
+    w->idle.wait(lock, [w] { return !w->busy; });
+  }
+}
+
+void SherpaNcnnDecodeWorkerNotify(SherpaNcnnDecodeWorker *w) {
+  std::lock_guard<std::mutex> lock(w->mutex);
+  w->notified = true;
+  w->wake.notify_one();
+}
+
+void SherpaNcnnStopDecodeWorker(SherpaNcnnDecodeWorker *w) {
+  {
+    std::lock_guard<std::mutex> lock(w->mutex);
+    w->stop = true;
+    w->wake.notify_one();
+  }
+
+  w->thread.join();
+  delete w;
+}
+
 SherpaNcnnDisplay *CreateDisplay(int32_t max_word_per_line) {
   SherpaNcnnDisplay *ans = new SherpaNcnnDisplay;
   ans->impl = std::make_unique<sherpa_ncnn::Display>(max_word_per_line);
@@ -190,6 +868,7 @@ void SherpaNcnnPrint(SherpaNcnnDisplay *display, int32_t idx, const char *s) {
   display->impl->Print(idx, s);
 }
 
+#ifndef SHERPA_NCNN_DISABLE_VAD
 // ============================================================
 // For Voice Activity Detection (VAD)
 // ============================================================
@@ -198,8 +877,8 @@ struct SherpaNcnnVoiceActivityDetector {
   std::unique_ptr<sherpa_ncnn::VoiceActivityDetector> impl;
 };
 
-SherpaNcnnVoiceActivityDetector *SherpaNcnnCreateVoiceActivityDetector(
-    const SherpaNcnnVadModelConfig *config, float buffer_size_in_seconds) {
+static sherpa_ncnn::SileroVadModelConfig GetVadModelConfig(
+    const SherpaNcnnVadModelConfig *config) {
   sherpa_ncnn::SileroVadModelConfig vad_config;
 
   vad_config.model_dir = SHERPA_NCNN_OR(config->model_dir, "");
@@ -212,6 +891,21 @@ SherpaNcnnVoiceActivityDetector *SherpaNcnnCreateVoiceActivityDetector(
   vad_config.sample_rate = SHERPA_NCNN_OR(config->sample_rate, 16000);
   vad_config.use_vulkan_compute = config->use_vulkan_compute;
   vad_config.num_threads = SHERPA_NCNN_OR(config->num_threads, 1);
+  vad_config.buffers = GetModelBuffers(config->buffers, config->num_buffers);
+  vad_config.energy_gate_db = config->energy_gate_db;
+  vad_config.energy_gate_max_zcr =
+      SHERPA_NCNN_OR(config->energy_gate_max_zcr, 0.3f);
+  vad_config.max_segment_duration = config->max_segment_duration;
+  vad_config.max_segment_search =
+      SHERPA_NCNN_OR(config->max_segment_search, 2.0f);
+  vad_config.file_warm_up = SHERPA_NCNN_OR(config->file_warm_up, 1.0f);
+
+  return vad_config;
+}
+
+SherpaNcnnVoiceActivityDetector *SherpaNcnnCreateVoiceActivityDetector(
+    const SherpaNcnnVadModelConfig *config, float buffer_size_in_seconds) {
+  sherpa_ncnn::SileroVadModelConfig vad_config = GetVadModelConfig(config);
 
   if (buffer_size_in_seconds <= 0) {
     buffer_size_in_seconds = 60;
@@ -239,6 +933,16 @@ void SherpaNcnnVoiceActivityDetectorAcceptWaveform(
   p->impl->AcceptWaveform(samples, n);
 }
 
+void SherpaNcnnVoiceActivityDetectorAcceptWaveformInt16(
+    SherpaNcnnVoiceActivityDetector *p, const int16_t *samples, int32_t n) {
+  p->impl->AcceptWaveformInt16(samples, n);
+}
+
+void SherpaNcnnVoiceActivityDetectorAcceptFile(
+    SherpaNcnnVoiceActivityDetector *p, const float *samples, int32_t n) {
+  p->impl->AcceptFile(samples, n);
+}
+
 int32_t SherpaNcnnVoiceActivityDetectorEmpty(
     SherpaNcnnVoiceActivityDetector *p) {
   return p->impl->Empty();
@@ -259,6 +963,23 @@ const SherpaNcnnSpeechSegment *SherpaNcnnVoiceActivityDetectorFront(
   return ans;
 }
 
+int32_t SherpaNcnnVoiceActivityDetectorFrontCopy(
+    SherpaNcnnVoiceActivityDetector *p, float *samples, int32_t capacity,
+    int32_t *start) {
+  sherpa_ncnn::SpeechSegmentView segment = p->impl->FrontView();
+
+  int32_t n = segment.samples.Size();
+  if (samples && capacity >= n) {
+    segment.samples.CopyTo(samples);
+  }
+
+  if (start) {
+    *start = segment.start;
+  }
+
+  return n;
+}
+
 void SherpaNcnnVoiceActivityDetectorPop(SherpaNcnnVoiceActivityDetector *p) {
   p->impl->Pop();
 }
@@ -280,9 +1001,340 @@ int32_t SherpaNcnnVoiceActivityDetectorDetected(
   return p->impl->IsSpeechDetected();
 }
 
+void SherpaNcnnVoiceActivityDetectorAttachStream(
+    SherpaNcnnVoiceActivityDetector *p, SherpaNcnnStream *s) {
+  sherpa_ncnn::VadCallbacks callbacks;
+  if (s) {
+    sherpa_ncnn::Stream *stream = s->stream.get();
+    float threshold = p->impl->GetConfig().threshold;
+    float sample_rate = p->impl->GetConfig().sample_rate;
+
+    callbacks.on_speech_probability = [stream, threshold, sample_rate](
+                                          float prob, int32_t n) {
+      stream->AcceptSpeechProbability(prob, n / sample_rate, threshold);
+    };
+  }
+
+  p->impl->SetCallbacks(std::move(callbacks));
+}
+
 void SherpaNcnnDestroySpeechSegment(const SherpaNcnnSpeechSegment *p) {
   if (p) {
     delete[] p->samples;
     delete p;
   }
 }
+
+#endif  // SHERPA_NCNN_DISABLE_VAD
+
+#if !defined(SHERPA_NCNN_DISABLE_SENSE_VOICE) && \
+    !defined(SHERPA_NCNN_DISABLE_VAD)
+// ============================================================
+// For simulated streaming ASR with a non-streaming model
+// ============================================================
+
+struct SherpaNcnnSimulatedStreamingAsr {
+  std::unique_ptr<sherpa_ncnn::OfflineRecognizer> recognizer;
+  std::unique_ptr<sherpa_ncnn::SimulatedStreamingAsr> impl;
+};
+
+SherpaNcnnSimulatedStreamingAsr *SherpaNcnnCreateSimulatedStreamingAsr(
+    const SherpaNcnnSimulatedStreamingAsrConfig *config) {
+  sherpa_ncnn::SileroVadModelConfig vad_config =
+      GetVadModelConfig(&config->vad_config);
+
+  sherpa_ncnn::OfflineRecognizerConfig asr_config;
+  asr_config.model_config.sense_voice.model_dir =
+      SHERPA_NCNN_OR(config->sense_voice.model_dir, "");
+  asr_config.model_config.sense_voice.language =
+      SHERPA_NCNN_OR(config->sense_voice.language, "auto");
+  asr_config.model_config.sense_voice.use_itn = config->sense_voice.use_itn;
+  asr_config.model_config.sense_voice.buffers = GetModelBuffers(
+      config->sense_voice.buffers, config->sense_voice.num_buffers);
+  asr_config.model_config.tokens = SHERPA_NCNN_OR(config->tokens, "");
+  asr_config.model_config.num_threads = SHERPA_NCNN_OR(config->num_threads, 1);
+  asr_config.decoding_method =
+      SHERPA_NCNN_OR(config->decoding_method, "greedy_search");
+
+  sherpa_ncnn::SimulatedStreamingAsrConfig streaming_config;
+  streaming_config.decode_interval =
+      SHERPA_NCNN_OR(config->decode_interval, 0.2f);
+  streaming_config.max_window_duration =
+      SHERPA_NCNN_OR(config->max_window_duration, 8.0f);
+  streaming_config.min_right_context =
+      SHERPA_NCNN_OR(config->min_right_context, 2.0f);
+
+  if (!vad_config.Validate()) {
+    NCNN_LOGE("Invalid VAD config: %s", vad_config.ToString().c_str());
+    return nullptr;
+  }
+
+  if (!asr_config.Validate()) {
+    NCNN_LOGE("Invalid ASR config: %s", asr_config.ToString().c_str());
+    return nullptr;
+  }
+
+  if (!streaming_config.Validate()) {
+    NCNN_LOGE("Invalid config: %s", streaming_config.ToString().c_str());
+    return nullptr;
+  }
+
+  auto p = new SherpaNcnnSimulatedStreamingAsr;
+  p->recognizer = std::make_unique<sherpa_ncnn::OfflineRecognizer>(asr_config);
+  p->impl = std::make_unique<sherpa_ncnn::SimulatedStreamingAsr>(
+      p->recognizer.get(), vad_config, streaming_config);
+
+  return p;
+}
+
+void SherpaNcnnDestroySimulatedStreamingAsr(
+    SherpaNcnnSimulatedStreamingAsr *p) {
+  delete p;
+}
+
+void SherpaNcnnSimulatedStreamingAsrAcceptWaveform(
+    SherpaNcnnSimulatedStreamingAsr *p, const float *samples, int32_t n) {
+  p->impl->AcceptWaveform(samples, n);
+}
+
+void SherpaNcnnSimulatedStreamingAsrAcceptWaveformInt16(
+    SherpaNcnnSimulatedStreamingAsr *p, const int16_t *samples, int32_t n) {
+  p->impl->AcceptWaveformInt16(samples, n);
+}
+
+void SherpaNcnnSimulatedStreamingAsrInputFinished(
+    SherpaNcnnSimulatedStreamingAsr *p) {
+  p->impl->InputFinished();
+}
+
+int32_t SherpaNcnnSimulatedStreamingAsrIsSpeechDetected(
+    SherpaNcnnSimulatedStreamingAsr *p) {
+  return p->impl->IsSpeechDetected();
+}
+
+SherpaNcnnResult *SherpaNcnnSimulatedStreamingAsrGetPartialResult(
+    SherpaNcnnSimulatedStreamingAsr *p) {
+  const auto &r = p->impl->GetPartialResult();
+  return CreateResult(r.text, r.tokens, r.timestamps);
+}
+
+int32_t SherpaNcnnSimulatedStreamingAsrEmpty(
+    SherpaNcnnSimulatedStreamingAsr *p) {
+  return p->impl->Empty();
+}
+
+SherpaNcnnResult *SherpaNcnnSimulatedStreamingAsrFront(
+    SherpaNcnnSimulatedStreamingAsr *p) {
+  const auto &r = p->impl->Front();
+  return CreateResult(r.text, r.tokens, r.timestamps);
+}
+
+void SherpaNcnnSimulatedStreamingAsrPop(SherpaNcnnSimulatedStreamingAsr *p) {
+  p->impl->Pop();
+}
+
+void SherpaNcnnSimulatedStreamingAsrReset(SherpaNcnnSimulatedStreamingAsr *p) {
+  p->impl->Reset();
+}
+
+#endif
+
+#ifndef SHERPA_NCNN_DISABLE_SENSE_VOICE
+// ============================================================
+// For non-streaming ASR
+// ============================================================
+
+struct SherpaNcnnOfflineRecognizer {
+  std::unique_ptr<sherpa_ncnn::OfflineRecognizer> impl;
+};
+
+struct SherpaNcnnOfflineStream {
+  std::unique_ptr<sherpa_ncnn::OfflineStream> impl;
+};
+
+SherpaNcnnOfflineRecognizer *SherpaNcnnCreateOfflineRecognizer(
+    const SherpaNcnnOfflineRecognizerConfig *config) {
+  sherpa_ncnn::OfflineRecognizerConfig recognizer_config;
+  recognizer_config.model_config.sense_voice.model_dir =
+      SHERPA_NCNN_OR(config->sense_voice.model_dir, "");
+  recognizer_config.model_config.sense_voice.language =
+      SHERPA_NCNN_OR(config->sense_voice.language, "auto");
+  recognizer_config.model_config.sense_voice.use_itn =
+      config->sense_voice.use_itn;
+  recognizer_config.model_config.sense_voice.buffers = GetModelBuffers(
+      config->sense_voice.buffers, config->sense_voice.num_buffers);
+  recognizer_config.model_config.tokens = SHERPA_NCNN_OR(config->tokens, "");
+  recognizer_config.model_config.num_threads =
+      SHERPA_NCNN_OR(config->num_threads, 1);
+
+  recognizer_config.decoding_method =
+      SHERPA_NCNN_OR(config->decoding_method, "greedy_search");
+  recognizer_config.max_active_paths =
+      SHERPA_NCNN_OR(config->max_active_paths, 4);
+  recognizer_config.hotwords_file = SHERPA_NCNN_OR(config->hotwords_file, "");
+  recognizer_config.hotwords_score =
+      SHERPA_NCNN_OR(config->hotwords_score, 1.5f);
+  recognizer_config.chunk_duration = config->chunk_duration;
+  recognizer_config.chunk_overlap = SHERPA_NCNN_OR(config->chunk_overlap, 2.0f);
+  recognizer_config.length_bucket = config->length_bucket;
+  recognizer_config.model_config.perf_profile =
+      SHERPA_NCNN_OR(config->perf_profile, "");
+
+  if (!recognizer_config.Validate()) {
+    NCNN_LOGE("Invalid config: %s", recognizer_config.ToString().c_str());
+    return nullptr;
+  }
+
+  auto p = new SherpaNcnnOfflineRecognizer;
+  p->impl = std::make_unique<sherpa_ncnn::OfflineRecognizer>(recognizer_config);
+
+  return p;
+}
+
+void SherpaNcnnDestroyOfflineRecognizer(SherpaNcnnOfflineRecognizer *p) {
+  delete p;
+}
+
+SherpaNcnnOfflineStream *SherpaNcnnCreateOfflineStream(
+    const SherpaNcnnOfflineRecognizer *p) {
+  auto s = new SherpaNcnnOfflineStream;
+  s->impl = p->impl->CreateStream();
+  return s;
+}
+
+void SherpaNcnnDestroyOfflineStream(SherpaNcnnOfflineStream *s) { delete s; }
+
+void SherpaNcnnAcceptWaveformOffline(SherpaNcnnOfflineStream *s,
+                                     int32_t sample_rate,
+                                     const float *samples, int32_t n) {
+  s->impl->AcceptWaveform(sample_rate, samples, n);
+}
+
+void SherpaNcnnAcceptWaveformInt16Offline(SherpaNcnnOfflineStream *s,
+                                          int32_t sample_rate,
+                                          const int16_t *samples, int32_t n) {
+  s->impl->AcceptWaveformInt16(sample_rate, samples, n);
+}
+
+void SherpaNcnnDecodeOfflineStream(const SherpaNcnnOfflineRecognizer *p,
+                                   SherpaNcnnOfflineStream *s) {
+  p->impl->DecodeStream(s->impl.get());
+}
+
+void SherpaNcnnDecodeMultipleOfflineStreams(
+    const SherpaNcnnOfflineRecognizer *p, SherpaNcnnOfflineStream **streams,
+    int32_t n) {
+  std::vector<sherpa_ncnn::OfflineStream *> ss(n);
+  for (int32_t i = 0; i != n; ++i) {
+    ss[i] = streams[i]->impl.get();
+  }
+
+  p->impl->DecodeStreams(ss.data(), n);
+}
+
+SherpaNcnnResult *SherpaNcnnGetOfflineStreamResult(
+    const SherpaNcnnOfflineStream *s) {
+  const auto &r = s->impl->GetResult();
+  return CreateResult(r.text, r.tokens, r.timestamps);
+}
+
+const char *SherpaNcnnGetOfflineStreamResultAsJson(
+    const SherpaNcnnOfflineStream *s) {
+  std::string json = s->impl->GetResult().AsJsonString();
+
+  char *ans = new char[json.size() + 1];
+  std::copy(json.begin(), json.end(), ans);
+  ans[json.size()] = 0;
+
+  return ans;
+}
+
+void SherpaNcnnDestroyOfflineStreamResultJson(const char *json) {
+  delete[] json;
+}
+
+#endif  // SHERPA_NCNN_DISABLE_SENSE_VOICE
+
+#ifndef SHERPA_NCNN_DISABLE_TTS
+// ============================================================
+// For text to speech
+// ============================================================
+
+struct SherpaNcnnOfflineTts {
+  std::unique_ptr<sherpa_ncnn::OfflineTts> impl;
+};
+
+SherpaNcnnOfflineTts *SherpaNcnnCreateOfflineTts(
+    const SherpaNcnnOfflineTtsConfig *config) {
+  sherpa_ncnn::OfflineTtsConfig tts_config;
+  tts_config.model.vits.model_dir = SHERPA_NCNN_OR(config->vits.model_dir, "");
+  tts_config.model.vits.bundle = SHERPA_NCNN_OR(config->vits.bundle, "");
+  tts_config.model.vits.buffers =
+      GetModelBuffers(config->vits.buffers, config->vits.num_buffers);
+  tts_config.model.num_threads = SHERPA_NCNN_OR(config->num_threads, 1);
+
+  tts_config.rule_fsts = SHERPA_NCNN_OR(config->rule_fsts, "");
+  tts_config.rule_fars = SHERPA_NCNN_OR(config->rule_fars, "");
+  tts_config.max_num_sentences = SHERPA_NCNN_OR(config->max_num_sentences, 1);
+  tts_config.num_workers = SHERPA_NCNN_OR(config->num_workers, 1);
+  tts_config.max_concurrent_requests = config->max_concurrent_requests;
+  tts_config.silence_scale = SHERPA_NCNN_OR(config->silence_scale, 1.0f);
+  tts_config.model.perf_profile = SHERPA_NCNN_OR(config->perf_profile, "");
+
+  if (!tts_config.Validate()) {
+    NCNN_LOGE("Invalid config: %s", tts_config.ToString().c_str());
+    return nullptr;
+  }
+
+  auto p = new SherpaNcnnOfflineTts;
+  p->impl = std::make_unique<sherpa_ncnn::OfflineTts>(tts_config);
+
+  return p;
+}
+
+void SherpaNcnnDestroyOfflineTts(SherpaNcnnOfflineTts *p) { delete p; }
+
+int32_t SherpaNcnnOfflineTtsSampleRate(const SherpaNcnnOfflineTts *p) {
+  return p->impl->SampleRate();
+}
+
+int32_t SherpaNcnnOfflineTtsNumSpeakers(const SherpaNcnnOfflineTts *p) {
+  return p->impl->NumSpeakers();
+}
+
+const SherpaNcnnGeneratedAudio *SherpaNcnnOfflineTtsGenerate(
+    const SherpaNcnnOfflineTts *p, const char *text, int32_t sid, float speed,
+    SherpaNcnnGeneratedAudioCallback callback, void *arg,
+    int32_t return_samples) {
+  sherpa_ncnn::TtsArgs args;
+  args.text = SHERPA_NCNN_OR(text, "");
+  args.sid = sid;
+  args.speed = SHERPA_NCNN_OR(speed, 1.0f);
+  args.return_samples = return_samples;
+
+  sherpa_ncnn::GeneratedAudio audio =
+      p->impl->Generate(args, callback, arg);
+
+  auto ans = new SherpaNcnnGeneratedAudio;
+  ans->n = audio.samples.size();
+  ans->sample_rate = audio.sample_rate;
+  ans->samples = nullptr;
+
+  if (ans->n > 0) {
+    float *samples = new float[ans->n];
+    std::copy(audio.samples.begin(), audio.samples.end(), samples);
+    ans->samples = samples;
+  }
+
+  return ans;
+}
+
+void SherpaNcnnDestroyOfflineTtsGeneratedAudio(
+    const SherpaNcnnGeneratedAudio *p) {
+  if (p) {
+    delete[] p->samples;
+    delete p;
+  }
+}
+
+#endif  // SHERPA_NCNN_DISABLE_TTS
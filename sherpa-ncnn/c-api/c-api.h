@@ -78,6 +78,45 @@ SHERPA_NCNN_API const char *SherpaNcnnGetGitSha1();
 // Example return value: "Fri Jun 20 11:22:52 2025"
 SHERPA_NCNN_API const char *SherpaNcnnGetGitDate();
 
+/// Start recording a trace of recognition, VAD and TTS in the Chrome trace
+/// event format, which chrome://tracing and https://ui.perfetto.dev open.
+/// It is written to filename by SherpaNcnnStopTrace() or at exit. Setting
+/// the environment variable SHERPA_NCNN_TRACE to a filename has the same
+/// effect from the start of the process.
+SHERPA_NCNN_API void SherpaNcnnStartTrace(const char *filename);
+
+/// Stop recording and write the trace. Return 1 on success and 0 if no
+/// trace is being recorded or the file cannot be written.
+SHERPA_NCNN_API int32_t SherpaNcnnStopTrace();
+
+/// Turn the process-wide metrics of recognition, VAD and TTS on (1) or off
+/// (0). They are off by default.
+SHERPA_NCNN_API void SherpaNcnnEnableMetrics(int32_t enabled);
+
+/// Get the metrics in the OpenMetrics text format, e.g., to serve them to
+/// Prometheus. They include counters of streams, chunks, endpoints, VAD
+/// segments, TTS requests and cache lookups, and histograms of the time
+/// of each stage and of the real-time factor.
+///
+/// @return Return a null-terminated string. The user has to invoke
+///         SherpaNcnnDestroyMetrics() to free it to avoid memory leak.
+SHERPA_NCNN_API const char *SherpaNcnnGetMetrics();
+
+/// Free a pointer returned by SherpaNcnnGetMetrics()
+SHERPA_NCNN_API void SherpaNcnnDestroyMetrics(const char *metrics);
+
+/// A file of a model that is in memory, e.g., embedded in the binary or
+/// decrypted by the app.
+SHERPA_NCNN_API typedef struct SherpaNcnnModelBuffer {
+  /// Name of the file, e.g., encoder.ncnn.param. See the model configs
+  /// below for the names they expect.
+  const char *name;
+  const void *data;
+
+  /// Number of bytes in data
+  int32_t size;
+} SherpaNcnnModelBuffer;
+
 /// Please refer to
 /// https://k2-fsa.github.io/sherpa/ncnn/pretrained_models/index.html
 /// to download pre-trained models. That is, you can find .ncnn.param,
@@ -111,6 +150,67 @@ SHERPA_NCNN_API typedef struct SherpaNcnnModelConfig {
 
   /// Number of threads for neural network computation.
   int32_t num_threads;
+
+  /// Number of threads of the decoder and the joiner networks. If it is 0,
+  /// num_threads is used.
+  int32_t decoder_num_threads;
+  int32_t joiner_num_threads;
+
+  /// The CPU cores of the encoder, decoder and joiner networks:
+  /// 0 for all cores, 1 for the little cores and 2 for the big cores.
+  int32_t encoder_powersave;
+  int32_t decoder_powersave;
+  int32_t joiner_powersave;
+
+  /// Optional. Comma separated ids of the CPU cores all networks run on,
+  /// e.g., "4,5,6,7". If not empty, it overrides the powersave options
+  /// above. Give each recognizer of a process its own cores so that they
+  /// do not compete for the same ones.
+  const char *cpu_cores;
+
+  /// Optional. If num_buffers is positive, the model is loaded from these
+  /// buffers and the paths above are ignored, except that tokens is used if
+  /// there is no buffer named "tokens". The names are encoder.ncnn.param,
+  /// encoder.ncnn.bin, decoder.ncnn.param, decoder.ncnn.bin,
+  /// joiner.ncnn.param, joiner.ncnn.bin and tokens, which is the content of
+  /// tokens.txt. The .param buffers are copied. The others are not and must
+  /// be kept alive until the recognizer is destroyed.
+  const SherpaNcnnModelBuffer *buffers;
+  int32_t num_buffers;
+
+  /// Optional. The encoder exported with other chunk sizes, as the paths to
+  /// their .param and .bin files separated by commas, e.g.,
+  /// "encoder-16.ncnn.param,encoder-16.ncnn.bin,encoder-64.ncnn.param,
+  /// encoder-64.ncnn.bin". The decoder and joiner above are used for all of
+  /// them. See CreateStreamWithChunkSize().
+  const char *encoder_variants;
+
+  /// Optional. The precision and memory layout of the encoder, decoder and
+  /// joiner networks: "accuracy" (fp32), "balanced" (weights and blobs in
+  /// fp16, or bf16 on CPUs without fp16, with fp32 arithmetic) or "speed"
+  /// (also fp16 arithmetic where supported, e.g., on ARMv8.2 CPUs and most
+  /// GPUs). If NULL or empty, the defaults of ncnn are used.
+  const char *encoder_precision;
+  const char *decoder_precision;
+  const char *joiner_precision;
+
+  /// Optional. If positive, the networks allocate their intermediate
+  /// memory from a fixed arena of this many MB, allocated when the
+  /// recognizer is created, instead of from the heap. A run that needs
+  /// more fails with an error log. Use it to bound the memory and avoid
+  /// heap fragmentation in long-running embedded deployments.
+  int32_t arena_mb;
+
+  /// Optional. "host:port" of a sherpa-ncnn-encoder-server with the same
+  /// model. If not NULL or empty, the encoder runs on that server and the
+  /// rest runs locally. Not supported on Windows.
+  const char *remote_encoder;
+
+  /// Optional. Path to a profile written by SherpaNcnnAutoTune() or
+  /// sherpa-ncnn-autotune. If not NULL or empty, the device, precision,
+  /// number of threads and convolution options of each network are taken
+  /// from it instead of from the fields above.
+  const char *perf_profile;
 } SherpaNcnnModelConfig;
 
 SHERPA_NCNN_API typedef struct SherpaNcnnDecoderConfig {
@@ -165,6 +265,20 @@ SHERPA_NCNN_API typedef struct SherpaNcnnRecognizerConfig {
 
   /// scale of hotwords, used only when hotwords_file is not empty
   float hotwords_score;
+
+  /// 1 to record the wall time of each stage of recognition.
+  /// See GetLatencyStats() and GetStreamLatencyStats().
+  /// 0 to disable it.
+  int32_t enable_profiling;
+
+  /// 1 to publish the result of each stream after each decoded chunk so
+  /// that GetResultSnapshot() can be called from other threads.
+  /// 0 to disable it.
+  int32_t publish_results;
+
+  /// Maximum number of streams kept by RecycleStream() for reuse.
+  /// 0 disables the pool.
+  int32_t stream_pool_size;
 } SherpaNcnnRecognizerConfig;
 
 SHERPA_NCNN_API typedef struct SherpaNcnnResult {
@@ -183,8 +297,66 @@ SHERPA_NCNN_API typedef struct SherpaNcnnResult {
   int32_t count;
 } SherpaNcnnResult;
 
+// See GetResultUpdate()
+SHERPA_NCNN_API typedef struct SherpaNcnnResultUpdate {
+  // It increases whenever the result changes
+  int32_t revision;
+
+  // Number of tokens kept from the previous result. The tokens from this
+  // index on are replaced by the tokens below. It is 0 after Reset().
+  int32_t start;
+
+  // The first num_stable tokens of the result do not change any more
+  // until Reset()
+  int32_t num_stable;
+
+  // Text of the tokens below
+  const char *text;
+
+  // The tokens from index start on, each followed by \0
+  const char *tokens;
+
+  // Timestamps in seconds of the tokens
+  const float *timestamps;
+
+  // The number of tokens/timestamps in above pointers
+  int32_t count;
+} SherpaNcnnResultUpdate;
+
+SHERPA_NCNN_API typedef struct SherpaNcnnModel SherpaNcnnModel;
 SHERPA_NCNN_API typedef struct SherpaNcnnRecognizer SherpaNcnnRecognizer;
 SHERPA_NCNN_API typedef struct SherpaNcnnStream SherpaNcnnStream;
+SHERPA_NCNN_API typedef struct SherpaNcnnRecognizerLoader
+    SherpaNcnnRecognizerLoader;
+
+/// Load a model that can be shared by several recognizers, see
+/// CreateRecognizerWithModel().
+///
+/// @param config  Config for the model. config->tokens is not used.
+/// @return Return a pointer to the model. The user has to invoke
+///         SherpaNcnnDestroyModel() to free it to avoid memory leak.
+///         Return NULL if the model cannot be created.
+SHERPA_NCNN_API SherpaNcnnModel *SherpaNcnnCreateModel(
+    const SherpaNcnnModelConfig *config);
+
+/// Find the fastest options of each network of a model on this device and
+/// write them to a profile for SherpaNcnnModelConfig::perf_profile. The
+/// model is loaded and run many times, so it takes a while and should be
+/// done once per device, e.g., at the first start of an app.
+///
+/// @param config  Config for the model. config->tokens is not used.
+/// @param filename  The profile is written to this file.
+/// @param num_runs  Number of timed runs of each candidate. Default: 10
+/// @return Return 1 on success. Return 0 otherwise.
+SHERPA_NCNN_API int32_t SherpaNcnnAutoTune(const SherpaNcnnModelConfig *config,
+                                           const char *filename,
+                                           int32_t num_runs);
+
+/// Free a pointer returned by SherpaNcnnCreateModel(). Recognizers created
+/// from the model keep using it, so it can be freed before them.
+///
+/// @param p A pointer returned by SherpaNcnnCreateModel()
+SHERPA_NCNN_API void SherpaNcnnDestroyModel(const SherpaNcnnModel *p);
 
 /// Create a recognizer.
 ///
@@ -199,15 +371,130 @@ SHERPA_NCNN_API SherpaNcnnRecognizer *CreateRecognizer(
 /// @param p A pointer returned by CreateRecognizer()
 SHERPA_NCNN_API void DestroyRecognizer(SherpaNcnnRecognizer *p);
 
+/// Create a recognizer that uses the given model instead of loading the
+/// weights again. Recognizers created from the same model can have
+/// different decoding, hotword, endpoint and feature settings.
+///
+/// @param config  Config for the recognizer. From config->model_config, only
+///                tokens is used. It must match the model.
+/// @param model  A pointer returned by SherpaNcnnCreateModel()
+/// @return Return a pointer to the recognizer, or NULL if model is NULL.
+///         The user has to invoke DestroyRecognizer() to free it to avoid
+///         memory leak.
+SHERPA_NCNN_API SherpaNcnnRecognizer *CreateRecognizerWithModel(
+    const SherpaNcnnRecognizerConfig *config, const SherpaNcnnModel *model);
+
+/// Run the neural networks of a recognizer once on silence, so that the
+/// first call of Decode() does not pay for the setup that ncnn does on the
+/// first run, e.g., creating Vulkan command buffers.
+///
+/// @param p A pointer returned by CreateRecognizer()
+SHERPA_NCNN_API void WarmUpRecognizer(const SherpaNcnnRecognizer *p);
+
+/// Start creating a recognizer on a background thread and return
+/// immediately. The recognizer is warmed up, see WarmUpRecognizer().
+///
+/// @param config  Config for the recognizer. It is copied, so it can be
+///                freed right after the call.
+/// @return Return a pointer to be passed to IsRecognizerLoaded() and
+///         GetLoadedRecognizer(). The user has to invoke
+///         DestroyRecognizerLoader() to free it.
+SHERPA_NCNN_API SherpaNcnnRecognizerLoader *CreateRecognizerAsync(
+    const SherpaNcnnRecognizerConfig *config);
+
+/// Return 1 if the recognizer of the loader is ready, so that
+/// GetLoadedRecognizer() does not block. Return 0 otherwise.
+SHERPA_NCNN_API int32_t
+IsRecognizerLoaded(const SherpaNcnnRecognizerLoader *loader);
+
+/// Wait until the recognizer is ready and return it. It can be called only
+/// once for a loader.
+///
+/// @return Return a pointer to the recognizer or NULL on errors. The user
+///         has to invoke DestroyRecognizer() to free it.
+SHERPA_NCNN_API SherpaNcnnRecognizer *GetLoadedRecognizer(
+    SherpaNcnnRecognizerLoader *loader);
+
+/// Free a pointer returned by CreateRecognizerAsync(). If the recognizer
+/// is still loading, it waits for it.
+SHERPA_NCNN_API void DestroyRecognizerLoader(
+    SherpaNcnnRecognizerLoader *loader);
+
 /// Create a stream for accepting audio samples
 ///
 /// @param p A pointer returned by CreateRecognizer
-/// @return Return a pointer to a stream. The caller MUST invoke
+/// @return Return a pointer to a stream, or NULL if it cannot be created.
+///         The caller MUST invoke
 ///         DestroyStream at the end to avoid memory leak.
 SHERPA_NCNN_API SherpaNcnnStream *CreateStream(SherpaNcnnRecognizer *p);
 
+/// Create a stream that is decoded with the given hotwords instead of those
+/// from the hotwords_file of the recognizer config. Used only with
+/// modified_beam_search.
+///
+/// Compiled hotwords are cached by the recognizer, so creating a stream
+/// with hotwords that were used recently does not build them again.
+///
+/// @param p A pointer returned by CreateRecognizer
+/// @param hotwords  Hotwords in the format of the hotwords file, separated
+///                  by newlines, e.g., "▁HE LL O\n▁WORLD :2.0". If it is
+///                  NULL or empty, the stream has no hotwords.
+/// @return Return a pointer to a stream, or NULL if hotwords contain a
+///         token that is not in the symbol table. The caller MUST invoke
+///         DestroyStream at the end to avoid memory leak.
+SHERPA_NCNN_API SherpaNcnnStream *CreateStreamWithHotwords(
+    SherpaNcnnRecognizer *p, const char *hotwords);
+
+/// Create a stream that is decoded with the encoder whose chunk size is
+/// closest to chunk_size, see encoder_variants of SherpaNcnnModelConfig.
+/// Use a small chunk for interactive streams and a large one for
+/// throughput; one recognizer serves both.
+///
+/// @param p A pointer returned by CreateRecognizer()
+/// @param chunk_size  In feature frames of 10 ms before subsampling, e.g.,
+///                    32 for 320 ms.
+/// @param hotwords  See CreateStreamWithHotwords(). If it is NULL, the
+///                  hotwords of the recognizer config are used, as in
+///                  CreateStream().
+/// @return Return a pointer to a stream, or NULL if hotwords are invalid,
+///         see CreateStreamWithHotwords(). The caller MUST invoke
+///         DestroyStream at the end to avoid memory leak.
+SHERPA_NCNN_API SherpaNcnnStream *CreateStreamWithChunkSize(
+    SherpaNcnnRecognizer *p, int32_t chunk_size, const char *hotwords);
+
+/// Change the hotwords of a stream, e.g., right after Reset(). The boosting
+/// scores of partial matches with the previous hotwords are canceled.
+///
+/// @param p A pointer returned by CreateRecognizer
+/// @param s A pointer returned by CreateStream() or
+///          CreateStreamWithHotwords() of the same recognizer
+/// @param hotwords  See CreateStreamWithHotwords().
+/// @return Return 1 on success. Return 0 and keep the hotwords of s if
+///         hotwords contain a token that is not in the symbol table.
+SHERPA_NCNN_API int32_t SetStreamHotwords(SherpaNcnnRecognizer *p,
+                                          SherpaNcnnStream *s,
+                                          const char *hotwords);
+
 SHERPA_NCNN_API void DestroyStream(SherpaNcnnStream *s);
 
+/// Same as DestroyStream(), but the stream is kept for reuse by the next
+/// CreateStream*() call of the recognizer if its pool is not full, see
+/// stream_pool_size. s must not be used afterwards.
+///
+/// @param p The recognizer that created s.
+/// @param s A pointer returned by CreateStream()
+SHERPA_NCNN_API void RecycleStream(SherpaNcnnRecognizer *p,
+                                   SherpaNcnnStream *s);
+
+/// Release most of the memory of a stream that is idle, e.g., one of many
+/// connections that are waiting for audio. The encoder states are kept in
+/// fp16 and the buffered samples are freed. The stream is restored
+/// automatically by the next AcceptWaveform() or Decode(). Do not call it
+/// after InputFinished().
+///
+/// @param s A pointer returned by CreateStream()
+SHERPA_NCNN_API void ParkStream(SherpaNcnnStream *s);
+
 /// Accept input audio samples and compute the features.
 ///
 /// @param s  A pointer returned by CreateStream().
@@ -221,6 +508,40 @@ SHERPA_NCNN_API void DestroyStream(SherpaNcnnStream *s);
 SHERPA_NCNN_API void AcceptWaveform(SherpaNcnnStream *s, float sample_rate,
                                     const float *samples, int32_t n);
 
+/// Same as AcceptWaveform() but for 16-bit PCM samples, e.g., from ALSA or
+/// RTP. They are scaled by 1/32768 inside, so the caller does not need to
+/// convert them to float.
+///
+/// @param s  A pointer returned by CreateStream().
+/// @param sample_rate  Sample rate of the input samples.
+/// @param samples A pointer to a 1-D array containing 16-bit PCM samples.
+/// @param n  Number of elements in the samples array.
+SHERPA_NCNN_API void AcceptWaveformInt16(SherpaNcnnStream *s,
+                                         float sample_rate,
+                                         const int16_t *samples, int32_t n);
+
+/// Pass each channel of interleaved audio to its own stream, e.g., the two
+/// sides of a stereo call recording. Decode the streams together, e.g.,
+/// with DecodeMultipleStreams(), so that they share batches.
+///
+/// @param streams  num_channels pointers returned by CreateStream().
+///                 streams[c] gets channel c.
+/// @param num_channels  Number of channels.
+/// @param sample_rate  Sample rate of the input samples.
+/// @param samples  n frames of num_channels samples each, normalized to
+///                 [-1, 1].
+/// @param n  Number of frames, i.e., samples per channel.
+SHERPA_NCNN_API void AcceptWaveformInterleaved(SherpaNcnnStream **streams,
+                                               int32_t num_channels,
+                                               float sample_rate,
+                                               const float *samples,
+                                               int32_t n);
+
+/// Same as AcceptWaveformInterleaved() but for 16-bit PCM samples.
+SHERPA_NCNN_API void AcceptWaveformInterleavedInt16(
+    SherpaNcnnStream **streams, int32_t num_channels, float sample_rate,
+    const int16_t *samples, int32_t n);
+
 /// Test if the stream has enough frames for decoding.
 ///
 /// The common usage is:
@@ -240,6 +561,61 @@ SHERPA_NCNN_API int32_t IsReady(SherpaNcnnRecognizer *p, SherpaNcnnStream *s);
 /// @param s A pointer returned by CreateStream()
 SHERPA_NCNN_API void Decode(SherpaNcnnRecognizer *p, SherpaNcnnStream *s);
 
+/// Test n streams at once, e.g., to find the ones to pass to
+/// DecodeMultipleStreams().
+///
+/// @param p A pointer returned by CreateRecognizer()
+/// @param streams An array of n pointers returned by CreateStream()
+/// @param n Number of streams
+/// @param ready It has (n + 7) / 8 bytes. Bit (i % 8) of ready[i / 8] is set
+///              to 1 if streams[i] is ready for decoding and 0 otherwise.
+/// @return Return the number of ready streams.
+SHERPA_NCNN_API int32_t IsReadyMultiple(SherpaNcnnRecognizer *p,
+                                        SherpaNcnnStream **streams, int32_t n,
+                                        uint8_t *ready);
+
+/// Decode n streams in one batch. It is faster than calling Decode() for
+/// each of them.
+///
+/// Pre-condition for this function:
+///   IsReady(p, streams[i]) returns 1 for every stream.
+///
+/// @param p A pointer returned by CreateRecognizer()
+/// @param streams An array of n pointers returned by CreateStream()
+/// @param n Number of streams
+SHERPA_NCNN_API void DecodeMultipleStreams(SherpaNcnnRecognizer *p,
+                                           SherpaNcnnStream **streams,
+                                           int32_t n);
+
+/// Decode all ready chunks of n streams in one call, e.g., to catch up with
+/// a backlog after a stall. Ready streams are decoded in batches until
+/// none is ready. A stream is not decoded further once an endpoint is
+/// detected for it, so call Reset() for it afterwards if IsEndpoint()
+/// returns 1.
+///
+/// @param p A pointer returned by CreateRecognizer()
+/// @param streams An array of n pointers returned by CreateStream(). They
+///                need not be ready.
+/// @param n Number of streams
+/// @return Return the number of decoded chunks, summed over the streams.
+SHERPA_NCNN_API int32_t DecodeReadyStreams(SherpaNcnnRecognizer *p,
+                                           SherpaNcnnStream **streams,
+                                           int32_t n);
+
+/// Decode the rest of n streams after InputFinished() was called for them,
+/// without appending tail padding. Ready chunks are decoded first and the
+/// frames that do not fill a chunk are then decoded with the right context
+/// of the encoder padded with silence. Endpoints are not checked.
+///
+/// @param p A pointer returned by CreateRecognizer()
+/// @param streams An array of n pointers returned by CreateStream(). They
+///                need not be ready.
+/// @param n Number of streams
+/// @return Return the number of decoded chunks, summed over the streams.
+SHERPA_NCNN_API int32_t DecodeRemainingFrames(SherpaNcnnRecognizer *p,
+                                              SherpaNcnnStream **streams,
+                                              int32_t n);
+
 /// Get the decoding results so far.
 ///
 /// @param p A pointer returned by CreateRecognizer().
@@ -254,6 +630,57 @@ SHERPA_NCNN_API SherpaNcnnResult *GetResult(SherpaNcnnRecognizer *p,
 /// @param r A pointer returned by GetResult()
 SHERPA_NCNN_API void DestroyResult(const SherpaNcnnResult *r);
 
+/// Return the revision of the result of a stream. It increases whenever
+/// the result changes, e.g., after Decode() or Reset(), and it is cheap
+/// to get. Use it to skip GetBorrowedResult() or GetResult() when the
+/// result is the same as last time.
+///
+/// @param s A pointer returned by CreateStream()
+SHERPA_NCNN_API int32_t GetResultRevision(SherpaNcnnStream *s);
+
+/// Like GetResult(), but the result is owned by the stream and it is
+/// computed again only if it has changed. Nothing is allocated once the
+/// memory of the stream is large enough, so it is suitable for showing
+/// partial results after every Decode().
+///
+/// Do NOT call DestroyResult() on the returned pointer. It is valid
+/// until the next call of GetBorrowedResult() with s or until s is
+/// destroyed.
+///
+/// @param p A pointer returned by CreateRecognizer().
+/// @param s A pointer returned by CreateStream()
+/// @param revision If not NULL, it is set to the revision of the result,
+///                 see GetResultRevision().
+SHERPA_NCNN_API const SherpaNcnnResult *GetBorrowedResult(
+    SherpaNcnnRecognizer *p, SherpaNcnnStream *s, int32_t *revision);
+
+/// Return only what has changed in the result of a stream since the last
+/// call, e.g., to append newly decoded text to a UI. The cost depends on
+/// the number of changed tokens, not on the length of the utterance.
+///
+/// The revision is independent of GetResultRevision().
+///
+/// Do NOT free the returned pointer. It is valid until the next call of
+/// GetResultUpdate() with s or until s is destroyed.
+///
+/// @param p A pointer returned by CreateRecognizer().
+/// @param s A pointer returned by CreateStream()
+SHERPA_NCNN_API const SherpaNcnnResultUpdate *GetResultUpdate(
+    SherpaNcnnRecognizer *p, SherpaNcnnStream *s);
+
+/// Like GetResult(), but the result is the one published after the last
+/// decoded chunk or Reset() of s. It does not wait for the decoding of s,
+/// so it can be called from any thread, e.g., a UI thread, while another
+/// thread is inside Decode() with s. It requires publish_results in the
+/// config. Otherwise, the result is empty.
+///
+/// @param p A pointer returned by CreateRecognizer().
+/// @param s A pointer returned by CreateStream()
+/// @return A pointer containing the result. The user has to invoke
+///         DestroyResult() to free the returned pointer to avoid memory leak.
+SHERPA_NCNN_API SherpaNcnnResult *GetResultSnapshot(SherpaNcnnRecognizer *p,
+                                                    SherpaNcnnStream *s);
+
 /// Reset a stream
 ///
 /// @param p A pointer returned by CreateRecognizer().
@@ -278,6 +705,150 @@ SHERPA_NCNN_API void InputFinished(SherpaNcnnStream *s);
 SHERPA_NCNN_API int32_t IsEndpoint(SherpaNcnnRecognizer *p,
                                    SherpaNcnnStream *s);
 
+/// Save the decoding state of a stream, e.g., to continue decoding it on
+/// another node. Restoring it with RestoreStream() is much cheaper than
+/// decoding the audio again. Audio that has not formed a complete feature
+/// frame yet (less than 25 ms) and partial matches of hotwords are not
+/// saved.
+///
+/// @param p A pointer returned by CreateRecognizer()
+/// @param s A pointer returned by CreateStream()
+/// @param size  It is set to the number of bytes of the snapshot.
+/// @return Return NULL on error. Otherwise, the caller MUST invoke
+///         DestroyStreamSnapshot() to free the returned pointer.
+SHERPA_NCNN_API const uint8_t *SaveStream(SherpaNcnnRecognizer *p,
+                                          SherpaNcnnStream *s,
+                                          int32_t *size);
+
+/// Free the pointer returned by SaveStream().
+SHERPA_NCNN_API void DestroyStreamSnapshot(const uint8_t *snapshot);
+
+/// Create a stream that continues decoding from a snapshot. Feed it the
+/// audio that follows the audio of the saved stream.
+///
+/// @param p A pointer returned by CreateRecognizer(). It must use the same
+///          model as the recognizer of the saved stream.
+/// @param snapshot  The output of SaveStream(). It is copied.
+/// @param size  Number of bytes in snapshot.
+/// @param hotwords  See CreateStreamWithHotwords(). If it is NULL, the
+///                  hotwords of the recognizer config are used, as in
+///                  CreateStream().
+/// @return Return NULL if snapshot is invalid for the model or if the
+///         stream cannot be created, e.g., hotwords are invalid. Otherwise,
+///         the caller MUST invoke DestroyStream() at the end.
+SHERPA_NCNN_API SherpaNcnnStream *RestoreStream(SherpaNcnnRecognizer *p,
+                                                const uint8_t *snapshot,
+                                                int32_t size,
+                                                const char *hotwords);
+
+SHERPA_NCNN_API typedef struct SherpaNcnnStageStats {
+  /// Name of the stage. Possible values are:
+  /// feature_extraction, encoder, decoder, joiner, search, and the stages
+  /// of text-to-speech, whose count is always 0 for a recognizer:
+  /// tts_front_end, tts_encoder, tts_duration_predictor,
+  /// tts_path_attention, tts_flow, tts_vocoder
+  const char *name;
+
+  /// Number of samples. A sample is the time of this stage for one call
+  /// of AcceptWaveform() or for one chunk decoded by Decode()
+  int64_t count;
+
+  float total_ms;
+  float mean_ms;
+  float p50_ms;
+  float p99_ms;
+  float max_ms;
+} SherpaNcnnStageStats;
+
+SHERPA_NCNN_API typedef struct SherpaNcnnLatencyStats {
+  /// Pointer to an array of num_stages entries
+  const SherpaNcnnStageStats *stages;
+  int32_t num_stages;
+} SherpaNcnnLatencyStats;
+
+/// Get the latency statistics aggregated over all streams of a recognizer.
+///
+/// @param p A pointer returned by CreateRecognizer()
+/// @return Return nullptr if enable_profiling is 0. Otherwise, the user has
+///         to invoke DestroyLatencyStats() to free the returned pointer to
+///         avoid memory leak.
+SHERPA_NCNN_API const SherpaNcnnLatencyStats *GetLatencyStats(
+    SherpaNcnnRecognizer *p);
+
+/// Get the latency statistics of a stream.
+///
+/// @param s A pointer returned by CreateStream()
+/// @return Return nullptr if enable_profiling is 0. Otherwise, the user has
+///         to invoke DestroyLatencyStats() to free the returned pointer to
+///         avoid memory leak.
+SHERPA_NCNN_API const SherpaNcnnLatencyStats *GetStreamLatencyStats(
+    SherpaNcnnStream *s);
+
+/// Free a pointer returned by GetLatencyStats() or GetStreamLatencyStats()
+SHERPA_NCNN_API void DestroyLatencyStats(const SherpaNcnnLatencyStats *s);
+
+// ============================================================
+// For decoding streams on a background thread
+// ============================================================
+
+/// A thread that decodes the streams added to it whenever they are ready
+/// and reports their results through a callback. The caller only feeds
+/// audio, e.g., from the event loop of an app, and never blocks on
+/// decoding.
+///
+/// While a stream is in a worker, the other threads may only call
+/// AcceptWaveform(), AcceptWaveformInt16() and InputFinished() for it,
+/// followed by SherpaNcnnDecodeWorkerNotify().
+SHERPA_NCNN_API typedef struct SherpaNcnnDecodeWorker SherpaNcnnDecodeWorker;
+
+/// Invoked on the thread of the worker.
+///
+/// @param s The stream of the result.
+/// @param r The result. It is valid only during the callback.
+/// @param is_final 1 if an endpoint is detected or the input of s is
+///                 finished and it is fully decoded. At an endpoint, the
+///                 stream is reset after the callback. After the last
+///                 result of a finished input, the stream is removed from
+///                 the worker. 0 for a partial result, which is reported
+///                 only if it differs from the last one.
+/// @param user_data The pointer given to SherpaNcnnStartDecodeWorker().
+typedef void (*SherpaNcnnDecodeCallback)(SherpaNcnnStream *s,
+                                         const SherpaNcnnResult *r,
+                                         int32_t is_final, void *user_data);
+
+/// Start a worker thread for streams of the given recognizer. It uses
+/// batched decoding when several streams are ready.
+///
+/// @param p A pointer returned by CreateRecognizer(). It must outlive the
+///          worker.
+/// @param callback It is called for results of the streams.
+/// @param user_data It is passed to the callback.
+/// @return Return a pointer that must be freed with
+///         SherpaNcnnStopDecodeWorker().
+SHERPA_NCNN_API SherpaNcnnDecodeWorker *SherpaNcnnStartDecodeWorker(
+    SherpaNcnnRecognizer *p, SherpaNcnnDecodeCallback callback,
+    void *user_data);
+
+/// Decode a stream on the worker from now on. It must not be destroyed
+/// while it is in the worker.
+SHERPA_NCNN_API void SherpaNcnnDecodeWorkerAddStream(SherpaNcnnDecodeWorker *w,
+                                                     SherpaNcnnStream *s);
+
+/// Stop decoding a stream. When it returns, the worker no longer uses the
+/// stream, which can then be destroyed. It is a no-op if the stream
+/// is not in the worker.
+SHERPA_NCNN_API void SherpaNcnnDecodeWorkerRemoveStream(
+    SherpaNcnnDecodeWorker *w, SherpaNcnnStream *s);
+
+/// Wake up the worker, e.g., after feeding audio to its streams or
+/// calling InputFinished().
+SHERPA_NCNN_API void SherpaNcnnDecodeWorkerNotify(SherpaNcnnDecodeWorker *w);
+
+/// Stop the worker thread, wait for it and free the worker. The streams
+/// are not destroyed. The callback is not called after it returns. Do not
+/// call it from the callback.
+SHERPA_NCNN_API void SherpaNcnnStopDecodeWorker(SherpaNcnnDecodeWorker *w);
+
 // for displaying results on Linux/macOS.
 SHERPA_NCNN_API typedef struct SherpaNcnnDisplay SherpaNcnnDisplay;
 
@@ -324,6 +895,38 @@ SHERPA_NCNN_API typedef struct SherpaNcnnVadModelConfig {
   /// Number of threads for neural network computation.
   /// Default: 1
   int32_t num_threads;
+
+  /// Optional. If num_buffers is positive, the model is loaded from the
+  /// buffers silero.ncnn.param and silero.ncnn.bin instead of model_dir.
+  /// silero.ncnn.bin is not copied and must be kept alive until the VAD
+  /// is destroyed.
+  const SherpaNcnnModelBuffer *buffers;
+  int32_t num_buffers;
+
+  /// If negative, windows whose energy in dB relative to full scale is
+  /// below it are treated as silence without running the model, e.g., -60
+  /// for telephony audio with long pauses.
+  /// Default: 0, i.e., every window runs the model
+  float energy_gate_db;
+
+  /// Windows below energy_gate_db whose zero-crossing rate is above it
+  /// still run the model, since unvoiced speech is quiet.
+  /// Default: 0.3
+  float energy_gate_max_zcr;
+
+  /// If positive, speech longer than this many seconds is cut into
+  /// segments at the least speech-like point within max_segment_search
+  /// seconds before the limit, even without a pause.
+  /// Default: 0, i.e., segments end only at pauses
+  float max_segment_duration;
+
+  /// Default: 2
+  float max_segment_search;
+
+  /// Seconds of audio before each parallel part of a file that warm up
+  /// the model. Used only by SherpaNcnnVoiceActivityDetectorAcceptFile().
+  /// Default: 1
+  float file_warm_up;
 } SherpaNcnnVadModelConfig;
 
 /// Represents a speech segment detected by VAD.
@@ -370,6 +973,26 @@ SHERPA_NCNN_API void SherpaNcnnDestroyVoiceActivityDetector(
 SHERPA_NCNN_API void SherpaNcnnVoiceActivityDetectorAcceptWaveform(
     SherpaNcnnVoiceActivityDetector *p, const float *samples, int32_t n);
 
+/// Same as SherpaNcnnVoiceActivityDetectorAcceptWaveform() but for 16-bit
+/// PCM samples, which are scaled by 1/32768 inside.
+///
+/// @param p A pointer returned by SherpaNcnnCreateVoiceActivityDetector().
+/// @param samples A pointer to a 1-D array containing 16-bit PCM samples.
+/// @param n Number of elements in the samples array.
+SHERPA_NCNN_API void SherpaNcnnVoiceActivityDetectorAcceptWaveformInt16(
+    SherpaNcnnVoiceActivityDetector *p, const int16_t *samples, int32_t n);
+
+/// Accept all samples of a file at once and flush the VAD at the end.
+/// Parts of the file run the model in parallel on up to num_threads
+/// threads of the config.
+///
+/// @param p A pointer returned by SherpaNcnnCreateVoiceActivityDetector().
+/// @param samples A pointer to a 1-D array containing audio samples.
+///                The range of samples has to be normalized to [-1, 1].
+/// @param n Number of elements in the samples array.
+SHERPA_NCNN_API void SherpaNcnnVoiceActivityDetectorAcceptFile(
+    SherpaNcnnVoiceActivityDetector *p, const float *samples, int32_t n);
+
 /// Check whether the speech segment queue is empty.
 ///
 /// @param p A pointer returned by SherpaNcnnCreateVoiceActivityDetector().
@@ -387,6 +1010,22 @@ SherpaNcnnVoiceActivityDetectorEmpty(SherpaNcnnVoiceActivityDetector *p);
 SHERPA_NCNN_API const SherpaNcnnSpeechSegment *
 SherpaNcnnVoiceActivityDetectorFront(SherpaNcnnVoiceActivityDetector *p);
 
+/// Copy the samples of the first speech segment in the queue to a buffer
+/// of the caller. Unlike SherpaNcnnVoiceActivityDetectorFront(), nothing
+/// is allocated. The queue must not be empty.
+///
+/// @param p A pointer returned by SherpaNcnnCreateVoiceActivityDetector().
+/// @param samples The buffer. If it is NULL or capacity is less than the
+///                number of samples, nothing is copied. Call it with NULL
+///                to get the size of the buffer that is needed.
+/// @param capacity Number of floats samples can hold.
+/// @param start If not NULL, it is set to the start sample index of the
+///              segment in the original audio.
+/// @return Return the number of samples of the segment.
+SHERPA_NCNN_API int32_t SherpaNcnnVoiceActivityDetectorFrontCopy(
+    SherpaNcnnVoiceActivityDetector *p, float *samples, int32_t capacity,
+    int32_t *start);
+
 /// Remove the first speech segment from the queue.
 /// It throws if the queue is empty.
 ///
@@ -420,12 +1059,356 @@ SHERPA_NCNN_API void SherpaNcnnVoiceActivityDetectorFlush(
 SHERPA_NCNN_API int32_t
 SherpaNcnnVoiceActivityDetectorDetected(SherpaNcnnVoiceActivityDetector *p);
 
+/// Use the detector for the endpointing of a stream instead of trailing
+/// blanks. The speech probability of each window is passed to the stream,
+/// and IsEndpoint() then measures trailing silence in non-speech windows.
+/// The detector and the stream must get the same audio. Pass NULL to
+/// detach the stream.
+///
+/// @param p A pointer returned by SherpaNcnnCreateVoiceActivityDetector().
+/// @param s A pointer returned by CreateStream() or NULL. It must outlive
+///          the detector or be detached first.
+SHERPA_NCNN_API void SherpaNcnnVoiceActivityDetectorAttachStream(
+    SherpaNcnnVoiceActivityDetector *p, SherpaNcnnStream *s);
+
 /// Free the pointer returned by SherpaNcnnVoiceActivityDetectorFront().
 ///
 /// @param p A pointer returned by SherpaNcnnVoiceActivityDetectorFront().
 SHERPA_NCNN_API void SherpaNcnnDestroySpeechSegment(
     const SherpaNcnnSpeechSegment *p);
 
+// ============================================================
+// For simulated streaming ASR with a non-streaming model
+// ============================================================
+
+/// Configuration for a SenseVoice model
+SHERPA_NCNN_API typedef struct SherpaNcnnSenseVoiceModelConfig {
+  /// Path to the directory containing model.ncnn.param and model.ncnn.bin
+  const char *model_dir;
+
+  /// zh, en, ja, ko, yue or auto. Default: auto
+  const char *language;
+
+  /// Non-zero to use inverse text normalization
+  int32_t use_itn;
+
+  /// Optional. If num_buffers is positive, the model is loaded from the
+  /// buffers model.ncnn.param and model.ncnn.bin instead of model_dir.
+  /// If there is also a buffer named "tokens", it is used when tokens is
+  /// not given. model.ncnn.bin and tokens are not copied and must be kept
+  /// alive until the recognizer is destroyed.
+  const SherpaNcnnModelBuffer *buffers;
+  int32_t num_buffers;
+} SherpaNcnnSenseVoiceModelConfig;
+
+SHERPA_NCNN_API typedef struct SherpaNcnnSimulatedStreamingAsrConfig {
+  SherpaNcnnVadModelConfig vad_config;
+  SherpaNcnnSenseVoiceModelConfig sense_voice;
+
+  /// Path to tokens.txt
+  const char *tokens;
+
+  /// Number of threads of the recognizer. Default: 1
+  int32_t num_threads;
+
+  /// greedy_search or prefix_beam_search. Default: greedy_search
+  const char *decoding_method;
+
+  /// The current speech segment is decoded again once it has grown by
+  /// this many seconds. Default: 0.2
+  float decode_interval;
+
+  /// A decode covers at most about this many seconds of a segment. Older
+  /// text of a longer segment is committed and not decoded again.
+  /// Default: 8
+  float max_window_duration;
+
+  /// Text is committed only if it has at least this many seconds of audio
+  /// after it. Default: 2
+  float min_right_context;
+} SherpaNcnnSimulatedStreamingAsrConfig;
+
+/// Real-time recognition with a VAD and a non-streaming model. The cost
+/// of each decode is bounded by max_window_duration.
+SHERPA_NCNN_API typedef struct SherpaNcnnSimulatedStreamingAsr
+    SherpaNcnnSimulatedStreamingAsr;
+
+/// @param config  Fields that are 0 or NULL take their default values.
+/// @return Return NULL if the config is invalid. Otherwise, the user has
+///         to invoke SherpaNcnnDestroySimulatedStreamingAsr() to free the
+///         returned pointer to avoid memory leak.
+SHERPA_NCNN_API SherpaNcnnSimulatedStreamingAsr *
+SherpaNcnnCreateSimulatedStreamingAsr(
+    const SherpaNcnnSimulatedStreamingAsrConfig *config);
+
+SHERPA_NCNN_API void SherpaNcnnDestroySimulatedStreamingAsr(
+    SherpaNcnnSimulatedStreamingAsr *p);
+
+/// Accept samples at the sample rate of the VAD config, normalized to
+/// [-1, 1]. Decoding happens in this call.
+///
+/// @param p A pointer returned by SherpaNcnnCreateSimulatedStreamingAsr().
+SHERPA_NCNN_API void SherpaNcnnSimulatedStreamingAsrAcceptWaveform(
+    SherpaNcnnSimulatedStreamingAsr *p, const float *samples, int32_t n);
+
+/// Same as SherpaNcnnSimulatedStreamingAsrAcceptWaveform() but for 16-bit
+/// PCM samples.
+SHERPA_NCNN_API void SherpaNcnnSimulatedStreamingAsrAcceptWaveformInt16(
+    SherpaNcnnSimulatedStreamingAsr *p, const int16_t *samples, int32_t n);
+
+/// End the current speech segment, if any, so that its result is queued.
+SHERPA_NCNN_API void SherpaNcnnSimulatedStreamingAsrInputFinished(
+    SherpaNcnnSimulatedStreamingAsr *p);
+
+/// @return Return 1 if a speech segment is going on; return 0 otherwise.
+SHERPA_NCNN_API int32_t SherpaNcnnSimulatedStreamingAsrIsSpeechDetected(
+    SherpaNcnnSimulatedStreamingAsr *p);
+
+/// Return the result of the current speech segment so far. Timestamps are
+/// in seconds of the input. The user has to invoke DestroyResult() to free
+/// the returned pointer to avoid memory leak.
+SHERPA_NCNN_API SherpaNcnnResult *
+SherpaNcnnSimulatedStreamingAsrGetPartialResult(
+    SherpaNcnnSimulatedStreamingAsr *p);
+
+/// @return Return 1 if no result of a finished segment is queued; return 0
+///         otherwise.
+SHERPA_NCNN_API int32_t
+SherpaNcnnSimulatedStreamingAsrEmpty(SherpaNcnnSimulatedStreamingAsr *p);
+
+/// Return the result of the oldest finished segment. The queue must not be
+/// empty. The user has to invoke DestroyResult() to free the returned
+/// pointer to avoid memory leak.
+SHERPA_NCNN_API SherpaNcnnResult *SherpaNcnnSimulatedStreamingAsrFront(
+    SherpaNcnnSimulatedStreamingAsr *p);
+
+/// Remove the oldest finished segment from the queue.
+SHERPA_NCNN_API void SherpaNcnnSimulatedStreamingAsrPop(
+    SherpaNcnnSimulatedStreamingAsr *p);
+
+/// Drop the current segment and the queued results.
+SHERPA_NCNN_API void SherpaNcnnSimulatedStreamingAsrReset(
+    SherpaNcnnSimulatedStreamingAsr *p);
+
+// ============================================================
+// For non-streaming ASR
+// ============================================================
+
+SHERPA_NCNN_API typedef struct SherpaNcnnOfflineRecognizerConfig {
+  SherpaNcnnSenseVoiceModelConfig sense_voice;
+
+  /// Path to tokens.txt
+  const char *tokens;
+
+  /// Number of threads of the recognizer. Streams passed to
+  /// SherpaNcnnDecodeMultipleOfflineStreams() are decoded this many at a
+  /// time. Default: 1
+  int32_t num_threads;
+
+  /// greedy_search or prefix_beam_search. Default: greedy_search
+  const char *decoding_method;
+
+  /// Used only for prefix_beam_search. Default: 4
+  int32_t max_active_paths;
+
+  /// Used only for prefix_beam_search. Optional.
+  const char *hotwords_file;
+
+  /// The score of each token of a hotword without a score. Default: 1.5
+  float hotwords_score;
+
+  /// If positive, streams longer than this many seconds are decoded in
+  /// overlapping chunks of this duration. Default: 0
+  float chunk_duration;
+
+  /// Overlap in seconds between neighboring chunks. Default: 2
+  float chunk_overlap;
+
+  /// If positive, features are padded to a multiple of this many seconds
+  /// to limit the number of input shapes of the model. Default: 0
+  float length_bucket;
+
+  /// Optional. Path to a profile written by sherpa-ncnn-autotune with
+  /// --sense-voice-model-dir
+  const char *perf_profile;
+} SherpaNcnnOfflineRecognizerConfig;
+
+SHERPA_NCNN_API typedef struct SherpaNcnnOfflineRecognizer
+    SherpaNcnnOfflineRecognizer;
+SHERPA_NCNN_API typedef struct SherpaNcnnOfflineStream
+    SherpaNcnnOfflineStream;
+
+/// @param config  Fields that are 0 or NULL take their default values.
+/// @return Return NULL if the config is invalid. Otherwise, the user has
+///         to invoke SherpaNcnnDestroyOfflineRecognizer() to free the
+///         returned pointer to avoid memory leak.
+SHERPA_NCNN_API SherpaNcnnOfflineRecognizer *SherpaNcnnCreateOfflineRecognizer(
+    const SherpaNcnnOfflineRecognizerConfig *config);
+
+/// All streams of the recognizer must be destroyed before it.
+SHERPA_NCNN_API void SherpaNcnnDestroyOfflineRecognizer(
+    SherpaNcnnOfflineRecognizer *p);
+
+/// Create a stream for one utterance. The user has to invoke
+/// SherpaNcnnDestroyOfflineStream() to free the returned pointer to avoid
+/// memory leak.
+///
+/// @param p A pointer returned by SherpaNcnnCreateOfflineRecognizer().
+SHERPA_NCNN_API SherpaNcnnOfflineStream *SherpaNcnnCreateOfflineStream(
+    const SherpaNcnnOfflineRecognizer *p);
+
+SHERPA_NCNN_API void SherpaNcnnDestroyOfflineStream(
+    SherpaNcnnOfflineStream *s);
+
+/// Accept samples normalized to [-1, 1]. It can be called many times as
+/// the audio arrives. They are resampled if sample_rate differs from that
+/// of the model.
+///
+/// @param s A pointer returned by SherpaNcnnCreateOfflineStream().
+SHERPA_NCNN_API void SherpaNcnnAcceptWaveformOffline(
+    SherpaNcnnOfflineStream *s, int32_t sample_rate, const float *samples,
+    int32_t n);
+
+/// Same as SherpaNcnnAcceptWaveformOffline() but for 16-bit PCM samples.
+SHERPA_NCNN_API void SherpaNcnnAcceptWaveformInt16Offline(
+    SherpaNcnnOfflineStream *s, int32_t sample_rate, const int16_t *samples,
+    int32_t n);
+
+/// Decode a stream after all of its samples are accepted.
+SHERPA_NCNN_API void SherpaNcnnDecodeOfflineStream(
+    const SherpaNcnnOfflineRecognizer *p, SherpaNcnnOfflineStream *s);
+
+/// Decode n streams together. It is faster than decoding them one by one,
+/// since the streams are batched and decoded num_threads at a time.
+///
+/// @param streams An array of n pointers returned by
+///                SherpaNcnnCreateOfflineStream().
+SHERPA_NCNN_API void SherpaNcnnDecodeMultipleOfflineStreams(
+    const SherpaNcnnOfflineRecognizer *p, SherpaNcnnOfflineStream **streams,
+    int32_t n);
+
+/// Return the result of a decoded stream. The user has to invoke
+/// DestroyResult() to free the returned pointer to avoid memory leak.
+SHERPA_NCNN_API SherpaNcnnResult *SherpaNcnnGetOfflineStreamResult(
+    const SherpaNcnnOfflineStream *s);
+
+/// Return the result of a decoded stream as JSON, including the language,
+/// emotion and event of SenseVoice. The user has to invoke
+/// SherpaNcnnDestroyOfflineStreamResultJson() to free the returned pointer
+/// to avoid memory leak.
+SHERPA_NCNN_API const char *SherpaNcnnGetOfflineStreamResultAsJson(
+    const SherpaNcnnOfflineStream *s);
+
+SHERPA_NCNN_API void SherpaNcnnDestroyOfflineStreamResultJson(
+    const char *json);
+
+// ============================================================
+// For text to speech
+// ============================================================
+
+SHERPA_NCNN_API typedef struct SherpaNcnnOfflineTtsVitsModelConfig {
+  /// Path to the directory containing config.json, lexicon.txt (or
+  /// lexicon.bin from sherpa-ncnn-compile-lexicon) and the ncnn files of
+  /// the encoder, dp, flow and decoder
+  const char *model_dir;
+
+  /// Optional. Path to a model bundle created by sherpa-ncnn-pack-model.
+  /// If given, model_dir is ignored.
+  const char *bundle;
+
+  /// Optional. If num_buffers is positive, the files of model_dir are
+  /// loaded from the buffers instead. The buffers are not copied and must
+  /// be kept alive until the TTS is destroyed.
+  const SherpaNcnnModelBuffer *buffers;
+  int32_t num_buffers;
+} SherpaNcnnOfflineTtsVitsModelConfig;
+
+SHERPA_NCNN_API typedef struct SherpaNcnnOfflineTtsConfig {
+  SherpaNcnnOfflineTtsVitsModelConfig vits;
+
+  /// Number of threads per sentence. Default: 1
+  int32_t num_threads;
+
+  /// Optional. Comma separated rule FSTs and FST archives
+  const char *rule_fsts;
+  const char *rule_fars;
+
+  /// Maximum number of sentences processed at a time. Default: 1
+  int32_t max_num_sentences;
+
+  /// If positive, at most this many calls of SherpaNcnnOfflineTtsGenerate()
+  /// from different threads are served at a time. Default: 0, no limit
+  int32_t max_concurrent_requests;
+
+  /// The duration of silences is scaled by it. Default: 1
+  float silence_scale;
+
+  /// Optional. Path to a profile with the options of "tts_encoder" and
+  /// "tts_decoder", see sherpa-ncnn/csrc/perf-profile.h
+  const char *perf_profile;
+
+  /// Number of threads that synthesize sentences in parallel, each with
+  /// num_threads threads. At most max_num_sentences sentences are
+  /// processed at a time. Default: 1
+  int32_t num_workers;
+} SherpaNcnnOfflineTtsConfig;
+
+SHERPA_NCNN_API typedef struct SherpaNcnnGeneratedAudio {
+  /// Samples normalized to [-1, 1]. It is NULL if the audio was passed to
+  /// the callback only.
+  const float *samples;
+  int32_t n;
+  int32_t sample_rate;
+} SherpaNcnnGeneratedAudio;
+
+/// It is called with the audio of each chunk, e.g., of each sentence, as
+/// soon as it is ready. samples is valid only during the call. processed
+/// and total are in sentences. Return 0 to stop; return 1 to continue.
+typedef int32_t (*SherpaNcnnGeneratedAudioCallback)(const float *samples,
+                                                    int32_t n,
+                                                    int32_t processed,
+                                                    int32_t total, void *arg);
+
+SHERPA_NCNN_API typedef struct SherpaNcnnOfflineTts SherpaNcnnOfflineTts;
+
+/// @param config  Fields that are 0 or NULL take their default values.
+/// @return Return NULL if the config is invalid. Otherwise, the user has
+///         to invoke SherpaNcnnDestroyOfflineTts() to free the returned
+///         pointer to avoid memory leak.
+SHERPA_NCNN_API SherpaNcnnOfflineTts *SherpaNcnnCreateOfflineTts(
+    const SherpaNcnnOfflineTtsConfig *config);
+
+SHERPA_NCNN_API void SherpaNcnnDestroyOfflineTts(SherpaNcnnOfflineTts *p);
+
+/// Return the sample rate of the generated audio.
+SHERPA_NCNN_API int32_t
+SherpaNcnnOfflineTtsSampleRate(const SherpaNcnnOfflineTts *p);
+
+/// Return the number of speakers. It is 0 or 1 for single-speaker models.
+SHERPA_NCNN_API int32_t
+SherpaNcnnOfflineTtsNumSpeakers(const SherpaNcnnOfflineTts *p);
+
+/// Convert text to speech. It is thread-safe.
+///
+/// @param p A pointer returned by SherpaNcnnCreateOfflineTts().
+/// @param text The text to synthesize.
+/// @param sid Speaker ID. Used only for multi-speaker models.
+/// @param speed E.g., 2 means 2x faster. 0 means 1.
+/// @param callback Optional. See SherpaNcnnGeneratedAudioCallback.
+/// @param arg It is passed to the callback.
+/// @param return_samples If 0, the audio is passed to the callback only
+///                       and not kept in memory, so the returned samples
+///                       are NULL.
+/// @return The user has to invoke SherpaNcnnDestroyOfflineTtsGeneratedAudio()
+///         to free the returned pointer to avoid memory leak.
+SHERPA_NCNN_API const SherpaNcnnGeneratedAudio *SherpaNcnnOfflineTtsGenerate(
+    const SherpaNcnnOfflineTts *p, const char *text, int32_t sid, float speed,
+    SherpaNcnnGeneratedAudioCallback callback, void *arg,
+    int32_t return_samples);
+
+SHERPA_NCNN_API void SherpaNcnnDestroyOfflineTtsGeneratedAudio(
+    const SherpaNcnnGeneratedAudio *p);
+
 /// Create a display object. Must be freed using DestroyDisplay to avoid
 /// memory leak.
 SHERPA_NCNN_API SherpaNcnnDisplay *CreateDisplay(int32_t max_word_per_line);
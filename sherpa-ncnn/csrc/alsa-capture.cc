@@ -0,0 +1,265 @@
+// sherpa-ncnn/csrc/alsa-capture.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifdef SHERPA_NCNN_ENABLE_ALSA
+
+#include "sherpa-ncnn/csrc/alsa-capture.h"
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstdlib>
+#include <sstream>
+
+#include "alsa/asoundlib.h"
+
+namespace sherpa_ncnn {
+
+std::string AlsaCaptureConfig::ToString() const {
+  std::ostringstream os;
+
+  os << "AlsaCaptureConfig(";
+  os << "sample_rate=" << sample_rate << ", ";
+  os << "num_channels=" << num_channels << ", ";
+  os << "buffer_seconds=" << buffer_seconds << ", ";
+  os << "period_seconds=" << period_seconds << ")";
+
+  return os.str();
+}
+
+AlsaCapture::AlsaCapture(const char *device_name,
+                         const AlsaCaptureConfig &config) {
+  int32_t err =
+      snd_pcm_open(&capture_handle_, device_name, SND_PCM_STREAM_CAPTURE, 0);
+  if (err) {
+    fprintf(stderr, "Unable to open: %s. %s\n", device_name, snd_strerror(err));
+    fprintf(stderr, "Please use arecord -l to list the devices\n");
+    exit(-1);
+  }
+
+  snd_pcm_hw_params_t *hw_params;
+  snd_pcm_hw_params_alloca(&hw_params);
+
+  err = snd_pcm_hw_params_any(capture_handle_, hw_params);
+  if (err < 0) {
+    fprintf(stderr, "Failed to initialize hw_params: %s\n", snd_strerror(err));
+    exit(-1);
+  }
+
+  err = snd_pcm_hw_params_set_access(capture_handle_, hw_params,
+                                     SND_PCM_ACCESS_MMAP_INTERLEAVED);
+  if (err < 0) {
+    fprintf(stderr,
+            "Failed to set access type to SND_PCM_ACCESS_MMAP_INTERLEAVED: "
+            "%s. Try a plughw: device\n",
+            snd_strerror(err));
+    exit(-1);
+  }
+
+  err = snd_pcm_hw_params_set_format(capture_handle_, hw_params,
+                                     SND_PCM_FORMAT_S16_LE);
+  if (err < 0) {
+    err = snd_pcm_hw_params_set_format(capture_handle_, hw_params,
+                                       SND_PCM_FORMAT_S32_LE);
+    if (err < 0) {
+      fprintf(stderr, "Failed to set format to S16_LE or S32_LE: %s\n",
+              snd_strerror(err));
+      exit(-1);
+    }
+    pcm_format_ = 32;
+  }
+
+  uint32_t num_channels = config.num_channels;
+  if (num_channels == 0) {
+    snd_pcm_hw_params_get_channels_max(hw_params, &num_channels);
+  }
+
+  err = snd_pcm_hw_params_set_channels(capture_handle_, hw_params,
+                                       num_channels);
+  if (err < 0) {
+    fprintf(stderr, "Failed to set number of channels to %d: %s\n",
+            static_cast<int32_t>(num_channels), snd_strerror(err));
+    exit(-1);
+  }
+  num_channels_ = num_channels;
+
+  uint32_t sample_rate = config.sample_rate;
+  int32_t dir = 0;
+  err = snd_pcm_hw_params_set_rate_near(capture_handle_, hw_params,
+                                        &sample_rate, &dir);
+  if (err < 0) {
+    fprintf(stderr, "Failed to set sample rate to %d: %s\n",
+            config.sample_rate, snd_strerror(err));
+    exit(-1);
+  }
+  sample_rate_ = sample_rate;
+
+  // A device buffer of several periods, so that the capture thread may be
+  // late by a few periods without an overrun
+  uint32_t period_us = config.period_seconds * 1e6;
+  snd_pcm_hw_params_set_period_time_near(capture_handle_, hw_params,
+                                         &period_us, &dir);
+
+  uint32_t buffer_us = std::max<uint32_t>(8 * period_us, 500000);
+  snd_pcm_hw_params_set_buffer_time_near(capture_handle_, hw_params,
+                                         &buffer_us, &dir);
+
+  err = snd_pcm_hw_params(capture_handle_, hw_params);
+  if (err < 0) {
+    fprintf(stderr, "Failed to set hw params: %s\n", snd_strerror(err));
+    exit(-1);
+  }
+
+  snd_pcm_uframes_t period_size = 0;
+  snd_pcm_hw_params_get_period_size(hw_params, &period_size, &dir);
+
+  snd_pcm_sw_params_t *sw_params;
+  snd_pcm_sw_params_alloca(&sw_params);
+  snd_pcm_sw_params_current(capture_handle_, sw_params);
+  snd_pcm_sw_params_set_avail_min(capture_handle_, sw_params, period_size);
+  err = snd_pcm_sw_params(capture_handle_, sw_params);
+  if (err < 0) {
+    fprintf(stderr, "Failed to set sw params: %s\n", snd_strerror(err));
+    exit(-1);
+  }
+
+  int32_t capacity = config.buffer_seconds * sample_rate_;
+  for (int32_t i = 0; i != num_channels_; ++i) {
+    rings_.push_back(std::make_unique<SpscRingBuffer>(capacity));
+  }
+
+  err = snd_pcm_prepare(capture_handle_);
+  if (err >= 0) {
+    err = snd_pcm_start(capture_handle_);
+  }
+  if (err < 0) {
+    fprintf(stderr, "Failed to start recording: %s\n", snd_strerror(err));
+    exit(-1);
+  }
+
+  fprintf(stderr,
+          "Recording %d channels at %d Hz with periods of %d frames\n",
+          num_channels_, sample_rate_, static_cast<int32_t>(period_size));
+
+  thread_ = std::thread([this]() { Run(); });
+}
+
+AlsaCapture::~AlsaCapture() {
+  stop_ = true;
+  thread_.join();
+
+  snd_pcm_close(capture_handle_);
+}
+
+int32_t AlsaCapture::Read(int32_t channel, float *samples, int32_t n) {
+  return rings_[channel]->Pop(samples, n);
+}
+
+void AlsaCapture::Wait(int32_t timeout_ms) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  int64_t n = num_periods_;
+  cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+               [this, n]() { return num_periods_ != n; });
+}
+
+void AlsaCapture::Run() {
+  while (!stop_) {
+    // It polls the device, so the thread sleeps until a period is ready
+    int32_t err = snd_pcm_wait(capture_handle_, 100);
+    if (err == 0) continue;
+
+    if (err < 0) {
+      if (!Recover(err)) return;
+      continue;
+    }
+
+    snd_pcm_sframes_t avail = snd_pcm_avail_update(capture_handle_);
+    if (avail < 0) {
+      if (!Recover(avail)) return;
+      continue;
+    }
+
+    while (avail > 0) {
+      const snd_pcm_channel_area_t *areas = nullptr;
+      snd_pcm_uframes_t offset = 0;
+      snd_pcm_uframes_t frames = avail;
+
+      err = snd_pcm_mmap_begin(capture_handle_, &areas, &offset, &frames);
+      if (err < 0) {
+        if (!Recover(err)) return;
+        break;
+      }
+
+      Deinterleave(areas, offset, frames);
+
+      snd_pcm_sframes_t committed =
+          snd_pcm_mmap_commit(capture_handle_, offset, frames);
+      if (committed < 0 ||
+          static_cast<snd_pcm_uframes_t>(committed) != frames) {
+        if (!Recover(committed < 0 ? committed : -EPIPE)) return;
+        break;
+      }
+
+      avail -= frames;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++num_periods_;
+    }
+    cv_.notify_all();
+  }
+}
+
+void AlsaCapture::Deinterleave(const snd_pcm_channel_area_t *areas,
+                               snd_pcm_uframes_t offset,
+                               snd_pcm_uframes_t frames) {
+  scratch_.resize(frames);
+
+  for (int32_t c = 0; c != num_channels_; ++c) {
+    const snd_pcm_channel_area_t &a = areas[c];
+
+    // first and step are in bits
+    const char *p = static_cast<const char *>(a.addr) +
+                    (a.first + offset * a.step) / 8;
+    int32_t step = a.step / 8;
+
+    if (pcm_format_ == 16) {
+      for (snd_pcm_uframes_t i = 0; i != frames; ++i, p += step) {
+        scratch_[i] = *reinterpret_cast<const int16_t *>(p) / 32768.0f;
+      }
+    } else {
+      for (snd_pcm_uframes_t i = 0; i != frames; ++i, p += step) {
+        scratch_[i] = *reinterpret_cast<const int32_t *>(p) /
+                      static_cast<float>(1u << 31);
+      }
+    }
+
+    int32_t n = rings_[c]->Push(scratch_.data(), frames);
+    num_dropped_ += frames - n;
+  }
+}
+
+bool AlsaCapture::Recover(int32_t err) {
+  if (err == -EPIPE) {
+    ++num_overruns_;
+    fprintf(stderr, "An overrun of the capture device occurred\n");
+  }
+
+  err = snd_pcm_recover(capture_handle_, err, 1);
+  if (err >= 0) {
+    err = snd_pcm_start(capture_handle_);
+  }
+
+  if (err < 0) {
+    fprintf(stderr, "Failed to recover the capture device: %s\n",
+            snd_strerror(err));
+    return false;
+  }
+
+  return true;
+}
+
+}  // namespace sherpa_ncnn
+
+#endif
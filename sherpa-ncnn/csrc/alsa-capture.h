@@ -0,0 +1,132 @@
+// sherpa-ncnn/csrc/alsa-capture.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_ALSA_CAPTURE_H_
+#define SHERPA_NCNN_CSRC_ALSA_CAPTURE_H_
+
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <cstdint>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "alsa/asoundlib.h"
+#include "sherpa-ncnn/csrc/spsc-ring-buffer.h"
+
+namespace sherpa_ncnn {
+
+struct AlsaCaptureConfig {
+  // The sample rate to ask the device for. See AlsaCapture::SampleRate()
+  // for the one it uses.
+  int32_t sample_rate = 16000;
+
+  // Number of channels to capture. 0 means all channels of the device.
+  int32_t num_channels = 1;
+
+  // Seconds of audio of each channel that are kept for the consumer. The
+  // capture thread drops samples only if the consumer falls behind by more.
+  float buffer_seconds = 30;
+
+  // The capture thread wakes up once per period of the device
+  float period_seconds = 0.02;
+
+  std::string ToString() const;
+};
+
+/** Capture audio from an ALSA device on a dedicated thread.
+ *
+ * Unlike Alsa, which reads with snd_pcm_readi() on the caller's thread,
+ * the capture thread waits for the device with poll(), copies each period
+ * directly out of the memory-mapped ring buffer of the device and
+ * deinterleaves it into one SpscRingBuffer per channel. Decoding that
+ * stalls for up to buffer_seconds therefore loses no samples, and the
+ * channels of a multi-channel device can be decoded as separate streams.
+ *
+ * Usage:
+ *
+ *   AlsaCapture capture("plughw:3,0", config);
+ *   std::vector<float> samples(capture.SampleRate());
+ *   while (true) {
+ *     capture.Wait(100);
+ *     for (int32_t c = 0; c != capture.NumChannels(); ++c) {
+ *       int32_t n = capture.Read(c, samples.data(), samples.size());
+ *       ss[c]->AcceptWaveform(capture.SampleRate(), samples.data(), n);
+ *     }
+ *   }
+ */
+class AlsaCapture {
+ public:
+  // It exits the program if the device cannot be opened or configured
+  AlsaCapture(const char *device_name, const AlsaCaptureConfig &config);
+  ~AlsaCapture();
+
+  AlsaCapture(const AlsaCapture &) = delete;
+  AlsaCapture &operator=(const AlsaCapture &) = delete;
+
+  int32_t NumChannels() const { return num_channels_; }
+
+  // The actual sample rate of the device. Stream::AcceptWaveform()
+  // resamples it if needed.
+  int32_t SampleRate() const { return sample_rate_; }
+
+  // Move at most n captured samples of a channel to samples and return
+  // their number. It does not block. Only one thread may read a channel.
+  int32_t Read(int32_t channel, float *samples, int32_t n);
+
+  // Number of samples of a channel that Read() can return
+  int32_t NumAvailable(int32_t channel) const {
+    return rings_[channel]->Size();
+  }
+
+  // Block until the next period is captured or timeout_ms has passed
+  void Wait(int32_t timeout_ms);
+
+  // Number of samples, summed over the channels, that were dropped because
+  // the consumer fell behind by more than buffer_seconds
+  int64_t NumDropped() const { return num_dropped_; }
+
+  // Number of overruns of the device, i.e., the capture thread itself was
+  // too late. Each loses the samples of at least one period.
+  int64_t NumOverruns() const { return num_overruns_; }
+
+ private:
+  void Run();
+
+  // Deinterleave frames of the mmap area into the rings
+  void Deinterleave(const snd_pcm_channel_area_t *areas,
+                    snd_pcm_uframes_t offset, snd_pcm_uframes_t frames);
+
+  // Recover from an error of the device and restart it. Return false if
+  // it cannot be recovered.
+  bool Recover(int32_t err);
+
+ private:
+  snd_pcm_t *capture_handle_ = nullptr;
+  int32_t sample_rate_ = 0;
+  int32_t num_channels_ = 0;
+
+  // It can only be 16 or 32
+  int32_t pcm_format_ = 16;
+
+  std::vector<std::unique_ptr<SpscRingBuffer>> rings_;
+  std::vector<float> scratch_;  // used only by the capture thread
+
+  std::atomic<int64_t> num_dropped_{0};
+  std::atomic<int64_t> num_overruns_{0};
+
+  // For Wait() only; the samples do not pass through it
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  int64_t num_periods_ = 0;
+
+  std::atomic<bool> stop_{false};
+  std::thread thread_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_ALSA_CAPTURE_H_
@@ -0,0 +1,52 @@
+// sherpa-ncnn/csrc/audio-capture-queue.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/audio-capture-queue.h"
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+
+namespace sherpa_ncnn {
+
+// The longest time Wait() sleeps without checking the ring again. It bounds
+// the delay of the rare wakeup that Push() misses, see below.
+static constexpr std::chrono::milliseconds kMaxWaitSlice{5};
+
+int32_t AudioCaptureQueue::Push(const float *samples, int32_t n) {
+  int32_t k = ring_.Push(samples, n);
+  if (k < n) {
+    num_dropped_.fetch_add(n - k, std::memory_order_relaxed);
+  }
+
+  // The producer must not block on the mutex. If try_lock() succeeds, the
+  // consumer is either sleeping in wait_for() or has not yet checked the
+  // ring, so the notification below is not lost. Otherwise it may be
+  // lost, and the consumer sees the samples after at most kMaxWaitSlice.
+  if (mutex_.try_lock()) {
+    mutex_.unlock();
+  }
+  cv_.notify_one();
+
+  return k;
+}
+
+bool AudioCaptureQueue::Wait(int32_t min_samples, int32_t timeout_ms) {
+  using Clock = std::chrono::steady_clock;
+  auto deadline = Clock::now() + std::chrono::milliseconds(timeout_ms);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (ring_.Size() < min_samples) {
+    auto now = Clock::now();
+    if (now >= deadline) {
+      return false;
+    }
+
+    cv_.wait_for(lock, std::min<Clock::duration>(deadline - now,
+                                                 kMaxWaitSlice));
+  }
+
+  return true;
+}
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,81 @@
+// sherpa-ncnn/csrc/audio-capture-queue.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_AUDIO_CAPTURE_QUEUE_H_
+#define SHERPA_NCNN_CSRC_AUDIO_CAPTURE_QUEUE_H_
+
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <cstdint>
+#include <mutex>  // NOLINT
+
+#include "sherpa-ncnn/csrc/spsc-ring-buffer.h"
+
+namespace sherpa_ncnn {
+
+/** Pass samples from an audio callback to the thread that decodes them.
+ *
+ * The callback of PortAudio runs on a real-time thread that must not
+ * block, allocate or do heavy work. Push() only copies the samples into
+ * a SpscRingBuffer and wakes up the consumer; feature extraction and
+ * decoding happen on the thread that calls Wait() and Pop(), which wakes
+ * up as soon as samples arrive instead of polling with Pa_Sleep().
+ *
+ * There must be one producer thread and one consumer thread.
+ *
+ * Usage:
+ *
+ *   AudioCaptureQueue queue(30 * 16000);
+ *
+ *   // in the audio callback
+ *   queue.Push(samples, n);
+ *
+ *   // in the main loop
+ *   std::vector<float> buf(16000);
+ *   while (!stop) {
+ *     queue.Wait(1, 100);
+ *     int32_t n = queue.Pop(buf.data(), buf.size());
+ *     s->AcceptWaveform(16000, buf.data(), n);
+ *   }
+ */
+class AudioCaptureQueue {
+ public:
+  // capacity is in samples and is rounded up to a power of two
+  explicit AudioCaptureQueue(int32_t capacity) : ring_(capacity) {}
+
+  AudioCaptureQueue(const AudioCaptureQueue &) = delete;
+  AudioCaptureQueue &operator=(const AudioCaptureQueue &) = delete;
+
+  // For the producer. It never blocks. Samples that do not fit are dropped
+  // and counted in NumDropped(). Return the number of samples stored.
+  int32_t Push(const float *samples, int32_t n);
+
+  // For the consumer. Move at most n samples to samples and return their
+  // number. It does not block.
+  int32_t Pop(float *samples, int32_t n) { return ring_.Pop(samples, n); }
+
+  // For the consumer. Block until at least min_samples samples are
+  // available or timeout_ms has passed. Return true in the former case.
+  bool Wait(int32_t min_samples, int32_t timeout_ms);
+
+  int32_t Size() const { return ring_.Size(); }
+
+  int32_t Capacity() const { return ring_.Capacity(); }
+
+  // Number of samples dropped because the consumer fell behind by more
+  // than Capacity() samples
+  int64_t NumDropped() const { return num_dropped_; }
+
+ private:
+  SpscRingBuffer ring_;
+  std::atomic<int64_t> num_dropped_{0};
+
+  // For Wait() only; the samples do not pass through it
+  std::mutex mutex_;
+  std::condition_variable cv_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_AUDIO_CAPTURE_QUEUE_H_
@@ -0,0 +1,351 @@
+// sherpa-ncnn/csrc/autotune.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/autotune.h"
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "cpu.h"  // NOLINT
+#include "gpu.h"  // NOLINT
+
+#ifndef SHERPA_NCNN_DISABLE_SENSE_VOICE
+#include "sherpa-ncnn/csrc/offline-sense-voice-model.h"
+#endif
+
+namespace sherpa_ncnn {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// A candidate replaces the best options of a network only if it is faster
+// by this fraction, so that noise does not switch them
+constexpr double kMinGain = 0.05;
+
+/* Load a model with tunings[i] for its i-th network, run it and set
+ * ms[i] to the mean time of the i-th network and outputs[i] to its
+ * output. Return false if the model cannot be loaded.
+ */
+using NetRunner = std::function<bool(const std::vector<NetTuning> &tunings,
+                                     std::vector<double> *ms,
+                                     std::vector<std::vector<float>> *outputs)>;
+
+std::vector<float> ToVector(const ncnn::Mat &m) {
+  std::vector<float> ans;
+  int32_t n = m.w * m.h * m.d;
+  for (int32_t q = 0; q != m.c; ++q) {
+    const float *p = m.channel(q);
+    ans.insert(ans.end(), p, p + n);
+  }
+
+  return ans;
+}
+
+// Largest absolute difference, relative to the largest absolute value of
+// reference
+float RelativeError(const std::vector<float> &reference,
+                    const std::vector<float> &v) {
+  if (v.size() != reference.size()) {
+    return std::numeric_limits<float>::infinity();
+  }
+
+  float max_value = 0;
+  float max_diff = 0;
+  for (std::size_t i = 0; i != v.size(); ++i) {
+    max_value = std::max(max_value, std::abs(reference[i]));
+    max_diff = std::max(max_diff, std::abs(v[i] - reference[i]));
+  }
+
+  // NaN fails the comparison with max_error
+  if (std::isnan(max_diff) || (max_diff > 0 && max_value == 0)) {
+    return std::numeric_limits<float>::infinity();
+  }
+
+  return max_value > 0 ? max_diff / max_value : 0;
+}
+
+// Features in the range of log mel filterbank energies
+ncnn::Mat MakeFeatures(int32_t dim, int32_t num_frames) {
+  ncnn::Mat ans(dim, num_frames);
+  for (int32_t t = 0; t != num_frames; ++t) {
+    float *p = ans.row(t);
+    for (int32_t d = 0; d != dim; ++d) {
+      p[d] = -5 + 4 * std::sin(0.37f * t + 0.11f * d) + (t % 3);
+    }
+  }
+
+  return ans;
+}
+
+std::vector<int32_t> ThreadCandidates(const AutoTuneConfig &config) {
+  int32_t max_threads = config.max_threads > 0 ? config.max_threads
+                                               : ncnn::get_big_cpu_count();
+  max_threads = std::max(max_threads, 1);
+
+  std::vector<int32_t> ans;
+  for (int32_t n = 1; n < max_threads; n *= 2) {
+    ans.push_back(n);
+  }
+  ans.push_back(max_threads);
+
+  return ans;
+}
+
+bool HasGpu() {
+#if NCNN_VULKAN
+  return ncnn::get_gpu_count() > 0;
+#else
+  return false;
+#endif
+}
+
+/* Find the fastest valid tuning of each network, see AutoTune(). start
+ * is the tuning of the reference, in fp32 on the CPU.
+ */
+PerfProfile Search(const std::vector<std::string> &names,
+                   const NetTuning &start, bool tune_convolution,
+                   const NetRunner &run, const AutoTuneConfig &config) {
+  int32_t n = static_cast<int32_t>(names.size());
+
+  std::vector<NetTuning> best(n, start);
+  std::vector<double> best_ms;
+  std::vector<std::vector<float>> reference;
+  if (!run(best, &best_ms, &reference)) {
+    NCNN_LOGE("Failed to load the model");
+    return {};
+  }
+
+  auto report = [&](const std::vector<NetTuning> &tunings,
+                    const std::vector<double> &ms,
+                    const std::vector<float> &errors) {
+    if (!config.debug) return;
+
+    for (int32_t i = 0; i != n; ++i) {
+      NCNN_LOGE("%s %s: %.3f ms, error %.5f", names[i].c_str(),
+                tunings[i].ToString().c_str(), ms[i], errors[i]);
+    }
+  };
+
+  report(best, best_ms, std::vector<float>(n, 0));
+
+  auto try_candidate = [&](const std::function<void(NetTuning *)> &change) {
+    std::vector<NetTuning> tunings = best;
+    bool changed = false;
+    for (auto &t : tunings) {
+      std::string before = t.ToString();
+      change(&t);
+      changed = changed || t.ToString() != before;
+    }
+
+    if (!changed) return;
+
+    std::vector<double> ms;
+    std::vector<std::vector<float>> outputs;
+    if (!run(tunings, &ms, &outputs)) {
+      NCNN_LOGE("Failed to load the model with %s. Skip it",
+                tunings[0].ToString().c_str());
+      return;
+    }
+
+    std::vector<float> errors(n);
+    for (int32_t i = 0; i != n; ++i) {
+      errors[i] = RelativeError(reference[i], outputs[i]);
+      if (errors[i] <= config.max_error &&
+          ms[i] < best_ms[i] * (1 - kMinGain)) {
+        best[i] = tunings[i];
+        best_ms[i] = ms[i];
+      }
+    }
+
+    report(tunings, ms, errors);
+  };
+
+  std::vector<std::string> devices = {"cpu"};
+  if (config.use_gpu && HasGpu()) {
+    devices.push_back("gpu");
+  }
+
+  for (const auto &device : devices) {
+    for (const char *precision : {"accuracy", "balanced", "speed"}) {
+      try_candidate([&](NetTuning *t) {
+        t->device = device;
+        t->precision = precision;
+      });
+    }
+  }
+
+  for (int32_t num_threads : ThreadCandidates(config)) {
+    try_candidate([num_threads](NetTuning *t) {
+      t->num_threads = num_threads;
+    });
+  }
+
+  if (tune_convolution) {
+    for (int32_t k = 0; k != 3; ++k) {
+      // (winograd, sgemm) = (0, 1), (1, 0) and (0, 0)
+      try_candidate([k](NetTuning *t) {
+        t->use_winograd_convolution = k == 1;
+        t->use_sgemm_convolution = k == 0;
+      });
+    }
+  }
+
+  PerfProfile profile;
+  profile.SetFingerprint(PerfProfile::DeviceFingerprint());
+  for (int32_t i = 0; i != n; ++i) {
+    profile.Set(names[i], best[i]);
+    NCNN_LOGE("%s: %s, %.3f ms", names[i].c_str(), best[i].ToString().c_str(),
+              best_ms[i]);
+  }
+
+  return profile;
+}
+
+}  // namespace
+
+std::string AutoTuneConfig::ToString() const {
+  std::ostringstream os;
+
+  os << "AutoTuneConfig(";
+  os << "num_runs=" << num_runs << ", ";
+  os << "max_threads=" << max_threads << ", ";
+  os << "use_gpu=" << (use_gpu ? "True" : "False") << ", ";
+  os << "max_error=" << max_error << ", ";
+  os << "debug=" << (debug ? "True" : "False") << ")";
+
+  return os.str();
+}
+
+PerfProfile AutoTune(const ModelConfig &config,
+                     const AutoTuneConfig &tune_config) {
+  const std::vector<std::string> names = {"encoder", "decoder", "joiner"};
+
+  auto run = [&](const std::vector<NetTuning> &tunings,
+                 std::vector<double> *ms,
+                 std::vector<std::vector<float>> *outputs) {
+    ModelConfig c = config;
+    c.perf_profile.clear();
+    c.remote_encoder.clear();
+
+    PerfProfile profile;
+    for (std::size_t i = 0; i != names.size(); ++i) {
+      profile.Set(names[i], tunings[i]);
+      if (tunings[i].device == "gpu") {
+        c.use_vulkan_compute = true;
+      }
+    }
+    Model::ApplyPerfProfile(profile, &c);
+
+    auto model = Model::Create(c);
+    if (!model) {
+      return false;
+    }
+
+    // The feature dim of all our models. See FeatureExtractorConfig
+    ncnn::Mat features = MakeFeatures(80, model->Segment());
+
+    ncnn::Mat decoder_input(model->ContextSize());
+    for (int32_t i = 0; i != model->ContextSize(); ++i) {
+      static_cast<int32_t *>(decoder_input)[i] = model->BlankId();
+    }
+
+    ms->assign(3, 0);
+
+    ncnn::Mat out[3];
+    for (int32_t r = 0; r <= tune_config.num_runs; ++r) {
+      std::vector<ncnn::Mat> states = model->GetEncoderInitStates();
+
+      auto t0 = Clock::now();
+      out[0] = model->RunEncoder(features, states).first;
+
+      auto t1 = Clock::now();
+      out[1] = model->RunDecoder(decoder_input);
+
+      auto t2 = Clock::now();
+      ncnn::Mat encoder_out_t(out[0].w, out[0].row(0));
+      out[2] = model->RunJoiner(encoder_out_t, out[1]);
+
+      auto t3 = Clock::now();
+
+      // The first run is not timed
+      if (r == 0) continue;
+
+      (*ms)[0] += std::chrono::duration<double, std::milli>(t1 - t0).count();
+      (*ms)[1] += std::chrono::duration<double, std::milli>(t2 - t1).count();
+      (*ms)[2] += std::chrono::duration<double, std::milli>(t3 - t2).count();
+    }
+
+    outputs->clear();
+    for (int32_t i = 0; i != 3; ++i) {
+      (*ms)[i] /= std::max(tune_config.num_runs, 1);
+      outputs->push_back(ToVector(out[i]));
+    }
+
+    return true;
+  };
+
+  NetTuning start;
+  start.num_threads = std::max(config.encoder_opt.num_threads, 1);
+
+  return Search(names, start, true, run, tune_config);
+}
+
+#ifndef SHERPA_NCNN_DISABLE_SENSE_VOICE
+PerfProfile AutoTune(const OfflineModelConfig &config,
+                     const AutoTuneConfig &tune_config) {
+  auto run = [&](const std::vector<NetTuning> &tunings,
+                 std::vector<double> *ms,
+                 std::vector<std::vector<float>> *outputs) {
+    // The model takes the options from the config, so the convolution
+    // options are not tuned
+    OfflineModelConfig c = config;
+    c.perf_profile.clear();
+    c.device = tunings[0].device;
+    c.precision = tunings[0].precision;
+    c.num_threads = tunings[0].num_threads;
+
+    OfflineSenseVoiceModel model(c);
+    const auto &meta = model.GetModelMetadata();
+
+    // 2 seconds of LFR features of 80-dim fbank
+    ncnn::Mat features = MakeFeatures(80 * meta.window_size, 33);
+
+    auto it = meta.lang2id.find("auto");
+    int32_t language = it != meta.lang2id.end() ? it->second : 0;
+
+    ms->assign(1, 0);
+
+    ncnn::Mat logits;
+    for (int32_t r = 0; r <= tune_config.num_runs; ++r) {
+      auto start = Clock::now();
+      logits = model.Forward(features, language, meta.without_itn_id);
+      auto end = Clock::now();
+
+      if (r > 0) {
+        (*ms)[0] += std::chrono::duration<double, std::milli>(end - start)
+                        .count();
+      }
+    }
+
+    (*ms)[0] /= std::max(tune_config.num_runs, 1);
+    *outputs = {ToVector(logits)};
+
+    return true;
+  };
+
+  NetTuning start;
+  start.num_threads = std::max(config.num_threads, 1);
+
+  return Search({"sense_voice"}, start, false, run, tune_config);
+}
+#endif
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,70 @@
+// sherpa-ncnn/csrc/autotune.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_AUTOTUNE_H_
+#define SHERPA_NCNN_CSRC_AUTOTUNE_H_
+
+#include <cstdint>
+#include <string>
+
+#include "sherpa-ncnn/csrc/model.h"
+#include "sherpa-ncnn/csrc/perf-profile.h"
+
+#ifndef SHERPA_NCNN_DISABLE_SENSE_VOICE
+#include "sherpa-ncnn/csrc/offline-model-config.h"
+#endif
+
+namespace sherpa_ncnn {
+
+struct AutoTuneConfig {
+  // Number of timed runs of each candidate, after a run that is not timed
+  int32_t num_runs = 10;
+
+  // Largest number of threads to try. If not positive, the number of big
+  // CPU cores.
+  int32_t max_threads = 0;
+
+  // Try the GPU as well if there is one
+  bool use_gpu = true;
+
+  // A candidate is used for a network only if its outputs differ from
+  // those of fp32 on the CPU by at most this, relative to the largest
+  // absolute value of them. It rules out, e.g., fp16 arithmetic for models
+  // that overflow in fp16.
+  float max_error = 0.05;
+
+  // true to print the time and the error of each candidate
+  bool debug = false;
+
+  std::string ToString() const;
+};
+
+/** Find the fastest options of the encoder, decoder and joiner of a
+ * streaming model on this device, see PerfProfile and
+ * ModelConfig::perf_profile.
+ *
+ * The candidates are tried in rounds, each starting from the fastest
+ * options of each network so far: the device and the precision, then the
+ * number of threads and then the convolution algorithms. For each
+ * candidate, the model is loaded and the networks are run on a chunk of
+ * fixed features. It takes a while and should be done once per device,
+ * e.g., at the first start of an app.
+ *
+ * @return Return an empty profile if the model cannot be loaded.
+ */
+PerfProfile AutoTune(const ModelConfig &config,
+                     const AutoTuneConfig &tune_config);
+
+#ifndef SHERPA_NCNN_DISABLE_SENSE_VOICE
+/** The same for "sense_voice" of a SenseVoice model, on an utterance of
+ * fixed features. The convolution algorithms are not tuned, since the
+ * model has few convolutions.
+ */
+PerfProfile AutoTune(const OfflineModelConfig &config,
+                     const AutoTuneConfig &tune_config);
+#endif
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_AUTOTUNE_H_
@@ -0,0 +1,351 @@
+// sherpa-ncnn/csrc/batch-fbank.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/batch-fbank.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+#if SHERPA_NCNN_ENABLE_ACCELERATE
+#include <Accelerate/Accelerate.h>
+#endif
+
+#include "platform.h"  // NOLINT
+#include "sherpa-ncnn/csrc/vulkan-fbank.h"
+
+namespace sherpa_ncnn {
+
+static float MelScale(float freq) {
+  return 1127.0f * logf(1.0f + freq / 700.0f);
+}
+
+BatchFbank::BatchFbank(const knf::FbankOptions &opts, bool use_vulkan)
+    : opts_(opts), window_function_(opts.frame_opts) {
+  if (opts_.use_energy || opts_.htk_compat || !opts_.use_power ||
+      !opts_.use_log_fbank || opts_.mel_opts.htk_mode ||
+      opts_.mel_opts.is_librosa) {
+    NCNN_LOGE("BatchFbank supports only the options used by "
+              "FeatureExtractor. Given:\n%s",
+              opts_.ToString().c_str());
+    exit(-1);
+  }
+
+  padded_window_size_ = opts_.frame_opts.PaddedWindowSize();
+  if (padded_window_size_ < 4 ||
+      (padded_window_size_ & (padded_window_size_ - 1)) != 0) {
+    NCNN_LOGE("BatchFbank requires a power-of-two window size. Given: %d",
+              padded_window_size_);
+    exit(-1);
+  }
+
+  num_bins_ = opts_.mel_opts.num_bins;
+  half_size_ = padded_window_size_ / 2;
+
+  int32_t num_bits = 0;
+  while ((1 << num_bits) < half_size_) ++num_bits;
+
+  bit_reverse_.resize(half_size_);
+  for (int32_t i = 0; i != half_size_; ++i) {
+    int32_t r = 0;
+    for (int32_t b = 0; b != num_bits; ++b) {
+      r |= ((i >> b) & 1) << (num_bits - 1 - b);
+    }
+    bit_reverse_[i] = r;
+  }
+
+  twiddle_re_.resize(half_size_ / 2);
+  twiddle_im_.resize(half_size_ / 2);
+  for (int32_t k = 0; k != half_size_ / 2; ++k) {
+    double a = -2 * M_PI * k / half_size_;
+    twiddle_re_[k] = std::cos(a);
+    twiddle_im_[k] = std::sin(a);
+  }
+
+  split_re_.resize(half_size_);
+  split_im_.resize(half_size_);
+  for (int32_t k = 0; k != half_size_; ++k) {
+    double a = -2 * M_PI * k / padded_window_size_;
+    split_re_[k] = std::cos(a);
+    split_im_[k] = std::sin(a);
+  }
+
+  // The same triangular filters as knf::MelBanks. Only the first
+  // half_size_ bins of the power spectrum are used.
+  float sample_freq = opts_.frame_opts.samp_freq;
+  float nyquist = 0.5f * sample_freq;
+  float low_freq = opts_.mel_opts.low_freq;
+  float high_freq = opts_.mel_opts.high_freq > 0.0f
+                        ? opts_.mel_opts.high_freq
+                        : nyquist + opts_.mel_opts.high_freq;
+
+  if (low_freq < 0.0f || low_freq >= nyquist || high_freq <= 0.0f ||
+      high_freq > nyquist || high_freq <= low_freq) {
+    NCNN_LOGE("Bad values in options: low-freq %f and high-freq %f vs. "
+              "nyquist %f",
+              low_freq, high_freq, nyquist);
+    exit(-1);
+  }
+
+  float fft_bin_width = sample_freq / padded_window_size_;
+  float mel_low_freq = MelScale(low_freq);
+  float mel_high_freq = MelScale(high_freq);
+  float mel_freq_delta = (mel_high_freq - mel_low_freq) / (num_bins_ + 1);
+
+  mel_offset_.resize(num_bins_);
+  mel_begin_.resize(num_bins_ + 1);
+  for (int32_t bin = 0; bin != num_bins_; ++bin) {
+    float left_mel = mel_low_freq + bin * mel_freq_delta;
+    float center_mel = mel_low_freq + (bin + 1) * mel_freq_delta;
+    float right_mel = mel_low_freq + (bin + 2) * mel_freq_delta;
+
+    int32_t first_index = -1;
+    int32_t last_index = -1;
+    std::vector<float> weights(half_size_);
+    for (int32_t i = 0; i != half_size_; ++i) {
+      float mel = MelScale(fft_bin_width * i);
+      if (mel > left_mel && mel < right_mel) {
+        if (mel <= center_mel) {
+          weights[i] = (mel - left_mel) / (center_mel - left_mel);
+        } else {
+          weights[i] = (right_mel - mel) / (right_mel - center_mel);
+        }
+
+        if (first_index == -1) first_index = i;
+        last_index = i;
+      }
+    }
+
+    mel_begin_[bin] = mel_weights_.size();
+    if (first_index == -1) {
+      NCNN_LOGE("You may have set num_mel_bins too large.");
+      exit(-1);
+    }
+
+    mel_offset_[bin] = first_index;
+    mel_weights_.insert(mel_weights_.end(), weights.begin() + first_index,
+                        weights.begin() + last_index + 1);
+  }
+  mel_begin_[num_bins_] = mel_weights_.size();
+
+#if SHERPA_NCNN_ENABLE_ACCELERATE
+  mel_matrix_.resize(half_size_ * num_bins_);
+  for (int32_t bin = 0; bin != num_bins_; ++bin) {
+    for (int32_t i = mel_begin_[bin]; i != mel_begin_[bin + 1]; ++i) {
+      int32_t k = mel_offset_[bin] + i - mel_begin_[bin];
+      mel_matrix_[k * num_bins_ + bin] = mel_weights_[i];
+    }
+  }
+
+  log2_size_ = num_bits + 1;
+  fft_setup_ = vDSP_create_fftsetup(log2_size_, kFFTRadix2);
+  if (!fft_setup_) {
+    NCNN_LOGE("Failed to create the vDSP FFT of %d points",
+              padded_window_size_);
+    exit(-1);
+  }
+#endif
+
+#if NCNN_VULKAN
+  if (use_vulkan) {
+    vulkan_ = VulkanFbank::Get(*this);
+  }
+#else
+  (void)use_vulkan;
+#endif
+}
+
+BatchFbank::~BatchFbank() {
+#if SHERPA_NCNN_ENABLE_ACCELERATE
+  vDSP_destroy_fftsetup(fft_setup_);
+#endif
+}
+
+void BatchFbank::ExtractWindow(int64_t sample_offset,
+                               const std::vector<float> &wave, int32_t frame,
+                               std::vector<float> *window) const {
+  window->assign(padded_window_size_, 0);
+  knf::ExtractWindow(sample_offset, wave, frame, opts_.frame_opts,
+                     window_function_, window);
+}
+
+void BatchFbank::Compute(const float *windows, int32_t num_frames,
+                         float *features) const {
+#if NCNN_VULKAN
+  if (vulkan_ && num_frames >= kMinVulkanFrames) {
+    vulkan_->Compute(windows, num_frames, features);
+    return;
+  }
+#endif
+
+  std::vector<float> re(half_size_ * kTileSize);
+  std::vector<float> im(half_size_ * kTileSize);
+
+#if SHERPA_NCNN_ENABLE_ACCELERATE
+  std::vector<float> power(half_size_ * kTileSize);
+  for (int32_t i = 0; i < num_frames; i += kTileSize) {
+    int32_t n = std::min(kTileSize, num_frames - i);
+    ComputeTileAccelerate(windows + i * padded_window_size_, n, re.data(),
+                          im.data(), power.data(), features + i * num_bins_);
+  }
+#else
+  for (int32_t i = 0; i < num_frames; i += kTileSize) {
+    int32_t n = std::min(kTileSize, num_frames - i);
+    ComputeTile(windows + i * padded_window_size_, n, re.data(), im.data(),
+                features + i * num_bins_);
+  }
+#endif
+}
+
+void BatchFbank::ComputeTile(const float *windows, int32_t num_frames,
+                             float *re, float *im, float *features) const {
+  constexpr int32_t T = kTileSize;
+  int32_t M = half_size_;
+
+  // Pack x[2m] + i x[2m+1] of every frame into lane t of complex element
+  // m, in bit-reversed order. Unused lanes are zero.
+  if (num_frames < T) {
+    std::fill(re, re + M * T, 0);
+    std::fill(im, im + M * T, 0);
+  }
+
+  for (int32_t t = 0; t != num_frames; ++t) {
+    const float *x = windows + t * padded_window_size_;
+    for (int32_t m = 0; m != M; ++m) {
+      int32_t r = bit_reverse_[m] * T + t;
+      re[r] = x[2 * m];
+      im[r] = x[2 * m + 1];
+    }
+  }
+
+  // Iterative radix-2 decimation-in-time FFT of M points. The innermost
+  // loop runs over the T frames of a tile.
+  for (int32_t len = 2; len <= M; len *= 2) {
+    int32_t half = len / 2;
+    int32_t step = M / len;
+    for (int32_t start = 0; start < M; start += len) {
+      for (int32_t j = 0; j != half; ++j) {
+        float wr = twiddle_re_[j * step];
+        float wi = twiddle_im_[j * step];
+
+        float *ar = re + (start + j) * T;
+        float *ai = im + (start + j) * T;
+        float *br = re + (start + j + half) * T;
+        float *bi = im + (start + j + half) * T;
+
+        for (int32_t t = 0; t != T; ++t) {
+          float tr = br[t] * wr - bi[t] * wi;
+          float ti = br[t] * wi + bi[t] * wr;
+          br[t] = ar[t] - tr;
+          bi[t] = ai[t] - ti;
+          ar[t] += tr;
+          ai[t] += ti;
+        }
+      }
+    }
+  }
+
+  // Split the M-point complex spectrum Z into the spectrum X of the real
+  // input and store |X[k]|^2 in re[k]:
+  //
+  //   X[k] = (Z[k] + conj(Z[M-k])) / 2 - i W^k (Z[k] - conj(Z[M-k])) / 2
+  //
+  // with W = exp(-2 pi i / (2M)). X[k] and X[M-k] depend on the same pair
+  // of inputs, so they are computed together and the result overwrites
+  // the input in place.
+  for (int32_t t = 0; t != T; ++t) {
+    float x0 = re[t] + im[t];
+    re[t] = x0 * x0;
+  }
+
+  for (int32_t k = 1; k <= M / 2; ++k) {
+    float *ar = re + k * T;
+    float *ai = im + k * T;
+    float *br = re + (M - k) * T;
+    float *bi = im + (M - k) * T;
+
+    float wr = split_re_[k];
+    float wi = split_im_[k];
+    // W^(M-k) = -conj(W^k)
+    float vr = -wr;
+    float vi = wi;
+
+    for (int32_t t = 0; t != T; ++t) {
+      // X[k] from a = Z[k], b = Z[M-k]
+      float er = 0.5f * (ar[t] + br[t]);
+      float ei = 0.5f * (ai[t] - bi[t]);
+      float or_ = 0.5f * (ai[t] + bi[t]);
+      float oi = -0.5f * (ar[t] - br[t]);
+
+      float xr = er + wr * or_ - wi * oi;
+      float xi = ei + wr * oi + wi * or_;
+
+      // X[M-k] from a = Z[M-k], b = Z[k]: the even part is conj(E) and
+      // the odd part is conj(O)
+      float yr = er + vr * or_ + vi * oi;
+      float yi = -ei - vr * oi + vi * or_;
+
+      ar[t] = xr * xr + xi * xi;
+      br[t] = yr * yr + yi * yi;
+    }
+  }
+
+  // Mel projection of the whole tile, then log
+  float mel[T];
+  const float kEps = std::numeric_limits<float>::epsilon();
+  for (int32_t bin = 0; bin != num_bins_; ++bin) {
+    std::fill(mel, mel + T, 0);
+
+    const float *p = re + mel_offset_[bin] * T;
+    for (int32_t i = mel_begin_[bin]; i != mel_begin_[bin + 1]; ++i, p += T) {
+      float w = mel_weights_[i];
+      for (int32_t t = 0; t != T; ++t) {
+        mel[t] += w * p[t];
+      }
+    }
+
+    for (int32_t t = 0; t != num_frames; ++t) {
+      features[t * num_bins_ + bin] = logf(std::max(mel[t], kEps));
+    }
+  }
+}
+
+#if SHERPA_NCNN_ENABLE_ACCELERATE
+void BatchFbank::ComputeTileAccelerate(const float *windows,
+                                       int32_t num_frames, float *re,
+                                       float *im, float *power,
+                                       float *features) const {
+  int32_t M = half_size_;
+  DSPSplitComplex z = {re, im};
+
+  for (int32_t t = 0; t != num_frames; ++t) {
+    // Pack x[2m] + i x[2m+1] into z[m]. vDSP_fft_zrip() returns 2 X[k]
+    // for 0 < k < M, with 2 X[0] and 2 X[M], both real, in re[0] and
+    // im[0].
+    vDSP_ctoz(reinterpret_cast<const DSPComplex *>(
+                  windows + t * padded_window_size_),
+              2, &z, 1, M);
+    vDSP_fft_zrip(fft_setup_, &z, 1, log2_size_, kFFTDirection_Forward);
+
+    float dc = re[0];
+    vDSP_zvmags(&z, 1, power + t * M, 1, M);
+    power[t * M] = dc * dc;
+  }
+
+  // (num_frames, M) x (M, num_bins_). The factor 1/4 undoes the scaling
+  // of the FFT above.
+  int32_t n = num_frames * num_bins_;
+  vDSP_mmul(power, 1, mel_matrix_.data(), 1, features, 1, num_frames,
+            num_bins_, M);
+
+  const float kQuarter = 0.25f;
+  const float kEps = std::numeric_limits<float>::epsilon();
+  vDSP_vsmul(features, 1, &kQuarter, features, 1, n);
+  vDSP_vthr(features, 1, &kEps, features, 1, n);
+  vvlogf(features, features, &n);
+}
+#endif
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,147 @@
+// sherpa-ncnn/csrc/batch-fbank.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_BATCH_FBANK_H_
+#define SHERPA_NCNN_CSRC_BATCH_FBANK_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "kaldi-native-fbank/csrc/online-feature.h"
+#include "platform.h"  // NOLINT
+
+#if SHERPA_NCNN_ENABLE_ACCELERATE
+// See <Accelerate/Accelerate.h>
+struct OpaqueFFTSetup;
+#endif
+
+namespace sherpa_ncnn {
+
+class VulkanFbank;
+
+/** Compute log-mel filterbank features of many frames at once.
+ *
+ * It produces the same features as knf::FbankComputer for the options
+ * used by FeatureExtractor (no energy, log power mel, non-HTK mel banks),
+ * up to floating point rounding.
+ *
+ * Frames are processed in tiles of kTileSize. Within a tile the FFT
+ * works on a structure-of-arrays layout, so every butterfly updates
+ * kTileSize frames with contiguous loads and stores and the compiler
+ * vectorizes it. The mel projection of a tile then runs as one banded
+ * matrix multiply.
+ *
+ * If SHERPA_NCNN_ENABLE_ACCELERATE is set, i.e., on iOS and macOS, the
+ * FFT and the mel projection run with vDSP of Apple's Accelerate
+ * framework instead.
+ *
+ * With use_vulkan, batches of at least kMinVulkanFrames frames are
+ * computed on the GPU instead, see VulkanFbank.
+ *
+ * Frames may come from different streams; the object has no per-stream
+ * state and Compute() is thread-safe.
+ */
+class BatchFbank {
+ public:
+  static constexpr int32_t kTileSize = 8;
+
+  // Smaller batches are computed on the CPU, since a GPU submission and
+  // the wait for it take longer
+  static constexpr int32_t kMinVulkanFrames = 64;
+
+  /** @param use_vulkan  True to compute large batches on the default GPU
+   *                     with Vulkan. It is ignored if ncnn is built without
+   *                     Vulkan or there is no GPU.
+   */
+  explicit BatchFbank(const knf::FbankOptions &opts, bool use_vulkan = false);
+  ~BatchFbank();
+
+  BatchFbank(const BatchFbank &) = delete;
+  BatchFbank &operator=(const BatchFbank &) = delete;
+
+  // Number of mel bins
+  int32_t Dim() const { return num_bins_; }
+
+  // Number of samples of a window passed to Compute()
+  int32_t PaddedWindowSize() const { return padded_window_size_; }
+
+  const knf::FbankOptions &GetOptions() const { return opts_; }
+
+  /** Extract the window of the given frame, see knf::ExtractWindow().
+   *
+   * @param sample_offset Index of wave[0] in the whole waveform.
+   * @param wave  Samples starting at sample_offset.
+   * @param frame Frame index.
+   * @param window It is resized to PaddedWindowSize().
+   */
+  void ExtractWindow(int64_t sample_offset, const std::vector<float> &wave,
+                     int32_t frame, std::vector<float> *window) const;
+
+  /** Compute the features of num_frames windows.
+   *
+   * @param windows A row-major matrix of shape (num_frames,
+   *                PaddedWindowSize())
+   * @param num_frames Number of frames
+   * @param features  A row-major matrix of shape (num_frames, Dim())
+   */
+  void Compute(const float *windows, int32_t num_frames,
+               float *features) const;
+
+ private:
+  friend class VulkanFbank;
+
+  void ComputeTile(const float *windows, int32_t num_frames, float *re,
+                   float *im, float *features) const;
+
+#if SHERPA_NCNN_ENABLE_ACCELERATE
+  void ComputeTileAccelerate(const float *windows, int32_t num_frames,
+                             float *re, float *im, float *power,
+                             float *features) const;
+#endif
+
+ private:
+  knf::FbankOptions opts_;
+  knf::FeatureWindowFunction window_function_;
+
+  int32_t padded_window_size_ = 0;
+  int32_t num_bins_ = 0;
+
+  // The real FFT of padded_window_size_ points is computed with a complex
+  // FFT of half_size_ points
+  int32_t half_size_ = 0;
+
+  std::vector<int32_t> bit_reverse_;  // [half_size_]
+
+  // exp(-2 pi i k / half_size_), k < half_size_ / 2
+  std::vector<float> twiddle_re_;
+  std::vector<float> twiddle_im_;
+
+  // exp(-2 pi i k / padded_window_size_), k < half_size_
+  std::vector<float> split_re_;
+  std::vector<float> split_im_;
+
+  // The weights of mel bin i are mel_weights_[mel_begin_[i]:mel_begin_[i+1]]
+  // and apply to the power spectrum starting at mel_offset_[i]
+  std::vector<int32_t> mel_offset_;
+  std::vector<int32_t> mel_begin_;
+  std::vector<float> mel_weights_;
+
+#if NCNN_VULKAN
+  // Shared by all objects with the same options. Not owned.
+  const VulkanFbank *vulkan_ = nullptr;
+#endif
+
+#if SHERPA_NCNN_ENABLE_ACCELERATE
+  OpaqueFFTSetup *fft_setup_ = nullptr;
+  int32_t log2_size_ = 0;
+
+  // The weights above as a dense row-major matrix of shape
+  // (half_size_, num_bins_), for vDSP_mmul()
+  std::vector<float> mel_matrix_;
+#endif
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_BATCH_FBANK_H_
@@ -0,0 +1,366 @@
+// sherpa-ncnn/csrc/benchmark-kernels.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+// Microbenchmarks of the hot primitives, so that a change to one of them
+// can be measured in isolation on each platform, including WASM.
+//
+// Each benchmark runs its body until --min-time seconds have passed and
+// reports the time per iteration and the items processed per second. The
+// output follows the layout of Google Benchmark. With --json, one JSON
+// object per benchmark is printed instead.
+//
+//   ./bin/benchmark-kernels [--filter=Resample] [--min-time=0.5] [--json]
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/circular-buffer.h"
+#include "sherpa-ncnn/csrc/context-graph.h"
+#include "sherpa-ncnn/csrc/features.h"
+#include "sherpa-ncnn/csrc/hypothesis.h"
+#include "sherpa-ncnn/csrc/log-softmax-topk.h"
+#include "sherpa-ncnn/csrc/math.h"
+#include "sherpa-ncnn/csrc/offline-stream.h"
+#include "sherpa-ncnn/csrc/offline-tts-vits-model.h"
+#include "sherpa-ncnn/csrc/parse-options.h"
+#include "sherpa-ncnn/csrc/resample.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Keeps the compiler from optimizing away the computation of a value
+template <typename T>
+void DoNotOptimize(const T &value) {
+  static volatile const void *sink;
+  sink = &value;
+}
+
+struct Benchmark {
+  std::string name;
+
+  // Run one iteration and return the number of items it processed, e.g.,
+  // samples or frames
+  std::function<int64_t()> body;
+};
+
+std::vector<float> RandomFloats(int32_t n, float a = -1, float b = 1) {
+  std::vector<float> ans(n);
+  sherpa_ncnn::RandomVectorFill(ans.data(), n, a, b);
+  return ans;
+}
+
+// A fixed seed, so that all runs use the same inputs
+std::mt19937 &Generator() {
+  static std::mt19937 g(20250101);
+  return g;
+}
+
+void AddMathBenchmarks(std::vector<Benchmark> *benchmarks) {
+  for (int32_t vocab_size : {500, 5000}) {
+    auto logits =
+        std::make_shared<std::vector<float>>(RandomFloats(vocab_size));
+    benchmarks->push_back(
+        {"LogSoftmax/" + std::to_string(vocab_size), [logits]() {
+           sherpa_ncnn::LogSoftmax(logits->data(),
+                                   static_cast<int32_t>(logits->size()));
+           DoNotOptimize((*logits)[0]);
+           return static_cast<int64_t>(logits->size());
+         }});
+
+    // 4 active paths as in modified beam search
+    int32_t n = 4 * vocab_size;
+    auto scores = std::make_shared<std::vector<float>>(RandomFloats(n));
+    benchmarks->push_back(
+        {"TopkIndex/" + std::to_string(n) + "/4", [scores]() {
+           auto topk = sherpa_ncnn::TopkIndex(scores->data(), scores->size(),
+                                              4);
+           DoNotOptimize(topk[0]);
+           return static_cast<int64_t>(scores->size());
+         }});
+
+    benchmarks->push_back(
+        {"LogSoftmaxTopk/4x" + std::to_string(vocab_size) + "/4",
+         [scores, vocab_size]() {
+           int32_t index[4];
+           float value[4];
+           sherpa_ncnn::LogSoftmaxTopk(scores->data(), 4, vocab_size,
+                                       nullptr, 4, index, value);
+           DoNotOptimize(index[0]);
+           return static_cast<int64_t>(scores->size());
+         }});
+  }
+}
+
+void AddResampleBenchmarks(std::vector<Benchmark> *benchmarks) {
+  for (int32_t in_rate : {8000, 44100, 48000}) {
+    int32_t out_rate = 16000;
+    float cutoff = 0.99 * 0.5 * std::min(in_rate, out_rate);
+    auto resampler = std::make_shared<sherpa_ncnn::LinearResample>(
+        in_rate, out_rate, cutoff, 6);
+
+    // 100 ms per call, as from a microphone
+    auto samples =
+        std::make_shared<std::vector<float>>(RandomFloats(in_rate / 10));
+    auto out = std::make_shared<std::vector<float>>();
+
+    benchmarks->push_back(
+        {"LinearResample/" + std::to_string(in_rate) + "to16000",
+         [resampler, samples, out]() {
+           resampler->Resample(samples->data(), samples->size(), false,
+                               out.get());
+           DoNotOptimize((*out)[0]);
+           return static_cast<int64_t>(samples->size());
+         }});
+  }
+}
+
+void AddFeatureBenchmarks(std::vector<Benchmark> *benchmarks) {
+  auto samples = std::make_shared<std::vector<float>>(RandomFloats(16000));
+
+  // 1 second of audio, from samples to fbank frames
+  benchmarks->push_back({"FeatureExtractor/GetFrames/1s", [samples]() {
+                           sherpa_ncnn::FeatureExtractorConfig config;
+                           sherpa_ncnn::FeatureExtractor extractor(config);
+                           extractor.AcceptWaveform(16000, samples->data(),
+                                                    samples->size());
+                           int32_t n = extractor.NumFramesReady();
+                           ncnn::Mat frames = extractor.GetFrames(0, n);
+                           DoNotOptimize(frames.data);
+                           return static_cast<int64_t>(n);
+                         }});
+
+  // LFR of SenseVoice, i.e., window size 7 and shift 6, over 10 seconds
+  auto stream = std::make_shared<sherpa_ncnn::OfflineStream>();
+  auto long_samples = RandomFloats(160000);
+  stream->AcceptWaveform(16000, long_samples.data(), long_samples.size());
+  stream->InputFinished();
+
+  benchmarks->push_back({"ApplyLFR/7x6/10s", [stream]() {
+                           ncnn::Mat lfr = stream->GetLfrFrames(7, 6);
+                           DoNotOptimize(lfr.data);
+                           return static_cast<int64_t>(lfr.h);
+                         }});
+}
+
+void AddSearchBenchmarks(std::vector<Benchmark> *benchmarks) {
+  // One frame of modified beam search with 4 active paths: 4 x 4
+  // candidates, half of which share tokens with another one
+  std::uniform_int_distribution<int32_t> token(1, 499);
+  std::uniform_real_distribution<double> log_prob(-10, 0);
+
+  auto candidates = std::make_shared<std::vector<sherpa_ncnn::Hypothesis>>();
+  for (int32_t i = 0; i != 8; ++i) {
+    std::vector<int32_t> ys(20);
+    for (auto &y : ys) y = token(Generator());
+
+    for (int32_t k = 0; k != 2; ++k) {
+      candidates->emplace_back(ys, log_prob(Generator()));
+    }
+  }
+
+  benchmarks->push_back({"Hypotheses/Add+GetTopK/16/4", [candidates]() {
+                           sherpa_ncnn::Hypotheses hyps;
+                           hyps.Reserve(candidates->size());
+                           for (const auto &h : *candidates) {
+                             hyps.Add(h);
+                           }
+                           auto topk = hyps.GetTopK(4, true);
+                           DoNotOptimize(topk[0].log_prob);
+                           return static_cast<int64_t>(candidates->size());
+                         }});
+
+  // 1000 hotwords of 2 to 6 tokens
+  std::vector<std::vector<int32_t>> hotwords(1000);
+  std::uniform_int_distribution<int32_t> length(2, 6);
+  for (auto &w : hotwords) {
+    w.resize(length(Generator()));
+    for (auto &t : w) t = token(Generator());
+  }
+  auto graph = std::make_shared<sherpa_ncnn::ContextGraph>(hotwords, 1.5f);
+
+  // Decoded tokens, a quarter of which continue a hotword
+  auto tokens = std::make_shared<std::vector<int32_t>>();
+  for (int32_t i = 0; i != 4096; ++i) {
+    if (i % 4 == 0) {
+      const auto &w = hotwords[i % hotwords.size()];
+      tokens->insert(tokens->end(), w.begin(), w.end());
+    } else {
+      tokens->push_back(token(Generator()));
+    }
+  }
+
+  benchmarks->push_back(
+      {"ContextGraph/ForwardOneStep/1000", [graph, tokens]() {
+         const sherpa_ncnn::ContextState *state = graph->Root();
+         float score = 0;
+         for (int32_t t : *tokens) {
+           auto r = graph->ForwardOneStep(state, t);
+           score += std::get<0>(r);
+           state = std::get<1>(r);
+         }
+         DoNotOptimize(score);
+         return static_cast<int64_t>(tokens->size());
+       }});
+}
+
+void AddBufferBenchmarks(std::vector<Benchmark> *benchmarks) {
+  // One VAD window of 512 samples per iteration in a 30 s buffer
+  auto buffer = std::make_shared<sherpa_ncnn::CircularBuffer>(16000 * 30);
+  auto window = std::make_shared<std::vector<float>>(RandomFloats(512));
+
+  benchmarks->push_back({"CircularBuffer/Push+Get+Pop/512", [buffer, window]() {
+                           buffer->Push(window->data(), window->size());
+                           auto v = buffer->Get(buffer->Head(), window->size());
+                           buffer->Pop(window->size());
+                           DoNotOptimize(v[0]);
+                           return static_cast<int64_t>(window->size());
+                         }});
+
+  benchmarks->push_back({"CircularBuffer/Push+GetView+Pop/512",
+                         [buffer, window]() {
+                           buffer->Push(window->data(), window->size());
+                           auto v = buffer->GetView(buffer->Head(),
+                                                    window->size());
+                           DoNotOptimize(v.data1[0]);
+                           buffer->Pop(window->size());
+                           return static_cast<int64_t>(window->size());
+                         }});
+}
+
+void AddTtsBenchmarks(std::vector<Benchmark> *benchmarks) {
+  // 100 phonemes with about 5 frames each and 192 channels as in VITS
+  int32_t num_phonemes = 100;
+  int32_t depth = 192;
+
+  auto logw = std::make_shared<ncnn::Mat>(num_phonemes);
+  auto m_p = std::make_shared<ncnn::Mat>(num_phonemes, depth);
+  auto logs_p = std::make_shared<ncnn::Mat>(num_phonemes, depth);
+  sherpa_ncnn::RandomVectorFill(static_cast<float *>(logw->data),
+                                num_phonemes, 1.4, 1.8);
+  sherpa_ncnn::RandomVectorFill(static_cast<float *>(m_p->data),
+                                num_phonemes * depth, -1, 1);
+  sherpa_ncnn::RandomVectorFill(static_cast<float *>(logs_p->data),
+                                num_phonemes * depth, -2, 0);
+
+  benchmarks->push_back({"PathAttention/100x192", [logw, m_p, logs_p]() {
+                           ncnn::Mat z_p =
+                               sherpa_ncnn::OfflineTtsVitsModel::PathAttention(
+                                   *logw, *m_p, *logs_p, 0.667, 1.0);
+                           DoNotOptimize(z_p.data);
+                           return static_cast<int64_t>(z_p.w);
+                         }});
+}
+
+struct Result {
+  std::string name;
+  int64_t iterations = 0;
+  double ns_per_iteration = 0;
+  double items_per_second = 0;
+};
+
+Result Run(const Benchmark &b, double min_time) {
+  // Warm up caches and lazily initialized state
+  b.body();
+
+  Result r;
+  r.name = b.name;
+
+  int64_t items = 0;
+  int64_t iterations = 1;
+  double seconds = 0;
+
+  // Grow the number of iterations until a run takes min_time, so that the
+  // clock is read rarely for cheap bodies
+  while (true) {
+    items = 0;
+    auto start = Clock::now();
+    for (int64_t i = 0; i != iterations; ++i) {
+      items += b.body();
+    }
+    seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    if (seconds >= min_time || iterations >= (int64_t{1} << 40)) break;
+
+    double scale = seconds > 0 ? min_time / seconds * 1.4 : 10;
+    iterations = std::max<int64_t>(iterations + 1,
+                                   iterations * std::min(scale, 10.0));
+  }
+
+  r.iterations = iterations;
+  r.ns_per_iteration = seconds * 1e9 / iterations;
+  r.items_per_second = items / seconds;
+  return r;
+}
+
+}  // namespace
+
+int32_t main(int32_t argc, char *argv[]) {
+  const char *kUsageMessage = R"usage(
+Microbenchmarks of the hot primitives of sherpa-ncnn.
+
+  ./bin/benchmark-kernels [--filter=Resample] [--min-time=0.5] [--json]
+)usage";
+
+  sherpa_ncnn::ParseOptions po(kUsageMessage);
+
+  std::string filter;
+  float min_time = 0.5;
+  bool json = false;
+
+  po.Register("filter", &filter,
+              "Run only the benchmarks whose names contain it");
+  po.Register("min-time", &min_time,
+              "Minimum number of seconds to run each benchmark");
+  po.Register("json", &json, "Print one JSON object per benchmark");
+
+  po.Read(argc, argv);
+
+  std::vector<Benchmark> benchmarks;
+  AddMathBenchmarks(&benchmarks);
+  AddResampleBenchmarks(&benchmarks);
+  AddFeatureBenchmarks(&benchmarks);
+  AddSearchBenchmarks(&benchmarks);
+  AddBufferBenchmarks(&benchmarks);
+  AddTtsBenchmarks(&benchmarks);
+
+  if (!json) {
+    printf("%-45s %15s %15s %15s\n", "Benchmark", "Time (ns)", "Iterations",
+           "Items/s");
+    printf("%s\n", std::string(93, '-').c_str());
+  }
+
+  for (const auto &b : benchmarks) {
+    if (!filter.empty() && b.name.find(filter) == std::string::npos) {
+      continue;
+    }
+
+    Result r = Run(b, min_time);
+
+    if (json) {
+      printf(
+          "{\"name\": \"%s\", \"iterations\": %lld, \"ns_per_iteration\": "
+          "%.1f, \"items_per_second\": %.1f}\n",
+          r.name.c_str(), static_cast<long long>(r.iterations),  // NOLINT
+          r.ns_per_iteration, r.items_per_second);
+    } else {
+      printf("%-45s %15.1f %15lld %15.4g\n", r.name.c_str(),
+             r.ns_per_iteration,
+             static_cast<long long>(r.iterations),  // NOLINT
+             r.items_per_second);
+    }
+    fflush(stdout);
+  }
+
+  return 0;
+}
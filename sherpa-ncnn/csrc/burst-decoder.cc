@@ -0,0 +1,83 @@
+// sherpa-ncnn/csrc/burst-decoder.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/burst-decoder.h"
+
+#include <algorithm>
+#include <sstream>
+#include <thread>  // NOLINT
+#include <vector>
+
+namespace sherpa_ncnn {
+
+using Clock = std::chrono::steady_clock;
+
+std::string BurstDecoderConfig::ToString() const {
+  std::ostringstream os;
+
+  os << "BurstDecoderConfig(";
+  os << "latency_ms=" << latency_ms << ")";
+
+  return os.str();
+}
+
+BurstDecoder::BurstDecoder(const Recognizer &recognizer,
+                           const BurstDecoderConfig &config)
+    : recognizer_(recognizer) {
+  float frame_shift_ms = recognizer.GetConfig().feat_config.frame_shift_ms;
+
+  // Compared with the smallest chunk, a frame waits longer for a larger
+  // chunk to fill by the difference of their sizes, and at most one period
+  // for the next burst. The former takes at most half of the budget and
+  // the rest is the period.
+  std::vector<int32_t> sizes = recognizer.GetChunkSizes();
+  int32_t min_size = *std::min_element(sizes.begin(), sizes.end());
+  chunk_size_ = min_size;
+  for (int32_t size : sizes) {
+    if ((size - min_size) * frame_shift_ms <= config.latency_ms / 2.0f &&
+        size > chunk_size_) {
+      chunk_size_ = size;
+    }
+  }
+
+  int32_t extra_ms =
+      static_cast<int32_t>((chunk_size_ - min_size) * frame_shift_ms);
+  period_ = std::chrono::milliseconds(
+      std::max(config.latency_ms - extra_ms, 1));
+
+  next_ = Clock::now() + period_;
+}
+
+void BurstDecoder::UseBigCores(ModelConfig *config) {
+  if (config->cpu_cores.empty()) {
+    config->encoder_powersave = 2;
+    config->decoder_powersave = 2;
+    config->joiner_powersave = 2;
+  }
+
+  config->encoder_opt.openmp_blocktime = 0;
+  config->decoder_opt.openmp_blocktime = 0;
+  config->joiner_opt.openmp_blocktime = 0;
+}
+
+std::unique_ptr<Stream> BurstDecoder::CreateStream() const {
+  return recognizer_.CreateStreamWithChunkSize(chunk_size_);
+}
+
+void BurstDecoder::Sleep() {
+  auto now = Clock::now();
+  if (now < next_) {
+    std::this_thread::sleep_until(next_);
+    next_ += period_;
+  } else {
+    // Behind: skip the missed bursts instead of running them back to back
+    next_ = now + period_;
+  }
+}
+
+int32_t BurstDecoder::Decode(Stream *s) const {
+  return recognizer_.DecodeReadyStreams(&s, 1);
+}
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,95 @@
+// sherpa-ncnn/csrc/burst-decoder.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_BURST_DECODER_H_
+#define SHERPA_NCNN_CSRC_BURST_DECODER_H_
+
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "sherpa-ncnn/csrc/model.h"
+#include "sherpa-ncnn/csrc/recognizer.h"
+#include "sherpa-ncnn/csrc/stream.h"
+
+namespace sherpa_ncnn {
+
+struct BurstDecoderConfig {
+  // The latency budget in ms: how much later audio is decoded at most
+  // than when each chunk of the smallest encoder is decoded as soon as it
+  // is ready
+  int32_t latency_ms = 300;
+
+  std::string ToString() const;
+};
+
+/** Decode a live stream in bursts to save power, e.g., on always-on
+ * wearables.
+ *
+ * Decoding chunk by chunk as soon as Recognizer::IsReady() is true keeps
+ * the cores awake all the time. Instead, the decoding thread sleeps in
+ * Sleep() while audio accumulates, and then Decode() decodes all of the
+ * ready chunks in one burst, so the cores can go idle between bursts.
+ *
+ * The stream uses the encoder with the largest chunk that fits the
+ * budget, see ModelConfig::encoder_variants, since a larger chunk costs
+ * less per second of audio. The budget is split between waiting for the
+ * larger chunk to fill and waiting for the next burst.
+ *
+ * Usage:
+ *
+ *   BurstDecoder::UseBigCores(&config.model_config);
+ *   Recognizer recognizer(config);
+ *
+ *   BurstDecoder burst(recognizer, burst_config);
+ *   auto s = burst.CreateStream();
+ *   while (!stop) {
+ *     burst.Sleep();
+ *     // move the captured samples to s, e.g., from an AudioCaptureQueue
+ *     burst.Decode(s.get());
+ *   }
+ */
+class BurstDecoder {
+ public:
+  BurstDecoder(const Recognizer &recognizer, const BurstDecoderConfig &config);
+
+  /** Run the networks of config on the big CPU cores, see
+   * ModelConfig::encoder_powersave, unless ModelConfig::cpu_cores is set,
+   * and let the threads of ncnn sleep right after a burst instead of
+   * spinning for more work. Call it before the recognizer is created.
+   */
+  static void UseBigCores(ModelConfig *config);
+
+  // Create a stream with the chunk size of ChunkSize()
+  std::unique_ptr<Stream> CreateStream() const;
+
+  // Sleep until the next burst is due. If the previous burst took longer
+  // than Period(), it returns at once.
+  void Sleep();
+
+  /** Decode all of the ready chunks of a stream, see
+   * Recognizer::DecodeReadyStreams(). It stops at an endpoint so that the
+   * caller can Reset() the stream.
+   *
+   * @return Return the number of decoded chunks.
+   */
+  int32_t Decode(Stream *s) const;
+
+  // In feature frames, see Recognizer::GetChunkSizes()
+  int32_t ChunkSize() const { return chunk_size_; }
+
+  // The time between two bursts
+  std::chrono::milliseconds Period() const { return period_; }
+
+ private:
+  const Recognizer &recognizer_;
+  int32_t chunk_size_ = 0;
+  std::chrono::milliseconds period_;
+  std::chrono::steady_clock::time_point next_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_BURST_DECODER_H_
@@ -23,6 +23,17 @@
 
 namespace sherpa_ncnn {
 
+void CircularBufferView::CopyTo(float *dst) const {
+  std::copy(data1, data1 + size1, dst);
+  std::copy(data2, data2 + size2, dst + size1);
+}
+
+std::vector<float> CircularBufferView::ToVector() const {
+  std::vector<float> ans(Size());
+  CopyTo(ans.data());
+  return ans;
+}
+
 CircularBuffer::CircularBuffer(int32_t capacity) {
   if (capacity <= 0) {
     NCNN_LOGE("Please specify a positive capacity. Given: %d\n", capacity);
@@ -166,6 +177,34 @@ std::vector<float> CircularBuffer::Get(int32_t start_index, int32_t n) const {
   return ans;
 }
 
+CircularBufferView CircularBuffer::GetView(int32_t start_index,
+                                           int32_t n) const {
+  int32_t size = Size();
+  if (start_index < head_ || n < 0 || start_index - head_ + n > size) {
+    NCNN_LOGE("Invalid start_index: %d and n: %d. head_: %d, size: %d",
+              start_index, n, head_, size);
+    return {};
+  }
+
+  CircularBufferView ans;
+  if (n == 0) {
+    return ans;
+  }
+
+  int32_t capacity = static_cast<int32_t>(buffer_.size());
+  int32_t start = start_index % capacity;
+
+  ans.data1 = buffer_.data() + start;
+  ans.size1 = std::min(n, capacity - start);
+
+  if (ans.size1 < n) {
+    ans.data2 = buffer_.data();
+    ans.size2 = n - ans.size1;
+  }
+
+  return ans;
+}
+
 void CircularBuffer::Pop(int32_t n) {
   int32_t size = Size();
   if (n < 0 || n > size) {
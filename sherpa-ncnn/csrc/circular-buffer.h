@@ -23,6 +23,24 @@
 
 namespace sherpa_ncnn {
 
+// A view of consecutive elements of a CircularBuffer without copying them.
+// Since the buffer wraps around, the elements are in at most two parts:
+// [data1, data1 + size1) followed by [data2, data2 + size2).
+struct CircularBufferView {
+  const float *data1 = nullptr;
+  int32_t size1 = 0;
+
+  const float *data2 = nullptr;
+  int32_t size2 = 0;
+
+  int32_t Size() const { return size1 + size2; }
+
+  // Copy the elements to dst, which has room for Size() elements
+  void CopyTo(float *dst) const;
+
+  std::vector<float> ToVector() const;
+};
+
 class CircularBuffer {
  public:
   // Capacity of this buffer. Should be large enough.
@@ -42,6 +60,11 @@ class CircularBuffer {
   // @return Return a vector of size n containing the requested elements
   std::vector<float> Get(int32_t start_index, int32_t n) const;
 
+  // Same as Get() but return a view into the buffer. It is valid until the
+  // next call to Push(), which may move the elements, Resize() or Reset(),
+  // or until the elements are popped.
+  CircularBufferView GetView(int32_t start_index, int32_t n) const;
+
   // Remove n elements from the buffer
   //
   // @param n Should be in the range [0, size_]
@@ -63,6 +86,8 @@ class CircularBuffer {
 
   void Resize(int32_t new_capacity);
 
+  int32_t Capacity() const { return buffer_.size(); }
+
  private:
   std::vector<float> buffer_;
 
@@ -0,0 +1,94 @@
+// sherpa-ncnn/csrc/compact-frames.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/compact-frames.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "mat.h"  // NOLINT
+
+namespace sherpa_ncnn {
+
+bool CompactFrames::ParseFormat(const std::string &s, Format *format) {
+  if (s == "fp16") {
+    *format = Format::kFloat16;
+    return true;
+  }
+
+  if (s == "int8") {
+    *format = Format::kInt8;
+    return true;
+  }
+
+  return false;
+}
+
+CompactFrames::CompactFrames(int32_t feature_dim, Format format)
+    : feature_dim_(feature_dim), format_(format) {}
+
+void CompactFrames::Push(const float *frame) {
+  if (format_ == Format::kFloat16) {
+    std::size_t size = half_.size();
+    half_.resize(size + feature_dim_);
+
+    uint16_t *p = half_.data() + size;
+    for (int32_t k = 0; k != feature_dim_; ++k) {
+      p[k] = ncnn::float32_to_float16(frame[k]);
+    }
+  } else {
+    auto mm = std::minmax_element(frame, frame + feature_dim_);
+    float offset = *mm.first;
+    float scale = (*mm.second - offset) / 255;
+    float inv_scale = scale > 0 ? 1 / scale : 0;
+
+    std::size_t size = q_.size();
+    q_.resize(size + feature_dim_);
+
+    uint8_t *p = q_.data() + size;
+    for (int32_t k = 0; k != feature_dim_; ++k) {
+      float q = std::round((frame[k] - offset) * inv_scale);
+      p[k] = static_cast<uint8_t>(std::min(std::max(q, 0.0f), 255.0f));
+    }
+
+    offset_scale_.push_back(offset);
+    offset_scale_.push_back(scale);
+  }
+
+  ++num_frames_;
+}
+
+void CompactFrames::GetFrame(int32_t i, float *out) const {
+  assert(i >= 0 && i < num_frames_);
+  std::size_t start = static_cast<std::size_t>(i) * feature_dim_;
+
+  if (format_ == Format::kFloat16) {
+    const uint16_t *p = half_.data() + start;
+    for (int32_t k = 0; k != feature_dim_; ++k) {
+      out[k] = ncnn::float16_to_float32(p[k]);
+    }
+    return;
+  }
+
+  const uint8_t *p = q_.data() + start;
+  float offset = offset_scale_[2 * i];
+  float scale = offset_scale_[2 * i + 1];
+  for (int32_t k = 0; k != feature_dim_; ++k) {
+    out[k] = offset + p[k] * scale;
+  }
+}
+
+void CompactFrames::ShrinkToFit() {
+  half_.shrink_to_fit();
+  q_.shrink_to_fit();
+  offset_scale_.shrink_to_fit();
+}
+
+std::size_t CompactFrames::NumBytes() const {
+  return half_.capacity() * sizeof(uint16_t) + q_.capacity() +
+         offset_scale_.capacity() * sizeof(float);
+}
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,73 @@
+// sherpa-ncnn/csrc/compact-frames.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_COMPACT_FRAMES_H_
+#define SHERPA_NCNN_CSRC_COMPACT_FRAMES_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace sherpa_ncnn {
+
+/** Feature frames stored with fewer bits than float, for streams that
+ * wait in a queue before they are decoded.
+ *
+ * With kFloat16, each value is an IEEE half. With kInt8, each frame is
+ * quantized to uint8 with its own offset and scale, i.e., value
+ * ≈ min + q * (max - min) / 255, where min and max are those of the
+ * frame. The error is at most half a step of the frame.
+ */
+class CompactFrames {
+ public:
+  enum class Format {
+    kFloat16,
+    kInt8,
+  };
+
+  /** Parse "fp16" or "int8". Return false for other strings, including
+   * "fp32", which means frames are not compacted.
+   */
+  static bool ParseFormat(const std::string &s, Format *format);
+
+  CompactFrames(int32_t feature_dim, Format format);
+
+  CompactFrames(const CompactFrames &) = delete;
+  CompactFrames &operator=(const CompactFrames &) = delete;
+
+  int32_t FeatureDim() const { return feature_dim_; }
+
+  // Number of frames pushed so far
+  int32_t NumFrames() const { return num_frames_; }
+
+  // Append a frame of FeatureDim() floats
+  void Push(const float *frame);
+
+  // Write FeatureDim() floats of frame i to out
+  void GetFrame(int32_t i, float *out) const;
+
+  // Release the capacity reserved for frames that are not pushed yet
+  void ShrinkToFit();
+
+  // Bytes of the stored frames, including the reserved capacity
+  std::size_t NumBytes() const;
+
+ private:
+  int32_t feature_dim_;
+  Format format_;
+  int32_t num_frames_ = 0;
+
+  // Used if format_ is kFloat16
+  std::vector<uint16_t> half_;
+
+  // Used if format_ is kInt8. offset_scale_[2*i] and offset_scale_[2*i+1]
+  // are the offset and the scale of frame i.
+  std::vector<uint8_t> q_;
+  std::vector<float> offset_scale_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_COMPACT_FRAMES_H_
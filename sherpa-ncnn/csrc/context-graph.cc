@@ -6,16 +6,78 @@
 
 #include <algorithm>
 #include <cassert>
-#include <queue>
+#include <cstdint>
+#include <cstring>
+#include <map>
 #include <string>
 #include <tuple>
 #include <utility>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/macros.h"
+#include "sherpa-ncnn/csrc/mapped-file.h"
 
 namespace sherpa_ncnn {
-void ContextGraph::Build(const std::vector<std::vector<int32_t>> &token_ids,
-                         const std::vector<float> &scores,
-                         const std::vector<std::string> &phrases,
-                         const std::vector<float> &ac_thresholds) const {
+
+namespace {
+
+constexpr char kMagic[4] = {'C', 'T', 'X', 'G'};
+
+// Magic and sizeof(ContextState), num_nodes, pool_size
+constexpr std::size_t kHeaderSize = 16;
+
+// A node of the trie while it is being built
+struct BuildNode {
+  int32_t token = -1;
+  int32_t level = 0;
+  float token_score = 0;
+  float node_score = 0;
+  float output_score = 0;
+  float ac_threshold = 0;
+  bool is_end = false;
+  std::string phrase;
+
+  // token -> index of the child
+  std::map<int32_t, int32_t> next;
+};
+
+// The memory of a graph built in this process
+struct Storage {
+  std::vector<ContextState> nodes;
+  std::string phrases;
+};
+
+std::shared_ptr<const void> CopyAligned(const void *data, std::size_t size) {
+  auto buf = std::make_shared<std::vector<uint32_t>>((size + 3) / 4);
+  std::memcpy(buf->data(), data, size);
+  return std::shared_ptr<const void>(buf, buf->data());
+}
+
+void AppendUint32(uint32_t v, std::string *s) {
+  s->append(reinterpret_cast<const char *>(&v), sizeof(v));
+}
+
+// Return the child of nodes[i] for token or -1 if there is none
+int32_t FindChild(const ContextState *nodes, int32_t i, int32_t token) {
+  const ContextState *begin = nodes + nodes[i].first_child;
+  const ContextState *end = begin + nodes[i].num_children;
+
+  const ContextState *p =
+      std::lower_bound(begin, end, token, [](const ContextState &s, int32_t t) {
+        return s.token < t;
+      });
+
+  return (p != end && p->token == token) ? p - nodes : -1;
+}
+
+/* Build the trie of the hotwords and compile it into nodes in
+ * breadth-first order. Fail and output links are not set.
+ */
+void BuildNodes(const std::vector<std::vector<int32_t>> &token_ids,
+                float context_score, float context_ac_threshold,
+                const std::vector<float> &scores,
+                const std::vector<std::string> &phrases,
+                const std::vector<float> &ac_thresholds, Storage *storage) {
   if (!scores.empty()) {
     assert(token_ids.size() == scores.size());
   }
@@ -25,84 +87,330 @@ void ContextGraph::Build(const std::vector<std::vector<int32_t>> &token_ids,
   if (!ac_thresholds.empty()) {
     assert(token_ids.size() == ac_thresholds.size());
   }
+
+  std::vector<BuildNode> trie(1);
+
   for (int32_t i = 0; i < token_ids.size(); ++i) {
-    auto node = root_.get();
+    int32_t node = 0;
     float score = scores.empty() ? 0.0f : scores[i];
-    score = score == 0.0f ? context_score_ : score;
+    score = score == 0.0f ? context_score : score;
     float ac_threshold = ac_thresholds.empty() ? 0.0f : ac_thresholds[i];
-    ac_threshold = ac_threshold == 0.0f ? ac_threshold_ : ac_threshold;
+    ac_threshold = ac_threshold == 0.0f ? context_ac_threshold : ac_threshold;
     std::string phrase = phrases.empty() ? std::string() : phrases[i];
 
     for (int32_t j = 0; j < token_ids[i].size(); ++j) {
       int32_t token = token_ids[i][j];
-      if (0 == node->next.count(token)) {
-        bool is_end = j == token_ids[i].size() - 1;
-        node->next[token] = std::make_unique<ContextState>(
-            token, score, node->node_score + score,
-            is_end ? node->node_score + score : 0, j + 1,
-            is_end ? ac_threshold : 0.0f, is_end,
-            is_end ? phrase : std::string());
+      bool is_last = j == token_ids[i].size() - 1;
+
+      auto it = trie[node].next.find(token);
+      if (it == trie[node].next.end()) {
+        float node_score = trie[node].node_score + score;
+
+        BuildNode n;
+        n.token = token;
+        n.token_score = score;
+        n.node_score = node_score;
+        n.output_score = is_last ? node_score : 0;
+        n.level = j + 1;
+        n.ac_threshold = is_last ? ac_threshold : 0.0f;
+        n.is_end = is_last;
+        n.phrase = is_last ? phrase : std::string();
+
+        int32_t child = trie.size();
+        trie[node].next[token] = child;
+        trie.push_back(std::move(n));
+        node = child;
+        continue;
+      }
+
+      int32_t child = it->second;
+      BuildNode &n = trie[child];
+      n.token_score = std::max(score, n.token_score);
+      n.node_score = trie[node].node_score + n.token_score;
+      n.is_end = is_last || n.is_end;
+      n.output_score = n.is_end ? n.node_score : 0.0f;
+      if (is_last) {
+        n.phrase = phrase;
+        n.ac_threshold = ac_threshold;
+      }
+      node = child;
+    }
+  }
+
+  // order[k] is the trie node that becomes node k
+  std::vector<int32_t> order;
+  order.reserve(trie.size());
+  order.push_back(0);
+
+  storage->nodes.resize(trie.size());
+
+  for (int32_t k = 0; k != static_cast<int32_t>(order.size()); ++k) {
+    const BuildNode &b = trie[order[k]];
+    ContextState &s = storage->nodes[k];
+
+    s.token = b.token;
+    s.level = b.level;
+    s.token_score = b.token_score;
+    s.node_score = b.node_score;
+    s.output_score = b.output_score;
+    s.ac_threshold = b.ac_threshold;
+    s.fail = 0;
+    s.output = -1;
+    s.first_child = order.size();
+    s.num_children = b.next.size();
+    s.phrase_offset = storage->phrases.size();
+    s.phrase_size = b.phrase.size();
+    s.is_end = b.is_end;
+
+    storage->phrases.append(b.phrase);
+
+    // std::map iterates in the order of tokens
+    for (const auto &kv : b.next) {
+      order.push_back(kv.second);
+    }
+  }
+}
+
+/* Fill the fail and output links of nodes in breadth-first order. The
+ * fail and output nodes of a node are at lower levels, so they are done
+ * before it.
+ */
+void FillFailOutput(std::vector<ContextState> *v) {
+  ContextState *nodes = v->data();
+  int32_t num_nodes = v->size();
+
+  for (int32_t i = 0; i != num_nodes; ++i) {
+    const ContextState &current_node = nodes[i];
+
+    for (int32_t c = current_node.first_child;
+         c != current_node.first_child + current_node.num_children; ++c) {
+      ContextState &child = nodes[c];
+      if (i == 0) {
+        child.fail = 0;
+        continue;
+      }
+
+      int32_t token = child.token;
+
+      int32_t fail = current_node.fail;
+      int32_t next = FindChild(nodes, fail, token);
+      if (next != -1) {
+        fail = next;
       } else {
-        float token_score = std::max(score, node->next[token]->token_score);
-        node->next[token]->token_score = token_score;
-        float node_score = node->node_score + token_score;
-        node->next[token]->node_score = node_score;
-        bool is_end =
-            (j == token_ids[i].size() - 1) || node->next[token]->is_end;
-        node->next[token]->output_score = is_end ? node_score : 0.0f;
-        node->next[token]->is_end = is_end;
-        if (j == token_ids[i].size() - 1) {
-          node->next[token]->phrase = phrase;
-          node->next[token]->ac_threshold = ac_threshold;
+        fail = nodes[fail].fail;
+        while ((next = FindChild(nodes, fail, token)) == -1) {
+          fail = nodes[fail].fail;
+          if (-1 == nodes[fail].token) break;
+        }
+        next = FindChild(nodes, fail, token);
+        if (next != -1) fail = next;
+      }
+      child.fail = fail;
+
+      // fill the output arc
+      int32_t output = fail;
+      while (!nodes[output].is_end) {
+        output = nodes[output].fail;
+        if (-1 == nodes[output].token) {
+          output = -1;
+          break;
         }
       }
-      node = node->next[token].get();
+      child.output = output;
+      child.output_score += output == -1 ? 0 : nodes[output].output_score;
     }
   }
-  FillFailOutput();
+}
+
+}  // namespace
+
+ContextGraph::ContextGraph(const std::vector<std::vector<int32_t>> &token_ids,
+                           float context_score, float ac_threshold,
+                           const std::vector<float> &scores,
+                           const std::vector<std::string> &phrases,
+                           const std::vector<float> &ac_thresholds) {
+  auto storage = std::make_shared<Storage>();
+  BuildNodes(token_ids, context_score, ac_threshold, scores, phrases,
+             ac_thresholds, storage.get());
+  FillFailOutput(&storage->nodes);
+
+  nodes_ = storage->nodes.data();
+  num_nodes_ = storage->nodes.size();
+  phrases_ = storage->phrases.data();
+  phrases_size_ = storage->phrases.size();
+  owner_ = std::move(storage);
+}
+
+ContextGraph::ContextGraph(const unsigned char *data, std::size_t size,
+                           std::shared_ptr<const void> owner /*= nullptr*/) {
+  if (!owner || reinterpret_cast<uintptr_t>(data) % alignof(uint32_t) != 0) {
+    owner_ = CopyAligned(data, size);
+    data = static_cast<const unsigned char *>(owner_.get());
+  } else {
+    owner_ = std::move(owner);
+  }
+
+  InitFromBinary(data, size);
+}
+
+ContextGraphPtr ContextGraph::Load(const std::string &filename) {
+  std::shared_ptr<MappedFile> f = MappedFile::Open(filename);
+  if (!f) {
+    SHERPA_NCNN_LOGE("Failed to map %s", filename.c_str());
+    SHERPA_NCNN_EXIT(-1);
+  }
+
+  const unsigned char *data = f->Data();
+  std::size_t size = f->Size();
+  return std::make_shared<ContextGraph>(data, size, std::move(f));
+}
+
+bool ContextGraph::IsBinary(const char *data, std::size_t size) {
+  return size >= sizeof(kMagic) && std::memcmp(data, kMagic, 4) == 0;
+}
+
+void ContextGraph::InitFromBinary(const unsigned char *data,
+                                  std::size_t size) {
+  if (size < kHeaderSize ||
+      !IsBinary(reinterpret_cast<const char *>(data), size)) {
+    SHERPA_NCNN_LOGE("Not a binary context graph");
+    SHERPA_NCNN_EXIT(-1);
+  }
+
+  uint32_t header[3];
+  std::memcpy(header, data + sizeof(kMagic), sizeof(header));
+  uint64_t node_size = header[0];
+  uint64_t num_nodes = header[1];
+  uint64_t pool_size = header[2];
+
+  if (node_size != sizeof(ContextState)) {
+    SHERPA_NCNN_LOGE(
+        "The context graph was written with nodes of %d bytes. Expected: %d",
+        static_cast<int32_t>(node_size),
+        static_cast<int32_t>(sizeof(ContextState)));
+    SHERPA_NCNN_EXIT(-1);
+  }
+
+  uint64_t expected = kHeaderSize + num_nodes * node_size + pool_size;
+  if (num_nodes == 0 || size < expected) {
+    SHERPA_NCNN_LOGE("Truncated context graph: %d bytes, expected %d",
+                     static_cast<int32_t>(size),
+                     static_cast<int32_t>(expected));
+    SHERPA_NCNN_EXIT(-1);
+  }
+
+  nodes_ = reinterpret_cast<const ContextState *>(data + kHeaderSize);
+  num_nodes_ = num_nodes;
+  phrases_ = reinterpret_cast<const char *>(data + kHeaderSize +
+                                            num_nodes * node_size);
+  phrases_size_ = pool_size;
+}
+
+std::string ContextGraph::ToBinary() const {
+  std::string ans;
+  ans.reserve(kHeaderSize + num_nodes_ * sizeof(ContextState) +
+              phrases_size_);
+
+  ans.append(kMagic, sizeof(kMagic));
+  AppendUint32(sizeof(ContextState), &ans);
+  AppendUint32(num_nodes_, &ans);
+  AppendUint32(phrases_size_, &ans);
+  ans.append(reinterpret_cast<const char *>(nodes_),
+             num_nodes_ * sizeof(ContextState));
+  ans.append(phrases_, phrases_size_);
+
+  return ans;
+}
+
+const ContextState *ContextGraph::Next(const ContextState *state,
+                                       int32_t token) const {
+  int32_t i = FindChild(nodes_, state - nodes_, token);
+  return i == -1 ? nullptr : nodes_ + i;
 }
 
 std::tuple<float, const ContextState *, const ContextState *>
 ContextGraph::ForwardOneStep(const ContextState *state, int32_t token,
                              bool strict_mode /*= true*/) const {
-  const ContextState *node;
+  const ContextState *node = Next(state, token);
   float score;
-  if (1 == state->next.count(token)) {
-    node = state->next.at(token).get();
+  if (node) {
     score = node->token_score;
   } else {
-    node = state->fail;
-    while (0 == node->next.count(token)) {
-      node = node->fail;
-      if (-1 == node->token) break;  // root
-    }
-    if (1 == node->next.count(token)) {
-      node = node->next.at(token).get();
+    node = nodes_ + state->fail;
+
+    const ContextState *next;
+    while (!(next = Next(node, token)) && -1 != node->token) {
+      node = nodes_ + node->fail;
     }
+
+    if (next) node = next;
+
     score = node->node_score - state->node_score;
   }
 
+  return Arrive(node, score, strict_mode);
+}
+
+std::tuple<float, const ContextState *, const ContextState *>
+ContextGraph::Arrive(const ContextState *node, float score,
+                     bool strict_mode) const {
   assert(nullptr != node);
 
-  const ContextState *matched_node =
-      node->is_end ? node : (node->output != nullptr ? node->output : nullptr);
+  const ContextState *output = node->output == -1 ? nullptr
+                                                  : nodes_ + node->output;
+  const ContextState *matched_node = node->is_end ? node : output;
 
   if (!strict_mode && node->output_score != 0) {
     assert(nullptr != matched_node);
     float output_score =
         node->is_end ? node->node_score
-                     : (node->output != nullptr ? node->output->node_score
-                                                : node->node_score);
-    return std::make_tuple(score + output_score - node->node_score, root_.get(),
+                     : (output != nullptr ? output->node_score
+                                          : node->node_score);
+    return std::make_tuple(score + output_score - node->node_score, Root(),
                            matched_node);
   }
   return std::make_tuple(score + node->output_score, node, matched_node);
 }
 
+float ContextGraph::GetArcs(const ContextState *state, bool strict_mode,
+                            std::vector<ContextArc> *arcs) const {
+  std::size_t begin = arcs->size();
+
+  // The arcs of state, then those of the nodes on its fail chain. A token
+  // takes the arc of the first node that has one, as in ForwardOneStep().
+  const ContextState *node = state;
+  while (true) {
+    std::size_t end = arcs->size();
+    const ContextState *child = nodes_ + node->first_child;
+    for (int32_t i = 0; i != node->num_children; ++i, ++child) {
+      auto it = std::find_if(
+          arcs->begin() + begin, arcs->begin() + end,
+          [child](const ContextArc &a) { return a.token == child->token; });
+      if (it != arcs->begin() + end) {
+        continue;
+      }
+
+      float score = node == state ? child->token_score
+                                  : child->node_score - state->node_score;
+      auto res = Arrive(child, score, strict_mode);
+      arcs->push_back({child->token, std::get<0>(res), std::get<1>(res)});
+    }
+
+    if (node->token == -1) {
+      break;
+    }
+    node = nodes_ + node->fail;
+  }
+
+  // Other tokens go back to the root
+  return std::get<0>(
+      Arrive(Root(), Root()->node_score - state->node_score, strict_mode));
+}
+
 std::pair<float, const ContextState *> ContextGraph::Finalize(
     const ContextState *state) const {
   float score = -state->node_score;
-  return std::make_pair(score, root_.get());
+  return std::make_pair(score, Root());
 }
 
 std::pair<bool, const ContextState *> ContextGraph::IsMatched(
@@ -113,50 +421,12 @@ std::pair<bool, const ContextState *> ContextGraph::IsMatched(
     status = true;
     node = state;
   } else {
-    if (state->output != nullptr) {
+    if (state->output != -1) {
       status = true;
-      node = state->output;
+      node = nodes_ + state->output;
     }
   }
   return std::make_pair(status, node);
 }
 
-void ContextGraph::FillFailOutput() const {
-  std::queue<const ContextState *> node_queue;
-  for (auto &kv : root_->next) {
-    kv.second->fail = root_.get();
-    node_queue.push(kv.second.get());
-  }
-  while (!node_queue.empty()) {
-    auto current_node = node_queue.front();
-    node_queue.pop();
-    for (auto &kv : current_node->next) {
-      auto fail = current_node->fail;
-      if (1 == fail->next.count(kv.first)) {
-        fail = fail->next.at(kv.first).get();
-      } else {
-        fail = fail->fail;
-        while (0 == fail->next.count(kv.first)) {
-          fail = fail->fail;
-          if (-1 == fail->token) break;
-        }
-        if (1 == fail->next.count(kv.first))
-          fail = fail->next.at(kv.first).get();
-      }
-      kv.second->fail = fail;
-      // fill the output arc
-      auto output = fail;
-      while (!output->is_end) {
-        output = output->fail;
-        if (-1 == output->token) {
-          output = nullptr;
-          break;
-        }
-      }
-      kv.second->output = output;
-      kv.second->output_score += output == nullptr ? 0 : output->output_score;
-      node_queue.push(kv.second.get());
-    }
-  }
-}
 }  // namespace sherpa_ncnn
@@ -5,10 +5,12 @@
 #ifndef SHERPA_NCNN_CSRC_CONTEXT_GRAPH_H_
 #define SHERPA_NCNN_CSRC_CONTEXT_GRAPH_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <tuple>
-#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -17,46 +19,65 @@ namespace sherpa_ncnn {
 class ContextGraph;
 using ContextGraphPtr = std::shared_ptr<ContextGraph>;
 
+// A node of a ContextGraph.
+//
+// All nodes of a graph live in one array in breadth-first order, so the
+// children of a node are contiguous and sorted by token. Links are indexes
+// into that array and the phrases are in a separate pool. A node contains
+// no pointers, so the array can be written to a file and mapped back.
 struct ContextState {
   int32_t token;
+  int32_t level;
   float token_score;
   float node_score;
   float output_score;
-  int32_t level;
   float ac_threshold;
-  bool is_end;
-  std::string phrase;
-  std::unordered_map<int32_t, std::unique_ptr<ContextState>> next;
-  const ContextState *fail = nullptr;
-  const ContextState *output = nullptr;
-
-  ContextState() = default;
-  ContextState(int32_t token, float token_score, float node_score,
-               float output_score, int32_t level = 0, float ac_threshold = 0.0f,
-               bool is_end = false, const std::string &phrase = {})
-      : token(token),
-        token_score(token_score),
-        node_score(node_score),
-        output_score(output_score),
-        level(level),
-        ac_threshold(ac_threshold),
-        is_end(is_end),
-        phrase(phrase) {}
+
+  // Index of the node to go to if there is no arc for a token
+  int32_t fail;
+
+  // Index of the nearest node on the fail chain, excluding this one, at
+  // which a hotword ends. It is -1 if there is none.
+  int32_t output;
+
+  // The children are nodes [first_child, first_child + num_children)
+  int32_t first_child;
+  int32_t num_children;
+
+  // The phrase is [phrase_offset, phrase_offset + phrase_size) of the pool
+  int32_t phrase_offset;
+  int32_t phrase_size;
+
+  // 1 if a hotword ends at this node
+  int32_t is_end;
 };
 
+// The result of ContextGraph::ForwardOneStep() for a token, see
+// ContextGraph::GetArcs()
+struct ContextArc {
+  int32_t token;
+  float score;
+  const ContextState *next;
+};
+
+/** An Aho-Corasick automaton of hotwords.
+ *
+ * It is compiled into a flat node array once and is immutable afterwards,
+ * so one graph can be shared by any number of streams. Finding the arc of
+ * a token is a binary search among the children of a node.
+ *
+ * ToBinary() serializes the graph. A graph loaded from it, e.g., with
+ * Load(), is used in place without rebuilding anything.
+ */
 class ContextGraph {
  public:
   ContextGraph() = default;
+
   ContextGraph(const std::vector<std::vector<int32_t>> &token_ids,
                float context_score, float ac_threshold,
                const std::vector<float> &scores = {},
                const std::vector<std::string> &phrases = {},
-               const std::vector<float> &ac_thresholds = {})
-      : context_score_(context_score), ac_threshold_(ac_threshold) {
-    root_ = std::make_unique<ContextState>(-1, 0, 0, 0);
-    root_->fail = root_.get();
-    Build(token_ids, scores, phrases, ac_thresholds);
-  }
+               const std::vector<float> &ac_thresholds = {});
 
   ContextGraph(const std::vector<std::vector<int32_t>> &token_ids,
                float context_score, const std::vector<float> &scores = {},
@@ -64,28 +85,93 @@ class ContextGraph {
       : ContextGraph(token_ids, context_score, 0.0f, scores, phrases,
                      std::vector<float>()) {}
 
+  /** Construct a graph from the output of ToBinary().
+   *
+   * @param data  The binary graph.
+   * @param size  Number of bytes of data.
+   * @param owner  If not null, it keeps data alive and data is used in
+   *               place. Otherwise, data is copied.
+   */
+  ContextGraph(const unsigned char *data, std::size_t size,
+               std::shared_ptr<const void> owner = nullptr);
+
+  /// Memory map a file written with the output of ToBinary()
+  static ContextGraphPtr Load(const std::string &filename);
+
+  /// Return true if the first size bytes of data start like the output
+  /// of ToBinary()
+  static bool IsBinary(const char *data, std::size_t size);
+
+  /** Return a binary representation of this graph. All integers are
+   * 32-bit and use the byte order of the host:
+   *
+   *   "CTXG", sizeof(ContextState), num_nodes, pool_size,
+   *   nodes[num_nodes],
+   *   pool[pool_size]  // the phrases
+   */
+  std::string ToBinary() const;
+
   std::tuple<float, const ContextState *, const ContextState *> ForwardOneStep(
       const ContextState *state, int32_t token_id,
       bool strict_mode = true) const;
 
+  /** Append to arcs the tokens that have an arc from state or from a node
+   * on its fail chain, with the score and the next state that
+   * ForwardOneStep(state, token, strict_mode) returns. Each token is
+   * appended once.
+   *
+   * It allows boosting the tokens before they are selected instead of
+   * calling ForwardOneStep() for each selected token.
+   *
+   * @return Return the score of ForwardOneStep() for all other tokens. Their
+   *         next state is Root().
+   */
+  float GetArcs(const ContextState *state, bool strict_mode,
+                std::vector<ContextArc> *arcs) const;
+
   std::pair<bool, const ContextState *> IsMatched(
       const ContextState *state) const;
 
   std::pair<float, const ContextState *> Finalize(
       const ContextState *state) const;
 
-  const ContextState *Root() const { return root_.get(); }
+  const ContextState *Root() const { return nodes_; }
+
+  int32_t NumNodes() const { return num_nodes_; }
+
+  /// Return the bytes of the nodes and phrases of this graph
+  std::size_t NumBytes() const {
+    return num_nodes_ * sizeof(ContextState) + phrases_size_;
+  }
+
+  /// Return the phrase of a node at which a hotword ends
+  std::string_view Phrase(const ContextState *state) const {
+    return {phrases_ + state->phrase_offset,
+            static_cast<std::size_t>(state->phrase_size)};
+  }
 
  private:
-  float context_score_;
-  float ac_threshold_;
-  std::unique_ptr<ContextState> root_;
-  void Build(const std::vector<std::vector<int32_t>> &token_ids,
-             const std::vector<float> &scores,
-             const std::vector<std::string> &phrases,
-             const std::vector<float> &ac_thresholds) const;
-  void FillFailOutput() const;
+  // Return the child of state for token or nullptr if there is none
+  const ContextState *Next(const ContextState *state, int32_t token) const;
+
+  // The result of ForwardOneStep() that goes to node with the given score
+  std::tuple<float, const ContextState *, const ContextState *> Arrive(
+      const ContextState *node, float score, bool strict_mode) const;
+
+  // Point the members to data, which has the layout of ToBinary()
+  void InitFromBinary(const unsigned char *data, std::size_t size);
+
+ private:
+  // Keeps the memory that the pointers below refer to alive
+  std::shared_ptr<const void> owner_;
+
+  const ContextState *nodes_ = nullptr;
+  int32_t num_nodes_ = 0;
+
+  const char *phrases_ = nullptr;
+  int32_t phrases_size_ = 0;
 };
 
 }  // namespace sherpa_ncnn
+
 #endif  // SHERPA_NCNN_CSRC_CONTEXT_GRAPH_H_
@@ -15,26 +15,15 @@
 
 namespace sherpa_ncnn {
 
-ConvEmformerModel::ConvEmformerModel(const ModelConfig &config) {
+ConvEmformerModel::ConvEmformerModel(
+    const ModelConfig &config, std::shared_ptr<const ModelBundle> bundle) {
   encoder_.opt = config.encoder_opt;
   decoder_.opt = config.decoder_opt;
   joiner_.opt = config.joiner_opt;
 
-  bool has_gpu = false;
-#if NCNN_VULKAN
-  has_gpu = ncnn::get_gpu_count() > 0;
-#endif
+  InitDevices(config);
 
-  if (has_gpu && config.use_vulkan_compute) {
-    encoder_.opt.use_vulkan_compute = true;
-    decoder_.opt.use_vulkan_compute = true;
-    joiner_.opt.use_vulkan_compute = true;
-    NCNN_LOGE("Use GPU");
-  } else {
-    // NCNN_LOGE("Don't Use GPU. has_gpu: %d, config.use_vulkan_compute: %d",
-    //           static_cast<int32_t>(has_gpu),
-    //           static_cast<int32_t>(config.use_vulkan_compute));
-  }
+  InitOptions(config, std::move(bundle));
 
   InitEncoder(config.encoder_param, config.encoder_bin);
   InitDecoder(config.decoder_param, config.decoder_bin);
@@ -43,6 +32,9 @@ ConvEmformerModel::ConvEmformerModel(const ModelConfig &config) {
   InitEncoderInputOutputIndexes();
   InitDecoderInputOutputIndexes();
   InitJoinerInputOutputIndexes();
+
+  InitEarlyExit(config.early_exit_threshold, encoder_,
+                encoder_output_indexes_.size());
 }
 
 #if __ANDROID_API__ >= 9
@@ -52,21 +44,9 @@ ConvEmformerModel::ConvEmformerModel(AAssetManager *mgr,
   decoder_.opt = config.decoder_opt;
   joiner_.opt = config.joiner_opt;
 
-  bool has_gpu = false;
-#if NCNN_VULKAN
-  has_gpu = ncnn::get_gpu_count() > 0;
-#endif
+  InitDevices(config);
 
-  if (has_gpu && config.use_vulkan_compute) {
-    encoder_.opt.use_vulkan_compute = true;
-    decoder_.opt.use_vulkan_compute = true;
-    joiner_.opt.use_vulkan_compute = true;
-    NCNN_LOGE("Use GPU");
-  } else {
-    // NCNN_LOGE("Don't Use GPU. has_gpu: %d, config.use_vulkan_compute: %d",
-    //           static_cast<int32_t>(has_gpu),
-    //           static_cast<int32_t>(config.use_vulkan_compute));
-  }
+  InitOptions(config);
 
   InitEncoder(mgr, config.encoder_param, config.encoder_bin);
   InitDecoder(mgr, config.decoder_param, config.decoder_bin);
@@ -75,18 +55,31 @@ ConvEmformerModel::ConvEmformerModel(AAssetManager *mgr,
   InitEncoderInputOutputIndexes();
   InitDecoderInputOutputIndexes();
   InitJoinerInputOutputIndexes();
+
+  InitEarlyExit(config.early_exit_threshold, encoder_,
+                encoder_output_indexes_.size());
 }
 #endif
 
 std::pair<ncnn::Mat, std::vector<ncnn::Mat>> ConvEmformerModel::RunEncoder(
     ncnn::Mat &features, const std::vector<ncnn::Mat> &states) {
-  ncnn::Extractor encoder_ex = encoder_.create_extractor();
+  ncnn::Extractor encoder_ex = CreateExtractor(encoder_);
   return RunEncoder(features, states, &encoder_ex);
 }
 
 std::pair<ncnn::Mat, std::vector<ncnn::Mat>> ConvEmformerModel::RunEncoder(
     ncnn::Mat &features, const std::vector<ncnn::Mat> &states,
     ncnn::Extractor *encoder_ex) {
+  std::vector<ncnn::Mat> next_states;
+  ncnn::Mat encoder_out =
+      RunEncoder(features, states, encoder_ex, &next_states);
+  return {encoder_out, next_states};
+}
+
+ncnn::Mat ConvEmformerModel::RunEncoder(ncnn::Mat &features,
+                                        const std::vector<ncnn::Mat> &states,
+                                        ncnn::Extractor *encoder_ex,
+                                        std::vector<ncnn::Mat> *next_states) {
   std::vector<ncnn::Mat> _states;
 
   const ncnn::Mat *p;
@@ -103,19 +96,30 @@ std::pair<ncnn::Mat, std::vector<ncnn::Mat>> ConvEmformerModel::RunEncoder(
     encoder_ex->input(encoder_input_indexes_[i], p[i - 1]);
   }
 
+  // For a confidently blank chunk, only the layers up to the early blank
+  // head are run
+  const std::vector<int32_t> *early = EarlyExit(encoder_ex);
+  const std::vector<int32_t> &output_indexes =
+      early ? *early : encoder_output_indexes_;
+
   ncnn::Mat encoder_out;
-  encoder_ex->extract(encoder_output_indexes_[0], encoder_out);
+  encoder_ex->extract(output_indexes[0], encoder_out);
+
+  next_states->resize(num_layers_ * 4);
+  for (int32_t i = 1; i != output_indexes.size(); ++i) {
+    ncnn::Mat s;
+    encoder_ex->extract(output_indexes[i], s);
 
-  std::vector<ncnn::Mat> next_states(num_layers_ * 4);
-  for (int32_t i = 1; i != encoder_output_indexes_.size(); ++i) {
-    encoder_ex->extract(encoder_output_indexes_[i], next_states[i - 1]);
+    // The states are kept in the stream, so they must not refer to the
+    // memory pool of the model
+    CopyTo(s, &(*next_states)[i - 1]);
   }
 
-  return {encoder_out, next_states};
+  return Detach(encoder_out);
 }
 
 ncnn::Mat ConvEmformerModel::RunDecoder(ncnn::Mat &decoder_input) {
-  ncnn::Extractor decoder_ex = decoder_.create_extractor();
+  ncnn::Extractor decoder_ex = CreateExtractor(decoder_);
   return RunDecoder(decoder_input, &decoder_ex);
 }
 
@@ -124,14 +128,19 @@ ncnn::Mat ConvEmformerModel::RunDecoder(ncnn::Mat &decoder_input,
   ncnn::Mat decoder_out;
   decoder_ex->input(decoder_input_indexes_[0], decoder_input);
   decoder_ex->extract(decoder_output_indexes_[0], decoder_out);
-  decoder_out = decoder_out.reshape(decoder_out.w);
 
-  return decoder_out;
+  // decoder_out.h is 1 unless the contexts of several hypotheses are
+  // concatenated in decoder_input. See Model::RunDecoder2D()
+  if (decoder_out.h == 1) {
+    decoder_out = decoder_out.reshape(decoder_out.w);
+  }
+
+  return Detach(decoder_out);
 }
 
 ncnn::Mat ConvEmformerModel::RunJoiner(ncnn::Mat &encoder_out,
                                        ncnn::Mat &decoder_out) {
-  auto joiner_ex = joiner_.create_extractor();
+  auto joiner_ex = CreateExtractor(joiner_);
   return RunJoiner(encoder_out, decoder_out, &joiner_ex);
 }
 
@@ -146,6 +155,18 @@ ncnn::Mat ConvEmformerModel::RunJoiner(ncnn::Mat &encoder_out,
   return joiner_out;
 }
 
+ncnn::Mat ConvEmformerModel::RunJoinerRaw(ncnn::Mat &encoder_out,
+                                          ncnn::Mat &decoder_out) {
+  auto joiner_ex = CreateExtractor(joiner_);
+  joiner_ex.input(joiner_input_indexes_[0], encoder_out);
+  joiner_ex.input(joiner_input_indexes_[1], decoder_out);
+
+  // type 1: keep the storage precision and the packing
+  ncnn::Mat joiner_out;
+  joiner_ex.extract(joiner_output_indexes_[0], joiner_out, 1);
+  return joiner_out;
+}
+
 void ConvEmformerModel::InitEncoderPostProcessing() {
   // Now load parameters for member variables
   for (const auto *layer : encoder_.layers()) {
@@ -166,23 +187,25 @@ void ConvEmformerModel::InitEncoderPostProcessing() {
       break;
     }
   }
+
+  InitEncoderStateLayout();
 }
 
 void ConvEmformerModel::InitEncoder(const std::string &encoder_param,
                                     const std::string &encoder_bin) {
   RegisterCustomLayers(encoder_);
-  InitNet(encoder_, encoder_param, encoder_bin);
+  LoadNet(encoder_, encoder_param, encoder_bin);
   InitEncoderPostProcessing();
 }
 
 void ConvEmformerModel::InitDecoder(const std::string &decoder_param,
                                     const std::string &decoder_bin) {
-  InitNet(decoder_, decoder_param, decoder_bin);
+  LoadNet(decoder_, decoder_param, decoder_bin);
 }
 
 void ConvEmformerModel::InitJoiner(const std::string &joiner_param,
                                    const std::string &joiner_bin) {
-  InitNet(joiner_, joiner_param, joiner_bin);
+  LoadNet(joiner_, joiner_param, joiner_bin);
 }
 
 #if __ANDROID_API__ >= 9
@@ -4,6 +4,7 @@
 
 #ifndef SHERPA_NCNN_CSRC_CONV_EMFORMER_MODEL_H_
 #define SHERPA_NCNN_CSRC_CONV_EMFORMER_MODEL_H_
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -16,7 +17,11 @@ namespace sherpa_ncnn {
 // for how the model is converted from icefall to ncnn
 class ConvEmformerModel : public Model {
  public:
-  explicit ConvEmformerModel(const ModelConfig &config);
+  // If bundle is not nullptr, the .param and .bin fields of config are
+  // names of its sections
+  explicit ConvEmformerModel(
+      const ModelConfig &config,
+      std::shared_ptr<const ModelBundle> bundle = nullptr);
 #if __ANDROID_API__ >= 9
   ConvEmformerModel(AAssetManager *mgr, const ModelConfig &config);
 #endif
@@ -34,6 +39,11 @@ class ConvEmformerModel : public Model {
       ncnn::Mat &features, const std::vector<ncnn::Mat> &states,
       ncnn::Extractor *extractor) override;
 
+  ncnn::Mat RunEncoder(ncnn::Mat &features,
+                       const std::vector<ncnn::Mat> &states,
+                       ncnn::Extractor *extractor,
+                       std::vector<ncnn::Mat> *next_states) override;
+
   ncnn::Mat RunDecoder(ncnn::Mat &decoder_input) override;
 
   ncnn::Mat RunDecoder(ncnn::Mat &decoder_input,
@@ -44,6 +54,9 @@ class ConvEmformerModel : public Model {
   ncnn::Mat RunJoiner(ncnn::Mat &encoder_out, ncnn::Mat &decoder_out,
                       ncnn::Extractor *extractor) override;
 
+  ncnn::Mat RunJoinerRaw(ncnn::Mat &encoder_out,
+                         ncnn::Mat &decoder_out) override;
+
   int32_t Segment() const override {
     // chunk_length 32
     // right_context 8
@@ -0,0 +1,64 @@
+// sherpa-ncnn/csrc/decoder-cache.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/decoder-cache.h"
+
+#include <algorithm>
+
+#include "sherpa-ncnn/csrc/macros.h"
+
+namespace sherpa_ncnn {
+
+DecoderCache::DecoderCache(int32_t capacity, int32_t context_size)
+    : capacity_(capacity),
+      context_size_(context_size),
+      keys_(capacity * context_size),
+      values_(capacity) {
+  if (capacity <= 0) {
+    SHERPA_NCNN_LOGE("capacity should be positive. Given: %d", capacity);
+    SHERPA_NCNN_EXIT(-1);
+  }
+}
+
+int32_t DecoderCache::Slot(const int32_t *context) const {
+  // FNV-1a
+  uint64_t h = 14695981039346656037ULL;
+  for (int32_t i = 0; i != context_size_; ++i) {
+    h ^= static_cast<uint32_t>(context[i]);
+    h *= 1099511628211ULL;
+  }
+
+  return static_cast<int32_t>(h % capacity_);
+}
+
+ncnn::Mat DecoderCache::Get(const int32_t *context) const {
+  int32_t slot = Slot(context);
+  const int32_t *key = keys_.data() + slot * context_size_;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  const ncnn::Mat &value = values_[slot];
+  if (!value.empty() && std::equal(context, context + context_size_, key)) {
+    ++num_hits_;
+    return value;
+  }
+
+  ++num_misses_;
+  return {};
+}
+
+void DecoderCache::Put(const int32_t *context, const ncnn::Mat &decoder_out) {
+  int32_t slot = Slot(context);
+  int32_t *key = keys_.data() + slot * context_size_;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::copy(context, context + context_size_, key);
+  values_[slot] = decoder_out;
+}
+
+void DecoderCache::ResetCounters() {
+  num_hits_ = 0;
+  num_misses_ = 0;
+}
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,85 @@
+// sherpa-ncnn/csrc/decoder-cache.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_DECODER_CACHE_H_
+#define SHERPA_NCNN_CSRC_DECODER_CACHE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>  // NOLINT
+#include <vector>
+
+#include "mat.h"  // NOLINT
+
+namespace sherpa_ncnn {
+
+// The output of the decoder network depends only on the last context_size
+// tokens. This class caches decoder outputs keyed by those tokens so that
+// hypotheses and streams sharing the same context don't run the decoder
+// network again.
+//
+// It is a direct-mapped cache, i.e., each context can be stored in only
+// one slot and a newer entry replaces the older one in that slot.
+//
+// It is thread-safe and can be shared by all streams of a recognizer.
+class DecoderCache {
+ public:
+  /**
+   * @param capacity Number of entries in the cache. Must be positive.
+   * @param context_size Number of tokens in each context.
+   */
+  DecoderCache(int32_t capacity, int32_t context_size);
+
+  /** Look up the decoder output for the given context.
+   *
+   * @param context Pointer to an array of context_size tokens.
+   *
+   * @return Return the cached decoder output of shape (decoder_dim,).
+   *         Return an empty mat if there is no entry for this context.
+   */
+  ncnn::Mat Get(const int32_t *context) const;
+
+  /** Save the decoder output for the given context.
+   *
+   * @param context Pointer to an array of context_size tokens.
+   * @param decoder_out A mat of shape (decoder_dim,). It must own its data
+   *                    and it must not be modified after calling this
+   *                    function.
+   */
+  void Put(const int32_t *context, const ncnn::Mat &decoder_out);
+
+  int32_t Capacity() const { return capacity_; }
+
+  int32_t ContextSize() const { return context_size_; }
+
+  // Number of successful lookups since construction or the last call to
+  // ResetCounters()
+  int64_t NumHits() const { return num_hits_; }
+
+  // Number of failed lookups since construction or the last call to
+  // ResetCounters()
+  int64_t NumMisses() const { return num_misses_; }
+
+  void ResetCounters();
+
+ private:
+  int32_t Slot(const int32_t *context) const;
+
+ private:
+  int32_t capacity_;
+  int32_t context_size_;
+
+  mutable std::mutex mutex_;
+
+  // keys_[i*context_size_:(i+1)*context_size_] is the context of slot i
+  std::vector<int32_t> keys_;
+  std::vector<ncnn::Mat> values_;
+
+  mutable std::atomic<int64_t> num_hits_{0};
+  mutable std::atomic<int64_t> num_misses_{0};
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_DECODER_CACHE_H_
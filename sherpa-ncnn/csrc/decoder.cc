@@ -29,7 +29,18 @@ std::string DecoderConfig::ToString() const {
 
   os << "DecoderConfig(";
   os << "method=\"" << method << "\", ";
-  os << "num_active_paths=" << num_active_paths << ")";
+  os << "num_active_paths=" << num_active_paths << ", ";
+  os << "decoder_cache_size=" << decoder_cache_size << ", ";
+  os << "blank_skip_threshold=" << blank_skip_threshold << ", ";
+  os << "speculative_joiner=" << (speculative_joiner ? "True" : "False")
+     << ", ";
+  os << "token_shortlist=\"" << token_shortlist << "\", ";
+  os << "lm=\"" << lm << "\", ";
+  os << "lm_scale=" << lm_scale << ", ";
+  os << "beam=" << beam << ", ";
+  os << "min_active_paths=" << min_active_paths << ", ";
+  os << "hotwords_before_topk=" << (hotwords_before_topk ? "True" : "False")
+     << ")";
 
   return os.str();
 }
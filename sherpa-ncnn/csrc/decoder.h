@@ -27,12 +27,76 @@
 
 namespace sherpa_ncnn {
 
+// The context size of all transducer models we ship. The decoders use code
+// specialized for it, which keeps the decoder input on the stack, and fall
+// back to generic code for other sizes.
+constexpr int32_t kCommonContextSize = 2;
+
+// Copy the N tokens before end to p. N is known at compile time so that
+// the loop is unrolled.
+template <int32_t N>
+void CopyLastTokens(const int32_t *end, int32_t *p) {
+  for (int32_t i = 0; i != N; ++i) {
+    p[i] = end[i - N];
+  }
+}
+
 struct DecoderConfig {
   // supported values are: modified_beam_search, greedy_search
   std::string method = "greedy_search";
 
   int32_t num_active_paths = 4;  // only used by modified beam search
 
+  // Number of decoder outputs to cache. The cache is shared by all streams
+  // of a recognizer. Set it to 0 to disable the cache.
+  int32_t decoder_cache_size = 512;
+
+  // Used only by greedy search. If it is in the range [0.5, 1), the full
+  // joiner output is not computed for frames whose probability of blank is
+  // known to be at least this value. See joiner-blank-head.h.
+  // Set it to 0 to disable it.
+  float blank_skip_threshold = 0;
+
+  // Used only by greedy search without blank_skip_threshold. If true, the
+  // joiner is run for all remaining frames of a chunk at once with the
+  // current decoder output, and again only for the frames after the first
+  // one that emits a token. Chunks that are mostly blank then need one run
+  // of the joiner instead of one per frame. The results are the same.
+  bool speculative_joiner = false;
+
+  // Used only by modified beam search. If not empty, it is a text file with
+  // one token per line. Only these tokens and blank are scored by the
+  // joiner, which saves most of its cost for large vocabularies. See
+  // joiner-shortlist.h.
+  std::string token_shortlist;
+
+  // Used only by modified beam search. If not empty, it is a token-level
+  // n-gram LM, either an ARPA file or a file compiled from it by
+  // sherpa-ncnn-compile-lm, for shallow fusion. See ngram-lm.h.
+  std::string lm;
+
+  // The LM score is scaled by it before it is added to the score of
+  // a hypothesis.
+  float lm_scale = 0.3;
+
+  // Used only by modified beam search. If positive, paths whose log prob
+  // is more than beam below that of the best path are pruned before each
+  // frame, so the number of paths adapts to the margin of the best path:
+  // when it dominates, only min_active_paths of them are decoded.
+  // Set it to 0 to always keep num_active_paths paths.
+  float beam = 0;
+
+  // Used only if beam is positive. At least this many paths are kept.
+  int32_t min_active_paths = 1;
+
+  // Used only by modified beam search with hotwords. If true, the hotword
+  // score of each token is added to the joiner output before the best
+  // paths are selected, so hotwords can bring a token into the beam.
+  // Otherwise, it is added only to the selected paths. Only the tokens on
+  // an arc of the context state of a path have their own score, so the
+  // cost is small.
+  bool hotwords_before_topk = false;
+
   DecoderConfig() = default;
 
   DecoderConfig(const std::string &method, int32_t num_active_paths)
@@ -58,6 +122,23 @@ struct DecoderResult {
 
   // used only for modified_beam_search
   Hypotheses hyps;
+
+  // used only for keyword spotting. If not null, it is the node at which
+  // a detected keyword ends, and tokens and timestamps contain the tokens
+  // of the keyword only. No other keyword is detected until the caller
+  // clears it.
+  const ContextState *keyword = nullptr;
+
+  // Reset it to context_size blanks and no hypotheses. decoder_out and the
+  // memory of the vectors are kept.
+  void Clear(int32_t context_size) {
+    frame_offset = 0;
+    tokens.assign(context_size, 0);  // blank id is 0
+    num_trailing_blanks = 0;
+    timestamps.clear();
+    hyps.Clear();
+    keyword = nullptr;
+  }
 };
 
 class Stream;
@@ -74,6 +155,17 @@ class Decoder {
    */
   virtual DecoderResult GetEmptyResult() const = 0;
 
+  /* Reset r in place to an empty result, e.g., after an endpoint.
+   *
+   * Unlike GetEmptyResult(), r->decoder_out is kept, and subclasses reuse
+   * the memory r already holds.
+   */
+  virtual void ResetResult(DecoderResult *r) const {
+    ncnn::Mat decoder_out = r->decoder_out;
+    *r = GetEmptyResult();
+    r->decoder_out = decoder_out;
+  }
+
   /** Strip blanks added by `GetEmptyResult()`.
    *
    * @param r It is changed in-place.
@@ -95,6 +187,22 @@ class Decoder {
     NCNN_LOGE("Please override it!");
     exit(-1);
   }
+
+  /** Run the search for several streams, e.g., for a batch whose encoder
+   * outputs were computed together.
+   *
+   * @param encoder_out encoder_out[i] is the encoder output of results[i]
+   * @param results  Each of them is modified in-place.
+   * @param n  Number of streams.
+   *
+   * By default, the streams are decoded one by one.
+   */
+  virtual void DecodeBatch(ncnn::Mat *encoder_out, DecoderResult **results,
+                           int32_t n) {
+    for (int32_t i = 0; i != n; ++i) {
+      Decode(encoder_out[i], results[i]);
+    }
+  }
 };
 
 }  // namespace sherpa_ncnn
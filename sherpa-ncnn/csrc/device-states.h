@@ -0,0 +1,35 @@
+// sherpa-ncnn/csrc/device-states.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_DEVICE_STATES_H_
+#define SHERPA_NCNN_CSRC_DEVICE_STATES_H_
+
+#include <vector>
+
+#include "mat.h"  // NOLINT
+
+namespace sherpa_ncnn {
+
+/** The encoder states of a stream kept on the device of the model, e.g.,
+ * as ncnn::VkMat on a GPU with Vulkan, so that they are not copied between
+ * the host and the device for every chunk.
+ *
+ * They are created by Model::RunEncoderBatch() and owned by the stream.
+ * While a stream has them, they are its current states and
+ * Stream::GetStates() is out of date.
+ */
+class DeviceStates {
+ public:
+  virtual ~DeviceStates() = default;
+
+  /** Copy the states to the host, in the format of
+   * Model::GetEncoderInitStates(). A mat of states that has the same shape
+   * is written in place, so packed states stay packed.
+   */
+  virtual void Download(std::vector<ncnn::Mat> *states) const = 0;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_DEVICE_STATES_H_
@@ -0,0 +1,232 @@
+// sherpa-ncnn/csrc/encoder-state-layout.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/encoder-state-layout.h"
+
+#include <cstring>
+#include <map>
+#include <mutex>  // NOLINT
+
+#include "allocator.h"  // NOLINT
+#include "sherpa-ncnn/csrc/macros.h"
+
+namespace sherpa_ncnn {
+
+namespace {
+
+// The reference count is the first member, so the block of a view can be
+// found from the refcount pointer of the view
+struct Block {
+  int refcount = 0;
+  int32_t num_views = 0;
+  unsigned char *data = nullptr;
+  std::size_t num_bytes = 0;
+};
+
+/* The allocator of all views.
+ *
+ * ncnn frees a mat by passing its data pointer to the allocator once the
+ * reference count drops to 0. For a view, that pointer may point into the
+ * middle of the block, so blocks are registered by their start address.
+ * This happens once per block; lookups of views go through the refcount
+ * pointer instead and take no lock.
+ */
+class BlockAllocator : public ncnn::Allocator {
+ public:
+  Block *NewBlock(std::size_t num_bytes, int32_t num_views) {
+    auto *b = new Block;
+    b->num_views = num_views;
+    b->num_bytes = num_bytes;
+    b->data = static_cast<unsigned char *>(ncnn::fastMalloc(num_bytes));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    blocks_[b->data] = b;
+    return b;
+  }
+
+  // Views are never resized through this allocator, but follow the
+  // contract anyway
+  void *fastMalloc(std::size_t size) override {
+    return ncnn::fastMalloc(size);
+  }
+
+  void fastFree(void *ptr) override {
+    auto *p = static_cast<unsigned char *>(ptr);
+
+    Block *b = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = blocks_.upper_bound(p);
+      if (it != blocks_.begin()) {
+        --it;
+        if (p < it->first + it->second->num_bytes) {
+          b = it->second;
+          blocks_.erase(it);
+        }
+      }
+    }
+
+    if (!b) {
+      ncnn::fastFree(ptr);
+      return;
+    }
+
+    ncnn::fastFree(b->data);
+    delete b;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::map<const unsigned char *, Block *> blocks_;
+};
+
+BlockAllocator &GetBlockAllocator() {
+  // Never destroyed, since views may be released during static destruction
+  static auto *allocator = new BlockAllocator;
+  return *allocator;
+}
+
+std::size_t AlignSize(std::size_t n, std::size_t alignment) {
+  return (n + alignment - 1) / alignment * alignment;
+}
+
+bool SameShape(const ncnn::Mat &a, const ncnn::Mat &b) {
+  return a.dims == b.dims && a.w == b.w && a.h == b.h && a.d == b.d &&
+         a.c == b.c && a.elemsize == b.elemsize && a.elempack == b.elempack &&
+         a.cstep == b.cstep;
+}
+
+}  // namespace
+
+EncoderStateLayout::EncoderStateLayout(const std::vector<ncnn::Mat> &states) {
+  entries_.reserve(states.size());
+
+  std::size_t offset = 0;
+  for (const auto &m : states) {
+    if (m.elemsize != 4 || m.elempack != 1) {
+      SHERPA_NCNN_LOGE("Only float32 states are supported. Given %d bytes",
+                       static_cast<int32_t>(m.elemsize));
+      exit(-1);
+    }
+
+    entries_.push_back({m.dims, m.w, m.h, m.d, m.c, offset});
+    offset += AlignSize(m.total() * m.elemsize, kAlignment);
+  }
+
+  num_bytes_ = offset;
+}
+
+std::vector<ncnn::Mat> EncoderStateLayout::Allocate() const {
+  if (entries_.empty()) return {};
+
+  BlockAllocator &allocator = GetBlockAllocator();
+  Block *b = allocator.NewBlock(num_bytes_, entries_.size());
+
+  std::vector<ncnn::Mat> ans;
+  ans.reserve(entries_.size());
+
+  for (const auto &e : entries_) {
+    void *p = b->data + e.offset;
+
+    ncnn::Mat m;
+    switch (e.dims) {
+      case 1:
+        m = ncnn::Mat(e.w, p);
+        break;
+      case 2:
+        m = ncnn::Mat(e.w, e.h, p);
+        break;
+      case 3:
+        m = ncnn::Mat(e.w, e.h, e.c, p);
+        break;
+      default:
+        m = ncnn::Mat(e.w, e.h, e.d, e.c, p);
+        break;
+    }
+
+    // Turn the external mat into a refcounted one. The reference is
+    // dropped when m goes out of scope, after ans holds its own.
+    m.refcount = &b->refcount;
+    m.allocator = &allocator;
+    m.addref();
+
+    ans.push_back(m);
+  }
+
+  return ans;
+}
+
+std::vector<ncnn::Mat> EncoderStateLayout::Pack(
+    const std::vector<ncnn::Mat> &states) const {
+  if (entries_.empty()) return states;
+
+  std::vector<ncnn::Mat> ans = Allocate();
+  Copy(states, &ans);
+  return ans;
+}
+
+bool EncoderStateLayout::IsPacked(const std::vector<ncnn::Mat> &states) const {
+  if (entries_.empty() || states.size() != entries_.size()) return false;
+
+  const ncnn::Mat &first = states[0];
+  if (first.allocator != &GetBlockAllocator()) return false;
+
+  const auto *b = reinterpret_cast<const Block *>(first.refcount);
+  if (b->num_bytes != num_bytes_) return false;
+
+  for (std::size_t i = 0; i != states.size(); ++i) {
+    const ncnn::Mat &m = states[i];
+    if (m.refcount != first.refcount ||
+        m.data != b->data + entries_[i].offset) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void EncoderStateLayout::Copy(const std::vector<ncnn::Mat> &src,
+                              std::vector<ncnn::Mat> *dst) const {
+  if (entries_.empty()) {
+    *dst = src;
+    return;
+  }
+
+  if (!IsPacked(*dst) || !IsWritablePackedState((*dst)[0])) {
+    *dst = Allocate();
+  }
+
+  if (IsPacked(src)) {
+    if (src[0].data == (*dst)[0].data) return;
+
+    std::memcpy((*dst)[0].data, src[0].data, num_bytes_);
+    return;
+  }
+
+  if (src.size() != entries_.size()) {
+    SHERPA_NCNN_LOGE("Expected %d states. Given %d", NumStates(),
+                     static_cast<int32_t>(src.size()));
+    exit(-1);
+  }
+
+  for (std::size_t i = 0; i != src.size(); ++i) {
+    if (!SameShape(src[i], (*dst)[i])) {
+      SHERPA_NCNN_LOGE("The shape of state %d does not match the layout",
+                       static_cast<int32_t>(i));
+      exit(-1);
+    }
+
+    std::memcpy((*dst)[i].data, src[i].data,
+                src[i].total() * src[i].elemsize);
+  }
+}
+
+bool IsWritablePackedState(const ncnn::Mat &m) {
+  if (m.allocator != &GetBlockAllocator()) return false;
+
+  const auto *b = reinterpret_cast<const Block *>(m.refcount);
+  return b->refcount == b->num_views;
+}
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,90 @@
+// sherpa-ncnn/csrc/encoder-state-layout.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_ENCODER_STATE_LAYOUT_H_
+#define SHERPA_NCNN_CSRC_ENCODER_STATE_LAYOUT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "mat.h"  // NOLINT
+
+namespace sherpa_ncnn {
+
+/** A packed layout of the encoder states of one stream.
+ *
+ * All states live in one aligned block. Allocate() and Pack() return mats
+ * that are views into the block, one per state, in the order of
+ * Model::GetEncoderInitStates(). They are ordinary refcounted mats that can
+ * be passed to ncnn: the views of a block share one reference count and
+ * the block is freed with the last of them.
+ *
+ * Since the block is contiguous, copying the states of a stream, e.g., to
+ * save and restore them, or gathering the states of several streams into
+ * one batch is a single memcpy of NumBytes() bytes, starting at the data
+ * of the first view.
+ *
+ * The layout is computed once per model, see
+ * Model::GetEncoderStateLayout().
+ */
+class EncoderStateLayout {
+ public:
+  EncoderStateLayout() = default;
+
+  // Compute the layout from mats that have the shapes of the states,
+  // e.g., the output of Model::GetEncoderInitStates(). Only float32 mats
+  // with elempack 1 are supported.
+  explicit EncoderStateLayout(const std::vector<ncnn::Mat> &states);
+
+  bool Empty() const { return entries_.empty(); }
+
+  int32_t NumStates() const { return entries_.size(); }
+
+  // Size of a block. Each state starts at a multiple of kAlignment bytes.
+  std::size_t NumBytes() const { return num_bytes_; }
+
+  // Return views into a new block. Their content is not initialized.
+  std::vector<ncnn::Mat> Allocate() const;
+
+  // Return views into a new block that contains a copy of states, which
+  // must have the shapes of this layout. If the layout is empty, states is
+  // returned as it is.
+  std::vector<ncnn::Mat> Pack(const std::vector<ncnn::Mat> &states) const;
+
+  // Return true if states are exactly the views of one block of this
+  // layout
+  bool IsPacked(const std::vector<ncnn::Mat> &states) const;
+
+  // Copy the content of src into the memory of *dst. If both are packed,
+  // it is a single memcpy. If *dst is not packed or its block is shared
+  // with other mats, it becomes Pack(src). If the layout is empty, *dst
+  // becomes src.
+  void Copy(const std::vector<ncnn::Mat> &src,
+            std::vector<ncnn::Mat> *dst) const;
+
+  static constexpr std::size_t kAlignment = 64;
+
+ private:
+  struct Entry {
+    int32_t dims;
+    int32_t w;
+    int32_t h;
+    int32_t d;
+    int32_t c;
+    std::size_t offset;  // in bytes from the start of the block
+  };
+
+  std::vector<Entry> entries_;
+  std::size_t num_bytes_ = 0;
+};
+
+// Return true if m is a view created by EncoderStateLayout and no mat
+// except the views of its block refers to the block, so that writing to m
+// changes no other mat
+bool IsWritablePackedState(const ncnn::Mat &m);
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_ENCODER_STATE_LAYOUT_H_
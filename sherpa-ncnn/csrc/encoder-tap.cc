@@ -0,0 +1,63 @@
+// sherpa-ncnn/csrc/encoder-tap.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/encoder-tap.h"
+
+#include <algorithm>
+#include <atomic>
+#include <utility>
+
+namespace sherpa_ncnn {
+
+int32_t EncoderTaps::Add(EncoderTap tap, bool with_features) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto taps = std::make_shared<std::vector<Entry>>();
+  if (taps_) {
+    *taps = *taps_;
+  }
+
+  int32_t id = next_id_++;
+
+  Entry e;
+  e.id = id;
+  e.tap = std::move(tap);
+  e.with_features = with_features;
+  taps->push_back(std::move(e));
+
+  std::atomic_store(&taps_,
+                    std::shared_ptr<const std::vector<Entry>>(std::move(taps)));
+
+  return id;
+}
+
+bool EncoderTaps::Remove(int32_t id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!taps_) {
+    return false;
+  }
+
+  auto taps = std::make_shared<std::vector<Entry>>(*taps_);
+  auto it = std::find_if(taps->begin(), taps->end(),
+                         [id](const Entry &e) { return e.id == id; });
+  if (it == taps->end()) {
+    return false;
+  }
+  taps->erase(it);
+
+  std::shared_ptr<const std::vector<Entry>> ans;
+  if (!taps->empty()) {
+    ans = std::move(taps);
+  }
+  std::atomic_store(&taps_, std::move(ans));
+
+  return true;
+}
+
+std::shared_ptr<const std::vector<EncoderTaps::Entry>> EncoderTaps::Get()
+    const {
+  return std::atomic_load(&taps_);
+}
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,92 @@
+// sherpa-ncnn/csrc/encoder-tap.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_ENCODER_TAP_H_
+#define SHERPA_NCNN_CSRC_ENCODER_TAP_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <vector>
+
+#include "mat.h"  // NOLINT
+
+namespace sherpa_ncnn {
+
+/** One encoded chunk of a stream, passed to the taps of
+ * Recognizer::AddEncoderTap() and Stream::SetEncoderTap(), e.g., for an
+ * intent or keyword head that reuses the encoder of the recognizer
+ * instead of running a model of its own on the same audio.
+ *
+ * The mats are those that the recognizer decodes; nothing is copied. They
+ * are reference counted, so a tap can keep a chunk, e.g., to pass it to
+ * another thread, by copying the mats. A kept mat holds memory of the
+ * model, e.g., of ModelConfig::use_pool_allocator, until it is released.
+ * The mats must not be modified.
+ */
+struct EncoderChunk {
+  // See Stream::GetId()
+  int64_t stream_id = 0;
+
+  // The index of the first feature frame of the chunk, i.e.,
+  // Stream::GetNumProcessedFrames() before the chunk
+  int32_t start_frame = 0;
+
+  // Number of feature frames of the chunk, i.e., Model::Offset()
+  int32_t num_frames = 0;
+
+  // The encoder output of shape (num_frames / subsampling factor,
+  // encoder_dim), i.e., w is encoder_dim
+  ncnn::Mat encoder_out;
+
+  /** Empty unless the tap asked for features. The input of the encoder,
+   * of shape (Model::Segment(), feature_dim): the num_frames frames of the
+   * chunk followed by the right context, which are also the first frames
+   * of the next chunk. Frames after the end of a finished stream are
+   * padding.
+   */
+  ncnn::Mat features;
+};
+
+// It is called on the thread that decodes the stream, after the encoder
+// and before the search of the chunk, so it should return quickly.
+using EncoderTap = std::function<void(const EncoderChunk &chunk)>;
+
+/** The taps of a recognizer, see Recognizer::AddEncoderTap().
+ *
+ * Add() and Remove() may be called from any thread, also while streams
+ * are decoded. Get() is lock-free. A chunk is passed to the taps that
+ * were registered when it was encoded, so a tap may still be called once
+ * on another thread after Remove() has returned.
+ */
+class EncoderTaps {
+ public:
+  struct Entry {
+    int32_t id = 0;
+    EncoderTap tap;
+    bool with_features = false;
+  };
+
+  // Return the id of the tap for Remove()
+  int32_t Add(EncoderTap tap, bool with_features);
+
+  // Return false if there is no tap with the given id
+  bool Remove(int32_t id);
+
+  // Return nullptr if there are no taps
+  std::shared_ptr<const std::vector<Entry>> Get() const;
+
+ private:
+  // Serializes Add() and Remove()
+  std::mutex mutex_;
+  int32_t next_id_ = 1;
+
+  // Replaced by Add() and Remove() and read with std::atomic_load()
+  std::shared_ptr<const std::vector<Entry>> taps_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_ENCODER_TAP_H_
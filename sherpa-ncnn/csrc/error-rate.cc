@@ -0,0 +1,111 @@
+// sherpa-ncnn/csrc/error-rate.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/error-rate.h"
+
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/text-utils.h"
+
+namespace sherpa_ncnn {
+
+std::string ErrorStats::ToString() const {
+  std::ostringstream os;
+  os << "ErrorStats(";
+  os << "num_ref=" << num_ref << ", ";
+  os << "num_sub=" << num_sub << ", ";
+  os << "num_del=" << num_del << ", ";
+  os << "num_ins=" << num_ins << ")";
+  return os.str();
+}
+
+ErrorStats ComputeErrorStats(const std::vector<std::string> &ref,
+                             const std::vector<std::string> &hyp) {
+  int32_t n = ref.size();
+  int32_t m = hyp.size();
+
+  // d[i * (m + 1) + j] is the distance between the first i words of ref
+  // and the first j words of hyp
+  std::vector<int32_t> d((n + 1) * (m + 1));
+  auto at = [&d, m](int32_t i, int32_t j) -> int32_t & {
+    return d[i * (m + 1) + j];
+  };
+
+  for (int32_t i = 0; i <= n; ++i) {
+    at(i, 0) = i;
+  }
+
+  for (int32_t j = 0; j <= m; ++j) {
+    at(0, j) = j;
+  }
+
+  for (int32_t i = 1; i <= n; ++i) {
+    for (int32_t j = 1; j <= m; ++j) {
+      int32_t sub = at(i - 1, j - 1) + (ref[i - 1] != hyp[j - 1]);
+      at(i, j) = std::min({sub, at(i - 1, j) + 1, at(i, j - 1) + 1});
+    }
+  }
+
+  ErrorStats ans;
+  ans.num_ref = n;
+
+  // Walk back along one of the best alignments
+  int32_t i = n;
+  int32_t j = m;
+  while (i > 0 || j > 0) {
+    if (i > 0 && j > 0 &&
+        at(i, j) == at(i - 1, j - 1) + (ref[i - 1] != hyp[j - 1])) {
+      ans.num_sub += ref[i - 1] != hyp[j - 1];
+      --i;
+      --j;
+    } else if (i > 0 && at(i, j) == at(i - 1, j) + 1) {
+      ++ans.num_del;
+      --i;
+    } else {
+      ++ans.num_ins;
+      --j;
+    }
+  }
+
+  return ans;
+}
+
+std::vector<std::string> SplitWordsForErrorRate(const std::string &text) {
+  return SplitUtf8(ToLowerCase(text));
+}
+
+std::vector<std::string> SplitCharsForErrorRate(const std::string &text) {
+  std::string s = ToLowerCase(text);
+
+  std::vector<std::string> ans;
+  int32_t n = s.size();
+  for (int32_t i = 0; i < n;) {
+    uint8_t c = s[i];
+
+    // Length of the UTF-8 sequence from its first byte. An invalid byte is
+    // a character of its own.
+    int32_t len = 1;
+    if ((c & 0xe0) == 0xc0) {
+      len = 2;
+    } else if ((c & 0xf0) == 0xe0) {
+      len = 3;
+    } else if ((c & 0xf8) == 0xf0) {
+      len = 4;
+    }
+    len = std::min(len, n - i);
+
+    if (len != 1 || !std::isspace(c)) {
+      ans.push_back(s.substr(i, len));
+    }
+    i += len;
+  }
+
+  return ans;
+}
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,63 @@
+// sherpa-ncnn/csrc/error-rate.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_ERROR_RATE_H_
+#define SHERPA_NCNN_CSRC_ERROR_RATE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace sherpa_ncnn {
+
+// Errors of a hypothesis against a reference, e.g., for computing the
+// word error rate. It can be summed up over utterances.
+struct ErrorStats {
+  // Number of words of the reference
+  int64_t num_ref = 0;
+
+  int64_t num_sub = 0;
+  int64_t num_del = 0;
+  int64_t num_ins = 0;
+
+  int64_t NumErrors() const { return num_sub + num_del + num_ins; }
+
+  // Errors divided by the length of the reference. If the reference is
+  // empty, it is 0 without any insertions and 1 otherwise.
+  double Rate() const {
+    if (num_ref == 0) {
+      return num_ins == 0 ? 0 : 1;
+    }
+    return static_cast<double>(NumErrors()) / num_ref;
+  }
+
+  ErrorStats &operator+=(const ErrorStats &other) {
+    num_ref += other.num_ref;
+    num_sub += other.num_sub;
+    num_del += other.num_del;
+    num_ins += other.num_ins;
+    return *this;
+  }
+
+  std::string ToString() const;
+};
+
+// Align hyp to ref with the Levenshtein distance and count the errors
+ErrorStats ComputeErrorStats(const std::vector<std::string> &ref,
+                             const std::vector<std::string> &hyp);
+
+/** Split text into words for the word error rate after converting it to
+ * lower case. Like SplitUtf8(), letters of English words are kept together
+ * and each Chinese character is a word of its own, so that the rate of
+ * mixed Chinese and English text is the usual "mixed error rate".
+ */
+std::vector<std::string> SplitWordsForErrorRate(const std::string &text);
+
+// Split text into UTF-8 characters for the character error rate after
+// converting it to lower case. Whitespace is dropped.
+std::vector<std::string> SplitCharsForErrorRate(const std::string &text);
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_ERROR_RATE_H_
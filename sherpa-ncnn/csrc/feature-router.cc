@@ -0,0 +1,112 @@
+// sherpa-ncnn/csrc/feature-router.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/feature-router.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace sherpa_ncnn {
+
+class FeatureRouter::Impl {
+ public:
+  explicit Impl(const FeatureExtractorConfig &config)
+      : config_(config), extractor_(config) {}
+
+  void AddStream(Stream *s) {
+    // It switches s to external frames even if none is ready yet
+    s->AcceptFrames(nullptr, 0, config_.feature_dim);
+    if (input_finished_) {
+      s->InputFinished();
+    }
+
+    streams_.push_back(s);
+  }
+
+  void RemoveStream(Stream *s) {
+    streams_.erase(std::remove(streams_.begin(), streams_.end(), s),
+                   streams_.end());
+  }
+
+  int32_t NumStreams() const { return streams_.size(); }
+
+  void AcceptWaveform(int32_t sampling_rate, const float *waveform,
+                      int32_t n) {
+    extractor_.AcceptWaveform(sampling_rate, waveform, n);
+    Flush();
+  }
+
+  void AcceptWaveformInt16(int32_t sampling_rate, const int16_t *waveform,
+                           int32_t n) {
+    extractor_.AcceptWaveformInt16(sampling_rate, waveform, n);
+    Flush();
+  }
+
+  void InputFinished() {
+    extractor_.InputFinished();
+    Flush();
+
+    input_finished_ = true;
+    for (auto s : streams_) {
+      s->InputFinished();
+    }
+  }
+
+  int32_t NumFramesReady() const { return num_frames_; }
+
+ private:
+  // Move the new frames of extractor_ to the streams
+  void Flush() {
+    int32_t n = extractor_.NumFramesReady() - num_frames_;
+    if (n <= 0) {
+      return;
+    }
+
+    ncnn::Mat frames = extractor_.GetFrames(num_frames_, n);
+    num_frames_ += n;
+
+    for (auto s : streams_) {
+      s->AcceptFrames(static_cast<const float *>(frames), n, frames.w);
+    }
+  }
+
+ private:
+  FeatureExtractorConfig config_;
+  FeatureExtractor extractor_;
+  std::vector<Stream *> streams_;
+
+  // Number of frames passed to the streams so far
+  int32_t num_frames_ = 0;
+  bool input_finished_ = false;
+};
+
+FeatureRouter::FeatureRouter(const FeatureExtractorConfig &config)
+    : impl_(std::make_unique<Impl>(config)) {}
+
+FeatureRouter::~FeatureRouter() = default;
+
+void FeatureRouter::AddStream(Stream *s) { impl_->AddStream(s); }
+
+void FeatureRouter::RemoveStream(Stream *s) { impl_->RemoveStream(s); }
+
+int32_t FeatureRouter::NumStreams() const { return impl_->NumStreams(); }
+
+void FeatureRouter::AcceptWaveform(int32_t sampling_rate,
+                                   const float *waveform, int32_t n) {
+  impl_->AcceptWaveform(sampling_rate, waveform, n);
+}
+
+void FeatureRouter::AcceptWaveformInt16(int32_t sampling_rate,
+                                        const int16_t *waveform, int32_t n) {
+  impl_->AcceptWaveformInt16(sampling_rate, waveform, n);
+}
+
+void FeatureRouter::InputFinished() { impl_->InputFinished(); }
+
+int32_t FeatureRouter::NumFramesReady() const {
+  return impl_->NumFramesReady();
+}
+
+}  // namespace sherpa_ncnn
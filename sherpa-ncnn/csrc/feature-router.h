@@ -0,0 +1,75 @@
+// sherpa-ncnn/csrc/feature-router.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_FEATURE_ROUTER_H_
+#define SHERPA_NCNN_CSRC_FEATURE_ROUTER_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "sherpa-ncnn/csrc/features.h"
+#include "sherpa-ncnn/csrc/stream.h"
+
+namespace sherpa_ncnn {
+
+/** Compute the fbank of one input once and feed it to the streams of
+ * several models, e.g., a language identification model and the ASR models
+ * of the candidate languages, see Stream::AcceptFrames().
+ *
+ * The models must use the same FeatureExtractorConfig. Each stream is
+ * decoded by its own recognizer as usual. Once a model is not needed any
+ * more, e.g., after the language is known, remove its stream so that it
+ * is no longer fed and stop decoding it.
+ *
+ * Usage:
+ *
+ *   FeatureRouter router(feat_config);
+ *   auto lid = lid_recognizer.CreateStream();
+ *   auto asr = asr_recognizer.CreateStream();
+ *   router.AddStream(lid.get());
+ *   router.AddStream(asr.get());
+ *
+ *   router.AcceptWaveform(16000, samples, n);
+ *   while (lid_recognizer.IsReady(lid.get())) ...
+ *   while (asr_recognizer.IsReady(asr.get())) ...
+ *
+ * It is not thread-safe. Decode the streams on the thread that feeds the
+ * router, or lock around both.
+ */
+class FeatureRouter {
+ public:
+  explicit FeatureRouter(const FeatureExtractorConfig &config);
+  ~FeatureRouter();
+
+  /** Feed the frames computed from now on to s. s must not have accepted
+   * any waveform. It is not owned.
+   */
+  void AddStream(Stream *s);
+
+  // Stop feeding s. It can be freed afterwards.
+  void RemoveStream(Stream *s);
+
+  int32_t NumStreams() const;
+
+  // See FeatureExtractor::AcceptWaveform()
+  void AcceptWaveform(int32_t sampling_rate, const float *waveform, int32_t n);
+
+  // See FeatureExtractor::AcceptWaveformInt16()
+  void AcceptWaveformInt16(int32_t sampling_rate, const int16_t *waveform,
+                           int32_t n);
+
+  // Flush the last frames and call InputFinished() of all streams
+  void InputFinished();
+
+  // Number of frames computed so far
+  int32_t NumFramesReady() const;
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_FEATURE_ROUTER_H_
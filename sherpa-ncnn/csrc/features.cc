@@ -19,12 +19,16 @@
 #include "sherpa-ncnn/csrc/features.h"
 
 #include <algorithm>
+#include <atomic>
 #include <memory>
 #include <mutex>  // NOLINT
 #include <vector>
 
 #include "kaldi-native-fbank/csrc/online-feature.h"
 #include "mat.h"  // NOLINT
+#include "sherpa-ncnn/csrc/batch-fbank.h"
+#include "sherpa-ncnn/csrc/frame-ring.h"
+#include "sherpa-ncnn/csrc/pcm-utils.h"
 #include "sherpa-ncnn/csrc/resample.h"
 
 namespace sherpa_ncnn {
@@ -51,6 +55,26 @@ void FeatureExtractorConfig::Register(ParseOptions *po) {
                "By default the audio samples are in range [-1,+1], "
                "so 0.00003 is a good value, "
                "equivalent to the default 1.0 from kaldi");
+
+  po->Register("feat-lock-free", &lock_free,
+               "True to hand over feature frames through a lock-free "
+               "single-producer/single-consumer queue. Only one thread may "
+               "call AcceptWaveform()/InputFinished() and only one thread "
+               "may read frames from a stream");
+
+  po->Register("feat-use-batch-fbank", &use_batch_fbank,
+               "True to compute fbank features of all streams passed to "
+               "DecodeStreams() in one batch. Cannot be used with "
+               "--feat-lock-free");
+
+  po->Register("feat-use-vulkan-fbank", &use_vulkan_fbank,
+               "True to compute the batched fbank features of many streams "
+               "on the GPU with Vulkan. Requires --feat-use-batch-fbank");
+
+  po->Register("feat-storage", &feature_storage,
+               "Used only by non-streaming models. How feature frames are "
+               "kept until a stream is decoded: fp32, fp16, or int8. fp16 "
+               "and int8 need less memory for streams waiting in a queue");
 }
 
 std::string FeatureExtractorConfig::ToString() const {
@@ -58,14 +82,29 @@ std::string FeatureExtractorConfig::ToString() const {
 
   os << "FeatureExtractorConfig(";
   os << "sampling_rate=" << sampling_rate << ", ";
-  os << "feature_dim=" << feature_dim << ")";
+  os << "feature_dim=" << feature_dim << ", ";
+  os << "lock_free=" << (lock_free ? "True" : "False") << ", ";
+  os << "use_batch_fbank=" << (use_batch_fbank ? "True" : "False") << ", ";
+  os << "use_vulkan_fbank=" << (use_vulkan_fbank ? "True" : "False") << ", ";
+  os << "feature_storage=\"" << feature_storage << "\")";
 
   return os.str();
 }
 
 class FeatureExtractor::Impl {
  public:
-  explicit Impl(const FeatureExtractorConfig &config) {
+  explicit Impl(const FeatureExtractorConfig &config)
+      : lock_free_(config.lock_free) {
+    if (config.lock_free && config.use_batch_fbank) {
+      NCNN_LOGE("lock_free and use_batch_fbank cannot both be true");
+      exit(-1);
+    }
+
+    if (config.use_vulkan_fbank && !config.use_batch_fbank) {
+      NCNN_LOGE("use_vulkan_fbank requires use_batch_fbank");
+      exit(-1);
+    }
+
     opts_.frame_opts.dither = 0;
     opts_.frame_opts.snip_edges = false;
     opts_.frame_opts.samp_freq = config.sampling_rate;
@@ -78,11 +117,203 @@ class FeatureExtractor::Impl {
     // https://github.com/k2-fsa/sherpa-onnx/issues/514
     opts_.mel_opts.high_freq = -400;
 
+    if (config.use_batch_fbank) {
+      batch_fbank_ =
+          std::make_unique<BatchFbank>(opts_, config.use_vulkan_fbank);
+      feature_dim_ = batch_fbank_->Dim();
+      ring_ = std::make_unique<FrameRing>(feature_dim_);
+      return;
+    }
+
     fbank_ = std::make_unique<knf::OnlineFbank>(opts_);
+    feature_dim_ = fbank_->Dim();
+
+    if (lock_free_) {
+      head_ = new FrameBlock(feature_dim_);
+      tail_ = head_;
+      return;
+    }
+
+    ring_ = std::make_unique<FrameRing>(feature_dim_);
+  }
+
+  ~Impl() {
+    while (head_) {
+      FrameBlock *next = head_->next;
+      delete head_;
+      head_ = next;
+    }
   }
 
   void AcceptWaveform(int32_t sampling_rate, const float *waveform, int32_t n) {
+    if (lock_free_) {
+      AcceptWaveformImpl(sampling_rate, waveform, n);
+      PublishFrames();
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    AcceptWaveformImpl(sampling_rate, waveform, n);
+    MoveFrames();
+  }
+
+  void AcceptWaveformInt16(int32_t sampling_rate, const int16_t *waveform,
+                           int32_t n) {
+    constexpr float kScale = 1.0f / 32768;
+
+    if (lock_free_) {
+      int16_samples_.resize(n);
+      Int16ToFloat(waveform, n, kScale, int16_samples_.data());
+      AcceptWaveformImpl(sampling_rate, int16_samples_.data(), n);
+      PublishFrames();
+      return;
+    }
+
     std::lock_guard<std::mutex> lock(mutex_);
+    if (batch_fbank_ && !resampler_ &&
+        sampling_rate == opts_.frame_opts.samp_freq) {
+      size_t size = waveform_.size();
+      waveform_.resize(size + n);
+      Int16ToFloat(waveform, n, kScale, waveform_.data() + size);
+      return;
+    }
+
+    int16_samples_.resize(n);
+    Int16ToFloat(waveform, n, kScale, int16_samples_.data());
+    AcceptWaveformImpl(sampling_rate, int16_samples_.data(), n);
+    MoveFrames();
+  }
+
+  void InputFinished() {
+    if (lock_free_) {
+      fbank_->InputFinished();
+      PublishFrames();
+      input_finished_.store(true, std::memory_order_release);
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (batch_fbank_) {
+      input_finished_.store(true, std::memory_order_relaxed);
+      return;
+    }
+
+    fbank_->InputFinished();
+    MoveFrames();
+  }
+
+  int32_t NumFramesReady() const {
+    if (lock_free_) {
+      return num_published_.load(std::memory_order_acquire);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (batch_fbank_) {
+      return NumBatchFramesReady();
+    }
+
+    return fbank_->NumFramesReady();
+  }
+
+  bool IsLastFrame(int32_t frame) const {
+    if (lock_free_) {
+      // Load input_finished_ first so that num_published_ already includes
+      // the frames flushed by InputFinished()
+      return input_finished_.load(std::memory_order_acquire) &&
+             frame == num_published_.load(std::memory_order_acquire) - 1;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (batch_fbank_) {
+      return input_finished_.load(std::memory_order_relaxed) &&
+             frame == NumBatchFramesReady() - 1;
+    }
+
+    return fbank_->IsLastFrame(frame);
+  }
+
+  ncnn::Mat GetFrames(int32_t frame_index, int32_t n) {
+    if (lock_free_) {
+      return GetPublishedFrames(frame_index, n);
+    }
+
+    if (batch_fbank_) {
+      Impl *self = this;
+      ComputeFeatures(&self, 1);
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      return ring_->View(frame_index, n);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ring_->View(frame_index, n);
+  }
+
+  bool IsBatchMode() const { return batch_fbank_ != nullptr; }
+
+  // impls[i]->batch_fbank_ must not be null
+  static void ComputeFeatures(Impl **impls, int32_t n) {
+    if (n == 0) return;
+
+    // All streams of a recognizer share the same options. Streams that
+    // differ from the first one are computed on their own.
+    const BatchFbank &fbank = *impls[0]->batch_fbank_;
+
+    struct Pending {
+      Impl *impl;
+      int32_t first_frame;
+      int32_t num_frames;
+    };
+
+    std::vector<Pending> pending;
+    pending.reserve(n);
+
+    std::vector<float> windows;
+    std::vector<float> window;
+    int32_t window_size = fbank.PaddedWindowSize();
+
+    for (int32_t i = 0; i != n; ++i) {
+      Impl *impl = impls[i];
+      if (i != 0 && !impl->IsCompatible(fbank)) {
+        ComputeFeatures(&impl, 1);
+        continue;
+      }
+
+      std::lock_guard<std::mutex> lock(impl->mutex_);
+      int32_t first_frame = impl->NumComputedFrames();
+      int32_t num_frames = impl->NumBatchFramesReady() - first_frame;
+      if (num_frames <= 0) continue;
+
+      // Samples are discarded only after the frames are appended, so a
+      // concurrent AcceptWaveform() cannot invalidate these windows
+      for (int32_t f = 0; f != num_frames; ++f) {
+        impl->batch_fbank_->ExtractWindow(impl->waveform_offset_,
+                                          impl->waveform_, first_frame + f,
+                                          &window);
+        windows.insert(windows.end(), window.begin(),
+                       window.begin() + window_size);
+      }
+
+      pending.push_back({impl, first_frame, num_frames});
+    }
+
+    if (pending.empty()) return;
+
+    int32_t total_frames = windows.size() / window_size;
+    std::vector<float> features(total_frames * fbank.Dim());
+    fbank.Compute(windows.data(), total_frames, features.data());
+
+    const float *p = features.data();
+    for (const auto &e : pending) {
+      std::lock_guard<std::mutex> lock(e.impl->mutex_);
+      e.impl->AppendFrames(e.first_frame, e.num_frames, p);
+      p += e.num_frames * fbank.Dim();
+    }
+  }
+
+ private:
+  void AcceptWaveformImpl(int32_t sampling_rate, const float *waveform,
+                          int32_t n) {
     if (resampler_) {
       if (sampling_rate != resampler_->GetInputSamplingRate()) {
         NCNN_LOGE(
@@ -92,10 +323,8 @@ class FeatureExtractor::Impl {
         exit(-1);
       }
 
-      std::vector<float> samples;
-      resampler_->Resample(waveform, n, false, &samples);
-      fbank_->AcceptWaveform(opts_.frame_opts.samp_freq, samples.data(),
-                             samples.size());
+      resampler_->Resample(waveform, n, false, &resampled_);
+      AcceptSamples(resampled_.data(), resampled_.size());
       return;
     }
 
@@ -115,54 +344,164 @@ class FeatureExtractor::Impl {
           sampling_rate, opts_.frame_opts.samp_freq, lowpass_cutoff,
           lowpass_filter_width);
 
-      std::vector<float> samples;
-      resampler_->Resample(waveform, n, false, &samples);
-      fbank_->AcceptWaveform(opts_.frame_opts.samp_freq, samples.data(),
-                             samples.size());
+      resampler_->Resample(waveform, n, false, &resampled_);
+      AcceptSamples(resampled_.data(), resampled_.size());
       return;
     }
 
-    fbank_->AcceptWaveform(sampling_rate, waveform, n);
+    AcceptSamples(waveform, n);
   }
 
-  void InputFinished() {
-    std::lock_guard<std::mutex> lock(mutex_);
-    fbank_->InputFinished();
+  void AcceptSamples(const float *samples, int32_t n) {
+    if (batch_fbank_) {
+      waveform_.insert(waveform_.end(), samples, samples + n);
+      return;
+    }
+
+    fbank_->AcceptWaveform(opts_.frame_opts.samp_freq, samples, n);
   }
 
-  int32_t NumFramesReady() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return fbank_->NumFramesReady();
+  // Move the frames that fbank_ has computed into ring_. The caller must
+  // hold mutex_.
+  void MoveFrames() {
+    if (batch_fbank_) return;
+
+    int32_t num_ready = fbank_->NumFramesReady();
+    int32_t num_moved = ring_->NumFrames();
+    for (int32_t i = num_moved; i != num_ready; ++i) {
+      ring_->Push(fbank_->GetFrame(i));
+    }
+
+    fbank_->Pop(num_ready - num_moved);
   }
 
-  bool IsLastFrame(int32_t frame) const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return fbank_->IsLastFrame(frame);
+  // The following methods are used only if batch_fbank_ is not null.
+  // The caller must hold mutex_.
+  int32_t NumBatchFramesReady() const {
+    return knf::NumFrames(waveform_offset_ + waveform_.size(),
+                          opts_.frame_opts,
+                          input_finished_.load(std::memory_order_relaxed));
   }
 
-  ncnn::Mat GetFrames(int32_t frame_index, int32_t n) {
+  int32_t NumComputedFrames() const { return ring_->NumFrames(); }
+
+  bool IsCompatible(const BatchFbank &fbank) const {
+    return batch_fbank_->Dim() == fbank.Dim() &&
+           batch_fbank_->PaddedWindowSize() == fbank.PaddedWindowSize() &&
+           opts_.frame_opts.samp_freq ==
+               fbank.GetOptions().frame_opts.samp_freq;
+  }
+
+  void AppendFrames(int32_t first_frame, int32_t num_frames,
+                    const float *features) {
+    // GetFrames() may have computed some of them in the meantime
+    int32_t skip = NumComputedFrames() - first_frame;
+    for (int32_t i = skip; i < num_frames; ++i) {
+      ring_->Push(features + i * feature_dim_);
+    }
+
+    // Discard samples that are not needed by any future frame
+    int64_t first_sample =
+        knf::FirstSampleOfFrame(NumComputedFrames(), opts_.frame_opts);
+    int64_t discard = std::min<int64_t>(first_sample - waveform_offset_,
+                                        waveform_.size());
+    if (discard > 0) {
+      waveform_.erase(waveform_.begin(), waveform_.begin() + discard);
+      waveform_offset_ += discard;
+    }
+  }
+
+  std::size_t NumBytes() const {
+    if (lock_free_) {
+      // Blocks from head_ to the one of the last published frame
+      int32_t num_published = num_published_.load(std::memory_order_acquire);
+      int32_t num_blocks =
+          (num_published - head_frame_index_) / kFramesPerBlock + 1;
+      return static_cast<std::size_t>(num_blocks) * kFramesPerBlock *
+             feature_dim_ * sizeof(float);
+    }
+
     std::lock_guard<std::mutex> lock(mutex_);
-    if (frame_index + n > fbank_->NumFramesReady()) {
-      NCNN_LOGE("%d + %d > %d", frame_index, n, fbank_->NumFramesReady());
+    std::size_t ans =
+        (resampled_.capacity() + int16_samples_.capacity()) * sizeof(float);
+
+    if (batch_fbank_) {
+      ans += waveform_.capacity() * sizeof(float);
+    }
+
+    return ans + ring_->NumBytes();
+  }
+
+  // Producer side of the lock-free mode.
+  //
+  // Moves frames that fbank_ has computed since the last call into the
+  // block list and makes them visible to the consumer. Only the producer
+  // touches fbank_ and tail_.
+  void PublishFrames() {
+    int32_t num_ready = fbank_->NumFramesReady();
+    int32_t num_published = num_published_.load(std::memory_order_relaxed);
+
+    for (int32_t i = num_published; i != num_ready; ++i) {
+      int32_t slot = i % kFramesPerBlock;
+      if (slot == 0 && i != 0) {
+        // The consumer follows this pointer only for frames it has seen
+        // through num_published_, so the release store below is enough
+        // to make the link visible.
+        tail_->next = new FrameBlock(feature_dim_);
+        tail_ = tail_->next;
+      }
+
+      const float *f = fbank_->GetFrame(i);
+      std::copy(f, f + feature_dim_,
+                tail_->data.data() + slot * feature_dim_);
+    }
+
+    fbank_->Pop(num_ready - num_published);
+
+    num_published_.store(num_ready, std::memory_order_release);
+  }
+
+  // Consumer side of the lock-free mode. Only the consumer touches
+  // head_, head_frame_index_ and last_frame_index_.
+  ncnn::Mat GetPublishedFrames(int32_t frame_index, int32_t n) {
+    int32_t num_published = num_published_.load(std::memory_order_acquire);
+    if (frame_index + n > num_published) {
+      NCNN_LOGE("%d + %d > %d", frame_index, n, num_published);
       exit(-1);
     }
 
-    int32_t discard_num = frame_index - last_frame_index_;
-    if (discard_num < 0) {
+    if (frame_index < last_frame_index_) {
       NCNN_LOGE("last_frame_index_: %d, frame_index_: %d", last_frame_index_,
                 frame_index);
       exit(-1);
     }
 
-    fbank_->Pop(discard_num);
+    // Free blocks that hold only frames before frame_index. The successor
+    // of head_ is valid only if at least one of its frames is published;
+    // otherwise the producer may still be linking it.
+    while (frame_index - head_frame_index_ >= kFramesPerBlock &&
+           head_frame_index_ + kFramesPerBlock < num_published) {
+      FrameBlock *next = head_->next;
+      delete head_;
+      head_ = next;
+      head_frame_index_ += kFramesPerBlock;
+    }
 
-    int32_t feature_dim = fbank_->Dim();
     ncnn::Mat features;
-    features.create(feature_dim, n);
+    features.create(feature_dim_, n);
 
+    const FrameBlock *block = head_;
+    int32_t block_frame_index = head_frame_index_;
     for (int32_t i = 0; i != n; ++i) {
-      const float *f = fbank_->GetFrame(i + frame_index);
-      std::copy(f, f + feature_dim, features.row(i));
+      int32_t k = frame_index + i;
+      while (k - block_frame_index >= kFramesPerBlock) {
+        block = block->next;
+        block_frame_index += kFramesPerBlock;
+      }
+
+      const float *f =
+          block->data.data() + (k - block_frame_index) * feature_dim_;
+      std::copy(f, f + feature_dim_, features.row(i));
     }
 
     last_frame_index_ = frame_index;
@@ -170,12 +509,54 @@ class FeatureExtractor::Impl {
     return features;
   }
 
- private:
+  // 64 frames are 0.64 seconds of audio with the default 10 ms frame shift
+  static constexpr int32_t kFramesPerBlock = 64;
+
+  struct FrameBlock {
+    explicit FrameBlock(int32_t feature_dim)
+        : data(kFramesPerBlock * feature_dim) {}
+
+    std::vector<float> data;
+    FrameBlock *next = nullptr;
+  };
+
   std::unique_ptr<knf::OnlineFbank> fbank_;
   knf::FbankOptions opts_;
   mutable std::mutex mutex_;
   std::unique_ptr<LinearResample> resampler_;
+  // Output of resampler_. It is reused so that resampling does not
+  // allocate once it has seen the largest input.
+  std::vector<float> resampled_;
+  // Converted input of AcceptWaveformInt16(), also reused across calls
+  std::vector<float> int16_samples_;
+  int32_t feature_dim_ = 0;
+
+  // Computed frames that GetFrames() may still return, from the first
+  // frame of its last call on. GetFrames() returns views into it. Used
+  // unless lock_free_ is true.
+  std::unique_ptr<FrameRing> ring_;
+
+  // Used only if lock_free_ is true.
+  //
+  // Published frames live in a singly linked list of FrameBlock. The
+  // producer appends at tail_, the consumer frees blocks from head_
+  // once GetFrames() has moved past them.
+  bool lock_free_ = false;
   int32_t last_frame_index_ = 0;
+  FrameBlock *head_ = nullptr;
+  FrameBlock *tail_ = nullptr;
+  int32_t head_frame_index_ = 0;  // frame index of head_->data[0]
+  std::atomic<int32_t> num_published_{0};
+  std::atomic<bool> input_finished_{false};
+
+  // Used only if batch_fbank_ is not null. Also uses input_finished_
+  // from above.
+  //
+  // waveform_ holds the samples that future frames still need; its first
+  // entry is sample waveform_offset_ of the stream.
+  std::unique_ptr<BatchFbank> batch_fbank_;
+  std::vector<float> waveform_;
+  int64_t waveform_offset_ = 0;
 };
 
 FeatureExtractor::FeatureExtractor(const FeatureExtractorConfig &config)
@@ -188,6 +569,12 @@ void FeatureExtractor::AcceptWaveform(int32_t sampling_rate,
   impl_->AcceptWaveform(sampling_rate, waveform, n);
 }
 
+void FeatureExtractor::AcceptWaveformInt16(int32_t sampling_rate,
+                                           const int16_t *waveform,
+                                           int32_t n) {
+  impl_->AcceptWaveformInt16(sampling_rate, waveform, n);
+}
+
 void FeatureExtractor::InputFinished() { impl_->InputFinished(); }
 
 int32_t FeatureExtractor::NumFramesReady() const {
@@ -202,4 +589,19 @@ ncnn::Mat FeatureExtractor::GetFrames(int32_t frame_index, int32_t n) const {
   return impl_->GetFrames(frame_index, n);
 }
 
+std::size_t FeatureExtractor::NumBytes() const { return impl_->NumBytes(); }
+
+void FeatureExtractor::ComputeFeatures(FeatureExtractor **extractors,
+                                       int32_t n) {
+  std::vector<Impl *> impls;
+  impls.reserve(n);
+  for (int32_t i = 0; i != n; ++i) {
+    if (extractors[i]->impl_->IsBatchMode()) {
+      impls.push_back(extractors[i]->impl_.get());
+    }
+  }
+
+  Impl::ComputeFeatures(impls.data(), impls.size());
+}
+
 }  // namespace sherpa_ncnn
@@ -19,6 +19,7 @@
 #ifndef SHERPA_NCNN_CSRC_FEATURES_H_
 #define SHERPA_NCNN_CSRC_FEATURES_H_
 
+#include <cstddef>
 #include <memory>
 #include <string>
 
@@ -71,6 +72,35 @@ struct FeatureExtractorConfig {
   std::string window_type = "povey";  // e.g. Hamming window
   bool round_to_power_of_two = true;
 
+  // If true, the feature extractor assumes a single producer thread calling
+  // AcceptWaveform() and InputFinished() and a single consumer thread calling
+  // NumFramesReady(), IsLastFrame() and GetFrames(). Computed frames are
+  // handed over through a lock-free queue instead of a mutex, so the
+  // consumer never blocks the producer and vice versa.
+  //
+  // If false, every method takes a mutex and any number of threads may
+  // call them.
+  bool lock_free = false;
+
+  // If true, AcceptWaveform() only buffers samples and fbank frames are
+  // computed with BatchFbank, either for many streams at once with
+  // FeatureExtractor::ComputeFeatures() or on demand by GetFrames().
+  // It cannot be combined with lock_free. The C API sets it on iOS and
+  // macOS, where BatchFbank uses Accelerate.
+  bool use_batch_fbank = false;
+
+  // If true with use_batch_fbank, large batches of frames are computed on
+  // the GPU with Vulkan, see VulkanFbank. It is for servers that decode
+  // many streams on a GPU. Without a GPU, the CPU is used.
+  bool use_vulkan_fbank = false;
+
+  // Used only by OfflineStream. How the fbank frames of a stream are kept
+  // until it is decoded: "fp32", "fp16", or "int8" with a per-frame
+  // offset and scale, see CompactFrames. "fp16" and "int8" save half and
+  // three quarters of the memory of streams that wait in a queue, at the
+  // cost of a small rounding error.
+  std::string feature_storage = "fp32";
+
   std::string ToString() const;
 
   void Register(ParseOptions *po);
@@ -92,6 +122,14 @@ class FeatureExtractor {
    */
   void AcceptWaveform(int32_t sampling_rate, const float *waveform, int32_t n);
 
+  /** Same as AcceptWaveform() but for 16-bit PCM samples, which are scaled
+   * by 1/32768. It converts them with SIMD directly into the sample buffer
+   * if use_batch_fbank is true and no resampling is needed; otherwise,
+   * into a scratch buffer that is reused across calls.
+   */
+  void AcceptWaveformInt16(int32_t sampling_rate, const int16_t *waveform,
+                           int32_t n);
+
   // InputFinished() tells the class you won't be providing any
   // more waveform.  This will help flush out the last frame or two
   // of features, in the case where snip-edges == false; it also
@@ -110,9 +148,31 @@ class FeatureExtractor {
    * @param n  Number of frames to get.
    * @return Return a 2-D tensor of shape (n, feature_dim).
    *         ans.w == feature_dim; ans.h == n
+   *         Unless config.lock_free is true, it is a read-only view into
+   *         the frames of this extractor and is neither allocated nor
+   *         copied, see FrameRing. Frames before frame_index are
+   *         discarded, so frame_index must not decrease between calls.
    */
   ncnn::Mat GetFrames(int32_t frame_index, int32_t n) const;
 
+  /** Compute the pending frames of many extractors in one batch.
+   *
+   * Extractors without config.use_batch_fbank are skipped. Calling it is
+   * optional: GetFrames() computes missing frames itself, only one stream
+   * at a time.
+   *
+   * @param extractors  Pointer to an array of n extractors
+   * @param n  Number of extractors
+   */
+  static void ComputeFeatures(FeatureExtractor **extractors, int32_t n);
+
+  /** Return the bytes of the samples and frames buffered by this
+   * extractor, see StreamMemoryUsage::features. With lock_free, call it
+   * from the consumer thread; the scratch buffers of the producer are not
+   * counted then.
+   */
+  std::size_t NumBytes() const;
+
  private:
   class Impl;
   std::unique_ptr<Impl> impl_;
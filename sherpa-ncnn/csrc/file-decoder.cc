@@ -0,0 +1,228 @@
+// sherpa-ncnn/csrc/file-decoder.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/file-decoder.h"
+
+#include <algorithm>
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <mutex>  // NOLINT
+#include <sstream>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/macros.h"
+
+namespace sherpa_ncnn {
+
+std::string FileDecoderConfig::ToString() const {
+  std::ostringstream os;
+
+  os << "FileDecoderConfig(";
+  os << "num_threads=" << num_threads << ", ";
+  os << "max_batch_size=" << max_batch_size << ", ";
+  os << "chunk_size=" << chunk_size << ", ";
+  os << "tail_padding=" << tail_padding << ")";
+
+  return os.str();
+}
+
+class FileDecoder::Impl {
+  struct Job {
+    int32_t sampling_rate = 0;
+    std::vector<float> samples;
+    Callback callback;
+
+    // Created by the worker that decodes the job
+    std::unique_ptr<Stream> s;
+  };
+
+ public:
+  Impl(const Recognizer *recognizer, const FileDecoderConfig &config)
+      : recognizer_(recognizer), config_(config) {
+    if (config_.num_threads < 1 || config_.max_batch_size < 1 ||
+        config_.chunk_size < 0 || config_.tail_padding < 0) {
+      SHERPA_NCNN_LOGE("Invalid config: %s", config_.ToString().c_str());
+      SHERPA_NCNN_EXIT(-1);
+    }
+
+    chunk_size_ = config_.chunk_size;
+    if (chunk_size_ == 0) {
+      std::vector<int32_t> sizes = recognizer_->GetChunkSizes();
+      chunk_size_ = *std::max_element(sizes.begin(), sizes.end());
+    }
+
+    for (int32_t i = 0; i != config_.num_threads; ++i) {
+      threads_.emplace_back([this]() { Run(); });
+    }
+  }
+
+  ~Impl() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+
+    for (auto &t : threads_) {
+      t.join();
+    }
+  }
+
+  void Submit(int32_t sampling_rate, std::vector<float> samples,
+              Callback callback) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      queue_.push_back({sampling_rate, std::move(samples),
+                        std::move(callback), nullptr});
+      ++num_pending_;
+    }
+    cv_.notify_one();
+  }
+
+  void WaitIdle() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this]() { return num_pending_ == 0; });
+  }
+
+ private:
+  void Run() {
+    std::vector<Job> batch;
+    std::vector<Stream *> ready;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      // Top up the batch with queued files
+      std::size_t num_old = batch.size();
+      while (static_cast<int32_t>(batch.size()) < config_.max_batch_size &&
+             !queue_.empty()) {
+        batch.push_back(std::move(queue_.front()));
+        queue_.pop_front();
+      }
+
+      if (batch.empty()) {
+        if (stop_) return;
+
+        cv_.wait(lock);
+        continue;
+      }
+
+      lock.unlock();
+
+      for (std::size_t i = num_old; i != batch.size(); ++i) {
+        Start(&batch[i]);
+      }
+
+      ready.clear();
+      for (auto &job : batch) {
+        if (job.s && recognizer_->IsReady(job.s.get())) {
+          ready.push_back(job.s.get());
+        }
+      }
+
+      if (!ready.empty()) {
+        recognizer_->DecodeStreams(ready.data(), ready.size());
+      }
+
+      // A file is finished once it has no ready chunk left. Its input is
+      // finished, so no more frames will arrive.
+      int32_t num_done = 0;
+      for (std::size_t i = 0; i != batch.size();) {
+        Job &job = batch[i];
+        if (job.s && recognizer_->IsReady(job.s.get())) {
+          ++i;
+          continue;
+        }
+
+        job.callback(job.s ? recognizer_->GetResult(job.s.get())
+                           : RecognitionResult{});
+
+        std::swap(job, batch.back());
+        batch.pop_back();
+        ++num_done;
+      }
+
+      lock.lock();
+
+      if (num_done) {
+        num_pending_ -= num_done;
+        done_cv_.notify_all();
+      }
+    }
+  }
+
+  // Create the stream of a job and accept all of its samples
+  void Start(Job *job) const {
+    job->s = recognizer_->CreateStreamWithChunkSize(chunk_size_);
+    if (!job->s) {
+      return;
+    }
+
+    Stream *s = job->s.get();
+    s->AcceptWaveform(job->sampling_rate, job->samples.data(),
+                      job->samples.size());
+
+    std::vector<float> tail_paddings(
+        static_cast<int32_t>(config_.tail_padding * job->sampling_rate));
+    s->AcceptWaveform(job->sampling_rate, tail_paddings.data(),
+                      tail_paddings.size());
+    s->InputFinished();
+
+    // Free the samples early; files can be long
+    job->samples = std::vector<float>();
+  }
+
+ private:
+  const Recognizer *recognizer_;
+  FileDecoderConfig config_;
+  int32_t chunk_size_ = 0;
+
+  std::vector<std::thread> threads_;
+
+  // Protects queue_, num_pending_ and stop_
+  std::mutex mutex_;
+
+  // Signaled when files are queued or stop_ is set
+  std::condition_variable cv_;
+
+  // Signaled when files are done
+  std::condition_variable done_cv_;
+
+  // Files that are not taken by a worker yet
+  std::deque<Job> queue_;
+
+  // Number of files that are queued or being decoded
+  int32_t num_pending_ = 0;
+
+  bool stop_ = false;
+};
+
+FileDecoder::FileDecoder(const Recognizer *recognizer,
+                         const FileDecoderConfig &config)
+    : impl_(std::make_unique<Impl>(recognizer, config)) {}
+
+FileDecoder::~FileDecoder() = default;
+
+void FileDecoder::Submit(int32_t sampling_rate, std::vector<float> samples,
+                         Callback callback) {
+  impl_->Submit(sampling_rate, std::move(samples), std::move(callback));
+}
+
+std::future<RecognitionResult> FileDecoder::Submit(
+    int32_t sampling_rate, std::vector<float> samples) {
+  auto promise = std::make_shared<std::promise<RecognitionResult>>();
+  std::future<RecognitionResult> ans = promise->get_future();
+
+  impl_->Submit(sampling_rate, std::move(samples),
+                [promise](const RecognitionResult &r) {
+                  promise->set_value(r);
+                });
+
+  return ans;
+}
+
+void FileDecoder::WaitIdle() { impl_->WaitIdle(); }
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,101 @@
+// sherpa-ncnn/csrc/file-decoder.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_FILE_DECODER_H_
+#define SHERPA_NCNN_CSRC_FILE_DECODER_H_
+
+#include <cstdint>
+#include <functional>
+#include <future>  // NOLINT
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/recognizer.h"
+
+namespace sherpa_ncnn {
+
+struct FileDecoderConfig {
+  // Number of worker threads. Each of them passes one batch at a time to
+  // Recognizer::DecodeStreams(), which may use several threads by itself,
+  // see ModelConfig::encoder_opt.
+  int32_t num_threads = 2;
+
+  // A worker decodes at most this many files together
+  int32_t max_batch_size = 16;
+
+  // Chunk size of the encoder in feature frames, see
+  // Recognizer::CreateStreamWithChunkSize(). 0 means the largest one of
+  // Recognizer::GetChunkSizes().
+  int32_t chunk_size = 0;
+
+  // Seconds of silence appended to each file so that its last frames are
+  // decoded
+  float tail_padding = 0.3;
+
+  FileDecoderConfig() = default;
+
+  FileDecoderConfig(int32_t num_threads, int32_t max_batch_size,
+                    int32_t chunk_size, float tail_padding)
+      : num_threads(num_threads),
+        max_batch_size(max_batch_size),
+        chunk_size(chunk_size),
+        tail_padding(tail_padding) {}
+
+  std::string ToString() const;
+};
+
+/** Decode whole files with a streaming model for throughput, e.g., to
+ * transcribe an archive.
+ *
+ * Unlike a live stream, a file is decoded as fast as possible: all of its
+ * samples are accepted at once, the encoder with the largest chunk size is
+ * used and there are no partial results or endpoints. Each worker keeps up
+ * to max_batch_size files in flight and decodes one chunk of each of them
+ * per Recognizer::DecodeStreams() call. A file that is finished is
+ * replaced by the next queued one right away, so the batches stay full
+ * while files of different lengths come and go.
+ *
+ * Usage:
+ *
+ *   FileDecoder decoder(&recognizer, config);
+ *   std::future<RecognitionResult> f =
+ *       decoder.Submit(16000, std::move(samples));
+ *   auto r = f.get();
+ */
+class FileDecoder {
+ public:
+  // Invoked on a worker thread with the result of a file
+  using Callback = std::function<void(const RecognitionResult &result)>;
+
+  FileDecoder(const Recognizer *recognizer, const FileDecoderConfig &config);
+
+  // Decode the files that are still queued and stop the workers
+  ~FileDecoder();
+
+  FileDecoder(const FileDecoder &) = delete;
+  FileDecoder &operator=(const FileDecoder &) = delete;
+
+  // Queue the samples of a file. Its features are computed on a worker.
+  // If RecognizerConfig::memory_budget cannot afford the stream of the
+  // file, the result is empty.
+  void Submit(int32_t sampling_rate, std::vector<float> samples,
+              Callback callback);
+
+  // Like the above one, but the result is delivered through the returned
+  // future
+  std::future<RecognitionResult> Submit(int32_t sampling_rate,
+                                        std::vector<float> samples);
+
+  // Wait until all submitted files are decoded
+  void WaitIdle();
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_FILE_DECODER_H_
@@ -0,0 +1,175 @@
+// sherpa-ncnn/csrc/frame-ring.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/frame-ring.h"
+
+#include <algorithm>
+#include <map>
+#include <mutex>  // NOLINT
+
+#include "allocator.h"  // NOLINT
+#include "sherpa-ncnn/csrc/macros.h"
+
+namespace sherpa_ncnn {
+
+namespace {
+
+// 64 frames are 0.64 seconds of audio with the default 10 ms frame shift
+constexpr int32_t kMinCapacity = 64;
+
+// The reference count is shared by the ring and its views
+struct Buffer {
+  int refcount = 0;
+  unsigned char *data = nullptr;
+  std::size_t num_bytes = 0;
+};
+
+/* The allocator of all buffers.
+ *
+ * ncnn passes the data pointer of the mat that drops the last reference
+ * to the allocator. For a view, it points into the middle of the buffer,
+ * so buffers are registered by their start address. This happens once
+ * per buffer, not per view.
+ */
+class BufferAllocator : public ncnn::Allocator {
+ public:
+  Buffer *NewBuffer(std::size_t num_bytes) {
+    auto *b = new Buffer;
+    b->num_bytes = num_bytes;
+    b->data = static_cast<unsigned char *>(ncnn::fastMalloc(num_bytes));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    buffers_[b->data] = b;
+    return b;
+  }
+
+  // Buffers are never resized through this allocator, but follow the
+  // contract anyway
+  void *fastMalloc(std::size_t size) override {
+    return ncnn::fastMalloc(size);
+  }
+
+  void fastFree(void *ptr) override {
+    auto *p = static_cast<unsigned char *>(ptr);
+
+    Buffer *b = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = buffers_.upper_bound(p);
+      if (it != buffers_.begin()) {
+        --it;
+        if (p < it->first + it->second->num_bytes) {
+          b = it->second;
+          buffers_.erase(it);
+        }
+      }
+    }
+
+    if (!b) {
+      ncnn::fastFree(ptr);
+      return;
+    }
+
+    ncnn::fastFree(b->data);
+    delete b;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::map<const unsigned char *, Buffer *> buffers_;
+};
+
+BufferAllocator &GetBufferAllocator() {
+  // Never destroyed, since views may be released during static destruction
+  static auto *allocator = new BufferAllocator;
+  return *allocator;
+}
+
+}  // namespace
+
+FrameRing::FrameRing(int32_t feature_dim) : feature_dim_(feature_dim) {}
+
+void FrameRing::Push(const float *frame) {
+  if (num_frames_ - first_frame_ == capacity_) {
+    Reallocate(std::max(kMinCapacity, capacity_ * 2), mirror_);
+  }
+
+  Write(num_frames_, frame);
+  ++num_frames_;
+}
+
+ncnn::Mat FrameRing::View(int32_t frame_index, int32_t n) {
+  if (frame_index + n > num_frames_) {
+    SHERPA_NCNN_LOGE("%d + %d > %d", frame_index, n, num_frames_);
+    SHERPA_NCNN_EXIT(-1);
+  }
+
+  if (frame_index < first_frame_) {
+    SHERPA_NCNN_LOGE("first_frame_: %d, frame_index: %d", first_frame_,
+                     frame_index);
+    SHERPA_NCNN_EXIT(-1);
+  }
+
+  first_frame_ = frame_index;
+
+  if (n == 0) {
+    return ncnn::Mat();
+  }
+
+  // Frames [frame_index, frame_index + n) are in the ring, so if they wrap
+  // around, the rest of them is in the mirrored rows once n <= mirror_.
+  // The mirror is only grown for windows that wrap around, so that a
+  // single large read, e.g., of all frames, does not double the buffer.
+  if (frame_index % capacity_ + n > capacity_ && n > mirror_) {
+    Reallocate(std::max(capacity_, n), n);
+  }
+
+  ncnn::Mat ans = buf_;
+  ans.data = buf_.row(frame_index % capacity_);
+  ans.h = n;
+  ans.cstep = static_cast<std::size_t>(feature_dim_) * n;
+
+  return ans;
+}
+
+std::size_t FrameRing::NumBytes() const {
+  return static_cast<std::size_t>(capacity_ + mirror_) * feature_dim_ *
+         sizeof(float);
+}
+
+void FrameRing::Reallocate(int32_t capacity, int32_t mirror) {
+  BufferAllocator &allocator = GetBufferAllocator();
+  Buffer *b = allocator.NewBuffer(static_cast<std::size_t>(capacity + mirror) *
+                                  feature_dim_ * sizeof(float));
+
+  ncnn::Mat buf(feature_dim_, capacity + mirror, b->data);
+
+  // Turn the external mat into a refcounted one
+  buf.refcount = &b->refcount;
+  buf.allocator = &allocator;
+  buf.addref();
+
+  // Views of the old buffer keep it alive
+  ncnn::Mat old = buf_;
+  int32_t old_capacity = capacity_;
+
+  buf_ = buf;
+  capacity_ = capacity;
+  mirror_ = mirror;
+
+  for (int32_t k = first_frame_; k != num_frames_; ++k) {
+    Write(k, old.row(k % old_capacity));
+  }
+}
+
+void FrameRing::Write(int32_t frame_index, const float *frame) {
+  int32_t row = frame_index % capacity_;
+  std::copy(frame, frame + feature_dim_, buf_.row(row));
+
+  if (row < mirror_) {
+    std::copy(frame, frame + feature_dim_, buf_.row(capacity_ + row));
+  }
+}
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,78 @@
+// sherpa-ncnn/csrc/frame-ring.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_FRAME_RING_H_
+#define SHERPA_NCNN_CSRC_FRAME_RING_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "mat.h"  // NOLINT
+
+namespace sherpa_ncnn {
+
+/** The feature frames of a stream that may still be read.
+ *
+ * Frames are kept in a ring buffer whose first rows are mirrored after
+ * its end, so that the frames of a window are always contiguous. View()
+ * returns them as a mat that points into the buffer: reading a chunk for
+ * the encoder neither allocates nor copies, and the frames that
+ * consecutive chunks share are stored once.
+ *
+ * A view is an ordinary refcounted mat and stays valid after the ring is
+ * changed or destroyed. When the ring grows, it moves to a new buffer and
+ * the old one is freed with its last view. Frames from the first frame
+ * of the last view on are never overwritten, so Push() may be called
+ * while a view is read on another thread, provided calls of the ring
+ * itself are serialized.
+ */
+class FrameRing {
+ public:
+  explicit FrameRing(int32_t feature_dim);
+
+  FrameRing(const FrameRing &) = delete;
+  FrameRing &operator=(const FrameRing &) = delete;
+
+  int32_t FeatureDim() const { return feature_dim_; }
+
+  // Number of frames pushed so far
+  int32_t NumFrames() const { return num_frames_; }
+
+  // Append a frame of FeatureDim() floats
+  void Push(const float *frame);
+
+  /** Return frames [frame_index, frame_index + n) as a mat of shape
+   * (n, FeatureDim()) that refers to the buffer. Frames before frame_index
+   * are discarded, so frame_index must not decrease between calls.
+   */
+  ncnn::Mat View(int32_t frame_index, int32_t n);
+
+  // Bytes of the buffer, including the mirrored rows
+  std::size_t NumBytes() const;
+
+ private:
+  // Move the frames to a new buffer with the given number of rows in the
+  // ring and mirrored after it. mirror must not exceed capacity.
+  void Reallocate(int32_t capacity, int32_t mirror);
+
+  void Write(int32_t frame_index, const float *frame);
+
+ private:
+  int32_t feature_dim_;
+
+  // (capacity_ + mirror_, feature_dim_). Frame k is in row k % capacity_
+  // and, if that row is below mirror_, also in row capacity_ + k %
+  // capacity_.
+  ncnn::Mat buf_;
+  int32_t capacity_ = 0;
+  int32_t mirror_ = 0;
+
+  // The ring holds frames [first_frame_, num_frames_)
+  int32_t first_frame_ = 0;
+  int32_t num_frames_ = 0;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_FRAME_RING_H_
@@ -23,7 +23,17 @@
 #include <float.h>
 #include <stdio.h>  // for FLT_MAX
 
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
 #include <vector>
 
 #include "kaldi-native-fbank/csrc/online-feature.h"
@@ -34,6 +44,10 @@
 #include "net.h"
 #include "sherpa-ncnn/csrc/features.h"
 #include "sherpa-ncnn/csrc/model.h"
+#include "sherpa-ncnn/csrc/offline-recognizer.h"
+#include "sherpa-ncnn/csrc/offline-sense-voice-model.h"
+#include "sherpa-ncnn/csrc/offline-tts-vits-model.h"
+#include "sherpa-ncnn/csrc/offline-tts.h"
 #include "sherpa-ncnn/csrc/recognizer.h"
 #include "sherpa-ncnn/csrc/wave-reader.h"
 
@@ -244,726 +258,934 @@ float compute_kl_threshold(QuantBlobStat &stat, int num_histogram_bins = 2048) {
   return scale;
 }
 
-class QuantNet : public ncnn::Net {
- public:
-  QuantNet(sherpa_ncnn::Model *model);
+// Index of the thread that runs the current task of parallel_for()
+static thread_local int current_worker = 0;
+
+// Run f(0), f(1), ..., f(n - 1) on num_threads threads, including the
+// calling one. current_worker is in the range [0, num_threads) for each
+// call of f.
+static void parallel_for(int n, int num_threads,
+                         const std::function<void(int)> &f) {
+  std::atomic<int> next{0};
+  auto run = [&](int worker) {
+    current_worker = worker;
+    for (int i; (i = next++) < n;) {
+      f(i);
+    }
+  };
 
-  sherpa_ncnn::Model *model;
-  std::vector<ncnn::Layer *> &encoder_layers;
-  std::vector<ncnn::Layer *> &joiner_layers;
+  std::vector<std::thread> threads;
+  for (int w = 1; w < num_threads; w++) {
+    threads.emplace_back(run, w);
+  }
+  run(0);
+
+  for (auto &t : threads) {
+    t.join();
+  }
+}
+
+// Return the weights of a conv layer and save its number of output
+// channels in num_output
+static const ncnn::Mat &get_weight_data(const ncnn::Layer *layer,
+                                        int *num_output) {
+  if (layer->type == "Convolution") {
+    const ncnn::Convolution *convolution = (const ncnn::Convolution *)layer;
+    *num_output = convolution->num_output;
+    return convolution->weight_data;
+  } else if (layer->type == "ConvolutionDepthWise") {
+    const ncnn::ConvolutionDepthWise *convolutiondepthwise =
+        (const ncnn::ConvolutionDepthWise *)layer;
+    *num_output = convolutiondepthwise->num_output;
+    return convolutiondepthwise->weight_data;
+  }
 
+  const ncnn::InnerProduct *innerproduct = (const ncnn::InnerProduct *)layer;
+  *num_output = innerproduct->num_output;
+  return innerproduct->weight_data;
+}
+
+// Int8 calibration of a single net with the KL method. Statistics are
+// collected in two passes over the same data: the first one finds the
+// absmax of the input blob of each conv layer and the second one its
+// histogram.
+//
+// To collect them on several threads, each thread uses its own copy and
+// the copies are merged at the end of a pass.
+//
+// For mixed precision, the quantization error of each conv layer is
+// estimated from the statistics as a signal-to-quantization-noise ratio
+// (SQNR) of its input blob and weights. Layers with a low SQNR are left out
+// of the table, so that ncnn2int8 keeps them in float. At runtime they use
+// fp16 or fp32, depending on the ncnn::Option of the net.
+class NetQuantizer {
  public:
+  explicit NetQuantizer(const ncnn::Net &net) : layers(net.layers()) {}
+
   int init();
-  void print_quant_info() const;
-  int save_table_encoder(const char *tablepath);
-  int save_table_joiner(const char *tablepath);
-  int quantize_KL(const std::vector<std::string> &wave_filenames);
-  int quantize_ACIQ();
-  int quantize_EQ();
+  void init_histogram();
 
- private:
-  int init_encoder();
-  int init_joiner();
+  void collect_absmax(ncnn::Extractor *ex);
+  void collect_histogram(ncnn::Extractor *ex);
+
+  // Add the statistics of a copy of this object
+  void merge_absmax(const NetQuantizer &other);
+  void merge_histogram(const NetQuantizer &other);
 
-  void quantize_encoder_weight();
-  void quantize_joiner_weight();
+  // Compute the weight scales and the bottom blob scales from the
+  // collected statistics. The blobs are distributed over num_threads
+  // threads.
+  //
+  // Layers whose estimated SQNR is below min_sqnr dB are kept in float.
+  // If min_sqnr is 0, all layers are quantized.
+  void compute_scales(int num_threads, float min_sqnr = 0);
+
+  void print_quant_info() const;
+  int save_table(const char *tablepath) const;
 
  public:
-  std::vector<int> encoder_conv_layers;
-  std::vector<int> encoder_conv_bottom_blobs;
+  static constexpr int num_histogram_bins = 2048;
 
-  std::vector<int> joiner_conv_layers;
-  std::vector<int> joiner_conv_bottom_blobs;
+  const std::vector<ncnn::Layer *> &layers;
 
-  // result
-  std::vector<QuantBlobStat> encoder_quant_blob_stats;
-  std::vector<ncnn::Mat> encoder_weight_scales;
-  std::vector<ncnn::Mat> encoder_bottom_blob_scales;
+  std::vector<int> conv_layers;
+  std::vector<int> conv_bottom_blobs;
 
-  std::vector<QuantBlobStat> joiner_quant_blob_stats;
-  std::vector<ncnn::Mat> joiner_weight_scales;
-  std::vector<ncnn::Mat> joiner_bottom_blob_scales;
-};
+  std::vector<QuantBlobStat> quant_blob_stats;
+  std::vector<ncnn::Mat> weight_scales;
+  std::vector<ncnn::Mat> bottom_blob_scales;
 
-QuantNet::QuantNet(sherpa_ncnn::Model *model)
-    : model(model),
-      encoder_layers(model->GetEncoder().mutable_layers()),
-      joiner_layers(model->GetJoiner().mutable_layers()) {}
+  // Number of multiply-accumulates of each conv layer over the first pass
+  std::vector<double> macs;
+
+  // Estimated SQNR in dB of each conv layer in int8
+  std::vector<float> sqnr;
 
-int QuantNet::init_encoder() {
-  // find all encoder conv layers
-  for (int i = 0; i < (int)encoder_layers.size(); i++) {
-    const ncnn::Layer *layer = encoder_layers[i];
+  // True if a conv layer is kept in float, i.e., not saved to the table
+  std::vector<bool> keep_float;
+};
+
+int NetQuantizer::init() {
+  for (int i = 0; i < (int)layers.size(); i++) {
+    const ncnn::Layer *layer = layers[i];
     if (layer->type == "Convolution" || layer->type == "ConvolutionDepthWise" ||
         layer->type == "InnerProduct") {
-      encoder_conv_layers.push_back(i);
-      encoder_conv_bottom_blobs.push_back(layer->bottoms[0]);
+      conv_layers.push_back(i);
+      conv_bottom_blobs.push_back(layer->bottoms[0]);
     }
   }
 
-  fprintf(stderr, "num encoder conv layers: %d\n",
-          static_cast<int32_t>(encoder_conv_layers.size()));
-
-  const int encoder_conv_layer_count = (int)encoder_conv_layers.size();
-  const int encoder_conv_bottom_blob_count =
-      (int)encoder_conv_bottom_blobs.size();
-
-  encoder_quant_blob_stats.resize(encoder_conv_bottom_blob_count);
-  encoder_weight_scales.resize(encoder_conv_layer_count);
-  encoder_bottom_blob_scales.resize(encoder_conv_bottom_blob_count);
+  quant_blob_stats.resize(conv_bottom_blobs.size());
+  weight_scales.resize(conv_layers.size());
+  bottom_blob_scales.resize(conv_bottom_blobs.size());
+  macs.resize(conv_layers.size(), 0);
+  sqnr.resize(conv_layers.size(), 0);
+  keep_float.resize(conv_layers.size(), false);
 
   return 0;
 }
 
-int QuantNet::init_joiner() {
-  // find all joiner conv layers
-  for (int i = 0; i < (int)joiner_layers.size(); i++) {
-    const ncnn::Layer *layer = joiner_layers[i];
-    if (layer->type == "Convolution" || layer->type == "ConvolutionDepthWise" ||
-        layer->type == "InnerProduct") {
-      joiner_conv_layers.push_back(i);
-      joiner_conv_bottom_blobs.push_back(layer->bottoms[0]);
-    }
+void NetQuantizer::init_histogram() {
+  for (auto &stat : quant_blob_stats) {
+    stat.histogram.resize(num_histogram_bins, 0);
+    stat.histogram_normed.resize(num_histogram_bins, 0);
   }
+}
 
-  fprintf(stderr, "num joiner conv layers: %d\n",
-          static_cast<int32_t>(joiner_conv_layers.size()));
+void NetQuantizer::collect_absmax(ncnn::Extractor *ex) {
+  for (int j = 0; j < (int)conv_bottom_blobs.size(); j++) {
+    ncnn::Mat out;
+    ex->extract(conv_bottom_blobs[j], out);
 
-  const int joiner_conv_layer_count = (int)joiner_conv_layers.size();
-  const int joiner_conv_bottom_blob_count =
-      (int)joiner_conv_bottom_blobs.size();
+    float absmax = 0.f;
 
-  joiner_quant_blob_stats.resize(joiner_conv_bottom_blob_count);
-  joiner_weight_scales.resize(joiner_conv_layer_count);
-  joiner_bottom_blob_scales.resize(joiner_conv_bottom_blob_count);
+    // Zipformer has 4-D blobs
+    const int outc = out.c;
+    const int outsize = out.w * out.h * out.d;
+    for (int p = 0; p < outc; p++) {
+      const float *ptr = out.channel(p);
+      for (int k = 0; k < outsize; k++) {
+        absmax = std::max(absmax, (float)fabs(ptr[k]));
+      }
+    }
 
-  return 0;
-}
+    QuantBlobStat &stat = quant_blob_stats[j];
+    stat.absmax = std::max(stat.absmax, absmax);
 
-int QuantNet::init() {
-  init_encoder();
-  init_joiner();
+    // Each output element takes weight_data.w / num_output MACs
+    const ncnn::Layer *layer = layers[conv_layers[j]];
+    int num_output = 0;
+    const ncnn::Mat &weight_data = get_weight_data(layer, &num_output);
 
-  return 0;
+    ncnn::Mat top;
+    ex->extract(layer->tops[0], top);
+    const double top_size = (double)top.w * top.h * top.d * top.c;
+    macs[j] += (double)weight_data.w / num_output * top_size;
+  }
 }
 
-void QuantNet::quantize_encoder_weight() {
-  const int encoder_conv_layer_count = (int)encoder_conv_layers.size();
-
-  for (int i = 0; i < encoder_conv_layer_count; i++) {
-    const ncnn::Layer *layer = encoder_layers[encoder_conv_layers[i]];
-    if (layer->type == "Convolution") {
-      const ncnn::Convolution *convolution = (const ncnn::Convolution *)layer;
-      const int num_output = convolution->num_output;
-      const int kernel_w = convolution->kernel_w;
-      const int kernel_h = convolution->kernel_h;
-      const int dilation_w = convolution->dilation_w;
-      const int dilation_h = convolution->dilation_h;
-      const int stride_w = convolution->stride_w;
-      const int stride_h = convolution->stride_h;
-
-      const int weight_data_size_output =
-          convolution->weight_data_size / num_output;
-
-      // int8 winograd F43 needs weight data to use 6bit quantization
-      // TODO proper condition for winograd 3x3 int8
-      bool quant_6bit = false;
-      if (kernel_w == 3 && kernel_h == 3 && dilation_w == 1 &&
-          dilation_h == 1 && stride_w == 1 && stride_h == 1) {
-        quant_6bit = true;
-      }
+void NetQuantizer::collect_histogram(ncnn::Extractor *ex) {
+  for (int j = 0; j < (int)conv_bottom_blobs.size(); j++) {
+    ncnn::Mat out;
+    ex->extract(conv_bottom_blobs[j], out);
 
-      encoder_weight_scales[i].create(num_output);
-      for (int n = 0; n < num_output; n++) {
-        const ncnn::Mat weight_data_n = convolution->weight_data.range(
-            weight_data_size_output * n, weight_data_size_output);
+    QuantBlobStat &stat = quant_blob_stats[j];
+    const float absmax = stat.absmax;
 
-        float absmax = 0.f;
-        for (int k = 0; k < weight_data_size_output; k++) {
-          absmax = std::max(absmax, (float)fabs(weight_data_n[k]));
-        }
+    // Zipformer has 4-D blobs
+    const int outc = out.c;
+    const int outsize = out.w * out.h * out.d;
+    for (int p = 0; p < outc; p++) {
+      const float *ptr = out.channel(p);
+      for (int k = 0; k < outsize; k++) {
+        if (ptr[k] == 0.f) continue;
 
-        if (quant_6bit) {
-          encoder_weight_scales[i][n] = 31 / absmax;
-        } else {
-          encoder_weight_scales[i][n] = 127 / absmax;
-        }
-      }
-    }  // if (layer->type == "Convolution")
+        const int index =
+            std::min((int)(fabs(ptr[k]) / absmax * num_histogram_bins),
+                     (num_histogram_bins - 1));
 
-    if (layer->type == "ConvolutionDepthWise") {
-      const ncnn::ConvolutionDepthWise *convolutiondepthwise =
-          (const ncnn::ConvolutionDepthWise *)layer;
+        stat.histogram[index] += 1;
+      }
+    }
+  }
+}
 
-      const int group = convolutiondepthwise->group;
-      const int weight_data_size_output =
-          convolutiondepthwise->weight_data_size / group;
+void NetQuantizer::merge_absmax(const NetQuantizer &other) {
+  for (int j = 0; j < (int)quant_blob_stats.size(); j++) {
+    QuantBlobStat &stat = quant_blob_stats[j];
+    stat.absmax = std::max(stat.absmax, other.quant_blob_stats[j].absmax);
+    macs[j] += other.macs[j];
+  }
+}
 
-      std::vector<float> scales;
+void NetQuantizer::merge_histogram(const NetQuantizer &other) {
+  for (int j = 0; j < (int)quant_blob_stats.size(); j++) {
+    QuantBlobStat &stat = quant_blob_stats[j];
+    const QuantBlobStat &other_stat = other.quant_blob_stats[j];
+    for (int k = 0; k < num_histogram_bins; k++) {
+      stat.histogram[k] += other_stat.histogram[k];
+    }
+  }
+}
 
-      encoder_weight_scales[i].create(group);
+// Return the per output channel scales of the weights of a conv layer
+static ncnn::Mat compute_weight_scales(const ncnn::Layer *layer) {
+  ncnn::Mat weight_data;
+  int num_output = 0;
+  bool quant_6bit = false;
+
+  if (layer->type == "Convolution") {
+    const ncnn::Convolution *convolution = (const ncnn::Convolution *)layer;
+    weight_data = convolution->weight_data;
+    num_output = convolution->num_output;
+
+    // int8 winograd F43 needs weight data to use 6bit quantization
+    quant_6bit = convolution->kernel_w == 3 && convolution->kernel_h == 3 &&
+                 convolution->dilation_w == 1 &&
+                 convolution->dilation_h == 1 && convolution->stride_w == 1 &&
+                 convolution->stride_h == 1;
+  } else if (layer->type == "ConvolutionDepthWise") {
+    const ncnn::ConvolutionDepthWise *convolutiondepthwise =
+        (const ncnn::ConvolutionDepthWise *)layer;
+    weight_data = convolutiondepthwise->weight_data;
+    num_output = convolutiondepthwise->group;
+  } else {
+    const ncnn::InnerProduct *innerproduct = (const ncnn::InnerProduct *)layer;
+    weight_data = innerproduct->weight_data;
+    num_output = innerproduct->num_output;
+  }
 
-      for (int n = 0; n < group; n++) {
-        const ncnn::Mat weight_data_n = convolutiondepthwise->weight_data.range(
-            weight_data_size_output * n, weight_data_size_output);
+  const int weight_data_size_output = weight_data.w / num_output;
 
-        float absmax = 0.f;
-        for (int k = 0; k < weight_data_size_output; k++) {
-          absmax = std::max(absmax, (float)fabs(weight_data_n[k]));
-        }
+  ncnn::Mat scales(num_output);
+  for (int n = 0; n < num_output; n++) {
+    const ncnn::Mat weight_data_n = weight_data.range(
+        weight_data_size_output * n, weight_data_size_output);
 
-        encoder_weight_scales[i][n] = 127 / absmax;
-      }
-    }  // if (layer->type == "ConvolutionDepthWise")
+    float absmax = 0.f;
+    for (int k = 0; k < weight_data_size_output; k++) {
+      absmax = std::max(absmax, (float)fabs(weight_data_n[k]));
+    }
 
-    if (layer->type == "InnerProduct") {
-      const ncnn::InnerProduct *innerproduct =
-          (const ncnn::InnerProduct *)layer;
+    scales[n] = (quant_6bit ? 31 : 127) / absmax;
+  }
 
-      const int num_output = innerproduct->num_output;
-      const int weight_data_size_output =
-          innerproduct->weight_data_size / num_output;
+  return scales;
+}
 
-      encoder_weight_scales[i].create(num_output);
+// Signal and noise power of quantizing a blob, given its histogram, with
+// stat.threshold. Values above the threshold are clipped.
+static void blob_noise(const QuantBlobStat &stat, int num_histogram_bins,
+                       double *signal, double *noise) {
+  const double bin_width = stat.absmax / num_histogram_bins;
+  const double step = stat.threshold / 127;
+
+  for (int k = 0; k < num_histogram_bins; k++) {
+    const double v = (k + 0.5) * bin_width;
+    const double n = stat.histogram[k];
+
+    *signal += n * v * v;
+    if (v <= stat.threshold) {
+      *noise += n * step * step / 12;
+    } else {
+      *noise += n * (v - stat.threshold) * (v - stat.threshold);
+    }
+  }
+}
 
-      for (int n = 0; n < num_output; n++) {
-        const ncnn::Mat weight_data_n = innerproduct->weight_data.range(
-            weight_data_size_output * n, weight_data_size_output);
+// Signal and noise power of quantizing the weights of a conv layer with
+// its per output channel scales
+static void weight_noise(const ncnn::Mat &weight_data,
+                         const ncnn::Mat &scales, double *signal,
+                         double *noise) {
+  const int weight_data_size_output = weight_data.w / scales.w;
+  for (int n = 0; n < scales.w; n++) {
+    if (!std::isfinite(scales[n])) {
+      // All weights of the channel are 0
+      continue;
+    }
 
-        float absmax = 0.f;
-        for (int k = 0; k < weight_data_size_output; k++) {
-          absmax = std::max(absmax, (float)fabs(weight_data_n[k]));
-        }
+    for (int k = 0; k < weight_data_size_output; k++) {
+      const float w = weight_data[weight_data_size_output * n + k];
+      const float e = w - std::round(w * scales[n]) / scales[n];
 
-        encoder_weight_scales[i][n] = 127 / absmax;
-      }
-    }  // if (layer->type == "InnerProduct")
-  }    // for (int i = 0; i < encoder_conv_layer_count; i++)
+      *signal += (double)w * w;
+      *noise += (double)e * e;
+    }
+  }
 }
 
-void QuantNet::quantize_joiner_weight() {
-  const int joiner_conv_layer_count = (int)joiner_conv_layers.size();
-
-  for (int i = 0; i < joiner_conv_layer_count; i++) {
-    const ncnn::Layer *layer = joiner_layers[joiner_conv_layers[i]];
-    if (layer->type == "Convolution") {
-      const ncnn::Convolution *convolution = (const ncnn::Convolution *)layer;
-      const int num_output = convolution->num_output;
-      const int kernel_w = convolution->kernel_w;
-      const int kernel_h = convolution->kernel_h;
-      const int dilation_w = convolution->dilation_w;
-      const int dilation_h = convolution->dilation_h;
-      const int stride_w = convolution->stride_w;
-      const int stride_h = convolution->stride_h;
-
-      const int weight_data_size_output =
-          convolution->weight_data_size / num_output;
-
-      // int8 winograd F43 needs weight data to use 6bit quantization
-      // TODO proper condition for winograd 3x3 int8
-      bool quant_6bit = false;
-      if (kernel_w == 3 && kernel_h == 3 && dilation_w == 1 &&
-          dilation_h == 1 && stride_w == 1 && stride_h == 1) {
-        quant_6bit = true;
-      }
+void NetQuantizer::compute_scales(int num_threads, float min_sqnr) {
+  for (int i = 0; i < (int)conv_layers.size(); i++) {
+    weight_scales[i] = compute_weight_scales(layers[conv_layers[i]]);
+  }
 
-      joiner_weight_scales[i].create(num_output);
-      for (int n = 0; n < num_output; n++) {
-        const ncnn::Mat weight_data_n = convolution->weight_data.range(
-            weight_data_size_output * n, weight_data_size_output);
+  // The threshold search of a blob takes O(num_histogram_bins^2) time and
+  // does not depend on other blobs
+  parallel_for(conv_bottom_blobs.size(), num_threads, [this](int i) {
+    float scale = compute_kl_threshold(quant_blob_stats[i], num_histogram_bins);
+
+    bottom_blob_scales[i].create(1);
+    bottom_blob_scales[i][0] = scale;
+  });
+
+  // The noise of the input and of the weights add up in the output of a
+  // layer, relative to its signal
+  for (int i = 0; i < (int)conv_layers.size(); i++) {
+    double signal = 0;
+    double noise = 0;
+    blob_noise(quant_blob_stats[i], num_histogram_bins, &signal, &noise);
+    double ratio = signal > 0 ? noise / signal : 0;
+
+    int num_output = 0;
+    signal = 0;
+    noise = 0;
+    weight_noise(get_weight_data(layers[conv_layers[i]], &num_output),
+                 weight_scales[i], &signal, &noise);
+    ratio += signal > 0 ? noise / signal : 0;
+
+    sqnr[i] = ratio > 0 ? -10 * log10(ratio) : FLT_MAX;
+    keep_float[i] = min_sqnr > 0 && sqnr[i] < min_sqnr;
+  }
+}
 
-        float absmax = 0.f;
-        for (int k = 0; k < weight_data_size_output; k++) {
-          absmax = std::max(absmax, (float)fabs(weight_data_n[k]));
-        }
+void NetQuantizer::print_quant_info() const {
+  double total_macs = 0;
+  double int8_macs = 0;
+  int num_int8 = 0;
+  float min_int8_sqnr = FLT_MAX;
 
-        if (quant_6bit) {
-          joiner_weight_scales[i][n] = 31 / absmax;
-        } else {
-          joiner_weight_scales[i][n] = 127 / absmax;
-        }
-      }
-    }  // if (layer->type == "Convolution")
+  for (int i = 0; i < (int)conv_bottom_blobs.size(); i++) {
+    const QuantBlobStat &stat = quant_blob_stats[i];
 
-    if (layer->type == "ConvolutionDepthWise") {
-      const ncnn::ConvolutionDepthWise *convolutiondepthwise =
-          (const ncnn::ConvolutionDepthWise *)layer;
+    float scale = 127 / stat.threshold;
 
-      const int group = convolutiondepthwise->group;
-      const int weight_data_size_output =
-          convolutiondepthwise->weight_data_size / group;
+    fprintf(stderr,
+            "%-40s : max = %-15f  threshold = %-15f  scale = %-15f  "
+            "sqnr = %6.1f dB  %s\n",
+            layers[conv_layers[i]]->name.c_str(), stat.absmax, stat.threshold,
+            scale, std::min(sqnr[i], 999.f), keep_float[i] ? "float" : "int8");
+
+    total_macs += macs[i];
+    if (!keep_float[i]) {
+      int8_macs += macs[i];
+      num_int8 += 1;
+      min_int8_sqnr = std::min(min_int8_sqnr, sqnr[i]);
+    }
+  }
 
-      std::vector<float> scales;
+  if (conv_layers.empty()) {
+    return;
+  }
 
-      joiner_weight_scales[i].create(group);
+  // The estimated speedup of int8 is proportional to the share of the MACs
+  // in int8 layers. The lowest SQNR bounds the accuracy loss: it is the
+  // layer that adds the most noise.
+  fprintf(stderr,
+          "int8 layers: %d/%d, int8 share of conv MACs: %.1f%%, lowest SQNR "
+          "of int8 layers: %.1f dB\n",
+          num_int8, (int)conv_layers.size(),
+          total_macs > 0 ? 100 * int8_macs / total_macs : 0,
+          num_int8 > 0 ? std::min(min_int8_sqnr, 999.f) : 0);
+}
 
-      for (int n = 0; n < group; n++) {
-        const ncnn::Mat weight_data_n = convolutiondepthwise->weight_data.range(
-            weight_data_size_output * n, weight_data_size_output);
+int NetQuantizer::save_table(const char *tablepath) const {
+  FILE *fp = fopen(tablepath, "wb");
+  if (!fp) {
+    fprintf(stderr, "fopen %s failed\n", tablepath);
+    return -1;
+  }
 
-        float absmax = 0.f;
-        for (int k = 0; k < weight_data_size_output; k++) {
-          absmax = std::max(absmax, (float)fabs(weight_data_n[k]));
-        }
+  // ncnn2int8 does not quantize layers that are not in the table
+  for (int i = 0; i < (int)conv_layers.size(); i++) {
+    if (keep_float[i]) continue;
 
-        joiner_weight_scales[i][n] = 127 / absmax;
-      }
-    }  // if (layer->type == "ConvolutionDepthWise")
+    const ncnn::Mat &weight_scale = weight_scales[i];
 
-    if (layer->type == "InnerProduct") {
-      const ncnn::InnerProduct *innerproduct =
-          (const ncnn::InnerProduct *)layer;
+    fprintf(fp, "%s_param_0 ", layers[conv_layers[i]]->name.c_str());
+    for (int j = 0; j < weight_scale.w; j++) {
+      fprintf(fp, "%f ", weight_scale[j]);
+    }
+    fprintf(fp, "\n");
+  }
 
-      const int num_output = innerproduct->num_output;
-      const int weight_data_size_output =
-          innerproduct->weight_data_size / num_output;
+  for (int i = 0; i < (int)conv_bottom_blobs.size(); i++) {
+    if (keep_float[i]) continue;
 
-      joiner_weight_scales[i].create(num_output);
+    const ncnn::Mat &bottom_blob_scale = bottom_blob_scales[i];
 
-      for (int n = 0; n < num_output; n++) {
-        const ncnn::Mat weight_data_n = innerproduct->weight_data.range(
-            weight_data_size_output * n, weight_data_size_output);
+    fprintf(fp, "%s ", layers[conv_layers[i]]->name.c_str());
+    for (int j = 0; j < bottom_blob_scale.w; j++) {
+      fprintf(fp, "%f ", bottom_blob_scale[j]);
+    }
+    fprintf(fp, "\n");
+  }
 
-        float absmax = 0.f;
-        for (int k = 0; k < weight_data_size_output; k++) {
-          absmax = std::max(absmax, (float)fabs(weight_data_n[k]));
-        }
+  fclose(fp);
 
-        joiner_weight_scales[i][n] = 127 / absmax;
-      }
-    }  // if (layer->type == "InnerProduct")
-  }    // for (int i = 0; i < joiner_conv_layer_count; i++)
+  return 0;
 }
 
-int QuantNet::quantize_KL(const std::vector<std::string> &wave_filenames) {
-  const int encoder_conv_bottom_blob_count =
-      (int)encoder_conv_bottom_blobs.size();
+class QuantNet {
+ public:
+  QuantNet(sherpa_ncnn::Model *model, int num_threads, float min_sqnr);
+
+  sherpa_ncnn::Model *model;
 
-  const int joiner_conv_bottom_blob_count =
-      (int)joiner_conv_bottom_blobs.size();
+  // Number of threads that run the model and search the thresholds
+  int num_threads;
 
-  fprintf(stderr, "num files: %d\n", (int)wave_filenames.size());
+  // Layers with a lower estimated SQNR in dB are kept in float
+  float min_sqnr;
 
-  const int num_histogram_bins = 2048;
-  std::vector<ncnn::UnlockedPoolAllocator> blob_allocators(1);
-  std::vector<ncnn::UnlockedPoolAllocator> workspace_allocators(1);
+ public:
+  int init();
+  void print_quant_info() const;
+  int save_table_encoder(const char *tablepath);
+  int save_table_decoder(const char *tablepath);
+  int save_table_joiner(const char *tablepath);
+  int quantize_KL(const std::vector<std::string> &wave_filenames);
+  int quantize_ACIQ();
+  int quantize_EQ();
 
-  // initialize conv weight scales
-  quantize_encoder_weight();
-  quantize_joiner_weight();
+ private:
+  // Run the encoder and greedy search with the decoder and the joiner over
+  // a wave file and collect the statistics of their blobs into encoder,
+  // decoder and joiner
+  void process_file(const std::string &filename, bool histogram_pass,
+                    NetQuantizer *encoder, NetQuantizer *decoder,
+                    NetQuantizer *joiner, ncnn::Allocator *blob_allocator,
+                    ncnn::Allocator *workspace_allocator);
 
-  float expected_sampling_rate = 16000;
+ public:
+  NetQuantizer encoder_quantizer;
+  NetQuantizer decoder_quantizer;
+  NetQuantizer joiner_quantizer;
+};
 
-  knf::FbankOptions fbank_opts;
-  fbank_opts.frame_opts.dither = 0;
-  fbank_opts.frame_opts.snip_edges = false;
-  fbank_opts.frame_opts.samp_freq = expected_sampling_rate;
-  fbank_opts.mel_opts.num_bins = 80;
+QuantNet::QuantNet(sherpa_ncnn::Model *model, int num_threads,
+                   float min_sqnr)
+    : model(model),
+      num_threads(num_threads),
+      min_sqnr(min_sqnr),
+      encoder_quantizer(model->GetEncoder()),
+      decoder_quantizer(model->GetDecoder()),
+      joiner_quantizer(model->GetJoiner()) {}
 
-  // Please see
-  // https://github.com/lhotse-speech/lhotse/blob/master/lhotse/features/fbank.py#L27
-  // and
-  // https://github.com/k2-fsa/sherpa-onnx/issues/514
-  fbank_opts.mel_opts.high_freq = -400;
+int QuantNet::init() {
+  encoder_quantizer.init();
+  fprintf(stderr, "num encoder conv layers: %d\n",
+          static_cast<int32_t>(encoder_quantizer.conv_layers.size()));
 
-  int32_t segment = model->Segment();
-  int32_t offset = model->Offset();
+  decoder_quantizer.init();
+  fprintf(stderr, "num decoder conv layers: %d\n",
+          static_cast<int32_t>(decoder_quantizer.conv_layers.size()));
 
-  // count the absmax
-  for (const auto &filename : wave_filenames) {
-    bool is_ok = false;
-    std::vector<float> samples =
-        sherpa_ncnn::ReadWave(filename, expected_sampling_rate, &is_ok);
-    if (!is_ok) {
-      fprintf(stderr, "Failed to read %s\n", filename.c_str());
-      continue;
-    }
-    fprintf(stderr, "Processing %s\n", filename.c_str());
+  joiner_quantizer.init();
+  fprintf(stderr, "num joiner conv layers: %d\n",
+          static_cast<int32_t>(joiner_quantizer.conv_layers.size()));
+
+  return 0;
+}
+
+void QuantNet::process_file(const std::string &filename, bool histogram_pass,
+                            NetQuantizer *encoder, NetQuantizer *decoder,
+                            NetQuantizer *joiner,
+                            ncnn::Allocator *blob_allocator,
+                            ncnn::Allocator *workspace_allocator) {
+  float expected_sampling_rate = 16000;
+
+  bool is_ok = false;
+  std::vector<float> samples =
+      sherpa_ncnn::ReadWave(filename, expected_sampling_rate, &is_ok);
+  if (!is_ok) {
+    fprintf(stderr, "Failed to read %s\n", filename.c_str());
+    return;
+  }
+  fprintf(stderr, "Processing %s\n", filename.c_str());
 
-    sherpa_ncnn::FeatureExtractorConfig config;
-    config.sampling_rate = 16000;
-    config.feature_dim = 80;
-    sherpa_ncnn::FeatureExtractor feature_extractor(config);
-    feature_extractor.AcceptWaveform(expected_sampling_rate, samples.data(),
-                                     samples.size());
-    feature_extractor.InputFinished();
+  sherpa_ncnn::FeatureExtractorConfig config;
+  config.sampling_rate = 16000;
+  config.feature_dim = 80;
+  sherpa_ncnn::FeatureExtractor feature_extractor(config);
+  feature_extractor.AcceptWaveform(expected_sampling_rate, samples.data(),
+                                   samples.size());
+  feature_extractor.InputFinished();
 
-    int32_t context_size = model->ContextSize();
-    int32_t blank_id = model->BlankId();
+  int32_t segment = model->Segment();
+  int32_t offset = model->Offset();
+  int32_t context_size = model->ContextSize();
+  int32_t blank_id = model->BlankId();
 
-    std::vector<int32_t> hyp(context_size, blank_id);
+  std::vector<int32_t> hyp(context_size, blank_id);
 
-    ncnn::Mat decoder_input(context_size);
+  // The decoder is run with the last context_size tokens of hyp
+  ncnn::Mat decoder_input(context_size);
+  auto run_decoder = [&]() {
     for (int32_t i = 0; i != context_size; ++i) {
-      static_cast<int32_t *>(decoder_input)[i] = blank_id;
+      static_cast<int32_t *>(decoder_input)[i] =
+          hyp[hyp.size() - context_size + i];
     }
 
-    ncnn::Mat decoder_out = model->RunDecoder(decoder_input);
-
-    std::vector<ncnn::Mat> states;
-    ncnn::Mat encoder_out;
-
-    int32_t num_processed = 0;
-    while (feature_extractor.NumFramesReady() - num_processed >= segment) {
-      ncnn::Extractor encoder_ex = model->GetEncoder().create_extractor();
-      encoder_ex.set_light_mode(false);
-      encoder_ex.set_blob_allocator(&blob_allocators[0]);
-      encoder_ex.set_workspace_allocator(&workspace_allocators[0]);
-
-      ncnn::Extractor joiner_ex = model->GetJoiner().create_extractor();
-      joiner_ex.set_light_mode(false);
-      joiner_ex.set_blob_allocator(&blob_allocators[0]);
-      joiner_ex.set_workspace_allocator(&workspace_allocators[0]);
-
-      ncnn::Mat features = feature_extractor.GetFrames(num_processed, segment);
-      num_processed += offset;
-      std::tie(encoder_out, states) =
-          model->RunEncoder(features, states, &encoder_ex);
-
-      for (int j = 0; j < encoder_conv_bottom_blob_count; j++) {
-        ncnn::Mat out;
-        encoder_ex.extract(encoder_conv_bottom_blobs[j], out);
-
-        {
-          // count absmax
-          float absmax = 0.f;
-
-          const int outc = out.c;
-          const int outsize = out.w * out.h;
-          for (int p = 0; p < outc; p++) {
-            const float *ptr = out.channel(p);
-            for (int k = 0; k < outsize; k++) {
-              absmax = std::max(absmax, (float)fabs(ptr[k]));
-            }
-          }
+    ncnn::Extractor decoder_ex = model->GetDecoder().create_extractor();
+    decoder_ex.set_light_mode(false);
+    decoder_ex.set_blob_allocator(blob_allocator);
+    decoder_ex.set_workspace_allocator(workspace_allocator);
 
-          QuantBlobStat &stat = encoder_quant_blob_stats[j];
-          stat.absmax = std::max(stat.absmax, absmax);
-        }
-      }  // for (int j = 0; j < encoder_conv_bottom_blob_count; j++)
-
-      // now for joiner
-      for (int32_t t = 0; t != encoder_out.h; ++t) {
-        ncnn::Mat encoder_out_t(encoder_out.w, encoder_out.row(t));
-        ncnn::Mat joiner_out =
-            model->RunJoiner(encoder_out_t, decoder_out, &joiner_ex);
-
-        for (int j = 0; j < joiner_conv_bottom_blob_count; j++) {
-          ncnn::Mat out;
-          joiner_ex.extract(joiner_conv_bottom_blobs[j], out);
-
-          {
-            // count absmax
-            float absmax = 0.f;
-
-            const int outc = out.c;
-            const int outsize = out.w * out.h;
-            for (int p = 0; p < outc; p++) {
-              const float *ptr = out.channel(p);
-              for (int k = 0; k < outsize; k++) {
-                absmax = std::max(absmax, (float)fabs(ptr[k]));
-              }
-            }
-
-            QuantBlobStat &stat = joiner_quant_blob_stats[j];
-            stat.absmax = std::max(stat.absmax, absmax);
-          }
-        }  // for (int j = 0; j < joiner_conv_bottom_blob_count; j++)
+    ncnn::Mat decoder_out = model->RunDecoder(decoder_input, &decoder_ex);
 
-        auto y = static_cast<int32_t>(std::distance(
-            static_cast<const float *>(joiner_out),
-            std::max_element(
-                static_cast<const float *>(joiner_out),
-                static_cast<const float *>(joiner_out) + joiner_out.w)));
+    if (histogram_pass) {
+      decoder->collect_histogram(&decoder_ex);
+    } else {
+      decoder->collect_absmax(&decoder_ex);
+    }
 
-        if (y != blank_id) {
-          static_cast<int32_t *>(decoder_input)[0] = hyp.back();
-          static_cast<int32_t *>(decoder_input)[1] = y;
-          hyp.push_back(y);
+    return decoder_out;
+  };
 
-          decoder_out = model->RunDecoder(decoder_input);
-        }
-      }  // for (int32_t t = 0; t != encoder_out.h; ++t)
+  ncnn::Mat decoder_out = run_decoder();
 
-    }  // while (feature_extractor.NumFramesReady() - num_processed >=
-       // segment)
-  }    // for (const auto &filename : wave_filenames)
+  std::vector<ncnn::Mat> states;
+  ncnn::Mat encoder_out;
 
-  // initialize histogram
-  for (int i = 0; i < encoder_conv_bottom_blob_count; i++) {
-    QuantBlobStat &stat = encoder_quant_blob_stats[i];
+  int32_t num_processed = 0;
+  while (feature_extractor.NumFramesReady() - num_processed >= segment) {
+    ncnn::Extractor encoder_ex = model->GetEncoder().create_extractor();
+    encoder_ex.set_light_mode(false);
+    encoder_ex.set_blob_allocator(blob_allocator);
+    encoder_ex.set_workspace_allocator(workspace_allocator);
 
-    stat.histogram.resize(num_histogram_bins, 0);
-    stat.histogram_normed.resize(num_histogram_bins, 0);
-  }
+    ncnn::Extractor joiner_ex = model->GetJoiner().create_extractor();
+    joiner_ex.set_light_mode(false);
+    joiner_ex.set_blob_allocator(blob_allocator);
+    joiner_ex.set_workspace_allocator(workspace_allocator);
 
-  for (int i = 0; i < joiner_conv_bottom_blob_count; i++) {
-    QuantBlobStat &stat = joiner_quant_blob_stats[i];
+    ncnn::Mat features = feature_extractor.GetFrames(num_processed, segment);
+    num_processed += offset;
 
-    stat.histogram.resize(num_histogram_bins, 0);
-    stat.histogram_normed.resize(num_histogram_bins, 0);
-  }
+    // The states of a chunk are the input of the next one, so that the
+    // blobs are the ones of streaming recognition. They are initialized
+    // by RunEncoder() when empty
+    std::tie(encoder_out, states) =
+        model->RunEncoder(features, states, &encoder_ex);
 
-  // build histogram
-  for (const auto &filename : wave_filenames) {
-    bool is_ok = false;
-    std::vector<float> samples =
-        sherpa_ncnn::ReadWave(filename, expected_sampling_rate, &is_ok);
-    if (!is_ok) {
-      fprintf(stderr, "Failed to read %s\n", filename.c_str());
-      continue;
+    if (histogram_pass) {
+      encoder->collect_histogram(&encoder_ex);
+    } else {
+      encoder->collect_absmax(&encoder_ex);
     }
-    fprintf(stderr, "Processing %s\n", filename.c_str());
-
-    sherpa_ncnn::FeatureExtractorConfig config;
-    config.sampling_rate = 16000;
-    config.feature_dim = 80;
-    sherpa_ncnn::FeatureExtractor feature_extractor(config);
-    feature_extractor.AcceptWaveform(expected_sampling_rate, samples.data(),
-                                     samples.size());
-    feature_extractor.InputFinished();
 
-    int32_t context_size = model->ContextSize();
-    int32_t blank_id = model->BlankId();
+    // now for joiner
+    for (int32_t t = 0; t != encoder_out.h; ++t) {
+      ncnn::Mat encoder_out_t(encoder_out.w, encoder_out.row(t));
+      ncnn::Mat joiner_out =
+          model->RunJoiner(encoder_out_t, decoder_out, &joiner_ex);
 
-    std::vector<int32_t> hyp(context_size, blank_id);
+      if (histogram_pass) {
+        joiner->collect_histogram(&joiner_ex);
+      } else {
+        joiner->collect_absmax(&joiner_ex);
+      }
 
-    ncnn::Mat decoder_input(context_size);
-    for (int32_t i = 0; i != context_size; ++i) {
-      static_cast<int32_t *>(decoder_input)[i] = blank_id;
-    }
+      auto y = static_cast<int32_t>(std::distance(
+          static_cast<const float *>(joiner_out),
+          std::max_element(
+              static_cast<const float *>(joiner_out),
+              static_cast<const float *>(joiner_out) + joiner_out.w)));
 
-    ncnn::Mat decoder_out = model->RunDecoder(decoder_input);
+      if (y != blank_id) {
+        hyp.push_back(y);
 
-    std::vector<ncnn::Mat> states;
-    ncnn::Mat encoder_out;
+        decoder_out = run_decoder();
+      }
+    }  // for (int32_t t = 0; t != encoder_out.h; ++t)
+  }    // while (feature_extractor.NumFramesReady() - num_processed >=
+       // segment)
+}
 
-    int32_t num_processed = 0;
-    while (feature_extractor.NumFramesReady() - num_processed >= segment) {
-      ncnn::Extractor encoder_ex = model->GetEncoder().create_extractor();
-      encoder_ex.set_light_mode(false);
-      encoder_ex.set_blob_allocator(&blob_allocators[0]);
-      encoder_ex.set_workspace_allocator(&workspace_allocators[0]);
+int QuantNet::quantize_KL(const std::vector<std::string> &wave_filenames) {
+  fprintf(stderr, "num files: %d\n", (int)wave_filenames.size());
+  fprintf(stderr, "num threads: %d\n", num_threads);
+
+  std::vector<ncnn::UnlockedPoolAllocator> blob_allocators(num_threads);
+  std::vector<ncnn::UnlockedPoolAllocator> workspace_allocators(num_threads);
+
+  // The first pass counts the absmax and the second one builds the
+  // histograms
+  for (int pass = 0; pass != 2; ++pass) {
+    bool histogram_pass = pass == 1;
+    if (histogram_pass) {
+      encoder_quantizer.init_histogram();
+      decoder_quantizer.init_histogram();
+      joiner_quantizer.init_histogram();
+    }
 
-      ncnn::Extractor joiner_ex = model->GetJoiner().create_extractor();
-      joiner_ex.set_light_mode(false);
-      joiner_ex.set_blob_allocator(&blob_allocators[0]);
-      joiner_ex.set_workspace_allocator(&workspace_allocators[0]);
+    std::vector<NetQuantizer> encoders(num_threads, encoder_quantizer);
+    std::vector<NetQuantizer> decoders(num_threads, decoder_quantizer);
+    std::vector<NetQuantizer> joiners(num_threads, joiner_quantizer);
+
+    parallel_for(wave_filenames.size(), num_threads, [&](int i) {
+      int w = current_worker;
+      process_file(wave_filenames[i], histogram_pass, &encoders[w],
+                   &decoders[w], &joiners[w], &blob_allocators[w],
+                   &workspace_allocators[w]);
+    });
+
+    for (int w = 0; w < num_threads; w++) {
+      if (histogram_pass) {
+        encoder_quantizer.merge_histogram(encoders[w]);
+        decoder_quantizer.merge_histogram(decoders[w]);
+        joiner_quantizer.merge_histogram(joiners[w]);
+      } else {
+        encoder_quantizer.merge_absmax(encoders[w]);
+        decoder_quantizer.merge_absmax(decoders[w]);
+        joiner_quantizer.merge_absmax(joiners[w]);
+      }
+    }
+  }
 
-      ncnn::Mat features = feature_extractor.GetFrames(num_processed, segment);
-      num_processed += offset;
-      std::tie(encoder_out, states) =
-          model->RunEncoder(features, states, &encoder_ex);
+  // using kld to find the best threshold value
+  encoder_quantizer.compute_scales(num_threads, min_sqnr);
+  decoder_quantizer.compute_scales(num_threads, min_sqnr);
+  joiner_quantizer.compute_scales(num_threads, min_sqnr);
 
-      for (int j = 0; j < encoder_conv_bottom_blob_count; j++) {
-        ncnn::Mat out;
-        encoder_ex.extract(encoder_conv_bottom_blobs[j], out);
+  return 0;
+}
 
-        // count histogram bin
-        {
-          const float absmax = encoder_quant_blob_stats[j].absmax;
+void QuantNet::print_quant_info() const {
+  fprintf(stderr, "----------encoder----------\n");
+  encoder_quantizer.print_quant_info();
 
-          std::vector<uint64_t> histogram(num_histogram_bins, 0);
+  fprintf(stderr, "----------decoder----------\n");
+  decoder_quantizer.print_quant_info();
 
-          const int outc = out.c;
-          const int outsize = out.w * out.h;
-          for (int p = 0; p < outc; p++) {
-            const float *ptr = out.channel(p);
-            for (int k = 0; k < outsize; k++) {
-              if (ptr[k] == 0.f) continue;
+  fprintf(stderr, "----------joiner----------\n");
+  joiner_quantizer.print_quant_info();
+}
 
-              const int index =
-                  std::min((int)(fabs(ptr[k]) / absmax * num_histogram_bins),
-                           (num_histogram_bins - 1));
+int QuantNet::save_table_encoder(const char *tablepath) {
+  return encoder_quantizer.save_table(tablepath);
+}
 
-              histogram[index] += 1;
-            }
-          }
+int QuantNet::save_table_decoder(const char *tablepath) {
+  return decoder_quantizer.save_table(tablepath);
+}
 
-          QuantBlobStat &stat = encoder_quant_blob_stats[j];
+int QuantNet::save_table_joiner(const char *tablepath) {
+  int ret = joiner_quantizer.save_table(tablepath);
+  if (ret != 0) {
+    return ret;
+  }
 
-          for (int k = 0; k < num_histogram_bins; k++) {
-            stat.histogram[k] += histogram[k];
-          }
-        }
-      }  // for (int j = 0; j < encoder_conv_bottom_blob_count; j++)
+  fprintf(stderr,
+          "ncnn int8 calibration table create success, best wish for your int8 "
+          "inference has a low accuracy loss...\\(^0^)/...233...\n");
 
-      // now for joiner
-      for (int32_t t = 0; t != encoder_out.h; ++t) {
-        ncnn::Mat encoder_out_t(encoder_out.w, encoder_out.row(t));
-        ncnn::Mat joiner_out =
-            model->RunJoiner(encoder_out_t, decoder_out, &joiner_ex);
+  return 0;
+}
 
-        for (int j = 0; j < joiner_conv_bottom_blob_count; j++) {
-          ncnn::Mat out;
-          joiner_ex.extract(joiner_conv_bottom_blobs[j], out);
+// Calibrate the encoder, dp, flow and decoder nets of a VITS model by
+// generating the audio of each line of text_filename. It writes
+// <name>-scale-table.txt of each net to output_dir.
+static int CalibrateTts(const std::string &model_dir,
+                        const char *text_filename,
+                        const std::string &output_dir, int num_threads,
+                        float min_sqnr) {
+  std::vector<std::string> texts;
+  {
+    std::ifstream in(text_filename);
+    std::string line;
+    while (std::getline(in, line)) {
+      if (!line.empty()) {
+        texts.push_back(line);
+      }
+    }
+  }
 
-          // count histogram bin
-          {
-            const float absmax = joiner_quant_blob_stats[j].absmax;
+  if (texts.empty()) {
+    fprintf(stderr, "There are no texts in %s\n", text_filename);
+    return 1;
+  }
 
-            std::vector<uint64_t> histogram(num_histogram_bins, 0);
+  fprintf(stderr, "num texts: %d\n", (int)texts.size());
+  fprintf(stderr, "num threads: %d\n", num_threads);
 
-            const int outc = out.c;
-            const int outsize = out.w * out.h;
-            for (int p = 0; p < outc; p++) {
-              const float *ptr = out.channel(p);
-              for (int k = 0; k < outsize; k++) {
-                if (ptr[k] == 0.f) continue;
+  // The names of the nets to calibrate, in the order they are run
+  const std::vector<std::string> names = {"encoder", "dp", "flow", "decoder"};
 
-                const int index =
-                    std::min((int)(fabs(ptr[k]) / absmax * num_histogram_bins),
-                             (num_histogram_bins - 1));
+  using Quantizers = std::map<std::string, std::unique_ptr<NetQuantizer>>;
 
-                histogram[index] += 1;
-              }
-            }
+  // Each thread collects the statistics of the texts it generates into
+  // its own quantizers, which are merged into `merged` after each pass
+  std::vector<Quantizers> quantizers(num_threads);
+  Quantizers merged;
+  bool histogram_pass = false;
 
-            QuantBlobStat &stat = joiner_quant_blob_stats[j];
+  sherpa_ncnn::OfflineTtsVitsModel::SetCalibrationHook(
+      [&](const std::string &name, const ncnn::Net &net,
+          ncnn::Extractor *ex) {
+        if (std::find(names.begin(), names.end(), name) == names.end()) {
+          return;
+        }
 
-            for (int k = 0; k < num_histogram_bins; k++) {
-              stat.histogram[k] += histogram[k];
-            }
+        auto &q = quantizers[current_worker][name];
+        if (!q) {
+          if (histogram_pass) {
+            // Not run in the first pass
+            return;
           }
-        }  // for (int j = 0; j < joiner_conv_bottom_blob_count; j++)
-
-        auto y = static_cast<int32_t>(std::distance(
-            static_cast<const float *>(joiner_out),
-            std::max_element(
-                static_cast<const float *>(joiner_out),
-                static_cast<const float *>(joiner_out) + joiner_out.w)));
 
-        if (y != blank_id) {
-          static_cast<int32_t *>(decoder_input)[0] = hyp.back();
-          static_cast<int32_t *>(decoder_input)[1] = y;
-          hyp.push_back(y);
+          q = std::make_unique<NetQuantizer>(net);
+          q->init();
+        }
 
-          decoder_out = model->RunDecoder(decoder_input);
+        if (histogram_pass) {
+          q->collect_histogram(ex);
+        } else {
+          q->collect_absmax(ex);
         }
-      }  // for (int32_t t = 0; t != encoder_out.h; ++t)
+      });
 
-    }  // while (feature_extractor.NumFramesReady() - num_processed >=
-       // segment)
-  }    // for (const auto &filename : wave_filenames)
+  sherpa_ncnn::OfflineTtsConfig config;
+  config.model.vits.model_dir = model_dir;
 
-  // using kld to find the best threshold value
-  for (int i = 0; i < encoder_conv_bottom_blob_count; i++) {
-    QuantBlobStat &stat = encoder_quant_blob_stats[i];
+  config.model.num_threads = 1;
 
-    float scale = compute_kl_threshold(stat, num_histogram_bins);
+  // Both passes must see the same blobs, so the noise is fixed. The
+  // sentences of a text run on the calling thread, which the hook uses
+  // to find its quantizers.
+  config.seed = 0;
+  config.max_num_sentences = 1;
 
-    encoder_bottom_blob_scales[i].create(1);
-    encoder_bottom_blob_scales[i][0] = scale;
-  }  // for (int i = 0; i < encoder_conv_bottom_blob_count; i++)
+  if (!config.Validate()) {
+    fprintf(stderr, "Errors in config!\n");
+    return 1;
+  }
 
-  for (int i = 0; i < joiner_conv_bottom_blob_count; i++) {
-    QuantBlobStat &stat = joiner_quant_blob_stats[i];
+  sherpa_ncnn::OfflineTts tts(config);
+
+  for (int pass = 0; pass != 2; ++pass) {
+    histogram_pass = pass == 1;
+    if (histogram_pass) {
+      for (auto &p : merged) {
+        p.second->init_histogram();
+        for (auto &qs : quantizers) {
+          qs[p.first] = std::make_unique<NetQuantizer>(*p.second);
+        }
+      }
+    }
+
+    parallel_for(texts.size(), num_threads, [&](int i) {
+      fprintf(stderr, "Processing %s\n", texts[i].c_str());
+
+      sherpa_ncnn::TtsArgs args;
+      args.text = texts[i];
+      tts.Generate(args);
+    });
+
+    for (auto &qs : quantizers) {
+      for (auto &p : qs) {
+        auto &m = merged[p.first];
+        if (!m) {
+          m = std::make_unique<NetQuantizer>(*p.second);
+        } else if (histogram_pass) {
+          m->merge_histogram(*p.second);
+        } else {
+          m->merge_absmax(*p.second);
+        }
+      }
+      qs.clear();
+    }
+  }
 
-    float scale = compute_kl_threshold(stat, num_histogram_bins);
+  sherpa_ncnn::OfflineTtsVitsModel::SetCalibrationHook(nullptr);
 
-    joiner_bottom_blob_scales[i].create(1);
-    joiner_bottom_blob_scales[i][0] = scale;
-  }  // for (int i = 0; i < joiner_conv_bottom_blob_count; i++)
+  for (const auto &name : names) {
+    auto it = merged.find(name);
+    if (it == merged.end()) {
+      continue;
+    }
 
-  return 0;
-}
+    NetQuantizer &q = *it->second;
+    fprintf(stderr, "num %s conv layers: %d\n", name.c_str(),
+            (int)q.conv_layers.size());
 
-void QuantNet::print_quant_info() const {
-  fprintf(stderr, "----------encoder----------\n");
-  for (int i = 0; i < (int)encoder_conv_bottom_blobs.size(); i++) {
-    const QuantBlobStat &stat = encoder_quant_blob_stats[i];
+    q.compute_scales(num_threads, min_sqnr);
 
-    float scale = 127 / stat.threshold;
+    fprintf(stderr, "----------%s----------\n", name.c_str());
+    q.print_quant_info();
 
-    fprintf(stderr, "%-40s : max = %-15f  threshold = %-15f  scale = %-15f\n",
-            encoder_layers[encoder_conv_layers[i]]->name.c_str(), stat.absmax,
-            stat.threshold, scale);
+    std::string table = output_dir + "/" + name + "-scale-table.txt";
+    if (q.save_table(table.c_str()) != 0) {
+      return 1;
+    }
   }
 
-  fprintf(stderr, "----------joiner----------\n");
-  // for joiner
-  for (int i = 0; i < (int)joiner_conv_bottom_blobs.size(); i++) {
-    const QuantBlobStat &stat = joiner_quant_blob_stats[i];
+  fprintf(stderr,
+          "ncnn int8 calibration table create success, best wish for your int8 "
+          "inference has a low accuracy loss...\\(^0^)/...233...\n");
 
-    float scale = 127 / stat.threshold;
+  return 0;
+}
 
-    fprintf(stderr, "%-40s : max = %-15f  threshold = %-15f  scale = %-15f\n",
-            joiner_layers[joiner_conv_layers[i]]->name.c_str(), stat.absmax,
-            stat.threshold, scale);
+static std::vector<std::string> ReadWaveFilenames(const char *f) {
+  std::ifstream in(f);
+  std::vector<std::string> ans;
+  std::string line;
+  while (std::getline(in, line)) {
+    ans.push_back(line);
   }
+  return ans;
 }
 
-int QuantNet::save_table_encoder(const char *tablepath) {
-  FILE *fp = fopen(tablepath, "wb");
-  if (!fp) {
-    fprintf(stderr, "fopen %s failed\n", tablepath);
-    return -1;
+// Calibrate the net of a SenseVoice model by recognizing each wave file
+// of wave_filenames, so that the blobs are the ones of the real LFR
+// features, prompt and position encodings. It writes the scale table of
+// the net to tablepath.
+static int CalibrateSenseVoice(const std::string &model_dir,
+                               const char *wave_filenames,
+                               const char *tablepath, int num_threads,
+                               float min_sqnr) {
+  std::vector<std::string> filenames = ReadWaveFilenames(wave_filenames);
+  if (filenames.empty()) {
+    fprintf(stderr, "There are no wave files in %s\n", wave_filenames);
+    return 1;
   }
 
-  const int encoder_conv_layer_count = (int)encoder_conv_layers.size();
-  const int encoder_conv_bottom_blob_count =
-      (int)encoder_conv_bottom_blobs.size();
+  fprintf(stderr, "num files: %d\n", (int)filenames.size());
+  fprintf(stderr, "num threads: %d\n", num_threads);
+
+  // Each thread collects the statistics of the files it recognizes into
+  // its own quantizer, which is merged into `merged` after each pass
+  std::vector<std::unique_ptr<NetQuantizer>> quantizers(num_threads);
+  std::unique_ptr<NetQuantizer> merged;
+  bool histogram_pass = false;
+
+  sherpa_ncnn::OfflineSenseVoiceModel::SetCalibrationHook(
+      [&](const ncnn::Net &net, ncnn::Extractor *ex) {
+        auto &q = quantizers[current_worker];
+        if (!q) {
+          q = std::make_unique<NetQuantizer>(net);
+          q->init();
+        }
 
-  for (int i = 0; i < encoder_conv_layer_count; i++) {
-    const ncnn::Mat &weight_scale = encoder_weight_scales[i];
+        if (histogram_pass) {
+          q->collect_histogram(ex);
+        } else {
+          q->collect_absmax(ex);
+        }
+      });
 
-    fprintf(fp, "%s_param_0 ",
-            encoder_layers[encoder_conv_layers[i]]->name.c_str());
-    for (int j = 0; j < weight_scale.w; j++) {
-      fprintf(fp, "%f ", weight_scale[j]);
-    }
-    fprintf(fp, "\n");
-  }
+  sherpa_ncnn::OfflineRecognizerConfig config;
+  config.model_config.sense_voice.model_dir = model_dir;
+  config.model_config.tokens = model_dir + "/tokens.txt";
 
-  for (int i = 0; i < encoder_conv_bottom_blob_count; i++) {
-    const ncnn::Mat &bottom_blob_scale = encoder_bottom_blob_scales[i];
+  // Files are processed in parallel, and each one is run on the calling
+  // thread, which the hook uses to find its quantizer
+  config.model_config.num_threads = 1;
 
-    fprintf(fp, "%s ", encoder_layers[encoder_conv_layers[i]]->name.c_str());
-    for (int j = 0; j < bottom_blob_scale.w; j++) {
-      fprintf(fp, "%f ", bottom_blob_scale[j]);
-    }
-    fprintf(fp, "\n");
+  if (!config.Validate()) {
+    fprintf(stderr, "Errors in config!\n");
+    return 1;
   }
 
-  fclose(fp);
+  sherpa_ncnn::OfflineRecognizer recognizer(config);
 
-  return 0;
-}
+  for (int pass = 0; pass != 2; ++pass) {
+    histogram_pass = pass == 1;
+    if (histogram_pass) {
+      if (!merged) {
+        fprintf(stderr, "None of the files could be read\n");
+        return 1;
+      }
 
-int QuantNet::save_table_joiner(const char *tablepath) {
-  FILE *fp = fopen(tablepath, "wb");
-  if (!fp) {
-    fprintf(stderr, "fopen %s failed\n", tablepath);
-    return -1;
-  }
+      merged->init_histogram();
+      for (auto &q : quantizers) {
+        q = std::make_unique<NetQuantizer>(*merged);
+      }
+    }
 
-  const int joiner_conv_layer_count = (int)joiner_conv_layers.size();
-  const int joiner_conv_bottom_blob_count =
-      (int)joiner_conv_bottom_blobs.size();
+    parallel_for(filenames.size(), num_threads, [&](int i) {
+      bool is_ok = false;
+      std::vector<float> samples =
+          sherpa_ncnn::ReadWave(filenames[i], 16000, &is_ok);
+      if (!is_ok) {
+        fprintf(stderr, "Failed to read %s\n", filenames[i].c_str());
+        return;
+      }
+      fprintf(stderr, "Processing %s\n", filenames[i].c_str());
 
-  for (int i = 0; i < joiner_conv_layer_count; i++) {
-    const ncnn::Mat &weight_scale = joiner_weight_scales[i];
+      auto s = recognizer.CreateStream();
+      s->AcceptWaveform(16000, samples.data(), samples.size());
+      recognizer.DecodeStream(s.get());
+    });
 
-    fprintf(fp, "%s_param_0 ",
-            joiner_layers[joiner_conv_layers[i]]->name.c_str());
+    for (auto &q : quantizers) {
+      if (!q) {
+        continue;
+      }
 
-    for (int j = 0; j < weight_scale.w; j++) {
-      fprintf(fp, "%f ", weight_scale[j]);
+      if (!merged) {
+        merged = std::make_unique<NetQuantizer>(*q);
+      } else if (histogram_pass) {
+        merged->merge_histogram(*q);
+      } else {
+        merged->merge_absmax(*q);
+      }
+      q.reset();
     }
-    fprintf(fp, "\n");
   }
 
-  for (int i = 0; i < joiner_conv_bottom_blob_count; i++) {
-    const ncnn::Mat &bottom_blob_scale = joiner_bottom_blob_scales[i];
+  sherpa_ncnn::OfflineSenseVoiceModel::SetCalibrationHook(nullptr);
 
-    fprintf(fp, "%s ", joiner_layers[joiner_conv_layers[i]]->name.c_str());
-    for (int j = 0; j < bottom_blob_scale.w; j++) {
-      fprintf(fp, "%f ", bottom_blob_scale[j]);
-    }
-    fprintf(fp, "\n");
-  }
+  fprintf(stderr, "num conv layers: %d\n", (int)merged->conv_layers.size());
 
-  fclose(fp);
+  merged->compute_scales(num_threads, min_sqnr);
+  merged->print_quant_info();
+
+  if (merged->save_table(tablepath) != 0) {
+    return 1;
+  }
 
   fprintf(stderr,
           "ncnn int8 calibration table create success, best wish for your int8 "
@@ -972,50 +1194,118 @@ int QuantNet::save_table_joiner(const char *tablepath) {
   return 0;
 }
 
-static std::vector<std::string> ReadWaveFilenames(const char *f) {
-  std::ifstream in(f);
-  std::vector<std::string> ans;
-  std::string line;
-  while (std::getline(in, line)) {
-    ans.push_back(line);
-  }
-  return ans;
-}
-
 static void ShowUsage() {
   fprintf(
       stderr,
       "Usage:\ngenerate-int8-scale-table encoder.param "
       "encoder.bin decoder.param decoder.bin joiner.param joiner.bin "
-      "encoder-scale-table.txt joiner-scale-table.txt wave_filenames.txt\n\n"
+      "encoder-scale-table.txt joiner-scale-table.txt wave_filenames.txt "
+      "[--decoder-scale-table=decoder-scale-table.txt] "
+      "[--num-threads=N] [--min-layer-sqnr=DB]\n\n"
       "Each line in wave_filenames.txt is a path to some 16k Hz mono wave "
-      "file.\n");
+      "file. It supports all streaming transducer models, e.g., "
+      "ConvEmformer, LSTM and Zipformer. The scale table of the decoder is "
+      "written only if --decoder-scale-table is given.\n\n"
+      "For VITS text-to-speech models:\n"
+      "generate-int8-scale-table --tts vits-model-dir texts.txt "
+      "output-dir [--num-threads=N] [--min-layer-sqnr=DB]\n\n"
+      "Each line in texts.txt is a text to synthesize. It writes "
+      "encoder-scale-table.txt, dp-scale-table.txt, flow-scale-table.txt "
+      "and decoder-scale-table.txt to output-dir. Convert a net with, "
+      "e.g.,\n"
+      "  ncnn2int8 flow.ncnn.param flow.ncnn.bin flow.int8.ncnn.param "
+      "flow.int8.ncnn.bin flow-scale-table.txt\n"
+      "and put the int8 files into vits-model-dir. They are used instead "
+      "of the fp32 ones unless --vits-use-int8=false.\n\n"
+      "For SenseVoice models:\n"
+      "generate-int8-scale-table --sense-voice sense-voice-model-dir "
+      "wave_filenames.txt scale-table.txt [--num-threads=N] "
+      "[--min-layer-sqnr=DB]\n\n"
+      "The model is calibrated by recognizing the wave files, so the "
+      "statistics come from the real features, prompt and position "
+      "encodings. Convert it with\n"
+      "  ncnn2int8 model.ncnn.param model.ncnn.bin model.int8.ncnn.param "
+      "model.int8.ncnn.bin scale-table.txt\n"
+      "and put the int8 files into sense-voice-model-dir. They are used "
+      "instead of the fp32 ones unless --sense-voice-use-int8=false.\n\n"
+      "The statistics are collected and the scales are searched on "
+      "--num-threads threads. It defaults to the number of CPUs.\n\n"
+      "For mixed precision, the quantization error of each conv layer is "
+      "estimated as a signal-to-quantization-noise ratio (SQNR). Layers "
+      "below --min-layer-sqnr dB, e.g., 20, are left out of the tables, so "
+      "that ncnn2int8 keeps them in fp16/fp32. The SQNR of each layer and "
+      "the share of the MACs that run in int8 are printed. It defaults to "
+      "0, i.e., all layers are quantized.\n");
+}
+
+// If arg is --name=value, save value and return true
+static bool GetOption(const std::string &arg, const std::string &name,
+                      std::string *value) {
+  std::string prefix = "--" + name + "=";
+  if (arg.compare(0, prefix.size(), prefix) != 0) {
+    return false;
+  }
+
+  *value = arg.substr(prefix.size());
+  return true;
 }
 
 int main(int argc, char **argv) {
-  if (argc != 10) {
-    fprintf(stderr, "Please provide 10 arg. Currently given: %d\n", argc);
+  int num_threads = std::thread::hardware_concurrency();
+  std::string decoder_scale_table;
+  float min_sqnr = 0;
+
+  // Positional arguments, without the options
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; ++i) {
+    std::string value;
+    if (GetOption(argv[i], "num-threads", &value)) {
+      num_threads = atoi(value.c_str());
+    } else if (GetOption(argv[i], "decoder-scale-table", &value)) {
+      decoder_scale_table = value;
+    } else if (GetOption(argv[i], "min-layer-sqnr", &value)) {
+      min_sqnr = atof(value.c_str());
+    } else {
+      args.push_back(argv[i]);
+    }
+  }
+  num_threads = std::max(num_threads, 1);
+
+  if (args.size() == 4 && args[0] == "--tts") {
+    return CalibrateTts(args[1], args[2].c_str(), args[3], num_threads,
+                        min_sqnr);
+  }
+
+  if (args.size() == 4 && args[0] == "--sense-voice") {
+    return CalibrateSenseVoice(args[1], args[2].c_str(), args[3].c_str(),
+                               num_threads, min_sqnr);
+  }
+
+  if (args.size() != 9) {
+    fprintf(stderr, "Please provide 9 positional args. Currently given: %d\n",
+            static_cast<int32_t>(args.size()));
 
     ShowUsage();
     return 1;
   }
 
-  int32_t num_threads = 10;
   sherpa_ncnn::ModelConfig config;
 
-  config.encoder_param = argv[1];
-  config.encoder_bin = argv[2];
-  config.decoder_param = argv[3];
-  config.decoder_bin = argv[4];
-  config.joiner_param = argv[5];
-  config.joiner_bin = argv[6];
+  config.encoder_param = args[0];
+  config.encoder_bin = args[1];
+  config.decoder_param = args[2];
+  config.decoder_bin = args[3];
+  config.joiner_param = args[4];
+  config.joiner_bin = args[5];
 
-  const char *encoder_scale_table = argv[7];
-  const char *joiner_scale_table = argv[8];
-  std::vector<std::string> wave_filenames = ReadWaveFilenames(argv[9]);
+  const std::string &encoder_scale_table = args[6];
+  const std::string &joiner_scale_table = args[7];
+  std::vector<std::string> wave_filenames =
+      ReadWaveFilenames(args[8].c_str());
 
+  // Files are processed in parallel, so each net uses a single thread
   ncnn::Option opt;
-  opt.num_threads = num_threads;
+  opt.num_threads = 1;
   opt.lightmode = false;
   opt.use_fp16_packed = false;
   opt.use_fp16_storage = false;
@@ -1025,9 +1315,11 @@ int main(int argc, char **argv) {
   config.decoder_opt = opt;
   config.joiner_opt = opt;
 
+  // It supports all the models of Model::Create(), e.g., Zipformer,
+  // whose custom layers are registered by it
   auto model = sherpa_ncnn::Model::Create(config);
 
-  QuantNet net(model.get());
+  QuantNet net(model.get(), num_threads, min_sqnr);
 
   net.init();
 
@@ -1036,8 +1328,11 @@ int main(int argc, char **argv) {
 
   net.print_quant_info();
 
-  net.save_table_encoder(encoder_scale_table);
-  net.save_table_joiner(joiner_scale_table);
+  net.save_table_encoder(encoder_scale_table.c_str());
+  if (!decoder_scale_table.empty()) {
+    net.save_table_decoder(decoder_scale_table.c_str());
+  }
+  net.save_table_joiner(joiner_scale_table.c_str());
 
   return 0;
 }
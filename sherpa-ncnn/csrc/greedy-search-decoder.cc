@@ -18,63 +18,101 @@
  */
 #include "sherpa-ncnn/csrc/greedy-search-decoder.h"
 
+#include <algorithm>
+#include <utility>
 #include <vector>
 
+#include "sherpa-ncnn/csrc/joiner-argmax.h"
+#include "sherpa-ncnn/csrc/latency-stats.h"
+
 namespace sherpa_ncnn {
 
-ncnn::Mat GreedySearchDecoder::BuildDecoderInput(
-    const DecoderResult &result) const {
-  int32_t context_size = model_->ContextSize();
-  ncnn::Mat decoder_input(context_size);
-  for (int32_t i = 0; i != context_size; ++i) {
-    static_cast<int32_t *>(decoder_input)[i] =
-        *(result.tokens.end() - context_size + i);
+ncnn::Mat GreedySearchDecoder::BuildDecoderInput(const DecoderResult &result,
+                                                 int32_t *buf) const {
+  const int32_t *end = result.tokens.data() + result.tokens.size();
+  if (context_size_ == kCommonContextSize) {
+    CopyLastTokens<kCommonContextSize>(end, buf);
+    return ncnn::Mat(kCommonContextSize, buf);
   }
+
+  ncnn::Mat decoder_input(context_size_);
+  std::copy(end - context_size_, end, static_cast<int32_t *>(decoder_input));
   return decoder_input;
 }
 
+ncnn::Mat GreedySearchDecoder::RunDecoder(const DecoderResult &result) {
+  int32_t buf[kCommonContextSize];
+  ncnn::Mat decoder_input = BuildDecoderInput(result, buf);
+  if (!cache_) {
+    ScopedStageTimer timer(Stage::kDecoder);
+    return model_->RunDecoder(decoder_input);
+  }
+
+  const int32_t *context = decoder_input;
+  ncnn::Mat decoder_out = cache_->Get(context);
+  if (decoder_out.empty()) {
+    {
+      ScopedStageTimer timer(Stage::kDecoder);
+      decoder_out = model_->RunDecoder(decoder_input);
+    }
+    cache_->Put(context, decoder_out);
+  }
+
+  return decoder_out;
+}
+
 DecoderResult GreedySearchDecoder::GetEmptyResult() const {
-  int32_t context_size = model_->ContextSize();
   int32_t blank_id = 0;  // always 0
   DecoderResult r;
-  r.tokens.resize(context_size, blank_id);
+  r.tokens.resize(context_size_, blank_id);
 
   return r;
 }
 
 void GreedySearchDecoder::StripLeadingBlanks(DecoderResult *r) const {
-  int32_t context_size = model_->ContextSize();
-
-  auto start = r->tokens.begin() + context_size;
+  auto start = r->tokens.begin() + context_size_;
   auto end = r->tokens.end();
 
   r->tokens = std::vector<int32_t>(start, end);
 }
 
 void GreedySearchDecoder::Decode(ncnn::Mat encoder_out, DecoderResult *result) {
-  // TODO(fangjun): Cache the result of decoder_out
+  if (speculative_joiner_ && encoder_out.h > 1) {
+    DecodeSpeculatively(encoder_out, result);
+    return;
+  }
+
   ncnn::Mat decoder_out = result->decoder_out;
   if (decoder_out.empty()) {
-    ncnn::Mat decoder_input = BuildDecoderInput(*result);
-    decoder_out = model_->RunDecoder(decoder_input);
+    decoder_out = RunDecoder(*result);
   }
 
   int32_t frame_offset = result->frame_offset;
   for (int32_t t = 0; t != encoder_out.h; ++t) {
     ncnn::Mat encoder_out_t(encoder_out.w, encoder_out.row(t));
-    ncnn::Mat joiner_out = model_->RunJoiner(encoder_out_t, decoder_out);
+    ncnn::Mat joiner_out;
+    bool is_blank = false;
+    {
+      ScopedStageTimer timer(Stage::kJoiner);
+      if (blank_head_) {
+        is_blank = blank_head_->Run(encoder_out_t, decoder_out, &joiner_out);
+      } else {
+        // Only the argmax is needed, so the output is not converted to fp32
+        joiner_out = model_->RunJoinerRaw(encoder_out_t, decoder_out);
+      }
+    }
 
-    const float *joiner_out_ptr = joiner_out.row(0);
+    if (is_blank) {
+      ++result->num_trailing_blanks;
+      continue;
+    }
 
-    auto new_token = static_cast<int32_t>(std::distance(
-        joiner_out_ptr,
-        std::max_element(joiner_out_ptr, joiner_out_ptr + joiner_out.w)));
+    int32_t new_token = ArgmaxJoinerOut(joiner_out);
 
     // the blank ID is fixed to 0
     if (new_token != 0 && new_token != 2) {
       result->tokens.push_back(new_token);
-      ncnn::Mat decoder_input = BuildDecoderInput(*result);
-      decoder_out = model_->RunDecoder(decoder_input);
+      decoder_out = RunDecoder(*result);
       result->num_trailing_blanks = 0;
       result->timestamps.push_back(t + frame_offset);
     } else {
@@ -86,4 +124,229 @@ void GreedySearchDecoder::Decode(ncnn::Mat encoder_out, DecoderResult *result) {
   result->decoder_out = decoder_out;
 }
 
+void GreedySearchDecoder::DecodeSpeculatively(ncnn::Mat encoder_out,
+                                              DecoderResult *result) {
+  ncnn::Mat decoder_out = result->decoder_out;
+  if (decoder_out.empty()) {
+    decoder_out = RunDecoder(*result);
+  }
+
+  int32_t num_frames = encoder_out.h;
+  int32_t frame_offset = result->frame_offset;
+
+  // Each row is a copy of decoder_out. Only the first num_frames - t rows
+  // are used for frame t.
+  ncnn::Mat decoder_rows(decoder_out.w, num_frames);
+  bool decoder_rows_stale = true;
+
+  int32_t t = 0;
+  while (t != num_frames) {
+    int32_t num_rows = num_frames - t;
+    if (decoder_rows_stale) {
+      const float *p = decoder_out;
+      for (int32_t k = 0; k != num_rows; ++k) {
+        std::copy(p, p + decoder_out.w, decoder_rows.row(k));
+      }
+      decoder_rows_stale = false;
+    }
+
+    // Frames [t, num_frames) of encoder_out and the first num_rows rows of
+    // decoder_rows
+    ncnn::Mat encoder_rows(encoder_out.w, num_rows, encoder_out.row(t));
+    ncnn::Mat decoder_rows_t(decoder_rows.w, num_rows,
+                             static_cast<float *>(decoder_rows));
+
+    ncnn::Mat joiner_out;
+    {
+      ScopedStageTimer timer(Stage::kJoiner);
+      joiner_out = model_->RunJoiner2D(encoder_rows, decoder_rows_t);
+    }
+
+    int32_t k = 0;
+    for (; k != num_rows; ++k) {
+      const float *joiner_out_ptr = joiner_out.row(k);
+      auto new_token = static_cast<int32_t>(std::distance(
+          joiner_out_ptr,
+          std::max_element(joiner_out_ptr, joiner_out_ptr + joiner_out.w)));
+
+      // the blank ID is fixed to 0
+      if (new_token != 0 && new_token != 2) {
+        result->tokens.push_back(new_token);
+        decoder_out = RunDecoder(*result);
+        result->num_trailing_blanks = 0;
+        result->timestamps.push_back(t + k + frame_offset);
+        decoder_rows_stale = true;
+        break;
+      }
+
+      ++result->num_trailing_blanks;
+    }
+
+    // The joiner outputs after frame t + k used the old decoder output
+    t = std::min(t + k + 1, num_frames);
+  }
+
+  result->frame_offset += num_frames;
+  result->decoder_out = decoder_out;
+}
+
+void GreedySearchDecoder::RunDecoderBatch(DecoderResult **results,
+                                          const std::vector<int32_t> &indexes,
+                                          ncnn::Mat *decoder_out) {
+  int32_t num_indexes = static_cast<int32_t>(indexes.size());
+  if (num_indexes == 1) {
+    decoder_out[indexes[0]] = RunDecoder(*results[indexes[0]]);
+    return;
+  }
+
+  // Row k of decoder_input is the context of results[missing[k]], which
+  // is not in the cache. Streams with the same context share a row.
+  ncnn::Mat decoder_input(context_size_, num_indexes);
+  std::vector<int32_t> missing;
+  std::vector<std::pair<int32_t, int32_t>> shared;  // (i, k)
+  for (int32_t i : indexes) {
+    const std::vector<int32_t> &tokens = results[i]->tokens;
+    int32_t num_missing = static_cast<int32_t>(missing.size());
+    int32_t *context = decoder_input.row<int32_t>(num_missing);
+    std::copy(tokens.end() - context_size_, tokens.end(), context);
+
+    if (cache_) {
+      decoder_out[i] = cache_->Get(context);
+      if (!decoder_out[i].empty()) {
+        continue;
+      }
+    }
+
+    int32_t k = 0;
+    while (k != num_missing &&
+           !std::equal(context, context + context_size_,
+                       decoder_input.row<const int32_t>(k))) {
+      ++k;
+    }
+
+    if (k != num_missing) {
+      shared.emplace_back(i, k);
+    } else {
+      missing.push_back(i);
+    }
+  }
+
+  int32_t num_missing = static_cast<int32_t>(missing.size());
+  if (num_missing == 0) {
+    return;
+  }
+
+  // The first num_missing rows of decoder_input
+  ncnn::Mat missing_input(context_size_, num_missing,
+                          static_cast<int32_t *>(decoder_input));
+
+  ncnn::Mat out;
+  {
+    ScopedStageTimer timer(Stage::kDecoder);
+    out = model_->RunDecoder2D(missing_input);
+  }
+
+  for (int32_t k = 0; k != num_missing; ++k) {
+    // Note: We need to clone it since it is kept in the result
+    int32_t i = missing[k];
+    decoder_out[i] = ncnn::Mat(out.w, out.row(k)).clone();
+    if (cache_) {
+      cache_->Put(missing_input.row<const int32_t>(k), decoder_out[i]);
+    }
+  }
+
+  for (const auto &p : shared) {
+    decoder_out[p.first] = decoder_out[missing[p.second]];
+  }
+}
+
+void GreedySearchDecoder::DecodeBatch(ncnn::Mat *encoder_out,
+                                      DecoderResult **results, int32_t n) {
+  if (blank_head_ || n == 1) {
+    // The blank head decides for each stream whether the joiner runs
+    Decoder::DecodeBatch(encoder_out, results, n);
+    return;
+  }
+
+  std::vector<ncnn::Mat> decoder_out(n);
+  std::vector<int32_t> to_run;
+  int32_t num_frames = 0;
+  for (int32_t i = 0; i != n; ++i) {
+    decoder_out[i] = results[i]->decoder_out;
+    if (decoder_out[i].empty()) {
+      to_run.push_back(i);
+    }
+    num_frames = std::max(num_frames, encoder_out[i].h);
+  }
+
+  if (!to_run.empty()) {
+    RunDecoderBatch(results, to_run, decoder_out.data());
+  }
+
+  // Streams that have frame t. It is all of them unless their encoder
+  // outputs have different numbers of frames.
+  std::vector<int32_t> active;
+  std::vector<int32_t> emitted;
+  ncnn::Mat encoder_rows;
+  ncnn::Mat decoder_rows;
+  for (int32_t t = 0; t != num_frames; ++t) {
+    active.clear();
+    for (int32_t i = 0; i != n; ++i) {
+      if (t < encoder_out[i].h) {
+        active.push_back(i);
+      }
+    }
+
+    int32_t num_active = static_cast<int32_t>(active.size());
+    int32_t encoder_dim = encoder_out[active[0]].w;
+    int32_t decoder_dim = decoder_out[active[0]].w;
+    encoder_rows.create(encoder_dim, num_active);
+    decoder_rows.create(decoder_dim, num_active);
+    for (int32_t k = 0; k != num_active; ++k) {
+      int32_t i = active[k];
+      const float *p = encoder_out[i].row(t);
+      std::copy(p, p + encoder_dim, encoder_rows.row(k));
+
+      const float *q = decoder_out[i];
+      std::copy(q, q + decoder_dim, decoder_rows.row(k));
+    }
+
+    ncnn::Mat joiner_out;
+    {
+      ScopedStageTimer timer(Stage::kJoiner);
+      joiner_out = model_->RunJoiner2D(encoder_rows, decoder_rows);
+    }
+
+    emitted.clear();
+    for (int32_t k = 0; k != num_active; ++k) {
+      int32_t i = active[k];
+      DecoderResult *result = results[i];
+
+      const float *joiner_out_ptr = joiner_out.row(k);
+      auto new_token = static_cast<int32_t>(std::distance(
+          joiner_out_ptr,
+          std::max_element(joiner_out_ptr, joiner_out_ptr + joiner_out.w)));
+
+      // the blank ID is fixed to 0
+      if (new_token != 0 && new_token != 2) {
+        result->tokens.push_back(new_token);
+        result->num_trailing_blanks = 0;
+        result->timestamps.push_back(t + result->frame_offset);
+        emitted.push_back(i);
+      } else {
+        ++result->num_trailing_blanks;
+      }
+    }
+
+    if (!emitted.empty()) {
+      RunDecoderBatch(results, emitted, decoder_out.data());
+    }
+  }
+
+  for (int32_t i = 0; i != n; ++i) {
+    results[i]->frame_offset += encoder_out[i].h;
+    results[i]->decoder_out = decoder_out[i];
+  }
+}
+
 }  // namespace sherpa_ncnn
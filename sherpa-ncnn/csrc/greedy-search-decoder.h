@@ -20,26 +20,79 @@
 #ifndef SHERPA_NCNN_CSRC_GREEDY_SEARCH_DECODER_H_
 #define SHERPA_NCNN_CSRC_GREEDY_SEARCH_DECODER_H_
 
+#include <vector>
+
+#include "sherpa-ncnn/csrc/decoder-cache.h"
 #include "sherpa-ncnn/csrc/decoder.h"
+#include "sherpa-ncnn/csrc/joiner-blank-head.h"
 #include "sherpa-ncnn/csrc/model.h"
 
 namespace sherpa_ncnn {
 
 class GreedySearchDecoder : public Decoder {
  public:
-  explicit GreedySearchDecoder(Model *model) : model_(model) {}
+  /**
+   * @param model The NN model. Not owned.
+   * @param cache If not null, decoder outputs are looked up from and saved
+   *              to it. Not owned.
+   * @param blank_head If not null, it is used to skip the full joiner
+   *                   output for blank frames. Not owned.
+   * @param speculative_joiner If true and blank_head is null, Decode()
+   *                           runs the joiner for all remaining frames at
+   *                           once. See DecoderConfig::speculative_joiner.
+   */
+  explicit GreedySearchDecoder(Model *model, DecoderCache *cache = nullptr,
+                               const JoinerBlankHead *blank_head = nullptr,
+                               bool speculative_joiner = false)
+      : model_(model),
+        cache_(cache),
+        blank_head_(blank_head),
+        speculative_joiner_(speculative_joiner && !blank_head),
+        context_size_(model->ContextSize()) {}
 
   DecoderResult GetEmptyResult() const override;
 
+  void ResetResult(DecoderResult *r) const override {
+    r->Clear(context_size_);
+  }
+
   void StripLeadingBlanks(DecoderResult * /*r*/) const override;
 
   void Decode(ncnn::Mat encoder_out, DecoderResult *result) override;
 
+  // Frame t of all streams is joined with one run of the joiner, and the
+  // streams that emit a token at it share one run of the decoder. With a
+  // blank head, the streams are decoded one by one. The joiner is never
+  // run speculatively here since its runs are already shared.
+  void DecodeBatch(ncnn::Mat *encoder_out, DecoderResult **results,
+                   int32_t n) override;
+
  private:
-  ncnn::Mat BuildDecoderInput(const DecoderResult &result) const;
+  // If context_size_ is kCommonContextSize, the returned mat uses buf,
+  // which must have kCommonContextSize elements, instead of allocating
+  // memory.
+  ncnn::Mat BuildDecoderInput(const DecoderResult &result,
+                              int32_t *buf) const;
+
+  // Decode() with speculative_joiner_. The joiner is run for frames
+  // [t, T) with the current decoder output until frame t emits a token.
+  void DecodeSpeculatively(ncnn::Mat encoder_out, DecoderResult *result);
+
+  // Return the decoder output for the last context_size tokens of result
+  ncnn::Mat RunDecoder(const DecoderResult &result);
+
+  // Set decoder_out[i] to the decoder output for the last context_size
+  // tokens of results[i] for each i in indexes
+  void RunDecoderBatch(DecoderResult **results,
+                       const std::vector<int32_t> &indexes,
+                       ncnn::Mat *decoder_out);
 
  private:
-  Model *model_;  // not owned
+  Model *model_;                       // not owned
+  DecoderCache *cache_;                // not owned
+  const JoinerBlankHead *blank_head_;  // not owned
+  bool speculative_joiner_;
+  int32_t context_size_;
 };
 
 }  // namespace sherpa_ncnn
@@ -0,0 +1,220 @@
+// sherpa-ncnn/csrc/hotwords.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/hotwords.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if __ANDROID_API__ >= 9
+#include "android/asset_manager.h"
+#include "android/asset_manager_jni.h"
+#endif
+
+#if __OHOS__
+#include "rawfile/raw_file_manager.h"
+#endif
+
+#include "sherpa-ncnn/csrc/file-utils.h"
+#include "sherpa-ncnn/csrc/macros.h"
+#include "sherpa-ncnn/csrc/startup-stats.h"
+
+namespace sherpa_ncnn {
+
+bool ReadHotwords(std::istream &is, const SymbolTable &sym,
+                  std::vector<std::vector<int32_t>> *hotwords,
+                  std::vector<float> *boost_scores) {
+  std::vector<int32_t> tmp;
+  std::string line;
+  std::string word;
+
+  while (std::getline(is, line)) {
+    std::istringstream iss(line);
+    float tmp_score = 0.0;  // MUST be 0.0, meaning if no customize score use
+                            // the global one.
+    while (iss >> word) {
+      if (sym.contains(word)) {
+        tmp.push_back(sym[word]);
+      } else if (word[0] == ':') {
+        char *end = nullptr;
+        tmp_score = std::strtof(word.c_str() + 1, &end);
+        if (end == word.c_str() + 1 || *end != '\0') {
+          SHERPA_NCNN_LOGE("Invalid score %s of hotword at line: %s",
+                           word.c_str(), line.c_str());
+          return false;
+        }
+      } else {
+        SHERPA_NCNN_LOGE(
+            "Cannot find ID for hotword %s at line: %s. (Hint: words on "
+            "the same line are separated by spaces)",
+            word.c_str(), line.c_str());
+        return false;
+      }
+    }
+
+    if (tmp.empty()) continue;
+
+    hotwords->push_back(std::move(tmp));
+    boost_scores->push_back(tmp_score);
+    tmp.clear();
+  }
+
+  return true;
+}
+
+void ReadKeywords(std::istream &is, const SymbolTable &sym,
+                  std::vector<std::vector<int32_t>> *keywords,
+                  std::vector<float> *boost_scores,
+                  std::vector<float> *thresholds,
+                  std::vector<std::string> *phrases) {
+  std::vector<int32_t> tmp;
+  std::string line;
+  std::string word;
+
+  while (std::getline(is, line)) {
+    std::istringstream iss(line);
+    float score = 0;
+    float threshold = 0;
+    std::string phrase;
+    while (iss >> word) {
+      if (sym.contains(word)) {
+        tmp.push_back(sym[word]);
+      } else if (word[0] == ':') {
+        score = std::stof(word.substr(1));
+      } else if (word[0] == '#') {
+        threshold = std::stof(word.substr(1));
+      } else if (word[0] == '@') {
+        phrase = word.substr(1);
+      } else {
+        SHERPA_NCNN_LOGE("Cannot find ID for keyword %s at line: %s",
+                         word.c_str(), line.c_str());
+        SHERPA_NCNN_EXIT(-1);
+      }
+    }
+
+    if (tmp.empty()) continue;
+
+    if (phrase.empty()) {
+      for (int32_t t : tmp) {
+        phrase.append(sym[t]);
+      }
+    }
+
+    keywords->push_back(std::move(tmp));
+    boost_scores->push_back(score);
+    thresholds->push_back(threshold);
+    phrases->push_back(std::move(phrase));
+    tmp.clear();
+  }
+}
+
+ContextGraphPtr CreateContextGraph(std::istream &is, const SymbolTable &sym,
+                                   float hotwords_score) {
+  std::vector<std::vector<int32_t>> hotwords;
+  std::vector<float> boost_scores;
+  if (!ReadHotwords(is, sym, &hotwords, &boost_scores)) {
+    return nullptr;
+  }
+
+  return std::make_shared<ContextGraph>(hotwords, hotwords_score,
+                                        boost_scores);
+}
+
+ContextGraphPtr CreateContextGraph(const std::string &hotwords_file,
+                                   const SymbolTable &sym,
+                                   float hotwords_score) {
+  ScopedStartupTimer timer(StartupPhase::kHotwords);
+  std::ifstream is(hotwords_file, std::ios::binary);
+  if (!is) {
+    SHERPA_NCNN_LOGE("Open hotwords file failed: %s", hotwords_file.c_str());
+    return nullptr;
+  }
+
+  char magic[4] = {};
+  is.read(magic, sizeof(magic));
+  if (ContextGraph::IsBinary(magic, is.gcount())) {
+    return ContextGraph::Load(hotwords_file);
+  }
+
+  is.clear();
+  is.seekg(0);
+  return CreateContextGraph(is, sym, hotwords_score);
+}
+
+template <typename Manager>
+ContextGraphPtr CreateContextGraph(Manager *mgr,
+                                   const std::string &hotwords_file,
+                                   const SymbolTable &sym,
+                                   float hotwords_score) {
+  ScopedStartupTimer timer(StartupPhase::kHotwords);
+  std::vector<char> buf = ReadFile(mgr, hotwords_file);
+  if (ContextGraph::IsBinary(buf.data(), buf.size())) {
+    return std::make_shared<ContextGraph>(
+        reinterpret_cast<const unsigned char *>(buf.data()), buf.size());
+  }
+
+  std::istringstream is(std::string(buf.begin(), buf.end()));
+
+  return CreateContextGraph(is, sym, hotwords_score);
+}
+
+ContextGraphCache::ContextGraphCache(int32_t capacity)
+    : capacity_(capacity), keys_(capacity), values_(capacity) {
+  if (capacity <= 0) {
+    SHERPA_NCNN_LOGE("capacity should be positive. Given: %d", capacity);
+    SHERPA_NCNN_EXIT(-1);
+  }
+}
+
+int32_t ContextGraphCache::Slot(const std::string &hotwords) const {
+  // FNV-1a
+  uint64_t h = 14695981039346656037ULL;
+  for (unsigned char c : hotwords) {
+    h ^= c;
+    h *= 1099511628211ULL;
+  }
+
+  return static_cast<int32_t>(h % capacity_);
+}
+
+ContextGraphPtr ContextGraphCache::Get(const std::string &hotwords) const {
+  int32_t slot = Slot(hotwords);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (values_[slot] && keys_[slot] == hotwords) {
+    return values_[slot];
+  }
+
+  return nullptr;
+}
+
+void ContextGraphCache::Put(const std::string &hotwords,
+                            ContextGraphPtr context_graph) {
+  int32_t slot = Slot(hotwords);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  keys_[slot] = hotwords;
+  values_[slot] = std::move(context_graph);
+}
+
+#if __ANDROID_API__ >= 9
+template ContextGraphPtr CreateContextGraph(AAssetManager *mgr,
+                                            const std::string &hotwords_file,
+                                            const SymbolTable &sym,
+                                            float hotwords_score);
+#endif
+
+#if __OHOS__
+template ContextGraphPtr CreateContextGraph(NativeResourceManager *mgr,
+                                            const std::string &hotwords_file,
+                                            const SymbolTable &sym,
+                                            float hotwords_score);
+#endif
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,134 @@
+// sherpa-ncnn/csrc/hotwords.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_HOTWORDS_H_
+#define SHERPA_NCNN_CSRC_HOTWORDS_H_
+
+#include <cstdint>
+#include <istream>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/context-graph.h"
+#include "sherpa-ncnn/csrc/symbol-table.h"
+
+namespace sherpa_ncnn {
+
+/** Read hotwords as token IDs.
+ *
+ * Each line contains the space separated tokens of one hotword, optionally
+ * followed by an item that starts with ":", which is the boosting score of
+ * this hotword, e.g.,
+ *
+ *   ▁HE LL O ▁WORLD :1.5
+ *
+ * If there is no such item, the score is 0, which means the default score
+ * of the ContextGraph.
+ *
+ * @param is  The input stream to read from.
+ * @param sym  The symbol table of the model.
+ * @param hotwords  On return, it contains the token IDs of each hotword.
+ * @param boost_scores  On return, it contains the score of each hotword.
+ *
+ * @return Return false if a token is not in sym or a score is invalid.
+ *         The error is logged.
+ */
+bool ReadHotwords(std::istream &is, const SymbolTable &sym,
+                  std::vector<std::vector<int32_t>> *hotwords,
+                  std::vector<float> *boost_scores);
+
+/** Read keywords for keyword spotting as token IDs.
+ *
+ * The format is that of ReadHotwords(), with two more optional items: one
+ * that starts with "#", which is the threshold of the keyword, and one
+ * that starts with "@", which is the text reported when it is detected,
+ * e.g.,
+ *
+ *   ▁HE LL O ▁WORLD :1.5 #0.35 @HELLO_WORLD
+ *
+ * A keyword without a threshold gets 0, which means the default one. A
+ * keyword without text is reported as its tokens joined.
+ *
+ * @param is  The input stream to read from.
+ * @param sym  The symbol table of the model.
+ * @param keywords  On return, it contains the token IDs of each keyword.
+ * @param boost_scores  On return, it contains the score of each keyword.
+ * @param thresholds  On return, it contains the threshold of each keyword.
+ * @param phrases  On return, it contains the text of each keyword.
+ */
+void ReadKeywords(std::istream &is, const SymbolTable &sym,
+                  std::vector<std::vector<int32_t>> *keywords,
+                  std::vector<float> *boost_scores,
+                  std::vector<float> *thresholds,
+                  std::vector<std::string> *phrases);
+
+/** Build a context graph from the hotwords read from is.
+ *
+ * The graph is immutable once built, so it can be shared by any number of
+ * streams, e.g., one graph per vocabulary for all streams that use it.
+ *
+ * @param is  The input stream to read the hotwords from, see
+ *            ReadHotwords().
+ * @param sym  The symbol table of the model.
+ * @param hotwords_score  The score of hotwords that have no score of
+ *                        their own.
+ *
+ * @return Return nullptr if the hotwords are invalid, see ReadHotwords().
+ */
+ContextGraphPtr CreateContextGraph(std::istream &is, const SymbolTable &sym,
+                                   float hotwords_score);
+
+// Same as the above one, but read the hotwords from a file. If the file
+// contains the output of ContextGraph::ToBinary() instead, it is memory
+// mapped and hotwords_score is ignored. Return nullptr if the file cannot
+// be read or is invalid.
+ContextGraphPtr CreateContextGraph(const std::string &hotwords_file,
+                                   const SymbolTable &sym,
+                                   float hotwords_score);
+
+// Same as the above one, but read the file with a resource manager, e.g.,
+// AAssetManager on Android
+template <typename Manager>
+ContextGraphPtr CreateContextGraph(Manager *mgr,
+                                   const std::string &hotwords_file,
+                                   const SymbolTable &sym,
+                                   float hotwords_score);
+
+// Compiled context graphs keyed by the content of their hotwords, i.e.,
+// the text passed to CreateContextGraph(std::istream&, ...), so that streams
+// that use the same hotwords share one graph and it is built only once.
+//
+// Like DecoderCache, it is a direct-mapped cache: each text can be stored in
+// only one slot and a newer entry replaces the older one in that slot.
+//
+// It is thread-safe.
+class ContextGraphCache {
+ public:
+  /**
+   * @param capacity Number of entries in the cache. Must be positive.
+   */
+  explicit ContextGraphCache(int32_t capacity = 64);
+
+  // Return nullptr if there is no graph for hotwords
+  ContextGraphPtr Get(const std::string &hotwords) const;
+
+  void Put(const std::string &hotwords, ContextGraphPtr context_graph);
+
+  int32_t Capacity() const { return capacity_; }
+
+ private:
+  int32_t Slot(const std::string &hotwords) const;
+
+ private:
+  int32_t capacity_;
+
+  mutable std::mutex mutex_;
+  std::vector<std::string> keys_;
+  std::vector<ContextGraphPtr> values_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_HOTWORDS_H_
@@ -0,0 +1,85 @@
+// sherpa-ncnn/csrc/huge-pages.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/huge-pages.h"
+
+#include <cstdint>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#include "allocator.h"  // NOLINT
+
+namespace sherpa_ncnn {
+
+namespace {
+
+std::size_t RoundUp(std::size_t size) {
+  return (size + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+}
+
+}  // namespace
+
+#if defined(__linux__)
+
+void *AllocateHugePages(std::size_t size) {
+  size = RoundUp(size);
+
+#if defined(MAP_HUGETLB)
+  void *p = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (p != MAP_FAILED) {
+    return p;
+  }
+#endif
+
+  // Over-allocate by a huge page and unmap the unaligned head and tail,
+  // since transparent huge pages back only aligned ranges
+  std::size_t n = size + kHugePageSize;
+  void *q = mmap(nullptr, n, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (q == MAP_FAILED) {
+    return nullptr;
+  }
+
+  auto begin = reinterpret_cast<std::uintptr_t>(q);
+  auto aligned = (begin + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+  std::size_t head = aligned - begin;
+  std::size_t tail = n - head - size;
+  if (head) {
+    munmap(q, head);
+  }
+  if (tail) {
+    munmap(reinterpret_cast<void *>(aligned + size), tail);
+  }
+
+  void *ans = reinterpret_cast<void *>(aligned);
+
+#if defined(MADV_HUGEPAGE)
+  // It fails if transparent huge pages are disabled, which leaves ordinary
+  // pages
+  madvise(ans, size, MADV_HUGEPAGE);
+#endif
+
+  return ans;
+}
+
+void FreeHugePages(void *p, std::size_t size) {
+  if (p) {
+    munmap(p, RoundUp(size));
+  }
+}
+
+#else
+
+void *AllocateHugePages(std::size_t size) {
+  return ncnn::fastMalloc(RoundUp(size));
+}
+
+void FreeHugePages(void *p, std::size_t /*size*/) { ncnn::fastFree(p); }
+
+#endif
+
+}  // namespace sherpa_ncnn
@@ -25,33 +25,99 @@
 
 namespace sherpa_ncnn {
 
+TokenNode::~TokenNode() {
+  std::shared_ptr<TokenNode> p = std::move(prev);
+  // If we hold the last reference to p, detach its predecessor before
+  // destroying it so that destroying p does not recurse.
+  while (p && p.use_count() == 1) {
+    std::shared_ptr<TokenNode> next = std::move(p->prev);
+    p.reset();
+    p = std::move(next);
+  }
+}
+
+Hypothesis::Hypothesis(const std::vector<int32_t> &ys, double log_prob,
+                       const ContextState *context_state /*= nullptr*/)
+    : log_prob(log_prob), context_state(context_state) {
+  for (auto i : ys) {
+    AddToken(i, -1);
+  }
+}
+
+std::vector<int32_t> Hypothesis::Ys() const {
+  std::vector<int32_t> ans(NumTokens());
+  auto it = ans.rbegin();
+  for (const TokenNode *p = tail.get(); p; p = p->prev.get()) {
+    *it++ = p->token;
+  }
+  return ans;
+}
+
+std::vector<int32_t> Hypothesis::Timestamps() const {
+  std::vector<int32_t> ans;
+  for (const TokenNode *p = tail.get(); p; p = p->prev.get()) {
+    if (p->timestamp >= 0) {
+      ans.push_back(p->timestamp);
+    }
+  }
+  std::reverse(ans.begin(), ans.end());
+  return ans;
+}
+
+void Hypothesis::GetLastTokens(int32_t n, int32_t *p) const {
+  const TokenNode *node = tail.get();
+  for (int32_t i = n - 1; i >= 0; --i) {
+    p[i] = node->token;
+    node = node->prev.get();
+  }
+}
+
+bool Hypothesis::SameTokens(const Hypothesis &other) const {
+  if (NumTokens() != other.NumTokens()) {
+    return false;
+  }
+
+  const TokenNode *a = tail.get();
+  const TokenNode *b = other.tail.get();
+
+  // Stop as soon as we reach a shared prefix
+  while (a != b) {
+    if (a->token != b->token) {
+      return false;
+    }
+
+    a = a->prev.get();
+    b = b->prev.get();
+  }
+
+  return true;
+}
+
 void Hypotheses::Add(Hypothesis hyp) {
-  auto key = hyp.Key();
-  auto it = hyps_dict_.find(key);
-  if (it == hyps_dict_.end()) {
-    hyps_dict_[key] = std::move(hyp);
-  } else {
-    it->second.log_prob = LogAdd<double>()(it->second.log_prob, hyp.log_prob);
+  for (auto &h : hyps_) {
+    if (h.hash == hyp.hash && h.SameTokens(hyp)) {
+      h.log_prob = LogAdd<double>()(h.log_prob, hyp.log_prob);
+      return;
+    }
   }
+
+  hyps_.push_back(std::move(hyp));
 }
 
 Hypothesis Hypotheses::GetMostProbable(bool length_norm) const {
   if (length_norm == false) {
-    return std::max_element(hyps_dict_.begin(), hyps_dict_.end(),
-                            [](const auto &left, auto &right) -> bool {
-                              return left.second.log_prob <
-                                     right.second.log_prob;
-                            })
-        ->second;
+    return *std::max_element(hyps_.begin(), hyps_.end(),
+                             [](const auto &left, auto &right) -> bool {
+                               return left.log_prob < right.log_prob;
+                             });
   } else {
     // for length_norm is true
-    return std::max_element(
-               hyps_dict_.begin(), hyps_dict_.end(),
-               [](const auto &left, const auto &right) -> bool {
-                 return left.second.log_prob / left.second.ys.size() <
-                        right.second.log_prob / right.second.ys.size();
-               })
-        ->second;
+    return *std::max_element(
+        hyps_.begin(), hyps_.end(),
+        [](const auto &left, const auto &right) -> bool {
+          return left.log_prob / left.NumTokens() <
+                 right.log_prob / right.NumTokens();
+        });
   }
 }
 
@@ -59,7 +125,7 @@ std::vector<Hypothesis> Hypotheses::GetTopK(int32_t k, bool length_norm) const {
   k = std::max(k, 1);
   k = std::min(k, Size());
 
-  std::vector<Hypothesis> all_hyps = Vec();
+  std::vector<Hypothesis> all_hyps = hyps_;
 
   if (length_norm == false) {
     std::partial_sort(
@@ -69,12 +135,13 @@ std::vector<Hypothesis> Hypotheses::GetTopK(int32_t k, bool length_norm) const {
     // for length_norm is true
     std::partial_sort(all_hyps.begin(), all_hyps.begin() + k, all_hyps.end(),
                       [](const auto &a, const auto &b) {
-                        return a.log_prob / a.ys.size() >
-                               b.log_prob / b.ys.size();
+                        return a.log_prob / a.NumTokens() >
+                               b.log_prob / b.NumTokens();
                       });
   }
 
-  return {all_hyps.begin(), all_hyps.begin() + k};
+  all_hyps.resize(k);
+  return all_hyps;
 }
 
 }  // namespace sherpa_ncnn
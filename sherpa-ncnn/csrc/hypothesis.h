@@ -19,9 +19,10 @@
 #ifndef SHERPA_NCNN_CSRC_HYPOTHESIS_H_
 #define SHERPA_NCNN_CSRC_HYPOTHESIS_H_
 
+#include <cstdint>
+#include <memory>
 #include <sstream>
 #include <string>
-#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -29,103 +30,180 @@
 
 namespace sherpa_ncnn {
 
-struct Hypothesis {
-  // The predicted tokens so far. Newly predicated tokens are appended.
-  std::vector<int32_t> ys;
+// A node in a prefix tree of decoded tokens.
+//
+// Each node points to its predecessor, so a token sequence is represented
+// by its last node. Hypotheses with a common prefix share the nodes of
+// that prefix, so expanding a hypothesis by one token is O(1) regardless
+// of the length of the sequence.
+struct TokenNode {
+  int32_t token;
+
+  // Frame number after subsampling on which the token is decoded.
+  // It is -1 for tokens we don't have a timestamp for, e.g., the leading
+  // blanks added by the decoder.
+  int32_t timestamp;
+
+  // Number of tokens from the first node up to and including this node
+  int32_t length;
+
+  std::shared_ptr<TokenNode> prev;
+
+  TokenNode(int32_t token, int32_t timestamp, std::shared_ptr<TokenNode> prev)
+      : token(token),
+        timestamp(timestamp),
+        length(prev ? prev->length + 1 : 1),
+        prev(std::move(prev)) {}
+
+  // Free the chain of predecessors iteratively to avoid deep recursion
+  // for long utterances.
+  ~TokenNode();
+};
 
-  // timestamps[i] contains the frame number after subsampling
-  // on which ys[i] is decoded.
-  std::vector<int32_t> timestamps;
+struct Hypothesis {
+  // The last node of the predicted tokens so far. Newly predicated tokens
+  // are appended with AddToken().
+  std::shared_ptr<TokenNode> tail;
 
-  // The total score of ys in log space.
+  // The total score of the tokens in log space.
   double log_prob = 0;
   const ContextState *context_state;
   int32_t num_trailing_blanks = 0;
 
+  // State of the n-gram LM after the tokens so far. Used only with
+  // DecoderConfig::lm. See ngram-lm.h.
+  int32_t lm_state = 0;
+
+  // Sum of the log probs of the tokens of the keyword matched so far,
+  // i.e., of the last context_state->level tokens. Used only by
+  // KeywordDecoder.
+  float keyword_log_prob = 0;
+
+  // Hash of the token sequence. It is updated incrementally in AddToken().
+  uint64_t hash = kInitHash;
+
   Hypothesis() = default;
+
+  // Tokens in ys have no timestamps
   Hypothesis(const std::vector<int32_t> &ys, double log_prob,
-             const ContextState *context_state = nullptr)
-      : ys(ys), log_prob(log_prob), context_state(context_state) {}
+             const ContextState *context_state = nullptr);
 
-  // If two Hypotheses have the same `Key`, then they contain
-  // the same token sequence.
-  std::string Key() const {
-    // TODO(fangjun): Use a hash function?
-    std::ostringstream os;
-    std::string sep = "-";
-    for (auto i : ys) {
-      os << i << sep;
-      sep = "-";
+  // Append a token decoded at the given frame and update the hash
+  void AddToken(int32_t token, int32_t timestamp) {
+    tail = std::make_shared<TokenNode>(token, timestamp, std::move(tail));
+    hash = HashCombine(hash, token);
+  }
+
+  // Number of tokens decoded so far
+  int32_t NumTokens() const { return tail ? tail->length : 0; }
+
+  // Return the predicted tokens so far.
+  //
+  // Caution: It is O(NumTokens()). Don't call it for each frame.
+  std::vector<int32_t> Ys() const;
+
+  // Return the timestamps of tokens that have one.
+  // timestamps[i] contains the frame number after subsampling
+  // on which the i-th such token is decoded.
+  //
+  // Caution: It is O(NumTokens()). Don't call it for each frame.
+  std::vector<int32_t> Timestamps() const;
+
+  // Copy the last n tokens to p in order. NumTokens() must be >= n.
+  void GetLastTokens(int32_t n, int32_t *p) const;
+
+  // Same as above with n known at compile time
+  template <int32_t N>
+  void GetLastTokens(int32_t *p) const {
+    const TokenNode *node = tail.get();
+    for (int32_t i = N - 1; i >= 0; --i) {
+      p[i] = node->token;
+      node = node->prev.get();
     }
-    return os.str();
   }
 
+  // Return true if this hypothesis and other contain the same token sequence.
+  bool SameTokens(const Hypothesis &other) const;
+
+  // If two Hypotheses have different keys, then they contain different token
+  // sequences. Two hypotheses with the same key usually contain the same
+  // token sequence, but you have to call SameTokens() to be sure.
+  uint64_t Key() const { return hash; }
+
   // For debugging
   std::string ToString() const {
     std::ostringstream os;
-    os << "(" << Key() << ", " << log_prob << ")";
+    os << "(";
+    std::string sep;
+    for (auto i : Ys()) {
+      os << sep << i;
+      sep = "-";
+    }
+    os << ", " << log_prob << ")";
     return os.str();
   }
+
+  // FNV-1a
+  static constexpr uint64_t kInitHash = 14695981039346656037ULL;
+
+  static uint64_t HashCombine(uint64_t h, int32_t token) {
+    return (h ^ static_cast<uint32_t>(token)) * 1099511628211ULL;
+  }
 };
 
+// A small set of hypotheses, i.e., the beam.
+//
+// Hypotheses are kept in a flat vector since the beam is small.
+// Looking up a hypothesis compares the hashes first and compares the
+// token sequences only if the hashes are equal.
 class Hypotheses {
  public:
   Hypotheses() = default;
 
   explicit Hypotheses(std::vector<Hypothesis> hyps) {
+    hyps_.reserve(hyps.size());
     for (auto &h : hyps) {
-      hyps_dict_[h.Key()] = std::move(h);
+      Add(std::move(h));
     }
   }
 
-  explicit Hypotheses(std::unordered_map<std::string, Hypothesis> hyps_dict)
-      : hyps_dict_(std::move(hyps_dict)) {}
-
   // Add hyp to this object. If it already exists, its log_prob
   // is updated with the given hyp using log-sum-exp.
   void Add(Hypothesis hyp);
 
   // Get the hyp that has the largest log_prob.
   // If length_norm is true, hyp's log_prob is divided by
-  // len(hyp.ys) before comparison.
+  // hyp.NumTokens() before comparison.
   Hypothesis GetMostProbable(bool length_norm) const;
 
   // Get the k hyps that have the largest log_prob.
   // If length_norm is true, hyp's log_prob is divided by
-  // len(hyp.ys) before comparison.
+  // hyp.NumTokens() before comparison.
   std::vector<Hypothesis> GetTopK(int32_t k, bool length_norm) const;
 
-  int32_t Size() const { return hyps_dict_.size(); }
+  int32_t Size() const { return hyps_.size(); }
+
+  // Reserve space for n hypotheses, e.g., num_active_paths
+  void Reserve(int32_t n) { hyps_.reserve(n); }
 
   std::string ToString() const {
     std::ostringstream os;
-    for (const auto &p : hyps_dict_) {
-      os << p.second.ToString() << "\n";
+    for (const auto &h : hyps_) {
+      os << h.ToString() << "\n";
     }
     return os.str();
   }
 
-  const auto begin() const { return hyps_dict_.begin(); }
-  const auto end() const { return hyps_dict_.end(); }
-  auto begin() { return hyps_dict_.begin(); }
-  auto end() { return hyps_dict_.end(); }
-
-  void Clear() { hyps_dict_.clear(); }
+  const auto begin() const { return hyps_.begin(); }
+  const auto end() const { return hyps_.end(); }
+  auto begin() { return hyps_.begin(); }
+  auto end() { return hyps_.end(); }
 
- private:
-  // Return a list of hyps contained in this object.
-  std::vector<Hypothesis> Vec() const {
-    std::vector<Hypothesis> ans;
-    ans.reserve(hyps_dict_.size());
-    for (const auto &p : hyps_dict_) {
-      ans.push_back(p.second);
-    }
-    return ans;
-  }
+  // Note: It keeps the allocated memory
+  void Clear() { hyps_.clear(); }
 
  private:
-  using Map = std ::unordered_map<std::string, Hypothesis>;
-  Map hyps_dict_;
+  std::vector<Hypothesis> hyps_;
 };
 
 }  // namespace sherpa_ncnn
@@ -0,0 +1,90 @@
+// sherpa-ncnn/csrc/joiner-argmax.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/joiner-argmax.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "sherpa-ncnn/csrc/simd.h"
+
+namespace sherpa_ncnn {
+
+// fp16 and bf16 are sign-magnitude. Flipping the magnitude bits of
+// negative numbers gives an int16 that is ordered like the number.
+static inline int16_t HalfKey(uint16_t x) {
+  auto s = static_cast<int16_t>(x);
+  return static_cast<int16_t>(s ^ ((s >> 15) & 0x7fff));
+}
+
+int32_t ArgmaxHalf(const uint16_t *in, int32_t n) {
+  int32_t i = 0;
+
+  // Max of the keys of the 8 lanes
+  int16_t lanes[8] = {INT16_MIN, INT16_MIN, INT16_MIN, INT16_MIN,
+                      INT16_MIN, INT16_MIN, INT16_MIN, INT16_MIN};
+
+#if SHERPA_NCNN_NEON
+  int16x8_t mask = vdupq_n_s16(0x7fff);
+  int16x8_t best = vdupq_n_s16(INT16_MIN);
+  for (; i + 8 <= n; i += 8) {
+    int16x8_t x = vreinterpretq_s16_u16(vld1q_u16(in + i));
+    x = veorq_s16(x, vandq_s16(vshrq_n_s16(x, 15), mask));
+    best = vmaxq_s16(best, x);
+  }
+  vst1q_s16(lanes, best);
+#elif SHERPA_NCNN_WASM_SIMD
+  v128_t mask = wasm_i16x8_splat(0x7fff);
+  v128_t best = wasm_i16x8_splat(INT16_MIN);
+  for (; i + 8 <= n; i += 8) {
+    v128_t x = wasm_v128_load(in + i);
+    x = wasm_v128_xor(x, wasm_v128_and(wasm_i16x8_shr(x, 15), mask));
+    best = wasm_i16x8_max(best, x);
+  }
+  wasm_v128_store(lanes, best);
+#elif SHERPA_NCNN_SSE2
+  __m128i mask = _mm_set1_epi16(0x7fff);
+  __m128i best = _mm_set1_epi16(INT16_MIN);
+  for (; i + 8 <= n; i += 8) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+    x = _mm_xor_si128(x, _mm_and_si128(_mm_srai_epi16(x, 15), mask));
+    best = _mm_max_epi16(best, x);
+  }
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), best);
+#endif
+
+  int16_t best_key = *std::max_element(lanes, lanes + 8);
+  for (; i < n; ++i) {
+    best_key = std::max(best_key, HalfKey(in[i]));
+  }
+
+  // The maximum is usually found early, so finding its index is cheaper
+  // than tracking it in the loop above
+  int32_t k = 0;
+  while (HalfKey(in[k]) != best_key) {
+    ++k;
+  }
+
+  return k;
+}
+
+int32_t ArgmaxJoinerOut(const ncnn::Mat &joiner_out) {
+  int32_t n = joiner_out.w * joiner_out.elempack;
+  size_t bytes = joiner_out.elemsize / joiner_out.elempack;
+
+  if (bytes == 2) {
+    return ArgmaxHalf(static_cast<const uint16_t *>(joiner_out.data), n);
+  }
+
+  if (bytes == 1) {
+    // The dequantization scale is positive, so it keeps the order
+    const auto *p = static_cast<const int8_t *>(joiner_out.data);
+    return static_cast<int32_t>(std::distance(p, std::max_element(p, p + n)));
+  }
+
+  const auto *p = static_cast<const float *>(joiner_out.data);
+  return static_cast<int32_t>(std::distance(p, std::max_element(p, p + n)));
+}
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,30 @@
+// sherpa-ncnn/csrc/joiner-argmax.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_JOINER_ARGMAX_H_
+#define SHERPA_NCNN_CSRC_JOINER_ARGMAX_H_
+
+#include <cstdint>
+
+#include "mat.h"
+
+namespace sherpa_ncnn {
+
+// Return the index of the largest of in[0, n), the first one if several
+// are equal. Each element is an fp16 or bf16 number, which are compared
+// without converting them to float. n must be positive. NaNs are not
+// supported.
+int32_t ArgmaxHalf(const uint16_t *in, int32_t n);
+
+// Return the index of the largest logit of a joiner output returned by
+// Model::RunJoinerRaw(). It is an ncnn::Mat with a single row, whose
+// elements may be fp32, fp16, bf16 or int8 and may be packed.
+//
+// It is the same as the argmax of the fp32 output returned by
+// Model::RunJoiner(), which is converted from the former.
+int32_t ArgmaxJoinerOut(const ncnn::Mat &joiner_out);
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_JOINER_ARGMAX_H_
@@ -0,0 +1,203 @@
+// sherpa-ncnn/csrc/joiner-blank-head.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/joiner-blank-head.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "net.h"  // NOLINT
+
+namespace sherpa_ncnn {
+
+std::unique_ptr<JoinerBlankHead> JoinerBlankHead::Create(Model *model,
+                                                         float threshold) {
+  if (threshold < 0.5f || threshold >= 1.0f) {
+    NCNN_LOGE("blank_skip_threshold should be in the range [0.5, 1). Given: %f",
+              threshold);
+    exit(-1);
+  }
+
+  ncnn::Net &net = model->GetJoiner();
+  if (net.opt.use_vulkan_compute) {
+    NCNN_LOGE("Blank skipping is not supported with vulkan. Disable it.");
+    return nullptr;
+  }
+
+  int32_t joiner_out_index = FindBlob(net, "out0");
+  if (joiner_out_index == -1) {
+    NCNN_LOGE("Cannot find the output of the joiner. Disable blank skipping.");
+    return nullptr;
+  }
+
+  int32_t producer = net.blobs()[joiner_out_index].producer;
+  if (producer < 0) {
+    NCNN_LOGE("Invalid joiner. Disable blank skipping.");
+    return nullptr;
+  }
+
+  const ncnn::Layer *layer = net.layers()[producer];
+  if (layer->type != "InnerProduct" || layer->bottoms.size() != 1) {
+    NCNN_LOGE(
+        "The last layer of the joiner is %s, not InnerProduct. Disable blank "
+        "skipping.",
+        layer->type.c_str());
+    return nullptr;
+  }
+
+  return std::unique_ptr<JoinerBlankHead>(
+      new JoinerBlankHead(model, threshold, layer->bottoms[0]));
+}
+
+JoinerBlankHead::JoinerBlankHead(Model *model, float threshold,
+                                 int32_t hidden_index)
+    : model_(model), threshold_(threshold), hidden_index_(hidden_index) {
+  const ncnn::Net &net = model_->GetJoiner();
+  encoder_out_index_ = FindBlob(net, "in0");
+  decoder_out_index_ = FindBlob(net, "in1");
+  joiner_out_index_ = FindBlob(net, "out0");
+}
+
+void JoinerBlankHead::Init(int32_t hidden_dim) const {
+  const ncnn::Net &net = model_->GetJoiner();
+
+  // Row 0 is zero and row i + 1 is the i-th unit vector, so row 0 of the
+  // output is b and row i + 1 is b + the i-th column of w.
+  ncnn::Mat probe(hidden_dim, hidden_dim + 1);
+  probe.fill(0.0f);
+  for (int32_t i = 0; i != hidden_dim; ++i) {
+    probe.row(i + 1)[i] = 1;
+  }
+
+  ncnn::Mat out;
+  {
+    auto ex = net.create_extractor();
+    ex.input(hidden_index_, probe);
+    if (ex.extract(joiner_out_index_, out) != 0 || out.h != hidden_dim + 1) {
+      NCNN_LOGE("Failed to run the last layer of the joiner. Disable blank "
+                "skipping.");
+      return;
+    }
+  }
+
+  int32_t vocab_size = out.w;
+  int32_t blank_id = model_->BlankId();
+  if (vocab_size < 2 || blank_id < 0 || blank_id >= vocab_size) {
+    NCNN_LOGE("Invalid vocab size %d. Disable blank skipping.", vocab_size);
+    return;
+  }
+
+  const float *b = out.row(0);
+
+  blank_bias_ = b[blank_id];
+  blank_weight_.resize(hidden_dim);
+
+  std::vector<float> w(static_cast<size_t>(vocab_size) * hidden_dim);
+  for (int32_t i = 0; i != hidden_dim; ++i) {
+    const float *p = out.row(i + 1);
+    for (int32_t k = 0; k != vocab_size; ++k) {
+      w[static_cast<size_t>(k) * hidden_dim + i] = p[k] - b[k];
+    }
+    blank_weight_[i] = p[blank_id] - b[blank_id];
+  }
+
+  norms_.resize(vocab_size);
+  biases_.assign(b, b + vocab_size);
+  for (int32_t k = 0; k != vocab_size; ++k) {
+    const float *p = w.data() + static_cast<size_t>(k) * hidden_dim;
+    double sum = 0;
+    for (int32_t i = 0; i != hidden_dim; ++i) {
+      sum += p[i] * p[i];
+    }
+    norms_[k] = static_cast<float>(std::sqrt(sum));
+  }
+
+  // The layer has to be affine; otherwise, e.g., if it has a fused
+  // activation or is quantized, the bound is invalid.
+  ncnn::Mat x(hidden_dim);
+  for (int32_t i = 0; i != hidden_dim; ++i) {
+    x[i] = std::sin(0.7f * i + 0.3f);
+  }
+
+  ncnn::Mat y;
+  {
+    auto ex = net.create_extractor();
+    ex.input(hidden_index_, x);
+    ex.extract(joiner_out_index_, y);
+  }
+
+  if (static_cast<int32_t>(y.total()) != vocab_size) {
+    NCNN_LOGE("Unexpected joiner output. Disable blank skipping.");
+    return;
+  }
+
+  const float *py = y;
+  for (int32_t k = 0; k != vocab_size; ++k) {
+    const float *p = w.data() + static_cast<size_t>(k) * hidden_dim;
+    float expected = b[k];
+    for (int32_t i = 0; i != hidden_dim; ++i) {
+      expected += p[i] * x[i];
+    }
+
+    if (std::abs(expected - py[k]) > 1e-2f * (1 + std::abs(expected))) {
+      NCNN_LOGE(
+          "The last layer of the joiner is not affine. Disable blank "
+          "skipping.");
+      return;
+    }
+  }
+
+  log_margin_ = std::log((1 - threshold_) / threshold_) -
+                std::log(static_cast<float>(vocab_size - 1));
+
+  enabled_ = true;
+}
+
+bool JoinerBlankHead::Run(ncnn::Mat &encoder_out, ncnn::Mat &decoder_out,
+                          ncnn::Mat *joiner_out) const {
+  auto ex = model_->CreateExtractor(model_->GetJoiner());
+  ex.input(encoder_out_index_, encoder_out);
+  ex.input(decoder_out_index_, decoder_out);
+
+  ncnn::Mat hidden;
+  ex.extract(hidden_index_, hidden);
+
+  int32_t hidden_dim = static_cast<int32_t>(hidden.total());
+  std::call_once(init_flag_, [this, hidden_dim]() { Init(hidden_dim); });
+
+  if (enabled_ && hidden_dim == static_cast<int32_t>(blank_weight_.size())) {
+    const float *h = hidden;
+
+    float blank_logit = blank_bias_;
+    float sum = 0;
+    for (int32_t i = 0; i != hidden_dim; ++i) {
+      blank_logit += blank_weight_[i] * h[i];
+      sum += h[i] * h[i];
+    }
+    float h_norm = std::sqrt(sum);
+
+    int32_t blank_id = model_->BlankId();
+    int32_t vocab_size = static_cast<int32_t>(norms_.size());
+    float bound = -std::numeric_limits<float>::infinity();
+    for (int32_t k = 0; k != vocab_size; ++k) {
+      if (k == blank_id) continue;
+      bound = std::max(bound, norms_[k] * h_norm + biases_[k]);
+    }
+
+    // p(blank) = 1 / (1 + sum_k exp(l[k] - l[blank]))
+    //         >= 1 / (1 + (vocab_size - 1) * exp(bound - l[blank]))
+    if (bound - blank_logit <= log_margin_) {
+      return true;
+    }
+  }
+
+  // hidden is kept in the extractor, so only the last layer is run here
+  ex.extract(joiner_out_index_, *joiner_out);
+  return false;
+}
+
+}  // namespace sherpa_ncnn
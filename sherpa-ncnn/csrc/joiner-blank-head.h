@@ -0,0 +1,98 @@
+// sherpa-ncnn/csrc/joiner-blank-head.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_JOINER_BLANK_HEAD_H_
+#define SHERPA_NCNN_CSRC_JOINER_BLANK_HEAD_H_
+
+#include <memory>
+#include <mutex>  // NOLINT
+#include <vector>
+
+#include "mat.h"  // NOLINT
+#include "sherpa-ncnn/csrc/model.h"
+
+namespace sherpa_ncnn {
+
+// Most encoder frames emit blank. For them, we don't need the full
+// projection from the joiner hidden state to the vocabulary.
+//
+// The last layer of the joiner is an InnerProduct that maps the hidden
+// state h to logits l[i] = w[i]·h + b[i]. This class computes only the
+// blank logit l[0] and bounds all other logits using
+//
+//   l[i] <= |w[i]| * |h| + b[i]
+//
+// If the bound shows that the probability of blank is at least the given
+// threshold, the frame is known to be blank without computing the other
+// logits. Otherwise, the remaining InnerProduct is run as usual.
+//
+// Since the test uses an upper bound, no frame is ever wrongly classified
+// as blank. How often frames are skipped depends on the model.
+//
+// It is thread-safe.
+class JoinerBlankHead {
+ public:
+  /**
+   * @param model The NN model. Not owned.
+   * @param threshold  A frame is skipped if the probability of blank is
+   *                   known to be at least this value. Must be in the
+   *                   range [0.5, 1).
+   *
+   * @return Return nullptr if the joiner of the model is not supported.
+   */
+  static std::unique_ptr<JoinerBlankHead> Create(Model *model,
+                                                 float threshold);
+
+  /** Run the joiner network.
+   *
+   * @param encoder_out  A mat of shape (encoder_dim,)
+   * @param decoder_out  A mat of shape (decoder_dim,)
+   * @param joiner_out If the function returns false, it contains the joiner
+   *                   output on return, which is of shape (vocab_size,).
+   *                   Otherwise, it is not changed.
+   *
+   * @return Return true if the probability of blank is at least the
+   *         threshold.
+   */
+  bool Run(ncnn::Mat &encoder_out, ncnn::Mat &decoder_out,
+           ncnn::Mat *joiner_out) const;
+
+ private:
+  JoinerBlankHead(Model *model, float threshold, int32_t hidden_index);
+
+  // Compute the weights of the last layer from its output for
+  // unit hidden states. It is called once on the first call to Run()
+  // since we need the hidden dimension.
+  void Init(int32_t hidden_dim) const;
+
+ private:
+  Model *model_;  // not owned
+  float threshold_;
+
+  int32_t encoder_out_index_ = -1;
+  int32_t decoder_out_index_ = -1;
+  int32_t joiner_out_index_ = -1;
+
+  // Index of the blob that is the input of the last InnerProduct layer
+  int32_t hidden_index_ = -1;
+
+  mutable std::once_flag init_flag_;
+
+  // The following members are set in Init()
+  mutable bool enabled_ = false;
+  mutable std::vector<float> blank_weight_;
+  mutable float blank_bias_ = 0;
+
+  // norms_[i] is |w[i]| and biases_[i] is b[i] for non-blank token i.
+  // The entry for blank is not used.
+  mutable std::vector<float> norms_;
+  mutable std::vector<float> biases_;
+
+  // log((1 - threshold) / (threshold * (vocab_size - 1)))
+  mutable float log_margin_ = 0;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_JOINER_BLANK_HEAD_H_
@@ -0,0 +1,100 @@
+// sherpa-ncnn/csrc/joiner-projection.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/joiner-projection.h"
+
+#include <memory>
+
+#include "net.h"  // NOLINT
+
+namespace sherpa_ncnn {
+
+// Return the output of the InnerProduct layer that is the only consumer of
+// blob and has no other input. Return -1 if there is no such layer.
+static int32_t FindProjection(const ncnn::Net &net, int32_t blob) {
+  int32_t ans = -1;
+  for (const auto *layer : net.layers()) {
+    for (auto b : layer->bottoms) {
+      if (b != blob) continue;
+
+      if (ans != -1 || layer->type != "InnerProduct" ||
+          layer->bottoms.size() != 1 || layer->tops.size() != 1) {
+        return -1;
+      }
+
+      ans = layer->tops[0];
+    }
+  }
+
+  return ans;
+}
+
+std::unique_ptr<JoinerProjection> JoinerProjection::Create(Model *model) {
+  const ncnn::Net &net = model->GetJoiner();
+  if (net.opt.use_vulkan_compute) {
+    return nullptr;
+  }
+
+  int32_t encoder_out_index = FindBlob(net, "in0");
+  int32_t decoder_out_index = FindBlob(net, "in1");
+  int32_t joiner_out_index = FindBlob(net, "out0");
+  if (encoder_out_index == -1 || decoder_out_index == -1 ||
+      joiner_out_index == -1) {
+    return nullptr;
+  }
+
+  int32_t encoder_proj_index = FindProjection(net, encoder_out_index);
+  int32_t decoder_proj_index = FindProjection(net, decoder_out_index);
+  if (encoder_proj_index == -1 || decoder_proj_index == -1) {
+    return nullptr;
+  }
+
+  return std::unique_ptr<JoinerProjection>(new JoinerProjection(
+      model, encoder_out_index, decoder_out_index, encoder_proj_index,
+      decoder_proj_index, joiner_out_index));
+}
+
+JoinerProjection::JoinerProjection(Model *model, int32_t encoder_out_index,
+                                   int32_t decoder_out_index,
+                                   int32_t encoder_proj_index,
+                                   int32_t decoder_proj_index,
+                                   int32_t joiner_out_index)
+    : model_(model),
+      encoder_out_index_(encoder_out_index),
+      decoder_out_index_(decoder_out_index),
+      encoder_proj_index_(encoder_proj_index),
+      decoder_proj_index_(decoder_proj_index),
+      joiner_out_index_(joiner_out_index) {}
+
+ncnn::Mat JoinerProjection::Extract(int32_t in_index, ncnn::Mat &in,
+                                    int32_t out_index) const {
+  auto ex = model_->CreateExtractor(model_->GetJoiner());
+  ex.input(in_index, in);
+
+  ncnn::Mat out;
+  ex.extract(out_index, out);
+  return out;
+}
+
+ncnn::Mat JoinerProjection::ProjectEncoder(ncnn::Mat &encoder_out) const {
+  return Extract(encoder_out_index_, encoder_out, encoder_proj_index_);
+}
+
+ncnn::Mat JoinerProjection::ProjectDecoder(ncnn::Mat &decoder_out) const {
+  // The output may be allocated from the memory pool of the model
+  return Extract(decoder_out_index_, decoder_out, decoder_proj_index_).clone();
+}
+
+ncnn::Mat JoinerProjection::Run(ncnn::Mat &encoder_proj,
+                                ncnn::Mat &decoder_proj) const {
+  auto ex = model_->CreateExtractor(model_->GetJoiner());
+  ex.input(encoder_proj_index_, encoder_proj);
+  ex.input(decoder_proj_index_, decoder_proj);
+
+  ncnn::Mat joiner_out;
+  ex.extract(joiner_out_index_, joiner_out);
+  return joiner_out;
+}
+
+}  // namespace sherpa_ncnn
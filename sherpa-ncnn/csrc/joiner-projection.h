@@ -0,0 +1,88 @@
+// sherpa-ncnn/csrc/joiner-projection.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_JOINER_PROJECTION_H_
+#define SHERPA_NCNN_CSRC_JOINER_PROJECTION_H_
+
+#include <memory>
+
+#include "mat.h"  // NOLINT
+#include "sherpa-ncnn/csrc/model.h"
+
+namespace sherpa_ncnn {
+
+// Run the input projections of the joiner separately from the rest of it.
+//
+// The joiner computes
+//
+//   out = output_linear(tanh(encoder_proj(e) + decoder_proj(d)))
+//
+// where encoder_proj and decoder_proj are InnerProduct layers that read
+// the inputs in0 and in1 directly. Running the whole network for each
+// frame projects the frame again for every call, and the decoder output
+// of a context again for every frame. With this class, a chunk of encoder
+// frames is projected in one batched InnerProduct, decoder outputs are
+// projected once when they are computed, e.g., before they are put in the
+// DecoderCache, and each joiner call runs only the add, tanh and output
+// projection. The results are the same as running the whole network.
+//
+// It is thread-safe.
+class JoinerProjection {
+ public:
+  /**
+   * @param model The NN model. Not owned.
+   *
+   * @return Return nullptr if the inputs of the joiner are not projected
+   *         by InnerProduct layers that have no other input, or if the
+   *         joiner runs on the GPU.
+   */
+  static std::unique_ptr<JoinerProjection> Create(Model *model);
+
+  /**
+   * @param encoder_out  A mat of shape (encoder_dim, num_frames)
+   * @return Return a mat of shape (joiner_dim, num_frames)
+   */
+  ncnn::Mat ProjectEncoder(ncnn::Mat &encoder_out) const;
+
+  /**
+   * @param decoder_out  A mat of shape (decoder_dim, num_hyps)
+   * @return Return a mat of shape (joiner_dim, num_hyps). It does not refer
+   *         to the memory pools of the model, so it can be cached.
+   */
+  ncnn::Mat ProjectDecoder(ncnn::Mat &decoder_out) const;
+
+  /** Same as Model::RunJoiner() but for projected inputs.
+   *
+   * @param encoder_proj  A mat of shape (joiner_dim, 1)
+   * @param decoder_proj  A mat of shape (joiner_dim, num_hyps)
+   * @return Return a mat of shape (vocab_size, num_hyps)
+   */
+  ncnn::Mat Run(ncnn::Mat &encoder_proj, ncnn::Mat &decoder_proj) const;
+
+  // Index of the blobs of the projected inputs in the joiner network, for
+  // classes that run parts of the joiner, e.g., JoinerShortlist
+  int32_t EncoderProjIndex() const { return encoder_proj_index_; }
+  int32_t DecoderProjIndex() const { return decoder_proj_index_; }
+
+ private:
+  JoinerProjection(Model *model, int32_t encoder_out_index,
+                   int32_t decoder_out_index, int32_t encoder_proj_index,
+                   int32_t decoder_proj_index, int32_t joiner_out_index);
+
+  // Run the joiner from input in_index to output out_index
+  ncnn::Mat Extract(int32_t in_index, ncnn::Mat &in, int32_t out_index) const;
+
+ private:
+  Model *model_;  // not owned
+
+  int32_t encoder_out_index_;
+  int32_t decoder_out_index_;
+  int32_t encoder_proj_index_;
+  int32_t decoder_proj_index_;
+  int32_t joiner_out_index_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_JOINER_PROJECTION_H_
@@ -0,0 +1,196 @@
+// sherpa-ncnn/csrc/joiner-shortlist.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/joiner-shortlist.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "net.h"  // NOLINT
+
+namespace sherpa_ncnn {
+
+std::unique_ptr<JoinerShortlist> JoinerShortlist::Create(
+    Model *model, std::vector<int32_t> tokens) {
+  ncnn::Net &net = model->GetJoiner();
+  if (net.opt.use_vulkan_compute) {
+    NCNN_LOGE("Token shortlist is not supported with vulkan. Disable it.");
+    return nullptr;
+  }
+
+  int32_t joiner_out_index = FindBlob(net, "out0");
+  if (joiner_out_index == -1) {
+    NCNN_LOGE("Cannot find the output of the joiner. Disable token shortlist.");
+    return nullptr;
+  }
+
+  int32_t producer = net.blobs()[joiner_out_index].producer;
+  if (producer < 0) {
+    NCNN_LOGE("Invalid joiner. Disable token shortlist.");
+    return nullptr;
+  }
+
+  const ncnn::Layer *layer = net.layers()[producer];
+  if (layer->type != "InnerProduct" || layer->bottoms.size() != 1) {
+    NCNN_LOGE(
+        "The last layer of the joiner is %s, not InnerProduct. Disable token "
+        "shortlist.",
+        layer->type.c_str());
+    return nullptr;
+  }
+
+  int32_t blank_id = model->BlankId();
+  if (std::find(tokens.begin(), tokens.end(), blank_id) == tokens.end()) {
+    tokens.insert(tokens.begin(), blank_id);
+  }
+
+  return std::unique_ptr<JoinerShortlist>(
+      new JoinerShortlist(model, std::move(tokens), layer->bottoms[0]));
+}
+
+JoinerShortlist::JoinerShortlist(Model *model, std::vector<int32_t> tokens,
+                                 int32_t hidden_index)
+    : model_(model), tokens_(std::move(tokens)), hidden_index_(hidden_index) {
+  const ncnn::Net &net = model_->GetJoiner();
+  encoder_out_index_ = FindBlob(net, "in0");
+  decoder_out_index_ = FindBlob(net, "in1");
+  joiner_out_index_ = FindBlob(net, "out0");
+}
+
+void JoinerShortlist::Init(int32_t hidden_dim) const {
+  const ncnn::Net &net = model_->GetJoiner();
+
+  // Row 0 is zero and row i + 1 is the i-th unit vector, so row 0 of the
+  // output is b and row i + 1 is b + the i-th column of w.
+  ncnn::Mat probe(hidden_dim, hidden_dim + 1);
+  probe.fill(0.0f);
+  for (int32_t i = 0; i != hidden_dim; ++i) {
+    probe.row(i + 1)[i] = 1;
+  }
+
+  ncnn::Mat out;
+  {
+    auto ex = net.create_extractor();
+    ex.input(hidden_index_, probe);
+    if (ex.extract(joiner_out_index_, out) != 0 || out.h != hidden_dim + 1) {
+      NCNN_LOGE("Failed to run the last layer of the joiner. Disable token "
+                "shortlist.");
+      return;
+    }
+  }
+
+  int32_t vocab_size = out.w;
+  for (auto t : tokens_) {
+    if (t < 0 || t >= vocab_size) {
+      NCNN_LOGE("Token %d of the shortlist is not in [0, %d). Disable token "
+                "shortlist.",
+                t, vocab_size);
+      return;
+    }
+  }
+
+  int32_t n = static_cast<int32_t>(tokens_.size());
+  const float *b = out.row(0);
+
+  biases_.resize(n);
+  weights_.resize(static_cast<size_t>(n) * hidden_dim);
+  for (int32_t k = 0; k != n; ++k) {
+    int32_t t = tokens_[k];
+    biases_[k] = b[t];
+
+    float *w = weights_.data() + static_cast<size_t>(k) * hidden_dim;
+    for (int32_t i = 0; i != hidden_dim; ++i) {
+      w[i] = out.row(i + 1)[t] - b[t];
+    }
+  }
+
+  // The layer has to be affine; otherwise, e.g., if it has a fused
+  // activation or is quantized, the logits would be wrong.
+  ncnn::Mat x(hidden_dim);
+  for (int32_t i = 0; i != hidden_dim; ++i) {
+    x[i] = std::sin(0.7f * i + 0.3f);
+  }
+
+  ncnn::Mat y;
+  {
+    auto ex = net.create_extractor();
+    ex.input(hidden_index_, x);
+    ex.extract(joiner_out_index_, y);
+  }
+
+  if (static_cast<int32_t>(y.total()) != vocab_size) {
+    NCNN_LOGE("Unexpected joiner output. Disable token shortlist.");
+    return;
+  }
+
+  const float *py = y;
+  for (int32_t k = 0; k != n; ++k) {
+    const float *w = weights_.data() + static_cast<size_t>(k) * hidden_dim;
+    float expected = biases_[k];
+    for (int32_t i = 0; i != hidden_dim; ++i) {
+      expected += w[i] * x[i];
+    }
+
+    float actual = py[tokens_[k]];
+    if (std::abs(expected - actual) > 1e-2f * (1 + std::abs(expected))) {
+      NCNN_LOGE(
+          "The last layer of the joiner is not affine. Disable token "
+          "shortlist.");
+      return;
+    }
+  }
+
+  hidden_dim_ = hidden_dim;
+  enabled_ = true;
+}
+
+bool JoinerShortlist::Run(ncnn::Mat &encoder_out, ncnn::Mat &decoder_out,
+                          ncnn::Mat *joiner_out,
+                          const JoinerProjection *projection) const {
+  auto ex = model_->CreateExtractor(model_->GetJoiner());
+  if (projection) {
+    ex.input(projection->EncoderProjIndex(), encoder_out);
+    ex.input(projection->DecoderProjIndex(), decoder_out);
+  } else {
+    ex.input(encoder_out_index_, encoder_out);
+    ex.input(decoder_out_index_, decoder_out);
+  }
+
+  ncnn::Mat hidden;
+  ex.extract(hidden_index_, hidden);
+
+  int32_t hidden_dim = hidden.w;
+  std::call_once(init_flag_, [this, hidden_dim]() { Init(hidden_dim); });
+
+  if (!enabled_ || hidden_dim != hidden_dim_ || hidden.elempack != 1) {
+    // hidden is kept in the extractor, so only the last layer is run here
+    ex.extract(joiner_out_index_, *joiner_out);
+    return false;
+  }
+
+  int32_t num_rows = hidden.dims == 1 ? 1 : hidden.h;
+  int32_t n = static_cast<int32_t>(tokens_.size());
+
+  joiner_out->create(n, num_rows);
+  for (int32_t r = 0; r != num_rows; ++r) {
+    const float *h = hidden.row(r);
+    float *out = joiner_out->row(r);
+
+    for (int32_t k = 0; k != n; ++k) {
+      const float *w = weights_.data() + static_cast<size_t>(k) * hidden_dim;
+      float sum = biases_[k];
+      for (int32_t i = 0; i != hidden_dim; ++i) {
+        sum += w[i] * h[i];
+      }
+      out[k] = sum;
+    }
+  }
+
+  return true;
+}
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,97 @@
+// sherpa-ncnn/csrc/joiner-shortlist.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_JOINER_SHORTLIST_H_
+#define SHERPA_NCNN_CSRC_JOINER_SHORTLIST_H_
+
+#include <memory>
+#include <mutex>  // NOLINT
+#include <vector>
+
+#include "mat.h"  // NOLINT
+#include "sherpa-ncnn/csrc/joiner-projection.h"
+#include "sherpa-ncnn/csrc/model.h"
+
+namespace sherpa_ncnn {
+
+// Score only a subset of the vocabulary in the joiner, e.g., the tokens of
+// the languages a deployment needs from a large multilingual vocabulary.
+//
+// The last layer of the joiner is an InnerProduct that maps the hidden
+// state h to logits l[i] = w[i]·h + b[i]. For a vocabulary of 10k tokens
+// it dominates the cost of the joiner. This class keeps the rows w[i] and
+// b[i] of the shortlisted tokens only and computes their logits from h, so
+// the cost is proportional to the size of the shortlist. The log-softmax
+// of the decoder is then taken over the shortlist, i.e., the model is
+// restricted to it.
+//
+// If the joiner is not supported, e.g., its last layer is not affine or it
+// runs on the GPU, the full projection is used instead.
+//
+// It is thread-safe.
+class JoinerShortlist {
+ public:
+  /**
+   * @param model The NN model. Not owned.
+   * @param tokens  IDs of the tokens to score. Blank is added if it is
+   *                missing.
+   *
+   * @return Return nullptr if the joiner of the model is not supported.
+   */
+  static std::unique_ptr<JoinerShortlist> Create(Model *model,
+                                                 std::vector<int32_t> tokens);
+
+  /** Run the joiner network.
+   *
+   * @param encoder_out  A mat of shape (encoder_dim,) or (encoder_dim, 1)
+   * @param decoder_out  A mat of shape (decoder_dim, num_hyps)
+   * @param joiner_out On return, it is of shape (Tokens().size(), num_hyps)
+   *                   if the function returns true. Otherwise, it is the
+   *                   full joiner output of shape (vocab_size, num_hyps).
+   * @param projection If not null, encoder_out and decoder_out are the
+   *                   outputs of its ProjectEncoder() and ProjectDecoder().
+   *
+   * @return Return true if joiner_out contains the logits of Tokens() only.
+   */
+  bool Run(ncnn::Mat &encoder_out, ncnn::Mat &decoder_out,
+           ncnn::Mat *joiner_out,
+           const JoinerProjection *projection = nullptr) const;
+
+  // Column k of the output of Run() is the logit of Tokens()[k]
+  const std::vector<int32_t> &Tokens() const { return tokens_; }
+
+ private:
+  JoinerShortlist(Model *model, std::vector<int32_t> tokens,
+                  int32_t hidden_index);
+
+  // Compute the rows of the last layer for the shortlisted tokens from its
+  // output for unit hidden states. It is called once on the first call to
+  // Run() since we need the hidden dimension.
+  void Init(int32_t hidden_dim) const;
+
+ private:
+  Model *model_;  // not owned
+  std::vector<int32_t> tokens_;
+
+  int32_t encoder_out_index_ = -1;
+  int32_t decoder_out_index_ = -1;
+  int32_t joiner_out_index_ = -1;
+
+  // Index of the blob that is the input of the last InnerProduct layer
+  int32_t hidden_index_ = -1;
+
+  mutable std::once_flag init_flag_;
+
+  // The following members are set in Init()
+  mutable bool enabled_ = false;
+  mutable int32_t hidden_dim_ = 0;
+
+  // Row k is w[tokens_[k]], of hidden_dim_ floats
+  mutable std::vector<float> weights_;
+  mutable std::vector<float> biases_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_JOINER_SHORTLIST_H_
@@ -0,0 +1,272 @@
+// sherpa-ncnn/csrc/keyword-decoder.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/keyword-decoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/latency-stats.h"
+#include "sherpa-ncnn/csrc/math.h"
+
+namespace sherpa_ncnn {
+
+namespace {
+
+// Return true if state has a child for token
+bool HasChild(const ContextState *root, const ContextState *state,
+              int32_t token) {
+  const ContextState *begin = root + state->first_child;
+  const ContextState *end = begin + state->num_children;
+  const ContextState *p =
+      std::lower_bound(begin, end, token, [](const ContextState &s, int32_t t) {
+        return s.token < t;
+      });
+  return p != end && p->token == token;
+}
+
+bool SameMat(const ncnn::Mat &a, const ncnn::Mat &b) {
+  return !a.empty() && a.w == b.w && a.h == b.h &&
+         std::memcmp(a.data, b.data, a.total() * a.elemsize) == 0;
+}
+
+}  // namespace
+
+KeywordDecoder::KeywordDecoder(Model *model, const ContextGraph *graph,
+                               int32_t num_active_paths,
+                               int32_t num_trailing_blanks,
+                               int32_t max_blank_frames)
+    : model_(model),
+      graph_(graph),
+      num_active_paths_(num_active_paths),
+      num_trailing_blanks_(num_trailing_blanks),
+      max_blank_frames_(max_blank_frames) {
+  float min_threshold = 1;
+  const ContextState *root = graph_->Root();
+  for (int32_t i = 0; i != graph_->NumNodes(); ++i) {
+    if (root[i].is_end) {
+      min_threshold = std::min(min_threshold, root[i].ac_threshold);
+    }
+  }
+
+  min_log_threshold_ = min_threshold > 0
+                           ? std::log(min_threshold)
+                           : -std::numeric_limits<float>::infinity();
+}
+
+DecoderResult KeywordDecoder::GetEmptyResult() const {
+  DecoderResult r;
+
+  std::vector<int32_t> blanks(model_->ContextSize(), model_->BlankId());
+  Hypothesis hyp(blanks, 0, graph_->Root());
+  r.hyps = Hypotheses({hyp});
+
+  return r;
+}
+
+bool KeywordDecoder::IsIdle(const DecoderResult &result) const {
+  for (const auto &hyp : result.hyps) {
+    if (hyp.context_state != graph_->Root()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::vector<Hypothesis> KeywordDecoder::Prune(const Hypotheses &hyps) const {
+  std::vector<Hypothesis> ans = hyps.GetTopK(num_active_paths_, false);
+
+  const ContextState *root = graph_->Root();
+  for (const auto &hyp : ans) {
+    if (hyp.context_state == root) {
+      return ans;
+    }
+  }
+
+  for (const auto &hyp : hyps) {
+    if (hyp.context_state == root) {
+      ans.push_back(hyp);
+      break;
+    }
+  }
+
+  return ans;
+}
+
+ncnn::Mat KeywordDecoder::BuildDecoderInput(
+    const std::vector<Hypothesis> &hyps) const {
+  int32_t num_hyps = static_cast<int32_t>(hyps.size());
+  int32_t context_size = model_->ContextSize();
+
+  ncnn::Mat decoder_input(context_size, num_hyps);
+  auto p = static_cast<int32_t *>(decoder_input);
+
+  for (const auto &hyp : hyps) {
+    hyp.GetLastTokens(context_size, p);
+    p += context_size;
+  }
+
+  return decoder_input;
+}
+
+void KeywordDecoder::SetKeyword(const Hypothesis &hyp,
+                                DecoderResult *result) const {
+  int32_t level = hyp.context_state->level;
+  result->tokens.resize(level);
+  result->timestamps.resize(level);
+
+  const TokenNode *node = hyp.tail.get();
+  for (int32_t i = level - 1; i >= 0; --i, node = node->prev.get()) {
+    result->tokens[i] = node->token;
+    result->timestamps[i] = node->timestamp;
+  }
+
+  result->keyword = hyp.context_state;
+}
+
+void KeywordDecoder::Decode(ncnn::Mat encoder_out, DecoderResult *result) {
+  const ContextState *root = graph_->Root();
+  int32_t blank_id = model_->BlankId();
+
+  Hypotheses cur = std::move(result->hyps);
+
+  // Without a partial match, the context of the only hypothesis rarely
+  // changes between frames, so its decoder output is reused
+  ncnn::Mat last_decoder_input;
+  ncnn::Mat last_decoder_out;
+
+  /* encoder_out.w == encoder_out_dim, encoder_out.h == num_frames */
+  for (int32_t t = 0; t != encoder_out.h; ++t) {
+    std::vector<Hypothesis> prev = Prune(cur);
+    cur.Clear();
+
+    ncnn::Mat decoder_input = BuildDecoderInput(prev);
+    ncnn::Mat decoder_out;
+    if (SameMat(last_decoder_input, decoder_input)) {
+      decoder_out = last_decoder_out;
+    } else {
+      ScopedStageTimer timer(Stage::kDecoder);
+      decoder_out = model_->RunDecoder2D(decoder_input);
+      last_decoder_input = decoder_input;
+      last_decoder_out = decoder_out;
+    }
+
+    ncnn::Mat encoder_out_t(encoder_out.w, 1, encoder_out.row(t));
+    ncnn::Mat joiner_out;
+    {
+      ScopedStageTimer timer(Stage::kJoiner);
+      joiner_out = model_->RunJoiner(encoder_out_t, decoder_out);
+    }
+    // joiner_out.w == vocab_size
+    // joiner_out.h == prev.size()
+
+    int32_t vocab_size = joiner_out.w;
+    int32_t frame = t + result->frame_offset;
+    for (int32_t i = 0; i != static_cast<int32_t>(prev.size()); ++i) {
+      const Hypothesis &hyp = prev[i];
+      float *log_probs = joiner_out.row(i);
+      LogSoftmax(log_probs, vocab_size);
+
+      const ContextState *state = hyp.context_state;
+      const ContextState *begin = root + state->first_child;
+      const ContextState *end = begin + state->num_children;
+
+      // Tokens that continue the match
+      for (const ContextState *c = begin; c != end; ++c) {
+        float log_prob = log_probs[c->token];
+        float keyword_log_prob = hyp.keyword_log_prob + log_prob;
+        if (keyword_log_prob < min_log_threshold_ * c->level) {
+          // No keyword below c can reach its threshold
+          continue;
+        }
+
+        Hypothesis new_hyp = hyp;
+        new_hyp.AddToken(c->token, frame);
+        new_hyp.context_state = c;
+        new_hyp.log_prob += log_prob;
+        new_hyp.keyword_log_prob = keyword_log_prob;
+        new_hyp.num_trailing_blanks = 0;
+        cur.Add(std::move(new_hyp));
+      }
+
+      Hypothesis new_hyp = hyp;
+      if (state == root) {
+        // Blank or any token that does not start a keyword
+        float start_prob = 0;
+        for (const ContextState *c = begin; c != end; ++c) {
+          start_prob += std::exp(log_probs[c->token]);
+        }
+        new_hyp.log_prob += std::log(std::max(1 - start_prob, 1e-10f));
+
+        // The decoder context follows the most probable token
+        int32_t token =
+            std::max_element(log_probs, log_probs + vocab_size) - log_probs;
+        if (token != blank_id && !HasChild(root, root, token)) {
+          new_hyp.AddToken(token, frame);
+          new_hyp.num_trailing_blanks = 0;
+        } else {
+          ++new_hyp.num_trailing_blanks;
+        }
+      } else {
+        // Other tokens end the match. So does a long pause.
+        if (hyp.num_trailing_blanks >= max_blank_frames_) {
+          continue;
+        }
+        new_hyp.log_prob += log_probs[blank_id];
+        ++new_hyp.num_trailing_blanks;
+      }
+      cur.Add(std::move(new_hyp));
+    }
+
+    if (result->keyword) {
+      // The last detection is not consumed yet
+      continue;
+    }
+
+    const Hypothesis *best = nullptr;
+    for (const auto &hyp : cur) {
+      const ContextState *s = hyp.context_state;
+      if (!s->is_end || hyp.num_trailing_blanks < num_trailing_blanks_ ||
+          hyp.keyword_log_prob < std::log(s->ac_threshold) * s->level) {
+        continue;
+      }
+
+      if (!best || hyp.log_prob > best->log_prob) {
+        best = &hyp;
+      }
+    }
+
+    if (best) {
+      SetKeyword(*best, result);
+
+      // Start over, keeping the decoder context
+      Hypothesis hyp = *best;
+      hyp.context_state = root;
+      hyp.log_prob = 0;
+      hyp.keyword_log_prob = 0;
+      hyp.num_trailing_blanks = 0;
+
+      cur.Clear();
+      cur.Add(std::move(hyp));
+    }
+  }
+
+  // Keep the scores small in streams that run for days
+  double max_log_prob = -std::numeric_limits<double>::infinity();
+  for (const auto &hyp : cur) {
+    max_log_prob = std::max(max_log_prob, hyp.log_prob);
+  }
+  for (auto &hyp : cur) {
+    hyp.log_prob -= max_log_prob;
+  }
+
+  result->hyps = std::move(cur);
+  result->frame_offset += encoder_out.h;
+}
+
+}  // namespace sherpa_ncnn
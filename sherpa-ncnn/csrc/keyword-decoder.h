@@ -0,0 +1,88 @@
+// sherpa-ncnn/csrc/keyword-decoder.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_KEYWORD_DECODER_H_
+#define SHERPA_NCNN_CSRC_KEYWORD_DECODER_H_
+
+#include <vector>
+
+#include "mat.h"  // NOLINT
+#include "sherpa-ncnn/csrc/context-graph.h"
+#include "sherpa-ncnn/csrc/decoder.h"
+#include "sherpa-ncnn/csrc/model.h"
+
+namespace sherpa_ncnn {
+
+/** Transducer search restricted to the paths of a keyword graph.
+ *
+ * Unlike ModifiedBeamSearchDecoder with hotwords, it does not recognize
+ * speech. Each hypothesis is a partial match of a keyword, i.e., a node of
+ * the graph, and can only be extended by blank or by a token that leads to
+ * a child of the node. One hypothesis always stays at the root. It absorbs
+ * blank and every token that does not start a keyword, and new partial
+ * matches start from it on each frame.
+ *
+ * A keyword is detected when a hypothesis at the end of a keyword has been
+ * followed by num_trailing_blanks blanks and the mean probability of the
+ * tokens of the keyword is at least ContextState::ac_threshold of its end
+ * node. The search then starts over from the root.
+ *
+ * Partial matches are dropped once their mean token probability is below
+ * the smallest threshold of the graph, or after max_blank_frames blanks, so
+ * without a candidate keyword in the audio, only the root hypothesis is
+ * left. See IsIdle().
+ */
+class KeywordDecoder : public Decoder {
+ public:
+  /**
+   * @param model The NN model. Not owned.
+   * @param graph The keywords. Not owned.
+   * @param num_active_paths Number of partial matches to keep.
+   * @param num_trailing_blanks Number of blank frames after the last token
+   *                            of a keyword before it is detected. Use it
+   *                            if a keyword is a prefix of another one.
+   * @param max_blank_frames A partial match is dropped after this number
+   *                         of blank frames, counted after subsampling.
+   */
+  KeywordDecoder(Model *model, const ContextGraph *graph,
+                 int32_t num_active_paths, int32_t num_trailing_blanks,
+                 int32_t max_blank_frames);
+
+  DecoderResult GetEmptyResult() const override;
+
+  void Decode(ncnn::Mat encoder_out, DecoderResult *result) override;
+
+  // The graph of the stream is not used
+  void Decode(ncnn::Mat encoder_out, Stream *s,
+              DecoderResult *result) override {
+    Decode(encoder_out, result);
+  }
+
+  // Return true if result has no partial match of a keyword
+  bool IsIdle(const DecoderResult &result) const;
+
+ private:
+  // Return the top num_active_paths_ hypotheses, plus the one at the root
+  // if it is not among them
+  std::vector<Hypothesis> Prune(const Hypotheses &hyps) const;
+
+  ncnn::Mat BuildDecoderInput(const std::vector<Hypothesis> &hyps) const;
+
+  // Set result->keyword, tokens and timestamps to the keyword of hyp
+  void SetKeyword(const Hypothesis &hyp, DecoderResult *result) const;
+
+ private:
+  Model *model_;  // not owned
+  const ContextGraph *graph_;  // not owned
+  int32_t num_active_paths_;
+  int32_t num_trailing_blanks_;
+  int32_t max_blank_frames_;
+
+  // Log of the smallest threshold of the keywords
+  float min_log_threshold_ = 0;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_KEYWORD_DECODER_H_
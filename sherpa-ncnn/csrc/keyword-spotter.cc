@@ -0,0 +1,240 @@
+// sherpa-ncnn/csrc/keyword-spotter.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/keyword-spotter.h"
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/context-graph.h"
+#include "sherpa-ncnn/csrc/hotwords.h"
+#include "sherpa-ncnn/csrc/keyword-decoder.h"
+#include "sherpa-ncnn/csrc/macros.h"
+#include "sherpa-ncnn/csrc/symbol-table.h"
+
+namespace sherpa_ncnn {
+
+std::string KeywordSpotterConfig::ToString() const {
+  std::ostringstream os;
+
+  os << "KeywordSpotterConfig(";
+  os << "feat_config=" << feat_config.ToString() << ", ";
+  os << "model_config=" << model_config.ToString() << ", ";
+  os << "keywords_file=\"" << keywords_file << "\", ";
+  os << "keywords_threshold=" << keywords_threshold << ", ";
+  os << "num_trailing_blanks=" << num_trailing_blanks << ", ";
+  os << "num_active_paths=" << num_active_paths << ", ";
+  os << "max_pause=" << max_pause << ", ";
+  os << "idle_chunks=" << idle_chunks << ")";
+
+  return os.str();
+}
+
+std::string KeywordResult::ToString() const {
+  std::ostringstream os;
+
+  os << "keyword: " << keyword << "\n";
+  os << "tokens:";
+  for (const auto &t : tokens) {
+    os << " " << t;
+  }
+  os << "\n";
+  os << "timestamps:";
+  for (const auto &t : timestamps) {
+    os << " " << t;
+  }
+  os << "\n";
+
+  return os.str();
+}
+
+class KeywordSpotter::Impl {
+ public:
+  explicit Impl(const KeywordSpotterConfig &config)
+      : config_(config),
+        model_(Model::Create(config.model_config)),
+        sym_(config.model_config.tokens) {
+    if (!model_) {
+      SHERPA_NCNN_LOGE("Failed to load the model");
+      SHERPA_NCNN_EXIT(-1);
+    }
+
+    if (config_.num_active_paths < 1 || config_.idle_chunks < 1) {
+      SHERPA_NCNN_LOGE("Invalid config: %s", config_.ToString().c_str());
+      SHERPA_NCNN_EXIT(-1);
+    }
+
+    InitKeywords();
+
+    float frame_shift = config_.feat_config.frame_shift_ms / 1000;
+    int32_t max_blank_frames =
+        config_.max_pause / frame_shift / model_->SubsamplingFactor();
+
+    decoder_ = std::make_unique<KeywordDecoder>(
+        model_.get(), graph_.get(), config_.num_active_paths,
+        config_.num_trailing_blanks, std::max(max_blank_frames, 1));
+  }
+
+  std::unique_ptr<Stream> CreateStream() const {
+    auto stream = std::make_unique<Stream>(config_.feat_config);
+    stream->SetResult(decoder_->GetEmptyResult());
+    stream->SetStates(model_->GetEncoderInitStates(),
+                      model_->GetEncoderStateLayout());
+    return stream;
+  }
+
+  bool IsReady(Stream *s) const {
+    int32_t num_chunks = decoder_->IsIdle(s->GetResult())
+                             ? config_.idle_chunks
+                             : 1;
+    int32_t needed = s->GetNumProcessedFrames() + model_->Segment() +
+                     (num_chunks - 1) * model_->Offset();
+    if (needed < s->NumFramesReady()) {
+      return true;
+    }
+
+    // The input is finished. Decode what is left.
+    int32_t n = s->NumFramesReady();
+    return num_chunks > 1 && n > 0 && s->IsLastFrame(n - 1) &&
+           s->GetNumProcessedFrames() + model_->Segment() < n;
+  }
+
+  void DecodeStream(Stream *s) const {
+    bool idle = decoder_->IsIdle(s->GetResult());
+    int32_t num_chunks = idle ? config_.idle_chunks : 1;
+
+    for (int32_t i = 0; i != num_chunks; ++i) {
+      if (s->GetNumProcessedFrames() + model_->Segment() >=
+          s->NumFramesReady()) {
+        break;
+      }
+
+      DecodeChunk(s);
+
+      const DecoderResult &r = s->GetResult();
+      if (r.keyword || !decoder_->IsIdle(r)) {
+        // The remaining chunks are decoded one by one
+        break;
+      }
+    }
+  }
+
+  KeywordResult GetResult(Stream *s) const {
+    DecoderResult &r = s->GetResult();
+    KeywordResult ans;
+    if (!r.keyword) {
+      return ans;
+    }
+
+    std::string_view keyword = graph_->Phrase(r.keyword);
+    ans.keyword = std::string(keyword.data(), keyword.size());
+
+    float frame_shift = config_.feat_config.frame_shift_ms / 1000;
+    int32_t subsampling_factor = model_->SubsamplingFactor();
+    for (std::size_t i = 0; i != r.tokens.size(); ++i) {
+      std::string_view token = sym_[r.tokens[i]];
+      ans.tokens.emplace_back(token.data(), token.size());
+      ans.timestamps.push_back(frame_shift * subsampling_factor *
+                               r.timestamps[i]);
+    }
+
+    r.keyword = nullptr;
+    r.tokens.clear();
+    r.timestamps.clear();
+
+    return ans;
+  }
+
+  void Reset(Stream *s) const {
+    DecoderResult &r = s->GetResult();
+    DecoderResult empty = decoder_->GetEmptyResult();
+
+    // Keep the decoder context and the frame counter
+    Hypothesis hyp = r.hyps.GetMostProbable(false);
+    hyp.context_state = graph_->Root();
+    hyp.log_prob = 0;
+    hyp.keyword_log_prob = 0;
+    hyp.num_trailing_blanks = 0;
+
+    empty.hyps = Hypotheses({hyp});
+    empty.frame_offset = r.frame_offset;
+    r = std::move(empty);
+  }
+
+ private:
+  void InitKeywords() {
+    std::ifstream is(config_.keywords_file);
+    if (!is) {
+      SHERPA_NCNN_LOGE("Failed to open the keywords file %s",
+                       config_.keywords_file.c_str());
+      SHERPA_NCNN_EXIT(-1);
+    }
+
+    std::vector<std::vector<int32_t>> keywords;
+    std::vector<float> scores;
+    std::vector<float> thresholds;
+    std::vector<std::string> phrases;
+    ReadKeywords(is, sym_, &keywords, &scores, &thresholds, &phrases);
+    if (keywords.empty()) {
+      SHERPA_NCNN_LOGE("There are no keywords in %s",
+                       config_.keywords_file.c_str());
+      SHERPA_NCNN_EXIT(-1);
+    }
+
+    // The scores of the graph are not used
+    graph_ = std::make_unique<ContextGraph>(keywords, 0,
+                                            config_.keywords_threshold,
+                                            scores, phrases, thresholds);
+  }
+
+  void DecodeChunk(Stream *s) const {
+    ncnn::Mat features =
+        s->GetFrames(s->GetNumProcessedFrames(), model_->Segment());
+    s->GetNumProcessedFrames() += model_->Offset();
+
+    std::vector<ncnn::Mat> batch = {features};
+    ncnn::Mat encoder_out =
+        model_
+            ->RunEncoderBatch(batch, {&s->GetStates()},
+                              {&s->GetNextStates()}, {&s->GetDeviceStates()})
+            .at(0);
+
+    decoder_->Decode(encoder_out, &s->GetResult());
+    s->SwapStates();
+  }
+
+ private:
+  KeywordSpotterConfig config_;
+  std::unique_ptr<Model> model_;
+  SymbolTable sym_;
+  std::unique_ptr<ContextGraph> graph_;
+  std::unique_ptr<KeywordDecoder> decoder_;
+};
+
+KeywordSpotter::KeywordSpotter(const KeywordSpotterConfig &config)
+    : impl_(std::make_unique<Impl>(config)) {}
+
+KeywordSpotter::~KeywordSpotter() = default;
+
+std::unique_ptr<Stream> KeywordSpotter::CreateStream() const {
+  return impl_->CreateStream();
+}
+
+bool KeywordSpotter::IsReady(Stream *s) const { return impl_->IsReady(s); }
+
+void KeywordSpotter::DecodeStream(Stream *s) const { impl_->DecodeStream(s); }
+
+KeywordResult KeywordSpotter::GetResult(Stream *s) const {
+  return impl_->GetResult(s);
+}
+
+void KeywordSpotter::Reset(Stream *s) const { impl_->Reset(s); }
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,98 @@
+// sherpa-ncnn/csrc/keyword-spotter.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_KEYWORD_SPOTTER_H_
+#define SHERPA_NCNN_CSRC_KEYWORD_SPOTTER_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/features.h"
+#include "sherpa-ncnn/csrc/model.h"
+#include "sherpa-ncnn/csrc/stream.h"
+
+namespace sherpa_ncnn {
+
+struct KeywordSpotterConfig {
+  FeatureExtractorConfig feat_config;
+  ModelConfig model_config;
+
+  // One keyword per line, see ReadKeywords()
+  std::string keywords_file;
+
+  // The threshold of keywords without one of their own. A keyword is
+  // detected if the mean probability of its tokens is at least its
+  // threshold.
+  float keywords_threshold = 0.25;
+
+  // Number of blank frames after the last token of a keyword before it
+  // is detected, counted after subsampling. Use it if a keyword is a
+  // prefix of another one.
+  int32_t num_trailing_blanks = 1;
+
+  // Number of partial matches of keywords to keep
+  int32_t num_active_paths = 4;
+
+  // A partial match is dropped if no token of the keyword follows within
+  // this many seconds
+  float max_pause = 1.0;
+
+  // When no keyword is partially matched, the encoder waits until this
+  // many chunks are buffered and runs them back to back, so that the CPU
+  // wakes up less often. As soon as a keyword is partially matched, each
+  // chunk is decoded when it arrives. 1 disables it.
+  int32_t idle_chunks = 4;
+
+  std::string ToString() const;
+};
+
+struct KeywordResult {
+  // The text of the detected keyword. It is empty if none is detected.
+  std::string keyword;
+
+  // The tokens of the keyword and their timestamps in seconds from the
+  // start of the stream
+  std::vector<std::string> tokens;
+  std::vector<float> timestamps;
+
+  std::string ToString() const;
+};
+
+class KeywordSpotter {
+ public:
+  explicit KeywordSpotter(const KeywordSpotterConfig &config);
+  ~KeywordSpotter();
+
+  std::unique_ptr<Stream> CreateStream() const;
+
+  /** Return true if DecodeStream() can be called. While no keyword is
+   * partially matched, it needs KeywordSpotterConfig::idle_chunks chunks,
+   * unless the input is finished.
+   */
+  bool IsReady(Stream *s) const;
+
+  /** Decode one chunk, or, while no keyword is partially matched, up to
+   * KeywordSpotterConfig::idle_chunks chunks. It stops after a chunk in
+   * which a keyword is detected.
+   */
+  void DecodeStream(Stream *s) const;
+
+  /** Return the keyword detected since the last call, if any. Only one
+   * keyword is kept until it is returned, so call it after each
+   * DecodeStream().
+   */
+  KeywordResult GetResult(Stream *s) const;
+
+  /// Drop partial matches, e.g., after a detected keyword was handled
+  void Reset(Stream *s) const;
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_KEYWORD_SPOTTER_H_
@@ -0,0 +1,212 @@
+// sherpa-ncnn/csrc/latency-stats.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/latency-stats.h"
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <sstream>
+#include <string>
+
+#include "sherpa-ncnn/csrc/metrics.h"
+#include "sherpa-ncnn/csrc/trace.h"
+
+namespace sherpa_ncnn {
+
+// Bucket i contains samples in [kMinMs * kRatio^i, kMinMs * kRatio^(i+1)).
+// Bucket 0 also contains samples less than kMinMs.
+static constexpr double kMinMs = 1e-3;
+
+// 4 buckets per octave
+static const double kRatio = std::pow(2.0, 0.25);
+
+static thread_local ProfileScope *current_scope = nullptr;
+
+const char *GetStageName(Stage stage) {
+  switch (stage) {
+    case Stage::kFeatureExtraction:
+      return "feature_extraction";
+    case Stage::kEncoder:
+      return "encoder";
+    case Stage::kDecoder:
+      return "decoder";
+    case Stage::kJoiner:
+      return "joiner";
+    case Stage::kSearch:
+      return "search";
+    case Stage::kTtsFrontEnd:
+      return "tts_front_end";
+    case Stage::kTtsEncoder:
+      return "tts_encoder";
+    case Stage::kTtsDurationPredictor:
+      return "tts_duration_predictor";
+    case Stage::kTtsPathAttention:
+      return "tts_path_attention";
+    case Stage::kTtsFlow:
+      return "tts_flow";
+    case Stage::kTtsVocoder:
+      return "tts_vocoder";
+  }
+  return "unknown";
+}
+
+std::string StageSummary::ToString() const {
+  std::ostringstream os;
+  os << "StageSummary(";
+  os << "count=" << count << ", ";
+  os << "total_ms=" << total_ms << ", ";
+  os << "mean_ms=" << mean_ms << ", ";
+  os << "p50_ms=" << p50_ms << ", ";
+  os << "p99_ms=" << p99_ms << ", ";
+  os << "max_ms=" << max_ms << ")";
+  return os.str();
+}
+
+void LatencyStats::Add(Stage stage, double ms) {
+  ms = std::max(ms, 0.0);
+
+  int32_t b = 0;
+  if (ms > kMinMs) {
+    b = static_cast<int32_t>(std::log(ms / kMinMs) / std::log(kRatio));
+    b = std::min(b, kNumBuckets - 1);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto &h = histograms_[static_cast<int32_t>(stage)];
+  h.count += 1;
+  h.total_ms += ms;
+  h.max_ms = std::max(h.max_ms, ms);
+  h.buckets[b] += 1;
+}
+
+StageSummary LatencyStats::Summary(Stage stage) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto &h = histograms_[static_cast<int32_t>(stage)];
+
+  StageSummary ans;
+  ans.count = h.count;
+  if (h.count == 0) {
+    return ans;
+  }
+
+  ans.total_ms = h.total_ms;
+  ans.mean_ms = h.total_ms / h.count;
+  ans.max_ms = h.max_ms;
+
+  // Return the upper edge of the bucket containing the q-th quantile
+  auto quantile = [&h](double q) -> double {
+    int64_t target = static_cast<int64_t>(std::ceil(q * h.count));
+    target = std::max<int64_t>(target, 1);
+
+    int64_t acc = 0;
+    for (int32_t i = 0; i != kNumBuckets; ++i) {
+      acc += h.buckets[i];
+      if (acc >= target) {
+        return std::min(kMinMs * std::pow(kRatio, i + 1), h.max_ms);
+      }
+    }
+    return h.max_ms;
+  };
+
+  ans.p50_ms = quantile(0.5);
+  ans.p99_ms = quantile(0.99);
+
+  return ans;
+}
+
+void LatencyStats::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto &h : histograms_) {
+    h = Histogram{};
+  }
+}
+
+std::string LatencyStats::ToString() const {
+  std::ostringstream os;
+  os << "LatencyStats(";
+  std::string sep;
+  for (int32_t i = 0; i != kNumStages; ++i) {
+    auto stage = static_cast<Stage>(i);
+    StageSummary summary = Summary(stage);
+    if (summary.count == 0) {
+      continue;
+    }
+
+    os << sep << GetStageName(stage) << "=" << summary.ToString();
+    sep = ", ";
+  }
+  os << ")";
+  return os.str();
+}
+
+ProfileScope::ProfileScope(LatencyStats *stream_stats,
+                           LatencyStats *recognizer_stats)
+    : stream_stats_(stream_stats),
+      recognizer_stats_(recognizer_stats),
+      active_(stream_stats || recognizer_stats || Metrics::Enabled()) {
+  if (active_) {
+    prev_ = current_scope;
+    current_scope = this;
+  }
+}
+
+ProfileScope::~ProfileScope() {
+  if (!active_) {
+    return;
+  }
+
+  current_scope = prev_;
+
+  for (int32_t i = 0; i != kNumStages; ++i) {
+    if (!used_[i]) continue;
+
+    auto stage = static_cast<Stage>(i);
+    if (stream_stats_) {
+      stream_stats_->Add(stage, totals_[i]);
+    }
+
+    if (recognizer_stats_) {
+      recognizer_stats_->Add(stage, totals_[i]);
+    }
+
+    Metrics::ObserveStage(stage, totals_[i] / 1000);
+  }
+}
+
+ProfileScope *ProfileScope::Current() { return current_scope; }
+
+void ProfileScope::Add(Stage stage, double ms) {
+  int32_t i = static_cast<int32_t>(stage);
+  totals_[i] += ms;
+  used_[i] = true;
+}
+
+ScopedStageTimer::ScopedStageTimer(Stage stage)
+    : stage_(stage),
+      scope_(ProfileScope::Current()),
+      trace_(Tracer::Enabled()) {
+  if (scope_ || trace_) {
+    start_ = StageClock::now();
+  }
+}
+
+ScopedStageTimer::~ScopedStageTimer() {
+  if (!scope_ && !trace_) {
+    return;
+  }
+
+  auto end = StageClock::now();
+  if (scope_) {
+    scope_->Add(stage_, std::chrono::duration<double, std::milli>(end - start_)
+                            .count());
+  }
+
+  if (trace_) {
+    Tracer::AddSpan(GetStageName(stage_), start_, end,
+                    TraceStreamScope::Current());
+  }
+}
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,159 @@
+// sherpa-ncnn/csrc/latency-stats.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_LATENCY_STATS_H_
+#define SHERPA_NCNN_CSRC_LATENCY_STATS_H_
+
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <mutex>  // NOLINT
+#include <string>
+
+namespace sherpa_ncnn {
+
+// Stages of streaming recognition and of text-to-speech whose wall time
+// is recorded
+enum class Stage : int32_t {
+  // Stream::AcceptWaveform() and Stream::GetFrames()
+  kFeatureExtraction = 0,
+  // The encoder network
+  kEncoder = 1,
+  // The decoder network
+  kDecoder = 2,
+  // The joiner network
+  kJoiner = 3,
+  // Decoding excluding the decoder and joiner networks, e.g., top-k and
+  // hypothesis bookkeeping in beam search
+  kSearch = 4,
+
+  // The text front-end of TTS: text normalization and the lexicon
+  kTtsFrontEnd = 5,
+  // The text encoder of VITS
+  kTtsEncoder = 6,
+  // The stochastic duration predictor of VITS, including its noise
+  kTtsDurationPredictor = 7,
+  // Expanding the encoder output by the durations, see
+  // OfflineTtsVitsModel::PathAttention()
+  kTtsPathAttention = 8,
+  // The flow of VITS
+  kTtsFlow = 9,
+  // The decoder of VITS, which generates the audio samples
+  kTtsVocoder = 10,
+};
+
+constexpr int32_t kNumStages = 11;
+
+// Return a name such as "encoder" for the given stage
+const char *GetStageName(Stage stage);
+
+struct StageSummary {
+  // Number of samples. A sample is the time of a stage for one call of
+  // Stream::AcceptWaveform() or for one chunk of a stream
+  int64_t count = 0;
+
+  double total_ms = 0;
+  double mean_ms = 0;
+
+  // The percentiles are estimated from a histogram whose buckets are
+  // about 19% wide
+  double p50_ms = 0;
+  double p99_ms = 0;
+
+  double max_ms = 0;
+
+  std::string ToString() const;
+};
+
+// Latency statistics of each stage. It is thread-safe.
+class LatencyStats {
+ public:
+  void Add(Stage stage, double ms);
+
+  StageSummary Summary(Stage stage) const;
+
+  void Reset();
+
+  // Stages without samples are skipped
+  std::string ToString() const;
+
+ private:
+  static constexpr int32_t kNumBuckets = 128;
+
+  struct Histogram {
+    int64_t count = 0;
+    double total_ms = 0;
+    double max_ms = 0;
+    int64_t buckets[kNumBuckets] = {};
+  };
+
+  mutable std::mutex mutex_;
+  Histogram histograms_[kNumStages];
+};
+
+using StageClock = std::chrono::steady_clock;
+
+// Return the number of milliseconds since start
+inline double ElapsedMs(StageClock::time_point start) {
+  return std::chrono::duration<double, std::milli>(StageClock::now() - start)
+      .count();
+}
+
+// The decoder and joiner networks are run from inside the decoders, which
+// don't know which stream they decode. A ProfileScope collects the time of
+// each stage on the current thread while it is alive, e.g., while a
+// stream is decoded, and adds it as one sample per stage to the given
+// stats on destruction. The samples are also added to Metrics if it is
+// enabled.
+//
+// If both stats are null and Metrics is disabled, it does nothing.
+class ProfileScope {
+ public:
+  ProfileScope(LatencyStats *stream_stats, LatencyStats *recognizer_stats);
+  ~ProfileScope();
+
+  ProfileScope(const ProfileScope &) = delete;
+  ProfileScope &operator=(const ProfileScope &) = delete;
+
+  // Return the innermost active scope of the current thread, or nullptr
+  static ProfileScope *Current();
+
+  void Add(Stage stage, double ms);
+
+  // Time of the given stage in this scope so far
+  double Total(Stage stage) const {
+    return totals_[static_cast<int32_t>(stage)];
+  }
+
+ private:
+  LatencyStats *stream_stats_;
+  LatencyStats *recognizer_stats_;
+  bool active_;
+  ProfileScope *prev_ = nullptr;
+
+  double totals_[kNumStages] = {};
+  bool used_[kNumStages] = {};
+};
+
+// Add the lifetime of this object to the given stage of the current
+// ProfileScope. If the tracer is enabled, it is also recorded as a span,
+// see Tracer. It does nothing if there is no active scope and the tracer
+// is disabled.
+class ScopedStageTimer {
+ public:
+  explicit ScopedStageTimer(Stage stage);
+  ~ScopedStageTimer();
+
+  ScopedStageTimer(const ScopedStageTimer &) = delete;
+  ScopedStageTimer &operator=(const ScopedStageTimer &) = delete;
+
+ private:
+  Stage stage_;
+  ProfileScope *scope_;
+  bool trace_;
+  StageClock::time_point start_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_LATENCY_STATS_H_
@@ -4,17 +4,57 @@
 
 #include "sherpa-ncnn/csrc/lexicon.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
 #include <memory>
 #include <sstream>
+#include <string_view>
 #include <unordered_map>
 #include <utility>
 
 #include "sherpa-ncnn/csrc/file-utils.h"
 #include "sherpa-ncnn/csrc/macros.h"
+#include "sherpa-ncnn/csrc/mapped-file.h"
+#include "sherpa-ncnn/csrc/startup-stats.h"
 #include "sherpa-ncnn/csrc/text-utils.h"
 
 namespace sherpa_ncnn {
 
+static constexpr char kMagic[8] = {'S', 'N', 'C', 'N', 'N', 'L', 'X', '1'};
+
+namespace {
+
+struct Header {
+  char magic[8];
+  int32_t num_nodes;
+  int32_t num_ids;
+  int32_t num_words;
+
+  // Number of tokens of the model that it is compiled for
+  int32_t vocab_size;
+};
+
+struct Node {
+  // Children are [first_child, next node's first_child)
+  uint32_t first_child;
+
+  // The token IDs of the word that ends at this node are
+  // [ids_begin, next node's ids_begin). They are empty if no word ends here.
+  uint32_t ids_begin;
+
+  // The character of the arc from the parent, see PackChar()
+  uint32_t label;
+};
+
+template <typename T>
+void Append(const T *p, std::size_t n, std::string *out) {
+  out->append(reinterpret_cast<const char *>(p), n * sizeof(T));
+}
+
+}  // namespace
+
 static std::vector<int32_t> ConvertTokensToIds(
     const std::unordered_map<std::string, int32_t> &token2id,
     const std::vector<std::string> &tokens) {
@@ -32,33 +72,206 @@ static std::vector<int32_t> ConvertTokensToIds(
   return ids;
 }
 
+// Number of bytes of the UTF-8 character that starts with byte c. An
+// invalid byte is treated as a character of its own.
+static int32_t Utf8CharLength(uint8_t c) {
+  if (c < 0x80) return 1;
+  if ((c & 0xe0) == 0xc0) return 2;
+  if ((c & 0xf0) == 0xe0) return 3;
+  if ((c & 0xf8) == 0xf0) return 4;
+  return 1;
+}
+
+// The UTF-8 character [p, p + n), where 1 <= n <= 4, as an integer
+static uint32_t PackChar(const char *p, int32_t n) {
+  uint32_t c = 0;
+  for (int32_t i = 0; i != n; ++i) {
+    c = (c << 8) | static_cast<uint8_t>(p[i]);
+  }
+
+  return c;
+}
+
 class Lexicon::Impl {
  public:
   explicit Impl(const std::string &lexicon,
                 const std::unordered_map<std::string, int32_t> &token2id)
       : token2id_(token2id) {
+    ScopedStartupTimer timer(StartupPhase::kLexicon);
+
+    mapped_ = MappedFile::Open(lexicon);
+    if (mapped_ && mapped_->Size() >= sizeof(kMagic) &&
+        std::memcmp(mapped_->Data(), kMagic, sizeof(kMagic)) == 0) {
+      InitCompiled(mapped_->Data(), mapped_->Size(), lexicon.c_str());
+      return;
+    }
+
+    // Not compiled. Assume it is a text file.
+    mapped_.reset();
     std::ifstream is(lexicon);
     Init(is);
   }
 
+  Impl(std::istream &is,
+       const std::unordered_map<std::string, int32_t> &token2id)
+      : token2id_(token2id) {
+    ScopedStartupTimer timer(StartupPhase::kLexicon);
+    Init(is);
+  }
+
+  Impl(const unsigned char *data, std::size_t size,
+       const std::unordered_map<std::string, int32_t> &token2id)
+      : token2id_(token2id) {
+    ScopedStartupTimer timer(StartupPhase::kLexicon);
+
+    // A buffer from the user may not be aligned
+    if (reinterpret_cast<uintptr_t>(data) % alignof(Node) != 0) {
+      buffer_.assign(reinterpret_cast<const char *>(data), size);
+      data = reinterpret_cast<const unsigned char *>(buffer_.data());
+    }
+
+    InitCompiled(data, size, "The lexicon in memory");
+  }
+
+  // Return the compiled form of the words of a text lexicon
+  std::string ToCompiled() const {
+    int32_t num_nodes = static_cast<int32_t>(node_ids_.size());
+
+    // (character, child) pairs of each node
+    std::vector<std::vector<std::pair<uint32_t, int32_t>>> children(
+        num_nodes);
+    for (const auto &p : arcs_) {
+      children[p.first >> 32].emplace_back(static_cast<uint32_t>(p.first),
+                                           p.second);
+    }
+
+    // order[i] is the node that is numbered i in breadth-first order
+    std::vector<int32_t> order = {0};
+    std::vector<uint32_t> labels = {0};
+    std::vector<Node> nodes(num_nodes + 1);
+    std::vector<int32_t> ids;
+
+    for (int32_t i = 0; i != static_cast<int32_t>(order.size()); ++i) {
+      int32_t node = order[i];
+      nodes[i].first_child = order.size();
+      nodes[i].ids_begin = ids.size();
+      nodes[i].label = labels[i];
+
+      if (node_ids_[node]) {
+        ids.insert(ids.end(), node_ids_[node]->begin(),
+                   node_ids_[node]->end());
+      }
+
+      auto &c = children[node];
+      std::sort(c.begin(), c.end());
+      for (const auto &p : c) {
+        order.push_back(p.second);
+        labels.push_back(p.first);
+      }
+    }
+
+    nodes[num_nodes].first_child = num_nodes;
+    nodes[num_nodes].ids_begin = ids.size();
+
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.num_nodes = num_nodes;
+    header.num_ids = static_cast<int32_t>(ids.size());
+    header.num_words = static_cast<int32_t>(word2token_ids_.size());
+    header.vocab_size = static_cast<int32_t>(token2id_.size());
+
+    std::string ans;
+    Append(&header, 1, &ans);
+    Append(nodes.data(), nodes.size(), &ans);
+    Append(ids.data(), ids.size(), &ans);
+
+    return ans;
+  }
+
   void TokenizeWord(const std::string &word,
                     std::vector<int32_t> *token_ids) const {
     token_ids->clear();
 
     auto w = ToLowerCase(word);
 
-    if (word2token_ids_.count(w)) {
-      *token_ids = word2token_ids_.at(w);
+    auto it = word2token_ids_.find(w);
+    if (it != word2token_ids_.end()) {
+      *token_ids = it->second;
+      return;
+    }
+
+    int32_t node = FindCompiled(w);
+    if (node != -1) {
+      CopyCompiledIds(node, token_ids);
     }
   }
 
   void AddWord(const std::string &word, const std::vector<int32_t> &token_ids) {
     auto w = ToLowerCase(word);
-    word2token_ids_[w] = token_ids;
+    auto &ids = word2token_ids_[w];
+    ids = token_ids;
+    AddToTrie(w, &ids);
   }
 
   bool Contains(const std::string &word) const {
-    return word2token_ids_.count(word) > 0;
+    return word2token_ids_.count(word) > 0 || FindCompiled(word) != -1;
+  }
+
+  int32_t LongestMatch(const std::vector<std::string_view> &words,
+                       int32_t start, int32_t max_num_words,
+                       std::vector<int32_t> *token_ids) const {
+    int32_t end = std::min<int32_t>(words.size(), start + max_num_words);
+
+    // Walk the trie of the text lexicon or added words and the compiled
+    // trie together. At the same length, the former takes precedence so
+    // that AddWord() overrides compiled words.
+    int32_t node = 0;
+    int32_t compiled_node = nodes_ ? 0 : -1;
+    int32_t ans = 0;
+    const std::vector<int32_t> *ids = nullptr;
+    int32_t ans_compiled_node = -1;
+
+    for (int32_t k = start; k < end; ++k) {
+      std::string_view w = words[k];
+      for (int32_t i = 0; i < static_cast<int32_t>(w.size());) {
+        if (node == -1 && compiled_node == -1) {
+          break;
+        }
+
+        int32_t n = std::min<int32_t>(Utf8CharLength(w[i]), w.size() - i);
+        uint32_t c = PackChar(w.data() + i, n);
+        if (node != -1) {
+          node = Next(node, c);
+        }
+
+        if (compiled_node != -1) {
+          compiled_node = NextCompiled(compiled_node, c);
+        }
+        i += n;
+      }
+
+      if (node == -1 && compiled_node == -1) {
+        break;
+      }
+
+      if (node != -1 && node_ids_[node]) {
+        ans = k - start + 1;
+        ids = node_ids_[node];
+        ans_compiled_node = -1;
+      } else if (compiled_node != -1 && HasCompiledIds(compiled_node)) {
+        ans = k - start + 1;
+        ids = nullptr;
+        ans_compiled_node = compiled_node;
+      }
+    }
+
+    if (ids) {
+      *token_ids = *ids;
+    } else if (ans_compiled_node != -1) {
+      CopyCompiledIds(ans_compiled_node, token_ids);
+    }
+
+    return ans;
   }
 
  private:
@@ -92,13 +305,153 @@ class Lexicon::Impl {
         continue;
       }
 
-      word2token_ids_.insert({std::move(word), std::move(ids)});
+      auto it = word2token_ids_.insert({std::move(word), std::move(ids)}).first;
+      AddToTrie(it->first, &it->second);
+    }
+  }
+
+  // Check the compiled lexicon and set the pointers into it. Exit on
+  // error.
+  void InitCompiled(const unsigned char *data, std::size_t size,
+                    const char *name) {
+    static_assert(sizeof(Node) == 12, "The layout of the file changed");
+
+    if (!CheckCompiled(data, size)) {
+      SHERPA_NCNN_LOGE("%s is corrupted", name);
+      SHERPA_NCNN_EXIT(-1);
+    }
+
+    header_ = reinterpret_cast<const Header *>(data);
+    if (header_->vocab_size != static_cast<int32_t>(token2id_.size())) {
+      SHERPA_NCNN_LOGE(
+          "%s is compiled for %d tokens, but the model has %d tokens. "
+          "Please compile it again with the tokens of this model",
+          name, header_->vocab_size, static_cast<int32_t>(token2id_.size()));
+      SHERPA_NCNN_EXIT(-1);
+    }
+
+    nodes_ = reinterpret_cast<const Node *>(data + sizeof(Header));
+    ids_ = reinterpret_cast<const int32_t *>(
+        data + sizeof(Header) + (header_->num_nodes + 1) * sizeof(Node));
+  }
+
+  static bool CheckCompiled(const unsigned char *data, std::size_t size) {
+    if (size < sizeof(Header)) {
+      return false;
+    }
+
+    const auto *header = reinterpret_cast<const Header *>(data);
+    if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 ||
+        header->num_nodes < 1 || header->num_ids < 0) {
+      return false;
+    }
+
+    std::size_t expected = sizeof(Header) +
+                           (header->num_nodes + 1) * sizeof(Node) +
+                           header->num_ids * sizeof(int32_t);
+    if (size != expected) {
+      return false;
+    }
+
+    const auto *sentinel = reinterpret_cast<const Node *>(
+        data + sizeof(Header) + header->num_nodes * sizeof(Node));
+
+    return sentinel->first_child == static_cast<uint32_t>(header->num_nodes) &&
+           sentinel->ids_begin == static_cast<uint32_t>(header->num_ids);
+  }
+
+  // The key of the arc that leaves node with the character c
+  static uint64_t ArcKey(int32_t node, uint32_t c) {
+    return (static_cast<uint64_t>(node) << 32) | c;
+  }
+
+  // Return -1 if there is no such arc
+  int32_t Next(int32_t node, uint32_t c) const {
+    auto it = arcs_.find(ArcKey(node, c));
+    return it == arcs_.end() ? -1 : it->second;
+  }
+
+  // The same as Next() but for the compiled trie
+  int32_t NextCompiled(int32_t node, uint32_t c) const {
+    const Node *begin = nodes_ + nodes_[node].first_child;
+    const Node *end = nodes_ + nodes_[node + 1].first_child;
+    const Node *it =
+        std::lower_bound(begin, end, c, [](const Node &n, uint32_t label) {
+          return n.label < label;
+        });
+
+    return (it != end && it->label == c) ? static_cast<int32_t>(it - nodes_)
+                                         : -1;
+  }
+
+  bool HasCompiledIds(int32_t node) const {
+    return nodes_[node + 1].ids_begin > nodes_[node].ids_begin;
+  }
+
+  void CopyCompiledIds(int32_t node, std::vector<int32_t> *token_ids) const {
+    token_ids->assign(ids_ + nodes_[node].ids_begin,
+                      ids_ + nodes_[node + 1].ids_begin);
+  }
+
+  // Return the node of the compiled trie where word ends, or -1 if word is
+  // not a compiled word
+  int32_t FindCompiled(std::string_view word) const {
+    if (!nodes_) {
+      return -1;
+    }
+
+    int32_t node = 0;
+    for (int32_t i = 0; i < static_cast<int32_t>(word.size());) {
+      int32_t n =
+          std::min<int32_t>(Utf8CharLength(word[i]), word.size() - i);
+      node = NextCompiled(node, PackChar(word.data() + i, n));
+      if (node == -1) {
+        return -1;
+      }
+      i += n;
+    }
+
+    return HasCompiledIds(node) ? node : -1;
+  }
+
+  // Values of word2token_ids_ do not move when it grows, so the trie can
+  // point to them
+  void AddToTrie(const std::string &word, const std::vector<int32_t> *ids) {
+    int32_t node = 0;
+    for (int32_t i = 0; i < static_cast<int32_t>(word.size());) {
+      int32_t n = std::min<int32_t>(Utf8CharLength(word[i]), word.size() - i);
+      uint64_t key = ArcKey(node, PackChar(word.data() + i, n));
+
+      auto it = arcs_.find(key);
+      if (it == arcs_.end()) {
+        it = arcs_.emplace(key, static_cast<int32_t>(node_ids_.size())).first;
+        node_ids_.push_back(nullptr);
+      }
+
+      node = it->second;
+      i += n;
     }
+
+    node_ids_[node] = ids->empty() ? nullptr : ids;
   }
 
  private:
   std::unordered_map<std::string, std::vector<int32_t>> word2token_ids_;
   std::unordered_map<std::string, int32_t> token2id_;
+
+  // A trie of the words of word2token_ids_ with a UTF-8 character per arc.
+  // Node 0 is the root. node_ids_[i] points to the token IDs of the word
+  // that ends at node i, or is nullptr if no word ends there.
+  std::unordered_map<uint64_t, int32_t> arcs_;
+  std::vector<const std::vector<int32_t> *> node_ids_ = {nullptr};
+
+  // Set if the lexicon is compiled. Words from AddWord() are still added
+  // to the maps above.
+  std::unique_ptr<MappedFile> mapped_;  // nullptr if it is in memory
+  std::string buffer_;  // a copy of unaligned data in memory
+  const Header *header_ = nullptr;
+  const Node *nodes_ = nullptr;  // header_->num_nodes + 1, incl. a sentinel
+  const int32_t *ids_ = nullptr;  // header_->num_ids
 };
 
 Lexicon::~Lexicon() = default;
@@ -107,6 +460,41 @@ Lexicon::Lexicon(const std::string &lexicon,
                  const std::unordered_map<std::string, int32_t> &token2id)
     : impl_(std::make_unique<Impl>(lexicon, token2id)) {}
 
+Lexicon::Lexicon(std::istream &is,
+                 const std::unordered_map<std::string, int32_t> &token2id)
+    : impl_(std::make_unique<Impl>(is, token2id)) {}
+
+Lexicon::Lexicon(const unsigned char *data, std::size_t size,
+                 const std::unordered_map<std::string, int32_t> &token2id)
+    : impl_(std::make_unique<Impl>(data, size, token2id)) {}
+
+std::string Lexicon::Compile(
+    std::istream &is,
+    const std::unordered_map<std::string, int32_t> &token2id) {
+  return Impl(is, token2id).ToCompiled();
+}
+
+bool Lexicon::Compile(const std::string &lexicon,
+                      const std::unordered_map<std::string, int32_t> &token2id,
+                      const std::string &filename) {
+  std::ifstream is(lexicon);
+  if (!is) {
+    SHERPA_NCNN_LOGE("Failed to open %s", lexicon.c_str());
+    return false;
+  }
+
+  std::string buffer = Compile(is, token2id);
+
+  std::ofstream os(filename, std::ios::binary);
+  os.write(buffer.data(), buffer.size());
+  if (!os) {
+    SHERPA_NCNN_LOGE("Failed to write %s", filename.c_str());
+    return false;
+  }
+
+  return true;
+}
+
 void Lexicon::TokenizeWord(const std::string &word,
                            std::vector<int32_t> *token_ids) const {
   impl_->TokenizeWord(word, token_ids);
@@ -121,4 +509,10 @@ bool Lexicon::Contains(const std::string &word) const {
   return impl_->Contains(word);
 }
 
+int32_t Lexicon::LongestMatch(const std::vector<std::string_view> &words,
+                              int32_t start, int32_t max_num_words,
+                              std::vector<int32_t> *token_ids) const {
+  return impl_->LongestMatch(words, start, max_num_words, token_ids);
+}
+
 }  // namespace sherpa_ncnn
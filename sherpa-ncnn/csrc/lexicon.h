@@ -5,21 +5,70 @@
 #ifndef SHERPA_NCNN_CSRC_LEXICON_H_
 #define SHERPA_NCNN_CSRC_LEXICON_H_
 
+#include <cstddef>
 #include <cstdint>
+#include <istream>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
 namespace sherpa_ncnn {
 
+/** Map words to token IDs.
+ *
+ * A lexicon is either a text file with a word and its tokens per line, or
+ * the output of Compile(), which is a trie of the words with a UTF-8
+ * character per arc:
+ *
+ *   - Nodes are numbered in breadth-first order and node 0 is the root, so
+ *     the children of consecutive nodes are contiguous. They are sorted by
+ *     character and found by binary search.
+ *   - The token IDs of all words are in one flat array. Each node takes 12
+ *     bytes and refers to the token IDs of the word that ends there.
+ *
+ * The compiled form is memory mapped and used in place, so constructing
+ * the lexicon does not parse or allocate per word, and processes that load
+ * the same file share its pages. It assumes a little endian host.
+ */
 class Lexicon {
  public:
   ~Lexicon();
 
+  /** @param lexicon  Path to a text lexicon or to a file written by
+   *                  Compile(). They are told apart by the content.
+   * @param token2id  Tokens of the model. A compiled lexicon must have been
+   *                  compiled with the same tokens.
+   */
   Lexicon(const std::string& lexicon,
           const std::unordered_map<std::string, int32_t>& token2id);
 
+  // Read a text lexicon from a stream instead of a file
+  Lexicon(std::istream& is,
+          const std::unordered_map<std::string, int32_t>& token2id);
+
+  // Use a compiled lexicon in memory, e.g., a section of a model bundle.
+  // It is not copied, so it must outlive this object.
+  Lexicon(const unsigned char* data, std::size_t size,
+          const std::unordered_map<std::string, int32_t>& token2id);
+
+  /** Compile the text lexicon read from is.
+   *
+   * @return Return the compiled lexicon.
+   */
+  static std::string Compile(
+      std::istream& is,
+      const std::unordered_map<std::string, int32_t>& token2id);
+
+  /** Compile a text lexicon into the form that the constructor maps.
+   *
+   * @return Return false on error.
+   */
+  static bool Compile(const std::string& lexicon,
+                      const std::unordered_map<std::string, int32_t>& token2id,
+                      const std::string& filename);
+
   void TokenizeWord(const std::string& word,
                     std::vector<int32_t>* token_ids) const;
 
@@ -28,6 +77,24 @@ class Lexicon {
 
   bool Contains(const std::string& word) const;
 
+  /** Find the longest sequence of words that is a word of the lexicon.
+   *
+   * @param words  E.g., the output of SplitUtf8View().
+   * @param start  The sequence starts at words[start].
+   * @param max_num_words  The sequence has at most this many words.
+   * @param token_ids  On return, the token IDs of the sequence if it is
+   *                   found.
+   *
+   * @return Return the number of words in the sequence, i.e., the sequence
+   *         is words[start], ..., words[start + ans - 1] concatenated. It
+   *         returns 0 if even words[start] is not in the lexicon.
+   *
+   * Unlike TokenizeWord(), words are matched as they are, like Contains().
+   */
+  int32_t LongestMatch(const std::vector<std::string_view>& words,
+                       int32_t start, int32_t max_num_words,
+                       std::vector<int32_t>* token_ids) const;
+
  private:
   class Impl;
   std::unique_ptr<Impl> impl_;
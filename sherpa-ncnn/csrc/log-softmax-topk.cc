@@ -0,0 +1,609 @@
+// sherpa-ncnn/csrc/log-softmax-topk.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/log-softmax-topk.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+
+#include "sherpa-ncnn/csrc/math.h"
+#include "sherpa-ncnn/csrc/simd.h"
+
+namespace sherpa_ncnn {
+
+namespace {
+
+// Constants for the exp() approximation from the Cephes library. It is
+// also used by ncnn, see ncnn/src/layer/arm/neon_mathfun.h
+constexpr float kExpHi = 88.3762626647949f;
+constexpr float kExpLo = -88.3762626647949f;
+constexpr float kLog2e = 1.44269504088896341f;
+constexpr float kExpC1 = 0.693359375f;
+constexpr float kExpC2 = -2.12194440e-4f;
+constexpr float kExpP0 = 1.9875691500E-4f;
+constexpr float kExpP1 = 1.3981999507E-3f;
+constexpr float kExpP2 = 8.3334519073E-3f;
+constexpr float kExpP3 = 4.1665795894E-2f;
+constexpr float kExpP4 = 1.6666665459E-1f;
+constexpr float kExpP5 = 5.0000001201E-1f;
+
+#if SHERPA_NCNN_NEON
+float HorizontalMax(float32x4_t v) {
+#if defined(__aarch64__)
+  return vmaxvq_f32(v);
+#else
+  float32x2_t m = vmax_f32(vget_low_f32(v), vget_high_f32(v));
+  m = vpmax_f32(m, m);
+  return vget_lane_f32(m, 0);
+#endif
+}
+
+float HorizontalSum(float32x4_t v) {
+#if defined(__aarch64__)
+  return vaddvq_f32(v);
+#else
+  float32x2_t s = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+  s = vpadd_f32(s, s);
+  return vget_lane_f32(s, 0);
+#endif
+}
+
+float32x4_t Exp(float32x4_t x) {
+  x = vminq_f32(x, vdupq_n_f32(kExpHi));
+  x = vmaxq_f32(x, vdupq_n_f32(kExpLo));
+
+  // n = floor(x * log2(e) + 0.5)
+  float32x4_t fx = vmlaq_f32(vdupq_n_f32(0.5f), x, vdupq_n_f32(kLog2e));
+  float32x4_t tmp = vcvtq_f32_s32(vcvtq_s32_f32(fx));
+  uint32x4_t mask = vcgtq_f32(tmp, fx);
+  fx = vsubq_f32(tmp, vreinterpretq_f32_u32(
+                          vandq_u32(mask, vreinterpretq_u32_f32(
+                                              vdupq_n_f32(1.0f)))));
+
+  x = vmlsq_f32(x, fx, vdupq_n_f32(kExpC1));
+  x = vmlsq_f32(x, fx, vdupq_n_f32(kExpC2));
+
+  float32x4_t z = vmulq_f32(x, x);
+  float32x4_t y = vdupq_n_f32(kExpP0);
+  y = vmlaq_f32(vdupq_n_f32(kExpP1), y, x);
+  y = vmlaq_f32(vdupq_n_f32(kExpP2), y, x);
+  y = vmlaq_f32(vdupq_n_f32(kExpP3), y, x);
+  y = vmlaq_f32(vdupq_n_f32(kExpP4), y, x);
+  y = vmlaq_f32(vdupq_n_f32(kExpP5), y, x);
+  y = vmlaq_f32(x, y, z);
+  y = vaddq_f32(y, vdupq_n_f32(1.0f));
+
+  int32x4_t n = vcvtq_s32_f32(fx);
+  n = vaddq_s32(n, vdupq_n_s32(127));
+  n = vshlq_n_s32(n, 23);
+  return vmulq_f32(y, vreinterpretq_f32_s32(n));
+}
+#elif SHERPA_NCNN_WASM_SIMD
+float HorizontalMax(v128_t v) {
+  float a = std::max(wasm_f32x4_extract_lane(v, 0),
+                     wasm_f32x4_extract_lane(v, 1));
+  float b = std::max(wasm_f32x4_extract_lane(v, 2),
+                     wasm_f32x4_extract_lane(v, 3));
+  return std::max(a, b);
+}
+
+float HorizontalSum(v128_t v) {
+  return (wasm_f32x4_extract_lane(v, 0) + wasm_f32x4_extract_lane(v, 1)) +
+         (wasm_f32x4_extract_lane(v, 2) + wasm_f32x4_extract_lane(v, 3));
+}
+
+v128_t Exp(v128_t x) {
+  x = wasm_f32x4_min(x, wasm_f32x4_splat(kExpHi));
+  x = wasm_f32x4_max(x, wasm_f32x4_splat(kExpLo));
+
+  v128_t fx = wasm_f32x4_add(wasm_f32x4_mul(x, wasm_f32x4_splat(kLog2e)),
+                             wasm_f32x4_splat(0.5f));
+  fx = wasm_f32x4_floor(fx);
+
+  x = wasm_f32x4_sub(x, wasm_f32x4_mul(fx, wasm_f32x4_splat(kExpC1)));
+  x = wasm_f32x4_sub(x, wasm_f32x4_mul(fx, wasm_f32x4_splat(kExpC2)));
+
+  v128_t z = wasm_f32x4_mul(x, x);
+  v128_t y = wasm_f32x4_splat(kExpP0);
+  y = wasm_f32x4_add(wasm_f32x4_mul(y, x), wasm_f32x4_splat(kExpP1));
+  y = wasm_f32x4_add(wasm_f32x4_mul(y, x), wasm_f32x4_splat(kExpP2));
+  y = wasm_f32x4_add(wasm_f32x4_mul(y, x), wasm_f32x4_splat(kExpP3));
+  y = wasm_f32x4_add(wasm_f32x4_mul(y, x), wasm_f32x4_splat(kExpP4));
+  y = wasm_f32x4_add(wasm_f32x4_mul(y, x), wasm_f32x4_splat(kExpP5));
+  y = wasm_f32x4_add(wasm_f32x4_mul(y, z), x);
+  y = wasm_f32x4_add(y, wasm_f32x4_splat(1.0f));
+
+  v128_t n = wasm_i32x4_trunc_sat_f32x4(fx);
+  n = wasm_i32x4_add(n, wasm_i32x4_splat(127));
+  n = wasm_i32x4_shl(n, 23);
+  return wasm_f32x4_mul(y, n);
+}
+#elif SHERPA_NCNN_SSE2
+float HorizontalMax(__m128 v) {
+  __m128 t = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+  t = _mm_max_ps(t, _mm_shuffle_ps(t, t, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtss_f32(t);
+}
+
+float HorizontalSum(__m128 v) {
+  __m128 t = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+  t = _mm_add_ps(t, _mm_shuffle_ps(t, t, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtss_f32(t);
+}
+
+__m128 Exp(__m128 x) {
+  x = _mm_min_ps(x, _mm_set1_ps(kExpHi));
+  x = _mm_max_ps(x, _mm_set1_ps(kExpLo));
+
+  __m128 fx =
+      _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(kLog2e)), _mm_set1_ps(0.5f));
+  __m128 tmp = _mm_cvtepi32_ps(_mm_cvttps_epi32(fx));
+  __m128 mask = _mm_and_ps(_mm_cmpgt_ps(tmp, fx), _mm_set1_ps(1.0f));
+  fx = _mm_sub_ps(tmp, mask);
+
+  x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(kExpC1)));
+  x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(kExpC2)));
+
+  __m128 z = _mm_mul_ps(x, x);
+  __m128 y = _mm_set1_ps(kExpP0);
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(kExpP1));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(kExpP2));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(kExpP3));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(kExpP4));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(kExpP5));
+  y = _mm_add_ps(_mm_mul_ps(y, z), x);
+  y = _mm_add_ps(y, _mm_set1_ps(1.0f));
+
+  __m128i n = _mm_cvttps_epi32(fx);
+  n = _mm_add_epi32(n, _mm_set1_epi32(127));
+  n = _mm_slli_epi32(n, 23);
+  return _mm_mul_ps(y, _mm_castsi128_ps(n));
+}
+
+#if SHERPA_NCNN_AVX2_KERNELS
+SHERPA_NCNN_TARGET_AVX2 float HorizontalMax(__m256 v) {
+  return HorizontalMax(
+      _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1)));
+}
+
+SHERPA_NCNN_TARGET_AVX2 float HorizontalSum(__m256 v) {
+  return HorizontalSum(
+      _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1)));
+}
+
+SHERPA_NCNN_TARGET_AVX2 __m256 Exp(__m256 x) {
+  x = _mm256_min_ps(x, _mm256_set1_ps(kExpHi));
+  x = _mm256_max_ps(x, _mm256_set1_ps(kExpLo));
+
+  __m256 fx = _mm256_floor_ps(
+      _mm256_fmadd_ps(x, _mm256_set1_ps(kLog2e), _mm256_set1_ps(0.5f)));
+
+  x = _mm256_fnmadd_ps(fx, _mm256_set1_ps(kExpC1), x);
+  x = _mm256_fnmadd_ps(fx, _mm256_set1_ps(kExpC2), x);
+
+  __m256 z = _mm256_mul_ps(x, x);
+  __m256 y = _mm256_set1_ps(kExpP0);
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(kExpP1));
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(kExpP2));
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(kExpP3));
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(kExpP4));
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(kExpP5));
+  y = _mm256_fmadd_ps(y, z, x);
+  y = _mm256_add_ps(y, _mm256_set1_ps(1.0f));
+
+  __m256i n = _mm256_cvttps_epi32(fx);
+  n = _mm256_add_epi32(n, _mm256_set1_epi32(127));
+  n = _mm256_slli_epi32(n, 23);
+  return _mm256_mul_ps(y, _mm256_castsi256_ps(n));
+}
+
+// The following two functions process whole blocks of 8 entries at the
+// start of p and return the number of entries processed
+
+// *m = max(p[0:i]) if i > 0
+SHERPA_NCNN_TARGET_AVX2 int32_t RowMaxAvx2(const float *p, int32_t n,
+                                           float *m) {
+  if (n < 8) {
+    return 0;
+  }
+
+  __m256 vm = _mm256_loadu_ps(p);
+  int32_t i = 8;
+  for (; i + 8 <= n; i += 8) {
+    vm = _mm256_max_ps(vm, _mm256_loadu_ps(p + i));
+  }
+  *m = HorizontalMax(vm);
+  return i;
+}
+
+// *sum = sum(exp(p[0:i] - m))
+SHERPA_NCNN_TARGET_AVX2 int32_t RowSumExpAvx2(const float *p, int32_t n,
+                                              float m, float *sum) {
+  __m256 vm = _mm256_set1_ps(m);
+  __m256 vsum = _mm256_setzero_ps();
+  int32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    vsum = _mm256_add_ps(vsum, Exp(_mm256_sub_ps(_mm256_loadu_ps(p + i), vm)));
+  }
+  *sum = HorizontalSum(vsum);
+  return i;
+}
+#endif
+#elif SHERPA_NCNN_RVV
+// The kernels use LMUL = 2 so that the temporaries of Exp() fit into the
+// 32 vector registers
+vfloat32m2_t Exp(vfloat32m2_t x, size_t vl) {
+  x = __riscv_vfmin_vf_f32m2(x, kExpHi, vl);
+  x = __riscv_vfmax_vf_f32m2(x, kExpLo, vl);
+
+  // fx = floor(x * log2(e) + 0.5)
+  vfloat32m2_t fx = __riscv_vfmacc_vf_f32m2(__riscv_vfmv_v_f_f32m2(0.5f, vl),
+                                            kLog2e, x, vl);
+  vfloat32m2_t tmp = __riscv_vfcvt_f_x_v_f32m2(
+      __riscv_vfcvt_rtz_x_f_v_i32m2(fx, vl), vl);
+  vbool16_t mask = __riscv_vmfgt_vv_f32m2_b16(tmp, fx, vl);
+  fx = __riscv_vfsub_vf_f32m2_mu(mask, tmp, tmp, 1.0f, vl);
+
+  x = __riscv_vfnmsac_vf_f32m2(x, kExpC1, fx, vl);
+  x = __riscv_vfnmsac_vf_f32m2(x, kExpC2, fx, vl);
+
+  vfloat32m2_t z = __riscv_vfmul_vv_f32m2(x, x, vl);
+  vfloat32m2_t y = __riscv_vfmv_v_f_f32m2(kExpP0, vl);
+  y = __riscv_vfadd_vf_f32m2(__riscv_vfmul_vv_f32m2(y, x, vl), kExpP1, vl);
+  y = __riscv_vfadd_vf_f32m2(__riscv_vfmul_vv_f32m2(y, x, vl), kExpP2, vl);
+  y = __riscv_vfadd_vf_f32m2(__riscv_vfmul_vv_f32m2(y, x, vl), kExpP3, vl);
+  y = __riscv_vfadd_vf_f32m2(__riscv_vfmul_vv_f32m2(y, x, vl), kExpP4, vl);
+  y = __riscv_vfadd_vf_f32m2(__riscv_vfmul_vv_f32m2(y, x, vl), kExpP5, vl);
+  y = __riscv_vfmacc_vv_f32m2(x, y, z, vl);
+  y = __riscv_vfadd_vf_f32m2(y, 1.0f, vl);
+
+  vint32m2_t n = __riscv_vfcvt_rtz_x_f_v_i32m2(fx, vl);
+  n = __riscv_vadd_vx_i32m2(n, 127, vl);
+  n = __riscv_vsll_vx_i32m2(n, 23, vl);
+  return __riscv_vfmul_vv_f32m2(y, __riscv_vreinterpret_v_i32m2_f32m2(n),
+                                vl);
+}
+#endif
+
+float RowMax(const float *p, int32_t n) {
+  float m = -std::numeric_limits<float>::infinity();
+  int32_t i = 0;
+#if SHERPA_NCNN_NEON
+  if (n >= 4) {
+    float32x4_t vm = vld1q_f32(p);
+    for (i = 4; i + 4 <= n; i += 4) {
+      vm = vmaxq_f32(vm, vld1q_f32(p + i));
+    }
+    m = HorizontalMax(vm);
+  }
+#elif SHERPA_NCNN_WASM_SIMD
+  if (n >= 4) {
+    v128_t vm = wasm_v128_load(p);
+    for (i = 4; i + 4 <= n; i += 4) {
+      vm = wasm_f32x4_max(vm, wasm_v128_load(p + i));
+    }
+    m = HorizontalMax(vm);
+  }
+#elif SHERPA_NCNN_SSE2
+#if SHERPA_NCNN_AVX2_KERNELS
+  if (CpuHasAvx2()) {
+    i = RowMaxAvx2(p, n, &m);
+  }
+#endif
+  if (i + 4 <= n) {
+    __m128 vm = _mm_loadu_ps(p + i);
+    for (i += 4; i + 4 <= n; i += 4) {
+      vm = _mm_max_ps(vm, _mm_loadu_ps(p + i));
+    }
+    m = std::max(m, HorizontalMax(vm));
+  }
+#elif SHERPA_NCNN_RVV
+  if (n > 0) {
+    // The lanes past the last vl keep their value due to the _tu policy
+    size_t vlmax = __riscv_vsetvlmax_e32m2();
+    vfloat32m2_t vm = __riscv_vfmv_v_f_f32m2(m, vlmax);
+    for (size_t vl; i < n; i += static_cast<int32_t>(vl)) {
+      vl = __riscv_vsetvl_e32m2(n - i);
+      vm = __riscv_vfmax_vv_f32m2_tu(vm, vm, __riscv_vle32_v_f32m2(p + i, vl),
+                                     vl);
+    }
+    m = __riscv_vfmv_f_s_f32m1_f32(__riscv_vfredmax_vs_f32m2_f32m1(
+        vm, __riscv_vfmv_s_f_f32m1(m, 1), vlmax));
+  }
+#endif
+  for (; i < n; ++i) {
+    m = std::max(m, p[i]);
+  }
+  return m;
+}
+
+// Return sum(exp(p[i] - m))
+float RowSumExp(const float *p, int32_t n, float m) {
+  float sum = 0;
+  int32_t i = 0;
+#if SHERPA_NCNN_NEON
+  float32x4_t vm = vdupq_n_f32(m);
+  float32x4_t vsum = vdupq_n_f32(0);
+  for (; i + 4 <= n; i += 4) {
+    vsum = vaddq_f32(vsum, Exp(vsubq_f32(vld1q_f32(p + i), vm)));
+  }
+  sum = HorizontalSum(vsum);
+#elif SHERPA_NCNN_WASM_SIMD
+  v128_t vm = wasm_f32x4_splat(m);
+  v128_t vsum = wasm_f32x4_splat(0);
+  for (; i + 4 <= n; i += 4) {
+    vsum = wasm_f32x4_add(vsum, Exp(wasm_f32x4_sub(wasm_v128_load(p + i), vm)));
+  }
+  sum = HorizontalSum(vsum);
+#elif SHERPA_NCNN_SSE2
+#if SHERPA_NCNN_AVX2_KERNELS
+  if (CpuHasAvx2()) {
+    i = RowSumExpAvx2(p, n, m, &sum);
+  }
+#endif
+  __m128 vm = _mm_set1_ps(m);
+  __m128 vsum = _mm_setzero_ps();
+  for (; i + 4 <= n; i += 4) {
+    vsum = _mm_add_ps(vsum, Exp(_mm_sub_ps(_mm_loadu_ps(p + i), vm)));
+  }
+  sum += HorizontalSum(vsum);
+#elif SHERPA_NCNN_RVV
+  size_t vlmax = __riscv_vsetvlmax_e32m2();
+  vfloat32m2_t vsum = __riscv_vfmv_v_f_f32m2(0, vlmax);
+  for (size_t vl; i < n; i += static_cast<int32_t>(vl)) {
+    vl = __riscv_vsetvl_e32m2(n - i);
+    vfloat32m2_t x =
+        __riscv_vfsub_vf_f32m2(__riscv_vle32_v_f32m2(p + i, vl), m, vl);
+    vsum = __riscv_vfadd_vv_f32m2_tu(vsum, vsum, Exp(x, vl), vl);
+  }
+  sum = __riscv_vfmv_f_s_f32m1_f32(__riscv_vfredusum_vs_f32m2_f32m1(
+      vsum, __riscv_vfmv_s_f_f32m1(0, 1), vlmax));
+#endif
+  for (; i < n; ++i) {
+    sum += std::exp(p[i] - m);
+  }
+  return sum;
+}
+
+// Return true if any of p[0], p[1], p[2], p[3] is greater than threshold
+inline bool AnyGreater4(const float *p, float threshold) {
+#if SHERPA_NCNN_NEON
+  uint32x4_t c = vcgtq_f32(vld1q_f32(p), vdupq_n_f32(threshold));
+#if defined(__aarch64__)
+  return vmaxvq_u32(c) != 0;
+#else
+  uint32x2_t t = vorr_u32(vget_low_u32(c), vget_high_u32(c));
+  return (vget_lane_u32(t, 0) | vget_lane_u32(t, 1)) != 0;
+#endif
+#elif SHERPA_NCNN_WASM_SIMD
+  return wasm_v128_any_true(
+      wasm_f32x4_gt(wasm_v128_load(p), wasm_f32x4_splat(threshold)));
+#elif SHERPA_NCNN_SSE2
+  return _mm_movemask_ps(
+             _mm_cmpgt_ps(_mm_loadu_ps(p), _mm_set1_ps(threshold))) != 0;
+#elif SHERPA_NCNN_RVV
+  vbool32_t c = __riscv_vmfgt_vf_f32m1_b32(__riscv_vle32_v_f32m1(p, 4),
+                                           threshold, 4);
+  return __riscv_vfirst_m_b32(c, 4) >= 0;
+#else
+  return p[0] > threshold || p[1] > threshold || p[2] > threshold ||
+         p[3] > threshold;
+#endif
+}
+
+// A min-heap of (value, index) pairs stored in two caller provided arrays.
+// The smallest value is at position 0.
+class BoundedMinHeap {
+ public:
+  BoundedMinHeap(int32_t capacity, float *value, int32_t *index)
+      : capacity_(capacity), value_(value), index_(index) {}
+
+  bool Full() const { return size_ == capacity_; }
+
+  int32_t Size() const { return size_; }
+
+  // Only new values greater than it can change the heap once it is full
+  float Threshold() const {
+    return Full() ? value_[0] : -std::numeric_limits<float>::infinity();
+  }
+
+  void Push(float v, int32_t idx) {
+    if (!Full()) {
+      int32_t i = size_++;
+      while (i > 0) {
+        int32_t parent = (i - 1) / 2;
+        if (!Less(v, idx, value_[parent], index_[parent])) break;
+        value_[i] = value_[parent];
+        index_[i] = index_[parent];
+        i = parent;
+      }
+      value_[i] = v;
+      index_[i] = idx;
+      return;
+    }
+
+    if (!Less(value_[0], index_[0], v, idx)) return;
+
+    // replace the root and sift down
+    int32_t i = 0;
+    while (true) {
+      int32_t child = 2 * i + 1;
+      if (child >= size_) break;
+      if (child + 1 < size_ &&
+          Less(value_[child + 1], index_[child + 1], value_[child],
+               index_[child])) {
+        ++child;
+      }
+      if (!Less(value_[child], index_[child], v, idx)) break;
+      value_[i] = value_[child];
+      index_[i] = index_[child];
+      i = child;
+    }
+    value_[i] = v;
+    index_[i] = idx;
+  }
+
+  // Sort the entries by value in descending order. Ties are broken by
+  // preferring the smaller index. The heap is empty afterwards.
+  void SortDescending() {
+    for (int32_t last = size_ - 1; last > 0; --last) {
+      std::swap(value_[0], value_[last]);
+      std::swap(index_[0], index_[last]);
+      size_ = last;
+      SiftDown();
+    }
+    size_ = 0;
+  }
+
+ private:
+  // Return true if (a, ia) should be ranked below (b, ib)
+  static bool Less(float a, int32_t ia, float b, int32_t ib) {
+    return a < b || (a == b && ia > ib);
+  }
+
+  void SiftDown() {
+    int32_t i = 0;
+    float v = value_[0];
+    int32_t idx = index_[0];
+    while (true) {
+      int32_t child = 2 * i + 1;
+      if (child >= size_) break;
+      if (child + 1 < size_ &&
+          Less(value_[child + 1], index_[child + 1], value_[child],
+               index_[child])) {
+        ++child;
+      }
+      if (!Less(value_[child], index_[child], v, idx)) break;
+      value_[i] = value_[child];
+      index_[i] = index_[child];
+      i = child;
+    }
+    value_[i] = v;
+    index_[i] = idx;
+  }
+
+ private:
+  int32_t capacity_;
+  int32_t size_ = 0;
+  float *value_;
+  int32_t *index_;
+};
+
+// Push column j of a row unless it is boosted. *col points to the first
+// boosted column of the row that is not less than the previous j.
+inline void PushUnboosted(float v, int32_t base, int32_t j,
+                          const int32_t **col, const int32_t *col_end,
+                          BoundedMinHeap *heap) {
+  while (*col != col_end && **col < j) {
+    ++*col;
+  }
+
+  if (*col != col_end && **col == j) {
+    return;
+  }
+
+  heap->Push(v, base + j);
+}
+
+}  // namespace
+
+int32_t LogSoftmaxTopk(const float *in, int32_t num_rows, int32_t num_cols,
+                       const float *prior, int32_t k, int32_t *out_index,
+                       float *out_value) {
+  return LogSoftmaxTopk(in, num_rows, num_cols, prior, nullptr, nullptr,
+                        nullptr, k, out_index, out_value);
+}
+
+int32_t LogSoftmaxTopk(const float *in, int32_t num_rows, int32_t num_cols,
+                       const float *prior, const int32_t *boost_begin,
+                       const int32_t *boost_col, const float *boost_value,
+                       int32_t k, int32_t *out_index, float *out_value) {
+  int64_t total = static_cast<int64_t>(num_rows) * num_cols;
+  k = static_cast<int32_t>(std::min<int64_t>(k, total));
+  if (k <= 0) {
+    return 0;
+  }
+
+  // If the caller does not need the values, we use a small buffer on the
+  // stack for the heap. Larger k is rare, so we fall back to the heap then.
+  constexpr int32_t kMaxStackK = 64;
+  float stack_value[kMaxStackK];
+  std::unique_ptr<float[]> heap_value;
+  float *value = out_value;
+  if (!value) {
+    if (k <= kMaxStackK) {
+      value = stack_value;
+    } else {
+      heap_value.reset(new float[k]);
+      value = heap_value.get();
+    }
+  }
+
+  BoundedMinHeap heap(k, value, out_index);
+
+  for (int32_t r = 0; r != num_rows; ++r) {
+    const float *p = in + static_cast<int64_t>(r) * num_cols;
+
+    float m = RowMax(p, num_cols);
+
+    // After log_softmax and adding prior, p[i] becomes p[i] - offset
+    float offset = m + std::log(RowSumExp(p, num_cols, m));
+    if (prior) {
+      offset -= prior[r];
+    }
+
+    int32_t base = r * num_cols;
+
+    // The boosted entries are pushed first and skipped below, so the
+    // checks against the threshold below hold for the remaining ones.
+    const int32_t *col = nullptr;
+    const int32_t *col_end = nullptr;
+    if (boost_begin) {
+      col = boost_col + boost_begin[r];
+      col_end = boost_col + boost_begin[r + 1];
+      for (int32_t b = boost_begin[r]; b != boost_begin[r + 1]; ++b) {
+        heap.Push(p[boost_col[b]] - offset + boost_value[b],
+                  base + boost_col[b]);
+      }
+    }
+
+    // No entry in this row can enter the heap
+    if (heap.Full() && m - offset <= heap.Threshold()) {
+      continue;
+    }
+
+    int32_t i = 0;
+    for (; i + 4 <= num_cols; i += 4) {
+      // Compare the raw input against the threshold shifted by offset so
+      // that most groups are rejected with a single comparison.
+      if (heap.Full() && !AnyGreater4(p + i, heap.Threshold() + offset)) {
+        continue;
+      }
+
+      for (int32_t j = i; j != i + 4; ++j) {
+        PushUnboosted(p[j] - offset, base, j, &col, col_end, &heap);
+      }
+    }
+
+    for (; i < num_cols; ++i) {
+      PushUnboosted(p[i] - offset, base, i, &col, col_end, &heap);
+    }
+  }
+
+  heap.SortDescending();
+
+  return k;
+}
+
+void LogSoftmax(float *input, int32_t input_len) {
+  float m = RowMax(input, input_len);
+  float offset = m + std::log(RowSumExp(input, input_len, m));
+  for (int32_t i = 0; i < input_len; ++i) {
+    input[i] -= offset;
+  }
+}
+
+}  // namespace sherpa_ncnn
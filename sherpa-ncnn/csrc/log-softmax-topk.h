@@ -0,0 +1,54 @@
+// sherpa-ncnn/csrc/log-softmax-topk.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_LOG_SOFTMAX_TOPK_H_
+#define SHERPA_NCNN_CSRC_LOG_SOFTMAX_TOPK_H_
+
+#include <cstdint>
+
+namespace sherpa_ncnn {
+
+/** Find the top-k entries of log_softmax(in[i]) + prior[i] over all rows.
+ *
+ * It is equivalent to calling LogSoftmax() for each row, adding prior[i] to
+ * row i, and calling TopkIndex() on the flattened result, but it neither
+ * modifies the input nor allocates memory.
+ *
+ * @param in  A 2-D array of shape (num_rows, num_cols) in row-major order.
+ * @param num_rows  Number of rows in `in`.
+ * @param num_cols  Number of columns in `in`.
+ * @param prior  An array of size num_rows. It is added to each row after
+ *               log_softmax. It can be nullptr, in which case 0 is used.
+ * @param k  Number of entries to find.
+ * @param out_index  On return, it contains min(k, num_rows * num_cols)
+ *                   indexes into the flattened array, sorted by value in
+ *                   descending order. Its size must be at least k.
+ * @param out_value  If not nullptr, on return, out_value[i] contains the
+ *                   value of out_index[i]. Its size must be at least k.
+ *
+ * @return Return the number of entries found, i.e.,
+ *         min(k, num_rows * num_cols).
+ */
+int32_t LogSoftmaxTopk(const float *in, int32_t num_rows, int32_t num_cols,
+                       const float *prior, int32_t k, int32_t *out_index,
+                       float *out_value);
+
+/** Same as above, but a few entries of each row are increased by a boost
+ * after log_softmax, e.g., the tokens that continue a hotword.
+ *
+ * @param boost_begin  An array of size num_rows + 1. The boosts of row r
+ *                     are entries [boost_begin[r], boost_begin[r + 1]) of
+ *                     boost_col and boost_value.
+ * @param boost_col  The column of each boost. Within a row, the columns are
+ *                   in increasing order and unique.
+ * @param boost_value  The value that is added to the entry of each boost.
+ */
+int32_t LogSoftmaxTopk(const float *in, int32_t num_rows, int32_t num_cols,
+                       const float *prior, const int32_t *boost_begin,
+                       const int32_t *boost_col, const float *boost_value,
+                       int32_t k, int32_t *out_index, float *out_value);
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_LOG_SOFTMAX_TOPK_H_
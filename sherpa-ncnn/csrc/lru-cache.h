@@ -0,0 +1,99 @@
+// sherpa-ncnn/csrc/lru-cache.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_LRU_CACHE_H_
+#define SHERPA_NCNN_CSRC_LRU_CACHE_H_
+
+#include <cstdint>
+#include <list>
+#include <mutex>  // NOLINT
+#include <unordered_map>
+#include <utility>
+
+namespace sherpa_ncnn {
+
+/** A thread-safe cache that keeps the capacity most recently used items.
+ *
+ * Hash is the hash function of Key. A capacity that is not positive
+ * disables the cache, i.e., Get() always misses and Put() does nothing.
+ */
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class LruCache {
+ public:
+  explicit LruCache(int32_t capacity) : capacity_(capacity) {}
+
+  LruCache(const LruCache &) = delete;
+  LruCache &operator=(const LruCache &) = delete;
+
+  int32_t Capacity() const { return capacity_; }
+
+  int32_t Size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return items_.size();
+  }
+
+  // If key is in the cache, copy its value to *value, mark it as the most
+  // recently used one and return true. Otherwise, return false.
+  bool Get(const Key &key, Value *value) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+      return false;
+    }
+
+    items_.splice(items_.begin(), items_, it->second);
+    *value = it->second->second;
+
+    return true;
+  }
+
+  // Insert or replace the value of key. The least recently used item is
+  // evicted if the cache is full.
+  void Put(const Key &key, Value value) const {
+    if (capacity_ <= 0) {
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+      it->second->second = std::move(value);
+      items_.splice(items_.begin(), items_, it->second);
+      return;
+    }
+
+    if (static_cast<int32_t>(items_.size()) >= capacity_) {
+      index_.erase(items_.back().first);
+      items_.pop_back();
+    }
+
+    items_.emplace_front(key, std::move(value));
+    index_.emplace(key, items_.begin());
+  }
+
+  void Clear() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    index_.clear();
+    items_.clear();
+  }
+
+ private:
+  using List = std::list<std::pair<Key, Value>>;
+
+  int32_t capacity_;
+
+  // Get() and Put() are const so that a cache can be used by const
+  // methods of its owner, e.g., OfflineTtsImpl::Generate()
+  mutable std::mutex mutex_;
+
+  // The most recently used item is at the front
+  mutable List items_;
+  mutable std::unordered_map<Key, typename List::iterator, Hash> index_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_LRU_CACHE_H_
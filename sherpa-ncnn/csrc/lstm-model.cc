@@ -17,6 +17,9 @@
  */
 #include "sherpa-ncnn/csrc/lstm-model.h"
 
+#include <algorithm>
+#include <atomic>
+#include <thread>  // NOLINT
 #include <utility>
 #include <vector>
 
@@ -25,26 +28,17 @@
 
 namespace sherpa_ncnn {
 
-LstmModel::LstmModel(const ModelConfig &config) {
+LstmModel::LstmModel(const ModelConfig &config,
+                     std::shared_ptr<const ModelBundle> bundle) {
   encoder_.opt = config.encoder_opt;
   decoder_.opt = config.decoder_opt;
   joiner_.opt = config.joiner_opt;
 
-  bool has_gpu = false;
-#if NCNN_VULKAN
-  has_gpu = ncnn::get_gpu_count() > 0;
-#endif
+  chunks_per_run_ = std::max(config.lstm_chunks_per_run, 1);
 
-  if (has_gpu && config.use_vulkan_compute) {
-    encoder_.opt.use_vulkan_compute = true;
-    decoder_.opt.use_vulkan_compute = true;
-    joiner_.opt.use_vulkan_compute = true;
-    NCNN_LOGE("Use GPU");
-  } else {
-    // NCNN_LOGE("Don't Use GPU. has_gpu: %d, config.use_vulkan_compute: %d",
-    //           static_cast<int32_t>(has_gpu),
-    //           static_cast<int32_t>(config.use_vulkan_compute));
-  }
+  InitDevices(config);
+
+  InitOptions(config, std::move(bundle));
 
   InitEncoder(config.encoder_param, config.encoder_bin);
   InitDecoder(config.decoder_param, config.decoder_bin);
@@ -61,21 +55,11 @@ LstmModel::LstmModel(AAssetManager *mgr, const ModelConfig &config) {
   decoder_.opt = config.decoder_opt;
   joiner_.opt = config.joiner_opt;
 
-  bool has_gpu = false;
-#if NCNN_VULKAN
-  has_gpu = ncnn::get_gpu_count() > 0;
-#endif
+  chunks_per_run_ = std::max(config.lstm_chunks_per_run, 1);
 
-  if (has_gpu && config.use_vulkan_compute) {
-    encoder_.opt.use_vulkan_compute = true;
-    decoder_.opt.use_vulkan_compute = true;
-    joiner_.opt.use_vulkan_compute = true;
-    NCNN_LOGE("Use GPU");
-  } else {
-    // NCNN_LOGE("Don't Use GPU. has_gpu: %d, config.use_vulkan_compute: %d",
-    //           static_cast<int32_t>(has_gpu),
-    //           static_cast<int32_t>(config.use_vulkan_compute));
-  }
+  InitDevices(config);
+
+  InitOptions(config);
 
   InitEncoder(mgr, config.encoder_param, config.encoder_bin);
   InitDecoder(mgr, config.decoder_param, config.decoder_bin);
@@ -90,6 +74,16 @@ LstmModel::LstmModel(AAssetManager *mgr, const ModelConfig &config) {
 std::pair<ncnn::Mat, std::vector<ncnn::Mat>> LstmModel::RunEncoder(
     ncnn::Mat &features, const std::vector<ncnn::Mat> &states,
     ncnn::Extractor *encoder_ex) {
+  std::vector<ncnn::Mat> next_states;
+  ncnn::Mat encoder_out =
+      RunEncoder(features, states, encoder_ex, &next_states);
+  return {encoder_out, next_states};
+}
+
+ncnn::Mat LstmModel::RunEncoder(ncnn::Mat &features,
+                                const std::vector<ncnn::Mat> &states,
+                                ncnn::Extractor *encoder_ex,
+                                std::vector<ncnn::Mat> *next_states) {
   ncnn::Mat hx;
   ncnn::Mat cx;
 
@@ -116,19 +110,66 @@ std::pair<ncnn::Mat, std::vector<ncnn::Mat>> LstmModel::RunEncoder(
   encoder_ex->extract(encoder_output_indexes_[1], hx);
   encoder_ex->extract(encoder_output_indexes_[2], cx);
 
-  std::vector<ncnn::Mat> next_states = {hx, cx};
+  // The states are kept in the stream, so they must not refer to the
+  // memory pool of the model
+  next_states->resize(2);
+  CopyTo(hx, &(*next_states)[0]);
+  CopyTo(cx, &(*next_states)[1]);
 
-  return {encoder_out, next_states};
+  return Detach(encoder_out);
 }
 
 std::pair<ncnn::Mat, std::vector<ncnn::Mat>> LstmModel::RunEncoder(
     ncnn::Mat &features, const std::vector<ncnn::Mat> &states) {
-  ncnn::Extractor encoder_ex = encoder_.create_extractor();
+  ncnn::Extractor encoder_ex = CreateExtractor(encoder_);
   return RunEncoder(features, states, &encoder_ex);
 }
 
+std::vector<ncnn::Mat> LstmModel::RunEncoderBatch(
+    std::vector<ncnn::Mat> &features,
+    const std::vector<const std::vector<ncnn::Mat> *> &states,
+    const std::vector<std::vector<ncnn::Mat> *> &next_states) {
+  int32_t n = static_cast<int32_t>(features.size());
+  int32_t num_threads = std::max(encoder_.opt.num_threads, 1);
+
+  if (encoder_.opt.use_vulkan_compute || n < 2 || num_threads < 2) {
+    return Model::RunEncoderBatch(features, states, next_states);
+  }
+
+  int32_t num_workers = std::min(n, num_threads);
+
+  // The threads of the encoder are shared among the workers
+  int32_t threads_per_worker = std::max(num_threads / num_workers, 1);
+
+  std::vector<ncnn::Mat> encoder_out(n);
+
+  std::atomic<int32_t> next{0};
+  auto run = [&]() {
+    int32_t i;
+    while ((i = next++) < n) {
+      ncnn::Extractor encoder_ex = CreateExtractor(encoder_);
+      encoder_ex.set_num_threads(threads_per_worker);
+      encoder_out[i] =
+          RunEncoder(features[i], *states[i], &encoder_ex, next_states[i]);
+    }
+  };
+
+  std::vector<std::thread> workers;
+  workers.reserve(num_workers - 1);
+  for (int32_t i = 1; i < num_workers; ++i) {
+    workers.emplace_back(run);
+  }
+  run();
+
+  for (auto &t : workers) {
+    t.join();
+  }
+
+  return encoder_out;
+}
+
 ncnn::Mat LstmModel::RunDecoder(ncnn::Mat &decoder_input) {
-  ncnn::Extractor decoder_ex = decoder_.create_extractor();
+  ncnn::Extractor decoder_ex = CreateExtractor(decoder_);
   return RunDecoder(decoder_input, &decoder_ex);
 }
 
@@ -137,13 +178,18 @@ ncnn::Mat LstmModel::RunDecoder(ncnn::Mat &decoder_input,
   ncnn::Mat decoder_out;
   decoder_ex->input(decoder_input_indexes_[0], decoder_input);
   decoder_ex->extract(decoder_output_indexes_[0], decoder_out);
-  decoder_out = decoder_out.reshape(decoder_out.w);
 
-  return decoder_out;
+  // decoder_out.h is 1 unless the contexts of several hypotheses are
+  // concatenated in decoder_input. See Model::RunDecoder2D()
+  if (decoder_out.h == 1) {
+    decoder_out = decoder_out.reshape(decoder_out.w);
+  }
+
+  return Detach(decoder_out);
 }
 
 ncnn::Mat LstmModel::RunJoiner(ncnn::Mat &encoder_out, ncnn::Mat &decoder_out) {
-  auto joiner_ex = joiner_.create_extractor();
+  auto joiner_ex = CreateExtractor(joiner_);
   return RunJoiner(encoder_out, decoder_out, &joiner_ex);
 }
 
@@ -157,22 +203,34 @@ ncnn::Mat LstmModel::RunJoiner(ncnn::Mat &encoder_out, ncnn::Mat &decoder_out,
   return joiner_out;
 }
 
+ncnn::Mat LstmModel::RunJoinerRaw(ncnn::Mat &encoder_out,
+                                  ncnn::Mat &decoder_out) {
+  auto joiner_ex = CreateExtractor(joiner_);
+  joiner_ex.input(joiner_input_indexes_[0], encoder_out);
+  joiner_ex.input(joiner_input_indexes_[1], decoder_out);
+
+  // type 1: keep the storage precision and the packing
+  ncnn::Mat joiner_out;
+  joiner_ex.extract(joiner_output_indexes_[0], joiner_out, 1);
+  return joiner_out;
+}
+
 void LstmModel::InitEncoder(const std::string &encoder_param,
                             const std::string &encoder_bin) {
   RegisterCustomLayers(encoder_);
-  InitNet(encoder_, encoder_param, encoder_bin);
+  LoadNet(encoder_, encoder_param, encoder_bin);
 
   InitEncoderPostProcessing();
 }
 
 void LstmModel::InitDecoder(const std::string &decoder_param,
                             const std::string &decoder_bin) {
-  InitNet(decoder_, decoder_param, decoder_bin);
+  LoadNet(decoder_, decoder_param, decoder_bin);
 }
 
 void LstmModel::InitJoiner(const std::string &joiner_param,
                            const std::string &joiner_bin) {
-  InitNet(joiner_, joiner_param, joiner_bin);
+  LoadNet(joiner_, joiner_param, joiner_bin);
 }
 
 #if __ANDROID_API__ >= 9
@@ -213,6 +271,8 @@ void LstmModel::InitEncoderPostProcessing() {
       break;
     }
   }
+
+  InitEncoderStateLayout();
 }
 
 std::vector<ncnn::Mat> LstmModel::GetEncoderInitStates() const {
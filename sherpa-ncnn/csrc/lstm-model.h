@@ -19,6 +19,7 @@
 #ifndef SHERPA_NCNN_CSRC_LSTM_MODEL_H_
 #define SHERPA_NCNN_CSRC_LSTM_MODEL_H_
 
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -30,7 +31,10 @@ namespace sherpa_ncnn {
 
 class LstmModel : public Model {
  public:
-  explicit LstmModel(const ModelConfig &config);
+  // If bundle is not nullptr, the .param and .bin fields of config are
+  // names of its sections
+  explicit LstmModel(const ModelConfig &config,
+                     std::shared_ptr<const ModelBundle> bundle = nullptr);
 #if __ANDROID_API__ >= 9
   LstmModel(AAssetManager *mgr, const ModelConfig &config);
 #endif
@@ -68,6 +72,22 @@ class LstmModel : public Model {
       ncnn::Mat &features, const std::vector<ncnn::Mat> &states,
       ncnn::Extractor *extractor) override;
 
+  ncnn::Mat RunEncoder(ncnn::Mat &features,
+                       const std::vector<ncnn::Mat> &states,
+                       ncnn::Extractor *extractor,
+                       std::vector<ncnn::Mat> *next_states) override;
+
+  using Model::RunEncoderBatch;
+
+  // On the CPU, the streams are run concurrently, each with its share of
+  // the threads of the encoder. The LSTM layers step through the frames
+  // one at a time, and a step of one stream is a matrix-vector product
+  // that is too small to keep all threads busy.
+  std::vector<ncnn::Mat> RunEncoderBatch(
+      std::vector<ncnn::Mat> &features,
+      const std::vector<const std::vector<ncnn::Mat> *> &states,
+      const std::vector<std::vector<ncnn::Mat> *> &next_states) override;
+
   ncnn::Mat RunDecoder(ncnn::Mat &decoder_input) override;
 
   ncnn::Mat RunDecoder(ncnn::Mat &decoder_input,
@@ -78,11 +98,15 @@ class LstmModel : public Model {
   ncnn::Mat RunJoiner(ncnn::Mat &encoder_out, ncnn::Mat &decoder_out,
                       ncnn::Extractor *extractor) override;
 
-  int32_t Segment() const override { return 9; }
+  ncnn::Mat RunJoinerRaw(ncnn::Mat &encoder_out,
+                         ncnn::Mat &decoder_out) override;
+
+  // See ModelConfig::lstm_chunks_per_run
+  int32_t Segment() const override { return 4 * chunks_per_run_ + 5; }
 
   // Advance the feature extract by this number of frames after
   // running the encoder network
-  int32_t Offset() const override { return 4; }
+  int32_t Offset() const override { return 4 * chunks_per_run_; }
 
  private:
   void InitEncoder(const std::string &encoder_param,
@@ -113,6 +137,8 @@ class LstmModel : public Model {
   int32_t encoder_dim_ = 512;        // arg2, i.e., d_model
   int32_t rnn_hidden_size_ = 1024;   // arg3
 
+  int32_t chunks_per_run_ = 1;
+
   ncnn::Net encoder_;
   ncnn::Net decoder_;
   ncnn::Net joiner_;
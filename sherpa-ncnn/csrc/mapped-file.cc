@@ -0,0 +1,160 @@
+// sherpa-ncnn/csrc/mapped-file.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/mapped-file.h"
+
+#include <fstream>
+#include <memory>
+#include <string>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "datareader.h"  // NOLINT
+#include "sherpa-ncnn/csrc/huge-pages.h"
+
+namespace sherpa_ncnn {
+
+#if defined(_WIN32)
+
+std::unique_ptr<MappedFile> MappedFile::Open(const std::string &filename) {
+  HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return nullptr;
+  }
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+    CloseHandle(file);
+    return nullptr;
+  }
+
+  // The mapping keeps the file open
+  HANDLE mapping =
+      CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (!mapping) {
+    return nullptr;
+  }
+
+  void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (!data) {
+    CloseHandle(mapping);
+    return nullptr;
+  }
+
+  std::unique_ptr<MappedFile> ans(new MappedFile);
+  ans->data_ = static_cast<const unsigned char *>(data);
+  ans->size_ = static_cast<std::size_t>(size.QuadPart);
+  ans->mapping_ = mapping;
+  return ans;
+}
+
+MappedFile::~MappedFile() {
+  if (huge_pages_) {
+    FreeHugePages(const_cast<unsigned char *>(data_), size_);
+    return;
+  }
+
+  UnmapViewOfFile(data_);
+  CloseHandle(mapping_);
+}
+
+#else
+
+std::unique_ptr<MappedFile> MappedFile::Open(const std::string &filename) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return nullptr;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) == -1 || st.st_size == 0) {
+    close(fd);
+    return nullptr;
+  }
+
+  // The mapping stays valid after the file is closed
+  void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return nullptr;
+  }
+
+  std::unique_ptr<MappedFile> ans(new MappedFile);
+  ans->data_ = static_cast<const unsigned char *>(data);
+  ans->size_ = st.st_size;
+  return ans;
+}
+
+MappedFile::~MappedFile() {
+  if (huge_pages_) {
+    FreeHugePages(const_cast<unsigned char *>(data_), size_);
+    return;
+  }
+
+  munmap(const_cast<unsigned char *>(data_), size_);
+}
+
+#endif
+
+std::unique_ptr<MappedFile> MappedFile::ReadIntoHugePages(
+    const std::string &filename) {
+  std::ifstream is(filename, std::ios::binary | std::ios::ate);
+  if (!is) {
+    return nullptr;
+  }
+
+  std::size_t size = is.tellg();
+  if (size == 0) {
+    return nullptr;
+  }
+
+  auto *data = static_cast<char *>(AllocateHugePages(size));
+  if (!data) {
+    return nullptr;
+  }
+
+  is.seekg(0);
+  if (!is.read(data, size)) {
+    FreeHugePages(data, size);
+    return nullptr;
+  }
+
+  std::unique_ptr<MappedFile> ans(new MappedFile);
+  ans->data_ = reinterpret_cast<const unsigned char *>(data);
+  ans->size_ = size;
+  ans->huge_pages_ = true;
+  return ans;
+}
+
+std::unique_ptr<MappedFile> LoadModelFromMappedFile(const std::string &bin,
+                                                    ncnn::Net *net,
+                                                    bool huge_pages) {
+  auto file = huge_pages ? MappedFile::ReadIntoHugePages(bin)
+                         : MappedFile::Open(bin);
+  if (!file) {
+    return nullptr;
+  }
+
+  // DataReaderFromMemory hands out pointers into the mapping, which ncnn uses
+  // as the data of the weight mats whenever possible
+  const unsigned char *p = file->Data();
+  ncnn::DataReaderFromMemory dr(p);
+  if (net->load_model(dr)) {
+    return nullptr;
+  }
+
+  return file;
+}
+
+}  // namespace sherpa_ncnn
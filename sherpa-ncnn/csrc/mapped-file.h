@@ -0,0 +1,83 @@
+// sherpa-ncnn/csrc/mapped-file.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_MAPPED_FILE_H_
+#define SHERPA_NCNN_CSRC_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "net.h"  // NOLINT
+
+namespace sherpa_ncnn {
+
+/** A read-only memory map of a whole file.
+ *
+ * The pages are backed by the page cache of the OS, so processes that map
+ * the same file share them. A file read with ReadIntoHugePages() is a
+ * private copy instead.
+ */
+class MappedFile {
+ public:
+  // Return nullptr if the file cannot be mapped, e.g., it does not exist
+  // or it is empty.
+  static std::unique_ptr<MappedFile> Open(const std::string &filename);
+
+  /** Read the whole file into memory from AllocateHugePages(), since pages
+   * of the page cache are huge only on some file systems.
+   *
+   * @return Return nullptr if the file cannot be read or it is empty.
+   */
+  static std::unique_ptr<MappedFile> ReadIntoHugePages(
+      const std::string &filename);
+
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  const unsigned char *Data() const { return data_; }
+
+  std::size_t Size() const { return size_; }
+
+ private:
+  MappedFile() = default;
+
+ private:
+  const unsigned char *data_ = nullptr;
+  std::size_t size_ = 0;
+
+  // True if data_ is from ReadIntoHugePages()
+  bool huge_pages_ = false;
+
+#if defined(_WIN32)
+  void *mapping_ = nullptr;
+#endif
+};
+
+/** Load the weights of net from a memory map of bin instead of copying the
+ * whole file into memory.
+ *
+ * Weights that ncnn can use as they are stay in the mapping; the others,
+ * e.g., fp16 or quantized ones, and the ones that a layer repacks when the
+ * net creates its pipelines, are still copied.
+ *
+ * @param bin  Path to a .ncnn.bin file. Unlike loading from a file, the
+ *             reader is not bounds-checked, so bin must match the param
+ *             of net.
+ * @param net  The net to load. Its param must have been loaded.
+ * @param huge_pages  If true, bin is read with
+ *                    MappedFile::ReadIntoHugePages() instead of mapped.
+ *
+ * @return Return the mapping, which must outlive net since net refers to
+ *         it. Return nullptr on error.
+ */
+std::unique_ptr<MappedFile> LoadModelFromMappedFile(const std::string &bin,
+                                                    ncnn::Net *net,
+                                                    bool huge_pages = false);
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_MAPPED_FILE_H_
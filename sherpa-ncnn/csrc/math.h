@@ -101,6 +101,10 @@ void LogSoftmax(T *input, int32_t input_len) {
   }
 }
 
+// A vectorized version of the above for float. It shares the kernels with
+// LogSoftmaxTopk() and is defined in log-softmax-topk.cc.
+void LogSoftmax(float *input, int32_t input_len);
+
 template <class T>
 std::vector<int32_t> TopkIndex(const T *vec, int32_t size, int32_t topk) {
   std::vector<int32_t> vec_index(size);
@@ -0,0 +1,449 @@
+// sherpa-ncnn/csrc/memory-pool.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/memory-pool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <unordered_map>
+
+#include "sherpa-ncnn/csrc/huge-pages.h"
+#include "sherpa-ncnn/csrc/macros.h"
+
+namespace sherpa_ncnn {
+
+MemoryPool::MemoryPool(bool thread_safe, std::size_t limit, bool huge_pages)
+    : thread_safe_(thread_safe), limit_(limit), huge_pages_(huge_pages) {}
+
+MemoryPool::~MemoryPool() {
+  for (const auto &p : free_) {
+    Release(p.second, p.first);
+  }
+
+  // Like ncnn::PoolAllocator, chunks still in use are leaked rather than
+  // freed under their users
+  if (!used_.empty()) {
+    SHERPA_NCNN_LOGE("%d chunks of a memory pool are still in use",
+                     static_cast<int32_t>(used_.size()));
+  }
+}
+
+void *MemoryPool::fastMalloc(size_t size) {
+  std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+  if (thread_safe_) {
+    lock.lock();
+  }
+
+  auto it = free_.lower_bound(size);
+  if (it != free_.end()) {
+    void *ptr = it->second;
+    used_.emplace(ptr, it->first);
+    free_.erase(it);
+    return ptr;
+  }
+
+  void *ptr = Allocate(size);
+  used_.emplace(ptr, size);
+
+  num_bytes_ += size;
+  if (num_bytes_ > high_water_mark_) {
+    high_water_mark_ = num_bytes_.load();
+  }
+
+  Trim();
+
+  return ptr;
+}
+
+void MemoryPool::fastFree(void *ptr) {
+  std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+  if (thread_safe_) {
+    lock.lock();
+  }
+
+  auto it = used_.find(ptr);
+  if (it == used_.end()) {
+    SHERPA_NCNN_LOGE("Freeing a chunk that is not from this memory pool");
+    ncnn::fastFree(ptr);
+    return;
+  }
+
+  std::size_t size = it->second;
+  used_.erase(it);
+
+  if (limit_ > 0 && num_bytes_ > limit_) {
+    Release(ptr, size);
+    num_bytes_ -= size;
+    return;
+  }
+
+  free_.emplace(size, ptr);
+}
+
+void MemoryPool::Trim() {
+  if (limit_ == 0) {
+    return;
+  }
+
+  while (num_bytes_ > limit_ && !free_.empty()) {
+    auto it = std::prev(free_.end());
+    Release(it->second, it->first);
+    num_bytes_ -= it->first;
+    free_.erase(it);
+  }
+}
+
+void *MemoryPool::Allocate(std::size_t size) const {
+  if (huge_pages_ && size >= kHugePageSize) {
+    void *ptr = AllocateHugePages(size);
+    if (!ptr) {
+      SHERPA_NCNN_LOGE("Failed to allocate %zu bytes", size);
+      SHERPA_NCNN_EXIT(-1);
+    }
+    return ptr;
+  }
+
+  return ncnn::fastMalloc(size);
+}
+
+void MemoryPool::Release(void *ptr, std::size_t size) const {
+  // The size decides the allocator, see Allocate()
+  if (huge_pages_ && size >= kHugePageSize) {
+    FreeHugePages(ptr, size);
+    return;
+  }
+
+  ncnn::fastFree(ptr);
+}
+
+// Alignment of the blocks of a MemoryArena. It is at least
+// NCNN_MALLOC_ALIGN of all platforms.
+static constexpr std::size_t kArenaAlignment = 64;
+
+static std::size_t RoundUp(std::size_t n, std::size_t m) {
+  return (n + m - 1) / m * m;
+}
+
+// It precedes each block of a MemoryArena. Blocks are contiguous, so the
+// next and the previous one are found by their sizes.
+struct MemoryArena::Header {
+  // Of this block, including the header
+  std::size_t size;
+
+  // Of the previous block. 0 for the first one.
+  std::size_t prev_size;
+
+  bool used;
+};
+
+// It keeps the blocks aligned
+static constexpr std::size_t kArenaHeaderSize = 64;
+
+MemoryArena::MemoryArena(std::size_t capacity, bool huge_pages /*= false*/)
+    : huge_pages_(huge_pages) {
+  owned_size_ = RoundUp(capacity, kArenaAlignment);
+  owned_ = huge_pages_ ? AllocateHugePages(owned_size_)
+                       : ncnn::fastMalloc(owned_size_);
+  if (!owned_) {
+    SHERPA_NCNN_LOGE("Failed to allocate %zu bytes", owned_size_);
+    SHERPA_NCNN_EXIT(-1);
+  }
+
+  Init(owned_, owned_size_);
+}
+
+MemoryArena::MemoryArena(void *buffer, std::size_t capacity) {
+  Init(buffer, capacity);
+}
+
+MemoryArena::~MemoryArena() {
+  // Unlike MemoryPool, blocks in use cannot be leaked since the memory of
+  // the arena goes away
+  if (num_bytes_ > 0) {
+    SHERPA_NCNN_LOGE("%zu bytes of a memory arena are still in use",
+                     num_bytes_.load());
+  }
+
+  if (!owned_) {
+    return;
+  }
+
+  if (huge_pages_) {
+    FreeHugePages(owned_, owned_size_);
+  } else {
+    ncnn::fastFree(owned_);
+  }
+}
+
+void MemoryArena::Init(void *buffer, std::size_t capacity) {
+  static_assert(sizeof(Header) <= kArenaHeaderSize, "");
+
+  auto addr = reinterpret_cast<std::uintptr_t>(buffer);
+  std::size_t skip = RoundUp(addr, kArenaAlignment) - addr;
+  if (capacity < skip + kArenaHeaderSize + kArenaAlignment) {
+    SHERPA_NCNN_LOGE("A memory arena of %zu bytes is too small", capacity);
+    return;
+  }
+
+  begin_ = static_cast<unsigned char *>(buffer) + skip;
+  capacity_ = (capacity - skip) / kArenaAlignment * kArenaAlignment;
+
+  auto *h = reinterpret_cast<Header *>(begin_);
+  h->size = capacity_;
+  h->prev_size = 0;
+  h->used = false;
+}
+
+MemoryArena::Header *MemoryArena::Next(Header *h) const {
+  auto *p = reinterpret_cast<unsigned char *>(h) + h->size;
+  return p < begin_ + capacity_ ? reinterpret_cast<Header *>(p) : nullptr;
+}
+
+MemoryArena::Header *MemoryArena::Prev(Header *h) const {
+  if (h->prev_size == 0) {
+    return nullptr;
+  }
+  return reinterpret_cast<Header *>(reinterpret_cast<unsigned char *>(h) -
+                                    h->prev_size);
+}
+
+void *MemoryArena::fastMalloc(size_t size) {
+  std::size_t need = kArenaHeaderSize +
+                     RoundUp(std::max<std::size_t>(size, 1), kArenaAlignment);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  Header *best = nullptr;
+  for (Header *h = capacity_ ? reinterpret_cast<Header *>(begin_) : nullptr;
+       h; h = Next(h)) {
+    if (!h->used && h->size >= need && (!best || h->size < best->size)) {
+      best = h;
+    }
+  }
+
+  if (!best) {
+    ++num_failures_;
+    SHERPA_NCNN_LOGE(
+        "A memory arena of %zu bytes has no room for %zu bytes. %zu bytes "
+        "are in use. Please use a larger arena",
+        capacity_, size, num_bytes_.load());
+    return nullptr;
+  }
+
+  // Split off the rest if it can hold a block
+  if (best->size - need >= kArenaHeaderSize + kArenaAlignment) {
+    auto *rest = reinterpret_cast<Header *>(
+        reinterpret_cast<unsigned char *>(best) + need);
+    rest->size = best->size - need;
+    rest->prev_size = need;
+    rest->used = false;
+
+    if (Header *next = Next(rest)) {
+      next->prev_size = rest->size;
+    }
+
+    best->size = need;
+  }
+
+  best->used = true;
+
+  num_bytes_ += best->size;
+  if (num_bytes_ > high_water_mark_) {
+    high_water_mark_ = num_bytes_.load();
+  }
+
+  return reinterpret_cast<unsigned char *>(best) + kArenaHeaderSize;
+}
+
+void MemoryArena::fastFree(void *ptr) {
+  if (!ptr) {
+    return;
+  }
+
+  auto *p = static_cast<unsigned char *>(ptr);
+  if (p < begin_ + kArenaHeaderSize || p >= begin_ + capacity_) {
+    SHERPA_NCNN_LOGE("Freeing memory that is not from this memory arena");
+    ncnn::fastFree(ptr);
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto *h = reinterpret_cast<Header *>(p - kArenaHeaderSize);
+  h->used = false;
+  num_bytes_ -= h->size;
+
+  Header *next = Next(h);
+  if (next && !next->used) {
+    h->size += next->size;
+  }
+
+  Header *prev = Prev(h);
+  if (prev && !prev->used) {
+    prev->size += h->size;
+    h = prev;
+  }
+
+  if (Header *n = Next(h)) {
+    n->prev_size = h->size;
+  }
+}
+
+ModelMemoryPools::ModelMemoryPools(bool per_thread, int32_t limit_mb,
+                                   bool huge_pages, int32_t arena_mb /*= 0*/)
+    : per_thread_(per_thread),
+      limit_(static_cast<std::size_t>(std::max(limit_mb, 0)) << 20),
+      huge_pages_(huge_pages),
+      alive_(std::make_shared<char>()) {
+  static std::atomic<uint64_t> next_id{0};
+  id_ = next_id++;
+
+  if (arena_mb > 0) {
+    arena_ = std::make_unique<MemoryArena>(
+        static_cast<std::size_t>(arena_mb) << 20, huge_pages_);
+    per_thread_ = false;
+    return;
+  }
+
+  if (!per_thread_) {
+    shared_ = std::make_unique<Pools>(true, limit_, huge_pages_);
+  }
+}
+
+ModelMemoryPools::Pools &ModelMemoryPools::GetPools() const {
+  if (!per_thread_) {
+    return *shared_;
+  }
+
+  struct Entry {
+    std::weak_ptr<char> owner;
+    std::shared_ptr<Pools> pools;
+  };
+
+  static thread_local std::unordered_map<uint64_t, Entry> entries;
+
+  Entry &e = entries[id_];
+  if (e.pools) {
+    return *e.pools;
+  }
+
+  for (auto it = entries.begin(); it != entries.end();) {
+    if (it->first != id_ && it->second.owner.expired()) {
+      it = entries.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  e.owner = alive_;
+  e.pools = std::make_shared<Pools>(false, limit_, huge_pages_);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // Forget the pools of threads that have exited
+  thread_pools_.erase(
+      std::remove_if(thread_pools_.begin(), thread_pools_.end(),
+                     [](const std::weak_ptr<Pools> &p) { return p.expired(); }),
+      thread_pools_.end());
+  thread_pools_.push_back(e.pools);
+
+  return *e.pools;
+}
+
+void ModelMemoryPools::Attach(ncnn::Extractor *ex) const {
+  if (arena_) {
+    ex->set_blob_allocator(arena_.get());
+    ex->set_workspace_allocator(arena_.get());
+    return;
+  }
+
+  Pools &pools = GetPools();
+
+  ex->set_blob_allocator(&pools.blob);
+  ex->set_workspace_allocator(&pools.workspace);
+}
+
+bool ModelMemoryPools::Owns(const ncnn::Mat &m) const {
+  if (m.empty() || !m.allocator) {
+    return false;
+  }
+
+  if (arena_) {
+    return m.allocator == arena_.get();
+  }
+
+  if (!per_thread_) {
+    return m.allocator == &shared_->blob ||
+           m.allocator == &shared_->workspace;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto &p : thread_pools_) {
+    auto pools = p.lock();
+    if (pools &&
+        (m.allocator == &pools->blob || m.allocator == &pools->workspace)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+ncnn::Mat ModelMemoryPools::Detach(const ncnn::Mat &m) const {
+  return Owns(m) ? m.clone() : m;
+}
+
+void ModelMemoryPools::CopyTo(const ncnn::Mat &src, ncnn::Mat *dst) const {
+  if (!Owns(src)) {
+    *dst = src;
+    return;
+  }
+
+  bool reuse = !dst->empty() && dst->dims == src.dims && dst->w == src.w &&
+               dst->h == src.h && dst->d == src.d && dst->c == src.c &&
+               dst->elemsize == src.elemsize &&
+               dst->elempack == src.elempack && dst->cstep == src.cstep &&
+               dst->refcount && *dst->refcount == 1 && !Owns(*dst);
+
+  if (!reuse) {
+    *dst = src.clone();
+    return;
+  }
+
+  std::memcpy(dst->data, src.data, src.total() * src.elemsize);
+}
+
+std::size_t ModelMemoryPools::BlobHighWaterMark() const {
+  if (arena_) {
+    return arena_->HighWaterMark();
+  }
+  return HighWaterMark(&Pools::blob);
+}
+
+std::size_t ModelMemoryPools::WorkspaceHighWaterMark() const {
+  if (arena_) {
+    return 0;
+  }
+  return HighWaterMark(&Pools::workspace);
+}
+
+std::size_t ModelMemoryPools::HighWaterMark(MemoryPool Pools::*pool) const {
+  if (!per_thread_) {
+    return ((*shared_).*pool).HighWaterMark();
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::size_t ans = 0;
+  for (const auto &p : thread_pools_) {
+    if (auto pools = p.lock()) {
+      ans += ((*pools).*pool).HighWaterMark();
+    }
+  }
+  return ans;
+}
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,262 @@
+// sherpa-ncnn/csrc/memory-pool.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_MEMORY_POOL_H_
+#define SHERPA_NCNN_CSRC_MEMORY_POOL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>   // NOLINT
+#include <unordered_map>
+#include <vector>
+
+#include "allocator.h"  // NOLINT
+#include "mat.h"        // NOLINT
+#include "net.h"        // NOLINT
+
+namespace sherpa_ncnn {
+
+// An allocator for the blobs or workspace of ncnn networks that keeps
+// freed chunks for reuse, like ncnn::PoolAllocator, and counts the bytes
+// it holds.
+//
+// A request is served by the smallest free chunk that is large enough, so
+// once the pool has grown to the peak usage of the networks, it does not
+// allocate or grow any more, even if the shapes of the blobs change from
+// run to run.
+class MemoryPool : public ncnn::Allocator {
+ public:
+  /**
+   * @param thread_safe  If false, the pool must be used by one thread at a
+   *                     time, like ncnn::UnlockedPoolAllocator.
+   * @param limit  If positive, freed chunks are released instead of kept
+   *               while the pool holds more than this number of bytes.
+   * @param huge_pages  If true, chunks of at least kHugePageSize bytes are
+   *                    allocated with AllocateHugePages(). They are
+   *                    rounded up to whole huge pages, which NumBytes()
+   *                    does not count.
+   */
+  MemoryPool(bool thread_safe, std::size_t limit, bool huge_pages = false);
+  ~MemoryPool() override;
+
+  MemoryPool(const MemoryPool &) = delete;
+  MemoryPool &operator=(const MemoryPool &) = delete;
+
+  void *fastMalloc(size_t size) override;
+  void fastFree(void *ptr) override;
+
+  // Bytes held by the pool, in use or not. It can be called from any
+  // thread.
+  std::size_t NumBytes() const { return num_bytes_; }
+
+  // The largest NumBytes() so far. It can be called from any thread.
+  std::size_t HighWaterMark() const { return high_water_mark_; }
+
+ private:
+  // Release free chunks, largest first, until the pool holds at most
+  // limit_ bytes. mutex_ must be held if thread_safe_ is true.
+  void Trim();
+
+  void *Allocate(std::size_t size) const;
+  void Release(void *ptr, std::size_t size) const;
+
+ private:
+  bool thread_safe_;
+  std::size_t limit_;
+  bool huge_pages_;
+
+  std::mutex mutex_;
+
+  // size -> chunk
+  std::multimap<std::size_t, void *> free_;
+
+  // chunk -> size
+  std::unordered_map<void *, std::size_t> used_;
+
+  std::atomic<std::size_t> num_bytes_{0};
+  std::atomic<std::size_t> high_water_mark_{0};
+};
+
+// An allocator for the blobs and workspace of ncnn networks that serves
+// all requests from one block of memory of a fixed size, which is
+// allocated once in the constructor or provided by the caller.
+//
+// A request that does not fit returns nullptr, so that the layer that
+// makes it fails with -100 instead of the process growing, and is
+// logged. Memory use is bounded by the capacity and nothing is allocated
+// from the heap after construction, so a long-running process does not
+// fragment the heap. Choose the capacity from
+// ModelMemoryPools::HighWaterMark() of a run with MemoryPool plus some
+// headroom for fragmentation.
+//
+// Requests are served by the smallest free block that fits, found by a
+// walk over all blocks, which is cheap for the few dozen blobs of a
+// network. Adjacent free blocks are merged.
+//
+// It is thread-safe.
+class MemoryArena : public ncnn::Allocator {
+ public:
+  /**
+   * @param capacity  In bytes.
+   * @param huge_pages  If true, the memory is allocated with
+   *                    AllocateHugePages().
+   */
+  explicit MemoryArena(std::size_t capacity, bool huge_pages = false);
+
+  // Use capacity bytes at buffer, which must outlive the arena
+  MemoryArena(void *buffer, std::size_t capacity);
+
+  ~MemoryArena() override;
+
+  MemoryArena(const MemoryArena &) = delete;
+  MemoryArena &operator=(const MemoryArena &) = delete;
+
+  void *fastMalloc(size_t size) override;
+  void fastFree(void *ptr) override;
+
+  // Usable bytes, i.e., the capacity after alignment
+  std::size_t Capacity() const { return capacity_; }
+
+  // Bytes in use, including the headers of the blocks. It can be called
+  // from any thread.
+  std::size_t NumBytes() const { return num_bytes_; }
+
+  // The largest NumBytes() so far. It can be called from any thread.
+  std::size_t HighWaterMark() const { return high_water_mark_; }
+
+  // Number of requests that did not fit. It can be called from any
+  // thread.
+  int32_t NumFailures() const { return num_failures_; }
+
+ private:
+  struct Header;
+
+  void Init(void *buffer, std::size_t capacity);
+
+  Header *Next(Header *h) const;
+  Header *Prev(Header *h) const;
+
+ private:
+  // The memory allocated by the arena, if any
+  void *owned_ = nullptr;
+  std::size_t owned_size_ = 0;
+  bool huge_pages_ = false;
+
+  unsigned char *begin_ = nullptr;
+  std::size_t capacity_ = 0;
+
+  std::mutex mutex_;
+
+  std::atomic<std::size_t> num_bytes_{0};
+  std::atomic<std::size_t> high_water_mark_{0};
+  std::atomic<int32_t> num_failures_{0};
+};
+
+// The memory pools of the networks of a model: one MemoryPool for blobs
+// and one for workspace, either shared by all threads or one pair per
+// thread, or a MemoryArena for both that is shared by all threads.
+//
+// Per-thread pools need no lock. A mat allocated from them must be
+// released on the thread that created it, so Detach() the outputs that
+// are kept or passed to other threads. The pools of a thread are freed
+// when the thread exits.
+//
+// It is thread-safe.
+class ModelMemoryPools {
+ public:
+  /**
+   * @param per_thread  True to give each thread its own pools.
+   * @param limit_mb  If positive, the limit of each pool in MB, see
+   *                  MemoryPool.
+   * @param huge_pages  See MemoryPool.
+   * @param arena_mb  If positive, blobs and workspace are allocated from a
+   *                  MemoryArena of this many MB instead, and per_thread
+   *                  and limit_mb are ignored.
+   */
+  ModelMemoryPools(bool per_thread, int32_t limit_mb, bool huge_pages = false,
+                   int32_t arena_mb = 0);
+
+  // Let ex allocate blobs and workspace from the pools of the calling
+  // thread
+  void Attach(ncnn::Extractor *ex) const;
+
+  // The pools of the calling thread, or the arena
+  ncnn::Allocator *BlobPool() const {
+    return arena_ ? static_cast<ncnn::Allocator *>(arena_.get())
+                  : &GetPools().blob;
+  }
+
+  ncnn::Allocator *WorkspacePool() const {
+    return arena_ ? static_cast<ncnn::Allocator *>(arena_.get())
+                  : &GetPools().workspace;
+  }
+
+  // nullptr if arena_mb is not positive
+  const MemoryArena *Arena() const { return arena_.get(); }
+
+  // Return true if m is allocated from one of the pools
+  bool Owns(const ncnn::Mat &m) const;
+
+  // Return a copy of m if it is allocated from one of the pools and m
+  // otherwise
+  ncnn::Mat Detach(const ncnn::Mat &m) const;
+
+  // Same as *dst = Detach(src), but if src is from the pools, it is
+  // copied into dst when dst has the same shape and is not shared, so
+  // that states that are carried from run to run are not reallocated.
+  void CopyTo(const ncnn::Mat &src, ncnn::Mat *dst) const;
+
+  // Sum of MemoryPool::HighWaterMark() of the pools, except the ones of
+  // threads that have exited
+  std::size_t HighWaterMark() const {
+    return BlobHighWaterMark() + WorkspaceHighWaterMark();
+  }
+
+  // Same as above, but only for the pools of blobs or of workspace. The
+  // peak of an arena is counted as the one of blobs.
+  std::size_t BlobHighWaterMark() const;
+  std::size_t WorkspaceHighWaterMark() const;
+
+ private:
+  struct Pools {
+    Pools(bool thread_safe, std::size_t limit, bool huge_pages)
+        : blob(thread_safe, limit, huge_pages),
+          workspace(thread_safe, limit, huge_pages) {}
+
+    MemoryPool blob;
+    MemoryPool workspace;
+  };
+
+  Pools &GetPools() const;
+
+  // Sum of MemoryPool::HighWaterMark() of one pool of each Pools
+  std::size_t HighWaterMark(MemoryPool Pools::*pool) const;
+
+ private:
+  bool per_thread_;
+  std::size_t limit_;
+  bool huge_pages_;
+
+  // If not null, it replaces the pools
+  std::unique_ptr<MemoryArena> arena_;
+
+  // Used if per_thread_ is false
+  std::unique_ptr<Pools> shared_;
+
+  // The per-thread pools are owned by their threads and found by id_.
+  // A thread drops the pools of destroyed objects, i.e., if alive_ has
+  // expired, when it creates new ones.
+  uint64_t id_;
+  std::shared_ptr<char> alive_;
+
+  mutable std::mutex mutex_;
+  mutable std::vector<std::weak_ptr<Pools>> thread_pools_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_MEMORY_POOL_H_
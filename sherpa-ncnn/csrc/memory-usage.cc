@@ -0,0 +1,60 @@
+// sherpa-ncnn/csrc/memory-usage.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/memory-usage.h"
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+
+namespace sherpa_ncnn {
+
+std::string ModelMemoryUsage::ToString() const {
+  std::ostringstream os;
+
+  os << "ModelMemoryUsage(";
+  os << "encoder_weights=" << encoder_weights << ", ";
+  os << "decoder_weights=" << decoder_weights << ", ";
+  os << "joiner_weights=" << joiner_weights << ", ";
+  os << "blob_high_water_mark=" << blob_high_water_mark << ", ";
+  os << "workspace_high_water_mark=" << workspace_high_water_mark << ")";
+
+  return os.str();
+}
+
+std::string StreamMemoryUsage::ToString() const {
+  std::ostringstream os;
+
+  os << "StreamMemoryUsage(";
+  os << "encoder_states=" << encoder_states << ", ";
+  os << "features=" << features << ", ";
+  os << "hypotheses=" << hypotheses << ", ";
+  os << "context_graph=" << context_graph << ")";
+
+  return os.str();
+}
+
+bool MemoryBudget::Reserve(std::size_t n) {
+  std::size_t used = used_.load();
+  do {
+    if (n > limit_ || used > limit_ - n) {
+      return false;
+    }
+  } while (!used_.compare_exchange_weak(used, used + n));
+
+  return true;
+}
+
+std::unique_ptr<MemoryReservation> MemoryReservation::Create(
+    std::shared_ptr<MemoryBudget> budget, std::size_t n) {
+  if (!budget->Reserve(n)) {
+    return nullptr;
+  }
+
+  return std::unique_ptr<MemoryReservation>(
+      new MemoryReservation(std::move(budget), n));
+}
+
+}  // namespace sherpa_ncnn
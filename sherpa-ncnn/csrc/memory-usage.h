@@ -0,0 +1,116 @@
+// sherpa-ncnn/csrc/memory-usage.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_MEMORY_USAGE_H_
+#define SHERPA_NCNN_CSRC_MEMORY_USAGE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace sherpa_ncnn {
+
+// Memory of a model, see Model::GetMemoryUsage(). All sizes are in bytes.
+struct ModelMemoryUsage {
+  // Size of the weights of each network as loaded, i.e., of its .bin file
+  // or bundle section. ncnn may keep transformed copies of some weights,
+  // e.g., for winograd convolution, so the resident size can be larger.
+  // 0 for networks loaded from Android assets.
+  std::size_t encoder_weights = 0;
+  std::size_t decoder_weights = 0;
+  std::size_t joiner_weights = 0;
+
+  // Peak bytes of the memory pools for blobs and for workspace, see
+  // ModelConfig::use_pool_allocator. 0 if it is false.
+  std::size_t blob_high_water_mark = 0;
+  std::size_t workspace_high_water_mark = 0;
+
+  std::size_t Total() const {
+    return encoder_weights + decoder_weights + joiner_weights +
+           blob_high_water_mark + workspace_high_water_mark;
+  }
+
+  std::string ToString() const;
+};
+
+// Memory of a stream, see Stream::GetMemoryUsage(). All sizes are in bytes.
+struct StreamMemoryUsage {
+  // The current and next encoder states, or the fp16 states of a parked
+  // or compacted stream. States kept on a GPU are not counted.
+  std::size_t encoder_states = 0;
+
+  // Samples and fbank frames buffered by the feature extractor, including
+  // restored frames, see Stream::RestoreFrames()
+  std::size_t features = 0;
+
+  // Tokens, timestamps and hypotheses of the decoding result. Paths of
+  // different hypotheses share their prefixes, so it is an upper bound.
+  std::size_t hypotheses = 0;
+
+  // The context graph of the stream. It may be shared with other streams.
+  std::size_t context_graph = 0;
+
+  std::size_t Total() const {
+    return encoder_states + features + hypotheses + context_graph;
+  }
+
+  std::string ToString() const;
+};
+
+/** A limit on the bytes reserved by its users, e.g., the streams of one
+ * or more recognizers, see RecognizerConfig::memory_budget.
+ *
+ * It is thread-safe.
+ */
+class MemoryBudget {
+ public:
+  explicit MemoryBudget(std::size_t limit) : limit_(limit) {}
+
+  MemoryBudget(const MemoryBudget &) = delete;
+  MemoryBudget &operator=(const MemoryBudget &) = delete;
+
+  // Reserve n bytes. Return false and reserve nothing if Used() would
+  // exceed Limit().
+  bool Reserve(std::size_t n);
+
+  // Give back n bytes of an earlier Reserve()
+  void Release(std::size_t n) { used_ -= n; }
+
+  std::size_t Used() const { return used_; }
+
+  std::size_t Limit() const { return limit_; }
+
+ private:
+  std::size_t limit_;
+  std::atomic<std::size_t> used_{0};
+};
+
+// Bytes reserved from a MemoryBudget until this object is destroyed
+class MemoryReservation {
+ public:
+  // Return nullptr if budget cannot reserve n bytes
+  static std::unique_ptr<MemoryReservation> Create(
+      std::shared_ptr<MemoryBudget> budget, std::size_t n);
+
+  ~MemoryReservation() { budget_->Release(n_); }
+
+  MemoryReservation(const MemoryReservation &) = delete;
+  MemoryReservation &operator=(const MemoryReservation &) = delete;
+
+  std::size_t NumBytes() const { return n_; }
+
+ private:
+  MemoryReservation(std::shared_ptr<MemoryBudget> budget, std::size_t n)
+      : budget_(std::move(budget)), n_(n) {}
+
+ private:
+  std::shared_ptr<MemoryBudget> budget_;
+  std::size_t n_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_MEMORY_USAGE_H_
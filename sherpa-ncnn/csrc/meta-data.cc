@@ -18,6 +18,11 @@
 
 #include "sherpa-ncnn/csrc/meta-data.h"
 
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+
 #include "net.h"  // NOLINT
 namespace sherpa_ncnn {
 
@@ -56,4 +61,45 @@ void RegisterMetaDataLayer(ncnn::Net &net) {
   net.register_custom_layer("SherpaMetaData", MetaDataCreator);
 }
 
+bool ReadModelType(const char *param, int32_t *type, int32_t *version) {
+  const char *p = param;
+  while ((p = std::strstr(p, "SherpaMetaData")) != nullptr) {
+    const char *end = std::strchr(p, '\n');
+    std::string line = end ? std::string(p, end) : std::string(p);
+    p += std::strlen("SherpaMetaData");
+
+    // type name num_bottoms num_tops bottoms... tops... k=v ...
+    std::istringstream is(line);
+    std::string layer_type, name;
+    int32_t num_bottoms = 0, num_tops = 0;
+    if (!(is >> layer_type >> name >> num_bottoms >> num_tops) ||
+        layer_type != "SherpaMetaData" || name != "sherpa_meta_data1") {
+      continue;
+    }
+
+    bool has_type = false;
+    *version = 0;
+
+    std::string kv;
+    while (is >> kv) {
+      auto pos = kv.find('=');
+      if (pos == std::string::npos) continue;
+
+      // Negative keys are arrays, which we don't need
+      int32_t key = std::atoi(kv.substr(0, pos).c_str());
+      int32_t value = std::atoi(kv.c_str() + pos + 1);
+      if (key == 0) {
+        *type = value;
+        has_type = true;
+      } else if (key == 15) {
+        *version = value;
+      }
+    }
+
+    return has_type;
+  }
+
+  return false;
+}
+
 }  // namespace sherpa_ncnn
@@ -67,6 +67,18 @@ Note: You first need to change 1060 to 1061 since we add one layer
 
 void RegisterMetaDataLayer(ncnn::Net &net);
 
+/** Read the model type (arg0) and version (arg15) of the layer
+ * sherpa_meta_data1 from the text of a .param file without loading the
+ * network. Only the line of the layer is parsed.
+ *
+ * @param param  The content of a .param file. It must be null-terminated.
+ * @param type  On return, it contains arg0.
+ * @param version  On return, it contains arg15, 0 if it is not given.
+ *
+ * @return Return false if there is no such layer or arg0 is missing.
+ */
+bool ReadModelType(const char *param, int32_t *type, int32_t *version);
+
 }  // namespace sherpa_ncnn
 
 #endif  // SHERPA_NCNN_CSRC_META_DATA_H_
@@ -0,0 +1,274 @@
+// sherpa-ncnn/csrc/metrics.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/metrics.h"
+
+#include <cmath>
+#include <sstream>
+#include <string>
+
+namespace sherpa_ncnn {
+
+namespace {
+
+constexpr int32_t kNumShards = 16;
+
+// The stage histograms come first, followed by the MetricHistogram ones
+constexpr int32_t kNumHistograms = kNumStages + kNumMetricHistograms;
+
+// Upper bounds of the buckets. Each histogram has an additional +Inf
+// bucket.
+constexpr int32_t kNumBounds = 14;
+
+constexpr double kSecondsBounds[kNumBounds] = {
+    0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05,
+    0.1,    0.25,  0.5,    1,     2.5,  5,     10};
+
+constexpr double kRtfBounds[kNumBounds] = {
+    0.01, 0.02, 0.05, 0.1, 0.2, 0.3, 0.4, 0.5, 0.75, 1, 1.5, 2, 5, 10};
+
+// Sums are kept in integers of this unit
+constexpr double kSumScale = 1e6;
+
+// Aligned to a cache line, so that threads of different shards do not
+// share one
+struct alignas(64) Shard {
+  std::atomic<int64_t> counters[kNumMetricCounters];
+  std::atomic<int64_t> gauges[kNumMetricGauges];
+  std::atomic<int64_t> buckets[kNumHistograms][kNumBounds + 1];
+  std::atomic<int64_t> sums[kNumHistograms];
+};
+
+// Zero-initialized, since it has static storage
+Shard shards[kNumShards];
+
+Shard &CurrentShard() {
+  static std::atomic<int32_t> next{0};
+  static thread_local int32_t i = next++ % kNumShards;
+  return shards[i];
+}
+
+const double *GetBounds(int32_t h) {
+  if (h < kNumStages ||
+      h == kNumStages +
+               static_cast<int32_t>(MetricHistogram::kTtsSynthesisSeconds)) {
+    return kSecondsBounds;
+  }
+  return kRtfBounds;
+}
+
+void ObserveImpl(int32_t h, double value) {
+  const double *bounds = GetBounds(h);
+  int32_t b = 0;
+  while (b != kNumBounds && value > bounds[b]) {
+    ++b;
+  }
+
+  Shard &shard = CurrentShard();
+  shard.buckets[h][b].fetch_add(1, std::memory_order_relaxed);
+  shard.sums[h].fetch_add(std::llround(value * kSumScale),
+                          std::memory_order_relaxed);
+}
+
+template <std::size_t N>
+int64_t Sum(std::atomic<int64_t> (Shard::*values)[N], int32_t i) {
+  int64_t ans = 0;
+  for (const auto &shard : shards) {
+    ans += (shard.*values)[i].load(std::memory_order_relaxed);
+  }
+  return ans;
+}
+
+int64_t CountImpl(int32_t h) {
+  int64_t ans = 0;
+  for (const auto &shard : shards) {
+    for (const auto &b : shard.buckets[h]) {
+      ans += b.load(std::memory_order_relaxed);
+    }
+  }
+  return ans;
+}
+
+struct CounterInfo {
+  const char *name;
+  const char *help;
+};
+
+constexpr CounterInfo kCounters[kNumMetricCounters] = {
+    {"streams_created", "Streams created"},
+    {"chunks_decoded", "Chunks decoded, summed over all streams"},
+    {"endpoints", "Endpoints detected"},
+    {"vad_segments", "Speech segments found by voice activity detection"},
+    {"tts_requests", "Audios requested from text-to-speech"},
+    {"tts_audio_cache_hits", "Lookups of the audio cache of TTS that hit"},
+    {"tts_audio_cache_misses",
+     "Lookups of the audio cache of TTS that missed"},
+    {"tts_token_cache_hits", "Lookups of the token cache of TTS that hit"},
+    {"tts_token_cache_misses",
+     "Lookups of the token cache of TTS that missed"},
+};
+
+constexpr CounterInfo kGauges[kNumMetricGauges] = {
+    {"streams_active", "Streams that are not destroyed yet"},
+};
+
+constexpr CounterInfo kHistograms[kNumMetricHistograms] = {
+    {"chunk_real_time_factor",
+     "Time of the encoder and the search of a chunk divided by its duration"},
+    {"tts_synthesis_seconds", "Time to generate an audio"},
+    {"tts_real_time_factor",
+     "Time to generate an audio divided by its duration"},
+};
+
+constexpr const char *kPrefix = "sherpa_ncnn_";
+
+// Write the samples of histogram h. labels is empty or ends with a comma.
+void RenderHistogram(int32_t h, const std::string &name,
+                     const std::string &labels, std::ostream &os) {
+  const double *bounds = GetBounds(h);
+
+  int64_t count = 0;
+  for (int32_t b = 0; b != kNumBounds + 1; ++b) {
+    for (const auto &shard : shards) {
+      count += shard.buckets[h][b].load(std::memory_order_relaxed);
+    }
+
+    os << name << "_bucket{" << labels << "le=\"";
+    if (b == kNumBounds) {
+      os << "+Inf";
+    } else {
+      os << bounds[b];
+    }
+    os << "\"} " << count << "\n";
+  }
+
+  std::string braces = labels.empty()
+                           ? std::string()
+                           : "{" + labels.substr(0, labels.size() - 1) + "}";
+
+  os << name << "_count" << braces << " " << count << "\n";
+  os << name << "_sum" << braces << " " << Sum(&Shard::sums, h) / kSumScale
+     << "\n";
+}
+
+}  // namespace
+
+std::atomic<bool> Metrics::enabled_{false};
+
+void Metrics::Enable(bool enabled) { enabled_ = enabled; }
+
+void Metrics::Add(MetricCounter c, int64_t n /*= 1*/) {
+  if (!Enabled()) {
+    return;
+  }
+
+  CurrentShard()
+      .counters[static_cast<int32_t>(c)]
+      .fetch_add(n, std::memory_order_relaxed);
+}
+
+void Metrics::Add(MetricGauge g, int64_t n) {
+  CurrentShard()
+      .gauges[static_cast<int32_t>(g)]
+      .fetch_add(n, std::memory_order_relaxed);
+}
+
+void Metrics::Observe(MetricHistogram h, double value) {
+  if (!Enabled()) {
+    return;
+  }
+
+  ObserveImpl(kNumStages + static_cast<int32_t>(h), value);
+}
+
+void Metrics::ObserveStage(Stage stage, double seconds) {
+  if (!Enabled()) {
+    return;
+  }
+
+  ObserveImpl(static_cast<int32_t>(stage), seconds);
+}
+
+int64_t Metrics::Get(MetricCounter c) {
+  return Sum(&Shard::counters, static_cast<int32_t>(c));
+}
+
+int64_t Metrics::Get(MetricGauge g) {
+  return Sum(&Shard::gauges, static_cast<int32_t>(g));
+}
+
+int64_t Metrics::Count(MetricHistogram h) {
+  return CountImpl(kNumStages + static_cast<int32_t>(h));
+}
+
+int64_t Metrics::Count(Stage stage) {
+  return CountImpl(static_cast<int32_t>(stage));
+}
+
+void Metrics::Reset() {
+  for (auto &shard : shards) {
+    for (auto &c : shard.counters) {
+      c = 0;
+    }
+
+    for (auto &h : shard.buckets) {
+      for (auto &b : h) {
+        b = 0;
+      }
+    }
+
+    for (auto &s : shard.sums) {
+      s = 0;
+    }
+  }
+}
+
+std::string Metrics::ToOpenMetrics() {
+  std::ostringstream os;
+
+  for (int32_t i = 0; i != kNumMetricCounters; ++i) {
+    std::string name = std::string(kPrefix) + kCounters[i].name;
+    os << "# TYPE " << name << " counter\n";
+    os << "# HELP " << name << " " << kCounters[i].help << ".\n";
+    os << name << "_total " << Sum(&Shard::counters, i) << "\n";
+  }
+
+  for (int32_t i = 0; i != kNumMetricGauges; ++i) {
+    std::string name = std::string(kPrefix) + kGauges[i].name;
+    os << "# TYPE " << name << " gauge\n";
+    os << "# HELP " << name << " " << kGauges[i].help << ".\n";
+    os << name << " " << Sum(&Shard::gauges, i) << "\n";
+  }
+
+  std::string name = std::string(kPrefix) + "stage_seconds";
+  os << "# TYPE " << name << " histogram\n";
+  os << "# UNIT " << name << " seconds\n";
+  os << "# HELP " << name
+     << " Time of a stage for a chunk, an AcceptWaveform() call or a TTS "
+        "request.\n";
+  for (int32_t i = 0; i != kNumStages; ++i) {
+    if (CountImpl(i) == 0) continue;
+
+    std::string labels = std::string("stage=\"") +
+                         GetStageName(static_cast<Stage>(i)) + "\",";
+    RenderHistogram(i, name, labels, os);
+  }
+
+  for (int32_t i = 0; i != kNumMetricHistograms; ++i) {
+    name = std::string(kPrefix) + kHistograms[i].name;
+    os << "# TYPE " << name << " histogram\n";
+    if (static_cast<MetricHistogram>(i) ==
+        MetricHistogram::kTtsSynthesisSeconds) {
+      os << "# UNIT " << name << " seconds\n";
+    }
+    os << "# HELP " << name << " " << kHistograms[i].help << ".\n";
+    RenderHistogram(kNumStages + i, name, "", os);
+  }
+
+  os << "# EOF\n";
+
+  return os.str();
+}
+
+}  // namespace sherpa_ncnn
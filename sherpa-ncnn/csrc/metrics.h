@@ -0,0 +1,108 @@
+// sherpa-ncnn/csrc/metrics.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_METRICS_H_
+#define SHERPA_NCNN_CSRC_METRICS_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "sherpa-ncnn/csrc/latency-stats.h"
+
+namespace sherpa_ncnn {
+
+enum class MetricCounter : int32_t {
+  // Streams created by a recognizer, including restored ones
+  kStreamsCreated = 0,
+  // Chunks decoded by the encoder and the search, summed over all streams
+  kChunksDecoded = 1,
+  // Endpoints detected, counted when a stream is reset at an endpoint
+  kEndpoints = 2,
+  // Speech segments found by voice activity detectors
+  kVadSegments = 3,
+  // Audios requested from OfflineTts, including those from its cache
+  kTtsRequests = 4,
+  kTtsAudioCacheHits = 5,
+  kTtsAudioCacheMisses = 6,
+  // Lookups of the token IDs of a text, see OfflineTtsConfig
+  kTtsTokenCacheHits = 7,
+  kTtsTokenCacheMisses = 8,
+};
+
+constexpr int32_t kNumMetricCounters = 9;
+
+enum class MetricGauge : int32_t {
+  // Streams that are not destroyed yet
+  kStreamsActive = 0,
+};
+
+constexpr int32_t kNumMetricGauges = 1;
+
+enum class MetricHistogram : int32_t {
+  // Time of the encoder and the search of a chunk divided by the duration
+  // of its audio
+  kChunkRealTimeFactor = 0,
+  // Seconds to generate an audio, excluding cache hits
+  kTtsSynthesisSeconds = 1,
+  // kTtsSynthesisSeconds divided by the duration of the audio
+  kTtsRealTimeFactor = 2,
+};
+
+constexpr int32_t kNumMetricHistograms = 3;
+
+/** Process-wide metrics of recognition, VAD and TTS for long-running
+ * services, e.g., to be scraped by Prometheus, see ToOpenMetrics().
+ *
+ * Besides the histograms above, it has a histogram of the seconds of each
+ * Stage, with one sample per chunk of a stream, per call of
+ * Stream::AcceptWaveform() and per TTS request, as in LatencyStats.
+ *
+ * Each thread updates its own shard of the values with relaxed atomic
+ * additions, so threads that decode in parallel do not contend on a lock
+ * or a cache line. Reading sums up the shards.
+ *
+ * It is off by default and then costs one atomic load per update. Gauges
+ * are updated even while it is off, so that they stay consistent when it
+ * is turned on later.
+ *
+ * It is thread-safe.
+ */
+class Metrics {
+ public:
+  static void Enable(bool enabled);
+
+  static bool Enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+  static void Add(MetricCounter c, int64_t n = 1);
+
+  static void Add(MetricGauge g, int64_t n);
+
+  static void Observe(MetricHistogram h, double value);
+
+  static void ObserveStage(Stage stage, double seconds);
+
+  static int64_t Get(MetricCounter c);
+
+  static int64_t Get(MetricGauge g);
+
+  // Number of samples of a histogram
+  static int64_t Count(MetricHistogram h);
+
+  static int64_t Count(Stage stage);
+
+  // Set the counters and histograms to 0. Gauges are kept.
+  static void Reset();
+
+  // Render all metrics in the OpenMetrics text format, which Prometheus
+  // scrapes. Stages without samples are skipped.
+  static std::string ToOpenMetrics();
+
+ private:
+  static std::atomic<bool> enabled_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_METRICS_H_
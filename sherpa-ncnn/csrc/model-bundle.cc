@@ -0,0 +1,225 @@
+// sherpa-ncnn/csrc/model-bundle.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/model-bundle.h"
+
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "datareader.h"  // NOLINT
+#include "sherpa-ncnn/csrc/startup-stats.h"
+#include "sherpa-ncnn/csrc/text-utils.h"
+
+namespace sherpa_ncnn {
+
+namespace {
+
+constexpr char kMagic[8] = {'S', 'N', 'C', 'N', 'N', 'B', 'D', 'L'};
+constexpr uint32_t kVersion = 1;
+constexpr int32_t kHeaderSize = 16;
+constexpr int32_t kNameSize = 48;
+constexpr int32_t kIndexEntrySize = 64;
+
+struct IndexEntry {
+  char name[kNameSize];
+  uint64_t offset;
+  uint64_t size;
+};
+
+static_assert(sizeof(IndexEntry) == kIndexEntrySize, "");
+
+}  // namespace
+
+std::shared_ptr<ModelBundle> ModelBundle::Open(const std::string &filename) {
+  auto file = MappedFile::Open(filename);
+  if (!file) {
+    NCNN_LOGE("Failed to map %s", filename.c_str());
+    return nullptr;
+  }
+
+  auto ans = Parse(file->Data(), file->Size(), filename);
+  if (ans) {
+    ans->file_ = std::move(file);
+  }
+
+  return ans;
+}
+
+std::shared_ptr<ModelBundle> ModelBundle::FromMemory(const void *data,
+                                                     std::size_t size) {
+  return Parse(static_cast<const unsigned char *>(data), size, "in memory");
+}
+
+std::shared_ptr<ModelBundle> ModelBundle::FromBuffers(
+    const std::vector<ModelBuffer> &buffers) {
+  auto ans = std::make_shared<ModelBundle>();
+  ans->sections_.reserve(buffers.size());
+
+  // No reallocation, so that sections can point into the copies
+  ans->copies_.reserve(buffers.size());
+
+  for (const auto &b : buffers) {
+    Section s;
+    s.name = b.name;
+    s.data = static_cast<const unsigned char *>(b.data);
+    s.size = b.size;
+
+    // ncnn needs a NUL terminated .param
+    if (EndsWith(b.name, ".param")) {
+      ans->copies_.emplace_back(static_cast<const char *>(b.data), b.size);
+      s.data = reinterpret_cast<const unsigned char *>(
+          ans->copies_.back().c_str());
+    }
+
+    ans->sections_.push_back(std::move(s));
+  }
+
+  return ans;
+}
+
+std::shared_ptr<ModelBundle> ModelBundle::Parse(const unsigned char *p,
+                                                std::size_t file_size,
+                                                const std::string &filename) {
+  if (file_size < kHeaderSize || std::memcmp(p, kMagic, sizeof(kMagic))) {
+    NCNN_LOGE("%s is not a model bundle", filename.c_str());
+    return nullptr;
+  }
+
+  uint32_t version;
+  uint32_t num_sections;
+  std::memcpy(&version, p + 8, 4);
+  std::memcpy(&num_sections, p + 12, 4);
+
+  if (version != kVersion) {
+    NCNN_LOGE("Unsupported version %u of the model bundle %s (expected %u)",
+              version, filename.c_str(), kVersion);
+    return nullptr;
+  }
+
+  if ((file_size - kHeaderSize) / kIndexEntrySize < num_sections) {
+    NCNN_LOGE("Truncated index in the model bundle %s", filename.c_str());
+    return nullptr;
+  }
+
+  auto ans = std::make_shared<ModelBundle>();
+  ans->sections_.reserve(num_sections);
+
+  for (uint32_t i = 0; i != num_sections; ++i) {
+    IndexEntry e;
+    std::memcpy(&e, p + kHeaderSize + i * kIndexEntrySize, sizeof(e));
+
+    // Every section is followed by a NUL byte
+    if (e.offset > file_size || e.size >= file_size - e.offset) {
+      NCNN_LOGE("Truncated section %u in the model bundle %s", i,
+                filename.c_str());
+      return nullptr;
+    }
+
+    Section s;
+    s.name.assign(e.name, strnlen(e.name, kNameSize));
+    s.data = p + e.offset;
+    s.size = e.size;
+    ans->sections_.push_back(std::move(s));
+  }
+
+  return ans;
+}
+
+const unsigned char *ModelBundle::GetSection(const std::string &name,
+                                             std::size_t *size) const {
+  for (const auto &s : sections_) {
+    if (s.name == name) {
+      if (size) {
+        *size = s.size;
+      }
+      return s.data;
+    }
+  }
+
+  return nullptr;
+}
+
+bool ModelBundle::LoadNet(const std::string &param, const std::string &bin,
+                          ncnn::Net *net) const {
+  const unsigned char *param_data = GetSection(param);
+  const unsigned char *bin_data = GetSection(bin);
+  if (!param_data || !bin_data) {
+    return false;
+  }
+
+  {
+    ScopedStartupTimer timer(StartupPhase::kParamParse);
+    if (net->load_param_mem(reinterpret_cast<const char *>(param_data))) {
+      return false;
+    }
+  }
+
+  ScopedStartupTimer timer(StartupPhase::kWeightLoad);
+  ncnn::DataReaderFromMemory dr(bin_data);
+  return net->load_model(dr) == 0;
+}
+
+void ModelBundleWriter::AddSection(const std::string &name, std::string data) {
+  sections_.emplace_back(name, std::move(data));
+}
+
+bool ModelBundleWriter::Write(const std::string &filename) const {
+  for (const auto &s : sections_) {
+    if (s.first.size() >= kNameSize) {
+      NCNN_LOGE("Section name '%s' is too long. Max %d bytes", s.first.c_str(),
+                kNameSize - 1);
+      return false;
+    }
+  }
+
+  std::string header(kMagic, sizeof(kMagic));
+  uint32_t num_sections = sections_.size();
+  header.append(reinterpret_cast<const char *>(&kVersion), 4);
+  header.append(reinterpret_cast<const char *>(&num_sections), 4);
+
+  std::vector<IndexEntry> index(num_sections);
+
+  uint64_t offset = kHeaderSize + num_sections * kIndexEntrySize;
+  for (uint32_t i = 0; i != num_sections; ++i) {
+    offset = (offset + kModelBundleAlignment - 1) / kModelBundleAlignment *
+             kModelBundleAlignment;
+
+    IndexEntry &e = index[i];
+    std::memset(e.name, 0, kNameSize);
+    std::memcpy(e.name, sections_[i].first.data(), sections_[i].first.size());
+    e.offset = offset;
+    e.size = sections_[i].second.size();
+
+    offset += e.size + 1;  // + 1 for the NUL byte
+  }
+
+  std::ofstream os(filename, std::ios::binary);
+  if (!os) {
+    return false;
+  }
+
+  os.write(header.data(), header.size());
+  os.write(reinterpret_cast<const char *>(index.data()),
+           num_sections * kIndexEntrySize);
+
+  uint64_t pos = kHeaderSize + num_sections * kIndexEntrySize;
+  for (uint32_t i = 0; i != num_sections; ++i) {
+    std::string padding(index[i].offset - pos, '\0');
+    os.write(padding.data(), padding.size());
+
+    const std::string &data = sections_[i].second;
+    os.write(data.data(), data.size());
+    os.put('\0');
+
+    pos = index[i].offset + data.size() + 1;
+  }
+
+  return static_cast<bool>(os);
+}
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,132 @@
+// sherpa-ncnn/csrc/model-bundle.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_MODEL_BUNDLE_H_
+#define SHERPA_NCNN_CSRC_MODEL_BUNDLE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "net.h"  // NOLINT
+#include "sherpa-ncnn/csrc/mapped-file.h"
+
+namespace sherpa_ncnn {
+
+/** A single file that packs all files of a model, e.g., the .param and
+ * .bin files of its networks and tokens.txt. It is loaded with one memory
+ * map and nothing is copied out of it.
+ *
+ * Layout. Integers use the byte order of the host, as ncnn .bin files do.
+ *
+ *   - Header, 16 bytes: the magic "SNCNNBDL", uint32 version (1) and
+ *     uint32 num_sections
+ *   - Index, num_sections entries of 64 bytes: char name[48], padded with
+ *     NULs, uint64 offset and uint64 size of the section
+ *   - The sections. Each starts at a multiple of kModelBundleAlignment and
+ *     is followed by a NUL byte that is not counted in its size, so that
+ *     .param sections can be passed to ncnn as they are.
+ *
+ * Section names of a streaming transducer model, see ModelConfig::bundle:
+ *
+ *   encoder.ncnn.param, encoder.ncnn.bin, decoder.ncnn.param,
+ *   decoder.ncnn.bin, joiner.ncnn.param, joiner.ncnn.bin, and tokens, which
+ *   is the output of SymbolTable::ToBinary()
+ *
+ * Use sherpa-ncnn-pack-model to create a bundle.
+ */
+constexpr int32_t kModelBundleAlignment = 64;
+
+// A file of a model that is in memory instead of on disk, e.g., embedded
+// in the binary or decrypted from a private store
+struct ModelBuffer {
+  // The name of the section, e.g., encoder.ncnn.param
+  std::string name;
+  const void *data = nullptr;
+  std::size_t size = 0;
+};
+
+class ModelBundle {
+ public:
+  // Return nullptr if the file cannot be mapped or is not a valid bundle
+  static std::shared_ptr<ModelBundle> Open(const std::string &filename);
+
+  /** Use a bundle that is already in memory, e.g., the content of a file
+   * created by sherpa-ncnn-pack-model. data is not copied and must outlive
+   * the bundle and the networks loaded from it. It should be aligned to
+   * kModelBundleAlignment bytes, so that ncnn can use the weights in place.
+   *
+   * @return Return nullptr if it is not a valid bundle.
+   */
+  static std::shared_ptr<ModelBundle> FromMemory(const void *data,
+                                                 std::size_t size);
+
+  /** Create a bundle whose sections are the given buffers, e.g., the .param
+   * and .bin files of the networks of a model, named as in a bundle file.
+   * Sections whose names end with .param are copied, since ncnn needs a
+   * terminating NUL. The others are not copied and must outlive the bundle
+   * and the networks loaded from it.
+   */
+  static std::shared_ptr<ModelBundle> FromBuffers(
+      const std::vector<ModelBuffer> &buffers);
+
+  // Return the section with the given name or nullptr if there is none.
+  // If size is not nullptr, it is set to the size of the section.
+  const unsigned char *GetSection(const std::string &name,
+                                  std::size_t *size = nullptr) const;
+
+  bool HasSection(const std::string &name) const {
+    return GetSection(name) != nullptr;
+  }
+
+  /** Load net from two sections of this bundle.
+   *
+   * The weights stay in the memory map when possible, so the bundle must
+   * outlive net.
+   *
+   * @return Return true on success. Return false if a section is missing or
+   *         ncnn fails to load it.
+   */
+  bool LoadNet(const std::string &param, const std::string &bin,
+               ncnn::Net *net) const;
+
+ private:
+  struct Section {
+    std::string name;
+    const unsigned char *data;
+    std::size_t size;
+  };
+
+  // Read the index of a bundle at p. filename is used in error messages.
+  static std::shared_ptr<ModelBundle> Parse(const unsigned char *p,
+                                            std::size_t file_size,
+                                            const std::string &filename);
+
+  // Null if the bundle is not from a file
+  std::unique_ptr<MappedFile> file_;
+
+  // Copies of the buffers of FromBuffers() that cannot be used in place
+  std::vector<std::string> copies_;
+
+  std::vector<Section> sections_;
+};
+
+// Create a bundle for sherpa-ncnn-pack-model
+class ModelBundleWriter {
+ public:
+  // Name must be shorter than 48 bytes and unique in the bundle
+  void AddSection(const std::string &name, std::string data);
+
+  // Return false if filename cannot be written
+  bool Write(const std::string &filename) const;
+
+ private:
+  std::vector<std::pair<std::string, std::string>> sections_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_MODEL_BUNDLE_H_
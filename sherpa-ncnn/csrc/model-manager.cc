@@ -0,0 +1,48 @@
+// sherpa-ncnn/csrc/model-manager.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/model-manager.h"
+
+#include <memory>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/recognizer.h"
+
+#ifndef SHERPA_NCNN_DISABLE_SENSE_VOICE
+#include "sherpa-ncnn/csrc/offline-recognizer.h"
+#endif
+
+namespace sherpa_ncnn {
+
+std::shared_ptr<const Recognizer> LoadRecognizer(
+    const RecognizerConfig &config) {
+  auto recognizer = std::make_shared<Recognizer>(config);
+  if (!recognizer->GetModel()) {
+    return nullptr;
+  }
+
+  recognizer->WarmUp();
+  return recognizer;
+}
+
+#ifndef SHERPA_NCNN_DISABLE_SENSE_VOICE
+std::shared_ptr<const OfflineRecognizer> LoadOfflineRecognizer(
+    const OfflineRecognizerConfig &config) {
+  auto recognizer = std::make_shared<OfflineRecognizer>(config);
+
+  // ncnn sets up the layers on the first run. Pay for it now instead of
+  // in the first request.
+  int32_t sampling_rate = config.feat_config.sampling_rate;
+  std::vector<float> silence(sampling_rate / 2);
+
+  auto s = recognizer->CreateStream();
+  s->AcceptWaveform(sampling_rate, silence.data(), silence.size());
+  s->InputFinished();
+  recognizer->DecodeStream(s.get());
+
+  return recognizer;
+}
+#endif
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,127 @@
+// sherpa-ncnn/csrc/model-manager.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_MODEL_MANAGER_H_
+#define SHERPA_NCNN_CSRC_MODEL_MANAGER_H_
+
+#include <cstdint>
+#include <functional>
+#include <future>  // NOLINT
+#include <memory>
+#include <mutex>  // NOLINT
+#include <utility>
+
+namespace sherpa_ncnn {
+
+/** A stream together with the recognizer that created it.
+ *
+ * A stream must be decoded by the recognizer that created it, so it keeps
+ * that recognizer, and with it the weights of its model, alive until the
+ * stream is destroyed, even if ModelManager has switched to another one.
+ */
+template <typename R, typename S>
+struct ManagedStream {
+  // Declared first, so that it is released after the stream
+  std::shared_ptr<const R> recognizer;
+  std::unique_ptr<S> stream;
+};
+
+/** Replace the model of a running service without dropping its streams.
+ *
+ * R is Recognizer or OfflineRecognizer. The manager holds the current
+ * recognizer. Reload() loads and warms up a new one on a background
+ * thread, while the current one keeps serving, and then makes it current
+ * in one step. Streams created before keep using the recognizer that
+ * created them until they are destroyed. The old recognizer, and the
+ * mapping of its weights, are released with its last stream.
+ *
+ * It is thread-safe.
+ */
+template <typename R>
+class ModelManager {
+ public:
+  using Stream = typename decltype(std::declval<const R &>().CreateStream())::
+      element_type;
+
+  explicit ModelManager(std::shared_ptr<const R> recognizer)
+      : current_(std::move(recognizer)) {}
+
+  ModelManager(const ModelManager &) = delete;
+  ModelManager &operator=(const ModelManager &) = delete;
+
+  // Return the current recognizer
+  std::shared_ptr<const R> Get() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return current_;
+  }
+
+  // It is incremented each time the current recognizer is replaced
+  int32_t Version() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return version_;
+  }
+
+  // Create a stream with the current recognizer
+  ManagedStream<R, Stream> CreateStream() const {
+    ManagedStream<R, Stream> ans;
+    ans.recognizer = Get();
+    ans.stream = ans.recognizer->CreateStream();
+    return ans;
+  }
+
+  // Make recognizer current. New streams are created with it.
+  void Set(std::shared_ptr<const R> recognizer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    current_ = std::move(recognizer);
+    ++version_;
+  }
+
+  /** Call create() on a background thread and make its result current.
+   *
+   * @param create  It loads and warms up a recognizer, e.g., with
+   *                LoadRecognizer(). It returns nullptr on error.
+   * @return Return a future that is true once the new recognizer is
+   *         current, or false if create() failed, in which case the
+   *         current one is kept. As with std::async(), its destructor
+   *         waits for the reload. If reloads overlap, the last one to
+   *         finish wins. The manager must outlive the future.
+   */
+  std::future<bool> Reload(std::function<std::shared_ptr<const R>()> create) {
+    return std::async(std::launch::async, [this, create]() {
+      std::shared_ptr<const R> recognizer = create();
+      if (!recognizer) {
+        return false;
+      }
+
+      Set(std::move(recognizer));
+      return true;
+    });
+  }
+
+ private:
+  mutable std::mutex mutex_;
+  std::shared_ptr<const R> current_;
+  int32_t version_ = 0;
+};
+
+class Recognizer;
+struct RecognizerConfig;
+class OfflineRecognizer;
+struct OfflineRecognizerConfig;
+
+/** Load a recognizer and warm it up, see Recognizer::WarmUp(). Use a model
+ * bundle, see ModelConfig::bundle, to memory map the weights.
+ *
+ * @return Return nullptr if the model failed to load.
+ */
+std::shared_ptr<const Recognizer> LoadRecognizer(
+    const RecognizerConfig &config);
+
+/// Load an offline recognizer and warm it up by decoding a short silence
+std::shared_ptr<const OfflineRecognizer> LoadOfflineRecognizer(
+    const OfflineRecognizerConfig &config);
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_MODEL_MANAGER_H_
@@ -17,16 +17,51 @@
  */
 #include "sherpa-ncnn/csrc/model.h"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
 #include <sstream>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
 
+#include "cpu.h"  // NOLINT
+#include "sherpa-ncnn/csrc/file-utils.h"
+#include "sherpa-ncnn/csrc/meta-data.h"
+#include "sherpa-ncnn/csrc/perf-profile.h"
+#include "sherpa-ncnn/csrc/startup-stats.h"
+#include "sherpa-ncnn/csrc/text-utils.h"
+
+#ifndef _WIN32
+#include "sherpa-ncnn/csrc/remote-encoder.h"
+#endif
+
+// A family is compiled in unless SHERPA_NCNN_DISABLE_<family> is defined,
+// see SHERPA_NCNN_ENABLE_ZIPFORMER, etc. in CMakeLists.txt
+#ifndef SHERPA_NCNN_DISABLE_CONV_EMFORMER
 #include "sherpa-ncnn/csrc/conv-emformer-model.h"
+#endif
+
+#ifndef SHERPA_NCNN_DISABLE_LSTM
 #include "sherpa-ncnn/csrc/lstm-model.h"
-#include "sherpa-ncnn/csrc/meta-data.h"
+#endif
+
+#ifndef SHERPA_NCNN_DISABLE_ZIPFORMER
 #include "sherpa-ncnn/csrc/poolingmodulenoproj.h"
 #include "sherpa-ncnn/csrc/simpleupsample.h"
 #include "sherpa-ncnn/csrc/stack.h"
 #include "sherpa-ncnn/csrc/tensorasstrided.h"
 #include "sherpa-ncnn/csrc/zipformer-model.h"
+#endif
 
 namespace sherpa_ncnn {
 
@@ -40,94 +75,201 @@ std::string ModelConfig::ToString() const {
   os << "joiner_param=\"" << joiner_param << "\", ";
   os << "joiner_bin=\"" << joiner_bin << "\", ";
   os << "tokens=\"" << tokens << "\", ";
+  os << "bundle=\"" << bundle << "\", ";
+  os << "buffers=" << (buffers ? "True" : "False") << ", ";
+  os << "encoder_variants=[";
+  std::string sep;
+  for (const auto &v : encoder_variants) {
+    os << sep << "(\"" << v.param << "\", \"" << v.bin << "\")";
+    sep = ", ";
+  }
+  os << "], ";
+  os << "use_vulkan_compute=" << (use_vulkan_compute ? "True" : "False")
+     << ", ";
+  os << "encoder_device=\"" << encoder_device << "\", ";
+  os << "decoder_device=\"" << decoder_device << "\", ";
+  os << "joiner_device=\"" << joiner_device << "\", ";
+  os << "encoder_powersave=" << encoder_powersave << ", ";
+  os << "decoder_powersave=" << decoder_powersave << ", ";
+  os << "joiner_powersave=" << joiner_powersave << ", ";
+  os << "cpu_cores=\"" << cpu_cores << "\", ";
+  os << "encoder_precision=\"" << encoder_precision << "\", ";
+  os << "decoder_precision=\"" << decoder_precision << "\", ";
+  os << "joiner_precision=\"" << joiner_precision << "\", ";
+  os << "cache_dir=\"" << cache_dir << "\", ";
+  os << "perf_profile=\"" << perf_profile << "\", ";
   os << "encoder num_threads=" << encoder_opt.num_threads << ", ";
   os << "decoder num_threads=" << decoder_opt.num_threads << ", ";
-  os << "joiner num_threads=" << joiner_opt.num_threads << ")";
+  os << "joiner num_threads=" << joiner_opt.num_threads << ", ";
+  os << "use_pool_allocator=" << (use_pool_allocator ? "True" : "False")
+     << ", ";
+  os << "pool_per_thread=" << (pool_per_thread ? "True" : "False") << ", ";
+  os << "pool_limit_mb=" << pool_limit_mb << ", ";
+  os << "arena_mb=" << arena_mb << ", ";
+  os << "use_mmap=" << (use_mmap ? "True" : "False") << ", ";
+  os << "use_huge_pages=" << (use_huge_pages ? "True" : "False") << ", ";
+  os << "lstm_chunks_per_run=" << lstm_chunks_per_run << ", ";
+  os << "early_exit_threshold=" << early_exit_threshold << ", ";
+  os << "remote_encoder=\"" << remote_encoder << "\")";
 
   return os.str();
 }
 
-static bool IsLstmModel(const ncnn::Net &net) {
-  for (const auto *layer : net.layers()) {
-    if (layer->type == "SherpaMetaData" && layer->name == "sherpa_meta_data1") {
-      // Note: We don't use dynamic_cast<> here since it will throw
-      // the following error
-      //  error: ‘dynamic_cast’ not permitted with -fno-rtti
-      const auto *meta_data = reinterpret_cast<const MetaData *>(layer);
-
-      if (meta_data->arg0 == 3) return true;
-    }
-  }
-
-  return false;
-}
-
-static bool IsConvEmformerModel(const ncnn::Net &net) {
-  // Note: We may need to add more constraints if number of models gets larger.
-  //
-  // If the net has a layer of type SherpaMetaData and with name
-  // sherpa_meta_data1 and if attribute 0 is 1, we assume the model is
-  // a ConvEmformer model
-
-  for (const auto *layer : net.layers()) {
-    if (layer->type == "SherpaMetaData" && layer->name == "sherpa_meta_data1") {
-      // Note: We don't use dynamic_cast<> here since it will throw
-      // the following error
-      //  error: ‘dynamic_cast’ not permitted with -fno-rtti
-      const auto *meta_data = reinterpret_cast<const MetaData *>(layer);
-
-      if (meta_data->arg0 == 1) return true;
-    }
-  }
-
-  return false;
-}
-
-static bool IsZipformerModel(const ncnn::Net &net) {
-  // Note: We may need to add more constraints if number of models gets larger.
-  //
-  // If the net has a layer of type SherpaMetaData and with name
-  // sherpa_meta_data1 and if attribute 0 is 2, we assume the model is
-  // a Zipformer model.
-
-  for (const auto *layer : net.layers()) {
-    if (layer->type == "SherpaMetaData" && layer->name == "sherpa_meta_data1") {
-      // Note: We don't use dynamic_cast<> here since it will throw
-      // the following error
-      //  error: ‘dynamic_cast’ not permitted with -fno-rtti
-      const auto *meta_data = reinterpret_cast<const MetaData *>(layer);
-
-      if (meta_data->arg0 == 2) {
-        // arg15 is the version.
-        // Staring from sherpa-ncnn 2.0, we use the master of tencent/ncnn
-        // directly and we have update the version of Zipformer from 0 to 1.
-        //
-        // If yo are using an older version of Zipformer, please
-        // re-download the model or re-export the model using the latest icefall
-        // or use sherpa-ncnn < v2.0
-        if (meta_data->arg15 < 1) {
-          NCNN_LOGE(
-              "You are using a too old version of Zipformer. You can "
-              "choose one of the following solutions: \n"
-              "  (1) Re-download the latest model\n"
-              "  (2) Re-export your model using the latest icefall. Remember "
-              "to strictly follow the documentation\n"
-              "      to update the version number to 1.\n"
-              "  (3) Use sherpa-ncnn < v2.0 (not recommended)\n");
-          exit(-1);
-        }
-        return true;
-      }
+namespace {
+
+// A family of models, identified by arg0 of the SherpaMetaData layer of
+// the encoder. See meta-data.h. To support a new family, add an entry to
+// kModelFactories. The entries of families that are not compiled in have
+// no create function.
+struct ModelFactory {
+  int32_t type;
+  const char *name;
+
+  // Older exports of the family are not supported
+  int32_t min_version;
+
+  std::unique_ptr<Model> (*create)(const ModelConfig &config,
+                                   std::shared_ptr<const ModelBundle> bundle);
+#if __ANDROID_API__ >= 9
+  std::unique_ptr<Model> (*create_from_assets)(AAssetManager *mgr,
+                                               const ModelConfig &config);
+#endif
+};
+
+template <typename M>
+std::unique_ptr<Model> CreateModelOfType(
+    const ModelConfig &config, std::shared_ptr<const ModelBundle> bundle) {
+  return std::make_unique<M>(config, std::move(bundle));
+}
+
+#if __ANDROID_API__ >= 9
+template <typename M>
+std::unique_ptr<Model> CreateModelOfTypeFromAssets(AAssetManager *mgr,
+                                                   const ModelConfig &config) {
+  return std::make_unique<M>(mgr, config);
+}
+
+#define SHERPA_NCNN_MODEL_FACTORY(type, name, min_version, M)     \
+  {                                                               \
+    type, name, min_version, &CreateModelOfType<M>,               \
+        &CreateModelOfTypeFromAssets<M>                           \
+  }
+#else
+#define SHERPA_NCNN_MODEL_FACTORY(type, name, min_version, M) \
+  { type, name, min_version, &CreateModelOfType<M> }
+#endif
+
+#define SHERPA_NCNN_DISABLED_MODEL_FACTORY(type, name) \
+  { type, name, 0, nullptr }
+
+const ModelFactory kModelFactories[] = {
+#ifndef SHERPA_NCNN_DISABLE_CONV_EMFORMER
+    SHERPA_NCNN_MODEL_FACTORY(1, "ConvEmformer", 0, ConvEmformerModel),
+#else
+    SHERPA_NCNN_DISABLED_MODEL_FACTORY(1, "ConvEmformer"),
+#endif
+#ifndef SHERPA_NCNN_DISABLE_ZIPFORMER
+    // Staring from sherpa-ncnn 2.0, we use the master of tencent/ncnn
+    // directly and we have update the version of Zipformer from 0 to 1.
+    SHERPA_NCNN_MODEL_FACTORY(2, "Zipformer", 1, ZipformerModel),
+#else
+    SHERPA_NCNN_DISABLED_MODEL_FACTORY(2, "Zipformer"),
+#endif
+#ifndef SHERPA_NCNN_DISABLE_LSTM
+    SHERPA_NCNN_MODEL_FACTORY(3, "LSTM", 0, LstmModel),
+#else
+    SHERPA_NCNN_DISABLED_MODEL_FACTORY(3, "LSTM"),
+#endif
+};
+
+#undef SHERPA_NCNN_MODEL_FACTORY
+#undef SHERPA_NCNN_DISABLED_MODEL_FACTORY
+
+}  // namespace
+
+// Find the factory of the encoder from the text of its .param file. Only
+// the line of the meta data layer is parsed, the network is loaded once
+// by the model itself.
+//
+// Return nullptr if the model type is unknown.
+static const ModelFactory *FindModelFactory(const char *param) {
+  int32_t type = 0;
+  int32_t version = 0;
+  if (!ReadModelType(param, &type, &version)) {
+    return nullptr;
+  }
+
+  for (const auto &f : kModelFactories) {
+    if (f.type != type) continue;
+
+    if (!f.create) {
+      NCNN_LOGE(
+          "%s models are not supported by this build. Please build "
+          "sherpa-ncnn with all SHERPA_NCNN_ENABLE_<family> options on",
+          f.name);
+      return nullptr;
+    }
+
+    if (version < f.min_version) {
+      // If yo are using an older version of the model, please
+      // re-download the model or re-export the model using the latest
+      // icefall or use sherpa-ncnn < v2.0
+      NCNN_LOGE(
+          "You are using a too old version of %s. You can "
+          "choose one of the following solutions: \n"
+          "  (1) Re-download the latest model\n"
+          "  (2) Re-export your model using the latest icefall. Remember "
+          "to strictly follow the documentation\n"
+          "      to update the version number to %d.\n"
+          "  (3) Use sherpa-ncnn < v2.0 (not recommended)\n",
+          f.name, f.min_version);
+      exit(-1);
     }
+
+    return &f;
   }
-  return false;
+
+  return nullptr;
+}
+
+static void LogUnknownModel() {
+  NCNN_LOGE(
+      "Unable to create a model from specified model files.\n"
+      "Please check: \n"
+      "  1. If you are using a ConvEmformer/Zipformer/LSTM model, please "
+      "make "
+      "sure "
+      "you have added SherapMetaData to encoder_xxx.ncnn.param "
+      "(or encoder_xxx.ncnn.int8.param if you are using an int8 model). "
+      "You need to add it manually after converting the model with pnnx.\n"
+      "  2. (Android) Whether the app requires an int8 model or not\n");
 }
 
 void Model::InitNet(ncnn::Net &net, const std::string &param,
                     const std::string &bin) {
-  if (net.load_param(param.c_str())) {
-    NCNN_LOGE("failed to load %s", param.c_str());
-    exit(-1);
+  InitNet(net, param, bin, nullptr);
+}
+
+void Model::InitNet(ncnn::Net &net, const std::string &param,
+                    const std::string &bin,
+                    std::unique_ptr<MappedFile> *mapped_bin,
+                    bool huge_pages) {
+  {
+    ScopedStartupTimer timer(StartupPhase::kParamParse);
+    if (net.load_param(param.c_str())) {
+      NCNN_LOGE("failed to load %s", param.c_str());
+      exit(-1);
+    }
+  }
+
+  ScopedStartupTimer timer(StartupPhase::kWeightLoad);
+  if (mapped_bin) {
+    *mapped_bin = LoadModelFromMappedFile(bin, &net, huge_pages);
+    if (!*mapped_bin) {
+      NCNN_LOGE("failed to load %s", bin.c_str());
+      exit(-1);
+    }
+    return;
   }
 
   if (net.load_model(bin.c_str())) {
@@ -139,11 +281,15 @@ void Model::InitNet(ncnn::Net &net, const std::string &param,
 #if __ANDROID_API__ >= 9
 void Model::InitNet(AAssetManager *mgr, ncnn::Net &net,
                     const std::string &param, const std::string &bin) {
-  if (net.load_param(mgr, param.c_str())) {
-    NCNN_LOGE("failed to load %s", param.c_str());
-    exit(-1);
+  {
+    ScopedStartupTimer timer(StartupPhase::kParamParse);
+    if (net.load_param(mgr, param.c_str())) {
+      NCNN_LOGE("failed to load %s", param.c_str());
+      exit(-1);
+    }
   }
 
+  ScopedStartupTimer timer(StartupPhase::kWeightLoad);
   if (net.load_model(mgr, bin.c_str())) {
     NCNN_LOGE("failed to load %s", bin.c_str());
     exit(-1);
@@ -151,94 +297,1007 @@ void Model::InitNet(AAssetManager *mgr, ncnn::Net &net,
 }
 #endif
 
+std::vector<ncnn::Mat> Model::RunEncoderBatch(
+    std::vector<ncnn::Mat> &features,
+    const std::vector<const std::vector<ncnn::Mat> *> &states,
+    const std::vector<std::vector<ncnn::Mat> *> &next_states) {
+  int32_t n = static_cast<int32_t>(features.size());
+
+  std::vector<ncnn::Mat> encoder_out(n);
+
+  for (int32_t i = 0; i != n; ++i) {
+    ncnn::Extractor encoder_ex = CreateExtractor(GetEncoder());
+    encoder_out[i] =
+        RunEncoder(features[i], *states[i], &encoder_ex, next_states[i]);
+  }
+
+  return encoder_out;
+}
+
+std::vector<ncnn::Mat> Model::RunEncoderBatch(
+    std::vector<ncnn::Mat> &features,
+    const std::vector<const std::vector<ncnn::Mat> *> &states,
+    const std::vector<std::vector<ncnn::Mat> *> &next_states,
+    const std::vector<std::unique_ptr<DeviceStates> *> & /*device_states*/) {
+  return RunEncoderBatch(features, states, next_states);
+}
+
+// Run the decoder network once for each row of decoder_input.
+//
+// @param decoder_input A 2-D tensor of shape (num_hyps, context_size)
+// @return Return a 2-D tensor of shape (num_hyps, decoder_dim)
+static ncnn::Mat RunDecoderRowByRow(Model *model, ncnn::Mat &decoder_input) {
+  ncnn::Mat decoder_out;
+  int32_t h = decoder_input.h;
+
+  for (int32_t y = 0; y != h; ++y) {
+    ncnn::Mat decoder_input_t =
+        ncnn::Mat(decoder_input.w, decoder_input.row(y));
+
+    ncnn::Mat tmp = model->RunDecoder(decoder_input_t);
+
+    if (y == 0) {
+      decoder_out = ncnn::Mat(tmp.w, h);
+    }
+
+    const float *ptr = tmp;
+    float *out_ptr = decoder_out.row(y);
+    std::copy(ptr, ptr + tmp.w, out_ptr);
+  }
+
+  return decoder_out;
+}
+
+// The decoder network contains an embedding layer followed by a 1-D
+// convolution over the time axis with kernel size context_size. If we
+// concatenate the contexts of all hypotheses along the time axis, the
+// convolution output at frame i * context_size depends only on the context
+// of the i-th hypothesis, so a single run of the decoder network computes
+// the outputs of all hypotheses.
+//
+// @param decoder_input A 2-D tensor of shape (num_hyps, context_size)
+// @return Return a 2-D tensor of shape (num_hyps, decoder_dim). Return an
+//         empty tensor if the decoder output does not have the expected shape.
+static ncnn::Mat RunDecoderConcatenated(Model *model,
+                                        const ncnn::Mat &decoder_input) {
+  int32_t context_size = decoder_input.w;
+  int32_t num_hyps = decoder_input.h;
+
+  ncnn::Mat concatenated = decoder_input.reshape(context_size * num_hyps);
+  ncnn::Mat out = model->RunDecoder(concatenated);
+  if (num_hyps == 1) {
+    return out.reshape(out.w, 1);
+  }
+
+  if (out.dims != 2) {
+    return {};
+  }
+
+  // offset is 0 if the convolution has no padding and is context_size - 1
+  // if it is padded on the left
+  int32_t offset = out.h - 1 - (num_hyps - 1) * context_size;
+  if (offset < 0 || offset >= context_size) {
+    return {};
+  }
+
+  ncnn::Mat ans(out.w, num_hyps);
+  for (int32_t i = 0; i != num_hyps; ++i) {
+    const float *p = out.row(offset + i * context_size);
+    std::copy(p, p + out.w, ans.row(i));
+  }
+
+  return ans;
+}
+
+// Return true if a and b have the same shape and values up to a small
+// relative error
+static bool AllClose(const ncnn::Mat &a, const ncnn::Mat &b) {
+  if (a.empty() || a.w != b.w || a.h != b.h) {
+    return false;
+  }
+
+  for (int32_t y = 0; y != b.h; ++y) {
+    const float *p = a.row(y);
+    const float *q = b.row(y);
+    for (int32_t x = 0; x != b.w; ++x) {
+      if (std::abs(p[x] - q[x]) > 1e-3f * std::max(1.0f, std::abs(q[x]))) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+bool Model::CheckConcatenatedDecoder() {
+  int32_t context_size = ContextSize();
+  int32_t num_hyps = 3;
+
+  ncnn::Mat decoder_input(context_size, num_hyps);
+  int32_t *p = decoder_input;
+  for (int32_t i = 0; i != context_size * num_hyps; ++i) {
+    p[i] = i;
+  }
+
+  ncnn::Mat expected = RunDecoderRowByRow(this, decoder_input);
+  ncnn::Mat actual = RunDecoderConcatenated(this, decoder_input);
+
+  return AllClose(actual, expected);
+}
+
+ncnn::Mat Model::RunDecoder2D(ncnn::Mat &decoder_input) {
+  std::call_once(concatenated_decoder_flag_, [this]() {
+    use_concatenated_decoder_ = CheckConcatenatedDecoder();
+  });
+
+  if (use_concatenated_decoder_) {
+    ncnn::Mat ans = RunDecoderConcatenated(this, decoder_input);
+    if (!ans.empty()) {
+      return ans;
+    }
+  }
+
+  return RunDecoderRowByRow(this, decoder_input);
+}
+
+// Run the joiner network once for each row of encoder_out and decoder_out.
+//
+// @return Return a 2-D tensor of shape (num_rows, vocab_size)
+static ncnn::Mat RunJoinerRowByRow(Model *model, ncnn::Mat &encoder_out,
+                                   ncnn::Mat &decoder_out) {
+  ncnn::Mat joiner_out;
+  int32_t h = encoder_out.h;
+
+  for (int32_t y = 0; y != h; ++y) {
+    ncnn::Mat encoder_out_t(encoder_out.w, encoder_out.row(y));
+    ncnn::Mat decoder_out_t(decoder_out.w, decoder_out.row(y));
+
+    ncnn::Mat tmp = model->RunJoiner(encoder_out_t, decoder_out_t);
+
+    if (y == 0) {
+      joiner_out = ncnn::Mat(tmp.w, h);
+    }
+
+    const float *ptr = tmp;
+    std::copy(ptr, ptr + tmp.w, joiner_out.row(y));
+  }
+
+  return joiner_out;
+}
+
+// Run the joiner network once for all rows. The joiner adds the projected
+// encoder and decoder outputs elementwise, so each row of the output
+// depends only on the same row of the inputs.
+//
+// @return Return a 2-D tensor of shape (num_rows, vocab_size). Return an
+//         empty tensor if the joiner output does not have the expected
+//         shape.
+static ncnn::Mat RunJoinerBatched(Model *model, ncnn::Mat &encoder_out,
+                                  ncnn::Mat &decoder_out) {
+  ncnn::Mat out = model->RunJoiner(encoder_out, decoder_out);
+  if (out.dims != 2 || out.h != encoder_out.h) {
+    return {};
+  }
+
+  return out;
+}
+
+bool Model::CheckBatchedJoiner(ncnn::Mat &encoder_out,
+                               ncnn::Mat &decoder_out) {
+  ncnn::Mat expected = RunJoinerRowByRow(this, encoder_out, decoder_out);
+  ncnn::Mat actual = RunJoinerBatched(this, encoder_out, decoder_out);
+
+  return AllClose(actual, expected);
+}
+
+ncnn::Mat Model::RunJoiner2D(ncnn::Mat &encoder_out, ncnn::Mat &decoder_out) {
+  if (encoder_out.h == 1) {
+    return RunJoinerRowByRow(this, encoder_out, decoder_out);
+  }
+
+  // It is checked with the first real input since the joiner has no
+  // input that is known to be valid, unlike the token IDs of the decoder
+  std::call_once(batched_joiner_flag_, [&]() {
+    use_batched_joiner_ = CheckBatchedJoiner(encoder_out, decoder_out);
+  });
+
+  if (use_batched_joiner_) {
+    ncnn::Mat ans = RunJoinerBatched(this, encoder_out, decoder_out);
+    if (!ans.empty()) {
+      return ans;
+    }
+  }
+
+  return RunJoinerRowByRow(this, encoder_out, decoder_out);
+}
+
 void Model::RegisterCustomLayers(ncnn::Net &net) {
   RegisterMetaDataLayer(net);
 
+#ifndef SHERPA_NCNN_DISABLE_ZIPFORMER
   RegisterPoolingModuleNoProjLayer(net);   // for zipformer only
   RegisterTensorAsStridedLayer(net);       // for zipformer only
   RegisterTensorSimpleUpsampleLayer(net);  // for zipformer only
   RegisterStackLayer(net);                 // for zipformer only
+#endif
+}
+
+void Model::LoadNet(ncnn::Net &net, const std::string &param,
+                    const std::string &bin) {
+  if (bundle_) {
+    if (!bundle_->LoadNet(param, bin, &net)) {
+      NCNN_LOGE("failed to load %s and %s from the model bundle",
+                param.c_str(), bin.c_str());
+      exit(-1);
+    }
+
+    std::size_t size = 0;
+    bundle_->GetSection(bin, &size);
+    weight_bytes_.emplace_back(&net, size);
+    return;
+  }
+
+  if (!use_mmap_ && !use_huge_pages_) {
+    InitNet(net, param, bin);
+
+    std::ifstream is(bin, std::ios::binary | std::ios::ate);
+    weight_bytes_.emplace_back(
+        &net, is ? static_cast<std::size_t>(is.tellg()) : 0);
+    return;
+  }
+
+  std::unique_ptr<MappedFile> mapped_bin;
+  InitNet(net, param, bin, &mapped_bin, use_huge_pages_);
+  weight_bytes_.emplace_back(&net, mapped_bin->Size());
+  mapped_files_.push_back(std::move(mapped_bin));
 }
 
-std::unique_ptr<Model> Model::Create(const ModelConfig &config) {
+void Model::InitOptions(const ModelConfig &config,
+                        std::shared_ptr<const ModelBundle> bundle) {
+  use_mmap_ = config.use_mmap;
+  use_huge_pages_ = config.use_huge_pages;
+  bundle_ = std::move(bundle);
+
+  if (!config.use_pool_allocator && config.arena_mb <= 0) {
+    return;
+  }
+
+  memory_pools_ = std::make_unique<ModelMemoryPools>(
+      config.pool_per_thread, config.pool_limit_mb, config.use_huge_pages,
+      config.arena_mb);
+}
+
+void Model::InitEncoderStateLayout() {
+  std::vector<ncnn::Mat> states = GetEncoderInitStates();
+  encoder_state_layout_ = EncoderStateLayout(states);
+  if (!encoder_state_layout_.Empty()) {
+    packed_encoder_init_states_ = encoder_state_layout_.Pack(states);
+  }
+}
+
+bool Model::SetPrecision(const std::string &precision, ncnn::Option *opt) {
+  if (precision.empty()) {
+    return true;
+  }
+
+  bool balanced = precision == "balanced";
+  bool speed = precision == "speed";
+  if (precision != "accuracy" && !balanced && !speed) {
+    return false;
+  }
+
+  // ncnn falls back to fp32 for layers and hardware without fp16 or bf16
+  opt->use_fp16_packed = balanced || speed;
+  opt->use_fp16_storage = balanced || speed;
+  opt->use_bf16_storage = balanced || speed;
+  opt->use_fp16_arithmetic = speed;
+  opt->use_packing_layout = true;
+
+  return true;
+}
+
+bool Model::SetDevice(const std::string &device, ncnn::Option *opt) {
+  if (device != "gpu" && device != "cpu") {
+    return false;
+  }
+
+  bool has_gpu = false;
+#if NCNN_VULKAN
+  has_gpu = ncnn::get_gpu_count() > 0;
+#endif
+
+  if (device == "gpu" && !has_gpu) {
+    NCNN_LOGE("There is no GPU. Use the CPU instead");
+  }
+
+  opt->use_vulkan_compute = device == "gpu" && has_gpu;
+
+  return true;
+}
+
+void Model::ApplyPerfProfile(const PerfProfile &profile,
+                             ModelConfig *config) {
+  struct Net {
+    const char *name;
+    std::string ModelConfig::*device;
+    std::string ModelConfig::*precision;
+    ncnn::Option ModelConfig::*opt;
+  };
+
+  const std::array<Net, 3> nets = {{
+      {"encoder", &ModelConfig::encoder_device,
+       &ModelConfig::encoder_precision, &ModelConfig::encoder_opt},
+      {"decoder", &ModelConfig::decoder_device,
+       &ModelConfig::decoder_precision, &ModelConfig::decoder_opt},
+      {"joiner", &ModelConfig::joiner_device, &ModelConfig::joiner_precision,
+       &ModelConfig::joiner_opt},
+  }};
+
+  for (const auto &net : nets) {
+    const NetTuning *t = profile.Get(net.name);
+    if (!t) {
+      continue;
+    }
+
+    config->*net.device = t->device;
+    config->*net.precision = t->precision;
+
+    ncnn::Option &opt = config->*net.opt;
+    opt.num_threads = t->num_threads;
+    opt.use_winograd_convolution = t->use_winograd_convolution;
+    opt.use_sgemm_convolution = t->use_sgemm_convolution;
+  }
+}
+
+void Model::InitDevices(const ModelConfig &config) {
+  bool has_gpu = false;
+#if NCNN_VULKAN
+  has_gpu = ncnn::get_gpu_count() > 0;
+#endif
+
+  bool use_gpu = has_gpu && config.use_vulkan_compute;
+
+  const std::array<std::pair<ncnn::Net *, const std::string *>, 3> nets = {{
+      {&GetEncoder(), &config.encoder_device},
+      {&GetDecoder(), &config.decoder_device},
+      {&GetJoiner(), &config.joiner_device},
+  }};
+
+  bool any_gpu = false;
+  for (const auto &p : nets) {
+    const std::string &device = *p.second;
+    if (device != "gpu" && device != "cpu" && device != "auto") {
+      NCNN_LOGE("Unknown device '%s'. Please use gpu, cpu or auto",
+                device.c_str());
+      exit(-1);
+    }
+
+    if (use_gpu && device != "cpu") {
+      p.first->opt.use_vulkan_compute = true;
+      any_gpu = true;
+    }
+  }
+
+  if (any_gpu) {
+    NCNN_LOGE("Use GPU");
+  }
+
+  const std::array<std::pair<ncnn::Net *, const std::string *>, 3>
+      precisions = {{
+          {&GetEncoder(), &config.encoder_precision},
+          {&GetDecoder(), &config.decoder_precision},
+          {&GetJoiner(), &config.joiner_precision},
+      }};
+
+  for (const auto &p : precisions) {
+    if (!SetPrecision(*p.second, &p.first->opt)) {
+      NCNN_LOGE(
+          "Unknown precision '%s'. Please use accuracy, balanced or speed",
+          p.second->c_str());
+      exit(-1);
+    }
+  }
+
+  affinity_ = {{&GetEncoder(), config.encoder_powersave},
+               {&GetDecoder(), config.decoder_powersave},
+               {&GetJoiner(), config.joiner_powersave}};
+
+  for (const auto &p : affinity_) {
+    if (p.second < 0 || p.second > 2) {
+      NCNN_LOGE("Invalid powersave %d. Please use 0, 1 or 2", p.second);
+      exit(-1);
+    }
+  }
+
+  if (config.cpu_cores.empty()) {
+    return;
+  }
+
+  std::vector<int32_t> cores;
+  if (!SplitStringToIntegers(config.cpu_cores, ",", true, &cores) ||
+      cores.empty()) {
+    NCNN_LOGE("Invalid cpu_cores '%s'", config.cpu_cores.c_str());
+    exit(-1);
+  }
+
+  int32_t num_cpus = ncnn::get_cpu_count();
+  cpu_set_.disable_all();
+  for (int32_t c : cores) {
+    if (c < 0 || c >= num_cpus) {
+      NCNN_LOGE("Invalid CPU core %d in cpu_cores. There are %d cores", c,
+                num_cpus);
+      exit(-1);
+    }
+    cpu_set_.enable(c);
+  }
+
+  // 0, 1 and 2 are the powersave values
+  static std::atomic<int32_t> next_id{3};
+  int32_t id = next_id++;
+
+  int32_t num_enabled = cpu_set_.num_enabled();
+  for (auto &p : affinity_) {
+    p.second = id;
+  }
+
+  // More threads than cores only make them wait for each other
+  for (const auto &p : nets) {
+    p.first->opt.num_threads =
+        std::min(p.first->opt.num_threads, num_enabled);
+  }
+}
+
+void Model::SetThreadAffinity(const ncnn::Net &net) const {
+  int32_t affinity = 0;
+  for (const auto &p : affinity_) {
+    if (p.first == &net) {
+      affinity = p.second;
+    }
+  }
+
+  // Setting the affinity takes a system call per thread, so it is done
+  // only when the calling thread runs a network on other cores than the
+  // last one. Threads start on all cores.
+  static thread_local int32_t current_affinity = 0;
+  if (affinity == current_affinity) {
+    return;
+  }
+
+  ncnn::set_cpu_thread_affinity(
+      affinity > 2 ? cpu_set_ : ncnn::get_cpu_thread_affinity_mask(affinity));
+  current_affinity = affinity;
+}
+
+// See Model::SetThreadNumThreads()
+static thread_local int32_t thread_num_threads = 0;
+
+void Model::SetThreadNumThreads(int32_t num_threads) {
+  thread_num_threads = num_threads;
+}
+
+ncnn::Extractor Model::CreateExtractor(const ncnn::Net &net) const {
+  SetThreadAffinity(net);
+
+  ncnn::Extractor ex = net.create_extractor();
+  if (thread_num_threads > 0) {
+    ex.set_num_threads(thread_num_threads);
+  }
+
+  if (memory_pools_) {
+    memory_pools_->Attach(&ex);
+  }
+  return ex;
+}
+
+std::size_t Model::MemoryPoolHighWaterMark() const {
+  return memory_pools_ ? memory_pools_->HighWaterMark() : 0;
+}
+
+ModelMemoryUsage Model::GetMemoryUsage() const {
+  // The getters of the networks do not change the model
+  auto *self = const_cast<Model *>(this);
+
+  auto weights = [this](const ncnn::Net &net) -> std::size_t {
+    for (const auto &p : weight_bytes_) {
+      if (p.first == &net) return p.second;
+    }
+    return 0;
+  };
+
+  ModelMemoryUsage ans;
+  ans.encoder_weights = weights(self->GetEncoder());
+  ans.decoder_weights = weights(self->GetDecoder());
+  ans.joiner_weights = weights(self->GetJoiner());
+
+  if (memory_pools_) {
+    ans.blob_high_water_mark = memory_pools_->BlobHighWaterMark();
+    ans.workspace_high_water_mark = memory_pools_->WorkspaceHighWaterMark();
+  }
+
+  return ans;
+}
+
+ncnn::Mat Model::Detach(const ncnn::Mat &m) const {
+  return memory_pools_ ? memory_pools_->Detach(m) : m;
+}
+
+void Model::CopyTo(const ncnn::Mat &src, ncnn::Mat *dst) const {
+  bool same_shape = !dst->empty() && dst->dims == src.dims &&
+                    dst->w == src.w && dst->h == src.h && dst->d == src.d &&
+                    dst->c == src.c && dst->elemsize == src.elemsize &&
+                    dst->elempack == src.elempack && dst->cstep == src.cstep;
+
+  // Keep packed states packed, see EncoderStateLayout
+  if (same_shape && IsWritablePackedState(*dst)) {
+    if (src.data != dst->data) {
+      std::memcpy(dst->data, src.data, src.total() * src.elemsize);
+    }
+    return;
+  }
+
+  if (!memory_pools_ || !memory_pools_->Owns(src)) {
+    // src is not from the memory pool, so we can keep it as it is
+    *dst = src;
+    return;
+  }
+
+  // Only mats using the default allocator are reused, since they may be
+  // kept after the model is destroyed
+  bool reuse = same_shape && dst->allocator == nullptr && dst->refcount &&
+               *dst->refcount == 1;
+
+  if (!reuse) {
+    *dst = src.clone();
+    return;
+  }
+
+  const auto *p = static_cast<const unsigned char *>(src.data);
+  std::copy(p, p + src.total() * src.elemsize,
+            static_cast<unsigned char *>(dst->data));
+}
+
+int32_t FindBlob(const ncnn::Net &net, const std::string &name) {
+  const auto &blobs = net.blobs();
+  for (int32_t i = 0; i != static_cast<int32_t>(blobs.size()); ++i) {
+    if (blobs[i].name == name) return i;
+  }
+  return -1;
+}
+
+void Model::InitEarlyExit(float threshold, const ncnn::Net &encoder,
+                          int32_t num_outputs) {
+  if (threshold <= 0) {
+    return;
+  }
+
+  int32_t blank_index = -1;
+  std::vector<int32_t> output_indexes(num_outputs, -1);
+
+  const auto &blobs = encoder.blobs();
+  for (int32_t i = 0; i != static_cast<int32_t>(blobs.size()); ++i) {
+    const std::string &name = blobs[i].name;
+    if (name == "early_blank") {
+      blank_index = i;
+    } else if (name.compare(0, 9, "early_out") == 0) {
+      int32_t k = std::atoi(name.c_str() + 9);
+      if (k >= 0 && k < num_outputs) {
+        output_indexes[k] = i;
+      }
+    }
+  }
+
+  if (blank_index == -1 ||
+      std::count(output_indexes.begin(), output_indexes.end(), -1) != 0) {
+    NCNN_LOGE(
+        "The encoder has no early blank head with %d early outputs. Ignore "
+        "early_exit_threshold",
+        num_outputs);
+    return;
+  }
+
+  early_exit_threshold_ = threshold;
+  early_blank_index_ = blank_index;
+  early_output_indexes_ = std::move(output_indexes);
+}
+
+const std::vector<int32_t> *Model::EarlyExit(ncnn::Extractor *ex) const {
+  if (early_blank_index_ == -1) {
+    return nullptr;
+  }
+
+  // Only the layers up to the head are run here
+  ncnn::Mat blank;
+  if (ex->extract(early_blank_index_, blank) != 0 || blank.empty()) {
+    return nullptr;
+  }
+
+  int32_t n = blank.w * blank.h * blank.d;
+  for (int32_t c = 0; c != blank.c; ++c) {
+    const float *p = blank.channel(c);
+    for (int32_t i = 0; i != n; ++i) {
+      if (p[i] < early_exit_threshold_) {
+        return nullptr;
+      }
+    }
+  }
+
+  ++num_early_exits_;
+  return &early_output_indexes_;
+}
+
+static std::unique_ptr<Model> CreateFromBundle(const ModelConfig &config) {
+  std::shared_ptr<const ModelBundle> bundle = config.buffers;
+  if (!bundle) {
+    bundle = ModelBundle::Open(config.bundle);
+  }
+
+  if (!bundle) {
+    return nullptr;
+  }
+
+  const char *name = config.buffers ? "the buffers" : config.bundle.c_str();
+
+  // The subclasses load their networks from these sections
+  ModelConfig c = config;
+  c.encoder_param = "encoder.ncnn.param";
+  c.encoder_bin = "encoder.ncnn.bin";
+  c.decoder_param = "decoder.ncnn.param";
+  c.decoder_bin = "decoder.ncnn.bin";
+  c.joiner_param = "joiner.ncnn.param";
+  c.joiner_bin = "joiner.ncnn.bin";
+
+  const auto *param = bundle->GetSection(c.encoder_param);
+  if (!param) {
+    NCNN_LOGE("Failed to load %s from %s", c.encoder_param.c_str(), name);
+    return nullptr;
+  }
+
+  const ModelFactory *f =
+      FindModelFactory(reinterpret_cast<const char *>(param));
+  if (f) {
+    return f->create(c, std::move(bundle));
+  }
+
+  NCNN_LOGE("Unable to create a model from %s", name);
+
+  return nullptr;
+}
+
+static std::unique_ptr<Model> CreateModel(const ModelConfig &config) {
   // 1. Load the encoder network
   // 2. If the encoder network has LSTM layers, we assume it is a LstmModel
   // 3. Otherwise, we assume it is a ConvEmformer
   // 4. TODO(fangjun): We need to change this function to support more models
   // in the future
 
-  ncnn::Net net;
-  RegisterCustomLayers(net);
+  if (config.buffers || !config.bundle.empty()) {
+    return CreateFromBundle(config);
+  }
 
-  auto ret = net.load_param(config.encoder_param.c_str());
-  if (ret != 0) {
+  std::vector<char> param = ReadFile(config.encoder_param);
+  if (param.empty()) {
     NCNN_LOGE("Failed to load %s", config.encoder_param.c_str());
     return nullptr;
   }
+  param.push_back('\0');
+
+  const ModelFactory *f = FindModelFactory(param.data());
+  if (f) {
+    return f->create(config, nullptr);
+  }
+
+  LogUnknownModel();
+
+  return nullptr;
+}
+
+using ModelCreator = std::function<std::unique_ptr<Model>(const ModelConfig &)>;
+
+// Return the mean time in ms of running the encoder, the decoder and the
+// joiner of model on a chunk of silence
+// Run the networks of model once on silence. Return the time of each of
+// them in ms.
+static std::array<double, 3> RunNetsOnce(Model *model) {
+  using Clock = std::chrono::steady_clock;
+
+  // The feature dim of all our models. See FeatureExtractorConfig
+  int32_t feature_dim = 80;
+
+  ncnn::Mat features(feature_dim, model->Segment());
+  features.fill(0.f);
+
+  ncnn::Mat decoder_input(model->ContextSize());
+  for (int32_t i = 0; i != model->ContextSize(); ++i) {
+    static_cast<int32_t *>(decoder_input)[i] = model->BlankId();
+  }
+
+  std::vector<ncnn::Mat> states = model->GetEncoderInitStates();
+
+  auto t0 = Clock::now();
+  ncnn::Mat encoder_out = model->RunEncoder(features, states).first;
+
+  auto t1 = Clock::now();
+  ncnn::Mat decoder_out = model->RunDecoder(decoder_input);
+
+  auto t2 = Clock::now();
+  ncnn::Mat encoder_out_t(encoder_out.w, encoder_out.row(0));
+  model->RunJoiner(encoder_out_t, decoder_out);
+
+  auto t3 = Clock::now();
+
+  return {std::chrono::duration<double, std::milli>(t1 - t0).count(),
+          std::chrono::duration<double, std::milli>(t2 - t1).count(),
+          std::chrono::duration<double, std::milli>(t3 - t2).count()};
+}
+
+void Model::WarmUp() { RunNetsOnce(this); }
+
+static std::array<double, 3> TimeNets(Model *model) {
+  model->WarmUp();
+
+  std::array<double, 3> ms = {0, 0, 0};
+
+  constexpr int32_t kNumRuns = 10;
+  for (int32_t r = 0; r != kNumRuns; ++r) {
+    std::array<double, 3> t = RunNetsOnce(model);
+    for (int32_t i = 0; i != 3; ++i) {
+      ms[i] += t[i];
+    }
+  }
 
-  if (IsLstmModel(net)) {
-    return std::make_unique<LstmModel>(config);
+  for (auto &t : ms) {
+    t /= kNumRuns;
   }
 
-  if (IsConvEmformerModel(net)) {
-    return std::make_unique<ConvEmformerModel>(config);
+  return ms;
+}
+
+// Return the file in ModelConfig::cache_dir for the placement of config.
+// Its name is a hash of config, the sizes of the model files and the GPU.
+static std::string GetPlacementFile(const ModelConfig &config) {
+  ModelConfig c = config;
+  c.cache_dir.clear();
+
+  std::ostringstream os;
+  os << c.ToString();
+
+  for (const std::string *f :
+       {&config.encoder_param, &config.encoder_bin, &config.decoder_param,
+        &config.decoder_bin, &config.joiner_param, &config.joiner_bin,
+        &config.bundle}) {
+    // Files of Android assets cannot be opened. Their paths are still
+    // part of the key.
+    std::ifstream is(*f, std::ios::binary | std::ios::ate);
+    os << "|" << (is ? static_cast<int64_t>(is.tellg()) : -1);
   }
 
-  if (IsZipformerModel(net)) {
-    return std::make_unique<ZipformerModel>(config);
+#if NCNN_VULKAN
+  const ncnn::GpuInfo &info = ncnn::get_gpu_info();
+  os << "|" << info.device_name() << "|" << info.vendor_id() << ":"
+     << info.device_id() << "|" << info.driver_version();
+#endif
+
+  std::ostringstream name;
+  name << config.cache_dir << "/" << std::hex << std::setw(16)
+       << std::setfill('0') << Fnv1a(os.str()) << ".placement";
+  return name.str();
+}
+
+// A placement file contains the devices of the encoder, decoder and joiner
+static bool ReadPlacement(const std::string &filename,
+                          std::array<std::string, 3> *devices) {
+  std::ifstream is(filename);
+  for (auto &d : *devices) {
+    if (!(is >> d) || (d != "gpu" && d != "cpu")) {
+      return false;
+    }
   }
 
-  NCNN_LOGE(
-      "Unable to create a model from specified model files.\n"
-      "Please check: \n"
-      "  1. If you are using a ConvEmformer/Zipformer/LSTM model, please "
-      "make "
-      "sure "
-      "you have added SherapMetaData to encoder_xxx.ncnn.param "
-      "(or encoder_xxx.ncnn.int8.param if you are using an int8 model). "
-      "You need to add it manually after converting the model with pnnx.\n"
-      "  2. (Android) Whether the app requires an int8 model or not\n");
+  return true;
+}
 
-  return nullptr;
+static void WritePlacement(const std::string &filename,
+                           const std::array<std::string, 3> &devices) {
+  // Write to another file and rename it, so that a model loaded at the
+  // same time never sees a partial file
+  std::string tmp = filename + ".tmp";
+  {
+    std::ofstream os(tmp);
+    os << devices[0] << " " << devices[1] << " " << devices[2] << "\n";
+    if (!os) {
+      NCNN_LOGE("Failed to write %s", tmp.c_str());
+      os.close();
+      std::remove(tmp.c_str());
+      return;
+    }
+  }
+
+  if (std::rename(tmp.c_str(), filename.c_str()) != 0) {
+    NCNN_LOGE("Failed to rename %s to %s", tmp.c_str(), filename.c_str());
+    std::remove(tmp.c_str());
+  }
 }
 
-#if __ANDROID_API__ >= 9
-std::unique_ptr<Model> Model::Create(AAssetManager *mgr,
-                                     const ModelConfig &config) {
-  ncnn::Net net;
-  RegisterCustomLayers(net);
+// Replace "auto" in ModelConfig::encoder_device, etc., by the faster
+// device and create the model. If ModelConfig::cache_dir is not empty,
+// the choice is saved there and the timing is skipped when the same model
+// is loaded again on the same device.
+static std::unique_ptr<Model> CreateAutoPlaced(const ModelConfig &config,
+                                               const ModelCreator &create) {
+  const std::array<std::string ModelConfig::*, 3> devices = {
+      &ModelConfig::encoder_device, &ModelConfig::decoder_device,
+      &ModelConfig::joiner_device};
 
-  auto ret = net.load_param(mgr, config.encoder_param.c_str());
-  if (ret != 0) {
-    NCNN_LOGE("Failed to load %s", config.encoder_param.c_str());
+  ModelConfig gpu_config = config;
+  ModelConfig cpu_config = config;
+  for (auto d : devices) {
+    if (config.*d == "auto") {
+      gpu_config.*d = "gpu";
+      cpu_config.*d = "cpu";
+    }
+  }
+
+  bool has_gpu = false;
+#if NCNN_VULKAN
+  has_gpu = ncnn::get_gpu_count() > 0;
+#endif
+
+  if (!has_gpu || !config.use_vulkan_compute) {
+    return create(cpu_config);
+  }
+
+  std::string placement_file;
+  if (!config.cache_dir.empty()) {
+    placement_file = GetPlacementFile(config);
+
+    std::array<std::string, 3> cached;
+    if (ReadPlacement(placement_file, &cached)) {
+      NCNN_LOGE("Use the devices in %s", placement_file.c_str());
+
+      ModelConfig best = config;
+      for (int32_t i = 0; i != 3; ++i) {
+        best.*devices[i] = cached[i];
+      }
+      return create(best);
+    }
+  }
+
+  std::array<double, 3> gpu_ms;
+  {
+    auto model = create(gpu_config);
+    if (!model) {
+      return nullptr;
+    }
+    gpu_ms = TimeNets(model.get());
+  }
+
+  auto model = create(cpu_config);
+  if (!model) {
     return nullptr;
   }
+  std::array<double, 3> cpu_ms = TimeNets(model.get());
 
-  if (IsLstmModel(net)) {
-    return std::make_unique<LstmModel>(mgr, config);
+  const char *names[] = {"encoder", "decoder", "joiner"};
+
+  ModelConfig best = config;
+  bool all_cpu = true;
+  for (int32_t i = 0; i != 3; ++i) {
+    auto d = devices[i];
+    if (config.*d != "auto") {
+      continue;
+    }
+
+    best.*d = gpu_ms[i] < cpu_ms[i] ? "gpu" : "cpu";
+    all_cpu = all_cpu && best.*d == "cpu";
+
+    NCNN_LOGE("%s: %.3f ms on GPU, %.3f ms on CPU. Use %s", names[i],
+              gpu_ms[i], cpu_ms[i], (best.*d).c_str());
   }
 
-  if (IsConvEmformerModel(net)) {
-    return std::make_unique<ConvEmformerModel>(mgr, config);
+  if (!placement_file.empty()) {
+    WritePlacement(placement_file, {best.encoder_device, best.decoder_device,
+                                    best.joiner_device});
   }
 
-  if (IsZipformerModel(net)) {
-    return std::make_unique<ZipformerModel>(mgr, config);
+  if (all_cpu) {
+    return model;
   }
 
-  NCNN_LOGE(
-      "Unable to create a model from specified model files.\n"
-      "Please check: \n"
-      "  1. If you are using a ConvEmformer/Zipformer/LSTM model, please "
-      "make "
-      "sure "
-      "you have added SherapMetaData to encoder_xxx.ncnn.param "
-      "(or encoder_xxx.ncnn.int8.param if you are using an int8 model). "
-      "You need to add it manually after converting the model with pnnx.\n"
-      "  2. (Android) Whether the app requires an int8 model or not\n");
+  // Release the memory of the probe first
+  model.reset();
+
+  return create(best);
+}
+
+static bool HasAutoDevice(const ModelConfig &config) {
+  return config.encoder_device == "auto" ||
+         config.decoder_device == "auto" || config.joiner_device == "auto";
+}
+
+// Run the encoder of model on ModelConfig::remote_encoder if it is set
+static std::unique_ptr<Model> WrapRemoteEncoder(const ModelConfig &config,
+                                                std::unique_ptr<Model> model) {
+  if (!model || config.remote_encoder.empty()) {
+    return model;
+  }
+
+#ifndef _WIN32
+  return std::make_unique<RemoteEncoderModel>(std::move(model),
+                                              config.remote_encoder);
+#else
+  NCNN_LOGE("remote_encoder is not supported on Windows. Ignore it");
+  return model;
+#endif
+}
+
+// Return config with the options of ModelConfig::perf_profile
+static ModelConfig WithPerfProfile(const ModelConfig &config) {
+  ModelConfig ans = config;
+  if (config.perf_profile.empty()) {
+    return ans;
+  }
+  ans.perf_profile.clear();
+
+  PerfProfile profile;
+  if (!profile.Read(config.perf_profile)) {
+    NCNN_LOGE("Ignore the performance profile %s",
+              config.perf_profile.c_str());
+    return ans;
+  }
+
+  Model::ApplyPerfProfile(profile, &ans);
+
+  return ans;
+}
+
+std::unique_ptr<Model> Model::Create(const ModelConfig &in_config) {
+  ModelConfig config = WithPerfProfile(in_config);
+  if (HasAutoDevice(config)) {
+    return WrapRemoteEncoder(
+        config, CreateAutoPlaced(config, [](const ModelConfig &c) {
+          return CreateModel(c);
+        }));
+  }
+
+  return WrapRemoteEncoder(config, CreateModel(config));
+}
+
+#if __ANDROID_API__ >= 9
+static std::unique_ptr<Model> CreateModel(AAssetManager *mgr,
+                                          const ModelConfig &config) {
+  if (config.buffers) {
+    return CreateFromBundle(config);
+  }
+
+  std::vector<char> param = ReadFile(mgr, config.encoder_param);
+  if (param.empty()) {
+    NCNN_LOGE("Failed to load %s", config.encoder_param.c_str());
+    return nullptr;
+  }
+  param.push_back('\0');
+
+  const ModelFactory *f = FindModelFactory(param.data());
+  if (f) {
+    return f->create_from_assets(mgr, config);
+  }
+
+  LogUnknownModel();
 
   return nullptr;
 }
+
+std::unique_ptr<Model> Model::Create(AAssetManager *mgr,
+                                     const ModelConfig &in_config) {
+  ModelConfig config = WithPerfProfile(in_config);
+  if (HasAutoDevice(config)) {
+    return WrapRemoteEncoder(
+        config, CreateAutoPlaced(config, [mgr](const ModelConfig &c) {
+          return CreateModel(mgr, c);
+        }));
+  }
+
+  return WrapRemoteEncoder(config, CreateModel(mgr, config));
+}
 #endif
 
 }  // namespace sherpa_ncnn
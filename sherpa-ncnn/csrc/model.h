@@ -19,15 +19,34 @@
 #ifndef SHERPA_NCNN_CSRC_MODEL_H_
 #define SHERPA_NCNN_CSRC_MODEL_H_
 
+#include <atomic>
 #include <memory>
+#include <mutex>  // NOLINT
 #include <string>
 #include <utility>
 #include <vector>
 
-#include "net.h"  // NOLINT
+#include "allocator.h"  // NOLINT
+#include "cpu.h"        // NOLINT
+#include "net.h"        // NOLINT
+#include "sherpa-ncnn/csrc/device-states.h"
+#include "sherpa-ncnn/csrc/encoder-state-layout.h"
+#include "sherpa-ncnn/csrc/mapped-file.h"
+#include "sherpa-ncnn/csrc/memory-pool.h"
+#include "sherpa-ncnn/csrc/memory-usage.h"
+#include "sherpa-ncnn/csrc/model-bundle.h"
 
 namespace sherpa_ncnn {
 
+class PerfProfile;
+
+// The same encoder exported with another chunk size, see
+// ModelConfig::encoder_variants
+struct EncoderVariant {
+  std::string param;  // path to encoder.ncnn.param
+  std::string bin;    // path to encoder.ncnn.bin
+};
+
 struct ModelConfig {
   std::string encoder_param;  // path to encoder.ncnn.param
   std::string encoder_bin;    // path to encoder.ncnn.bin
@@ -36,8 +55,146 @@ struct ModelConfig {
   std::string joiner_param;   // path to joiner.ncnn.param
   std::string joiner_bin;     // path to joiner.ncnn.bin
   std::string tokens;         // path to tokens.txt
+
+  // Path to a model bundle created by sherpa-ncnn-pack-model. If it is not
+  // empty, the networks and the tokens are loaded from it and the paths
+  // above are ignored. See model-bundle.h. Not supported for Android assets.
+  std::string bundle;
+
+  // If not null, the networks and the tokens are loaded from these buffers
+  // in memory instead, see ModelBundle::FromBuffers(). The sections have
+  // the names of those of a bundle, except that tokens may also be the
+  // content of tokens.txt. If there is no tokens section, the file tokens
+  // is used. The buffers must outlive the model.
+  std::shared_ptr<const ModelBundle> buffers;
+
+  // Optional. The encoder exported with other chunk sizes, e.g., a small
+  // chunk for interactive streams and a large one for batch transcription.
+  // The chunk size is fixed when an encoder is exported, so each one is a
+  // separate network; the decoder and joiner of encoder_param are used for
+  // all of them. A stream chooses one when it is created, see
+  // Recognizer::CreateStreamWithChunkSize(). Used only by
+  // Recognizer(const RecognizerConfig &) with files on disk.
+  std::vector<EncoderVariant> encoder_variants;
+
   bool use_vulkan_compute = true;
 
+  // Where each network runs if use_vulkan_compute is true and there is a
+  // GPU: "gpu", "cpu" or "auto". On mobile GPUs, the small decoder and
+  // joiner are often faster on the CPU because of the dispatch overhead.
+  // With "auto", Model::Create() times the network on both at load time
+  // and uses the faster one.
+  std::string encoder_device = "gpu";
+  std::string decoder_device = "gpu";
+  std::string joiner_device = "gpu";
+
+  // The CPU cores each network runs on, as in ncnn::set_cpu_powersave():
+  // 0 for all cores, 1 for the little cores and 2 for the big cores.
+  // The number of threads of a network is set in encoder_opt, etc.
+  int32_t encoder_powersave = 0;
+  int32_t decoder_powersave = 0;
+  int32_t joiner_powersave = 0;
+
+  // Comma separated ids of the CPU cores all networks of this model run on,
+  // e.g., "4,5,6,7". If not empty, it overrides the powersave options above
+  // and the number of threads of each network is at most the number of
+  // cores. Give each recognizer of a process its own cores so that they
+  // do not compete for the same ones.
+  std::string cpu_cores;
+
+  // If not empty, the devices chosen for "auto" in encoder_device, etc.,
+  // are saved in this directory, which must exist, and reused when the same
+  // model is loaded with the same config on the same GPU, so that the
+  // networks are not timed at every start.
+  std::string cache_dir;
+
+  // If not empty, a file written by sherpa-ncnn-autotune for this model on
+  // this device. The device, precision, number of threads and convolution
+  // options of the networks in it replace those of this config. See
+  // PerfProfile.
+  std::string perf_profile;
+
+  // If true, intermediate blobs and workspace of the encoder, decoder and
+  // joiner networks are allocated from memory pools owned by the model,
+  // so that no heap allocation happens in the networks once the pools
+  // are warmed up.
+  bool use_pool_allocator = true;
+
+  // Used only if use_pool_allocator is true. If true, each thread that
+  // runs the networks has its own pools, which need no lock. Otherwise,
+  // the pools are shared by all threads.
+  bool pool_per_thread = false;
+
+  // Used only if use_pool_allocator is true. If positive, each pool keeps
+  // freed memory only while it holds at most this many MB, so that a
+  // long-running process does not keep the memory of its largest inputs.
+  // See Model::MemoryPoolHighWaterMark() to choose it.
+  int32_t pool_limit_mb = 0;
+
+  // If positive, intermediate blobs and workspace of the networks are
+  // allocated from a fixed arena of this many MB that is allocated once
+  // when the model is loaded, instead of from the memory pools above. A
+  // run that needs more memory fails and logs an error instead of
+  // allocating from the heap, so memory use is bounded and the heap is
+  // not fragmented by long runs, e.g., on embedded boards. Size it from
+  // Model::MemoryPoolHighWaterMark() of a run with the memory pools plus
+  // some headroom. It overrides use_pool_allocator.
+  int32_t arena_mb = 0;
+
+  // If true, the .bin files are memory-mapped and the networks use the
+  // weights in the mappings instead of reading the whole files into memory.
+  // See LoadModelFromMappedFile(). Not used for models loaded from
+  // Android assets.
+  bool use_mmap = false;
+
+  // If true, the .bin files are read into memory backed by huge pages, see
+  // AllocateHugePages(), and the networks use the weights there as with
+  // use_mmap, which it overrides. Chunks of the memory pools of at least
+  // 2 MB are also allocated in huge pages. It saves TLB misses of large
+  // encoders. Weights that ncnn copies or repacks when loading a network
+  // are in ordinary pages. Not used for models loaded from Android assets
+  // or from a bundle.
+  bool use_huge_pages = false;
+
+  // Used only by LSTM models. The encoder of an LSTM model takes chunks of
+  // 4 output frames, plus 5 frames of right context, per run. It accepts
+  // longer inputs, so with this option set to n, each run takes n chunks,
+  // i.e., 4 * n + 5 frames, and advances by 4 * n frames. The results are
+  // the same since the states are carried from frame to frame within a
+  // run as well; a larger n costs fewer runs and larger matrix products
+  // per run, for 40 * (n - 1) ms more latency. Keep it at 1 for an
+  // encoder exported with a fixed input length.
+  int32_t lstm_chunks_per_run = 1;
+
+  // Used only by zipformer and conv-emformer models whose encoder is
+  // exported with an early blank head: a blob "early_blank" with the
+  // blank probability of each output frame from an intermediate CTC head,
+  // and for each output "outK" a blob "early_outK" computed only from the
+  // layers up to the head, e.g., the states of the remaining layers
+  // carried forward with a cheap update. If positive and all values of
+  // early_blank of a chunk are at least this threshold, early_outK are
+  // extracted instead of outK, so the remaining layers are not run for
+  // the chunk. Encoders without the head ignore it. Not used with the
+  // batched encoder on the GPU.
+  float early_exit_threshold = 0;
+
+  // The precision and memory layout of each network:
+  //  - "accuracy": weights, blobs and arithmetic are fp32
+  //  - "balanced": weights and blobs are stored in fp16, or in bf16 on CPUs
+  //    without fp16, and the arithmetic is fp32
+  //  - "speed": the arithmetic is also fp16 where the hardware supports
+  //    it, e.g., ARMv8.2 CPUs and most GPUs
+  // All of them use the packed layout. If empty, use_fp16_storage, etc.,
+  // of encoder_opt, decoder_opt and joiner_opt are used as they are.
+  std::string encoder_precision;
+  std::string decoder_precision;
+  std::string joiner_precision;
+
+  // If not empty, "host:port" of a sherpa-ncnn-encoder-server that runs
+  // the encoder, see RemoteEncoderModel. The server should use the same
+  // model. Not supported on Windows.
+  std::string remote_encoder;
+
   ncnn::Option encoder_opt;
   ncnn::Option decoder_opt;
   ncnn::Option joiner_opt;
@@ -51,6 +208,19 @@ class Model {
 
   static void RegisterCustomLayers(ncnn::Net &net);
 
+  // Set the precision and layout options of opt for a profile of
+  // ModelConfig::encoder_precision. Return false if it is unknown.
+  static bool SetPrecision(const std::string &precision, ncnn::Option *opt);
+
+  // Set use_vulkan_compute of opt for "gpu" or "cpu". With "gpu", the CPU
+  // is used if there is no GPU. Return false if device is unknown.
+  static bool SetDevice(const std::string &device, ncnn::Option *opt);
+
+  // Replace the options of the encoder, decoder and joiner of config by
+  // those in profile, see ModelConfig::perf_profile
+  static void ApplyPerfProfile(const PerfProfile &profile,
+                               ModelConfig *config);
+
   /** Create a model from a config. */
   static std::unique_ptr<Model> Create(const ModelConfig &config);
 
@@ -70,6 +240,19 @@ class Model {
 
   virtual std::vector<ncnn::Mat> GetEncoderInitStates() const = 0;
 
+  // Return the packed layout of the encoder states. It is empty if the
+  // model does not provide one. See EncoderStateLayout.
+  const EncoderStateLayout &GetEncoderStateLayout() const {
+    return encoder_state_layout_;
+  }
+
+  // Return GetEncoderInitStates() packed with GetEncoderStateLayout(). It
+  // is computed once, so copying it to the states of a new stream is a
+  // memcpy. It is empty if the layout is empty. Do not modify it.
+  const std::vector<ncnn::Mat> &GetPackedEncoderInitStates() const {
+    return packed_encoder_init_states_;
+  }
+
   /** Run the encoder network.
    *
    * @param features  A 2-d mat of shape (num_frames, feature_dim).
@@ -91,6 +274,69 @@ class Model {
       ncnn::Mat &features, const std::vector<ncnn::Mat> &states,
       ncnn::Extractor *extractor) = 0;
 
+  /** Run the encoder network with a user provided extractor and write
+   * the next states into preallocated mats.
+   *
+   * @param features  A 2-d mat of shape (num_frames, feature_dim).
+   * @param states It contains the states for the encoder network.
+   * @param extractor  The extractor for the encoder network.
+   * @param next_states  On return, it contains the next states. If a mat
+   *                     in it has the expected shape and is not shared
+   *                     with other mats, the state is copied into it;
+   *                     otherwise, it is reallocated. So passing the same
+   *                     vector for every chunk of a stream allocates no
+   *                     memory after the first chunk. It must not be the
+   *                     same vector as `states`.
+   *
+   * @return Return encoder_out.
+   */
+  virtual ncnn::Mat RunEncoder(ncnn::Mat &features,
+                               const std::vector<ncnn::Mat> &states,
+                               ncnn::Extractor *extractor,
+                               std::vector<ncnn::Mat> *next_states) = 0;
+
+  /** Run the encoder network for a batch of streams.
+   *
+   * @param features  features[i] is a 2-d mat of shape (num_frames,
+   *                  feature_dim) for the i-th stream.
+   * @param states  states[i] contains the encoder states for the i-th stream.
+   *                states.size() == features.size()
+   * @param next_states  On return, next_states[i] contains the next states
+   *                     of the i-th stream. Its mats are reused as
+   *                     described for RunEncoder() above.
+   *                     next_states.size() == features.size()
+   *
+   * @return Return encoder_out, where encoder_out[i] is the encoder output
+   *         of the i-th stream.
+   *
+   * Note: ncnn::Mat has no batch dimension and the encoders we export accept
+   * only one utterance per call, so the default implementation runs the
+   * encoder for each stream in turn. A model that supports batching can
+   * override it.
+   */
+  virtual std::vector<ncnn::Mat> RunEncoderBatch(
+      std::vector<ncnn::Mat> &features,
+      const std::vector<const std::vector<ncnn::Mat> *> &states,
+      const std::vector<std::vector<ncnn::Mat> *> &next_states);
+
+  /** Same as above, but the states of a stream may be kept on the device
+   * of the model between chunks, see DeviceStates.
+   *
+   * @param device_states  If *device_states[i] is not null, it holds the
+   *                       states of the i-th stream and states[i] is not
+   *                       used. On return, the model may set it to the
+   *                       next states of the stream, in which case
+   *                       next_states[i] is not updated.
+   *
+   * The default implementation keeps the states on the host. It must not
+   * be given device states, since it never creates them.
+   */
+  virtual std::vector<ncnn::Mat> RunEncoderBatch(
+      std::vector<ncnn::Mat> &features,
+      const std::vector<const std::vector<ncnn::Mat> *> &states,
+      const std::vector<std::vector<ncnn::Mat> *> &next_states,
+      const std::vector<std::unique_ptr<DeviceStates> *> &device_states);
+
   /** Run the decoder network.
    *
    * @param  decoder_input A mat of shape (context_size,). Note: Its underlying
@@ -106,6 +352,20 @@ class Model {
   virtual ncnn::Mat RunDecoder(ncnn::Mat &decoder_input,
                                ncnn::Extractor *extractor) = 0;
 
+  /** Run the decoder network for several hypotheses.
+   *
+   * @param  decoder_input A mat of shape (num_hyps, context_size). Note: Its
+   *                       underlying content consists of integers, though its
+   *                       type is float.
+   *
+   * @return Return a mat of shape (num_hyps, decoder_dim)
+   *
+   * If the decoder network supports it, all hypotheses are processed with
+   * a single run of the decoder network. Otherwise, it falls back to running
+   * the decoder network once per hypothesis.
+   */
+  ncnn::Mat RunDecoder2D(ncnn::Mat &decoder_input);
+
   /** Run the joiner network.
    *
    * @param encoder_out  A mat of shape (encoder_dim,)
@@ -121,10 +381,85 @@ class Model {
   virtual ncnn::Mat RunJoiner(ncnn::Mat &encoder_out, ncnn::Mat &decoder_out,
                               ncnn::Extractor *extractor) = 0;
 
+  /** Run the joiner network like RunJoiner(), but return its output in the
+   * storage precision and layout of the network, e.g., fp16 or bf16 with
+   * ModelConfig::joiner_precision "balanced", instead of converting it to
+   * fp32. See ArgmaxJoinerOut() in joiner-argmax.h.
+   *
+   * The default implementation returns RunJoiner().
+   */
+  virtual ncnn::Mat RunJoinerRaw(ncnn::Mat &encoder_out,
+                                 ncnn::Mat &decoder_out) {
+    return RunJoiner(encoder_out, decoder_out);
+  }
+
+  /** Run the joiner network for several pairs of encoder and decoder
+   * outputs, e.g., for one frame of several streams.
+   *
+   * @param encoder_out  A mat of shape (num_rows, encoder_dim)
+   * @param decoder_out  A mat of shape (num_rows, decoder_dim)
+   *
+   * @return Return a mat of shape (num_rows, vocab_size)
+   *
+   * If the joiner network gives the same output for all rows at once, they
+   * are processed with a single run of it. Otherwise, it falls back to
+   * running the joiner network once per row.
+   */
+  ncnn::Mat RunJoiner2D(ncnn::Mat &encoder_out, ncnn::Mat &decoder_out);
+
+  /** Create an extractor for one of the networks of this model.
+   *
+   * If ModelConfig::use_pool_allocator is true, the extractor allocates
+   * blobs and workspace from the memory pools of this model. Mats
+   * returned by RunEncoder() and RunDecoder() never refer to the pools.
+   * Mats returned by RunJoiner() may refer to them and must not outlive
+   * the model. With ModelConfig::pool_per_thread, they must also be
+   * released on the calling thread.
+   *
+   * The ncnn threads of the calling thread are moved to the CPU cores of
+   * the network, see ModelConfig::encoder_powersave.
+   */
+  ncnn::Extractor CreateExtractor(const ncnn::Net &net) const;
+
+  /** Run the networks of all models with num_threads threads on the
+   * calling thread instead of ncnn::Option::num_threads of each network.
+   * 0 restores the latter. It applies to extractors created afterwards.
+   *
+   * StreamScheduler uses it to share StreamSchedulerConfig::thread_budget
+   * among its workers.
+   */
+  static void SetThreadNumThreads(int32_t num_threads);
+
+  /** Run the encoder, decoder and joiner once on silence.
+   *
+   * ncnn does some of its setup on the first run of a network, e.g.,
+   * growing the memory pools and, with Vulkan, creating the command
+   * buffers and staging memory. Call it after loading the model so that
+   * the first chunk of real audio does not pay for it.
+   */
+  void WarmUp();
+
+  // Bytes held by the memory pools of this model at their peak, see
+  // ModelConfig::pool_limit_mb, or used in its arena at the peak, see
+  // ModelConfig::arena_mb. 0 if neither is used.
+  std::size_t MemoryPoolHighWaterMark() const;
+
+  // Return the sizes of the weights of the networks and the peak sizes of
+  // the memory pools. It can be called from any thread.
+  ModelMemoryUsage GetMemoryUsage() const;
+
+  // Number of encoder runs so far that skipped the layers after the early
+  // blank head, see ModelConfig::early_exit_threshold
+  int64_t NumEarlyExits() const { return num_early_exits_; }
+
   virtual int32_t ContextSize() const { return 2; }
 
   virtual int32_t BlankId() const { return 0; }
 
+  // The encoder outputs one frame for this number of feature frames. It is
+  // used to convert frames of the decoding result to seconds.
+  virtual int32_t SubsamplingFactor() const { return 4; }
+
   // The encoder takes this number of frames as input
   virtual int32_t Segment() const = 0;
 
@@ -135,12 +470,137 @@ class Model {
   static void InitNet(ncnn::Net &net, const std::string &param,
                       const std::string &bin);
 
+  // Return the bundle this model is loaded from or nullptr if it is loaded
+  // from separate files. See ModelConfig::bundle.
+  const ModelBundle *GetBundle() const { return bundle_.get(); }
+
+  /** Same as above, but if mapped_bin is not nullptr, the weights are loaded
+   * from a memory map of bin and *mapped_bin is set to the mapping, which
+   * must outlive net. If huge_pages is true, it is a copy of bin in huge
+   * pages instead, see MappedFile::ReadIntoHugePages().
+   */
+  static void InitNet(ncnn::Net &net, const std::string &param,
+                      const std::string &bin,
+                      std::unique_ptr<MappedFile> *mapped_bin,
+                      bool huge_pages = false);
+
 #if __ANDROID_API__ >= 9
   static void InitNet(AAssetManager *mgr, ncnn::Net &net,
                       const std::string &param, const std::string &bin);
 #endif
+
+ protected:
+  // Apply the options of config that are shared by all networks of this
+  // model: create the memory pools if config.use_pool_allocator is true and
+  // remember config.use_mmap, config.use_huge_pages and bundle for
+  // LoadNet(). Subclasses call it
+  // in their constructors before loading the networks.
+  void InitOptions(const ModelConfig &config,
+                   std::shared_ptr<const ModelBundle> bundle = nullptr);
+
+  // Set use_vulkan_compute of each network as placed by config, see
+  // ModelConfig::encoder_device, set its precision options, see
+  // ModelConfig::encoder_precision, and remember the CPU cores of each
+  // network, see ModelConfig::cpu_cores. "auto" is resolved by Create();
+  // here it means the GPU. Subclasses call it in their constructors after
+  // setting the options of the networks and before loading them.
+  void InitDevices(const ModelConfig &config);
+
+  // Load one of the networks of this model. If the model has a bundle,
+  // param and bin are names of its sections. Otherwise, they are loaded
+  // with InitNet(), memory-mapping bin if ModelConfig::use_mmap is true.
+  // The mapping is kept until the model is destroyed. The size of bin is
+  // recorded for GetMemoryUsage().
+  void LoadNet(ncnn::Net &net, const std::string &param,
+               const std::string &bin);
+
+  // Compute the packed layout of the encoder states from the shapes of
+  // GetEncoderInitStates(). Subclasses call it once the metadata of the
+  // encoder is loaded.
+  void InitEncoderStateLayout();
+
+  // If m is allocated from the memory pool of this model, return a copy
+  // of it that is not; otherwise, return m. It is used for outputs that
+  // are kept after a network run, e.g., encoder states that are saved
+  // in a stream, which may outlive the model.
+  ncnn::Mat Detach(const ncnn::Mat &m) const;
+
+  // Set *dst to src. If *dst is a packed state with the same shape that is
+  // not shared, src is copied into it. If src is allocated from the memory
+  // pool of this model, it is copied into the memory of *dst when *dst has
+  // the same shape and is not shared; otherwise, *dst is a copy of src
+  // that is not allocated from the pool.
+  void CopyTo(const ncnn::Mat &src, ncnn::Mat *dst) const;
+
+  // Find the early blank head of the encoder and its num_outputs early
+  // outputs, see ModelConfig::early_exit_threshold. Subclasses call it
+  // once the encoder is loaded.
+  void InitEarlyExit(float threshold, const ncnn::Net &encoder,
+                     int32_t num_outputs);
+
+  // Run the encoder up to the early blank head, whose inputs must be set
+  // in ex. If the chunk is confidently blank, return the indexes of the
+  // early outputs to extract instead of those of out0, out1, etc.
+  // Otherwise, return nullptr.
+  const std::vector<int32_t> *EarlyExit(ncnn::Extractor *ex) const;
+
+ private:
+  // Return true if concatenating the contexts of several hypotheses
+  // along the time axis gives the same decoder output as processing the
+  // hypotheses one by one.
+  bool CheckConcatenatedDecoder();
+
+  // Return true if running the joiner network for all rows of the given
+  // inputs at once gives the same output as running it row by row
+  bool CheckBatchedJoiner(ncnn::Mat &encoder_out, ncnn::Mat &decoder_out);
+
+  // Move the ncnn threads of the calling thread to the CPU cores of net
+  void SetThreadAffinity(const ncnn::Net &net) const;
+
+ private:
+  std::once_flag concatenated_decoder_flag_;
+  bool use_concatenated_decoder_ = false;
+
+  std::once_flag batched_joiner_flag_;
+  bool use_batched_joiner_ = false;
+
+  // Shared by all networks of this model. Null if
+  // ModelConfig::use_pool_allocator is false.
+  std::unique_ptr<ModelMemoryPools> memory_pools_;
+
+  bool use_mmap_ = false;
+  bool use_huge_pages_ = false;
+
+  // Bytes of the weights of each network loaded with LoadNet()
+  std::vector<std::pair<const ncnn::Net *, std::size_t>> weight_bytes_;
+
+  // The CPU cores of each network, see ModelConfig::encoder_powersave.
+  // The value is the powersave of the network or, for ModelConfig::cpu_cores,
+  // an id greater than 2 that is unique to this model.
+  std::vector<std::pair<const ncnn::Net *, int32_t>> affinity_;
+
+  // Used if ModelConfig::cpu_cores is not empty
+  ncnn::CpuSet cpu_set_;
+
+  EncoderStateLayout encoder_state_layout_;
+  std::vector<ncnn::Mat> packed_encoder_init_states_;
+
+  // See InitEarlyExit(). early_blank_index_ is -1 if it is not used.
+  float early_exit_threshold_ = 0;
+  int32_t early_blank_index_ = -1;
+  std::vector<int32_t> early_output_indexes_;
+  mutable std::atomic<int64_t> num_early_exits_{0};
+
+  // The networks of subclasses refer to them. As members of the base class,
+  // they are destroyed after the networks.
+  std::vector<std::unique_ptr<MappedFile>> mapped_files_;
+  std::shared_ptr<const ModelBundle> bundle_;
 };
 
+// Return the index of the blob with the given name in net, or -1 if there
+// is no such blob
+int32_t FindBlob(const ncnn::Net &net, const std::string &name);
+
 }  // namespace sherpa_ncnn
 
 #endif  // SHERPA_NCNN_CSRC_MODEL_H_
@@ -20,99 +20,248 @@
 #include "sherpa-ncnn/csrc/modified-beam-search-decoder.h"
 
 #include <algorithm>
+#include <memory>
 #include <utility>
 #include <vector>
 
-#include "sherpa-ncnn/csrc/math.h"
+#include "sherpa-ncnn/csrc/latency-stats.h"
+#include "sherpa-ncnn/csrc/log-softmax-topk.h"
 
 namespace sherpa_ncnn {
 
 DecoderResult ModifiedBeamSearchDecoder::GetEmptyResult() const {
   DecoderResult r;
-
-  int32_t context_size = model_->ContextSize();
-  int32_t blank_id = 0;  // always 0
-
-  std::vector<int32_t> blanks(context_size, blank_id);
-  Hypotheses blank_hyp({{blanks, 0}});
-
-  r.hyps = std::move(blank_hyp);
-  r.tokens = std::move(blanks);
+  r.Clear(context_size_);
+  r.hyps.Add(blank_hyp_);
   return r;
 }
 
+void ModifiedBeamSearchDecoder::ResetResult(DecoderResult *r) const {
+  r->Clear(context_size_);
+  r->hyps.Add(blank_hyp_);
+}
+
 void ModifiedBeamSearchDecoder::StripLeadingBlanks(DecoderResult *r) const {
-  int32_t context_size = model_->ContextSize();
   auto hyp = r->hyps.GetMostProbable(true);
 
-  auto start = hyp.ys.begin() + context_size;
-  auto end = hyp.ys.end();
+  std::vector<int32_t> ys = hyp.Ys();
+
+  auto start = ys.begin() + context_size_;
+  auto end = ys.end();
 
   r->tokens = std::vector<int32_t>(start, end);
-  r->timestamps = std::move(hyp.timestamps);
+  r->timestamps = hyp.Timestamps();
   r->num_trailing_blanks = hyp.num_trailing_blanks;
 }
 
-// Compute log_softmax in-place.
-//
-// The log_softmax of each row is computed.
-//
-// @param in_out A 2-D tensor
-static void LogSoftmax(ncnn::Mat *in_out) {
-  int32_t h = in_out->h;
-  int32_t w = in_out->w;
-  for (int32_t y = 0; y != h; ++y) {
-    float *p = in_out->row(y);
-    LogSoftmax(p, w);
+ncnn::Mat ModifiedBeamSearchDecoder::BuildDecoderInput(
+    const std::vector<Hypothesis> &hyps, int32_t *buf) const {
+  int32_t num_hyps = static_cast<int32_t>(hyps.size());
+
+  if (context_size_ == kCommonContextSize && num_hyps <= kMaxStackPaths) {
+    int32_t *p = buf;
+    for (const auto &hyp : hyps) {
+      hyp.GetLastTokens<kCommonContextSize>(p);
+      p += kCommonContextSize;
+    }
+
+    return ncnn::Mat(kCommonContextSize, num_hyps, buf);
   }
+
+  ncnn::Mat decoder_input(context_size_, num_hyps);
+  auto p = static_cast<int32_t *>(decoder_input);
+
+  for (const auto &hyp : hyps) {
+    hyp.GetLastTokens(context_size_, p);
+    p += context_size_;
+  }
+
+  return decoder_input;
 }
 
-// The decoder model contains an embedding layer, which only supports
-// 1-D output.
-// This is a wrapper to support 2-D decoder output.
-//
-// @param model_ The NN model.
-// @param decoder_input A 2-D tensor of shape (num_active_paths, context_size)
-// @return Return a 2-D tensor of shape (num_active_paths, decoder_dim)
-//
-// TODO(fangjun): Change Embed in ncnn to output 2-d tensors
-static ncnn::Mat RunDecoder2D(Model *model_, ncnn::Mat decoder_input) {
-  ncnn::Mat decoder_out;
-  int32_t h = decoder_input.h;
+ncnn::Mat ModifiedBeamSearchDecoder::RunDecoderNetwork(
+    ncnn::Mat &decoder_input) {
+  ScopedStageTimer timer(Stage::kDecoder);
+  ncnn::Mat decoder_out = model_->RunDecoder2D(decoder_input);
+  if (projection_) {
+    decoder_out = projection_->ProjectDecoder(decoder_out);
+  }
 
-  for (int32_t y = 0; y != h; ++y) {
-    ncnn::Mat decoder_input_t =
-        ncnn::Mat(decoder_input.w, decoder_input.row(y));
+  return decoder_out;
+}
 
-    ncnn::Mat tmp = model_->RunDecoder(decoder_input_t);
+ncnn::Mat ModifiedBeamSearchDecoder::RunDecoder(ncnn::Mat &decoder_input) {
+  if (!cache_) {
+    return RunDecoderNetwork(decoder_input);
+  }
 
-    if (y == 0) {
-      decoder_out = ncnn::Mat(tmp.w, h);
+  int32_t context_size = decoder_input.w;
+  int32_t num_hyps = decoder_input.h;
+
+  // For at most kMaxStackPaths hyps, the bookkeeping below is on the stack
+  ncnn::Mat stack_rows[kMaxStackPaths];
+  int32_t stack_missing[kMaxStackPaths];
+  int32_t stack_row2missing[kMaxStackPaths];
+  int32_t stack_input[kMaxStackPaths * kCommonContextSize];
+
+  std::vector<ncnn::Mat> heap_rows;
+  std::vector<int32_t> heap_missing;
+  std::vector<int32_t> heap_row2missing;
+
+  ncnn::Mat *rows = stack_rows;
+  int32_t *missing = stack_missing;
+  int32_t *row2missing = stack_row2missing;
+  if (num_hyps > kMaxStackPaths) {
+    heap_rows.resize(num_hyps);
+    heap_missing.resize(num_hyps);
+    heap_row2missing.resize(num_hyps);
+
+    rows = heap_rows.data();
+    missing = heap_missing.data();
+    row2missing = heap_row2missing.data();
+  }
+
+  // missing[i] is the index of the first hyp whose context is not in
+  // the cache. Hyps with the same context share the same entry.
+  int32_t num_missing = 0;
+  std::fill(row2missing, row2missing + num_hyps, -1);
+
+  for (int32_t y = 0; y != num_hyps; ++y) {
+    const int32_t *context = decoder_input.row<const int32_t>(y);
+    rows[y] = cache_->Get(context);
+    if (!rows[y].empty()) {
+      continue;
+    }
+
+    for (int32_t i = 0; i != num_missing; ++i) {
+      const int32_t *other = decoder_input.row<const int32_t>(missing[i]);
+      if (std::equal(context, context + context_size, other)) {
+        row2missing[y] = i;
+        break;
+      }
     }
 
-    const float *ptr = tmp;
-    float *out_ptr = decoder_out.row(y);
-    std::copy(ptr, ptr + tmp.w, out_ptr);
+    if (row2missing[y] == -1) {
+      row2missing[y] = num_missing;
+      missing[num_missing++] = y;
+    }
+  }
+
+  ncnn::Mat missing_out;
+  if (num_missing) {
+    ncnn::Mat missing_input;
+    if (context_size == kCommonContextSize && num_hyps <= kMaxStackPaths) {
+      missing_input = ncnn::Mat(context_size, num_missing, stack_input);
+    } else {
+      missing_input.create(context_size, num_missing);
+    }
+
+    for (int32_t i = 0; i != num_missing; ++i) {
+      const int32_t *context = decoder_input.row<const int32_t>(missing[i]);
+      std::copy(context, context + context_size,
+                missing_input.row<int32_t>(i));
+    }
+
+    missing_out = RunDecoderNetwork(missing_input);
+
+    for (int32_t i = 0; i != num_missing; ++i) {
+      // Note: We need to clone it since the cache should own its data
+      ncnn::Mat decoder_out =
+          ncnn::Mat(missing_out.w, missing_out.row(i)).clone();
+      cache_->Put(decoder_input.row<const int32_t>(missing[i]), decoder_out);
+    }
+  }
+
+  int32_t decoder_dim = missing_out.empty() ? rows[0].w : missing_out.w;
+  ncnn::Mat decoder_out(decoder_dim, num_hyps);
+  for (int32_t y = 0; y != num_hyps; ++y) {
+    const float *p = rows[y].empty() ? missing_out.row(row2missing[y])
+                                     : static_cast<const float *>(rows[y]);
+    std::copy(p, p + decoder_dim, decoder_out.row(y));
   }
 
   return decoder_out;
 }
 
-ncnn::Mat ModifiedBeamSearchDecoder::BuildDecoderInput(
-    const std::vector<Hypothesis> &hyps) const {
-  int32_t num_hyps = static_cast<int32_t>(hyps.size());
-  int32_t context_size = model_->ContextSize();
+void ModifiedBeamSearchDecoder::Prune(std::vector<Hypothesis> *hyps) const {
+  double best = hyps->front().log_prob;
+  for (const auto &h : *hyps) {
+    best = std::max(best, h.log_prob);
+  }
 
-  ncnn::Mat decoder_input(context_size, num_hyps);
-  auto p = static_cast<int32_t *>(decoder_input);
+  int32_t num_kept = 0;
+  int32_t num_hyps = static_cast<int32_t>(hyps->size());
+  for (int32_t i = 0; i != num_hyps; ++i) {
+    if (i < min_active_paths_ || (*hyps)[i].log_prob >= best - beam_) {
+      if (num_kept != i) {
+        (*hyps)[num_kept] = std::move((*hyps)[i]);
+      }
+      ++num_kept;
+    }
+  }
 
-  for (const auto &hyp : hyps) {
-    const auto &ys = hyp.ys;
-    std::copy(ys.end() - context_size, ys.end(), p);
-    p += context_size;
+  hyps->erase(hyps->begin() + num_kept, hyps->end());
+}
+
+void ModifiedBeamSearchDecoder::InitShortlistColumns() {
+  const auto &tokens = shortlist_->Tokens();
+  int32_t max_token = *std::max_element(tokens.begin(), tokens.end());
+
+  shortlist_columns_.assign(max_token + 1, -1);
+  for (int32_t k = 0; k != static_cast<int32_t>(tokens.size()); ++k) {
+    shortlist_columns_[tokens[k]] = k;
   }
+}
 
-  return decoder_input;
+void ModifiedBeamSearchDecoder::GetContextBoosts(
+    const ContextGraph &graph, const std::vector<Hypothesis> &prev,
+    int32_t num_cols, const int32_t *token_map, std::vector<ContextArc> *arcs,
+    std::vector<ContextBoost> *boosts, std::vector<int32_t> *begin,
+    std::vector<float> *other) const {
+  boosts->clear();
+  begin->assign(1, 0);
+  other->clear();
+
+  // Return -1 if the token is not scored by the joiner
+  auto column = [this, num_cols, token_map](int32_t token) -> int32_t {
+    if (token_map) {
+      return token < static_cast<int32_t>(shortlist_columns_.size())
+                 ? shortlist_columns_[token]
+                 : -1;
+    }
+    return token < num_cols ? token : -1;
+  };
+
+  for (const auto &hyp : prev) {
+    arcs->clear();
+    float o = graph.GetArcs(hyp.context_state, false /*strict_mode*/, arcs);
+    other->push_back(o);
+
+    std::size_t row_begin = boosts->size();
+    for (const auto &a : *arcs) {
+      int32_t col = column(a.token);
+      // Tokens 0 and 2 are not passed to the graph, see Decode()
+      if (col != -1 && a.token != 0 && a.token != 2) {
+        boosts->push_back({col, a.score - o, a.next});
+      }
+    }
+
+    if (o != 0) {
+      // o is added to the whole row, so cancel it for tokens 0 and 2
+      for (int32_t token : {0, 2}) {
+        int32_t col = column(token);
+        if (col != -1) {
+          boosts->push_back({col, -o, hyp.context_state});
+        }
+      }
+    }
+
+    std::sort(boosts->begin() + row_begin, boosts->end(),
+              [](const ContextBoost &a, const ContextBoost &b) {
+                return a.col < b.col;
+              });
+    begin->push_back(static_cast<int32_t>(boosts->size()));
+  }
 }
 
 void ModifiedBeamSearchDecoder::Decode(ncnn::Mat encoder_out,
@@ -122,71 +271,189 @@ void ModifiedBeamSearchDecoder::Decode(ncnn::Mat encoder_out,
 
 void ModifiedBeamSearchDecoder::Decode(ncnn::Mat encoder_out, Stream *s,
                                        DecoderResult *result) {
-  int32_t context_size = model_->ContextSize();
   Hypotheses cur = std::move(result->hyps);
-  /* encoder_out.w == encoder_out_dim, encoder_out.h == num_frames. */
+
+  int32_t decoder_input_buf[kMaxStackPaths * kCommonContextSize];
+
+  // The n-gram LM is not evaluated over the whole vocabulary. Instead,
+  // it rescores twice as many candidates as there are active paths, and
+  // GetTopK() of the next frame keeps the best of them.
+  int32_t num_candidates = lm_ ? 2 * num_active_paths_ : num_active_paths_;
+  cur.Reserve(num_candidates);
+
+  std::vector<float> prev_log_probs(num_active_paths_);
+  std::vector<int32_t> topk_index(num_candidates);
+  std::vector<float> topk_log_probs(num_candidates);
+
+  std::unique_ptr<NgramLmScorer> lm_scorer;
+  std::vector<int32_t> lm_states;
+  std::vector<int32_t> lm_tokens;
+  std::vector<float> lm_scores(num_candidates);
+  std::vector<int32_t> lm_next(num_candidates);
+  if (lm_) {
+    lm_scorer = std::make_unique<NgramLmScorer>(lm_);
+  }
+
+  const ContextGraph *graph =
+      (s && s->GetContextGraph()) ? s->GetContextGraph().get() : nullptr;
+
+  // Used only if the hotword scores are added before top-k
+  bool boost_before_topk = graph && hotwords_before_topk_;
+  std::vector<ContextArc> arcs;
+  std::vector<ContextBoost> boosts;
+  std::vector<int32_t> boost_begin;
+  std::vector<int32_t> boost_col;
+  std::vector<float> boost_value;
+  std::vector<float> boost_other;
+
+  if (projection_) {
+    // All frames of the chunk in one batched InnerProduct
+    ScopedStageTimer timer(Stage::kJoiner);
+    encoder_out = projection_->ProjectEncoder(encoder_out);
+  }
+
+  /* encoder_out.w == encoder_out_dim, encoder_out.h == num_frames.
+   * With projection_, encoder_out.w is joiner_dim. */
   for (int32_t t = 0; t != encoder_out.h; ++t) {
     std::vector<Hypothesis> prev = cur.GetTopK(num_active_paths_, true);
     cur.Clear();
 
-    ncnn::Mat decoder_input = BuildDecoderInput(prev);
+    if (beam_ > 0) {
+      // The decoder and the joiner run only for the remaining paths
+      Prune(&prev);
+    }
+
+    ncnn::Mat decoder_input = BuildDecoderInput(prev, decoder_input_buf);
     ncnn::Mat decoder_out;
-    if (t == 0 && prev.size() == 1 && prev[0].ys.size() == context_size &&
+    if (t == 0 && prev.size() == 1 && prev[0].NumTokens() == context_size_ &&
         !result->decoder_out.empty()) {
       // When an endpoint is detected, we keep the decoder_out
       decoder_out = result->decoder_out;
     } else {
-      decoder_out = RunDecoder2D(model_, decoder_input);
+      decoder_out = RunDecoder(decoder_input);
     }
 
     // decoder_out.w == decoder_dim
     // decoder_out.h == num_active_paths
     ncnn::Mat encoder_out_t(encoder_out.w, 1, encoder_out.row(t));
 
-    ncnn::Mat joiner_out = model_->RunJoiner(encoder_out_t, decoder_out);
-    // joiner_out.w == vocab_size
+    ncnn::Mat joiner_out;
+    // If not null, column k of joiner_out is the score of token_map[k]
+    const int32_t *token_map = nullptr;
+    {
+      ScopedStageTimer timer(Stage::kJoiner);
+      if (shortlist_) {
+        if (shortlist_->Run(encoder_out_t, decoder_out, &joiner_out,
+                            projection_)) {
+          token_map = shortlist_->Tokens().data();
+        }
+      } else if (projection_) {
+        joiner_out = projection_->Run(encoder_out_t, decoder_out);
+      } else {
+        joiner_out = model_->RunJoiner(encoder_out_t, decoder_out);
+      }
+    }
+    // joiner_out.w == vocab_size, or the size of the shortlist
     // joiner_out.h == num_active_paths
-    LogSoftmax(&joiner_out);
+    // log_softmax, adding prev[i].log_prob to row i and top-k are fused
+    // so that we don't need to write back the whole joiner output.
+    int32_t num_hyps = static_cast<int32_t>(prev.size());
+    for (int32_t i = 0; i != num_hyps; ++i) {
+      prev_log_probs[i] = prev[i].log_prob;
+    }
 
-    float *p_joiner_out = joiner_out;
+    int32_t num_topk;
+    if (boost_before_topk) {
+      // The hotword scores of all tokens are a score per path plus the
+      // boosts of the few tokens that are on an arc of the graph
+      GetContextBoosts(*graph, prev, joiner_out.w, token_map, &arcs, &boosts,
+                       &boost_begin, &boost_other);
+
+      boost_col.clear();
+      boost_value.clear();
+      for (const auto &b : boosts) {
+        boost_col.push_back(b.col);
+        boost_value.push_back(b.value);
+      }
 
-    for (int32_t i = 0; i != joiner_out.h; ++i) {
-      float prev_log_prob = prev[i].log_prob;
-      for (int32_t k = 0; k != joiner_out.w; ++k, ++p_joiner_out) {
-        *p_joiner_out += prev_log_prob;
+      for (int32_t i = 0; i != num_hyps; ++i) {
+        prev_log_probs[i] += boost_other[i];
       }
+
+      num_topk = LogSoftmaxTopk(
+          static_cast<const float *>(joiner_out), joiner_out.h, joiner_out.w,
+          prev_log_probs.data(), boost_begin.data(), boost_col.data(),
+          boost_value.data(), num_candidates, topk_index.data(),
+          topk_log_probs.data());
+    } else {
+      num_topk = LogSoftmaxTopk(
+          static_cast<const float *>(joiner_out), joiner_out.h, joiner_out.w,
+          prev_log_probs.data(), num_candidates, topk_index.data(),
+          topk_log_probs.data());
     }
 
-    auto topk = TopkIndex(static_cast<float *>(joiner_out),
-                          joiner_out.w * joiner_out.h, num_active_paths_);
+    if (lm_) {
+      // Score the non-blank candidates in one batch
+      lm_states.clear();
+      lm_tokens.clear();
+      for (int32_t k = 0; k != num_topk; ++k) {
+        int32_t new_token = topk_index[k] % joiner_out.w;
+        if (token_map) {
+          new_token = token_map[new_token];
+        }
+
+        if (new_token != 0 && new_token != 2) {
+          lm_states.push_back(prev[topk_index[k] / joiner_out.w].lm_state);
+          lm_tokens.push_back(new_token);
+        }
+      }
+
+      lm_scorer->Score(lm_states.data(), lm_tokens.data(),
+                       static_cast<int32_t>(lm_tokens.size()),
+                       lm_scores.data(), lm_next.data());
+    }
 
     int32_t frame_offset = result->frame_offset;
-    for (auto i : topk) {
+    int32_t num_lm_scored = 0;
+    for (int32_t k = 0; k != num_topk; ++k) {
+      int32_t i = topk_index[k];
       int32_t hyp_index = i / joiner_out.w;
-      int32_t new_token = i % joiner_out.w;
-
-      const float *p = joiner_out.row(hyp_index);
+      int32_t col = i % joiner_out.w;
+      int32_t new_token = token_map ? token_map[col] : col;
 
       Hypothesis new_hyp = prev[hyp_index];
-      // const float prev_lm_log_prob = new_hyp.lm_log_prob;
       float context_score = 0;
+      float lm_score = 0;
       auto context_state = new_hyp.context_state;
       // blank id is fixed to 0
       if (new_token != 0 && new_token != 2) {
-        new_hyp.ys.push_back(new_token);
+        new_hyp.AddToken(new_token, t + frame_offset);
         new_hyp.num_trailing_blanks = 0;
-        new_hyp.timestamps.push_back(t + frame_offset);
-        if (s && s->GetContextGraph()) {
-          auto context_res = s->GetContextGraph()->ForwardOneStep(
-              context_state, new_token, false /*strict_mode*/);
+        if (boost_before_topk) {
+          // The score is already in topk_log_probs[k]
+          auto end = boosts.begin() + boost_begin[hyp_index + 1];
+          auto it = std::lower_bound(
+              boosts.begin() + boost_begin[hyp_index], end, col,
+              [](const ContextBoost &b, int32_t c) { return b.col < c; });
+          new_hyp.context_state =
+              (it != end && it->col == col) ? it->next : graph->Root();
+        } else if (graph) {
+          auto context_res = graph->ForwardOneStep(context_state, new_token,
+                                                   false /*strict_mode*/);
           context_score = std::get<0>(context_res);
           new_hyp.context_state = std::get<1>(context_res);
         }
+
+        if (lm_) {
+          lm_score = lm_scale_ * lm_scores[num_lm_scored];
+          new_hyp.lm_state = lm_next[num_lm_scored];
+          ++num_lm_scored;
+        }
       } else {
         ++new_hyp.num_trailing_blanks;
       }
-      // We have already added prev[hyp_index].log_prob to p[new_token]
-      new_hyp.log_prob = p[new_token] + context_score;
+      // prev[hyp_index].log_prob is already included in topk_log_probs[k]
+      new_hyp.log_prob = topk_log_probs[k] + context_score + lm_score;
 
       cur.Add(std::move(new_hyp));
     }
@@ -197,10 +464,12 @@ void ModifiedBeamSearchDecoder::Decode(ncnn::Mat encoder_out, Stream *s,
   auto hyp = result->hyps.GetMostProbable(true);
 
   // set decoder_out in case of endpointing
-  ncnn::Mat decoder_input = BuildDecoderInput({hyp});
-  result->decoder_out = model_->RunDecoder(decoder_input);
+  ncnn::Mat decoder_input = BuildDecoderInput({hyp}, decoder_input_buf);
+  ncnn::Mat decoder_out = RunDecoder(decoder_input);
+  result->decoder_out = decoder_out.reshape(decoder_out.w);
 
-  result->tokens = std::move(hyp.ys);
+  // Note: result->tokens is set in StripLeadingBlanks() so that we don't
+  // need to convert the best path to a vector for each chunk.
   result->num_trailing_blanks = hyp.num_trailing_blanks;
 }
 
@@ -23,8 +23,12 @@
 #include <vector>
 
 #include "mat.h"  // NOLINT
+#include "sherpa-ncnn/csrc/decoder-cache.h"
 #include "sherpa-ncnn/csrc/decoder.h"
+#include "sherpa-ncnn/csrc/joiner-projection.h"
+#include "sherpa-ncnn/csrc/joiner-shortlist.h"
 #include "sherpa-ncnn/csrc/model.h"
+#include "sherpa-ncnn/csrc/ngram-lm.h"
 #include "sherpa-ncnn/csrc/stream.h"
 #include "sherpa-ncnn/csrc/context-graph.h"
 
@@ -32,22 +36,134 @@ namespace sherpa_ncnn {
 
 class ModifiedBeamSearchDecoder : public Decoder {
  public:
-  ModifiedBeamSearchDecoder(Model *model, int32_t num_active_paths)
-      : model_(model), num_active_paths_(num_active_paths) {}
+  /**
+   * @param model The NN model. Not owned.
+   * @param num_active_paths Number of active paths during beam search.
+   * @param cache If not null, decoder outputs are looked up from and saved
+   *              to it. Not owned.
+   * @param shortlist If not null, only its tokens are scored. Not owned.
+   * @param projection If not null, the inputs of the joiner are projected
+   *                   once per chunk and once per decoder output, and the
+   *                   cache holds projected decoder outputs. Not owned.
+   * @param lm If not null, lm_scale times its score of each non-blank
+   *           token is added to the score of a hypothesis. Not owned.
+   * @param lm_scale Scale of the LM score.
+   * @param beam If positive, paths more than beam below the best path are
+   *             pruned before each frame. See DecoderConfig::beam.
+   * @param min_active_paths Number of paths that are never pruned.
+   * @param hotwords_before_topk If true, the hotword scores of the tokens
+   *                             are added before the top-k paths are
+   *                             selected. See
+   *                             DecoderConfig::hotwords_before_topk.
+   */
+  ModifiedBeamSearchDecoder(Model *model, int32_t num_active_paths,
+                            DecoderCache *cache = nullptr,
+                            const JoinerShortlist *shortlist = nullptr,
+                            const JoinerProjection *projection = nullptr,
+                            const NgramLm *lm = nullptr, float lm_scale = 0,
+                            float beam = 0, int32_t min_active_paths = 1,
+                            bool hotwords_before_topk = false)
+      : model_(model),
+        num_active_paths_(num_active_paths),
+        cache_(cache),
+        shortlist_(shortlist),
+        projection_(projection),
+        lm_(lm),
+        lm_scale_(lm_scale),
+        beam_(beam),
+        min_active_paths_(min_active_paths),
+        hotwords_before_topk_(hotwords_before_topk),
+        context_size_(model->ContextSize()),
+        blank_hyp_(std::vector<int32_t>(context_size_, 0), 0) {
+    if (lm_) {
+      blank_hyp_.lm_state = lm_->StartState();
+    }
+
+    if (hotwords_before_topk_ && shortlist_) {
+      InitShortlistColumns();
+    }
+  }
 
   DecoderResult GetEmptyResult() const override;
 
+  void ResetResult(DecoderResult *r) const override;
+
   void StripLeadingBlanks(DecoderResult *r) const override;
 
   void Decode(ncnn::Mat encoder_out, DecoderResult *result) override;
   void Decode(ncnn::Mat encoder_out, Stream *s, DecoderResult *result) override;
 
  private:
-  ncnn::Mat BuildDecoderInput(const std::vector<Hypothesis> &hyps) const;
+  // Number of paths whose decoder input and cache lookups are kept on the
+  // stack. It covers the usual beam sizes of 4 and 8.
+  static constexpr int32_t kMaxStackPaths = 8;
+
+  // If context_size_ is kCommonContextSize and there are at most
+  // kMaxStackPaths hyps, the returned mat uses buf, which must have
+  // kMaxStackPaths * kCommonContextSize elements, instead of allocating
+  // memory.
+  ncnn::Mat BuildDecoderInput(const std::vector<Hypothesis> &hyps,
+                              int32_t *buf) const;
+
+  // @param decoder_input A 2-D tensor of shape (num_hyps, context_size)
+  // @return Return a 2-D tensor of shape (num_hyps, decoder_dim), or of
+  //         shape (num_hyps, joiner_dim) with a JoinerProjection
+  ncnn::Mat RunDecoder(ncnn::Mat &decoder_input);
+
+  // Run the decoder network and, if any, the decoder projection
+  ncnn::Mat RunDecoderNetwork(ncnn::Mat &decoder_input);
+
+  // Remove the paths that are more than beam_ below the best one. hyps
+  // are sorted by GetTopK() and the first min_active_paths_ are kept.
+  void Prune(std::vector<Hypothesis> *hyps) const;
+
+  // A token whose hotword score differs from that of the other tokens of
+  // a path, see ContextGraph::GetArcs()
+  struct ContextBoost {
+    int32_t col;  // column of the token in the joiner output
+    float value;  // its score minus that of the other tokens
+    const ContextState *next;
+  };
+
+  // Set shortlist_columns_
+  void InitShortlistColumns();
+
+  /* Compute the hotword scores of the tokens of each path in prev for
+   * LogSoftmaxTopk(). On return, the boosts of prev[i] are
+   * (*boosts)[(*begin)[i]:(*begin)[i+1]], sorted by column, and other[i]
+   * is the score of all other tokens of prev[i], including blank.
+   *
+   * @param num_cols  Number of columns of the joiner output
+   * @param token_map  If not null, the token of each column
+   */
+  void GetContextBoosts(const ContextGraph &graph,
+                        const std::vector<Hypothesis> &prev, int32_t num_cols,
+                        const int32_t *token_map,
+                        std::vector<ContextArc> *arcs,
+                        std::vector<ContextBoost> *boosts,
+                        std::vector<int32_t> *begin,
+                        std::vector<float> *other) const;
 
  private:
   Model *model_;  // not owned
   int32_t num_active_paths_;
+  DecoderCache *cache_;  // not owned
+  const JoinerShortlist *shortlist_;  // not owned
+  const JoinerProjection *projection_;  // not owned
+  const NgramLm *lm_;  // not owned
+  float lm_scale_;
+  float beam_;
+  int32_t min_active_paths_;
+  bool hotwords_before_topk_;
+  int32_t context_size_;
+
+  // Used only with hotwords_before_topk_ and shortlist_. Entry t is the
+  // column of token t in the output of the shortlist or -1.
+  std::vector<int32_t> shortlist_columns_;
+
+  // The hypothesis of an empty result. Its token nodes are shared by all
+  // empty results.
+  Hypothesis blank_hyp_;
 };
 
 }  // namespace sherpa_ncnn
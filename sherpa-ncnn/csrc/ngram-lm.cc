@@ -0,0 +1,547 @@
+// sherpa-ncnn/csrc/ngram-lm.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/ngram-lm.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <utility>
+
+#include "sherpa-ncnn/csrc/macros.h"
+#include "sherpa-ncnn/csrc/text-utils.h"
+
+namespace sherpa_ncnn {
+
+static constexpr char kMagic[8] = {'S', 'N', 'C', 'N', 'N', 'L', 'M', '1'};
+static constexpr int32_t kCodebookSize = 256;
+
+struct NgramLm::Header {
+  char magic[8];
+  int32_t order;
+  int32_t num_nodes;
+  int32_t vocab_size;
+
+  // The unigram node of <s>, or 0 if there is none
+  int32_t start_node;
+
+  // Score of tokens that are not unigrams of the model
+  float unk_score;
+
+  float prob_codebook[kCodebookSize];
+
+  // Entry 0 is always 0, so that Node::backoff == 0 means no backoff
+  float backoff_codebook[kCodebookSize];
+};
+
+struct NgramLm::Node {
+  // Children are [first_child, next node's first_child)
+  uint32_t first_child;
+  uint32_t suffix;
+  uint16_t token;
+  uint8_t prob;
+  uint8_t backoff;
+};
+
+namespace {
+
+// The n-grams of one order, sorted by tokens
+struct Level {
+  int32_t order = 0;
+  std::vector<int32_t> tokens;  // order tokens per n-gram
+  std::vector<float> probs;
+  std::vector<float> backoffs;
+
+  int32_t Size() const { return static_cast<int32_t>(probs.size()); }
+
+  const int32_t *Tokens(int32_t i) const { return &tokens[i * order]; }
+
+  // Return the index of the n-gram, or -1 if it is not in this level
+  int32_t Find(const int32_t *ngram) const {
+    int32_t lo = 0;
+    int32_t hi = Size();
+    while (lo < hi) {
+      int32_t mid = lo + (hi - lo) / 2;
+      const int32_t *p = Tokens(mid);
+      if (std::lexicographical_compare(p, p + order, ngram, ngram + order)) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+
+    if (lo < Size() && std::equal(ngram, ngram + order, Tokens(lo))) {
+      return lo;
+    }
+    return -1;
+  }
+
+  void Sort() {
+    std::vector<int32_t> perm(Size());
+    std::iota(perm.begin(), perm.end(), 0);
+    std::sort(perm.begin(), perm.end(), [this](int32_t a, int32_t b) {
+      const int32_t *pa = Tokens(a);
+      const int32_t *pb = Tokens(b);
+      return std::lexicographical_compare(pa, pa + order, pb, pb + order);
+    });
+
+    Level sorted;
+    sorted.order = order;
+    for (int32_t i : perm) {
+      sorted.Add(Tokens(i), probs[i], backoffs[i]);
+    }
+    *this = std::move(sorted);
+  }
+
+  void Add(const int32_t *ngram, float prob, float backoff) {
+    tokens.insert(tokens.end(), ngram, ngram + order);
+    probs.push_back(prob);
+    backoffs.push_back(backoff);
+  }
+};
+
+// Return a sorted codebook of at most n values. If there are more distinct
+// values, each entry is the mean of an equal share of the sorted values.
+std::vector<float> BuildCodebook(std::vector<float> values, int32_t n) {
+  std::sort(values.begin(), values.end());
+
+  std::vector<float> distinct = values;
+  distinct.erase(std::unique(distinct.begin(), distinct.end()),
+                 distinct.end());
+  if (static_cast<int32_t>(distinct.size()) <= n) {
+    return distinct;
+  }
+
+  std::vector<float> ans;
+  int64_t size = values.size();
+  for (int32_t b = 0; b != n; ++b) {
+    int64_t begin = b * size / n;
+    int64_t end = (b + 1) * size / n;
+    double sum = std::accumulate(values.begin() + begin, values.begin() + end,
+                                 0.0);
+    ans.push_back(sum / (end - begin));
+  }
+  ans.erase(std::unique(ans.begin(), ans.end()), ans.end());
+
+  return ans;
+}
+
+// Return the index of the entry of the sorted codebook nearest to v
+int32_t Quantize(const std::vector<float> &codebook, float v) {
+  auto it = std::lower_bound(codebook.begin(), codebook.end(), v);
+  if (it == codebook.end()) {
+    return static_cast<int32_t>(codebook.size()) - 1;
+  }
+
+  int32_t i = it - codebook.begin();
+  if (i > 0 && v - codebook[i - 1] < *it - v) {
+    --i;
+  }
+  return i;
+}
+
+// Read the n-grams of an ARPA file. Scores are converted to natural log.
+bool ReadArpa(const std::string &filename, const SymbolTable &sym,
+              int32_t bos, int32_t eos, std::vector<Level> *levels) {
+  std::ifstream is(filename);
+  if (!is) {
+    SHERPA_NCNN_LOGE("Failed to open %s", filename.c_str());
+    return false;
+  }
+
+  const float kLn10 = std::log(10.0f);
+
+  int32_t order = 0;  // of the current section
+  int64_t num_dropped = 0;
+  std::vector<int32_t> ngram;
+  std::vector<std::string> fields;
+  std::string line;
+  while (std::getline(is, line)) {
+    SplitStringToVector(line, " \t\r", true, &fields);
+    if (fields.empty()) continue;
+
+    if (fields[0] == "\\data\\" || fields[0] == "ngram") {
+      continue;
+    }
+
+    if (fields[0] == "\\end\\") {
+      break;
+    }
+
+    if (fields[0][0] == '\\') {
+      // \k-grams:
+      order = atoi(fields[0].c_str() + 1);
+      if (order < 1) {
+        SHERPA_NCNN_LOGE("Invalid line in %s: %s", filename.c_str(),
+                         line.c_str());
+        return false;
+      }
+
+      while (static_cast<int32_t>(levels->size()) < order) {
+        levels->emplace_back();
+        levels->back().order = levels->size();
+      }
+      continue;
+    }
+
+    int32_t n = static_cast<int32_t>(fields.size());
+    if (order == 0 || (n != order + 1 && n != order + 2)) {
+      SHERPA_NCNN_LOGE("Invalid line in %s: %s", filename.c_str(),
+                       line.c_str());
+      return false;
+    }
+
+    ngram.clear();
+    for (int32_t i = 1; i <= order; ++i) {
+      const std::string &w = fields[i];
+      if (sym.contains(w) && sym[w] < sym.NumSymbols()) {
+        ngram.push_back(sym[w]);
+      } else if (w == "<s>") {
+        ngram.push_back(bos);
+      } else if (w == "</s>") {
+        ngram.push_back(eos);
+      } else {
+        break;
+      }
+    }
+
+    if (static_cast<int32_t>(ngram.size()) != order) {
+      ++num_dropped;
+      continue;
+    }
+
+    float prob = atof(fields[0].c_str()) * kLn10;
+    float backoff = n == order + 2 ? atof(fields.back().c_str()) * kLn10 : 0;
+    (*levels)[order - 1].Add(ngram.data(), prob, backoff);
+  }
+
+  if (num_dropped) {
+    SHERPA_NCNN_LOGE("Dropped %lld n-grams of %s with words that are not "
+                     "tokens",
+                     static_cast<long long>(num_dropped),  // NOLINT
+                     filename.c_str());
+  }
+
+  if (levels->empty() || (*levels)[0].Size() == 0) {
+    SHERPA_NCNN_LOGE("There are no unigrams in %s", filename.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+template <typename T>
+void Append(const T *p, std::size_t n, std::string *out) {
+  out->append(reinterpret_cast<const char *>(p), n * sizeof(T));
+}
+
+}  // namespace
+
+bool NgramLm::CompileToString(const std::string &arpa,
+                              const SymbolTable &sym, std::string *out) {
+  // <s> and </s> are usually not tokens. They get the ids after the tokens.
+  int32_t vocab_size = sym.NumSymbols() + 2;
+  int32_t bos = sym.contains("<s>") ? sym["<s>"] : vocab_size - 2;
+  int32_t eos = sym.contains("</s>") ? sym["</s>"] : vocab_size - 1;
+
+  if (vocab_size > 65536) {
+    SHERPA_NCNN_LOGE("At most 65534 tokens are supported. Given: %d",
+                     vocab_size - 2);
+    return false;
+  }
+
+  std::vector<Level> levels;
+  if (!ReadArpa(arpa, sym, bos, eos, &levels)) {
+    return false;
+  }
+
+  int32_t order = static_cast<int32_t>(levels.size());
+
+  // Drop n-grams whose prefix is missing, which a valid ARPA file does not
+  // have, since they cannot be reached
+  int64_t num_orphans = 0;
+  for (int32_t k = 0; k != order; ++k) {
+    levels[k].Sort();
+    if (k == 0) continue;
+
+    Level kept;
+    kept.order = k + 1;
+    for (int32_t i = 0; i != levels[k].Size(); ++i) {
+      const int32_t *p = levels[k].Tokens(i);
+      if (levels[k - 1].Find(p) == -1) {
+        ++num_orphans;
+        continue;
+      }
+      kept.Add(p, levels[k].probs[i], levels[k].backoffs[i]);
+    }
+    levels[k] = std::move(kept);
+  }
+
+  if (num_orphans) {
+    SHERPA_NCNN_LOGE("Dropped %lld n-grams without prefix",
+                     static_cast<long long>(num_orphans));  // NOLINT
+  }
+
+  // base[k] is the node of the first n-gram of levels[k]
+  std::vector<int32_t> base(order + 1, 1);
+  for (int32_t k = 0; k != order; ++k) {
+    base[k + 1] = base[k] + levels[k].Size();
+  }
+  int32_t num_nodes = base[order];
+
+  std::vector<float> all_probs;
+  std::vector<float> nonzero_backoffs;
+  for (const auto &level : levels) {
+    all_probs.insert(all_probs.end(), level.probs.begin(), level.probs.end());
+    for (float b : level.backoffs) {
+      if (b != 0) nonzero_backoffs.push_back(b);
+    }
+  }
+
+  std::vector<float> prob_codebook =
+      BuildCodebook(std::move(all_probs), kCodebookSize);
+  std::vector<float> backoff_codebook =
+      BuildCodebook(std::move(nonzero_backoffs), kCodebookSize - 1);
+
+  std::vector<Node> nodes(num_nodes + 1);
+  std::vector<uint32_t> num_children(num_nodes);
+  num_children[0] = levels[0].Size();
+
+  for (int32_t k = 0; k != order; ++k) {
+    const Level &level = levels[k];
+    for (int32_t i = 0; i != level.Size(); ++i) {
+      const int32_t *p = level.Tokens(i);
+      Node &node = nodes[base[k] + i];
+
+      node.token = p[k];
+      node.prob = Quantize(prob_codebook, level.probs[i]);
+      node.backoff =
+          level.backoffs[i] == 0
+              ? 0
+              : 1 + Quantize(backoff_codebook, level.backoffs[i]);
+
+      // The longest suffix that is in the model
+      node.suffix = 0;
+      for (int32_t j = 1; j <= k; ++j) {
+        int32_t m = levels[k - j].Find(p + j);
+        if (m != -1) {
+          node.suffix = base[k - j] + m;
+          break;
+        }
+      }
+
+      if (k > 0) {
+        ++num_children[base[k - 1] + levels[k - 1].Find(p)];
+      }
+    }
+  }
+
+  // Children of consecutive nodes are consecutive
+  nodes[0].first_child = 1;
+  for (int32_t i = 1; i <= num_nodes; ++i) {
+    nodes[i].first_child = nodes[i - 1].first_child + num_children[i - 1];
+  }
+
+  std::vector<int32_t> unigrams(vocab_size, -1);
+  float min_unigram_prob = 0;
+  for (int32_t i = 0; i != levels[0].Size(); ++i) {
+    int32_t token = levels[0].Tokens(i)[0];
+    unigrams[token] = base[0] + i;
+
+    // <s> and </s> usually have a probability of 10^-99
+    if (token != bos && token != eos) {
+      min_unigram_prob = std::min(min_unigram_prob, levels[0].probs[i]);
+    }
+  }
+
+  Header header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.order = order;
+  header.num_nodes = num_nodes;
+  header.vocab_size = vocab_size;
+  header.start_node = std::max(unigrams[bos], 0);
+
+  int32_t unk = sym.contains("<unk>") ? unigrams[sym["<unk>"]] : -1;
+  header.unk_score =
+      unk != -1 ? prob_codebook[nodes[unk].prob] : min_unigram_prob;
+
+  std::copy(prob_codebook.begin(), prob_codebook.end(),
+            header.prob_codebook);
+  std::copy(backoff_codebook.begin(), backoff_codebook.end(),
+            header.backoff_codebook + 1);
+
+  out->clear();
+  Append(&header, 1, out);
+  Append(nodes.data(), nodes.size(), out);
+  Append(unigrams.data(), unigrams.size(), out);
+
+  return true;
+}
+
+std::unique_ptr<NgramLm> NgramLm::Load(const std::string &filename,
+                                       const SymbolTable &sym) {
+  std::unique_ptr<NgramLm> ans(new NgramLm);
+
+  ans->mapped_ = MappedFile::Open(filename);
+  if (!ans->mapped_) {
+    SHERPA_NCNN_LOGE("Failed to open %s", filename.c_str());
+    return nullptr;
+  }
+
+  const unsigned char *data = ans->mapped_->Data();
+  std::size_t size = ans->mapped_->Size();
+  if (size < sizeof(kMagic) ||
+      std::memcmp(data, kMagic, sizeof(kMagic)) != 0) {
+    // Not compiled. Assume it is an ARPA file.
+    ans->mapped_.reset();
+    if (!CompileToString(filename, sym, &ans->buffer_)) {
+      return nullptr;
+    }
+
+    data = reinterpret_cast<const unsigned char *>(ans->buffer_.data());
+    size = ans->buffer_.size();
+  }
+
+  if (!ans->Init(data, size)) {
+    SHERPA_NCNN_LOGE("%s is corrupted", filename.c_str());
+    return nullptr;
+  }
+
+  return ans;
+}
+
+bool NgramLm::Compile(const std::string &arpa, const SymbolTable &sym,
+                      const std::string &filename) {
+  std::string buffer;
+  if (!CompileToString(arpa, sym, &buffer)) {
+    return false;
+  }
+
+  std::ofstream os(filename, std::ios::binary);
+  os.write(buffer.data(), buffer.size());
+  if (!os) {
+    SHERPA_NCNN_LOGE("Failed to write %s", filename.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+NgramLm::~NgramLm() = default;
+
+bool NgramLm::Init(const unsigned char *data, std::size_t size) {
+  static_assert(sizeof(Node) == 12, "The layout of the file changed");
+
+  if (size < sizeof(Header)) {
+    return false;
+  }
+
+  header_ = reinterpret_cast<const Header *>(data);
+  if (std::memcmp(header_->magic, kMagic, sizeof(kMagic)) != 0 ||
+      header_->num_nodes < 1 || header_->vocab_size < 1) {
+    return false;
+  }
+
+  std::size_t expected = sizeof(Header) +
+                         (header_->num_nodes + 1) * sizeof(Node) +
+                         header_->vocab_size * sizeof(int32_t);
+  if (size != expected) {
+    return false;
+  }
+
+  nodes_ = reinterpret_cast<const Node *>(data + sizeof(Header));
+  unigrams_ = reinterpret_cast<const int32_t *>(
+      data + sizeof(Header) + (header_->num_nodes + 1) * sizeof(Node));
+
+  return true;
+}
+
+int32_t NgramLm::StartState() const {
+  return header_->start_node ? NextState(header_->start_node) : 0;
+}
+
+float NgramLm::Score(int32_t state, int32_t token, int32_t *next) const {
+  const float *probs = header_->prob_codebook;
+  const float *backoffs = header_->backoff_codebook;
+
+  float score = 0;
+  for (int32_t node = state; node != 0; node = nodes_[node].suffix) {
+    int32_t child = FindChild(node, token);
+    if (child != -1) {
+      *next = NextState(child);
+      return score + probs[nodes_[child].prob];
+    }
+
+    score += backoffs[nodes_[node].backoff];
+  }
+
+  int32_t child =
+      (token >= 0 && token < header_->vocab_size) ? unigrams_[token] : -1;
+  if (child == -1) {
+    *next = 0;
+    return score + header_->unk_score;
+  }
+
+  *next = NextState(child);
+  return score + probs[nodes_[child].prob];
+}
+
+int32_t NgramLm::Order() const { return header_->order; }
+
+int32_t NgramLm::NumNodes() const { return header_->num_nodes; }
+
+int32_t NgramLm::FindChild(int32_t node, int32_t token) const {
+  int32_t lo = nodes_[node].first_child;
+  int32_t hi = nodes_[node + 1].first_child;
+  while (lo < hi) {
+    int32_t mid = lo + (hi - lo) / 2;
+    if (nodes_[mid].token < token) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  return (lo < nodes_[node + 1].first_child && nodes_[lo].token == token)
+             ? lo
+             : -1;
+}
+
+int32_t NgramLm::NextState(int32_t node) const {
+  // A node without children and without backoff behaves exactly like its
+  // suffix, which is more likely to be shared with other hypotheses
+  while (node != 0 && nodes_[node].backoff == 0 &&
+         nodes_[node].first_child == nodes_[node + 1].first_child) {
+    node = nodes_[node].suffix;
+  }
+  return node;
+}
+
+// Must be a power of two
+static constexpr int32_t kScorerCacheSize = 256;
+
+NgramLmScorer::NgramLmScorer(const NgramLm *lm)
+    : lm_(lm), cache_(kScorerCacheSize) {}
+
+void NgramLmScorer::Score(const int32_t *states, const int32_t *tokens,
+                          int32_t n, float *scores, int32_t *next) {
+  for (int32_t i = 0; i != n; ++i) {
+    uint32_t h = static_cast<uint32_t>(states[i]) * 2654435761u ^
+                 static_cast<uint32_t>(tokens[i]);
+    Entry &e = cache_[h & (kScorerCacheSize - 1)];
+
+    if (e.state != states[i] || e.token != tokens[i]) {
+      e.state = states[i];
+      e.token = tokens[i];
+      e.score = lm_->Score(e.state, e.token, &e.next);
+    }
+
+    scores[i] = e.score;
+    next[i] = e.next;
+  }
+}
+
+}  // namespace sherpa_ncnn
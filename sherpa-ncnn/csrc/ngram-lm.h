@@ -0,0 +1,136 @@
+// sherpa-ncnn/csrc/ngram-lm.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_NGRAM_LM_H_
+#define SHERPA_NCNN_CSRC_NGRAM_LM_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/mapped-file.h"
+#include "sherpa-ncnn/csrc/symbol-table.h"
+
+namespace sherpa_ncnn {
+
+/** A token-level n-gram language model with backoff, e.g., for shallow
+ * fusion in modified beam search.
+ *
+ * The words of the model are the tokens of tokens.txt. It is built from
+ * an ARPA file, which is compiled into a trie:
+ *
+ *   - Node 0 is the empty context. It is followed by the unigrams, the
+ *     bigrams and so on, each order sorted by tokens. The children of a
+ *     node, i.e., the n-grams that extend it by one token, are therefore
+ *     contiguous and sorted, and are found by binary search. Unigrams are
+ *     found with a table indexed by token.
+ *   - Each node takes 12 bytes. Probabilities and backoff weights are
+ *     quantized to 8 bits, each with a codebook of 256 values.
+ *   - Each node links to the node of its suffix, i.e., the same n-gram
+ *     without its first token, so that backing off does not need the
+ *     history.
+ *
+ * The compiled form is memory mapped, so processes that load the same
+ * file share its pages. It assumes a little endian host.
+ *
+ * A state is the node of the longest suffix of the history that is in
+ * the model. It is an int32_t that can be kept in each Hypothesis.
+ */
+class NgramLm {
+ public:
+  /** Load a file written by Compile(), which is memory mapped, or an ARPA
+   * file, which is compiled in memory.
+   *
+   * @param filename  Path to the file
+   * @param sym  The tokens of the recognizer. N-grams with words that are
+   *             not tokens are dropped, except for <s> and </s>.
+   * @return Return nullptr on error.
+   */
+  static std::unique_ptr<NgramLm> Load(const std::string &filename,
+                                       const SymbolTable &sym);
+
+  /** Compile an ARPA file into the form that Load() maps.
+   *
+   * @return Return false on error.
+   */
+  static bool Compile(const std::string &arpa, const SymbolTable &sym,
+                      const std::string &filename);
+
+  ~NgramLm();
+
+  NgramLm(const NgramLm &) = delete;
+  NgramLm &operator=(const NgramLm &) = delete;
+
+  // The state at the beginning of an utterance, i.e., after <s>
+  int32_t StartState() const;
+
+  /** Return the natural log of the probability of token given the
+   * history of state and set *next to the state after the token.
+   */
+  float Score(int32_t state, int32_t token, int32_t *next) const;
+
+  int32_t Order() const;
+
+  int32_t NumNodes() const;
+
+ private:
+  NgramLm() = default;
+
+  // Build the trie from an ARPA file and return it in *out
+  static bool CompileToString(const std::string &arpa, const SymbolTable &sym,
+                              std::string *out);
+
+  // Check the data and set the pointers into it
+  bool Init(const unsigned char *data, std::size_t size);
+
+  // Return the child of node for token, or -1 if there is none
+  int32_t FindChild(int32_t node, int32_t token) const;
+
+  // Return the state after the n-gram of node
+  int32_t NextState(int32_t node) const;
+
+ private:
+  struct Header;
+  struct Node;
+
+  // Exactly one of them holds the data
+  std::unique_ptr<MappedFile> mapped_;
+  std::string buffer_;
+
+  const Header *header_ = nullptr;
+  const Node *nodes_ = nullptr;  // header_->num_nodes + 1, incl. a sentinel
+  const int32_t *unigrams_ = nullptr;  // header_->vocab_size
+};
+
+/** Score many (state, token) pairs of an NgramLm, with a small direct-mapped
+ * cache in front of it.
+ *
+ * In beam search, the hypotheses propose mostly the same tokens in
+ * consecutive frames, so most queries of a chunk hit the cache. It is not
+ * thread-safe; create one per decoding call. It is cheap.
+ */
+class NgramLmScorer {
+ public:
+  explicit NgramLmScorer(const NgramLm *lm);
+
+  // For i in [0, n): scores[i] = lm->Score(states[i], tokens[i], &next[i])
+  void Score(const int32_t *states, const int32_t *tokens, int32_t n,
+             float *scores, int32_t *next);
+
+ private:
+  struct Entry {
+    int32_t state = -1;
+    int32_t token = -1;
+    int32_t next = 0;
+    float score = 0;
+  };
+
+  const NgramLm *lm_;  // not owned
+  std::vector<Entry> cache_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_NGRAM_LM_H_
@@ -0,0 +1,133 @@
+// sherpa-ncnn/csrc/numa.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/numa.h"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "cpu.h"  // NOLINT
+#include "sherpa-ncnn/csrc/macros.h"
+#include "sherpa-ncnn/csrc/text-utils.h"
+
+namespace sherpa_ncnn {
+
+namespace {
+
+// Return the first line of a file, or an empty string if it cannot be read
+std::string ReadLine(const std::string &filename) {
+  std::ifstream is(filename);
+  std::string line;
+  std::getline(is, line);
+  return line;
+}
+
+}  // namespace
+
+bool ParseCpuList(const std::string &s, std::vector<int32_t> *cores) {
+  cores->clear();
+
+  std::vector<std::string> ranges;
+  SplitStringToVector(s, ",", true, &ranges);
+  for (const auto &r : ranges) {
+    std::vector<int32_t> ends;
+    if (!SplitStringToIntegers(r, "-", false, &ends) || ends.empty() ||
+        ends.size() > 2) {
+      return false;
+    }
+
+    int32_t first = ends[0];
+    int32_t last = ends.back();
+    if (first < 0 || last < first) {
+      return false;
+    }
+
+    for (int32_t i = first; i <= last; ++i) {
+      cores->push_back(i);
+    }
+  }
+
+  return !cores->empty();
+}
+
+std::vector<std::string> GetNumaNodeCores() {
+  std::vector<std::string> ans;
+
+#if defined(__linux__)
+  const std::string dir = "/sys/devices/system/node/";
+
+  std::vector<int32_t> nodes;
+  if (!ParseCpuList(ReadLine(dir + "online"), &nodes)) {
+    return ans;
+  }
+
+  for (int32_t node : nodes) {
+    std::vector<int32_t> cores;
+    std::string filename = dir + "node" + std::to_string(node) + "/cpulist";
+    if (!ParseCpuList(ReadLine(filename), &cores)) {
+      // E.g., a node with memory only
+      continue;
+    }
+
+    std::ostringstream os;
+    std::string sep;
+    for (int32_t c : cores) {
+      os << sep << c;
+      sep = ",";
+    }
+    ans.push_back(os.str());
+  }
+#endif
+
+  return ans;
+}
+
+std::vector<std::shared_ptr<Model>> CreateNumaReplicas(
+    const ModelConfig &config, const std::vector<std::string> &node_cores) {
+  int32_t num_nodes = node_cores.size();
+  std::vector<std::shared_ptr<Model>> ans(num_nodes);
+
+  // The nodes load their copies at the same time
+  std::vector<std::thread> threads;
+  for (int32_t i = 0; i != num_nodes; ++i) {
+    threads.emplace_back([&config, &node_cores, &ans, i]() {
+      std::vector<int32_t> cores;
+      if (!SplitStringToIntegers(node_cores[i], ",", true, &cores)) {
+        SHERPA_NCNN_LOGE("Invalid cores '%s' of node %d",
+                         node_cores[i].c_str(), i);
+        return;
+      }
+
+      ncnn::CpuSet cpu_set;
+      cpu_set.disable_all();
+      for (int32_t c : cores) {
+        cpu_set.enable(c);
+      }
+      ncnn::set_cpu_thread_affinity(cpu_set);
+
+      ModelConfig c = config;
+      c.cpu_cores = node_cores[i];
+      ans[i] = Model::Create(c);
+    });
+  }
+
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  for (int32_t i = 0; i != num_nodes; ++i) {
+    if (!ans[i]) {
+      SHERPA_NCNN_LOGE("Failed to create the model of node %d", i);
+      return {};
+    }
+  }
+
+  return ans;
+}
+
+}  // namespace sherpa_ncnn
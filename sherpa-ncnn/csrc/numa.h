@@ -0,0 +1,55 @@
+// sherpa-ncnn/csrc/numa.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_NUMA_H_
+#define SHERPA_NCNN_CSRC_NUMA_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/model.h"
+
+namespace sherpa_ncnn {
+
+/** Return the CPU cores of each NUMA node in the format of
+ * ModelConfig::cpu_cores, e.g., {"0,1,2,3", "4,5,6,7"}. Nodes without
+ * cores are skipped. It is read from /sys/devices/system/node and is empty
+ * if the topology is unknown, e.g., on other systems than Linux.
+ */
+std::vector<std::string> GetNumaNodeCores();
+
+/** Parse a CPU list as used by sysfs, e.g., "0-3,8-11", into core ids.
+ *
+ * @return Return false if s is not a valid list.
+ */
+bool ParseCpuList(const std::string &s, std::vector<int32_t> *cores);
+
+/** Create a copy of a model for each NUMA node, so that the networks on
+ * each node read their weights from local memory instead of across the
+ * interconnect.
+ *
+ * The copy of a node runs on the cores of the node, see
+ * ModelConfig::cpu_cores, so the threads that run its networks stay on the
+ * node as well. It is loaded by a thread on these cores: Linux allocates a
+ * page on the node of the thread that first touches it, so the weights and
+ * the memory pools of the copy end up on the node.
+ *
+ * Use it with ModelConfig::use_mmap false. Mapped pages live in the page
+ * cache and are shared by all mappings of a file, so the copies would
+ * share the weights that ncnn uses in place wherever they were read first.
+ *
+ * @param config  The config of the model. Its cpu_cores is replaced by
+ *                those of each node.
+ * @param node_cores  The cores of each node, see GetNumaNodeCores().
+ * @return Return a model for each element of node_cores, or an empty vector
+ *         if one of them fails to load.
+ */
+std::vector<std::shared_ptr<Model>> CreateNumaReplicas(
+    const ModelConfig &config, const std::vector<std::string> &node_cores);
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_NUMA_H_
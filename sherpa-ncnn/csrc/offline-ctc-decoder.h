@@ -8,6 +8,7 @@
 #include <vector>
 
 #include "mat.h"  // NOLINT
+#include "sherpa-ncnn/csrc/context-graph.h"
 
 namespace sherpa_ncnn {
 
@@ -34,6 +35,15 @@ class OfflineCtcDecoder {
    * @return Return the decoded result.
    */
   virtual OfflineCtcDecoderResult Decode(const ncnn::Mat &logits) = 0;
+
+  /** Same as the above one, but bias the result towards the hotwords of
+   * context_graph, which may be null. Decoders that do not support
+   * hotwords ignore it.
+   */
+  virtual OfflineCtcDecoderResult Decode(const ncnn::Mat &logits,
+                                         const ContextGraph *context_graph) {
+    return Decode(logits);
+  }
 };
 
 }  // namespace sherpa_ncnn
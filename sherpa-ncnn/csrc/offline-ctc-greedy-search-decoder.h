@@ -16,6 +16,8 @@ class OfflineCtcGreedySearchDecoder : public OfflineCtcDecoder {
   explicit OfflineCtcGreedySearchDecoder(int32_t blank_id)
       : blank_id_(blank_id) {}
 
+  using OfflineCtcDecoder::Decode;
+
   OfflineCtcDecoderResult Decode(const ncnn::Mat &logits) override;
 
  private:
@@ -0,0 +1,189 @@
+// sherpa-ncnn/csrc/offline-ctc-prefix-beam-search-decoder.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/offline-ctc-prefix-beam-search-decoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/hypothesis.h"
+#include "sherpa-ncnn/csrc/log-softmax-topk.h"
+#include "sherpa-ncnn/csrc/math.h"
+
+namespace sherpa_ncnn {
+
+namespace {
+
+constexpr double kNegInf = -std::numeric_limits<double>::infinity();
+
+struct Prefix {
+  // The tokens of this prefix and the frames on which they are decoded
+  Hypothesis hyp;
+
+  // Log probability of all paths of this prefix that end in blank
+  double log_pb = kNegInf;
+
+  // Log probability of all paths of this prefix that end in its last token
+  double log_pnb = kNegInf;
+
+  // Bonus of the hotwords matched by the tokens of this prefix. Its
+  // context state is in hyp.
+  double context_score = 0;
+
+  double LogProb() const { return LogAdd<double>()(log_pb, log_pnb); }
+
+  // The score to rank prefixes
+  double Score() const { return LogProb() + context_score; }
+
+  int32_t LastToken() const { return hyp.tail ? hyp.tail->token : -1; }
+};
+
+// Return the entry of v that has the tokens of hyp, appending one with the
+// given hotword bonus if there is none. The context state is that of hyp.
+// The returned pointer is valid until v is resized.
+Prefix *FindOrAdd(const Hypothesis &hyp, double context_score,
+                  std::vector<Prefix> *v) {
+  for (auto &p : *v) {
+    if (p.hyp.Key() == hyp.Key() && p.hyp.SameTokens(hyp)) {
+      return &p;
+    }
+  }
+
+  Prefix p;
+  p.hyp = hyp;
+  p.context_score = context_score;
+  v->push_back(std::move(p));
+  return &v->back();
+}
+
+// Keep the n prefixes with the highest probability
+void Prune(int32_t n, std::vector<Prefix> *v) {
+  if (static_cast<int32_t>(v->size()) <= n) return;
+
+  std::nth_element(v->begin(), v->begin() + n, v->end(),
+                   [](const Prefix &a, const Prefix &b) {
+                     return a.Score() > b.Score();
+                   });
+  v->resize(n);
+}
+
+}  // namespace
+
+OfflineCtcDecoderResult OfflineCtcPrefixBeamSearchDecoder::Decode(
+    const ncnn::Mat &logits, const ContextGraph *context_graph) {
+  int32_t num_frames = logits.h;
+  int32_t vocab_size = logits.w;
+
+  std::vector<Prefix> cur(1);
+  cur[0].hyp.context_state = context_graph ? context_graph->Root() : nullptr;
+  cur[0].log_pb = 0;
+
+  std::vector<Prefix> next;
+
+  // The best tokens of a frame and their log probabilities
+  std::vector<int32_t> topk_index(max_active_paths_);
+  std::vector<float> topk_value(max_active_paths_);
+
+  float log_blank_threshold = std::log(blank_threshold_);
+
+  for (int32_t t = 0; t != num_frames; ++t) {
+    const float *p = logits.row(t);
+
+    int32_t k = LogSoftmaxTopk(p, 1, vocab_size, nullptr, max_active_paths_,
+                               topk_index.data(), topk_value.data());
+
+    // Blank may not be among the best tokens, so its log probability is
+    // found with the normalizer of the frame
+    float log_z = p[topk_index[0]] - topk_value[0];
+    float log_blank = p[blank_id_] - log_z;
+
+    if (log_blank > log_blank_threshold) {
+      // A blank frame ends every path of a prefix in blank
+      for (auto &q : cur) {
+        q.log_pb = q.LogProb() + log_blank;
+        q.log_pnb = kNegInf;
+      }
+      continue;
+    }
+
+    next.clear();
+    // So that FindOrAdd() never reallocates
+    next.reserve(cur.size() * (k + 1));
+
+    // The prefixes of cur are added first, so that a prefix that is also
+    // reached by extending a shorter one keeps its earlier timestamp
+    for (const auto &q : cur) {
+      Prefix *b = FindOrAdd(q.hyp, q.context_score, &next);
+      b->log_pb = LogAdd<double>()(b->log_pb, q.LogProb() + log_blank);
+    }
+
+    for (const auto &q : cur) {
+      double log_prob = q.LogProb();
+      int32_t last_token = q.LastToken();
+
+      for (int32_t i = 0; i != k; ++i) {
+        int32_t token = topk_index[i];
+        if (token == blank_id_) continue;
+
+        double log_p = topk_value[i];
+
+        if (token == last_token) {
+          // A repeat without a blank in between continues the last token
+          Prefix *same = FindOrAdd(q.hyp, q.context_score, &next);
+          same->log_pnb = LogAdd<double>()(same->log_pnb, q.log_pnb + log_p);
+
+          if (q.log_pb == kNegInf) continue;
+        }
+
+        Hypothesis ext = q.hyp;
+        ext.AddToken(token, t);
+
+        // After the same token, only the paths ending in blank start a new
+        // one
+        double log_prev = token == last_token ? q.log_pb : log_prob;
+
+        Prefix *e = FindOrAdd(ext, q.context_score, &next);
+        e->log_pnb = LogAdd<double>()(e->log_pnb, log_prev + log_p);
+
+        if (context_graph) {
+          // The context state depends only on the tokens, so all paths
+          // that reach e agree on it
+          auto r = context_graph->ForwardOneStep(q.hyp.context_state, token,
+                                                 false /*strict_mode*/);
+          e->context_score = q.context_score + std::get<0>(r);
+          e->hyp.context_state = std::get<1>(r);
+        }
+      }
+    }
+
+    Prune(max_active_paths_, &next);
+    std::swap(cur, next);
+  }  // for (int32_t t = 0; ...)
+
+  // Cancel the bonus of hotwords that are only partially matched
+  auto final_score = [context_graph](const Prefix &p) {
+    double score = p.Score();
+    if (context_graph) {
+      score += context_graph->Finalize(p.hyp.context_state).first;
+    }
+    return score;
+  };
+
+  const Prefix &best = *std::max_element(
+      cur.begin(), cur.end(), [&final_score](const Prefix &a, const Prefix &b) {
+        return final_score(a) < final_score(b);
+      });
+
+  OfflineCtcDecoderResult ans;
+  ans.tokens = best.hyp.Ys();
+  ans.timestamps = best.hyp.Timestamps();
+
+  return ans;
+}
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,54 @@
+// sherpa-ncnn/csrc/offline-ctc-prefix-beam-search-decoder.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_OFFLINE_CTC_PREFIX_BEAM_SEARCH_DECODER_H_
+#define SHERPA_NCNN_CSRC_OFFLINE_CTC_PREFIX_BEAM_SEARCH_DECODER_H_
+
+#include <vector>
+
+#include "sherpa-ncnn/csrc/offline-ctc-decoder.h"
+
+namespace sherpa_ncnn {
+
+/** CTC prefix beam search.
+ *
+ * Two kinds of pruning keep it close to the cost of greedy search:
+ *
+ *  - Frames whose blank posterior exceeds blank_threshold are skipped.
+ *    They only merge the blank and non-blank scores of each prefix.
+ *    For SenseVoice, most frames are such frames.
+ *
+ *  - For the other frames, only the best max_active_paths tokens are
+ *    expanded. They and the log-softmax are found in one vectorized
+ *    pass over the vocabulary, see LogSoftmaxTopk().
+ *
+ * If a context graph is given, a prefix receives the bonus of the
+ * hotwords it matches. The bonus of a partial match at the end is
+ * canceled, see ContextGraph::Finalize().
+ */
+class OfflineCtcPrefixBeamSearchDecoder : public OfflineCtcDecoder {
+ public:
+  OfflineCtcPrefixBeamSearchDecoder(int32_t blank_id,
+                                    int32_t max_active_paths,
+                                    float blank_threshold = 0.999f)
+      : blank_id_(blank_id),
+        max_active_paths_(max_active_paths),
+        blank_threshold_(blank_threshold) {}
+
+  OfflineCtcDecoderResult Decode(const ncnn::Mat &logits) override {
+    return Decode(logits, nullptr);
+  }
+
+  OfflineCtcDecoderResult Decode(const ncnn::Mat &logits,
+                                 const ContextGraph *context_graph) override;
+
+ private:
+  int32_t blank_id_;
+  int32_t max_active_paths_;
+  float blank_threshold_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_OFFLINE_CTC_PREFIX_BEAM_SEARCH_DECODER_H_
@@ -0,0 +1,225 @@
+// sherpa-ncnn/csrc/offline-job-queue.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/offline-job-queue.h"
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <iterator>
+#include <map>
+#include <mutex>  // NOLINT
+#include <sstream>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/macros.h"
+
+namespace sherpa_ncnn {
+
+std::string OfflineJobQueueConfig::ToString() const {
+  std::ostringstream os;
+
+  os << "OfflineJobQueueConfig(";
+  os << "num_threads=" << num_threads << ", ";
+  os << "max_batch_size=" << max_batch_size << ", ";
+  os << "max_latency_ms=" << max_latency_ms << ", ";
+  os << "bucket_width=" << bucket_width << ")";
+
+  return os.str();
+}
+
+class OfflineJobQueue::Impl {
+  using Clock = std::chrono::steady_clock;
+
+  struct Job {
+    OfflineStream *s = nullptr;
+    Callback callback;
+    Clock::time_point submit_time;
+  };
+
+ public:
+  Impl(const OfflineRecognizer *recognizer, const OfflineJobQueueConfig &config)
+      : recognizer_(recognizer), config_(config) {
+    if (config_.num_threads < 1 || config_.max_batch_size < 1 ||
+        config_.max_latency_ms < 0 || config_.bucket_width < 1) {
+      SHERPA_NCNN_LOGE("Invalid config: %s", config_.ToString().c_str());
+      SHERPA_NCNN_EXIT(-1);
+    }
+
+    max_latency_ = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<float, std::milli>(config_.max_latency_ms));
+
+    for (int32_t i = 0; i != config_.num_threads; ++i) {
+      threads_.emplace_back([this]() { Run(); });
+    }
+  }
+
+  ~Impl() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+
+    for (auto &t : threads_) {
+      t.join();
+    }
+  }
+
+  void Submit(OfflineStream *s, Callback callback) {
+    // Computed outside of the lock. The length is final only once the
+    // input is finished.
+    s->InputFinished();
+    int32_t bucket = s->NumFramesReady() / config_.bucket_width;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      buckets_[bucket].push_back({s, std::move(callback), Clock::now()});
+      ++num_pending_;
+    }
+
+    // A full bucket or a new deadline may concern any waiting worker
+    cv_.notify_all();
+  }
+
+  void WaitIdle() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this]() { return num_pending_ == 0; });
+  }
+
+ private:
+  void Run() {
+    std::vector<Job> batch;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      Clock::time_point deadline = Clock::time_point::max();
+      auto it = SelectBucketLocked(&deadline);
+
+      if (it != buckets_.end()) {
+        auto &q = it->second;
+        int32_t n = std::min<int32_t>(q.size(), config_.max_batch_size);
+
+        batch.clear();
+        std::move(q.begin(), q.begin() + n, std::back_inserter(batch));
+        q.erase(q.begin(), q.begin() + n);
+        if (q.empty()) {
+          buckets_.erase(it);
+        }
+
+        lock.unlock();
+        Process(&batch);
+        lock.lock();
+
+        num_pending_ -= n;
+        done_cv_.notify_all();
+        continue;
+      }
+
+      if (stop_) return;
+
+      if (deadline == Clock::time_point::max()) {
+        cv_.wait(lock);
+      } else {
+        cv_.wait_until(lock, deadline);
+      }
+    }
+  }
+
+  // Return the bucket to decode next: among the buckets that are full or
+  // whose oldest stream has waited max_latency_ms, the one with the oldest
+  // stream. When stopping, every bucket is due. If no bucket is due,
+  // return buckets_.end() and set *deadline to the time the first one is.
+  // The caller must hold mutex_.
+  std::map<int32_t, std::deque<Job>>::iterator SelectBucketLocked(
+      Clock::time_point *deadline) {
+    auto now = Clock::now();
+    auto ans = buckets_.end();
+
+    for (auto it = buckets_.begin(); it != buckets_.end(); ++it) {
+      const auto &q = it->second;
+      Clock::time_point due = q.front().submit_time + max_latency_;
+
+      if (stop_ || due <= now ||
+          static_cast<int32_t>(q.size()) >= config_.max_batch_size) {
+        if (ans == buckets_.end() ||
+            q.front().submit_time < ans->second.front().submit_time) {
+          ans = it;
+        }
+      } else {
+        *deadline = std::min(*deadline, due);
+      }
+    }
+
+    return ans;
+  }
+
+  void Process(std::vector<Job> *batch) {
+    std::vector<OfflineStream *> ss;
+    ss.reserve(batch->size());
+    for (const auto &job : *batch) {
+      ss.push_back(job.s);
+    }
+
+    recognizer_->DecodeStreams(ss.data(), ss.size());
+
+    for (auto &job : *batch) {
+      job.callback(job.s);
+    }
+  }
+
+ private:
+  const OfflineRecognizer *recognizer_;
+  OfflineJobQueueConfig config_;
+  Clock::duration max_latency_;
+
+  std::vector<std::thread> threads_;
+
+  // Protects buckets_, num_pending_ and stop_
+  std::mutex mutex_;
+
+  // Signaled when streams are queued or stop_ is set
+  std::condition_variable cv_;
+
+  // Signaled when a batch is done
+  std::condition_variable done_cv_;
+
+  // Bucket index -> streams in the order they were submitted. Empty
+  // buckets are erased.
+  std::map<int32_t, std::deque<Job>> buckets_;
+
+  // Number of streams that are queued or being decoded
+  int32_t num_pending_ = 0;
+
+  bool stop_ = false;
+};
+
+OfflineJobQueue::OfflineJobQueue(const OfflineRecognizer *recognizer,
+                                 const OfflineJobQueueConfig &config)
+    : impl_(std::make_unique<Impl>(recognizer, config)) {}
+
+OfflineJobQueue::~OfflineJobQueue() = default;
+
+void OfflineJobQueue::Submit(OfflineStream *s, Callback callback) {
+  impl_->Submit(s, std::move(callback));
+}
+
+std::future<OfflineRecognizerResult> OfflineJobQueue::Submit(
+    OfflineStream *s) {
+  auto promise = std::make_shared<std::promise<OfflineRecognizerResult>>();
+  std::future<OfflineRecognizerResult> ans = promise->get_future();
+
+  impl_->Submit(s, [promise](OfflineStream *s) {
+    promise->set_value(s->GetResult());
+  });
+
+  return ans;
+}
+
+void OfflineJobQueue::WaitIdle() { impl_->WaitIdle(); }
+
+}  // namespace sherpa_ncnn
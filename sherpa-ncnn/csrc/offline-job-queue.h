@@ -0,0 +1,100 @@
+// sherpa-ncnn/csrc/offline-job-queue.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_OFFLINE_JOB_QUEUE_H_
+#define SHERPA_NCNN_CSRC_OFFLINE_JOB_QUEUE_H_
+
+#include <cstdint>
+#include <functional>
+#include <future>  // NOLINT
+#include <memory>
+#include <string>
+
+#include "sherpa-ncnn/csrc/offline-recognizer.h"
+#include "sherpa-ncnn/csrc/offline-stream.h"
+
+namespace sherpa_ncnn {
+
+struct OfflineJobQueueConfig {
+  // Number of worker threads. Each of them passes one batch at a time to
+  // OfflineRecognizer::DecodeStreams(), which may use several threads by
+  // itself, see OfflineModelConfig::num_threads.
+  int32_t num_threads = 1;
+
+  // A batch has at most this many streams
+  int32_t max_batch_size = 16;
+
+  // A batch is started once it is full or its oldest stream has waited
+  // this long
+  float max_latency_ms = 50;
+
+  // Streams are batched only with streams in the same length bucket.
+  // Bucket i holds streams of [i * bucket_width, (i + 1) * bucket_width)
+  // feature frames. The frame shift is 10 ms, so the default groups clips
+  // whose durations differ by less than 2 seconds.
+  int32_t bucket_width = 200;
+
+  OfflineJobQueueConfig() = default;
+
+  OfflineJobQueueConfig(int32_t num_threads, int32_t max_batch_size,
+                        float max_latency_ms, int32_t bucket_width)
+      : num_threads(num_threads),
+        max_batch_size(max_batch_size),
+        max_latency_ms(max_latency_ms),
+        bucket_width(bucket_width) {}
+
+  std::string ToString() const;
+};
+
+/** Decode offline streams submitted from any thread in batches.
+ *
+ * Streams of similar lengths are grouped and decoded with one
+ * OfflineRecognizer::DecodeStreams() call per batch. It gives the
+ * throughput of large batches while no stream waits longer than
+ * max_latency_ms for its batch to start.
+ *
+ * Usage:
+ *
+ *   OfflineJobQueue queue(&recognizer, config);
+ *   auto s = recognizer.CreateStream();
+ *   s->AcceptWaveform(16000, samples, n);
+ *   std::future<OfflineRecognizerResult> f = queue.Submit(s.get());
+ *   // s must be kept alive until f is ready
+ *   auto r = f.get();
+ */
+class OfflineJobQueue {
+ public:
+  // Invoked on a worker thread once s is decoded, i.e., s->GetResult()
+  // holds the result. The queue no longer refers to s afterwards.
+  using Callback = std::function<void(OfflineStream *s)>;
+
+  OfflineJobQueue(const OfflineRecognizer *recognizer,
+                  const OfflineJobQueueConfig &config);
+
+  // Decode the streams that are still queued and stop the workers
+  ~OfflineJobQueue();
+
+  OfflineJobQueue(const OfflineJobQueue &) = delete;
+  OfflineJobQueue &operator=(const OfflineJobQueue &) = delete;
+
+  // Queue s, which must have received all of its samples. Its input is
+  // finished here, see OfflineStream::InputFinished(). It must be created
+  // by the recognizer of this queue and must outlive the decoding.
+  void Submit(OfflineStream *s, Callback callback);
+
+  // Like the above one, but the result is delivered through the returned
+  // future
+  std::future<OfflineRecognizerResult> Submit(OfflineStream *s);
+
+  // Wait until all submitted streams are decoded
+  void WaitIdle();
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_OFFLINE_JOB_QUEUE_H_
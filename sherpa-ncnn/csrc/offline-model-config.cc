@@ -21,6 +21,38 @@ void OfflineModelConfig::Register(ParseOptions *po) {
 
   po->Register("debug", &debug,
                "true to print model information while loading it.");
+
+  po->Register("device", &device,
+               "Where the model runs: cpu or gpu. With gpu, the CPU is used "
+               "if there is no GPU");
+
+  po->Register("precision", &precision,
+               "Precision of the model: accuracy, balanced or speed. Leave "
+               "it empty to use the defaults of ncnn");
+
+  po->Register("perf-profile", &perf_profile,
+               "A file written by sherpa-ncnn-autotune with the fastest "
+               "options of the model on this device");
+
+  po->Register("use-mmap", &use_mmap,
+               "true to memory-map the .bin file of the model instead of "
+               "reading it into memory");
+
+  po->Register("use-huge-pages", &use_huge_pages,
+               "true to read the .bin file of the model and large memory "
+               "pool chunks into huge pages where the OS supports them");
+
+  po->Register("use-pool-allocator", &use_pool_allocator,
+               "true to allocate the intermediate blobs of the model from "
+               "memory pools that are reused from run to run");
+
+  po->Register("pool-per-thread", &pool_per_thread,
+               "true to give each thread its own memory pools, which need "
+               "no lock");
+
+  po->Register("pool-limit-mb", &pool_limit_mb,
+               "If positive, each memory pool keeps freed memory only while "
+               "it holds at most this many MB");
 }
 
 bool OfflineModelConfig::Validate() const {
@@ -29,7 +61,25 @@ bool OfflineModelConfig::Validate() const {
     return false;
   }
 
+  if (device != "cpu" && device != "gpu") {
+    SHERPA_NCNN_LOGE("Unknown device '%s'. Please use cpu or gpu",
+                     device.c_str());
+    return false;
+  }
+
+  if (!precision.empty() && precision != "accuracy" &&
+      precision != "balanced" && precision != "speed") {
+    SHERPA_NCNN_LOGE(
+        "Unknown precision '%s'. Please use accuracy, balanced or speed",
+        precision.c_str());
+    return false;
+  }
+
   if (tokens.empty()) {
+    if (sense_voice.buffers && sense_voice.buffers->HasSection("tokens")) {
+      return sense_voice.Validate();
+    }
+
     SHERPA_NCNN_LOGE("Please provide --tokens");
     return false;
   }
@@ -52,7 +102,16 @@ std::string OfflineModelConfig::ToString() const {
   os << "sense_voice=" << sense_voice.ToString() << ", ";
   os << "tokens=\"" << tokens << "\", ";
   os << "num_threads=" << num_threads << ", ";
-  os << "debug=" << (debug ? "True" : "False") << ")";
+  os << "debug=" << (debug ? "True" : "False") << ", ";
+  os << "device=\"" << device << "\", ";
+  os << "precision=\"" << precision << "\", ";
+  os << "perf_profile=\"" << perf_profile << "\", ";
+  os << "use_pool_allocator=" << (use_pool_allocator ? "True" : "False")
+     << ", ";
+  os << "pool_per_thread=" << (pool_per_thread ? "True" : "False") << ", ";
+  os << "pool_limit_mb=" << pool_limit_mb << ", ";
+  os << "use_mmap=" << (use_mmap ? "True" : "False") << ", ";
+  os << "use_huge_pages=" << (use_huge_pages ? "True" : "False") << ")";
 
   return os.str();
 }
@@ -17,6 +17,40 @@ struct OfflineModelConfig {
   int32_t num_threads = 2;
   bool debug = false;
 
+  // Where the model runs: "cpu" or "gpu". With "gpu", it runs on the GPU
+  // with Vulkan if there is one and on the CPU otherwise.
+  std::string device = "cpu";
+
+  // The precision of the model: "accuracy", "balanced" or "speed", see
+  // ModelConfig::encoder_precision. If empty, the defaults of ncnn are
+  // used.
+  std::string precision;
+
+  // If not empty, a file written by sherpa-ncnn-autotune for this model on
+  // this device. The options of "sense_voice" in it replace device,
+  // precision and the number of threads of the model. See PerfProfile.
+  std::string perf_profile;
+
+  // If true, the .bin file of the model is memory-mapped instead of read
+  // into memory
+  bool use_mmap = false;
+
+  // If true, the .bin file is read into huge pages and large chunks of the
+  // memory pools are allocated in them, see ModelConfig::use_huge_pages
+  bool use_huge_pages = false;
+
+  // If true, intermediate blobs and workspace of the network are allocated
+  // from memory pools owned by the model, so that no heap allocation
+  // happens once the pools are warmed up. See ModelMemoryPools.
+  bool use_pool_allocator = true;
+
+  // If true, each thread has its own pools, which need no lock
+  bool pool_per_thread = false;
+
+  // If positive, each pool keeps freed memory only while it holds at most
+  // this many MB
+  int32_t pool_limit_mb = 0;
+
   OfflineModelConfig() = default;
   OfflineModelConfig(const OfflineSenseVoiceModelConfig &sense_voice,
                      const std::string &tokens, int32_t num_threads, bool debug)
@@ -28,6 +28,12 @@ class OfflineRecognizerImpl {
 
   virtual std::unique_ptr<OfflineStream> CreateStream() const = 0;
 
+  virtual std::unique_ptr<OfflineStream> CreateStream(
+      ContextGraphPtr context_graph) const = 0;
+
+  virtual ContextGraphPtr CreateContextGraph(const std::string &hotwords_file,
+                                             float hotwords_score) const = 0;
+
   virtual void DecodeStreams(OfflineStream **ss, int32_t n) const = 0;
 
   virtual void SetConfig(const OfflineRecognizerConfig &config) = 0;
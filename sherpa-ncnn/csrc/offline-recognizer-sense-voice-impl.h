@@ -6,13 +6,17 @@
 #define SHERPA_NCNN_CSRC_OFFLINE_RECOGNIZER_SENSE_VOICE_IMPL_H_
 
 #include <algorithm>
+#include <cmath>
+#include <limits>
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "sherpa-ncnn/csrc/hotwords.h"
 #include "sherpa-ncnn/csrc/macros.h"
 #include "sherpa-ncnn/csrc/offline-ctc-greedy-search-decoder.h"
+#include "sherpa-ncnn/csrc/offline-ctc-prefix-beam-search-decoder.h"
 #include "sherpa-ncnn/csrc/offline-model-config.h"
 #include "sherpa-ncnn/csrc/offline-recognizer-impl.h"
 #include "sherpa-ncnn/csrc/offline-recognizer.h"
@@ -29,15 +33,14 @@ OfflineRecognizerResult ConvertSenseVoiceResult(
   r.tokens.reserve(src.tokens.size());
   r.timestamps.reserve(src.timestamps.size());
 
-  std::string text;
+  // The first 4 tokens are lang, emotion, event and itn
+  if (src.tokens.size() > 4) {
+    r.text = sym_table.Join(src.tokens.data() + 4, src.tokens.size() - 4);
+  }
 
   for (int32_t i = 4; i < src.tokens.size(); ++i) {
-    auto sym = sym_table[src.tokens[i]];
-    text.append(sym);
-
-    r.tokens.push_back(std::move(sym));
+    r.tokens.emplace_back(sym_table[src.tokens[i]]);
   }
-  r.text = std::move(text);
 
   float frame_shift_s = frame_shift_ms / 1000. * subsampling_factor;
 
@@ -56,33 +59,103 @@ OfflineRecognizerResult ConvertSenseVoiceResult(
   return r;
 }
 
+// Tokens given in --tokens take precedence over the ones in the buffers of
+// the model, which are used in place
+static SymbolTable CreateSenseVoiceSymbolTable(
+    const OfflineModelConfig &config) {
+  const auto &buffers = config.sense_voice.buffers;
+
+  std::size_t size = 0;
+  const unsigned char *data =
+      buffers && config.tokens.empty() ? buffers->GetSection("tokens", &size)
+                                       : nullptr;
+  if (!data) {
+    return SymbolTable(config.tokens);
+  }
+
+  return SymbolTable(data, size, buffers);
+}
+
 class OfflineRecognizerSenseVoiceImpl : public OfflineRecognizerImpl {
  public:
   explicit OfflineRecognizerSenseVoiceImpl(
       const OfflineRecognizerConfig &config)
       : config_(config),
-        symbol_table_(config_.model_config.tokens),
+        symbol_table_(CreateSenseVoiceSymbolTable(config_.model_config)),
         model_(std::make_unique<OfflineSenseVoiceModel>(config.model_config)) {
     Init();
+
+    if (!config_.hotwords_file.empty()) {
+      context_graph_ = CreateContextGraph(config_.hotwords_file,
+                                          config_.hotwords_score);
+      if (!context_graph_) {
+        SHERPA_NCNN_EXIT(-1);
+      }
+    }
   }
 
   template <typename Manager>
   OfflineRecognizerSenseVoiceImpl(Manager *mgr,
                                   const OfflineRecognizerConfig &config)
       : config_(config),
-        symbol_table_(mgr, config_.model_config.tokens),
+        symbol_table_(config_.model_config.sense_voice.buffers
+                          ? CreateSenseVoiceSymbolTable(config_.model_config)
+                          : SymbolTable(mgr, config_.model_config.tokens)),
         model_(std::make_unique<OfflineSenseVoiceModel>(mgr,
                                                         config.model_config)) {
     Init();
+
+    if (!config_.hotwords_file.empty()) {
+      context_graph_ = sherpa_ncnn::CreateContextGraph(
+          mgr, config_.hotwords_file, symbol_table_, config_.hotwords_score);
+      if (!context_graph_) {
+        SHERPA_NCNN_EXIT(-1);
+      }
+    }
   }
 
   std::unique_ptr<OfflineStream> CreateStream() const override {
-    return std::make_unique<OfflineStream>(config_.feat_config);
+    return CreateStream(context_graph_);
+  }
+
+  std::unique_ptr<OfflineStream> CreateStream(
+      ContextGraphPtr context_graph) const override {
+    return std::make_unique<OfflineStream>(config_.feat_config,
+                                           std::move(context_graph));
+  }
+
+  ContextGraphPtr CreateContextGraph(const std::string &hotwords_file,
+                                     float hotwords_score) const override {
+    if (config_.decoding_method != "prefix_beam_search") {
+      SHERPA_NCNN_LOGE(
+          "Hotwords are used only with prefix_beam_search. Given %s",
+          config_.decoding_method.c_str());
+    }
+
+    return sherpa_ncnn::CreateContextGraph(hotwords_file, symbol_table_,
+                                           hotwords_score);
   }
 
   void DecodeStreams(OfflineStream **ss, int32_t n) const override {
-    for (int32_t i = 0; i < n; ++i) {
-      DecodeOneStream(ss[i]);
+    if (config_.chunk_duration > 0) {
+      DecodeStreamsInChunks(ss, n);
+      return;
+    }
+
+    if (n == 1) {
+      DecodeOneStream(ss[0]);
+      return;
+    }
+
+    std::vector<ncnn::Mat> features(n);
+    for (int32_t i = 0; i != n; ++i) {
+      features[i] = GetLfrFrames(ss[i]);
+    }
+
+    std::vector<ncnn::Mat> logits = Forward(&features);
+
+    for (int32_t i = 0; i != n; ++i) {
+      SetResult(logits[i], ss[i]);
     }
   }
 
@@ -98,9 +171,14 @@ class OfflineRecognizerSenseVoiceImpl : public OfflineRecognizerImpl {
     if (config_.decoding_method == "greedy_search") {
       decoder_ =
           std::make_unique<OfflineCtcGreedySearchDecoder>(meta_data.blank_id);
+    } else if (config_.decoding_method == "prefix_beam_search") {
+      decoder_ = std::make_unique<OfflineCtcPrefixBeamSearchDecoder>(
+          meta_data.blank_id, config_.max_active_paths);
     } else {
-      SHERPA_NCNN_LOGE("Only greedy_search is supported at present. Given %s",
-                       config_.decoding_method.c_str());
+      SHERPA_NCNN_LOGE(
+          "Only greedy_search and prefix_beam_search are supported at "
+          "present. Given %s",
+          config_.decoding_method.c_str());
       SHERPA_NCNN_EXIT(-1);
     }
 
@@ -117,10 +195,71 @@ class OfflineRecognizerSenseVoiceImpl : public OfflineRecognizerImpl {
   }
 
   void DecodeOneStream(OfflineStream *s) const {
+    std::vector<ncnn::Mat> features = {GetLfrFrames(s)};
+
+    ncnn::Mat logits = Forward(&features)[0];
+    SetResult(logits, s);
+  }
+
+  // Run the model on features, which are padded to the length buckets
+  // first, see OfflineRecognizerConfig::length_bucket. The logits of the
+  // padded frames are dropped.
+  std::vector<ncnn::Mat> Forward(std::vector<ncnn::Mat> *features) const {
+    int32_t n = features->size();
+    std::vector<int32_t> num_frames(n);
+    for (int32_t i = 0; i != n; ++i) {
+      num_frames[i] = (*features)[i].h;
+      (*features)[i] = PadToBucket((*features)[i]);
+    }
+
+    std::vector<ncnn::Mat> logits =
+        model_->Forward(*features, GetLanguage(), GetTextNorm());
+
+    for (int32_t i = 0; i != n; ++i) {
+      // The 4 prompt frames come first
+      int32_t h = num_frames[i] + 4;
+      if (logits[i].h > h) {
+        // A view of the first rows that shares the reference count
+        logits[i].h = h;
+        logits[i].cstep = static_cast<size_t>(logits[i].w) * h;
+      }
+    }
+
+    return logits;
+  }
+
+  ncnn::Mat PadToBucket(const ncnn::Mat &features) const {
+    if (config_.length_bucket <= 0) {
+      return features;
+    }
+
     const auto &meta_data = model_->GetModelMetadata();
 
-    ncnn::Mat f = s->GetFrames();
-    f = ApplyLFR(f);
+    // An LFR frame covers window_shift frames of 10 ms
+    float lfr_frame_ms = 10.0f * meta_data.window_shift;
+    int32_t bucket =
+        std::max<int32_t>(1, config_.length_bucket * 1000 / lfr_frame_ms);
+
+    int32_t h = (features.h + bucket - 1) / bucket * bucket;
+    if (h == features.h) {
+      return features;
+    }
+
+    ncnn::Mat ans(features.w, h);
+    const float *src = features;
+    float *dst = ans;
+    std::size_t n = static_cast<std::size_t>(features.w) * features.h;
+    std::copy(src, src + n, dst);
+
+    // The log mel energy of digital silence, i.e., the floor of fbank
+    float silence = std::log(std::numeric_limits<float>::epsilon());
+    std::fill(dst + n, dst + static_cast<std::size_t>(ans.w) * h, silence);
+
+    return ans;
+  }
+
+  int32_t GetLanguage() const {
+    const auto &meta_data = model_->GetModelMetadata();
 
     int32_t language = 0;
     if (config_.model_config.sense_voice.language.empty()) {
@@ -134,52 +273,162 @@ class OfflineRecognizerSenseVoiceImpl : public OfflineRecognizerImpl {
                        config_.model_config.sense_voice.language.c_str());
     }
 
-    int32_t text_norm = config_.model_config.sense_voice.use_itn
-                            ? meta_data.with_itn_id
-                            : meta_data.without_itn_id;
-
-    ncnn::Mat logits = model_->Forward(f, language, text_norm);
+    return language;
+  }
 
-    auto result = decoder_->Decode(logits);
+  int32_t GetTextNorm() const {
+    const auto &meta_data = model_->GetModelMetadata();
 
-    int32_t frame_shift_ms = 10;
-    int32_t subsampling_factor = meta_data.window_shift;
-    auto r = ConvertSenseVoiceResult(result, symbol_table_, frame_shift_ms,
-                                     subsampling_factor);
-    s->SetResult(r);
+    return config_.model_config.sense_voice.use_itn ? meta_data.with_itn_id
+                                                    : meta_data.without_itn_id;
   }
 
-  ncnn::Mat ApplyLFR(const ncnn::Mat &in) const {
+  // A piece of a stream that is decoded by itself, see
+  // OfflineRecognizerConfig::chunk_duration. All indexes are LFR frames.
+  struct Chunk {
+    // Index of the stream in the input array
+    int32_t stream = 0;
+
+    // The chunk consists of the frames [start, start + num_frames)
+    int32_t start = 0;
+    int32_t num_frames = 0;
+
+    // Only the tokens decoded at frames [keep_begin, keep_end) are kept.
+    // The keep ranges of the chunks of a stream cover it without gaps or
+    // overlaps, so every token is taken from the chunk in which it is
+    // farthest from the chunk edges.
+    int32_t keep_begin = 0;
+    int32_t keep_end = 0;
+  };
+
+  void DecodeStreamsInChunks(OfflineStream **ss, int32_t n) const {
     const auto &meta_data = model_->GetModelMetadata();
 
-    int32_t lfr_window_size = meta_data.window_size;
-    int32_t lfr_window_shift = meta_data.window_shift;
-    int32_t in_feat_dim = in.w;
-
-    int32_t in_num_frames = in.h;
-    int32_t out_num_frames =
-        (in_num_frames - lfr_window_size) / lfr_window_shift + 1;
-    int32_t out_feat_dim = in_feat_dim * lfr_window_size;
+    // An LFR frame covers window_shift frames of 10 ms
+    float lfr_frame_ms = 10.0f * meta_data.window_shift;
+    int32_t chunk_size =
+        std::max<int32_t>(1, config_.chunk_duration * 1000 / lfr_frame_ms);
+    int32_t overlap = std::min<int32_t>(
+        chunk_size - 1, config_.chunk_overlap * 1000 / lfr_frame_ms);
+
+    std::vector<Chunk> chunks;
+    for (int32_t i = 0; i != n; ++i) {
+      int32_t num_frames =
+          ss[i]->NumLfrFrames(meta_data.window_size, meta_data.window_shift);
+      SplitIntoChunks(i, num_frames, chunk_size, overlap, &chunks);
+    }
 
-    ncnn::Mat out(out_feat_dim, out_num_frames);
+    // Each batch keeps all model threads busy, while the logits of only
+    // one batch are alive at a time
+    int32_t batch_size = std::max(1, config_.model_config.num_threads);
+    int32_t num_chunks = chunks.size();
+
+    std::vector<OfflineCtcDecoderResult> results(n);
+    std::vector<ncnn::Mat> features;
+    for (int32_t b = 0; b < num_chunks; b += batch_size) {
+      int32_t m = std::min(batch_size, num_chunks - b);
+
+      features.resize(m);
+      for (int32_t k = 0; k != m; ++k) {
+        const Chunk &c = chunks[b + k];
+        features[k] =
+            ss[c.stream]->GetLfrFrames(meta_data.window_size,
+                                       meta_data.window_shift, c.start,
+                                       c.num_frames);
+      }
+
+      std::vector<ncnn::Mat> logits = Forward(&features);
+
+      for (int32_t k = 0; k != m; ++k) {
+        const Chunk &c = chunks[b + k];
+        auto r = decoder_->Decode(logits[k],
+                                  ss[c.stream]->GetContextGraph().get());
+        AppendChunkResult(r, c, &results[c.stream]);
+      }
+    }
 
-    const float *p_in = in;
-    float *p_out = out;
+    for (int32_t i = 0; i != n; ++i) {
+      SetResult(results[i], ss[i]);
+    }
+  }
 
-    for (int32_t i = 0; i != out_num_frames; ++i) {
-      std::copy(p_in, p_in + out_feat_dim, p_out);
+  // Split a stream of num_frames LFR frames into chunks of chunk_size
+  // frames, where neighboring chunks share overlap frames. Tokens in an
+  // overlap are kept from the chunk on the side of its middle.
+  static void SplitIntoChunks(int32_t stream, int32_t num_frames,
+                              int32_t chunk_size, int32_t overlap,
+                              std::vector<Chunk> *chunks) {
+    int32_t stride = chunk_size - overlap;
+
+    for (int32_t start = 0;; start += stride) {
+      bool is_last = start + chunk_size >= num_frames;
+
+      Chunk c;
+      c.stream = stream;
+      c.start = start;
+      c.num_frames = std::min(chunk_size, num_frames - start);
+      c.keep_begin = start == 0 ? 0 : start + overlap / 2;
+      c.keep_end = is_last ? num_frames : start + stride + overlap / 2;
+      chunks->push_back(c);
+
+      if (is_last) break;
+    }
+  }
 
-      p_out += out_feat_dim;
-      p_in += lfr_window_shift * in_feat_dim;
+  // Append the tokens of a chunk in its keep range to *r, with timestamps
+  // relative to the start of the stream. The 4 leading tokens, i.e., the
+  // language, emotion, event and text norm, are taken from the first
+  // chunk.
+  static void AppendChunkResult(const OfflineCtcDecoderResult &src,
+                                const Chunk &c, OfflineCtcDecoderResult *r) {
+    constexpr int32_t kNumPrompts = 4;
+
+    for (int32_t i = 0; i < static_cast<int32_t>(src.tokens.size()); ++i) {
+      if (i < kNumPrompts) {
+        if (c.start == 0) {
+          r->tokens.push_back(src.tokens[i]);
+          r->timestamps.push_back(src.timestamps[i]);
+        }
+        continue;
+      }
+
+      int32_t t = src.timestamps[i] - kNumPrompts + c.start;
+      if (t < c.keep_begin || t >= c.keep_end) continue;
+
+      r->tokens.push_back(src.tokens[i]);
+      r->timestamps.push_back(t + kNumPrompts);
     }
+  }
+
+  void SetResult(const ncnn::Mat &logits, OfflineStream *s) const {
+    SetResult(decoder_->Decode(logits, s->GetContextGraph().get()), s);
+  }
+
+  void SetResult(const OfflineCtcDecoderResult &result,
+                 OfflineStream *s) const {
+    const auto &meta_data = model_->GetModelMetadata();
+
+    int32_t frame_shift_ms = 10;
+    int32_t subsampling_factor = meta_data.window_shift;
+    auto r = ConvertSenseVoiceResult(result, symbol_table_, frame_shift_ms,
+                                     subsampling_factor);
+    s->SetResult(r);
+  }
+
+  ncnn::Mat GetLfrFrames(const OfflineStream *s) const {
+    const auto &meta_data = model_->GetModelMetadata();
 
-    return out;
+    return s->GetLfrFrames(meta_data.window_size, meta_data.window_shift);
   }
 
   OfflineRecognizerConfig config_;
   SymbolTable symbol_table_;
   std::unique_ptr<OfflineSenseVoiceModel> model_;
   std::unique_ptr<OfflineCtcDecoder> decoder_;
+
+  // Built from config_.hotwords_file and shared by the streams. It may be
+  // null.
+  ContextGraphPtr context_graph_;
 };
 
 }  // namespace sherpa_ncnn
@@ -5,6 +5,8 @@
 #include "sherpa-ncnn/csrc/offline-recognizer.h"
 
 #include <memory>
+#include <string>
+#include <utility>
 
 #if __ANDROID_API__ >= 9
 #include "android/asset_manager.h"
@@ -15,6 +17,7 @@
 #include "rawfile/raw_file_manager.h"
 #endif
 
+#include "sherpa-ncnn/csrc/compact-frames.h"
 #include "sherpa-ncnn/csrc/file-utils.h"
 #include "sherpa-ncnn/csrc/macros.h"
 #include "sherpa-ncnn/csrc/offline-recognizer-impl.h"
@@ -28,7 +31,19 @@ void OfflineRecognizerConfig::Register(ParseOptions *po) {
 
   po->Register("decoding-method", &decoding_method,
                "decoding method,"
-               "Valid values: greedy_search.");
+               "Valid values: greedy_search, prefix_beam_search.");
+
+  po->Register("max-active-paths", &max_active_paths,
+               "Number of active paths to keep for prefix_beam_search.");
+
+  po->Register("hotwords-file", &hotwords_file,
+               "The file containing hotwords, one hotword per line, with "
+               "its tokens separated by spaces. Used only for "
+               "prefix_beam_search.");
+
+  po->Register("hotwords-score", &hotwords_score,
+               "The bonus score for each token in hotwords. Used only for "
+               "prefix_beam_search.");
 
   po->Register("blank-penalty", &blank_penalty,
                "The penalty applied on blank symbol during decoding. "
@@ -36,9 +51,60 @@ void OfflineRecognizerConfig::Register(ParseOptions *po) {
                "Increasing value will lead to lower deletion at the cost"
                "of higher insertions. "
                "Currently only applicable for transducer models.");
+
+  po->Register("chunk-duration", &chunk_duration,
+               "If positive, audio longer than this many seconds is split "
+               "into overlapping chunks that are decoded separately and "
+               "stitched. Use it for long recordings. 0 decodes the whole "
+               "audio in one pass.");
+
+  po->Register("chunk-overlap", &chunk_overlap,
+               "Overlap in seconds between neighboring chunks. Used only "
+               "if --chunk-duration is positive.");
+
+  po->Register("length-bucket", &length_bucket,
+               "If positive, pad the features of each utterance to a "
+               "multiple of this many seconds with silence, so that the "
+               "model sees fewer input shapes and reuses its memory. The "
+               "results may change a little. 0 disables padding.");
 }
 
 bool OfflineRecognizerConfig::Validate() const {
+  if (decoding_method == "prefix_beam_search" && max_active_paths < 1) {
+    SHERPA_NCNN_LOGE("--max-active-paths should be >= 1. Given: %d",
+                     max_active_paths);
+    return false;
+  }
+
+  if (chunk_duration < 0) {
+    SHERPA_NCNN_LOGE("--chunk-duration should be >= 0. Given: %.3f",
+                     chunk_duration);
+    return false;
+  }
+
+  if (chunk_duration > 0 &&
+      (chunk_overlap < 0 || chunk_overlap >= chunk_duration)) {
+    SHERPA_NCNN_LOGE(
+        "--chunk-overlap should be in [0, --chunk-duration). Given: %.3f",
+        chunk_overlap);
+    return false;
+  }
+
+  if (length_bucket < 0) {
+    SHERPA_NCNN_LOGE("--length-bucket should be >= 0. Given: %.3f",
+                     length_bucket);
+    return false;
+  }
+
+  CompactFrames::Format format;
+  if (feat_config.feature_storage != "fp32" &&
+      !CompactFrames::ParseFormat(feat_config.feature_storage, &format)) {
+    SHERPA_NCNN_LOGE(
+        "--feat-storage should be one of fp32, fp16, int8. Given: %s",
+        feat_config.feature_storage.c_str());
+    return false;
+  }
+
   return model_config.Validate();
 }
 
@@ -49,7 +115,13 @@ std::string OfflineRecognizerConfig::ToString() const {
   os << "feat_config=" << feat_config.ToString() << ", ";
   os << "model_config=" << model_config.ToString() << ", ";
   os << "decoding_method=\"" << decoding_method << "\", ";
-  os << "blank_penalty=" << blank_penalty << ")";
+  os << "blank_penalty=" << blank_penalty << ", ";
+  os << "max_active_paths=" << max_active_paths << ", ";
+  os << "hotwords_file=\"" << hotwords_file << "\", ";
+  os << "hotwords_score=" << hotwords_score << ", ";
+  os << "chunk_duration=" << chunk_duration << ", ";
+  os << "chunk_overlap=" << chunk_overlap << ", ";
+  os << "length_bucket=" << length_bucket << ")";
 
   return os.str();
 }
@@ -68,7 +140,21 @@ std::unique_ptr<OfflineStream> OfflineRecognizer::CreateStream() const {
   return impl_->CreateStream();
 }
 
+std::unique_ptr<OfflineStream> OfflineRecognizer::CreateStream(
+    ContextGraphPtr context_graph) const {
+  return impl_->CreateStream(std::move(context_graph));
+}
+
+ContextGraphPtr OfflineRecognizer::CreateContextGraph(
+    const std::string &hotwords_file, float hotwords_score) const {
+  return impl_->CreateContextGraph(hotwords_file, hotwords_score);
+}
+
 void OfflineRecognizer::DecodeStreams(OfflineStream **ss, int32_t n) const {
+  for (int32_t i = 0; i != n; ++i) {
+    ss[i]->InputFinished();
+  }
+
   impl_->DecodeStreams(ss, n);
 }
 
@@ -9,6 +9,7 @@
 #include <string>
 #include <vector>
 
+#include "sherpa-ncnn/csrc/context-graph.h"
 #include "sherpa-ncnn/csrc/features.h"
 #include "sherpa-ncnn/csrc/offline-model-config.h"
 #include "sherpa-ncnn/csrc/offline-stream.h"
@@ -24,15 +25,56 @@ struct OfflineRecognizerConfig {
 
   float blank_penalty = 0.0;
 
+  // Used only for prefix_beam_search
+  int32_t max_active_paths = 4;
+
+  // Used only for prefix_beam_search. The context graph built from it is
+  // shared by all streams created with CreateStream(), see
+  // CreateContextGraph() for the format.
+  std::string hotwords_file;
+
+  // The score of each token of a hotword that has no score of its own
+  float hotwords_score = 1.5;
+
+  // If positive, streams longer than this many seconds are split into
+  // overlapping chunks of this duration. The chunks are decoded in
+  // batches of OfflineModelConfig::num_threads and their results are
+  // stitched in the middle of each overlap, so the memory and the
+  // attention cost per chunk do not grow with the length of the stream.
+  // If 0, a stream is decoded in one pass.
+  float chunk_duration = 0;
+
+  // Overlap in seconds between neighboring chunks. It must be less than
+  // chunk_duration.
+  float chunk_overlap = 2;
+
+  // If positive, the features of each utterance or chunk are padded at
+  // the end to a multiple of this many seconds, e.g., 1. The model then
+  // sees only a few distinct input shapes, so the blobs of one call fit
+  // the pooled memory of the previous calls. The logits of the padded
+  // frames are dropped. The graph has no padding mask, so the encoder
+  // still attends to them, which may change the results a little.
+  // If 0, features are not padded.
+  float length_bucket = 0;
+
   OfflineRecognizerConfig() = default;
   OfflineRecognizerConfig(const FeatureExtractorConfig &feat_config,
                           const OfflineModelConfig &model_config,
                           const std::string &decoding_method,
-                          float blank_penalty)
+                          float blank_penalty, float chunk_duration = 0,
+                          float chunk_overlap = 2,
+                          int32_t max_active_paths = 4,
+                          const std::string &hotwords_file = {},
+                          float hotwords_score = 1.5)
       : feat_config(feat_config),
         model_config(model_config),
         decoding_method(decoding_method),
-        blank_penalty(blank_penalty) {}
+        blank_penalty(blank_penalty),
+        max_active_paths(max_active_paths),
+        hotwords_file(hotwords_file),
+        hotwords_score(hotwords_score),
+        chunk_duration(chunk_duration),
+        chunk_overlap(chunk_overlap) {}
 
   void Register(ParseOptions *po);
   bool Validate() const;
@@ -54,6 +96,29 @@ class OfflineRecognizer {
   /// Create a stream for decoding.
   std::unique_ptr<OfflineStream> CreateStream() const;
 
+  /** Create a stream that is biased towards the hotwords of
+   * context_graph instead of those of config.hotwords_file.
+   *
+   * @param context_graph  It is shared, not copied, so one graph per
+   *                       vocabulary serves all streams that use it.
+   *                       It is used only for prefix_beam_search.
+   */
+  std::unique_ptr<OfflineStream> CreateStream(
+      ContextGraphPtr context_graph) const;
+
+  /** Build a context graph with the symbol table of the model.
+   *
+   * @param hotwords_file  Each line contains the space separated tokens of
+   *                       one hotword, optionally followed by its score,
+   *                       e.g., "▁HE LL O ▁WORLD :1.5".
+   * @param hotwords_score  The score of hotwords that have no score.
+   *
+   * @return Return nullptr if the file cannot be read or contains a token
+   *         that is not in the symbol table.
+   */
+  ContextGraphPtr CreateContextGraph(const std::string &hotwords_file,
+                                     float hotwords_score) const;
+
   /** Decode a single stream
    *
    * @param s The stream to decode.
@@ -67,6 +132,9 @@ class OfflineRecognizer {
    *
    * @param ss Pointer to an array of streams.
    * @param n  Size of the input array.
+   *
+   * Streams whose input is not finished yet are finished first, see
+   * OfflineStream::InputFinished().
    */
   void DecodeStreams(OfflineStream **ss, int32_t n) const;
 
@@ -24,10 +24,14 @@ void OfflineSenseVoiceModelConfig::Register(ParseOptions *po) {
   po->Register(
       "sense-voice-use-itn", &use_itn,
       "True to enable inverse text normalization. False to disable it.");
+
+  po->Register("sense-voice-use-int8", &use_int8,
+               "true to use model.int8.ncnn.{param,bin} instead of "
+               "model.ncnn.{param,bin} if it exists in the model directory");
 }
 
 bool OfflineSenseVoiceModelConfig::Validate() const {
-  if (model_dir.empty()) {
+  if (model_dir.empty() && !buffers) {
     SHERPA_NCNN_LOGE("Please provide --sense-voice-model-dir");
     return false;
   }
@@ -39,6 +43,14 @@ bool OfflineSenseVoiceModelConfig::Validate() const {
 
   bool ok = true;
   for (const auto &f : files_to_check) {
+    if (buffers) {
+      if (!buffers->HasSection(f)) {
+        SHERPA_NCNN_LOGE("There is no '%s' in the buffers", f.c_str());
+        ok = false;
+      }
+      continue;
+    }
+
     auto name = model_dir + "/" + f;
     if (!FileExists(name)) {
       SHERPA_NCNN_LOGE("'%s' does not exist inside the directory '%s'",
@@ -72,8 +84,10 @@ std::string OfflineSenseVoiceModelConfig::ToString() const {
 
   os << "OfflineSenseVoiceModelConfig(";
   os << "model_dir=\"" << model_dir << "\", ";
+  os << "buffers=" << (buffers ? "True" : "False") << ", ";
   os << "language=\"" << language << "\", ";
-  os << "use_itn=" << (use_itn ? "True" : "False") << ")";
+  os << "use_itn=" << (use_itn ? "True" : "False") << ", ";
+  os << "use_int8=" << (use_int8 ? "True" : "False") << ")";
 
   return os.str();
 }
@@ -4,8 +4,10 @@
 #ifndef SHERPA_NCNN_CSRC_OFFLINE_SENSE_VOICE_MODEL_CONFIG_H_
 #define SHERPA_NCNN_CSRC_OFFLINE_SENSE_VOICE_MODEL_CONFIG_H_
 
+#include <memory>
 #include <string>
 
+#include "sherpa-ncnn/csrc/model-bundle.h"
 #include "sherpa-ncnn/csrc/parse-options.h"
 
 namespace sherpa_ncnn {
@@ -14,6 +16,12 @@ struct OfflineSenseVoiceModelConfig {
   // it should contain model.ncnn.param and model.ncnn.bin
   std::string model_dir;
 
+  // If not null, the model is loaded from its sections model.ncnn.param
+  // and model.ncnn.bin in memory instead of from model_dir. It may also
+  // contain "tokens", which is then used if --tokens is empty.
+  // See ModelBundle::FromBuffers(). They must outlive the model.
+  std::shared_ptr<const ModelBundle> buffers;
+
   // "" or "auto" to let the model recognize the language
   // valid values:
   //  zh, en, ja, ko, yue, auto
@@ -23,6 +31,11 @@ struct OfflineSenseVoiceModelConfig {
   // false to not use inverse text normalization
   bool use_itn = false;
 
+  // If true and there is model.int8.ncnn.{param,bin} in model_dir or the
+  // buffers, it is used instead of model.ncnn.{param,bin}. See
+  // generate-int8-scale-table --sense-voice for how to create it.
+  bool use_int8 = true;
+
   OfflineSenseVoiceModelConfig() = default;
   OfflineSenseVoiceModelConfig(const std::string &model_dir,
                                const std::string &language, bool use_itn)
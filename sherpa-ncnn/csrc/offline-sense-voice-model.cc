@@ -7,9 +7,14 @@
 #include <math.h>
 
 #include <algorithm>
+#include <atomic>
+#include <memory>
 #include <mutex>  // NOLINT
+#include <numeric>
 #include <string>
+#include <thread>  // NOLINT
 #include <utility>
+#include <vector>
 
 #if __ANDROID_API__ >= 9
 #include "android/asset_manager.h"
@@ -24,80 +29,204 @@
 #include "net.h"  // NOLINT
 #include "sherpa-ncnn/csrc/file-utils.h"
 #include "sherpa-ncnn/csrc/macros.h"
+#include "sherpa-ncnn/csrc/mapped-file.h"
+#include "sherpa-ncnn/csrc/memory-pool.h"
+#include "sherpa-ncnn/csrc/model.h"
+#include "sherpa-ncnn/csrc/perf-profile.h"
+#include "sherpa-ncnn/csrc/startup-stats.h"
 #include "sherpa-ncnn/csrc/text-utils.h"
 
 namespace sherpa_ncnn {
 
 namespace {
 
+/* Position encodings of SenseVoice. Row t of the table is the encoding of
+ * position t + 1.
+ *
+ * The table only grows, geometrically, and rows that are computed are
+ * never computed again. Each table is kept until this object is
+ * destroyed, so readers can use the current one without taking the lock.
+ * Callers get zero-copy views into it.
+ */
 class SinusoidalPositionEncoder {
  public:
   explicit SinusoidalPositionEncoder(int32_t dim) : dim_(dim) {}
 
+  // Return the encodings of positions 1 to len as a read-only mat of shape
+  // (len, dim). It refers to the table, which it keeps alive.
   ncnn::Mat operator()(int32_t len) {
+    const ncnn::Mat *table = table_.load(std::memory_order_acquire);
+    if (!table || table->h < len) {
+      table = Reserve(len);
+    }
+
+    // A refcounted view of the first len rows. Unlike row_range(), it
+    // shares the reference count of the table, so the reference count is
+    // never 1 and ncnn does not run in-place layers on it.
+    ncnn::Mat ans = *table;
+    ans.h = len;
+    ans.cstep = static_cast<size_t>(ans.w) * len;
+    return ans;
+  }
+
+  // Make sure the table has at least len rows and return it
+  const ncnn::Mat *Reserve(int32_t len) {
     std::lock_guard<std::mutex> lock(mutex_);
 
-    if (pos_.h < len) {
-      Resize(len);
+    const ncnn::Mat *table = table_.load(std::memory_order_relaxed);
+    int32_t old_len = table ? table->h : 0;
+    if (old_len >= len) {
+      return table;
+    }
+
+    int32_t new_len = std::max(len, old_len * 2);
+
+    auto m = std::make_unique<ncnn::Mat>(dim_, new_len);
+    float *p = *m;
+    if (table) {
+      const float *src = *table;
+      std::copy(src, src + static_cast<size_t>(old_len) * dim_, p);
     }
 
-    return pos_.row_range(0, len).clone();
+    Compute(old_len, new_len, p);
+
+    tables_.push_back(std::move(m));
+    table = tables_.back().get();
+    table_.store(table, std::memory_order_release);
+
+    return table;
   }
 
-  void Resize(int32_t len) {
-    int32_t timesteps = len;
+ private:
+  // Compute rows [begin, end) of the table at p
+  void Compute(int32_t begin, int32_t end, float *p) const {
     int32_t input_dim = dim_;
 
-    pos_.create(input_dim, timesteps);
-
     int32_t half_dim = input_dim / 2;
     float log_timescale_increment = logf(10000.f) / (half_dim - 1);
 
-    float *outptr = pos_;
-
-    for (int32_t t = 0; t < timesteps; ++t) {
+    for (int32_t t = begin; t < end; ++t) {
       int32_t pos = t + 1;  // positions start from 1
 
+      float *outptr = p + static_cast<size_t>(t) * input_dim;
       for (int32_t i = 0; i < half_dim; i++) {
         float inv_timescale = expf(-i * log_timescale_increment);
 
         float scaled_time = pos * inv_timescale;
 
-        float sinv = sinf(scaled_time);
-        float cosv = cosf(scaled_time);
-
         // write both sin and cos channels
-        outptr[t * input_dim + i] = sinv;
-        outptr[t * input_dim + i + half_dim] = cosv;
+        outptr[i] = sinf(scaled_time);
+        outptr[i + half_dim] = cosf(scaled_time);
       }
     }
   }
 
  private:
-  std::mutex mutex_;
   int32_t dim_;
-  ncnn::Mat pos_;
+
+  // Protects tables_ and the update of table_
+  std::mutex mutex_;
+
+  // All tables so far. Readers may still use an old one.
+  std::vector<std::unique_ptr<ncnn::Mat>> tables_;
+
+  // The largest one of tables_
+  std::atomic<const ncnn::Mat *> table_{nullptr};
 };
 
 }  // namespace
 
+static OfflineSenseVoiceModel::CalibrationHook &GetCalibrationHook() {
+  static OfflineSenseVoiceModel::CalibrationHook hook;
+  return hook;
+}
+
 class OfflineSenseVoiceModel::Impl {
  public:
   explicit Impl(const OfflineModelConfig &config)
-      : config_(config), pos_encoder_(560) {
+      : config_(config), hook_(GetCalibrationHook()), pos_encoder_(560) {
+    InitMemoryPools();
     InitNet();
     PostInit();
   }
 
   template <typename Manager>
   explicit Impl(Manager *mgr, const OfflineModelConfig &config)
-      : config_(config), pos_encoder_(560) {
+      : config_(config), hook_(GetCalibrationHook()), pos_encoder_(560) {
+    InitMemoryPools();
     InitNet(mgr);
     PostInit();
   }
 
   ncnn::Mat Forward(const ncnn::Mat &features, int32_t language,
                     int32_t text_norm) {
+    ncnn::Extractor ex = CreateExtractor();
+    return Forward(features, language, text_norm, &ex);
+  }
+
+  std::vector<ncnn::Mat> Forward(const std::vector<ncnn::Mat> &features,
+                                 int32_t language, int32_t text_norm) {
+    int32_t n = features.size();
+    std::vector<ncnn::Mat> ans(n);
+    if (n == 0) return ans;
+
+    // Longest first, so that the last utterances to start are short
+    std::vector<int32_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [&features](int32_t a, int32_t b) {
+                       return features[a].h > features[b].h;
+                     });
+
+    int32_t num_threads = std::max(config_.num_threads, 1);
+    int32_t num_workers = std::min(n, num_threads);
+
+    // The threads of ncnn are shared among the workers
+    int32_t threads_per_worker = std::max(num_threads / num_workers, 1);
+
+    // Grow the position encoding once for the longest utterance instead of
+    // from inside the workers
+    pos_encoder_.Reserve(features[order[0]].h + 4);
+
+    std::atomic<int32_t> next{0};
+    auto run = [&]() {
+      int32_t k;
+      while ((k = next++) < n) {
+        int32_t i = order[k];
+        ncnn::Extractor ex = CreateExtractor();
+        ex.set_num_threads(threads_per_worker);
+        ans[i] = Forward(features[i], language, text_norm, &ex);
+      }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(num_workers - 1);
+    for (int32_t i = 1; i < num_workers; ++i) {
+      workers.emplace_back(run);
+    }
+    run();
+
+    for (auto &t : workers) {
+      t.join();
+    }
+
+    return ans;
+  }
+
+  void WarmUp(float max_duration) {
+    // The frame shift of fbank is 10 ms. 4 prompt frames are prepended.
+    int32_t num_frames = static_cast<int32_t>(max_duration * 100);
+    int32_t len = num_frames / meta_data_.window_shift + 1 + 4;
+    pos_encoder_.Reserve(len);
+  }
+
+  const OfflineSenseVoiceModelMetaData &GetModelMetadata() const {
+    return meta_data_;
+  }
+
+ private:
+  ncnn::Mat Forward(const ncnn::Mat &features, int32_t language,
+                    int32_t text_norm, ncnn::Extractor *ex) {
     ncnn::Mat prompt(4);
     int32_t *p_prompt = prompt;
     p_prompt[0] = language;
@@ -107,24 +236,43 @@ class OfflineSenseVoiceModel::Impl {
 
     ncnn::Mat pos = pos_encoder_(features.h + 4);
 
-    ncnn::Extractor ex = net_.create_extractor();
-
-    ex.input("in0", features);
-    ex.input("in1", prompt);
-    ex.input("in2", pos);
+    ex->input("in0", features);
+    ex->input("in1", prompt);
+    ex->input("in2", pos);
 
     ncnn::Mat logits;
 
-    ex.extract("out0", logits);
+    ex->extract("out0", logits);
+
+    if (hook_) {
+      hook_(net_, ex);
+    }
 
-    return logits;
+    // The logits are kept after ex is destroyed, maybe on another thread
+    return memory_pools_ ? memory_pools_->Detach(logits) : logits;
   }
 
-  const OfflineSenseVoiceModelMetaData &GetModelMetadata() const {
-    return meta_data_;
+  ncnn::Extractor CreateExtractor() const {
+    ncnn::Extractor ex = net_.create_extractor();
+    if (memory_pools_) {
+      memory_pools_->Attach(&ex);
+    }
+
+    if (hook_) {
+      // Keep the intermediate blobs for the hook
+      ex.set_light_mode(false);
+    }
+    return ex;
+  }
+
+  void InitMemoryPools() {
+    if (config_.use_pool_allocator) {
+      memory_pools_ = std::make_unique<ModelMemoryPools>(
+          config_.pool_per_thread, config_.pool_limit_mb,
+          config_.use_huge_pages);
+    }
   }
 
- private:
   void PostInit() {
     meta_data_.vocab_size = 25055;
     meta_data_.window_size = 7;
@@ -144,19 +292,99 @@ class OfflineSenseVoiceModel::Impl {
         {"auto", lang_auto}, {"zh", lang_zh}, {"en", lang_en},
         {"ja", lang_ja},     {"ko", lang_ko}, {"yue", lang_yue},
     };
+
+    // Clips are usually shorter than 30 seconds
+    WarmUp(30);
   }
 
-  void InitNet() {
-    net_.opt.num_threads = config_.num_threads;
+  // Return "model.int8" if there is model.int8.ncnn.{param,bin} in the
+  // model directory or the buffers and it is not disabled. Otherwise,
+  // return "model".
+  std::string GetNetName() const {
+    const auto &c = config_.sense_voice;
+    if (!c.use_int8 || hook_) {
+      return "model";
+    }
 
-    std::string param = config_.sense_voice.model_dir + "/model.ncnn.param";
-    std::string bin = config_.sense_voice.model_dir + "/model.ncnn.bin";
+    std::string param = "model.int8.ncnn.param";
+    std::string bin = "model.int8.ncnn.bin";
+    bool found = c.buffers ? c.buffers->HasSection(param) &&
+                                 c.buffers->HasSection(bin)
+                           : FileExists(c.model_dir + "/" + param) &&
+                                 FileExists(c.model_dir + "/" + bin);
+    if (!found) {
+      return "model";
+    }
+
+    if (config_.debug) {
+      SHERPA_NCNN_LOGE("Use the int8 SenseVoice model");
+    }
+    return "model.int8";
+  }
+
+  void InitOptions() {
+    net_.opt.num_threads = config_.num_threads;
 
-    if (net_.load_param(param.c_str())) {
-      SHERPA_NCNN_LOGE("Failed to load param from '%s'", param.c_str());
+    if (!Model::SetDevice(config_.device, &net_.opt) ||
+        !Model::SetPrecision(config_.precision, &net_.opt)) {
+      SHERPA_NCNN_LOGE("Invalid device '%s' or precision '%s'",
+                       config_.device.c_str(), config_.precision.c_str());
       SHERPA_NCNN_EXIT(-1);
     }
-    if (net_.load_model(bin.c_str())) {
+
+    // Those of "sense_voice" in the performance profile take precedence.
+    // num_threads still sets the number of utterances run at a time.
+    if (!config_.perf_profile.empty()) {
+      PerfProfile profile;
+      if (!profile.Read(config_.perf_profile)) {
+        SHERPA_NCNN_LOGE("Ignore the performance profile %s",
+                         config_.perf_profile.c_str());
+      } else if (const NetTuning *t = profile.Get("sense_voice")) {
+        t->Apply(&net_.opt);
+      }
+    }
+
+    if (hook_) {
+      // The blobs are calibrated in fp32 on the CPU, and the weights are
+      // kept for computing their scales
+      net_.opt.use_vulkan_compute = false;
+      net_.opt.lightmode = false;
+      net_.opt.use_fp16_packed = false;
+      net_.opt.use_fp16_storage = false;
+      net_.opt.use_fp16_arithmetic = false;
+    }
+  }
+
+  void InitNet() {
+    InitOptions();
+
+    std::string name = GetNetName();
+    if (config_.sense_voice.buffers) {
+      InitNetFromBuffers(name);
+      return;
+    }
+
+    std::string param =
+        config_.sense_voice.model_dir + "/" + name + ".ncnn.param";
+    std::string bin = config_.sense_voice.model_dir + "/" + name + ".ncnn.bin";
+
+    {
+      ScopedStartupTimer timer(StartupPhase::kParamParse);
+      if (net_.load_param(param.c_str())) {
+        SHERPA_NCNN_LOGE("Failed to load param from '%s'", param.c_str());
+        SHERPA_NCNN_EXIT(-1);
+      }
+    }
+
+    ScopedStartupTimer timer(StartupPhase::kWeightLoad);
+    if (config_.use_mmap || config_.use_huge_pages) {
+      mapped_bin_ =
+          LoadModelFromMappedFile(bin, &net_, config_.use_huge_pages);
+      if (!mapped_bin_) {
+        SHERPA_NCNN_LOGE("Failed to load bin from '%s'", bin.c_str());
+        SHERPA_NCNN_EXIT(-1);
+      }
+    } else if (net_.load_model(bin.c_str())) {
       SHERPA_NCNN_LOGE("Failed to load bin from '%s'", bin.c_str());
       SHERPA_NCNN_EXIT(-1);
     }
@@ -164,6 +392,13 @@ class OfflineSenseVoiceModel::Impl {
 
   template <typename Manager>
   void InitNet(Manager *mgr) {
+    InitOptions();
+
+    if (config_.sense_voice.buffers) {
+      InitNetFromBuffers(GetNetName());
+      return;
+    }
+
     if (!config_.sense_voice.model_dir.empty() &&
         config_.sense_voice.model_dir[0] == '/') {
       SHERPA_NCNN_LOGE(
@@ -172,31 +407,56 @@ class OfflineSenseVoiceModel::Impl {
       SHERPA_NCNN_LOGE("You will likely get initialization failures");
     }
 
-    net_.opt.num_threads = config_.num_threads;
-
     std::string param = config_.sense_voice.model_dir + "/model.ncnn.param";
     std::string bin = config_.sense_voice.model_dir + "/model.ncnn.bin";
 
-    if (net_.load_param(mgr, param.c_str())) {
-      SHERPA_NCNN_LOGE("Failed to load param from asset '%s'", param.c_str());
-      SHERPA_NCNN_EXIT(-1);
+    {
+      ScopedStartupTimer timer(StartupPhase::kParamParse);
+      if (net_.load_param(mgr, param.c_str())) {
+        SHERPA_NCNN_LOGE("Failed to load param from asset '%s'",
+                         param.c_str());
+        SHERPA_NCNN_EXIT(-1);
+      }
     }
 
+    ScopedStartupTimer timer(StartupPhase::kWeightLoad);
     if (net_.load_model(mgr, bin.c_str())) {
       SHERPA_NCNN_LOGE("Failed to load bin from asset '%s'", bin.c_str());
       SHERPA_NCNN_EXIT(-1);
     }
   }
 
+  // config_ keeps the buffers alive
+  void InitNetFromBuffers(const std::string &name) {
+    if (!config_.sense_voice.buffers->LoadNet(name + ".ncnn.param",
+                                              name + ".ncnn.bin", &net_)) {
+      SHERPA_NCNN_LOGE("Failed to load the SenseVoice model from the buffers");
+      SHERPA_NCNN_EXIT(-1);
+    }
+  }
+
  private:
   OfflineModelConfig config_;
+
+  // Copied from GetCalibrationHook() when the model is created
+  CalibrationHook hook_;
+
   SinusoidalPositionEncoder pos_encoder_;
 
+  std::unique_ptr<MappedFile> mapped_bin_;  // net_ may refer to it
+
+  // Null if config_.use_pool_allocator is false
+  std::unique_ptr<ModelMemoryPools> memory_pools_;
+
   ncnn::Net net_;
 
   OfflineSenseVoiceModelMetaData meta_data_;
 };
 
+void OfflineSenseVoiceModel::SetCalibrationHook(CalibrationHook hook) {
+  GetCalibrationHook() = std::move(hook);
+}
+
 OfflineSenseVoiceModel::OfflineSenseVoiceModel(const OfflineModelConfig &config)
     : impl_(std::make_unique<Impl>(config)) {}
 
@@ -213,6 +473,16 @@ ncnn::Mat OfflineSenseVoiceModel::Forward(const ncnn::Mat &features,
   return impl_->Forward(features, language, text_norm);
 }
 
+std::vector<ncnn::Mat> OfflineSenseVoiceModel::Forward(
+    const std::vector<ncnn::Mat> &features, int32_t language,
+    int32_t text_norm) const {
+  return impl_->Forward(features, language, text_norm);
+}
+
+void OfflineSenseVoiceModel::WarmUp(float max_duration) const {
+  impl_->WarmUp(max_duration);
+}
+
 const OfflineSenseVoiceModelMetaData &OfflineSenseVoiceModel::GetModelMetadata()
     const {
   return impl_->GetModelMetadata();
@@ -4,6 +4,7 @@
 #ifndef SHERPA_NCNN_CSRC_OFFLINE_SENSE_VOICE_MODEL_H_
 #define SHERPA_NCNN_CSRC_OFFLINE_SENSE_VOICE_MODEL_H_
 
+#include <functional>
 #include <memory>
 #include <vector>
 
@@ -11,10 +12,32 @@
 #include "sherpa-ncnn/csrc/offline-model-config.h"
 #include "sherpa-ncnn/csrc/offline-sense-voice-model-meta-data.h"
 
+namespace ncnn {
+class Extractor;
+class Net;
+}  // namespace ncnn
+
 namespace sherpa_ncnn {
 
 class OfflineSenseVoiceModel {
  public:
+  /** It is called after the model is run for an utterance with the net
+   * and the extractor that ran it. The intermediate blobs can be extracted
+   * from ex.
+   */
+  using CalibrationHook =
+      std::function<void(const ncnn::Net &net, ncnn::Extractor *ex)>;
+
+  /** Set the hook of models that are created afterwards, e.g., to collect
+   * the statistics of the blobs for int8 calibration. Such models keep the
+   * intermediate blobs, run in fp32 and ignore model.int8.ncnn.{param,bin}.
+   * Pass nullptr to remove it.
+   *
+   * It is meant for tools such as generate-int8-scale-table and is not
+   * thread-safe.
+   */
+  static void SetCalibrationHook(CalibrationHook hook);
+
   explicit OfflineSenseVoiceModel(const OfflineModelConfig &config);
 
   template <typename Manager>
@@ -24,14 +47,14 @@ class OfflineSenseVoiceModel {
 
   /** Run the forward method of the model.
    *
-   * @param features  A tensor of shape (N, T, C). It is changed in-place.
-   * @param features_length  A 1-D tensor of shape (N,) containing number of
-   *                         valid frames in `features` before padding.
-   *                         Its dtype is int32_t.
-   * @param language A 1-D tensor of shape (N,) with dtype int32_t
-   * @param text_norm A 1-D tensor of shape (N,) with dtype int32_t
+   * @param features  A 2-D tensor of shape (T, C) containing the LFR
+   *                  features of one utterance.
+   * @param language The ID of the language
+   * @param text_norm The ID for text normalization, i.e., with_itn_id or
+   *                  without_itn_id of the meta data
    *
-   * @return Return logits of shape (N, T, C) with dtype float
+   * @return Return logits of shape (T + 4, vocab_size) with dtype float.
+   *         The first 4 frames correspond to the prompt.
    *
    * Note: The subsampling factor is 1 for SenseVoice, so there is
    *       no need to output logits_length.
@@ -39,6 +62,28 @@ class OfflineSenseVoiceModel {
   ncnn::Mat Forward(const ncnn::Mat &features, int32_t language,
                     int32_t text_norm) const;
 
+  /** Run the forward method for a batch of utterances.
+   *
+   * The exported ncnn graph has no batch dimension and no padding mask,
+   * so utterances are not padded into one tensor. Instead, they are run
+   * concurrently, each with its own extractor, on up to
+   * OfflineModelConfig::num_threads threads. Longer utterances are
+   * started first so that the threads finish at about the same time.
+   *
+   * @param features  features[i] is the (T_i, C) features of the i-th
+   *                  utterance, see Forward() above.
+   *
+   * @return Return the logits, where ans[i] is for features[i].
+   */
+  std::vector<ncnn::Mat> Forward(const std::vector<ncnn::Mat> &features,
+                                 int32_t language, int32_t text_norm) const;
+
+  /** Precompute the position encodings for utterances of up to
+   * max_duration seconds, so that no call of Forward() for them computes
+   * any. Longer utterances are still supported.
+   */
+  void WarmUp(float max_duration) const;
+
   const OfflineSenseVoiceModelMetaData &GetModelMetadata() const;
 
  private:
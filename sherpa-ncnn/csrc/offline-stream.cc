@@ -10,20 +10,25 @@
 #include <cstdint>
 #include <iomanip>
 #include <limits>
+#include <memory>
 #include <sstream>
 #include <utility>
+#include <vector>
 
 #include "kaldi-native-fbank/csrc/online-feature.h"
 #include "mat.h"  // NOLINT
+#include "sherpa-ncnn/csrc/compact-frames.h"
 #include "sherpa-ncnn/csrc/macros.h"
 #include "sherpa-ncnn/csrc/offline-recognizer.h"
+#include "sherpa-ncnn/csrc/pcm-utils.h"
 #include "sherpa-ncnn/csrc/resample.h"
 
 namespace sherpa_ncnn {
 
 class OfflineStream::Impl {
  public:
-  explicit Impl(const FeatureExtractorConfig &config) : config_(config) {
+  Impl(const FeatureExtractorConfig &config, ContextGraphPtr context_graph)
+      : config_(config), context_graph_(std::move(context_graph)) {
     knf::FbankOptions opts;
     opts.frame_opts.dither = config.dither;
     opts.frame_opts.snip_edges = config.snip_edges;
@@ -41,6 +46,15 @@ class OfflineStream::Impl {
     opts.mel_opts.is_librosa = config.is_librosa;
 
     fbank_ = std::make_unique<knf::OnlineFbank>(opts);
+
+    CompactFrames::Format format;
+    if (CompactFrames::ParseFormat(config.feature_storage, &format)) {
+      compact_ = std::make_unique<CompactFrames>(config.feature_dim, format);
+    } else if (config.feature_storage != "fp32") {
+      SHERPA_NCNN_LOGE("Unknown feature_storage: %s",
+                       config.feature_storage.c_str());
+      SHERPA_NCNN_EXIT(-1);
+    }
   }
 
   void AcceptWaveform(int32_t sampling_rate, const float *waveform, int32_t n) {
@@ -55,8 +69,43 @@ class OfflineStream::Impl {
     }
   }
 
+  void AcceptWaveformInt16(int32_t sampling_rate, const int16_t *waveform,
+                           int32_t n) {
+    float scale = config_.normalize_samples ? 1.0f / 32768 : 1.0f;
+
+    std::vector<float> buf(n);
+    Int16ToFloat(waveform, n, scale, buf.data());
+    AcceptWaveformImpl(sampling_rate, buf.data(), n);
+  }
+
   void AcceptWaveformImpl(int32_t sampling_rate, const float *waveform,
                           int32_t n) {
+    ComputeFrames(sampling_rate, waveform, n);
+    MoveFrames();
+  }
+
+  void ComputeFrames(int32_t sampling_rate, const float *waveform,
+                     int32_t n) {
+    if (input_finished_) {
+      SHERPA_NCNN_LOGE("Don't call AcceptWaveform() after InputFinished()");
+      SHERPA_NCNN_EXIT(-1);
+    }
+
+    if (resampler_) {
+      if (sampling_rate != resampler_->GetInputSamplingRate()) {
+        SHERPA_NCNN_LOGE(
+            "You changed the input sampling rate!! Expected: %d, given: "
+            "%d",
+            resampler_->GetInputSamplingRate(), sampling_rate);
+        SHERPA_NCNN_EXIT(-1);
+      }
+
+      resampler_->Resample(waveform, n, false, &resampled_);
+      fbank_->AcceptWaveform(config_.sampling_rate, resampled_.data(),
+                             resampled_.size());
+      return;
+    }
+
     if (sampling_rate != config_.sampling_rate) {
       SHERPA_NCNN_LOGE(
           "Creating a resampler:\n"
@@ -68,26 +117,54 @@ class OfflineStream::Impl {
       float lowpass_cutoff = 0.99 * 0.5 * min_freq;
 
       int32_t lowpass_filter_width = 6;
-      auto resampler = std::make_unique<LinearResample>(
+      resampler_ = std::make_unique<LinearResample>(
           sampling_rate, config_.sampling_rate, lowpass_cutoff,
           lowpass_filter_width);
-      std::vector<float> samples;
-      resampler->Resample(waveform, n, true, &samples);
 
-      fbank_->AcceptWaveform(config_.sampling_rate, samples.data(),
-                             samples.size());
-      fbank_->InputFinished();
+      resampler_->Resample(waveform, n, false, &resampled_);
+      fbank_->AcceptWaveform(config_.sampling_rate, resampled_.data(),
+                             resampled_.size());
       return;
     }  // if (sampling_rate != config_.sampling_rate)
 
     fbank_->AcceptWaveform(sampling_rate, waveform, n);
+  }
+
+  void InputFinished() {
+    if (input_finished_) return;
+
+    if (resampler_) {
+      // Flush the samples that the resampler still holds
+      resampler_->Resample(nullptr, 0, true, &resampled_);
+      fbank_->AcceptWaveform(config_.sampling_rate, resampled_.data(),
+                             resampled_.size());
+    }
+
     fbank_->InputFinished();
+    MoveFrames();
+    input_finished_ = true;
+
+    // No more samples follow, so release the buffers of the waveform
+    resampler_.reset();
+    std::vector<float>().swap(resampled_);
+
+    if (compact_) {
+      // All frames have been moved to compact_
+      fbank_.reset();
+      compact_->ShrinkToFit();
+    }
   }
 
+  bool IsInputFinished() const { return input_finished_; }
+
   int32_t FeatureDim() const { return config_.feature_dim; }
 
+  int32_t NumFramesReady() const {
+    return compact_ ? compact_->NumFrames() : fbank_->NumFramesReady();
+  }
+
   ncnn::Mat GetFrames() const {
-    int32_t n = fbank_->NumFramesReady();
+    int32_t n = NumFramesReady();
     assert(n > 0 && "Please first call AcceptWaveform()");
 
     int32_t feature_dim = FeatureDim();
@@ -96,25 +173,93 @@ class OfflineStream::Impl {
     features.create(feature_dim, n);
 
     for (int32_t i = 0; i != n; ++i) {
-      const float *f = fbank_->GetFrame(i);
-      std::copy(f, f + feature_dim, features.row(i));
+      CopyFrame(i, features.row(i));
     }
 
     return features;
   }
 
+  int32_t NumLfrFrames(int32_t window_size, int32_t window_shift) const {
+    int32_t n = NumFramesReady();
+    return n < window_size ? 0 : (n - window_size) / window_shift + 1;
+  }
+
+  ncnn::Mat GetLfrFrames(int32_t window_size, int32_t window_shift,
+                         int32_t start, int32_t num_out_frames) const {
+    assert(NumFramesReady() > 0 && "Please first call AcceptWaveform()");
+    assert(start >= 0 && num_out_frames >= 0 &&
+           start + num_out_frames <= NumLfrFrames(window_size, window_shift));
+
+    int32_t feature_dim = FeatureDim();
+
+    ncnn::Mat features;
+    features.create(feature_dim * window_size, num_out_frames);
+
+    for (int32_t i = 0; i != num_out_frames; ++i) {
+      float *p = features.row(i);
+      int32_t offset = (start + i) * window_shift;
+      for (int32_t k = 0; k != window_size; ++k) {
+        CopyFrame(offset + k, p + k * feature_dim);
+      }
+    }
+
+    return features;
+  }
+
+  const ContextGraphPtr &GetContextGraph() const { return context_graph_; }
+
   void SetResult(const OfflineRecognizerResult &r) { r_ = r; }
 
   const OfflineRecognizerResult &GetResult() const { return r_; }
 
+ private:
+  // Move the frames computed so far from fbank_ to compact_
+  void MoveFrames() {
+    if (!compact_) return;
+
+    int32_t num_ready = fbank_->NumFramesReady();
+    int32_t num_moved = compact_->NumFrames();
+    for (int32_t i = num_moved; i != num_ready; ++i) {
+      compact_->Push(fbank_->GetFrame(i));
+    }
+
+    fbank_->Pop(num_ready - num_moved);
+  }
+
+  void CopyFrame(int32_t i, float *out) const {
+    if (compact_) {
+      compact_->GetFrame(i, out);
+      return;
+    }
+
+    const float *f = fbank_->GetFrame(i);
+    std::copy(f, f + FeatureDim(), out);
+  }
+
  private:
   FeatureExtractorConfig config_;
+  ContextGraphPtr context_graph_;
   std::unique_ptr<knf::OnlineFbank> fbank_;
+
+  // Not null if config_.feature_storage is fp16 or int8. Frames are moved
+  // here from fbank_ as soon as they are computed and fbank_ is released
+  // by InputFinished().
+  std::unique_ptr<CompactFrames> compact_;
+
+  // Created by the first AcceptWaveform() call whose sampling rate differs
+  // from config_.sampling_rate. It keeps its state across calls.
+  std::unique_ptr<LinearResample> resampler_;
+
+  // Output of resampler_, reused across calls
+  std::vector<float> resampled_;
+
+  bool input_finished_ = false;
   OfflineRecognizerResult r_;
 };
 
-OfflineStream::OfflineStream(const FeatureExtractorConfig &config /*= {}*/)
-    : impl_(std::make_unique<Impl>(config)) {}
+OfflineStream::OfflineStream(const FeatureExtractorConfig &config /*= {}*/,
+                             ContextGraphPtr context_graph /*= nullptr*/)
+    : impl_(std::make_unique<Impl>(config, std::move(context_graph))) {}
 
 OfflineStream::~OfflineStream() = default;
 
@@ -123,10 +268,60 @@ void OfflineStream::AcceptWaveform(int32_t sampling_rate, const float *waveform,
   impl_->AcceptWaveform(sampling_rate, waveform, n);
 }
 
+void OfflineStream::AcceptWaveform(int32_t sampling_rate,
+                                   const CircularBufferView &waveform) const {
+  // Both parts go to the same incremental feature extractor, so the result
+  // is the same as for one contiguous array
+  if (waveform.size1 > 0) {
+    impl_->AcceptWaveform(sampling_rate, waveform.data1, waveform.size1);
+  }
+
+  if (waveform.size2 > 0) {
+    impl_->AcceptWaveform(sampling_rate, waveform.data2, waveform.size2);
+  }
+}
+
+void OfflineStream::AcceptWaveformInt16(int32_t sampling_rate,
+                                        const int16_t *waveform,
+                                        int32_t n) const {
+  impl_->AcceptWaveformInt16(sampling_rate, waveform, n);
+}
+
+void OfflineStream::InputFinished() const { impl_->InputFinished(); }
+
+bool OfflineStream::IsInputFinished() const {
+  return impl_->IsInputFinished();
+}
+
 int32_t OfflineStream::FeatureDim() const { return impl_->FeatureDim(); }
 
+int32_t OfflineStream::NumFramesReady() const {
+  return impl_->NumFramesReady();
+}
+
 ncnn::Mat OfflineStream::GetFrames() const { return impl_->GetFrames(); }
 
+ncnn::Mat OfflineStream::GetLfrFrames(int32_t window_size,
+                                      int32_t window_shift) const {
+  return impl_->GetLfrFrames(window_size, window_shift, 0,
+                             impl_->NumLfrFrames(window_size, window_shift));
+}
+
+ncnn::Mat OfflineStream::GetLfrFrames(int32_t window_size,
+                                      int32_t window_shift, int32_t start,
+                                      int32_t n) const {
+  return impl_->GetLfrFrames(window_size, window_shift, start, n);
+}
+
+int32_t OfflineStream::NumLfrFrames(int32_t window_size,
+                                    int32_t window_shift) const {
+  return impl_->NumLfrFrames(window_size, window_shift);
+}
+
+const ContextGraphPtr &OfflineStream::GetContextGraph() const {
+  return impl_->GetContextGraph();
+}
+
 void OfflineStream::SetResult(const OfflineRecognizerResult &r) {
   impl_->SetResult(r);
 }
@@ -11,6 +11,8 @@
 #include <vector>
 
 #include "math.h"  // NOLINT
+#include "sherpa-ncnn/csrc/circular-buffer.h"
+#include "sherpa-ncnn/csrc/context-graph.h"
 #include "sherpa-ncnn/csrc/features.h"
 #include "sherpa-ncnn/csrc/parse-options.h"
 
@@ -44,7 +46,8 @@ struct OfflineRecognizerResult {
 
 class OfflineStream {
  public:
-  explicit OfflineStream(const FeatureExtractorConfig &config = {});
+  explicit OfflineStream(const FeatureExtractorConfig &config = {},
+                         ContextGraphPtr context_graph = nullptr);
   ~OfflineStream();
 
   /**
@@ -55,23 +58,82 @@ class OfflineStream {
                      the range [-1, 1].
      @param n Number of entries in waveform
 
-     Caution: You can only invoke this function once so you have to input
-              all the samples at once
+     It can be called many times as the audio arrives, e.g., from a
+     microphone. Feature frames are computed as the samples are received.
+     After the last call, invoke InputFinished(). The sampling rate must
+     not change between calls.
    */
   void AcceptWaveform(int32_t sampling_rate, const float *waveform,
                       int32_t n) const;
 
+  /** Same as AcceptWaveform() above but for samples that are still in a
+   * CircularBuffer, e.g., a speech segment from
+   * VoiceActivityDetector::FrontView(). The samples are not copied
+   * beforehand.
+   */
+  void AcceptWaveform(int32_t sampling_rate,
+                      const CircularBufferView &waveform) const;
+
+  /** Same as AcceptWaveform() but for 16-bit PCM samples.
+   *
+   * They are converted with SIMD to the range the model expects in one
+   * pass: scaled by 1/32768 if config.normalize_samples is true and used
+   * as they are otherwise.
+   */
+  void AcceptWaveformInt16(int32_t sampling_rate, const int16_t *waveform,
+                           int32_t n) const;
+
+  /** Tell the stream that no more samples will follow. It flushes the
+   * last feature frames. Calling it more than once is fine.
+   *
+   * OfflineRecognizer::DecodeStreams() calls it for streams that have not
+   * been finished, so it is optional if the stream is decoded right after
+   * the last AcceptWaveform() call.
+   */
+  void InputFinished() const;
+
+  /// Return true if InputFinished() has been called
+  bool IsInputFinished() const;
+
   /// Return feature dim of this extractor.
   ///
   /// Note: if it is Moonshine, then it returns the number of audio samples
   /// currently received.
   int32_t FeatureDim() const;
 
+  /// Return the number of feature frames of this stream
+  int32_t NumFramesReady() const;
+
   /** Get all the feature frames of this stream in a 2-D array
    * @return Return a 2-D tensor of shape (n, feature_dim).
    */
   ncnn::Mat GetFrames() const;
 
+  /** Get the low frame rate (LFR) features of this stream, e.g., for
+   * SenseVoice. Output frame i is the concatenation of the feature frames
+   * [i * window_shift, i * window_shift + window_size). They are copied
+   * from the feature extractor directly, so it needs neither the output
+   * of GetFrames() nor a second pass.
+   *
+   * @return Return a 2-D tensor of shape
+   *         ((n - window_size) / window_shift + 1,
+   *          feature_dim * window_size), where n is NumFramesReady().
+   */
+  ncnn::Mat GetLfrFrames(int32_t window_size, int32_t window_shift) const;
+
+  /** Same as the above one, but return only the LFR frames
+   * [start, start + n). They must be within
+   * [0, NumLfrFrames(window_size, window_shift)).
+   */
+  ncnn::Mat GetLfrFrames(int32_t window_size, int32_t window_shift,
+                         int32_t start, int32_t n) const;
+
+  /// Return the number of LFR frames GetLfrFrames() would return
+  int32_t NumLfrFrames(int32_t window_size, int32_t window_shift) const;
+
+  /// Return the context graph for hotwords biasing. It may be null.
+  const ContextGraphPtr &GetContextGraph() const;
+
   /** Set the recognition result for this stream. */
   void SetResult(const OfflineRecognizerResult &r);
 
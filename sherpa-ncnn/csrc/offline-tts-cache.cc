@@ -0,0 +1,195 @@
+// sherpa-ncnn/csrc/offline-tts-cache.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/offline-tts-cache.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include <thread>  // NOLINT
+#include <utility>
+
+#include "sherpa-ncnn/csrc/macros.h"
+#include "sherpa-ncnn/csrc/mapped-file.h"
+#include "sherpa-ncnn/csrc/text-utils.h"
+
+namespace sherpa_ncnn {
+
+static constexpr char kMagic[4] = {'T', 'T', 'S', 'A'};
+
+// The header of a file is kMagic followed by 3 int32
+static constexpr int32_t kHeaderSize = 16;
+
+OfflineTtsCache::OfflineTtsCache(const OfflineTtsConfig &config)
+    : dir_(config.audio_cache_dir), audios_(config.audio_cache_size) {
+  std::ostringstream os;
+  os << config.model.vits.ToString() << "|seed=" << config.seed
+     << "|chunk=" << config.decoder_chunk_size << ","
+     << config.decoder_chunk_overlap;
+  model_id_ = os.str();
+}
+
+std::string OfflineTtsCache::GetKey(const TtsArgs &args) const {
+  std::ostringstream os;
+
+  // hexfloat is exact
+  os << std::hexfloat;
+  os << model_id_ << "|sid=" << args.sid << "|speed=" << args.speed
+     << "|noise_scale=" << args.noise_scale
+     << "|noise_scale_w=" << args.noise_scale_w << "|seed=" << args.seed;
+
+  {
+    std::lock_guard<std::mutex> lock(embeddings_mutex_);
+    auto it = embeddings_.find(args.sid);
+    if (it != embeddings_.end()) {
+      os << "|embedding=" << std::hex << it->second << std::dec;
+    }
+  }
+
+  if (!args.text.empty()) {
+    os << "|text=" << args.text;
+  } else {
+    os << "|tokens=";
+    for (const auto &sentence : args.tokens) {
+      for (int32_t t : sentence) {
+        os << t << ' ';
+      }
+      os << ';';
+    }
+  }
+
+  return os.str();
+}
+
+void OfflineTtsCache::SetSpeakerEmbedding(
+    int32_t sid, const std::vector<float> &embedding) const {
+  std::string bytes(reinterpret_cast<const char *>(embedding.data()),
+                    embedding.size() * sizeof(float));
+
+  std::lock_guard<std::mutex> lock(embeddings_mutex_);
+  embeddings_[sid] = Fnv1a(bytes);
+}
+
+bool OfflineTtsCache::Get(const std::string &key,
+                          GeneratedAudio *audio) const {
+  std::shared_ptr<const GeneratedAudio> p;
+  if (audios_.Get(key, &p)) {
+    *audio = *p;
+    return true;
+  }
+
+  if (dir_.empty() || !ReadFile(key, audio)) {
+    return false;
+  }
+
+  audios_.Put(key, std::make_shared<GeneratedAudio>(*audio));
+
+  return true;
+}
+
+void OfflineTtsCache::Put(const std::string &key,
+                          const GeneratedAudio &audio) const {
+  audios_.Put(key, std::make_shared<GeneratedAudio>(audio));
+
+  if (!dir_.empty()) {
+    WriteFile(key, audio);
+  }
+}
+
+std::string OfflineTtsCache::GetFilename(const std::string &key) const {
+  std::ostringstream os;
+  os << dir_ << "/" << std::hex << std::setw(16) << std::setfill('0')
+     << Fnv1a(key) << ".ttsa";
+  return os.str();
+}
+
+bool OfflineTtsCache::ReadFile(const std::string &key,
+                               GeneratedAudio *audio) const {
+  auto f = MappedFile::Open(GetFilename(key));
+  if (!f || f->Size() < kHeaderSize) {
+    return false;
+  }
+
+  const unsigned char *p = f->Data();
+  if (std::memcmp(p, kMagic, sizeof(kMagic)) != 0) {
+    return false;
+  }
+
+  int32_t header[3];
+  std::memcpy(header, p + sizeof(kMagic), sizeof(header));
+
+  int32_t sample_rate = header[0];
+  int32_t key_size = header[1];
+  int32_t num_samples = header[2];
+
+  std::size_t samples_offset = kHeaderSize + (key_size + 3) / 4 * 4;
+  if (key_size < 0 || num_samples < 0 ||
+      f->Size() != samples_offset + num_samples * sizeof(float)) {
+    SHERPA_NCNN_LOGE("Ignore corrupted cache file %s",
+                     GetFilename(key).c_str());
+    return false;
+  }
+
+  if (key_size != static_cast<int32_t>(key.size()) ||
+      std::memcmp(p + kHeaderSize, key.data(), key_size) != 0) {
+    // A hash collision
+    return false;
+  }
+
+  audio->sample_rate = sample_rate;
+  audio->samples.resize(num_samples);
+  std::memcpy(audio->samples.data(), p + samples_offset,
+              num_samples * sizeof(float));
+
+  return true;
+}
+
+void OfflineTtsCache::WriteFile(const std::string &key,
+                                const GeneratedAudio &audio) const {
+  std::string filename = GetFilename(key);
+
+  // Write to a file of this thread and rename it, so that readers never
+  // see a partial file
+  std::string tmp =
+      filename + ".tmp" +
+      std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+
+  {
+    std::ofstream os(tmp, std::ios::binary);
+    if (!os) {
+      SHERPA_NCNN_LOGE("Failed to create %s", tmp.c_str());
+      return;
+    }
+
+    int32_t header[3] = {audio.sample_rate, static_cast<int32_t>(key.size()),
+                         static_cast<int32_t>(audio.samples.size())};
+    char padding[3] = {0};
+
+    os.write(kMagic, sizeof(kMagic));
+    os.write(reinterpret_cast<const char *>(header), sizeof(header));
+    os.write(key.data(), key.size());
+    os.write(padding, (4 - key.size() % 4) % 4);
+    os.write(reinterpret_cast<const char *>(audio.samples.data()),
+             audio.samples.size() * sizeof(float));
+
+    if (!os) {
+      SHERPA_NCNN_LOGE("Failed to write %s", tmp.c_str());
+      os.close();
+      std::remove(tmp.c_str());
+      return;
+    }
+  }
+
+  if (std::rename(tmp.c_str(), filename.c_str()) != 0) {
+    SHERPA_NCNN_LOGE("Failed to rename %s to %s", tmp.c_str(),
+                     filename.c_str());
+    std::remove(tmp.c_str());
+  }
+}
+
+}  // namespace sherpa_ncnn
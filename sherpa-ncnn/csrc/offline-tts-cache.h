@@ -0,0 +1,79 @@
+// sherpa-ncnn/csrc/offline-tts-cache.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_OFFLINE_TTS_CACHE_H_
+#define SHERPA_NCNN_CSRC_OFFLINE_TTS_CACHE_H_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/lru-cache.h"
+#include "sherpa-ncnn/csrc/offline-tts.h"
+
+namespace sherpa_ncnn {
+
+/** A cache of generated audios for prompts that are synthesized again and
+ * again.
+ *
+ * Audios are kept in an in-memory LRU cache and, if a directory is given,
+ * in one file per audio in that directory. A file is memory-mapped when it
+ * is read, so it is shared by all processes that use the directory.
+ *
+ * A file contains, in the byte order of the host:
+ *
+ *   "TTSA", sample_rate, key_size, num_samples,  // int32
+ *   key[key_size], zero padding to a multiple of 4 bytes,
+ *   samples[num_samples]  // float32
+ *
+ * Its name is derived from a hash of the key. The key is stored so that
+ * a hash collision is a miss.
+ */
+class OfflineTtsCache {
+ public:
+  // Use config.audio_cache_size and config.audio_cache_dir. The other
+  // fields of config that affect the output are part of every key.
+  explicit OfflineTtsCache(const OfflineTtsConfig &config);
+
+  // Return the key of args. It includes a hash of the embedding of
+  // args.sid if one was set with SetSpeakerEmbedding().
+  std::string GetKey(const TtsArgs &args) const;
+
+  // Call it whenever OfflineTts::SetSpeakerEmbedding() succeeds, so that
+  // audios of the old voice of sid are not returned for the new one
+  void SetSpeakerEmbedding(int32_t sid,
+                           const std::vector<float> &embedding) const;
+
+  // Return true and set *audio if key is in the cache
+  bool Get(const std::string &key, GeneratedAudio *audio) const;
+
+  void Put(const std::string &key, const GeneratedAudio &audio) const;
+
+  // Return the path of the file of key in the cache directory
+  std::string GetFilename(const std::string &key) const;
+
+ private:
+  bool ReadFile(const std::string &key, GeneratedAudio *audio) const;
+
+  void WriteFile(const std::string &key, const GeneratedAudio &audio) const;
+
+ private:
+  std::string dir_;
+
+  // Identifies the model and the options that affect the generated audio
+  std::string model_id_;
+
+  LruCache<std::string, std::shared_ptr<const GeneratedAudio>> audios_;
+
+  // sid -> Fnv1a() of the bytes of its custom embedding
+  mutable std::mutex embeddings_mutex_;
+  mutable std::unordered_map<int32_t, uint64_t> embeddings_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_OFFLINE_TTS_CACHE_H_
@@ -13,7 +13,8 @@ namespace sherpa_ncnn {
 
 std::unique_ptr<OfflineTtsImpl> OfflineTtsImpl::Create(
     const OfflineTtsConfig &config) {
-  if (!config.model.vits.model_dir.empty()) {
+  if (!config.model.vits.model_dir.empty() ||
+      !config.model.vits.bundle.empty() || config.model.vits.buffers) {
     return std::make_unique<OfflineTtsVitsImpl>(config);
   }
 
@@ -23,12 +23,33 @@ class OfflineTtsImpl {
                                   GeneratedAudioCallback callback = nullptr,
                                   void *callback_arg = nullptr) const = 0;
 
+  // See OfflineTts::GenerateBatch(). The default implementation generates
+  // the requests one by one.
+  virtual std::vector<GeneratedAudio> GenerateBatch(
+      const std::vector<TtsArgs> &args) const {
+    std::vector<GeneratedAudio> ans;
+    ans.reserve(args.size());
+    for (const auto &a : args) {
+      ans.push_back(Generate(a));
+    }
+    return ans;
+  }
+
   // Return the sample rate of the generated audio
   virtual int32_t SampleRate() const = 0;
 
   // Number of supported speakers.
   // If it supports only a single speaker, then it return 0 or 1.
   virtual int32_t NumSpeakers() const = 0;
+
+  // See OfflineTts::GetLatencyStats()
+  virtual const LatencyStats *GetLatencyStats() const { return nullptr; }
+
+  // See OfflineTts::SetSpeakerEmbedding()
+  virtual bool SetSpeakerEmbedding(int32_t sid,
+                                   const std::vector<float> &embedding) const {
+    return false;
+  }
 };
 
 }  // namespace sherpa_ncnn
@@ -4,6 +4,8 @@
 
 #include "sherpa-ncnn/csrc/offline-tts-model-config.h"
 
+#include <string>
+
 #include "sherpa-ncnn/csrc/macros.h"
 
 namespace sherpa_ncnn {
@@ -14,8 +16,54 @@ void OfflineTtsModelConfig::Register(ParseOptions *po) {
   po->Register("num-threads", &num_threads,
                "Number of threads to run the neural network");
 
+  po->Register("encoder-num-threads", &encoder_num_threads,
+               "If positive, number of threads of the encoder, duration "
+               "predictor and speaker embedding nets. Otherwise, "
+               "--num-threads is used");
+
+  po->Register("decoder-num-threads", &decoder_num_threads,
+               "If positive, number of threads of the flow and decoder nets. "
+               "Otherwise, --num-threads is used");
+
+  po->Register("encoder-device", &encoder_device,
+               "Where the encoder, duration predictor and speaker embedding "
+               "nets run: cpu or gpu. With gpu, the CPU is used if there is "
+               "no GPU");
+
+  po->Register("decoder-device", &decoder_device,
+               "Where the flow and decoder nets run: cpu or gpu");
+
+  po->Register("encoder-precision", &encoder_precision,
+               "Precision of the encoder, duration predictor and speaker "
+               "embedding nets: accuracy, balanced or speed. Leave it empty "
+               "to use the defaults of ncnn");
+
+  po->Register("decoder-precision", &decoder_precision,
+               "Precision of the flow and decoder nets: accuracy, balanced "
+               "or speed");
+
+  po->Register("perf-profile", &perf_profile,
+               "A file with the options of the nets on this device, see "
+               "sherpa-ncnn-autotune");
+
   po->Register("debug", &debug,
                "true to print model information while loading it.");
+
+  po->Register("use-mmap", &use_mmap,
+               "true to memory-map the .bin files of the model instead of "
+               "reading them into memory");
+
+  po->Register("use-pool-allocator", &use_pool_allocator,
+               "true to allocate the intermediate blobs of the model from "
+               "memory pools that are reused from run to run");
+
+  po->Register("pool-per-thread", &pool_per_thread,
+               "true to give each thread its own memory pools, which need "
+               "no lock");
+
+  po->Register("pool-limit-mb", &pool_limit_mb,
+               "If positive, each memory pool keeps freed memory only while "
+               "it holds at most this many MB");
 }
 
 bool OfflineTtsModelConfig::Validate() const {
@@ -24,7 +72,25 @@ bool OfflineTtsModelConfig::Validate() const {
     return false;
   }
 
-  if (!vits.model_dir.empty()) {
+  for (const auto *device : {&encoder_device, &decoder_device}) {
+    if (*device != "cpu" && *device != "gpu") {
+      SHERPA_NCNN_LOGE("Unknown device '%s'. Please use cpu or gpu",
+                       device->c_str());
+      return false;
+    }
+  }
+
+  for (const auto *precision : {&encoder_precision, &decoder_precision}) {
+    if (!precision->empty() && *precision != "accuracy" &&
+        *precision != "balanced" && *precision != "speed") {
+      SHERPA_NCNN_LOGE(
+          "Unknown precision '%s'. Please use accuracy, balanced or speed",
+          precision->c_str());
+      return false;
+    }
+  }
+
+  if (!vits.model_dir.empty() || !vits.bundle.empty() || vits.buffers) {
     return vits.Validate();
   }
 
@@ -39,7 +105,19 @@ std::string OfflineTtsModelConfig::ToString() const {
   os << "OfflineTtsModelConfig(";
   os << "vits=" << vits.ToString() << ", ";
   os << "num_threads=" << num_threads << ", ";
-  os << "debug=" << (debug ? "True" : "False");
+  os << "encoder_num_threads=" << encoder_num_threads << ", ";
+  os << "decoder_num_threads=" << decoder_num_threads << ", ";
+  os << "encoder_device=\"" << encoder_device << "\", ";
+  os << "decoder_device=\"" << decoder_device << "\", ";
+  os << "encoder_precision=\"" << encoder_precision << "\", ";
+  os << "decoder_precision=\"" << decoder_precision << "\", ";
+  os << "perf_profile=\"" << perf_profile << "\", ";
+  os << "debug=" << (debug ? "True" : "False") << ", ";
+  os << "use_pool_allocator=" << (use_pool_allocator ? "True" : "False")
+     << ", ";
+  os << "pool_per_thread=" << (pool_per_thread ? "True" : "False") << ", ";
+  os << "pool_limit_mb=" << pool_limit_mb << ", ";
+  os << "use_mmap=" << (use_mmap ? "True" : "False") << ")";
 
   return os.str();
 }
@@ -16,8 +16,54 @@ struct OfflineTtsModelConfig {
   OfflineTtsVitsModelConfig vits;
 
   int32_t num_threads = 1;
+
+  // Number of threads of the nets that run before the flow, i.e., the
+  // encoder, the duration predictor and the speaker embedding. If it is
+  // not positive, num_threads is used.
+  int32_t encoder_num_threads = 0;
+
+  // Number of threads of the flow and the decoder. If it is not positive,
+  // num_threads is used.
+  int32_t decoder_num_threads = 0;
+
+  // Where the nets run: "cpu" or "gpu". With "gpu", they run on the GPU
+  // with Vulkan if there is one and on the CPU otherwise. The custom
+  // layers of the encoder and the duration predictor always run on the
+  // CPU; ncnn moves their inputs and outputs between the devices. The
+  // encoder nets are those of encoder_num_threads, the decoder nets those
+  // of decoder_num_threads.
+  std::string encoder_device = "cpu";
+  std::string decoder_device = "cpu";
+
+  // The precision of the nets: "accuracy", "balanced" or "speed", see
+  // ModelConfig::encoder_precision. If empty, the defaults of ncnn are
+  // used.
+  std::string encoder_precision;
+  std::string decoder_precision;
+
+  // If not empty, a file written by sherpa-ncnn-autotune for this device.
+  // The options of "tts_encoder" and "tts_decoder" in it replace those
+  // above. See PerfProfile.
+  std::string perf_profile;
+
   bool debug = false;
 
+  // If true, the .bin files of the model are memory-mapped instead of read
+  // into memory
+  bool use_mmap = false;
+
+  // If true, intermediate blobs and workspace of the networks are allocated
+  // from memory pools owned by the model, so that no heap allocation
+  // happens once the pools are warmed up. See ModelMemoryPools.
+  bool use_pool_allocator = true;
+
+  // If true, each thread has its own pools, which need no lock
+  bool pool_per_thread = false;
+
+  // If positive, each pool keeps freed memory only while it holds at most
+  // this many MB
+  int32_t pool_limit_mb = 0;
+
   OfflineTtsModelConfig() = default;
 
   OfflineTtsModelConfig(const OfflineTtsVitsModelConfig &vits,
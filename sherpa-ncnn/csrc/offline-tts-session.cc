@@ -0,0 +1,164 @@
+// sherpa-ncnn/csrc/offline-tts-session.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/offline-tts-session.h"
+
+#include <cctype>
+#include <string>
+#include <utility>
+
+namespace sherpa_ncnn {
+
+// Return the number of bytes of the clause boundary at text[i], or 0 if
+// there is none
+static int32_t ClauseBoundary(const std::string &text, std::size_t i) {
+  // The Chinese punctuations that NormalizeChinesePunctuation() maps to
+  // , . ! ? ;
+  static const char *kChinese[] = {"，", "。", "！", "？", "；"};
+
+  char c = text[i];
+  if (c == '\n') {
+    return 1;
+  }
+
+  if (c == ',' || c == '.' || c == '?' || c == '!' || c == ';') {
+    // Wait for the next character if there is none
+    return i + 1 < text.size() &&
+           std::isspace(static_cast<uint8_t>(text[i + 1]));
+  }
+
+  for (const char *p : kChinese) {
+    // All of them are 3 bytes
+    if (text.compare(i, 3, p) == 0) {
+      return 3;
+    }
+  }
+
+  return 0;
+}
+
+std::string TakeCompleteClauses(std::string *text, bool flush /*= false*/) {
+  std::string ans;
+  if (flush) {
+    ans.swap(*text);
+    return ans;
+  }
+
+  std::size_t end = 0;
+  for (std::size_t i = 0; i < text->size(); ++i) {
+    int32_t n = ClauseBoundary(*text, i);
+    if (n > 0) {
+      i += n - 1;
+      end = i + 1;
+    }
+  }
+
+  ans = text->substr(0, end);
+  text->erase(0, end);
+
+  return ans;
+}
+
+OfflineTtsSession::OfflineTtsSession(const OfflineTts *tts,
+                                     const TtsArgs &args,
+                                     GeneratedAudioCallback callback,
+                                     void *callback_arg /*= nullptr*/)
+    : tts_(tts),
+      args_(args),
+      callback_(std::move(callback)),
+      callback_arg_(callback_arg) {
+  args_.text.clear();
+  args_.tokens.clear();
+
+  thread_ = std::thread([this]() { Run(); });
+}
+
+OfflineTtsSession::~OfflineTtsSession() {
+  if (thread_.joinable()) {
+    Cancel();
+  }
+}
+
+void OfflineTtsSession::AcceptText(const std::string &text) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (finished_) {
+    return;
+  }
+
+  pending_.append(text);
+
+  std::string clauses = TakeCompleteClauses(&pending_);
+  if (!clauses.empty()) {
+    ready_.append(clauses);
+    cond_.notify_one();
+  }
+}
+
+void OfflineTtsSession::Finish() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ready_.append(TakeCompleteClauses(&pending_, true));
+    finished_ = true;
+  }
+  cond_.notify_one();
+
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void OfflineTtsSession::Cancel() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cancelled_ = true;
+    finished_ = true;
+  }
+  cond_.notify_one();
+
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void OfflineTtsSession::Run() {
+  while (true) {
+    TtsArgs args = args_;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cond_.wait(lock, [this]() {
+        return cancelled_ || finished_ || !ready_.empty();
+      });
+
+      if (cancelled_ || ready_.empty()) {
+        return;
+      }
+
+      args.text.swap(ready_);
+    }
+
+    tts_->Generate(
+        args,
+        [this](const float *samples, int32_t n, int32_t processed,
+               int32_t total, void * /*arg*/) -> int32_t {
+          return OnAudio(samples, n, processed, total);
+        });
+  }
+}
+
+int32_t OfflineTtsSession::OnAudio(const float *samples, int32_t n,
+                                   int32_t processed, int32_t total) {
+  if (cancelled_) {
+    return 0;
+  }
+
+  if (!callback_ || callback_(samples, n, processed, total, callback_arg_)) {
+    return 1;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  cancelled_ = true;
+  return 0;
+}
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,94 @@
+// sherpa-ncnn/csrc/offline-tts-session.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+#ifndef SHERPA_NCNN_CSRC_OFFLINE_TTS_SESSION_H_
+#define SHERPA_NCNN_CSRC_OFFLINE_TTS_SESSION_H_
+
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <mutex>               // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+
+#include "sherpa-ncnn/csrc/offline-tts.h"
+
+namespace sherpa_ncnn {
+
+/* Remove the complete clauses from the beginning of *text and return them.
+ *
+ * A clause ends with one of , . ? ! ; or their Chinese counterparts, i.e.,
+ * where OfflineTts also ends a sentence of Chinese text, or with a
+ * newline. An ASCII punctuation ends a clause only if it is followed by
+ * whitespace, so that "3.14" or "1,000" is not split before the rest of
+ * it arrives.
+ *
+ * If flush is true, the remaining text is returned as well.
+ */
+std::string TakeCompleteClauses(std::string *text, bool flush = false);
+
+/* Synthesize text that arrives in pieces, e.g., the output of a language
+ * model token by token, without waiting for all of it.
+ *
+ * Each complete clause is synthesized as soon as it arrives and the audio
+ * is passed to the callback in order, so the first audio comes after about
+ * one clause. Clauses that arrive while an earlier one is being
+ * synthesized are synthesized together afterwards.
+ *
+ * The callback is called in a thread of the session. If it returns 0, the
+ * rest of the text is dropped.
+ */
+class OfflineTtsSession {
+ public:
+  // @param tts It must outlive the session.
+  // @param args The speaker, speed, etc. Its text and tokens are ignored.
+  OfflineTtsSession(const OfflineTts *tts, const TtsArgs &args,
+                    GeneratedAudioCallback callback,
+                    void *callback_arg = nullptr);
+
+  // It calls Cancel() if Finish() has not been called
+  ~OfflineTtsSession();
+
+  OfflineTtsSession(const OfflineTtsSession &) = delete;
+  OfflineTtsSession &operator=(const OfflineTtsSession &) = delete;
+
+  // Append a piece of text. It does not wait for the synthesis.
+  void AcceptText(const std::string &text);
+
+  // Synthesize the remaining text and wait until the callback has received
+  // all of the audio
+  void Finish();
+
+  // Drop the text that is not yet synthesized, stop the current clause
+  // and wait for it
+  void Cancel();
+
+ private:
+  void Run();
+
+  int32_t OnAudio(const float *samples, int32_t n, int32_t processed,
+                  int32_t total);
+
+ private:
+  const OfflineTts *tts_;
+  TtsArgs args_;
+  GeneratedAudioCallback callback_;
+  void *callback_arg_;
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+
+  // Text after the last complete clause
+  std::string pending_;
+
+  // Complete clauses that are not yet synthesized
+  std::string ready_;
+
+  bool finished_ = false;
+  std::atomic<bool> cancelled_{false};
+
+  std::thread thread_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_OFFLINE_TTS_SESSION_H_
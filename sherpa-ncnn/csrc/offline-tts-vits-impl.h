@@ -7,17 +7,29 @@
 #include <stdlib.h>
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <deque>
 #include <memory>
-#include <regex>  // NOLINT
+#include <mutex>  // NOLINT
+#include <random>
+#include <sstream>
 #include <string>
+#include <string_view>
+#include <thread>  // NOLINT
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "sherpa-ncnn/csrc/file-utils.h"
+#include "sherpa-ncnn/csrc/latency-stats.h"
 #include "sherpa-ncnn/csrc/lexicon.h"
+#include "sherpa-ncnn/csrc/lru-cache.h"
 #include "sherpa-ncnn/csrc/macros.h"
 #include "sherpa-ncnn/csrc/math.h"
+#include "sherpa-ncnn/csrc/metrics.h"
 #include "sherpa-ncnn/csrc/offline-tts-vits-model.h"
+#include "sherpa-ncnn/csrc/philox.h"
 #include "sherpa-ncnn/csrc/text-utils.h"
 
 namespace sherpa_ncnn {
@@ -26,10 +38,53 @@ class OfflineTtsVitsImpl : public OfflineTtsImpl {
  public:
   explicit OfflineTtsVitsImpl(const OfflineTtsConfig &config)
       : config_(config),
-        model_(std::make_unique<OfflineTtsVitsModel>(config.model)) {
-    lexicon_ =
-        std::make_unique<Lexicon>(config_.model.vits.model_dir + "/lexicon.txt",
-                                  model_->GetMetaData().token2id);
+        model_(std::make_unique<OfflineTtsVitsModel>(ModelConfig(config))),
+        token_cache_(config.token_cache_size) {
+    if (config_.enable_profiling) {
+      latency_stats_ = std::make_unique<LatencyStats>();
+    }
+
+    const auto &token2id = model_->GetMetaData().token2id;
+
+    // lexicon.bin is from sherpa-ncnn-compile-lexicon
+    const ModelBundle *bundle = model_->GetBundle();
+    if (!bundle) {
+      std::string lexicon = config_.model.vits.model_dir + "/lexicon.bin";
+      if (!FileExists(lexicon)) {
+        lexicon = config_.model.vits.model_dir + "/lexicon.txt";
+      }
+
+      lexicon_ = std::make_unique<Lexicon>(lexicon, token2id);
+      return;
+    }
+
+    std::size_t size = 0;
+    const auto *p = bundle->GetSection("lexicon.bin", &size);
+    if (p) {
+      lexicon_ = std::make_unique<Lexicon>(p, size, token2id);
+      return;
+    }
+
+    p = bundle->GetSection("lexicon.txt", &size);
+    if (!p) {
+      SHERPA_NCNN_LOGE("There is no lexicon.txt in the model bundle %s",
+                       config_.model.vits.buffers
+                           ? "in memory"
+                           : config_.model.vits.bundle.c_str());
+      SHERPA_NCNN_EXIT(-1);
+    }
+
+    std::istringstream is(std::string(reinterpret_cast<const char *>(p), size));
+    lexicon_ = std::make_unique<Lexicon>(is, token2id);
+  }
+
+  // Concurrent requests use per-thread memory pools, see
+  // OfflineTtsConfig::max_concurrent_requests
+  static OfflineTtsModelConfig ModelConfig(const OfflineTtsConfig &config) {
+    OfflineTtsModelConfig ans = config.model;
+    ans.pool_per_thread =
+        ans.pool_per_thread || config.max_concurrent_requests > 1;
+    return ans;
   }
 
   int32_t SampleRate() const override {
@@ -40,21 +95,166 @@ class OfflineTtsVitsImpl : public OfflineTtsImpl {
     return model_->GetMetaData().num_speakers;
   }
 
+  const LatencyStats *GetLatencyStats() const override {
+    return latency_stats_.get();
+  }
+
+  bool SetSpeakerEmbedding(int32_t sid,
+                           const std::vector<float> &embedding) const override {
+    return model_->SetEmbedding(sid, embedding.data(), embedding.size());
+  }
+
   GeneratedAudio Generate(const TtsArgs &_args,
                           GeneratedAudioCallback callback = nullptr,
                           void *callback_arg = nullptr) const override {
-    TtsArgs args = _args;
+    TtsArgs args;
+    if (!PrepareArgs(_args, &args)) {
+      return {};
+    }
+
+    std::vector<float> samples;
+    std::vector<float> *out = args.return_samples ? &samples : nullptr;
+
+    int32_t total = args.tokens.size();
+    int32_t max_pending = config_.max_num_sentences;
+    if (max_pending < 1 || max_pending > total) {
+      max_pending = total;
+    }
+
+    int32_t num_workers = std::min(config_.num_workers, max_pending);
+
+    if (num_workers <= 1) {
+      GenerateSerial(args, callback, callback_arg, out);
+    } else {
+      GenerateParallel(args, num_workers, max_pending, callback, callback_arg,
+                       out);
+    }
+
+    GeneratedAudio ans;
+    ans.sample_rate = model_->GetMetaData().sample_rate;
+    ans.samples = std::move(samples);
+
+    return ans;
+  }
+
+  // The nets of the model are exported with a batch size of 1, so the
+  // requests are not padded into a single batch. Instead, the sentences of
+  // all requests are put into one queue, from the longest to the shortest,
+  // and config_.num_workers worker threads share the nets to
+  // synthesize them. Sorting by length keeps the threads busy until the
+  // end, since the short sentences fill the gaps left by the long ones.
+  std::vector<GeneratedAudio> GenerateBatch(
+      const std::vector<TtsArgs> &batch) const override {
+    int32_t batch_size = batch.size();
+
+    std::vector<TtsArgs> args(batch_size);
+    std::vector<char> valid(batch_size, 0);
+
+    // (request, sentence)
+    std::vector<std::pair<int32_t, int32_t>> jobs;
+    for (int32_t r = 0; r != batch_size; ++r) {
+      valid[r] = PrepareArgs(batch[r], &args[r]);
+      if (!valid[r]) {
+        continue;
+      }
+
+      int32_t num_sentences = args[r].tokens.size();
+      for (int32_t i = 0; i != num_sentences; ++i) {
+        jobs.emplace_back(r, i);
+      }
+    }
+
+    std::stable_sort(jobs.begin(), jobs.end(),
+                     [&args](const auto &a, const auto &b) {
+                       return args[a.first].tokens[a.second].size() >
+                              args[b.first].tokens[b.second].size();
+                     });
+
+    std::vector<std::vector<ncnn::Mat>> outputs(batch_size);
+    for (int32_t r = 0; r != batch_size; ++r) {
+      outputs[r].resize(args[r].tokens.size());
+    }
+
+    int32_t num_jobs = jobs.size();
+    int32_t num_workers = std::min(config_.num_workers, num_jobs);
+
+    // Each job writes only its own output, so only the queue is shared
+    std::atomic<int32_t> next{0};
+    auto worker = [&]() {
+      int32_t k;
+      while ((k = next++) < num_jobs) {
+        const auto &job = jobs[k];
+        outputs[job.first][job.second] = Process(args[job.first], job.second);
+      }
+    };
+
+    if (num_workers <= 1) {
+      worker();
+    } else {
+      std::vector<std::thread> workers;
+      workers.reserve(num_workers);
+      for (int32_t i = 0; i != num_workers; ++i) {
+        workers.emplace_back(worker);
+      }
+
+      for (auto &t : workers) {
+        t.join();
+      }
+    }
+
+    int32_t sample_rate = model_->GetMetaData().sample_rate;
+
+    std::vector<GeneratedAudio> ans(batch_size);
+    for (int32_t r = 0; r != batch_size; ++r) {
+      if (!valid[r]) {
+        continue;
+      }
+
+      ans[r].sample_rate = sample_rate;
+
+      std::size_t n = 0;
+      for (const auto &o : outputs[r]) {
+        n += o.w;
+      }
+      ans[r].samples.reserve(n);
+
+      for (auto &o : outputs[r]) {
+        ans[r].samples.insert(ans[r].samples.end(),
+                              static_cast<const float *>(o),
+                              static_cast<const float *>(o) + o.w);
+        o.release();
+      }
+    }
+
+    return ans;
+  }
+
+ private:
+  // Input of the flow
+  struct EncoderOutput {
+    ncnn::Mat z_p;
+    ncnn::Mat g;  // speaker embedding. Empty for single-speaker models
+  };
+
+  // Convert the text of _args to token IDs and check the speaker ID. It
+  // also resolves the seed, so that all sentences of args use the same one.
+  // Return false if _args is invalid.
+  bool PrepareArgs(const TtsArgs &_args, TtsArgs *out) const {
+    TtsArgs &args = *out;
+    args = _args;
     if (args.text.empty() && args.tokens.empty()) {
       SHERPA_NCNN_LOGE("Both text and tokens are empty.");
-      return {};
+      return false;
     }
 
     if (!args.text.empty() && !args.tokens.empty()) {
       SHERPA_NCNN_LOGE("Both text and tokens are NOT empty.");
-      return {};
+      return false;
     }
 
     if (!args.text.empty()) {
+      ProfileScope scope(latency_stats_.get(), nullptr);
+      ScopedStageTimer timer(Stage::kTtsFrontEnd);
       args.tokens = Convert(args.text);
     }
 
@@ -68,7 +268,8 @@ class OfflineTtsVitsImpl : public OfflineTtsImpl {
           args.sid);
     }
 
-    if ((args.sid >= num_speakers) || (args.sid < 0)) {
+    if (((args.sid >= num_speakers) || (args.sid < 0)) &&
+        !model_->HasEmbedding(args.sid)) {
       SHERPA_NCNN_LOGE(
           "This model contains only %d speakers. sid should be in the range "
           "[%d, %d]. Given: %d. Use sid=0",
@@ -77,42 +278,342 @@ class OfflineTtsVitsImpl : public OfflineTtsImpl {
       args.sid = 0;
     }
 
-    std::vector<float> samples;
-    bool should_continue = true;
+    if (args.seed < 0) {
+      args.seed = config_.seed;
+    }
+
+    if (args.seed < 0) {
+      std::random_device rd;
+      args.seed = (static_cast<int64_t>(rd() & 0x7fffffff) << 32) | rd();
+    }
+
+    return true;
+  }
+
+  void GenerateSerial(const TtsArgs &args, GeneratedAudioCallback callback,
+                      void *callback_arg, std::vector<float> *samples) const {
+    if (config_.enable_pipeline && args.tokens.size() > 1) {
+      GeneratePipelined(args, callback, callback_arg, samples);
+      return;
+    }
+
     int32_t processed = 0;
     int32_t total = args.tokens.size();
     for (const auto &tokens : args.tokens) {
       ++processed;
 
-      ncnn::Mat o = Process(tokens, args.sid, args.noise_scale_w,
-                            args.noise_scale, args.speed);
+      EncoderOutput in = ProcessEncoder(args, processed - 1);
+
+      if (!DecodeAndEmit(&in, processed, total, callback, callback_arg,
+                         samples)) {
+        break;
+      }
+
+      if (processed == 1) {
+        ReserveSamples(args, samples);
+      }
+    }
+  }
+
+  // Reserve memory for the audio of all sentences of args once samples
+  // holds that of the first one, assuming the other sentences have as many
+  // samples per token. It saves growing samples sentence by sentence,
+  // which copies the audio each time its capacity is exceeded.
+  static void ReserveSamples(const TtsArgs &args,
+                             std::vector<float> *samples) {
+    if (!samples || samples->empty() || args.tokens[0].empty()) {
+      return;
+    }
+
+    std::size_t num_tokens = 0;
+    for (const auto &t : args.tokens) {
+      num_tokens += t.size();
+    }
+
+    // With some slack, as the estimate is rough
+    std::size_t n = samples->size() * num_tokens / args.tokens[0].size();
+    samples->reserve(n + n / 8);
+  }
+
+  // Run ProcessDecoder() on in, append the audio to samples if it is not
+  // null and pass it to the callback. If config_.decoder_chunk_size is
+  // positive, it is done chunk by chunk. Return false if the callback asks
+  // to stop.
+  bool DecodeAndEmit(EncoderOutput *in, int32_t processed, int32_t total,
+                     GeneratedAudioCallback callback, void *callback_arg,
+                     std::vector<float> *samples) const {
+    int32_t chunk_size = config_.decoder_chunk_size;
+    if (chunk_size <= 0 || in->z_p.w <= chunk_size) {
+      ncnn::Mat o = ProcessDecoder(in);
+
+      if (samples) {
+        samples->insert(samples->end(), static_cast<const float *>(o),
+                        static_cast<const float *>(o) + o.w);
+      }
+
+      if (!callback) {
+        return true;
+      }
+
+      // Caution(fangjun): o is freed when the callback returns, so users
+      // should copy the data if they want to access the data after
+      // the callback returns to avoid segmentation fault.
+      return callback(static_cast<const float *>(o), o.w, processed, total,
+                      callback_arg);
+    }
+
+    // The time of all chunks of the sentence is a single sample. The
+    // callback is not timed.
+    ProfileScope scope(latency_stats_.get(), nullptr);
+
+    ncnn::Mat z;
+    {
+      ScopedStageTimer timer(Stage::kTtsFlow);
+      z = model_->RunFlow(in->z_p, in->g);
+    }
+    in->z_p.release();
+
+    int32_t num_frames = z.w;
+    int32_t context = config_.decoder_chunk_overlap;
+
+    // Audio of the last frame of the previous chunk. It is cross-faded
+    // with the audio of the same frame decoded with the current chunk.
+    std::vector<float> tail;
+    std::vector<float> buf;
+
+    for (int32_t start = 0; start < num_frames; start += chunk_size) {
+      int32_t end = std::min(start + chunk_size, num_frames);
+      int32_t left = std::max(0, start - context);
+      int32_t right = std::min(num_frames, end + context);
+
+      ncnn::Mat o;
+      {
+        ScopedStageTimer timer(Stage::kTtsVocoder);
+        o = model_->RunDecoder(SliceFrames(z, left, right - left), in->g);
+      }
+
+      // Number of samples per frame
+      int32_t hop = o.w / (right - left);
+      const float *p = static_cast<const float *>(o) + (start - left) * hop;
+      const float *p_end = p + (end - start) * hop;
+
+      buf.clear();
+
+      int32_t fade = std::min<int32_t>(tail.size(), (start - left) * hop);
+      tail.resize(fade);
+      for (int32_t k = 0; k != fade; ++k) {
+        float w = (k + 0.5f) / fade;
+        buf.push_back(tail[k] * (1 - w) + p[k - fade] * w);
+      }
+
+      tail.clear();
+      if (end < num_frames && context > 0) {
+        tail.assign(p_end - hop, p_end);
+        p_end -= hop;
+      }
+
+      buf.insert(buf.end(), p, p_end);
+
+      if (samples) {
+        samples->insert(samples->end(), buf.begin(), buf.end());
+      }
+
+      if (callback && !callback(buf.data(), buf.size(), processed, total,
+                                callback_arg)) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  // Return frames [start, start + n) of z, which has a frame per column
+  static ncnn::Mat SliceFrames(const ncnn::Mat &z, int32_t start, int32_t n) {
+    ncnn::Mat ans(n, z.h);
+    for (int32_t i = 0; i != z.h; ++i) {
+      const float *p = z.row(i) + start;
+      std::copy(p, p + n, ans.row(i));
+    }
+
+    return ans;
+  }
+
+  // Like GenerateSerial(), but a thread runs ProcessEncoder() for the next
+  // sentence while the calling thread runs ProcessDecoder() for the
+  // current one. The first audio arrives as early as without the pipeline
+  // and the throughput is bounded by the slower of the two stages.
+  void GeneratePipelined(const TtsArgs &args, GeneratedAudioCallback callback,
+                         void *callback_arg,
+                         std::vector<float> *samples) const {
+    int32_t total = args.tokens.size();
+
+    // The encoder stage is at most one sentence ahead of the decoder stage
+    // besides the one it is working on
+    std::deque<EncoderOutput> queue;
+    bool stop = false;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    std::thread encoder([&]() {
+      for (int32_t i = 0; i != total; ++i) {
+        EncoderOutput out = ProcessEncoder(args, i);
+
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          cv.wait(lock, [&]() { return stop || queue.empty(); });
+          if (stop) {
+            return;
+          }
+          queue.push_back(std::move(out));
+        }
+        cv.notify_all();
+      }
+    });
+
+    for (int32_t i = 0; i != total; ++i) {
+      EncoderOutput in;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&]() { return !queue.empty(); });
+        in = std::move(queue.front());
+        queue.pop_front();
+      }
+      cv.notify_all();
+
+      if (!DecodeAndEmit(&in, i + 1, total, callback, callback_arg,
+                         samples)) {
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          stop = true;
+        }
+        cv.notify_all();
+        break;
+      }
+
+      if (i == 0) {
+        ReserveSamples(args, samples);
+      }
+    }
+
+    encoder.join();
+  }
+
+  // Sentences are independent of each other, so num_workers threads
+  // synthesize them in parallel. The calling thread appends the audio and
+  // invokes the callback in the order of the sentences.
+  //
+  // A worker starts sentence i only if i < emitted + max_pending, so at
+  // most max_pending outputs are held in memory, even if an early sentence
+  // is slow.
+  void GenerateParallel(const TtsArgs &args, int32_t num_workers,
+                        int32_t max_pending, GeneratedAudioCallback callback,
+                        void *callback_arg,
+                        std::vector<float> *samples) const {
+    int32_t total = args.tokens.size();
+
+    std::vector<ncnn::Mat> outputs(total);
+    std::vector<char> ready(total, 0);
+    int32_t next = 0;
+    int32_t emitted = 0;
+    bool stop = false;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    auto worker = [&]() {
+      while (true) {
+        int32_t i;
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          cv.wait(lock, [&]() {
+            return stop || next >= total || next < emitted + max_pending;
+          });
+
+          if (stop || next >= total) {
+            return;
+          }
+          i = next++;
+        }
+
+        ncnn::Mat o = Process(args, i);
+
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          outputs[i] = o;
+          ready[i] = 1;
+        }
+        cv.notify_all();
+      }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(num_workers);
+    for (int32_t k = 0; k != num_workers; ++k) {
+      workers.emplace_back(worker);
+    }
+
+    for (int32_t i = 0; i != total; ++i) {
+      ncnn::Mat o;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&]() { return ready[i] != 0; });
+        o = outputs[i];
+        outputs[i].release();
+      }
+
+      if (samples) {
+        samples->insert(samples->end(), static_cast<const float *>(o),
+                        static_cast<const float *>(o) + o.w);
 
-      samples.insert(samples.end(), static_cast<const float *>(o),
-                     static_cast<const float *>(o) + o.w);
+        if (i == 0) {
+          ReserveSamples(args, samples);
+        }
+      }
 
+      bool should_continue = true;
       if (callback) {
-        should_continue = callback(static_cast<const float *>(o), o.w,
-                                   processed, total, callback_arg);
-        // Caution(fangjun): o is freed when the callback returns, so users
-        // should copy the data if they want to access the data after
-        // the callback returns to avoid segmentation fault.
+        // o is freed after the callback returns, see GenerateSerial()
+        should_continue = callback(static_cast<const float *>(o), o.w, i + 1,
+                                   total, callback_arg);
       }
 
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++emitted;
+        stop = !should_continue;
+      }
+      cv.notify_all();
+
       if (!should_continue) {
         break;
       }
     }
 
-    GeneratedAudio ans;
-    ans.sample_rate = meta_data.sample_rate;
-    ans.samples = std::move(samples);
+    for (auto &t : workers) {
+      t.join();
+    }
+  }
 
-    return ans;
+  // Synthesize sentence index of args
+  ncnn::Mat Process(const TtsArgs &args, int32_t index) const {
+    EncoderOutput encoder_out = ProcessEncoder(args, index);
+    return ProcessDecoder(&encoder_out);
   }
 
- private:
-  ncnn::Mat Process(const std::vector<int32_t> &_tokens, int32_t sid,
-                    float noise_scale_w, float noise_scale, float speed) const {
+  // Run the encoder, the duration predictor and the path attention for
+  // sentence index of args. The noise of a sentence depends only on
+  // args.seed, which Generate() has set, and index. So the output does not
+  // depend on how sentences are scheduled.
+  EncoderOutput ProcessEncoder(const TtsArgs &args, int32_t index) const {
+    const std::vector<int32_t> &_tokens = args.tokens[index];
+
+    // Two streams per sentence: one for the duration predictor and one
+    // for the path attention
+    Philox rng(args.seed, 2 * static_cast<uint64_t>(index));
+
+    ProfileScope scope(latency_stats_.get(), nullptr);
+
     // add bos, eos, and pad
     const auto &meta = model_->GetMetaData();
     int32_t bos = meta.bos;
@@ -130,69 +631,114 @@ class OfflineTtsVitsImpl : public OfflineTtsImpl {
     ncnn::Mat sequence(tokens.size(), 1);
     std::copy(tokens.begin(), tokens.end(), static_cast<int32_t *>(sequence));
 
-    auto encoder_out = model_->RunEncoder(sequence);
+    std::vector<ncnn::Mat> encoder_out;
+    {
+      ScopedStageTimer timer(Stage::kTtsEncoder);
+      encoder_out = model_->RunEncoder(sequence);
+    }
     sequence.release();
 
-    ncnn::Mat noise(encoder_out[0].w, 2);
-    RandomVectorFill(static_cast<float *>(noise), noise.w * noise.h, 0,
-                     noise_scale_w);
+    ncnn::Mat g;
+    ncnn::Mat logw;
+    {
+      ScopedStageTimer timer(Stage::kTtsDurationPredictor);
+      ncnn::Mat noise(encoder_out[0].w, 2);
+      rng.Fill(static_cast<float *>(noise), noise.w * noise.h, 0,
+               args.noise_scale_w);
 
-    ncnn::Mat g = model_->RunEmbedding(sid);
+      g = model_->RunEmbedding(args.sid);
 
-    ncnn::Mat logw = model_->RunDurationPredictor(encoder_out[0], noise, g);
+      logw = model_->RunDurationPredictor(encoder_out[0], noise, g);
+    }
 
-    noise.release();
     encoder_out[0].release();
 
-    ncnn::Mat z_p = model_->PathAttention(logw, encoder_out[1], encoder_out[2],
-                                          noise_scale, speed);
-    encoder_out.clear();
-    logw.release();
+    EncoderOutput ans;
+    {
+      ScopedStageTimer timer(Stage::kTtsPathAttention);
+      Philox path_rng = rng.Stream(2 * static_cast<uint64_t>(index) + 1);
+      ans.z_p = model_->PathAttention(logw, encoder_out[1], encoder_out[2],
+                                      args.noise_scale, args.speed,
+                                      &path_rng);
+    }
+    ans.g = g;
+
+    return ans;
+  }
+
+  // Run the flow and the decoder. It returns the audio samples.
+  ncnn::Mat ProcessDecoder(EncoderOutput *in) const {
+    ProfileScope scope(latency_stats_.get(), nullptr);
 
-    ncnn::Mat z = model_->RunFlow(z_p, g);
-    z_p.release();
+    ncnn::Mat z;
+    {
+      ScopedStageTimer timer(Stage::kTtsFlow);
+      z = model_->RunFlow(in->z_p, in->g);
+    }
+    in->z_p.release();
 
-    ncnn::Mat o = model_->RunDecoder(z, g);
+    ncnn::Mat o;
+    {
+      ScopedStageTimer timer(Stage::kTtsVocoder);
+      o = model_->RunDecoder(z, in->g);
+    }
+    in->g.release();
 
     return o;
   }
 
   std::vector<std::vector<int32_t>> Convert(const std::string &text) const {
-    const auto &voice = model_->GetMetaData().voice;
-    if (voice == "cmn") {
-      return ConvertChinese(text);
-    } else {
-      return ConvertNonChinese(text);
+    std::vector<std::vector<int32_t>> ans;
+    bool hit = token_cache_.Get(text, &ans);
+    if (token_cache_.Capacity() > 0) {
+      Metrics::Add(hit ? MetricCounter::kTtsTokenCacheHits
+                       : MetricCounter::kTtsTokenCacheMisses);
     }
-  }
 
-  // end is inclusive
-  static std::string GetWord(const std::vector<std::string> &words,
-                             int32_t start, int32_t end) {
-    std::string ans;
-
-    if (start >= words.size() || end >= words.size()) {
+    if (hit) {
       return ans;
     }
 
-    for (int32_t i = start; i <= end; ++i) {
-      ans += words[i];
+    const auto &voice = model_->GetMetaData().voice;
+    if (voice == "cmn") {
+      ans = ConvertChinese(text);
+    } else {
+      ans = ConvertNonChinese(text);
     }
 
+    token_cache_.Put(text, ans);
+
     return ans;
   }
 
   static std::string NormalizeChinesePunctuation(const std::string &input) {
-    std::string text = input;
-
-    static const std::unordered_map<std::string, std::string> punct_map = {
-        {"，", ","}, {"。", "."}, {"！", "!"}, {"？", "?"},
-        {"：", ":"}, {"；", ";"}, {"（", "("}, {"）", ")"},
-        {"【", "["}, {"】", "]"}, {"“", "\""}, {"”", "\""},
-        {"‘", "'"},  {"’", "'"},  {"《", "<"}, {"》", ">"}};
+    // All keys are 3-byte UTF-8 characters
+    static const std::unordered_map<std::string, char> punct_map = {
+        {"，", ','}, {"。", '.'}, {"！", '!'}, {"？", '?'},
+        {"：", ':'}, {"；", ';'}, {"（", '('}, {"）", ')'},
+        {"【", '['}, {"】", ']'}, {"“", '"'},  {"”", '"'},
+        {"‘", '\''}, {"’", '\''}, {"《", '<'}, {"》", '>'}};
+
+    std::string text;
+    text.reserve(input.size());
+
+    std::string c;
+    for (std::size_t i = 0; i < input.size();) {
+      if ((static_cast<uint8_t>(input[i]) & 0xf0) == 0xe0 &&
+          i + 3 <= input.size()) {
+        c.assign(input, i, 3);
+        auto it = punct_map.find(c);
+        if (it != punct_map.end()) {
+          text.push_back(it->second);
+        } else {
+          text.append(c);
+        }
+        i += 3;
+        continue;
+      }
 
-    for (const auto &kv : punct_map) {
-      text = std::regex_replace(text, std::regex(kv.first), kv.second);
+      text.push_back(input[i]);
+      ++i;
     }
 
     return text;
@@ -202,7 +748,8 @@ class OfflineTtsVitsImpl : public OfflineTtsImpl {
       const std::string &_text) const {
     auto text = NormalizeChinesePunctuation(_text);
 
-    std::vector<std::string> words = SplitUtf8(text);
+    // They refer to text
+    std::vector<std::string_view> words = SplitUtf8View(text);
 
     const auto &token2id = model_->GetMetaData().token2id;
     std::vector<std::vector<int32_t>> ans;
@@ -214,29 +761,19 @@ class OfflineTtsVitsImpl : public OfflineTtsImpl {
     int32_t space = token2id.at(" ");
 
     for (int32_t i = 0; i < num_words;) {
-      int32_t start = i;
-      int32_t end = std::min(i + max_len, num_words - 1);
+      // Longest match of at least 2 words. A single word is looked up with
+      // TokenizeWord() below, which is case insensitive.
+      int32_t n = lexicon_->LongestMatch(words, i, max_len + 1, &token_ids);
 
       std::string w;
-      while (end > start) {
-        auto this_word = GetWord(words, start, end);
-
-        if (lexicon_->Contains(this_word)) {
-          i = end + 1;
-          w = std::move(this_word);
-
-          break;
-        }
-
-        end -= 1;
-      }
-
-      if (w.empty()) {
-        w = words[i];
+      if (n >= 2) {
+        i += n;
+      } else {
+        w.assign(words[i].data(), words[i].size());
         i += 1;
-      }
 
-      lexicon_->TokenizeWord(w, &token_ids);
+        lexicon_->TokenizeWord(w, &token_ids);
+      }
 
       if (!token_ids.empty()) {
         this_sentence.insert(this_sentence.end(), token_ids.begin(),
@@ -264,7 +801,7 @@ class OfflineTtsVitsImpl : public OfflineTtsImpl {
 
   std::vector<std::vector<int32_t>> ConvertNonChinese(
       const std::string &text) const {
-    std::vector<std::string> words = SplitUtf8(text);
+    std::vector<std::string_view> words = SplitUtf8View(text);
 
     const auto &token2id = model_->GetMetaData().token2id;
     std::vector<std::vector<int32_t>> ans;
@@ -273,7 +810,10 @@ class OfflineTtsVitsImpl : public OfflineTtsImpl {
 
     int32_t space = token2id.at(" ");
 
-    for (const auto &w : words) {
+    std::string w;
+    for (auto word : words) {
+      w.assign(word.data(), word.size());
+
       lexicon_->TokenizeWord(w, &token_ids);
       if (!token_ids.empty()) {
         this_sentence.insert(this_sentence.end(), token_ids.begin(),
@@ -306,6 +846,12 @@ class OfflineTtsVitsImpl : public OfflineTtsImpl {
   OfflineTtsConfig config_;
   std::unique_ptr<OfflineTtsVitsModel> model_;
   std::unique_ptr<Lexicon> lexicon_;
+
+  // text -> output of Convert()
+  LruCache<std::string, std::vector<std::vector<int32_t>>> token_cache_;
+
+  // Not null if config_.enable_profiling is true
+  std::unique_ptr<LatencyStats> latency_stats_;
 };
 
 }  // namespace sherpa_ncnn
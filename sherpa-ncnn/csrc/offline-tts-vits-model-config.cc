@@ -14,9 +14,37 @@ namespace sherpa_ncnn {
 
 void OfflineTtsVitsModelConfig::Register(ParseOptions *po) {
   po->Register("vits-model-dir", &model_dir, "Path to VITS model");
+  po->Register("vits-bundle", &bundle,
+               "Path to a VITS model bundle. If given, --vits-model-dir is "
+               "ignored");
+  po->Register("vits-precompute-speaker-embeddings",
+               &precompute_speaker_embeddings,
+               "true to compute the embeddings of all speakers of a "
+               "multi-speaker model when it is loaded");
+  po->Register("vits-use-int8", &use_int8,
+               "true to use the int8 variant name.int8.ncnn.{param,bin} of "
+               "a net if it exists");
 }
 
 bool OfflineTtsVitsModelConfig::Validate() const {
+  if (buffers) {
+    // The other sections are checked when the model is loaded
+    if (!buffers->HasSection("config.json")) {
+      SHERPA_NCNN_LOGE("There is no config.json in the buffers");
+      return false;
+    }
+    return true;
+  }
+
+  if (!bundle.empty()) {
+    // The sections are checked when the bundle is loaded
+    if (!FileExists(bundle)) {
+      SHERPA_NCNN_LOGE("'%s' does not exist!", bundle.c_str());
+      return false;
+    }
+    return true;
+  }
+
   if (model_dir.empty()) {
     SHERPA_NCNN_LOGE("Please provide --vits-model-dir");
     return false;
@@ -29,9 +57,9 @@ bool OfflineTtsVitsModelConfig::Validate() const {
   }
 
   std::vector<std::string> files_to_check = {
-      "lexicon.txt",   "encoder.ncnn.param", "encoder.ncnn.bin",
-      "dp.ncnn.param", "dp.ncnn.bin",        "flow.ncnn.param",
-      "flow.ncnn.bin", "decoder.ncnn.param", "decoder.ncnn.bin",
+      "encoder.ncnn.param", "encoder.ncnn.bin",   "dp.ncnn.param",
+      "dp.ncnn.bin",        "flow.ncnn.param",    "flow.ncnn.bin",
+      "decoder.ncnn.param", "decoder.ncnn.bin",
   };
 
   OfflineTtsVitsModelMetaData meta =
@@ -43,6 +71,17 @@ bool OfflineTtsVitsModelConfig::Validate() const {
   }
 
   bool ok = true;
+
+  // lexicon.bin is from sherpa-ncnn-compile-lexicon
+  if (!FileExists(model_dir + "/lexicon.bin") &&
+      !FileExists(model_dir + "/lexicon.txt")) {
+    SHERPA_NCNN_LOGE(
+        "Neither lexicon.bin nor lexicon.txt exists inside the directory "
+        "'%s'",
+        model_dir.c_str());
+    ok = false;
+  }
+
   for (const auto &f : files_to_check) {
     auto name = model_dir + "/" + f;
     if (!FileExists(name)) {
@@ -59,7 +98,12 @@ std::string OfflineTtsVitsModelConfig::ToString() const {
   std::ostringstream os;
 
   os << "OfflineTtsVitsModelConfig(";
-  os << "model_dir=\"" << model_dir << "\")";
+  os << "model_dir=\"" << model_dir << "\", ";
+  os << "bundle=\"" << bundle << "\", ";
+  os << "buffers=" << (buffers ? "True" : "False") << ", ";
+  os << "precompute_speaker_embeddings="
+     << (precompute_speaker_embeddings ? "True" : "False") << ", ";
+  os << "use_int8=" << (use_int8 ? "True" : "False") << ")";
 
   return os.str();
 }
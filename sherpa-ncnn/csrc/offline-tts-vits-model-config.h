@@ -5,8 +5,10 @@
 #ifndef SHERPA_NCNN_CSRC_OFFLINE_TTS_VITS_MODEL_CONFIG_H_
 #define SHERPA_NCNN_CSRC_OFFLINE_TTS_VITS_MODEL_CONFIG_H_
 
+#include <memory>
 #include <string>
 
+#include "sherpa-ncnn/csrc/model-bundle.h"
 #include "sherpa-ncnn/csrc/parse-options.h"
 
 namespace sherpa_ncnn {
@@ -22,6 +24,25 @@ struct OfflineTtsVitsModelConfig {
   //  - decoder.ncnn.{param,bin}
   std::string model_dir;
 
+  // Path to a model bundle that contains the files above, created by
+  // sherpa-ncnn-pack-model. If it is not empty, model_dir is ignored.
+  std::string bundle;
+
+  // If not null, the files above are the sections of it in memory and both
+  // model_dir and bundle are ignored. See ModelBundle::FromBuffers().
+  // They must outlive the model.
+  std::shared_ptr<const ModelBundle> buffers;
+
+  // For multi-speaker models, true to compute the embeddings of all
+  // speakers when the model is loaded. Otherwise, the embedding of a
+  // speaker is computed on its first use. In both cases, it is cached.
+  bool precompute_speaker_embeddings = false;
+
+  // If true and there is name.int8.ncnn.{param,bin} for a net, e.g.,
+  // flow.int8.ncnn.param, it is used instead of name.ncnn.{param,bin}.
+  // See generate-int8-scale-table --tts for how to create them.
+  bool use_int8 = true;
+
   OfflineTtsVitsModelConfig() = default;
 
   explicit OfflineTtsVitsModelConfig(const std::string &model_dir)
@@ -19,10 +19,7 @@ static std::unordered_map<std::string, int32_t> LoadToken2ID(
   return ans;
 }
 
-OfflineTtsVitsModelMetaData ReadFromConfigJson(const std::string& filename) {
-  std::ifstream f(filename);
-  auto data = nlohmann::json::parse(f);
-
+static OfflineTtsVitsModelMetaData ReadFromJson(const nlohmann::json& data) {
   OfflineTtsVitsModelMetaData ans;
   ans.sample_rate = data["audio"]["sample_rate"];
   ans.voice = data["espeak"]["voice"];
@@ -36,4 +33,14 @@ OfflineTtsVitsModelMetaData ReadFromConfigJson(const std::string& filename) {
   return ans;
 }
 
+OfflineTtsVitsModelMetaData ReadFromConfigJson(const std::string& filename) {
+  std::ifstream f(filename);
+  return ReadFromJson(nlohmann::json::parse(f));
+}
+
+OfflineTtsVitsModelMetaData ReadFromConfigJson(const char* data,
+                                               std::size_t size) {
+  return ReadFromJson(nlohmann::json::parse(data, data + size));
+}
+
 }  // namespace sherpa_ncnn
@@ -5,6 +5,7 @@
 #ifndef SHERPA_NCNN_CSRC_OFFLINE_TTS_VITS_MODEL_META_DATA_H_
 #define SHERPA_NCNN_CSRC_OFFLINE_TTS_VITS_MODEL_META_DATA_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <unordered_map>
@@ -26,5 +27,9 @@ struct OfflineTtsVitsModelMetaData {
 
 OfflineTtsVitsModelMetaData ReadFromConfigJson(const std::string& filename);
 
+// Same as above, but the content of config.json is given in memory
+OfflineTtsVitsModelMetaData ReadFromConfigJson(const char* data,
+                                               std::size_t size);
+
 }  // namespace sherpa_ncnn
 #endif  // SHERPA_NCNN_CSRC_OFFLINE_TTS_VITS_MODEL_META_DATA_H_
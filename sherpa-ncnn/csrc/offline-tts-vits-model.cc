@@ -7,20 +7,32 @@
 #include <math.h>
 
 #include <algorithm>
+#include <cstring>
 #include <memory>
+#include <mutex>  // NOLINT
+#include <random>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "net.h"  // NOLINT
+#include "sherpa-ncnn/csrc/file-utils.h"
+#include "sherpa-ncnn/csrc/macros.h"
+#include "sherpa-ncnn/csrc/mapped-file.h"
 #include "sherpa-ncnn/csrc/math.h"
+#include "sherpa-ncnn/csrc/memory-pool.h"
+#include "sherpa-ncnn/csrc/model.h"
+#include "sherpa-ncnn/csrc/perf-profile.h"
+#include "sherpa-ncnn/csrc/philox.h"
+#include "sherpa-ncnn/csrc/startup-stats.h"
 
 namespace sherpa_ncnn {
 
 // this function is is modified from nihui's implementation
 static ncnn::Mat PathAttentionImpl(const ncnn::Mat &logw, const ncnn::Mat &m_p,
                                    ncnn::Mat &logs_p, float noise_scale,
-                                   float speed) {
+                                   float speed, const Philox &rng) {
   float length_scale = 1 / speed;
 
   const int x_lengths = logw.w;
@@ -38,17 +50,31 @@ static ncnn::Mat PathAttentionImpl(const ncnn::Mat &logw, const ncnn::Mat &m_p,
 
   z_p.create(y_lengths, depth);
 
+  std::vector<float> scale(x_lengths);
+
   for (int i = 0; i < depth; i++) {
     const float *m_p_ptr = m_p.row(i);
     const float *logs_p_ptr = logs_p.row(i);
     float *ptr = z_p.row(i);
 
+    // Uniform noise in [0, 1) for the whole row at once. Row i uses the
+    // positions [i * y_lengths, (i + 1) * y_lengths) of the stream.
+    rng.Fill(ptr, y_lengths, 0, 1, static_cast<uint64_t>(i) * y_lengths);
+
+    for (int j = 0; j < x_lengths; j++) {
+      scale[j] = expf(logs_p_ptr[j]) * noise_scale;
+    }
+
+    // Expand the durations: a sample of token j is uniform in
+    // [m_p[j], m_p[j] + exp(logs_p[j]) * noise_scale)
     for (int j = 0; j < x_lengths; j++) {
       const float m = m_p_ptr[j];
-      const float nl = expf(logs_p_ptr[j]) * noise_scale;
+      const float s = scale[j];
       const int duration = w_ceil[j];
 
-      RandomVectorFill(ptr, duration, m, m + nl);
+      for (int k = 0; k < duration; k++) {
+        ptr[k] = m + s * ptr[k];
+      }
 
       ptr += duration;
     }
@@ -57,10 +83,30 @@ static ncnn::Mat PathAttentionImpl(const ncnn::Mat &logw, const ncnn::Mat &m_p,
   return z_p;
 }
 
+// Copy n elements of elemsize bytes from src to dst at offset in
+// [0, dst_size) and zero the rest of dst
+static void CopyRowWithZeroPadding(const unsigned char *src,
+                                   unsigned char *dst, int offset, int n,
+                                   int dst_size, size_t elemsize) {
+  n = std::max(n, 0);
+  memset(dst, 0, offset * elemsize);
+  memcpy(dst + offset * elemsize, src, n * elemsize);
+  memset(dst + (offset + n) * elemsize, 0,
+         (dst_size - offset - n) * elemsize);
+}
+
 // this class is written by nihui
+//
+// The heads are independent and the rows are copied as bytes, so it
+// supports packing along the heads and any storage type.
 class relative_embeddings_k_module : public ncnn::Layer {
  public:
-  relative_embeddings_k_module() { one_blob_only = true; }
+  relative_embeddings_k_module() {
+    one_blob_only = true;
+    support_packing = true;
+    support_fp16_storage = true;
+    support_bf16_storage = true;
+  }
 
   virtual int forward(const ncnn::Mat &bottom_blob, ncnn::Mat &top_blob,
                       const ncnn::Option &opt) const {
@@ -69,24 +115,25 @@ class relative_embeddings_k_module : public ncnn::Layer {
     const int wsize = bottom_blob.w;
     const int len = bottom_blob.h;
     const int num_heads = bottom_blob.c;
+    const size_t elemsize = bottom_blob.elemsize;
 
-    top_blob.create(len, len, num_heads);
+    top_blob.create(len, len, num_heads, elemsize, bottom_blob.elempack,
+                    opt.blob_allocator);
+    if (top_blob.empty()) return -100;
 
-    top_blob.fill(0.f);
-
-#pragma omp parallel for
+#pragma omp parallel for num_threads(opt.num_threads)
     for (int q = 0; q < num_heads; q++) {
       const ncnn::Mat x0 = bottom_blob.channel(q);
       ncnn::Mat out0 = top_blob.channel(q);
 
       for (int i = 0; i < len; i++) {
-        const float *xptr = x0.row(i) + std::max(0, window_size - i);
-        float *outptr = out0.row(i) + std::max(i - window_size, 0);
-        const int wsize2 = std::min(len, i - window_size + wsize) -
-                           std::max(i - window_size, 0);
-        for (int j = 0; j < wsize2; j++) {
-          *outptr++ = *xptr++;
-        }
+        const int start = std::max(i - window_size, 0);
+        const int wsize2 = std::min(len, i - window_size + wsize) - start;
+        const unsigned char *xptr = x0.row<unsigned char>(i) +
+                                    std::max(0, window_size - i) * elemsize;
+
+        CopyRowWithZeroPadding(xptr, out0.row<unsigned char>(i), start, wsize2,
+                               len, elemsize);
       }
     }
 
@@ -97,9 +144,16 @@ class relative_embeddings_k_module : public ncnn::Layer {
 DEFINE_LAYER_CREATOR(relative_embeddings_k_module)
 
 // this class is written by nihui
+//
+// See relative_embeddings_k_module for packing and storage
 class relative_embeddings_v_module : public ncnn::Layer {
  public:
-  relative_embeddings_v_module() { one_blob_only = true; }
+  relative_embeddings_v_module() {
+    one_blob_only = true;
+    support_packing = true;
+    support_fp16_storage = true;
+    support_bf16_storage = true;
+  }
 
   virtual int forward(const ncnn::Mat &bottom_blob, ncnn::Mat &top_blob,
                       const ncnn::Option &opt) const {
@@ -108,24 +162,26 @@ class relative_embeddings_v_module : public ncnn::Layer {
     const int wsize = window_size * 2 + 1;
     const int len = bottom_blob.h;
     const int num_heads = bottom_blob.c;
+    const size_t elemsize = bottom_blob.elemsize;
 
-    top_blob.create(wsize, len, num_heads);
+    top_blob.create(wsize, len, num_heads, elemsize, bottom_blob.elempack,
+                    opt.blob_allocator);
+    if (top_blob.empty()) return -100;
 
-    top_blob.fill(0.f);
-
-#pragma omp parallel for
+#pragma omp parallel for num_threads(opt.num_threads)
     for (int q = 0; q < num_heads; q++) {
       const ncnn::Mat x0 = bottom_blob.channel(q);
       ncnn::Mat out0 = top_blob.channel(q);
 
       for (int i = 0; i < len; i++) {
-        const float *xptr = x0.row(i) + std::max(i - window_size, 0);
-        float *outptr = out0.row(i) + std::max(0, window_size - i);
-        const int wsize2 = std::min(len, i - window_size + wsize) -
-                           std::max(i - window_size, 0);
-        for (int j = 0; j < wsize2; j++) {
-          *outptr++ = *xptr++;
-        }
+        const int start = std::max(i - window_size, 0);
+        const int wsize2 = std::min(len, i - window_size + wsize) - start;
+        const unsigned char *xptr =
+            x0.row<unsigned char>(i) + start * elemsize;
+
+        CopyRowWithZeroPadding(xptr, out0.row<unsigned char>(i),
+                               std::max(0, window_size - i), wsize2, wsize,
+                               elemsize);
       }
     }
 
@@ -136,6 +192,9 @@ class relative_embeddings_v_module : public ncnn::Layer {
 DEFINE_LAYER_CREATOR(relative_embeddings_v_module)
 
 // this class is from by nihui
+//
+// The items of the batch are independent, so they are processed in
+// parallel. The bins of an item are kept on the stack.
 class piecewise_rational_quadratic_transform_module : public ncnn::Layer {
  public:
   piecewise_rational_quadratic_transform_module() { one_blob_only = false; }
@@ -147,174 +206,151 @@ class piecewise_rational_quadratic_transform_module : public ncnn::Layer {
     const ncnn::Mat &x1 = bottom_blobs[1];
     ncnn::Mat &outputs = top_blobs[0];
 
-    const int num_bins = 10;
-    const int filter_channels = 192;
-    const bool reverse = true;
-    const float tail_bound = 5.0f;
-    const float DEFAULT_MIN_BIN_WIDTH = 1e-3f;
-    const float DEFAULT_MIN_BIN_HEIGHT = 1e-3f;
-    const float DEFAULT_MIN_DERIVATIVE = 1e-3f;
-
     // x1 shape: (w=N, h=1, c=1), h shape (w=29*N, h=1, c=1) due to Fortran
     // layout
     const int batch_size = x1.w;
-    const int h_params_per_item = 2 * num_bins + (num_bins - 1);  // 29
 
-    outputs = x1.clone();
+    outputs = x1.clone(opt.blob_allocator);
+    if (outputs.empty()) return -100;
 
+    const float *x_ptr = x1;
     float *out_ptr = outputs;
 
+#pragma omp parallel for num_threads(opt.num_threads)
     for (int i = 0; i < batch_size; ++i) {
-      const float current_x = ((const float *)x1)[i];
-
-      const float *h_data = h.row(i);
-
-      if (current_x < -tail_bound || current_x > tail_bound) {
+      const float current_x = x_ptr[i];
+      if (current_x < -kTailBound || current_x > kTailBound) {
         continue;
       }
 
-      std::vector<float> unnormalized_widths(num_bins);
-      std::vector<float> unnormalized_heights(num_bins);
-      std::vector<float> unnormalized_derivatives(num_bins + 1);
-
-      const float inv_sqrt_filter_channels = 1.0f / sqrtf(filter_channels);
-      for (int j = 0; j < num_bins; ++j) {
-        unnormalized_widths[j] = h_data[j] * inv_sqrt_filter_channels;
-      }
-      for (int j = 0; j < num_bins; ++j) {
-        unnormalized_heights[j] =
-            h_data[num_bins + j] * inv_sqrt_filter_channels;
-      }
-      for (int j = 0; j < num_bins - 1; ++j) {
-        unnormalized_derivatives[j + 1] = h_data[2 * num_bins + j];
-      }
+      out_ptr[i] = Transform(h.row(i), current_x);
+    }
 
-      const float constant = logf(expf(1.f - DEFAULT_MIN_DERIVATIVE) - 1.f);
-      unnormalized_derivatives[0] = constant;
-      unnormalized_derivatives[num_bins] = constant;
+    return 0;
+  }
 
-      const float left = -tail_bound, right = tail_bound;
-      const float bottom = -tail_bound, top = tail_bound;
+ private:
+  static constexpr int kNumBins = 10;
+  static constexpr int kFilterChannels = 192;
+  static constexpr bool kReverse = true;
+  static constexpr float kTailBound = 5.0f;
+  static constexpr float kMinBinWidth = 1e-3f;
+  static constexpr float kMinBinHeight = 1e-3f;
+  static constexpr float kMinDerivative = 1e-3f;
+
+  // Compute cum[0..kNumBins] from the unnormalized sizes u[0..kNumBins) of
+  // the bins, which cover [lo, hi]. The sizes are a softmax of u with a
+  // minimum of min_size.
+  static void CumulativeBins(const float *u, float scale, float min_size,
+                             float lo, float hi, float *cum) {
+    float sizes[kNumBins];
+    float max_u = -INFINITY;
+    for (int j = 0; j < kNumBins; ++j) {
+      max_u = std::max(max_u, u[j] * scale);
+    }
 
-      std::vector<float> widths(num_bins);
-      float w_max = -INFINITY;
-      for (float val : unnormalized_widths) w_max = std::max(w_max, val);
-      float w_sum = 0.f;
-      for (int j = 0; j < num_bins; ++j) {
-        widths[j] = expf(unnormalized_widths[j] - w_max);
-        w_sum += widths[j];
-      }
-      for (int j = 0; j < num_bins; ++j) {
-        widths[j] =
-            DEFAULT_MIN_BIN_WIDTH +
-            (1.f - DEFAULT_MIN_BIN_WIDTH * num_bins) * (widths[j] / w_sum);
-      }
+    float sum = 0.f;
+    for (int j = 0; j < kNumBins; ++j) {
+      sizes[j] = expf(u[j] * scale - max_u);
+      sum += sizes[j];
+    }
 
-      std::vector<float> cumwidths(num_bins + 1);
-      cumwidths[0] = left;
-      float current_w_sum = 0.f;
-      for (int j = 0; j < num_bins - 1; ++j) {
-        current_w_sum += widths[j];
-        cumwidths[j + 1] = left + (right - left) * current_w_sum;
-      }
-      cumwidths[num_bins] = right;
-
-      std::vector<float> heights(num_bins);
-      float h_max = -INFINITY;
-      for (float val : unnormalized_heights) h_max = std::max(h_max, val);
-      float h_sum = 0.f;
-      for (int j = 0; j < num_bins; ++j) {
-        heights[j] = expf(unnormalized_heights[j] - h_max);
-        h_sum += heights[j];
-      }
-      for (int j = 0; j < num_bins; ++j) {
-        heights[j] =
-            DEFAULT_MIN_BIN_HEIGHT +
-            (1.f - DEFAULT_MIN_BIN_HEIGHT * num_bins) * (heights[j] / h_sum);
-      }
+    cum[0] = lo;
+    float current_sum = 0.f;
+    for (int j = 0; j < kNumBins - 1; ++j) {
+      current_sum += min_size + (1.f - min_size * kNumBins) * (sizes[j] / sum);
+      cum[j + 1] = lo + (hi - lo) * current_sum;
+    }
+    cum[kNumBins] = hi;
+  }
 
-      std::vector<float> cumheights(num_bins + 1);
-      cumheights[0] = bottom;
-      float current_h_sum = 0.f;
-      for (int j = 0; j < num_bins - 1; ++j) {
-        current_h_sum += heights[j];
-        cumheights[j + 1] = bottom + (top - bottom) * current_h_sum;
-      }
-      cumheights[num_bins] = top;
-
-      std::vector<float> derivatives(num_bins + 1);
-      for (int j = 0; j < num_bins + 1; ++j) {
-        float x = unnormalized_derivatives[j];
-        derivatives[j] =
-            DEFAULT_MIN_DERIVATIVE +
-            (x > 0 ? x + logf(1.f + expf(-x)) : logf(1.f + expf(x)));
-      }
+  static float Softplus(float x) {
+    return x > 0 ? x + logf(1.f + expf(-x)) : logf(1.f + expf(x));
+  }
 
-      int bin_idx = 0;
-      if (reverse) {
-        auto it =
-            std::upper_bound(cumheights.begin(), cumheights.end(), current_x);
-        bin_idx = std::distance(cumheights.begin(), it) - 1;
-      } else {
-        auto it =
-            std::upper_bound(cumwidths.begin(), cumwidths.end(), current_x);
-        bin_idx = std::distance(cumwidths.begin(), it) - 1;
-      }
-      bin_idx = std::max(0, std::min(bin_idx, num_bins - 1));
-
-      const float input_cumwidths = cumwidths[bin_idx];
-      const float input_bin_widths =
-          cumwidths[bin_idx + 1] - cumwidths[bin_idx];
-      const float input_cumheights = cumheights[bin_idx];
-      const float input_heights = cumheights[bin_idx + 1] - cumheights[bin_idx];
-      const float input_derivatives = derivatives[bin_idx];
-      const float input_derivatives_plus_one = derivatives[bin_idx + 1];
-      const float delta = input_heights / input_bin_widths;
-
-      if (reverse) {
-        float a =
-            (current_x - input_cumheights) *
-                (input_derivatives + input_derivatives_plus_one - 2 * delta) +
-            input_heights * (delta - input_derivatives);
-        float b =
-            input_heights * input_derivatives -
-            (current_x - input_cumheights) *
-                (input_derivatives + input_derivatives_plus_one - 2 * delta);
-        float c = -delta * (current_x - input_cumheights);
-        float discriminant = b * b - 4 * a * c;
-        discriminant = std::max(0.f, discriminant);
-        float root = (2 * c) / (-b - sqrtf(discriminant));
-        out_ptr[i] = root * input_bin_widths + input_cumwidths;
-      } else {
-        float theta = (current_x - input_cumwidths) / input_bin_widths;
-        float theta_one_minus_theta = theta * (1 - theta);
-        float numerator =
-            input_heights *
-            (delta * theta * theta + input_derivatives * theta_one_minus_theta);
-        float denominator =
-            delta +
-            ((input_derivatives + input_derivatives_plus_one - 2 * delta) *
-             theta_one_minus_theta);
-        out_ptr[i] = input_cumheights + numerator / denominator;
-      }
+  static float Transform(const float *h_data, float current_x) {
+    const float inv_sqrt_filter_channels = 1.0f / sqrtf(kFilterChannels);
+
+    float cumwidths[kNumBins + 1];
+    float cumheights[kNumBins + 1];
+    CumulativeBins(h_data, inv_sqrt_filter_channels, kMinBinWidth,
+                   -kTailBound, kTailBound, cumwidths);
+    CumulativeBins(h_data + kNumBins, inv_sqrt_filter_channels, kMinBinHeight,
+                   -kTailBound, kTailBound, cumheights);
+
+    const float *cum = kReverse ? cumheights : cumwidths;
+    int bin_idx =
+        std::upper_bound(cum, cum + kNumBins + 1, current_x) - cum - 1;
+    bin_idx = std::max(0, std::min(bin_idx, kNumBins - 1));
+
+    // The derivatives at both ends are constant. The others are in
+    // h_data[2 * kNumBins ...]. Only the two of the bin are needed.
+    static const float kEdgeDerivative =
+        kMinDerivative + Softplus(logf(expf(1.f - kMinDerivative) - 1.f));
+    const float *unnormalized_derivatives = h_data + 2 * kNumBins - 1;
+    const float input_derivatives =
+        bin_idx == 0
+            ? kEdgeDerivative
+            : kMinDerivative + Softplus(unnormalized_derivatives[bin_idx]);
+    const float input_derivatives_plus_one =
+        bin_idx + 1 == kNumBins
+            ? kEdgeDerivative
+            : kMinDerivative + Softplus(unnormalized_derivatives[bin_idx + 1]);
+
+    const float input_cumwidths = cumwidths[bin_idx];
+    const float input_bin_widths = cumwidths[bin_idx + 1] - cumwidths[bin_idx];
+    const float input_cumheights = cumheights[bin_idx];
+    const float input_heights = cumheights[bin_idx + 1] - cumheights[bin_idx];
+    const float delta = input_heights / input_bin_widths;
+
+    if (kReverse) {
+      float a = (current_x - input_cumheights) *
+                    (input_derivatives + input_derivatives_plus_one -
+                     2 * delta) +
+                input_heights * (delta - input_derivatives);
+      float b = input_heights * input_derivatives -
+                (current_x - input_cumheights) *
+                    (input_derivatives + input_derivatives_plus_one -
+                     2 * delta);
+      float c = -delta * (current_x - input_cumheights);
+      float discriminant = b * b - 4 * a * c;
+      discriminant = std::max(0.f, discriminant);
+      float root = (2 * c) / (-b - sqrtf(discriminant));
+      return root * input_bin_widths + input_cumwidths;
     }
 
-    return 0;
+    float theta = (current_x - input_cumwidths) / input_bin_widths;
+    float theta_one_minus_theta = theta * (1 - theta);
+    float numerator =
+        input_heights *
+        (delta * theta * theta + input_derivatives * theta_one_minus_theta);
+    float denominator =
+        delta + ((input_derivatives + input_derivatives_plus_one - 2 * delta) *
+                 theta_one_minus_theta);
+    return input_cumheights + numerator / denominator;
   }
 };
 
 DEFINE_LAYER_CREATOR(piecewise_rational_quadratic_transform_module)
 
+static OfflineTtsVitsModel::CalibrationHook &GetCalibrationHook() {
+  static OfflineTtsVitsModel::CalibrationHook hook;
+  return hook;
+}
+
 class OfflineTtsVitsModel::Impl {
  public:
-  explicit Impl(const OfflineTtsModelConfig &config) : config_(config) {
+  explicit Impl(const OfflineTtsModelConfig &config)
+      : config_(config), hook_(GetCalibrationHook()) {
     Init();
   }
 
   const OfflineTtsVitsModelMetaData &GetMetaData() const { return meta_; }
 
+  const ModelBundle *GetBundle() const { return bundle_.get(); }
+
   std::vector<ncnn::Mat> RunEncoder(const ncnn::Mat &sequence) const {
-    ncnn::Extractor ex = enc_p_.create_extractor();
+    ncnn::Extractor ex = CreateExtractor(enc_p_);
 
     ex.input("in0", sequence);
 
@@ -326,12 +362,14 @@ class OfflineTtsVitsModel::Impl {
     ex.extract("out1", m_p);
     ex.extract("out2", logs_p);
 
-    return {x, m_p, logs_p};
+    Observe("encoder", enc_p_, &ex);
+
+    return {Detach(x), Detach(m_p), Detach(logs_p)};
   }
 
   ncnn::Mat RunDurationPredictor(const ncnn::Mat &x, const ncnn::Mat &noise,
                                  const ncnn::Mat &g) const {
-    ncnn::Extractor ex = dp_.create_extractor();
+    ncnn::Extractor ex = CreateExtractor(dp_);
 
     ex.input("in0", x);
     ex.input("in1", noise);
@@ -343,11 +381,13 @@ class OfflineTtsVitsModel::Impl {
     ncnn::Mat logw;
     ex.extract("out0", logw);
 
-    return logw;
+    Observe("dp", dp_, &ex);
+
+    return Detach(logw);
   }
 
   ncnn::Mat RunFlow(const ncnn::Mat &z_p, const ncnn::Mat &g) const {
-    ncnn::Extractor ex = flow_.create_extractor();
+    ncnn::Extractor ex = CreateExtractor(flow_);
 
     ex.input("in0", z_p);
     if (meta_.num_speakers > 1) {
@@ -357,11 +397,13 @@ class OfflineTtsVitsModel::Impl {
     ncnn::Mat z;
     ex.extract("out0", z);
 
-    return z;
+    Observe("flow", flow_, &ex);
+
+    return Detach(z);
   }
 
   ncnn::Mat RunDecoder(const ncnn::Mat &z, const ncnn::Mat &g) const {
-    ncnn::Extractor ex = decoder_.create_extractor();
+    ncnn::Extractor ex = CreateExtractor(decoder_);
 
     ex.input("in0", z);
     if (meta_.num_speakers > 1) {
@@ -371,7 +413,9 @@ class OfflineTtsVitsModel::Impl {
     ncnn::Mat o;
     ex.extract("out0", o);
 
-    return o;
+    Observe("decoder", decoder_, &ex);
+
+    return Detach(o);
   }
 
   ncnn::Mat RunEmbedding(int32_t sid) const {
@@ -380,9 +424,64 @@ class OfflineTtsVitsModel::Impl {
     }
 
     sid = sid < 0 ? 0 : sid;
+
+    {
+      std::lock_guard<std::mutex> lock(embedding_mutex_);
+      auto it = embeddings_.find(sid);
+      if (it != embeddings_.end()) {
+        return it->second;
+      }
+    }
+
     sid = sid > meta_.num_speakers - 1 ? meta_.num_speakers - 1 : sid;
 
-    ncnn::Extractor ex = embedding_.create_extractor();
+    ncnn::Mat g = ComputeEmbedding(sid);
+
+    std::lock_guard<std::mutex> lock(embedding_mutex_);
+
+    // If another thread has computed it meanwhile, keep its result
+    return embeddings_.emplace(sid, g).first->second;
+  }
+
+  bool SetEmbedding(int32_t sid, const float *embedding, int32_t n) const {
+    if (meta_.num_speakers < 2) {
+      SHERPA_NCNN_LOGE("Only multi-speaker models support speaker embeddings");
+      return false;
+    }
+
+    if (sid < 0) {
+      SHERPA_NCNN_LOGE("sid should be non-negative. Given: %d", sid);
+      return false;
+    }
+
+    int32_t dim = RunEmbedding(0).h;
+    if (n != dim) {
+      SHERPA_NCNN_LOGE("Expected an embedding of dimension %d. Given: %d", dim,
+                       n);
+      return false;
+    }
+
+    ncnn::Mat g(1, dim);
+    std::copy(embedding, embedding + n, static_cast<float *>(g));
+
+    std::lock_guard<std::mutex> lock(embedding_mutex_);
+    embeddings_[sid] = g;
+
+    return true;
+  }
+
+  bool HasEmbedding(int32_t sid) const {
+    if (sid >= 0 && sid < meta_.num_speakers) {
+      return true;
+    }
+
+    std::lock_guard<std::mutex> lock(embedding_mutex_);
+    return embeddings_.count(sid) > 0;
+  }
+
+ private:
+  ncnn::Mat ComputeEmbedding(int32_t sid) const {
+    ncnn::Extractor ex = CreateExtractor(embedding_);
 
     ncnn::Mat in(1);
     static_cast<int32_t *>(in)[0] = sid;
@@ -392,18 +491,123 @@ class OfflineTtsVitsModel::Impl {
     ncnn::Mat g;
     ex.extract("out0", g);
 
-    g = g.reshape(1, g.w);
+    Observe("embedding", embedding_, &ex);
+
+    // It is cached in embeddings_
+    g = Detach(g).reshape(1, g.w);
 
     return g;
   }
 
- private:
+  ncnn::Extractor CreateExtractor(const ncnn::Net &net) const {
+    ncnn::Extractor ex = net.create_extractor();
+    if (memory_pools_) {
+      memory_pools_->Attach(&ex);
+    }
+
+    if (hook_) {
+      // Keep the intermediate blobs for the hook
+      ex.set_light_mode(false);
+    }
+    return ex;
+  }
+
+  // The outputs of the nets are returned to the caller, which may keep
+  // them or release them on another thread, so they are copied out of the
+  // memory pools
+  ncnn::Mat Detach(const ncnn::Mat &m) const {
+    return memory_pools_ ? memory_pools_->Detach(m) : m;
+  }
+
+  void Observe(const char *name, const ncnn::Net &net,
+               ncnn::Extractor *ex) const {
+    if (hook_) {
+      hook_(name, net, ex);
+    }
+  }
+
   void Init() {
-    meta_ = ReadFromConfigJson(config_.vits.model_dir + "/config.json");
+    if (!config_.perf_profile.empty() &&
+        !perf_profile_.Read(config_.perf_profile)) {
+      SHERPA_NCNN_LOGE("Ignore the performance profile %s",
+                       config_.perf_profile.c_str());
+    }
+
+    if (config_.vits.buffers) {
+      bundle_ = config_.vits.buffers;
+    } else if (!config_.vits.bundle.empty()) {
+      bundle_ = ModelBundle::Open(config_.vits.bundle);
+      if (!bundle_) {
+        SHERPA_NCNN_EXIT(-1);
+      }
+    }
+
+    if (!bundle_) {
+      meta_ = ReadFromConfigJson(config_.vits.model_dir + "/config.json");
+    } else {
+      std::size_t size = 0;
+      const auto *p = bundle_->GetSection("config.json", &size);
+      if (!p) {
+        SHERPA_NCNN_LOGE("There is no config.json in the model bundle %s",
+                         BundleName());
+        SHERPA_NCNN_EXIT(-1);
+      }
+      meta_ = ReadFromConfigJson(reinterpret_cast<const char *>(p), size);
+    }
+
     InitNet();
   }
 
+  int32_t EncoderNumThreads() const {
+    return config_.encoder_num_threads > 0 ? config_.encoder_num_threads
+                                           : config_.num_threads;
+  }
+
+  int32_t DecoderNumThreads() const {
+    return config_.decoder_num_threads > 0 ? config_.decoder_num_threads
+                                           : config_.num_threads;
+  }
+
+  // Set the number of threads, the device and the precision of a net that
+  // runs before the flow. Those of "tts_encoder" in the performance
+  // profile take precedence.
+  void InitEncoderOptions(ncnn::Net *net) const {
+    InitOptions(EncoderNumThreads(), config_.encoder_device,
+                config_.encoder_precision, net);
+
+    if (const NetTuning *t = perf_profile_.Get("tts_encoder")) {
+      t->Apply(&net->opt);
+    }
+  }
+
+  // The same for the flow and the decoder, with "tts_decoder"
+  void InitDecoderOptions(ncnn::Net *net) const {
+    InitOptions(DecoderNumThreads(), config_.decoder_device,
+                config_.decoder_precision, net);
+
+    if (const NetTuning *t = perf_profile_.Get("tts_decoder")) {
+      t->Apply(&net->opt);
+    }
+  }
+
+  static void InitOptions(int32_t num_threads, const std::string &device,
+                          const std::string &precision, ncnn::Net *net) {
+    net->opt.num_threads = num_threads;
+
+    if (!Model::SetDevice(device, &net->opt) ||
+        !Model::SetPrecision(precision, &net->opt)) {
+      SHERPA_NCNN_LOGE("Invalid device '%s' or precision '%s'",
+                       device.c_str(), precision.c_str());
+      SHERPA_NCNN_EXIT(-1);
+    }
+  }
+
   void InitNet() {
+    if (config_.use_pool_allocator) {
+      memory_pools_ = std::make_unique<ModelMemoryPools>(
+          config_.pool_per_thread, config_.pool_limit_mb);
+    }
+
     InitEncoderNet();
     InitDurationPredictorNet();
     InitFlowNet();
@@ -411,11 +615,17 @@ class OfflineTtsVitsModel::Impl {
 
     if (meta_.num_speakers > 1) {
       InitEmbeddingNet();
+
+      if (config_.vits.precompute_speaker_embeddings) {
+        for (int32_t sid = 0; sid != meta_.num_speakers; ++sid) {
+          embeddings_[sid] = ComputeEmbedding(sid);
+        }
+      }
     }
   }
 
   void InitEncoderNet() {
-    enc_p_.opt.num_threads = config_.num_threads;
+    InitEncoderOptions(&enc_p_);
 
     // en_enc_p_pnnx is for our first version.
     enc_p_.register_custom_layer("en_enc_p_pnnx.relative_embeddings_k_module",
@@ -430,68 +640,148 @@ class OfflineTtsVitsModel::Impl {
         "piper.train.vits.attentions.relative_embeddings_v_module",
         relative_embeddings_v_module_layer_creator);
 
-    std::string param = config_.vits.model_dir + "/encoder.ncnn.param";
-    std::string bin = config_.vits.model_dir + "/encoder.ncnn.bin";
-    enc_p_.load_param(param.c_str());
-    enc_p_.load_model(bin.c_str());
+    LoadNet("encoder", &enc_p_);
   }
 
   void InitDurationPredictorNet() {
-    dp_.opt.num_threads = config_.num_threads;
+    InitEncoderOptions(&dp_);
 
     dp_.register_custom_layer(
         "piper.train.vits.modules.piecewise_rational_quadratic_transform_"
         "module",
         piecewise_rational_quadratic_transform_module_layer_creator);
 
-    std::string param = config_.vits.model_dir + "/dp.ncnn.param";
-    std::string bin = config_.vits.model_dir + "/dp.ncnn.bin";
-
-    dp_.load_param(param.c_str());
-    dp_.load_model(bin.c_str());
+    LoadNet("dp", &dp_);
   }
 
   void InitFlowNet() {
-    flow_.opt.num_threads = config_.num_threads;
-
-    std::string param = config_.vits.model_dir + "/flow.ncnn.param";
-    std::string bin = config_.vits.model_dir + "/flow.ncnn.bin";
+    InitDecoderOptions(&flow_);
 
-    flow_.load_param(param.c_str());
-    flow_.load_model(bin.c_str());
+    LoadNet("flow", &flow_);
   }
 
   void InitDecoderNet() {
-    decoder_.opt.num_threads = config_.num_threads;
+    InitDecoderOptions(&decoder_);
 
-    std::string param = config_.vits.model_dir + "/decoder.ncnn.param";
-    std::string bin = config_.vits.model_dir + "/decoder.ncnn.bin";
+    LoadNet("decoder", &decoder_);
+  }
 
-    decoder_.load_param(param.c_str());
-    decoder_.load_model(bin.c_str());
+  // For error messages
+  const char *BundleName() const {
+    return config_.vits.buffers ? "in memory" : config_.vits.bundle.c_str();
   }
 
-  void InitEmbeddingNet() {
-    embedding_.opt.num_threads = config_.num_threads;
+  // Return true if name.ncnn.param and name.ncnn.bin exist in model_dir or
+  // the bundle
+  bool HasNet(const std::string &name) const {
+    std::string param = name + ".ncnn.param";
+    std::string bin = name + ".ncnn.bin";
 
-    std::string param = config_.vits.model_dir + "/embedding.ncnn.param";
-    std::string bin = config_.vits.model_dir + "/embedding.ncnn.bin";
+    if (bundle_) {
+      return bundle_->HasSection(param) && bundle_->HasSection(bin);
+    }
+
+    return FileExists(config_.vits.model_dir + "/" + param) &&
+           FileExists(config_.vits.model_dir + "/" + bin);
+  }
+
+  // Load name.ncnn.param and name.ncnn.bin from model_dir or the bundle.
+  // If there is name.int8.ncnn.{param,bin}, it is loaded instead unless
+  // int8 is disabled.
+  void LoadNet(const std::string &_name, ncnn::Net *net) {
+    std::string name = _name;
+    if (config_.vits.use_int8 && !hook_ && HasNet(name + ".int8")) {
+      name += ".int8";
+      if (config_.debug) {
+        SHERPA_NCNN_LOGE("Use the int8 net %s", name.c_str());
+      }
+    }
+
+    if (hook_) {
+      // The blobs are calibrated in fp32 on the CPU, and the weights are
+      // kept for computing their scales
+      net->opt.use_vulkan_compute = false;
+      net->opt.lightmode = false;
+      net->opt.use_fp16_packed = false;
+      net->opt.use_fp16_storage = false;
+      net->opt.use_fp16_arithmetic = false;
+    }
+
+    std::string param = name + ".ncnn.param";
+    std::string bin = name + ".ncnn.bin";
+
+    if (bundle_) {
+      if (!bundle_->LoadNet(param, bin, net)) {
+        SHERPA_NCNN_LOGE("Failed to load %s from the model bundle %s",
+                         name.c_str(), BundleName());
+        SHERPA_NCNN_EXIT(-1);
+      }
+      return;
+    }
+
+    param = config_.vits.model_dir + "/" + param;
+    bin = config_.vits.model_dir + "/" + bin;
+
+    {
+      ScopedStartupTimer timer(StartupPhase::kParamParse);
+      net->load_param(param.c_str());
+    }
 
-    embedding_.load_param(param.c_str());
-    embedding_.load_model(bin.c_str());
+    ScopedStartupTimer timer(StartupPhase::kWeightLoad);
+    if (!config_.use_mmap) {
+      net->load_model(bin.c_str());
+      return;
+    }
+
+    auto mapped_bin = LoadModelFromMappedFile(bin, net);
+    if (!mapped_bin) {
+      SHERPA_NCNN_LOGE("Failed to load bin from '%s'", bin.c_str());
+      SHERPA_NCNN_EXIT(-1);
+    }
+
+    mapped_bins_.push_back(std::move(mapped_bin));
+  }
+
+  void InitEmbeddingNet() {
+    InitEncoderOptions(&embedding_);
+
+    LoadNet("embedding", &embedding_);
   }
 
  private:
   OfflineTtsModelConfig config_;
   OfflineTtsVitsModelMetaData meta_;
 
+  // Copied from GetCalibrationHook() when the model is created
+  CalibrationHook hook_;
+
+  // Read from config_.perf_profile. Empty if it is not set.
+  PerfProfile perf_profile_;
+
+  // Null if config_.use_pool_allocator is false
+  std::unique_ptr<ModelMemoryPools> memory_pools_;
+
+  // The nets below may refer to them
+  std::vector<std::unique_ptr<MappedFile>> mapped_bins_;
+  std::shared_ptr<const ModelBundle> bundle_;
+
   ncnn::Net enc_p_;
   ncnn::Net dp_;
   ncnn::Net flow_;
   ncnn::Net decoder_;
   ncnn::Net embedding_;
+
+  // Protects embeddings_
+  mutable std::mutex embedding_mutex_;
+
+  // Speaker ID -> output of RunEmbedding()
+  mutable std::unordered_map<int32_t, ncnn::Mat> embeddings_;
 };
 
+void OfflineTtsVitsModel::SetCalibrationHook(CalibrationHook hook) {
+  GetCalibrationHook() = std::move(hook);
+}
+
 OfflineTtsVitsModel::~OfflineTtsVitsModel() = default;
 
 OfflineTtsVitsModel::OfflineTtsVitsModel(const OfflineTtsModelConfig &config)
@@ -501,6 +791,10 @@ const OfflineTtsVitsModelMetaData &OfflineTtsVitsModel::GetMetaData() const {
   return impl_->GetMetaData();
 }
 
+const ModelBundle *OfflineTtsVitsModel::GetBundle() const {
+  return impl_->GetBundle();
+}
+
 std::vector<ncnn::Mat> OfflineTtsVitsModel::RunEncoder(
     const ncnn::Mat &sequence) const {
   return impl_->RunEncoder(sequence);
@@ -515,8 +809,15 @@ ncnn::Mat OfflineTtsVitsModel::RunDurationPredictor(const ncnn::Mat &x,
 ncnn::Mat OfflineTtsVitsModel::PathAttention(const ncnn::Mat &logw,
                                              const ncnn::Mat &m_p,
                                              ncnn::Mat &logs_p,
-                                             float noise_scale, float speed) {
-  return PathAttentionImpl(logw, m_p, logs_p, noise_scale, speed);
+                                             float noise_scale, float speed,
+                                             const Philox *rng /*= nullptr*/) {
+  if (rng) {
+    return PathAttentionImpl(logw, m_p, logs_p, noise_scale, speed, *rng);
+  }
+
+  std::random_device rd;
+  Philox r((static_cast<uint64_t>(rd()) << 32) | rd());
+  return PathAttentionImpl(logw, m_p, logs_p, noise_scale, speed, r);
 }
 
 ncnn::Mat OfflineTtsVitsModel::RunFlow(const ncnn::Mat &z_p,
@@ -533,4 +834,13 @@ ncnn::Mat OfflineTtsVitsModel::RunEmbedding(int32_t sid) const {
   return impl_->RunEmbedding(sid);
 }
 
+bool OfflineTtsVitsModel::SetEmbedding(int32_t sid, const float *embedding,
+                                       int32_t n) const {
+  return impl_->SetEmbedding(sid, embedding, n);
+}
+
+bool OfflineTtsVitsModel::HasEmbedding(int32_t sid) const {
+  return impl_->HasEmbedding(sid);
+}
+
 }  // namespace sherpa_ncnn
@@ -5,22 +5,53 @@
 #ifndef SHERPA_NCNN_CSRC_OFFLINE_TTS_VITS_MODEL_H_
 #define SHERPA_NCNN_CSRC_OFFLINE_TTS_VITS_MODEL_H_
 
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "mat.h"  // NOLINT
+#include "sherpa-ncnn/csrc/model-bundle.h"
 #include "sherpa-ncnn/csrc/offline-tts-model-config.h"
 #include "sherpa-ncnn/csrc/offline-tts-vits-model-meta-data.h"
+#include "sherpa-ncnn/csrc/philox.h"
+
+namespace ncnn {
+class Extractor;
+class Net;
+}  // namespace ncnn
 
 namespace sherpa_ncnn {
 
 class OfflineTtsVitsModel {
  public:
+  /** It is called after a net of the model is run with the name of the
+   * net, i.e., encoder, dp, flow, decoder or embedding, the net and the
+   * extractor that ran it. The intermediate blobs can be extracted from ex.
+   */
+  using CalibrationHook = std::function<void(
+      const std::string &name, const ncnn::Net &net, ncnn::Extractor *ex)>;
+
+  /** Set the hook of models that are created afterwards, e.g., to collect
+   * the statistics of the blobs for int8 calibration. Such models keep the
+   * intermediate blobs, run in fp32 and ignore the int8 variants of the
+   * nets. Pass nullptr to remove it.
+   *
+   * It is meant for tools such as generate-int8-scale-table and is not
+   * thread-safe.
+   */
+  static void SetCalibrationHook(CalibrationHook hook);
+
   ~OfflineTtsVitsModel();
   explicit OfflineTtsVitsModel(const OfflineTtsModelConfig &config);
 
   const OfflineTtsVitsModelMetaData &GetMetaData() const;
 
+  // Return the bundle the model is loaded from or nullptr if it is loaded
+  // from model_dir
+  const ModelBundle *GetBundle() const;
+
   /**
    * @param sequence A 2-D tensor of shape (1, num_tokens). Note sequence.w ==
    *                 num_tokens
@@ -33,9 +64,31 @@ class OfflineTtsVitsModel {
    * @returns Return the embedding of this speaker ID.
    *
    * Note: For models with a single speaker, it returns an empty mat.
+   *
+   * The embedding of a speaker is computed once and cached, so the
+   * returned mat must not be modified. An embedding set with
+   * SetEmbedding() is returned as it is.
    */
   ncnn::Mat RunEmbedding(int32_t sid) const;
 
+  /** Use an externally provided embedding for a speaker ID, e.g., one that
+   * is interpolated between speakers. sid need not be less than
+   * num_speakers. Supported only by multi-speaker models.
+   *
+   * @param sid  Speaker ID. It must be non-negative.
+   * @param embedding  It has as many elements as the output of
+   *                   RunEmbedding().
+   * @param n  Number of elements of embedding.
+   *
+   * @return Return false if the model has a single speaker or n is not
+   *         the dimension of the embeddings.
+   */
+  bool SetEmbedding(int32_t sid, const float *embedding, int32_t n) const;
+
+  // Return true if sid is a speaker of the model or SetEmbedding() has been
+  // called for it
+  bool HasEmbedding(int32_t sid) const;
+
   /**
    * @param x It is the x returned by RunEncoder()
    * @param noise A 2-D tensor of shape (2, x.w). Note x.w == noise.w
@@ -52,12 +105,15 @@ class OfflineTtsVitsModel {
    * @param logs_p It is returned by RunEncoder()
    * @param noise_scale
    * @param speed Note speed = 1 / length_scale, so speed should > 0
+   * @param rng If not null, the noise is drawn from it, so the output is
+   *            reproducible. Otherwise, a randomly seeded generator is
+   *            used.
    *
    * @returns Return z_p
    */
   static ncnn::Mat PathAttention(const ncnn::Mat &logw, const ncnn::Mat &m_p,
                                  ncnn::Mat &logs_p, float noise_scale,
-                                 float speed);
+                                 float speed, const Philox *rng = nullptr);
 
   /**
    * @param z_p It is returned by PathAttention()
@@ -7,10 +7,15 @@
 #include <cmath>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "sherpa-ncnn/csrc/file-utils.h"
 #include "sherpa-ncnn/csrc/macros.h"
+#include "sherpa-ncnn/csrc/metrics.h"
+#include "sherpa-ncnn/csrc/offline-tts-cache.h"
 #include "sherpa-ncnn/csrc/offline-tts-impl.h"
+#include "sherpa-ncnn/csrc/pcm-utils.h"
+#include "sherpa-ncnn/csrc/slots.h"
 #include "sherpa-ncnn/csrc/text-utils.h"
 
 namespace sherpa_ncnn {
@@ -103,6 +108,48 @@ void OfflineTtsConfig::Register(ParseOptions *po) {
       "This is to avoid OOM for very long input text. "
       "If you set it to -1, then we process all sentences in a single batch.");
 
+  po->Register("tts-num-workers", &num_workers,
+               "Number of threads that synthesize sentences in parallel, "
+               "each with --num-threads threads. At most "
+               "--tts-max-num-sentences sentences are processed at a time");
+
+  po->Register("tts-enable-pipeline", &enable_pipeline,
+               "true to run the encoder of the next sentence while the "
+               "current one is decoded. Used only if sentences are not "
+               "synthesized in parallel, see --tts-num-workers");
+
+  po->Register("tts-max-concurrent-requests", &max_concurrent_requests,
+               "If positive, at most this many concurrent calls share the "
+               "model at a time, each with --num-threads threads. "
+               "0 for no limit");
+
+  po->Register("tts-decoder-chunk-size", &decoder_chunk_size,
+               "If positive, the audio of a sentence is generated in chunks "
+               "of this many frames to get the first audio earlier");
+
+  po->Register("tts-decoder-chunk-overlap", &decoder_chunk_overlap,
+               "Number of context frames on each side of a chunk. Used only "
+               "if --tts-decoder-chunk-size is positive");
+
+  po->Register("tts-token-cache-size", &token_cache_size,
+               "Number of recent input texts whose token IDs are cached. "
+               "0 to disable the cache");
+
+  po->Register("tts-seed", &seed,
+               "If not negative, the seed of the noise, so that the output "
+               "is reproducible");
+
+  po->Register("tts-audio-cache-size", &audio_cache_size,
+               "Number of generated audios to cache in memory. "
+               "0 to disable the cache");
+
+  po->Register("tts-audio-cache-dir", &audio_cache_dir,
+               "If not empty, an existing directory where generated audios "
+               "are cached on disk");
+
+  po->Register("tts-enable-profiling", &enable_profiling,
+               "true to record the time of each stage of the model");
+
   po->Register(
       "tts-max-tokens-per-sentence", &max_tokens_per_sentence,
       "If positive, we limit the number of tokens per sentence to this value");
@@ -135,6 +182,25 @@ bool OfflineTtsConfig::Validate() const {
     }
   }
 
+  if (decoder_chunk_size > 0 && decoder_chunk_overlap < 0) {
+    SHERPA_NCNN_LOGE("--tts-decoder-chunk-overlap should be >= 0. Given: %d",
+                     decoder_chunk_overlap);
+    return false;
+  }
+
+  if (num_workers < 1) {
+    SHERPA_NCNN_LOGE("--tts-num-workers should be >= 1. Given: %d",
+                     num_workers);
+    return false;
+  }
+
+  if (max_concurrent_requests < 0) {
+    SHERPA_NCNN_LOGE(
+        "--tts-max-concurrent-requests should be >= 0. Given: %d",
+        max_concurrent_requests);
+    return false;
+  }
+
   if (silence_scale < 0.001) {
     SHERPA_NCNN_LOGE("--tts-silence-scale '%.3f' is too small", silence_scale);
     return false;
@@ -151,26 +217,28 @@ std::string OfflineTtsConfig::ToString() const {
   os << "rule_fsts=\"" << rule_fsts << "\", ";
   os << "rule_fars=\"" << rule_fars << "\", ";
   os << "max_num_sentences=" << max_num_sentences << ", ";
+  os << "num_workers=" << num_workers << ", ";
+  os << "enable_pipeline=" << (enable_pipeline ? "True" : "False") << ", ";
+  os << "max_concurrent_requests=" << max_concurrent_requests << ", ";
+  os << "decoder_chunk_size=" << decoder_chunk_size << ", ";
+  os << "decoder_chunk_overlap=" << decoder_chunk_overlap << ", ";
+  os << "token_cache_size=" << token_cache_size << ", ";
+  os << "seed=" << seed << ", ";
+  os << "audio_cache_size=" << audio_cache_size << ", ";
+  os << "audio_cache_dir=\"" << audio_cache_dir << "\", ";
+  os << "enable_profiling=" << (enable_profiling ? "True" : "False") << ", ";
   os << "silence_scale=" << silence_scale << ")";
 
   return os.str();
 }
 
-OfflineTts::OfflineTts(const OfflineTtsConfig &config)
-    : impl_(OfflineTtsImpl::Create(config)) {}
-
-OfflineTts::~OfflineTts() = default;
-
-GeneratedAudio OfflineTts::Generate(
-    const TtsArgs &args, GeneratedAudioCallback callback /*= nullptr*/,
-    void *callback_arg /*= nullptr*/) const {
 #if !defined(_WIN32)
-  return impl_->Generate(args, std::move(callback), callback_arg);
+static const TtsArgs &ToUtf8(const TtsArgs &args) { return args; }
 #else
+static TtsArgs ToUtf8(const TtsArgs &args) {
   if (IsUtf8(args.text)) {
-    return impl_->Generate(args, std::move(callback), callback_arg);
+    return args;
   } else if (IsGB2312(args.text)) {
-    auto utf8_text = Gb2312ToUtf8(args.text);
     static bool printed = false;
     if (!printed) {
       SHERPA_NCNN_LOGE(
@@ -178,19 +246,209 @@ GeneratedAudio OfflineTts::Generate(
       printed = true;
     }
     TtsArgs utf8_args = args;
-    utf8_args.text = utf8_text;
-    return impl_->Generate(utf8_args, std::move(callback), callback_arg);
+    utf8_args.text = Gb2312ToUtf8(args.text);
+    return utf8_args;
   } else {
     SHERPA_NCNN_LOGE(
         "Non UTF8 encoded string is received. You would not get expected "
         "results!");
-    return impl_->Generate(args, std::move(callback), callback_arg);
+    return args;
   }
+}
 #endif
+
+// Add the time of generating an audio to Metrics
+static void ObserveSynthesis(const GeneratedAudio &audio, double seconds) {
+  Metrics::Observe(MetricHistogram::kTtsSynthesisSeconds, seconds);
+
+  if (!audio.samples.empty() && audio.sample_rate > 0) {
+    double duration =
+        audio.samples.size() / static_cast<double>(audio.sample_rate);
+    Metrics::Observe(MetricHistogram::kTtsRealTimeFactor, seconds / duration);
+  }
+}
+
+OfflineTts::OfflineTts(const OfflineTtsConfig &config)
+    : impl_(OfflineTtsImpl::Create(config)) {
+  if (config.audio_cache_size > 0 || !config.audio_cache_dir.empty()) {
+    cache_ = std::make_unique<OfflineTtsCache>(config);
+  }
+
+  if (config.max_concurrent_requests > 0) {
+    slots_ = std::make_unique<Slots>(config.max_concurrent_requests);
+  }
+}
+
+OfflineTts::~OfflineTts() = default;
+
+GeneratedAudio OfflineTts::Generate(
+    const TtsArgs &args, GeneratedAudioCallback callback /*= nullptr*/,
+    void *callback_arg /*= nullptr*/) const {
+  Metrics::Add(MetricCounter::kTtsRequests);
+
+  if (!cache_) {
+    SlotGuard guard(slots_.get());
+    return GenerateImpl(args, std::move(callback), callback_arg);
+  }
+
+  std::string key = cache_->GetKey(args);
+
+  GeneratedAudio ans;
+  bool hit = cache_->Get(key, &ans);
+  Metrics::Add(hit ? MetricCounter::kTtsAudioCacheHits
+                   : MetricCounter::kTtsAudioCacheMisses);
+  if (hit) {
+    if (callback) {
+      callback(ans.samples.data(), ans.samples.size(), 1, 1, callback_arg);
+    }
+
+    if (!args.return_samples) {
+      ans.samples = {};
+    }
+
+    return ans;
+  }
+
+  // An audio that is stopped by the callback is incomplete
+  bool stopped = false;
+  GeneratedAudioCallback wrapper = nullptr;
+  if (callback) {
+    wrapper = [&callback, &stopped](const float *samples, int32_t n,
+                                    int32_t processed, int32_t total,
+                                    void *arg) -> int32_t {
+      int32_t ans = callback(samples, n, processed, total, arg);
+      stopped = stopped || !ans;
+      return ans;
+    };
+  }
+
+  {
+    SlotGuard guard(slots_.get());
+    ans = GenerateImpl(args, std::move(wrapper), callback_arg);
+  }
+
+  if (!stopped && !ans.samples.empty()) {
+    cache_->Put(key, ans);
+  }
+
+  return ans;
+}
+
+int64_t OfflineTts::GenerateInt16(const TtsArgs &_args,
+                                  GeneratedInt16Callback callback,
+                                  void *callback_arg /*= nullptr*/) const {
+  if (!callback) {
+    SHERPA_NCNN_LOGE("Please provide a callback for GenerateInt16()");
+    return 0;
+  }
+
+  TtsArgs args = _args;
+  args.return_samples = false;
+
+  int64_t num_samples = 0;
+  std::vector<int16_t> buf;
+
+  Generate(
+      args,
+      [&](const float *samples, int32_t n, int32_t processed, int32_t total,
+          void *arg) -> int32_t {
+        num_samples += n;
+
+        buf.resize(n);
+        FloatToInt16(samples, n, buf.data());
+
+        return callback(buf.data(), n, processed, total, arg);
+      },
+      callback_arg);
+
+  return num_samples;
+}
+
+std::vector<GeneratedAudio> OfflineTts::GenerateBatch(
+    const std::vector<TtsArgs> &args) const {
+  int32_t n = args.size();
+  std::vector<GeneratedAudio> ans(n);
+
+  Metrics::Add(MetricCounter::kTtsRequests, n);
+
+  std::vector<std::string> keys(n);
+  std::vector<int32_t> misses;
+  std::vector<TtsArgs> miss_args;
+  for (int32_t i = 0; i != n; ++i) {
+    if (cache_) {
+      keys[i] = cache_->GetKey(args[i]);
+      bool hit = cache_->Get(keys[i], &ans[i]);
+      Metrics::Add(hit ? MetricCounter::kTtsAudioCacheHits
+                       : MetricCounter::kTtsAudioCacheMisses);
+      if (hit) {
+        continue;
+      }
+    }
+
+    misses.push_back(i);
+    miss_args.push_back(ToUtf8(args[i]));
+  }
+
+  if (miss_args.empty()) {
+    return ans;
+  }
+
+  SlotGuard guard(slots_.get());
+
+  auto start = StageClock::now();
+  std::vector<GeneratedAudio> generated = impl_->GenerateBatch(miss_args);
+
+  // The audios of a batch are generated together, so each of them is
+  // charged an equal share
+  double seconds = ElapsedMs(start) / 1000 / misses.size();
+
+  for (int32_t k = 0; k != static_cast<int32_t>(misses.size()); ++k) {
+    int32_t i = misses[k];
+    ans[i] = std::move(generated[k]);
+    ObserveSynthesis(ans[i], seconds);
+
+    if (cache_ && !ans[i].samples.empty()) {
+      cache_->Put(keys[i], ans[i]);
+    }
+  }
+
+  return ans;
+}
+
+GeneratedAudio OfflineTts::GenerateImpl(const TtsArgs &args,
+                                        GeneratedAudioCallback callback,
+                                        void *callback_arg) const {
+  if (!Metrics::Enabled()) {
+    return impl_->Generate(ToUtf8(args), std::move(callback), callback_arg);
+  }
+
+  auto start = StageClock::now();
+  GeneratedAudio ans =
+      impl_->Generate(ToUtf8(args), std::move(callback), callback_arg);
+  ObserveSynthesis(ans, ElapsedMs(start) / 1000);
+
+  return ans;
 }
 
 int32_t OfflineTts::SampleRate() const { return impl_->SampleRate(); }
 
+const LatencyStats *OfflineTts::GetLatencyStats() const {
+  return impl_->GetLatencyStats();
+}
+
 int32_t OfflineTts::NumSpeakers() const { return impl_->NumSpeakers(); }
 
+bool OfflineTts::SetSpeakerEmbedding(
+    int32_t sid, const std::vector<float> &embedding) const {
+  if (!impl_->SetSpeakerEmbedding(sid, embedding)) {
+    return false;
+  }
+
+  if (cache_) {
+    cache_->SetSpeakerEmbedding(sid, embedding);
+  }
+
+  return true;
+}
+
 }  // namespace sherpa_ncnn
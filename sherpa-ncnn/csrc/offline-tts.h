@@ -10,6 +10,7 @@
 #include <string>
 #include <vector>
 
+#include "sherpa-ncnn/csrc/latency-stats.h"
 #include "sherpa-ncnn/csrc/offline-tts-model-config.h"
 #include "sherpa-ncnn/csrc/parse-options.h"
 
@@ -32,6 +33,68 @@ struct OfflineTtsConfig {
   // If you set it to -1, then we process all sentences in a single batch.
   int32_t max_num_sentences = 1;
 
+  // Number of threads that synthesize sentences in parallel, each with
+  // OfflineTtsModelConfig::num_threads threads. The callback still receives
+  // the sentences in order. At most max_num_sentences sentences are
+  // processed at a time, so both must be larger than 1 for parallelism.
+  int32_t num_workers = 1;
+
+  // If true and sentences are processed one at a time, the nets run in a
+  // two-stage pipeline: the encoder and the duration predictor of the next
+  // sentence run while the current one is in the flow and the decoder.
+  // See also OfflineTtsModelConfig::encoder_num_threads and
+  // OfflineTtsModelConfig::decoder_num_threads.
+  bool enable_pipeline = false;
+
+  // OfflineTts::Generate() may be called from several threads at the same
+  // time, which share the weights of the model. If positive, at most this
+  // many requests are synthesized at a time and further calls wait, so
+  // that a server can use one model for N requests in parallel, each with
+  // OfflineTtsModelConfig::num_threads threads, without oversubscribing
+  // the CPU. Requests served from the audio cache do not wait. 0 means no
+  // limit.
+  //
+  // If it is larger than 1, each thread uses its own memory pools, i.e.,
+  // OfflineTtsModelConfig::pool_per_thread is implied, so that concurrent
+  // requests do not contend for the lock of shared pools.
+  int32_t max_concurrent_requests = 0;
+
+  // If positive, the decoder converts the latent of a sentence to audio in
+  // chunks of this many frames and the callback receives the audio of
+  // each chunk as soon as it is ready. It reduces the time to the first
+  // audio of long sentences. Not used if sentences are processed in
+  // parallel, see num_workers.
+  int32_t decoder_chunk_size = 0;
+
+  // Number of frames on each side of a chunk that are decoded along with
+  // it. They give the decoder the context of the chunk and the outputs of
+  // neighboring chunks are cross-faded over one frame.
+  int32_t decoder_chunk_overlap = 16;
+
+  // Number of texts whose token IDs are cached. Generating a text again
+  // skips the text front-end. 0 disables the cache.
+  int32_t token_cache_size = 128;
+
+  // If not negative, the noise of the model is drawn from a generator with
+  // this seed, so generating the same text twice gives the same audio.
+  // Otherwise, the noise differs from call to call. TtsArgs::seed
+  // overrides it.
+  int32_t seed = -1;
+
+  // Number of generated audios that are cached in memory, keyed by the
+  // text or tokens, sid, speed, the noise scales and the model. Generating
+  // a cached text returns the cached audio. 0 disables the cache.
+  int32_t audio_cache_size = 0;
+
+  // If not empty, generated audios are also saved to this existing
+  // directory. Cached audios are memory-mapped from it, so the cache
+  // survives restarts and is shared by processes.
+  std::string audio_cache_dir;
+
+  // If true, the wall time of each stage of each sentence is recorded.
+  // See OfflineTts::GetLatencyStats().
+  bool enable_profiling = false;
+
   // If positive, we limit the max number of tokens per sentence
   int32_t max_tokens_per_sentence = -1;
 
@@ -97,9 +160,21 @@ struct TtsArgs {
 
   float noise_scale = 0.667f;
   float noise_scale_w = 0.8f;
+
+  // If not negative, the seed of the noise of the model, so that the same
+  // arguments give the same audio. Otherwise, OfflineTtsConfig::seed is
+  // used.
+  int64_t seed = -1;
+
+  // If false, the audio is passed only to the callback of
+  // OfflineTts::Generate() and GeneratedAudio::samples is empty, so that
+  // the audio of a long text is not held in memory.
+  bool return_samples = true;
 };
 
+class OfflineTtsCache;
 class OfflineTtsImpl;
+class Slots;
 
 // If the callback returns 0, then it stops generating
 // if the callback returns 1, then it keeps generating
@@ -107,6 +182,13 @@ using GeneratedAudioCallback = std::function<int32_t(
     const float * /*samples*/, int32_t /*num_samples*/, int32_t /*processed*/,
     int32_t /*total*/, void * /*arg*/)>;
 
+// Like GeneratedAudioCallback, but the samples are 16-bit PCM
+using GeneratedInt16Callback = std::function<int32_t(
+    const int16_t * /*samples*/, int32_t /*num_samples*/,
+    int32_t /*processed*/, int32_t /*total*/, void * /*arg*/)>;
+
+// All methods are thread-safe. See OfflineTtsConfig::max_concurrent_requests
+// for serving several requests in parallel.
 class OfflineTts {
  public:
   ~OfflineTts();
@@ -124,15 +206,59 @@ class OfflineTts {
                           GeneratedAudioCallback callback = nullptr,
                           void *callback_arg = nullptr) const;
 
+  // Like Generate(), but the audio is passed to the callback only, as
+  // 16-bit PCM as in a wave file, see FloatToInt16(). No copy of the whole
+  // audio is kept, so a long text needs memory for one sentence at a time,
+  // e.g., when the callback writes to a WaveWriter or a socket.
+  //
+  // Return the number of samples passed to the callback. It is 0 if args
+  // is invalid.
+  int64_t GenerateInt16(const TtsArgs &args, GeneratedInt16Callback callback,
+                        void *callback_arg = nullptr) const;
+
+  // Generate the audio of several requests, e.g., of several callers that
+  // share this object. ans[i] is the audio of args[i] and is empty if
+  // args[i] is invalid.
+  //
+  // The sentences of all requests are synthesized together by
+  // config.num_workers threads, so it has a higher throughput than
+  // calling Generate() for each request in turn.
+  std::vector<GeneratedAudio> GenerateBatch(
+      const std::vector<TtsArgs> &args) const;
+
   // Return the sample rate of the generated audio
   int32_t SampleRate() const;
 
+  // Return the time of each stage, one sample per sentence for the nets
+  // and one per text for the front-end. Audios from the cache are not
+  // counted. Return nullptr if config.enable_profiling is false.
+  const LatencyStats *GetLatencyStats() const;
+
   // Number of supported speakers.
   // If it supports only a single speaker, then it return 0 or 1.
   int32_t NumSpeakers() const;
 
+  // Make TtsArgs::sid == sid use the given speaker embedding, e.g., one that
+  // is interpolated between speakers of the model. sid may be larger than
+  // or equal to NumSpeakers(). Supported only by multi-speaker models.
+  // Return false on error.
+  bool SetSpeakerEmbedding(int32_t sid,
+                           const std::vector<float> &embedding) const;
+
+ private:
+  GeneratedAudio GenerateImpl(const TtsArgs &args,
+                              GeneratedAudioCallback callback,
+                              void *callback_arg) const;
+
  private:
   std::unique_ptr<OfflineTtsImpl> impl_;
+
+  // Not null if config.audio_cache_size > 0 or config.audio_cache_dir is
+  // not empty
+  std::unique_ptr<OfflineTtsCache> cache_;
+
+  // Not null if config.max_concurrent_requests > 0
+  std::unique_ptr<Slots> slots_;
 };
 
 }  // namespace sherpa_ncnn
@@ -0,0 +1,285 @@
+// sherpa-ncnn/csrc/pcm-utils.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/pcm-utils.h"
+
+#include <algorithm>
+
+#include "sherpa-ncnn/csrc/simd.h"
+
+namespace sherpa_ncnn {
+
+void Int16ToFloat(const int16_t *in, int32_t n, float scale, float *out) {
+  int32_t i = 0;
+
+#if SHERPA_NCNN_NEON
+  float32x4_t s = vdupq_n_f32(scale);
+  for (; i + 8 <= n; i += 8) {
+    int16x8_t x = vld1q_s16(in + i);
+    int32x4_t lo = vmovl_s16(vget_low_s16(x));
+    int32x4_t hi = vmovl_s16(vget_high_s16(x));
+    vst1q_f32(out + i, vmulq_f32(vcvtq_f32_s32(lo), s));
+    vst1q_f32(out + i + 4, vmulq_f32(vcvtq_f32_s32(hi), s));
+  }
+#elif SHERPA_NCNN_WASM_SIMD
+  v128_t s = wasm_f32x4_splat(scale);
+  for (; i + 8 <= n; i += 8) {
+    v128_t x = wasm_v128_load(in + i);
+    v128_t lo = wasm_i32x4_extend_low_i16x8(x);
+    v128_t hi = wasm_i32x4_extend_high_i16x8(x);
+    wasm_v128_store(out + i, wasm_f32x4_mul(wasm_f32x4_convert_i32x4(lo), s));
+    wasm_v128_store(out + i + 4,
+                    wasm_f32x4_mul(wasm_f32x4_convert_i32x4(hi), s));
+  }
+#elif SHERPA_NCNN_SSE2
+  __m128 s = _mm_set1_ps(scale);
+  for (; i + 8 <= n; i += 8) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+    // Sign-extend to 32 bits: put each value in the upper half of a 32-bit
+    // lane, then shift it down arithmetically
+    __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+    __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+    _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), s));
+    _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), s));
+  }
+#endif
+
+  for (; i < n; ++i) {
+    out[i] = in[i] * scale;
+  }
+}
+
+void FloatToInt16(const float *in, int32_t n, int16_t *out) {
+  int32_t i = 0;
+
+#if SHERPA_NCNN_NEON
+  float32x4_t lower = vdupq_n_f32(-1);
+  float32x4_t upper = vdupq_n_f32(1);
+  float32x4_t s = vdupq_n_f32(32767);
+  for (; i + 8 <= n; i += 8) {
+    float32x4_t lo = vminq_f32(vmaxq_f32(vld1q_f32(in + i), lower), upper);
+    float32x4_t hi =
+        vminq_f32(vmaxq_f32(vld1q_f32(in + i + 4), lower), upper);
+    int16x4_t a = vmovn_s32(vcvtq_s32_f32(vmulq_f32(lo, s)));
+    int16x4_t b = vmovn_s32(vcvtq_s32_f32(vmulq_f32(hi, s)));
+    vst1q_s16(out + i, vcombine_s16(a, b));
+  }
+#elif SHERPA_NCNN_WASM_SIMD
+  v128_t lower = wasm_f32x4_splat(-1);
+  v128_t upper = wasm_f32x4_splat(1);
+  v128_t s = wasm_f32x4_splat(32767);
+  for (; i + 8 <= n; i += 8) {
+    v128_t lo = wasm_f32x4_min(wasm_f32x4_max(wasm_v128_load(in + i), lower),
+                               upper);
+    v128_t hi = wasm_f32x4_min(
+        wasm_f32x4_max(wasm_v128_load(in + i + 4), lower), upper);
+    lo = wasm_i32x4_trunc_sat_f32x4(wasm_f32x4_mul(lo, s));
+    hi = wasm_i32x4_trunc_sat_f32x4(wasm_f32x4_mul(hi, s));
+    wasm_v128_store(out + i, wasm_i16x8_narrow_i32x4(lo, hi));
+  }
+#elif SHERPA_NCNN_SSE2
+  __m128 lower = _mm_set1_ps(-1);
+  __m128 upper = _mm_set1_ps(1);
+  __m128 s = _mm_set1_ps(32767);
+  for (; i + 8 <= n; i += 8) {
+    __m128 lo = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i), lower), upper);
+    __m128 hi =
+        _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i + 4), lower), upper);
+    __m128i a = _mm_cvttps_epi32(_mm_mul_ps(lo, s));
+    __m128i b = _mm_cvttps_epi32(_mm_mul_ps(hi, s));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i),
+                     _mm_packs_epi32(a, b));
+  }
+#endif
+
+  for (; i < n; ++i) {
+    float x = std::min(std::max(in[i], -1.0f), 1.0f);
+    out[i] = static_cast<int16_t>(x * 32767);
+  }
+}
+
+void Deinterleave(const float *in, int32_t num_channels, int32_t n,
+                  float scale, float *const *out) {
+  int32_t i = 0;
+
+#if SHERPA_NCNN_NEON || SHERPA_NCNN_WASM_SIMD || SHERPA_NCNN_SSE2
+  if (num_channels == 2) {
+    float *left = out[0];
+    float *right = out[1];
+#if SHERPA_NCNN_NEON
+    float32x4_t s = vdupq_n_f32(scale);
+    for (; i + 4 <= n; i += 4) {
+      float32x4x2_t x = vld2q_f32(in + 2 * i);
+      vst1q_f32(left + i, vmulq_f32(x.val[0], s));
+      vst1q_f32(right + i, vmulq_f32(x.val[1], s));
+    }
+#elif SHERPA_NCNN_WASM_SIMD
+    v128_t s = wasm_f32x4_splat(scale);
+    for (; i + 4 <= n; i += 4) {
+      v128_t a = wasm_v128_load(in + 2 * i);
+      v128_t b = wasm_v128_load(in + 2 * i + 4);
+      wasm_v128_store(left + i,
+                      wasm_f32x4_mul(wasm_i32x4_shuffle(a, b, 0, 2, 4, 6), s));
+      wasm_v128_store(right + i,
+                      wasm_f32x4_mul(wasm_i32x4_shuffle(a, b, 1, 3, 5, 7), s));
+    }
+#elif SHERPA_NCNN_SSE2
+    __m128 s = _mm_set1_ps(scale);
+    for (; i + 4 <= n; i += 4) {
+      __m128 a = _mm_loadu_ps(in + 2 * i);
+      __m128 b = _mm_loadu_ps(in + 2 * i + 4);
+      __m128 l = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+      __m128 r = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+      _mm_storeu_ps(left + i, _mm_mul_ps(l, s));
+      _mm_storeu_ps(right + i, _mm_mul_ps(r, s));
+    }
+#endif
+  }
+#endif
+
+  for (; i < n; ++i) {
+    const float *p = in + static_cast<int64_t>(i) * num_channels;
+    for (int32_t c = 0; c != num_channels; ++c) {
+      out[c][i] = p[c] * scale;
+    }
+  }
+}
+
+void DeinterleaveInt16(const int16_t *in, int32_t num_channels, int32_t n,
+                       float scale, float *const *out) {
+  int32_t i = 0;
+
+#if SHERPA_NCNN_NEON || SHERPA_NCNN_WASM_SIMD || SHERPA_NCNN_SSE2
+  if (num_channels == 2) {
+    float *left = out[0];
+    float *right = out[1];
+#if SHERPA_NCNN_NEON
+    float32x4_t s = vdupq_n_f32(scale);
+    for (; i + 4 <= n; i += 4) {
+      int16x4x2_t x = vld2_s16(in + 2 * i);
+      vst1q_f32(left + i, vmulq_f32(vcvtq_f32_s32(vmovl_s16(x.val[0])), s));
+      vst1q_f32(right + i, vmulq_f32(vcvtq_f32_s32(vmovl_s16(x.val[1])), s));
+    }
+#elif SHERPA_NCNN_WASM_SIMD
+    // A 32-bit lane holds a left sample in its lower half and a right
+    // sample in its upper half. Arithmetic shifts sign-extend them.
+    v128_t s = wasm_f32x4_splat(scale);
+    for (; i + 4 <= n; i += 4) {
+      v128_t x = wasm_v128_load(in + 2 * i);
+      v128_t l = wasm_i32x4_shr(wasm_i32x4_shl(x, 16), 16);
+      v128_t r = wasm_i32x4_shr(x, 16);
+      wasm_v128_store(left + i,
+                      wasm_f32x4_mul(wasm_f32x4_convert_i32x4(l), s));
+      wasm_v128_store(right + i,
+                      wasm_f32x4_mul(wasm_f32x4_convert_i32x4(r), s));
+    }
+#elif SHERPA_NCNN_SSE2
+    // The same as above
+    __m128 s = _mm_set1_ps(scale);
+    for (; i + 4 <= n; i += 4) {
+      __m128i x =
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + 2 * i));
+      __m128i l = _mm_srai_epi32(_mm_slli_epi32(x, 16), 16);
+      __m128i r = _mm_srai_epi32(x, 16);
+      _mm_storeu_ps(left + i, _mm_mul_ps(_mm_cvtepi32_ps(l), s));
+      _mm_storeu_ps(right + i, _mm_mul_ps(_mm_cvtepi32_ps(r), s));
+    }
+#endif
+  }
+#endif
+
+  for (; i < n; ++i) {
+    const int16_t *p = in + static_cast<int64_t>(i) * num_channels;
+    for (int32_t c = 0; c != num_channels; ++c) {
+      out[c][i] = p[c] * scale;
+    }
+  }
+}
+
+float MeanSquare(const float *in, int32_t n) {
+  if (n <= 0) {
+    return 0;
+  }
+
+  int32_t i = 0;
+
+  // Partial sums of the 4 lanes
+  float lanes[4] = {0, 0, 0, 0};
+
+#if SHERPA_NCNN_NEON
+  float32x4_t acc = vdupq_n_f32(0);
+  for (; i + 4 <= n; i += 4) {
+    float32x4_t x = vld1q_f32(in + i);
+    acc = vmlaq_f32(acc, x, x);
+  }
+  vst1q_f32(lanes, acc);
+#elif SHERPA_NCNN_WASM_SIMD
+  v128_t acc = wasm_f32x4_splat(0);
+  for (; i + 4 <= n; i += 4) {
+    v128_t x = wasm_v128_load(in + i);
+    acc = wasm_f32x4_add(acc, wasm_f32x4_mul(x, x));
+  }
+  wasm_v128_store(lanes, acc);
+#elif SHERPA_NCNN_SSE2
+  __m128 acc = _mm_setzero_ps();
+  for (; i + 4 <= n; i += 4) {
+    __m128 x = _mm_loadu_ps(in + i);
+    acc = _mm_add_ps(acc, _mm_mul_ps(x, x));
+  }
+  _mm_storeu_ps(lanes, acc);
+#endif
+
+  float sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+  for (; i < n; ++i) {
+    sum += in[i] * in[i];
+  }
+
+  return sum / n;
+}
+
+int32_t NumZeroCrossings(const float *in, int32_t n) {
+  int32_t i = 1;
+
+  // Counts of the 4 lanes. A lane of a comparison mask is all ones, i.e.,
+  // -1, so subtracting the xor of two masks counts the differences.
+  int32_t lanes[4] = {0, 0, 0, 0};
+
+#if SHERPA_NCNN_NEON
+  float32x4_t zero = vdupq_n_f32(0);
+  int32x4_t acc = vdupq_n_s32(0);
+  for (; i + 4 <= n; i += 4) {
+    uint32x4_t a = vcltq_f32(vld1q_f32(in + i - 1), zero);
+    uint32x4_t b = vcltq_f32(vld1q_f32(in + i), zero);
+    acc = vsubq_s32(acc, vreinterpretq_s32_u32(veorq_u32(a, b)));
+  }
+  vst1q_s32(lanes, acc);
+#elif SHERPA_NCNN_WASM_SIMD
+  v128_t zero = wasm_f32x4_splat(0);
+  v128_t acc = wasm_i32x4_splat(0);
+  for (; i + 4 <= n; i += 4) {
+    v128_t a = wasm_f32x4_lt(wasm_v128_load(in + i - 1), zero);
+    v128_t b = wasm_f32x4_lt(wasm_v128_load(in + i), zero);
+    acc = wasm_i32x4_sub(acc, wasm_v128_xor(a, b));
+  }
+  wasm_v128_store(lanes, acc);
+#elif SHERPA_NCNN_SSE2
+  __m128 zero = _mm_setzero_ps();
+  __m128i acc = _mm_setzero_si128();
+  for (; i + 4 <= n; i += 4) {
+    __m128 a = _mm_cmplt_ps(_mm_loadu_ps(in + i - 1), zero);
+    __m128 b = _mm_cmplt_ps(_mm_loadu_ps(in + i), zero);
+    acc = _mm_sub_epi32(acc, _mm_castps_si128(_mm_xor_ps(a, b)));
+  }
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), acc);
+#endif
+
+  int32_t ans = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+  for (; i < n; ++i) {
+    ans += (in[i - 1] < 0) != (in[i] < 0);
+  }
+
+  return ans;
+}
+
+}  // namespace sherpa_ncnn
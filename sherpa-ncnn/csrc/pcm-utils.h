@@ -0,0 +1,40 @@
+// sherpa-ncnn/csrc/pcm-utils.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_PCM_UTILS_H_
+#define SHERPA_NCNN_CSRC_PCM_UTILS_H_
+
+#include <cstdint>
+
+namespace sherpa_ncnn {
+
+// out[i] = in[i] * scale, for i in [0, n).
+//
+// Use scale = 1.0f / 32768 to get samples normalized to [-1, 1).
+void Int16ToFloat(const int16_t *in, int32_t n, float scale, float *out);
+
+// out[i] = in[i] * 32767 rounded toward zero, for i in [0, n), after
+// clamping in[i] to [-1, 1]. It is the format of wave files.
+void FloatToInt16(const float *in, int32_t n, int16_t *out);
+
+// out[c][i] = in[i * num_channels + c] * scale, for c in [0, num_channels)
+// and i in [0, n), i.e., split n frames of interleaved samples into one
+// array per channel. Stereo input is split with SIMD.
+void Deinterleave(const float *in, int32_t num_channels, int32_t n,
+                  float scale, float *const *out);
+
+// Same as Deinterleave() but for 16-bit samples
+void DeinterleaveInt16(const int16_t *in, int32_t num_channels, int32_t n,
+                       float scale, float *const *out);
+
+// Return the mean of in[i] * in[i], for i in [0, n). 0 if n is 0.
+float MeanSquare(const float *in, int32_t n);
+
+// Return the number of i in [1, n) such that in[i - 1] and in[i] have
+// different signs. 0 counts as positive.
+int32_t NumZeroCrossings(const float *in, int32_t n);
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_PCM_UTILS_H_
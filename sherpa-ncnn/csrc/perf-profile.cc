@@ -0,0 +1,194 @@
+// sherpa-ncnn/csrc/perf-profile.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/perf-profile.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include "cpu.h"  // NOLINT
+#include "gpu.h"  // NOLINT
+#include "sherpa-ncnn/csrc/model.h"
+
+namespace sherpa_ncnn {
+
+bool NetTuning::Apply(ncnn::Option *opt) const {
+  if (!Model::SetDevice(device, opt) || !Model::SetPrecision(precision, opt)) {
+    return false;
+  }
+
+  opt->num_threads = num_threads;
+  opt->use_winograd_convolution = use_winograd_convolution;
+  opt->use_sgemm_convolution = use_sgemm_convolution;
+
+  return true;
+}
+
+std::string NetTuning::ToString() const {
+  std::ostringstream os;
+  os << "device=" << device << " precision=" << precision
+     << " num_threads=" << num_threads
+     << " winograd=" << use_winograd_convolution
+     << " sgemm=" << use_sgemm_convolution;
+  return os.str();
+}
+
+std::string PerfProfile::DeviceFingerprint() {
+  std::ostringstream os;
+  os << "cpus=" << ncnn::get_cpu_count()
+     << " big=" << ncnn::get_big_cpu_count();
+
+  std::string gpu = "none";
+#if NCNN_VULKAN
+  if (ncnn::get_gpu_count() > 0) {
+    gpu = ncnn::get_gpu_info().device_name();
+    std::replace(gpu.begin(), gpu.end(), ' ', '_');
+  }
+#endif
+  os << " gpu=" << gpu;
+
+  return os.str();
+}
+
+// Parse "key=value" of a network into t. Return false if it is invalid.
+static bool ParseOption(const std::string &s, NetTuning *t) {
+  auto pos = s.find('=');
+  if (pos == std::string::npos) {
+    return false;
+  }
+
+  std::string key = s.substr(0, pos);
+  std::string value = s.substr(pos + 1);
+
+  if (key == "device") {
+    t->device = value;
+    return value == "cpu" || value == "gpu";
+  }
+
+  if (key == "precision") {
+    t->precision = value;
+    return value == "accuracy" || value == "balanced" || value == "speed";
+  }
+
+  if (value.empty()) {
+    return false;
+  }
+
+  int32_t v = atoi(value.c_str());
+  if (key == "num_threads") {
+    t->num_threads = v;
+    return v > 0;
+  }
+
+  if (key == "winograd") {
+    t->use_winograd_convolution = v != 0;
+    return true;
+  }
+
+  if (key == "sgemm") {
+    t->use_sgemm_convolution = v != 0;
+    return true;
+  }
+
+  return false;
+}
+
+bool PerfProfile::Read(const std::string &filename) {
+  std::ifstream is(filename);
+  if (!is) {
+    NCNN_LOGE("Failed to open %s", filename.c_str());
+    return false;
+  }
+
+  std::string fingerprint;
+  std::map<std::string, NetTuning> nets;
+
+  std::string line;
+  while (std::getline(is, line)) {
+    std::istringstream ls(line);
+    std::string name;
+    if (!(ls >> name) || name[0] == '#') {
+      continue;
+    }
+
+    if (name == "fingerprint") {
+      std::getline(ls >> std::ws, fingerprint);
+      continue;
+    }
+
+    NetTuning t;
+    std::string s;
+    while (ls >> s) {
+      if (!ParseOption(s, &t)) {
+        NCNN_LOGE("Invalid option '%s' of %s in %s", s.c_str(), name.c_str(),
+                  filename.c_str());
+        return false;
+      }
+    }
+
+    nets[name] = t;
+  }
+
+  std::string this_device = DeviceFingerprint();
+  if (fingerprint != this_device) {
+    NCNN_LOGE("%s is for another device (%s). This one is %s",
+              filename.c_str(), fingerprint.c_str(), this_device.c_str());
+  }
+
+  fingerprint_ = std::move(fingerprint);
+  nets_ = std::move(nets);
+
+  return true;
+}
+
+bool PerfProfile::Write(const std::string &filename) const {
+  // Write to another file and rename it, so that a model loaded at the
+  // same time never sees a partial file
+  std::string tmp = filename + ".tmp";
+  {
+    std::ofstream os(tmp);
+    os << ToString();
+    if (!os) {
+      NCNN_LOGE("Failed to write %s", tmp.c_str());
+      os.close();
+      std::remove(tmp.c_str());
+      return false;
+    }
+  }
+
+  if (std::rename(tmp.c_str(), filename.c_str()) != 0) {
+    NCNN_LOGE("Failed to rename %s to %s", tmp.c_str(), filename.c_str());
+    std::remove(tmp.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+const NetTuning *PerfProfile::Get(const std::string &net) const {
+  auto it = nets_.find(net);
+  return it != nets_.end() ? &it->second : nullptr;
+}
+
+void PerfProfile::Set(const std::string &net, const NetTuning &tuning) {
+  nets_[net] = tuning;
+}
+
+std::string PerfProfile::ToString() const {
+  std::ostringstream os;
+  os << "# sherpa-ncnn performance profile\n";
+  os << "fingerprint " << fingerprint_ << "\n";
+  for (const auto &p : nets_) {
+    os << p.first << " " << p.second.ToString() << "\n";
+  }
+
+  return os.str();
+}
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,92 @@
+// sherpa-ncnn/csrc/perf-profile.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_PERF_PROFILE_H_
+#define SHERPA_NCNN_CSRC_PERF_PROFILE_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "option.h"  // NOLINT
+
+namespace sherpa_ncnn {
+
+// How one network runs on this device, see PerfProfile
+struct NetTuning {
+  std::string device = "cpu";  // "cpu" or "gpu"
+
+  // "accuracy", "balanced" or "speed", see ModelConfig::encoder_precision
+  std::string precision = "accuracy";
+
+  int32_t num_threads = 1;
+
+  bool use_winograd_convolution = true;
+  bool use_sgemm_convolution = true;
+
+  // Set the options of a network. Return false if device or precision is
+  // unknown.
+  bool Apply(ncnn::Option *opt) const;
+
+  std::string ToString() const;
+};
+
+/** The fastest options of each network of a model on one device, found
+ * by AutoTune() or sherpa-ncnn-autotune.
+ *
+ * A model loads it at startup if ModelConfig::perf_profile, etc., is set.
+ * The networks are named:
+ *
+ *  - "encoder", "decoder" and "joiner" for ModelConfig
+ *  - "sense_voice" for OfflineModelConfig
+ *  - "tts_encoder" and "tts_decoder" for OfflineTtsModelConfig, with the
+ *    nets of encoder_num_threads and of decoder_num_threads
+ *
+ * The options of a network in the profile replace those of the config.
+ * Other networks keep the options of the config.
+ *
+ * It is a text file with a line per network, e.g.,
+ *
+ *   fingerprint cpus=8 big=4 gpu=Mali-G78
+ *   encoder device=cpu precision=balanced num_threads=4 winograd=1 sgemm=1
+ */
+class PerfProfile {
+ public:
+  // The CPU and GPU of this device. A profile is meant for the device
+  // that it was written on.
+  static std::string DeviceFingerprint();
+
+  /** Read a profile written by Write(). A profile of another device, see
+   * DeviceFingerprint(), is used with a warning.
+   *
+   * @return Return false if the file cannot be read or is malformed.
+   */
+  bool Read(const std::string &filename);
+
+  // Return false on error
+  bool Write(const std::string &filename) const;
+
+  // Return nullptr if there is nothing for the network
+  const NetTuning *Get(const std::string &net) const;
+
+  void Set(const std::string &net, const NetTuning &tuning);
+
+  // The networks of the profile by name
+  const std::map<std::string, NetTuning> &Nets() const { return nets_; }
+
+  bool Empty() const { return nets_.empty(); }
+
+  void SetFingerprint(const std::string &s) { fingerprint_ = s; }
+  const std::string &Fingerprint() const { return fingerprint_; }
+
+  std::string ToString() const;
+
+ private:
+  std::string fingerprint_;
+  std::map<std::string, NetTuning> nets_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_PERF_PROFILE_H_
@@ -0,0 +1,275 @@
+// sherpa-ncnn/csrc/philox.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/philox.h"
+
+#include "sherpa-ncnn/csrc/simd.h"
+
+namespace sherpa_ncnn {
+
+namespace {
+
+constexpr uint32_t kM0 = 0xD2511F53;
+constexpr uint32_t kM1 = 0xCD9E8D57;
+constexpr uint32_t kW0 = 0x9E3779B9;
+constexpr uint32_t kW1 = 0xBB67AE85;
+constexpr int32_t kNumRounds = 10;
+
+// Uniform in [0, 1) from the upper 24 bits of x
+constexpr float kScale = 1.0f / (1 << 24);
+
+#if SHERPA_NCNN_NEON
+// The counters of 4 blocks, one per lane
+struct Counters {
+  uint32x4_t c0, c1, c2, c3;
+};
+
+void MulHiLo(uint32x4_t x, uint32_t m, uint32x4_t *hi, uint32x4_t *lo) {
+  uint32x2_t mm = vdup_n_u32(m);
+  uint64x2_t p0 = vmull_u32(vget_low_u32(x), mm);
+  uint64x2_t p1 = vmull_u32(vget_high_u32(x), mm);
+  *lo = vcombine_u32(vmovn_u64(p0), vmovn_u64(p1));
+  *hi = vcombine_u32(vshrn_n_u64(p0, 32), vshrn_n_u64(p1, 32));
+}
+
+void Round(Counters *c, uint32_t k0, uint32_t k1) {
+  uint32x4_t hi0, lo0, hi1, lo1;
+  MulHiLo(c->c0, kM0, &hi0, &lo0);
+  MulHiLo(c->c2, kM1, &hi1, &lo1);
+
+  c->c0 = veorq_u32(veorq_u32(hi1, c->c1), vdupq_n_u32(k0));
+  c->c1 = lo1;
+  c->c2 = veorq_u32(veorq_u32(hi0, c->c3), vdupq_n_u32(k1));
+  c->c3 = lo0;
+}
+
+float32x4_t ToFloat(uint32x4_t x, float a, float d) {
+  float32x4_t u = vmulq_n_f32(vcvtq_f32_u32(vshrq_n_u32(x, 8)), kScale);
+  return vmlaq_n_f32(vdupq_n_f32(a), u, d);
+}
+
+// Write the 16 numbers of blocks [block, block + 4) to p
+void Fill4Blocks(uint64_t block, uint32_t s0, uint32_t s1, uint32_t k0,
+                 uint32_t k1, float a, float d, float *p) {
+  uint32_t lo[4], hi[4];
+  for (int32_t i = 0; i != 4; ++i) {
+    lo[i] = static_cast<uint32_t>(block + i);
+    hi[i] = static_cast<uint32_t>((block + i) >> 32);
+  }
+
+  Counters c{vld1q_u32(lo), vld1q_u32(hi), vdupq_n_u32(s0), vdupq_n_u32(s1)};
+  for (int32_t r = 0; r != kNumRounds; ++r) {
+    Round(&c, k0, k1);
+    k0 += kW0;
+    k1 += kW1;
+  }
+
+  float32x4x4_t v;
+  v.val[0] = ToFloat(c.c0, a, d);
+  v.val[1] = ToFloat(c.c1, a, d);
+  v.val[2] = ToFloat(c.c2, a, d);
+  v.val[3] = ToFloat(c.c3, a, d);
+
+  // Interleaving the lanes puts the numbers of a block next to each other
+  vst4q_f32(p, v);
+}
+#elif SHERPA_NCNN_WASM_SIMD
+struct Counters {
+  v128_t c0, c1, c2, c3;
+};
+
+void MulHiLo(v128_t x, uint32_t m, v128_t *hi, v128_t *lo) {
+  v128_t mm = wasm_i32x4_splat(m);
+  v128_t p0 = wasm_u64x2_extmul_low_u32x4(x, mm);
+  v128_t p1 = wasm_u64x2_extmul_high_u32x4(x, mm);
+  *lo = wasm_i32x4_shuffle(p0, p1, 0, 2, 4, 6);
+  *hi = wasm_i32x4_shuffle(p0, p1, 1, 3, 5, 7);
+}
+
+void Round(Counters *c, uint32_t k0, uint32_t k1) {
+  v128_t hi0, lo0, hi1, lo1;
+  MulHiLo(c->c0, kM0, &hi0, &lo0);
+  MulHiLo(c->c2, kM1, &hi1, &lo1);
+
+  c->c0 = wasm_v128_xor(wasm_v128_xor(hi1, c->c1), wasm_i32x4_splat(k0));
+  c->c1 = lo1;
+  c->c2 = wasm_v128_xor(wasm_v128_xor(hi0, c->c3), wasm_i32x4_splat(k1));
+  c->c3 = lo0;
+}
+
+v128_t ToFloat(v128_t x, float a, float d) {
+  v128_t u = wasm_f32x4_mul(wasm_f32x4_convert_i32x4(wasm_u32x4_shr(x, 8)),
+                            wasm_f32x4_splat(kScale));
+  return wasm_f32x4_add(wasm_f32x4_splat(a),
+                        wasm_f32x4_mul(u, wasm_f32x4_splat(d)));
+}
+
+void Fill4Blocks(uint64_t block, uint32_t s0, uint32_t s1, uint32_t k0,
+                 uint32_t k1, float a, float d, float *p) {
+  uint32_t lo[4], hi[4];
+  for (int32_t i = 0; i != 4; ++i) {
+    lo[i] = static_cast<uint32_t>(block + i);
+    hi[i] = static_cast<uint32_t>((block + i) >> 32);
+  }
+
+  Counters c{wasm_v128_load(lo), wasm_v128_load(hi), wasm_i32x4_splat(s0),
+             wasm_i32x4_splat(s1)};
+  for (int32_t r = 0; r != kNumRounds; ++r) {
+    Round(&c, k0, k1);
+    k0 += kW0;
+    k1 += kW1;
+  }
+
+  v128_t x0 = ToFloat(c.c0, a, d);
+  v128_t x1 = ToFloat(c.c1, a, d);
+  v128_t x2 = ToFloat(c.c2, a, d);
+  v128_t x3 = ToFloat(c.c3, a, d);
+
+  // Transpose, so that the numbers of a block are next to each other
+  v128_t t0 = wasm_i32x4_shuffle(x0, x1, 0, 4, 1, 5);
+  v128_t t1 = wasm_i32x4_shuffle(x2, x3, 0, 4, 1, 5);
+  v128_t t2 = wasm_i32x4_shuffle(x0, x1, 2, 6, 3, 7);
+  v128_t t3 = wasm_i32x4_shuffle(x2, x3, 2, 6, 3, 7);
+
+  wasm_v128_store(p, wasm_i64x2_shuffle(t0, t1, 0, 2));
+  wasm_v128_store(p + 4, wasm_i64x2_shuffle(t0, t1, 1, 3));
+  wasm_v128_store(p + 8, wasm_i64x2_shuffle(t2, t3, 0, 2));
+  wasm_v128_store(p + 12, wasm_i64x2_shuffle(t2, t3, 1, 3));
+}
+#elif SHERPA_NCNN_SSE2
+struct Counters {
+  __m128i c0, c1, c2, c3;
+};
+
+void MulHiLo(__m128i x, uint32_t m, __m128i *hi, __m128i *lo) {
+  __m128i mm = _mm_set1_epi32(static_cast<int32_t>(m));
+
+  // 64-bit products of lanes 0 and 2, and of lanes 1 and 3
+  __m128i even = _mm_mul_epu32(x, mm);
+  __m128i odd = _mm_mul_epu32(_mm_srli_epi64(x, 32), mm);
+
+  *lo = _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                           _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+  *hi = _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 3, 1)),
+                           _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 3, 1)));
+}
+
+void Round(Counters *c, uint32_t k0, uint32_t k1) {
+  __m128i hi0, lo0, hi1, lo1;
+  MulHiLo(c->c0, kM0, &hi0, &lo0);
+  MulHiLo(c->c2, kM1, &hi1, &lo1);
+
+  c->c0 = _mm_xor_si128(_mm_xor_si128(hi1, c->c1),
+                        _mm_set1_epi32(static_cast<int32_t>(k0)));
+  c->c1 = lo1;
+  c->c2 = _mm_xor_si128(_mm_xor_si128(hi0, c->c3),
+                        _mm_set1_epi32(static_cast<int32_t>(k1)));
+  c->c3 = lo0;
+}
+
+__m128 ToFloat(__m128i x, float a, float d) {
+  __m128 u = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(x, 8)),
+                        _mm_set1_ps(kScale));
+  return _mm_add_ps(_mm_set1_ps(a), _mm_mul_ps(u, _mm_set1_ps(d)));
+}
+
+void Fill4Blocks(uint64_t block, uint32_t s0, uint32_t s1, uint32_t k0,
+                 uint32_t k1, float a, float d, float *p) {
+  Counters c;
+  c.c0 = _mm_setr_epi32(static_cast<int32_t>(block),
+                        static_cast<int32_t>(block + 1),
+                        static_cast<int32_t>(block + 2),
+                        static_cast<int32_t>(block + 3));
+  c.c1 = _mm_setr_epi32(static_cast<int32_t>(block >> 32),
+                        static_cast<int32_t>((block + 1) >> 32),
+                        static_cast<int32_t>((block + 2) >> 32),
+                        static_cast<int32_t>((block + 3) >> 32));
+  c.c2 = _mm_set1_epi32(static_cast<int32_t>(s0));
+  c.c3 = _mm_set1_epi32(static_cast<int32_t>(s1));
+
+  for (int32_t r = 0; r != kNumRounds; ++r) {
+    Round(&c, k0, k1);
+    k0 += kW0;
+    k1 += kW1;
+  }
+
+  __m128 x0 = ToFloat(c.c0, a, d);
+  __m128 x1 = ToFloat(c.c1, a, d);
+  __m128 x2 = ToFloat(c.c2, a, d);
+  __m128 x3 = ToFloat(c.c3, a, d);
+
+  // Transpose, so that the numbers of a block are next to each other
+  _MM_TRANSPOSE4_PS(x0, x1, x2, x3);
+
+  _mm_storeu_ps(p, x0);
+  _mm_storeu_ps(p + 4, x1);
+  _mm_storeu_ps(p + 8, x2);
+  _mm_storeu_ps(p + 12, x3);
+}
+#endif
+
+}  // namespace
+
+std::array<uint32_t, 4> Philox::Block(std::array<uint32_t, 4> c,
+                                      std::array<uint32_t, 2> k) {
+  for (int32_t r = 0; r != kNumRounds; ++r) {
+    uint64_t p0 = static_cast<uint64_t>(kM0) * c[0];
+    uint64_t p1 = static_cast<uint64_t>(kM1) * c[2];
+
+    c = {static_cast<uint32_t>(p1 >> 32) ^ c[1] ^ k[0],
+         static_cast<uint32_t>(p1),
+         static_cast<uint32_t>(p0 >> 32) ^ c[3] ^ k[1],
+         static_cast<uint32_t>(p0)};
+
+    k[0] += kW0;
+    k[1] += kW1;
+  }
+
+  return c;
+}
+
+void Philox::Fill(float *p, int32_t n, float a /*= 0*/, float b /*= 1*/,
+                  uint64_t offset /*= 0*/) const {
+  uint32_t s0 = static_cast<uint32_t>(stream_);
+  uint32_t s1 = static_cast<uint32_t>(stream_ >> 32);
+  std::array<uint32_t, 2> key = {static_cast<uint32_t>(seed_),
+                                 static_cast<uint32_t>(seed_ >> 32)};
+  float d = b - a;
+
+  // Position i of the stream is lane i % 4 of block i / 4
+  auto scalar_block = [&](uint64_t block, int32_t begin, int32_t end,
+                          float *out) {
+    auto x = Block({static_cast<uint32_t>(block),
+                    static_cast<uint32_t>(block >> 32), s0, s1},
+                   key);
+    for (int32_t i = begin; i < end; ++i) {
+      *out++ = a + ((x[i] >> 8) * kScale) * d;
+    }
+  };
+
+  int32_t i = 0;
+  uint64_t pos = offset;
+
+  // The rest of a partial first block
+  if (n > 0 && pos % 4 != 0) {
+    int32_t begin = pos % 4;
+    int32_t end = begin + n < 4 ? begin + n : 4;
+    scalar_block(pos / 4, begin, end, p);
+    i += end - begin;
+    pos += end - begin;
+  }
+
+#if SHERPA_NCNN_NEON || SHERPA_NCNN_WASM_SIMD || SHERPA_NCNN_SSE2
+  for (; i + 16 <= n; i += 16, pos += 16) {
+    Fill4Blocks(pos / 4, s0, s1, key[0], key[1], a, d, p + i);
+  }
+#endif
+
+  for (; i < n; i += 4, pos += 4) {
+    int32_t end = n - i < 4 ? n - i : 4;
+    scalar_block(pos / 4, 0, end, p + i);
+  }
+}
+
+}  // namespace sherpa_ncnn
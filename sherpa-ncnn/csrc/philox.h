@@ -0,0 +1,47 @@
+// sherpa-ncnn/csrc/philox.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_PHILOX_H_
+#define SHERPA_NCNN_CSRC_PHILOX_H_
+
+#include <array>
+#include <cstdint>
+
+namespace sherpa_ncnn {
+
+/** The counter-based random number generator Philox4x32-10 from
+ * "Parallel random numbers: as easy as 1, 2, 3" by Salmon et al., SC 2011.
+ *
+ * A generator is a pure function of (seed, stream, position): the number at
+ * a position does not depend on which numbers were generated before. So
+ * numbers can be generated in any order, by several threads or several
+ * SIMD lanes at a time, and are still reproducible. Different streams of
+ * the same seed are independent.
+ */
+class Philox {
+ public:
+  explicit Philox(uint64_t seed, uint64_t stream = 0)
+      : seed_(seed), stream_(stream) {}
+
+  // Return a generator of another stream with the same seed
+  Philox Stream(uint64_t stream) const { return Philox(seed_, stream); }
+
+  /** Fill p[0], ..., p[n-1] with numbers uniformly distributed in [a, b).
+   * p[i] is the number at position offset + i of the stream.
+   */
+  void Fill(float *p, int32_t n, float a = 0, float b = 1,
+            uint64_t offset = 0) const;
+
+  // The Philox4x32-10 bijection of a 128-bit counter with a 64-bit key
+  static std::array<uint32_t, 4> Block(std::array<uint32_t, 4> counter,
+                                       std::array<uint32_t, 2> key);
+
+ private:
+  uint64_t seed_;
+  uint64_t stream_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_PHILOX_H_
@@ -18,11 +18,121 @@
 
 #include "sherpa-ncnn/csrc/poolingmodulenoproj.h"
 
+#include <vector>
+
+#include "sherpa-ncnn/csrc/simd.h"
+#include "sherpa-ncnn/csrc/vulkan-pipeline.h"
+
 namespace sherpa_ncnn {
 
+#if NCNN_VULKAN
+// One invocation per column. The rows are processed in order since each
+// output is a running average. The sums are kept in fp32 since
+// cached_len grows with the length of the utterance.
+static const char kPoolingModuleNoProjShader[] = R"(
+#version 450
+
+layout (binding = 0) readonly buffer bottom_blob { sfp bottom_blob_data[]; };
+layout (binding = 1) readonly buffer cached_len { sfp cached_len_data[]; };
+layout (binding = 2) readonly buffer cached_avg { sfp cached_avg_data[]; };
+layout (binding = 3) writeonly buffer top_blob { sfp top_blob_data[]; };
+layout (binding = 4) writeonly buffer out_len { sfp out_cached_len_data[]; };
+layout (binding = 5) writeonly buffer out_avg { sfp out_cached_avg_data[]; };
+
+layout (push_constant) uniform parameter
+{
+    int w;
+    int h;
+} p;
+
+void main()
+{
+    int gx = int(gl_GlobalInvocationID.x);
+
+    if (gx >= p.w)
+        return;
+
+    float n = float(buffer_ld1(cached_len_data, 0));
+    float sum = n * float(buffer_ld1(cached_avg_data, gx));
+    float avg = 0.f;
+
+    for (int r = 0; r < p.h; r++)
+    {
+        sum += float(buffer_ld1(bottom_blob_data, r * p.w + gx));
+        avg = sum / (n + float(r + 1));
+        buffer_st1(top_blob_data, r * p.w + gx, afp(avg));
+    }
+
+    buffer_st1(out_cached_avg_data, gx, afp(avg));
+
+    if (gx == 0)
+    {
+        buffer_st1(out_cached_len_data, 0, afp(n + float(p.h)));
+    }
+}
+)";
+#endif
+
 PoolingModuleNoProj::PoolingModuleNoProj() {
   one_blob_only = false;
   support_inplace = false;
+
+  // Only x is packed; cached_avg has a single row. fp16 storage is not
+  // supported since cached_len grows with the length of the utterance.
+  support_packing = true;
+#if NCNN_VULKAN
+  support_vulkan = true;
+#endif
+}
+
+// sum[i] += x[i] and out[i] = sum[i] * scale for i in [0, n)
+static void AccumulateRow(const float *x, float *sum, float *out, float scale,
+                          int32_t n) {
+  int32_t i = 0;
+#if SHERPA_NCNN_NEON
+  float32x4_t s = vdupq_n_f32(scale);
+  for (; i + 4 <= n; i += 4) {
+    float32x4_t v = vaddq_f32(vld1q_f32(sum + i), vld1q_f32(x + i));
+    vst1q_f32(sum + i, v);
+    vst1q_f32(out + i, vmulq_f32(v, s));
+  }
+#elif SHERPA_NCNN_WASM_SIMD
+  v128_t s = wasm_f32x4_splat(scale);
+  for (; i + 4 <= n; i += 4) {
+    v128_t v = wasm_f32x4_add(wasm_v128_load(sum + i), wasm_v128_load(x + i));
+    wasm_v128_store(sum + i, v);
+    wasm_v128_store(out + i, wasm_f32x4_mul(v, s));
+  }
+#elif SHERPA_NCNN_SSE2
+#if SHERPA_NCNN_AVX2
+  __m256 s8 = _mm256_set1_ps(scale);
+  for (; i + 8 <= n; i += 8) {
+    __m256 v =
+        _mm256_add_ps(_mm256_loadu_ps(sum + i), _mm256_loadu_ps(x + i));
+    _mm256_storeu_ps(sum + i, v);
+    _mm256_storeu_ps(out + i, _mm256_mul_ps(v, s8));
+  }
+#endif
+  __m128 s = _mm_set1_ps(scale);
+  for (; i + 4 <= n; i += 4) {
+    __m128 v = _mm_add_ps(_mm_loadu_ps(sum + i), _mm_loadu_ps(x + i));
+    _mm_storeu_ps(sum + i, v);
+    _mm_storeu_ps(out + i, _mm_mul_ps(v, s));
+  }
+#elif SHERPA_NCNN_RVV
+  for (size_t vl; i < n; i += static_cast<int32_t>(vl)) {
+    vl = __riscv_vsetvl_e32m8(n - i);
+    vfloat32m8_t v = __riscv_vfadd_vv_f32m8(__riscv_vle32_v_f32m8(sum + i, vl),
+                                            __riscv_vle32_v_f32m8(x + i, vl),
+                                            vl);
+    __riscv_vse32_v_f32m8(sum + i, v, vl);
+    __riscv_vse32_v_f32m8(out + i, __riscv_vfmul_vf_f32m8(v, scale, vl), vl);
+  }
+#endif
+  for (; i < n; ++i) {
+    sum[i] += x[i];
+    out[i] = sum[i] * scale;
+  }
 }
 
 int32_t PoolingModuleNoProj::forward(const std::vector<ncnn::Mat> &bottom_blobs,
@@ -32,7 +142,7 @@ int32_t PoolingModuleNoProj::forward(const std::vector<ncnn::Mat> &bottom_blobs,
   ncnn::Mat cached_len = bottom_blobs[1];
   ncnn::Mat cached_avg = bottom_blobs[2];
 
-  // x.dims = 2, x.w = C, x.h = T
+  // x.dims = 2, x.w = C, x.h = T. x may be packed along T.
   // cached_len.dims = 1, cached_len.w = 1
   // cached_avg.dims = 2, cached_avg.w = C, cached_avg.h = 1
 
@@ -46,39 +156,45 @@ int32_t PoolingModuleNoProj::forward(const std::vector<ncnn::Mat> &bottom_blobs,
   out_cached_avg.create_like(cached_avg, opt.blob_allocator);
 
   int32_t w = x.w;
-  int32_t h = x.h;
+  int32_t elempack = x.elempack;
+  int32_t h = x.h * elempack;
 
-  const float *x_ptr = x;
   const float *cached_avg_ptr = cached_avg;
-  float *out_ptr = out_x;
 
   float n = cached_len[0];
 
-  // process row 0
+  // Row r of the output is the sum of the first r + 1 rows of x and
+  // n * cached_avg, divided by n + r + 1
+  std::vector<float> sum(w);
   for (int32_t c = 0; c < w; ++c) {
-    out_ptr[c] = x_ptr[c] + n * cached_avg_ptr[c];
+    sum[c] = n * cached_avg_ptr[c];
   }
 
-  for (int32_t r = 1; r < h; ++r) {
-    const float *x_cur = x.row(r);
+  for (int32_t r = 0; r < h; ++r) {
+    float scale = 1. / (n + r + 1);
 
-    float *out_prev = out_x.row(r - 1);
-    float *out_cur = out_x.row(r);
+    if (elempack == 1) {
+      AccumulateRow(x.row(r), sum.data(), out_x.row(r), scale, w);
+      continue;
+    }
 
-    float scale = 1. / (n + r);  // scale for the previous row
+    // Row r is interleaved with the other rows of its pack
+    size_t offset =
+        static_cast<size_t>(r / elempack) * w * elempack + r % elempack;
+    const float *x_ptr = static_cast<const float *>(x) + offset;
+    float *out_ptr = static_cast<float *>(out_x) + offset;
     for (int32_t c = 0; c < w; ++c) {
-      out_cur[c] = out_prev[c] + x_cur[c];
-      out_prev[c] *= scale;
+      sum[c] += x_ptr[c * elempack];
+      out_ptr[c * elempack] = sum[c] * scale;
     }
   }
 
-  float *last_row = out_x.row(h - 1);
+  // It is the last row of the output
   float scale = 1. / (n + h);
 
   float *out_cached_avg_ptr = out_cached_avg;
   for (int32_t c = 0; c < w; ++c) {
-    last_row[c] *= scale;
-    out_cached_avg_ptr[c] = last_row[c];
+    out_cached_avg_ptr[c] = sum[c] * scale;
   }
 
   out_cached_len[0] = n + h;
@@ -86,6 +202,69 @@ int32_t PoolingModuleNoProj::forward(const std::vector<ncnn::Mat> &bottom_blobs,
   return 0;
 }
 
+#if NCNN_VULKAN
+int32_t PoolingModuleNoProj::create_pipeline(const ncnn::Option &opt) {
+  if (!vkdev) return 0;
+
+  pipeline_poolingmodulenoproj =
+      CreateVulkanPipeline(vkdev, kPoolingModuleNoProjShader, opt, 64, 1, 1);
+
+  return pipeline_poolingmodulenoproj ? 0 : -100;
+}
+
+int32_t PoolingModuleNoProj::destroy_pipeline(const ncnn::Option & /*opt*/) {
+  delete pipeline_poolingmodulenoproj;
+  pipeline_poolingmodulenoproj = nullptr;
+
+  return 0;
+}
+
+int32_t PoolingModuleNoProj::forward(
+    const std::vector<ncnn::VkMat> &bottom_blobs,
+    std::vector<ncnn::VkMat> &top_blobs, ncnn::VkCompute &cmd,
+    const ncnn::Option &opt) const {
+  // support_packing is for the CPU. The shader works on unpacked blobs.
+  ncnn::VkMat x = bottom_blobs[0];
+  if (x.elempack != 1) {
+    vkdev->convert_packing(bottom_blobs[0], x, 1, cmd, opt);
+  }
+
+  const ncnn::VkMat &cached_len = bottom_blobs[1];
+  const ncnn::VkMat &cached_avg = bottom_blobs[2];
+
+  ncnn::VkMat &out_x = top_blobs[0];
+  out_x.create_like(x, opt.blob_vkallocator);
+
+  ncnn::VkMat &out_cached_len = top_blobs[1];
+  out_cached_len.create(cached_len.w, cached_len.elemsize, 1,
+                        opt.blob_vkallocator);
+
+  ncnn::VkMat &out_cached_avg = top_blobs[2];
+  out_cached_avg.create_like(cached_avg, opt.blob_vkallocator);
+
+  if (out_x.empty() || out_cached_len.empty() || out_cached_avg.empty()) {
+    return -100;
+  }
+
+  std::vector<ncnn::VkMat> bindings = {x,     cached_len,     cached_avg,
+                                       out_x, out_cached_len, out_cached_avg};
+
+  std::vector<ncnn::vk_constant_type> constants(2);
+  constants[0].i = x.w;
+  constants[1].i = x.h;
+
+  ncnn::VkMat dispatcher;
+  dispatcher.w = x.w;
+  dispatcher.h = 1;
+  dispatcher.c = 1;
+
+  cmd.record_pipeline(pipeline_poolingmodulenoproj, bindings, constants,
+                      dispatcher);
+
+  return 0;
+}
+#endif
+
 static ncnn::Layer *PoolingModuleNoProjCreator(void * /*userdata*/) {
   return new PoolingModuleNoProj();
 }
@@ -34,6 +34,20 @@ class PoolingModuleNoProj : public ncnn::Layer {
   int32_t forward(const std::vector<ncnn::Mat> &bottom_blobs,
                   std::vector<ncnn::Mat> &top_blobs,
                   const ncnn::Option &opt) const override;
+
+#if NCNN_VULKAN
+  int32_t create_pipeline(const ncnn::Option &opt) override;
+  int32_t destroy_pipeline(const ncnn::Option &opt) override;
+
+  int32_t forward(const std::vector<ncnn::VkMat> &bottom_blobs,
+                  std::vector<ncnn::VkMat> &top_blobs, ncnn::VkCompute &cmd,
+                  const ncnn::Option &opt) const override;
+#endif
+
+#if NCNN_VULKAN
+ private:
+  ncnn::Pipeline *pipeline_poolingmodulenoproj = nullptr;
+#endif
 };
 
 void RegisterPoolingModuleNoProjLayer(ncnn::Net &net);
@@ -19,20 +19,41 @@
 
 #include "sherpa-ncnn/csrc/recognizer.h"
 
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>  // NOLINT
+#include <cstdlib>
 #include <fstream>
+#include <future>  // NOLINT
+#include <limits>
 #include <memory>
+#include <mutex>  // NOLINT
+#include <sstream>
 #include <string>
+#include <thread>  // NOLINT
+#include <tuple>
 #include <utility>
 #include <vector>
 
 #include "sherpa-ncnn/csrc/context-graph.h"
+#include "sherpa-ncnn/csrc/decoder-cache.h"
 #include "sherpa-ncnn/csrc/decoder.h"
 #include "sherpa-ncnn/csrc/greedy-search-decoder.h"
+#include "sherpa-ncnn/csrc/hotwords.h"
+#include "sherpa-ncnn/csrc/joiner-blank-head.h"
+#include "sherpa-ncnn/csrc/joiner-projection.h"
+#include "sherpa-ncnn/csrc/joiner-shortlist.h"
+#include "sherpa-ncnn/csrc/macros.h"
+#include "sherpa-ncnn/csrc/metrics.h"
 #include "sherpa-ncnn/csrc/modified-beam-search-decoder.h"
+#include "sherpa-ncnn/csrc/ngram-lm.h"
+#include "sherpa-ncnn/csrc/session-recorder.h"
+#include "sherpa-ncnn/csrc/stream-pool.h"
+#include "sherpa-ncnn/csrc/stream-snapshot.h"
+#include "sherpa-ncnn/csrc/text-utils.h"
+#include "sherpa-ncnn/csrc/trace.h"
 
 #if __ANDROID_API__ >= 9
-#include <strstream>
-
 #include "android/asset_manager.h"
 #include "android/asset_manager_jni.h"
 #include "android/log.h"
@@ -42,20 +63,17 @@ namespace sherpa_ncnn {
 
 static RecognitionResult Convert(const DecoderResult &src,
                                  const SymbolTable &sym_table,
-                                 int32_t frame_shift_ms,
+                                 float frame_shift_ms,
                                  int32_t subsampling_factor) {
   RecognitionResult ans;
   ans.stokens.reserve(src.tokens.size());
   ans.timestamps.reserve(src.timestamps.size());
 
-  std::string text;
+  ans.text = sym_table.Join(src.tokens.data(), src.tokens.size());
   for (auto i : src.tokens) {
-    auto sym = sym_table[i];
-    text.append(sym);
-    ans.stokens.push_back(sym);
+    ans.stokens.emplace_back(sym_table[i]);
   }
 
-  ans.text = std::move(text);
   ans.tokens = src.tokens;
   float frame_shift_s = frame_shift_ms / 1000. * subsampling_factor;
   for (auto t : src.timestamps) {
@@ -88,23 +106,81 @@ std::string RecognizerConfig::ToString() const {
   os << "endpoint_config=" << endpoint_config.ToString() << ", ";
   os << "enable_endpoint=" << (enable_endpoint ? "True" : "False") << ", ";
   os << "hotwords_file=\"" << hotwords_file << "\", ";
-  os << "hotwrods_score=" << hotwords_score << ")";
+  os << "hotwrods_score=" << hotwords_score << ", ";
+  os << "enable_profiling=" << (enable_profiling ? "True" : "False") << ", ";
+  os << "fp16_states=" << (fp16_states ? "True" : "False") << ", ";
+  os << "pipeline_search=" << (pipeline_search ? "True" : "False") << ", ";
+  os << "publish_results=" << (publish_results ? "True" : "False") << ", ";
+  os << "stream_pool_size=" << stream_pool_size << ", ";
+  os << "memory_budget="
+     << (memory_budget ? std::to_string(memory_budget->Limit()) : "None")
+     << ")";
 
   return os.str();
 }
 
+// Tokens come from the bundle of the model if it has one. They are used in
+// place, so the symbol table keeps the model alive.
+static SymbolTable CreateSymbolTable(const ModelConfig &config,
+                                     const std::shared_ptr<Model> &model) {
+  const ModelBundle *bundle = model ? model->GetBundle() : nullptr;
+  if (!bundle) {
+    return SymbolTable(config.tokens);
+  }
+
+  std::size_t size = 0;
+  const unsigned char *data = bundle->GetSection("tokens", &size);
+  if (!data && config.buffers && !config.tokens.empty()) {
+    return SymbolTable(config.tokens);
+  }
+
+  if (!data) {
+    NCNN_LOGE("There are no tokens in the model bundle %s",
+              config.bundle.c_str());
+    exit(-1);
+  }
+
+  return SymbolTable(data, size, model);
+}
+
 class Recognizer::Impl {
  public:
   explicit Impl(const RecognizerConfig &config)
+      : Impl(config, Model::Create(config.model_config)) {
+    InitEncoderVariants();
+  }
+
+  Impl(const RecognizerConfig &config, std::shared_ptr<Model> model)
       : config_(config),
-        model_(Model::Create(config.model_config)),
+        model_(std::move(model)),
         endpoint_(config.endpoint_config),
-        sym_(config.model_config.tokens) {
+        sym_(CreateSymbolTable(config.model_config, model_)) {
+    if (!model_) {
+      // The caller can detect it with GetModel()
+      NCNN_LOGE("No model is given!");
+      return;
+    }
+
+    encoders_.push_back(model_);
+    InitDecoderCache();
+    InitLatencyStats();
+
     if (config.decoder_config.method == "greedy_search") {
-      decoder_ = std::make_unique<GreedySearchDecoder>(model_.get());
+      InitBlankHead();
+      decoder_ = std::make_unique<GreedySearchDecoder>(
+          model_.get(), decoder_cache_.get(), blank_head_.get(),
+          config.decoder_config.speculative_joiner);
     } else if (config.decoder_config.method == "modified_beam_search") {
+      InitShortlist();
+      InitLm();
+      projection_ = JoinerProjection::Create(model_.get());
       decoder_ = std::make_unique<ModifiedBeamSearchDecoder>(
-          model_.get(), config.decoder_config.num_active_paths);
+          model_.get(), config.decoder_config.num_active_paths,
+          decoder_cache_.get(), shortlist_.get(), projection_.get(),
+          lm_.get(), config.decoder_config.lm_scale,
+          config.decoder_config.beam, config.decoder_config.min_active_paths,
+          config.decoder_config.hotwords_before_topk);
+      InitGreedyDecoder();
 
       if (!config_.hotwords_file.empty()) {
         InitHotwords();
@@ -117,15 +193,42 @@ class Recognizer::Impl {
 
 #if __ANDROID_API__ >= 9
   Impl(AAssetManager *mgr, const RecognizerConfig &config)
+      : Impl(mgr, config, Model::Create(mgr, config.model_config)) {}
+
+  Impl(AAssetManager *mgr, const RecognizerConfig &config,
+       std::shared_ptr<Model> model)
       : config_(config),
-        model_(Model::Create(mgr, config.model_config)),
+        model_(std::move(model)),
         endpoint_(config.endpoint_config),
-        sym_(mgr, config.model_config.tokens) {
+        sym_(config.model_config.buffers
+                 ? CreateSymbolTable(config.model_config, model_)
+                 : SymbolTable(mgr, config.model_config.tokens)) {
+    if (!model_) {
+      // The caller can detect it with GetModel()
+      NCNN_LOGE("No model is given!");
+      return;
+    }
+
+    encoders_.push_back(model_);
+    InitDecoderCache();
+    InitLatencyStats();
+
     if (config.decoder_config.method == "greedy_search") {
-      decoder_ = std::make_unique<GreedySearchDecoder>(model_.get());
+      InitBlankHead();
+      decoder_ = std::make_unique<GreedySearchDecoder>(
+          model_.get(), decoder_cache_.get(), blank_head_.get(),
+          config.decoder_config.speculative_joiner);
     } else if (config.decoder_config.method == "modified_beam_search") {
+      InitShortlist();
+      InitLm();
+      projection_ = JoinerProjection::Create(model_.get());
       decoder_ = std::make_unique<ModifiedBeamSearchDecoder>(
-          model_.get(), config.decoder_config.num_active_paths);
+          model_.get(), config.decoder_config.num_active_paths,
+          decoder_cache_.get(), shortlist_.get(), projection_.get(),
+          lm_.get(), config.decoder_config.lm_scale,
+          config.decoder_config.beam, config.decoder_config.min_active_paths,
+          config.decoder_config.hotwords_before_topk);
+      InitGreedyDecoder();
 
       if (!config_.hotwords_file.empty()) {
         InitHotwords(mgr);
@@ -138,83 +241,594 @@ class Recognizer::Impl {
 #endif
 
   std::unique_ptr<Stream> CreateStream() const {
-    if (hotwords_.empty()) {
-      auto stream = std::make_unique<Stream>(config_.feat_config);
-      stream->SetResult(decoder_->GetEmptyResult());
-      stream->SetStates(model_->GetEncoderInitStates());
-      return stream;
+    return CreateStream(context_graph_);
+  }
+
+  std::unique_ptr<Stream> CreateStream(ContextGraphPtr context_graph,
+                                       int32_t encoder_index = 0) const {
+    std::unique_ptr<MemoryReservation> reservation;
+    if (config_.memory_budget) {
+      std::size_t n = StreamBytes(*encoders_[encoder_index]);
+      reservation = MemoryReservation::Create(config_.memory_budget, n);
+      if (!reservation) {
+        NCNN_LOGE("Cannot create a stream of %zu bytes: %zu of %zu bytes of "
+                  "the memory budget are used",
+                  n, config_.memory_budget->Used(),
+                  config_.memory_budget->Limit());
+        return nullptr;
+      }
+    }
+
+    std::unique_ptr<Stream> stream = pool_.Take(encoder_index, context_graph);
+    if (!stream) {
+      stream = std::make_unique<Stream>(config_.feat_config, context_graph);
+    }
+
+    stream->SetMemoryReservation(std::move(reservation));
+    stream->SetEncoderIndex(encoder_index);
+    if (latency_stats_) {
+      stream->EnableLatencyStats(latency_stats_);
+    }
+
+    auto r = decoder_->GetEmptyResult();
+    if (context_graph) {
+      // r.hyps has only one element.
+      for (auto it = r.hyps.begin(); it != r.hyps.end(); ++it) {
+        it->context_state = context_graph->Root();
+      }
+    }
+
+    const Model &encoder = *encoders_[encoder_index];
+    stream->SetResult(r);
+
+    const auto &init_states = encoder.GetPackedEncoderInitStates();
+    if (!init_states.empty()) {
+      stream->SetStates(init_states, encoder.GetEncoderStateLayout());
     } else {
-      auto r = decoder_->GetEmptyResult();
+      stream->SetStates(encoder.GetEncoderInitStates(),
+                        encoder.GetEncoderStateLayout());
+    }
 
-      auto context_graph =
-          std::make_shared<ContextGraph>(hotwords_, config_.hotwords_score);
+    return stream;
+  }
 
-      auto stream =
-          std::make_unique<Stream>(config_.feat_config, context_graph);
+  void RecycleStream(std::unique_ptr<Stream> s) const {
+    pool_.Put(std::move(s));
+  }
 
-      if (stream->GetContextGraph()) {
-        // r.hyps has only one element.
-        for (auto it = r.hyps.begin(); it != r.hyps.end(); ++it) {
-          it->second.context_state = stream->GetContextGraph()->Root();
-        }
+  std::unique_ptr<Stream> CreateStreamWithChunkSize(
+      int32_t chunk_size, ContextGraphPtr context_graph) const {
+    // Use the encoder with the closest chunk size
+    int32_t best = 0;
+    for (int32_t i = 1; i != static_cast<int32_t>(encoders_.size()); ++i) {
+      if (std::abs(encoders_[i]->Offset() - chunk_size) <
+          std::abs(encoders_[best]->Offset() - chunk_size)) {
+        best = i;
       }
+    }
+
+    return CreateStream(std::move(context_graph), best);
+  }
+
+  std::unique_ptr<Stream> CreateStreamWithChunkSize(int32_t chunk_size) const {
+    return CreateStreamWithChunkSize(chunk_size, context_graph_);
+  }
 
-      stream->SetResult(r);
-      stream->SetStates(model_->GetEncoderInitStates());
+  std::vector<int32_t> GetChunkSizes() const {
+    std::vector<int32_t> ans;
+    ans.reserve(encoders_.size());
+    for (const auto &e : encoders_) {
+      ans.push_back(e->Offset());
+    }
+    return ans;
+  }
+
+  ContextGraphPtr CreateContextGraph(const std::string &hotwords) const {
+    if (hotwords.empty()) return nullptr;
 
-      return stream;
+    ContextGraphPtr ans = context_graph_cache_.Get(hotwords);
+    if (ans) return ans;
+
+    // Two threads may build the same graph at the same time. Both graphs
+    // are valid and the cache keeps the last one.
+    std::istringstream is(hotwords);
+    ans = sherpa_ncnn::CreateContextGraph(is, sym_, config_.hotwords_score);
+    if (ans) {
+      context_graph_cache_.Put(hotwords, ans);
     }
+
+    return ans;
   }
 
   bool IsReady(Stream *s) const {
-    return s->GetNumProcessedFrames() + model_->Segment() < s->NumFramesReady();
+    return s->GetNumProcessedFrames() + GetEncoder(s)->Segment() <
+           s->NumFramesReady();
   }
 
-  void DecodeStream(Stream *s) const {
-    int32_t segment = model_->Segment();
-    int32_t offset = model_->Offset();
+  // True if InputFinished() was called for s and not all of its frames
+  // are decoded
+  static bool HasRemainingFrames(Stream *s) {
+    int32_t num_frames = s->NumFramesReady();
+    return s->GetNumProcessedFrames() < num_frames &&
+           s->IsLastFrame(num_frames - 1);
+  }
 
-    ncnn::Mat features = s->GetFrames(s->GetNumProcessedFrames(), segment);
-    s->GetNumProcessedFrames() += offset;
-    std::vector<ncnn::Mat> states = s->GetStates();
+  // Return the segment frames of the next chunk of s. Frames after the
+  // last one, which are only needed for the last chunk in
+  // DecodeRemainingFrames(), are the features of silence, i.e., the
+  // floor of the log mel energies.
+  static ncnn::Mat GetChunkFrames(Stream *s, int32_t segment) {
+    int32_t start = s->GetNumProcessedFrames();
+    int32_t n = std::min(segment, s->NumFramesReady() - start);
+    if (n == segment) {
+      return s->GetFrames(start, segment);
+    }
 
-    ncnn::Mat encoder_out;
-    std::tie(encoder_out, states) = model_->RunEncoder(features, states);
+    ncnn::Mat frames = s->GetFrames(start, n);
 
-    if (s->GetContextGraph()) {
-      decoder_->Decode(encoder_out, s, &s->GetResult());
-    } else {
-      decoder_->Decode(encoder_out, &s->GetResult());
+    ncnn::Mat ans;
+    ans.create(frames.w, segment);
+
+    const float *src = frames;
+    float *dst = ans;
+    std::copy(src, src + n * frames.w, dst);
+    std::fill(dst + n * frames.w, dst + segment * frames.w,
+              std::log(std::numeric_limits<float>::epsilon()));
+
+    return ans;
+  }
+
+  // The encoder output of one chunk of each of the streams
+  struct EncodedChunks {
+    std::vector<Stream *> ss;
+    std::vector<ncnn::Mat> encoder_out;
+
+    // The share of each stream of the encoder time and the seconds of
+    // audio of a chunk, for MetricHistogram::kChunkRealTimeFactor
+    double encoder_ms = 0;
+    float chunk_seconds = 0;
+  };
+
+  // Runs the searches of the pipelined rounds of DecodeReadyStreams() on
+  // one thread, one round at a time and in order
+  class SearchWorker {
+   public:
+    explicit SearchWorker(const Impl *impl)
+        : impl_(impl), thread_([this]() { Run(); }) {}
+
+    ~SearchWorker() {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+      }
+      cv_.notify_all();
+      thread_.join();
+    }
+
+    // Wait until the previous round is searched and start the search of
+    // chunks
+    void Submit(std::vector<EncodedChunks> chunks) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this]() { return !busy_; });
+      chunks_ = std::move(chunks);
+      busy_ = true;
+      lock.unlock();
+      cv_.notify_all();
+    }
+
+    // Wait until the last submitted round is searched
+    void Wait() {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this]() { return !busy_; });
+    }
+
+   private:
+    void Run() {
+      std::unique_lock<std::mutex> lock(mutex_);
+      while (true) {
+        cv_.wait(lock, [this]() { return busy_ || stop_; });
+        if (!busy_) break;
+
+        std::vector<EncodedChunks> chunks = std::move(chunks_);
+        lock.unlock();
+
+        for (auto &c : chunks) {
+          impl_->RunSearch(&c);
+        }
+
+        lock.lock();
+        busy_ = false;
+        cv_.notify_all();
+      }
+    }
+
+   private:
+    const Impl *impl_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+
+    // Set by Submit() and cleared by Run() after the search
+    bool busy_ = false;
+    bool stop_ = false;
+    std::vector<EncodedChunks> chunks_;
+
+    // Last, so that it starts after the other members are initialized
+    std::thread thread_;
+  };
+
+  void DecodeStreams(Stream **ss, int32_t n) const {
+    for (auto &c : RunEncoders(ss, n)) {
+      RunSearch(&c);
     }
-    s->SetStates(states);
+  }
+
+  // Run the encoders for a chunk of each stream. The encoder states of
+  // the streams are advanced, but their results are not.
+  std::vector<EncodedChunks> RunEncoders(Stream **ss, int32_t n) const {
+    std::vector<EncodedChunks> ans;
+    if (encoders_.size() == 1) {
+      ans.push_back(RunEncoder(ss, n, model_.get()));
+      return ans;
+    }
+
+    // Streams of different encoders cannot share a batch
+    std::vector<std::vector<Stream *>> groups(encoders_.size());
+    for (int32_t i = 0; i != n; ++i) {
+      groups[ss[i]->GetEncoderIndex()].push_back(ss[i]);
+    }
+
+    for (std::size_t i = 0; i != groups.size(); ++i) {
+      if (!groups[i].empty()) {
+        ans.push_back(RunEncoder(groups[i].data(), groups[i].size(),
+                                 encoders_[i].get()));
+      }
+    }
+
+    return ans;
+  }
+
+  // All streams use the given encoder
+  EncodedChunks RunEncoder(Stream **ss, int32_t n, Model *encoder) const {
+    int32_t segment = encoder->Segment();
+    int32_t offset = encoder->Offset();
+
+    // As with the encoder, each stream is charged an equal share of the
+    // batched fbank computation
+    double fbank_ms = 0;
+    if (config_.feat_config.use_batch_fbank) {
+      auto fbank_start = StageClock::now();
+      TraceSpan span("batch_fbank");
+      Stream::ComputeFeatures(ss, n);
+      fbank_ms = ElapsedMs(fbank_start) / n;
+    }
+
+    std::vector<ncnn::Mat> features(n);
+    std::vector<int32_t> start_frames(n);
+    std::vector<const std::vector<ncnn::Mat> *> states(n);
+    std::vector<std::vector<ncnn::Mat> *> next_states(n);
+    std::vector<std::unique_ptr<DeviceStates> *> device_states(n);
+    for (int32_t i = 0; i != n; ++i) {
+      Stream *s = ss[i];
+      {
+        TraceStreamScope trace_scope(s->GetId());
+        ProfileScope scope(s->GetLatencyStats(), s->GetParentLatencyStats());
+        scope.Add(Stage::kFeatureExtraction, fbank_ms);
+        ScopedStageTimer timer(Stage::kFeatureExtraction);
+        features[i] = GetChunkFrames(s, segment);
+      }
+      start_frames[i] = s->GetNumProcessedFrames();
+      s->GetNumProcessedFrames() += offset;
+      states[i] = &s->GetStates();
+      next_states[i] = &s->GetNextStates();
+      device_states[i] = &s->GetDeviceStates();
+    }
+
+    auto start = StageClock::now();
+
+    EncodedChunks ans;
+    ans.ss.assign(ss, ss + n);
+    {
+      // The batch has no single stream
+      TraceSpan span(GetStageName(Stage::kEncoder));
+      ans.encoder_out = encoder->RunEncoderBatch(features, states,
+                                                 next_states, device_states);
+    }
+
+    // The encoder runs once for all streams, so each stream is charged
+    // an equal share
+    double encoder_ms = ElapsedMs(start) / n;
+    ans.encoder_ms = encoder_ms;
+    ans.chunk_seconds = offset * config_.feat_config.frame_shift_ms / 1000;
+    for (int32_t i = 0; i != n; ++i) {
+      Stream *s = ss[i];
+      {
+        ProfileScope scope(s->GetLatencyStats(), s->GetParentLatencyStats());
+        scope.Add(Stage::kEncoder, encoder_ms);
+      }
+
+      // The search does not use the states
+      s->SwapStates();
+      if (config_.fp16_states) {
+        s->CompactStates();
+      }
+    }
+
+    RunEncoderTaps(ans, features, start_frames, offset);
+
+    return ans;
+  }
+
+  // Pass the chunks of c to the taps of the recognizer and of the streams
+  void RunEncoderTaps(const EncodedChunks &c,
+                      const std::vector<ncnn::Mat> &features,
+                      const std::vector<int32_t> &start_frames,
+                      int32_t offset) const {
+    auto taps = encoder_taps_.Get();
+
+    for (std::size_t i = 0; i != c.ss.size(); ++i) {
+      Stream *s = c.ss[i];
+      const EncoderTap &stream_tap = s->GetEncoderTap();
+      if (!taps && !stream_tap) continue;
+
+      EncoderChunk chunk;
+      chunk.stream_id = s->GetId();
+      chunk.start_frame = start_frames[i];
+      chunk.num_frames = offset;
+      chunk.encoder_out = c.encoder_out[i];
+
+      // The mats are shared, so the chunk with features costs nothing
+      EncoderChunk chunk_with_features = chunk;
+      chunk_with_features.features = features[i];
+
+      if (taps) {
+        for (const auto &e : *taps) {
+          e.tap(e.with_features ? chunk_with_features : chunk);
+        }
+      }
+
+      if (stream_tap) {
+        stream_tap(s->EncoderTapWithFeatures() ? chunk_with_features
+                                               : chunk);
+      }
+    }
+  }
+
+  int32_t AddEncoderTap(EncoderTap tap, bool with_features) {
+    return encoder_taps_.Add(std::move(tap), with_features);
+  }
+
+  bool RemoveEncoderTap(int32_t id) { return encoder_taps_.Remove(id); }
+
+  // Extend the results of the streams with their encoder output
+  void RunSearch(EncodedChunks *c) const {
+    // Streams decoded with greedy search are searched together, so that
+    // the joiner runs once per frame for all of them. Greedy search does
+    // not use hotwords.
+    std::vector<int32_t> greedy;
+    for (std::size_t i = 0; i != c->ss.size(); ++i) {
+      if (IsGreedySearch(c->ss[i])) {
+        greedy.push_back(static_cast<int32_t>(i));
+      } else {
+        RunSearch(c, static_cast<int32_t>(i));
+      }
+    }
+
+    if (greedy.size() == 1) {
+      RunSearch(c, greedy[0]);
+    } else if (!greedy.empty()) {
+      RunSearchBatch(c, greedy);
+    }
+
+    if (config_.publish_results) {
+      for (Stream *s : c->ss) {
+        PublishResult(s);
+      }
+    }
+  }
+
+  // Convert the current result of s for GetResultSnapshot()
+  void PublishResult(Stream *s) const {
+    DecoderResult decoder_result = s->GetResult();
+    GetDecoder(s)->StripLeadingBlanks(&decoder_result);
+
+    s->PublishResult(std::make_shared<const RecognitionResult>(
+        Convert(decoder_result, sym_, config_.feat_config.frame_shift_ms,
+                GetEncoder(s)->SubsamplingFactor())));
+  }
+
+  // Extend the result of stream c->ss[i]
+  void RunSearch(EncodedChunks *c, int32_t i) const {
+    Stream *s = c->ss[i];
+    TraceStreamScope trace_scope(s->GetId());
+    ProfileScope scope(s->GetLatencyStats(), s->GetParentLatencyStats());
+    auto decode_start = StageClock::now();
+
+    {
+      // The decoder and joiner runs are nested spans
+      TraceSpan span(GetStageName(Stage::kSearch));
+
+      // Greedy search does not use hotwords
+      Decoder *decoder = GetDecoder(s);
+      if (s->GetContextGraph() && decoder == decoder_.get()) {
+        decoder->Decode(c->encoder_out[i], s, &s->GetResult());
+      } else {
+        decoder->Decode(c->encoder_out[i], &s->GetResult());
+      }
+    }
+
+    if (ProfileScope::Current()) {
+      scope.Add(Stage::kSearch, ElapsedMs(decode_start) -
+                                    scope.Total(Stage::kDecoder) -
+                                    scope.Total(Stage::kJoiner));
+    }
+
+    Metrics::Add(MetricCounter::kChunksDecoded);
+    if (Metrics::Enabled()) {
+      double seconds = (c->encoder_ms + ElapsedMs(decode_start)) / 1000;
+      Metrics::Observe(MetricHistogram::kChunkRealTimeFactor,
+                       seconds / c->chunk_seconds);
+    }
+  }
+
+  // Extend the results of the streams c->ss[i] for i in indexes, which
+  // use the same decoder, with one call of Decoder::DecodeBatch()
+  void RunSearchBatch(EncodedChunks *c,
+                      const std::vector<int32_t> &indexes) const {
+    int32_t n = static_cast<int32_t>(indexes.size());
+    std::vector<ncnn::Mat> encoder_out(n);
+    std::vector<DecoderResult *> results(n);
+    for (int32_t k = 0; k != n; ++k) {
+      encoder_out[k] = c->encoder_out[indexes[k]];
+      results[k] = &c->ss[indexes[k]]->GetResult();
+    }
+
+    auto decode_start = StageClock::now();
+    {
+      TraceSpan span(GetStageName(Stage::kSearch));
+      GetDecoder(c->ss[indexes[0]])
+          ->DecodeBatch(encoder_out.data(), results.data(), n);
+    }
+
+    // As with the encoder, each stream is charged an equal share. The
+    // decoder and joiner runs are shared, so they are not split out of
+    // the search.
+    double search_ms = ElapsedMs(decode_start) / n;
+    for (int32_t i : indexes) {
+      Stream *s = c->ss[i];
+      {
+        ProfileScope scope(s->GetLatencyStats(), s->GetParentLatencyStats());
+        scope.Add(Stage::kSearch, search_ms);
+      }
+
+      Metrics::Add(MetricCounter::kChunksDecoded);
+      if (Metrics::Enabled()) {
+        double seconds = (c->encoder_ms + search_ms) / 1000;
+        Metrics::Observe(MetricHistogram::kChunkRealTimeFactor,
+                         seconds / c->chunk_seconds);
+      }
+    }
+  }
+
+  int32_t DecodeRemainingFrames(Stream **ss, int32_t n) const {
+    std::vector<Stream *> pending;
+    pending.reserve(n);
+
+    int32_t num_chunks = 0;
+    while (true) {
+      pending.clear();
+      for (int32_t i = 0; i != n; ++i) {
+        if (IsReady(ss[i]) || HasRemainingFrames(ss[i])) {
+          pending.push_back(ss[i]);
+        }
+      }
+
+      if (pending.empty()) break;
+      num_chunks += pending.size();
+
+      DecodeStreams(pending.data(), pending.size());
+    }
+
+    // The last chunk of a finished stream ends with padding, which is not
+    // counted as processed
+    for (int32_t i = 0; i != n; ++i) {
+      int32_t num_frames = ss[i]->NumFramesReady();
+      if (ss[i]->GetNumProcessedFrames() > num_frames) {
+        ss[i]->GetNumProcessedFrames() = num_frames;
+      }
+    }
+
+    return num_chunks;
+  }
+
+  int32_t DecodeReadyStreams(Stream **ss, int32_t n) const {
+    std::vector<Stream *> ready;
+    ready.reserve(n);
+
+    // Whether a stream is at an endpoint depends on the search of its
+    // last chunk, so its next chunk cannot be encoded before that
+    bool pipeline = config_.pipeline_search && !config_.enable_endpoint;
+
+    // Started at the first round and kept for all of the rounds of this
+    // call, so that a round costs a handoff instead of a thread
+    std::unique_ptr<SearchWorker> worker;
+
+    int32_t num_chunks = 0;
+    while (true) {
+      ready.clear();
+      for (int32_t i = 0; i != n; ++i) {
+        if (IsReady(ss[i]) && !IsEndpoint(ss[i])) {
+          ready.push_back(ss[i]);
+        }
+      }
+
+      if (ready.empty()) break;
+      num_chunks += ready.size();
+
+      if (!pipeline) {
+        DecodeStreams(ready.data(), ready.size());
+        continue;
+      }
+
+      // The encoder of a stream does not depend on its search, so this
+      // round is encoded while the previous round is searched. The
+      // searches of a stream still run in order.
+      std::vector<EncodedChunks> chunks =
+          RunEncoders(ready.data(), ready.size());
+
+      if (!worker) {
+        worker = std::make_unique<SearchWorker>(this);
+      }
+
+      worker->Submit(std::move(chunks));
+    }
+
+    if (worker) {
+      // Wait for the search of the last round
+      worker->Wait();
+    }
+
+    return num_chunks;
   }
 
   bool IsEndpoint(Stream *s) const {
     if (!config_.enable_endpoint) return false;
     int32_t num_processed_frames = s->GetNumProcessedFrames();
 
-    // frame shift is 10 milliseconds
-    float frame_shift_in_seconds = 0.01;
+    float frame_shift_in_seconds = config_.feat_config.frame_shift_ms / 1000;
+
+    if (s->HasSpeechProbability()) {
+      // Use the voice activity detector of the stream
+      int32_t num_frames = s->GetVadDuration() / frame_shift_in_seconds;
+      int32_t trailing_silence_frames =
+          s->GetVadTrailingSilence() / frame_shift_in_seconds;
+
+      return endpoint_.IsEndpoint(num_frames, trailing_silence_frames,
+                                  frame_shift_in_seconds);
+    }
 
-    // subsampling factor is 4
-    int32_t trailing_silence_frames = s->GetResult().num_trailing_blanks * 4;
+    int32_t trailing_silence_frames =
+        s->GetResult().num_trailing_blanks * GetEncoder(s)->SubsamplingFactor();
 
     return endpoint_.IsEndpoint(num_processed_frames, trailing_silence_frames,
                                 frame_shift_in_seconds);
   }
 
   void Reset(Stream *s) const {
-    auto r = decoder_->GetEmptyResult();
+    if (Metrics::Enabled() && IsEndpoint(s)) {
+      Metrics::Add(MetricCounter::kEndpoints);
+    }
+
+    // Caution: We need to keep the decoder output state. It is reset in
+    // place so that no memory is allocated for each endpoint.
+    DecoderResult &r = s->GetResult();
+    GetDecoder(s)->ResetResult(&r);
 
     if (s->GetContextGraph()) {
-      for (auto it = r.hyps.begin(); it != r.hyps.end(); ++it) {
-        it->second.context_state = s->GetContextGraph()->Root();
+      for (auto &hyp : r.hyps) {
+        hyp.context_state = s->GetContextGraph()->Root();
       }
     }
-    // Caution: We need to keep the decoder output state
-    ncnn::Mat decoder_out = s->GetResult().decoder_out;
-    s->SetResult(r);
-    s->GetResult().decoder_out = decoder_out;
 
     // don't reset encoder state
     // s->SetStates(model_->GetEncoderInitStates());
@@ -223,6 +837,10 @@ class Recognizer::Impl {
     // Note: We only reset the counter. The underlying audio samples are
     // still kept in memory
     s->Reset();
+
+    if (config_.publish_results) {
+      PublishResult(s);
+    }
   }
 
   RecognitionResult GetResult(Stream *s) const {
@@ -231,92 +849,333 @@ class Recognizer::Impl {
     }
     DecoderResult decoder_result = s->GetResult();
 
-    decoder_->StripLeadingBlanks(&decoder_result);
+    GetDecoder(s)->StripLeadingBlanks(&decoder_result);
+
+    return Convert(decoder_result, sym_, config_.feat_config.frame_shift_ms,
+                   GetEncoder(s)->SubsamplingFactor());
+  }
+
+  RecognitionResultUpdate GetResultUpdate(Stream *s) const {
+    if (IsEndpoint(s)) {
+      s->Finalize();
+    }
+
+    const DecoderResult &r = s->GetResult();
+    ResultCursor &c = s->GetResultCursor();
+    int32_t context_size = model_->ContextSize();
+
+    float frame_shift_s = config_.feat_config.frame_shift_ms / 1000. *
+                          GetEncoder(s)->SubsamplingFactor();
+
+    int32_t num_prev_tokens = c.reset ? 0 : c.num_tokens;
+
+    RecognitionResultUpdate ans;
+    if (r.hyps.Size() == 0) {
+      // greedy_search only appends tokens
+      int32_t num_tokens =
+          static_cast<int32_t>(r.tokens.size()) - context_size;
+      ans.start = std::min(num_prev_tokens, num_tokens);
+      ans.num_stable = num_tokens;
+
+      for (int32_t i = ans.start; i < num_tokens; ++i) {
+        ans.tokens.push_back(r.tokens[i + context_size]);
+        ans.timestamps.push_back(frame_shift_s * r.timestamps[i]);
+      }
+    } else {
+      Hypothesis best = r.hyps.GetMostProbable(true);
+      const TokenNode *prev = c.reset ? nullptr : c.tail.get();
+      const TokenNode *common = CommonPrefix(best.tail.get(), prev);
+      ans.start = std::max(Length(common) - context_size, 0);
+
+      // Tokens that all hypotheses agree on
+      const TokenNode *stable = best.tail.get();
+      for (const auto &h : r.hyps) {
+        stable = CommonPrefix(stable, h.tail.get());
+      }
+      ans.num_stable = std::max(Length(stable) - context_size, 0);
+
+      for (const TokenNode *p = best.tail.get(); p != common;
+           p = p->prev.get()) {
+        if (p->length <= context_size) break;
+
+        ans.tokens.push_back(p->token);
+        ans.timestamps.push_back(frame_shift_s * p->timestamp);
+      }
+      std::reverse(ans.tokens.begin(), ans.tokens.end());
+      std::reverse(ans.timestamps.begin(), ans.timestamps.end());
+
+      c.tail = std::move(best.tail);
+    }
+
+    ans.text = sym_.Join(ans.tokens.data(), ans.tokens.size());
+    ans.stokens.reserve(ans.tokens.size());
+    for (auto i : ans.tokens) {
+      ans.stokens.emplace_back(sym_[i]);
+    }
+
+    int32_t num_tokens = ans.start + static_cast<int32_t>(ans.tokens.size());
+    if (ans.start != c.num_tokens || num_tokens != c.num_tokens) {
+      ++c.revision;
+    }
+
+    c.num_tokens = num_tokens;
+    c.reset = false;
+    ans.revision = c.revision;
 
-    // Those 2 parameters are figured out from sherpa source code
-    int32_t frame_shift_ms = 10;
-    int32_t subsampling_factor = 4;
-    return Convert(decoder_result, sym_, frame_shift_ms, subsampling_factor);
+    return ans;
   }
 
+  void SetGreedySearch(Stream *s, bool greedy) const {
+    if (!greedy_decoder_ || IsGreedySearch(s) == greedy) return;
+
+    const DecoderResult &r = s->GetResult();
+    int32_t context_size = model_->ContextSize();
+
+    DecoderResult ans;
+    if (greedy) {
+      Hypothesis best = r.hyps.GetMostProbable(true);
+      ans.tokens = best.Ys();
+      ans.timestamps = best.Timestamps();
+    } else {
+      // The best path so far is the only path. The LM starts over.
+      ans = decoder_->GetEmptyResult();
+      Hypothesis &h = *ans.hyps.begin();
+      if (s->GetContextGraph()) {
+        h.context_state = s->GetContextGraph()->Root();
+      }
+
+      for (int32_t i = context_size; i < static_cast<int32_t>(r.tokens.size());
+           ++i) {
+        h.AddToken(r.tokens[i], r.timestamps[i - context_size]);
+      }
+      h.num_trailing_blanks = r.num_trailing_blanks;
+    }
+
+    // r.decoder_out is not kept, since the cached decoder output of one
+    // decoder is not valid for the other
+    ans.num_trailing_blanks = r.num_trailing_blanks;
+    s->SetResult(ans);
+  }
+
+  bool IsGreedySearch(Stream *s) const {
+    return config_.decoder_config.method == "greedy_search" ||
+           GetDecoder(s) == greedy_decoder_.get();
+  }
+
+  bool RestoreStream(const void *data, std::size_t size, Stream *s) const {
+    return RestoreStreamState(data, size, *GetEncoder(s),
+                              config_.feat_config.feature_dim, s);
+  }
+
+  void WarmUp() const {
+    for (const auto &e : encoders_) {
+      e->WarmUp();
+    }
+  }
+
+  const RecognizerConfig &GetConfig() const { return config_; }
+
   const Model *GetModel() const { return model_.get(); }
 
+  std::shared_ptr<Model> GetSharedModel() const { return model_; }
+
+  const DecoderCache *GetDecoderCache() const { return decoder_cache_.get(); }
+
+  const LatencyStats *GetLatencyStats() const { return latency_stats_.get(); }
+
  private:
-#if __ANDROID_API__ >= 9
-  void InitHotwords(AAssetManager *mgr) {
-    AAsset *asset = AAssetManager_open(mgr, config_.hotwords_file.c_str(),
-                                       AASSET_MODE_BUFFER);
-    if (!asset) {
-      __android_log_print(ANDROID_LOG_FATAL, "sherpa-ncnn",
-                          "hotwords_file: Load %s failed",
-                          config_.hotwords_file.c_str());
-      exit(-1);
+  static int32_t Length(const TokenNode *p) { return p ? p->length : 0; }
+
+  // Return the last node that the paths ending at a and b share. It costs
+  // the number of nodes after it.
+  static const TokenNode *CommonPrefix(const TokenNode *a,
+                                       const TokenNode *b) {
+    while (a != b) {
+      if (Length(a) >= Length(b)) {
+        a = a->prev.get();
+      } else {
+        b = b->prev.get();
+      }
     }
 
-    auto p = reinterpret_cast<const char *>(AAsset_getBuffer(asset));
-    size_t asset_length = AAsset_getLength(asset);
-    std::istrstream is(p, asset_length);
-    InitHotwords(is);
-    AAsset_close(asset);
+    return a;
   }
-#endif
 
-  void InitHotwords() {
-    // each line in hotwords_file contains space-separated words
+  // The memory a stream of the given encoder reserves from
+  // RecognizerConfig::memory_budget
+  std::size_t StreamBytes(const Model &encoder) const {
+    std::size_t states = encoder.GetEncoderStateLayout().NumBytes();
+    if (states == 0) {
+      for (const auto &m : encoder.GetEncoderInitStates()) {
+        states += m.total() * m.elemsize;
+      }
+    }
 
-    std::ifstream is(config_.hotwords_file);
-    if (!is) {
-      NCNN_LOGE("Open hotwords file failed: %s", config_.hotwords_file.c_str());
-      exit(-1);
+    std::size_t features = static_cast<std::size_t>(encoder.Segment()) *
+                           config_.feat_config.feature_dim * sizeof(float);
+
+    return 2 * states + features;
+  }
+
+  Model *GetEncoder(Stream *s) const {
+    return encoders_[s->GetEncoderIndex()].get();
+  }
+
+  // Load the encoders of ModelConfig::encoder_variants. They are loaded as
+  // complete models, but only their encoders are run.
+  void InitEncoderVariants() {
+    if (!model_) return;
+
+    for (const auto &v : config_.model_config.encoder_variants) {
+      ModelConfig c = config_.model_config;
+      c.encoder_param = v.param;
+      c.encoder_bin = v.bin;
+      c.encoder_variants.clear();
+
+      // The server runs only the main encoder
+      c.remote_encoder.clear();
+
+      std::shared_ptr<Model> m = Model::Create(c);
+      if (!m) {
+        NCNN_LOGE("Failed to load the encoder %s", v.param.c_str());
+        exit(-1);
+      }
+
+      encoders_.push_back(std::move(m));
     }
+  }
+
+  void InitDecoderCache() {
+    if (config_.decoder_config.decoder_cache_size > 0) {
+      decoder_cache_ = std::make_unique<DecoderCache>(
+          config_.decoder_config.decoder_cache_size, model_->ContextSize());
+    }
+  }
 
-    InitHotwords(is);
+  void InitLatencyStats() {
+    if (config_.enable_profiling) {
+      latency_stats_ = std::make_shared<LatencyStats>();
+    }
   }
 
-  void InitHotwords(std::istream &is) {
-    std::vector<int32_t> tmp;
+  void InitBlankHead() {
+    if (config_.decoder_config.blank_skip_threshold > 0) {
+      blank_head_ = JoinerBlankHead::Create(
+          model_.get(), config_.decoder_config.blank_skip_threshold);
+    }
+  }
+
+  void InitShortlist() {
+    const std::string &filename = config_.decoder_config.token_shortlist;
+    if (filename.empty()) return;
+
+    std::ifstream is(filename);
+    if (!is) {
+      NCNN_LOGE("Failed to open the token shortlist %s", filename.c_str());
+      exit(-1);
+    }
+
+    // The first field of each line is the token, so a subset of the lines
+    // of tokens.txt is also a valid shortlist
+    std::vector<int32_t> tokens;
+    std::vector<std::string> fields;
     std::string line;
-    std::string word;
-    // The format of each line in hotwords_file looks like:
-    // ▁HE LL O ▁WORLD :1.5
-    // the first several items are tokens of the hotword, the item starts with
-    // ":" is the customize boosting score for this hotword, if there is no
-    // customize score it will use the score from configuration (i.e.
-    // config_.hotwords_score).
     while (std::getline(is, line)) {
-      std::istringstream iss(line);
-      float tmp_score = 0.0;  // MUST be 0.0, meaning if no customize score use
-                              // the global one.
-      while (iss >> word) {
-        if (sym_.contains(word)) {
-          int32_t number = sym_[word];
-          tmp.push_back(number);
-        } else {
-          if (word[0] == ':') {
-            tmp_score = std::stof(word.substr(1));
-          } else {
-            NCNN_LOGE(
-                "Cannot find ID for hotword %s at line: %s. (Hint: words on "
-                "the "
-                "same line are separated by spaces)",
-                word.c_str(), line.c_str());
-            exit(-1);
-          }
-        }
+      SplitStringToVector(line, " \t\r", true, &fields);
+      if (fields.empty()) continue;
+
+      const std::string &sym = fields[0];
+
+      if (!sym_.contains(sym)) {
+        NCNN_LOGE("Skip token %s of the shortlist. It is not in %s",
+                  sym.c_str(), config_.model_config.tokens.c_str());
+        continue;
       }
-      hotwords_.push_back(std::move(tmp));
-      boost_scores_.push_back(tmp_score);
+
+      tokens.push_back(sym_[sym]);
+    }
+
+    shortlist_ = JoinerShortlist::Create(model_.get(), std::move(tokens));
+  }
+
+  void InitLm() {
+    const std::string &filename = config_.decoder_config.lm;
+    if (filename.empty()) return;
+
+    lm_ = NgramLm::Load(filename, sym_);
+    if (!lm_) {
+      NCNN_LOGE("Failed to load the LM %s", filename.c_str());
+      exit(-1);
+    }
+  }
+
+  // Streams may be switched to greedy search, see SetGreedySearch(). With
+  // a projection, the cache holds projected decoder outputs, so it is not
+  // shared.
+  void InitGreedyDecoder() {
+    greedy_decoder_ = std::make_unique<GreedySearchDecoder>(
+        model_.get(), projection_ ? nullptr : decoder_cache_.get());
+  }
+
+  // A stream is decoded with greedy search if its result has no
+  // hypotheses, see SetGreedySearch()
+  Decoder *GetDecoder(Stream *s) const {
+    if (greedy_decoder_ && s->GetResult().hyps.Size() == 0) {
+      return greedy_decoder_.get();
+    }
+
+    return decoder_.get();
+  }
+
+#if __ANDROID_API__ >= 9
+  void InitHotwords(AAssetManager *mgr) {
+    context_graph_ = sherpa_ncnn::CreateContextGraph(
+        mgr, config_.hotwords_file, sym_, config_.hotwords_score);
+    if (!context_graph_) {
+      SHERPA_NCNN_EXIT(-1);
+    }
+  }
+#endif
+
+  // The graph is built once and shared by all streams, since it is
+  // immutable
+  void InitHotwords() {
+    context_graph_ = sherpa_ncnn::CreateContextGraph(
+        config_.hotwords_file, sym_, config_.hotwords_score);
+    if (!context_graph_) {
+      SHERPA_NCNN_EXIT(-1);
     }
   }
 
  private:
   RecognizerConfig config_;
-  std::unique_ptr<Model> model_;
+  std::shared_ptr<Model> model_;  // may be shared with other recognizers
+
+  // encoders_[0] is model_, followed by the models of
+  // ModelConfig::encoder_variants. See Stream::GetEncoderIndex().
+  std::vector<std::shared_ptr<Model>> encoders_;
+  std::unique_ptr<DecoderCache> decoder_cache_;
+  std::unique_ptr<JoinerBlankHead> blank_head_;
+  std::unique_ptr<JoinerShortlist> shortlist_;
+  std::unique_ptr<JoinerProjection> projection_;
+  std::unique_ptr<NgramLm> lm_;
   std::unique_ptr<Decoder> decoder_;
+
+  // Used only for modified_beam_search, see GetDecoder()
+  std::unique_ptr<Decoder> greedy_decoder_;
+  std::shared_ptr<LatencyStats> latency_stats_;  // shared with the streams
   Endpoint endpoint_;
   SymbolTable sym_;
-  std::vector<std::vector<int32_t>> hotwords_;
-  std::vector<float> boost_scores_;
+  ContextGraphPtr context_graph_;  // shared with the streams
+
+  // Graphs of the hotwords passed to CreateContextGraph()
+  mutable ContextGraphCache context_graph_cache_;
+
+  // See AddEncoderTap()
+  EncoderTaps encoder_taps_;
+
+  // Streams passed to RecycleStream(), see RecognizerConfig::stream_pool_size
+  StreamPool pool_{config_.stream_pool_size};
 };
 
 Recognizer::Recognizer(const RecognizerConfig &config)
@@ -327,24 +1186,217 @@ Recognizer::Recognizer(AAssetManager *mgr, const RecognizerConfig &config)
     : impl_(std::make_unique<Impl>(mgr, config)) {}
 #endif
 
+Recognizer::Recognizer(const RecognizerConfig &config,
+                       std::shared_ptr<Model> model)
+    : impl_(std::make_unique<Impl>(config, std::move(model))) {}
+
+#if __ANDROID_API__ >= 9
+Recognizer::Recognizer(AAssetManager *mgr, const RecognizerConfig &config,
+                       std::shared_ptr<Model> model)
+    : impl_(std::make_unique<Impl>(mgr, config, std::move(model))) {}
+#endif
+
 Recognizer::~Recognizer() = default;
 
 std::unique_ptr<Stream> Recognizer::CreateStream() const {
   return impl_->CreateStream();
 }
 
-bool Recognizer::IsReady(Stream *s) const { return impl_->IsReady(s); }
+std::unique_ptr<Stream> Recognizer::CreateStream(
+    const std::string &hotwords) const {
+  ContextGraphPtr context_graph = impl_->CreateContextGraph(hotwords);
+  if (!context_graph && !hotwords.empty()) {
+    return nullptr;
+  }
+
+  return impl_->CreateStream(std::move(context_graph));
+}
+
+std::unique_ptr<Stream> Recognizer::CreateStream(
+    ContextGraphPtr context_graph) const {
+  return impl_->CreateStream(std::move(context_graph));
+}
+
+std::unique_ptr<Stream> Recognizer::CreateStreamWithChunkSize(
+    int32_t chunk_size) const {
+  return impl_->CreateStreamWithChunkSize(chunk_size);
+}
+
+std::unique_ptr<Stream> Recognizer::CreateStreamWithChunkSize(
+    int32_t chunk_size, ContextGraphPtr context_graph) const {
+  return impl_->CreateStreamWithChunkSize(chunk_size,
+                                          std::move(context_graph));
+}
+
+void Recognizer::RecycleStream(std::unique_ptr<Stream> s) const {
+  impl_->RecycleStream(std::move(s));
+}
+
+std::vector<int32_t> Recognizer::GetChunkSizes() const {
+  return impl_->GetChunkSizes();
+}
+
+ContextGraphPtr Recognizer::CreateContextGraph(
+    const std::string &hotwords) const {
+  return impl_->CreateContextGraph(hotwords);
+}
+
+bool Recognizer::SetHotwords(Stream *s, const std::string &hotwords) const {
+  ContextGraphPtr context_graph = impl_->CreateContextGraph(hotwords);
+  if (!context_graph && !hotwords.empty()) {
+    return false;
+  }
+
+  s->SetContextGraph(std::move(context_graph));
+  return true;
+}
+
+// The public methods that SessionRecorder records wrap those of Impl
+
+bool Recognizer::IsReady(Stream *s) const {
+  bool ans = impl_->IsReady(s);
+  if (SessionRecorder::Enabled()) {
+    SessionRecorder::RecordResult(SessionEventType::kIsReady, s->GetId(),
+                                  ans);
+  }
+  return ans;
+}
+
+void Recognizer::DecodeStreams(Stream **ss, int32_t n) const {
+  if (!SessionRecorder::Enabled()) {
+    impl_->DecodeStreams(ss, n);
+    return;
+  }
+
+  auto start = StageClock::now();
+  impl_->DecodeStreams(ss, n);
+  SessionRecorder::RecordDecode(SessionEventType::kDecodeStreams, ss, n,
+                                start, StageClock::now());
+}
+
+int32_t Recognizer::DecodeReadyStreams(Stream **ss, int32_t n) const {
+  if (!SessionRecorder::Enabled()) {
+    return impl_->DecodeReadyStreams(ss, n);
+  }
+
+  auto start = StageClock::now();
+  int32_t ans = impl_->DecodeReadyStreams(ss, n);
+  SessionRecorder::RecordDecode(SessionEventType::kDecodeReadyStreams, ss, n,
+                                start, StageClock::now());
+  return ans;
+}
+
+int32_t Recognizer::DecodeRemainingFrames(Stream **ss, int32_t n) const {
+  if (!SessionRecorder::Enabled()) {
+    return impl_->DecodeRemainingFrames(ss, n);
+  }
 
-void Recognizer::DecodeStream(Stream *s) const { impl_->DecodeStream(s); }
+  auto start = StageClock::now();
+  int32_t ans = impl_->DecodeRemainingFrames(ss, n);
+  SessionRecorder::RecordDecode(SessionEventType::kDecodeRemainingFrames, ss,
+                                n, start, StageClock::now());
+  return ans;
+}
 
-bool Recognizer::IsEndpoint(Stream *s) const { return impl_->IsEndpoint(s); }
+bool Recognizer::IsEndpoint(Stream *s) const {
+  bool ans = impl_->IsEndpoint(s);
+  if (SessionRecorder::Enabled()) {
+    SessionRecorder::RecordResult(SessionEventType::kIsEndpoint, s->GetId(),
+                                  ans);
+  }
+  return ans;
+}
 
-void Recognizer::Reset(Stream *s) const { impl_->Reset(s); }
+void Recognizer::Reset(Stream *s) const {
+  if (SessionRecorder::Enabled()) {
+    SessionRecorder::Record(SessionEventType::kReset, s->GetId());
+  }
+  impl_->Reset(s);
+}
 
 RecognitionResult Recognizer::GetResult(Stream *s) const {
+  if (SessionRecorder::Enabled()) {
+    SessionRecorder::Record(SessionEventType::kGetResult, s->GetId());
+  }
   return impl_->GetResult(s);
 }
 
+std::shared_ptr<const RecognitionResult> Recognizer::GetResultSnapshot(
+    const Stream *s) const {
+  auto ans = s->GetPublishedResult();
+  return ans ? ans : std::make_shared<const RecognitionResult>();
+}
+
+RecognitionResultUpdate Recognizer::GetResultUpdate(Stream *s) const {
+  if (SessionRecorder::Enabled()) {
+    SessionRecorder::Record(SessionEventType::kGetResult, s->GetId());
+  }
+  return impl_->GetResultUpdate(s);
+}
+
+std::string Recognizer::SaveStream(Stream *s) const {
+  return SaveStreamState(s);
+}
+
+void Recognizer::SetGreedySearch(Stream *s, bool greedy) const {
+  impl_->SetGreedySearch(s, greedy);
+}
+
+bool Recognizer::IsGreedySearch(Stream *s) const {
+  return impl_->IsGreedySearch(s);
+}
+
+int32_t Recognizer::AddEncoderTap(EncoderTap tap, bool with_features) const {
+  return impl_->AddEncoderTap(std::move(tap), with_features);
+}
+
+bool Recognizer::RemoveEncoderTap(int32_t id) const {
+  return impl_->RemoveEncoderTap(id);
+}
+
+bool Recognizer::RestoreStream(const void *data, std::size_t size,
+                               Stream *s) const {
+  return impl_->RestoreStream(data, size, s);
+}
+
+void Recognizer::WarmUp() const { impl_->WarmUp(); }
+
+const RecognizerConfig &Recognizer::GetConfig() const {
+  return impl_->GetConfig();
+}
+
 const Model *Recognizer::GetModel() const { return impl_->GetModel(); }
 
+std::shared_ptr<Model> Recognizer::GetSharedModel() const {
+  return impl_->GetSharedModel();
+}
+
+const DecoderCache *Recognizer::GetDecoderCache() const {
+  return impl_->GetDecoderCache();
+}
+
+const LatencyStats *Recognizer::GetLatencyStats() const {
+  return impl_->GetLatencyStats();
+}
+
+std::future<std::unique_ptr<Recognizer>> CreateRecognizerAsync(
+    const RecognizerConfig &config) {
+  return std::async(std::launch::async, [config]() {
+    auto recognizer = std::make_unique<Recognizer>(config);
+    recognizer->WarmUp();
+    return recognizer;
+  });
+}
+
+#if __ANDROID_API__ >= 9
+std::future<std::unique_ptr<Recognizer>> CreateRecognizerAsync(
+    AAssetManager *mgr, const RecognizerConfig &config) {
+  return std::async(std::launch::async, [mgr, config]() {
+    auto recognizer = std::make_unique<Recognizer>(mgr, config);
+    recognizer->WarmUp();
+    return recognizer;
+  });
+}
+#endif
+
 }  // namespace sherpa_ncnn
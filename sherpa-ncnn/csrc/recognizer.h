@@ -20,13 +20,20 @@
 #ifndef SHERPA_NCNN_CSRC_RECOGNIZER_H_
 #define SHERPA_NCNN_CSRC_RECOGNIZER_H_
 
+#include <cstddef>
+#include <future>  // NOLINT
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "sherpa-ncnn/csrc/context-graph.h"
+#include "sherpa-ncnn/csrc/decoder-cache.h"
+#include "sherpa-ncnn/csrc/encoder-tap.h"
 #include "sherpa-ncnn/csrc/endpoint.h"
 #include "sherpa-ncnn/csrc/features.h"
 #include "sherpa-ncnn/csrc/hypothesis.h"
+#include "sherpa-ncnn/csrc/latency-stats.h"
+#include "sherpa-ncnn/csrc/memory-usage.h"
 #include "sherpa-ncnn/csrc/model.h"
 #include "sherpa-ncnn/csrc/stream.h"
 #include "sherpa-ncnn/csrc/symbol-table.h"
@@ -49,6 +56,30 @@ struct RecognitionResult {
   std::string ToString() const;
 };
 
+// The change of the result of a stream since the last call of
+// Recognizer::GetResultUpdate(). The current result is the previous one
+// with the tokens from index start on replaced by tokens.
+struct RecognitionResultUpdate {
+  // It increases whenever the result changes. If it is the same as last
+  // time, tokens is empty and start is the number of tokens.
+  int32_t revision = 0;
+
+  // Number of tokens kept from the previous result. It is 0 after Reset().
+  int32_t start = 0;
+
+  // The first num_stable tokens of the result do not change any more
+  // until Reset(). With greedy_search, all tokens are stable.
+  int32_t num_stable = 0;
+
+  // The tokens from index start on and their timestamps in seconds
+  std::vector<int32_t> tokens;
+  std::vector<std::string> stokens;
+  std::vector<float> timestamps;
+
+  // Concatenation of stokens
+  std::string text;
+};
+
 struct RecognizerConfig {
   FeatureExtractorConfig feat_config;
   ModelConfig model_config;
@@ -61,6 +92,47 @@ struct RecognizerConfig {
   /// used only for modified_beam_search
   float hotwords_score = 1.5;
 
+  /// If true, record the wall time of each stage of recognition for each
+  /// stream and for the recognizer. See Recognizer::GetLatencyStats() and
+  /// Stream::GetLatencyStats().
+  bool enable_profiling = false;
+
+  /// If true, the encoder states of a stream are kept in fp16 between
+  /// chunks, see Stream::CompactStates(). It saves memory when there are
+  /// many streams at the cost of rounding the states after each chunk,
+  /// which changes the results very little, and of converting them to
+  /// fp32 for each chunk.
+  bool fp16_states = false;
+
+  /// If true, DecodeReadyStreams() runs the encoder for the next chunk of
+  /// the streams on the calling thread while the search for their current
+  /// chunk runs on another thread, so the cores of the encoder are not
+  /// idle during a long beam search. The thread is started once per call
+  /// and searches all of its rounds. The results are the same. It is not
+  /// used if enable_endpoint is true, since the next chunk of a stream is
+  /// only decoded if its current chunk is not an endpoint.
+  bool pipeline_search = false;
+
+  /// If true, the result of each stream is converted and published after
+  /// each decoded chunk and after Reset(), so that GetResultSnapshot() can
+  /// be called from other threads while the stream is being decoded, e.g.,
+  /// by a UI thread. It costs one GetResult() per chunk of each stream.
+  bool publish_results = false;
+
+  /// Maximum number of streams kept by Recognizer::RecycleStream(). The
+  /// CreateStream*() methods reuse them instead of allocating a new
+  /// stream, its encoder states and its result. 0 disables the pool.
+  /// Pooled streams do not count against memory_budget.
+  int32_t stream_pool_size = 0;
+
+  /// If not null, each stream reserves the memory of its encoder states,
+  /// double-buffered, and of the features of one chunk from it until the
+  /// stream is destroyed, and CreateStream() returns nullptr if the budget
+  /// is exhausted. It can be shared by several recognizers. Memory that a
+  /// stream allocates later, e.g., for a long result, is not reserved; see
+  /// Stream::GetMemoryUsage().
+  std::shared_ptr<MemoryBudget> memory_budget;
+
   RecognizerConfig() = default;
 
   RecognizerConfig(const FeatureExtractorConfig &feat_config,
@@ -87,20 +159,172 @@ class Recognizer {
   Recognizer(AAssetManager *mgr, const RecognizerConfig &config);
 #endif
 
+  /** Create a recognizer that uses an existing model.
+   *
+   * The weights of a model are read-only after Model::Create() and a model
+   * can be run from several threads at the same time, so recognizers with
+   * different decoding, hotword, endpoint or feature settings can share one
+   * copy of the weights. The decoder cache, the blank head, the hotwords
+   * and the latency statistics are still owned by each recognizer.
+   *
+   * @param config  Only config.model_config.tokens is used from
+   *                config.model_config. It must match the model.
+   * @param model  A model returned by Model::Create(). It is kept alive
+   *               until all recognizers that use it are destroyed.
+   */
+  Recognizer(const RecognizerConfig &config, std::shared_ptr<Model> model);
+
+#if __ANDROID_API__ >= 9
+  Recognizer(AAssetManager *mgr, const RecognizerConfig &config,
+             std::shared_ptr<Model> model);
+#endif
+
   ~Recognizer();
 
-  /// Create a stream for decoding.
+  /// Create a stream for decoding. All CreateStream*() methods return
+  /// nullptr if RecognizerConfig::memory_budget cannot afford the stream.
   std::unique_ptr<Stream> CreateStream() const;
 
+  /** Create a stream that is decoded with the given hotwords instead of
+   * those from RecognizerConfig::hotwords_file.
+   *
+   * @param hotwords  The hotwords in the format of the hotwords file, i.e.,
+   *                  one hotword per line, see ReadHotwords(). If it is
+   *                  empty, the stream has no hotwords.
+   *
+   * @return Return nullptr if hotwords are invalid, e.g., contain a token
+   *         that is not in the symbol table.
+   */
+  std::unique_ptr<Stream> CreateStream(const std::string &hotwords) const;
+
+  /// Create a stream that is decoded with the given context graph, which
+  /// is shared with the stream. It may be null.
+  std::unique_ptr<Stream> CreateStream(ContextGraphPtr context_graph) const;
+
+  /** Create a stream that is decoded with the encoder whose chunk size is
+   * closest to chunk_size, see ModelConfig::encoder_variants. Use a small
+   * chunk for interactive streams and a large one for throughput. Streams
+   * of different chunk sizes can be passed to one DecodeStreams() call.
+   *
+   * @param chunk_size  In feature frames before subsampling, i.e., 10 ms
+   *                    each. See GetChunkSizes().
+   */
+  std::unique_ptr<Stream> CreateStreamWithChunkSize(int32_t chunk_size) const;
+
+  // Same as above, but with the given context graph, which may be null
+  std::unique_ptr<Stream> CreateStreamWithChunkSize(
+      int32_t chunk_size, ContextGraphPtr context_graph) const;
+
+  /** Give back a stream that is not needed any more, instead of destroying
+   * it, so that a later CreateStream*() call can reuse it, see
+   * RecognizerConfig::stream_pool_size. The stream is destroyed if the
+   * pool is full. It is thread-safe.
+   *
+   * A reused stream behaves as a new one, but it has a new id and it
+   * keeps the memory of its encoder states, which are set by a memcpy.
+   */
+  void RecycleStream(std::unique_ptr<Stream> s) const;
+
+  /// Return the chunk sizes of the encoders, see Model::Offset(). The first
+  /// is that of ModelConfig::encoder_param, followed by those of
+  /// ModelConfig::encoder_variants.
+  std::vector<int32_t> GetChunkSizes() const;
+
+  /** Build the context graph of the given hotwords, see CreateStream().
+   *
+   * Graphs are cached by the content of hotwords, so creating streams for
+   * hotwords that were seen recently costs a hash lookup instead of
+   * building a graph. RecognizerConfig::hotwords_score is the score of
+   * hotwords that have no score of their own.
+   *
+   * @return Return nullptr if hotwords is empty or invalid. Invalid hotwords
+   *         are logged and not cached.
+   */
+  ContextGraphPtr CreateContextGraph(const std::string &hotwords) const;
+
+  /// Change the hotwords of an existing stream, e.g., for a new utterance
+  /// after Reset(s). See Stream::SetContextGraph(). Return false and keep
+  /// the hotwords of s if the given ones are invalid.
+  bool SetHotwords(Stream *s, const std::string &hotwords) const;
+
   /**
    * Return true if the given stream has enough frames for decoding.
    * Return false otherwise
    */
   bool IsReady(Stream *s) const;
 
-  void DecodeStream(Stream *s) const;
+  /** Decode a single stream
+   *
+   * @param s The stream to decode. IsReady(s) must be true.
+   */
+  void DecodeStream(Stream *s) const {
+    Stream *ss[1] = {s};
+    DecodeStreams(ss, 1);
+  }
+
+  /** Decode a list of streams.
+   *
+   * @param ss Pointer to an array of streams. IsReady(ss[i]) must be true
+   *           for every stream.
+   * @param n  Size of the input array.
+   */
+  void DecodeStreams(Stream **ss, int32_t n) const;
+
+  /** Decode all ready chunks of a list of streams, e.g., to catch up with
+   * the backlog of a stream after a network or CPU stall.
+   *
+   * The chunks of one stream depend on each other and the encoders are
+   * exported with a fixed chunk size, so each chunk is still one encoder
+   * run. Instead, the ready streams are decoded together with
+   * DecodeStreams() until none is ready. A stream is not decoded further
+   * once IsEndpoint() is true for it, so that the caller can Reset() it.
+   * See RecognizerConfig::pipeline_search.
+   *
+   * @param ss Pointer to an array of streams. They need not be ready.
+   * @param n  Size of the input array.
+   * @return Return the number of decoded chunks, summed over the streams.
+   */
+  int32_t DecodeReadyStreams(Stream **ss, int32_t n) const;
+
+  /** Decode the rest of a list of streams after Stream::InputFinished(),
+   * so that the caller does not need to append tail padding to flush
+   * them.
+   *
+   * Ready chunks are decoded first. The frames that are left do not fill a
+   * chunk and are decoded in one more chunk, or a few if the encoder has
+   * a long right context, i.e., Model::Segment() - Model::Offset().
+   * Frames of these chunks after the last frame are the features of
+   * silence, so the encoder runs only as often as the frames need.
+   * Streams are decoded together in batches. Unlike DecodeReadyStreams(),
+   * endpoints are not checked. Streams for which InputFinished() was not
+   * called are decoded only up to their last ready chunk.
+   *
+   * Afterwards, GetNumProcessedFrames() equals NumFramesReady() for
+   * finished streams, so call GetResult() for the final result.
+   *
+   * @param ss Pointer to an array of streams. They need not be ready.
+   * @param n  Size of the input array.
+   * @return Return the number of decoded chunks, summed over the streams.
+   */
+  int32_t DecodeRemainingFrames(Stream **ss, int32_t n) const;
+
+  // Same as above, but for a single stream
+  int32_t DecodeRemainingFrames(Stream *s) const {
+    Stream *ss[1] = {s};
+    return DecodeRemainingFrames(ss, 1);
+  }
+
+  /** Run the networks once on silence so that the first call of
+   * DecodeStreams() does not pay for the setup ncnn does on the first run,
+   * see Model::WarmUp(). It can be called from any thread, e.g., while
+   * the UI is being shown. Streams are not affected.
+   */
+  void WarmUp() const;
 
   // Return true if we detect an endpoint for this stream.
+  // Trailing silence is measured in blanks of the decoding result or, if
+  // the stream has a voice activity detector, in its non-speech windows;
+  // see Stream::AcceptSpeechProbability().
   // Note: If this function returns true, you usually want to
   // invoke Reset(s).
   bool IsEndpoint(Stream *s) const;
@@ -111,16 +335,119 @@ class Recognizer {
 
   RecognitionResult GetResult(Stream *s) const;
 
+  /** Same as GetResult(), but return only the tokens that have changed
+   * since the last call for s. The cost depends on the number of changed
+   * tokens and not on the length of the utterance, so it is suitable for
+   * showing partial results after every chunk.
+   */
+  RecognitionResultUpdate GetResultUpdate(Stream *s) const;
+
+  /** Return the result of s as of its last decoded chunk or Reset(). It
+   * is lock-free and, unlike GetResult(), it can be called from any thread
+   * while s is being decoded, since the result is an immutable copy that
+   * the decoding thread replaces atomically.
+   *
+   * It requires RecognizerConfig::publish_results. Otherwise, or before
+   * the first chunk, the result is empty. Unlike GetResult(), it does not
+   * finalize the hotwords of s at an endpoint.
+   */
+  std::shared_ptr<const RecognitionResult> GetResultSnapshot(
+      const Stream *s) const;
+
+  /** Decode s with greedy search from now on, or switch it back, e.g., to
+   * shed load when the recognizer is overloaded, see
+   * StreamSchedulerConfig::overload_queue_depth. It does nothing if the
+   * decoding method is greedy_search.
+   *
+   * The result so far is kept: greedy search continues from the best path
+   * and modified_beam_search continues with that path as its only path.
+   * Hotwords and the LM are not used during greedy search. Reset() keeps
+   * the current method. It must not run while s is being decoded.
+   */
+  void SetGreedySearch(Stream *s, bool greedy) const;
+
+  // Return true if s is decoded with greedy search
+  bool IsGreedySearch(Stream *s) const;
+
+  /** Pass each encoded chunk of every stream of this recognizer to tap,
+   * see EncoderChunk, so that other models can reuse the encoder output,
+   * and optionally the features, instead of computing their own. See also
+   * Stream::SetEncoderTap() for a single stream. It can be called from any
+   * thread, also while streams are decoded.
+   *
+   * @param with_features  If true, EncoderChunk::features is set.
+   * @return Return the id of the tap for RemoveEncoderTap().
+   */
+  int32_t AddEncoderTap(EncoderTap tap, bool with_features = false) const;
+
+  // Return false if there is no tap with the given id
+  bool RemoveEncoderTap(int32_t id) const;
+
+  /** Save the decoding state of s, so that another recognizer with the
+   * same model, e.g., in another process, can continue decoding it with
+   * RestoreStream(). See stream-snapshot.h for what is saved.
+   *
+   * @return Return an empty string on error.
+   */
+  std::string SaveStream(Stream *s) const;
+
+  /** Restore the output of SaveStream() into s.
+   *
+   * @param s  A stream returned by CreateStream() that has not accepted
+   *           any waveform yet. Its hotwords are used.
+   * @return Return false if data is not a valid snapshot for the model of
+   *         this recognizer.
+   */
+  bool RestoreStream(const void *data, std::size_t size, Stream *s) const;
+
+  // Return the config passed to the constructor
+  const RecognizerConfig &GetConfig() const;
+
   // Return the contained model
   //
   // The user should not free it.
   const Model *GetModel() const;
 
+  // Return the contained model so that it can be passed to the constructor
+  // of another recognizer
+  std::shared_ptr<Model> GetSharedModel() const;
+
+  // Return the cache for decoder outputs shared by all streams.
+  // You can use its NumHits() and NumMisses() to choose
+  // DecoderConfig::decoder_cache_size.
+  //
+  // Return nullptr if the cache is disabled. The user should not free it.
+  const DecoderCache *GetDecoderCache() const;
+
+  // Return the latency statistics aggregated over all streams created by
+  // this recognizer. Per-stream statistics are available from
+  // Stream::GetLatencyStats().
+  //
+  // Return nullptr if RecognizerConfig::enable_profiling is false. The
+  // user should not free it.
+  const LatencyStats *GetLatencyStats() const;
+
  private:
   class Impl;
   std::unique_ptr<Impl> impl_;
 };
 
+/** Create a recognizer and warm it up on a background thread.
+ *
+ * It returns immediately. The future is ready once the recognizer is
+ * loaded and warmed up, see Recognizer::WarmUp(); use wait_for() to poll.
+ * As with the constructor, GetModel() of the result is nullptr if the
+ * model failed to load.
+ */
+std::future<std::unique_ptr<Recognizer>> CreateRecognizerAsync(
+    const RecognizerConfig &config);
+
+#if __ANDROID_API__ >= 9
+// mgr must be valid until the future is ready
+std::future<std::unique_ptr<Recognizer>> CreateRecognizerAsync(
+    AAssetManager *mgr, const RecognizerConfig &config);
+#endif
+
 }  // namespace sherpa_ncnn
 
 #endif  // SHERPA_NCNN_CSRC_RECOGNIZER_H_
@@ -0,0 +1,335 @@
+// sherpa-ncnn/csrc/remote-encoder.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/remote-encoder.h"
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+namespace sherpa_ncnn {
+
+// Size of a chunk before its data
+static constexpr std::size_t kChunkHeaderBytes = 8 + 4 * 4;
+
+template <typename T>
+static void Put(T v, std::vector<uint8_t> *buf) {
+  std::size_t n = buf->size();
+  buf->resize(n + sizeof(T));
+  std::memcpy(buf->data() + n, &v, sizeof(T));
+}
+
+template <typename T>
+static T Get(const uint8_t **p) {
+  T v;
+  std::memcpy(&v, *p, sizeof(T));
+  *p += sizeof(T);
+  return v;
+}
+
+RemoteEncoderHandle RemoteEncoderHandle::FromMat(const ncnn::Mat &m) {
+  const float *p = m;
+
+  RemoteEncoderHandle ans;
+  for (int32_t i = 0; i != 3; ++i) {
+    ans.session = (ans.session << 11) | static_cast<uint64_t>(p[i]);
+  }
+  ans.seq = static_cast<int32_t>(p[3]);
+
+  return ans;
+}
+
+void RemoteEncoderHandle::ToMat(ncnn::Mat *m) const {
+  float *p = *m;
+  for (int32_t i = 0; i != 3; ++i) {
+    p[i] = static_cast<float>((session >> (11 * (2 - i))) & 2047);
+  }
+  p[3] = static_cast<float>(seq % kMaxSeq);
+}
+
+void WriteRemoteEncoderMessage(const std::vector<RemoteEncoderChunk> &chunks,
+                               std::vector<uint8_t> *buf) {
+  std::size_t start = buf->size();
+  Put<uint32_t>(0, buf);  // the size, set below
+
+  Put<uint32_t>(kRemoteEncoderMagic, buf);
+  Put<uint32_t>(chunks.size(), buf);
+
+  for (const auto &c : chunks) {
+    Put<uint64_t>(c.session, buf);
+    Put<int32_t>(c.seq, buf);
+    Put<int32_t>(c.status, buf);
+    Put<int32_t>(c.data.w, buf);
+    Put<int32_t>(c.data.h, buf);
+
+    std::size_t n = static_cast<std::size_t>(c.data.w) * c.data.h;
+    const uint8_t *p = static_cast<const uint8_t *>(c.data.data);
+    buf->insert(buf->end(), p, p + n * sizeof(float));
+  }
+
+  uint32_t size = buf->size() - start - sizeof(uint32_t);
+  std::memcpy(buf->data() + start, &size, sizeof(size));
+}
+
+bool ParseRemoteEncoderMessage(const uint8_t *p, std::size_t n,
+                               std::vector<RemoteEncoderChunk> *chunks) {
+  const uint8_t *end = p + n;
+  if (n < 8 || Get<uint32_t>(&p) != kRemoteEncoderMagic) {
+    return false;
+  }
+
+  uint32_t num_chunks = Get<uint32_t>(&p);
+  if (num_chunks > (end - p) / kChunkHeaderBytes) {
+    return false;
+  }
+
+  chunks->clear();
+  chunks->resize(num_chunks);
+  for (auto &c : *chunks) {
+    if (static_cast<std::size_t>(end - p) < kChunkHeaderBytes) {
+      return false;
+    }
+
+    c.session = Get<uint64_t>(&p);
+    c.seq = Get<int32_t>(&p);
+    c.status = Get<int32_t>(&p);
+    int32_t w = Get<int32_t>(&p);
+    int32_t h = Get<int32_t>(&p);
+
+    if (w < 0 || h < 0 ||
+        static_cast<uint64_t>(w) * h * sizeof(float) >
+            static_cast<uint64_t>(end - p)) {
+      return false;
+    }
+
+    if (w == 0 || h == 0) {
+      continue;
+    }
+
+    c.data.create(w, h);
+    std::memcpy(c.data.data, p, static_cast<std::size_t>(w) * h * 4);
+    p += static_cast<std::size_t>(w) * h * 4;
+  }
+
+  return p == end;
+}
+
+// Read exactly n bytes. Return false on error or at the end of the stream.
+static bool ReceiveAll(int32_t fd, uint8_t *buf, std::size_t n) {
+  while (n > 0) {
+    ssize_t k = recv(fd, buf, n, 0);
+    if (k < 0 && errno == EINTR) continue;
+    if (k <= 0) return false;
+
+    buf += k;
+    n -= k;
+  }
+
+  return true;
+}
+
+bool ReceiveRemoteEncoderMessage(int32_t fd, std::size_t max_bytes,
+                                 std::vector<RemoteEncoderChunk> *chunks) {
+  uint32_t size = 0;
+  if (!ReceiveAll(fd, reinterpret_cast<uint8_t *>(&size), sizeof(size)) ||
+      size > max_bytes) {
+    return false;
+  }
+
+  std::vector<uint8_t> buf(size);
+  return ReceiveAll(fd, buf.data(), size) &&
+         ParseRemoteEncoderMessage(buf.data(), size, chunks);
+}
+
+bool SendAll(int32_t fd, const uint8_t *buf, std::size_t n) {
+  while (n > 0) {
+    ssize_t k = send(fd, buf, n, MSG_NOSIGNAL);
+    if (k < 0 && errno == EINTR) continue;
+    if (k <= 0) return false;
+
+    buf += k;
+    n -= k;
+  }
+
+  return true;
+}
+
+int32_t ConnectTo(const std::string &address) {
+  auto pos = address.rfind(':');
+  if (pos == std::string::npos) {
+    NCNN_LOGE("Expect host:port. Given: %s", address.c_str());
+    return -1;
+  }
+
+  std::string host = address.substr(0, pos);
+  std::string port = address.substr(pos + 1);
+
+  addrinfo hints{};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+
+  addrinfo *res = nullptr;
+  int32_t ret = getaddrinfo(host.c_str(), port.c_str(), &hints, &res);
+  if (ret != 0) {
+    NCNN_LOGE("Failed to resolve %s: %s", address.c_str(), gai_strerror(ret));
+    return -1;
+  }
+
+  int32_t fd = -1;
+  for (addrinfo *a = res; a; a = a->ai_next) {
+    fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+    if (fd < 0) continue;
+
+    if (connect(fd, a->ai_addr, a->ai_addrlen) == 0) break;
+
+    close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(res);
+
+  if (fd < 0) {
+    NCNN_LOGE("Failed to connect to %s: %s", address.c_str(), strerror(errno));
+    return -1;
+  }
+
+  // Requests are small and a response is awaited for each of them
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+  return fd;
+}
+
+RemoteEncoderModel::RemoteEncoderModel(std::unique_ptr<Model> local,
+                                       const std::string &address)
+    : local_(std::move(local)), address_(address) {
+  InitEncoderStateLayout();
+
+  fd_ = ConnectTo(address_);
+  if (fd_ < 0) {
+    NCNN_LOGE("The encoder server at %s is not available. Try again at the "
+              "first chunk",
+              address_.c_str());
+  }
+}
+
+RemoteEncoderModel::~RemoteEncoderModel() {
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+std::vector<ncnn::Mat> RemoteEncoderModel::GetEncoderInitStates() const {
+  ncnn::Mat handle(RemoteEncoderHandle::kSize);
+  RemoteEncoderHandle().ToMat(&handle);
+
+  return {handle};
+}
+
+std::pair<ncnn::Mat, std::vector<ncnn::Mat>> RemoteEncoderModel::RunEncoder(
+    ncnn::Mat &features, const std::vector<ncnn::Mat> &states) {
+  std::vector<ncnn::Mat> next_states;
+  ncnn::Mat encoder_out = RunEncoder(features, states, nullptr, &next_states);
+  return {encoder_out, next_states};
+}
+
+std::pair<ncnn::Mat, std::vector<ncnn::Mat>> RemoteEncoderModel::RunEncoder(
+    ncnn::Mat &features, const std::vector<ncnn::Mat> &states,
+    ncnn::Extractor *extractor) {
+  std::vector<ncnn::Mat> next_states;
+  ncnn::Mat encoder_out =
+      RunEncoder(features, states, extractor, &next_states);
+  return {encoder_out, next_states};
+}
+
+ncnn::Mat RemoteEncoderModel::RunEncoder(
+    ncnn::Mat &features, const std::vector<ncnn::Mat> &states,
+    ncnn::Extractor * /*extractor*/, std::vector<ncnn::Mat> *next_states) {
+  std::vector<ncnn::Mat> f = {features};
+  return RunEncoderBatch(f, {&states}, {next_states})[0];
+}
+
+std::vector<ncnn::Mat> RemoteEncoderModel::RunEncoderBatch(
+    std::vector<ncnn::Mat> &features,
+    const std::vector<const std::vector<ncnn::Mat> *> &states,
+    const std::vector<std::vector<ncnn::Mat> *> &next_states) {
+  int32_t n = static_cast<int32_t>(features.size());
+
+  std::vector<RemoteEncoderChunk> chunks(n);
+  for (int32_t i = 0; i != n; ++i) {
+    auto handle = RemoteEncoderHandle::FromMat((*states[i])[0]);
+    chunks[i].session = handle.session;
+    chunks[i].seq = handle.seq;
+
+    chunks[i].data = features[i];
+  }
+
+  std::vector<uint8_t> request;
+  WriteRemoteEncoderMessage(chunks, &request);
+
+  std::vector<RemoteEncoderChunk> response;
+  if (!Call(request, &response)) {
+    NCNN_LOGE("Failed to run the encoder at %s", address_.c_str());
+    exit(-1);
+  }
+
+  if (static_cast<int32_t>(response.size()) != n) {
+    NCNN_LOGE("Expected %d chunks from %s. Given: %d", n, address_.c_str(),
+              static_cast<int32_t>(response.size()));
+    exit(-1);
+  }
+
+  std::vector<ncnn::Mat> encoder_out(n);
+  for (int32_t i = 0; i != n; ++i) {
+    const auto &c = response[i];
+    if (c.status != kRemoteEncoderOk) {
+      NCNN_LOGE("The encoder at %s rejected a chunk of %dx%d features",
+                address_.c_str(), features[i].w, features[i].h);
+      exit(-1);
+    }
+
+    ncnn::Mat handle(RemoteEncoderHandle::kSize);
+    RemoteEncoderHandle{c.session, c.seq}.ToMat(&handle);
+
+    auto &next = *next_states[i];
+    next.resize(1);
+    CopyTo(handle, &next[0]);
+
+    encoder_out[i] = c.data;
+  }
+
+  return encoder_out;
+}
+
+bool RemoteEncoderModel::Call(const std::vector<uint8_t> &request,
+                              std::vector<RemoteEncoderChunk> *response) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // A broken connection is opened again once. The sessions are kept by
+  // the server.
+  for (int32_t attempt = 0; attempt != 2; ++attempt) {
+    if (fd_ < 0) {
+      fd_ = ConnectTo(address_);
+      if (fd_ < 0) continue;
+    }
+
+    if (SendAll(fd_, request.data(), request.size()) &&
+        ReceiveRemoteEncoderMessage(fd_, UINT32_MAX, response)) {
+      return true;
+    }
+
+    close(fd_);
+    fd_ = -1;
+  }
+
+  return false;
+}
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,209 @@
+// sherpa-ncnn/csrc/remote-encoder.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_REMOTE_ENCODER_H_
+#define SHERPA_NCNN_CSRC_REMOTE_ENCODER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "mat.h"  // NOLINT
+#include "sherpa-ncnn/csrc/model.h"
+
+namespace sherpa_ncnn {
+
+/* The encoder of a model can run on a server, see
+ * sherpa-ncnn-encoder-server, while the features, the decoder, the joiner
+ * and the search run locally, e.g., on a device that is too slow for the
+ * encoder. Only the features of each chunk are sent to the server and
+ * only the encoder output is sent back.
+ *
+ * The encoder states of a stream stay on the server in a session. The
+ * stream keeps a handle of the session as its encoder states instead, see
+ * RemoteEncoderHandle, so that nothing else in the recognizer changes.
+ *
+ * A message is a uint32 with the number of bytes that follow, the magic
+ * kRemoteEncoderMagic, the number of chunks and then for each chunk:
+ *
+ *   uint64 session, int32 seq, int32 status, int32 w, int32 h,
+ *   w * h float32
+ *
+ * All values are in the byte order of the host, i.e., little-endian on all
+ * platforms we support. A request and its response have the same chunks
+ * in the same order.
+ */
+constexpr uint32_t kRemoteEncoderMagic = 0x45524e53;  // "SNRE"
+
+// The status of a chunk of a response
+enum RemoteEncoderStatus : int32_t {
+  kRemoteEncoderOk = 0,
+  // The features do not have the shape the encoder expects
+  kRemoteEncoderBadInput = 1,
+};
+
+// One chunk of a request or of a response
+struct RemoteEncoderChunk {
+  // 0 in a request to start a new session. The server sets it in the
+  // response.
+  uint64_t session = 0;
+
+  // Number of chunks of the session before this one, modulo
+  // RemoteEncoderHandle::kMaxSeq
+  int32_t seq = 0;
+
+  // Used only in responses
+  int32_t status = kRemoteEncoderOk;
+
+  // The features of a request, of shape (num_frames, feature_dim), or the
+  // encoder output of a response
+  ncnn::Mat data;
+};
+
+/** The encoder states of a stream of RemoteEncoderModel: a mat of kSize
+ * floats that identifies a session on the server.
+ *
+ * Each float is an integer below 2048, which is exact in fp16, so the
+ * handle survives RecognizerConfig::fp16_states and Stream::Park(), which
+ * round the states to fp16. The first three are 11 bits each of the
+ * session id and the last is the sequence number of the next chunk.
+ */
+struct RemoteEncoderHandle {
+  static constexpr int32_t kSize = 4;
+  static constexpr int32_t kMaxSeq = 2048;
+
+  // Session ids are below this
+  static constexpr uint64_t kMaxSession = uint64_t(1) << 33;
+
+  uint64_t session = 0;
+  int32_t seq = 0;
+
+  static RemoteEncoderHandle FromMat(const ncnn::Mat &m);
+
+  // Write it to m, which must have kSize floats
+  void ToMat(ncnn::Mat *m) const;
+};
+
+// Append a message with the given chunks, including its size, to buf
+void WriteRemoteEncoderMessage(const std::vector<RemoteEncoderChunk> &chunks,
+                               std::vector<uint8_t> *buf);
+
+/** Parse a message, without the uint32 of its size, into chunks.
+ *
+ * @return Return false if it is malformed.
+ */
+bool ParseRemoteEncoderMessage(const uint8_t *p, std::size_t n,
+                               std::vector<RemoteEncoderChunk> *chunks);
+
+/** Read a message from a blocking socket and parse it.
+ *
+ * @return Return false on error, if the peer has closed the connection or
+ *         if the message has more than max_bytes bytes.
+ */
+bool ReceiveRemoteEncoderMessage(int32_t fd, std::size_t max_bytes,
+                                 std::vector<RemoteEncoderChunk> *chunks);
+
+// Write all of buf to a blocking socket. Return false on error.
+bool SendAll(int32_t fd, const uint8_t *buf, std::size_t n);
+
+// Connect to "host:port". Return -1 on error.
+int32_t ConnectTo(const std::string &address);
+
+/** A model whose encoder runs on a server at ModelConfig::remote_encoder.
+ *
+ * The decoder and the joiner, and the sizes of the chunks, are those of
+ * the local model, which should be the same model as that of the server.
+ * Its encoder is loaded but never run.
+ *
+ * The encoder runs of all threads share one connection and are sent one
+ * at a time. RunEncoderBatch() sends the chunks of all streams of a batch
+ * in one request, which the server may batch with those of other clients.
+ * If the connection breaks, it reconnects once per request; the sessions
+ * are kept on the server. Other errors are fatal.
+ */
+class RemoteEncoderModel : public Model {
+ public:
+  RemoteEncoderModel(std::unique_ptr<Model> local, const std::string &address);
+  ~RemoteEncoderModel() override;
+
+  ncnn::Net &GetEncoder() override { return local_->GetEncoder(); }
+  ncnn::Net &GetDecoder() override { return local_->GetDecoder(); }
+  ncnn::Net &GetJoiner() override { return local_->GetJoiner(); }
+
+  // A handle that starts a new session, see RemoteEncoderHandle
+  std::vector<ncnn::Mat> GetEncoderInitStates() const override;
+
+  std::pair<ncnn::Mat, std::vector<ncnn::Mat>> RunEncoder(
+      ncnn::Mat &features, const std::vector<ncnn::Mat> &states) override;
+
+  std::pair<ncnn::Mat, std::vector<ncnn::Mat>> RunEncoder(
+      ncnn::Mat &features, const std::vector<ncnn::Mat> &states,
+      ncnn::Extractor *extractor) override;
+
+  ncnn::Mat RunEncoder(ncnn::Mat &features,
+                       const std::vector<ncnn::Mat> &states,
+                       ncnn::Extractor *extractor,
+                       std::vector<ncnn::Mat> *next_states) override;
+
+  std::vector<ncnn::Mat> RunEncoderBatch(
+      std::vector<ncnn::Mat> &features,
+      const std::vector<const std::vector<ncnn::Mat> *> &states,
+      const std::vector<std::vector<ncnn::Mat> *> &next_states) override;
+
+  ncnn::Mat RunDecoder(ncnn::Mat &decoder_input) override {
+    return local_->RunDecoder(decoder_input);
+  }
+
+  ncnn::Mat RunDecoder(ncnn::Mat &decoder_input,
+                       ncnn::Extractor *extractor) override {
+    return local_->RunDecoder(decoder_input, extractor);
+  }
+
+  ncnn::Mat RunJoiner(ncnn::Mat &encoder_out,
+                      ncnn::Mat &decoder_out) override {
+    return local_->RunJoiner(encoder_out, decoder_out);
+  }
+
+  ncnn::Mat RunJoiner(ncnn::Mat &encoder_out, ncnn::Mat &decoder_out,
+                      ncnn::Extractor *extractor) override {
+    return local_->RunJoiner(encoder_out, decoder_out, extractor);
+  }
+
+  ncnn::Mat RunJoinerRaw(ncnn::Mat &encoder_out,
+                         ncnn::Mat &decoder_out) override {
+    return local_->RunJoinerRaw(encoder_out, decoder_out);
+  }
+
+  int32_t ContextSize() const override { return local_->ContextSize(); }
+
+  int32_t BlankId() const override { return local_->BlankId(); }
+
+  int32_t SubsamplingFactor() const override {
+    return local_->SubsamplingFactor();
+  }
+
+  int32_t Segment() const override { return local_->Segment(); }
+
+  int32_t Offset() const override { return local_->Offset(); }
+
+ private:
+  // Send a request and wait for its response. Return false on error.
+  bool Call(const std::vector<uint8_t> &request,
+            std::vector<RemoteEncoderChunk> *response);
+
+ private:
+  std::unique_ptr<Model> local_;
+  std::string address_;
+
+  std::mutex mutex_;
+  int32_t fd_ = -1;  // the connection, -1 if it is closed
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_REMOTE_ENCODER_H_
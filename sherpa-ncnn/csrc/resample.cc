@@ -28,8 +28,16 @@
 #include <math.h>
 #include <stdio.h>
 
+#include <algorithm>
 #include <cstdlib>
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <tuple>
 #include <type_traits>
+#include <utility>
+
+#include "sherpa-ncnn/csrc/simd.h"
 
 #ifndef M_2PI
 #define M_2PI 6.283185307179586476925286766559005
@@ -73,164 +81,403 @@ I Lcm(I m, I n) {
   return gcd * (m / gcd) * (n / gcd);
 }
 
+#if SHERPA_NCNN_AVX2_KERNELS
+// Return the sum of the lower and upper 4 lanes of v
+SHERPA_NCNN_TARGET_AVX2 static __m128 AddHalves(__m256 v) {
+  return _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+}
+
+// The following two functions process whole blocks of 8 entries at the
+// start of a and b and return the number of entries processed. The four
+// lanes of a result add up to the dot product of these entries.
+
+SHERPA_NCNN_TARGET_AVX2 static int32_t DotProductAvx2(const float *a,
+                                                      const float *b,
+                                                      int32_t n, __m128 *sum) {
+  __m256 sum8 = _mm256_setzero_ps();
+  int32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    sum8 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i),
+                           sum8);
+  }
+  *sum = AddHalves(sum8);
+  return i;
+}
+
+// sum[k] is that of a[k] and b[k], k = 0, 1, 2, 3
+SHERPA_NCNN_TARGET_AVX2 static int32_t DotProduct4Avx2(const float *const *a,
+                                                       const float *const *b,
+                                                       int32_t n,
+                                                       __m128 *sum) {
+  __m256 t0 = _mm256_setzero_ps();
+  __m256 t1 = _mm256_setzero_ps();
+  __m256 t2 = _mm256_setzero_ps();
+  __m256 t3 = _mm256_setzero_ps();
+  int32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    t0 = _mm256_fmadd_ps(_mm256_loadu_ps(a[0] + i), _mm256_loadu_ps(b[0] + i),
+                         t0);
+    t1 = _mm256_fmadd_ps(_mm256_loadu_ps(a[1] + i), _mm256_loadu_ps(b[1] + i),
+                         t1);
+    t2 = _mm256_fmadd_ps(_mm256_loadu_ps(a[2] + i), _mm256_loadu_ps(b[2] + i),
+                         t2);
+    t3 = _mm256_fmadd_ps(_mm256_loadu_ps(a[3] + i), _mm256_loadu_ps(b[3] + i),
+                         t3);
+  }
+  sum[0] = AddHalves(t0);
+  sum[1] = AddHalves(t1);
+  sum[2] = AddHalves(t2);
+  sum[3] = AddHalves(t3);
+  return i;
+}
+#endif
+
+// n must be a multiple of 4
 static float DotProduct(const float *a, const float *b, int32_t n) {
-  float sum = 0;
-  for (int32_t i = 0; i != n; ++i) {
-    sum += a[i] * b[i];
+#if SHERPA_NCNN_NEON
+  float32x4_t sum = vdupq_n_f32(0);
+  for (int32_t i = 0; i != n; i += 4) {
+    sum = vmlaq_f32(sum, vld1q_f32(a + i), vld1q_f32(b + i));
+  }
+#if defined(__aarch64__)
+  return vaddvq_f32(sum);
+#else
+  float32x2_t s = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+  s = vpadd_f32(s, s);
+  return vget_lane_f32(s, 0);
+#endif
+#elif SHERPA_NCNN_WASM_SIMD
+  v128_t sum = wasm_f32x4_splat(0);
+  for (int32_t i = 0; i != n; i += 4) {
+    sum = wasm_f32x4_add(
+        sum, wasm_f32x4_mul(wasm_v128_load(a + i), wasm_v128_load(b + i)));
+  }
+  return wasm_f32x4_extract_lane(sum, 0) + wasm_f32x4_extract_lane(sum, 1) +
+         wasm_f32x4_extract_lane(sum, 2) + wasm_f32x4_extract_lane(sum, 3);
+#elif SHERPA_NCNN_SSE2
+  int32_t i = 0;
+  __m128 sum = _mm_setzero_ps();
+#if SHERPA_NCNN_AVX2_KERNELS
+  if (CpuHasAvx2()) {
+    i = DotProductAvx2(a, b, n, &sum);
+  }
+#endif
+  for (; i != n; i += 4) {
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+  }
+  sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+  sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+  return _mm_cvtss_f32(sum);
+#elif SHERPA_NCNN_RVV
+  // The lanes past the last vl keep their value due to the _tu policy
+  size_t vlmax = __riscv_vsetvlmax_e32m4();
+  vfloat32m4_t sum = __riscv_vfmv_v_f_f32m4(0, vlmax);
+  for (size_t vl, i = 0; i < static_cast<size_t>(n); i += vl) {
+    vl = __riscv_vsetvl_e32m4(n - i);
+    sum = __riscv_vfmacc_vv_f32m4_tu(sum, __riscv_vle32_v_f32m4(a + i, vl),
+                                     __riscv_vle32_v_f32m4(b + i, vl), vl);
+  }
+  return __riscv_vfmv_f_s_f32m1_f32(__riscv_vfredusum_vs_f32m4_f32m1(
+      sum, __riscv_vfmv_s_f_f32m1(0, 1), vlmax));
+#else
+  float sum[4] = {0, 0, 0, 0};
+  for (int32_t i = 0; i != n; i += 4) {
+    sum[0] += a[i] * b[i];
+    sum[1] += a[i + 1] * b[i + 1];
+    sum[2] += a[i + 2] * b[i + 2];
+    sum[3] += a[i + 3] * b[i + 3];
   }
-  return sum;
+  return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+#endif
 }
 
-LinearResample::LinearResample(int32_t samp_rate_in_hz,
-                               int32_t samp_rate_out_hz, float filter_cutoff_hz,
-                               int32_t num_zeros)
-    : samp_rate_in_(samp_rate_in_hz),
-      samp_rate_out_(samp_rate_out_hz),
-      filter_cutoff_(filter_cutoff_hz),
-      num_zeros_(num_zeros) {
+// out[k] = DotProduct(a[k], b[k], n) for k = 0, 1, 2, 3. The four sums use
+// independent accumulators and share one horizontal reduction, which
+// hides the latency of the add chain for short filters.
+static void DotProduct4(const float *const *a, const float *const *b,
+                        int32_t n, float *out) {
+#if SHERPA_NCNN_NEON
+  float32x4_t s0 = vdupq_n_f32(0);
+  float32x4_t s1 = vdupq_n_f32(0);
+  float32x4_t s2 = vdupq_n_f32(0);
+  float32x4_t s3 = vdupq_n_f32(0);
+  for (int32_t i = 0; i != n; i += 4) {
+    s0 = vmlaq_f32(s0, vld1q_f32(a[0] + i), vld1q_f32(b[0] + i));
+    s1 = vmlaq_f32(s1, vld1q_f32(a[1] + i), vld1q_f32(b[1] + i));
+    s2 = vmlaq_f32(s2, vld1q_f32(a[2] + i), vld1q_f32(b[2] + i));
+    s3 = vmlaq_f32(s3, vld1q_f32(a[3] + i), vld1q_f32(b[3] + i));
+  }
+#if defined(__aarch64__)
+  vst1q_f32(out, vpaddq_f32(vpaddq_f32(s0, s1), vpaddq_f32(s2, s3)));
+#else
+  float32x2_t t0 = vpadd_f32(vget_low_f32(s0), vget_high_f32(s0));
+  float32x2_t t1 = vpadd_f32(vget_low_f32(s1), vget_high_f32(s1));
+  float32x2_t t2 = vpadd_f32(vget_low_f32(s2), vget_high_f32(s2));
+  float32x2_t t3 = vpadd_f32(vget_low_f32(s3), vget_high_f32(s3));
+  vst1q_f32(out, vcombine_f32(vpadd_f32(t0, t1), vpadd_f32(t2, t3)));
+#endif
+#elif SHERPA_NCNN_SSE2
+  int32_t i = 0;
+  __m128 s[4] = {_mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(),
+                 _mm_setzero_ps()};
+#if SHERPA_NCNN_AVX2_KERNELS
+  if (CpuHasAvx2()) {
+    i = DotProduct4Avx2(a, b, n, s);
+  }
+#endif
+  __m128 s0 = s[0];
+  __m128 s1 = s[1];
+  __m128 s2 = s[2];
+  __m128 s3 = s[3];
+  for (; i != n; i += 4) {
+    s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(a[0] + i),
+                                   _mm_loadu_ps(b[0] + i)));
+    s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(a[1] + i),
+                                   _mm_loadu_ps(b[1] + i)));
+    s2 = _mm_add_ps(s2, _mm_mul_ps(_mm_loadu_ps(a[2] + i),
+                                   _mm_loadu_ps(b[2] + i)));
+    s3 = _mm_add_ps(s3, _mm_mul_ps(_mm_loadu_ps(a[3] + i),
+                                   _mm_loadu_ps(b[3] + i)));
+  }
+  // Transpose-add so that lane k holds the sum of s_k
+  __m128 s01 = _mm_add_ps(_mm_unpacklo_ps(s0, s1), _mm_unpackhi_ps(s0, s1));
+  __m128 s23 = _mm_add_ps(_mm_unpacklo_ps(s2, s3), _mm_unpackhi_ps(s2, s3));
+  _mm_storeu_ps(out, _mm_add_ps(_mm_movelh_ps(s01, s23),
+                                _mm_movehl_ps(s23, s01)));
+#else
+  for (int32_t k = 0; k != 4; ++k) {
+    out[k] = DotProduct(a[k], b[k], n);
+  }
+#endif
+}
+
+/** Here, t is a time in seconds representing an offset from
+    the center of the windowed filter function, and FilterFunction(t)
+    returns the windowed filter function, described
+    in the header as h(t) = f(t)g(t), evaluated at t.
+*/
+static float FilterFunc(float filter_cutoff, int32_t num_zeros, float t) {
+  float window,  // raised-cosine (Hanning) window of width
+                 // num_zeros/2*filter_cutoff
+      filter;    // sinc filter function
+  if (fabs(t) < num_zeros / (2.0 * filter_cutoff))
+    window = 0.5 * (1 + cos(M_2PI * filter_cutoff / num_zeros * t));
+  else
+    window = 0.0;  // outside support of window function
+  if (t != 0)
+    filter = sin(M_2PI * filter_cutoff * t) / (M_PI * t);
+  else
+    filter = 2 * filter_cutoff;  // limit of the function at t = 0
+  return filter * window;
+}
+
+static std::shared_ptr<ResampleKernel> ComputeKernel(
+    int32_t samp_rate_in_hz, int32_t samp_rate_out_hz, float filter_cutoff_hz,
+    int32_t num_zeros) {
   assert(samp_rate_in_hz > 0.0 && samp_rate_out_hz > 0.0 &&
          filter_cutoff_hz > 0.0 && filter_cutoff_hz * 2 <= samp_rate_in_hz &&
          filter_cutoff_hz * 2 <= samp_rate_out_hz && num_zeros > 0);
 
+  auto kernel = std::make_shared<ResampleKernel>();
+  kernel->samp_rate_in = samp_rate_in_hz;
+  kernel->samp_rate_out = samp_rate_out_hz;
+  kernel->filter_cutoff = filter_cutoff_hz;
+  kernel->num_zeros = num_zeros;
+
   // base_freq is the frequency of the repeating unit, which is the gcd
   // of the input frequencies.
-  int32_t base_freq = Gcd(samp_rate_in_, samp_rate_out_);
-  input_samples_in_unit_ = samp_rate_in_ / base_freq;
-  output_samples_in_unit_ = samp_rate_out_ / base_freq;
+  int32_t base_freq = Gcd(samp_rate_in_hz, samp_rate_out_hz);
+  int32_t output_samples_in_unit = samp_rate_out_hz / base_freq;
+  kernel->input_samples_in_unit = samp_rate_in_hz / base_freq;
+  kernel->output_samples_in_unit = output_samples_in_unit;
 
-  SetIndexesAndWeights();
-  Reset();
-}
+  kernel->first_index.resize(output_samples_in_unit);
+  std::vector<std::vector<float>> weights(output_samples_in_unit);
 
-void LinearResample::SetIndexesAndWeights() {
-  first_index_.resize(output_samples_in_unit_);
-  weights_.resize(output_samples_in_unit_);
+  double window_width = num_zeros / (2.0 * filter_cutoff_hz);
 
-  double window_width = num_zeros_ / (2.0 * filter_cutoff_);
-
-  for (int32_t i = 0; i < output_samples_in_unit_; i++) {
-    double output_t = i / static_cast<double>(samp_rate_out_);
+  for (int32_t i = 0; i < output_samples_in_unit; i++) {
+    double output_t = i / static_cast<double>(samp_rate_out_hz);
     double min_t = output_t - window_width, max_t = output_t + window_width;
     // we do ceil on the min and floor on the max, because if we did it
     // the other way around we would unnecessarily include indexes just
     // outside the window, with zero coefficients.  It's possible
     // if the arguments to the ceil and floor expressions are integers
-    // (e.g. if filter_cutoff_ has an exact ratio with the sample rates),
+    // (e.g. if filter_cutoff_hz has an exact ratio with the sample rates),
     // that we unnecessarily include something with a zero coefficient,
     // but this is only a slight efficiency issue.
-    int32_t min_input_index = ceil(min_t * samp_rate_in_),
-            max_input_index = floor(max_t * samp_rate_in_),
+    int32_t min_input_index = ceil(min_t * samp_rate_in_hz),
+            max_input_index = floor(max_t * samp_rate_in_hz),
             num_indices = max_input_index - min_input_index + 1;
-    first_index_[i] = min_input_index;
-    weights_[i].resize(num_indices);
+    kernel->first_index[i] = min_input_index;
+    weights[i].resize(num_indices);
     for (int32_t j = 0; j < num_indices; j++) {
       int32_t input_index = min_input_index + j;
-      double input_t = input_index / static_cast<double>(samp_rate_in_),
+      double input_t = input_index / static_cast<double>(samp_rate_in_hz),
              delta_t = input_t - output_t;
       // sign of delta_t doesn't matter.
-      weights_[i][j] = FilterFunc(delta_t) / samp_rate_in_;
+      weights[i][j] = FilterFunc(filter_cutoff_hz, num_zeros, delta_t) /
+                      samp_rate_in_hz;
     }
   }
+
+  // Flatten the filter bank. With the cutoff and num_zeros used by
+  // FeatureExtractor, 8 kHz -> 16 kHz has 2 phases of 16 taps and
+  // 48 kHz -> 16 kHz has a single phase of 40 taps, after padding.
+  int32_t num_taps = 0;
+  for (const auto &w : weights) {
+    num_taps = std::max<int32_t>(num_taps, w.size());
+  }
+  num_taps = (num_taps + 3) / 4 * 4;
+  kernel->num_taps = num_taps;
+
+  kernel->weights.assign(output_samples_in_unit * num_taps, 0);
+  for (int32_t i = 0; i < output_samples_in_unit; i++) {
+    std::copy(weights[i].begin(), weights[i].end(),
+              kernel->weights.begin() + i * num_taps);
+  }
+
+  return kernel;
 }
 
-/** Here, t is a time in seconds representing an offset from
-    the center of the windowed filter function, and FilterFunction(t)
-    returns the windowed filter function, described
-    in the header as h(t) = f(t)g(t), evaluated at t.
-*/
-float LinearResample::FilterFunc(float t) const {
-  float window,  // raised-cosine (Hanning) window of width
-                 // num_zeros_/2*filter_cutoff_
-      filter;    // sinc filter function
-  if (fabs(t) < num_zeros_ / (2.0 * filter_cutoff_))
-    window = 0.5 * (1 + cos(M_2PI * filter_cutoff_ / num_zeros_ * t));
-  else
-    window = 0.0;  // outside support of window function
-  if (t != 0)
-    filter = sin(M_2PI * filter_cutoff_ * t) / (M_PI * t);
-  else
-    filter = 2 * filter_cutoff_;  // limit of the function at t = 0
-  return filter * window;
+std::shared_ptr<const ResampleKernel> GetResampleKernel(
+    int32_t samp_rate_in_hz, int32_t samp_rate_out_hz, float filter_cutoff_hz,
+    int32_t num_zeros) {
+  using Key = std::tuple<int32_t, int32_t, float, int32_t>;
+
+  // Kernels are dropped once no resampler uses them, so that odd rates
+  // seen once do not stay in memory
+  static std::mutex mutex;
+  static std::map<Key, std::weak_ptr<const ResampleKernel>> cache;
+
+  Key key{samp_rate_in_hz, samp_rate_out_hz, filter_cutoff_hz, num_zeros};
+
+  std::lock_guard<std::mutex> lock(mutex);
+  std::shared_ptr<const ResampleKernel> kernel = cache[key].lock();
+  if (!kernel) {
+    kernel = ComputeKernel(samp_rate_in_hz, samp_rate_out_hz,
+                           filter_cutoff_hz, num_zeros);
+    cache[key] = kernel;
+  }
+
+  return kernel;
+}
+
+LinearResample::LinearResample(int32_t samp_rate_in_hz,
+                               int32_t samp_rate_out_hz, float filter_cutoff_hz,
+                               int32_t num_zeros)
+    : LinearResample(GetResampleKernel(samp_rate_in_hz, samp_rate_out_hz,
+                                       filter_cutoff_hz, num_zeros)) {}
+
+LinearResample::LinearResample(std::shared_ptr<const ResampleKernel> kernel)
+    : kernel_(std::move(kernel)) {
+  Reset();
 }
 
 void LinearResample::Reset() {
   input_sample_offset_ = 0;
   output_sample_offset_ = 0;
-  input_remainder_.resize(0);
+
+  // Input samples before the beginning of the signal are zero.
+  // first_index[0] is the smallest first index of all phases.
+  buffer_start_ = std::min<int64_t>(0, kernel_->first_index[0]);
+  buffer_.assign(-buffer_start_, 0);
 }
 
 void LinearResample::Resample(const float *input, int32_t input_dim, bool flush,
                               std::vector<float> *output) {
+  const ResampleKernel &kernel = *kernel_;
+  int32_t num_taps = kernel.num_taps;
+  int32_t output_samples_in_unit = kernel.output_samples_in_unit;
+
   int64_t tot_input_samp = input_sample_offset_ + input_dim,
           tot_output_samp = GetNumOutputSamples(tot_input_samp, flush);
 
   assert(tot_output_samp >= output_sample_offset_);
 
+  // buffer_ now holds input samples [buffer_start_, tot_input_samp),
+  // followed by num_taps zeros. The zeros are what the filter sees past
+  // the end of the signal when flushing. They also cover the zero padding
+  // of the weights, so no output sample needs a bounds check.
+  buffer_.insert(buffer_.end(), input, input + input_dim);
+  buffer_.resize(buffer_.size() + num_taps, 0);
+
   output->resize(tot_output_samp - output_sample_offset_);
 
   // samp_out is the index into the total output signal, not just the part
   // of it we are producing here.
-  for (int64_t samp_out = output_sample_offset_; samp_out < tot_output_samp;
-       samp_out++) {
-    int64_t first_samp_in;
-    int32_t samp_out_wrapped;
-    GetIndexes(samp_out, &first_samp_in, &samp_out_wrapped);
-    const std::vector<float> &weights = weights_[samp_out_wrapped];
-    // first_input_index is the first index into "input" that we have a weight
-    // for.
-    int32_t first_input_index =
-        static_cast<int32_t>(first_samp_in - input_sample_offset_);
-    float this_output;
-    if (first_input_index >= 0 &&
-        first_input_index + static_cast<int32_t>(weights.size()) <= input_dim) {
-      this_output =
-          DotProduct(input + first_input_index, weights.data(), weights.size());
-    } else {  // Handle edge cases.
-      this_output = 0.0;
-      for (int32_t i = 0; i < static_cast<int32_t>(weights.size()); i++) {
-        float weight = weights[i];
-        int32_t input_index = first_input_index + i;
-        if (input_index < 0 &&
-            static_cast<int32_t>(input_remainder_.size()) + input_index >= 0) {
-          this_output +=
-              weight * input_remainder_[input_remainder_.size() + input_index];
-        } else if (input_index >= 0 && input_index < input_dim) {
-          this_output += weight * input[input_index];
-        } else if (input_index >= input_dim) {
-          // We're past the end of the input and are adding zero; should only
-          // happen if the user specified flush == true, or else we would not
-          // be trying to output this sample.
-          assert(flush);
-        }
-      }
+  int64_t unit_index = output_sample_offset_ / output_samples_in_unit;
+  int32_t samp_out_wrapped = static_cast<int32_t>(
+      output_sample_offset_ - unit_index * output_samples_in_unit);
+
+  // Return the input and the weights of the next output sample
+  auto next = [&](const float **in, const float **weights) {
+    int64_t first_samp_in = kernel.first_index[samp_out_wrapped] +
+                            unit_index * kernel.input_samples_in_unit;
+    *in = buffer_.data() + (first_samp_in - buffer_start_);
+    *weights = kernel.weights.data() + samp_out_wrapped * num_taps;
+
+    if (++samp_out_wrapped == output_samples_in_unit) {
+      samp_out_wrapped = 0;
+      ++unit_index;
     }
-    int32_t output_index =
-        static_cast<int32_t>(samp_out - output_sample_offset_);
-    (*output)[output_index] = this_output;
+  };
+
+  float *out = output->data();
+  int32_t num_out = static_cast<int32_t>(output->size());
+  int32_t i = 0;
+  for (; i + 4 <= num_out; i += 4) {
+    const float *in[4];
+    const float *weights[4];
+    for (int32_t k = 0; k != 4; ++k) {
+      next(&in[k], &weights[k]);
+    }
+    DotProduct4(in, weights, num_taps, out + i);
+  }
+
+  for (; i < num_out; ++i) {
+    const float *in;
+    const float *weights;
+    next(&in, &weights);
+    out[i] = DotProduct(in, weights, num_taps);
   }
 
   if (flush) {
     Reset();  // Reset the internal state.
-  } else {
-    SetRemainder(input, input_dim);
-    input_sample_offset_ = tot_input_samp;
-    output_sample_offset_ = tot_output_samp;
+    return;
   }
+
+  buffer_.resize(buffer_.size() - num_taps);
+  input_sample_offset_ = tot_input_samp;
+  output_sample_offset_ = tot_output_samp;
+
+  // Keep only the input samples from the first one that the next output
+  // sample needs. First indexes increase with the output index.
+  int64_t first_samp_in;
+  GetIndexes(tot_output_samp, &first_samp_in, &samp_out_wrapped);
+
+  int64_t keep_from = std::min(std::max(first_samp_in, buffer_start_),
+                               tot_input_samp);
+  buffer_.erase(buffer_.begin(), buffer_.begin() + (keep_from - buffer_start_));
+  buffer_start_ = keep_from;
 }
 
 int64_t LinearResample::GetNumOutputSamples(int64_t input_num_samp,
                                             bool flush) const {
+  int32_t samp_rate_in = kernel_->samp_rate_in;
+  int32_t samp_rate_out = kernel_->samp_rate_out;
+
   // For exact computation, we measure time in "ticks" of 1.0 / tick_freq,
-  // where tick_freq is the least common multiple of samp_rate_in_ and
-  // samp_rate_out_.
-  int32_t tick_freq = Lcm(samp_rate_in_, samp_rate_out_);
-  int32_t ticks_per_input_period = tick_freq / samp_rate_in_;
+  // where tick_freq is the least common multiple of samp_rate_in and
+  // samp_rate_out.
+  int32_t tick_freq = Lcm(samp_rate_in, samp_rate_out);
+  int32_t ticks_per_input_period = tick_freq / samp_rate_in;
 
   // work out the number of ticks in the time interval
-  // [ 0, input_num_samp/samp_rate_in_ ).
+  // [ 0, input_num_samp/samp_rate_in ).
   int64_t interval_length_in_ticks = input_num_samp * ticks_per_input_period;
   if (!flush) {
-    float window_width = num_zeros_ / (2.0 * filter_cutoff_);
+    float window_width = kernel_->num_zeros / (2.0 * kernel_->filter_cutoff);
     // To count the window-width in ticks we take the floor.  This
     // is because since we're looking for the largest integer num-out-samp
     // that fits in the interval, which is open on the right, a reduction
@@ -248,7 +495,7 @@ int64_t LinearResample::GetNumOutputSamples(int64_t input_num_samp,
   }
   if (interval_length_in_ticks <= 0) return 0;
 
-  int32_t ticks_per_output_period = tick_freq / samp_rate_out_;
+  int32_t ticks_per_output_period = tick_freq / samp_rate_out;
   // Get the last output-sample in the closed interval, i.e. replacing [ ) with
   // [ ].  Note: integer division rounds down.  See
   // http://en.wikipedia.org/wiki/Interval_(mathematics) for an explanation of
@@ -271,39 +518,13 @@ void LinearResample::GetIndexes(int64_t samp_out, int64_t *first_samp_in,
   // A unit is the smallest nonzero amount of time that is an exact
   // multiple of the input and output sample periods.  The unit index
   // is the answer to "which numbered unit we are in".
-  int64_t unit_index = samp_out / output_samples_in_unit_;
-  // samp_out_wrapped is equal to samp_out % output_samples_in_unit_
+  int32_t output_samples_in_unit = kernel_->output_samples_in_unit;
+  int64_t unit_index = samp_out / output_samples_in_unit;
+  // samp_out_wrapped is equal to samp_out % output_samples_in_unit
   *samp_out_wrapped =
-      static_cast<int32_t>(samp_out - unit_index * output_samples_in_unit_);
-  *first_samp_in =
-      first_index_[*samp_out_wrapped] + unit_index * input_samples_in_unit_;
-}
-
-void LinearResample::SetRemainder(const float *input, int32_t input_dim) {
-  std::vector<float> old_remainder(input_remainder_);
-  // max_remainder_needed is the width of the filter from side to side,
-  // measured in input samples.  you might think it should be half that,
-  // but you have to consider that you might be wanting to output samples
-  // that are "in the past" relative to the beginning of the latest
-  // input... anyway, storing more remainder than needed is not harmful.
-  int32_t max_remainder_needed =
-      ceil(samp_rate_in_ * num_zeros_ / filter_cutoff_);
-  input_remainder_.resize(max_remainder_needed);
-  for (int32_t index = -static_cast<int32_t>(input_remainder_.size());
-       index < 0; index++) {
-    // we interpret "index" as an offset from the end of "input" and
-    // from the end of input_remainder_.
-    int32_t input_index = index + input_dim;
-    if (input_index >= 0) {
-      input_remainder_[index + static_cast<int32_t>(input_remainder_.size())] =
-          input[input_index];
-    } else if (input_index + static_cast<int32_t>(old_remainder.size()) >= 0) {
-      input_remainder_[index + static_cast<int32_t>(input_remainder_.size())] =
-          old_remainder[input_index +
-                        static_cast<int32_t>(old_remainder.size())];
-      // else leave it at zero.
-    }
-  }
+      static_cast<int32_t>(samp_out - unit_index * output_samples_in_unit);
+  *first_samp_in = kernel_->first_index[*samp_out_wrapped] +
+                   unit_index * kernel_->input_samples_in_unit;
 }
 
 }  // namespace sherpa_ncnn
@@ -25,6 +25,7 @@
 #define SHERPA_NCNN_CSRC_RESAMPLE_H_
 
 #include <cstdint>
+#include <memory>
 #include <vector>
 
 namespace sherpa_ncnn {
@@ -34,6 +35,47 @@ namespace sherpa_ncnn {
    integers, as this is an easy way to specify that their ratio be rational.
 */
 
+/// The filter bank of LinearResample. It depends only on the arguments of
+/// GetResampleKernel() and is never modified, so one kernel is shared by
+/// all resamplers with the same arguments, e.g., by all streams that get
+/// 8 kHz audio.
+struct ResampleKernel {
+  int32_t samp_rate_in;
+  int32_t samp_rate_out;
+  float filter_cutoff;
+  int32_t num_zeros;
+
+  /// The number of input samples in the smallest repeating unit, i.e.,
+  /// samp_rate_in / Gcd(samp_rate_in, samp_rate_out)
+  int32_t input_samples_in_unit;
+
+  /// The number of output samples in the smallest repeating unit, i.e.,
+  /// samp_rate_out / Gcd(samp_rate_in, samp_rate_out)
+  int32_t output_samples_in_unit;
+
+  /// The first input-sample index that we sum over, for this output-sample
+  /// index.  May be negative; any truncation at the beginning is handled
+  /// separately.  This is just for the first few output samples, but we can
+  /// extrapolate the correct input-sample index for arbitrary output samples.
+  std::vector<int32_t> first_index;
+
+  /// Weights on the input samples, for this output-sample index. It is a
+  /// row-major matrix of shape (output_samples_in_unit, num_taps). Every
+  /// row is padded with zeros to num_taps, a multiple of 4, so that each
+  /// output sample is a SIMD dot product of the same length.
+  std::vector<float> weights;
+  int32_t num_taps;
+};
+
+/// Return the kernel for the given arguments, see LinearResample. It is
+/// computed on the first call and cached for the process as long as some
+/// resampler uses it. It is thread-safe.
+std::shared_ptr<const ResampleKernel> GetResampleKernel(
+    int32_t samp_rate_in_hz, int32_t samp_rate_out_hz, float filter_cutoff_hz,
+    int32_t num_zeros);
+
+/// A resampler holds only the state of the signal it is processing. Its
+/// filter bank is a shared ResampleKernel.
 class LinearResample {
  public:
   /// Constructor.  We make the input and output sample rates integers, because
@@ -45,6 +87,8 @@ class LinearResample {
   LinearResample(int32_t samp_rate_in_hz, int32_t samp_rate_out_hz,
                  float filter_cutoff_hz, int32_t num_zeros);
 
+  explicit LinearResample(std::shared_ptr<const ResampleKernel> kernel);
+
   /// Calling the function Reset() resets the state of the object prior to
   /// processing a new signal; it is only necessary if you have called
   /// Resample(x, x_size, false, y) for some signal, leading to a remainder of
@@ -74,14 +118,14 @@ class LinearResample {
                 std::vector<float> *output);
 
   //// Return the input and output sampling rates (for checks, for example)
-  int32_t GetInputSamplingRate() const { return samp_rate_in_; }
-  int32_t GetOutputSamplingRate() const { return samp_rate_out_; }
+  int32_t GetInputSamplingRate() const { return kernel_->samp_rate_in; }
+  int32_t GetOutputSamplingRate() const { return kernel_->samp_rate_out; }
 
- private:
-  void SetIndexesAndWeights();
-
-  float FilterFunc(float) const;
+  const std::shared_ptr<const ResampleKernel> &GetKernel() const {
+    return kernel_;
+  }
 
+ private:
   /// This function outputs the number of output samples we will output
   /// for a signal with "input_num_samp" input samples.  If flush == true,
   /// we return the largest n such that
@@ -94,38 +138,13 @@ class LinearResample {
 
   /// Given an output-sample index, this function outputs to *first_samp_in the
   /// first input-sample index that we have a weight on (may be negative),
-  /// and to *samp_out_wrapped the index into weights_ where we can get the
+  /// and to *samp_out_wrapped the index into the weights where we can get the
   /// corresponding weights on the input.
   inline void GetIndexes(int64_t samp_out, int64_t *first_samp_in,
                          int32_t *samp_out_wrapped) const;
 
-  void SetRemainder(const float *input, int32_t input_dim);
-
  private:
-  // The following variables are provided by the user.
-  int32_t samp_rate_in_;
-  int32_t samp_rate_out_;
-  float filter_cutoff_;
-  int32_t num_zeros_;
-
-  int32_t input_samples_in_unit_;  ///< The number of input samples in the
-                                   ///< smallest repeating unit: num_samp_in_ =
-                                   ///< samp_rate_in_hz / Gcd(samp_rate_in_hz,
-                                   ///< samp_rate_out_hz)
-
-  int32_t output_samples_in_unit_;  ///< The number of output samples in the
-                                    ///< smallest repeating unit: num_samp_out_
-                                    ///< = samp_rate_out_hz /
-                                    ///< Gcd(samp_rate_in_hz, samp_rate_out_hz)
-
-  /// The first input-sample index that we sum over, for this output-sample
-  /// index.  May be negative; any truncation at the beginning is handled
-  /// separately.  This is just for the first few output samples, but we can
-  /// extrapolate the correct input-sample index for arbitrary output samples.
-  std::vector<int32_t> first_index_;
-
-  /// Weights on the input samples, for this output-sample index.
-  std::vector<std::vector<float>> weights_;
+  std::shared_ptr<const ResampleKernel> kernel_;
 
   // the following variables keep track of where we are in a particular signal,
   // if it is being provided over multiple calls to Resample().
@@ -135,8 +154,13 @@ class LinearResample {
                                   ///< (including anything in remainder_)
   int64_t output_sample_offset_;  ///< The number of samples we have already
                                   ///< output for this signal.
-  std::vector<float> input_remainder_;  ///< A small trailing part of the
-                                        ///< previously seen input signal.
+  /// The input samples that are still needed by future output samples.
+  /// buffer_[0] is input sample buffer_start_, which is negative at the
+  /// beginning of a signal, where buffer_ starts with zeros. Its capacity
+  /// is kept across calls, so Resample() does not allocate once it has
+  /// seen the largest input.
+  std::vector<float> buffer_;
+  int64_t buffer_start_;
 };
 
 }  // namespace sherpa_ncnn
@@ -0,0 +1,280 @@
+// sherpa-ncnn/csrc/session-recorder.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/session-recorder.h"
+
+#include <stdio.h>
+
+#include <chrono>  // NOLINT
+#include <cstdlib>
+#include <cstring>
+#include <mutex>  // NOLINT
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/macros.h"
+#include "sherpa-ncnn/csrc/stream.h"
+
+namespace sherpa_ncnn {
+
+namespace {
+
+constexpr char kMagic[4] = {'S', 'N', 'R', 'S'};
+constexpr uint32_t kVersion = 1;
+
+struct RecorderState {
+  std::mutex mutex;
+  FILE *fp = nullptr;
+  std::string filename;
+  StageClock::time_point origin;
+  bool failed = false;
+};
+
+RecorderState &GetState() {
+  static RecorderState state;
+  return state;
+}
+
+// Record the header of an event. The caller must hold state.mutex.
+void WriteHeader(RecorderState *state, SessionEventType type,
+                 StageClock::time_point time, int64_t stream_id) {
+  auto t = static_cast<uint8_t>(type);
+  int64_t time_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                        time - state->origin)
+                        .count();
+
+  bool ok = fwrite(&t, sizeof(t), 1, state->fp) == 1 &&
+            fwrite(&time_us, sizeof(time_us), 1, state->fp) == 1 &&
+            fwrite(&stream_id, sizeof(stream_id), 1, state->fp) == 1;
+  state->failed = state->failed || !ok;
+}
+
+template <typename T>
+void Write(RecorderState *state, const T *p, int32_t n = 1) {
+  if (n > 0 && fwrite(p, sizeof(T), n, state->fp) != static_cast<size_t>(n)) {
+    state->failed = true;
+  }
+}
+
+template <typename T>
+bool Read(FILE *fp, T *p, int32_t n = 1) {
+  return n == 0 || fread(p, sizeof(T), n, fp) == static_cast<size_t>(n);
+}
+
+// Start recording if SHERPA_NCNN_RECORD is set and close the file at exit
+struct AutoStart {
+  AutoStart() {
+    // Construct the state first so that it is destroyed after this object
+    GetState();
+
+    const char *filename = std::getenv("SHERPA_NCNN_RECORD");
+    if (filename && *filename) {
+      SessionRecorder::Start(filename);
+    }
+  }
+
+  ~AutoStart() {
+    if (SessionRecorder::Enabled()) {
+      SessionRecorder::Stop();
+    }
+  }
+};
+
+}  // namespace
+
+std::atomic<bool> SessionRecorder::enabled_{false};
+
+static AutoStart auto_start;
+
+bool SessionRecorder::Start(const std::string &filename) {
+  if (Enabled()) {
+    Stop();
+  }
+
+  RecorderState &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+
+  state.fp = fopen(filename.c_str(), "wb");
+  if (!state.fp) {
+    SHERPA_NCNN_LOGE("Failed to open %s for the recording", filename.c_str());
+    return false;
+  }
+
+  state.filename = filename;
+  state.origin = StageClock::now();
+  state.failed = false;
+  Write(&state, kMagic, 4);
+  Write(&state, &kVersion);
+
+  enabled_ = true;
+  return true;
+}
+
+bool SessionRecorder::Stop() {
+  RecorderState &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+
+  if (!enabled_) {
+    return false;
+  }
+  enabled_ = false;
+
+  bool ok = fclose(state.fp) == 0 && !state.failed;
+  state.fp = nullptr;
+
+  if (!ok) {
+    SHERPA_NCNN_LOGE("Failed to write the recording to %s",
+                     state.filename.c_str());
+  }
+
+  return ok;
+}
+
+void SessionRecorder::Record(SessionEventType type, int64_t stream_id) {
+  auto now = StageClock::now();
+
+  RecorderState &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  if (!enabled_) {
+    return;
+  }
+
+  WriteHeader(&state, type, now, stream_id);
+}
+
+void SessionRecorder::RecordResult(SessionEventType type, int64_t stream_id,
+                                   bool result) {
+  auto now = StageClock::now();
+  uint8_t r = result;
+
+  RecorderState &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  if (!enabled_) {
+    return;
+  }
+
+  WriteHeader(&state, type, now, stream_id);
+  Write(&state, &r);
+}
+
+void SessionRecorder::RecordWaveform(int64_t stream_id,
+                                     int32_t sampling_rate,
+                                     const float *samples, int32_t n) {
+  auto now = StageClock::now();
+
+  RecorderState &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  if (!enabled_) {
+    return;
+  }
+
+  WriteHeader(&state, SessionEventType::kAcceptWaveform, now, stream_id);
+  Write(&state, &sampling_rate);
+  Write(&state, &n);
+  Write(&state, samples, n);
+}
+
+void SessionRecorder::RecordDecode(SessionEventType type, Stream **ss,
+                                   int32_t n, StageClock::time_point start,
+                                   StageClock::time_point end) {
+  std::vector<int64_t> ids(n);
+  for (int32_t i = 0; i != n; ++i) {
+    ids[i] = ss[i]->GetId();
+  }
+
+  int64_t duration_us =
+      std::chrono::duration_cast<std::chrono::microseconds>(end - start)
+          .count();
+
+  RecorderState &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  if (!enabled_) {
+    return;
+  }
+
+  WriteHeader(&state, type, start, -1);
+  Write(&state, &n);
+  Write(&state, ids.data(), n);
+  Write(&state, &duration_us);
+}
+
+bool ReadSession(const std::string &filename,
+                 std::vector<SessionEvent> *events) {
+  FILE *fp = fopen(filename.c_str(), "rb");
+  if (!fp) {
+    SHERPA_NCNN_LOGE("Failed to open %s", filename.c_str());
+    return false;
+  }
+
+  char magic[4];
+  uint32_t version = 0;
+  if (!Read(fp, magic, 4) || std::memcmp(magic, kMagic, 4) != 0 ||
+      !Read(fp, &version) || version != kVersion) {
+    SHERPA_NCNN_LOGE("%s is not a recording of version %d", filename.c_str(),
+                     static_cast<int32_t>(kVersion));
+    fclose(fp);
+    return false;
+  }
+
+  events->clear();
+
+  bool ok = true;
+  uint8_t type = 0;
+  while (ok && Read(fp, &type)) {
+    SessionEvent e;
+    e.type = static_cast<SessionEventType>(type);
+    ok = Read(fp, &e.time_us) && Read(fp, &e.stream_id);
+
+    int32_t n = 0;
+    uint8_t result = 0;
+    switch (e.type) {
+      case SessionEventType::kCreateStream:
+      case SessionEventType::kDestroyStream:
+      case SessionEventType::kInputFinished:
+      case SessionEventType::kGetResult:
+      case SessionEventType::kReset:
+        break;
+      case SessionEventType::kAcceptWaveform:
+        ok = ok && Read(fp, &e.sampling_rate) && Read(fp, &n) && n >= 0;
+        if (ok) {
+          e.samples.resize(n);
+          ok = Read(fp, e.samples.data(), n);
+        }
+        break;
+      case SessionEventType::kIsReady:
+      case SessionEventType::kIsEndpoint:
+        ok = ok && Read(fp, &result);
+        e.result = result;
+        break;
+      case SessionEventType::kDecodeStreams:
+      case SessionEventType::kDecodeReadyStreams:
+      case SessionEventType::kDecodeRemainingFrames:
+        ok = ok && Read(fp, &n) && n >= 0;
+        if (ok) {
+          e.stream_ids.resize(n);
+          ok = Read(fp, e.stream_ids.data(), n) && Read(fp, &e.duration_us);
+        }
+        break;
+      default:
+        ok = false;
+        break;
+    }
+
+    if (ok) {
+      events->push_back(std::move(e));
+    }
+  }
+
+  fclose(fp);
+
+  if (!ok) {
+    SHERPA_NCNN_LOGE("%s is truncated or corrupted after %d events",
+                     filename.c_str(), static_cast<int32_t>(events->size()));
+  }
+
+  return ok;
+}
+
+}  // namespace sherpa_ncnn
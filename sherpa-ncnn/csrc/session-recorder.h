@@ -0,0 +1,122 @@
+// sherpa-ncnn/csrc/session-recorder.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_SESSION_RECORDER_H_
+#define SHERPA_NCNN_CSRC_SESSION_RECORDER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/latency-stats.h"
+
+namespace sherpa_ncnn {
+
+class Stream;
+
+enum class SessionEventType : uint8_t {
+  kCreateStream = 0,
+  kDestroyStream = 1,
+  kAcceptWaveform = 2,
+  kInputFinished = 3,
+  kIsReady = 4,
+  kDecodeStreams = 5,
+  kDecodeReadyStreams = 6,
+  kGetResult = 7,
+  kIsEndpoint = 8,
+  kReset = 9,
+  kDecodeRemainingFrames = 10,
+};
+
+struct SessionEvent {
+  SessionEventType type = SessionEventType::kCreateStream;
+
+  // When the call started, in microseconds since SessionRecorder::Start()
+  int64_t time_us = 0;
+
+  // Stream::GetId() of the stream of the call. -1 for the decode calls,
+  // which have stream_ids instead.
+  int64_t stream_id = -1;
+
+  // kAcceptWaveform only
+  int32_t sampling_rate = 0;
+  std::vector<float> samples;
+
+  // kDecodeStreams, kDecodeReadyStreams and kDecodeRemainingFrames only
+  std::vector<int64_t> stream_ids;
+  int64_t duration_us = 0;
+
+  // The return value of kIsReady and kIsEndpoint
+  bool result = false;
+};
+
+/** A process-wide recorder of the calls to the streaming API, i.e., the
+ * audio passed to Stream::AcceptWaveform() and the calls to IsReady(),
+ * DecodeStreams(), GetResult(), IsEndpoint() and Reset() of Recognizer,
+ * with the time of each call and how long each decode call took.
+ *
+ * sherpa-ncnn-replay re-runs a recording against another build at the
+ * original or a faster pace and compares the latencies of the decode
+ * calls, so that a latency problem seen with live traffic can be
+ * reproduced and a fix measured.
+ *
+ * The file has a header, "SNRS" and a uint32 version, followed by one
+ * record per call, see SessionEvent. Each record is the type as a uint8,
+ * time_us and stream_id as int64 and then, depending on the type:
+ *
+ *   kAcceptWaveform       int32 sampling_rate, int32 n, n float samples
+ *   kIsReady, kIsEndpoint uint8 result
+ *   kDecode*              int32 n, n int64 stream ids, int64 duration_us
+ *
+ * Numbers are in the byte order of the recording machine. Audio takes 4
+ * bytes per sample, so a recording is about as large as the same audio
+ * as float wave files.
+ *
+ * Recording is off by default and costs one atomic load per call then.
+ * Set the environment variable SHERPA_NCNN_RECORD to a filename to record
+ * from the start of the process until it exits, or call Start() and
+ * Stop(). It is thread-safe. Records of calls from several threads are
+ * written in the order the calls finish.
+ */
+class SessionRecorder {
+ public:
+  // Start recording to filename. A recording in progress is stopped
+  // first. Return false if the file cannot be opened.
+  static bool Start(const std::string &filename);
+
+  // Stop recording and close the file. Return false if it is not
+  // recording or the file cannot be written.
+  static bool Stop();
+
+  static bool Enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+  // Record a call without arguments, e.g., kReset
+  static void Record(SessionEventType type, int64_t stream_id);
+
+  // Record a call that returns a bool, i.e., kIsReady and kIsEndpoint
+  static void RecordResult(SessionEventType type, int64_t stream_id,
+                           bool result);
+
+  static void RecordWaveform(int64_t stream_id, int32_t sampling_rate,
+                             const float *samples, int32_t n);
+
+  // Record a call of DecodeStreams(), DecodeReadyStreams() or
+  // DecodeRemainingFrames() that ran from start to end
+  static void RecordDecode(SessionEventType type, Stream **ss, int32_t n,
+                           StageClock::time_point start,
+                           StageClock::time_point end);
+
+ private:
+  static std::atomic<bool> enabled_;
+};
+
+// Read a file written by SessionRecorder. Return false if it cannot be
+// read or is not a recording.
+bool ReadSession(const std::string &filename,
+                 std::vector<SessionEvent> *events);
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_SESSION_RECORDER_H_
@@ -0,0 +1,176 @@
+// sherpa-ncnn/csrc/sherpa-ncnn-alsa-multi-channel.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/alsa-capture.h"
+#include "sherpa-ncnn/csrc/parse-options.h"
+#include "sherpa-ncnn/csrc/recognizer.h"
+
+static std::atomic<bool> stop{false};
+
+static void Handler(int32_t sig) {
+  stop = true;
+  fprintf(stderr, "\nCaught Ctrl + C. Exiting...\n");
+}
+
+int32_t main(int32_t argc, char *argv[]) {
+  const char *kUsageMessage = R"usage(
+Recognize each channel of an ALSA capture device as a separate stream.
+
+Audio is captured on a dedicated thread from the memory-mapped buffer of
+the device, see AlsaCapture, so that decoding that stalls for up to
+--buffer-seconds loses no samples. The streams of all channels are
+decoded together in batches.
+
+Usage:
+
+  ./bin/sherpa-ncnn-alsa-multi-channel \
+    --tokens=/path/to/tokens.txt \
+    --encoder-param=/path/to/encoder.ncnn.param \
+    --encoder-bin=/path/to/encoder.ncnn.bin \
+    --decoder-param=/path/to/decoder.ncnn.param \
+    --decoder-bin=/path/to/decoder.ncnn.bin \
+    --joiner-param=/path/to/joiner.ncnn.param \
+    --joiner-bin=/path/to/joiner.ncnn.bin \
+    --num-threads=4 \
+    --num-channels=0 \
+    plughw:3,0
+
+Use arecord -l to list the capture devices.
+)usage";
+
+  sherpa_ncnn::ParseOptions po(kUsageMessage);
+
+  sherpa_ncnn::RecognizerConfig config;
+  sherpa_ncnn::AlsaCaptureConfig capture_config;
+  int32_t num_threads = 4;
+
+  auto &model_config = config.model_config;
+  po.Register("tokens", &model_config.tokens, "Path to tokens.txt");
+  po.Register("encoder-param", &model_config.encoder_param,
+              "Path to encoder.ncnn.param");
+  po.Register("encoder-bin", &model_config.encoder_bin,
+              "Path to encoder.ncnn.bin");
+  po.Register("decoder-param", &model_config.decoder_param,
+              "Path to decoder.ncnn.param");
+  po.Register("decoder-bin", &model_config.decoder_bin,
+              "Path to decoder.ncnn.bin");
+  po.Register("joiner-param", &model_config.joiner_param,
+              "Path to joiner.ncnn.param");
+  po.Register("joiner-bin", &model_config.joiner_bin,
+              "Path to joiner.ncnn.bin");
+  po.Register("num-threads", &num_threads,
+              "Number of threads of each network");
+  po.Register("decoding-method", &config.decoder_config.method,
+              "greedy_search or modified_beam_search");
+  po.Register("hotwords-file", &config.hotwords_file,
+              "Used only for modified_beam_search");
+
+  po.Register("sample-rate", &capture_config.sample_rate,
+              "Sample rate to ask the device for");
+  po.Register("num-channels", &capture_config.num_channels,
+              "Number of channels to capture. 0 for all channels of the "
+              "device");
+  po.Register("buffer-seconds", &capture_config.buffer_seconds,
+              "Seconds of audio of each channel that are buffered while "
+              "decoding is behind");
+  po.Register("period-seconds", &capture_config.period_seconds,
+              "Period of the capture device");
+
+  po.Read(argc, argv);
+  if (po.NumArgs() != 1) {
+    po.PrintUsage();
+    exit(EXIT_FAILURE);
+  }
+
+  signal(SIGINT, Handler);
+
+  model_config.encoder_opt.num_threads = num_threads;
+  model_config.decoder_opt.num_threads = num_threads;
+  model_config.joiner_opt.num_threads = num_threads;
+
+  config.enable_endpoint = true;
+  config.endpoint_config.rule1.min_trailing_silence = 2.4;
+  config.endpoint_config.rule2.min_trailing_silence = 1.2;
+  config.endpoint_config.rule3.min_utterance_length = 300;
+
+  fprintf(stderr, "%s\n", config.ToString().c_str());
+  fprintf(stderr, "%s\n", capture_config.ToString().c_str());
+
+  sherpa_ncnn::Recognizer recognizer(config);
+
+  std::string device_name = po.GetArg(1);
+  sherpa_ncnn::AlsaCapture capture(device_name.c_str(), capture_config);
+  int32_t num_channels = capture.NumChannels();
+  int32_t sample_rate = capture.SampleRate();
+
+  std::vector<std::unique_ptr<sherpa_ncnn::Stream>> streams;
+  std::vector<sherpa_ncnn::Stream *> ss;
+  for (int32_t c = 0; c != num_channels; ++c) {
+    streams.push_back(recognizer.CreateStream());
+    ss.push_back(streams.back().get());
+  }
+
+  std::vector<std::string> last_texts(num_channels);
+  std::vector<int32_t> segments(num_channels);
+  std::vector<float> samples(sample_rate);
+
+  int64_t num_dropped = 0;
+  int64_t num_overruns = 0;
+
+  while (!stop) {
+    capture.Wait(100);
+
+    for (int32_t c = 0; c != num_channels; ++c) {
+      int32_t n = 0;
+      while ((n = capture.Read(c, samples.data(), samples.size())) > 0) {
+        ss[c]->AcceptWaveform(sample_rate, samples.data(), n);
+      }
+    }
+
+    recognizer.DecodeReadyStreams(ss.data(), ss.size());
+
+    for (int32_t c = 0; c != num_channels; ++c) {
+      sherpa_ncnn::Stream *s = ss[c];
+      bool is_endpoint = recognizer.IsEndpoint(s);
+
+      std::string text = recognizer.GetResult(s).text;
+      if (!text.empty() && text != last_texts[c]) {
+        last_texts[c] = text;
+        fprintf(stderr, "channel %d, segment %d: %s\n", c, segments[c],
+                text.c_str());
+      }
+
+      if (is_endpoint) {
+        if (!text.empty()) {
+          ++segments[c];
+        }
+        last_texts[c].clear();
+        recognizer.Reset(s);
+      }
+    }
+
+    if (capture.NumDropped() != num_dropped ||
+        capture.NumOverruns() != num_overruns) {
+      num_dropped = capture.NumDropped();
+      num_overruns = capture.NumOverruns();
+      fprintf(stderr,
+              "Warning: %lld samples dropped, %lld overruns. Decoding is "
+              "slower than real time\n",
+              static_cast<long long>(num_dropped),    // NOLINT
+              static_cast<long long>(num_overruns));  // NOLINT
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,169 @@
+// sherpa-ncnn/csrc/sherpa-ncnn-autotune.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <stdio.h>
+
+#include <cstdint>
+#include <string>
+
+#include "sherpa-ncnn/csrc/autotune.h"
+#include "sherpa-ncnn/csrc/file-utils.h"
+#include "sherpa-ncnn/csrc/model.h"
+#include "sherpa-ncnn/csrc/parse-options.h"
+#include "sherpa-ncnn/csrc/perf-profile.h"
+
+#ifndef SHERPA_NCNN_DISABLE_SENSE_VOICE
+#include "sherpa-ncnn/csrc/offline-model-config.h"
+#endif
+
+int32_t main(int32_t argc, char *argv[]) {
+  const char *kUsageMessage = R"usage(
+Find the fastest options of each network of a model on this device and
+write them to a performance profile, which is loaded at startup with
+--perf-profile of the other tools or ModelConfig::perf_profile, etc.
+
+For each network, it tries the device (CPU or GPU) and the precision,
+then the number of threads and then the convolution algorithms, keeping
+a candidate only if it is faster and its outputs are within --max-error
+of those of fp32 on the CPU. Run it on the device that the model is
+deployed on.
+
+If --output exists, the networks of the tuned models replace those in
+it and the others are kept, so that, e.g., a streaming and a SenseVoice
+model can share a profile.
+
+Usage:
+
+  ./bin/sherpa-ncnn-autotune \
+    --encoder-param=/path/to/encoder.ncnn.param \
+    --encoder-bin=/path/to/encoder.ncnn.bin \
+    --decoder-param=/path/to/decoder.ncnn.param \
+    --decoder-bin=/path/to/decoder.ncnn.bin \
+    --joiner-param=/path/to/joiner.ncnn.param \
+    --joiner-bin=/path/to/joiner.ncnn.bin \
+    --output=perf-profile.txt
+
+  ./bin/sherpa-ncnn-autotune \
+    --sense-voice-model-dir=/path/to/sense-voice \
+    --output=perf-profile.txt
+)usage";
+
+  sherpa_ncnn::ParseOptions po(kUsageMessage);
+
+  sherpa_ncnn::ModelConfig model_config;
+  sherpa_ncnn::AutoTuneConfig tune_config;
+  int32_t num_threads = 1;
+  std::string sense_voice_model_dir;
+  std::string output = "perf-profile.txt";
+
+  po.Register("encoder-param", &model_config.encoder_param,
+              "Path to encoder.ncnn.param");
+  po.Register("encoder-bin", &model_config.encoder_bin,
+              "Path to encoder.ncnn.bin");
+  po.Register("decoder-param", &model_config.decoder_param,
+              "Path to decoder.ncnn.param");
+  po.Register("decoder-bin", &model_config.decoder_bin,
+              "Path to decoder.ncnn.bin");
+  po.Register("joiner-param", &model_config.joiner_param,
+              "Path to joiner.ncnn.param");
+  po.Register("joiner-bin", &model_config.joiner_bin,
+              "Path to joiner.ncnn.bin");
+  po.Register("bundle", &model_config.bundle,
+              "Path to a model bundle. If given, the paths above are "
+              "ignored");
+  po.Register("sense-voice-model-dir", &sense_voice_model_dir,
+              "Path to a SenseVoice model directory to tune");
+  po.Register("num-threads", &num_threads,
+              "Number of threads of the reference run");
+  po.Register("num-runs", &tune_config.num_runs,
+              "Number of timed runs of each candidate");
+  po.Register("max-threads", &tune_config.max_threads,
+              "Largest number of threads to try. If not positive, the "
+              "number of big CPU cores");
+  po.Register("use-gpu", &tune_config.use_gpu,
+              "true to try the GPU as well if there is one");
+  po.Register("max-error", &tune_config.max_error,
+              "Largest relative difference of the outputs from those of "
+              "fp32 on the CPU");
+  po.Register("debug", &tune_config.debug,
+              "true to print the time and the error of each candidate");
+  po.Register("output", &output, "The profile is written to this file");
+
+  po.Read(argc, argv);
+  if (po.NumArgs() != 0) {
+    po.PrintUsage();
+    exit(EXIT_FAILURE);
+  }
+
+  bool tune_streaming =
+      !model_config.encoder_param.empty() || !model_config.bundle.empty();
+  if (!tune_streaming && sense_voice_model_dir.empty()) {
+    fprintf(stderr, "Please provide a model to tune\n\n");
+    po.PrintUsage();
+    exit(EXIT_FAILURE);
+  }
+
+  fprintf(stderr, "%s\n", tune_config.ToString().c_str());
+  fprintf(stderr, "Device: %s\n",
+          sherpa_ncnn::PerfProfile::DeviceFingerprint().c_str());
+
+  sherpa_ncnn::PerfProfile profile;
+  if (sherpa_ncnn::FileExists(output) && !profile.Read(output)) {
+    fprintf(stderr, "Failed to read '%s'\n", output.c_str());
+    return -1;
+  }
+
+  // The networks tuned on this device replace those of another one
+  profile.SetFingerprint(sherpa_ncnn::PerfProfile::DeviceFingerprint());
+
+  auto merge = [&profile](const sherpa_ncnn::PerfProfile &p) {
+    for (const auto &net : p.Nets()) {
+      profile.Set(net.first, net.second);
+    }
+  };
+
+  if (tune_streaming) {
+    model_config.use_vulkan_compute = false;
+    model_config.encoder_opt.num_threads = num_threads;
+    model_config.decoder_opt.num_threads = num_threads;
+    model_config.joiner_opt.num_threads = num_threads;
+
+    sherpa_ncnn::PerfProfile p = sherpa_ncnn::AutoTune(model_config,
+                                                       tune_config);
+    if (p.Empty()) {
+      fprintf(stderr, "Failed to tune the model: %s\n",
+              model_config.ToString().c_str());
+      return -1;
+    }
+    merge(p);
+  }
+
+  if (!sense_voice_model_dir.empty()) {
+#ifndef SHERPA_NCNN_DISABLE_SENSE_VOICE
+    sherpa_ncnn::OfflineModelConfig config;
+    config.sense_voice.model_dir = sense_voice_model_dir;
+    config.num_threads = num_threads;
+
+    sherpa_ncnn::PerfProfile p = sherpa_ncnn::AutoTune(config, tune_config);
+    if (p.Empty()) {
+      fprintf(stderr, "Failed to tune the model: %s\n",
+              config.ToString().c_str());
+      return -1;
+    }
+    merge(p);
+#else
+    fprintf(stderr, "SenseVoice is disabled in this build\n");
+    return -1;
+#endif
+  }
+
+  if (!profile.Write(output)) {
+    return -1;
+  }
+
+  fprintf(stderr, "Saved to %s\n%s", output.c_str(),
+          profile.ToString().c_str());
+
+  return 0;
+}
@@ -0,0 +1,444 @@
+// sherpa-ncnn/csrc/sherpa-ncnn-bench.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <stdio.h>
+
+#if !defined(_WIN32)
+#include <sys/resource.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/model.h"
+#include "sherpa-ncnn/csrc/parse-options.h"
+#include "sherpa-ncnn/csrc/recognizer.h"
+#include "sherpa-ncnn/csrc/text-utils.h"
+#include "sherpa-ncnn/csrc/wave-reader.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchConfig {
+  int32_t num_streams = 0;
+  int32_t num_workers = 1;
+  int32_t max_batch_size = 8;
+  float chunk_ms = 100;
+  float speed = 1;
+};
+
+struct Audio {
+  std::vector<float> samples;
+  int32_t sample_rate = 0;
+};
+
+struct BenchResult {
+  std::string method;
+  int32_t num_streams = 0;
+  double audio_seconds = 0;
+  double elapsed_seconds = 0;
+
+  // Time spent on decoding divided by the duration of the replayed audio
+  // of one stream, so a value below 1 means that all streams keep up
+  double rtf = 0;
+
+  // Wall time from feeding a chunk to a stream until the chunk is decoded
+  double latency_p50_ms = 0;
+  double latency_p90_ms = 0;
+  double latency_p99_ms = 0;
+  double latency_max_ms = 0;
+
+  int64_t num_tokens = 0;
+  double tokens_per_second = 0;
+
+  // Peak resident set size of the process so far
+  int64_t peak_rss_kb = 0;
+
+  std::string ToJson() const {
+    std::ostringstream os;
+    os << "{\"method\": \"" << method << "\", "
+       << "\"num_streams\": " << num_streams << ", "
+       << "\"audio_seconds\": " << audio_seconds << ", "
+       << "\"elapsed_seconds\": " << elapsed_seconds << ", "
+       << "\"rtf\": " << rtf << ", "
+       << "\"latency_p50_ms\": " << latency_p50_ms << ", "
+       << "\"latency_p90_ms\": " << latency_p90_ms << ", "
+       << "\"latency_p99_ms\": " << latency_p99_ms << ", "
+       << "\"latency_max_ms\": " << latency_max_ms << ", "
+       << "\"num_tokens\": " << num_tokens << ", "
+       << "\"tokens_per_second\": " << tokens_per_second << ", "
+       << "\"peak_rss_kb\": " << peak_rss_kb << "}";
+    return os.str();
+  }
+};
+
+int64_t PeakRssKb() {
+#if defined(_WIN32)
+  return 0;
+#else
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#if defined(__APPLE__)
+  return usage.ru_maxrss / 1024;  // in bytes on macOS
+#else
+  return usage.ru_maxrss;
+#endif
+#endif
+}
+
+double Percentile(const std::vector<double> &sorted, double p) {
+  if (sorted.empty()) {
+    return 0;
+  }
+
+  int32_t i = std::min<int32_t>(p * sorted.size(), sorted.size() - 1);
+  return sorted[i];
+}
+
+// A stream that replays one file
+struct Replay {
+  std::unique_ptr<sherpa_ncnn::Stream> s;
+  const Audio *audio = nullptr;
+  int32_t offset = 0;
+
+  bool finished = false;
+  bool done = false;
+};
+
+// Decode the ready streams of one chunk on num_workers threads. Each
+// worker takes max_batch_size streams at a time and decodes them together
+// until none of them is ready. latencies[i] is the time ss[i] was done
+// since start.
+void DecodeReady(const sherpa_ncnn::Recognizer &recognizer,
+                 const std::vector<sherpa_ncnn::Stream *> &ss,
+                 const BenchConfig &config, Clock::time_point start,
+                 std::vector<double> *latencies) {
+  latencies->resize(ss.size());
+  int32_t n = ss.size();
+  std::atomic<int32_t> next{0};
+
+  auto run = [&]() {
+    std::vector<sherpa_ncnn::Stream *> batch;
+    std::vector<int32_t> indexes;
+    for (int32_t b; (b = next.fetch_add(config.max_batch_size)) < n;) {
+      int32_t e = std::min(n, b + config.max_batch_size);
+
+      indexes.resize(e - b);
+      for (int32_t i = b; i != e; ++i) {
+        indexes[i - b] = i;
+      }
+
+      while (!indexes.empty()) {
+        batch.clear();
+        for (int32_t i : indexes) {
+          batch.push_back(ss[i]);
+        }
+        recognizer.DecodeStreams(batch.data(), batch.size());
+
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() -
+                                                              start)
+                        .count();
+
+        auto it = std::remove_if(indexes.begin(), indexes.end(),
+                                 [&](int32_t i) {
+                                   if (recognizer.IsReady(ss[i])) {
+                                     return false;
+                                   }
+                                   (*latencies)[i] = ms;
+                                   return true;
+                                 });
+        indexes.erase(it, indexes.end());
+      }
+    }
+  };
+
+  int32_t num_workers = std::min(config.num_workers, n);
+  std::vector<std::thread> threads;
+  for (int32_t i = 1; i < num_workers; ++i) {
+    threads.emplace_back(run);
+  }
+  run();
+
+  for (auto &t : threads) {
+    t.join();
+  }
+}
+
+BenchResult Run(const sherpa_ncnn::Recognizer &recognizer,
+                const std::vector<Audio> &audios, const BenchConfig &config) {
+  std::vector<Replay> replays(config.num_streams);
+  double audio_seconds = 0;
+  for (int32_t i = 0; i != config.num_streams; ++i) {
+    replays[i].s = recognizer.CreateStream();
+    replays[i].audio = &audios[i % audios.size()];
+    audio_seconds += static_cast<double>(replays[i].audio->samples.size()) /
+                     replays[i].audio->sample_rate;
+  }
+
+  std::vector<double> latencies;
+  std::vector<double> chunk_latencies;
+  std::vector<sherpa_ncnn::Stream *> ready;
+
+  double busy_seconds = 0;
+  int32_t num_chunks = 0;
+  int32_t num_done = 0;
+
+  auto begin = Clock::now();
+  auto next_tick = begin;
+  auto chunk = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double, std::milli>(config.chunk_ms));
+
+  while (num_done < config.num_streams) {
+    if (config.speed > 0) {
+      std::this_thread::sleep_until(next_tick);
+      next_tick += std::chrono::duration_cast<Clock::duration>(chunk /
+                                                               config.speed);
+    }
+
+    auto start = Clock::now();
+    ready.clear();
+
+    for (int32_t i = 0; i != config.num_streams; ++i) {
+      Replay &r = replays[i];
+      if (r.done) continue;
+
+      const Audio &a = *r.audio;
+      if (!r.finished) {
+        int32_t n = std::min<int32_t>(a.sample_rate * config.chunk_ms / 1000,
+                                      a.samples.size() - r.offset);
+        r.s->AcceptWaveform(a.sample_rate, a.samples.data() + r.offset, n);
+        r.offset += n;
+
+        if (r.offset == static_cast<int32_t>(a.samples.size())) {
+          std::vector<float> tail_paddings(0.3 * a.sample_rate);
+          r.s->AcceptWaveform(a.sample_rate, tail_paddings.data(),
+                              tail_paddings.size());
+          r.s->InputFinished();
+          r.finished = true;
+        }
+      }
+
+      if (recognizer.IsReady(r.s.get())) {
+        ready.push_back(r.s.get());
+      } else if (r.finished) {
+        r.done = true;
+        ++num_done;
+      }
+    }
+
+    DecodeReady(recognizer, ready, config, start, &chunk_latencies);
+    latencies.insert(latencies.end(), chunk_latencies.begin(),
+                     chunk_latencies.end());
+
+    busy_seconds +=
+        std::chrono::duration<double>(Clock::now() - start).count();
+    ++num_chunks;
+  }
+
+  double elapsed_seconds =
+      std::chrono::duration<double>(Clock::now() - begin).count();
+
+  BenchResult ans;
+  ans.num_streams = config.num_streams;
+  ans.audio_seconds = audio_seconds;
+  ans.elapsed_seconds = elapsed_seconds;
+  ans.rtf = busy_seconds / (num_chunks * config.chunk_ms / 1000);
+
+  std::sort(latencies.begin(), latencies.end());
+  ans.latency_p50_ms = Percentile(latencies, 0.5);
+  ans.latency_p90_ms = Percentile(latencies, 0.9);
+  ans.latency_p99_ms = Percentile(latencies, 0.99);
+  ans.latency_max_ms = latencies.empty() ? 0 : latencies.back();
+
+  for (auto &r : replays) {
+    r.s->Finalize();
+    ans.num_tokens += recognizer.GetResult(r.s.get()).tokens.size();
+  }
+  ans.tokens_per_second = ans.num_tokens / busy_seconds;
+  ans.peak_rss_kb = PeakRssKb();
+
+  return ans;
+}
+
+}  // namespace
+
+int32_t main(int32_t argc, char *argv[]) {
+  const char *kUsageMessage = R"usage(
+Benchmark the streaming recognizer with many concurrent streams.
+
+Each of --num-streams streams replays one of the given wave files in
+chunks of --chunk-ms, as if it were recorded in real time. All streams
+receive a chunk, and the ready ones are then decoded in batches on
+--num-workers threads. It is repeated for each of --decoding-methods.
+
+For each method, a summary is printed to stderr and one JSON line to
+stdout, e.g., for gating regressions:
+
+  rtf              decoding time / audio time. Below 1 means all streams
+                   keep up with real time.
+  latency_*_ms     time from feeding a chunk to a stream until the
+                   chunk is decoded
+  peak_rss_kb      peak resident memory of the process so far
+  tokens_per_second
+
+Usage:
+
+  ./bin/sherpa-ncnn-bench \
+    --tokens=/path/to/tokens.txt \
+    --encoder-param=/path/to/encoder.ncnn.param \
+    --encoder-bin=/path/to/encoder.ncnn.bin \
+    --decoder-param=/path/to/decoder.ncnn.param \
+    --decoder-bin=/path/to/decoder.ncnn.bin \
+    --joiner-param=/path/to/joiner.ncnn.param \
+    --joiner-bin=/path/to/joiner.ncnn.bin \
+    --num-threads=1 \
+    --num-streams=16 \
+    --num-workers=4 \
+    --decoding-methods=greedy_search,modified_beam_search \
+    foo.wav [bar.wav ...]
+)usage";
+
+  sherpa_ncnn::ParseOptions po(kUsageMessage);
+
+  sherpa_ncnn::RecognizerConfig config;
+  BenchConfig bench_config;
+  int32_t num_threads = 1;
+  std::string decoding_methods = "greedy_search,modified_beam_search";
+
+  auto &model_config = config.model_config;
+  po.Register("tokens", &model_config.tokens, "Path to tokens.txt");
+  po.Register("encoder-param", &model_config.encoder_param,
+              "Path to encoder.ncnn.param");
+  po.Register("encoder-bin", &model_config.encoder_bin,
+              "Path to encoder.ncnn.bin");
+  po.Register("decoder-param", &model_config.decoder_param,
+              "Path to decoder.ncnn.param");
+  po.Register("decoder-bin", &model_config.decoder_bin,
+              "Path to decoder.ncnn.bin");
+  po.Register("joiner-param", &model_config.joiner_param,
+              "Path to joiner.ncnn.param");
+  po.Register("joiner-bin", &model_config.joiner_bin,
+              "Path to joiner.ncnn.bin");
+  po.Register("bundle", &model_config.bundle,
+              "Path to a model bundle. If given, the paths above are "
+              "ignored");
+  po.Register("use-mmap", &model_config.use_mmap,
+              "Memory map the .bin files");
+  po.Register("use-huge-pages", &model_config.use_huge_pages,
+              "Read the .bin files and large memory pool chunks into huge "
+              "pages");
+  po.Register("arena-mb", &model_config.arena_mb,
+              "If positive, allocate the blobs of the networks from a fixed "
+              "arena of this many MB instead of the memory pools");
+  po.Register("num-threads", &num_threads,
+              "Number of threads of each network");
+  po.Register("num-active-paths", &config.decoder_config.num_active_paths,
+              "Used only for modified_beam_search");
+  po.Register("beam", &config.decoder_config.beam,
+              "Used only for modified_beam_search. If positive, prune paths "
+              "more than this log prob below the best one");
+  po.Register("min-active-paths", &config.decoder_config.min_active_paths,
+              "Used only for modified_beam_search with --beam");
+  po.Register("speculative-joiner", &config.decoder_config.speculative_joiner,
+              "Used only for greedy_search. If true, run the joiner for all "
+              "frames of a chunk at once until a token is emitted");
+  po.Register("decoding-methods", &decoding_methods,
+              "Comma separated decoding methods to benchmark");
+
+  po.Register("num-streams", &bench_config.num_streams,
+              "Number of concurrent streams. Files are reused if there are "
+              "fewer of them. If 0, one stream per file");
+  po.Register("num-workers", &bench_config.num_workers,
+              "Number of threads that decode streams");
+  po.Register("max-batch-size", &bench_config.max_batch_size,
+              "A worker decodes at most this many streams together");
+  po.Register("chunk-ms", &bench_config.chunk_ms,
+              "Duration of the chunks that are fed to each stream");
+  po.Register("speed", &bench_config.speed,
+              "Replay speed relative to real time. 0 to feed the next chunk "
+              "as soon as the previous one is decoded");
+
+  po.Read(argc, argv);
+  if (po.NumArgs() < 1) {
+    fprintf(stderr, "Error: Please provide at least 1 wave file.\n\n");
+    po.PrintUsage();
+    exit(EXIT_FAILURE);
+  }
+
+  if (bench_config.num_workers < 1 || bench_config.max_batch_size < 1 ||
+      bench_config.chunk_ms <= 0 || bench_config.speed < 0) {
+    fprintf(stderr, "Invalid --num-workers, --max-batch-size, --chunk-ms or "
+                    "--speed\n");
+    exit(EXIT_FAILURE);
+  }
+
+  model_config.encoder_opt.num_threads = num_threads;
+  model_config.decoder_opt.num_threads = num_threads;
+  model_config.joiner_opt.num_threads = num_threads;
+
+  std::vector<Audio> audios;
+  for (int32_t i = 1; i <= po.NumArgs(); ++i) {
+    auto reader = sherpa_ncnn::WaveFileReader::Open(po.GetArg(i));
+    if (!reader) {
+      fprintf(stderr, "Failed to read '%s'\n", po.GetArg(i).c_str());
+      return -1;
+    }
+
+    Audio a;
+    a.sample_rate = reader->SampleRate();
+    a.samples.resize(reader->NumFrames());
+    reader->Read(a.samples.data(), a.samples.size());
+    audios.push_back(std::move(a));
+  }
+
+  if (bench_config.num_streams <= 0) {
+    bench_config.num_streams = audios.size();
+  }
+
+  // The model is loaded once and shared by the recognizers of all methods
+  std::shared_ptr<sherpa_ncnn::Model> model =
+      sherpa_ncnn::Model::Create(model_config);
+  if (!model) {
+    fprintf(stderr, "Failed to create the model: %s\n",
+            model_config.ToString().c_str());
+    return -1;
+  }
+
+  std::vector<std::string> methods;
+  sherpa_ncnn::SplitStringToVector(decoding_methods, ",", true, &methods);
+
+  for (const auto &method : methods) {
+    config.decoder_config.method = method;
+    sherpa_ncnn::Recognizer recognizer(config, model);
+
+    BenchResult r = Run(recognizer, audios, bench_config);
+    r.method = method;
+
+    fprintf(stderr,
+            "%s: %d streams, %.1f s of audio in %.1f s\n"
+            "  RTF: %.3f\n"
+            "  chunk latency (ms): p50 %.1f, p90 %.1f, p99 %.1f, max %.1f\n"
+            "  tokens/s: %.1f\n"
+            "  peak RSS: %.1f MB\n",
+            method.c_str(), r.num_streams, r.audio_seconds,
+            r.elapsed_seconds, r.rtf, r.latency_p50_ms, r.latency_p90_ms,
+            r.latency_p99_ms, r.latency_max_ms, r.tokens_per_second,
+            r.peak_rss_kb / 1024.0);
+
+    fprintf(stdout, "%s\n", r.ToJson().c_str());
+    fflush(stdout);
+  }
+
+  return 0;
+}
@@ -0,0 +1,50 @@
+// sherpa-ncnn/csrc/sherpa-ncnn-compile-lexicon.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+
+#include "sherpa-ncnn/csrc/lexicon.h"
+#include "sherpa-ncnn/csrc/offline-tts-vits-model-meta-data.h"
+#include "sherpa-ncnn/csrc/parse-options.h"
+
+int32_t main(int32_t argc, char *argv[]) {
+  const char *kUsageMessage = R"usage(
+Compile lexicon.txt of a VITS model into the form that is memory mapped by
+the TTS, so that it is not parsed at startup.
+
+Usage:
+
+  ./bin/sherpa-ncnn-compile-lexicon \
+    /path/to/vits-model-dir/config.json \
+    /path/to/vits-model-dir/lexicon.txt \
+    /path/to/vits-model-dir/lexicon.bin
+
+The TTS uses lexicon.bin instead of lexicon.txt if it is in the model
+directory. It works only with the tokens of config.json.
+)usage";
+
+  sherpa_ncnn::ParseOptions po(kUsageMessage);
+  po.Read(argc, argv);
+  if (po.NumArgs() != 3) {
+    po.PrintUsage();
+    exit(EXIT_FAILURE);
+  }
+
+  sherpa_ncnn::OfflineTtsVitsModelMetaData meta =
+      sherpa_ncnn::ReadFromConfigJson(po.GetArg(1));
+
+  std::string lexicon = po.GetArg(2);
+  std::string filename = po.GetArg(3);
+  if (!sherpa_ncnn::Lexicon::Compile(lexicon, meta.token2id, filename)) {
+    fprintf(stderr, "Failed to compile %s\n", lexicon.c_str());
+    exit(EXIT_FAILURE);
+  }
+
+  fprintf(stderr, "Saved to %s\n", filename.c_str());
+
+  return 0;
+}
@@ -0,0 +1,53 @@
+// sherpa-ncnn/csrc/sherpa-ncnn-compile-lm.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+
+#include "sherpa-ncnn/csrc/ngram-lm.h"
+#include "sherpa-ncnn/csrc/parse-options.h"
+#include "sherpa-ncnn/csrc/symbol-table.h"
+
+int32_t main(int32_t argc, char *argv[]) {
+  const char *kUsageMessage = R"usage(
+Compile a token-level n-gram LM in ARPA format into the form that is
+memory mapped by the recognizer, for shallow fusion in modified beam search.
+Its words must be the tokens of tokens.txt.
+
+Usage:
+
+  ./bin/sherpa-ncnn-compile-lm /path/to/tokens.txt /path/to/lm.arpa ./lm.bin
+
+Use it with DecoderConfig::lm. N-grams with words that are not tokens are
+dropped.
+)usage";
+
+  sherpa_ncnn::ParseOptions po(kUsageMessage);
+  po.Read(argc, argv);
+  if (po.NumArgs() != 3) {
+    po.PrintUsage();
+    exit(EXIT_FAILURE);
+  }
+
+  sherpa_ncnn::SymbolTable sym(po.GetArg(1));
+
+  std::string arpa = po.GetArg(2);
+  std::string filename = po.GetArg(3);
+  if (!sherpa_ncnn::NgramLm::Compile(arpa, sym, filename)) {
+    fprintf(stderr, "Failed to compile %s\n", arpa.c_str());
+    exit(EXIT_FAILURE);
+  }
+
+  auto lm = sherpa_ncnn::NgramLm::Load(filename, sym);
+  if (!lm) {
+    exit(EXIT_FAILURE);
+  }
+
+  fprintf(stderr, "Saved to %s. Order: %d, number of n-grams: %d\n",
+          filename.c_str(), lm->Order(), lm->NumNodes() - 1);
+
+  return 0;
+}
@@ -0,0 +1,461 @@
+// sherpa-ncnn/csrc/sherpa-ncnn-encoder-server.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <thread>  // NOLINT
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/model.h"
+#include "sherpa-ncnn/csrc/parse-options.h"
+#include "sherpa-ncnn/csrc/remote-encoder.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using sherpa_ncnn::RemoteEncoderChunk;
+using sherpa_ncnn::RemoteEncoderHandle;
+
+struct ServerConfig {
+  int32_t port = 6007;
+
+  // Number of threads that run the encoder and the largest number of
+  // chunks they run together
+  int32_t num_workers = 2;
+  int32_t max_batch_size = 8;
+
+  // How long a chunk may wait for others to join its batch
+  int32_t max_latency_ms = 5;
+
+  // The features of a chunk are Model::Segment() frames of this dim
+  int32_t feature_dim = 80;
+
+  // A session that has no chunk for this many seconds is removed
+  int32_t session_timeout = 300;
+
+  // Close a client that sends a larger message
+  int32_t max_message_bytes = 16 << 20;
+};
+
+struct Connection {
+  explicit Connection(int32_t fd) : fd(fd) {}
+  ~Connection() { close(fd); }
+
+  int32_t fd;
+  std::mutex write_mutex;
+};
+
+// A message of a client. It is answered when all of its chunks are done.
+struct Request {
+  std::shared_ptr<Connection> connection;
+  std::vector<RemoteEncoderChunk> chunks;
+  std::atomic<int32_t> num_pending{0};
+};
+
+struct WorkItem {
+  std::shared_ptr<Request> request;
+  int32_t index;  // of the chunk in request->chunks
+};
+
+/* The encoder states of all streams of all clients, see
+ * RemoteEncoderHandle.
+ *
+ * A chunk of an unknown session, e.g., one that has expired or was on a
+ * server that restarted, or whose seq does not match, e.g., one of a
+ * stream that was restored from an older snapshot, starts a new session
+ * from the initial states. It is logged, since the result differs from
+ * that of a local encoder.
+ *
+ * A session has at most one chunk in flight, since a stream waits for the
+ * encoder output of a chunk before it sends the next one.
+ */
+class Sessions {
+ public:
+  Sessions(std::vector<ncnn::Mat> init_states, int32_t timeout)
+      : init_states_(std::move(init_states)), timeout_(timeout) {}
+
+  // Return the states for chunk c and set its session and seq to those of
+  // the session it belongs to
+  std::vector<ncnn::Mat> Begin(RemoteEncoderChunk *c) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = sessions_.find(c->session);
+    if (it != sessions_.end() && it->second.seq == c->seq) {
+      return it->second.states;
+    }
+
+    if (c->session != 0) {
+      fprintf(stderr,
+              "Session %llu with seq %d is unknown or stale. Start it "
+              "again\n",
+              static_cast<unsigned long long>(c->session), c->seq);  // NOLINT
+    }
+
+    c->session = NewId();
+    c->seq = 0;
+
+    return init_states_;
+  }
+
+  // Save the states after chunk c. Set c->seq to that of the next chunk.
+  void End(RemoteEncoderChunk *c, std::vector<ncnn::Mat> states) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto now = Clock::now();
+    c->seq = (c->seq + 1) % RemoteEncoderHandle::kMaxSeq;
+    sessions_[c->session] = {std::move(states), c->seq, now};
+
+    if (now - last_expire_ > std::chrono::seconds(1)) {
+      Expire(now);
+      last_expire_ = now;
+    }
+  }
+
+ private:
+  struct Session {
+    std::vector<ncnn::Mat> states;
+    int32_t seq = 0;  // of the next chunk
+    Clock::time_point last_used;
+  };
+
+  uint64_t NewId() {
+    do {
+      next_id_ = next_id_ % (RemoteEncoderHandle::kMaxSession - 1) + 1;
+    } while (sessions_.count(next_id_));
+
+    return next_id_;
+  }
+
+  void Expire(Clock::time_point now) {
+    for (auto it = sessions_.begin(); it != sessions_.end();) {
+      if (now - it->second.last_used > std::chrono::seconds(timeout_)) {
+        it = sessions_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+ private:
+  std::vector<ncnn::Mat> init_states_;
+  int32_t timeout_;
+
+  std::mutex mutex_;
+  std::unordered_map<uint64_t, Session> sessions_;
+  uint64_t next_id_ = 0;
+  Clock::time_point last_expire_;
+};
+
+// The chunks of all clients that wait for a worker
+class WorkQueue {
+ public:
+  void Push(const std::shared_ptr<Request> &r) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (int32_t i = 0; i != static_cast<int32_t>(r->chunks.size()); ++i) {
+        items_.push_back({r, i});
+      }
+    }
+    cv_.notify_all();
+  }
+
+  // Wait for a chunk, and then up to max_latency_ms for more, and return
+  // at most max_batch_size of them
+  std::vector<WorkItem> Pop(int32_t max_batch_size, int32_t max_latency_ms) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return !items_.empty(); });
+
+    cv_.wait_for(lock, std::chrono::milliseconds(max_latency_ms),
+                 [this, max_batch_size] {
+                   return static_cast<int32_t>(items_.size()) >=
+                          max_batch_size;
+                 });
+
+    std::vector<WorkItem> ans;
+    while (!items_.empty() &&
+           static_cast<int32_t>(ans.size()) < max_batch_size) {
+      ans.push_back(std::move(items_.front()));
+      items_.pop_front();
+    }
+
+    return ans;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<WorkItem> items_;
+};
+
+class Server {
+ public:
+  Server(sherpa_ncnn::Model *model, const ServerConfig &config)
+      : model_(model),
+        config_(config),
+        sessions_(model->GetEncoderInitStates(), config.session_timeout) {}
+
+  bool Listen() {
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) {
+      fprintf(stderr, "Failed to create a socket: %s\n", strerror(errno));
+      return false;
+    }
+
+    int one = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(config_.port);
+    if (bind(listen_fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) !=
+            0 ||
+        listen(listen_fd_, SOMAXCONN) != 0) {
+      fprintf(stderr, "Failed to listen on port %d: %s\n", config_.port,
+              strerror(errno));
+      return false;
+    }
+
+    return true;
+  }
+
+  void Run() {
+    for (int32_t i = 0; i != config_.num_workers; ++i) {
+      std::thread([this] { Work(); }).detach();
+    }
+
+    while (true) {
+      int32_t fd = accept(listen_fd_, nullptr, nullptr);
+      if (fd < 0) {
+        if (errno != EINTR) {
+          fprintf(stderr, "Failed to accept: %s\n", strerror(errno));
+        }
+        continue;
+      }
+
+      int one = 1;
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+      auto c = std::make_shared<Connection>(fd);
+      std::thread([this, c] { Read(c); }).detach();
+    }
+  }
+
+ private:
+  // Read the requests of a client until it disconnects
+  void Read(std::shared_ptr<Connection> c) {
+    while (true) {
+      auto r = std::make_shared<Request>();
+      if (!sherpa_ncnn::ReceiveRemoteEncoderMessage(
+              c->fd, config_.max_message_bytes, &r->chunks)) {
+        break;
+      }
+
+      r->connection = c;
+      if (r->chunks.empty()) {
+        Respond(r.get());
+        continue;
+      }
+
+      r->num_pending = static_cast<int32_t>(r->chunks.size());
+      queue_.Push(r);
+    }
+  }
+
+  void Work() {
+    int32_t segment = model_->Segment();
+
+    while (true) {
+      std::vector<WorkItem> items =
+          queue_.Pop(config_.max_batch_size, config_.max_latency_ms);
+
+      std::vector<RemoteEncoderChunk *> chunks;
+      std::vector<ncnn::Mat> features;
+      std::vector<std::vector<ncnn::Mat>> states;
+      for (auto &item : items) {
+        auto *c = &item.request->chunks[item.index];
+        if (c->data.w != config_.feature_dim || c->data.h != segment) {
+          c->status = sherpa_ncnn::kRemoteEncoderBadInput;
+          c->data = ncnn::Mat();
+          continue;
+        }
+
+        states.push_back(sessions_.Begin(c));
+        features.push_back(c->data);
+        chunks.push_back(c);
+      }
+
+      int32_t n = static_cast<int32_t>(chunks.size());
+      if (n > 0) {
+        std::vector<std::vector<ncnn::Mat>> next_states(n);
+        std::vector<const std::vector<ncnn::Mat> *> states_ptr(n);
+        std::vector<std::vector<ncnn::Mat> *> next_states_ptr(n);
+        for (int32_t i = 0; i != n; ++i) {
+          states_ptr[i] = &states[i];
+          next_states_ptr[i] = &next_states[i];
+        }
+
+        std::vector<ncnn::Mat> encoder_out =
+            model_->RunEncoderBatch(features, states_ptr, next_states_ptr);
+
+        for (int32_t i = 0; i != n; ++i) {
+          chunks[i]->data = encoder_out[i];
+          sessions_.End(chunks[i], std::move(next_states[i]));
+        }
+      }
+
+      for (auto &item : items) {
+        if (--item.request->num_pending == 0) {
+          Respond(item.request.get());
+        }
+      }
+    }
+  }
+
+  void Respond(Request *r) {
+    std::vector<uint8_t> buf;
+    sherpa_ncnn::WriteRemoteEncoderMessage(r->chunks, &buf);
+
+    Connection *c = r->connection.get();
+    std::lock_guard<std::mutex> lock(c->write_mutex);
+
+    // If it fails, the client has gone and its reader stops
+    sherpa_ncnn::SendAll(c->fd, buf.data(), buf.size());
+  }
+
+ private:
+  sherpa_ncnn::Model *model_;
+  ServerConfig config_;
+  Sessions sessions_;
+  WorkQueue queue_;
+  int32_t listen_fd_ = -1;
+};
+
+}  // namespace
+
+int32_t main(int32_t argc, char *argv[]) {
+  const char *kUsageMessage = R"usage(
+A server that runs the encoder of a streaming model for clients whose
+ModelConfig::remote_encoder, e.g., remote_encoder of the model config of
+the C API or of Python, is host:port of this server. The clients compute
+the features and run the decoder, the joiner and the search themselves.
+
+The encoder states of each stream of a client are kept on the server and
+removed after --session-timeout seconds without a chunk. The chunks of
+all clients are run in batches of up to --max-batch-size on --num-workers
+threads. The clients must use the same model.
+
+Usage:
+
+  ./bin/sherpa-ncnn-encoder-server \
+    --encoder-param=/path/to/encoder.ncnn.param \
+    --encoder-bin=/path/to/encoder.ncnn.bin \
+    --decoder-param=/path/to/decoder.ncnn.param \
+    --decoder-bin=/path/to/decoder.ncnn.bin \
+    --joiner-param=/path/to/joiner.ncnn.param \
+    --joiner-bin=/path/to/joiner.ncnn.bin \
+    --num-threads=1 \
+    --num-workers=4 \
+    --port=6007
+)usage";
+
+  sherpa_ncnn::ParseOptions po(kUsageMessage);
+
+  sherpa_ncnn::ModelConfig model_config;
+  ServerConfig config;
+  int32_t num_threads = 1;
+
+  po.Register("encoder-param", &model_config.encoder_param,
+              "Path to encoder.ncnn.param");
+  po.Register("encoder-bin", &model_config.encoder_bin,
+              "Path to encoder.ncnn.bin");
+  po.Register("decoder-param", &model_config.decoder_param,
+              "Path to decoder.ncnn.param");
+  po.Register("decoder-bin", &model_config.decoder_bin,
+              "Path to decoder.ncnn.bin");
+  po.Register("joiner-param", &model_config.joiner_param,
+              "Path to joiner.ncnn.param");
+  po.Register("joiner-bin", &model_config.joiner_bin,
+              "Path to joiner.ncnn.bin");
+  po.Register("bundle", &model_config.bundle,
+              "Path to a model bundle. If given, the paths above are "
+              "ignored");
+  po.Register("use-mmap", &model_config.use_mmap,
+              "Memory map the .bin files");
+  po.Register("encoder-device", &model_config.encoder_device,
+              "cpu or gpu");
+  po.Register("num-threads", &num_threads,
+              "Number of threads of the encoder");
+
+  po.Register("port", &config.port, "The port to listen on");
+  po.Register("num-workers", &config.num_workers,
+              "Number of threads that run the encoder");
+  po.Register("max-batch-size", &config.max_batch_size,
+              "A worker runs at most this many chunks together");
+  po.Register("max-latency-ms", &config.max_latency_ms,
+              "How long a chunk may wait for others to join its batch");
+  po.Register("feature-dim", &config.feature_dim,
+              "Dim of the features of the clients");
+  po.Register("session-timeout", &config.session_timeout,
+              "Remove the states of a stream after this many seconds "
+              "without a chunk");
+  po.Register("max-message-bytes", &config.max_message_bytes,
+              "Close a client that sends a larger message");
+
+  po.Read(argc, argv);
+  if (po.NumArgs() != 0) {
+    po.PrintUsage();
+    exit(EXIT_FAILURE);
+  }
+
+  if (config.num_workers < 1 || config.max_batch_size < 1 ||
+      config.max_latency_ms < 0 || config.feature_dim < 1 ||
+      config.session_timeout < 1) {
+    fprintf(stderr, "Invalid --num-workers, --max-batch-size, "
+                    "--max-latency-ms, --feature-dim or --session-timeout\n");
+    exit(EXIT_FAILURE);
+  }
+
+  model_config.encoder_opt.num_threads = num_threads;
+  model_config.decoder_opt.num_threads = 1;
+  model_config.joiner_opt.num_threads = 1;
+
+  fprintf(stderr, "%s\n", model_config.ToString().c_str());
+
+  // A client that disconnects must not kill the server
+  signal(SIGPIPE, SIG_IGN);
+
+  auto model = sherpa_ncnn::Model::Create(model_config);
+  if (!model) {
+    fprintf(stderr, "Failed to create the model\n");
+    return -1;
+  }
+
+  Server server(model.get(), config);
+  if (!server.Listen()) {
+    return -1;
+  }
+
+  fprintf(stderr, "Listening on port %d\n", config.port);
+  server.Run();
+
+  return 0;
+}
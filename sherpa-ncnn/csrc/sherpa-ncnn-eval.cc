@@ -0,0 +1,687 @@
+// sherpa-ncnn/csrc/sherpa-ncnn-eval.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <stdio.h>
+
+#if !defined(_WIN32)
+#include <sys/resource.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <fstream>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <sstream>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/error-rate.h"
+#include "sherpa-ncnn/csrc/offline-job-queue.h"
+#include "sherpa-ncnn/csrc/offline-recognizer.h"
+#include "sherpa-ncnn/csrc/parse-options.h"
+#include "sherpa-ncnn/csrc/recognizer.h"
+#include "sherpa-ncnn/csrc/slots.h"
+#include "sherpa-ncnn/csrc/text-utils.h"
+#include "sherpa-ncnn/csrc/wave-reader.h"
+
+namespace {
+
+using sherpa_ncnn::ComputeErrorStats;
+using sherpa_ncnn::SplitCharsForErrorRate;
+using sherpa_ncnn::SplitWordsForErrorRate;
+
+using Clock = std::chrono::steady_clock;
+
+double Ms(Clock::duration d) {
+  return std::chrono::duration<double, std::milli>(d).count();
+}
+
+struct Utterance {
+  std::string filename;
+  std::string ref;
+};
+
+// Each line is "/path/to/foo.wav the reference text"
+bool ReadManifest(const std::string &filename,
+                  std::vector<Utterance> *utterances) {
+  std::ifstream is(filename);
+  if (!is) {
+    fprintf(stderr, "Failed to open '%s'\n", filename.c_str());
+    return false;
+  }
+
+  std::string line;
+  while (std::getline(is, line)) {
+    std::istringstream iss(line);
+    Utterance u;
+    if (!(iss >> u.filename)) continue;
+
+    std::getline(iss >> std::ws, u.ref);
+    utterances->push_back(std::move(u));
+  }
+
+  return true;
+}
+
+struct Audio {
+  std::vector<float> samples;
+  int32_t sample_rate = 0;
+
+  double Seconds() const {
+    return static_cast<double>(samples.size()) / sample_rate;
+  }
+};
+
+bool ReadAudio(const std::string &filename, Audio *a) {
+  auto reader = sherpa_ncnn::WaveFileReader::Open(filename);
+  if (!reader) {
+    fprintf(stderr, "Failed to read '%s'\n", filename.c_str());
+    return false;
+  }
+
+  a->sample_rate = reader->SampleRate();
+  a->samples.resize(reader->NumFrames());
+  a->samples.resize(reader->Read(a->samples.data(), a->samples.size()));
+  return true;
+}
+
+struct UtteranceResult {
+  bool ok = false;
+  std::string hyp;
+  double seconds = 0;
+
+  // Streaming only. Time from the start of the first token of the result,
+  // according to its timestamp, until it is shown as a partial result, if
+  // the audio were fed in real time. Negative if there is no partial
+  // result.
+  double first_partial_ms = -1;
+
+  // Streaming: time from feeding the end of the audio until the final
+  // result is ready. Offline: time from submitting the audio until its
+  // result is ready, including the time it waits for a batch.
+  double final_ms = 0;
+};
+
+int64_t PeakRssKb() {
+#if defined(_WIN32)
+  return 0;
+#else
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#if defined(__APPLE__)
+  return usage.ru_maxrss / 1024;  // in bytes on macOS
+#else
+  return usage.ru_maxrss;
+#endif
+#endif
+}
+
+double Percentile(const std::vector<double> &sorted, double p) {
+  if (sorted.empty()) {
+    return 0;
+  }
+
+  int32_t i = std::min<int32_t>(p * sorted.size(), sorted.size() - 1);
+  return sorted[i];
+}
+
+struct Latency {
+  double p50_ms = 0;
+  double p90_ms = 0;
+  double p99_ms = 0;
+};
+
+Latency ComputeLatency(std::vector<double> v) {
+  std::sort(v.begin(), v.end());
+
+  Latency ans;
+  ans.p50_ms = Percentile(v, 0.5);
+  ans.p90_ms = Percentile(v, 0.9);
+  ans.p99_ms = Percentile(v, 0.99);
+  return ans;
+}
+
+struct EvalResult {
+  // streaming or offline
+  std::string mode;
+
+  int32_t num_utterances = 0;
+  int32_t num_failed = 0;
+  double audio_seconds = 0;
+  double elapsed_seconds = 0;
+
+  sherpa_ncnn::ErrorStats words;
+  sherpa_ncnn::ErrorStats chars;
+
+  Latency first_partial;
+  Latency final_result;
+
+  // Peak resident set size of the process so far
+  int64_t peak_rss_kb = 0;
+
+  double Rtf() const { return elapsed_seconds / audio_seconds; }
+
+  std::string ToJson() const {
+    std::ostringstream os;
+    os << "{\"mode\": \"" << mode << "\", "
+       << "\"num_utterances\": " << num_utterances << ", "
+       << "\"num_failed\": " << num_failed << ", "
+       << "\"audio_seconds\": " << audio_seconds << ", "
+       << "\"elapsed_seconds\": " << elapsed_seconds << ", "
+       << "\"rtf\": " << Rtf() << ", "
+       << "\"wer\": " << words.Rate() << ", "
+       << "\"num_ref_words\": " << words.num_ref << ", "
+       << "\"num_word_errors\": " << words.NumErrors() << ", "
+       << "\"cer\": " << chars.Rate() << ", "
+       << "\"num_ref_chars\": " << chars.num_ref << ", "
+       << "\"num_char_errors\": " << chars.NumErrors() << ", "
+       << "\"first_partial_p50_ms\": " << first_partial.p50_ms << ", "
+       << "\"first_partial_p90_ms\": " << first_partial.p90_ms << ", "
+       << "\"first_partial_p99_ms\": " << first_partial.p99_ms << ", "
+       << "\"final_p50_ms\": " << final_result.p50_ms << ", "
+       << "\"final_p90_ms\": " << final_result.p90_ms << ", "
+       << "\"final_p99_ms\": " << final_result.p99_ms << ", "
+       << "\"peak_rss_kb\": " << peak_rss_kb << "}";
+    return os.str();
+  }
+};
+
+struct EvalConfig {
+  int32_t num_workers = 1;
+  int32_t max_batch_size = 8;
+  float chunk_ms = 100;
+
+  // Streaming only. If positive, see Recognizer::CreateStreamWithChunkSize()
+  int32_t chunk_size = 0;
+
+  // Offline only
+  int32_t num_io_threads = 2;
+  int32_t max_in_flight = 64;
+};
+
+// A streaming utterance that is being decoded
+struct Active {
+  int32_t i = 0;
+  Audio audio;
+  std::unique_ptr<sherpa_ncnn::Stream> s;
+  int32_t offset = 0;
+  bool finished = false;
+  bool done = false;
+
+  // When the end of the audio was fed
+  Clock::time_point end_of_audio;
+};
+
+/* Each worker takes max_batch_size utterances at a time and feeds them
+ * chunk by chunk as fast as possible. After each chunk, the ready streams
+ * are decoded together until none of them is ready.
+ *
+ * Latencies are computed as if the audio were fed in real time: a partial
+ * result after the chunk that ends at t seconds of audio is shown at t
+ * plus the wall time to decode that chunk.
+ */
+void EvaluateStreaming(const sherpa_ncnn::Recognizer &recognizer,
+                       const std::vector<Utterance> &utterances,
+                       const EvalConfig &config,
+                       std::vector<UtteranceResult> *results) {
+  int32_t n = utterances.size();
+  std::atomic<int32_t> next{0};
+
+  auto run = [&]() {
+    std::vector<Active> batch;
+    std::vector<sherpa_ncnn::Stream *> ready;
+    std::vector<Active *> ready_active;
+
+    for (int32_t b; (b = next.fetch_add(config.max_batch_size)) < n;) {
+      int32_t e = std::min(n, b + config.max_batch_size);
+
+      batch.clear();
+      for (int32_t i = b; i != e; ++i) {
+        Active a;
+        a.i = i;
+        if (!ReadAudio(utterances[i].filename, &a.audio)) continue;
+
+        a.s = config.chunk_size > 0
+                  ? recognizer.CreateStreamWithChunkSize(config.chunk_size)
+                  : recognizer.CreateStream();
+        (*results)[i].seconds = a.audio.Seconds();
+        batch.push_back(std::move(a));
+      }
+
+      int32_t num_done = 0;
+      while (num_done < static_cast<int32_t>(batch.size())) {
+        auto start = Clock::now();
+        ready.clear();
+        ready_active.clear();
+
+        for (auto &a : batch) {
+          if (a.done) continue;
+
+          int32_t sample_rate = a.audio.sample_rate;
+          int32_t size = a.audio.samples.size();
+          if (!a.finished) {
+            int32_t k = std::min<int32_t>(sample_rate * config.chunk_ms / 1000,
+                                          size - a.offset);
+            a.s->AcceptWaveform(sample_rate, a.audio.samples.data() + a.offset,
+                                k);
+            a.offset += k;
+
+            if (a.offset == size) {
+              std::vector<float> tail_paddings(0.3 * sample_rate);
+              a.s->AcceptWaveform(sample_rate, tail_paddings.data(),
+                                  tail_paddings.size());
+              a.s->InputFinished();
+              a.finished = true;
+              a.end_of_audio = start;
+            }
+          }
+
+          if (recognizer.IsReady(a.s.get())) {
+            ready.push_back(a.s.get());
+            ready_active.push_back(&a);
+          } else if (a.finished) {
+            UtteranceResult &r = (*results)[a.i];
+            a.s->Finalize();
+            r.hyp = recognizer.GetResult(a.s.get()).text;
+            r.final_ms = Ms(Clock::now() - a.end_of_audio);
+            r.ok = true;
+            a.done = true;
+            ++num_done;
+          }
+        }
+
+        while (!ready.empty()) {
+          recognizer.DecodeStreams(ready.data(), ready.size());
+          auto now = Clock::now();
+
+          int32_t k = 0;
+          for (int32_t j = 0; j != static_cast<int32_t>(ready.size()); ++j) {
+            Active *a = ready_active[j];
+            if (recognizer.IsReady(a->s.get())) {
+              ready[k] = ready[j];
+              ready_active[k] = a;
+              ++k;
+              continue;
+            }
+
+            UtteranceResult &r = (*results)[a->i];
+            if (r.first_partial_ms >= 0) continue;
+
+            auto result = recognizer.GetResult(a->s.get());
+            if (result.text.empty()) continue;
+
+            double audio_ms = 1000. * a->offset / a->audio.sample_rate;
+            double token_ms =
+                result.timestamps.empty() ? 0 : 1000 * result.timestamps[0];
+            r.first_partial_ms =
+                std::max(0.0, audio_ms + Ms(now - start) - token_ms);
+          }
+          ready.resize(k);
+          ready_active.resize(k);
+        }
+      }
+    }
+  };
+
+  int32_t num_workers = std::max(1, std::min(config.num_workers, n));
+  std::vector<std::thread> threads;
+  for (int32_t i = 1; i < num_workers; ++i) {
+    threads.emplace_back(run);
+  }
+  run();
+
+  for (auto &t : threads) {
+    t.join();
+  }
+}
+
+// Files are read on num_io_threads threads and decoded in batches of
+// similar durations by an OfflineJobQueue with num_workers threads
+void EvaluateOffline(const sherpa_ncnn::OfflineRecognizer &recognizer,
+                     const std::vector<Utterance> &utterances,
+                     const EvalConfig &config,
+                     std::vector<UtteranceResult> *results) {
+  sherpa_ncnn::OfflineJobQueueConfig queue_config;
+  queue_config.num_threads = config.num_workers;
+  queue_config.max_batch_size = config.max_batch_size;
+  queue_config.max_latency_ms = 200;
+
+  sherpa_ncnn::OfflineJobQueue queue(&recognizer, queue_config);
+  // Limits the number of streams that are read but not decoded yet, so
+  // that memory stays bounded however long the manifest is
+  sherpa_ncnn::Slots slots(std::max(1, config.max_in_flight));
+
+  int32_t n = utterances.size();
+  std::atomic<int32_t> next{0};
+
+  auto read = [&]() {
+    Audio audio;
+    for (int32_t i; (i = next++) < n;) {
+      if (!ReadAudio(utterances[i].filename, &audio)) continue;
+
+      slots.Acquire();
+
+      auto s = recognizer.CreateStream();
+      s->AcceptWaveform(audio.sample_rate, audio.samples.data(),
+                        audio.samples.size());
+      (*results)[i].seconds = audio.Seconds();
+
+      auto start = Clock::now();
+
+      // The stream is owned by its callback from here on
+      queue.Submit(s.release(), [&, i, start](sherpa_ncnn::OfflineStream *s) {
+        UtteranceResult &r = (*results)[i];
+        r.final_ms = Ms(Clock::now() - start);
+        r.hyp = s->GetResult().text;
+        r.ok = true;
+        delete s;
+        slots.Release();
+      });
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int32_t i = 0; i < std::max(1, config.num_io_threads); ++i) {
+    threads.emplace_back(read);
+  }
+
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  queue.WaitIdle();
+}
+
+EvalResult Summarize(const std::string &mode,
+                     const std::vector<Utterance> &utterances,
+                     const std::vector<UtteranceResult> &results,
+                     double elapsed_seconds, std::ostream *os) {
+  EvalResult ans;
+  ans.mode = mode;
+  ans.elapsed_seconds = elapsed_seconds;
+
+  std::vector<double> first_partial;
+  std::vector<double> final_result;
+
+  for (int32_t i = 0; i != static_cast<int32_t>(utterances.size()); ++i) {
+    const Utterance &u = utterances[i];
+    const UtteranceResult &r = results[i];
+    if (!r.ok) {
+      ++ans.num_failed;
+      continue;
+    }
+
+    ++ans.num_utterances;
+    ans.audio_seconds += r.seconds;
+
+    auto words = ComputeErrorStats(SplitWordsForErrorRate(u.ref),
+                                   SplitWordsForErrorRate(r.hyp));
+    auto chars = ComputeErrorStats(SplitCharsForErrorRate(u.ref),
+                                   SplitCharsForErrorRate(r.hyp));
+    ans.words += words;
+    ans.chars += chars;
+
+    if (r.first_partial_ms >= 0) {
+      first_partial.push_back(r.first_partial_ms);
+    }
+    final_result.push_back(r.final_ms);
+
+    if (os) {
+      *os << "{\"mode\": \"" << mode << "\", "
+          << "\"filename\": " << ToJsonString(u.filename) << ", "
+          << "\"duration\": " << r.seconds << ", "
+          << "\"ref\": " << ToJsonString(u.ref) << ", "
+          << "\"hyp\": " << ToJsonString(r.hyp) << ", "
+          << "\"word_errors\": " << words.NumErrors() << ", "
+          << "\"char_errors\": " << chars.NumErrors() << ", "
+          << "\"first_partial_ms\": " << r.first_partial_ms << ", "
+          << "\"final_ms\": " << r.final_ms << "}\n";
+    }
+  }
+
+  ans.first_partial = ComputeLatency(std::move(first_partial));
+  ans.final_result = ComputeLatency(std::move(final_result));
+  ans.peak_rss_kb = PeakRssKb();
+
+  return ans;
+}
+
+void Print(const EvalResult &r) {
+  fprintf(stderr,
+          "%s: %d utterances (%d failed), %.1f s of audio in %.1f s\n"
+          "  RTF: %.3f\n"
+          "  WER: %.2f%% (%d / %d), CER: %.2f%% (%d / %d)\n",
+          r.mode.c_str(), r.num_utterances, r.num_failed, r.audio_seconds,
+          r.elapsed_seconds, r.Rtf(), 100 * r.words.Rate(),
+          static_cast<int32_t>(r.words.NumErrors()),
+          static_cast<int32_t>(r.words.num_ref), 100 * r.chars.Rate(),
+          static_cast<int32_t>(r.chars.NumErrors()),
+          static_cast<int32_t>(r.chars.num_ref));
+
+  if (r.mode == "streaming") {
+    fprintf(stderr, "  first partial (ms): p50 %.1f, p90 %.1f, p99 %.1f\n",
+            r.first_partial.p50_ms, r.first_partial.p90_ms,
+            r.first_partial.p99_ms);
+  }
+
+  fprintf(stderr,
+          "  final (ms): p50 %.1f, p90 %.1f, p99 %.1f\n"
+          "  peak RSS: %.1f MB\n",
+          r.final_result.p50_ms, r.final_result.p90_ms, r.final_result.p99_ms,
+          r.peak_rss_kb / 1024.0);
+
+  fprintf(stdout, "%s\n", r.ToJson().c_str());
+  fflush(stdout);
+}
+
+}  // namespace
+
+int32_t main(int32_t argc, char *argv[]) {
+  const char *kUsageMessage = R"usage(
+Measure the accuracy and the speed of a recognizer together, e.g., to
+find out whether tuning --beam, --precision, an int8 model or a chunk
+size is a net win.
+
+Each line of --manifest is a wave file followed by its reference text:
+
+  /path/to/foo.wav the reference text of foo
+  /path/to/bar.wav 参考文本
+
+The streaming recognizer is evaluated if --tokens or --bundle is given,
+and the offline recognizer if --offline.tokens is given. For each of them,
+a summary is printed to stderr and one JSON line to stdout, e.g., for
+gating regressions:
+
+  wer              word error rate. Each Chinese character counts as a
+                   word, i.e., it is the mixed error rate of mixed text.
+  cer              character error rate, ignoring whitespace
+  rtf              wall time / audio time of all utterances
+  first_partial_*  streaming only: time from the start of the first
+                   token until it is shown as a partial result, if the
+                   audio were fed in real time
+  final_*          streaming: time from the end of the audio until the
+                   final result. offline: time from submitting a file
+                   until its result, including waiting for a batch.
+  peak_rss_kb      peak resident memory of the process so far
+
+Texts are compared in lower case. Normalize the references the way the
+model writes its results, e.g., without punctuation.
+
+Usage:
+
+  ./bin/sherpa-ncnn-eval \
+    --tokens=/path/to/tokens.txt \
+    --encoder-param=/path/to/encoder.ncnn.param \
+    --encoder-bin=/path/to/encoder.ncnn.bin \
+    --decoder-param=/path/to/decoder.ncnn.param \
+    --decoder-bin=/path/to/decoder.ncnn.bin \
+    --joiner-param=/path/to/joiner.ncnn.param \
+    --joiner-bin=/path/to/joiner.ncnn.bin \
+    --decoding-method=modified_beam_search \
+    --num-workers=4 \
+    --manifest=/path/to/test.txt
+
+  ./bin/sherpa-ncnn-eval \
+    --offline.tokens=/path/to/sense-voice/tokens.txt \
+    --offline.sense-voice-model-dir=/path/to/sense-voice \
+    --num-workers=4 \
+    --manifest=/path/to/test.txt \
+    --output=/path/to/results.jsonl
+)usage";
+
+  sherpa_ncnn::ParseOptions po(kUsageMessage);
+
+  sherpa_ncnn::RecognizerConfig config;
+  sherpa_ncnn::OfflineRecognizerConfig offline_config;
+  EvalConfig eval_config;
+
+  int32_t num_threads = 1;
+  std::string precision;
+  std::string manifest;
+  std::string output;
+
+  auto &model_config = config.model_config;
+  po.Register("tokens", &model_config.tokens, "Path to tokens.txt");
+  po.Register("encoder-param", &model_config.encoder_param,
+              "Path to encoder.ncnn.param");
+  po.Register("encoder-bin", &model_config.encoder_bin,
+              "Path to encoder.ncnn.bin");
+  po.Register("decoder-param", &model_config.decoder_param,
+              "Path to decoder.ncnn.param");
+  po.Register("decoder-bin", &model_config.decoder_bin,
+              "Path to decoder.ncnn.bin");
+  po.Register("joiner-param", &model_config.joiner_param,
+              "Path to joiner.ncnn.param");
+  po.Register("joiner-bin", &model_config.joiner_bin,
+              "Path to joiner.ncnn.bin");
+  po.Register("bundle", &model_config.bundle,
+              "Path to a model bundle. If given, the paths above are "
+              "ignored");
+  po.Register("num-threads", &num_threads,
+              "Number of threads of each network");
+  po.Register("precision", &precision,
+              "accuracy, balanced or speed for all networks, see "
+              "ModelConfig::encoder_precision");
+  po.Register("decoding-method", &config.decoder_config.method,
+              "greedy_search or modified_beam_search");
+  po.Register("num-active-paths", &config.decoder_config.num_active_paths,
+              "Used only for modified_beam_search");
+  po.Register("beam", &config.decoder_config.beam,
+              "Used only for modified_beam_search. If positive, prune paths "
+              "more than this log prob below the best one");
+  po.Register("hotwords-file", &config.hotwords_file,
+              "Used only for modified_beam_search");
+  po.Register("chunk-size", &eval_config.chunk_size,
+              "If positive, decode with the encoder whose chunk size is "
+              "closest to it, in feature frames. See "
+              "ModelConfig::encoder_variants");
+  po.Register("chunk-ms", &eval_config.chunk_ms,
+              "Duration of the chunks that are fed to each stream");
+
+  sherpa_ncnn::ParseOptions offline_po("offline", &po);
+  offline_config.Register(&offline_po);
+  po.Register("num-io-threads", &eval_config.num_io_threads,
+              "Used only for the offline recognizer. Number of threads that "
+              "read files and compute features");
+  po.Register("max-in-flight", &eval_config.max_in_flight,
+              "Used only for the offline recognizer. Maximum number of files "
+              "that are read but not yet decoded");
+
+  po.Register("manifest", &manifest,
+              "A file with a wave file and its reference text per line");
+  po.Register("output", &output,
+              "If not empty, write the result of each utterance to this "
+              "file as JSON lines");
+  po.Register("num-workers", &eval_config.num_workers,
+              "Number of threads that decode utterances");
+  po.Register("max-batch-size", &eval_config.max_batch_size,
+              "A worker decodes at most this many utterances together");
+
+  po.Read(argc, argv);
+  if (po.NumArgs() != 0 || manifest.empty()) {
+    po.PrintUsage();
+    exit(EXIT_FAILURE);
+  }
+
+  if (eval_config.num_workers < 1 || eval_config.max_batch_size < 1 ||
+      eval_config.chunk_ms <= 0) {
+    fprintf(stderr,
+            "Invalid --num-workers, --max-batch-size or --chunk-ms\n");
+    exit(EXIT_FAILURE);
+  }
+
+  bool streaming = !model_config.tokens.empty() || !model_config.bundle.empty();
+  bool offline = !offline_config.model_config.tokens.empty();
+  if (!streaming && !offline) {
+    fprintf(stderr, "Please provide a streaming or an offline model\n\n");
+    po.PrintUsage();
+    exit(EXIT_FAILURE);
+  }
+
+  std::vector<Utterance> utterances;
+  if (!ReadManifest(manifest, &utterances)) {
+    return -1;
+  }
+
+  if (utterances.empty()) {
+    fprintf(stderr, "No utterances in '%s'\n", manifest.c_str());
+    return -1;
+  }
+
+  std::ofstream os;
+  if (!output.empty()) {
+    os.open(output);
+    if (!os) {
+      fprintf(stderr, "Failed to open '%s'\n", output.c_str());
+      return -1;
+    }
+  }
+  std::ostream *out = output.empty() ? nullptr : &os;
+
+  if (streaming) {
+    model_config.encoder_opt.num_threads = num_threads;
+    model_config.decoder_opt.num_threads = num_threads;
+    model_config.joiner_opt.num_threads = num_threads;
+    model_config.encoder_precision = precision;
+    model_config.decoder_precision = precision;
+    model_config.joiner_precision = precision;
+
+    fprintf(stderr, "%s\n", config.ToString().c_str());
+
+    sherpa_ncnn::Recognizer recognizer(config);
+    std::vector<UtteranceResult> results(utterances.size());
+
+    auto begin = Clock::now();
+    EvaluateStreaming(recognizer, utterances, eval_config, &results);
+    double elapsed_seconds = Ms(Clock::now() - begin) / 1000;
+
+    Print(Summarize("streaming", utterances, results, elapsed_seconds, out));
+  }
+
+  if (offline) {
+    fprintf(stderr, "%s\n", offline_config.ToString().c_str());
+
+    if (!offline_config.Validate()) {
+      fprintf(stderr, "Errors in the config of the offline recognizer!\n");
+      return -1;
+    }
+
+    sherpa_ncnn::OfflineRecognizer recognizer(offline_config);
+    std::vector<UtteranceResult> results(utterances.size());
+
+    auto begin = Clock::now();
+    EvaluateOffline(recognizer, utterances, eval_config, &results);
+    double elapsed_seconds = Ms(Clock::now() - begin) / 1000;
+
+    Print(Summarize("offline", utterances, results, elapsed_seconds, out));
+  }
+
+  return 0;
+}
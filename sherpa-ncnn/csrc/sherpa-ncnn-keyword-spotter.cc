@@ -0,0 +1,128 @@
+// sherpa-ncnn/csrc/sherpa-ncnn-keyword-spotter.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/keyword-spotter.h"
+#include "sherpa-ncnn/csrc/parse-options.h"
+#include "sherpa-ncnn/csrc/wave-reader.h"
+
+int32_t main(int32_t argc, char *argv[]) {
+  const char *kUsageMessage = R"usage(
+Detect keywords in a wave file. The file is fed in chunks of
+--chunk-seconds as if it were a live stream.
+
+Usage:
+
+  ./bin/sherpa-ncnn-keyword-spotter \
+    --tokens=/path/to/tokens.txt \
+    --encoder-param=/path/to/encoder.ncnn.param \
+    --encoder-bin=/path/to/encoder.ncnn.bin \
+    --decoder-param=/path/to/decoder.ncnn.param \
+    --decoder-bin=/path/to/decoder.ncnn.bin \
+    --joiner-param=/path/to/joiner.ncnn.param \
+    --joiner-bin=/path/to/joiner.ncnn.bin \
+    --keywords-file=/path/to/keywords.txt \
+    /path/to/foo.wav
+
+Each line of the keywords file contains the tokens of one keyword,
+optionally followed by #threshold and @text, e.g.,
+
+  ▁HE LL O ▁WORLD #0.3 @HELLO_WORLD
+)usage";
+
+  sherpa_ncnn::ParseOptions po(kUsageMessage);
+
+  sherpa_ncnn::KeywordSpotterConfig config;
+  int32_t num_threads = 1;
+  float chunk_seconds = 0.1;
+
+  auto &model_config = config.model_config;
+  po.Register("tokens", &model_config.tokens, "Path to tokens.txt");
+  po.Register("encoder-param", &model_config.encoder_param,
+              "Path to encoder.ncnn.param");
+  po.Register("encoder-bin", &model_config.encoder_bin,
+              "Path to encoder.ncnn.bin");
+  po.Register("decoder-param", &model_config.decoder_param,
+              "Path to decoder.ncnn.param");
+  po.Register("decoder-bin", &model_config.decoder_bin,
+              "Path to decoder.ncnn.bin");
+  po.Register("joiner-param", &model_config.joiner_param,
+              "Path to joiner.ncnn.param");
+  po.Register("joiner-bin", &model_config.joiner_bin,
+              "Path to joiner.ncnn.bin");
+  po.Register("num-threads", &num_threads, "Number of threads of each network");
+  po.Register("keywords-file", &config.keywords_file, "Path to the keywords");
+  po.Register("keywords-threshold", &config.keywords_threshold,
+              "Threshold of keywords without one of their own");
+  po.Register("num-trailing-blanks", &config.num_trailing_blanks,
+              "Blank frames after a keyword before it is detected");
+  po.Register("num-active-paths", &config.num_active_paths,
+              "Number of partial matches to keep");
+  po.Register("max-pause", &config.max_pause,
+              "Seconds after which a partial match is dropped");
+  po.Register("idle-chunks", &config.idle_chunks,
+              "Chunks decoded at a time while no keyword is partially "
+              "matched");
+  po.Register("chunk-seconds", &chunk_seconds,
+              "Seconds of audio fed at a time");
+
+  po.Read(argc, argv);
+  if (po.NumArgs() != 1) {
+    po.PrintUsage();
+    exit(EXIT_FAILURE);
+  }
+
+  model_config.encoder_opt.num_threads = num_threads;
+  model_config.decoder_opt.num_threads = num_threads;
+  model_config.joiner_opt.num_threads = num_threads;
+
+  fprintf(stderr, "%s\n", config.ToString().c_str());
+
+  sherpa_ncnn::KeywordSpotter spotter(config);
+
+  std::string wav_filename = po.GetArg(1);
+  int32_t sampling_rate = -1;
+  bool is_ok = false;
+  std::vector<float> samples =
+      sherpa_ncnn::ReadWave(wav_filename, &sampling_rate, &is_ok);
+  if (!is_ok) {
+    fprintf(stderr, "Failed to read '%s'\n", wav_filename.c_str());
+    exit(EXIT_FAILURE);
+  }
+
+  auto s = spotter.CreateStream();
+
+  auto decode = [&spotter, &s]() {
+    while (spotter.IsReady(s.get())) {
+      spotter.DecodeStream(s.get());
+
+      auto r = spotter.GetResult(s.get());
+      if (!r.keyword.empty()) {
+        fprintf(stderr, "%s", r.ToString().c_str());
+      }
+    }
+  };
+
+  int32_t chunk = std::max<int32_t>(1, chunk_seconds * sampling_rate);
+  std::vector<float> tail_paddings(static_cast<int>(0.3 * sampling_rate));
+  samples.insert(samples.end(), tail_paddings.begin(), tail_paddings.end());
+
+  for (int32_t start = 0; start < static_cast<int32_t>(samples.size());
+       start += chunk) {
+    int32_t n = std::min<int32_t>(chunk, samples.size() - start);
+    s->AcceptWaveform(sampling_rate, samples.data() + start, n);
+    decode();
+  }
+
+  s->InputFinished();
+  decode();
+
+  return 0;
+}
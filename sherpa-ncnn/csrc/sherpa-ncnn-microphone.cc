@@ -21,8 +21,12 @@
 #include <stdlib.h>
 
 #include <cctype>  // std::tolower
+#include <memory>
+#include <vector>
 
 #include "portaudio.h"  // NOLINT
+#include "sherpa-ncnn/csrc/audio-capture-queue.h"
+#include "sherpa-ncnn/csrc/burst-decoder.h"
 #include "sherpa-ncnn/csrc/display.h"
 #include "sherpa-ncnn/csrc/microphone.h"
 #include "sherpa-ncnn/csrc/recognizer.h"
@@ -35,10 +39,10 @@ static int32_t RecordCallback(const void *input_buffer,
                               const PaStreamCallbackTimeInfo * /*time_info*/,
                               PaStreamCallbackFlags /*status_flags*/,
                               void *user_data) {
-  auto s = reinterpret_cast<sherpa_ncnn::Stream *>(user_data);
-
-  s->AcceptWaveform(16000, reinterpret_cast<const float *>(input_buffer),
-                    frames_per_buffer);
+  // Feature extraction happens in the main loop, not in the audio thread
+  auto queue = reinterpret_cast<sherpa_ncnn::AudioCaptureQueue *>(user_data);
+  queue->Push(reinterpret_cast<const float *>(input_buffer),
+              frames_per_buffer);
 
   return stop ? paComplete : paContinue;
 }
@@ -62,6 +66,10 @@ Usage:
     /path/to/joiner.ncnn.bin \
     [num_threads] [decode_method, can be greedy_search/modified_beam_search] [hotwords_file] [hotwords_score]
 
+Set the environment variable SHERPA_NCNN_BURST_MS, e.g., to 300, to
+save power: audio is then decoded in bursts at most that many ms later
+than usual, on the big CPU cores, and the CPU sleeps in between.
+
 Please refer to
 https://k2-fsa.github.io/sherpa/ncnn/pretrained_models/index.html
 for a list of pre-trained models to download.
@@ -114,10 +122,24 @@ for a list of pre-trained models to download.
   config.feat_config.sampling_rate = expected_sampling_rate;
   config.feat_config.feature_dim = 80;
 
+  sherpa_ncnn::BurstDecoderConfig burst_config;
+  const char *burst_ms = std::getenv("SHERPA_NCNN_BURST_MS");
+  bool use_burst = burst_ms && atoi(burst_ms) > 0;
+  if (use_burst) {
+    burst_config.latency_ms = atoi(burst_ms);
+    sherpa_ncnn::BurstDecoder::UseBigCores(&config.model_config);
+    fprintf(stderr, "%s\n", burst_config.ToString().c_str());
+  }
+
   fprintf(stderr, "%s\n", config.ToString().c_str());
 
   sherpa_ncnn::Recognizer recognizer(config);
-  auto s = recognizer.CreateStream();
+  std::unique_ptr<sherpa_ncnn::BurstDecoder> burst;
+  if (use_burst) {
+    burst = std::make_unique<sherpa_ncnn::BurstDecoder>(recognizer,
+                                                        burst_config);
+  }
+  auto s = burst ? burst->CreateStream() : recognizer.CreateStream();
 
   sherpa_ncnn::Microphone mic;
 
@@ -139,7 +161,10 @@ for a list of pre-trained models to download.
 
   float sample_rate = 16000;
 
-  if (!mic.OpenDevice(device_index, sample_rate, 1, RecordCallback, s.get())) {
+  // Up to 30 seconds of audio while decoding is behind
+  sherpa_ncnn::AudioCaptureQueue queue(30 * sample_rate);
+
+  if (!mic.OpenDevice(device_index, sample_rate, 1, RecordCallback, &queue)) {
     fprintf(stderr, "Failed to open microphone device %d\n", device_index);
     exit(EXIT_FAILURE);
   }
@@ -147,12 +172,31 @@ for a list of pre-trained models to download.
   std::string last_text;
   int32_t segment_index = 0;
   sherpa_ncnn::Display display;
+  std::vector<float> samples(sample_rate);
+  bool is_endpoint = false;
   while (!stop) {
-    while (recognizer.IsReady(s.get())) {
-      recognizer.DecodeStream(s.get());
+    if (burst) {
+      // After an endpoint, the rest of the burst is decoded at once
+      if (!is_endpoint) burst->Sleep();
+    } else {
+      // Wake up as soon as the callback has delivered samples
+      queue.Wait(1, 100);
     }
 
-    bool is_endpoint = recognizer.IsEndpoint(s.get());
+    int32_t n = 0;
+    while ((n = queue.Pop(samples.data(), samples.size())) > 0) {
+      s->AcceptWaveform(sample_rate, samples.data(), n);
+    }
+
+    if (burst) {
+      burst->Decode(s.get());
+    } else {
+      while (recognizer.IsReady(s.get())) {
+        recognizer.DecodeStream(s.get());
+      }
+    }
+
+    is_endpoint = recognizer.IsEndpoint(s.get());
 
     if (is_endpoint) {
       s->Finalize();
@@ -175,8 +219,6 @@ for a list of pre-trained models to download.
 
       recognizer.Reset(s.get());
     }
-
-    Pa_Sleep(20);  // sleep for 20ms
   }
 
   return 0;
@@ -0,0 +1,262 @@
+// sherpa-ncnn/csrc/sherpa-ncnn-offline-batch.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <sstream>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/offline-job-queue.h"
+#include "sherpa-ncnn/csrc/offline-recognizer.h"
+#include "sherpa-ncnn/csrc/parse-options.h"
+#include "sherpa-ncnn/csrc/slots.h"
+#include "sherpa-ncnn/csrc/text-utils.h"
+#include "sherpa-ncnn/csrc/wave-reader.h"
+
+namespace {
+
+struct Utterance {
+  std::string key;
+  std::string filename;
+};
+
+// Each line is either "filename" or "key filename", e.g., a wav.scp
+bool ReadFileList(const std::string &filename,
+                  std::vector<Utterance> *utterances) {
+  std::ifstream is(filename);
+  if (!is) {
+    fprintf(stderr, "Failed to open '%s'\n", filename.c_str());
+    return false;
+  }
+
+  std::string line;
+  while (std::getline(is, line)) {
+    std::istringstream iss(line);
+    std::string a, b;
+    if (!(iss >> a)) continue;
+
+    if (iss >> b) {
+      utterances->push_back({a, b});
+    } else {
+      utterances->push_back({a, a});
+    }
+  }
+
+  return true;
+}
+
+}  // namespace
+
+int main(int32_t argc, char *argv[]) {
+  const char *kUsageMessage = R"usage(
+Transcribe many files with a non-streaming model in one process.
+
+Files are read and their features are computed on --num-io-threads
+threads. Files of similar durations are then decoded in batches with
+OfflineRecognizer::DecodeStreams() on --num-workers threads. Results are
+written as JSON lines in the order they are finished.
+
+Usage:
+
+  ./bin/sherpa-ncnn-offline-batch \
+    --tokens=./sherpa-ncnn-sense-voice-zh-en-ja-ko-yue-2024-07-17/tokens.txt \
+    --sense-voice-model-dir=./sherpa-ncnn-sense-voice-zh-en-ja-ko-yue-2024-07-17 \
+    --num-threads=2 \
+    --file-list=./wav.scp \
+    --output=./results.jsonl \
+    [foo.wav bar.wav ...]
+
+Each line of --file-list is either "/path/to/foo.wav" or "key /path/to/foo.wav".
+Wave files given as arguments are appended to the list.
+)usage";
+
+  sherpa_ncnn::ParseOptions po(kUsageMessage);
+  sherpa_ncnn::OfflineRecognizerConfig config;
+  sherpa_ncnn::OfflineJobQueueConfig queue_config;
+  queue_config.max_latency_ms = 200;
+
+  std::string file_list;
+  std::string output;
+  int32_t num_io_threads = 2;
+  int32_t max_in_flight = 64;
+
+  config.Register(&po);
+
+  po.Register("file-list", &file_list,
+              "A file that contains one wave file per line, optionally "
+              "preceded by a key");
+
+  po.Register("output", &output,
+              "Write the results to this file as JSON lines. If empty, "
+              "they are written to stdout");
+
+  po.Register("num-io-threads", &num_io_threads,
+              "Number of threads that read files and compute features");
+
+  po.Register("num-workers", &queue_config.num_threads,
+              "Number of threads that decode batches. Each of them uses "
+              "--num-threads threads for the model");
+
+  po.Register("max-batch-size", &queue_config.max_batch_size,
+              "Maximum number of files in a batch");
+
+  po.Register("max-latency-ms", &queue_config.max_latency_ms,
+              "A batch that is not full is decoded once its oldest file has "
+              "waited this long");
+
+  po.Register("bucket-width", &queue_config.bucket_width,
+              "Only files whose numbers of feature frames differ by less "
+              "than this are batched together");
+
+  po.Register("max-in-flight", &max_in_flight,
+              "Maximum number of files that are read but not yet decoded");
+
+  po.Read(argc, argv);
+
+  std::vector<Utterance> utterances;
+  if (!file_list.empty() && !ReadFileList(file_list, &utterances)) {
+    return -1;
+  }
+
+  for (int32_t i = 1; i <= po.NumArgs(); ++i) {
+    utterances.push_back({po.GetArg(i), po.GetArg(i)});
+  }
+
+  if (utterances.empty()) {
+    fprintf(stderr, "Error: Please provide --file-list or wave files.\n\n");
+    po.PrintUsage();
+    exit(EXIT_FAILURE);
+  }
+
+  fprintf(stderr, "%s\n", config.ToString().c_str());
+  fprintf(stderr, "%s\n", queue_config.ToString().c_str());
+
+  if (!config.Validate()) {
+    fprintf(stderr, "Errors in config!\n");
+    return -1;
+  }
+
+  std::ofstream os;
+  if (!output.empty()) {
+    os.open(output);
+    if (!os) {
+      fprintf(stderr, "Failed to open '%s'\n", output.c_str());
+      return -1;
+    }
+  }
+  std::ostream &out = output.empty() ? std::cout : os;
+
+  fprintf(stderr, "Creating recognizer ...\n");
+  sherpa_ncnn::OfflineRecognizer recognizer(config);
+  sherpa_ncnn::OfflineJobQueue queue(&recognizer, queue_config);
+
+  fprintf(stderr, "Started %d files\n",
+          static_cast<int32_t>(utterances.size()));
+  const auto begin = std::chrono::steady_clock::now();
+
+  // Limits the number of streams that are read but not decoded yet, so
+  // that memory stays bounded however long the list is
+  sherpa_ncnn::Slots slots(std::max(1, max_in_flight));
+  std::mutex out_mutex;
+
+  std::atomic<int32_t> next{0};
+  std::atomic<int32_t> num_failed{0};
+
+  // Sum of the durations of the files that are read, in seconds
+  std::atomic<double> duration{0};
+
+  auto read = [&]() {
+    std::vector<float> block;
+
+    for (int32_t i; (i = next++) < static_cast<int32_t>(utterances.size());) {
+      const Utterance &u = utterances[i];
+
+      auto reader = sherpa_ncnn::WaveFileReader::Open(u.filename);
+      if (!reader) {
+        fprintf(stderr, "Failed to read '%s'\n", u.filename.c_str());
+        ++num_failed;
+        continue;
+      }
+
+      slots.Acquire();
+
+      // The features are computed block by block as the file is read
+      int32_t sample_rate = reader->SampleRate();
+      block.resize(sample_rate);
+
+      auto s = recognizer.CreateStream();
+      int32_t n = 0;
+      while ((n = reader->Read(block.data(), block.size())) > 0) {
+        s->AcceptWaveform(sample_rate, block.data(), n);
+      }
+
+      float d = reader->Duration();
+      double old = duration.load();
+      while (!duration.compare_exchange_weak(old, old + d)) {
+      }
+
+      // The stream is owned by its callback from here on
+      queue.Submit(s.release(), [&, i, d](sherpa_ncnn::OfflineStream *s) {
+        std::string json = s->GetResult().AsJsonString();
+        delete s;
+        slots.Release();
+
+        const Utterance &u = utterances[i];
+        std::ostringstream line;
+        line << "{\"key\": " << ToJsonString(u.key)
+             << ", \"filename\": " << ToJsonString(u.filename)
+             << ", \"duration\": " << d << ", " << json.substr(1) << "\n";
+
+        std::lock_guard<std::mutex> lock(out_mutex);
+        out << line.str();
+      });
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int32_t i = 0; i < std::max(1, num_io_threads); ++i) {
+    threads.emplace_back(read);
+  }
+
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  queue.WaitIdle();
+  out.flush();
+
+  const auto end = std::chrono::steady_clock::now();
+  float elapsed_seconds =
+      std::chrono::duration_cast<std::chrono::milliseconds>(end - begin)
+          .count() /
+      1000.;
+
+  int32_t num_decoded = utterances.size() - num_failed;
+  float total_duration = duration;
+
+  fprintf(stderr, "Done!\n\n");
+  fprintf(stderr, "num threads: %d\n", config.model_config.num_threads);
+  fprintf(stderr, "num workers: %d\n", queue_config.num_threads);
+  fprintf(stderr, "decoding method: %s\n", config.decoding_method.c_str());
+  fprintf(stderr, "Decoded files: %d, failed: %d\n", num_decoded,
+          num_failed.load());
+  fprintf(stderr, "Elapsed seconds: %.3f s\n", elapsed_seconds);
+  fprintf(stderr, "Audio seconds: %.3f s\n", total_duration);
+  fprintf(stderr, "Real time factor (RTF): %.3f / %.3f = %.3f\n",
+          elapsed_seconds, total_duration, elapsed_seconds / total_duration);
+  fprintf(stderr, "Throughput: %.2f files/s, %.2f audio seconds/s\n",
+          num_decoded / elapsed_seconds, total_duration / elapsed_seconds);
+
+  return 0;
+}
@@ -9,12 +9,14 @@
 #include "sherpa-ncnn/csrc/parse-options.h"
 #include "sherpa-ncnn/csrc/wave-writer.h"
 
-static int32_t AudioCallback(const float * /*samples*/, int32_t num_samples,
+static int32_t AudioCallback(const int16_t *samples, int32_t num_samples,
                              int32_t processed, int32_t total, void *arg) {
   float progress = static_cast<float>(processed) / total;
   printf("Progress=%.3f%%\n", progress * 100);
 
-  return 1;
+  // The audio goes to the file as it is generated
+  auto writer = reinterpret_cast<sherpa_ncnn::WaveWriter *>(arg);
+  return writer->Write(samples, num_samples);
 }
 
 int main(int32_t argc, char *argv[]) {
@@ -83,15 +85,26 @@ or details.
 
   sherpa_ncnn::OfflineTts tts(config);
 
+  sherpa_ncnn::WaveWriter writer(output_filename, tts.SampleRate());
+  if (!writer.Ok()) {
+    fprintf(stderr, "Failed to create %s\n", output_filename.c_str());
+    exit(EXIT_FAILURE);
+  }
+
   const auto begin = std::chrono::steady_clock::now();
   sherpa_ncnn::TtsArgs args;
   args.text = po.GetArg(1);
   args.sid = sid;
   args.speed = 1.0;
-  auto audio = tts.Generate(args, AudioCallback);
+  int64_t num_samples = tts.GenerateInt16(args, AudioCallback, &writer);
   const auto end = std::chrono::steady_clock::now();
 
-  if (audio.samples.empty()) {
+  if (!writer.Close()) {
+    fprintf(stderr, "Failed to write wave to %s\n", output_filename.c_str());
+    exit(EXIT_FAILURE);
+  }
+
+  if (num_samples == 0) {
     fprintf(
         stderr,
         "Error in generating audio. Please read previous error messages.\n");
@@ -102,7 +115,7 @@ or details.
       std::chrono::duration_cast<std::chrono::milliseconds>(end - begin)
           .count() /
       1000.;
-  float duration = audio.samples.size() / static_cast<float>(audio.sample_rate);
+  float duration = num_samples / static_cast<float>(tts.SampleRate());
 
   float rtf = elapsed_seconds / duration;
   fprintf(stderr, "Number of threads: %d\n", config.model.num_threads);
@@ -111,13 +124,6 @@ or details.
   fprintf(stderr, "Real-time factor (RTF): %.3f/%.3f = %.3f\n", elapsed_seconds,
           duration, rtf);
 
-  bool ok = sherpa_ncnn::WriteWave(output_filename, audio.sample_rate,
-                                   audio.samples.data(), audio.samples.size());
-  if (!ok) {
-    fprintf(stderr, "Failed to write wave to %s\n", output_filename.c_str());
-    exit(EXIT_FAILURE);
-  }
-
   fprintf(stderr, "The text is: %s. Speaker ID: %d\n", po.GetArg(1).c_str(),
           sid);
   fprintf(stderr, "Saved to %s successfully!\n", output_filename.c_str());
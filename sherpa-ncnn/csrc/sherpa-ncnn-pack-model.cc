@@ -0,0 +1,197 @@
+// sherpa-ncnn/csrc/sherpa-ncnn-pack-model.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <stdio.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/file-utils.h"
+#include "sherpa-ncnn/csrc/lexicon.h"
+#include "sherpa-ncnn/csrc/model-bundle.h"
+#include "sherpa-ncnn/csrc/offline-tts-vits-model-meta-data.h"
+#include "sherpa-ncnn/csrc/parse-options.h"
+#include "sherpa-ncnn/csrc/symbol-table.h"
+
+static std::string ReadFileAsString(const std::string &filename) {
+  if (!sherpa_ncnn::FileExists(filename)) {
+    fprintf(stderr, "'%s' does not exist\n", filename.c_str());
+    exit(EXIT_FAILURE);
+  }
+
+  std::vector<char> buffer = sherpa_ncnn::ReadFile(filename);
+  return std::string(buffer.begin(), buffer.end());
+}
+
+int main(int32_t argc, char *argv[]) {
+  const char *kUsageMessage = R"usage(
+Pack all files of a model into a single model bundle, which is loaded with
+one memory map.
+
+Usage:
+
+(1) Streaming transducer models
+
+./bin/sherpa-ncnn-pack-model \
+  --encoder-param=/path/to/encoder_jit_trace-pnnx.ncnn.param \
+  --encoder-bin=/path/to/encoder_jit_trace-pnnx.ncnn.bin \
+  --decoder-param=/path/to/decoder_jit_trace-pnnx.ncnn.param \
+  --decoder-bin=/path/to/decoder_jit_trace-pnnx.ncnn.bin \
+  --joiner-param=/path/to/joiner_jit_trace-pnnx.ncnn.param \
+  --joiner-bin=/path/to/joiner_jit_trace-pnnx.ncnn.bin \
+  --tokens=/path/to/tokens.txt \
+  ./model.bundle
+
+Use it with ModelConfig::bundle.
+
+(2) VITS models
+
+./bin/sherpa-ncnn-pack-model \
+  --vits-model-dir=./ncnn-vits-piper-en_US-amy-low \
+  ./vits.bundle
+
+Use it with --vits-bundle.
+
+(3) Only tokens
+
+./bin/sherpa-ncnn-pack-model \
+  --tokens=/path/to/tokens.txt \
+  --tokens-only=true \
+  ./tokens.bin
+
+It saves the binary form of tokens.txt, which can be passed to --tokens
+in place of tokens.txt; it is memory mapped instead of parsed.
+)usage";
+
+  sherpa_ncnn::ParseOptions po(kUsageMessage);
+
+  std::string encoder_param;
+  std::string encoder_bin;
+  std::string decoder_param;
+  std::string decoder_bin;
+  std::string joiner_param;
+  std::string joiner_bin;
+  std::string tokens;
+  std::string vits_model_dir;
+  bool tokens_only = false;
+
+  po.Register("encoder-param", &encoder_param, "Path to encoder.ncnn.param");
+  po.Register("encoder-bin", &encoder_bin, "Path to encoder.ncnn.bin");
+  po.Register("decoder-param", &decoder_param, "Path to decoder.ncnn.param");
+  po.Register("decoder-bin", &decoder_bin, "Path to decoder.ncnn.bin");
+  po.Register("joiner-param", &joiner_param, "Path to joiner.ncnn.param");
+  po.Register("joiner-bin", &joiner_bin, "Path to joiner.ncnn.bin");
+  po.Register("tokens", &tokens, "Path to tokens.txt");
+  po.Register("vits-model-dir", &vits_model_dir,
+              "Path to a VITS model directory. If given, the options above "
+              "are ignored");
+  po.Register("tokens-only", &tokens_only,
+              "Save only the binary form of --tokens instead of a bundle");
+
+  po.Read(argc, argv);
+
+  if (po.NumArgs() != 1) {
+    fprintf(stderr, "Error: Please provide the output filename.\n\n");
+    po.PrintUsage();
+    exit(EXIT_FAILURE);
+  }
+
+  std::string output_filename = po.GetArg(1);
+
+  if (tokens_only) {
+    if (tokens.empty() || !sherpa_ncnn::FileExists(tokens)) {
+      fprintf(stderr, "Error: Please provide --tokens.\n\n");
+      po.PrintUsage();
+      exit(EXIT_FAILURE);
+    }
+
+    std::string binary = sherpa_ncnn::SymbolTable(tokens).ToBinary();
+    std::ofstream os(output_filename, std::ios::binary);
+    if (!os.write(binary.data(), binary.size())) {
+      fprintf(stderr, "Failed to write %s\n", output_filename.c_str());
+      exit(EXIT_FAILURE);
+    }
+
+    fprintf(stderr, "Saved to %s\n", output_filename.c_str());
+    return 0;
+  }
+
+  // (section name, path)
+  std::vector<std::pair<std::string, std::string>> files;
+
+  sherpa_ncnn::ModelBundleWriter writer;
+
+  if (!vits_model_dir.empty()) {
+    std::vector<std::string> names = {
+        "config.json",        "encoder.ncnn.param", "encoder.ncnn.bin",
+        "dp.ncnn.param",      "dp.ncnn.bin",        "flow.ncnn.param",
+        "flow.ncnn.bin",      "decoder.ncnn.param", "decoder.ncnn.bin",
+    };
+
+    sherpa_ncnn::OfflineTtsVitsModelMetaData meta =
+        sherpa_ncnn::ReadFromConfigJson(vits_model_dir + "/config.json");
+    if (meta.num_speakers > 1) {
+      names.push_back("embedding.ncnn.param");
+      names.push_back("embedding.ncnn.bin");
+    }
+
+    for (const auto &name : names) {
+      files.emplace_back(name, vits_model_dir + "/" + name);
+    }
+
+    // The lexicon is compiled so that it is not parsed at startup
+    std::string lexicon = vits_model_dir + "/lexicon.bin";
+    if (sherpa_ncnn::FileExists(lexicon)) {
+      files.emplace_back("lexicon.bin", lexicon);
+    } else {
+      std::istringstream is(
+          ReadFileAsString(vits_model_dir + "/lexicon.txt"));
+      writer.AddSection("lexicon.bin",
+                        sherpa_ncnn::Lexicon::Compile(is, meta.token2id));
+    }
+  } else {
+    files = {
+        {"encoder.ncnn.param", encoder_param},
+        {"encoder.ncnn.bin", encoder_bin},
+        {"decoder.ncnn.param", decoder_param},
+        {"decoder.ncnn.bin", decoder_bin},
+        {"joiner.ncnn.param", joiner_param},
+        {"joiner.ncnn.bin", joiner_bin},
+    };
+
+    for (const auto &f : files) {
+      if (f.second.empty()) {
+        fprintf(stderr, "Error: Please provide the path to %s.\n\n",
+                f.first.c_str());
+        po.PrintUsage();
+        exit(EXIT_FAILURE);
+      }
+    }
+
+    if (tokens.empty() || !sherpa_ncnn::FileExists(tokens)) {
+      fprintf(stderr, "Error: Please provide --tokens.\n\n");
+      po.PrintUsage();
+      exit(EXIT_FAILURE);
+    }
+
+    // Tokens are stored in binary so that they are not parsed at startup
+    writer.AddSection("tokens", sherpa_ncnn::SymbolTable(tokens).ToBinary());
+  }
+
+  for (const auto &f : files) {
+    writer.AddSection(f.first, ReadFileAsString(f.second));
+  }
+
+  if (!writer.Write(output_filename)) {
+    fprintf(stderr, "Failed to write %s\n", output_filename.c_str());
+    exit(EXIT_FAILURE);
+  }
+
+  fprintf(stderr, "Saved to %s\n", output_filename.c_str());
+
+  return 0;
+}
@@ -0,0 +1,469 @@
+// sherpa-ncnn/csrc/sherpa-ncnn-profile-model.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "layer.h"  // NOLINT
+#include "net.h"    // NOLINT
+#include "sherpa-ncnn/csrc/file-utils.h"
+#include "sherpa-ncnn/csrc/model.h"
+#include "sherpa-ncnn/csrc/parse-options.h"
+#include "sherpa-ncnn/csrc/recognizer.h"
+#include "sherpa-ncnn/csrc/wave-reader.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// What is measured for one layer of a network
+struct LayerStats {
+  std::string name;
+  std::string type;
+
+  int64_t count = 0;  // number of forward calls
+  double total_ms = 0;
+  double flops = 0;  // summed over the calls
+
+  // Of the first top blob of the last call
+  std::string shape;
+  int32_t elempack = 0;
+  int32_t elemsize = 0;
+  std::size_t out_bytes = 0;  // of all top blobs
+};
+
+// The integer parameters of each layer of a .param file, i.e., the keys
+// and values after the blob names, by layer name. Array and float values
+// are skipped.
+using LayerParams = std::map<std::string, std::map<int32_t, int64_t>>;
+
+LayerParams ParseParams(const std::string &text) {
+  LayerParams ans;
+
+  std::istringstream is(text);
+  std::string line;
+  std::getline(is, line);  // magic
+  std::getline(is, line);  // layer and blob counts
+
+  while (std::getline(is, line)) {
+    std::istringstream ls(line);
+    std::string type, name;
+    int32_t num_bottoms = 0, num_tops = 0;
+    if (!(ls >> type >> name >> num_bottoms >> num_tops)) continue;
+
+    std::string s;
+    for (int32_t i = 0; i != num_bottoms + num_tops; ++i) {
+      ls >> s;
+    }
+
+    auto &params = ans[name];
+    while (ls >> s) {
+      auto pos = s.find('=');
+      if (pos == std::string::npos) continue;
+
+      std::string key = s.substr(0, pos);
+      std::string value = s.substr(pos + 1);
+      if (key.empty() || key[0] == '-' || value.find_first_of(",.eE") !=
+                                              std::string::npos) {
+        continue;
+      }
+
+      params[std::stoi(key)] = std::stoll(value);
+    }
+  }
+
+  return ans;
+}
+
+int64_t NumElements(const ncnn::Mat &m) {
+  return static_cast<int64_t>(m.w) * m.h * m.d * m.c * m.elempack;
+}
+
+// A layer that forwards to another one and times it. ncnn decides how to
+// call a layer from the flags of the base class, e.g., one_blob_only and
+// support_packing, so they are copied from the wrapped layer.
+class ProfiledLayer : public ncnn::Layer {
+ public:
+  ProfiledLayer(ncnn::Layer *layer, const std::map<int32_t, int64_t> &params,
+                LayerStats *stats)
+      : layer_(layer), stats_(stats) {
+    ncnn::Layer::operator=(*layer);
+    support_vulkan = false;
+
+    // Key 0 is num_output and key 6 is weight_data_size of the layers
+    // with a weight matrix, e.g., InnerProduct and Convolution
+    auto it = params.find(6);
+    if (it != params.end() && params.count(0) && params.at(0) > 0) {
+      // Each weight is used once per output position
+      macs_per_output_ = static_cast<double>(it->second) / params.at(0);
+    }
+  }
+
+  ncnn::Layer *Wrapped() const { return layer_; }
+
+  int forward(const std::vector<ncnn::Mat> &bottom_blobs,
+              std::vector<ncnn::Mat> &top_blobs,
+              const ncnn::Option &opt) const override {
+    auto start = Clock::now();
+    int ret = layer_->forward(bottom_blobs, top_blobs, opt);
+    Record(start, bottom_blobs, top_blobs);
+    return ret;
+  }
+
+  int forward(const ncnn::Mat &bottom_blob, ncnn::Mat &top_blob,
+              const ncnn::Option &opt) const override {
+    auto start = Clock::now();
+    int ret = layer_->forward(bottom_blob, top_blob, opt);
+    Record(start, {bottom_blob}, {top_blob});
+    return ret;
+  }
+
+  int forward_inplace(std::vector<ncnn::Mat> &bottom_top_blobs,
+                      const ncnn::Option &opt) const override {
+    auto start = Clock::now();
+    int ret = layer_->forward_inplace(bottom_top_blobs, opt);
+    Record(start, bottom_top_blobs, bottom_top_blobs);
+    return ret;
+  }
+
+  int forward_inplace(ncnn::Mat &bottom_top_blob,
+                      const ncnn::Option &opt) const override {
+    auto start = Clock::now();
+    int ret = layer_->forward_inplace(bottom_top_blob, opt);
+    Record(start, {bottom_top_blob}, {bottom_top_blob});
+    return ret;
+  }
+
+ private:
+  void Record(Clock::time_point start, const std::vector<ncnn::Mat> &bottoms,
+              const std::vector<ncnn::Mat> &tops) const {
+    double ms =
+        std::chrono::duration<double, std::milli>(Clock::now() - start)
+            .count();
+
+    stats_->count += 1;
+    stats_->total_ms += ms;
+
+    int64_t out_elements = 0;
+    stats_->out_bytes = 0;
+    for (const auto &m : tops) {
+      out_elements += NumElements(m);
+      stats_->out_bytes += m.total() * m.elemsize;
+    }
+
+    // A rough estimate: 2 flops per multiply-add of the layers with
+    // weights and of MatMul, and one per output element otherwise
+    if (macs_per_output_ > 0) {
+      stats_->flops += 2 * macs_per_output_ * out_elements;
+    } else if (type == "MatMul" && !bottoms.empty()) {
+      stats_->flops += 2.0 * bottoms[0].w * out_elements;
+    } else {
+      stats_->flops += out_elements;
+    }
+
+    if (!tops.empty()) {
+      const ncnn::Mat &m = tops[0];
+      std::ostringstream os;
+      os << m.w;
+      if (m.dims >= 2) os << "x" << m.h;
+      if (m.dims == 4) os << "x" << m.d;
+      if (m.dims >= 3) os << "x" << m.c;
+      stats_->shape = os.str();
+      stats_->elempack = m.elempack;
+      stats_->elemsize = static_cast<int32_t>(m.elemsize);
+    }
+  }
+
+ private:
+  ncnn::Layer *layer_;
+  LayerStats *stats_;
+  double macs_per_output_ = 0;
+};
+
+// Replaces the layers of a network with ProfiledLayer while it is alive
+class NetProfiler {
+ public:
+  NetProfiler(const std::string &name, ncnn::Net *net,
+              const std::string &param_text)
+      : name_(name), net_(net) {
+    LayerParams params = ParseParams(param_text);
+
+    auto &layers = net_->mutable_layers();
+    stats_.resize(layers.size());
+    for (std::size_t i = 0; i != layers.size(); ++i) {
+      stats_[i].name = layers[i]->name;
+      stats_[i].type = layers[i]->type;
+      layers[i] = new ProfiledLayer(layers[i], params[layers[i]->name],
+                                    &stats_[i]);
+    }
+  }
+
+  ~NetProfiler() {
+    for (auto *&layer : net_->mutable_layers()) {
+      auto *p = static_cast<ProfiledLayer *>(layer);
+      layer = p->Wrapped();
+      delete p;
+    }
+  }
+
+  NetProfiler(const NetProfiler &) = delete;
+  NetProfiler &operator=(const NetProfiler &) = delete;
+
+  // Print the top layers by time and the time of each layer type
+  void Print(int32_t top) const {
+    double total_ms = 0;
+    int64_t num_runs = 0;
+    for (const auto &s : stats_) {
+      total_ms += s.total_ms;
+    }
+
+    std::vector<const LayerStats *> sorted;
+    for (const auto &s : stats_) {
+      if (s.count > 0 && s.type != "Input") sorted.push_back(&s);
+    }
+    std::sort(sorted.begin(), sorted.end(),
+              [](const LayerStats *a, const LayerStats *b) {
+                return a->total_ms > b->total_ms;
+              });
+
+    // Input layers are not run when the input is set, so the number of
+    // runs is that of the most frequent layer
+    for (const auto *s : sorted) num_runs = std::max(num_runs, s->count);
+    num_runs = std::max<int64_t>(num_runs, 1);
+
+    printf("==== %s: %d runs, %.3f ms per run ====\n", name_.c_str(),
+           static_cast<int32_t>(num_runs), total_ms / num_runs);
+    printf("%-28s %-22s %9s %6s %9s %-16s %4s %4s %9s\n", "layer", "type",
+           "ms/run", "%", "MFLOP/run", "output", "pack", "size", "out KB");
+
+    int32_t n = std::min<int32_t>(top, sorted.size());
+    for (int32_t i = 0; i != n; ++i) {
+      const LayerStats &s = *sorted[i];
+      printf("%-28s %-22s %9.4f %6.2f %9.3f %-16s %4d %4d %9.1f\n",
+             s.name.substr(0, 28).c_str(), s.type.substr(0, 22).c_str(),
+             s.total_ms / num_runs,
+             total_ms > 0 ? 100 * s.total_ms / total_ms : 0.0,
+             s.flops / num_runs / 1e6, s.shape.c_str(), s.elempack,
+             s.elemsize, s.out_bytes / 1024.0);
+    }
+
+    struct TypeStats {
+      double ms = 0;
+      double flops = 0;
+      int32_t num_layers = 0;
+    };
+    std::map<std::string, TypeStats> types;
+    for (const auto *s : sorted) {
+      auto &t = types[s->type];
+      t.ms += s->total_ms;
+      t.flops += s->flops;
+      t.num_layers += 1;
+    }
+
+    std::vector<std::pair<std::string, TypeStats>> by_type(types.begin(),
+                                                           types.end());
+    std::sort(by_type.begin(), by_type.end(),
+              [](const auto &a, const auto &b) {
+                return a.second.ms > b.second.ms;
+              });
+
+    printf("\n%-22s %6s %9s %6s %9s %9s\n", "type", "layers", "ms/run", "%",
+           "MFLOP/run", "GFLOP/s");
+    for (const auto &p : by_type) {
+      const TypeStats &t = p.second;
+      printf("%-22s %6d %9.4f %6.2f %9.3f %9.2f\n",
+             p.first.substr(0, 22).c_str(), t.num_layers, t.ms / num_runs,
+             total_ms > 0 ? 100 * t.ms / total_ms : 0.0,
+             t.flops / num_runs / 1e6, t.ms > 0 ? t.flops / t.ms / 1e6 : 0.0);
+    }
+    printf("\n");
+  }
+
+ private:
+  std::string name_;
+  ncnn::Net *net_;
+  std::vector<LayerStats> stats_;
+};
+
+std::string ReadParam(const sherpa_ncnn::Model &model,
+                      const std::string &filename,
+                      const std::string &section) {
+  if (const auto *bundle = model.GetBundle()) {
+    std::size_t size = 0;
+    const unsigned char *p = bundle->GetSection(section, &size);
+    return p ? std::string(reinterpret_cast<const char *>(p), size) : "";
+  }
+
+  std::vector<char> buf = sherpa_ncnn::ReadFile(filename);
+  return std::string(buf.begin(), buf.end());
+}
+
+}  // namespace
+
+int32_t main(int32_t argc, char *argv[]) {
+  const char *kUsageMessage = R"usage(
+Profile each layer of the encoder, decoder and joiner of a streaming
+model while decoding audio as the recognizer does, i.e., chunk by chunk
+with the encoder states carried from chunk to chunk.
+
+For each network, it prints the layers that take the most time and the
+time of each layer type, with an estimate of the FLOPs, the shape,
+elempack and element size of the output and its memory. It works with
+any build of ncnn, unlike NCNN_BENCHMARK. The networks run on the CPU.
+
+If no wave file is given, 10 seconds of noise are decoded.
+
+Usage:
+
+  ./bin/sherpa-ncnn-profile-model \
+    --tokens=/path/to/tokens.txt \
+    --encoder-param=/path/to/encoder.ncnn.param \
+    --encoder-bin=/path/to/encoder.ncnn.bin \
+    --decoder-param=/path/to/decoder.ncnn.param \
+    --decoder-bin=/path/to/decoder.ncnn.bin \
+    --joiner-param=/path/to/joiner.ncnn.param \
+    --joiner-bin=/path/to/joiner.ncnn.bin \
+    --num-threads=2 \
+    --precision=balanced \
+    [foo.wav]
+)usage";
+
+  sherpa_ncnn::ParseOptions po(kUsageMessage);
+
+  sherpa_ncnn::RecognizerConfig config;
+  int32_t num_threads = 1;
+  int32_t num_chunks = 0;
+  int32_t top = 20;
+  std::string precision;
+
+  auto &model_config = config.model_config;
+  po.Register("tokens", &model_config.tokens, "Path to tokens.txt");
+  po.Register("encoder-param", &model_config.encoder_param,
+              "Path to encoder.ncnn.param");
+  po.Register("encoder-bin", &model_config.encoder_bin,
+              "Path to encoder.ncnn.bin");
+  po.Register("decoder-param", &model_config.decoder_param,
+              "Path to decoder.ncnn.param");
+  po.Register("decoder-bin", &model_config.decoder_bin,
+              "Path to decoder.ncnn.bin");
+  po.Register("joiner-param", &model_config.joiner_param,
+              "Path to joiner.ncnn.param");
+  po.Register("joiner-bin", &model_config.joiner_bin,
+              "Path to joiner.ncnn.bin");
+  po.Register("bundle", &model_config.bundle,
+              "Path to a model bundle. If given, the paths above are "
+              "ignored");
+  po.Register("num-threads", &num_threads,
+              "Number of threads of each network");
+  po.Register("precision", &precision,
+              "accuracy, balanced or speed for all networks, see "
+              "ModelConfig::encoder_precision");
+  po.Register("decoding-method", &config.decoder_config.method,
+              "greedy_search or modified_beam_search");
+  po.Register("num-chunks", &num_chunks,
+              "Profile at most this many chunks. 0 for all of the audio");
+  po.Register("top", &top, "Number of layers to print for each network");
+
+  po.Read(argc, argv);
+  if (po.NumArgs() > 1) {
+    po.PrintUsage();
+    exit(EXIT_FAILURE);
+  }
+
+  model_config.use_vulkan_compute = false;
+  model_config.encoder_precision = precision;
+  model_config.decoder_precision = precision;
+  model_config.joiner_precision = precision;
+  model_config.encoder_opt.num_threads = num_threads;
+  model_config.decoder_opt.num_threads = num_threads;
+  model_config.joiner_opt.num_threads = num_threads;
+
+  // The outputs of all layers are kept until the extractor is destroyed,
+  // as with lightmode off, so that the memory of each one can be reported
+  // and so that timing is not affected by recycling
+  model_config.encoder_opt.lightmode = false;
+  model_config.decoder_opt.lightmode = false;
+  model_config.joiner_opt.lightmode = false;
+
+  std::vector<float> samples;
+  int32_t sample_rate = 16000;
+  if (po.NumArgs() == 1) {
+    auto reader = sherpa_ncnn::WaveFileReader::Open(po.GetArg(1));
+    if (!reader) {
+      fprintf(stderr, "Failed to read '%s'\n", po.GetArg(1).c_str());
+      return -1;
+    }
+    sample_rate = reader->SampleRate();
+    samples.resize(reader->NumFrames());
+    reader->Read(samples.data(), samples.size());
+  } else {
+    samples.resize(10 * sample_rate);
+    for (std::size_t i = 0; i != samples.size(); ++i) {
+      samples[i] = 0.01f * std::sin(0.37f * i) * std::sin(0.0011f * i);
+    }
+  }
+
+  std::shared_ptr<sherpa_ncnn::Model> model =
+      sherpa_ncnn::Model::Create(model_config);
+  if (!model) {
+    fprintf(stderr, "Failed to create the model: %s\n",
+            model_config.ToString().c_str());
+    return -1;
+  }
+
+  sherpa_ncnn::Recognizer recognizer(config, model);
+
+  // Layers run for the first time do some setup, so it is not profiled
+  recognizer.WarmUp();
+
+  std::string encoder_param = ReadParam(*model, model_config.encoder_param,
+                                        "encoder.ncnn.param");
+  std::string decoder_param = ReadParam(*model, model_config.decoder_param,
+                                        "decoder.ncnn.param");
+  std::string joiner_param = ReadParam(*model, model_config.joiner_param,
+                                       "joiner.ncnn.param");
+
+  int32_t num_decoded = 0;
+  double elapsed_ms = 0;
+  {
+    NetProfiler encoder("encoder", &model->GetEncoder(), encoder_param);
+    NetProfiler decoder("decoder", &model->GetDecoder(), decoder_param);
+    NetProfiler joiner("joiner", &model->GetJoiner(), joiner_param);
+
+    auto s = recognizer.CreateStream();
+    s->AcceptWaveform(sample_rate, samples.data(), samples.size());
+    s->InputFinished();
+
+    auto start = Clock::now();
+    while (recognizer.IsReady(s.get()) &&
+           (num_chunks <= 0 || num_decoded < num_chunks)) {
+      recognizer.DecodeStream(s.get());
+      ++num_decoded;
+    }
+    elapsed_ms =
+        std::chrono::duration<double, std::milli>(Clock::now() - start)
+            .count();
+
+    encoder.Print(top);
+    decoder.Print(top);
+    joiner.Print(top);
+
+    fprintf(stderr, "Text: %s\n", recognizer.GetResult(s.get()).text.c_str());
+  }
+
+  fprintf(stderr, "%d chunks in %.1f ms, %.2f ms per chunk\n", num_decoded,
+          elapsed_ms, num_decoded ? elapsed_ms / num_decoded : 0.0);
+
+  return 0;
+}
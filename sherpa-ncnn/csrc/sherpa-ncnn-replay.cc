@@ -0,0 +1,318 @@
+// sherpa-ncnn/csrc/sherpa-ncnn-replay.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <unordered_map>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/parse-options.h"
+#include "sherpa-ncnn/csrc/recognizer.h"
+#include "sherpa-ncnn/csrc/session-recorder.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct LatencySummary {
+  double p50_ms = 0;
+  double p90_ms = 0;
+  double p99_ms = 0;
+  double max_ms = 0;
+  double mean_ms = 0;
+};
+
+LatencySummary Summarize(std::vector<double> ms) {
+  LatencySummary ans;
+  if (ms.empty()) {
+    return ans;
+  }
+
+  std::sort(ms.begin(), ms.end());
+  auto percentile = [&ms](double p) {
+    int32_t i = std::min<int32_t>(p * ms.size(), ms.size() - 1);
+    return ms[i];
+  };
+
+  ans.p50_ms = percentile(0.5);
+  ans.p90_ms = percentile(0.9);
+  ans.p99_ms = percentile(0.99);
+  ans.max_ms = ms.back();
+
+  double sum = 0;
+  for (double x : ms) {
+    sum += x;
+  }
+  ans.mean_ms = sum / ms.size();
+
+  return ans;
+}
+
+void Print(const char *name, const LatencySummary &s) {
+  fprintf(stderr,
+          "  %s (ms): p50 %.2f, p90 %.2f, p99 %.2f, max %.2f, mean %.2f\n",
+          name, s.p50_ms, s.p90_ms, s.p99_ms, s.max_ms, s.mean_ms);
+}
+
+std::string ToJson(const char *name, const LatencySummary &s) {
+  char buf[256];
+  snprintf(buf, sizeof(buf),
+           "\"%s_p50_ms\":%.3f,\"%s_p90_ms\":%.3f,\"%s_p99_ms\":%.3f,"
+           "\"%s_max_ms\":%.3f,\"%s_mean_ms\":%.3f",
+           name, s.p50_ms, name, s.p90_ms, name, s.p99_ms, name, s.max_ms,
+           name, s.mean_ms);
+  return buf;
+}
+
+struct ReplayStats {
+  // Duration of the decode call of each decoded chunk, i.e., each stream
+  // of a call counts once
+  std::vector<double> recorded_ms;
+  std::vector<double> replayed_ms;
+
+  // Calls whose result differs from the recording, e.g., because the new
+  // build detects endpoints differently. The replay follows the recording
+  // anyway.
+  int32_t num_mismatches = 0;
+};
+
+class Replayer {
+ public:
+  explicit Replayer(const sherpa_ncnn::Recognizer *recognizer)
+      : recognizer_(recognizer) {}
+
+  void Run(const std::vector<sherpa_ncnn::SessionEvent> &events, float speed,
+           ReplayStats *stats) {
+    using sherpa_ncnn::SessionEventType;
+
+    Clock::time_point origin = Clock::now();
+    std::vector<sherpa_ncnn::Stream *> ss;
+
+    for (const auto &e : events) {
+      if (speed > 0) {
+        std::this_thread::sleep_until(
+            origin + std::chrono::microseconds(
+                         static_cast<int64_t>(e.time_us / speed)));
+      }
+
+      switch (e.type) {
+        case SessionEventType::kCreateStream:
+          streams_[e.stream_id] = recognizer_->CreateStream();
+          break;
+        case SessionEventType::kDestroyStream:
+          streams_.erase(e.stream_id);
+          break;
+        case SessionEventType::kAcceptWaveform:
+          GetStream(e.stream_id)
+              ->AcceptWaveform(e.sampling_rate, e.samples.data(),
+                               e.samples.size());
+          break;
+        case SessionEventType::kInputFinished:
+          GetStream(e.stream_id)->InputFinished();
+          break;
+        case SessionEventType::kIsReady:
+          if (recognizer_->IsReady(GetStream(e.stream_id)) != e.result) {
+            ++stats->num_mismatches;
+          }
+          break;
+        case SessionEventType::kDecodeStreams:
+        case SessionEventType::kDecodeReadyStreams:
+        case SessionEventType::kDecodeRemainingFrames: {
+          ss.clear();
+          for (int64_t id : e.stream_ids) {
+            sherpa_ncnn::Stream *s = GetStream(id);
+            if (e.type != SessionEventType::kDecodeStreams ||
+                recognizer_->IsReady(s)) {
+              ss.push_back(s);
+            } else {
+              ++stats->num_mismatches;
+            }
+          }
+
+          if (ss.empty()) {
+            break;
+          }
+
+          auto start = Clock::now();
+          if (e.type == SessionEventType::kDecodeStreams) {
+            recognizer_->DecodeStreams(ss.data(), ss.size());
+          } else if (e.type == SessionEventType::kDecodeReadyStreams) {
+            recognizer_->DecodeReadyStreams(ss.data(), ss.size());
+          } else {
+            recognizer_->DecodeRemainingFrames(ss.data(), ss.size());
+          }
+          double ms = std::chrono::duration<double, std::milli>(
+                          Clock::now() - start)
+                          .count();
+
+          for (size_t i = 0; i != ss.size(); ++i) {
+            stats->recorded_ms.push_back(e.duration_us / 1000.0);
+            stats->replayed_ms.push_back(ms);
+          }
+          break;
+        }
+        case SessionEventType::kGetResult:
+          recognizer_->GetResult(GetStream(e.stream_id));
+          break;
+        case SessionEventType::kIsEndpoint:
+          if (recognizer_->IsEndpoint(GetStream(e.stream_id)) != e.result) {
+            ++stats->num_mismatches;
+          }
+          break;
+        case SessionEventType::kReset:
+          recognizer_->Reset(GetStream(e.stream_id));
+          break;
+      }
+    }
+  }
+
+ private:
+  // Streams created before the recording started are created at their
+  // first event
+  sherpa_ncnn::Stream *GetStream(int64_t id) {
+    auto &s = streams_[id];
+    if (!s) {
+      s = recognizer_->CreateStream();
+    }
+    return s.get();
+  }
+
+ private:
+  const sherpa_ncnn::Recognizer *recognizer_;
+  std::unordered_map<int64_t, std::unique_ptr<sherpa_ncnn::Stream>> streams_;
+};
+
+}  // namespace
+
+int32_t main(int32_t argc, char *argv[]) {
+  const char *kUsageMessage = R"usage(
+Replay a recording of the streaming API against this build and compare
+the latencies of the decode calls with those of the recording.
+
+Record a session by setting the environment variable SHERPA_NCNN_RECORD
+to a filename in the process that serves the traffic, e.g.,
+
+  SHERPA_NCNN_RECORD=./session.bin ./bin/sherpa-ncnn-streaming-server ...
+
+The audio and the calls to IsReady(), DecodeStreams(), GetResult(),
+IsEndpoint() and Reset() are then replayed in the recorded order on one
+thread, at --speed times the recorded pace. A summary is printed to
+stderr and one JSON line to stdout, e.g., for gating regressions:
+
+  recorded_*_ms   duration of the decode call of each chunk when recorded
+  replayed_*_ms   the same in this replay
+  mismatches      calls whose result differs from the recording, e.g.,
+                  IsEndpoint() of a model that detects endpoints
+                  differently
+
+Usage:
+
+  ./bin/sherpa-ncnn-replay \
+    --tokens=/path/to/tokens.txt \
+    --encoder-param=/path/to/encoder.ncnn.param \
+    --encoder-bin=/path/to/encoder.ncnn.bin \
+    --decoder-param=/path/to/decoder.ncnn.param \
+    --decoder-bin=/path/to/decoder.ncnn.bin \
+    --joiner-param=/path/to/joiner.ncnn.param \
+    --joiner-bin=/path/to/joiner.ncnn.bin \
+    --num-threads=1 \
+    --speed=1 \
+    session.bin
+)usage";
+
+  sherpa_ncnn::ParseOptions po(kUsageMessage);
+
+  sherpa_ncnn::RecognizerConfig config;
+  int32_t num_threads = 1;
+  float speed = 1;
+
+  auto &model_config = config.model_config;
+  po.Register("tokens", &model_config.tokens, "Path to tokens.txt");
+  po.Register("encoder-param", &model_config.encoder_param,
+              "Path to encoder.ncnn.param");
+  po.Register("encoder-bin", &model_config.encoder_bin,
+              "Path to encoder.ncnn.bin");
+  po.Register("decoder-param", &model_config.decoder_param,
+              "Path to decoder.ncnn.param");
+  po.Register("decoder-bin", &model_config.decoder_bin,
+              "Path to decoder.ncnn.bin");
+  po.Register("joiner-param", &model_config.joiner_param,
+              "Path to joiner.ncnn.param");
+  po.Register("joiner-bin", &model_config.joiner_bin,
+              "Path to joiner.ncnn.bin");
+  po.Register("bundle", &model_config.bundle,
+              "Path to a model bundle. If given, the paths above are "
+              "ignored");
+  po.Register("num-threads", &num_threads,
+              "Number of threads of each network");
+  po.Register("decoding-method", &config.decoder_config.method,
+              "greedy_search or modified_beam_search");
+  po.Register("num-active-paths", &config.decoder_config.num_active_paths,
+              "Used only for modified_beam_search");
+  po.Register("enable-endpoint", &config.enable_endpoint,
+              "Detect endpoints as the recorded process did");
+  po.Register("speed", &speed,
+              "Replay pace relative to the recording. 0 to issue each call "
+              "as soon as the previous one returns");
+
+  po.Read(argc, argv);
+  if (po.NumArgs() != 1) {
+    fprintf(stderr, "Error: Please provide exactly 1 recording.\n\n");
+    po.PrintUsage();
+    exit(EXIT_FAILURE);
+  }
+
+  if (speed < 0) {
+    fprintf(stderr, "Invalid --speed %.3f\n", speed);
+    exit(EXIT_FAILURE);
+  }
+
+  model_config.encoder_opt.num_threads = num_threads;
+  model_config.decoder_opt.num_threads = num_threads;
+  model_config.joiner_opt.num_threads = num_threads;
+
+  std::vector<sherpa_ncnn::SessionEvent> events;
+  if (!sherpa_ncnn::ReadSession(po.GetArg(1), &events) && events.empty()) {
+    return -1;
+  }
+
+  sherpa_ncnn::Recognizer recognizer(config);
+  if (!recognizer.GetModel()) {
+    fprintf(stderr, "Failed to create the model: %s\n",
+            model_config.ToString().c_str());
+    return -1;
+  }
+
+  fprintf(stderr, "Replaying %d calls at speed %.2f\n",
+          static_cast<int32_t>(events.size()), speed);
+
+  ReplayStats stats;
+  Replayer replayer(&recognizer);
+  auto start = Clock::now();
+  replayer.Run(events, speed, &stats);
+  double elapsed =
+      std::chrono::duration<double>(Clock::now() - start).count();
+
+  LatencySummary recorded = Summarize(stats.recorded_ms);
+  LatencySummary replayed = Summarize(stats.replayed_ms);
+
+  fprintf(stderr, "%d chunks in %.1f s, %d mismatches\n",
+          static_cast<int32_t>(stats.replayed_ms.size()), elapsed,
+          stats.num_mismatches);
+  Print("recorded", recorded);
+  Print("replayed", replayed);
+
+  fprintf(stdout, "{\"chunks\":%d,\"mismatches\":%d,%s,%s}\n",
+          static_cast<int32_t>(stats.replayed_ms.size()),
+          stats.num_mismatches, ToJson("recorded", recorded).c_str(),
+          ToJson("replayed", replayed).c_str());
+  fflush(stdout);
+
+  return 0;
+}
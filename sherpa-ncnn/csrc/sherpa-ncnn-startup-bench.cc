@@ -0,0 +1,543 @@
+// sherpa-ncnn/csrc/sherpa-ncnn-startup-bench.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <stdio.h>
+
+#if !defined(_WIN32)
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/offline-recognizer.h"
+#include "sherpa-ncnn/csrc/offline-tts.h"
+#include "sherpa-ncnn/csrc/parse-options.h"
+#include "sherpa-ncnn/csrc/recognizer.h"
+#include "sherpa-ncnn/csrc/startup-stats.h"
+#include "sherpa-ncnn/csrc/text-utils.h"
+#include "sherpa-ncnn/csrc/voice-activity-detector.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double Ms(Clock::duration d) {
+  return std::chrono::duration<double, std::milli>(d).count();
+}
+
+struct StartupResult {
+  // recognizer, offline_recognizer, vad or tts
+  std::string component;
+
+  // cold or warm
+  std::string cache;
+  int32_t run = 0;
+
+  // Wall time of the constructor and of each phase inside it
+  double construct_ms = 0;
+  double phase_ms[sherpa_ncnn::kNumStartupPhases] = {};
+
+  // Recognizer::WarmUp() with --warm-up. 0 otherwise.
+  double warm_up_ms = 0;
+
+  // From the construction until the first chunk, utterance, VAD window or
+  // audio is done
+  double first_ms = 0;
+
+  // Peak resident memory from the start of the construction until the
+  // first result, and the resident memory that is still used then
+  int64_t peak_rss_kb = 0;
+  int64_t rss_delta_kb = 0;
+
+  std::string ToJson() const {
+    std::ostringstream os;
+    os << "{\"component\": \"" << component << "\", "
+       << "\"cache\": \"" << cache << "\", "
+       << "\"run\": " << run << ", "
+       << "\"construct_ms\": " << construct_ms << ", ";
+    for (int32_t i = 0; i != sherpa_ncnn::kNumStartupPhases; ++i) {
+      os << "\""
+         << sherpa_ncnn::GetStartupPhaseName(
+                static_cast<sherpa_ncnn::StartupPhase>(i))
+         << "_ms\": " << phase_ms[i] << ", ";
+    }
+    os << "\"warm_up_ms\": " << warm_up_ms << ", "
+       << "\"first_ms\": " << first_ms << ", "
+       << "\"peak_rss_kb\": " << peak_rss_kb << ", "
+       << "\"rss_delta_kb\": " << rss_delta_kb << "}";
+    return os.str();
+  }
+};
+
+// Return a field of /proc/self/status in KB, e.g., VmRSS, or 0 if it is
+// unknown
+int64_t ReadStatusKb(const std::string &key) {
+  std::ifstream is("/proc/self/status");
+  std::string line;
+  while (std::getline(is, line)) {
+    if (line.compare(0, key.size() + 1, key + ":") == 0) {
+      return std::atoll(line.c_str() + key.size() + 1);
+    }
+  }
+  return 0;
+}
+
+// Make the peak resident memory start from the current one. It needs
+// Linux 4.0 or later.
+void ResetPeakRss() {
+  std::ofstream os("/proc/self/clear_refs");
+  os << "5";
+}
+
+int64_t PeakRssKb() {
+  int64_t ans = ReadStatusKb("VmHWM");
+  if (ans > 0) {
+    return ans;
+  }
+
+#if defined(_WIN32)
+  return 0;
+#else
+  // It cannot be reset, so it is the peak of the process
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#if defined(__APPLE__)
+  return usage.ru_maxrss / 1024;  // in bytes on macOS
+#else
+  return usage.ru_maxrss;
+#endif
+#endif
+}
+
+// Return the regular files among paths and in the directories among them
+std::vector<std::string> ListFiles(const std::vector<std::string> &paths) {
+  std::vector<std::string> ans;
+#if !defined(_WIN32)
+  for (const auto &p : paths) {
+    struct stat st;
+    if (p.empty() || stat(p.c_str(), &st) != 0) continue;
+
+    if (S_ISREG(st.st_mode)) {
+      ans.push_back(p);
+      continue;
+    }
+
+    if (!S_ISDIR(st.st_mode)) continue;
+
+    DIR *dir = opendir(p.c_str());
+    if (!dir) continue;
+
+    while (struct dirent *e = readdir(dir)) {
+      std::string f = p + "/" + e->d_name;
+      if (stat(f.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+        ans.push_back(f);
+      }
+    }
+    closedir(dir);
+  }
+#endif
+  return ans;
+}
+
+// Drop the files from the page cache, so that they are read from the disk
+// again. Return false if it is not supported.
+bool EvictFromPageCache(const std::vector<std::string> &files) {
+#if defined(__linux__)
+  for (const auto &f : files) {
+    int fd = open(f.c_str(), O_RDONLY);
+    if (fd < 0) continue;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+void ReadIntoPageCache(const std::vector<std::string> &files) {
+  std::vector<char> buf(1 << 20);
+  for (const auto &f : files) {
+    std::ifstream is(f, std::ios::binary);
+    while (is.read(buf.data(), buf.size())) {
+    }
+  }
+}
+
+/** Construct a component and produce its first result.
+ *
+ * @param create  Return the component, e.g., a recognizer.
+ * @param first  Produce the first result of the component created by
+ *               create and set StartupResult::first_ms. It may also set
+ *               StartupResult::warm_up_ms.
+ */
+template <typename Create, typename First>
+StartupResult Measure(Create create, First first) {
+  StartupResult ans;
+
+  sherpa_ncnn::StartupStats::Reset();
+  ResetPeakRss();
+  int64_t rss = ReadStatusKb("VmRSS");
+
+  auto start = Clock::now();
+  auto component = create();
+  ans.construct_ms = Ms(Clock::now() - start);
+
+  for (int32_t i = 0; i != sherpa_ncnn::kNumStartupPhases; ++i) {
+    ans.phase_ms[i] = sherpa_ncnn::StartupStats::Get(
+        static_cast<sherpa_ncnn::StartupPhase>(i));
+  }
+
+  first(component.get(), &ans);
+
+  ans.peak_rss_kb = PeakRssKb();
+  ans.rss_delta_kb = ReadStatusKb("VmRSS") - rss;
+
+  return ans;
+}
+
+struct Component {
+  std::string name;
+
+  // Files and directories that the component reads
+  std::vector<std::string> paths;
+
+  std::function<StartupResult()> measure;
+};
+
+void Run(const Component &c, int32_t num_cold_runs, int32_t num_warm_runs) {
+  std::vector<std::string> files = ListFiles(c.paths);
+
+  if (num_cold_runs > 0 && !EvictFromPageCache(files)) {
+    fprintf(stderr, "Cold runs are not supported on this system\n");
+    num_cold_runs = 0;
+  }
+
+  for (int32_t i = 0; i != num_cold_runs + num_warm_runs; ++i) {
+    bool cold = i < num_cold_runs;
+    if (cold) {
+      EvictFromPageCache(files);
+    } else {
+      ReadIntoPageCache(files);
+    }
+
+    StartupResult r = c.measure();
+    r.component = c.name;
+    r.cache = cold ? "cold" : "warm";
+    r.run = cold ? i : i - num_cold_runs;
+
+    fprintf(stderr, "%s (%s, run %d): constructed in %.1f ms (", c.name.c_str(),
+            r.cache.c_str(), r.run, r.construct_ms);
+    std::string sep;
+    for (int32_t k = 0; k != sherpa_ncnn::kNumStartupPhases; ++k) {
+      if (r.phase_ms[k] == 0) continue;
+      fprintf(stderr, "%s%s %.1f", sep.c_str(),
+              sherpa_ncnn::GetStartupPhaseName(
+                  static_cast<sherpa_ncnn::StartupPhase>(k)),
+              r.phase_ms[k]);
+      sep = ", ";
+    }
+    fprintf(stderr,
+            "), warm-up %.1f ms, first result %.1f ms, peak RSS %.1f MB, "
+            "RSS +%.1f MB\n",
+            r.warm_up_ms, r.first_ms, r.peak_rss_kb / 1024.0,
+            r.rss_delta_kb / 1024.0);
+
+    fprintf(stdout, "%s\n", r.ToJson().c_str());
+    fflush(stdout);
+  }
+}
+
+}  // namespace
+
+int32_t main(int32_t argc, char *argv[]) {
+  const char *kUsageMessage = R"usage(
+Benchmark the startup of the streaming recognizer, the offline recognizer,
+the voice activity detector and text-to-speech.
+
+Each component whose model is given is constructed --num-cold-runs times
+with its files dropped from the page cache and then --num-warm-runs times
+with its files in the page cache. Each run measures:
+
+  construct_ms     wall time of the constructor
+  param_parse_ms   parsing the .ncnn.param files
+  weight_load_ms   loading the .ncnn.bin files, including the packing of
+                   the weights by ncnn
+  symbol_table_ms  reading tokens.txt
+  lexicon_ms       reading the lexicon of TTS
+  hotwords_ms      building the context graph of --hotwords-file
+  warm_up_ms       Recognizer::WarmUp(), see --warm-up
+  first_ms         time from the construction until the first result:
+                   the first chunk of a stream, the first utterance of
+                   --offline-seconds, the first VAD window, or the first
+                   audio of --tts-text
+  peak_rss_kb      peak resident memory during the run
+  rss_delta_kb     resident memory that is still used after it
+
+A summary is printed to stderr and one JSON line per run to stdout, e.g.,
+for gating regressions or for comparing --use-mmap, binary token tables
+and --warm-up.
+
+Dropping files from the page cache works on Linux and needs no root. It
+has no effect on file systems that are kept in memory, e.g., tmpfs.
+
+Usage:
+
+  ./bin/sherpa-ncnn-startup-bench \
+    --tokens=/path/to/tokens.txt \
+    --encoder-param=/path/to/encoder.ncnn.param \
+    --encoder-bin=/path/to/encoder.ncnn.bin \
+    --decoder-param=/path/to/decoder.ncnn.param \
+    --decoder-bin=/path/to/decoder.ncnn.bin \
+    --joiner-param=/path/to/joiner.ncnn.param \
+    --joiner-bin=/path/to/joiner.ncnn.bin \
+    --offline.tokens=/path/to/sense-voice/tokens.txt \
+    --offline.sense-voice-model-dir=/path/to/sense-voice \
+    --silero-vad-model-dir=/path/to/silero-vad \
+    --tts.vits-model-dir=/path/to/vits \
+    --num-cold-runs=3 \
+    --num-warm-runs=3
+)usage";
+
+  sherpa_ncnn::ParseOptions po(kUsageMessage);
+
+  sherpa_ncnn::RecognizerConfig config;
+  sherpa_ncnn::OfflineRecognizerConfig offline_config;
+  sherpa_ncnn::SileroVadModelConfig vad_config;
+  sherpa_ncnn::OfflineTtsConfig tts_config;
+
+  int32_t num_threads = 1;
+  int32_t num_cold_runs = 1;
+  int32_t num_warm_runs = 3;
+  bool warm_up = false;
+  float offline_seconds = 5;
+  std::string tts_text = "Hello world.";
+
+  auto &model_config = config.model_config;
+  po.Register("tokens", &model_config.tokens, "Path to tokens.txt");
+  po.Register("encoder-param", &model_config.encoder_param,
+              "Path to encoder.ncnn.param");
+  po.Register("encoder-bin", &model_config.encoder_bin,
+              "Path to encoder.ncnn.bin");
+  po.Register("decoder-param", &model_config.decoder_param,
+              "Path to decoder.ncnn.param");
+  po.Register("decoder-bin", &model_config.decoder_bin,
+              "Path to decoder.ncnn.bin");
+  po.Register("joiner-param", &model_config.joiner_param,
+              "Path to joiner.ncnn.param");
+  po.Register("joiner-bin", &model_config.joiner_bin,
+              "Path to joiner.ncnn.bin");
+  po.Register("bundle", &model_config.bundle,
+              "Path to a model bundle. If given, the paths above are "
+              "ignored");
+  po.Register("use-mmap", &model_config.use_mmap,
+              "Memory map the .bin files");
+  po.Register("use-huge-pages", &model_config.use_huge_pages,
+              "Read the .bin files and large memory pool chunks into huge "
+              "pages");
+  po.Register("num-threads", &num_threads,
+              "Number of threads of each network");
+  po.Register("decoding-method", &config.decoder_config.method,
+              "greedy_search or modified_beam_search");
+  po.Register("hotwords-file", &config.hotwords_file,
+              "Used only for modified_beam_search");
+  po.Register("warm-up", &warm_up,
+              "Call Recognizer::WarmUp() before decoding the first chunk");
+
+  sherpa_ncnn::ParseOptions offline_po("offline", &po);
+  offline_config.Register(&offline_po);
+  po.Register("offline-seconds", &offline_seconds,
+              "Duration of the first utterance of the offline recognizer");
+
+  vad_config.Register(&po);
+
+  sherpa_ncnn::ParseOptions tts_po("tts", &po);
+  tts_config.Register(&tts_po);
+  po.Register("tts-text", &tts_text, "Text of the first audio of TTS");
+
+  po.Register("num-cold-runs", &num_cold_runs,
+              "Number of runs with the files of a component dropped from "
+              "the page cache");
+  po.Register("num-warm-runs", &num_warm_runs,
+              "Number of runs with the files of a component in the page "
+              "cache");
+
+  po.Read(argc, argv);
+  if (po.NumArgs() != 0) {
+    po.PrintUsage();
+    exit(EXIT_FAILURE);
+  }
+
+  if (num_cold_runs < 0 || num_warm_runs < 0 || offline_seconds <= 0) {
+    fprintf(stderr,
+            "Invalid --num-cold-runs, --num-warm-runs or --offline-seconds\n");
+    exit(EXIT_FAILURE);
+  }
+
+  model_config.encoder_opt.num_threads = num_threads;
+  model_config.decoder_opt.num_threads = num_threads;
+  model_config.joiner_opt.num_threads = num_threads;
+
+  std::vector<Component> components;
+
+  if (!model_config.tokens.empty() || !model_config.bundle.empty()) {
+    Component c;
+    c.name = "recognizer";
+    c.paths = {model_config.tokens,        model_config.encoder_param,
+               model_config.encoder_bin,   model_config.decoder_param,
+               model_config.decoder_bin,   model_config.joiner_param,
+               model_config.joiner_bin,    model_config.bundle,
+               config.hotwords_file};
+    c.measure = [&config, warm_up]() {
+      return Measure(
+          [&config]() {
+            return std::make_unique<sherpa_ncnn::Recognizer>(config);
+          },
+          [&config, warm_up](sherpa_ncnn::Recognizer *recognizer,
+                             StartupResult *r) {
+            auto start = Clock::now();
+            if (warm_up) {
+              recognizer->WarmUp();
+              r->warm_up_ms = Ms(Clock::now() - start);
+            }
+
+            // Feed silence in chunks of 100 ms until the first chunk of
+            // the encoder is ready
+            int32_t sample_rate = config.feat_config.sampling_rate;
+            std::vector<float> samples(sample_rate / 10);
+            auto s = recognizer->CreateStream();
+            for (int32_t i = 0; i != 100 && !recognizer->IsReady(s.get());
+                 ++i) {
+              s->AcceptWaveform(sample_rate, samples.data(), samples.size());
+            }
+            recognizer->DecodeStream(s.get());
+
+            r->first_ms = Ms(Clock::now() - start);
+          });
+    };
+    components.push_back(std::move(c));
+  }
+
+  if (!offline_config.model_config.tokens.empty()) {
+    if (!offline_config.Validate()) {
+      fprintf(stderr, "Errors in the config of the offline recognizer!\n");
+      exit(EXIT_FAILURE);
+    }
+
+    Component c;
+    c.name = "offline_recognizer";
+    c.paths = {offline_config.model_config.tokens,
+               offline_config.model_config.sense_voice.model_dir,
+               offline_config.hotwords_file};
+    c.measure = [&offline_config, offline_seconds]() {
+      return Measure(
+          [&offline_config]() {
+            return std::make_unique<sherpa_ncnn::OfflineRecognizer>(
+                offline_config);
+          },
+          [&offline_config, offline_seconds](
+              sherpa_ncnn::OfflineRecognizer *recognizer, StartupResult *r) {
+            auto start = Clock::now();
+
+            int32_t sample_rate = offline_config.feat_config.sampling_rate;
+            std::vector<float> samples(sample_rate * offline_seconds);
+            auto s = recognizer->CreateStream();
+            s->AcceptWaveform(sample_rate, samples.data(), samples.size());
+            recognizer->DecodeStream(s.get());
+
+            r->first_ms = Ms(Clock::now() - start);
+          });
+    };
+    components.push_back(std::move(c));
+  }
+
+  if (!vad_config.model_dir.empty()) {
+    if (!vad_config.Validate()) {
+      fprintf(stderr, "Errors in the config of the VAD!\n");
+      exit(EXIT_FAILURE);
+    }
+
+    Component c;
+    c.name = "vad";
+    c.paths = {vad_config.model_dir};
+    c.measure = [&vad_config]() {
+      return Measure(
+          [&vad_config]() {
+            return std::make_unique<sherpa_ncnn::VoiceActivityDetector>(
+                vad_config);
+          },
+          [&vad_config](sherpa_ncnn::VoiceActivityDetector *vad,
+                        StartupResult *r) {
+            auto start = Clock::now();
+
+            std::vector<float> samples(vad_config.window_size);
+            vad->AcceptWaveform(samples.data(), samples.size());
+
+            r->first_ms = Ms(Clock::now() - start);
+          });
+    };
+    components.push_back(std::move(c));
+  }
+
+  const auto &vits = tts_config.model.vits;
+  if (!vits.model_dir.empty() || !vits.bundle.empty()) {
+    if (!tts_config.Validate()) {
+      fprintf(stderr, "Errors in the config of TTS!\n");
+      exit(EXIT_FAILURE);
+    }
+
+    Component c;
+    c.name = "tts";
+    c.paths = {vits.model_dir, vits.bundle};
+    for (const auto &s : {tts_config.rule_fsts, tts_config.rule_fars}) {
+      std::vector<std::string> files;
+      sherpa_ncnn::SplitStringToVector(s, ",", false, &files);
+      c.paths.insert(c.paths.end(), files.begin(), files.end());
+    }
+
+    c.measure = [&tts_config, &tts_text]() {
+      return Measure(
+          [&tts_config]() {
+            return std::make_unique<sherpa_ncnn::OfflineTts>(tts_config);
+          },
+          [&tts_text](sherpa_ncnn::OfflineTts *tts, StartupResult *r) {
+            auto start = Clock::now();
+
+            sherpa_ncnn::TtsArgs args;
+            args.text = tts_text;
+            tts->Generate(args);
+
+            r->first_ms = Ms(Clock::now() - start);
+          });
+    };
+    components.push_back(std::move(c));
+  }
+
+  if (components.empty()) {
+    fprintf(stderr, "Please provide the model of at least 1 component.\n\n");
+    po.PrintUsage();
+    exit(EXIT_FAILURE);
+  }
+
+  for (const auto &c : components) {
+    Run(c, num_cold_runs, num_warm_runs);
+  }
+
+  return 0;
+}
@@ -0,0 +1,1247 @@
+// sherpa-ncnn/csrc/sherpa-ncnn-streaming-server.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#else
+#include <sys/event.h>
+#include <sys/time.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/latency-stats.h"
+#include "sherpa-ncnn/csrc/metrics.h"
+#include "sherpa-ncnn/csrc/model.h"
+#include "sherpa-ncnn/csrc/numa.h"
+#include "sherpa-ncnn/csrc/parse-options.h"
+#include "sherpa-ncnn/csrc/recognizer.h"
+#include "sherpa-ncnn/csrc/stream-scheduler.h"
+#include "sherpa-ncnn/csrc/text-utils.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct ServerConfig {
+  int32_t port = 6006;
+  int32_t max_connections = 1024;
+
+  // Sample rate of the audio of all clients
+  int32_t sample_rate = 16000;
+
+  // Seconds of silence appended to the audio of a client once its input
+  // is finished, so that its last frames are decoded
+  float tail_padding = 0.3;
+
+  // Stop reading from a client while it has more than this many seconds
+  // of audio that are not decoded yet
+  float max_backlog_seconds = 2;
+
+  // Close a client that sends a larger message or does not read its
+  // results while more than max_output_bytes of them are queued
+  int32_t max_message_bytes = 1 << 20;
+  int32_t max_output_bytes = 1 << 20;
+
+  // Answer an HTTP request for /metrics on the same port with
+  // sherpa_ncnn::Metrics in the OpenMetrics text format, e.g., for
+  // Prometheus
+  bool metrics = false;
+};
+
+uint32_t Rotl(uint32_t x, int32_t n) { return (x << n) | (x >> (32 - n)); }
+
+// Only for the WebSocket handshake
+std::string Sha1(const std::string &s) {
+  uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476,
+                   0xC3D2E1F0};
+
+  std::string m = s;
+  uint64_t num_bits = static_cast<uint64_t>(s.size()) * 8;
+  m.push_back(static_cast<char>(0x80));
+  while (m.size() % 64 != 56) {
+    m.push_back(0);
+  }
+  for (int32_t i = 7; i >= 0; --i) {
+    m.push_back(static_cast<char>(num_bits >> (i * 8)));
+  }
+
+  for (std::size_t offset = 0; offset != m.size(); offset += 64) {
+    const auto *p = reinterpret_cast<const uint8_t *>(m.data() + offset);
+
+    uint32_t w[80];
+    for (int32_t i = 0; i != 16; ++i) {
+      w[i] = (static_cast<uint32_t>(p[4 * i]) << 24) |
+             (static_cast<uint32_t>(p[4 * i + 1]) << 16) |
+             (static_cast<uint32_t>(p[4 * i + 2]) << 8) | p[4 * i + 3];
+    }
+    for (int32_t i = 16; i != 80; ++i) {
+      w[i] = Rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    for (int32_t i = 0; i != 80; ++i) {
+      uint32_t f, k;
+      if (i < 20) {
+        f = (b & c) | (~b & d);
+        k = 0x5A827999;
+      } else if (i < 40) {
+        f = b ^ c ^ d;
+        k = 0x6ED9EBA1;
+      } else if (i < 60) {
+        f = (b & c) | (b & d) | (c & d);
+        k = 0x8F1BBCDC;
+      } else {
+        f = b ^ c ^ d;
+        k = 0xCA62C1D6;
+      }
+
+      uint32_t t = Rotl(a, 5) + f + e + k + w[i];
+      e = d;
+      d = c;
+      c = Rotl(b, 30);
+      b = a;
+      a = t;
+    }
+
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+  }
+
+  std::string ans;
+  for (uint32_t x : h) {
+    for (int32_t i = 3; i >= 0; --i) {
+      ans.push_back(static_cast<char>(x >> (i * 8)));
+    }
+  }
+  return ans;
+}
+
+std::string Base64(const std::string &s) {
+  static const char kChars[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+  std::string ans;
+  for (std::size_t i = 0; i < s.size(); i += 3) {
+    uint32_t n = static_cast<uint8_t>(s[i]) << 16;
+    if (i + 1 < s.size()) n |= static_cast<uint8_t>(s[i + 1]) << 8;
+    if (i + 2 < s.size()) n |= static_cast<uint8_t>(s[i + 2]);
+
+    ans.push_back(kChars[(n >> 18) & 63]);
+    ans.push_back(kChars[(n >> 12) & 63]);
+    ans.push_back(i + 1 < s.size() ? kChars[(n >> 6) & 63] : '=');
+    ans.push_back(i + 2 < s.size() ? kChars[n & 63] : '=');
+  }
+  return ans;
+}
+
+// Return the value of the Sec-WebSocket-Key header or an empty string
+std::string GetWebSocketKey(const std::string &headers) {
+  std::istringstream is(headers);
+  std::string line;
+  while (std::getline(is, line)) {
+    auto pos = line.find(':');
+    if (pos == std::string::npos) continue;
+
+    if (sherpa_ncnn::ToLowerCase(line.substr(0, pos)) != "sec-websocket-key") {
+      continue;
+    }
+
+    std::string value = line.substr(pos + 1);
+    auto begin = value.find_first_not_of(" \t");
+    auto end = value.find_last_not_of(" \t\r");
+    if (begin == std::string::npos) return "";
+    return value.substr(begin, end - begin + 1);
+  }
+  return "";
+}
+
+struct PollEvent {
+  int fd;
+  bool readable;
+  bool writable;
+};
+
+// Readiness of sockets with epoll on Linux and kqueue on macOS and BSD.
+// It is level-triggered.
+class Poller {
+ public:
+  Poller() {
+#if defined(__linux__)
+    fd_ = epoll_create1(0);
+#else
+    fd_ = kqueue();
+#endif
+  }
+
+  ~Poller() {
+    if (fd_ >= 0) close(fd_);
+  }
+
+  Poller(const Poller &) = delete;
+  Poller &operator=(const Poller &) = delete;
+
+  bool Ok() const { return fd_ >= 0; }
+
+  // Start watching fd if is_new is true; otherwise change what is watched
+  void Watch(int fd, bool read, bool write, bool is_new) {
+#if defined(__linux__)
+    epoll_event ev{};
+    ev.events = (read ? EPOLLIN : 0) | (write ? EPOLLOUT : 0);
+    ev.data.fd = fd;
+    epoll_ctl(fd_, is_new ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &ev);
+#else
+    struct kevent ev[2];
+    EV_SET(&ev[0], fd, EVFILT_READ, EV_ADD | (read ? EV_ENABLE : EV_DISABLE),
+           0, 0, nullptr);
+    EV_SET(&ev[1], fd, EVFILT_WRITE,
+           EV_ADD | (write ? EV_ENABLE : EV_DISABLE), 0, 0, nullptr);
+    kevent(fd_, ev, 2, nullptr, 0, nullptr);
+#endif
+  }
+
+  void Remove(int fd) {
+#if defined(__linux__)
+    epoll_ctl(fd_, EPOLL_CTL_DEL, fd, nullptr);
+#else
+    struct kevent ev[2];
+    EV_SET(&ev[0], fd, EVFILT_READ, EV_DELETE, 0, 0, nullptr);
+    EV_SET(&ev[1], fd, EVFILT_WRITE, EV_DELETE, 0, 0, nullptr);
+    kevent(fd_, ev, 2, nullptr, 0, nullptr);
+#endif
+  }
+
+  // Wait at most timeout_ms, or until an event if it is negative. Errors
+  // and hang-ups are reported as readable, so that the next read sees them.
+  void Wait(int32_t timeout_ms, std::vector<PollEvent> *events) {
+    constexpr int32_t kMaxEvents = 256;
+    events->clear();
+
+#if defined(__linux__)
+    epoll_event evs[kMaxEvents];
+    int n = epoll_wait(fd_, evs, kMaxEvents, timeout_ms);
+    for (int i = 0; i < n; ++i) {
+      uint32_t e = evs[i].events;
+      events->push_back({evs[i].data.fd,
+                         (e & (EPOLLIN | EPOLLERR | EPOLLHUP)) != 0,
+                         (e & EPOLLOUT) != 0});
+    }
+#else
+    struct kevent evs[kMaxEvents];
+    timespec ts{timeout_ms / 1000, (timeout_ms % 1000) * 1000000L};
+    int n = kevent(fd_, nullptr, 0, evs, kMaxEvents,
+                   timeout_ms < 0 ? nullptr : &ts);
+    for (int i = 0; i < n; ++i) {
+      bool error = (evs[i].flags & EV_ERROR) != 0;
+      events->push_back({static_cast<int>(evs[i].ident),
+                         evs[i].filter == EVFILT_READ || error,
+                         evs[i].filter == EVFILT_WRITE});
+    }
+#endif
+  }
+
+ private:
+  int fd_ = -1;
+};
+
+bool SetNonBlocking(int fd) {
+  int flags = fcntl(fd, F_GETFL, 0);
+  return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+enum class Protocol {
+  kUnknown,
+  // A WebSocket client whose handshake is not complete
+  kHandshake,
+  kWebSocket,
+  // Length-prefixed messages over TCP
+  kTcp,
+};
+
+struct Connection {
+  int fd = -1;
+
+  // The id of its stream, see Stream::GetId()
+  int64_t id = 0;
+
+  Protocol protocol = Protocol::kUnknown;
+  std::unique_ptr<sherpa_ncnn::Stream> s;
+
+  // Index of the node that decodes s, see Server::nodes_
+  int32_t node = 0;
+
+  // Bytes that are received but not parsed yet, and that are not sent yet
+  std::string in;
+  std::string out;
+
+  // A sample can be split between two messages
+  bool has_odd_byte = false;
+  char odd_byte = 0;
+
+  // Opcode of the WebSocket message being received and its text so far
+  int32_t ws_opcode = 0;
+  std::string ws_text;
+
+  // False at the end of the input or while it is paused
+  bool reading = true;
+  bool paused = false;
+  bool input_finished = false;
+
+  // True once the last result is queued
+  bool done = false;
+  bool closing = false;
+
+  // Index of the current segment, i.e., the number of final results so far
+  int32_t segment = 0;
+
+  int64_t num_samples = 0;
+  int32_t num_pauses = 0;
+  double max_backlog_seconds = 0;
+  Clock::time_point start_time;
+  Clock::time_point input_finished_time;
+};
+
+// A result from the decoding workers for the event loop
+struct Message {
+  int64_t id;
+  sherpa_ncnn::RecognitionResult result;
+  bool is_final;
+  bool is_last;
+};
+
+class Server {
+ public:
+  // recognizers: One for each NUMA node, with the same config, or a single
+  // one. Each has its own scheduler.
+  Server(const std::vector<const sherpa_ncnn::Recognizer *> &recognizers,
+         const sherpa_ncnn::StreamSchedulerConfig &scheduler_config,
+         const ServerConfig &config)
+      : config_(config) {
+    for (const auto *recognizer : recognizers) {
+      Node node;
+      node.recognizer = recognizer;
+      node.scheduler = std::make_unique<sherpa_ncnn::StreamScheduler>(
+          recognizer, scheduler_config,
+          [this](sherpa_ncnn::Stream *s,
+                 const sherpa_ncnn::RecognitionResult &r, bool is_final,
+                 bool is_last) { OnResult(s, r, is_final, is_last); });
+      nodes_.push_back(std::move(node));
+    }
+
+    // New streams use the first encoder, see Recognizer::CreateStream()
+    const auto *model = recognizers[0]->GetModel();
+    chunk_seconds_ = model->Offset() * 0.01f;
+  }
+
+  ~Server() {
+    for (auto &p : connections_) {
+      Scheduler(*p.second).RemoveStream(p.second->s.get());
+      close(p.first);
+    }
+
+    if (listen_fd_ >= 0) close(listen_fd_);
+    if (wake_fds_[0] >= 0) close(wake_fds_[0]);
+    if (wake_fds_[1] >= 0) close(wake_fds_[1]);
+  }
+
+  Server(const Server &) = delete;
+  Server &operator=(const Server &) = delete;
+
+  bool Listen() {
+    if (!poller_.Ok()) {
+      fprintf(stderr, "Failed to create the poller: %s\n", strerror(errno));
+      return false;
+    }
+
+    if (pipe(wake_fds_) != 0 || !SetNonBlocking(wake_fds_[0]) ||
+        !SetNonBlocking(wake_fds_[1])) {
+      fprintf(stderr, "Failed to create a pipe: %s\n", strerror(errno));
+      return false;
+    }
+
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) {
+      fprintf(stderr, "Failed to create a socket: %s\n", strerror(errno));
+      return false;
+    }
+
+    int one = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(config_.port);
+    if (bind(listen_fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) !=
+            0 ||
+        listen(listen_fd_, SOMAXCONN) != 0 || !SetNonBlocking(listen_fd_)) {
+      fprintf(stderr, "Failed to listen on port %d: %s\n", config_.port,
+              strerror(errno));
+      return false;
+    }
+
+    poller_.Watch(listen_fd_, true, false, true);
+    poller_.Watch(wake_fds_[0], true, false, true);
+
+    return true;
+  }
+
+  void Run() {
+    std::vector<PollEvent> events;
+    while (true) {
+      // Paused connections are checked periodically, since the decoding of
+      // their backlog does not always produce a result
+      poller_.Wait(num_paused_ > 0 ? 10 : -1, &events);
+
+      for (const auto &e : events) {
+        if (e.fd == listen_fd_) {
+          Accept();
+          continue;
+        }
+
+        if (e.fd == wake_fds_[0]) {
+          DeliverResults();
+          continue;
+        }
+
+        auto it = connections_.find(e.fd);
+        if (it == connections_.end() || it->second->closing) continue;
+
+        Connection *c = it->second.get();
+        if (e.readable) Read(c);
+        if (e.writable && !c->closing) Flush(c);
+      }
+
+      if (num_paused_ > 0) {
+        ResumePaused();
+      }
+
+      CloseConnections();
+    }
+  }
+
+ private:
+  // Invoked on a worker thread
+  void OnResult(sherpa_ncnn::Stream *s, const sherpa_ncnn::RecognitionResult &r,
+                bool is_final, bool is_last) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      messages_.push_back({s->GetId(), r, is_final, is_last});
+    }
+
+    // If the pipe is full, the loop is woken up anyway
+    char b = 0;
+    ssize_t n = write(wake_fds_[1], &b, 1);
+    (void)n;
+  }
+
+  void DeliverResults() {
+    char buf[256];
+    while (read(wake_fds_[0], buf, sizeof(buf)) > 0) {
+    }
+
+    std::vector<Message> messages;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      messages.swap(messages_);
+    }
+
+    for (const auto &m : messages) {
+      auto it = ids_.find(m.id);
+      if (it == ids_.end() || it->second->closing) continue;
+
+      Connection *c = it->second;
+      Send(c, ToJson(c, m));
+
+      if (m.is_final) ++c->segment;
+
+      if (m.is_last) {
+        c->done = true;
+        PrintStats(*c);
+
+        if (c->protocol == Protocol::kWebSocket) {
+          // A normal closure
+          AppendFrame(0x8, std::string("\x03\xe8", 2), &c->out);
+        }
+      }
+
+      if (!c->closing) Flush(c);
+    }
+  }
+
+  void Accept() {
+    while (true) {
+      int fd = accept(listen_fd_, nullptr, nullptr);
+      if (fd < 0) return;
+
+      if (static_cast<int32_t>(connections_.size()) >=
+          config_.max_connections) {
+        fprintf(stderr, "Rejected a client: %d connections\n",
+                config_.max_connections);
+        close(fd);
+        continue;
+      }
+
+      // The node with the fewest clients
+      int32_t node = 0;
+      for (int32_t i = 1; i != static_cast<int32_t>(nodes_.size()); ++i) {
+        if (nodes_[i].num_connections < nodes_[node].num_connections) {
+          node = i;
+        }
+      }
+
+      auto s = nodes_[node].recognizer->CreateStream();
+      if (!s || !SetNonBlocking(fd)) {
+        fprintf(stderr, "Rejected a client: cannot create its stream\n");
+        close(fd);
+        continue;
+      }
+
+      int one = 1;
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+      auto c = std::make_unique<Connection>();
+      c->fd = fd;
+      c->id = s->GetId();
+      c->s = std::move(s);
+      c->node = node;
+      c->start_time = Clock::now();
+
+      poller_.Watch(fd, true, false, true);
+      Scheduler(*c).AddStream(c->s.get());
+      ++nodes_[node].num_connections;
+
+      ids_[c->id] = c.get();
+      connections_[fd] = std::move(c);
+    }
+  }
+
+  void Read(Connection *c) {
+    char buf[64 * 1024];
+    ssize_t n = recv(c->fd, buf, sizeof(buf), 0);
+    if (n < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        Close(c);
+      }
+      return;
+    }
+
+    if (n == 0) {
+      // The client may still read its results after closing its side
+      if (c->protocol == Protocol::kWebSocket ||
+          c->protocol == Protocol::kTcp) {
+        FinishInput(c);
+        c->reading = false;
+        UpdateWatch(c);
+      } else {
+        Close(c);
+      }
+      return;
+    }
+
+    c->in.append(buf, n);
+    if (!Parse(c)) {
+      Close(c);
+      return;
+    }
+
+    if (!c->input_finished && c->reading) {
+      double backlog = GetBacklogSeconds(*c);
+      c->max_backlog_seconds = std::max(c->max_backlog_seconds, backlog);
+
+      if (backlog > config_.max_backlog_seconds) {
+        c->reading = false;
+        c->paused = true;
+        c->num_pauses += 1;
+        num_paused_ += 1;
+        UpdateWatch(c);
+      }
+    }
+  }
+
+  // Return false on a protocol error
+  bool Parse(Connection *c) {
+    if (c->protocol == Protocol::kUnknown) {
+      if (c->in.size() < 4) return true;
+
+      c->protocol = c->in.compare(0, 4, "GET ") == 0 ? Protocol::kHandshake
+                                                     : Protocol::kTcp;
+    }
+
+    if (c->protocol == Protocol::kHandshake) {
+      auto pos = c->in.find("\r\n\r\n");
+      if (pos == std::string::npos) {
+        return c->in.size() <= 8192;
+      }
+
+      std::string key = GetWebSocketKey(c->in.substr(0, pos));
+      if (key.empty()) return ServeMetrics(c);
+
+      c->out +=
+          "HTTP/1.1 101 Switching Protocols\r\n"
+          "Upgrade: websocket\r\n"
+          "Connection: Upgrade\r\n"
+          "Sec-WebSocket-Accept: " +
+          Base64(Sha1(key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11")) +
+          "\r\n\r\n";
+      c->in.erase(0, pos + 4);
+      c->protocol = Protocol::kWebSocket;
+
+      Flush(c);
+      if (c->closing) return true;
+    }
+
+    if (c->protocol == Protocol::kWebSocket) {
+      return ParseWebSocket(c);
+    }
+
+    return ParseTcp(c);
+  }
+
+  // Reply to a plain HTTP request for /metrics and close the connection.
+  // Return false for other requests.
+  bool ServeMetrics(Connection *c) {
+    if (!config_.metrics || (c->in.compare(0, 13, "GET /metrics ") != 0 &&
+                             c->in.compare(0, 13, "GET /metrics?") != 0)) {
+      return false;
+    }
+
+    std::string body = sherpa_ncnn::Metrics::ToOpenMetrics();
+    c->out +=
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: application/openmetrics-text; version=1.0.0; "
+        "charset=utf-8\r\n"
+        "Content-Length: " +
+        std::to_string(body.size()) +
+        "\r\n"
+        "Connection: close\r\n\r\n" +
+        body;
+    c->in.clear();
+
+    c->reading = false;
+    c->done = true;
+    Flush(c);
+
+    return true;
+  }
+
+  // Each message is a 4-byte little-endian length followed by that many
+  // bytes of 16-bit little-endian samples. A message of length 0 ends the
+  // input.
+  bool ParseTcp(Connection *c) {
+    std::size_t pos = 0;
+    while (c->in.size() - pos >= 4) {
+      const auto *p = reinterpret_cast<const uint8_t *>(c->in.data() + pos);
+      uint32_t n = p[0] | (p[1] << 8) | (p[2] << 16) |
+                   (static_cast<uint32_t>(p[3]) << 24);
+      if (n > static_cast<uint32_t>(config_.max_message_bytes)) return false;
+
+      if (c->in.size() - pos - 4 < n) break;
+
+      if (n == 0) {
+        FinishInput(c);
+      } else {
+        AcceptSamples(c, c->in.data() + pos + 4, n);
+      }
+      pos += 4 + n;
+    }
+
+    c->in.erase(0, pos);
+    return true;
+  }
+
+  // Binary messages hold 16-bit little-endian samples. The text message
+  // "Done" or a close frame ends the input.
+  bool ParseWebSocket(Connection *c) {
+    std::size_t pos = 0;
+    while (true) {
+      std::size_t avail = c->in.size() - pos;
+      if (avail < 2) break;
+
+      const auto *p = reinterpret_cast<const uint8_t *>(c->in.data() + pos);
+      bool fin = (p[0] & 0x80) != 0;
+      int32_t opcode = p[0] & 0x0f;
+      bool masked = (p[1] & 0x80) != 0;
+      uint64_t n = p[1] & 0x7f;
+
+      // Frames from clients must be masked
+      if (!masked) return false;
+
+      std::size_t header = 2;
+      if (n == 126) {
+        if (avail < 4) break;
+        n = (p[2] << 8) | p[3];
+        header = 4;
+      } else if (n == 127) {
+        if (avail < 10) break;
+        n = 0;
+        for (int32_t i = 0; i != 8; ++i) {
+          n = (n << 8) | p[2 + i];
+        }
+        header = 10;
+      }
+
+      if (n > static_cast<uint64_t>(config_.max_message_bytes)) return false;
+      if (avail < header + 4 + n) break;
+
+      const uint8_t *mask = p + header;
+      char *payload = &c->in[pos + header + 4];
+      for (uint64_t i = 0; i != n; ++i) {
+        payload[i] ^= mask[i % 4];
+      }
+      pos += header + 4 + n;
+
+      if (opcode == 0x0) {
+        opcode = c->ws_opcode;
+      } else if (opcode < 0x8) {
+        c->ws_opcode = opcode;
+      }
+
+      switch (opcode) {
+        case 0x1:
+          c->ws_text.append(payload, n);
+          if (c->ws_text.size() > 64) return false;
+          if (fin) {
+            if (c->ws_text == "Done") FinishInput(c);
+            c->ws_text.clear();
+          }
+          break;
+        case 0x2:
+          AcceptSamples(c, payload, n);
+          break;
+        case 0x8:
+          FinishInput(c);
+          c->reading = false;
+          UpdateWatch(c);
+          break;
+        case 0x9:
+          AppendFrame(0xA, std::string(payload, n), &c->out);
+          Flush(c);
+          break;
+        case 0xA:
+          break;
+        default:
+          return false;
+      }
+
+      if (c->closing || !c->reading) break;
+    }
+
+    c->in.erase(0, pos);
+    return true;
+  }
+
+  void AcceptSamples(Connection *c, const char *data, std::size_t n) {
+    if (c->input_finished || n == 0) return;
+
+    samples_.clear();
+    std::size_t i = 0;
+    if (c->has_odd_byte) {
+      samples_.push_back(static_cast<int16_t>(
+          static_cast<uint8_t>(c->odd_byte) |
+          (static_cast<uint8_t>(data[0]) << 8)));
+      c->has_odd_byte = false;
+      i = 1;
+    }
+
+    for (; i + 1 < n; i += 2) {
+      samples_.push_back(static_cast<int16_t>(
+          static_cast<uint8_t>(data[i]) |
+          (static_cast<uint8_t>(data[i + 1]) << 8)));
+    }
+
+    if (i < n) {
+      c->odd_byte = data[i];
+      c->has_odd_byte = true;
+    }
+
+    if (samples_.empty()) return;
+
+    Scheduler(*c).AcceptWaveformInt16(c->s.get(), config_.sample_rate,
+                                      samples_.data(), samples_.size());
+    c->num_samples += samples_.size();
+  }
+
+  void FinishInput(Connection *c) {
+    if (c->input_finished) return;
+
+    c->input_finished = true;
+    c->input_finished_time = Clock::now();
+
+    std::vector<float> tail_paddings(
+        static_cast<int32_t>(config_.tail_padding * config_.sample_rate));
+    Scheduler(*c).AcceptWaveform(c->s.get(), config_.sample_rate,
+                                 tail_paddings.data(), tail_paddings.size());
+    Scheduler(*c).InputFinished(c->s.get());
+  }
+
+  // Seconds of audio of c that are received but not decoded yet. It uses
+  // the number of encoder runs of the stream, which is updated under a
+  // lock, so that it can be read while the stream is being decoded.
+  double GetBacklogSeconds(const Connection &c) const {
+    const auto *stats = c.s->GetLatencyStats();
+    int64_t num_chunks = stats->Summary(sherpa_ncnn::Stage::kEncoder).count;
+
+    return static_cast<double>(c.num_samples) / config_.sample_rate -
+           num_chunks * chunk_seconds_;
+  }
+
+  void ResumePaused() {
+    for (auto &p : connections_) {
+      Connection *c = p.second.get();
+      if (!c->paused || c->closing) continue;
+
+      if (GetBacklogSeconds(*c) < config_.max_backlog_seconds / 2) {
+        c->paused = false;
+        c->reading = true;
+        num_paused_ -= 1;
+        UpdateWatch(c);
+      }
+    }
+  }
+
+  void Send(Connection *c, const std::string &text) {
+    if (c->protocol == Protocol::kWebSocket) {
+      AppendFrame(0x1, text, &c->out);
+    } else {
+      uint32_t n = text.size();
+      char len[4] = {static_cast<char>(n), static_cast<char>(n >> 8),
+                     static_cast<char>(n >> 16), static_cast<char>(n >> 24)};
+      c->out.append(len, 4);
+      c->out += text;
+    }
+
+    if (static_cast<int32_t>(c->out.size()) > config_.max_output_bytes) {
+      fprintf(stderr, "Client %lld does not read its results. Closing it\n",
+              static_cast<long long>(c->id));  // NOLINT
+      Close(c);
+    }
+  }
+
+  // An unmasked frame from the server
+  static void AppendFrame(int32_t opcode, const std::string &payload,
+                          std::string *out) {
+    out->push_back(static_cast<char>(0x80 | opcode));
+
+    uint64_t n = payload.size();
+    if (n < 126) {
+      out->push_back(static_cast<char>(n));
+    } else if (n < 65536) {
+      out->push_back(126);
+      out->push_back(static_cast<char>(n >> 8));
+      out->push_back(static_cast<char>(n));
+    } else {
+      out->push_back(127);
+      for (int32_t i = 7; i >= 0; --i) {
+        out->push_back(static_cast<char>(n >> (i * 8)));
+      }
+    }
+
+    *out += payload;
+  }
+
+  void Flush(Connection *c) {
+    std::size_t pos = 0;
+    while (pos < c->out.size()) {
+      ssize_t n = send(c->fd, c->out.data() + pos, c->out.size() - pos, 0);
+      if (n < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) break;
+
+        Close(c);
+        return;
+      }
+      pos += n;
+    }
+    c->out.erase(0, pos);
+
+    if (c->out.empty() && c->done) {
+      Close(c);
+      return;
+    }
+
+    UpdateWatch(c);
+  }
+
+  void UpdateWatch(Connection *c) {
+    if (c->closing) return;
+    poller_.Watch(c->fd, c->reading, !c->out.empty(), false);
+  }
+
+  // The connection is closed at the end of the current iteration of the
+  // loop, so that events for its fd in this iteration are ignored
+  void Close(Connection *c) {
+    if (c->closing) return;
+
+    c->closing = true;
+    if (c->paused) num_paused_ -= 1;
+
+    // It returns immediately if the last result was delivered
+    Scheduler(*c).RemoveStream(c->s.get());
+    poller_.Remove(c->fd);
+
+    to_close_.push_back(c->fd);
+  }
+
+  void CloseConnections() {
+    for (int fd : to_close_) {
+      auto it = connections_.find(fd);
+      ids_.erase(it->second->id);
+      --nodes_[it->second->node].num_connections;
+      connections_.erase(it);
+      close(fd);
+    }
+    to_close_.clear();
+  }
+
+  std::string ToJson(const Connection *c, const Message &m) const {
+    std::ostringstream os;
+    os << "{\"text\": " << ToJsonString(m.result.text) << ", \"tokens\": [";
+
+    std::string sep;
+    for (const auto &t : m.result.stokens) {
+      os << sep << ToJsonString(t);
+      sep = ", ";
+    }
+
+    os << "], \"timestamps\": [";
+    sep.clear();
+    os << std::fixed << std::setprecision(2);
+    for (float t : m.result.timestamps) {
+      os << sep << t;
+      sep = ", ";
+    }
+
+    os << "], \"segment\": " << c->segment
+       << ", \"is_final\": " << (m.is_final ? "true" : "false");
+
+    if (m.is_last) {
+      double final_latency_ms = std::chrono::duration<double, std::milli>(
+                                    Clock::now() - c->input_finished_time)
+                                    .count();
+
+      os << ", \"is_last\": true, \"stats\": {";
+      os << "\"audio_seconds\": "
+         << static_cast<double>(c->num_samples) / config_.sample_rate;
+      os << ", \"final_latency_ms\": " << final_latency_ms;
+      os << ", \"max_backlog_seconds\": " << c->max_backlog_seconds;
+      os << ", \"num_pauses\": " << c->num_pauses;
+
+      // One sample per chunk of the stream, see LatencyStats
+      const auto *stats = c->s->GetLatencyStats();
+      for (auto stage : {sherpa_ncnn::Stage::kFeatureExtraction,
+                         sherpa_ncnn::Stage::kEncoder,
+                         sherpa_ncnn::Stage::kDecoder,
+                         sherpa_ncnn::Stage::kJoiner,
+                         sherpa_ncnn::Stage::kSearch}) {
+        auto summary = stats->Summary(stage);
+        if (summary.count == 0) continue;
+
+        os << ", \"" << sherpa_ncnn::GetStageName(stage)
+           << "\": {\"count\": " << summary.count
+           << ", \"mean_ms\": " << summary.mean_ms
+           << ", \"p50_ms\": " << summary.p50_ms
+           << ", \"p99_ms\": " << summary.p99_ms
+           << ", \"max_ms\": " << summary.max_ms << "}";
+      }
+      os << "}";
+    }
+
+    os << "}";
+    return os.str();
+  }
+
+  sherpa_ncnn::StreamScheduler &Scheduler(const Connection &c) const {
+    return *nodes_[c.node].scheduler;
+  }
+
+  void PrintStats(const Connection &c) const {
+    double seconds = std::chrono::duration<double>(Clock::now() -
+                                                   c.start_time)
+                         .count();
+    double final_latency_ms = std::chrono::duration<double, std::milli>(
+                                  Clock::now() - c.input_finished_time)
+                                  .count();
+
+    auto encoder =
+        c.s->GetLatencyStats()->Summary(sherpa_ncnn::Stage::kEncoder);
+
+    fprintf(stderr,
+            "Client %lld: %.2f s of audio in %.2f s, %d segments, final "
+            "latency %.1f ms, encoder p50 %.1f ms, p99 %.1f ms, %d pauses\n",
+            static_cast<long long>(c.id),  // NOLINT
+            static_cast<double>(c.num_samples) / config_.sample_rate,
+            seconds, c.segment, final_latency_ms, encoder.p50_ms,
+            encoder.p99_ms, c.num_pauses);
+
+    auto stats = Scheduler(c).GetStats();
+    if (stats.num_overloads > 0) {
+      fprintf(stderr, "%s\n", stats.ToString().c_str());
+    }
+  }
+
+ private:
+  struct Node {
+    const sherpa_ncnn::Recognizer *recognizer = nullptr;
+    std::unique_ptr<sherpa_ncnn::StreamScheduler> scheduler;
+    int32_t num_connections = 0;
+  };
+
+  ServerConfig config_;
+
+  Poller poller_;
+  int listen_fd_ = -1;
+
+  // Workers write a byte to wake_fds_[1] after queuing a message
+  int wake_fds_[2] = {-1, -1};
+
+  // fd -> connection
+  std::unordered_map<int, std::unique_ptr<Connection>> connections_;
+
+  // Stream id -> connection
+  std::unordered_map<int64_t, Connection *> ids_;
+
+  std::vector<int> to_close_;
+  int32_t num_paused_ = 0;
+  float chunk_seconds_ = 0;
+
+  std::vector<int16_t> samples_;
+
+  // Protects messages_
+  std::mutex mutex_;
+  std::vector<Message> messages_;
+
+  // Destroyed first, so that no callback runs while the connections are
+  // destroyed
+  std::vector<Node> nodes_;
+};
+
+}  // namespace
+
+int32_t main(int32_t argc, char *argv[]) {
+  const char *kUsageMessage = R"usage(
+A streaming speech recognition server.
+
+Clients connect over TCP and send 16-bit little-endian mono samples at
+--sample-rate. The first bytes from a client select its protocol:
+
+  WebSocket  The client sends an HTTP upgrade request, then binary
+             messages with samples and the text message "Done" at the
+             end of its audio. Results are sent as text messages, and
+             the server closes the connection after the last one.
+
+  TCP        Every message in either direction is a 4-byte little-endian
+             length followed by the payload. The client sends samples
+             and an empty message at the end of its audio. Results are
+             sent as messages, and the server closes the connection after
+             the last one.
+
+Each result is a JSON object with the fields text, tokens, timestamps,
+segment and is_final. A result is final at an endpoint, if endpointing is
+enabled, and at the end of the audio. The last one has is_last set and
+the latency statistics of the connection in stats.
+
+The streams of all clients share one model and are decoded in batches on
+--num-workers threads. With --numa, each NUMA node has a copy of the
+model, --num-workers threads that run on its cores, and a share of the
+clients. A client with more than --max-backlog-seconds of
+audio that is not decoded yet is not read from until it has caught up.
+
+Usage:
+
+  ./bin/sherpa-ncnn-streaming-server \
+    --tokens=/path/to/tokens.txt \
+    --encoder-param=/path/to/encoder.ncnn.param \
+    --encoder-bin=/path/to/encoder.ncnn.bin \
+    --decoder-param=/path/to/decoder.ncnn.param \
+    --decoder-bin=/path/to/decoder.ncnn.bin \
+    --joiner-param=/path/to/joiner.ncnn.param \
+    --joiner-bin=/path/to/joiner.ncnn.bin \
+    --num-threads=1 \
+    --num-workers=4 \
+    --port=6006
+)usage";
+
+  sherpa_ncnn::ParseOptions po(kUsageMessage);
+
+  sherpa_ncnn::RecognizerConfig config;
+  sherpa_ncnn::StreamSchedulerConfig scheduler_config;
+  ServerConfig server_config;
+  int32_t num_threads = 1;
+  bool numa = false;
+
+  auto &model_config = config.model_config;
+  po.Register("tokens", &model_config.tokens, "Path to tokens.txt");
+  po.Register("encoder-param", &model_config.encoder_param,
+              "Path to encoder.ncnn.param");
+  po.Register("encoder-bin", &model_config.encoder_bin,
+              "Path to encoder.ncnn.bin");
+  po.Register("decoder-param", &model_config.decoder_param,
+              "Path to decoder.ncnn.param");
+  po.Register("decoder-bin", &model_config.decoder_bin,
+              "Path to decoder.ncnn.bin");
+  po.Register("joiner-param", &model_config.joiner_param,
+              "Path to joiner.ncnn.param");
+  po.Register("joiner-bin", &model_config.joiner_bin,
+              "Path to joiner.ncnn.bin");
+  po.Register("bundle", &model_config.bundle,
+              "Path to a model bundle. If given, the paths above are "
+              "ignored");
+  po.Register("use-mmap", &model_config.use_mmap,
+              "Memory map the .bin files");
+  po.Register("use-huge-pages", &model_config.use_huge_pages,
+              "Read the .bin files and large memory pool chunks into huge "
+              "pages");
+  po.Register("num-threads", &num_threads,
+              "Number of threads of each network");
+  po.Register("decoding-method", &config.decoder_config.method,
+              "greedy_search or modified_beam_search");
+  po.Register("num-active-paths", &config.decoder_config.num_active_paths,
+              "Used only for modified_beam_search");
+  po.Register("enable-endpoint", &config.enable_endpoint,
+              "Send a final result at each endpoint");
+  po.Register("hotwords-file", &config.hotwords_file,
+              "Hotwords of all clients, used only for modified_beam_search");
+
+  po.Register("num-workers", &scheduler_config.num_threads,
+              "Number of threads that decode streams");
+  po.Register("max-batch-size", &scheduler_config.max_batch_size,
+              "A worker decodes at most this many streams together");
+  po.Register("max-latency-ms", &scheduler_config.max_latency_ms,
+              "How long a ready stream may wait for others to join its "
+              "batch");
+  po.Register("overload-queue-depth", &scheduler_config.overload_queue_depth,
+              "Switch streams to greedy search while more streams wait for "
+              "a worker. 0 to disable");
+  po.Register("overload-deadline-ms", &scheduler_config.overload_deadline_ms,
+              "Switch streams to greedy search while more than "
+              "--overload-miss-rate of the chunks wait longer. 0 to disable");
+  po.Register("overload-miss-rate", &scheduler_config.overload_miss_rate,
+              "See --overload-deadline-ms");
+  po.Register("overload-max-batch-size",
+              &scheduler_config.overload_max_batch_size,
+              "--max-batch-size while overloaded. 0 to keep it");
+  po.Register("thread-budget", &scheduler_config.thread_budget,
+              "If positive, the workers share this many threads and each "
+              "batch takes more of them when fewer batches run at once. "
+              "It overrides --num-threads");
+
+  po.Register("numa", &numa,
+              "Load a copy of the model on each NUMA node and decode the "
+              "streams of a client on one node. --use-mmap should be false");
+
+  po.Register("port", &server_config.port, "The port to listen on");
+  po.Register("max-connections", &server_config.max_connections,
+              "Clients beyond this many are rejected");
+  po.Register("sample-rate", &server_config.sample_rate,
+              "Sample rate of the audio of the clients");
+  po.Register("tail-padding", &server_config.tail_padding,
+              "Seconds of silence appended to the audio of a client");
+  po.Register("max-backlog-seconds", &server_config.max_backlog_seconds,
+              "Stop reading from a client while it has more audio that is "
+              "not decoded yet");
+  po.Register("max-message-bytes", &server_config.max_message_bytes,
+              "Close a client that sends a larger message");
+  po.Register("max-output-bytes", &server_config.max_output_bytes,
+              "Close a client that leaves more results unread");
+  po.Register("metrics", &server_config.metrics,
+              "true to serve metrics in the OpenMetrics text format at "
+              "http://host:port/metrics, e.g., for Prometheus");
+
+  po.Read(argc, argv);
+  if (po.NumArgs() != 0) {
+    po.PrintUsage();
+    exit(EXIT_FAILURE);
+  }
+
+  if (server_config.sample_rate <= 0 || server_config.tail_padding < 0 ||
+      server_config.max_backlog_seconds <= 0 ||
+      server_config.max_connections < 1) {
+    fprintf(stderr, "Invalid --sample-rate, --tail-padding, "
+                    "--max-backlog-seconds or --max-connections\n");
+    exit(EXIT_FAILURE);
+  }
+
+  model_config.encoder_opt.num_threads = num_threads;
+  model_config.decoder_opt.num_threads = num_threads;
+  model_config.joiner_opt.num_threads = num_threads;
+
+  // For the backlog and the latency statistics of each client
+  config.enable_profiling = true;
+
+  sherpa_ncnn::Metrics::Enable(server_config.metrics);
+
+  fprintf(stderr, "%s\n", config.ToString().c_str());
+  fprintf(stderr, "%s\n", scheduler_config.ToString().c_str());
+
+  // A client that disconnects must not kill the server
+  signal(SIGPIPE, SIG_IGN);
+
+  std::vector<std::unique_ptr<sherpa_ncnn::Recognizer>> recognizers;
+  if (numa) {
+    auto node_cores = sherpa_ncnn::GetNumaNodeCores();
+    fprintf(stderr, "Found %d NUMA nodes\n",
+            static_cast<int32_t>(node_cores.size()));
+
+    if (node_cores.size() > 1) {
+      auto models = sherpa_ncnn::CreateNumaReplicas(model_config, node_cores);
+      if (models.empty()) {
+        fprintf(stderr, "Failed to create the models\n");
+        return -1;
+      }
+
+      for (auto &m : models) {
+        recognizers.push_back(
+            std::make_unique<sherpa_ncnn::Recognizer>(config, std::move(m)));
+      }
+    }
+  }
+
+  if (recognizers.empty()) {
+    recognizers.push_back(std::make_unique<sherpa_ncnn::Recognizer>(config));
+  }
+
+  std::vector<const sherpa_ncnn::Recognizer *> ptrs;
+  for (const auto &r : recognizers) {
+    if (!r->GetModel()) {
+      fprintf(stderr, "Failed to create the recognizer\n");
+      return -1;
+    }
+    r->WarmUp();
+    ptrs.push_back(r.get());
+  }
+
+  Server server(ptrs, scheduler_config, server_config);
+  if (!server.Listen()) {
+    return -1;
+  }
+
+  fprintf(stderr, "Listening on port %d\n", server_config.port);
+  server.Run();
+
+  return 0;
+}
@@ -0,0 +1,285 @@
+// sherpa-ncnn/csrc/sherpa-ncnn-tts-bench.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/latency-stats.h"
+#include "sherpa-ncnn/csrc/offline-tts.h"
+#include "sherpa-ncnn/csrc/parse-options.h"
+#include "sherpa-ncnn/csrc/text-utils.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const sherpa_ncnn::Stage kTtsStages[] = {
+    sherpa_ncnn::Stage::kTtsFrontEnd,
+    sherpa_ncnn::Stage::kTtsEncoder,
+    sherpa_ncnn::Stage::kTtsDurationPredictor,
+    sherpa_ncnn::Stage::kTtsPathAttention,
+    sherpa_ncnn::Stage::kTtsFlow,
+    sherpa_ncnn::Stage::kTtsVocoder,
+};
+
+struct BenchResult {
+  int32_t num_threads = 0;
+  int32_t num_prompts = 0;
+  double audio_seconds = 0;
+  double elapsed_seconds = 0;
+
+  // elapsed_seconds / audio_seconds
+  double rtf = 0;
+
+  // Time from calling Generate() until the callback receives the first
+  // samples of a prompt
+  double ttfa_p50_ms = 0;
+  double ttfa_p90_ms = 0;
+  double ttfa_max_ms = 0;
+
+  // Mean time of each stage of kTtsStages. A sample is one sentence, or
+  // one prompt for the front-end
+  std::vector<double> stage_mean_ms;
+
+  std::string ToJson() const {
+    std::ostringstream os;
+    os << "{\"num_threads\": " << num_threads << ", "
+       << "\"num_prompts\": " << num_prompts << ", "
+       << "\"audio_seconds\": " << audio_seconds << ", "
+       << "\"elapsed_seconds\": " << elapsed_seconds << ", "
+       << "\"rtf\": " << rtf << ", "
+       << "\"ttfa_p50_ms\": " << ttfa_p50_ms << ", "
+       << "\"ttfa_p90_ms\": " << ttfa_p90_ms << ", "
+       << "\"ttfa_max_ms\": " << ttfa_max_ms;
+
+    for (std::size_t i = 0; i != stage_mean_ms.size(); ++i) {
+      os << ", \"" << sherpa_ncnn::GetStageName(kTtsStages[i])
+         << "_mean_ms\": " << stage_mean_ms[i];
+    }
+    os << "}";
+
+    return os.str();
+  }
+};
+
+double Percentile(const std::vector<double> &sorted, double p) {
+  if (sorted.empty()) {
+    return 0;
+  }
+
+  int32_t i = std::min<int32_t>(p * sorted.size(), sorted.size() - 1);
+  return sorted[i];
+}
+
+double Seconds(Clock::duration d) {
+  return std::chrono::duration<double>(d).count();
+}
+
+BenchResult Run(const sherpa_ncnn::OfflineTtsConfig &config,
+                const std::vector<std::string> &prompts, int32_t sid,
+                int32_t num_repeats) {
+  sherpa_ncnn::OfflineTts tts(config);
+
+  sherpa_ncnn::TtsArgs args;
+  args.sid = sid;
+
+  // Warm up, e.g., so that ncnn allocates its memory pools
+  args.text = prompts[0];
+  tts.Generate(args);
+
+  // The warm-up is excluded from the stage times
+  const sherpa_ncnn::LatencyStats *stats = tts.GetLatencyStats();
+  std::vector<sherpa_ncnn::StageSummary> before;
+  for (auto stage : kTtsStages) {
+    before.push_back(stats->Summary(stage));
+  }
+
+  BenchResult ans;
+  ans.num_threads = config.model.num_threads;
+
+  std::vector<double> ttfa;
+
+  Clock::time_point start;
+  Clock::time_point first;
+  bool received = false;
+  auto callback = [&](const float *, int32_t n, int32_t, int32_t,
+                      void *) -> int32_t {
+    if (!received && n > 0) {
+      first = Clock::now();
+      received = true;
+    }
+    return 1;
+  };
+
+  for (int32_t r = 0; r != num_repeats; ++r) {
+    for (const auto &text : prompts) {
+      args.text = text;
+
+      received = false;
+      start = Clock::now();
+      auto audio = tts.Generate(args, callback);
+      auto end = Clock::now();
+
+      if (audio.samples.empty()) {
+        fprintf(stderr, "Failed to generate audio for '%s'\n", text.c_str());
+        continue;
+      }
+
+      ans.num_prompts += 1;
+      ans.audio_seconds +=
+          static_cast<double>(audio.samples.size()) / audio.sample_rate;
+      ans.elapsed_seconds += Seconds(end - start);
+      ttfa.push_back(Seconds((received ? first : end) - start) * 1000);
+    }
+  }
+
+  ans.rtf = ans.audio_seconds > 0 ? ans.elapsed_seconds / ans.audio_seconds
+                                  : 0;
+
+  std::sort(ttfa.begin(), ttfa.end());
+  ans.ttfa_p50_ms = Percentile(ttfa, 0.5);
+  ans.ttfa_p90_ms = Percentile(ttfa, 0.9);
+  ans.ttfa_max_ms = ttfa.empty() ? 0 : ttfa.back();
+
+  for (std::size_t i = 0; i != before.size(); ++i) {
+    auto after = stats->Summary(kTtsStages[i]);
+    int64_t count = after.count - before[i].count;
+    ans.stage_mean_ms.push_back(
+        count > 0 ? (after.total_ms - before[i].total_ms) / count : 0);
+  }
+
+  return ans;
+}
+
+}  // namespace
+
+int32_t main(int32_t argc, char *argv[]) {
+  const char *kUsageMessage = R"usage(
+Benchmark text-to-speech and find out where the time goes.
+
+It reads prompts from a text file, one per line, and generates audio for
+each of them --num-repeats times. It is repeated for each number of
+threads in --num-threads-list. The audio is not saved.
+
+For each number of threads, a summary is printed to stderr and one JSON
+line to stdout:
+
+  rtf              generation time / audio duration
+  ttfa_*_ms        time to the first audio of a prompt. See
+                   --tts-decoder-chunk-size to reduce it.
+  tts_*_mean_ms    mean time of a stage per sentence: the text front-end
+                   (per prompt), the encoder, the duration predictor, the
+                   path attention, the flow and the decoder (vocoder)
+
+The audio cache and the token cache are disabled, so that every prompt
+goes through all stages.
+
+Usage:
+
+  ./bin/sherpa-ncnn-tts-bench \
+    --vits-model-dir=./ncnn-vits-piper-en_US-amy-low \
+    --num-threads-list=1,2,4 \
+    --num-repeats=3 \
+    ./prompts.txt
+)usage";
+
+  sherpa_ncnn::ParseOptions po(kUsageMessage);
+
+  sherpa_ncnn::OfflineTtsConfig config;
+  std::string num_threads_list;
+  int32_t num_repeats = 1;
+  int32_t sid = 0;
+
+  config.Register(&po);
+
+  po.Register("num-threads-list", &num_threads_list,
+              "Comma separated numbers of threads to benchmark. If empty, "
+              "--num-threads is used");
+  po.Register("num-repeats", &num_repeats,
+              "Number of times each prompt is generated");
+  po.Register("sid", &sid, "Speaker ID. Used only for multi-speaker models");
+
+  po.Read(argc, argv);
+  if (po.NumArgs() != 1) {
+    fprintf(stderr, "Error: Please provide a file of prompts.\n\n");
+    po.PrintUsage();
+    exit(EXIT_FAILURE);
+  }
+
+  if (num_repeats < 1) {
+    fprintf(stderr, "Invalid --num-repeats: %d\n", num_repeats);
+    exit(EXIT_FAILURE);
+  }
+
+  std::vector<int32_t> threads;
+  if (num_threads_list.empty()) {
+    threads.push_back(config.model.num_threads);
+  } else if (!sherpa_ncnn::SplitStringToIntegers(num_threads_list, ",", true,
+                                                 &threads) ||
+             threads.empty() ||
+             *std::min_element(threads.begin(), threads.end()) < 1) {
+    fprintf(stderr, "Invalid --num-threads-list: %s\n",
+            num_threads_list.c_str());
+    exit(EXIT_FAILURE);
+  }
+
+  std::ifstream is(po.GetArg(1));
+  if (!is) {
+    fprintf(stderr, "Failed to open '%s'\n", po.GetArg(1).c_str());
+    exit(EXIT_FAILURE);
+  }
+
+  std::vector<std::string> prompts;
+  std::string line;
+  while (std::getline(is, line)) {
+    if (!line.empty()) {
+      prompts.push_back(line);
+    }
+  }
+
+  if (prompts.empty()) {
+    fprintf(stderr, "There are no prompts in '%s'\n", po.GetArg(1).c_str());
+    exit(EXIT_FAILURE);
+  }
+
+  config.enable_profiling = true;
+  config.token_cache_size = 0;
+  config.audio_cache_size = 0;
+  config.audio_cache_dir.clear();
+
+  if (!config.Validate()) {
+    fprintf(stderr, "Errors in config!\n");
+    exit(EXIT_FAILURE);
+  }
+
+  for (int32_t n : threads) {
+    config.model.num_threads = n;
+
+    BenchResult r = Run(config, prompts, sid, num_repeats);
+
+    fprintf(stderr,
+            "%d threads: %d prompts, %.1f s of audio in %.1f s\n"
+            "  RTF: %.3f\n"
+            "  time to first audio (ms): p50 %.1f, p90 %.1f, max %.1f\n"
+            "  mean time per sentence (ms):\n",
+            r.num_threads, r.num_prompts, r.audio_seconds, r.elapsed_seconds,
+            r.rtf, r.ttfa_p50_ms, r.ttfa_p90_ms, r.ttfa_max_ms);
+
+    for (std::size_t i = 0; i != r.stage_mean_ms.size(); ++i) {
+      fprintf(stderr, "    %-24s %.2f\n",
+              sherpa_ncnn::GetStageName(kTtsStages[i]), r.stage_mean_ms[i]);
+    }
+
+    fprintf(stdout, "%s\n", r.ToJson().c_str());
+    fflush(stdout);
+  }
+
+  return 0;
+}
@@ -0,0 +1,165 @@
+// sherpa-ncnn/csrc/sherpa-ncnn-two-pass.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/offline-recognizer.h"
+#include "sherpa-ncnn/csrc/parse-options.h"
+#include "sherpa-ncnn/csrc/recognizer.h"
+#include "sherpa-ncnn/csrc/two-pass-recognizer.h"
+#include "sherpa-ncnn/csrc/wave-reader.h"
+
+int32_t main(int32_t argc, char *argv[]) {
+  const char *kUsageMessage = R"usage(
+Two-pass decoding of a wave file: a streaming transducer gives the partial
+results and SenseVoice rescores each utterance once an endpoint is
+detected. The file is fed in chunks of --chunk-seconds as fast as
+possible, as if it were a live stream.
+
+Usage:
+
+  ./bin/sherpa-ncnn-two-pass \
+    --tokens=/path/to/tokens.txt \
+    --encoder-param=/path/to/encoder.ncnn.param \
+    --encoder-bin=/path/to/encoder.ncnn.bin \
+    --decoder-param=/path/to/decoder.ncnn.param \
+    --decoder-bin=/path/to/decoder.ncnn.bin \
+    --joiner-param=/path/to/joiner.ncnn.param \
+    --joiner-bin=/path/to/joiner.ncnn.bin \
+    --second-pass.tokens=/path/to/sense-voice/tokens.txt \
+    --second-pass.sense-voice-model-dir=/path/to/sense-voice \
+    /path/to/foo.wav
+
+Options of the second pass have the prefix --second-pass.
+)usage";
+
+  sherpa_ncnn::ParseOptions po(kUsageMessage);
+
+  sherpa_ncnn::RecognizerConfig config;
+  sherpa_ncnn::OfflineRecognizerConfig offline_config;
+  sherpa_ncnn::TwoPassRecognizerConfig two_pass_config;
+  int32_t num_threads = 2;
+  float chunk_seconds = 0.1;
+
+  auto &model_config = config.model_config;
+  po.Register("tokens", &model_config.tokens, "Path to tokens.txt");
+  po.Register("encoder-param", &model_config.encoder_param,
+              "Path to encoder.ncnn.param");
+  po.Register("encoder-bin", &model_config.encoder_bin,
+              "Path to encoder.ncnn.bin");
+  po.Register("decoder-param", &model_config.decoder_param,
+              "Path to decoder.ncnn.param");
+  po.Register("decoder-bin", &model_config.decoder_bin,
+              "Path to decoder.ncnn.bin");
+  po.Register("joiner-param", &model_config.joiner_param,
+              "Path to joiner.ncnn.param");
+  po.Register("joiner-bin", &model_config.joiner_bin,
+              "Path to joiner.ncnn.bin");
+  po.Register("num-threads", &num_threads,
+              "Number of threads of each network of the first pass");
+  po.Register("decoding-method", &config.decoder_config.method,
+              "greedy_search or modified_beam_search");
+  po.Register("chunk-seconds", &chunk_seconds,
+              "Seconds of audio fed to the first pass at a time");
+
+  po.Register("max-pending", &two_pass_config.max_pending,
+              "The second pass is skipped while this many utterances are "
+              "pending");
+  po.Register("max-utterance-seconds",
+              &two_pass_config.max_utterance_seconds,
+              "Longer utterances are not rescored. 0 means no limit");
+  po.Register("second-pass-threads", &two_pass_config.queue_config.num_threads,
+              "Number of worker threads of the second pass");
+
+  sherpa_ncnn::ParseOptions second_pass_po("second-pass", &po);
+  offline_config.Register(&second_pass_po);
+
+  po.Read(argc, argv);
+  if (po.NumArgs() != 1) {
+    po.PrintUsage();
+    exit(EXIT_FAILURE);
+  }
+
+  if (!offline_config.Validate()) {
+    fprintf(stderr, "Errors in the config of the second pass!\n");
+    exit(EXIT_FAILURE);
+  }
+
+  model_config.encoder_opt.num_threads = num_threads;
+  model_config.decoder_opt.num_threads = num_threads;
+  model_config.joiner_opt.num_threads = num_threads;
+
+  config.enable_endpoint = true;
+  config.endpoint_config.rule1.min_trailing_silence = 2.4;
+  config.endpoint_config.rule2.min_trailing_silence = 0.8;
+  config.endpoint_config.rule3.min_utterance_length = 300;
+
+  fprintf(stderr, "%s\n", config.ToString().c_str());
+  fprintf(stderr, "%s\n", offline_config.ToString().c_str());
+  fprintf(stderr, "%s\n", two_pass_config.ToString().c_str());
+
+  sherpa_ncnn::Recognizer recognizer(config);
+  sherpa_ncnn::OfflineRecognizer offline_recognizer(offline_config);
+  sherpa_ncnn::TwoPassRecognizer two_pass(&recognizer, &offline_recognizer,
+                                          two_pass_config);
+
+  std::string wav_filename = po.GetArg(1);
+  int32_t sampling_rate = -1;
+  bool is_ok = false;
+  std::vector<float> samples =
+      sherpa_ncnn::ReadWave(wav_filename, &sampling_rate, &is_ok);
+  if (!is_ok) {
+    fprintf(stderr, "Failed to read '%s'\n", wav_filename.c_str());
+    exit(EXIT_FAILURE);
+  }
+
+  std::mutex mutex;
+  auto s = two_pass.CreateStream(
+      [&mutex](const sherpa_ncnn::TwoPassResult &r) {
+        std::lock_guard<std::mutex> lock(mutex);
+        fprintf(stderr, "%d: %s\n", r.segment, r.first_pass_text.c_str());
+        if (r.rescored) {
+          fprintf(stderr, "%d: %s (second pass)\n", r.segment,
+                  r.text.c_str());
+        }
+      });
+  sherpa_ncnn::Stream *stream = s->GetStream();
+
+  int32_t chunk = std::max<int32_t>(1, chunk_seconds * sampling_rate);
+  std::vector<float> tail_paddings(static_cast<int>(0.3 * sampling_rate));
+  samples.insert(samples.end(), tail_paddings.begin(), tail_paddings.end());
+
+  for (int32_t start = 0; start < static_cast<int32_t>(samples.size());
+       start += chunk) {
+    int32_t n = std::min<int32_t>(chunk, samples.size() - start);
+    two_pass.AcceptWaveform(s.get(), sampling_rate, samples.data() + start,
+                            n);
+
+    while (recognizer.IsReady(stream)) {
+      recognizer.DecodeStream(stream);
+    }
+
+    two_pass.CheckEndpoint(s.get());
+  }
+
+  stream->InputFinished();
+  while (recognizer.IsReady(stream)) {
+    recognizer.DecodeStream(stream);
+  }
+  two_pass.FinishUtterance(s.get());
+
+  two_pass.WaitIdle();
+
+  fprintf(stderr, "Rescored: %lld, skipped: %lld\n",
+          static_cast<long long>(two_pass.NumRescored()),  // NOLINT
+          static_cast<long long>(two_pass.NumSkipped()));  // NOLINT
+
+  return 0;
+}
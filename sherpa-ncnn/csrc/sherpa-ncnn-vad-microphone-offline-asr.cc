@@ -9,13 +9,12 @@
 #include <algorithm>
 #include <chrono>  // NOLINT
 #include <iomanip>
-#include <mutex>  // NOLINT
 #include <sstream>
 #include <string>
 #include <vector>
 
 #include "portaudio.h"  // NOLINT
-#include "sherpa-ncnn/csrc/circular-buffer.h"
+#include "sherpa-ncnn/csrc/audio-capture-queue.h"
 #include "sherpa-ncnn/csrc/microphone.h"
 #include "sherpa-ncnn/csrc/offline-recognizer.h"
 #include "sherpa-ncnn/csrc/resample.h"
@@ -23,8 +22,7 @@
 #include "sherpa-ncnn/csrc/wave-writer.h"
 
 bool stop = false;
-std::mutex mutex;
-sherpa_ncnn::CircularBuffer buffer(16000 * 60);
+sherpa_ncnn::AudioCaptureQueue queue(16000 * 60);
 
 static int32_t RecordCallback(const void *input_buffer,
                               void * /*output_buffer*/,
@@ -32,8 +30,7 @@ static int32_t RecordCallback(const void *input_buffer,
                               const PaStreamCallbackTimeInfo * /*time_info*/,
                               PaStreamCallbackFlags /*status_flags*/,
                               void * /*user_data*/) {
-  std::lock_guard<std::mutex> lock(mutex);
-  buffer.Push(reinterpret_cast<const float *>(input_buffer), frames_per_buffer);
+  queue.Push(reinterpret_cast<const float *>(input_buffer), frames_per_buffer);
 
   return stop ? paComplete : paContinue;
 }
@@ -174,22 +171,22 @@ tar xvf sherpa-ncnn-sense-voice-zh-en-ja-ko-yue-2024-07-17.tar.bz2
   int32_t window_size = vad_config.window_size;
   int32_t index = 0;
 
+  std::vector<float> samples(window_size);
   while (!stop) {
-    {
-      std::lock_guard<std::mutex> lock(mutex);
+    // Wake up as soon as a window of samples is available
+    queue.Wait(window_size, 100);
 
-      while (buffer.Size() >= window_size) {
-        std::vector<float> samples = buffer.Get(buffer.Head(), window_size);
-        buffer.Pop(window_size);
+    while (queue.Size() >= window_size) {
+      samples.resize(window_size);
+      queue.Pop(samples.data(), window_size);
 
-        if (resampler) {
-          std::vector<float> tmp;
-          resampler->Resample(samples.data(), samples.size(), true, &tmp);
-          samples = std::move(tmp);
-        }
-
-        vad->AcceptWaveform(samples.data(), samples.size());
+      if (resampler) {
+        std::vector<float> tmp;
+        resampler->Resample(samples.data(), samples.size(), true, &tmp);
+        samples = std::move(tmp);
       }
+
+      vad->AcceptWaveform(samples.data(), samples.size());
     }
 
     while (!vad->Empty()) {
@@ -210,8 +207,6 @@ tar xvf sherpa-ncnn-sense-voice-zh-en-ja-ko-yue-2024-07-17.tar.bz2
       }
       vad->Pop();
     }
-
-    Pa_Sleep(100);  // sleep for 100ms
   }
 
   return 0;
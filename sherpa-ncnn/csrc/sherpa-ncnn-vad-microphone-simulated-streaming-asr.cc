@@ -7,25 +7,19 @@
 #include <stdlib.h>
 
 #include <algorithm>
-#include <chrono>              // NOLINT
-#include <condition_variable>  // NOLINT
-#include <mutex>               // NOLINT
-#include <queue>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "portaudio.h"  // NOLINT
-#include "sherpa-ncnn/csrc/circular-buffer.h"
+#include "sherpa-ncnn/csrc/audio-capture-queue.h"
 #include "sherpa-ncnn/csrc/microphone.h"
 #include "sherpa-ncnn/csrc/offline-recognizer.h"
 #include "sherpa-ncnn/csrc/resample.h"
 #include "sherpa-ncnn/csrc/sherpa-display.h"
-#include "sherpa-ncnn/csrc/voice-activity-detector.h"
-#include "sherpa-ncnn/csrc/wave-writer.h"
+#include "sherpa-ncnn/csrc/simulated-streaming-asr.h"
 
-std::queue<std::vector<float>> samples_queue;
-std::condition_variable condition_variable;
-std::mutex mutex;
+sherpa_ncnn::AudioCaptureQueue queue(16000 * 60);
 bool stop = false;
 
 static int32_t RecordCallback(const void *input_buffer,
@@ -34,18 +28,13 @@ static int32_t RecordCallback(const void *input_buffer,
                               const PaStreamCallbackTimeInfo * /*time_info*/,
                               PaStreamCallbackFlags /*status_flags*/,
                               void * /*user_data*/) {
-  std::lock_guard<std::mutex> lock(mutex);
-  samples_queue.emplace(
-      reinterpret_cast<const float *>(input_buffer),
-      reinterpret_cast<const float *>(input_buffer) + frames_per_buffer);
-  condition_variable.notify_one();
+  queue.Push(reinterpret_cast<const float *>(input_buffer), frames_per_buffer);
 
   return stop ? paComplete : paContinue;
 }
 
 static void Handler(int32_t /*sig*/) {
   stop = true;
-  condition_variable.notify_one();
   fprintf(stdout, "\nCaught Ctrl + C. Exiting...\n");
 }
 
@@ -78,10 +67,23 @@ tar xvf sherpa-ncnn-sense-voice-zh-en-ja-ko-yue-2024-07-17.tar.bz2
   sherpa_ncnn::SileroVadModelConfig vad_config;
 
   sherpa_ncnn::OfflineRecognizerConfig asr_config;
+  sherpa_ncnn::SimulatedStreamingAsrConfig streaming_config;
 
   vad_config.Register(&po);
   asr_config.Register(&po);
 
+  po.Register("decode-interval", &streaming_config.decode_interval,
+              "Decode the current speech segment again after this many "
+              "seconds of new speech");
+
+  po.Register("max-window-duration", &streaming_config.max_window_duration,
+              "A decode covers at most about this many seconds. Older text "
+              "of a long segment is committed and not decoded again");
+
+  po.Register("min-right-context", &streaming_config.min_right_context,
+              "Text is committed only if it has at least this many seconds "
+              "of audio after it");
+
   int32_t user_device_index = -1;  // -1 means to use default value
   int32_t user_sample_rate = -1;   // -1 means to use default value
 
@@ -118,6 +120,11 @@ tar xvf sherpa-ncnn-sense-voice-zh-en-ja-ko-yue-2024-07-17.tar.bz2
     return -1;
   }
 
+  if (!streaming_config.Validate()) {
+    fprintf(stdout, "Errors in streaming_config!\n");
+    return -1;
+  }
+
   fprintf(stdout, "Creating recognizer ...\n");
   sherpa_ncnn::OfflineRecognizer recognizer(asr_config);
   fprintf(stdout, "Recognizer created!\n");
@@ -162,86 +169,45 @@ tar xvf sherpa-ncnn-sense-voice-zh-en-ja-ko-yue-2024-07-17.tar.bz2
         mic_sample_rate, sample_rate, lowpass_cutoff, lowpass_filter_width);
   }
 
-  auto vad = std::make_unique<sherpa_ncnn::VoiceActivityDetector>(vad_config);
-
-  int32_t window_size = vad_config.window_size;
-
-  int32_t offset = 0;
-  bool speech_started = false;
-  std::vector<float> buffer;
-
-  auto started_time = std::chrono::steady_clock::now();
+  sherpa_ncnn::SimulatedStreamingAsr asr(&recognizer, vad_config,
+                                         streaming_config);
   sherpa_ncnn::SherpaDisplay display;
+  std::string last_text;
 
   fprintf(stdout, "Started. Please speak\n");
   std::vector<float> resampled;
 
+  std::vector<float> samples;
   while (!stop) {
-    {
-      std::unique_lock<std::mutex> lock(mutex);
-      while (samples_queue.empty() && !stop) {
-        condition_variable.wait(lock);
-      }
-
-      if (stop) {
-        break;
-      }
-
-      const auto &s = samples_queue.front();
-      if (!resampler) {
-        buffer.insert(buffer.end(), s.begin(), s.end());
-      } else {
-        resampler->Resample(s.data(), s.size(), false, &resampled);
-        buffer.insert(buffer.end(), resampled.begin(), resampled.end());
-      }
-
-      samples_queue.pop();
+    if (!queue.Wait(1, 100)) {
+      continue;
     }
 
-    for (; offset + window_size < buffer.size(); offset += window_size) {
-      vad->AcceptWaveform(buffer.data() + offset, window_size);
-      if (!speech_started && vad->IsSpeechDetected()) {
-        speech_started = true;
-        started_time = std::chrono::steady_clock::now();
-      }
-    }
+    samples.resize(queue.Size());
+    samples.resize(queue.Pop(samples.data(), samples.size()));
 
-    if (!speech_started) {
-      if (buffer.size() > 10 * window_size) {
-        offset -= buffer.size() - 10 * window_size;
-        buffer = {buffer.end() - 10 * window_size, buffer.end()};
-      }
+    if (resampler) {
+      resampler->Resample(samples.data(), samples.size(), false, &resampled);
+      samples.swap(resampled);
     }
 
-    auto current_time = std::chrono::steady_clock::now();
-    const float elapsed_seconds =
-        std::chrono::duration_cast<std::chrono::milliseconds>(current_time -
-                                                              started_time)
-            .count() /
-        1000.;
-
-    if (speech_started && elapsed_seconds > 0.2) {
-      auto s = recognizer.CreateStream();
-      s->AcceptWaveform(sample_rate, buffer.data(), buffer.size());
-      recognizer.DecodeStream(s.get());
-      const auto &result = s->GetResult();
-      display.UpdateText(result.text);
-      display.Display();
+    asr.AcceptWaveform(samples.data(), samples.size());
 
-      started_time = std::chrono::steady_clock::now();
-    }
-
-    while (!vad->Empty()) {
+    while (!asr.Empty()) {
       // when stopping speak, this while loop is executed
-
-      vad->Pop();
-
+      display.UpdateText(asr.Front().text);
       display.FinalizeCurrentSentence();
       display.Display();
 
-      buffer.clear();
-      offset = 0;
-      speech_started = false;
+      asr.Pop();
+      last_text.clear();
+    }
+
+    const auto &text = asr.GetPartialResult().text;
+    if (text != last_text) {
+      display.UpdateText(text);
+      display.Display();
+      last_text = text;
     }
   }
 
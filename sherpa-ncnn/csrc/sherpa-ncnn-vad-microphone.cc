@@ -7,18 +7,17 @@
 #include <stdlib.h>
 
 #include <algorithm>
-#include <mutex>  // NOLINT
+#include <vector>
 
 #include "portaudio.h"  // NOLINT
-#include "sherpa-ncnn/csrc/circular-buffer.h"
+#include "sherpa-ncnn/csrc/audio-capture-queue.h"
 #include "sherpa-ncnn/csrc/microphone.h"
 #include "sherpa-ncnn/csrc/resample.h"
 #include "sherpa-ncnn/csrc/voice-activity-detector.h"
 #include "sherpa-ncnn/csrc/wave-writer.h"
 
 bool stop = false;
-std::mutex mutex;
-sherpa_ncnn::CircularBuffer buffer(16000 * 60);
+sherpa_ncnn::AudioCaptureQueue queue(16000 * 60);
 
 static int32_t RecordCallback(const void *input_buffer,
                               void * /*output_buffer*/,
@@ -26,8 +25,7 @@ static int32_t RecordCallback(const void *input_buffer,
                               const PaStreamCallbackTimeInfo * /*time_info*/,
                               PaStreamCallbackFlags /*status_flags*/,
                               void * /*user_data*/) {
-  std::lock_guard<std::mutex> lock(mutex);
-  buffer.Push(reinterpret_cast<const float *>(input_buffer), frames_per_buffer);
+  queue.Push(reinterpret_cast<const float *>(input_buffer), frames_per_buffer);
 
   return stop ? paComplete : paContinue;
 }
@@ -154,48 +152,47 @@ cd $HOME/open-source/sherpa-ncnn/build
   bool printed = false;
 
   int32_t k = 0;
+  std::vector<float> samples(window_size);
   while (!stop) {
-    {
-      std::lock_guard<std::mutex> lock(mutex);
-
-      while (buffer.Size() >= window_size) {
-        std::vector<float> samples = buffer.Get(buffer.Head(), window_size);
-        buffer.Pop(window_size);
-
-        if (resampler) {
-          std::vector<float> tmp;
-          resampler->Resample(samples.data(), samples.size(), true, &tmp);
-          samples = std::move(tmp);
-        }
-
-        vad->AcceptWaveform(samples.data(), samples.size());
-
-        if (vad->IsSpeechDetected() && !printed) {
-          printed = true;
-          fprintf(stdout, "\nDetected speech!\n");
-        }
-        if (!vad->IsSpeechDetected()) {
-          printed = false;
-        }
-
-        while (!vad->Empty()) {
-          const auto &segment = vad->Front();
-          float duration = segment.samples.size() / sample_rate;
-          fprintf(stdout, "Duration: %.3f seconds\n", duration);
-
-          char filename[128];
-          snprintf(filename, sizeof(filename), "seg-%d-%.3fs.wav", k, duration);
-          k += 1;
-          sherpa_ncnn::WriteWave(filename, sample_rate, segment.samples.data(),
-                                 segment.samples.size());
-          fprintf(stdout, "Saved to %s\n", filename);
-          fprintf(stdout, "----------\n");
-
-          vad->Pop();
-        }
+    // Wake up as soon as a window of samples is available
+    queue.Wait(window_size, 100);
+
+    while (queue.Size() >= window_size) {
+      samples.resize(window_size);
+      queue.Pop(samples.data(), window_size);
+
+      if (resampler) {
+        std::vector<float> tmp;
+        resampler->Resample(samples.data(), samples.size(), true, &tmp);
+        samples = std::move(tmp);
+      }
+
+      vad->AcceptWaveform(samples.data(), samples.size());
+
+      if (vad->IsSpeechDetected() && !printed) {
+        printed = true;
+        fprintf(stdout, "\nDetected speech!\n");
+      }
+      if (!vad->IsSpeechDetected()) {
+        printed = false;
+      }
+
+      while (!vad->Empty()) {
+        const auto &segment = vad->Front();
+        float duration = segment.samples.size() / sample_rate;
+        fprintf(stdout, "Duration: %.3f seconds\n", duration);
+
+        char filename[128];
+        snprintf(filename, sizeof(filename), "seg-%d-%.3fs.wav", k, duration);
+        k += 1;
+        sherpa_ncnn::WriteWave(filename, sample_rate, segment.samples.data(),
+                               segment.samples.size());
+        fprintf(stdout, "Saved to %s\n", filename);
+        fprintf(stdout, "----------\n");
+
+        vad->Pop();
       }
     }
-    Pa_Sleep(100);  // sleep for 100ms
   }
 
   return 0;
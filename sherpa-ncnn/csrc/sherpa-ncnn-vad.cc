@@ -97,17 +97,8 @@ cd $HOME/open-source/sherpa-ncnn/build
 
   std::vector<sherpa_ncnn::SpeechSegment> segments;
 
-  for (int32_t i = 0; i < samples.size(); i += config.window_size) {
-    vad.AcceptWaveform(samples.data() + i, config.window_size);
-    while (!vad.Empty()) {
-      const auto &front = vad.Front();
-      segments.push_back(front);
-
-      vad.Pop();
-    }
-  }
-
-  vad.Flush();
+  // It also flushes the end of the file
+  vad.AcceptFile(samples.data(), num_samples);
   while (!vad.Empty()) {
     const auto &front = vad.Front();
     segments.push_back(front);
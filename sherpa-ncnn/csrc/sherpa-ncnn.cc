@@ -91,30 +91,34 @@ for a list of pre-trained models to download.
 
   std::string wav_filename = argv[8];
 
-  bool is_ok = false;
-  std::vector<float> samples =
-      sherpa_ncnn::ReadWave(wav_filename, expected_sampling_rate, &is_ok);
-  if (!is_ok) {
+  // The file is decoded block by block as it is read, so neither the
+  // memory nor the time to the first result grows with its length
+  auto reader = sherpa_ncnn::WaveFileReader::Open(wav_filename);
+  if (!reader || reader->SampleRate() != expected_sampling_rate) {
     fprintf(stderr, "Failed to read %s\n", wav_filename.c_str());
     exit(-1);
   }
 
-  const float duration = samples.size() / expected_sampling_rate;
+  const float duration = reader->Duration();
   std::cout << "wav filename: " << wav_filename << "\n";
   std::cout << "wav duration (s): " << duration << "\n";
 
   auto begin = std::chrono::steady_clock::now();
   std::cout << "Started!\n";
   auto stream = recognizer.CreateStream();
-  stream->AcceptWaveform(expected_sampling_rate, samples.data(),
-                         samples.size());
-  std::vector<float> tail_paddings(
-      static_cast<int>(0.3 * expected_sampling_rate));
-  stream->AcceptWaveform(expected_sampling_rate, tail_paddings.data(),
-                         tail_paddings.size());
-  while (recognizer.IsReady(stream.get())) {
-    recognizer.DecodeStream(stream.get());
+
+  std::vector<float> block(static_cast<int>(0.2 * expected_sampling_rate));
+  int32_t n = 0;
+  while ((n = reader->Read(block.data(), block.size())) > 0) {
+    stream->AcceptWaveform(expected_sampling_rate, block.data(), n);
+    while (recognizer.IsReady(stream.get())) {
+      recognizer.DecodeStream(stream.get());
+    }
   }
+
+  // No tail padding is needed to flush the last frames
+  stream->InputFinished();
+  recognizer.DecodeRemainingFrames(stream.get());
   stream->Finalize();
   auto result = recognizer.GetResult(stream.get());
   std::cout << "Done!\n";
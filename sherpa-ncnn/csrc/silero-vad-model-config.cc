@@ -34,10 +34,48 @@ void SileroVadModelConfig::Register(ParseOptions *po) {
   po->Register("silero-vad-threshold", &threshold, "VAD Threshold");
   po->Register("silero-vad-num-threads", &num_threads,
                "Number of threads to run the model");
+  po->Register("silero-vad-use-mmap", &use_mmap,
+               "true to memory-map silero.ncnn.bin instead of reading it "
+               "into memory");
+
+  po->Register("silero-vad-energy-gate-db", &energy_gate_db,
+               "If negative, windows with a lower energy in dBFS are "
+               "treated as silence without running the model, e.g., -60. "
+               "0 to disable it");
+
+  po->Register("silero-vad-energy-gate-max-zcr", &energy_gate_max_zcr,
+               "Windows below --silero-vad-energy-gate-db with a higher "
+               "zero-crossing rate are still run through the model");
+
+  po->Register("silero-vad-max-segment-duration", &max_segment_duration,
+               "If positive, speech longer than this many seconds is cut "
+               "into segments without waiting for a pause. 0 to disable it");
+
+  po->Register("silero-vad-max-segment-search", &max_segment_search,
+               "A segment longer than --silero-vad-max-segment-duration is "
+               "cut at the least speech-like window within this many "
+               "seconds before the limit");
+
+  po->Register("silero-vad-file-warm-up", &file_warm_up,
+               "When a whole file is processed in parallel parts, each part "
+               "starts this many seconds earlier to warm up the states of "
+               "the model");
+
+  po->Register("silero-vad-use-pool-allocator", &use_pool_allocator,
+               "true to allocate the intermediate blobs of the model from "
+               "memory pools that are reused from run to run");
+
+  po->Register("silero-vad-pool-per-thread", &pool_per_thread,
+               "true to give each thread its own memory pools, which need "
+               "no lock");
+
+  po->Register("silero-vad-pool-limit-mb", &pool_limit_mb,
+               "If positive, each memory pool keeps freed memory only while "
+               "it holds at most this many MB");
 }
 
 bool SileroVadModelConfig::Validate() const {
-  if (model_dir.empty()) {
+  if (model_dir.empty() && !buffers) {
     SHERPA_NCNN_LOGE("Please provide --silero-vad-model-dir");
     return false;
   }
@@ -49,6 +87,14 @@ bool SileroVadModelConfig::Validate() const {
 
   bool ok = true;
   for (const auto &f : files_to_check) {
+    if (buffers) {
+      if (!buffers->HasSection(f)) {
+        SHERPA_NCNN_LOGE("There is no '%s' in the buffers", f.c_str());
+        ok = false;
+      }
+      continue;
+    }
+
     auto name = model_dir + "/" + f;
     if (!FileExists(name)) {
       SHERPA_NCNN_LOGE("'%s' does not exist inside the directory '%s'",
@@ -73,6 +119,34 @@ bool SileroVadModelConfig::Validate() const {
     return false;
   }
 
+  if (energy_gate_db > 0) {
+    SHERPA_NCNN_LOGE("energy_gate_db must not be positive. Given: %f",
+                     energy_gate_db);
+    return false;
+  }
+
+  if (max_segment_duration < 0) {
+    SHERPA_NCNN_LOGE("max_segment_duration must not be negative. Given: %f",
+                     max_segment_duration);
+    return false;
+  }
+
+  if (max_segment_duration > 0 &&
+      (max_segment_search <= 0 ||
+       max_segment_search >= max_segment_duration)) {
+    SHERPA_NCNN_LOGE(
+        "max_segment_search should be in (0, max_segment_duration). "
+        "Given: %f, max_segment_duration: %f",
+        max_segment_search, max_segment_duration);
+    return false;
+  }
+
+  if (file_warm_up < 0) {
+    SHERPA_NCNN_LOGE("file_warm_up must not be negative. Given: %f",
+                     file_warm_up);
+    return false;
+  }
+
   if (num_threads < 1) {
     SHERPA_NCNN_LOGE("Please use a larger num_threads. Current: %d",
                      num_threads);
@@ -87,14 +161,25 @@ std::string SileroVadModelConfig::ToString() const {
 
   os << "SileroVadModelConfig(";
   os << "model_dir=\"" << model_dir << "\", ";
+  os << "buffers=" << (buffers ? "True" : "False") << ", ";
   os << "threshold=" << threshold << ", ";
   os << "min_silence_duration=" << min_silence_duration << ", ";
   os << "min_speech_duration=" << min_speech_duration << ", ";
+  os << "energy_gate_db=" << energy_gate_db << ", ";
+  os << "energy_gate_max_zcr=" << energy_gate_max_zcr << ", ";
+  os << "max_segment_duration=" << max_segment_duration << ", ";
+  os << "max_segment_search=" << max_segment_search << ", ";
+  os << "file_warm_up=" << file_warm_up << ", ";
   os << "window_size=" << window_size << ", ";
   os << "sample_rate=" << sample_rate << ", ";
   os << "use_vulkan_compute=" << (use_vulkan_compute ? "True" : "False")
      << ", ";
-  os << "num_threads=" << num_threads << ")";
+  os << "num_threads=" << num_threads << ", ";
+  os << "use_pool_allocator=" << (use_pool_allocator ? "True" : "False")
+     << ", ";
+  os << "pool_per_thread=" << (pool_per_thread ? "True" : "False") << ", ";
+  os << "pool_limit_mb=" << pool_limit_mb << ", ";
+  os << "use_mmap=" << (use_mmap ? "True" : "False") << ")";
 
   return os.str();
 }
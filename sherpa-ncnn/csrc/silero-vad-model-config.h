@@ -22,6 +22,7 @@
 #include <memory>
 #include <string>
 
+#include "sherpa-ncnn/csrc/model-bundle.h"
 #include "sherpa-ncnn/csrc/parse-options.h"
 
 namespace sherpa_ncnn {
@@ -30,6 +31,11 @@ struct SileroVadModelConfig {
   // It should contain silero.ncnn.param and silero.ncnn.bin
   std::string model_dir;
 
+  // If not null, the model is loaded from its sections silero.ncnn.param
+  // and silero.ncnn.bin in memory instead of from model_dir, see
+  // ModelBundle::FromBuffers(). They must outlive the model.
+  std::shared_ptr<const ModelBundle> buffers;
+
   // threshold to classify a segment as speech
   //
   // If the predicted probability of a segment is larger than this
@@ -40,6 +46,35 @@ struct SileroVadModelConfig {
 
   float min_speech_duration = 0.25;  // in seconds
 
+  // If negative, windows whose energy is below it in dB relative to full
+  // scale are treated as silence without running the model, e.g., -60 to
+  // skip digital silence and very quiet line noise. The state machine
+  // still sees them, with a speech probability of 0, so that
+  // min_silence_duration keeps its meaning. 0 disables it.
+  float energy_gate_db = 0;
+
+  // Windows below energy_gate_db whose zero-crossing rate, i.e., the
+  // fraction of adjacent samples with different signs, is above it are
+  // still run through the model, since unvoiced speech such as "s" is
+  // quiet but crosses zero often. 1 disables this check.
+  float energy_gate_max_zcr = 0.3;
+
+  // If positive, a segment of continuous speech longer than it, in
+  // seconds, is cut without waiting for a pause, so that the memory kept
+  // for it and the latency of recognizing it stay bounded. The cut is
+  // placed at the window with the lowest speech probability in the last
+  // max_segment_search seconds before the limit, and the rest of the
+  // speech starts a new segment. 0 disables it.
+  float max_segment_duration = 0;
+
+  float max_segment_search = 2;  // in seconds
+
+  // Used only by VoiceActivityDetector::AcceptFile(). Each part of the file
+  // that runs in parallel starts this many seconds earlier from reset
+  // states, so that the states have adapted to the audio by the start of
+  // the part.
+  float file_warm_up = 1;
+
   // 512, 1024, 1536 samples for 16000 Hz
   // 256, 512, 768 samples for 800 Hz
   int32_t window_size = 512;  // in samples
@@ -49,6 +84,21 @@ struct SileroVadModelConfig {
   bool use_vulkan_compute = true;
   int32_t num_threads = 1;
 
+  // If true, silero.ncnn.bin is memory-mapped instead of read into memory
+  bool use_mmap = false;
+
+  // If true, intermediate blobs and workspace of the model are allocated
+  // from memory pools owned by the model, so that no heap allocation
+  // happens once the pools are warmed up. See ModelMemoryPools.
+  bool use_pool_allocator = true;
+
+  // If true, each thread has its own pools, which need no lock
+  bool pool_per_thread = false;
+
+  // If positive, each pool keeps freed memory only while it holds at most
+  // this many MB
+  int32_t pool_limit_mb = 0;
+
   void Register(ParseOptions *po);
   bool Validate() const;
 
@@ -18,18 +18,206 @@
 
 #include "sherpa-ncnn/csrc/silero-vad-model.h"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <functional>
+#include <memory>
+#include <mutex>  // NOLINT
 #include <string>
+#include <thread>  // NOLINT
 #include <vector>
 
 #include "net.h"  // NOLINT
+#include "sherpa-ncnn/csrc/memory-pool.h"
 #include "sherpa-ncnn/csrc/model.h"
 #include "sherpa-ncnn/csrc/silero-vad-model-config.h"
+#include "sherpa-ncnn/csrc/trace.h"
 
 namespace sherpa_ncnn {
 
+namespace {
+
+// Threads that are started once and run a function together with the
+// calling thread for each call of Run(), since a batch of windows takes
+// far less time than starting threads
+class Workers {
+ public:
+  explicit Workers(int32_t num_threads) {
+    threads_.reserve(num_threads);
+    for (int32_t i = 0; i != num_threads; ++i) {
+      threads_.emplace_back([this]() { Loop(); });
+    }
+  }
+
+  ~Workers() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+
+    for (auto &t : threads_) {
+      t.join();
+    }
+  }
+
+  // Run f on each worker and on the calling thread, and wait for all of
+  // them to return
+  void Run(const std::function<void()> &f) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      f_ = &f;
+      num_running_ = static_cast<int32_t>(threads_.size());
+      ++generation_;
+    }
+    cv_.notify_all();
+
+    f();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this]() { return num_running_ == 0; });
+    f_ = nullptr;
+  }
+
+ private:
+  void Loop() {
+    int64_t generation = 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      cv_.wait(lock,
+               [&]() { return stop_ || generation_ != generation; });
+      if (stop_) break;
+
+      generation = generation_;
+      const std::function<void()> *f = f_;
+
+      lock.unlock();
+      (*f)();
+      lock.lock();
+
+      if (--num_running_ == 0) {
+        done_cv_.notify_one();
+      }
+    }
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::condition_variable done_cv_;
+
+  const std::function<void()> *f_ = nullptr;
+  int64_t generation_ = 0;
+  int32_t num_running_ = 0;
+  bool stop_ = false;
+
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace
+
+SileroVadStream::SileroVadStream(const SileroVadModelConfig &config)
+    : h_(64, 1, 2),
+      c_(64, 1, 2),
+      threshold_(config.threshold),
+      sample_rate_(config.sample_rate),
+      window_size_(config.window_size) {
+  min_silence_samples_ = config.sample_rate * config.min_silence_duration;
+
+  min_speech_samples_ = config.sample_rate * config.min_speech_duration;
+
+  h_.fill(0);
+  c_.fill(0);
+}
+
+void SileroVadStream::Reset() {
+  ResetStates();
+
+  triggered_ = false;
+  current_sample_ = 0;
+  temp_start_ = 0;
+  temp_end_ = 0;
+}
+
+void SileroVadStream::ResetStates() {
+  h_.fill(0);
+  c_.fill(0);
+}
+
+bool SileroVadStream::IsSpeech(float prob) {
+  float threshold = threshold_;
+
+  current_sample_ += window_size_;
+
+  if (prob > threshold && temp_end_ != 0) {
+    temp_end_ = 0;
+  }
+
+  if (prob > threshold && temp_start_ == 0) {
+    // start speaking, but we require that it must satisfy
+    // min_speech_duration
+    temp_start_ = current_sample_;
+    return false;
+  }
+
+  if (prob > threshold && temp_start_ != 0 && !triggered_) {
+    if (current_sample_ - temp_start_ < min_speech_samples_) {
+      return false;
+    }
+
+    triggered_ = true;
+
+    return true;
+  }
+
+  if ((prob < threshold) && !triggered_) {
+    // silence
+    temp_start_ = 0;
+    temp_end_ = 0;
+    return false;
+  }
+
+  if ((prob > threshold - 0.15) && triggered_) {
+    // speaking
+    return true;
+  }
+
+  if ((prob > threshold) && !triggered_) {
+    // start speaking
+    triggered_ = true;
+
+    return true;
+  }
+
+  if ((prob < threshold) && triggered_) {
+    // stop to speak
+    if (temp_end_ == 0) {
+      temp_end_ = current_sample_;
+    }
+
+    if (current_sample_ - temp_end_ < min_silence_samples_) {
+      // continue speaking
+      return true;
+    }
+    // stopped speaking
+    temp_start_ = 0;
+    temp_end_ = 0;
+    triggered_ = false;
+    return false;
+  }
+
+  return false;
+}
+
+void SileroVadStream::SetMinSilenceDuration(float s) {
+  min_silence_samples_ = sample_rate_ * s;
+}
+
 class SileroVadModel::Impl {
  public:
   explicit Impl(const SileroVadModelConfig &config) : config_(config) {
+    InitMemoryPools();
     model_.opt.num_threads = config.num_threads;
     bool has_gpu = false;
 
@@ -42,16 +230,23 @@ class SileroVadModel::Impl {
       NCNN_LOGE("Use GPU");
     }
 
+    if (config_.buffers) {
+      InitNetFromBuffers();
+      return;
+    }
+
     std::string param = config_.model_dir + "/silero.ncnn.param";
     std::string bin = config_.model_dir + "/silero.ncnn.bin";
 
-    Model::InitNet(model_, param, bin);
+    Model::InitNet(model_, param, bin,
+                   config_.use_mmap ? &mapped_bin_ : nullptr);
     PostInit();
   }
 
 #if __ANDROID_API__ >= 9
   Impl(AAssetManager *mgr, const SileroVadModelConfig &config)
       : config_(config) {
+    InitMemoryPools();
     model_.opt.num_threads = config.num_threads;
     bool has_gpu = false;
 
@@ -64,6 +259,11 @@ class SileroVadModel::Impl {
       NCNN_LOGE("Use GPU");
     }
 
+    if (config_.buffers) {
+      InitNetFromBuffers();
+      return;
+    }
+
     std::string param = config_.model_dir + "/silero.ncnn.param";
     std::string bin = config_.model_dir + "/silero.ncnn.bin";
 
@@ -73,107 +273,76 @@ class SileroVadModel::Impl {
   }
 #endif
 
-  void Reset() {
-    ResetV4();
+  // config_ keeps the buffers alive
+  void InitNetFromBuffers() {
+    if (!config_.buffers->LoadNet("silero.ncnn.param", "silero.ncnn.bin",
+                                  &model_)) {
+      NCNN_LOGE("Failed to load the silero VAD model from the buffers");
+      exit(-1);
+    }
 
-    triggered_ = false;
-    current_sample_ = 0;
-    temp_start_ = 0;
-    temp_end_ = 0;
+    PostInit();
   }
 
-  bool IsSpeech(const float *samples, int32_t n) {
+  float Compute(const float *samples, int32_t n, SileroVadStream *s,
+                int32_t num_threads) const {
     if (n != WindowSize()) {
       NCNN_LOGE("n: %d != window_size: %d", n, WindowSize());
       exit(-1);
     }
 
-    float prob = Run(samples, n);
+    TraceSpan span("vad_window");
+    return Run(samples, n, s, num_threads);
+  }
 
-    float threshold = config_.threshold;
+  void Compute(SileroVadStream **ss, const float *const *samples, int32_t n,
+               float *probs) const {
+    if (n == 0) return;
 
-    current_sample_ += config_.window_size;
+    int32_t num_threads = std::max(config_.num_threads, 1);
+    int32_t num_workers = std::min(n, num_threads);
 
-    if (prob > threshold && temp_end_ != 0) {
-      temp_end_ = 0;
-    }
+    // The threads of ncnn are shared among the workers
+    int32_t threads_per_worker = std::max(num_threads / num_workers, 1);
 
-    if (prob > threshold && temp_start_ == 0) {
-      // start speaking, but we require that it must satisfy
-      // min_speech_duration
-      temp_start_ = current_sample_;
-      return false;
-    }
-
-    if (prob > threshold && temp_start_ != 0 && !triggered_) {
-      if (current_sample_ - temp_start_ < min_speech_samples_) {
-        return false;
+    std::atomic<int32_t> next{0};
+    std::function<void()> run = [&]() {
+      int32_t i;
+      while ((i = next++) < n) {
+        probs[i] =
+            Compute(samples[i], WindowSize(), ss[i], threads_per_worker);
       }
+    };
 
-      triggered_ = true;
-
-      return true;
-    }
-
-    if ((prob < threshold) && !triggered_) {
-      // silence
-      temp_start_ = 0;
-      temp_end_ = 0;
-      return false;
-    }
-
-    if ((prob > threshold - 0.15) && triggered_) {
-      // speaking
-      return true;
+    if (num_workers == 1) {
+      run();
+      return;
     }
 
-    if ((prob > threshold) && !triggered_) {
-      // start speaking
-      triggered_ = true;
-
-      return true;
-    }
-
-    if ((prob < threshold) && triggered_) {
-      // stop to speak
-      if (temp_end_ == 0) {
-        temp_end_ = current_sample_;
-      }
-
-      if (current_sample_ - temp_end_ < min_silence_samples_) {
-        // continue speaking
-        return true;
-      }
-      // stopped speaking
-      temp_start_ = 0;
-      temp_end_ = 0;
-      triggered_ = false;
-      return false;
+    // It is called for every window, so the threads are kept. Calls from
+    // several threads take turns.
+    std::lock_guard<std::mutex> lock(workers_mutex_);
+    if (!workers_) {
+      workers_ = std::make_unique<Workers>(num_threads - 1);
     }
-
-    return false;
+    workers_->Run(run);
   }
 
   int32_t WindowShift() const { return config_.window_size; }
 
   int32_t WindowSize() const { return config_.window_size; }
 
-  int32_t MinSilenceDurationSamples() const { return min_silence_samples_; }
-
-  int32_t MinSpeechDurationSamples() const { return min_speech_samples_; }
+  const SileroVadModelConfig &GetConfig() const { return config_; }
 
-  void SetMinSilenceDuration(float s) {
-    min_silence_samples_ = config_.sample_rate * s;
+ private:
+  void InitMemoryPools() {
+    if (config_.use_pool_allocator) {
+      memory_pools_ = std::make_unique<ModelMemoryPools>(
+          config_.pool_per_thread, config_.pool_limit_mb);
+    }
   }
 
-  void SetThreshold(float threshold) { config_.threshold = threshold; }
-
- private:
   void PostInit() {
-    min_silence_samples_ = config_.sample_rate * config_.min_silence_duration;
-
-    min_speech_samples_ = config_.sample_rate * config_.min_speech_duration;
-
     // input indexes map
     // [0] -> in0, x
     // [1] -> in1, h
@@ -196,59 +365,66 @@ class SileroVadModel::Impl {
       if (b.name == "out1") output_indexes_[1] = i;
       if (b.name == "out2") output_indexes_[2] = i;
     }
-
-    h_ = ncnn::Mat(64, 1, 2);
-    c_ = ncnn::Mat(64, 1, 2);
-
-    h_.fill(0);
-    c_.fill(0);
-  }
-
-  void ResetV4() {
-    h_.fill(0);
-    c_.fill(0);
   }
 
-  float Run(const float *samples, int32_t n) {
+  float Run(const float *samples, int32_t n, SileroVadStream *s,
+            int32_t num_threads) const {
     // TODO(fangjun): Support V5
-    return RunV4(samples, n);
+    return RunV4(samples, n, s, num_threads);
   }
 
-  float RunV4(const float *samples, int32_t n) {
+  float RunV4(const float *samples, int32_t n, SileroVadStream *s,
+              int32_t num_threads) const {
     ncnn::Mat x(n, 1, 1, const_cast<float *>(samples));
 
-    ncnn::Extractor ex = model_.create_extractor();
+    ncnn::Mat out;
+    ncnn::Mat h;
+    ncnn::Mat c;
+    {
+      ncnn::Extractor ex = model_.create_extractor();
+      ex.set_num_threads(num_threads);
+      if (memory_pools_) {
+        memory_pools_->Attach(&ex);
+      }
 
-    ex.input(input_indexes_[0], x);
-    ex.input(input_indexes_[1], h_);
-    ex.input(input_indexes_[2], c_);
+      ex.input(input_indexes_[0], x);
+      ex.input(input_indexes_[1], s->H());
+      ex.input(input_indexes_[2], s->C());
 
-    ncnn::Mat out;
-    ex.extract(output_indexes_[0], out);
-    ex.extract(output_indexes_[1], h_);
-    ex.extract(output_indexes_[2], c_);
+      ex.extract(output_indexes_[0], out);
+      ex.extract(output_indexes_[1], h);
+      ex.extract(output_indexes_[2], c);
+    }
+
+    if (memory_pools_) {
+      // The states are kept in the stream. Once ex is destroyed, the old
+      // ones are not shared and the new ones are copied into them.
+      memory_pools_->CopyTo(h, &s->H());
+      memory_pools_->CopyTo(c, &s->C());
+    } else {
+      s->H() = h;
+      s->C() = c;
+    }
 
     float prob = out[0];
     return prob;
   }
 
  private:
+  std::unique_ptr<MappedFile> mapped_bin_;  // model_ may refer to it
+
+  // Null if config_.use_pool_allocator is false
+  std::unique_ptr<ModelMemoryPools> memory_pools_;
+
+  // Started by the first Compute() of a batch of more than one window
+  mutable std::mutex workers_mutex_;
+  mutable std::unique_ptr<Workers> workers_;
+
   ncnn::Net model_;
   std::vector<int32_t> input_indexes_;
   std::vector<int32_t> output_indexes_;
 
-  ncnn::Mat h_;
-  ncnn::Mat c_;
-
   SileroVadModelConfig config_;
-
-  int32_t min_silence_samples_;
-  int32_t min_speech_samples_;
-
-  bool triggered_ = false;
-  int32_t current_sample_ = 0;
-  int32_t temp_start_ = 0;
-  int32_t temp_end_ = 0;
 };
 
 SileroVadModel::SileroVadModel(const SileroVadModelConfig &config)
@@ -262,30 +438,32 @@ SileroVadModel::SileroVadModel(AAssetManager *mgr,
 
 SileroVadModel::~SileroVadModel() = default;
 
-void SileroVadModel::Reset() { return impl_->Reset(); }
-
-bool SileroVadModel::IsSpeech(const float *samples, int32_t n) {
-  return impl_->IsSpeech(samples, n);
+std::unique_ptr<SileroVadStream> SileroVadModel::CreateStream() const {
+  return std::make_unique<SileroVadStream>(impl_->GetConfig());
 }
 
-int32_t SileroVadModel::WindowSize() const { return impl_->WindowSize(); }
-
-int32_t SileroVadModel::WindowShift() const { return impl_->WindowShift(); }
-
-int32_t SileroVadModel::MinSilenceDurationSamples() const {
-  return impl_->MinSilenceDurationSamples();
+float SileroVadModel::Compute(const float *samples, int32_t n,
+                              SileroVadStream *s) const {
+  return impl_->Compute(samples, n, s, impl_->GetConfig().num_threads);
 }
 
-int32_t SileroVadModel::MinSpeechDurationSamples() const {
-  return impl_->MinSpeechDurationSamples();
+float SileroVadModel::Compute(const float *samples, int32_t n,
+                              SileroVadStream *s, int32_t num_threads) const {
+  return impl_->Compute(samples, n, s, num_threads);
 }
 
-void SileroVadModel::SetMinSilenceDuration(float s) {
-  impl_->SetMinSilenceDuration(s);
+void SileroVadModel::Compute(SileroVadStream **ss,
+                             const float *const *samples, int32_t n,
+                             float *probs) const {
+  impl_->Compute(ss, samples, n, probs);
 }
 
-void SileroVadModel::SetThreshold(float threshold) {
-  impl_->SetThreshold(threshold);
+int32_t SileroVadModel::WindowSize() const { return impl_->WindowSize(); }
+
+int32_t SileroVadModel::WindowShift() const { return impl_->WindowShift(); }
+
+const SileroVadModelConfig &SileroVadModel::GetConfig() const {
+  return impl_->GetConfig();
 }
 
 }  // namespace sherpa_ncnn
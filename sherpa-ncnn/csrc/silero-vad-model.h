@@ -24,12 +24,74 @@
 #include "android/asset_manager_jni.h"
 #endif
 
+#include <cstdint>
 #include <memory>
 
+#include "mat.h"  // NOLINT
 #include "sherpa-ncnn/csrc/silero-vad-model-config.h"
 
 namespace sherpa_ncnn {
 
+/** The per-stream state of a SileroVadModel: the recurrent states of the
+ * network and the counters of the speech/silence state machine.
+ *
+ * It is small, about 1 KB, so creating one per stream is cheap while the
+ * weights are loaded once, see SileroVadModel::CreateStream().
+ */
+class SileroVadStream {
+ public:
+  explicit SileroVadStream(const SileroVadModelConfig &config);
+
+  // reset the recurrent states and the state machine
+  void Reset();
+
+  // Reset only the recurrent states, e.g., after windows that did not run
+  // the model, see SileroVadModelConfig::energy_gate_db
+  void ResetStates();
+
+  /**
+   * @param prob The speech probability of the next window, see
+   *             SileroVadModel::Compute().
+   *
+   * @return Return true if speech is detected. Return false otherwise.
+   */
+  bool IsSpeech(float prob);
+
+  int32_t MinSilenceDurationSamples() const { return min_silence_samples_; }
+  int32_t MinSpeechDurationSamples() const { return min_speech_samples_; }
+
+  void SetMinSilenceDuration(float s);
+  void SetThreshold(float threshold) { threshold_ = threshold; }
+
+  // The recurrent states, of shape (2, 1, 64) each. They are updated by
+  // SileroVadModel::Compute().
+  ncnn::Mat &H() { return h_; }
+  ncnn::Mat &C() { return c_; }
+
+ private:
+  ncnn::Mat h_;
+  ncnn::Mat c_;
+
+  float threshold_;
+  int32_t sample_rate_;
+  int32_t window_size_;
+
+  int32_t min_silence_samples_;
+  int32_t min_speech_samples_;
+
+  bool triggered_ = false;
+  int32_t current_sample_ = 0;
+  int32_t temp_start_ = 0;
+  int32_t temp_end_ = 0;
+};
+
+/** The network of silero VAD.
+ *
+ * It is read-only once loaded, so one model can be shared by any number of
+ * streams, e.g., one per call, and used from several threads at the same
+ * time. Everything that changes while processing audio is in
+ * SileroVadStream.
+ */
 class SileroVadModel {
  public:
   explicit SileroVadModel(const SileroVadModelConfig &config);
@@ -40,17 +102,41 @@ class SileroVadModel {
 
   ~SileroVadModel();
 
-  // reset the internal model states
-  void Reset();
+  // Return a new stream that uses the thresholds of the config of this
+  // model
+  std::unique_ptr<SileroVadStream> CreateStream() const;
 
-  /**
+  /** Run the model on one window of a stream and update its recurrent
+   * states.
+   *
    * @param samples Pointer to a 1-d array containing audio samples.
    *                Each sample should be normalized to the range [-1, 1].
-   * @param n Number of samples.
+   * @param n Number of samples. It must be WindowSize().
+   * @param s The stream the window belongs to.
    *
-   * @return Return true if speech is detected. Return false otherwise.
+   * @return Return the speech probability of the window.
+   */
+  float Compute(const float *samples, int32_t n, SileroVadStream *s) const;
+
+  // Same as above, but ncnn uses num_threads threads instead of those of
+  // the config, e.g., when several threads run the model at the same time
+  float Compute(const float *samples, int32_t n, SileroVadStream *s,
+                int32_t num_threads) const;
+
+  /** Run the model on one window of each of the given streams.
+   *
+   * The windows are processed by up to num_threads threads, see
+   * SileroVadModelConfig. The threads are started by the first call and
+   * kept until the model is destroyed.
+   *
+   * @param ss  Pointer to an array of n distinct streams.
+   * @param samples  samples[i] contains WindowSize() samples of ss[i].
+   * @param n  Number of streams.
+   * @param probs  On return, probs[i] is the speech probability of the
+   *               window of ss[i]. Its size is n.
    */
-  bool IsSpeech(const float *samples, int32_t n);
+  void Compute(SileroVadStream **ss, const float *const *samples, int32_t n,
+               float *probs) const;
 
   // For silero vad V4, it is WindowShift().
   // For silero vad V5, it is WindowShift()+64 for 16kHz and
@@ -60,11 +146,7 @@ class SileroVadModel {
   // 512
   int32_t WindowShift() const;
 
-  int32_t MinSilenceDurationSamples() const;
-  int32_t MinSpeechDurationSamples() const;
-
-  void SetMinSilenceDuration(float s);
-  void SetThreshold(float threshold);
+  const SileroVadModelConfig &GetConfig() const;
 
  private:
   class Impl;
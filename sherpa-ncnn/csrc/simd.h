@@ -0,0 +1,80 @@
+// sherpa-ncnn/csrc/simd.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_SIMD_H_
+#define SHERPA_NCNN_CSRC_SIMD_H_
+
+// Select the SIMD instruction set used by the hand-vectorized kernels.
+// At most one of the following macros is defined to 1:
+//
+//   SHERPA_NCNN_NEON       ARM NEON (armv7 with -mfpu=neon, aarch64)
+//   SHERPA_NCNN_WASM_SIMD  WebAssembly SIMD128
+//   SHERPA_NCNN_SSE2       x86 SSE2
+//   SHERPA_NCNN_RVV        RISC-V vector extension 1.0 (-march=rv64gcv)
+//                          with the v0.12 intrinsics, i.e., GCC >= 14 or
+//                          clang >= 17
+//
+// In addition, SHERPA_NCNN_AVX2 is defined to 1 together with
+// SHERPA_NCNN_SSE2 if AVX2 and FMA are enabled, e.g., with
+// -mavx2 -mfma or -march=native. Kernels use 8 lanes then and SSE2 for
+// the remainder.
+//
+// Kernels fall back to scalar code if none is defined.
+//
+// x86 builds without AVX2, e.g., Python wheels, can still use the AVX2
+// kernels if the compiler builds single functions for AVX2, i.e., with
+// GCC and clang. SHERPA_NCNN_AVX2_RUNTIME is defined to 1 then.
+//
+// In both cases, SHERPA_NCNN_AVX2_KERNELS is defined to 1. AVX2 kernels
+// are marked with SHERPA_NCNN_TARGET_AVX2 and called only if
+// CpuHasAvx2() returns true, which it always does with SHERPA_NCNN_AVX2.
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SHERPA_NCNN_NEON 1
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#define SHERPA_NCNN_WASM_SIMD 1
+#elif defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SHERPA_NCNN_SSE2 1
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#define SHERPA_NCNN_AVX2 1
+#endif
+#elif defined(__riscv_vector) && defined(__riscv_v_intrinsic) && \
+    __riscv_v_intrinsic >= 12000
+#include <riscv_vector.h>
+#define SHERPA_NCNN_RVV 1
+#endif
+
+#if SHERPA_NCNN_AVX2
+#define SHERPA_NCNN_AVX2_KERNELS 1
+#define SHERPA_NCNN_TARGET_AVX2
+
+namespace sherpa_ncnn {
+constexpr bool CpuHasAvx2() { return true; }
+}  // namespace sherpa_ncnn
+
+#elif SHERPA_NCNN_SSE2 && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define SHERPA_NCNN_AVX2_RUNTIME 1
+#define SHERPA_NCNN_AVX2_KERNELS 1
+#define SHERPA_NCNN_TARGET_AVX2 __attribute__((target("avx2,fma")))
+
+namespace sherpa_ncnn {
+
+// It is computed once. The check includes whether the OS saves the AVX
+// registers.
+inline bool CpuHasAvx2() {
+  static const bool ans =
+      __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+  return ans;
+}
+
+}  // namespace sherpa_ncnn
+#endif
+
+#endif  // SHERPA_NCNN_CSRC_SIMD_H_
@@ -18,11 +18,61 @@
 
 #include "sherpa-ncnn/csrc/simpleupsample.h"
 
+#include <vector>
+
+#include "sherpa-ncnn/csrc/simd.h"
+#include "sherpa-ncnn/csrc/vulkan-pipeline.h"
+
 namespace sherpa_ncnn {
 
+#if NCNN_VULKAN
+// The output is written directly in the 2-D shape (w, upsample * h) that
+// the CPU implementation reshapes to.
+static const char kSimpleUpsampleShader[] = R"(
+#version 450
+
+layout (binding = 0) readonly buffer bottom_blob { sfp bottom_blob_data[]; };
+layout (binding = 1) writeonly buffer top_blob { sfp top_blob_data[]; };
+layout (binding = 2) readonly buffer bias_blob { sfp bias_data[]; };
+
+layout (push_constant) uniform parameter
+{
+    int w;
+    int h;
+    int upsample;
+    int bias_w;
+} p;
+
+void main()
+{
+    int gx = int(gl_GlobalInvocationID.x);
+    int gy = int(gl_GlobalInvocationID.y);
+
+    if (gx >= p.w || gy >= p.h * p.upsample)
+        return;
+
+    int q = gy / p.upsample;
+    int y = gy % p.upsample;
+
+    afp v = buffer_ld1(bottom_blob_data, q * p.w + gx)
+            + buffer_ld1(bias_data, y * p.bias_w + gx);
+
+    buffer_st1(top_blob_data, gy * p.w + gx, v);
+}
+)";
+#endif
+
 SimpleUpsample::SimpleUpsample() {
   one_blob_only = true;
   support_inplace = false;
+  support_packing = true;
+
+  // The bias is kept in fp32. We don't claim bf16 storage, so a 16-bit
+  // input is always fp16.
+  support_fp16_storage = true;
+#if NCNN_VULKAN
+  support_vulkan = true;
+#endif
 }
 
 int32_t SimpleUpsample::load_param(const ncnn::ParamDict &pd) {
@@ -46,39 +96,166 @@ int32_t SimpleUpsample::load_model(const ncnn::ModelBin &mb) {
   return 0;
 }
 
+// out[i] = a[i] + b[i] for i in [0, n)
+static void AddRow(const float *a, const float *b, float *out, int32_t n) {
+  int32_t i = 0;
+#if SHERPA_NCNN_NEON
+  for (; i + 4 <= n; i += 4) {
+    vst1q_f32(out + i, vaddq_f32(vld1q_f32(a + i), vld1q_f32(b + i)));
+  }
+#elif SHERPA_NCNN_WASM_SIMD
+  for (; i + 4 <= n; i += 4) {
+    wasm_v128_store(out + i, wasm_f32x4_add(wasm_v128_load(a + i),
+                                            wasm_v128_load(b + i)));
+  }
+#elif SHERPA_NCNN_SSE2
+#if SHERPA_NCNN_AVX2
+  for (; i + 8 <= n; i += 8) {
+    _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(a + i),
+                                            _mm256_loadu_ps(b + i)));
+  }
+#endif
+  for (; i + 4 <= n; i += 4) {
+    _mm_storeu_ps(out + i,
+                  _mm_add_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+  }
+#elif SHERPA_NCNN_RVV
+  for (size_t vl; i < n; i += static_cast<int32_t>(vl)) {
+    vl = __riscv_vsetvl_e32m8(n - i);
+    vfloat32m8_t v = __riscv_vfadd_vv_f32m8(__riscv_vle32_v_f32m8(a + i, vl),
+                                            __riscv_vle32_v_f32m8(b + i, vl),
+                                            vl);
+    __riscv_vse32_v_f32m8(out + i, v, vl);
+  }
+#endif
+  for (; i < n; ++i) {
+    out[i] = a[i] + b[i];
+  }
+}
+
 int32_t SimpleUpsample::forward(const ncnn::Mat &bottom_blob,
                                 ncnn::Mat &top_blob,
                                 const ncnn::Option &opt) const {
   // bottom_blob.dims == 2
-  // bottom_blob.w == seq_len
-  // bottom_blob.h == num_channels
+  // bottom_blob.w == num_channels, bottom_blob.h == seq_len
+  //
+  // Row q * upsample + y of the output is row q of the input plus row y of
+  // the bias.
 
-  int32_t outw = bottom_blob.w;
-  int32_t outh = upsample;
-  int32_t outc = bottom_blob.h;
+  int32_t w = bottom_blob.w;
+  int32_t elempack = bottom_blob.elempack;
+  int32_t h = bottom_blob.h * elempack;
+  int32_t outh = upsample * h;
+
+  bool fp16 = bottom_blob.elembits() == 16;
   size_t elemsize = bottom_blob.elemsize;
 
-  top_blob.create(outw, outh, outc, elemsize, opt.blob_allocator);
+  top_blob.create(w, outh / elempack, elemsize, elempack, opt.blob_allocator);
   if (top_blob.empty()) return -100;
 
+  if (elempack == 1 && !fp16) {
+#pragma omp parallel for num_threads(opt.num_threads)
+    for (int32_t q = 0; q < h; ++q) {
+      const float *a_ptr = bottom_blob.row(q);
+
+      for (int32_t y = 0; y < upsample; ++y) {
+        AddRow(a_ptr, bias.row(y), top_blob.row(q * upsample + y), w);
+      }
+    }
+
+    return 0;
+  }
+
+  // Row r of a mat packed along h is interleaved with the rows of the same
+  // pack, i.e., element (r, x) is at ((r / elempack) * w + x) * elempack +
+  // r % elempack.
 #pragma omp parallel for num_threads(opt.num_threads)
-  for (int32_t q = 0; q < outc; ++q) {
-    ncnn::Mat out_m = top_blob.channel(q);
-    const float *a_ptr = bottom_blob.row(q);
-
-    for (int32_t y = 0; y < outh; ++y) {
-      float *out_ptr = out_m.row(y);
-      const float *b_ptr = bias.row(y);
-      for (int32_t x = 0; x < outw; ++x) {
-        out_ptr[x] = a_ptr[x] + b_ptr[x];
+  for (int32_t r = 0; r < outh; ++r) {
+    int32_t q = r / upsample;
+    const float *b_ptr = bias.row(r % upsample);
+
+    size_t in_offset = static_cast<size_t>(q / elempack) * w * elempack +
+                       q % elempack;
+    size_t out_offset = static_cast<size_t>(r / elempack) * w * elempack +
+                        r % elempack;
+
+    if (fp16) {
+      const auto *in = static_cast<const uint16_t *>(bottom_blob.data);
+      auto *out = static_cast<uint16_t *>(top_blob.data);
+      for (int32_t x = 0; x < w; ++x) {
+        float v = ncnn::float16_to_float32(in[in_offset + x * elempack]);
+        out[out_offset + x * elempack] =
+            ncnn::float32_to_float16(v + b_ptr[x]);
+      }
+    } else {
+      const float *in = bottom_blob;
+      float *out = top_blob;
+      for (int32_t x = 0; x < w; ++x) {
+        out[out_offset + x * elempack] =
+            in[in_offset + x * elempack] + b_ptr[x];
       }
     }
   }
 
-  top_blob = top_blob.reshape(outw, outh * outc);
+  return 0;
+}
+
+#if NCNN_VULKAN
+int32_t SimpleUpsample::create_pipeline(const ncnn::Option &opt) {
+  if (!vkdev) return 0;
+
+  pipeline_simpleupsample =
+      CreateVulkanPipeline(vkdev, kSimpleUpsampleShader, opt, 8, 8, 1);
+
+  return pipeline_simpleupsample ? 0 : -100;
+}
+
+int32_t SimpleUpsample::destroy_pipeline(const ncnn::Option & /*opt*/) {
+  delete pipeline_simpleupsample;
+  pipeline_simpleupsample = nullptr;
+
+  return 0;
+}
+
+int32_t SimpleUpsample::upload_model(ncnn::VkTransfer &cmd,
+                                     const ncnn::Option &opt) {
+  cmd.record_upload(bias, bias_gpu, opt);
+
+  if (opt.lightmode) {
+    bias.release();
+  }
+
+  return 0;
+}
+
+int32_t SimpleUpsample::forward(const ncnn::VkMat &bottom_blob_packed,
+                                ncnn::VkMat &top_blob, ncnn::VkCompute &cmd,
+                                const ncnn::Option &opt) const {
+  // support_packing is for the CPU. The shader works on unpacked blobs.
+  ncnn::VkMat bottom_blob = bottom_blob_packed;
+  if (bottom_blob.elempack != 1) {
+    vkdev->convert_packing(bottom_blob_packed, bottom_blob, 1, cmd, opt);
+  }
+
+  int32_t outw = bottom_blob.w;
+  int32_t outh = upsample * bottom_blob.h;
+
+  top_blob.create(outw, outh, bottom_blob.elemsize, 1, opt.blob_vkallocator);
+  if (top_blob.empty()) return -100;
+
+  std::vector<ncnn::VkMat> bindings = {bottom_blob, top_blob, bias_gpu};
+
+  std::vector<ncnn::vk_constant_type> constants(4);
+  constants[0].i = bottom_blob.w;
+  constants[1].i = bottom_blob.h;
+  constants[2].i = upsample;
+  constants[3].i = bias_gpu.w;
+
+  cmd.record_pipeline(pipeline_simpleupsample, bindings, constants, top_blob);
 
   return 0;
 }
+#endif
 
 static ncnn::Layer *SimpleUpsampleCreator(void * /*userdata*/) {
   return new SimpleUpsample();
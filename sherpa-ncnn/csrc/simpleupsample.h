@@ -37,12 +37,29 @@ class SimpleUpsample : public ncnn::Layer {
   int32_t forward(const ncnn::Mat &bottom_blob, ncnn::Mat &top_blob,
                   const ncnn::Option &opt) const override;
 
+#if NCNN_VULKAN
+  int32_t create_pipeline(const ncnn::Option &opt) override;
+  int32_t destroy_pipeline(const ncnn::Option &opt) override;
+
+  int32_t forward(const ncnn::VkMat &bottom_blob, ncnn::VkMat &top_blob,
+                  ncnn::VkCompute &cmd, const ncnn::Option &opt) const override;
+
+  int32_t upload_model(ncnn::VkTransfer &cmd,
+                       const ncnn::Option &opt) override;
+#endif
+
  public:
   int32_t upsample;
   int32_t num_channels;
   int32_t bias_data_size;
 
   ncnn::Mat bias;
+
+#if NCNN_VULKAN
+ private:
+  ncnn::VkMat bias_gpu;
+  ncnn::Pipeline *pipeline_simpleupsample = nullptr;
+#endif
 };
 
 void RegisterTensorSimpleUpsampleLayer(ncnn::Net &net);
@@ -0,0 +1,288 @@
+// sherpa-ncnn/csrc/simulated-streaming-asr.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/simulated-streaming-asr.h"
+
+#include <algorithm>
+#include <deque>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/macros.h"
+#include "sherpa-ncnn/csrc/voice-activity-detector.h"
+
+namespace sherpa_ncnn {
+
+bool SimulatedStreamingAsrConfig::Validate() const {
+  if (decode_interval <= 0) {
+    SHERPA_NCNN_LOGE("decode_interval should be positive. Given: %f",
+                     decode_interval);
+    return false;
+  }
+
+  if (min_right_context <= 0) {
+    SHERPA_NCNN_LOGE("min_right_context should be positive. Given: %f",
+                     min_right_context);
+    return false;
+  }
+
+  if (max_window_duration <= min_right_context) {
+    SHERPA_NCNN_LOGE(
+        "max_window_duration (%f) should be larger than min_right_context "
+        "(%f)",
+        max_window_duration, min_right_context);
+    return false;
+  }
+
+  return true;
+}
+
+std::string SimulatedStreamingAsrConfig::ToString() const {
+  std::ostringstream os;
+
+  os << "SimulatedStreamingAsrConfig(";
+  os << "decode_interval=" << decode_interval << ", ";
+  os << "max_window_duration=" << max_window_duration << ", ";
+  os << "min_right_context=" << min_right_context << ")";
+
+  return os.str();
+}
+
+class SimulatedStreamingAsr::Impl {
+ public:
+  Impl(const OfflineRecognizer *recognizer,
+       const SileroVadModelConfig &vad_config,
+       const SimulatedStreamingAsrConfig &config,
+       std::shared_ptr<SileroVadModel> vad_model)
+      : recognizer_(recognizer),
+        config_(config),
+        sample_rate_(vad_config.sample_rate) {
+    if (!config_.Validate()) {
+      SHERPA_NCNN_LOGE("Invalid config: %s", config_.ToString().c_str());
+      SHERPA_NCNN_EXIT(-1);
+    }
+
+    if (vad_model) {
+      vad_ = std::make_unique<VoiceActivityDetector>(vad_config,
+                                                     std::move(vad_model));
+    } else {
+      vad_ = std::make_unique<VoiceActivityDetector>(vad_config);
+    }
+
+    decode_interval_ = config_.decode_interval * sample_rate_;
+
+    VadCallbacks callbacks;
+    callbacks.on_speech_start = [this](int32_t start) {
+      StartSegment(start);
+    };
+    callbacks.on_speech_samples = [this](const CircularBufferView &samples) {
+      samples_.insert(samples_.end(), samples.data1,
+                      samples.data1 + samples.size1);
+      samples_.insert(samples_.end(), samples.data2,
+                      samples.data2 + samples.size2);
+    };
+    callbacks.on_speech_end = [this](int32_t, int32_t) { EndSegment(); };
+    vad_->SetCallbacks(std::move(callbacks));
+  }
+
+  void AcceptWaveform(const float *samples, int32_t n) {
+    vad_->AcceptWaveform(samples, n);
+    MaybeDecode();
+  }
+
+  void AcceptWaveformInt16(const int16_t *samples, int32_t n) {
+    vad_->AcceptWaveformInt16(samples, n);
+    MaybeDecode();
+  }
+
+  void InputFinished() { vad_->Flush(); }
+
+  bool IsSpeechDetected() const { return in_segment_; }
+
+  const OfflineRecognizerResult &GetPartialResult() const { return partial_; }
+
+  bool Empty() const { return results_.empty(); }
+
+  const OfflineRecognizerResult &Front() const {
+    if (results_.empty()) {
+      SHERPA_NCNN_LOGE("No result is queued");
+      SHERPA_NCNN_EXIT(-1);
+    }
+
+    return results_.front();
+  }
+
+  void Pop() { results_.pop_front(); }
+
+  void Reset() {
+    vad_->Reset();
+    results_.clear();
+    ClearSegment();
+  }
+
+ private:
+  void StartSegment(int32_t start) {
+    ClearSegment();
+    in_segment_ = true;
+    window_start_ = start;
+  }
+
+  void EndSegment() {
+    Decode(true);
+    results_.push_back(std::move(partial_));
+    ClearSegment();
+  }
+
+  void ClearSegment() {
+    in_segment_ = false;
+    samples_.clear();
+    num_decoded_ = 0;
+    window_start_ = 0;
+    committed_ = {};
+    partial_ = {};
+  }
+
+  void MaybeDecode() {
+    if (in_segment_ &&
+        static_cast<int32_t>(samples_.size()) - num_decoded_ >=
+            decode_interval_) {
+      Decode(false);
+    }
+  }
+
+  // Decode the window, i.e., the samples of the current segment that are
+  // not committed, and update partial_. If is_final is false and the
+  // window is longer than max_window_duration, its stable tokens are
+  // committed and their samples are dropped.
+  void Decode(bool is_final) {
+    num_decoded_ = samples_.size();
+
+    // LFR features need a few frames. A shorter window only happens at the
+    // start of a segment and has no tokens.
+    if (static_cast<int32_t>(samples_.size()) < sample_rate_ / 10) {
+      partial_ = committed_;
+      return;
+    }
+
+    auto s = recognizer_->CreateStream();
+    s->AcceptWaveform(sample_rate_, samples_.data(), samples_.size());
+    recognizer_->DecodeStream(s.get());
+    const OfflineRecognizerResult &r = s->GetResult();
+
+    float offset = static_cast<float>(window_start_) / sample_rate_;
+    float duration = static_cast<float>(samples_.size()) / sample_rate_;
+
+    int32_t num_tokens = r.tokens.size();
+    int32_t num_committed = 0;
+    if (!is_final && duration > config_.max_window_duration) {
+      float limit = duration - config_.min_right_context;
+      num_committed =
+          std::lower_bound(r.timestamps.begin(), r.timestamps.end(), limit) -
+          r.timestamps.begin();
+
+      // Cut between the last committed token and the next one, so that
+      // neither of them is split
+      float cut = limit;
+      if (num_committed > 0 && num_committed < num_tokens) {
+        cut = (r.timestamps[num_committed - 1] +
+               r.timestamps[num_committed]) /
+              2;
+      }
+
+      Append(r, 0, num_committed, offset, &committed_);
+
+      int32_t n = std::min<int32_t>(cut * sample_rate_, samples_.size());
+      samples_.erase(samples_.begin(), samples_.begin() + n);
+      window_start_ += n;
+      num_decoded_ -= n;
+    }
+
+    partial_ = committed_;
+    Append(r, num_committed, num_tokens, offset, &partial_);
+
+    partial_.lang = r.lang;
+    partial_.emotion = r.emotion;
+    partial_.event = r.event;
+  }
+
+  // Append tokens [begin, end) of src to *dst with their timestamps
+  // shifted by offset seconds
+  static void Append(const OfflineRecognizerResult &src, int32_t begin,
+                     int32_t end, float offset, OfflineRecognizerResult *dst) {
+    for (int32_t i = begin; i != end; ++i) {
+      dst->text.append(src.tokens[i]);
+      dst->tokens.push_back(src.tokens[i]);
+      dst->timestamps.push_back(src.timestamps[i] + offset);
+    }
+  }
+
+ private:
+  const OfflineRecognizer *recognizer_;
+  SimulatedStreamingAsrConfig config_;
+  std::unique_ptr<VoiceActivityDetector> vad_;
+  int32_t sample_rate_;
+  int32_t decode_interval_;  // in samples
+
+  bool in_segment_ = false;
+
+  // Samples of the window of the current segment
+  std::vector<float> samples_;
+
+  // Size of samples_ at the last decode
+  int32_t num_decoded_ = 0;
+
+  // Index of the first sample of the window in the input
+  int64_t window_start_ = 0;
+
+  // Tokens of the current segment before the window
+  OfflineRecognizerResult committed_;
+
+  OfflineRecognizerResult partial_;
+
+  // Results of finished segments
+  std::deque<OfflineRecognizerResult> results_;
+};
+
+SimulatedStreamingAsr::SimulatedStreamingAsr(
+    const OfflineRecognizer *recognizer,
+    const SileroVadModelConfig &vad_config,
+    const SimulatedStreamingAsrConfig &config,
+    std::shared_ptr<SileroVadModel> vad_model)
+    : impl_(std::make_unique<Impl>(recognizer, vad_config, config,
+                                   std::move(vad_model))) {}
+
+SimulatedStreamingAsr::~SimulatedStreamingAsr() = default;
+
+void SimulatedStreamingAsr::AcceptWaveform(const float *samples, int32_t n) {
+  impl_->AcceptWaveform(samples, n);
+}
+
+void SimulatedStreamingAsr::AcceptWaveformInt16(const int16_t *samples,
+                                                int32_t n) {
+  impl_->AcceptWaveformInt16(samples, n);
+}
+
+void SimulatedStreamingAsr::InputFinished() { impl_->InputFinished(); }
+
+bool SimulatedStreamingAsr::IsSpeechDetected() const {
+  return impl_->IsSpeechDetected();
+}
+
+const OfflineRecognizerResult &SimulatedStreamingAsr::GetPartialResult()
+    const {
+  return impl_->GetPartialResult();
+}
+
+bool SimulatedStreamingAsr::Empty() const { return impl_->Empty(); }
+
+const OfflineRecognizerResult &SimulatedStreamingAsr::Front() const {
+  return impl_->Front();
+}
+
+void SimulatedStreamingAsr::Pop() { impl_->Pop(); }
+
+void SimulatedStreamingAsr::Reset() { impl_->Reset(); }
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,130 @@
+// sherpa-ncnn/csrc/simulated-streaming-asr.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_SIMULATED_STREAMING_ASR_H_
+#define SHERPA_NCNN_CSRC_SIMULATED_STREAMING_ASR_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "sherpa-ncnn/csrc/offline-recognizer.h"
+#include "sherpa-ncnn/csrc/offline-stream.h"
+#include "sherpa-ncnn/csrc/silero-vad-model-config.h"
+#include "sherpa-ncnn/csrc/silero-vad-model.h"
+
+namespace sherpa_ncnn {
+
+struct SimulatedStreamingAsrConfig {
+  // The current speech segment is decoded again once it has grown by this
+  // many seconds
+  float decode_interval = 0.2;
+
+  // A decode covers at most about this many seconds of a segment. Once the
+  // undecided part of a segment is longer, the tokens that have at least
+  // min_right_context seconds of audio after them are committed and their
+  // audio is never decoded again. It bounds the cost of a decode
+  // regardless of the length of the segment.
+  float max_window_duration = 8;
+
+  // See max_window_duration. It must be less than max_window_duration.
+  float min_right_context = 2;
+
+  SimulatedStreamingAsrConfig() = default;
+
+  SimulatedStreamingAsrConfig(float decode_interval,
+                              float max_window_duration,
+                              float min_right_context)
+      : decode_interval(decode_interval),
+        max_window_duration(max_window_duration),
+        min_right_context(min_right_context) {}
+
+  bool Validate() const;
+
+  std::string ToString() const;
+};
+
+/** Real-time recognition with a non-streaming model, e.g., SenseVoice.
+ *
+ * A voice activity detector splits the input into speech segments. While
+ * a segment is going on, it is decoded with the offline recognizer every
+ * decode_interval seconds of speech and GetPartialResult() is updated.
+ * Once the segment ends, it is decoded a last time and its result is
+ * queued, see Empty(), Front() and Pop().
+ *
+ * Only the last max_window_duration seconds or so of a segment are
+ * decoded each time, see SimulatedStreamingAsrConfig, so the cost of a
+ * decode does not grow with the length of the segment.
+ *
+ * Timestamps of the results are in seconds of the input audio.
+ *
+ * Usage:
+ *
+ *   SimulatedStreamingAsr asr(&recognizer, vad_config);
+ *   asr.AcceptWaveform(samples, n);
+ *   Show(asr.GetPartialResult().text);
+ *   while (!asr.Empty()) {
+ *     Print(asr.Front().text);
+ *     asr.Pop();
+ *   }
+ */
+class SimulatedStreamingAsr {
+ public:
+  /**
+   * @param recognizer It must outlive this object.
+   * @param vad_config The config of the detector.
+   * @param config  When to decode.
+   * @param vad_model  If not null, it is shared instead of loading the
+   *                   model of vad_config, see VoiceActivityDetector.
+   */
+  SimulatedStreamingAsr(const OfflineRecognizer *recognizer,
+                        const SileroVadModelConfig &vad_config,
+                        const SimulatedStreamingAsrConfig &config = {},
+                        std::shared_ptr<SileroVadModel> vad_model = nullptr);
+
+  ~SimulatedStreamingAsr();
+
+  SimulatedStreamingAsr(const SimulatedStreamingAsr &) = delete;
+  SimulatedStreamingAsr &operator=(const SimulatedStreamingAsr &) = delete;
+
+  /** Decoding happens in this call, on the calling thread.
+   *
+   * @param samples Audio samples at the sample rate of the VAD config,
+   *                normalized to [-1, 1].
+   * @param n Number of samples.
+   */
+  void AcceptWaveform(const float *samples, int32_t n);
+
+  // Same as AcceptWaveform() but for 16-bit PCM samples
+  void AcceptWaveformInt16(const int16_t *samples, int32_t n);
+
+  // End the current segment, if any, so that its result is queued
+  void InputFinished();
+
+  // Return true if a speech segment is going on
+  bool IsSpeechDetected() const;
+
+  // The result of the current segment so far. It is empty if no segment
+  // is going on.
+  const OfflineRecognizerResult &GetPartialResult() const;
+
+  // Return true if no result of a finished segment is queued
+  bool Empty() const;
+
+  // The result of the oldest finished segment. It must not be empty.
+  const OfflineRecognizerResult &Front() const;
+
+  void Pop();
+
+  // Drop the current segment and the queued results
+  void Reset();
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_SIMULATED_STREAMING_ASR_H_
@@ -0,0 +1,70 @@
+// sherpa-ncnn/csrc/slots.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_SLOTS_H_
+#define SHERPA_NCNN_CSRC_SLOTS_H_
+
+#include <condition_variable>  // NOLINT
+#include <cstdint>
+#include <mutex>  // NOLINT
+
+namespace sherpa_ncnn {
+
+// A counting semaphore with n slots. It limits the number of threads that
+// do something at the same time, e.g., the number of requests in flight.
+//
+// It is thread-safe.
+class Slots {
+ public:
+  explicit Slots(int32_t n) : n_(n) {}
+
+  Slots(const Slots &) = delete;
+  Slots &operator=(const Slots &) = delete;
+
+  // Wait until a slot is free and take it
+  void Acquire() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this]() { return n_ > 0; });
+    --n_;
+  }
+
+  void Release() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++n_;
+    }
+    cv_.notify_one();
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  int32_t n_;
+};
+
+// Hold a slot of slots, if it is not null, during its lifetime
+class SlotGuard {
+ public:
+  explicit SlotGuard(Slots *slots) : slots_(slots) {
+    if (slots_) {
+      slots_->Acquire();
+    }
+  }
+
+  ~SlotGuard() {
+    if (slots_) {
+      slots_->Release();
+    }
+  }
+
+  SlotGuard(const SlotGuard &) = delete;
+  SlotGuard &operator=(const SlotGuard &) = delete;
+
+ private:
+  Slots *slots_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_SLOTS_H_
@@ -0,0 +1,56 @@
+// sherpa-ncnn/csrc/spsc-ring-buffer.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/spsc-ring-buffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace sherpa_ncnn {
+
+SpscRingBuffer::SpscRingBuffer(int32_t capacity) {
+  int64_t n = 1;
+  while (n < capacity) {
+    n <<= 1;
+  }
+
+  buffer_.resize(n);
+  mask_ = n - 1;
+}
+
+int32_t SpscRingBuffer::Push(const float *p, int32_t n) {
+  int64_t tail = tail_.load(std::memory_order_relaxed);
+  int64_t head = head_.load(std::memory_order_acquire);
+
+  int32_t room = Capacity() - static_cast<int32_t>(tail - head);
+  n = std::min(n, room);
+  if (n <= 0) return 0;
+
+  // At most two parts, since the buffer wraps around
+  int32_t start = static_cast<int32_t>(tail & mask_);
+  int32_t n1 = std::min(n, Capacity() - start);
+  std::memcpy(buffer_.data() + start, p, n1 * sizeof(float));
+  std::memcpy(buffer_.data(), p + n1, (n - n1) * sizeof(float));
+
+  tail_.store(tail + n, std::memory_order_release);
+  return n;
+}
+
+int32_t SpscRingBuffer::Pop(float *p, int32_t n) {
+  int64_t head = head_.load(std::memory_order_relaxed);
+  int64_t tail = tail_.load(std::memory_order_acquire);
+
+  n = std::min(n, static_cast<int32_t>(tail - head));
+  if (n <= 0) return 0;
+
+  int32_t start = static_cast<int32_t>(head & mask_);
+  int32_t n1 = std::min(n, Capacity() - start);
+  std::memcpy(p, buffer_.data() + start, n1 * sizeof(float));
+  std::memcpy(p + n1, buffer_.data(), (n - n1) * sizeof(float));
+
+  head_.store(head + n, std::memory_order_release);
+  return n;
+}
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,58 @@
+// sherpa-ncnn/csrc/spsc-ring-buffer.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_SPSC_RING_BUFFER_H_
+#define SHERPA_NCNN_CSRC_SPSC_RING_BUFFER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace sherpa_ncnn {
+
+/** A fixed-size queue of samples between one producer thread, e.g., an
+ * audio capture thread, and one consumer thread. Neither side takes a lock
+ * or allocates, so the producer is never blocked by a slow consumer.
+ *
+ * Unlike CircularBuffer, it does not grow: Push() stores only the samples
+ * that fit and returns their number.
+ */
+class SpscRingBuffer {
+ public:
+  // The capacity is rounded up to a power of two
+  explicit SpscRingBuffer(int32_t capacity);
+
+  SpscRingBuffer(const SpscRingBuffer &) = delete;
+  SpscRingBuffer &operator=(const SpscRingBuffer &) = delete;
+
+  // Called only by the producer. Return the number of samples stored,
+  // which is less than n if the buffer is full.
+  int32_t Push(const float *p, int32_t n);
+
+  // Called only by the consumer. Move at most n samples to p and return
+  // their number.
+  int32_t Pop(float *p, int32_t n);
+
+  // Number of samples in the buffer. It is exact only when called by the
+  // producer or the consumer while the other side is idle.
+  int32_t Size() const {
+    return static_cast<int32_t>(tail_.load(std::memory_order_acquire) -
+                                head_.load(std::memory_order_acquire));
+  }
+
+  int32_t Capacity() const { return static_cast<int32_t>(buffer_.size()); }
+
+ private:
+  std::vector<float> buffer_;
+  int64_t mask_;
+
+  // Linear indexes that never wrap around. Each is written by one side
+  // only and kept on its own cache line.
+  alignas(64) std::atomic<int64_t> head_{0};  // consumer
+  alignas(64) std::atomic<int64_t> tail_{0};  // producer
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_SPSC_RING_BUFFER_H_
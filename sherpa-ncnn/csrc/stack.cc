@@ -18,11 +18,43 @@
 
 #include "sherpa-ncnn/csrc/stack.h"
 
+#include "sherpa-ncnn/csrc/vulkan-pipeline.h"
+
 namespace sherpa_ncnn {
 
+#if NCNN_VULKAN
+// Copy one input into the output at the given offset. It is run once for
+// each input.
+static const char kStackShader[] = R"(
+#version 450
+
+layout (binding = 0) readonly buffer bottom_blob { sfp bottom_blob_data[]; };
+layout (binding = 1) writeonly buffer top_blob { sfp top_blob_data[]; };
+
+layout (push_constant) uniform parameter
+{
+    int size;
+    int offset;
+} p;
+
+void main()
+{
+    int gx = int(gl_GlobalInvocationID.x);
+
+    if (gx >= p.size)
+        return;
+
+    buffer_cp1(top_blob_data, p.offset + gx, bottom_blob_data, gx);
+}
+)";
+#endif
+
 Stack::Stack() {
   one_blob_only = false;
   support_inplace = false;
+#if NCNN_VULKAN
+  support_vulkan = true;
+#endif
 }
 
 int32_t Stack::load_param(const ncnn::ParamDict &pd) {
@@ -41,6 +73,18 @@ int32_t Stack::forward(const std::vector<ncnn::Mat> &bottom_blobs,
   int32_t dims = bottom_blobs[0].dims;
   size_t elemsize = bottom_blobs[0].elemsize;
 
+  // The inputs are separate blobs, so the output is a copy, except for a
+  // single input, which is reshaped in place if possible.
+  //
+  // Note: support_packing is false since the output is packed along the
+  // new axis while the inputs are packed along their last axis.
+  if (bottom_blobs.size() == 1 && (dims == 1 || dims == 2)) {
+    const ncnn::Mat &b = bottom_blobs[0];
+    top_blobs[0] = dims == 1 ? b.reshape(b.w, 1, opt.blob_allocator)
+                             : b.reshape(b.w, b.h, 1, opt.blob_allocator);
+    return top_blobs[0].empty() ? -100 : 0;
+  }
+
   if (dims == 1) {
     int32_t out_w = bottom_blobs[0].w;
     int32_t out_h = bottom_blobs.size();
@@ -89,6 +133,67 @@ int32_t Stack::forward(const std::vector<ncnn::Mat> &bottom_blobs,
   return -100;
 }
 
+#if NCNN_VULKAN
+int32_t Stack::create_pipeline(const ncnn::Option &opt) {
+  if (!vkdev) return 0;
+
+  pipeline_stack = CreateVulkanPipeline(vkdev, kStackShader, opt, 64, 1, 1);
+
+  return pipeline_stack ? 0 : -100;
+}
+
+int32_t Stack::destroy_pipeline(const ncnn::Option & /*opt*/) {
+  delete pipeline_stack;
+  pipeline_stack = nullptr;
+
+  return 0;
+}
+
+int32_t Stack::forward(const std::vector<ncnn::VkMat> &bottom_blobs,
+                       std::vector<ncnn::VkMat> &top_blobs,
+                       ncnn::VkCompute &cmd, const ncnn::Option &opt) const {
+  int32_t dims = bottom_blobs[0].dims;
+  size_t elemsize = bottom_blobs[0].elemsize;
+
+  int32_t w = bottom_blobs[0].w;
+  int32_t h = bottom_blobs[0].h;
+  int32_t n = static_cast<int32_t>(bottom_blobs.size());
+
+  ncnn::VkMat &top_blob = top_blobs[0];
+  if (dims == 1) {
+    top_blob.create(w, n, elemsize, 1, opt.blob_vkallocator);
+  } else if (dims == 2) {
+    top_blob.create(w, h, n, elemsize, 1, opt.blob_vkallocator);
+  } else {
+    NCNN_LOGE("Stack: dim %d is not implemented", dims);
+    return -100;
+  }
+
+  if (top_blob.empty()) return -100;
+
+  // Input b is row b of a 2-D output or channel b of a 3-D output
+  int32_t size = dims == 1 ? w : w * h;
+  int32_t step = dims == 1 ? w : static_cast<int32_t>(top_blob.cstep);
+
+  ncnn::VkMat dispatcher;
+  dispatcher.w = size;
+  dispatcher.h = 1;
+  dispatcher.c = 1;
+
+  for (int32_t b = 0; b != n; ++b) {
+    std::vector<ncnn::VkMat> bindings = {bottom_blobs[b], top_blob};
+
+    std::vector<ncnn::vk_constant_type> constants(2);
+    constants[0].i = size;
+    constants[1].i = b * step;
+
+    cmd.record_pipeline(pipeline_stack, bindings, constants, dispatcher);
+  }
+
+  return 0;
+}
+#endif
+
 static ncnn::Layer *StackCreator(void * /*userdata*/) { return new Stack(); }
 
 void RegisterStackLayer(ncnn::Net &net) {
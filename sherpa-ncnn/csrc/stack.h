@@ -37,8 +37,22 @@ class Stack : public ncnn::Layer {
                   std::vector<ncnn::Mat> &top_blobs,
                   const ncnn::Option &opt) const override;
 
+#if NCNN_VULKAN
+  int32_t create_pipeline(const ncnn::Option &opt) override;
+  int32_t destroy_pipeline(const ncnn::Option &opt) override;
+
+  int32_t forward(const std::vector<ncnn::VkMat> &bottom_blobs,
+                  std::vector<ncnn::VkMat> &top_blobs, ncnn::VkCompute &cmd,
+                  const ncnn::Option &opt) const override;
+#endif
+
  public:
   int32_t axis;
+
+#if NCNN_VULKAN
+ private:
+  ncnn::Pipeline *pipeline_stack = nullptr;
+#endif
 };
 
 void RegisterStackLayer(ncnn::Net &net);
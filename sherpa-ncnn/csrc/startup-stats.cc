@@ -0,0 +1,60 @@
+// sherpa-ncnn/csrc/startup-stats.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/startup-stats.h"
+
+#include <atomic>
+#include <cmath>
+#include <sstream>
+#include <string>
+
+namespace sherpa_ncnn {
+
+// In microseconds
+static std::atomic<int64_t> totals[kNumStartupPhases];
+
+const char *GetStartupPhaseName(StartupPhase phase) {
+  switch (phase) {
+    case StartupPhase::kParamParse:
+      return "param_parse";
+    case StartupPhase::kWeightLoad:
+      return "weight_load";
+    case StartupPhase::kSymbolTable:
+      return "symbol_table";
+    case StartupPhase::kLexicon:
+      return "lexicon";
+    case StartupPhase::kHotwords:
+      return "hotwords";
+  }
+  return "unknown";
+}
+
+void StartupStats::Add(StartupPhase phase, double ms) {
+  totals[static_cast<int32_t>(phase)] += std::llround(ms * 1000);
+}
+
+double StartupStats::Get(StartupPhase phase) {
+  return totals[static_cast<int32_t>(phase)] / 1000.;
+}
+
+void StartupStats::Reset() {
+  for (auto &t : totals) {
+    t = 0;
+  }
+}
+
+std::string StartupStats::ToString() {
+  std::ostringstream os;
+  os << "StartupStats(";
+  std::string sep;
+  for (int32_t i = 0; i != kNumStartupPhases; ++i) {
+    auto phase = static_cast<StartupPhase>(i);
+    os << sep << GetStartupPhaseName(phase) << "=" << Get(phase) << " ms";
+    sep = ", ";
+  }
+  os << ")";
+  return os.str();
+}
+
+}  // namespace sherpa_ncnn
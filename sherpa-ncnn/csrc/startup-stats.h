@@ -0,0 +1,75 @@
+// sherpa-ncnn/csrc/startup-stats.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_STARTUP_STATS_H_
+#define SHERPA_NCNN_CSRC_STARTUP_STATS_H_
+
+#include <cstdint>
+#include <string>
+
+#include "sherpa-ncnn/csrc/latency-stats.h"
+
+namespace sherpa_ncnn {
+
+// Phases of loading models and their resources whose wall time is recorded
+enum class StartupPhase : int32_t {
+  // ncnn::Net::load_param(), which creates the layers of a network
+  kParamParse = 0,
+  // ncnn::Net::load_model(), which reads the weights and creates the
+  // pipelines of the layers, e.g., packs or transforms the weights
+  kWeightLoad = 1,
+  // Reading tokens.txt or its binary format, see SymbolTable
+  kSymbolTable = 2,
+  // Reading the lexicon of TTS, see Lexicon
+  kLexicon = 3,
+  // Building the context graph of a hotwords file
+  kHotwords = 4,
+};
+
+constexpr int32_t kNumStartupPhases = 5;
+
+// Return a name such as "param_parse" for the given phase
+const char *GetStartupPhaseName(StartupPhase phase);
+
+/** Process-wide time of each StartupPhase, e.g., for finding out where
+ * the construction of a recognizer spends its time on a cold start, see
+ * sherpa-ncnn-startup-bench.
+ *
+ * The time of models that are loaded in parallel is summed up. Recording
+ * is always on, since it costs two clock reads per network or file.
+ *
+ * It is thread-safe.
+ */
+class StartupStats {
+ public:
+  static void Add(StartupPhase phase, double ms);
+
+  // Milliseconds spent in phase since the start of the process or the
+  // last Reset()
+  static double Get(StartupPhase phase);
+
+  static void Reset();
+
+  static std::string ToString();
+};
+
+// Add the lifetime of this object to the given phase of StartupStats
+class ScopedStartupTimer {
+ public:
+  explicit ScopedStartupTimer(StartupPhase phase)
+      : phase_(phase), start_(StageClock::now()) {}
+
+  ~ScopedStartupTimer() { StartupStats::Add(phase_, ElapsedMs(start_)); }
+
+  ScopedStartupTimer(const ScopedStartupTimer &) = delete;
+  ScopedStartupTimer &operator=(const ScopedStartupTimer &) = delete;
+
+ private:
+  StartupPhase phase_;
+  StageClock::time_point start_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_STARTUP_STATS_H_
@@ -0,0 +1,56 @@
+// sherpa-ncnn/csrc/stream-pool.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/stream-pool.h"
+
+#include <iterator>
+#include <utility>
+
+namespace sherpa_ncnn {
+
+int32_t StreamPool::Size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return streams_.size();
+}
+
+void StreamPool::Put(std::unique_ptr<Stream> s) const {
+  if (!s) return;
+
+  // Release what the stream holds for its owner while it is idle
+  s->SetMemoryReservation(nullptr);
+  s->SetEncoderTap(EncoderTap(), false);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (static_cast<int32_t>(streams_.size()) < capacity_) {
+      streams_.push_back(std::move(s));
+      return;
+    }
+  }
+
+  // The pool is full. s is destroyed outside of the lock.
+}
+
+std::unique_ptr<Stream> StreamPool::Take(int32_t encoder_index,
+                                         ContextGraphPtr context_graph) const {
+  std::unique_ptr<Stream> ans;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = streams_.rbegin(); it != streams_.rend(); ++it) {
+      if ((*it)->GetEncoderIndex() == encoder_index) {
+        ans = std::move(*it);
+        streams_.erase(std::next(it).base());
+        break;
+      }
+    }
+  }
+
+  if (ans) {
+    ans->Recycle(std::move(context_graph));
+  }
+
+  return ans;
+}
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,57 @@
+// sherpa-ncnn/csrc/stream-pool.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_STREAM_POOL_H_
+#define SHERPA_NCNN_CSRC_STREAM_POOL_H_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <vector>
+
+#include "sherpa-ncnn/csrc/context-graph.h"
+#include "sherpa-ncnn/csrc/stream.h"
+
+namespace sherpa_ncnn {
+
+/** Streams given back by Recognizer::RecycleStream() for reuse, see
+ * RecognizerConfig::stream_pool_size. It is thread-safe.
+ *
+ * A pooled stream holds no MemoryReservation, so idle streams do not use
+ * up RecognizerConfig::memory_budget; the stream that is taken out gets
+ * the reservation of the new stream.
+ */
+class StreamPool {
+ public:
+  // A capacity that is not positive disables the pool
+  explicit StreamPool(int32_t capacity) : capacity_(capacity) {}
+
+  StreamPool(const StreamPool &) = delete;
+  StreamPool &operator=(const StreamPool &) = delete;
+
+  int32_t Capacity() const { return capacity_; }
+
+  int32_t Size() const;
+
+  // Keep s for a later Take(). Its memory reservation is released. It is
+  // destroyed if the pool is full.
+  void Put(std::unique_ptr<Stream> s) const;
+
+  /** Return a pooled stream of the given encoder, i.e., whose states have
+   * the layout of that encoder, made a new stream with Stream::Recycle().
+   * Return nullptr if there is none.
+   */
+  std::unique_ptr<Stream> Take(int32_t encoder_index,
+                               ContextGraphPtr context_graph) const;
+
+ private:
+  int32_t capacity_;
+
+  mutable std::mutex mutex_;
+  mutable std::vector<std::unique_ptr<Stream>> streams_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_STREAM_POOL_H_
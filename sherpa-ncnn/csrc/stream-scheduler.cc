@@ -0,0 +1,641 @@
+// sherpa-ncnn/csrc/stream-scheduler.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/stream-scheduler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <mutex>  // NOLINT
+#include <sstream>
+#include <thread>  // NOLINT
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "platform.h"  // NOLINT
+#include "sherpa-ncnn/csrc/model.h"
+
+namespace sherpa_ncnn {
+
+namespace {
+
+// Weight of the latest chunk in the miss rate, which thus averages over
+// roughly the last 30 chunks
+constexpr float kMissRateWeight = 1.0f / 16;
+
+}  // namespace
+
+std::string StreamSchedulerConfig::ToString() const {
+  std::ostringstream os;
+
+  os << "StreamSchedulerConfig(";
+  os << "num_threads=" << num_threads << ", ";
+  os << "max_batch_size=" << max_batch_size << ", ";
+  os << "max_latency_ms=" << max_latency_ms << ", ";
+  os << "overload_queue_depth=" << overload_queue_depth << ", ";
+  os << "overload_deadline_ms=" << overload_deadline_ms << ", ";
+  os << "overload_miss_rate=" << overload_miss_rate << ", ";
+  os << "overload_max_batch_size=" << overload_max_batch_size << ", ";
+  os << "thread_budget=" << thread_budget << ")";
+
+  return os.str();
+}
+
+std::string StreamSchedulerStats::ToString() const {
+  std::ostringstream os;
+
+  os << "StreamSchedulerStats(";
+  os << "overloaded=" << (overloaded ? "True" : "False") << ", ";
+  os << "num_overloads=" << num_overloads << ", ";
+  os << "overloaded_seconds=" << overloaded_seconds << ", ";
+  os << "queue_depth=" << queue_depth << ", ";
+  os << "miss_rate=" << miss_rate << ", ";
+  os << "num_threads_per_batch=" << num_threads_per_batch << ")";
+
+  return os.str();
+}
+
+class StreamScheduler::Impl {
+  using Clock = std::chrono::steady_clock;
+
+  struct Entry {
+    Stream *s = nullptr;
+
+    // Index of the worker whose queue receives this stream
+    int32_t home = 0;
+
+    // The following fields are protected by Impl::mutex_
+
+    // True if it is in a queue or being decoded
+    bool scheduled = false;
+    bool input_finished = false;
+    bool removed = false;
+
+    // When it was last queued
+    Clock::time_point ready_time;
+
+    // From Stream::GetPriority() and Stream::GetLatencyTarget() when it
+    // was last queued. deadline is ready_time plus the latency target.
+    // Like ready_time, they are set before it is queued, so the worker
+    // that takes it from a queue reads them without Impl::mutex_.
+    int32_t priority = 0;
+    Clock::time_point deadline;
+    bool has_latency_target = false;
+
+    // Seconds of audio that were not decoded yet when the last batch with
+    // this stream was done, and seconds fed since then
+    float pending_seconds = 0;
+    float new_seconds = 0;
+
+    // Only the worker that is decoding the stream accesses them
+    std::string last_text;
+
+    // True if the scheduler switched it to greedy search
+    bool degraded = false;
+  };
+
+  struct Worker {
+    std::mutex mutex;
+    std::deque<Entry *> queue;
+  };
+
+ public:
+  Impl(const Recognizer *recognizer, const StreamSchedulerConfig &config,
+       Callback callback)
+      : recognizer_(recognizer),
+        config_(config),
+        callback_(std::move(callback)),
+        frame_shift_s_(recognizer->GetConfig().feat_config.frame_shift_ms /
+                       1000) {
+    if (config_.num_threads < 1 || config_.max_batch_size < 1 ||
+        config_.max_latency_ms < 0 || config_.overload_queue_depth < 0 ||
+        config_.overload_deadline_ms < 0 || config_.overload_miss_rate <= 0 ||
+        config_.overload_miss_rate > 1 || config_.overload_max_batch_size < 0 ||
+        config_.thread_budget < 0) {
+      NCNN_LOGE("Invalid config: %s", config_.ToString().c_str());
+      exit(-1);
+    }
+
+    for (int32_t i = 0; i != config_.num_threads; ++i) {
+      workers_.push_back(std::make_unique<Worker>());
+    }
+
+    for (int32_t i = 0; i != config_.num_threads; ++i) {
+      threads_.emplace_back([this, i]() { Run(i); });
+    }
+  }
+
+  ~Impl() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+
+    for (auto &t : threads_) {
+      t.join();
+    }
+  }
+
+  void AddStream(Stream *s) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (entries_.count(s)) {
+      NCNN_LOGE("The stream has already been added");
+      exit(-1);
+    }
+
+    auto e = std::make_unique<Entry>();
+    e->s = s;
+    e->home = next_home_++ % config_.num_threads;
+    Entry *p = e.get();
+    entries_[s] = std::move(e);
+
+    ScheduleLocked(p);
+  }
+
+  // seconds: Duration of the samples that were fed
+  void Notify(Stream *s, float seconds = 0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(s);
+    if (it != entries_.end()) {
+      it->second->new_seconds += seconds;
+      ScheduleLocked(it->second.get());
+    }
+  }
+
+  void InputFinished(Stream *s) {
+    s->InputFinished();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(s);
+    if (it != entries_.end()) {
+      it->second->input_finished = true;
+      ScheduleLocked(it->second.get());
+    }
+  }
+
+  void RemoveStream(Stream *s) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = entries_.find(s);
+    if (it == entries_.end()) return;
+
+    it->second->removed = true;
+
+    // The entry is erased here or, if the stream finishes meanwhile, by its
+    // worker, so look it up again every time
+    done_cv_.wait(lock, [this, s]() {
+      auto it = entries_.find(s);
+      return it == entries_.end() || !it->second->scheduled;
+    });
+
+    entries_.erase(s);
+  }
+
+  void WaitBacklog(Stream *s, float max_seconds) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this, s, max_seconds]() {
+      auto it = entries_.find(s);
+      if (it == entries_.end()) return true;
+
+      // If it is not scheduled, it needs more samples to make progress
+      const Entry &e = *it->second;
+      return e.removed || !e.scheduled ||
+             e.pending_seconds + e.new_seconds <= max_seconds;
+    });
+  }
+
+  void WaitIdle() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this]() { return num_scheduled_ == 0; });
+  }
+
+  bool IsOverloaded() const { return overloaded_; }
+
+  StreamSchedulerStats GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    StreamSchedulerStats ans;
+    ans.overloaded = overloaded_;
+    ans.num_overloads = num_overloads_;
+    ans.overloaded_seconds = overloaded_seconds_;
+    if (overloaded_) {
+      ans.overloaded_seconds +=
+          std::chrono::duration<double>(Clock::now() - overloaded_since_)
+              .count();
+    }
+    ans.queue_depth = num_queued_;
+    ans.miss_rate = miss_rate_;
+    ans.num_threads_per_batch = num_threads_per_batch_;
+
+    return ans;
+  }
+
+ private:
+  // Queue e on its home worker if it has work to do.
+  // The caller must hold mutex_.
+  void ScheduleLocked(Entry *e) {
+    if (e->scheduled || e->removed) return;
+
+    if (!e->input_finished && !recognizer_->IsReady(e->s)) return;
+
+    float latency_target_ms = e->s->GetLatencyTarget();
+
+    e->scheduled = true;
+    e->ready_time = Clock::now();
+    e->priority = e->s->GetPriority();
+    e->has_latency_target = latency_target_ms > 0;
+    e->deadline = e->ready_time;
+    if (e->has_latency_target) {
+      e->deadline += std::chrono::duration_cast<Clock::duration>(
+          std::chrono::duration<float, std::milli>(latency_target_ms));
+    }
+    ++num_scheduled_;
+
+    // Keep the queue sorted by urgency. Streams of equal urgency stay in
+    // the order they became ready.
+    Worker &w = *workers_[e->home];
+    {
+      std::lock_guard<std::mutex> lock(w.mutex);
+      auto it = std::upper_bound(w.queue.begin(), w.queue.end(), e, Before);
+      w.queue.insert(it, e);
+    }
+
+    ++num_queued_;
+    cv_.notify_all();
+  }
+
+  int32_t MaxBatchSize() const {
+    if (overloaded_ && config_.overload_max_batch_size > 0) {
+      return config_.overload_max_batch_size;
+    }
+
+    return config_.max_batch_size;
+  }
+
+  // Update overloaded_ with the queueing delay of the chunks of a batch
+  // that starts now. The caller must hold mutex_.
+  void UpdateLoadLocked(const std::vector<Entry *> &batch,
+                        Clock::time_point now) {
+    if (config_.overload_deadline_ms > 0) {
+      for (const auto *e : batch) {
+        float delay_ms =
+            std::chrono::duration<float, std::milli>(now - e->ready_time)
+                .count();
+        float miss = delay_ms > config_.overload_deadline_ms ? 1 : 0;
+        miss_rate_ += kMissRateWeight * (miss - miss_rate_);
+      }
+    }
+
+    int32_t depth = num_queued_;
+    bool deep = config_.overload_queue_depth > 0 &&
+                depth > config_.overload_queue_depth;
+    bool late = config_.overload_deadline_ms > 0 &&
+                miss_rate_ > config_.overload_miss_rate;
+
+    if (!overloaded_ && (deep || late)) {
+      overloaded_ = true;
+      overloaded_since_ = now;
+      ++num_overloads_;
+      return;
+    }
+
+    // Recover only well below the thresholds, so that a load near them does
+    // not switch the streams back and forth
+    bool shallow = config_.overload_queue_depth == 0 ||
+                   2 * depth <= config_.overload_queue_depth;
+    if (overloaded_ && shallow &&
+        2 * miss_rate_ <= config_.overload_miss_rate) {
+      overloaded_ = false;
+      overloaded_seconds_ +=
+          std::chrono::duration<double>(now - overloaded_since_).count();
+    }
+  }
+
+  // Return the number of ncnn threads of a batch that starts now, see
+  // StreamSchedulerConfig::thread_budget. The caller must hold mutex_ and
+  // be counted in num_busy_.
+  int32_t NumThreadsPerBatchLocked() const {
+    int32_t max_batch_size = MaxBatchSize();
+    int32_t num_batches =
+        num_busy_ + (num_queued_ + max_batch_size - 1) / max_batch_size;
+    num_batches = std::min(num_batches, config_.num_threads);
+
+    return std::max(1, config_.thread_budget / num_batches);
+  }
+
+  // Return true if a is more urgent than b: it has a higher priority or
+  // the same priority and an earlier deadline
+  static bool Before(const Entry *a, const Entry *b) {
+    if (a->priority != b->priority) return a->priority > b->priority;
+    return a->deadline < b->deadline;
+  }
+
+  // Move up to MaxBatchSize() - batch->size() streams into batch, the most
+  // urgent of all queues first, so that urgent streams queued on a busy
+  // worker are not left behind. The own queue wins ties, and a thief takes
+  // at most half of a victim's queue.
+  void TakeStreams(int32_t id, std::vector<Entry *> *batch) {
+    int32_t max_batch_size = MaxBatchSize();
+    int32_t num_workers = config_.num_threads;
+
+    // Every worker locks the queues in the same order
+    std::vector<std::unique_lock<std::mutex>> locks;
+    locks.reserve(num_workers);
+    for (auto &w : workers_) {
+      locks.emplace_back(w->mutex);
+    }
+
+    std::vector<int32_t> quota(num_workers);
+    for (int32_t k = 0; k != num_workers; ++k) {
+      int32_t size = workers_[k]->queue.size();
+      quota[k] = k == id ? size : (size + 1) / 2;
+    }
+
+    while (static_cast<int32_t>(batch->size()) < max_batch_size) {
+      Worker *best = nullptr;
+      int32_t best_index = 0;
+      for (int32_t k = 0; k != num_workers; ++k) {
+        int32_t i = (id + k) % num_workers;
+        Worker *w = workers_[i].get();
+        if (quota[i] == 0) continue;
+
+        if (!best || Before(w->queue.front(), best->queue.front())) {
+          best = w;
+          best_index = i;
+        }
+      }
+
+      if (!best) break;
+
+      batch->push_back(best->queue.front());
+      best->queue.pop_front();
+      --quota[best_index];
+      --num_queued_;
+    }
+  }
+
+  // Move deadline forward to the latency targets of batch[start:]
+  static void ApplyLatencyTargets(const std::vector<Entry *> &batch,
+                                  int32_t start, Clock::time_point *deadline) {
+    for (int32_t i = start; i < static_cast<int32_t>(batch.size()); ++i) {
+      if (batch[i]->has_latency_target) {
+        *deadline = std::min(*deadline, batch[i]->deadline);
+      }
+    }
+  }
+
+  void Run(int32_t id) {
+    std::vector<Entry *> batch;
+    auto max_latency = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<float, std::milli>(config_.max_latency_ms));
+
+    while (true) {
+      batch.clear();
+      TakeStreams(id, &batch);
+
+      if (batch.empty()) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return stop_ || num_queued_ > 0; });
+        if (stop_) return;
+        continue;
+      }
+
+      // Give other streams a chance to join the batch, but do not delay
+      // the oldest one by more than max_latency_ms or any of them past its
+      // latency target
+      if (static_cast<int32_t>(batch.size()) < MaxBatchSize() &&
+          max_latency.count() > 0) {
+        Clock::time_point deadline = batch[0]->ready_time;
+        for (const auto *e : batch) {
+          deadline = std::min(deadline, e->ready_time);
+        }
+        deadline += max_latency;
+        ApplyLatencyTargets(batch, 0, &deadline);
+
+        while (static_cast<int32_t>(batch.size()) < MaxBatchSize()) {
+          {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (!cv_.wait_until(lock, deadline, [this]() {
+                  return stop_ || num_queued_ > 0;
+                })) {
+              break;
+            }
+
+            if (stop_) return;
+          }
+
+          int32_t num_taken = batch.size();
+          TakeStreams(id, &batch);
+          ApplyLatencyTargets(batch, num_taken, &deadline);
+        }
+      }
+
+      Process(batch);
+    }
+  }
+
+  void Process(const std::vector<Entry *> &batch) {
+    int32_t n = batch.size();
+
+    // Snapshot the flags that other threads may change
+    std::vector<char> removed(n);
+    std::vector<char> input_finished(n);
+    bool overloaded = false;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (int32_t i = 0; i != n; ++i) {
+        removed[i] = batch[i]->removed;
+        input_finished[i] = batch[i]->input_finished;
+      }
+
+      UpdateLoadLocked(batch, Clock::now());
+      overloaded = overloaded_;
+
+      ++num_busy_;
+      if (config_.thread_budget > 0) {
+        num_threads_per_batch_ = NumThreadsPerBatchLocked();
+        Model::SetThreadNumThreads(num_threads_per_batch_);
+      }
+    }
+
+    std::vector<Stream *> ready;
+    std::vector<Entry *> decoded;
+    std::vector<Entry *> finished;
+    std::vector<char> is_finished(n);
+    for (int32_t i = 0; i != n; ++i) {
+      if (removed[i]) continue;
+
+      Entry *e = batch[i];
+      if (recognizer_->IsReady(e->s)) {
+        ready.push_back(e->s);
+        decoded.push_back(e);
+      } else if (input_finished[i]) {
+        finished.push_back(e);
+        is_finished[i] = true;
+      }
+    }
+
+    for (auto *e : decoded) {
+      if (overloaded && !e->degraded && !recognizer_->IsGreedySearch(e->s)) {
+        recognizer_->SetGreedySearch(e->s, true);
+        e->degraded = true;
+      } else if (!overloaded && e->degraded) {
+        recognizer_->SetGreedySearch(e->s, false);
+        e->degraded = false;
+      }
+    }
+
+    if (!ready.empty()) {
+      recognizer_->DecodeStreams(ready.data(), ready.size());
+    }
+
+    for (auto *e : decoded) {
+      Stream *s = e->s;
+      if (recognizer_->IsEndpoint(s)) {
+        s->Finalize();
+        auto r = recognizer_->GetResult(s);
+        if (!r.text.empty()) {
+          callback_(s, r, true, false);
+        }
+
+        recognizer_->Reset(s);
+        e->last_text.clear();
+        continue;
+      }
+
+      auto r = recognizer_->GetResult(s);
+      if (r.text != e->last_text) {
+        e->last_text = r.text;
+        callback_(s, r, false, false);
+      }
+    }
+
+    // Finished streams leave the scheduler before the last callback, since
+    // the callback may free the stream
+    std::vector<std::unique_ptr<Entry>> done;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (auto *e : finished) {
+        auto it = entries_.find(e->s);
+        done.push_back(std::move(it->second));
+        entries_.erase(it);
+      }
+    }
+
+    for (auto &e : done) {
+      Stream *s = e->s;
+      s->Finalize();
+      callback_(s, recognizer_->GetResult(s), true, true);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    num_scheduled_ -= n;
+    --num_busy_;
+
+    for (int32_t i = 0; i != n; ++i) {
+      if (is_finished[i]) continue;
+
+      Entry *e = batch[i];
+      if (!removed[i]) {
+        Stream *s = e->s;
+        e->pending_seconds =
+            (s->NumFramesReady() - s->GetNumProcessedFrames()) *
+            frame_shift_s_;
+        e->new_seconds = 0;
+      }
+
+      e->scheduled = false;
+      ScheduleLocked(e);
+    }
+
+    done_cv_.notify_all();
+  }
+
+ private:
+  const Recognizer *recognizer_;
+  StreamSchedulerConfig config_;
+  Callback callback_;
+
+  // In seconds
+  float frame_shift_s_;
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<std::thread> threads_;
+
+  // Protects entries_, the fields of Entry marked above, num_scheduled_,
+  // stop_ and the load statistics. It is acquired before any
+  // Worker::mutex.
+  mutable std::mutex mutex_;
+
+  // Signaled when streams are queued or stop_ is set
+  std::condition_variable cv_;
+
+  // Signaled when a batch is done
+  std::condition_variable done_cv_;
+
+  std::unordered_map<Stream *, std::unique_ptr<Entry>> entries_;
+  int32_t next_home_ = 0;
+  int32_t num_scheduled_ = 0;
+  bool stop_ = false;
+
+  // Number of workers that are processing a batch
+  int32_t num_busy_ = 0;
+  int32_t num_threads_per_batch_ = 0;
+
+  // Number of streams in all worker queues
+  std::atomic<int32_t> num_queued_{0};
+
+  // Written under mutex_, but read without it to size batches
+  std::atomic<bool> overloaded_{false};
+
+  Clock::time_point overloaded_since_;
+  int64_t num_overloads_ = 0;
+  double overloaded_seconds_ = 0;
+  float miss_rate_ = 0;
+};
+
+StreamScheduler::StreamScheduler(const Recognizer *recognizer,
+                                 const StreamSchedulerConfig &config,
+                                 Callback callback)
+    : impl_(std::make_unique<Impl>(recognizer, config, std::move(callback))) {}
+
+StreamScheduler::~StreamScheduler() = default;
+
+void StreamScheduler::AddStream(Stream *s) { impl_->AddStream(s); }
+
+void StreamScheduler::AcceptWaveform(Stream *s, int32_t sampling_rate,
+                                     const float *waveform, int32_t n) {
+  s->AcceptWaveform(sampling_rate, waveform, n);
+  impl_->Notify(s, static_cast<float>(n) / sampling_rate);
+}
+
+void StreamScheduler::AcceptWaveformInt16(Stream *s, int32_t sampling_rate,
+                                          const int16_t *waveform,
+                                          int32_t n) {
+  s->AcceptWaveformInt16(sampling_rate, waveform, n);
+  impl_->Notify(s, static_cast<float>(n) / sampling_rate);
+}
+
+void StreamScheduler::Notify(Stream *s) { impl_->Notify(s); }
+
+void StreamScheduler::InputFinished(Stream *s) { impl_->InputFinished(s); }
+
+void StreamScheduler::RemoveStream(Stream *s) { impl_->RemoveStream(s); }
+
+void StreamScheduler::WaitBacklog(Stream *s, float max_seconds) {
+  impl_->WaitBacklog(s, max_seconds);
+}
+
+void StreamScheduler::WaitIdle() { impl_->WaitIdle(); }
+
+bool StreamScheduler::IsOverloaded() const { return impl_->IsOverloaded(); }
+
+StreamSchedulerStats StreamScheduler::GetStats() const {
+  return impl_->GetStats();
+}
+
+}  // namespace sherpa_ncnn
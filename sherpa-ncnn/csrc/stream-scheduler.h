@@ -0,0 +1,203 @@
+// sherpa-ncnn/csrc/stream-scheduler.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_STREAM_SCHEDULER_H_
+#define SHERPA_NCNN_CSRC_STREAM_SCHEDULER_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "sherpa-ncnn/csrc/recognizer.h"
+#include "sherpa-ncnn/csrc/stream.h"
+
+namespace sherpa_ncnn {
+
+struct StreamSchedulerConfig {
+  // Number of worker threads that decode streams
+  int32_t num_threads = 2;
+
+  // A worker passes at most this many streams to one
+  // Recognizer::DecodeStreams() call
+  int32_t max_batch_size = 8;
+
+  // If a worker has fewer than max_batch_size ready streams, it waits at
+  // most this long after the oldest of them became ready for more streams
+  // to join the batch. 0 means decode immediately.
+  float max_latency_ms = 5;
+
+  // The scheduler is overloaded while more than overload_queue_depth
+  // streams wait for a worker, or while more than overload_miss_rate of
+  // the recent chunks waited longer than overload_deadline_ms after they
+  // became ready. It recovers once both are at most half of that. Set
+  // overload_queue_depth or overload_deadline_ms to 0 to disable its
+  // condition.
+  //
+  // While it is overloaded, the streams it decodes are switched to greedy
+  // search, see Recognizer::SetGreedySearch(), and switched back at their
+  // next chunk after it recovers.
+  int32_t overload_queue_depth = 0;
+  float overload_deadline_ms = 0;
+  float overload_miss_rate = 0.2;
+
+  // max_batch_size while the scheduler is overloaded. 0 means max_batch_size.
+  int32_t overload_max_batch_size = 0;
+
+  // If positive, the workers share this many ncnn threads, e.g., the
+  // number of CPU cores, instead of each using num_threads of the
+  // networks. Before each batch, a worker takes thread_budget / n of them,
+  // at least 1, where n is the number of batches that are expected to run
+  // at the same time: those of the busy workers and those that the queued
+  // streams make, at most num_threads. So under a light load a batch runs
+  // its networks on many threads for a low latency, and under a heavy
+  // load on one thread each while the workers run in parallel.
+  int32_t thread_budget = 0;
+
+  StreamSchedulerConfig() = default;
+
+  StreamSchedulerConfig(int32_t num_threads, int32_t max_batch_size,
+                        float max_latency_ms)
+      : num_threads(num_threads),
+        max_batch_size(max_batch_size),
+        max_latency_ms(max_latency_ms) {}
+
+  std::string ToString() const;
+};
+
+struct StreamSchedulerStats {
+  // See StreamSchedulerConfig::overload_queue_depth
+  bool overloaded = false;
+
+  // Number of times the scheduler became overloaded. It recovered as often,
+  // unless it is overloaded now.
+  int64_t num_overloads = 0;
+
+  // Time spent overloaded, including the current period
+  double overloaded_seconds = 0;
+
+  // Number of streams that wait for a worker
+  int32_t queue_depth = 0;
+
+  // Fraction of the recent chunks that missed overload_deadline_ms
+  float miss_rate = 0;
+
+  // Number of ncnn threads of the latest batch with thread_budget
+  int32_t num_threads_per_batch = 0;
+
+  std::string ToString() const;
+};
+
+/** Decode many streams of a recognizer on a pool of worker threads.
+ *
+ * It replaces the loop
+ *
+ *    while (recognizer.IsReady(s)) recognizer.DecodeStream(s);
+ *
+ * that every caller would otherwise write. A stream becomes ready once it
+ * has Model::Segment() frames that are not decoded yet. Ready streams are
+ * queued on the worker that owns them. Each worker decodes batches of the
+ * most urgent ready streams, taking them from its own queue and, if
+ * others are more urgent, from the queues of the other workers.
+ *
+ * Streams are ordered by Stream::GetPriority() and then by the deadline
+ * given by Stream::GetLatencyTarget(), so, e.g., interactive streams of a
+ * higher priority always go into the next batch and bulk streams fill the
+ * rest of it.
+ *
+ * Results are delivered through the callback passed to the constructor.
+ * The callback runs on a worker thread; calls for the same stream never
+ * overlap and arrive in order.
+ *
+ * Usage:
+ *
+ *   StreamScheduler scheduler(&recognizer, config, callback);
+ *   auto s = recognizer.CreateStream();
+ *   scheduler.AddStream(s.get());
+ *   // from the audio thread of s
+ *   scheduler.AcceptWaveform(s.get(), 16000, samples, n);
+ *   ...
+ *   scheduler.InputFinished(s.get());
+ *   // s can be freed once the callback has been invoked with is_last true
+ */
+class StreamScheduler {
+ public:
+  /**
+   * @param s The stream
+   * @param result Its current result
+   * @param is_final True if an endpoint was detected or the stream ended.
+   *                 The stream is Reset() after an endpoint and result is
+   *                 the complete text of the segment.
+   * @param is_last True if InputFinished() was called for s and all of its
+   *                frames are decoded. It is the last call for s, after
+   *                which the scheduler no longer refers to s.
+   *
+   * If is_final is false, it is a partial result. Partial results are
+   * delivered only when the text changes.
+   */
+  using Callback = std::function<void(Stream *s, const RecognitionResult &result,
+                                      bool is_final, bool is_last)>;
+
+  StreamScheduler(const Recognizer *recognizer,
+                  const StreamSchedulerConfig &config, Callback callback);
+
+  // Stop the workers. Streams that are not finished are dropped without
+  // further callbacks.
+  ~StreamScheduler();
+
+  StreamScheduler(const StreamScheduler &) = delete;
+  StreamScheduler &operator=(const StreamScheduler &) = delete;
+
+  // Start scheduling s. It must be created by the recognizer of this
+  // scheduler and must outlive the scheduling, see RemoveStream().
+  void AddStream(Stream *s);
+
+  // Feed samples to s and schedule it if it becomes ready. It may run
+  // concurrently with the decoding of s.
+  void AcceptWaveform(Stream *s, int32_t sampling_rate, const float *waveform,
+                      int32_t n);
+
+  // Same as AcceptWaveform() but for 16-bit PCM samples
+  void AcceptWaveformInt16(Stream *s, int32_t sampling_rate,
+                           const int16_t *waveform, int32_t n);
+
+  // Tell the scheduler that s has new samples if they were fed through
+  // Stream::AcceptWaveform() directly
+  void Notify(Stream *s);
+
+  // No more samples for s. Its remaining frames are decoded and the
+  // callback is invoked with is_last true.
+  void InputFinished(Stream *s);
+
+  // Stop scheduling s without a final callback. It waits until s is not
+  // being decoded, so s can be freed after it returns. Do not call it from
+  // the callback.
+  void RemoveStream(Stream *s);
+
+  /** Wait until s has at most max_seconds of audio that is not decoded
+   * yet, e.g., so that a thread that reads a file does not run ahead of
+   * the decoding. It returns at once if s is not queued or being decoded,
+   * since it then needs more samples. Do not call it from the callback.
+   */
+  void WaitBacklog(Stream *s, float max_seconds);
+
+  // Wait until no stream is ready or being decoded
+  void WaitIdle();
+
+  /** Return true if the scheduler is overloaded, see
+   * StreamSchedulerConfig::overload_queue_depth. Callers may use it to skip
+   * optional work, e.g., a second pass over the final results.
+   */
+  bool IsOverloaded() const;
+
+  StreamSchedulerStats GetStats() const;
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_STREAM_SCHEDULER_H_
@@ -0,0 +1,299 @@
+// sherpa-ncnn/csrc/stream-snapshot.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/stream-snapshot.h"
+
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/macros.h"
+
+namespace sherpa_ncnn {
+
+namespace {
+
+constexpr char kMagic[8] = {'S', 'N', 'C', 'N', 'N', 'S', 'T', 'R'};
+constexpr uint32_t kVersion = 1;
+
+class Writer {
+ public:
+  template <typename T>
+  void Write(const T &v) {
+    buf_.append(reinterpret_cast<const char *>(&v), sizeof(T));
+  }
+
+  template <typename T>
+  void WriteArray(const T *p, int32_t n) {
+    Write(n);
+    buf_.append(reinterpret_cast<const char *>(p), n * sizeof(T));
+  }
+
+  // Return false if m is not float32 with elempack 1
+  bool WriteMat(const ncnn::Mat &m) {
+    if (!m.empty() && (m.elemsize != 4 || m.elempack != 1)) {
+      return false;
+    }
+
+    int32_t dims = m.empty() ? 0 : m.dims;
+    Write(dims);
+    Write<int32_t>(dims ? m.w : 0);
+    Write<int32_t>(dims ? m.h : 0);
+    Write<int32_t>(dims ? m.d : 0);
+    Write<int32_t>(dims ? m.c : 0);
+
+    if (dims) {
+      std::size_t n = static_cast<std::size_t>(m.w) * m.h * m.d;
+      for (int32_t q = 0; q != m.c; ++q) {
+        buf_.append(static_cast<const char *>(m.channel(q).data),
+                    n * sizeof(float));
+      }
+    }
+
+    return true;
+  }
+
+  std::string &Buffer() { return buf_; }
+
+ private:
+  std::string buf_;
+};
+
+class Reader {
+ public:
+  Reader(const void *data, std::size_t size)
+      : p_(static_cast<const unsigned char *>(data)), end_(p_ + size) {}
+
+  template <typename T>
+  bool Read(T *v) {
+    if (static_cast<std::size_t>(end_ - p_) < sizeof(T)) return false;
+    std::memcpy(v, p_, sizeof(T));
+    p_ += sizeof(T);
+    return true;
+  }
+
+  template <typename T>
+  bool ReadArray(std::vector<T> *v) {
+    int32_t n = 0;
+    if (!Read(&n) || n < 0 ||
+        static_cast<std::size_t>(end_ - p_) / sizeof(T) <
+            static_cast<std::size_t>(n)) {
+      return false;
+    }
+
+    v->resize(n);
+    std::memcpy(v->data(), p_, n * sizeof(T));
+    p_ += n * sizeof(T);
+    return true;
+  }
+
+  bool ReadMat(ncnn::Mat *m) {
+    int32_t dims = 0, w = 0, h = 0, d = 0, c = 0;
+    if (!Read(&dims) || !Read(&w) || !Read(&h) || !Read(&d) || !Read(&c)) {
+      return false;
+    }
+
+    switch (dims) {
+      case 0:
+        m->release();
+        return true;
+      case 1:
+        m->create(w);
+        break;
+      case 2:
+        m->create(w, h);
+        break;
+      case 3:
+        m->create(w, h, c);
+        break;
+      case 4:
+        m->create(w, h, d, c);
+        break;
+      default:
+        return false;
+    }
+
+    if (m->empty() || m->w != w || m->h != h || m->d != d || m->c != c) {
+      return false;
+    }
+
+    std::size_t n = static_cast<std::size_t>(w) * h * d * sizeof(float);
+    if (static_cast<std::size_t>(end_ - p_) / n <
+        static_cast<std::size_t>(c)) {
+      return false;
+    }
+
+    for (int32_t q = 0; q != c; ++q) {
+      std::memcpy(m->channel(q).data, p_, n);
+      p_ += n;
+    }
+
+    return true;
+  }
+
+  bool Done() const { return p_ == end_; }
+
+ private:
+  const unsigned char *p_;
+  const unsigned char *end_;
+};
+
+bool SameShape(const ncnn::Mat &a, const ncnn::Mat &b) {
+  return a.dims == b.dims && a.w == b.w && a.h == b.h && a.d == b.d &&
+         a.c == b.c;
+}
+
+}  // namespace
+
+std::string SaveStreamState(Stream *s) {
+  Writer w;
+  w.Buffer().append(kMagic, sizeof(kMagic));
+  w.Write(kVersion);
+
+  int32_t num_processed_frames = s->GetNumProcessedFrames();
+  w.Write(num_processed_frames);
+
+  const DecoderResult &r = s->GetResult();
+  w.Write(r.frame_offset);
+  w.Write(r.num_trailing_blanks);
+  w.WriteArray(r.tokens.data(), r.tokens.size());
+  w.WriteArray(r.timestamps.data(), r.timestamps.size());
+  if (!w.WriteMat(r.decoder_out)) {
+    SHERPA_NCNN_LOGE("decoder_out must be float32 to save a stream");
+    return {};
+  }
+
+  w.Write<int32_t>(r.hyps.Size());
+  std::vector<const TokenNode *> nodes;
+  for (const auto &hyp : r.hyps) {
+    w.Write(hyp.log_prob);
+    w.Write(hyp.num_trailing_blanks);
+
+    nodes.clear();
+    for (const TokenNode *n = hyp.tail.get(); n; n = n->prev.get()) {
+      nodes.push_back(n);
+    }
+
+    w.Write<int32_t>(nodes.size());
+    for (auto it = nodes.rbegin(); it != nodes.rend(); ++it) {
+      w.Write((*it)->token);
+      w.Write((*it)->timestamp);
+    }
+  }
+
+  s->DownloadStates();
+  const auto &states = s->GetStates();
+  w.Write<int32_t>(states.size());
+  for (const auto &m : states) {
+    if (!w.WriteMat(m)) {
+      SHERPA_NCNN_LOGE("Encoder states must be float32 to save a stream");
+      return {};
+    }
+  }
+
+  int32_t num_frames = s->NumFramesReady() - num_processed_frames;
+  ncnn::Mat frames;
+  if (num_frames > 0) {
+    frames = s->GetFrames(num_processed_frames, num_frames);
+  } else {
+    num_frames = 0;
+  }
+
+  w.Write<int32_t>(num_frames ? frames.w : 0);
+  w.WriteArray(static_cast<const float *>(frames.data),
+               num_frames * frames.w);
+
+  return std::move(w.Buffer());
+}
+
+bool RestoreStreamState(const void *data, std::size_t size,
+                        const Model &model, int32_t feature_dim, Stream *s) {
+  Reader r(data, size);
+
+  char magic[sizeof(kMagic)];
+  uint32_t version = 0;
+  if (!r.Read(&magic) || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 ||
+      !r.Read(&version)) {
+    SHERPA_NCNN_LOGE("Not a snapshot of a stream");
+    return false;
+  }
+
+  if (version != kVersion) {
+    SHERPA_NCNN_LOGE("Unsupported version %u of the snapshot (expected %u)",
+                     version, kVersion);
+    return false;
+  }
+
+  int32_t num_processed_frames = 0;
+  DecoderResult result;
+  bool ok = r.Read(&num_processed_frames) && r.Read(&result.frame_offset) &&
+            r.Read(&result.num_trailing_blanks) &&
+            r.ReadArray(&result.tokens) && r.ReadArray(&result.timestamps) &&
+            r.ReadMat(&result.decoder_out);
+
+  int32_t num_hyps = 0;
+  ok = ok && r.Read(&num_hyps) && num_hyps >= 0;
+
+  const ContextGraphPtr &graph = s->GetContextGraph();
+  const ContextState *root = graph ? graph->Root() : nullptr;
+
+  result.hyps.Reserve(num_hyps);
+  for (int32_t i = 0; ok && i != num_hyps; ++i) {
+    Hypothesis hyp;
+    hyp.context_state = root;
+
+    int32_t num_tokens = 0;
+    ok = r.Read(&hyp.log_prob) && r.Read(&hyp.num_trailing_blanks) &&
+         r.Read(&num_tokens) && num_tokens >= 0;
+
+    for (int32_t k = 0; ok && k != num_tokens; ++k) {
+      int32_t token = 0, timestamp = 0;
+      ok = r.Read(&token) && r.Read(&timestamp);
+      hyp.AddToken(token, timestamp);
+    }
+
+    result.hyps.Add(std::move(hyp));
+  }
+
+  std::vector<ncnn::Mat> init_states = model.GetEncoderInitStates();
+  int32_t num_states = 0;
+  ok = ok && r.Read(&num_states) &&
+       num_states == static_cast<int32_t>(init_states.size());
+
+  std::vector<ncnn::Mat> states(ok ? num_states : 0);
+  for (int32_t i = 0; ok && i != num_states; ++i) {
+    ok = r.ReadMat(&states[i]) && SameShape(states[i], init_states[i]);
+  }
+
+  int32_t saved_feature_dim = 0;
+  std::vector<float> frames;
+  ok = ok && r.Read(&saved_feature_dim) && r.ReadArray(&frames) && r.Done();
+
+  if (!ok) {
+    SHERPA_NCNN_LOGE("Invalid or truncated snapshot of a stream");
+    return false;
+  }
+
+  int32_t num_frames = saved_feature_dim ? frames.size() / saved_feature_dim
+                                         : 0;
+  if (num_frames && saved_feature_dim != feature_dim) {
+    SHERPA_NCNN_LOGE("Feature dim of the snapshot is %d. Expected: %d",
+                     saved_feature_dim, feature_dim);
+    return false;
+  }
+
+  int32_t frame_offset = result.frame_offset;
+  s->SetResult(result);
+  // SetResult() keeps the frame offset of the stream
+  s->GetResult().frame_offset = frame_offset;
+
+  s->SetStates(states, model.GetEncoderStateLayout());
+  s->RestoreFrames(num_processed_frames, frames.data(), num_frames,
+                   feature_dim);
+
+  return true;
+}
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,75 @@
+// sherpa-ncnn/csrc/stream-snapshot.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_STREAM_SNAPSHOT_H_
+#define SHERPA_NCNN_CSRC_STREAM_SNAPSHOT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "sherpa-ncnn/csrc/model.h"
+#include "sherpa-ncnn/csrc/stream.h"
+
+namespace sherpa_ncnn {
+
+/** A snapshot of the decoding state of a stream, so that decoding can
+ * continue in another process, e.g., on another node after a failover.
+ * Restoring it costs a few copies instead of decoding the audio again.
+ *
+ * Layout. Integers and floats use the byte order of the host, as ncnn .bin
+ * files do. A mat is int32 dims, w, h, d, c followed by its w * h * d * c
+ * floats without padding; an array is int32 n followed by n elements.
+ *
+ *   - Header, 12 bytes: the magic "SNCNNSTR" and uint32 version (1)
+ *   - int32 num_processed_frames, see Stream::GetNumProcessedFrames()
+ *   - DecoderResult: int32 frame_offset, int32 num_trailing_blanks, the
+ *     arrays tokens and timestamps, the mat decoder_out and an array of
+ *     hypotheses. A hypothesis is double log_prob, int32
+ *     num_trailing_blanks and an array of (token, timestamp) pairs.
+ *   - An array of the mats of the encoder states
+ *   - int32 feature_dim and the array of fbank frames that are not
+ *     processed yet, feature_dim floats each
+ *
+ * Not saved:
+ *   - Samples that are not part of a complete frame yet, i.e., less than
+ *     one frame shift plus the window. The first frames computed after
+ *     restoring start from new audio only.
+ *   - The positions of hypotheses in the context graph. Partial matches of
+ *     hotwords start again from the root of the graph of the new stream.
+ *   - Whether InputFinished() was called
+ *   - The counters of Stream::AcceptSpeechProbability()
+ */
+
+/** Save the decoding state of s.
+ *
+ * It reads the frames of s that are not processed yet with GetFrames(), so
+ * with FeatureExtractorConfig::lock_free it must be called by the thread
+ * that decodes s. Encoder states on a GPU are downloaded first.
+ *
+ * @return Return an empty string if the state cannot be saved, e.g., the
+ *         states are not float32.
+ */
+std::string SaveStreamState(Stream *s);
+
+/** Restore a state saved by SaveStreamState() into s.
+ *
+ * @param data  The output of SaveStreamState(). It is copied.
+ * @param size  Number of bytes in data.
+ * @param model  The model of the recognizer of s. The saved states must
+ *               have the shapes of Model::GetEncoderInitStates().
+ * @param feature_dim  The feature dimension of s. The saved frames must
+ *                     have it.
+ * @param s  A new stream of a recognizer with the same model as the
+ *           saved stream. No waveform must have been accepted yet.
+ *
+ * @return Return false if data is not a valid snapshot for the model. s is
+ *         then unchanged.
+ */
+bool RestoreStreamState(const void *data, std::size_t size,
+                        const Model &model, int32_t feature_dim, Stream *s);
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_STREAM_SNAPSHOT_H_
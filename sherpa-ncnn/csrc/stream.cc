@@ -18,8 +18,17 @@
 
 #include "sherpa-ncnn/csrc/stream.h"
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <memory>
 #include <utility>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/metrics.h"
+#include "sherpa-ncnn/csrc/pcm-utils.h"
+#include "sherpa-ncnn/csrc/session-recorder.h"
+#include "sherpa-ncnn/csrc/trace.h"
 
 namespace sherpa_ncnn {
 
@@ -27,41 +36,222 @@ class Stream::Impl {
  public:
   explicit Impl(const FeatureExtractorConfig &config,
                 ContextGraphPtr context_graph)
-      : feat_extractor_(config), context_graph_(context_graph) {}
+      : feat_config_(config),
+        feat_extractor_(std::make_unique<FeatureExtractor>(config)),
+        context_graph_(context_graph) {
+    static std::atomic<int64_t> next_id{0};
+    id_ = next_id++;
+  }
+
+  // Take the buffers of other, which is being recycled, see
+  // Stream::Recycle(). Their content is not used.
+  void AdoptBuffers(Impl *other) {
+    states_ = std::move(other->states_);
+    next_states_ = std::move(other->next_states_);
+    layout_ = other->layout_;
+
+    result_.tokens = std::move(other->result_.tokens);
+    result_.tokens.clear();
+    result_.timestamps = std::move(other->result_.timestamps);
+    result_.timestamps.clear();
+
+    restored_frames_ = std::move(other->restored_frames_);
+    restored_frames_.clear();
+  }
+
+  const FeatureExtractorConfig &GetFeatureConfig() const {
+    return feat_config_;
+  }
 
   void AcceptWaveform(int32_t sampling_rate, const float *waveform, int32_t n) {
-    feat_extractor_.AcceptWaveform(sampling_rate, waveform, n);
+    TraceStreamScope trace_scope(id_);
+    TraceSpan span("accept_waveform");
+    ProfileScope scope(stats_.get(), parent_stats_.get());
+    ScopedStageTimer timer(Stage::kFeatureExtraction);
+
+    UnparkFeatures();
+    feat_extractor_->AcceptWaveform(sampling_rate, waveform, n);
+  }
+
+  void AcceptWaveformInt16(int32_t sampling_rate, const int16_t *waveform,
+                           int32_t n) {
+    TraceStreamScope trace_scope(id_);
+    TraceSpan span("accept_waveform");
+    ProfileScope scope(stats_.get(), parent_stats_.get());
+    ScopedStageTimer timer(Stage::kFeatureExtraction);
+
+    UnparkFeatures();
+    feat_extractor_->AcceptWaveformInt16(sampling_rate, waveform, n);
   }
 
-  void InputFinished() { feat_extractor_.InputFinished(); }
+  void InputFinished() {
+    if (external_frames_) {
+      input_finished_ = true;
+      return;
+    }
+
+    UnparkFeatures();
+    feat_extractor_->InputFinished();
+  }
 
   int32_t NumFramesReady() const {
-    return feat_extractor_.NumFramesReady() - start_frame_index_;
+    int32_t n = feat_extractor_ ? feat_extractor_->NumFramesReady() : 0;
+    return num_restored_frames_ + n - start_frame_index_;
   }
 
   bool IsLastFrame(int32_t frame) const {
-    return feat_extractor_.IsLastFrame(frame);
+    if (external_frames_) {
+      return input_finished_ &&
+             frame + start_frame_index_ == num_restored_frames_ - 1;
+    }
+
+    // Frame indexes of the stream start at the last Reset(), see GetFrames()
+    return feat_extractor_ &&
+           feat_extractor_->IsLastFrame(frame + start_frame_index_ -
+                                        num_restored_frames_);
   }
 
   ncnn::Mat GetFrames(int32_t frame_index, int32_t n) const {
-    return feat_extractor_.GetFrames(frame_index + start_frame_index_, n);
+    int32_t k = frame_index + start_frame_index_;
+    if (k >= num_restored_frames_) {
+      return feat_extractor_->GetFrames(k - num_restored_frames_, n);
+    }
+
+    // Some of the frames are from RestoreFrames()
+    int32_t dim = restored_feature_dim_;
+    int32_t num_restored = std::min(n, num_restored_frames_ - k);
+
+    ncnn::Mat features;
+    features.create(dim, n);
+
+    const float *src =
+        restored_frames_.data() + (k - num_dropped_frames_) * dim;
+    std::copy(src, src + num_restored * dim, static_cast<float *>(features));
+
+    if (num_restored < n) {
+      ncnn::Mat rest = feat_extractor_->GetFrames(0, n - num_restored);
+      std::copy(static_cast<const float *>(rest),
+                static_cast<const float *>(rest) + rest.w * rest.h,
+                features.row(num_restored));
+    }
+
+    return features;
+  }
+
+  void RestoreFrames(int32_t num_processed_frames, const float *frames,
+                     int32_t n, int32_t feature_dim) {
+    restored_frames_.assign(frames, frames + n * feature_dim);
+    num_restored_frames_ = n;
+    restored_feature_dim_ = feature_dim;
+    num_dropped_frames_ = 0;
+
+    // Frame num_processed_frames is the first restored frame
+    num_processed_frames_ = num_processed_frames;
+    start_frame_index_ = -num_processed_frames;
+  }
+
+  void AcceptFrames(const float *frames, int32_t n, int32_t feature_dim) {
+    if (!external_frames_) {
+      external_frames_ = true;
+      restored_feature_dim_ = feature_dim;
+      feat_extractor_.reset();
+    }
+
+    // Frames before the next one to decode are not needed any more
+    int32_t num_unused =
+        num_processed_frames_ + start_frame_index_ - num_dropped_frames_;
+    if (num_unused > 0) {
+      restored_frames_.erase(
+          restored_frames_.begin(),
+          restored_frames_.begin() + num_unused * feature_dim);
+      num_dropped_frames_ += num_unused;
+    }
+
+    restored_frames_.insert(restored_frames_.end(), frames,
+                            frames + n * feature_dim);
+    num_restored_frames_ += n;
+  }
+
+  // Return nullptr if the stream is parked
+  FeatureExtractor *GetFeatureExtractor() { return feat_extractor_.get(); }
+
+  void Park() {
+    if (!feat_extractor_ && !parked_states_.empty()) return;
+
+    if (feat_extractor_) {
+      // Keep the frames that are not processed yet. The feature extractor
+      // is created again on the next audio.
+      int32_t num_frames = NumFramesReady() - num_processed_frames_;
+      std::vector<float> frames;
+      int32_t dim = 0;
+      if (num_frames > 0) {
+        ncnn::Mat m = GetFrames(num_processed_frames_, num_frames);
+        dim = m.w;
+        frames.assign(static_cast<const float *>(m),
+                      static_cast<const float *>(m) + m.w * m.h);
+      } else {
+        num_frames = 0;
+      }
+
+      RestoreFrames(num_processed_frames_, frames.data(), num_frames, dim);
+      restored_frames_.shrink_to_fit();
+      feat_extractor_.reset();
+    }
+
+    if (parked_states_.empty()) {
+      DownloadStates();
+      ParkStates();
+    }
+  }
+
+  bool IsParked() const {
+    return external_frames_ ? !parked_states_.empty() : !feat_extractor_;
+  }
+
+  void CompactStates() {
+    // States on the device are left there
+    if (!parked_states_.empty() || device_states_) return;
+
+    ParkStates();
   }
 
   void Reset() {
     start_frame_index_ += num_processed_frames_;
     num_processed_frames_ = 0;
+
+    if (vad_duration_ >= 0) {
+      vad_duration_ = 0;
+      vad_trailing_silence_ = 0;
+    }
   }
 
+  void AcceptSpeechProbability(float prob, float duration, float threshold) {
+    if (vad_duration_ < 0) vad_duration_ = 0;
+
+    vad_duration_ += duration;
+    if (prob >= threshold) {
+      vad_trailing_silence_ = 0;
+    } else {
+      vad_trailing_silence_ += duration;
+    }
+  }
+
+  bool HasSpeechProbability() const { return vad_duration_ >= 0; }
+
+  float GetVadDuration() const { return std::max(vad_duration_, 0.0f); }
+
+  float GetVadTrailingSilence() const { return vad_trailing_silence_; }
+
   void Finalize() {
     if (!context_graph_) return;
     auto &cur = result_.hyps;
     for (auto iter = cur.begin(); iter != cur.end(); ++iter) {
-      auto context_res = context_graph_->Finalize(iter->second.context_state);
-      iter->second.log_prob += context_res.first;
-      iter->second.context_state = context_res.second;
+      auto context_res = context_graph_->Finalize(iter->context_state);
+      iter->log_prob += context_res.first;
+      iter->context_state = context_res.second;
     }
     auto hyp = result_.hyps.GetMostProbable(true);
-    result_.tokens = std::move(hyp.ys);
+    result_.tokens = hyp.Ys();
   }
 
   int32_t &GetNumProcessedFrames() { return num_processed_frames_; }
@@ -70,37 +260,355 @@ class Stream::Impl {
     int32_t offset = result_.frame_offset;
     result_ = r;
     result_.frame_offset = offset;
+    cursor_.reset = true;
   }
 
+  ResultCursor &GetResultCursor() { return cursor_; }
+
   DecoderResult &GetResult() { return result_; }
 
-  void SetStates(const std::vector<ncnn::Mat> &states) { states_ = states; }
+  void PublishResult(std::shared_ptr<const RecognitionResult> r) {
+    std::atomic_store(&published_, std::move(r));
+  }
+
+  std::shared_ptr<const RecognitionResult> GetPublishedResult() const {
+    return std::atomic_load(&published_);
+  }
+
+  void SetStates(const std::vector<ncnn::Mat> &states) {
+    states_ = states;
+    device_states_.reset();
+    parked_states_.clear();
+  }
+
+  void SetStates(const std::vector<ncnn::Mat> &states,
+                 const EncoderStateLayout &layout) {
+    // The blocks of a recycled stream are reused
+    layout.Copy(states, &states_);
+    if (!layout.IsPacked(next_states_) ||
+        !IsWritablePackedState(next_states_[0])) {
+      next_states_ = layout.Allocate();
+    }
+    layout_ = layout;
+    device_states_.reset();
+    parked_states_.clear();
+  }
+
+  std::vector<ncnn::Mat> &GetStates() {
+    UnparkStates();
+    return states_;
+  }
+
+  std::vector<ncnn::Mat> &GetNextStates() {
+    UnparkStates();
+    return next_states_;
+  }
 
-  std::vector<ncnn::Mat> &GetStates() { return states_; }
+  void SwapStates() {
+    UnparkStates();
+    states_.swap(next_states_);
+  }
+
+  std::unique_ptr<DeviceStates> &GetDeviceStates() {
+    UnparkStates();
+    return device_states_;
+  }
+
+  void DownloadStates() {
+    UnparkStates();
+    if (device_states_) {
+      device_states_->Download(&states_);
+      device_states_.reset();
+    }
+  }
 
   const ContextGraphPtr &GetContextGraph() const { return context_graph_; }
 
+  void SetContextGraph(ContextGraphPtr context_graph) {
+    auto &cur = result_.hyps;
+    if (context_graph_) {
+      for (auto iter = cur.begin(); iter != cur.end(); ++iter) {
+        iter->log_prob += context_graph_->Finalize(iter->context_state).first;
+      }
+    }
+
+    context_graph_ = std::move(context_graph);
+
+    const ContextState *root =
+        context_graph_ ? context_graph_->Root() : nullptr;
+    for (auto iter = cur.begin(); iter != cur.end(); ++iter) {
+      iter->context_state = root;
+    }
+  }
+
+  int64_t GetId() const { return id_; }
+
+  int32_t GetEncoderIndex() const { return encoder_index_; }
+
+  void SetEncoderIndex(int32_t i) { encoder_index_ = i; }
+
+  void SetEncoderTap(EncoderTap tap, bool with_features) {
+    encoder_tap_ = std::move(tap);
+    encoder_tap_with_features_ = with_features;
+  }
+
+  const EncoderTap &GetEncoderTap() const { return encoder_tap_; }
+
+  bool EncoderTapWithFeatures() const { return encoder_tap_with_features_; }
+
+  void SetPriority(int32_t priority) { priority_ = priority; }
+
+  int32_t GetPriority() const { return priority_; }
+
+  void SetLatencyTarget(float latency_target_ms) {
+    latency_target_ms_ = latency_target_ms;
+  }
+
+  float GetLatencyTarget() const { return latency_target_ms_; }
+
+  void EnableLatencyStats(std::shared_ptr<LatencyStats> parent) {
+    stats_ = std::make_unique<LatencyStats>();
+    parent_stats_ = std::move(parent);
+  }
+
+  LatencyStats *GetLatencyStats() const { return stats_.get(); }
+
+  LatencyStats *GetParentLatencyStats() const { return parent_stats_.get(); }
+
+  StreamMemoryUsage GetMemoryUsage() const {
+    StreamMemoryUsage ans;
+    for (const auto *v : {&states_, &next_states_, &parked_states_}) {
+      ans.encoder_states += NumBytes(*v);
+    }
+
+    ans.features = restored_frames_.capacity() * sizeof(float);
+    if (feat_extractor_) {
+      ans.features += feat_extractor_->NumBytes();
+    }
+
+    ans.hypotheses =
+        (result_.tokens.capacity() + result_.timestamps.capacity()) *
+            sizeof(int32_t) +
+        result_.decoder_out.total() * result_.decoder_out.elemsize;
+    for (auto it = result_.hyps.begin(); it != result_.hyps.end(); ++it) {
+      ans.hypotheses +=
+          sizeof(Hypothesis) + it->NumTokens() * sizeof(TokenNode);
+    }
+
+    if (context_graph_) {
+      ans.context_graph = context_graph_->NumBytes();
+    }
+
+    return ans;
+  }
+
+  void SetMemoryReservation(std::unique_ptr<MemoryReservation> r) {
+    reservation_ = std::move(r);
+  }
+
  private:
-  FeatureExtractor feat_extractor_;
+  static std::size_t NumBytes(const std::vector<ncnn::Mat> &states) {
+    std::size_t ans = 0;
+    for (const auto &m : states) {
+      // The views of packed states add up to their buffer
+      ans += m.total() * m.elemsize;
+    }
+    return ans;
+  }
+
+  void UnparkFeatures() {
+    if (!feat_extractor_) {
+      feat_extractor_ = std::make_unique<FeatureExtractor>(feat_config_);
+    }
+  }
+
+  // Keep the states in fp16 in parked_states_ and free states_ and
+  // next_states_. The states must be on the host.
+  void ParkStates() {
+    ncnn::Option opt;
+    opt.num_threads = 1;
+    parked_states_.resize(states_.size());
+    for (std::size_t i = 0; i != states_.size(); ++i) {
+      ncnn::cast_float32_to_float16(states_[i], parked_states_[i], opt);
+    }
+
+    states_.clear();
+    states_.shrink_to_fit();
+    next_states_.clear();
+    next_states_.shrink_to_fit();
+  }
+
+  void UnparkStates() {
+    if (parked_states_.empty()) return;
+
+    ncnn::Option opt;
+    opt.num_threads = 1;
+    std::vector<ncnn::Mat> states(parked_states_.size());
+    for (std::size_t i = 0; i != states.size(); ++i) {
+      ncnn::cast_float16_to_float32(parked_states_[i], states[i], opt);
+    }
+    parked_states_.clear();
+
+    if (layout_.Empty()) {
+      states_ = std::move(states);
+    } else {
+      states_ = layout_.Pack(states);
+      next_states_ = layout_.Allocate();
+    }
+  }
+
+  int64_t id_;
+  FeatureExtractorConfig feat_config_;
+
+  // It is null while the stream is parked
+  std::unique_ptr<FeatureExtractor> feat_extractor_;
   ContextGraphPtr context_graph_;
   int32_t num_processed_frames_ = 0;  // before subsampling
   int32_t start_frame_index_ = 0;
+
+  // Frames from RestoreFrames(). They come before the frames of
+  // feat_extractor_, so frame k of feat_extractor_ is frame
+  // num_restored_frames_ + k of this stream.
+  std::vector<float> restored_frames_;
+  int32_t num_restored_frames_ = 0;
+  int32_t restored_feature_dim_ = 0;
+
+  // Number of frames removed from the front of restored_frames_, so frame
+  // k is at row k - num_dropped_frames_ of it
+  int32_t num_dropped_frames_ = 0;
+
+  // True after AcceptFrames(). The frames are then appended to
+  // restored_frames_ and feat_extractor_ is null.
+  bool external_frames_ = false;
+  bool input_finished_ = false;
+
+  // Seconds of audio and of trailing non-speech since Reset() as seen by
+  // AcceptSpeechProbability(). vad_duration_ is negative until it is called.
+  float vad_duration_ = -1;
+  float vad_trailing_silence_ = 0;
+
+  int32_t encoder_index_ = 0;
+
+  // See Stream::SetEncoderTap()
+  EncoderTap encoder_tap_;
+  bool encoder_tap_with_features_ = false;
+
+  // Read by the scheduler on other threads
+  std::atomic<int32_t> priority_{0};
+  std::atomic<float> latency_target_ms_{0};
+
   DecoderResult result_;
+  ResultCursor cursor_;
+
+  // Read by other threads with std::atomic_load()
+  std::shared_ptr<const RecognitionResult> published_;
+
   std::vector<ncnn::Mat> states_;
+  std::vector<ncnn::Mat> next_states_;
+
+  // If not null, it holds the current states instead of states_
+  std::unique_ptr<DeviceStates> device_states_;
+
+  // The layout passed to SetStates(), if any
+  EncoderStateLayout layout_;
+
+  // If not empty, the stream is parked or compacted and it holds the
+  // current states in fp16 instead of states_
+  std::vector<ncnn::Mat> parked_states_;
+
+  // Both are null unless EnableLatencyStats() is called
+  std::unique_ptr<LatencyStats> stats_;
+  std::shared_ptr<LatencyStats> parent_stats_;
+
+  // Null unless RecognizerConfig::memory_budget is set
+  std::unique_ptr<MemoryReservation> reservation_;
 };
 
 Stream::Stream(const FeatureExtractorConfig &config,
                ContextGraphPtr context_graph)
-    : impl_(std::make_unique<Impl>(config, context_graph)) {}
+    : impl_(std::make_unique<Impl>(config, context_graph)) {
+  Metrics::Add(MetricCounter::kStreamsCreated);
+  Metrics::Add(MetricGauge::kStreamsActive, 1);
+
+  if (SessionRecorder::Enabled()) {
+    SessionRecorder::Record(SessionEventType::kCreateStream, GetId());
+  }
+}
 
-Stream::~Stream() = default;
+Stream::~Stream() {
+  Metrics::Add(MetricGauge::kStreamsActive, -1);
+
+  if (SessionRecorder::Enabled()) {
+    SessionRecorder::Record(SessionEventType::kDestroyStream, GetId());
+  }
+}
 
 void Stream::AcceptWaveform(int32_t sampling_rate, const float *waveform,
                             int32_t n) {
+  if (SessionRecorder::Enabled()) {
+    SessionRecorder::RecordWaveform(GetId(), sampling_rate, waveform, n);
+  }
+
   impl_->AcceptWaveform(sampling_rate, waveform, n);
 }
 
-void Stream::InputFinished() { impl_->InputFinished(); }
+void Stream::AcceptWaveformInt16(int32_t sampling_rate,
+                                 const int16_t *waveform, int32_t n) {
+  if (SessionRecorder::Enabled()) {
+    // It is replayed with AcceptWaveform(), which gives the same features
+    std::vector<float> samples(n);
+    Int16ToFloat(waveform, n, 1.0f / 32768, samples.data());
+    SessionRecorder::RecordWaveform(GetId(), sampling_rate, samples.data(),
+                                    n);
+  }
+
+  impl_->AcceptWaveformInt16(sampling_rate, waveform, n);
+}
+
+// channels[c] is the start of n samples of channel c in buf
+static std::vector<float *> AllocateChannels(int32_t num_channels, int32_t n,
+                                             std::vector<float> *buf) {
+  buf->resize(static_cast<std::size_t>(num_channels) * n);
+
+  std::vector<float *> channels(num_channels);
+  for (int32_t c = 0; c != num_channels; ++c) {
+    channels[c] = buf->data() + static_cast<std::size_t>(c) * n;
+  }
+  return channels;
+}
+
+void Stream::AcceptInterleavedWaveform(Stream **ss, int32_t num_channels,
+                                       int32_t sampling_rate,
+                                       const float *samples, int32_t n) {
+  std::vector<float> buf;
+  std::vector<float *> channels = AllocateChannels(num_channels, n, &buf);
+  Deinterleave(samples, num_channels, n, 1.0f, channels.data());
+
+  for (int32_t c = 0; c != num_channels; ++c) {
+    ss[c]->AcceptWaveform(sampling_rate, channels[c], n);
+  }
+}
+
+void Stream::AcceptInterleavedWaveformInt16(Stream **ss, int32_t num_channels,
+                                            int32_t sampling_rate,
+                                            const int16_t *samples,
+                                            int32_t n) {
+  std::vector<float> buf;
+  std::vector<float *> channels = AllocateChannels(num_channels, n, &buf);
+  DeinterleaveInt16(samples, num_channels, n, 1.0f / 32768, channels.data());
+
+  for (int32_t c = 0; c != num_channels; ++c) {
+    ss[c]->AcceptWaveform(sampling_rate, channels[c], n);
+  }
+}
+
+void Stream::InputFinished() {
+  if (SessionRecorder::Enabled()) {
+    SessionRecorder::Record(SessionEventType::kInputFinished, GetId());
+  }
+
+  impl_->InputFinished();
+}
 
 int32_t Stream::NumFramesReady() const { return impl_->NumFramesReady(); }
 
@@ -112,8 +620,68 @@ ncnn::Mat Stream::GetFrames(int32_t frame_index, int32_t n) const {
   return impl_->GetFrames(frame_index, n);
 }
 
+void Stream::ComputeFeatures(Stream **ss, int32_t n) {
+  std::vector<FeatureExtractor *> extractors;
+  extractors.reserve(n);
+  for (int32_t i = 0; i != n; ++i) {
+    FeatureExtractor *e = ss[i]->impl_->GetFeatureExtractor();
+    if (e) {
+      extractors.push_back(e);
+    }
+  }
+
+  FeatureExtractor::ComputeFeatures(extractors.data(), extractors.size());
+}
+
 void Stream::Reset() { impl_->Reset(); }
 
+void Stream::Recycle(ContextGraphPtr context_graph) {
+  if (SessionRecorder::Enabled()) {
+    SessionRecorder::Record(SessionEventType::kDestroyStream, GetId());
+  }
+
+  auto old = std::move(impl_);
+  impl_ = std::make_unique<Impl>(old->GetFeatureConfig(),
+                                 std::move(context_graph));
+  impl_->AdoptBuffers(old.get());
+  Metrics::Add(MetricCounter::kStreamsCreated);
+
+  if (SessionRecorder::Enabled()) {
+    SessionRecorder::Record(SessionEventType::kCreateStream, GetId());
+  }
+}
+
+void Stream::RestoreFrames(int32_t num_processed_frames, const float *frames,
+                           int32_t n, int32_t feature_dim) {
+  impl_->RestoreFrames(num_processed_frames, frames, n, feature_dim);
+}
+
+void Stream::AcceptFrames(const float *frames, int32_t n,
+                          int32_t feature_dim) {
+  impl_->AcceptFrames(frames, n, feature_dim);
+}
+
+void Stream::AcceptSpeechProbability(float prob, float duration,
+                                     float threshold) {
+  impl_->AcceptSpeechProbability(prob, duration, threshold);
+}
+
+bool Stream::HasSpeechProbability() const {
+  return impl_->HasSpeechProbability();
+}
+
+float Stream::GetVadDuration() const { return impl_->GetVadDuration(); }
+
+float Stream::GetVadTrailingSilence() const {
+  return impl_->GetVadTrailingSilence();
+}
+
+void Stream::Park() { impl_->Park(); }
+
+bool Stream::IsParked() const { return impl_->IsParked(); }
+
+void Stream::CompactStates() { impl_->CompactStates(); }
+
 void Stream::Finalize() { impl_->Finalize(); }
 
 int32_t &Stream::GetNumProcessedFrames() {
@@ -124,13 +692,95 @@ void Stream::SetResult(const DecoderResult &r) { impl_->SetResult(r); }
 
 DecoderResult &Stream::GetResult() { return impl_->GetResult(); }
 
+ResultCursor &Stream::GetResultCursor() { return impl_->GetResultCursor(); }
+
+void Stream::PublishResult(std::shared_ptr<const RecognitionResult> r) {
+  impl_->PublishResult(std::move(r));
+}
+
+std::shared_ptr<const RecognitionResult> Stream::GetPublishedResult() const {
+  return impl_->GetPublishedResult();
+}
+
 void Stream::SetStates(const std::vector<ncnn::Mat> &states) {
   impl_->SetStates(states);
 }
 
+void Stream::SetStates(const std::vector<ncnn::Mat> &states,
+                       const EncoderStateLayout &layout) {
+  impl_->SetStates(states, layout);
+}
+
 std::vector<ncnn::Mat> &Stream::GetStates() { return impl_->GetStates(); }
 
+std::vector<ncnn::Mat> &Stream::GetNextStates() {
+  return impl_->GetNextStates();
+}
+
+void Stream::SwapStates() { impl_->SwapStates(); }
+
+std::unique_ptr<DeviceStates> &Stream::GetDeviceStates() {
+  return impl_->GetDeviceStates();
+}
+
+void Stream::DownloadStates() { impl_->DownloadStates(); }
+
 const ContextGraphPtr &Stream::GetContextGraph() const {
   return impl_->GetContextGraph();
 }
+
+void Stream::SetContextGraph(ContextGraphPtr context_graph) {
+  impl_->SetContextGraph(std::move(context_graph));
+}
+
+int64_t Stream::GetId() const { return impl_->GetId(); }
+
+int32_t Stream::GetEncoderIndex() const { return impl_->GetEncoderIndex(); }
+
+void Stream::SetEncoderIndex(int32_t i) { impl_->SetEncoderIndex(i); }
+
+void Stream::SetEncoderTap(EncoderTap tap, bool with_features) {
+  impl_->SetEncoderTap(std::move(tap), with_features);
+}
+
+const EncoderTap &Stream::GetEncoderTap() const {
+  return impl_->GetEncoderTap();
+}
+
+bool Stream::EncoderTapWithFeatures() const {
+  return impl_->EncoderTapWithFeatures();
+}
+
+void Stream::SetPriority(int32_t priority) { impl_->SetPriority(priority); }
+
+int32_t Stream::GetPriority() const { return impl_->GetPriority(); }
+
+void Stream::SetLatencyTarget(float latency_target_ms) {
+  impl_->SetLatencyTarget(latency_target_ms);
+}
+
+float Stream::GetLatencyTarget() const { return impl_->GetLatencyTarget(); }
+
+void Stream::EnableLatencyStats(std::shared_ptr<LatencyStats> parent) {
+  impl_->EnableLatencyStats(std::move(parent));
+}
+
+LatencyStats *Stream::GetLatencyStats() { return impl_->GetLatencyStats(); }
+
+const LatencyStats *Stream::GetLatencyStats() const {
+  return impl_->GetLatencyStats();
+}
+
+LatencyStats *Stream::GetParentLatencyStats() {
+  return impl_->GetParentLatencyStats();
+}
+
+StreamMemoryUsage Stream::GetMemoryUsage() const {
+  return impl_->GetMemoryUsage();
+}
+
+void Stream::SetMemoryReservation(std::unique_ptr<MemoryReservation> r) {
+  impl_->SetMemoryReservation(std::move(r));
+}
+
 }  // namespace sherpa_ncnn
@@ -24,9 +24,31 @@
 
 #include "sherpa-ncnn/csrc/context-graph.h"
 #include "sherpa-ncnn/csrc/decoder.h"
+#include "sherpa-ncnn/csrc/device-states.h"
+#include "sherpa-ncnn/csrc/encoder-tap.h"
+#include "sherpa-ncnn/csrc/encoder-state-layout.h"
 #include "sherpa-ncnn/csrc/features.h"
+#include "sherpa-ncnn/csrc/latency-stats.h"
+#include "sherpa-ncnn/csrc/memory-usage.h"
 
 namespace sherpa_ncnn {
+
+struct RecognitionResult;
+
+// What Recognizer::GetResultUpdate() returned last time for a stream
+struct ResultCursor {
+  int32_t revision = 0;
+
+  // Number of tokens of the last update, without the leading blanks
+  int32_t num_tokens = 0;
+
+  // The best path of the last update. Used only for modified_beam_search.
+  std::shared_ptr<TokenNode> tail;
+
+  // True if SetResult() has replaced the result since the last update
+  bool reset = false;
+};
+
 class Stream {
  public:
   explicit Stream(const FeatureExtractorConfig &config = {},
@@ -44,6 +66,40 @@ class Stream {
    */
   void AcceptWaveform(int32_t sampling_rate, const float *waveform, int32_t n);
 
+  /** Same as AcceptWaveform() but for 16-bit PCM samples, which are scaled
+   * by 1/32768. See FeatureExtractor::AcceptWaveformInt16().
+   */
+  void AcceptWaveformInt16(int32_t sampling_rate, const int16_t *waveform,
+                           int32_t n);
+
+  /** Pass each channel of interleaved audio to its own stream, e.g., the
+   * agent and the customer of a stereo call recording.
+   *
+   * The channels are split with SIMD; each stream then resamples its
+   * channel as in AcceptWaveform(). Set use_batch_fbank in the feature
+   * extractor config and decode the streams together with
+   * Recognizer::DecodeStreams() so that the fbank of all channels is
+   * computed in one batch.
+   *
+   * @param ss  num_channels streams. ss[c] gets channel c.
+   * @param num_channels  Number of channels.
+   * @param sampling_rate  The sampling rate of the audio.
+   * @param samples  n frames of num_channels samples each.
+   * @param n  Number of frames, i.e., samples per channel.
+   */
+  static void AcceptInterleavedWaveform(Stream **ss, int32_t num_channels,
+                                        int32_t sampling_rate,
+                                        const float *samples, int32_t n);
+
+  /** Same as AcceptInterleavedWaveform() but for 16-bit PCM samples, which
+   * are scaled by 1/32768.
+   */
+  static void AcceptInterleavedWaveformInt16(Stream **ss,
+                                             int32_t num_channels,
+                                             int32_t sampling_rate,
+                                             const int16_t *samples,
+                                             int32_t n);
+
   /**
    * InputFinished() tells the class you won't be providing any
    * more waveform.  This will help flush out the last frame or two
@@ -67,8 +123,113 @@ class Stream {
    */
   ncnn::Mat GetFrames(int32_t frame_index, int32_t n) const;
 
+  /** Compute the pending fbank frames of n streams in one batch.
+   *
+   * It is a no-op for streams whose feature extractor config does not
+   * set use_batch_fbank. See FeatureExtractor::ComputeFeatures().
+   */
+  static void ComputeFeatures(Stream **ss, int32_t n);
+
   void Reset();
 
+  /** Make this object a new stream with the given context graph, as if it
+   * were destroyed and created again with the same feature config. It
+   * gets a new id. The memory of its encoder states and of its result is
+   * kept, so that SetStates() with the same layout is a memcpy, see
+   * Recognizer::RecycleStream(). The caller then sets the states, the
+   * result and the encoder index as for a new stream.
+   */
+  void Recycle(ContextGraphPtr context_graph);
+
+  /** Continue a stream from a snapshot, see stream-snapshot.h. It must be
+   * called before any waveform is accepted.
+   *
+   * @param num_processed_frames  The value of GetNumProcessedFrames() of
+   *                              the saved stream.
+   * @param frames  n fbank frames of the saved stream that were not
+   *                processed yet, row by row. They are copied. GetFrames()
+   *                returns them before the frames of waveform accepted
+   *                afterwards.
+   * @param n  Number of frames.
+   * @param feature_dim  Number of floats per frame.
+   */
+  void RestoreFrames(int32_t num_processed_frames, const float *frames,
+                     int32_t n, int32_t feature_dim);
+
+  /** Append fbank frames computed elsewhere, e.g., by a FeatureRouter
+   * that shares one front-end among the streams of several models, instead
+   * of computing them from AcceptWaveform().
+   *
+   * The first call, even with n == 0, releases the feature extractor of
+   * the stream; AcceptWaveform() must not be called afterwards.
+   * InputFinished() then marks the last appended frame as the last one.
+   * Frames before GetNumProcessedFrames() are freed on the next call.
+   *
+   * @param frames  n frames, row by row. They are copied.
+   * @param n  Number of frames.
+   * @param feature_dim  Number of floats per frame. It must match the model.
+   */
+  void AcceptFrames(const float *frames, int32_t n, int32_t feature_dim);
+
+  /** Use a voice activity detector for endpointing instead of trailing
+   * blanks.
+   *
+   * Pass the speech probability of each window of the detector, in order,
+   * for the same audio as AcceptWaveform(), e.g., from
+   * VadCallbacks::on_speech_probability. Once it is called,
+   * Recognizer::IsEndpoint() applies the EndpointRules to the trailing
+   * non-speech of the detector and to the audio seen by it since the last
+   * Reset(); a window that is speech counts as nonsilence. Unlike trailing
+   * blanks, it does not wait for the encoder to lag behind the audio, so
+   * utterances end sooner and the stream stops being scheduled earlier.
+   *
+   * @param prob  The speech probability of the next window.
+   * @param duration  The shift of the window in seconds.
+   * @param threshold  The window is speech if prob >= threshold.
+   */
+  void AcceptSpeechProbability(float prob, float duration,
+                               float threshold = 0.5);
+
+  // Return true if AcceptSpeechProbability() has been called
+  bool HasSpeechProbability() const;
+
+  // Seconds of audio passed to AcceptSpeechProbability() since Reset()
+  float GetVadDuration() const;
+
+  // Seconds of non-speech at the end of GetVadDuration()
+  float GetVadTrailingSilence() const;
+
+  /** Release most of the memory of an idle stream, e.g., one of many
+   * connections that are waiting for audio.
+   *
+   * The feature extractor and its buffered samples are freed; frames that
+   * are not processed yet are kept. The encoder states are kept in fp16
+   * and the buffer for the next states is freed. The decoding result and
+   * the context graph, which is shared, are kept as they are.
+   *
+   * The stream is unparked on the next call that needs the features or
+   * the states, e.g., AcceptWaveform() or decoding. The states are then
+   * rounded to fp16 and samples that have not formed a complete frame
+   * before parking (less than one window) are lost, which changes the
+   * result very little. Do not park a stream after InputFinished().
+   *
+   * No other method of the stream may be called at the same time, even
+   * with FeatureExtractorConfig::lock_free.
+   */
+  void Park();
+
+  bool IsParked() const;
+
+  /** Keep the encoder states in fp16 until they are needed, as Park() does
+   * for them, e.g., between two chunks. The states of most encoders, e.g.,
+   * the memory and the attention and convolution caches of ConvEmformer,
+   * are much larger than the rest of a stream, so this halves the memory
+   * of a stream, and the fp32 states and the buffer of the next states
+   * are only allocated while a chunk is decoded. States that are kept on
+   * the device, see GetDeviceStates(), are not changed.
+   */
+  void CompactStates();
+
   /**
    * Finalize the decoding result. This is mainly for decoding with hotwords
    * (i.e. providing context_graph). It will cancel the boosting score of the
@@ -80,7 +241,8 @@ class Stream {
 
   // Return a reference to the number of processed frames so far
   // before subsampling..
-  // Initially, it is 0. It is always less than NumFramesReady().
+  // Initially, it is 0. It is always less than NumFramesReady(), except
+  // after Recognizer::DecodeRemainingFrames(), which leaves it equal.
   //
   // The returned reference is valid as long as this object is alive.
   int32_t &GetNumProcessedFrames();
@@ -88,8 +250,60 @@ class Stream {
   void SetResult(const DecoderResult &r);
   DecoderResult &GetResult();
 
+  // See Recognizer::GetResultUpdate()
+  ResultCursor &GetResultCursor();
+
+  /** Replace the result returned by GetPublishedResult(). The swap is
+   * atomic, so readers on other threads never wait for it and keep the
+   * result they have already got.
+   */
+  void PublishResult(std::shared_ptr<const RecognitionResult> r);
+
+  /** Return the result of the last PublishResult(), or nullptr if it has
+   * not been called. It is lock-free and can be called from any thread,
+   * including while the stream is being decoded.
+   */
+  std::shared_ptr<const RecognitionResult> GetPublishedResult() const;
+
   void SetStates(const std::vector<ncnn::Mat> &states);
+
+  /** Same as above, but the states and the buffer of the next states are
+   * packed with the given layout, see EncoderStateLayout. Saving or
+   * restoring the states is then a single memcpy, e.g.,
+   *
+   *   auto saved = layout.Pack(s.GetStates());
+   *   ...
+   *   layout.Copy(saved, &s.GetStates());
+   */
+  void SetStates(const std::vector<ncnn::Mat> &states,
+                 const EncoderStateLayout &layout);
+
+  /** Note: With a GPU, the states may be kept on the device between
+   * chunks, see GetDeviceStates(). Call DownloadStates() first to get the
+   * current states, e.g., to save them.
+   */
   std::vector<ncnn::Mat> &GetStates();
+
+  /** The encoder states are double-buffered. GetStates() returns the
+   * states for the next chunk and the encoder writes the states after it
+   * into GetNextStates(). SwapStates() then makes them current. The mats of
+   * the previous states become the buffer for the next chunk, so the
+   * encoder states of a stream use a fixed amount of memory.
+   */
+  std::vector<ncnn::Mat> &GetNextStates();
+  void SwapStates();
+
+  /** The states of the stream on the device of the model, if the model
+   * keeps them there. See Model::RunEncoderBatch(). If it is not null, it
+   * holds the current states. It is cleared by SetStates().
+   */
+  std::unique_ptr<DeviceStates> &GetDeviceStates();
+
+  /** Copy the states on the device, if any, to GetStates() and release
+   * them, so that the states of the stream are on the host again.
+   */
+  void DownloadStates();
+
   /**
    * Get the context graph corresponding to this stream.
    *
@@ -97,6 +311,86 @@ class Stream {
    */
   const ContextGraphPtr &GetContextGraph() const;
 
+  /** Replace the context graph of this stream, e.g., to change the
+   * hotwords of a stream without creating a new recognizer. The graph may
+   * be shared with other streams.
+   *
+   * The boosting scores of partial matches with the previous graph are
+   * canceled as in Finalize() and matching starts again from the root of
+   * the new graph, so it is best called before decoding or right after
+   * Reset().
+   *
+   * @param context_graph  The new graph. If it is null, the stream is
+   *                       decoded without hotwords.
+   */
+  void SetContextGraph(ContextGraphPtr context_graph);
+
+  // A number that identifies this stream in the process, e.g., in the
+  // spans of Tracer
+  int64_t GetId() const;
+
+  /** The encoder of the recognizer that decodes this stream: 0 for
+   * ModelConfig::encoder_param and i for ModelConfig::encoder_variants[i - 1].
+   * It is set when the stream is created and must not change afterwards,
+   * since the encoders have states of different shapes.
+   */
+  int32_t GetEncoderIndex() const;
+  void SetEncoderIndex(int32_t i);
+
+  /** Pass each encoded chunk of this stream to tap, in addition to the
+   * taps of Recognizer::AddEncoderTap(). It is not thread-safe; set it
+   * before the stream is decoded. An empty tap removes it. It is removed
+   * by Recognizer::RecycleStream() as well.
+   *
+   * @param with_features  If true, EncoderChunk::features is set.
+   */
+  void SetEncoderTap(EncoderTap tap, bool with_features = false);
+
+  // Return an empty function if SetEncoderTap() has not been called
+  const EncoderTap &GetEncoderTap() const;
+
+  // The with_features of SetEncoderTap()
+  bool EncoderTapWithFeatures() const;
+
+  /** Scheduling hints for StreamScheduler. Ready streams of a higher
+   * priority are decoded first. Among streams of the same priority, the
+   * one whose chunk became ready latency_target_ms ago is decoded first,
+   * i.e., earliest deadline first. A worker also does not wait longer than
+   * that for other streams to join the batch of the stream. 0 means no
+   * target, so streams without one are decoded in the order they became
+   * ready.
+   *
+   * The defaults are priority 0 and no target. Both may be changed at any
+   * time and take effect when the stream is queued next.
+   */
+  void SetPriority(int32_t priority);
+  int32_t GetPriority() const;
+
+  void SetLatencyTarget(float latency_target_ms);
+  float GetLatencyTarget() const;
+
+  /** Record per-stage latency statistics for this stream.
+   *
+   * @param parent If not null, every sample is also added to it, e.g., to
+   *               aggregate the statistics of all streams of a recognizer.
+   */
+  void EnableLatencyStats(std::shared_ptr<LatencyStats> parent = nullptr);
+
+  // Return nullptr if EnableLatencyStats() has not been called
+  LatencyStats *GetLatencyStats();
+  const LatencyStats *GetLatencyStats() const;
+
+  // Return the stats passed to EnableLatencyStats(). It may be null.
+  LatencyStats *GetParentLatencyStats();
+
+  // Return the bytes of the states, features, result and context graph
+  // of this stream. No other method may be called at the same time.
+  StreamMemoryUsage GetMemoryUsage() const;
+
+  // Keep r until the stream is destroyed, see
+  // RecognizerConfig::memory_budget
+  void SetMemoryReservation(std::unique_ptr<MemoryReservation> r);
+
  private:
   class Impl;
   std::unique_ptr<Impl> impl_;
@@ -18,10 +18,12 @@
 
 #include "sherpa-ncnn/csrc/symbol-table.h"
 
-#include <cassert>
-#include <cstdint>
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <sstream>
+#include <utility>
+#include <vector>
 
 #if __ANDROID_API__ >= 9
 #include <strstream>
@@ -31,15 +33,202 @@
 #include "android/log.h"
 #endif
 
+#include "sherpa-ncnn/csrc/macros.h"
+#include "sherpa-ncnn/csrc/mapped-file.h"
+#include "sherpa-ncnn/csrc/startup-stats.h"
+
 namespace sherpa_ncnn {
 
+namespace {
+
+constexpr char kMagic[4] = {'S', 'Y', 'M', 'T'};
+
+// Magic and num_ids, num_symbols, pool_size
+constexpr std::size_t kHeaderSize = 16;
+
+// FNV-1a followed by the finalizer of MurmurHash3
+uint32_t Hash(std::string_view s, uint32_t seed) {
+  uint32_t h = 2166136261u ^ (seed * 0x9e3779b9u);
+  for (unsigned char c : s) {
+    h ^= c;
+    h *= 16777619u;
+  }
+
+  h ^= h >> 16;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35u;
+  h ^= h >> 16;
+  return h;
+}
+
+bool HasMagic(const char *data, std::size_t size) {
+  return size >= sizeof(kMagic) && std::memcmp(data, kMagic, 4) == 0;
+}
+
+void AppendUint32(uint32_t v, std::string *s) {
+  s->append(reinterpret_cast<const char *>(&v), sizeof(v));
+}
+
+/* Build the layout of SymbolTable::ToBinary() from (symbol, id) pairs.
+ *
+ * symbol -> id uses "hash, displace and compress": the n symbols are
+ * hashed into n buckets with seed 0. Buckets are processed from the
+ * largest one, and for a bucket with several symbols we search a seed d
+ * such that Hash(sym, d) % n sends all of them to free slots; d is saved
+ * as the displacement of the bucket. A bucket with a single symbol takes
+ * any free slot s directly and saves -s - 1.
+ */
+std::string Build(std::vector<std::pair<std::string, int32_t>> symbols) {
+  std::sort(symbols.begin(), symbols.end(),
+            [](const auto &a, const auto &b) { return a.second < b.second; });
+
+  int32_t n = symbols.size();
+  int32_t num_ids = n ? symbols.back().second + 1 : 0;
+
+  std::vector<uint32_t> offsets(num_ids + 1);
+  std::string pool;
+  int32_t k = 0;
+  for (int32_t id = 0; id != num_ids; ++id) {
+    offsets[id] = pool.size();
+    if (k < n && symbols[k].second == id) {
+      if (symbols[k].first.empty()) {
+        SHERPA_NCNN_LOGE("Empty symbol for ID %d", id);
+        exit(-1);
+      }
+      pool.append(symbols[k].first);
+      ++k;
+      if (k < n && symbols[k].second == id) {
+        SHERPA_NCNN_LOGE("Duplicate ID %d", id);
+        exit(-1);
+      }
+    }
+  }
+  offsets[num_ids] = pool.size();
+
+  if (n && symbols[0].second < 0) {
+    SHERPA_NCNN_LOGE("Negative ID %d", symbols[0].second);
+    exit(-1);
+  }
+
+  std::vector<std::vector<int32_t>> buckets(n);
+  for (int32_t i = 0; i != n; ++i) {
+    buckets[Hash(symbols[i].first, 0) % n].push_back(i);
+  }
+
+  std::vector<int32_t> order(n);
+  for (int32_t i = 0; i != n; ++i) order[i] = i;
+  std::stable_sort(order.begin(), order.end(),
+                   [&buckets](int32_t a, int32_t b) {
+                     return buckets[a].size() > buckets[b].size();
+                   });
+
+  std::vector<int32_t> displacements(n);
+  std::vector<int32_t> slot2id(n, -1);
+  std::vector<int32_t> slots;
+
+  int32_t b = 0;
+  for (; b != n && buckets[order[b]].size() > 1; ++b) {
+    const auto &bucket = buckets[order[b]];
+    for (std::size_t i = 0; i != bucket.size(); ++i) {
+      for (std::size_t j = i + 1; j != bucket.size(); ++j) {
+        if (symbols[bucket[i]].first == symbols[bucket[j]].first) {
+          SHERPA_NCNN_LOGE("Duplicate symbol %s",
+                           symbols[bucket[i]].first.c_str());
+          exit(-1);
+        }
+      }
+    }
+
+    for (uint32_t d = 1;; ++d) {
+      if (d == 0) {
+        SHERPA_NCNN_LOGE("Failed to build the perfect hash");
+        exit(-1);
+      }
+
+      slots.clear();
+      for (int32_t i : bucket) {
+        int32_t s = Hash(symbols[i].first, d) % n;
+        if (slot2id[s] != -1 ||
+            std::find(slots.begin(), slots.end(), s) != slots.end()) {
+          break;
+        }
+        slots.push_back(s);
+      }
+
+      if (slots.size() == bucket.size()) {
+        for (std::size_t i = 0; i != bucket.size(); ++i) {
+          slot2id[slots[i]] = symbols[bucket[i]].second;
+        }
+        displacements[order[b]] = d;
+        break;
+      }
+    }
+  }
+
+  int32_t free_slot = 0;
+  for (; b != n && buckets[order[b]].size() == 1; ++b) {
+    while (slot2id[free_slot] != -1) ++free_slot;
+
+    slot2id[free_slot] = symbols[buckets[order[b]][0]].second;
+    displacements[order[b]] = -free_slot - 1;
+  }
+
+  std::string ans;
+  ans.reserve(kHeaderSize + 4 * (num_ids + 1) + 8 * n + pool.size());
+  ans.append(kMagic, sizeof(kMagic));
+  AppendUint32(num_ids, &ans);
+  AppendUint32(n, &ans);
+  AppendUint32(pool.size(), &ans);
+  ans.append(reinterpret_cast<const char *>(offsets.data()),
+             offsets.size() * sizeof(uint32_t));
+  ans.append(reinterpret_cast<const char *>(displacements.data()),
+             displacements.size() * sizeof(int32_t));
+  ans.append(reinterpret_cast<const char *>(slot2id.data()),
+             slot2id.size() * sizeof(int32_t));
+  ans.append(pool);
+
+  return ans;
+}
+
+// Copy data to a buffer that is aligned for the integers in it. The
+// returned pointer points to the copy.
+std::shared_ptr<const void> CopyAligned(const void *data, std::size_t size) {
+  auto buf = std::make_shared<std::vector<uint32_t>>((size + 3) / 4);
+  std::memcpy(buf->data(), data, size);
+  return std::shared_ptr<const void>(buf, buf->data());
+}
+
+}  // namespace
+
 SymbolTable::SymbolTable(const std::string &filename) {
-  std::ifstream is(filename);
+  ScopedStartupTimer timer(StartupPhase::kSymbolTable);
+  std::ifstream is(filename, std::ios::binary);
+
+  char magic[sizeof(kMagic)] = {};
+  is.read(magic, sizeof(magic));
+  if (HasMagic(magic, is.gcount())) {
+    std::shared_ptr<MappedFile> f = MappedFile::Open(filename);
+    if (!f) {
+      SHERPA_NCNN_LOGE("Failed to map %s", filename.c_str());
+      exit(-1);
+    }
+
+    const unsigned char *data = f->Data();
+    std::size_t size = f->Size();
+    owner_ = std::move(f);
+    InitFromBinary(data, size);
+    return;
+  }
+
+  is.clear();
+  is.seekg(0);
   Init(is);
 }
 
 #if __ANDROID_API__ >= 9
 SymbolTable::SymbolTable(AAssetManager *mgr, const std::string &filename) {
+  ScopedStartupTimer timer(StartupPhase::kSymbolTable);
   AAsset *asset = AAssetManager_open(mgr, filename.c_str(), AASSET_MODE_BUFFER);
   if (!asset) {
     __android_log_print(ANDROID_LOG_FATAL, "sherpa-ncnn",
@@ -49,13 +238,120 @@ SymbolTable::SymbolTable(AAssetManager *mgr, const std::string &filename) {
 
   auto p = reinterpret_cast<const char *>(AAsset_getBuffer(asset));
   size_t asset_length = AAsset_getLength(asset);
-  std::istrstream is(p, asset_length);
-  Init(is);
+  if (HasMagic(p, asset_length)) {
+    owner_ = CopyAligned(p, asset_length);
+    InitFromBinary(static_cast<const unsigned char *>(owner_.get()),
+                   asset_length);
+  } else {
+    std::istrstream is(p, asset_length);
+    Init(is);
+  }
   AAsset_close(asset);
 }
 #endif
 
+SymbolTable::SymbolTable(const unsigned char *data, std::size_t size) {
+  ScopedStartupTimer timer(StartupPhase::kSymbolTable);
+  if (!HasMagic(reinterpret_cast<const char *>(data), size)) {
+    std::istringstream is(
+        std::string(reinterpret_cast<const char *>(data), size));
+    Init(is);
+    return;
+  }
+
+  owner_ = CopyAligned(data, size);
+  InitFromBinary(static_cast<const unsigned char *>(owner_.get()), size);
+}
+
+SymbolTable::SymbolTable(const unsigned char *data, std::size_t size,
+                         std::shared_ptr<const void> owner) {
+  ScopedStartupTimer timer(StartupPhase::kSymbolTable);
+  if (!HasMagic(reinterpret_cast<const char *>(data), size)) {
+    std::istringstream is(
+        std::string(reinterpret_cast<const char *>(data), size));
+    Init(is);
+    return;
+  }
+
+  if (reinterpret_cast<uintptr_t>(data) % alignof(uint32_t) != 0) {
+    owner_ = CopyAligned(data, size);
+    data = static_cast<const unsigned char *>(owner_.get());
+  } else {
+    owner_ = std::move(owner);
+  }
+
+  InitFromBinary(data, size);
+}
+
+void SymbolTable::InitFromBinary(const unsigned char *data, std::size_t size) {
+  if (size < kHeaderSize ||
+      !HasMagic(reinterpret_cast<const char *>(data), size)) {
+    SHERPA_NCNN_LOGE("Not a binary symbol table");
+    exit(-1);
+  }
+
+  uint32_t header[3];
+  std::memcpy(header, data + sizeof(kMagic), sizeof(header));
+  uint64_t num_ids = header[0];
+  uint64_t num_symbols = header[1];
+  uint64_t pool_size = header[2];
+
+  uint64_t expected_size = kHeaderSize + 4 * (num_ids + 1) +
+                           8 * num_symbols + pool_size;
+  if (num_ids > INT32_MAX || num_symbols > num_ids ||
+      size < expected_size) {
+    SHERPA_NCNN_LOGE("Truncated binary symbol table");
+    exit(-1);
+  }
+
+  num_ids_ = num_ids;
+  num_symbols_ = num_symbols;
+
+  const unsigned char *p = data + kHeaderSize;
+  offsets_ = reinterpret_cast<const uint32_t *>(p);
+  p += 4 * (num_ids + 1);
+
+  displacements_ = reinterpret_cast<const int32_t *>(p);
+  p += 4 * num_symbols;
+
+  slot2id_ = reinterpret_cast<const int32_t *>(p);
+  p += 4 * num_symbols;
+
+  pool_ = reinterpret_cast<const char *>(p);
+
+  // A linear scan over two integer arrays, so that lookups need not check
+  // anything
+  bool ok = offsets_[num_ids] == pool_size;
+  for (int32_t i = 0; ok && i != num_ids_; ++i) {
+    ok = offsets_[i] <= offsets_[i + 1];
+  }
+
+  for (int32_t i = 0; ok && i != num_symbols_; ++i) {
+    ok = slot2id_[i] >= 0 && slot2id_[i] < num_ids_ &&
+         displacements_[i] >= -num_symbols_;
+  }
+
+  if (!ok) {
+    SHERPA_NCNN_LOGE("Corrupted binary symbol table");
+    exit(-1);
+  }
+}
+
+std::string SymbolTable::ToBinary() const {
+  std::vector<std::pair<std::string, int32_t>> symbols;
+  symbols.reserve(num_symbols_);
+  for (int32_t id = 0; id != num_ids_; ++id) {
+    if (contains(id)) {
+      symbols.emplace_back((*this)[id], id);
+    }
+  }
+
+  return Build(std::move(symbols));
+}
+
 void SymbolTable::Init(std::istream &is) {
+  std::vector<std::pair<std::string, int32_t>> symbols;
+
   std::string sym;
   int32_t id;
   while (is >> sym >> id) {
@@ -68,37 +364,85 @@ void SymbolTable::Init(std::istream &is) {
       }
     }
 
-    assert(!sym.empty());
-    assert(sym2id_.count(sym) == 0);
-    assert(id2sym_.count(id) == 0);
-
-    sym2id_.insert({sym, id});
-    id2sym_.insert({id, sym});
+    symbols.emplace_back(std::move(sym), id);
   }
-  assert(is.eof());
+
+  std::string binary = Build(std::move(symbols));
+  owner_ = CopyAligned(binary.data(), binary.size());
+  InitFromBinary(static_cast<const unsigned char *>(owner_.get()),
+                 binary.size());
 }
 
 std::string SymbolTable::ToString() const {
   std::ostringstream os;
   char sep = ' ';
-  for (const auto &p : sym2id_) {
-    os << p.first << sep << p.second << "\n";
+  for (int32_t id = 0; id != num_ids_; ++id) {
+    if (contains(id)) {
+      os << (*this)[id] << sep << id << "\n";
+    }
   }
   return os.str();
 }
 
-const std::string &SymbolTable::operator[](int32_t id) const {
-  return id2sym_.at(id);
+std::string_view SymbolTable::operator[](int32_t id) const {
+  if (!contains(id)) {
+    SHERPA_NCNN_LOGE("No symbol for ID %d", id);
+    exit(-1);
+  }
+
+  return std::string_view(pool_ + offsets_[id],
+                          offsets_[id + 1] - offsets_[id]);
+}
+
+int32_t SymbolTable::operator[](std::string_view sym) const {
+  int32_t id = Find(sym);
+  if (id == -1) {
+    SHERPA_NCNN_LOGE("No ID for symbol %.*s", static_cast<int>(sym.size()),
+                     sym.data());
+    exit(-1);
+  }
+
+  return id;
+}
+
+std::string SymbolTable::Join(const int32_t *ids, int32_t n) const {
+  // offsets_ gives the length of each symbol, so the result is allocated
+  // once
+  std::size_t num_bytes = 0;
+  for (int32_t i = 0; i != n; ++i) {
+    if (!contains(ids[i])) {
+      SHERPA_NCNN_LOGE("No symbol for ID %d", ids[i]);
+      exit(-1);
+    }
+    num_bytes += offsets_[ids[i] + 1] - offsets_[ids[i]];
+  }
+
+  std::string ans;
+  ans.reserve(num_bytes);
+  for (int32_t i = 0; i != n; ++i) {
+    ans.append(pool_ + offsets_[ids[i]], pool_ + offsets_[ids[i] + 1]);
+  }
+
+  return ans;
+}
+
+bool SymbolTable::contains(int32_t id) const {
+  return id >= 0 && id < num_ids_ && offsets_[id] != offsets_[id + 1];
 }
 
-int32_t SymbolTable::operator[](const std::string &sym) const {
-  return sym2id_.at(sym);
+bool SymbolTable::contains(std::string_view sym) const {
+  return Find(sym) != -1;
 }
 
-bool SymbolTable::contains(int32_t id) const { return id2sym_.count(id) != 0; }
+int32_t SymbolTable::Find(std::string_view sym) const {
+  if (num_symbols_ == 0) return -1;
+
+  int32_t d = displacements_[Hash(sym, 0) % num_symbols_];
+  int32_t slot = d < 0 ? -d - 1 : Hash(sym, d) % num_symbols_;
+  int32_t id = slot2id_[slot];
 
-bool SymbolTable::contains(const std::string &sym) const {
-  return sym2id_.count(sym) != 0;
+  std::string_view s(pool_ + offsets_[id], offsets_[id + 1] - offsets_[id]);
+  return s == sym ? id : -1;
 }
 
 std::ostream &operator<<(std::ostream &os, const SymbolTable &symbol_table) {
@@ -19,8 +19,11 @@
 #ifndef SHERPA_NCNN_CSRC_SYMBOL_TABLE_H_
 #define SHERPA_NCNN_CSRC_SYMBOL_TABLE_H_
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 
 #if __ANDROID_API__ >= 9
 #include "android/asset_manager.h"
@@ -30,6 +33,10 @@
 namespace sherpa_ncnn {
 
 /// It manages mapping between symbols and integer IDs.
+///
+/// Symbols are kept in one contiguous string pool. An offset array indexed
+/// by ID maps an ID to its symbol, and a minimal perfect hash maps a symbol
+/// to its ID, so both lookups are O(1) without hashing into a map.
 class SymbolTable {
  public:
   SymbolTable() = default;
@@ -39,32 +46,80 @@ class SymbolTable {
   ///    sym ID
   ///
   /// Fields are separated by space(s).
+  ///
+  /// If the file is the output of ToBinary(), it is memory mapped and used
+  /// without parsing.
   explicit SymbolTable(const std::string &filename);
 
 #if __ANDROID_API__ >= 9
   SymbolTable(AAssetManager *mgr, const std::string &filename);
 #endif
 
+  /// Construct a symbol table from the output of ToBinary(). Unlike
+  /// reading a text file, it does not parse anything; data is copied once.
+  /// If data is not the output of ToBinary(), it is parsed as the content
+  /// of a text file.
+  SymbolTable(const unsigned char *data, std::size_t size);
+
+  /// Like the above one, but binary data is used in place. owner must keep
+  /// data alive; the symbol table and its copies hold a reference to it.
+  SymbolTable(const unsigned char *data, std::size_t size,
+              std::shared_ptr<const void> owner);
+
+  /// Return a binary representation of this symbol table. All integers
+  /// are 32-bit and use the byte order of the host:
+  ///
+  ///   "SYMT", num_ids, num_symbols, pool_size,
+  ///   offsets[num_ids + 1]      // symbol of ID i is
+  ///                             // pool[offsets[i], offsets[i + 1])
+  ///   displacements[num_symbols],
+  ///   slot2id[num_symbols],     // the perfect hash, see Find()
+  ///   pool[pool_size]
+  ///
+  /// An ID without a symbol has an empty range in the pool.
+  std::string ToBinary() const;
+
   /// Return a string representation of this symbol table
   std::string ToString() const;
 
-  /// Return the symbol corresponding to the given ID.
-  const std::string &operator[](int32_t id) const;
+  /// Return the symbol corresponding to the given ID. It refers to the
+  /// pool of this symbol table.
+  std::string_view operator[](int32_t id) const;
   /// Return the ID corresponding to the given symbol.
-  int32_t operator[](const std::string &sym) const;
+  int32_t operator[](std::string_view sym) const;
+
+  /// Return the symbols of ids[0], ..., ids[n - 1] concatenated, e.g.,
+  /// the text of a result. It allocates only once.
+  std::string Join(const int32_t *ids, int32_t n) const;
 
   /// Return true if there is a symbol with the given ID.
   bool contains(int32_t id) const;
 
   /// Return true if there is a given symbol in the symbol table.
-  bool contains(const std::string &sym) const;
+  bool contains(std::string_view sym) const;
+
+  /// Return the number of symbols
+  int32_t NumSymbols() const { return num_symbols_; }
 
  private:
   void Init(std::istream &is);
 
+  // Point the members to data, which has the layout of ToBinary()
+  void InitFromBinary(const unsigned char *data, std::size_t size);
+
+  // Return the ID of sym or -1 if it does not exist
+  int32_t Find(std::string_view sym) const;
+
  private:
-  std::unordered_map<std::string, int32_t> sym2id_;
-  std::unordered_map<int32_t, std::string> id2sym_;
+  // Keeps the memory that the pointers below refer to alive
+  std::shared_ptr<const void> owner_;
+
+  int32_t num_ids_ = 0;
+  int32_t num_symbols_ = 0;
+  const uint32_t *offsets_ = nullptr;
+  const int32_t *displacements_ = nullptr;
+  const int32_t *slot2id_ = nullptr;
+  const char *pool_ = nullptr;
 };
 
 std::ostream &operator<<(std::ostream &os, const SymbolTable &symbol_table);
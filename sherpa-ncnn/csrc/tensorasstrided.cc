@@ -18,11 +18,58 @@
 
 #include "sherpa-ncnn/csrc/tensorasstrided.h"
 
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/vulkan-pipeline.h"
+
 namespace sherpa_ncnn {
 
+#if NCNN_VULKAN
+static const char kTensorAsStridedShader[] = R"(
+#version 450
+
+layout (binding = 0) readonly buffer bottom_blob { sfp bottom_blob_data[]; };
+layout (binding = 1) writeonly buffer top_blob { sfp top_blob_data[]; };
+
+layout (push_constant) uniform parameter
+{
+    int outw;
+    int outh;
+    int outc;
+    int outcstep;
+
+    int cstep;
+    int stride1;
+    int stride2;
+    int storage_offset;
+} p;
+
+void main()
+{
+    int gx = int(gl_GlobalInvocationID.x);
+    int gy = int(gl_GlobalInvocationID.y);
+    int gz = int(gl_GlobalInvocationID.z);
+
+    if (gx >= p.outw || gy >= p.outh || gz >= p.outc)
+        return;
+
+    int vi = gz * p.cstep + p.storage_offset + gy * p.stride1 + gx * p.stride2;
+    int gi = gz * p.outcstep + gy * p.outw + gx;
+
+    buffer_cp1(top_blob_data, gi, bottom_blob_data, vi);
+}
+)";
+#endif
+
 TensorAsStrided::TensorAsStrided() {
   one_blob_only = true;
   support_inplace = false;
+  support_packing = true;
+#if NCNN_VULKAN
+  support_vulkan = true;
+#endif
 }
 
 int32_t TensorAsStrided::load_param(const ncnn::ParamDict &pd) {
@@ -59,6 +106,9 @@ int32_t TensorAsStrided::forward(const ncnn::Mat &bottom_blob,
       return -100;
     }
 
+    // With packing, elempack channels are interleaved in each channel of
+    // the mat. The strides are the same for all of them.
+    int32_t elempack = bottom_blob.elempack;
     int32_t inc = bottom_blob.c;
     int32_t inh = bottom_blob.h;
     int32_t inw = bottom_blob.w;
@@ -67,7 +117,7 @@ int32_t TensorAsStrided::forward(const ncnn::Mat &bottom_blob,
     int32_t outh = p_sizes[1];
     int32_t outw = p_sizes[2];
 
-    if (bottom_blob.c != outc) {
+    if (inc * elempack != outc) {
       NCNN_LOGE("We only implement in_c == out_c right now");
       return -100;
     }
@@ -77,24 +127,55 @@ int32_t TensorAsStrided::forward(const ncnn::Mat &bottom_blob,
       return -100;
     }
 
-    size_t elemsize = bottom_blob.elemsize;
-    top_blob.create(outw, outh, outc, elemsize, opt.blob_allocator);
-
     int32_t stride1 = p_strides[1];
     int32_t stride2 = p_strides[2];
 
+    if (storage_offset == 0 && outw == inw && outh == inh &&
+        stride1 == inw && stride2 == 1) {
+      // The output is the input
+      top_blob = bottom_blob;
+      return 0;
+    }
+
+    size_t elemsize = bottom_blob.elemsize;
+    top_blob.create(outw, outh, inc, elemsize, elempack, opt.blob_allocator);
+    if (top_blob.empty()) return -100;
+
+    // The rows of a channel of the output are contiguous in the input
+    bool contiguous = stride2 == 1 && stride1 == outw;
+
 #pragma omp parallel for num_threads(opt.num_threads)
-    for (int32_t q = 0; q < outc; q++) {
-      ncnn::Mat out_m = top_blob.channel(q);
+    for (int32_t q = 0; q < inc; q++) {
+      float *out_m = top_blob.channel(q);
 
       const float *in_m = bottom_blob.channel(q);
-      in_m += storage_offset;
+      in_m += storage_offset * elempack;
+
+      if (contiguous) {
+        std::memcpy(out_m, in_m, outw * outh * elemsize);
+        continue;
+      }
 
       for (int32_t y = 0; y < outh; ++y) {
-        float *out_ptr = out_m.row(y);
-        const float *in_ptr = in_m + y * stride1;
+        float *out_ptr = out_m + y * outw * elempack;
+        const float *in_ptr = in_m + y * stride1 * elempack;
+
+        if (stride2 == 1) {
+          std::memcpy(out_ptr, in_ptr, outw * elemsize);
+          continue;
+        }
+
+        if (elempack == 1) {
+          for (int32_t x = 0; x < outw; ++x) {
+            out_ptr[x] = in_ptr[x * stride2];
+          }
+          continue;
+        }
+
         for (int32_t x = 0; x < outw; ++x) {
-          out_ptr[x] = in_ptr[x * stride2];
+          std::copy(in_ptr + x * stride2 * elempack,
+                    in_ptr + (x * stride2 + 1) * elempack,
+                    out_ptr + x * elempack);
         }
       }
     }
@@ -107,6 +188,78 @@ int32_t TensorAsStrided::forward(const ncnn::Mat &bottom_blob,
   return -100;
 }
 
+#if NCNN_VULKAN
+int32_t TensorAsStrided::create_pipeline(const ncnn::Option &opt) {
+  if (!vkdev) return 0;
+
+  pipeline_tensorasstrided =
+      CreateVulkanPipeline(vkdev, kTensorAsStridedShader, opt, 8, 8, 1);
+
+  return pipeline_tensorasstrided ? 0 : -100;
+}
+
+int32_t TensorAsStrided::destroy_pipeline(const ncnn::Option & /*opt*/) {
+  delete pipeline_tensorasstrided;
+  pipeline_tensorasstrided = nullptr;
+
+  return 0;
+}
+
+int32_t TensorAsStrided::forward(const ncnn::VkMat &bottom_blob_packed,
+                                 ncnn::VkMat &top_blob, ncnn::VkCompute &cmd,
+                                 const ncnn::Option &opt) const {
+  // support_packing is for the CPU. The shader works on unpacked blobs.
+  ncnn::VkMat bottom_blob = bottom_blob_packed;
+  if (bottom_blob.elempack != 1) {
+    vkdev->convert_packing(bottom_blob_packed, bottom_blob, 1, cmd, opt);
+  }
+
+  const int32_t *p_sizes = sizes;
+  const int32_t *p_strides = strides;
+
+  // The same cases as the CPU implementation
+  if (sizes.w != 3 || bottom_blob.dims != 3) {
+    NCNN_LOGE("TensorAsStrided: Only 3-D tensors are supported right now");
+    return -100;
+  }
+
+  int32_t outc = p_sizes[0];
+  int32_t outh = p_sizes[1];
+  int32_t outw = p_sizes[2];
+
+  if (bottom_blob.c != outc) {
+    NCNN_LOGE("We only implement in_c == out_c right now");
+    return -100;
+  }
+
+  if (p_strides[0] != bottom_blob.h * bottom_blob.w) {
+    NCNN_LOGE("Stride that crosses channels is not supported");
+    return -100;
+  }
+
+  top_blob.create(outw, outh, outc, bottom_blob.elemsize, 1,
+                  opt.blob_vkallocator);
+  if (top_blob.empty()) return -100;
+
+  std::vector<ncnn::VkMat> bindings = {bottom_blob, top_blob};
+
+  std::vector<ncnn::vk_constant_type> constants(8);
+  constants[0].i = outw;
+  constants[1].i = outh;
+  constants[2].i = outc;
+  constants[3].i = static_cast<int32_t>(top_blob.cstep);
+  constants[4].i = static_cast<int32_t>(bottom_blob.cstep);
+  constants[5].i = p_strides[1];
+  constants[6].i = p_strides[2];
+  constants[7].i = storage_offset;
+
+  cmd.record_pipeline(pipeline_tensorasstrided, bindings, constants,
+                      top_blob);
+
+  return 0;
+}
+#endif
+
 static ncnn::Layer *TensorAsStridedCreator(void * /*userdata*/) {
   return new TensorAsStrided();
 }
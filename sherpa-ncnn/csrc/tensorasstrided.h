@@ -35,10 +35,23 @@ class TensorAsStrided : public ncnn::Layer {
   int32_t forward(const ncnn::Mat &bottom_blob, ncnn::Mat &top_blob,
                   const ncnn::Option &opt) const override;
 
+#if NCNN_VULKAN
+  int32_t create_pipeline(const ncnn::Option &opt) override;
+  int32_t destroy_pipeline(const ncnn::Option &opt) override;
+
+  int32_t forward(const ncnn::VkMat &bottom_blob, ncnn::VkMat &top_blob,
+                  ncnn::VkCompute &cmd, const ncnn::Option &opt) const override;
+#endif
+
  public:
   ncnn::Mat sizes;
   ncnn::Mat strides;
   int32_t storage_offset;
+
+#if NCNN_VULKAN
+ private:
+  ncnn::Pipeline *pipeline_tensorasstrided = nullptr;
+#endif
 };
 
 void RegisterTensorAsStridedLayer(ncnn::Net &net);
@@ -0,0 +1,66 @@
+// sherpa-ncnn/csrc/test-audio-capture-queue.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <cassert>
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "sherpa-ncnn/csrc/audio-capture-queue.h"
+
+static void TestDropped() {
+  sherpa_ncnn::AudioCaptureQueue queue(8);
+
+  std::vector<float> in(6, 1);
+  assert(queue.Push(in.data(), 6) == 6);
+  assert(queue.Push(in.data(), 6) == 2);
+  assert(queue.NumDropped() == 4);
+  assert(queue.Size() == 8);
+
+  std::vector<float> out(8);
+  assert(queue.Pop(out.data(), 8) == 8);
+  assert(queue.Size() == 0);
+
+  // Nothing arrives
+  assert(!queue.Wait(1, 10));
+}
+
+static void TestWait() {
+  constexpr int32_t kNumBlocks = 200;
+  constexpr int32_t kBlockSize = 160;
+  sherpa_ncnn::AudioCaptureQueue queue(16000);
+
+  std::thread producer([&queue]() {
+    std::vector<float> block(kBlockSize);
+    for (int32_t i = 0; i != kNumBlocks; ++i) {
+      for (int32_t k = 0; k != kBlockSize; ++k) {
+        block[k] = i * kBlockSize + k;
+      }
+      queue.Push(block.data(), kBlockSize);
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  });
+
+  std::vector<float> block(1000);
+  int32_t expected = 0;
+  while (expected < kNumBlocks * kBlockSize) {
+    queue.Wait(1, 1000);
+    int32_t n = queue.Pop(block.data(), block.size());
+    for (int32_t i = 0; i != n; ++i) {
+      assert(block[i] == expected);
+      ++expected;
+    }
+  }
+
+  producer.join();
+  assert(queue.NumDropped() == 0);
+}
+
+int32_t main() {
+  TestDropped();
+  TestWait();
+
+  return 0;
+}
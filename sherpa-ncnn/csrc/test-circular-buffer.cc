@@ -0,0 +1,43 @@
+// sherpa-ncnn/csrc/test-circular-buffer.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <cassert>
+#include <numeric>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/circular-buffer.h"
+
+static void TestView() {
+  sherpa_ncnn::CircularBuffer buffer(8);
+
+  std::vector<float> samples(6);
+  std::iota(samples.begin(), samples.end(), 0);
+
+  buffer.Push(samples.data(), 6);
+
+  auto view = buffer.GetView(1, 4);
+  assert(view.size1 == 4 && view.size2 == 0);
+  assert(view.ToVector() == buffer.Get(1, 4));
+
+  buffer.Pop(5);
+
+  // [6, 7] at the end of the buffer and [8, 9, 10] at the beginning
+  std::iota(samples.begin(), samples.end(), 6);
+  buffer.Push(samples.data(), 5);
+
+  view = buffer.GetView(5, 6);
+  assert(view.size1 == 3 && view.size2 == 3);
+  assert(view.data2 == view.data1 - 5);
+  assert(view.ToVector() == buffer.Get(5, 6));
+
+  std::vector<float> expected = {5, 6, 7, 8, 9, 10};
+  assert(view.ToVector() == expected);
+
+  assert(buffer.GetView(5, 0).Size() == 0);
+}
+
+int32_t main() {
+  TestView();
+  return 0;
+}
@@ -0,0 +1,94 @@
+// sherpa-ncnn/csrc/test-compact-frames.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <assert.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/compact-frames.h"
+
+static constexpr int32_t kDim = 80;
+
+// Values in the range of log mel filterbank energies
+static std::vector<float> Frame(int32_t k) {
+  std::vector<float> ans(kDim);
+  for (int32_t d = 0; d != kDim; ++d) {
+    ans[d] = -5 + 10 * std::sin(0.1f * k + 0.37f * d) + (k % 3);
+  }
+  return ans;
+}
+
+static void Test(sherpa_ncnn::CompactFrames::Format format) {
+  sherpa_ncnn::CompactFrames frames(kDim, format);
+
+  int32_t n = 100;
+  for (int32_t k = 0; k != n; ++k) {
+    std::vector<float> f = Frame(k);
+    frames.Push(f.data());
+  }
+  frames.ShrinkToFit();
+
+  assert(frames.NumFrames() == n);
+
+  std::vector<float> out(kDim);
+  for (int32_t k = 0; k != n; ++k) {
+    std::vector<float> f = Frame(k);
+    frames.GetFrame(k, out.data());
+
+    auto mm = std::minmax_element(f.begin(), f.end());
+    float range = *mm.second - *mm.first;
+    for (int32_t d = 0; d != kDim; ++d) {
+      float err = std::abs(out[d] - f[d]);
+      if (format == sherpa_ncnn::CompactFrames::Format::kFloat16) {
+        // 10 bits of mantissa
+        assert(err <= std::abs(f[d]) / 1024);
+      } else {
+        // Half a step, with some slack for float rounding
+        assert(err <= range / 255 * 0.501f);
+      }
+    }
+  }
+
+  std::size_t bytes_per_frame =
+      format == sherpa_ncnn::CompactFrames::Format::kFloat16
+          ? kDim * 2
+          : kDim + 2 * sizeof(float);
+  assert(frames.NumBytes() == n * bytes_per_frame);
+}
+
+// A constant frame has no range and is restored exactly
+static void TestConstantFrame() {
+  sherpa_ncnn::CompactFrames frames(kDim,
+                                    sherpa_ncnn::CompactFrames::Format::kInt8);
+
+  std::vector<float> f(kDim, -3.25f);
+  frames.Push(f.data());
+
+  std::vector<float> out(kDim);
+  frames.GetFrame(0, out.data());
+  assert(out == f);
+}
+
+static void TestParseFormat() {
+  sherpa_ncnn::CompactFrames::Format format;
+  assert(sherpa_ncnn::CompactFrames::ParseFormat("fp16", &format));
+  assert(format == sherpa_ncnn::CompactFrames::Format::kFloat16);
+
+  assert(sherpa_ncnn::CompactFrames::ParseFormat("int8", &format));
+  assert(format == sherpa_ncnn::CompactFrames::Format::kInt8);
+
+  assert(!sherpa_ncnn::CompactFrames::ParseFormat("fp32", &format));
+  assert(!sherpa_ncnn::CompactFrames::ParseFormat("int4", &format));
+}
+
+int32_t main() {
+  Test(sherpa_ncnn::CompactFrames::Format::kFloat16);
+  Test(sherpa_ncnn::CompactFrames::Format::kInt8);
+  TestConstantFrame();
+  TestParseFormat();
+
+  return 0;
+}
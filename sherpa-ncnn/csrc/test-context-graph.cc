@@ -13,7 +13,7 @@
 #include "sherpa-ncnn/csrc/context-graph.h"
 
 static void TestHelper(const std::map<std::string, float> &queries, float score,
-                       bool strict_mode) {
+                       bool strict_mode, bool from_binary = false) {
   std::vector<std::string> contexts_str(
       {"S", "HE", "SHE", "SHELL", "HIS", "HERS", "HELLO", "THIS", "THEM"});
   std::vector<std::vector<int32_t>> contexts;
@@ -22,7 +22,16 @@ static void TestHelper(const std::map<std::string, float> &queries, float score,
     contexts.emplace_back(contexts_str[i].begin(), contexts_str[i].end());
     scores.push_back(std::round(score / contexts_str[i].size() * 100) / 100);
   }
-  auto context_graph = sherpa_ncnn::ContextGraph(contexts, 1, scores);
+  auto graph = sherpa_ncnn::ContextGraph(contexts, 1, scores);
+
+  std::string binary = graph.ToBinary();
+  assert(sherpa_ncnn::ContextGraph::IsBinary(binary.data(), binary.size()));
+
+  auto loaded = sherpa_ncnn::ContextGraph(
+      reinterpret_cast<const unsigned char *>(binary.data()), binary.size());
+  assert(loaded.NumNodes() == graph.NumNodes());
+
+  const auto &context_graph = from_binary ? loaded : graph;
 
   for (const auto &iter : queries) {
     float total_scores = 0;
@@ -70,6 +79,44 @@ static void TestCustomizeNonStrict() {
   TestHelper(queries, 5, false);
 }
 
+// GetArcs() must agree with ForwardOneStep() for every token
+static void TestGetArcs(bool strict_mode) {
+  std::vector<std::string> contexts_str(
+      {"S", "HE", "SHE", "SHELL", "HIS", "HERS", "HELLO", "THIS", "THEM"});
+  std::vector<std::vector<int32_t>> contexts;
+  for (const auto &c : contexts_str) {
+    contexts.emplace_back(c.begin(), c.end());
+  }
+  auto graph = sherpa_ncnn::ContextGraph(contexts, 1.5);
+
+  std::vector<sherpa_ncnn::ContextArc> arcs;
+  auto state = graph.Root();
+  for (auto q : std::string("HEHERSHELLOTHISHE")) {
+    arcs.clear();
+    float other = graph.GetArcs(state, strict_mode, &arcs);
+
+    for (int32_t t = 'A'; t <= 'Z'; ++t) {
+      auto res = graph.ForwardOneStep(state, t, strict_mode);
+
+      int32_t n = 0;
+      float score = other;
+      auto next = graph.Root();
+      for (const auto &a : arcs) {
+        if (a.token == t) {
+          ++n;
+          score = a.score;
+          next = a.next;
+        }
+      }
+      assert(n <= 1);
+      assert(std::fabs(score - std::get<0>(res)) < 1e-5);
+      assert(next == std::get<1>(res));
+    }
+
+    state = std::get<1>(graph.ForwardOneStep(state, q, strict_mode));
+  }
+}
+
 static void Benchmark() {
   std::random_device rd;
   std::mt19937 mt(rd());
@@ -95,11 +142,27 @@ static void Benchmark() {
   }
 }
 
+static void TestBinary() {
+  auto queries = std::map<std::string, float>{
+      {"HEHERSHE", 35.84}, {"HERSHE", 30.84},  {"HISHE", 24.18},
+      {"SHED", 18.34},     {"SHELF", 18.34},   {"HELL", 5},
+      {"HELLO", 13},       {"DHRHISQ", 10.84}, {"THEN", 5}};
+  TestHelper(queries, 5, true, true);
+
+  auto non_strict = std::map<std::string, float>{
+      {"HEHERSHE", 7}, {"HERSHE", 5}, {"HISHE", 5},   {"SHED", 3}, {"SHELF", 3},
+      {"HELL", 2},     {"HELLO", 2},  {"DHRHISQ", 3}, {"THEN", 2}};
+  TestHelper(non_strict, 0, false, true);
+}
+
 int32_t main() {
   TestBasic();
   TestBasicNonStrict();
   TestCustomize();
   TestCustomizeNonStrict();
+  TestBinary();
+  TestGetArcs(true);
+  TestGetArcs(false);
   Benchmark();
   return 0;
 }
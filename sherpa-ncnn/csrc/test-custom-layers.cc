@@ -0,0 +1,197 @@
+// sherpa-ncnn/csrc/test-custom-layers.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+// Run the custom layers of the Zipformer models with each precision of
+// ModelConfig::encoder_precision, on the CPU and, if there is one, on the
+// GPU, and compare the outputs with the ones of "accuracy" on the CPU.
+
+#include <assert.h>
+#include <stdio.h>
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "net.h"  // NOLINT
+#include "sherpa-ncnn/csrc/model.h"
+
+#if NCNN_VULKAN
+#include "gpu.h"  // NOLINT
+#endif
+
+namespace {
+
+struct TestCase {
+  const char *name;
+  const char *param;
+  // The weights, as read by ncnn::ModelBinFromDataReader
+  std::vector<float> weights;
+  std::vector<std::pair<const char *, ncnn::Mat>> inputs;
+  std::vector<const char *> outputs;
+};
+
+ncnn::Mat Fill(ncnn::Mat m, float offset) {
+  for (int32_t q = 0; q != m.c; ++q) {
+    float *p = m.channel(q);
+    for (int32_t i = 0; i != m.w * m.h * m.d; ++i) {
+      p[i] = std::sin(0.37f * (q * 100 + i) + offset);
+    }
+  }
+  return m;
+}
+
+std::vector<TestCase> CreateTestCases() {
+  std::vector<TestCase> ans;
+
+  ncnn::Mat cached_len(1);
+  cached_len[0] = 3;
+
+  // x is packed along h
+  ans.push_back({"PoolingModuleNoProj",
+                 "7767517\n"
+                 "4 6\n"
+                 "Input in0 0 1 in0\n"
+                 "Input in1 0 1 in1\n"
+                 "Input in2 0 1 in2\n"
+                 "PoolingModuleNoProj pool 3 3 in0 in1 in2 out0 out1 out2\n",
+                 {},
+                 {{"in0", Fill(ncnn::Mat(8, 8), 0)},
+                  {"in1", cached_len},
+                  {"in2", Fill(ncnn::Mat(8, 1), 1)}},
+                 {"out0", "out1", "out2"}});
+
+  // The first weight is the flag of the bias, i.e., fp32
+  std::vector<float> bias(1 + 2 * 8);
+  for (int32_t i = 1; i != static_cast<int32_t>(bias.size()); ++i) {
+    bias[i] = 0.1f * i;
+  }
+
+  ans.push_back({"SimpleUpsample",
+                 "7767517\n"
+                 "2 2\n"
+                 "Input in0 0 1 in0\n"
+                 "SimpleUpsample up 1 1 in0 out0 0=2 1=8 2=16\n",
+                 bias,
+                 {{"in0", Fill(ncnn::Mat(8, 8), 2)}},
+                 {"out0"}});
+
+  // The channels are packed
+  ans.push_back({"TensorAsStrided",
+                 "7767517\n"
+                 "2 2\n"
+                 "Input in0 0 1 in0\n"
+                 "TensorAsStrided s 1 1 in0 out0 -23300=3,8,4,3 "
+                 "-23301=3,24,6,2 2=1\n",
+                 {},
+                 {{"in0", Fill(ncnn::Mat(6, 4, 8), 3)}},
+                 {"out0"}});
+
+  ans.push_back({"Stack",
+                 "7767517\n"
+                 "3 3\n"
+                 "Input in0 0 1 in0\n"
+                 "Input in1 0 1 in1\n"
+                 "Stack s 2 1 in0 in1 out0 0=0\n",
+                 {},
+                 {{"in0", Fill(ncnn::Mat(8, 4), 4)},
+                  {"in1", Fill(ncnn::Mat(8, 4), 5)}},
+                 {"out0"}});
+
+  return ans;
+}
+
+std::vector<ncnn::Mat> Run(const TestCase &t, const std::string &precision,
+                           bool use_gpu) {
+  ncnn::Net net;
+  bool ok = sherpa_ncnn::Model::SetPrecision(precision, &net.opt);
+  assert(ok);
+  net.opt.use_vulkan_compute = use_gpu;
+  net.opt.num_threads = 2;
+
+  sherpa_ncnn::Model::RegisterCustomLayers(net);
+
+  int32_t ret = net.load_param_mem(t.param);
+  assert(ret == 0);
+
+  std::vector<float> weights = t.weights;
+  weights.push_back(0);  // so that data() is not null
+  net.load_model(reinterpret_cast<const unsigned char *>(weights.data()));
+
+  auto ex = net.create_extractor();
+  for (const auto &p : t.inputs) {
+    ex.input(p.first, p.second);
+  }
+
+  std::vector<ncnn::Mat> ans;
+  for (const char *name : t.outputs) {
+    // The outputs are converted to fp32 without packing
+    ncnn::Mat out;
+    ret = ex.extract(name, out);
+    assert(ret == 0);
+    ans.push_back(out.clone());
+  }
+
+  (void)ok;
+  (void)ret;
+  return ans;
+}
+
+bool Close(const ncnn::Mat &a, const ncnn::Mat &b) {
+  if (a.dims != b.dims || a.w != b.w || a.h != b.h || a.d != b.d ||
+      a.c != b.c || a.elempack != 1 || b.elempack != 1) {
+    return false;
+  }
+
+  for (int32_t q = 0; q != a.c; ++q) {
+    const float *pa = a.channel(q);
+    const float *pb = b.channel(q);
+    for (int32_t i = 0; i != a.w * a.h * a.d; ++i) {
+      // fp16 has 11 bits of precision
+      if (std::abs(pa[i] - pb[i]) > 1e-2f * (1 + std::abs(pb[i]))) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+}  // namespace
+
+int32_t main() {
+  bool has_gpu = false;
+#if NCNN_VULKAN
+  has_gpu = ncnn::get_gpu_count() > 0;
+#endif
+
+  for (const auto &t : CreateTestCases()) {
+    std::vector<ncnn::Mat> expected = Run(t, "accuracy", false);
+
+    for (const char *precision : {"accuracy", "balanced", "speed"}) {
+      for (bool use_gpu : {false, true}) {
+        if (use_gpu && !has_gpu) continue;
+
+        std::vector<ncnn::Mat> outputs = Run(t, precision, use_gpu);
+        assert(outputs.size() == expected.size());
+
+        for (std::size_t i = 0; i != outputs.size(); ++i) {
+          if (!Close(outputs[i], expected[i])) {
+            fprintf(stderr, "%s: output %d is wrong with %s on the %s\n",
+                    t.name, static_cast<int32_t>(i), precision,
+                    use_gpu ? "GPU" : "CPU");
+            return -1;
+          }
+        }
+      }
+    }
+  }
+
+#if NCNN_VULKAN
+  ncnn::destroy_gpu_instance();
+#endif
+
+  return 0;
+}
@@ -0,0 +1,113 @@
+// sherpa-ncnn/csrc/test-encoder-state-layout.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <assert.h>
+#include <stdio.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "mat.h"  // NOLINT
+#include "sherpa-ncnn/csrc/encoder-state-layout.h"
+
+static std::vector<ncnn::Mat> CreateStates() {
+  std::vector<ncnn::Mat> states = {
+      ncnn::Mat(3),
+      ncnn::Mat(5, 2),
+      ncnn::Mat(3, 7, 2),
+  };
+
+  float v = 0;
+  for (auto &m : states) {
+    for (int32_t i = 0; i != static_cast<int32_t>(m.total()); ++i) {
+      m[i] = v++;
+    }
+  }
+
+  return states;
+}
+
+static bool Equal(const ncnn::Mat &a, const ncnn::Mat &b) {
+  if (a.dims != b.dims || a.w != b.w || a.h != b.h || a.c != b.c ||
+      a.cstep != b.cstep) {
+    return false;
+  }
+
+  for (int32_t i = 0; i != static_cast<int32_t>(a.total()); ++i) {
+    if (a[i] != b[i]) return false;
+  }
+
+  return true;
+}
+
+static void TestPack() {
+  std::vector<ncnn::Mat> states = CreateStates();
+  sherpa_ncnn::EncoderStateLayout layout(states);
+
+  assert(layout.NumStates() == 3);
+  assert(layout.NumBytes() % sherpa_ncnn::EncoderStateLayout::kAlignment ==
+         0);
+  assert(!layout.IsPacked(states));
+
+  std::vector<ncnn::Mat> packed = layout.Pack(states);
+  assert(layout.IsPacked(packed));
+  assert(sherpa_ncnn::IsWritablePackedState(packed[1]));
+
+  for (int32_t i = 0; i != 3; ++i) {
+    assert(Equal(packed[i], states[i]));
+
+    auto offset = static_cast<unsigned char *>(packed[i].data) -
+                  static_cast<unsigned char *>(packed[0].data);
+    assert(offset % sherpa_ncnn::EncoderStateLayout::kAlignment == 0);
+    assert(offset + packed[i].total() * 4 <= layout.NumBytes());
+  }
+
+  // A copy of a view shares the block
+  {
+    ncnn::Mat m = packed[2];
+    assert(!sherpa_ncnn::IsWritablePackedState(packed[0]));
+  }
+  assert(sherpa_ncnn::IsWritablePackedState(packed[0]));
+
+  // Copying packed states is a single memcpy into the block of dst
+  std::vector<ncnn::Mat> other = layout.Allocate();
+  void *data = other[0].data;
+  layout.Copy(packed, &other);
+  assert(other[0].data == data);
+  for (int32_t i = 0; i != 3; ++i) {
+    assert(Equal(other[i], states[i]));
+  }
+
+  // The block of dst is shared, so it is not overwritten
+  std::vector<ncnn::Mat> shared = other;
+  packed[0][0] = 100;
+  layout.Copy(packed, &other);
+  assert(other[0].data != data);
+  assert(other[0][0] == 100);
+  assert(shared[0][0] == 0);
+
+  // Views stay valid after the others are released
+  ncnn::Mat last = packed[2];
+  packed.clear();
+  assert(Equal(last, states[2]));
+}
+
+static void TestEmpty() {
+  sherpa_ncnn::EncoderStateLayout layout;
+  assert(layout.Empty());
+
+  std::vector<ncnn::Mat> states = CreateStates();
+  std::vector<ncnn::Mat> packed = layout.Pack(states);
+  assert(packed.size() == states.size());
+  assert(packed[0].data == states[0].data);
+}
+
+int32_t main() {
+  TestPack();
+  TestEmpty();
+
+  fprintf(stderr, "Done\n");
+
+  return 0;
+}
@@ -0,0 +1,61 @@
+// sherpa-ncnn/csrc/test-encoder-tap.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <assert.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/encoder-tap.h"
+
+using sherpa_ncnn::EncoderChunk;
+using sherpa_ncnn::EncoderTaps;
+
+int32_t main() {
+  EncoderTaps taps;
+  assert(taps.Get() == nullptr);
+  assert(!taps.Remove(1));
+
+  std::vector<int32_t> calls;
+  int32_t a = taps.Add([&calls](const EncoderChunk &) { calls.push_back(1); },
+                       false);
+  int32_t b = taps.Add(
+      [&calls](const EncoderChunk &c) {
+        assert(!c.features.empty());
+        calls.push_back(2);
+      },
+      true);
+  assert(a != b);
+
+  auto list = taps.Get();
+  assert(list && list->size() == 2);
+  assert(!(*list)[0].with_features);
+  assert((*list)[1].with_features);
+
+  // A snapshot is not changed by Remove()
+  assert(taps.Remove(a));
+  assert(!taps.Remove(a));
+  assert(list->size() == 2);
+  assert(taps.Get()->size() == 1);
+
+  EncoderChunk chunk;
+  chunk.features.create(80, 39);
+  for (const auto &e : *taps.Get()) {
+    e.tap(chunk);
+  }
+  assert(calls.size() == 1 && calls[0] == 2);
+
+  // The mats of a chunk are shared, not copied
+  chunk.encoder_out.create(512, 8);
+  EncoderChunk kept = chunk;
+  assert(kept.encoder_out.data == chunk.encoder_out.data);
+
+  assert(taps.Remove(b));
+  assert(taps.Get() == nullptr);
+
+  int32_t c = taps.Add([](const EncoderChunk &) {}, false);
+  assert(c != a && c != b);
+
+  return 0;
+}
@@ -0,0 +1,62 @@
+// sherpa-ncnn/csrc/test-error-rate.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <cassert>
+#include <string>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/error-rate.h"
+
+using sherpa_ncnn::ComputeErrorStats;
+using sherpa_ncnn::ErrorStats;
+using sherpa_ncnn::SplitCharsForErrorRate;
+using sherpa_ncnn::SplitWordsForErrorRate;
+
+static void TestAlignment() {
+  std::vector<std::string> ref = {"the", "cat", "sat", "on", "the", "mat"};
+
+  ErrorStats s = ComputeErrorStats(ref, ref);
+  assert(s.num_ref == 6 && s.NumErrors() == 0 && s.Rate() == 0);
+
+  // A substitution, a deletion and an insertion
+  s = ComputeErrorStats(ref, {"the", "bat", "sat", "the", "mat", "too"});
+  assert(s.num_sub == 1);
+  assert(s.num_del == 1);
+  assert(s.num_ins == 1);
+  assert(s.Rate() == 0.5);
+
+  s = ComputeErrorStats(ref, {});
+  assert(s.num_del == 6 && s.Rate() == 1);
+
+  s = ComputeErrorStats({}, {"a", "b"});
+  assert(s.num_ins == 2 && s.Rate() == 1);
+
+  assert(ComputeErrorStats({}, {}).Rate() == 0);
+
+  // Summed over utterances
+  ErrorStats total;
+  total += ComputeErrorStats({"a", "b"}, {"a", "c"});
+  total += ComputeErrorStats({"d", "e"}, {"d", "e"});
+  assert(total.num_ref == 4 && total.NumErrors() == 1);
+  assert(total.Rate() == 0.25);
+}
+
+static void TestSplit() {
+  std::vector<std::string> words = SplitWordsForErrorRate("Hello  WORLD");
+  assert((words == std::vector<std::string>{"hello", "world"}));
+
+  // Each Chinese character is a word of its own
+  words = SplitWordsForErrorRate("你好 world");
+  assert((words == std::vector<std::string>{"你", "好", "world"}));
+
+  std::vector<std::string> chars = SplitCharsForErrorRate("Ab 你好");
+  assert((chars == std::vector<std::string>{"a", "b", "你", "好"}));
+}
+
+int32_t main() {
+  TestAlignment();
+  TestSplit();
+
+  return 0;
+}
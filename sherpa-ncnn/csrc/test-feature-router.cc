@@ -0,0 +1,105 @@
+// sherpa-ncnn/csrc/test-feature-router.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <assert.h>
+#include <math.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "mat.h"  // NOLINT
+#include "sherpa-ncnn/csrc/feature-router.h"
+#include "sherpa-ncnn/csrc/stream.h"
+
+static std::vector<float> GenerateWaveform(int32_t n) {
+  std::vector<float> samples(n);
+  for (int32_t i = 0; i != n; ++i) {
+    samples[i] = 0.3f * sinf(2 * M_PI * 440 * i / 16000.0f) +
+                 0.1f * sinf(2 * M_PI * 3000 * i / 16000.0f);
+  }
+  return samples;
+}
+
+static bool Equal(const ncnn::Mat &a, const ncnn::Mat &b) {
+  if (a.w != b.w || a.h != b.h) {
+    return false;
+  }
+
+  const float *p = a;
+  const float *q = b;
+  return std::equal(p, p + a.w * a.h, q);
+}
+
+// Two routed streams see the same frames as a stream that computes its
+// own, even if they are decoded at different paces
+static void TestRouter() {
+  int32_t num_samples = 16000 * 2 + 123;
+  std::vector<float> samples = GenerateWaveform(num_samples);
+
+  sherpa_ncnn::FeatureExtractorConfig config;
+  sherpa_ncnn::Stream expected(config);
+  expected.AcceptWaveform(16000, samples.data(), num_samples);
+  expected.InputFinished();
+  int32_t num_frames = expected.NumFramesReady();
+  ncnn::Mat all = expected.GetFrames(0, num_frames);
+
+  sherpa_ncnn::FeatureRouter router(config);
+  sherpa_ncnn::Stream fast(config);
+  sherpa_ncnn::Stream slow(config);
+  router.AddStream(&fast);
+  router.AddStream(&slow);
+  assert(router.NumStreams() == 2);
+
+  // Read 39 frames at a time, advancing by 32, as Recognizer does
+  int32_t chunk_size = 39;
+  int32_t chunk_shift = 32;
+  int32_t chunk = 1600;
+  for (int32_t i = 0; i < num_samples; i += chunk) {
+    int32_t n = std::min(chunk, num_samples - i);
+    router.AcceptWaveform(16000, samples.data() + i, n);
+
+    while (fast.GetNumProcessedFrames() + chunk_size <=
+           fast.NumFramesReady()) {
+      int32_t k = fast.GetNumProcessedFrames();
+      assert(Equal(fast.GetFrames(k, chunk_size),
+                   all.row_range(k, chunk_size)));
+      fast.GetNumProcessedFrames() += chunk_shift;
+    }
+  }
+
+  router.InputFinished();
+  assert(router.NumFramesReady() == num_frames);
+  assert(fast.NumFramesReady() == num_frames);
+  assert(slow.NumFramesReady() == num_frames);
+  assert(fast.IsLastFrame(num_frames - 1));
+  assert(!fast.IsLastFrame(num_frames - 2));
+
+  // slow has not decoded anything, so it still has all frames
+  assert(Equal(slow.GetFrames(0, num_frames), all));
+
+  router.RemoveStream(&fast);
+  assert(router.NumStreams() == 1);
+}
+
+// A stream added after the input is finished is finished, too
+static void TestLateStream() {
+  sherpa_ncnn::FeatureExtractorConfig config;
+  sherpa_ncnn::FeatureRouter router(config);
+
+  std::vector<float> samples = GenerateWaveform(1600);
+  router.AcceptWaveform(16000, samples.data(), samples.size());
+  router.InputFinished();
+
+  sherpa_ncnn::Stream s(config);
+  router.AddStream(&s);
+  assert(s.NumFramesReady() == 0);
+  assert(!s.IsLastFrame(0));
+}
+
+int32_t main() {
+  TestRouter();
+  TestLateStream();
+
+  return 0;
+}
@@ -0,0 +1,246 @@
+// sherpa-ncnn/csrc/test-features.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <memory>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "mat.h"  // NOLINT
+#include "sherpa-ncnn/csrc/features.h"
+#include "sherpa-ncnn/csrc/offline-stream.h"
+
+static std::vector<float> GenerateWaveform(int32_t n) {
+  std::vector<float> samples(n);
+  for (int32_t i = 0; i != n; ++i) {
+    samples[i] = 0.3f * sinf(2 * M_PI * 440 * i / 16000.0f) +
+                 0.1f * sinf(2 * M_PI * 3000 * i / 16000.0f);
+  }
+  return samples;
+}
+
+static ncnn::Mat ComputeExpected(const std::vector<float> &samples) {
+  sherpa_ncnn::FeatureExtractorConfig config;
+  sherpa_ncnn::FeatureExtractor extractor(config);
+  extractor.AcceptWaveform(16000, samples.data(), samples.size());
+  extractor.InputFinished();
+
+  return extractor.GetFrames(0, extractor.NumFramesReady());
+}
+
+// Feed the same waveform to a locked and a lock-free extractor and check
+// that a consumer thread reading from the lock-free one while a producer
+// thread is still feeding it sees exactly the same frames.
+static void TestLockFree() {
+  // A bit more than 5 seconds so that several frame blocks are used
+  int32_t num_samples = 16000 * 5 + 1234;
+  std::vector<float> samples = GenerateWaveform(num_samples);
+
+  ncnn::Mat expected = ComputeExpected(samples);
+  int32_t num_frames = expected.h;
+
+  sherpa_ncnn::FeatureExtractorConfig config;
+  config.lock_free = true;
+  sherpa_ncnn::FeatureExtractor extractor(config);
+
+  std::thread producer([&]() {
+    int32_t chunk = 1600;
+    for (int32_t i = 0; i < num_samples; i += chunk) {
+      int32_t n = std::min(chunk, num_samples - i);
+      extractor.AcceptWaveform(16000, samples.data() + i, n);
+    }
+    extractor.InputFinished();
+  });
+
+  // Read overlapping chunks the way Recognizer does: 39 frames at a time,
+  // advancing by 32
+  int32_t frame_index = 0;
+  int32_t chunk_size = 39;
+  int32_t chunk_shift = 32;
+  while (true) {
+    bool finished = extractor.IsLastFrame(extractor.NumFramesReady() - 1);
+    int32_t num_ready = extractor.NumFramesReady();
+    if (num_ready - frame_index < chunk_size && !finished) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    int32_t n = std::min(chunk_size, num_ready - frame_index);
+    if (n > 0) {
+      ncnn::Mat frames = extractor.GetFrames(frame_index, n);
+      assert(frames.w == expected.w);
+      assert(frames.h == n);
+
+      for (int32_t i = 0; i != n; ++i) {
+        const float *p = frames.row(i);
+        const float *q = expected.row(frame_index + i);
+        for (int32_t k = 0; k != frames.w; ++k) {
+          assert(p[k] == q[k]);
+        }
+      }
+    }
+
+    if (finished && frame_index + chunk_size >= num_ready) break;
+
+    frame_index += chunk_shift;
+  }
+
+  producer.join();
+
+  assert(extractor.NumFramesReady() == num_frames);
+  assert(extractor.IsLastFrame(num_frames - 1));
+
+}
+
+// Feed streams of different lengths in chunks, compute their frames with
+// ComputeFeatures() and compare with knf::OnlineFbank
+static void TestBatchFbank() {
+  int32_t num_streams = 5;
+  std::vector<std::vector<float>> samples(num_streams);
+  std::vector<ncnn::Mat> expected(num_streams);
+  for (int32_t i = 0; i != num_streams; ++i) {
+    samples[i] = GenerateWaveform(16000 + 3217 * i);
+    expected[i] = ComputeExpected(samples[i]);
+  }
+
+  sherpa_ncnn::FeatureExtractorConfig config;
+  config.use_batch_fbank = true;
+
+  std::vector<std::unique_ptr<sherpa_ncnn::FeatureExtractor>> extractors;
+  std::vector<sherpa_ncnn::FeatureExtractor *> pointers;
+  for (int32_t i = 0; i != num_streams; ++i) {
+    extractors.push_back(
+        std::make_unique<sherpa_ncnn::FeatureExtractor>(config));
+    pointers.push_back(extractors.back().get());
+  }
+
+  std::vector<int32_t> offsets(num_streams);
+  std::vector<int32_t> frame_index(num_streams);
+  int32_t chunk = 1000;
+  bool done = false;
+  while (!done) {
+    done = true;
+    for (int32_t i = 0; i != num_streams; ++i) {
+      int32_t n = std::min<int32_t>(chunk, samples[i].size() - offsets[i]);
+      if (n > 0) {
+        extractors[i]->AcceptWaveform(16000, samples[i].data() + offsets[i],
+                                      n);
+        offsets[i] += n;
+        done = false;
+      } else if (n == 0) {
+        extractors[i]->InputFinished();
+        offsets[i] += 1;
+      }
+    }
+
+    sherpa_ncnn::FeatureExtractor::ComputeFeatures(pointers.data(),
+                                                   num_streams);
+
+    for (int32_t i = 0; i != num_streams; ++i) {
+      int32_t n = extractors[i]->NumFramesReady() - frame_index[i];
+      if (n <= 0) continue;
+
+      ncnn::Mat frames = extractors[i]->GetFrames(frame_index[i], n);
+      for (int32_t r = 0; r != n; ++r) {
+        const float *p = frames.row(r);
+        const float *q = expected[i].row(frame_index[i] + r);
+        for (int32_t k = 0; k != frames.w; ++k) {
+          assert(fabsf(p[k] - q[k]) < 1e-3f);
+        }
+      }
+      frame_index[i] += n;
+    }
+  }
+
+  for (int32_t i = 0; i != num_streams; ++i) {
+    assert(frame_index[i] == expected[i].h);
+    assert(extractors[i]->IsLastFrame(expected[i].h - 1));
+  }
+}
+
+// The LFR frames of an offline stream are the stacked fbank frames
+static void TestOfflineLfr() {
+  std::vector<float> samples = GenerateWaveform(16000 * 2 + 321);
+
+  sherpa_ncnn::OfflineStream s;
+  s.AcceptWaveform(16000, samples.data(), samples.size());
+
+  ncnn::Mat frames = s.GetFrames();
+  int32_t window_size = 7;
+  int32_t window_shift = 6;
+  ncnn::Mat lfr = s.GetLfrFrames(window_size, window_shift);
+
+  assert(lfr.w == frames.w * window_size);
+  assert(lfr.h == (frames.h - window_size) / window_shift + 1);
+
+  for (int32_t i = 0; i != lfr.h; ++i) {
+    const float *p = lfr.row(i);
+    for (int32_t k = 0; k != window_size; ++k) {
+      const float *q = frames.row(i * window_shift + k);
+      for (int32_t d = 0; d != frames.w; ++d) {
+        assert(p[k * frames.w + d] == q[d]);
+      }
+    }
+  }
+
+  assert(s.NumLfrFrames(window_size, window_shift) == lfr.h);
+
+  ncnn::Mat part = s.GetLfrFrames(window_size, window_shift, 3, 10);
+  assert(part.w == lfr.w && part.h == 10);
+  for (int32_t i = 0; i != part.h; ++i) {
+    for (int32_t d = 0; d != part.w; ++d) {
+      assert(part.row(i)[d] == lfr.row(i + 3)[d]);
+    }
+  }
+
+  // Too short for a single LFR frame
+  sherpa_ncnn::OfflineStream t;
+  t.AcceptWaveform(16000, samples.data(), 800);
+  assert(t.NumFramesReady() < window_size);
+  assert(t.GetLfrFrames(window_size, window_shift).h == 0);
+}
+
+// Samples given in chunks give the same frames as all of them at once
+static void TestOfflineIncremental(int32_t sampling_rate) {
+  std::vector<float> samples = GenerateWaveform(sampling_rate * 2 + 123);
+
+  sherpa_ncnn::OfflineStream a;
+  a.AcceptWaveform(sampling_rate, samples.data(), samples.size());
+  a.InputFinished();
+
+  sherpa_ncnn::OfflineStream b;
+  int32_t chunk = 1234;
+  for (int32_t i = 0; i < static_cast<int32_t>(samples.size()); i += chunk) {
+    int32_t n = std::min<int32_t>(chunk, samples.size() - i);
+    b.AcceptWaveform(sampling_rate, samples.data() + i, n);
+  }
+  assert(!b.IsInputFinished());
+  b.InputFinished();
+  b.InputFinished();
+  assert(b.IsInputFinished());
+
+  ncnn::Mat fa = a.GetFrames();
+  ncnn::Mat fb = b.GetFrames();
+  assert(fa.w == fb.w && fa.h == fb.h);
+
+  for (int32_t i = 0; i != fa.h; ++i) {
+    for (int32_t d = 0; d != fa.w; ++d) {
+      assert(fabsf(fa.row(i)[d] - fb.row(i)[d]) < 1e-3f);
+    }
+  }
+}
+
+int32_t main() {
+  TestLockFree();
+  TestBatchFbank();
+  TestOfflineLfr();
+  TestOfflineIncremental(16000);
+  TestOfflineIncremental(8000);
+
+  return 0;
+}
@@ -0,0 +1,104 @@
+// sherpa-ncnn/csrc/test-frame-ring.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <assert.h>
+
+#include <vector>
+
+#include "mat.h"  // NOLINT
+#include "sherpa-ncnn/csrc/frame-ring.h"
+
+static constexpr int32_t kDim = 3;
+
+// Frame k is k * 10 + d for dimension d
+static std::vector<float> Frame(int32_t k) {
+  std::vector<float> ans(kDim);
+  for (int32_t d = 0; d != kDim; ++d) {
+    ans[d] = k * 10 + d;
+  }
+  return ans;
+}
+
+static bool IsWindow(const ncnn::Mat &m, int32_t frame_index, int32_t n) {
+  if (m.w != kDim || m.h != n) return false;
+
+  const float *p = m;
+  for (int32_t i = 0; i != n; ++i) {
+    std::vector<float> f = Frame(frame_index + i);
+    for (int32_t d = 0; d != kDim; ++d) {
+      if (p[i * kDim + d] != f[d]) return false;
+    }
+  }
+
+  return true;
+}
+
+// Windows of 39 frames advancing by 32 wrap around the ring and are
+// still contiguous
+static void TestSlidingWindow() {
+  sherpa_ncnn::FrameRing ring(kDim);
+
+  int32_t segment = 39;
+  int32_t offset = 32;
+  int32_t num_processed = 0;
+  for (int32_t k = 0; k != 1000; ++k) {
+    std::vector<float> f = Frame(k);
+    ring.Push(f.data());
+
+    while (num_processed + segment <= ring.NumFrames()) {
+      ncnn::Mat m = ring.View(num_processed, segment);
+      assert(IsWindow(m, num_processed, segment));
+      num_processed += offset;
+    }
+  }
+
+  assert(ring.NumFrames() == 1000);
+
+  // Only the frames from the last window on are kept, so the ring did not
+  // grow with the input
+  assert(ring.NumBytes() < 1000 * kDim * sizeof(float));
+}
+
+// A view is not changed by later pushes, even if the ring grows
+static void TestViewOutlivesGrowth() {
+  sherpa_ncnn::FrameRing ring(kDim);
+  for (int32_t k = 0; k != 10; ++k) {
+    std::vector<float> f = Frame(k);
+    ring.Push(f.data());
+  }
+
+  ncnn::Mat m = ring.View(2, 8);
+
+  // Nothing is consumed, so the ring has to grow
+  for (int32_t k = 10; k != 500; ++k) {
+    std::vector<float> f = Frame(k);
+    ring.Push(f.data());
+  }
+
+  assert(IsWindow(m, 2, 8));
+  assert(IsWindow(ring.View(2, 400), 2, 400));
+}
+
+// A view stays valid after the ring is destroyed
+static void TestViewOutlivesRing() {
+  ncnn::Mat m;
+  {
+    sherpa_ncnn::FrameRing ring(kDim);
+    for (int32_t k = 0; k != 100; ++k) {
+      std::vector<float> f = Frame(k);
+      ring.Push(f.data());
+    }
+    m = ring.View(70, 20);
+  }
+
+  assert(IsWindow(m, 70, 20));
+}
+
+int32_t main() {
+  TestSlidingWindow();
+  TestViewOutlivesGrowth();
+  TestViewOutlivesRing();
+
+  return 0;
+}
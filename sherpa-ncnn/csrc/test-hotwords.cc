@@ -0,0 +1,61 @@
+// sherpa-ncnn/csrc/test-hotwords.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <cassert>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/hotwords.h"
+
+static sherpa_ncnn::SymbolTable MakeSymbolTable() {
+  std::string s = "<blk> 0\nHE 1\nLL 2\nO 3\nWORLD 4\n";
+  return sherpa_ncnn::SymbolTable(
+      reinterpret_cast<const unsigned char *>(s.data()), s.size());
+}
+
+static void TestReadHotwords() {
+  auto sym = MakeSymbolTable();
+
+  std::istringstream is("HE LL O :2.5\n\nWORLD\n");
+  std::vector<std::vector<int32_t>> hotwords;
+  std::vector<float> scores;
+  bool ok = sherpa_ncnn::ReadHotwords(is, sym, &hotwords, &scores);
+  assert(ok);
+  assert(hotwords.size() == 2);
+  assert(hotwords[0] == (std::vector<int32_t>{1, 2, 3}));
+  assert(hotwords[1] == std::vector<int32_t>{4});
+  assert(scores == (std::vector<float>{2.5, 0}));
+  (void)ok;
+}
+
+// A token that is not in the symbol table is an error, not an exit, since
+// hotwords may come from a user at runtime
+static void TestInvalidHotwords() {
+  auto sym = MakeSymbolTable();
+
+  for (const char *text : {"HE LL O\nHELLO\n", "HE :x\n", "HE :1.5y\n"}) {
+    std::istringstream is(text);
+    std::vector<std::vector<int32_t>> hotwords;
+    std::vector<float> scores;
+    bool ok = sherpa_ncnn::ReadHotwords(is, sym, &hotwords, &scores);
+    assert(!ok);
+    (void)ok;
+
+    std::istringstream is2(text);
+    assert(!sherpa_ncnn::CreateContextGraph(is2, sym, 1.5));
+  }
+
+  std::istringstream is("HE LL O\n");
+  assert(sherpa_ncnn::CreateContextGraph(is, sym, 1.5));
+
+  assert(!sherpa_ncnn::CreateContextGraph("/no/such/hotwords.txt", sym, 1.5));
+}
+
+int32_t main() {
+  TestReadHotwords();
+  TestInvalidHotwords();
+
+  return 0;
+}
@@ -0,0 +1,81 @@
+// sherpa-ncnn/csrc/test-joiner-argmax.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "mat.h"
+#include "sherpa-ncnn/csrc/joiner-argmax.h"
+
+// Compare the argmax of fp16 and bf16 numbers with that of the same
+// numbers converted to float
+static void TestArgmaxHalf(int32_t n, bool bf16) {
+  std::mt19937 gen(n);
+  std::normal_distribution<float> dist(-3, 5);
+
+  for (int32_t round = 0; round != 20; ++round) {
+    std::vector<uint16_t> in(n);
+    std::vector<float> expected(n);
+    for (int32_t i = 0; i != n; ++i) {
+      float f = dist(gen);
+      if (round % 4 == 1) {
+        f = -std::abs(f);  // all negative
+      } else if (round % 4 == 2 && i % 3 == 0) {
+        f = 0;  // many equal values
+      }
+
+      if (bf16) {
+        in[i] = ncnn::float32_to_bfloat16(f);
+        expected[i] = ncnn::bfloat16_to_float32(in[i]);
+      } else {
+        in[i] = ncnn::float32_to_float16(f);
+        expected[i] = ncnn::float16_to_float32(in[i]);
+      }
+    }
+
+    auto k = std::distance(expected.begin(),
+                           std::max_element(expected.begin(), expected.end()));
+    assert(sherpa_ncnn::ArgmaxHalf(in.data(), n) == k);
+  }
+}
+
+static void TestArgmaxJoinerOut() {
+  int32_t vocab_size = 512;
+  std::vector<float> logits(vocab_size);
+  for (int32_t i = 0; i != vocab_size; ++i) {
+    logits[i] = (i * 37 % 101) * 0.25f - 10;
+  }
+  logits[345] = 20;
+
+  // fp32 with packing
+  ncnn::Mat fp32(vocab_size / 4, 16u, 4);
+  std::copy(logits.begin(), logits.end(), static_cast<float *>(fp32));
+  assert(sherpa_ncnn::ArgmaxJoinerOut(fp32) == 345);
+
+  // fp16 with packing
+  ncnn::Mat fp16(vocab_size / 8, 16u, 8);
+  auto *p = static_cast<uint16_t *>(fp16.data);
+  for (int32_t i = 0; i != vocab_size; ++i) {
+    p[i] = ncnn::float32_to_float16(logits[i]);
+  }
+  assert(sherpa_ncnn::ArgmaxJoinerOut(fp16) == 345);
+}
+
+int main() {
+  for (bool bf16 : {false, true}) {
+    TestArgmaxHalf(1, bf16);
+    TestArgmaxHalf(7, bf16);
+    TestArgmaxHalf(8, bf16);
+    TestArgmaxHalf(500, bf16);
+    TestArgmaxHalf(6254, bf16);
+  }
+
+  TestArgmaxJoinerOut();
+
+  return 0;
+}
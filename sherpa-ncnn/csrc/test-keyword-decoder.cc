@@ -0,0 +1,185 @@
+// sherpa-ncnn/csrc/test-keyword-decoder.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <assert.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/context-graph.h"
+#include "sherpa-ncnn/csrc/decoder.h"
+#include "sherpa-ncnn/csrc/keyword-decoder.h"
+#include "sherpa-ncnn/csrc/model.h"
+
+namespace {
+
+constexpr int32_t kVocabSize = 6;
+constexpr int32_t kDecoderDim = 4;
+
+// The encoder output of a frame is used as the joiner output of every
+// hypothesis, so a test specifies the token probabilities frame by frame
+class FakeModel : public sherpa_ncnn::Model {
+ public:
+  ncnn::Net &GetEncoder() override { return net_; }
+  ncnn::Net &GetDecoder() override { return net_; }
+  ncnn::Net &GetJoiner() override { return net_; }
+
+  std::vector<ncnn::Mat> GetEncoderInitStates() const override { return {}; }
+
+  std::pair<ncnn::Mat, std::vector<ncnn::Mat>> RunEncoder(
+      ncnn::Mat &, const std::vector<ncnn::Mat> &) override {
+    return {};
+  }
+
+  std::pair<ncnn::Mat, std::vector<ncnn::Mat>> RunEncoder(
+      ncnn::Mat &, const std::vector<ncnn::Mat> &,
+      ncnn::Extractor *) override {
+    return {};
+  }
+
+  ncnn::Mat RunEncoder(ncnn::Mat &, const std::vector<ncnn::Mat> &,
+                       ncnn::Extractor *,
+                       std::vector<ncnn::Mat> *) override {
+    return {};
+  }
+
+  ncnn::Mat RunDecoder(ncnn::Mat &) override {
+    ncnn::Mat ans(kDecoderDim);
+    ans.fill(0.0f);
+    return ans;
+  }
+
+  ncnn::Mat RunDecoder(ncnn::Mat &decoder_input, ncnn::Extractor *) override {
+    return RunDecoder(decoder_input);
+  }
+
+  // decoder_out has one row per hypothesis
+  ncnn::Mat RunJoiner(ncnn::Mat &encoder_out,
+                      ncnn::Mat &decoder_out) override {
+    ncnn::Mat ans(kVocabSize, decoder_out.h);
+    const float *p = encoder_out;
+    for (int32_t i = 0; i != decoder_out.h; ++i) {
+      float *q = ans.row(i);
+      for (int32_t k = 0; k != kVocabSize; ++k) {
+        q[k] = p[k];
+      }
+    }
+    return ans;
+  }
+
+  ncnn::Mat RunJoiner(ncnn::Mat &encoder_out, ncnn::Mat &decoder_out,
+                      ncnn::Extractor *) override {
+    return RunJoiner(encoder_out, decoder_out);
+  }
+
+  int32_t Segment() const override { return 39; }
+  int32_t Offset() const override { return 32; }
+
+ private:
+  ncnn::Net net_;
+};
+
+}  // namespace
+
+// Return the encoder output of the given frames. The token of each frame
+// has the logit score and the other tokens have 0. Token 0 is blank.
+static ncnn::Mat Frames(const std::vector<int32_t> &tokens, float score) {
+  ncnn::Mat ans(kVocabSize, static_cast<int32_t>(tokens.size()));
+  ans.fill(0.0f);
+  for (int32_t t = 0; t != static_cast<int32_t>(tokens.size()); ++t) {
+    ans.row(t)[tokens[t]] = score;
+  }
+  return ans;
+}
+
+// Decode the frames in chunks of chunk_size frames, starting at frame
+// offset, like a stream does
+static sherpa_ncnn::DecoderResult Decode(sherpa_ncnn::KeywordDecoder *decoder,
+                                         const std::vector<int32_t> &tokens,
+                                         float score, int32_t chunk_size,
+                                         int32_t offset = 0) {
+  sherpa_ncnn::DecoderResult r = decoder->GetEmptyResult();
+  r.frame_offset = offset;
+
+  ncnn::Mat frames = Frames(tokens, score);
+  for (int32_t t = 0; t < frames.h; t += chunk_size) {
+    int32_t n = std::min(chunk_size, frames.h - t);
+    ncnn::Mat chunk(frames.w, n, frames.row(t));
+    decoder->Decode(chunk, &r);
+  }
+
+  return r;
+}
+
+static void TestDetect() {
+  FakeModel model;
+
+  // Keyword 2 3 4 uses the default threshold 0.5. Keyword 5 1 has its own.
+  sherpa_ncnn::ContextGraph graph({{2, 3, 4}, {5, 1}}, 0, 0.5f, {}, {},
+                                  {0, 0.2f});
+  sherpa_ncnn::KeywordDecoder decoder(&model, &graph, 4, 1, 8);
+
+  std::vector<int32_t> tokens = {0, 0, 2, 0, 3, 4, 0, 0, 0, 0};
+
+  // The chunk size does not change the result, e.g., when chunks are
+  // decoded back to back while the spotter is idle
+  for (int32_t chunk_size : {1, 3, 16}) {
+    auto r = Decode(&decoder, tokens, 10, chunk_size);
+    assert(r.keyword != nullptr);
+    assert(r.keyword->is_end);
+    assert(r.keyword->level == 3);
+    assert(r.tokens == (std::vector<int32_t>{2, 3, 4}));
+    assert(r.timestamps == (std::vector<int32_t>{2, 4, 5}));
+    assert(r.frame_offset == static_cast<int32_t>(tokens.size()));
+
+    // After the detection, the search is back at the root
+    assert(decoder.IsIdle(r));
+  }
+
+  // Timestamps count from the start of the stream
+  auto r = Decode(&decoder, tokens, 10, 3, 100);
+  assert(r.keyword != nullptr);
+  assert(r.timestamps == (std::vector<int32_t>{102, 104, 105}));
+
+  // No keyword in the audio
+  r = Decode(&decoder, {0, 1, 3, 0, 4, 1, 0, 0}, 10, 3);
+  assert(r.keyword == nullptr);
+  assert(decoder.IsIdle(r));
+
+  // The probability of each token is about 0.35, which is below 0.5 but
+  // above 0.2
+  r = Decode(&decoder, {0, 2, 3, 4, 0, 0}, 1, 3);
+  assert(r.keyword == nullptr);
+
+  r = Decode(&decoder, {0, 5, 1, 0, 0}, 1, 3);
+  assert(r.keyword != nullptr);
+  assert(r.tokens == (std::vector<int32_t>{5, 1}));
+  assert(r.timestamps == (std::vector<int32_t>{1, 2}));
+  (void)r;
+}
+
+static void TestPause() {
+  FakeModel model;
+  sherpa_ncnn::ContextGraph graph({{2, 3}}, 0, 0.5f);
+
+  // A partial match is dropped after max_blank_frames blanks
+  sherpa_ncnn::KeywordDecoder decoder(&model, &graph, 4, 1, 2);
+
+  auto r = Decode(&decoder, {2, 0, 0, 3, 0, 0}, 10, 2);
+  assert(r.keyword != nullptr);
+  assert(r.timestamps == (std::vector<int32_t>{0, 3}));
+
+  r = Decode(&decoder, {2, 0, 0, 0, 3, 0, 0}, 10, 2);
+  assert(r.keyword == nullptr);
+  (void)r;
+}
+
+int32_t main() {
+  TestDetect();
+  TestPause();
+
+  return 0;
+}
@@ -0,0 +1,181 @@
+// sherpa-ncnn/csrc/test-log-softmax-topk.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/log-softmax-topk.h"
+#include "sherpa-ncnn/csrc/math.h"
+
+// Compare the vectorized LogSoftmax() for float with the generic one
+static void TestLogSoftmax(int32_t n) {
+  std::mt19937 gen(n);
+  std::normal_distribution<float> dist(0, 5);
+
+  std::vector<float> in(n);
+  std::vector<double> expected(n);
+  for (int32_t i = 0; i != n; ++i) {
+    in[i] = dist(gen);
+    expected[i] = in[i];
+  }
+
+  sherpa_ncnn::LogSoftmax(in.data(), n);
+  sherpa_ncnn::LogSoftmax<double>(expected.data(), n);
+
+  for (int32_t i = 0; i != n; ++i) {
+    assert(std::abs(in[i] - expected[i]) < 1e-4);
+  }
+}
+
+// Compare with LogSoftmax() + adding prior + TopkIndex()
+static void TestLogSoftmaxTopk(int32_t num_rows, int32_t num_cols, int32_t k,
+                               bool use_prior) {
+  std::mt19937 gen(num_rows * 131 + num_cols * 7 + k);
+  std::normal_distribution<float> dist(0, 5);
+
+  std::vector<float> in(num_rows * num_cols);
+  for (auto &f : in) {
+    f = dist(gen);
+  }
+
+  std::vector<float> prior(num_rows);
+  for (auto &f : prior) {
+    f = use_prior ? -std::abs(dist(gen)) : 0;
+  }
+
+  std::vector<float> expected = in;
+  for (int32_t r = 0; r != num_rows; ++r) {
+    float *p = expected.data() + r * num_cols;
+    sherpa_ncnn::LogSoftmax(p, num_cols);
+    for (int32_t c = 0; c != num_cols; ++c) {
+      p[c] += prior[r];
+    }
+  }
+
+  // TopkIndex() requires k <= size
+  std::vector<int32_t> expected_index = sherpa_ncnn::TopkIndex(
+      expected.data(), num_rows * num_cols, std::min(k, num_rows * num_cols));
+
+  std::vector<int32_t> index(k);
+  std::vector<float> value(k);
+  int32_t n = sherpa_ncnn::LogSoftmaxTopk(
+      in.data(), num_rows, num_cols, use_prior ? prior.data() : nullptr, k,
+      index.data(), value.data());
+
+  assert(n == static_cast<int32_t>(expected_index.size()));
+
+  for (int32_t i = 0; i != n; ++i) {
+    assert(std::abs(value[i] - expected[index[i]]) < 1e-4);
+    // Indexes may differ when two entries are (nearly) equal, so we
+    // compare the values
+    assert(std::abs(value[i] - expected[expected_index[i]]) < 1e-4);
+    if (i > 0) {
+      assert(value[i - 1] >= value[i]);
+    }
+  }
+
+  // The values are optional
+  std::vector<int32_t> index2(k);
+  int32_t n2 = sherpa_ncnn::LogSoftmaxTopk(
+      in.data(), num_rows, num_cols, use_prior ? prior.data() : nullptr, k,
+      index2.data(), nullptr);
+  assert(n2 == n);
+  assert(index2 == index);
+}
+
+// Boost a few columns of each row, some of them enough to enter the top-k
+static void TestLogSoftmaxTopkBoost(int32_t num_rows, int32_t num_cols,
+                                    int32_t k) {
+  std::mt19937 gen(num_rows * 17 + num_cols * 3 + k);
+  std::normal_distribution<float> dist(0, 5);
+  std::uniform_int_distribution<int32_t> col_dist(0, num_cols - 1);
+
+  std::vector<float> in(num_rows * num_cols);
+  for (auto &f : in) {
+    f = dist(gen);
+  }
+
+  std::vector<float> prior(num_rows);
+  for (auto &f : prior) {
+    f = -std::abs(dist(gen));
+  }
+
+  std::vector<int32_t> boost_begin = {0};
+  std::vector<int32_t> boost_col;
+  std::vector<float> boost_value;
+  for (int32_t r = 0; r != num_rows; ++r) {
+    std::vector<int32_t> cols(std::min(num_cols, 5));
+    for (auto &c : cols) {
+      c = col_dist(gen);
+    }
+    std::sort(cols.begin(), cols.end());
+    cols.erase(std::unique(cols.begin(), cols.end()), cols.end());
+
+    for (auto c : cols) {
+      boost_col.push_back(c);
+      boost_value.push_back(dist(gen) * 3);
+    }
+    boost_begin.push_back(static_cast<int32_t>(boost_col.size()));
+  }
+
+  std::vector<float> expected = in;
+  for (int32_t r = 0; r != num_rows; ++r) {
+    float *p = expected.data() + r * num_cols;
+    sherpa_ncnn::LogSoftmax(p, num_cols);
+    for (int32_t c = 0; c != num_cols; ++c) {
+      p[c] += prior[r];
+    }
+    for (int32_t b = boost_begin[r]; b != boost_begin[r + 1]; ++b) {
+      p[boost_col[b]] += boost_value[b];
+    }
+  }
+
+  std::vector<int32_t> expected_index = sherpa_ncnn::TopkIndex(
+      expected.data(), num_rows * num_cols, std::min(k, num_rows * num_cols));
+
+  std::vector<int32_t> index(k);
+  std::vector<float> value(k);
+  int32_t n = sherpa_ncnn::LogSoftmaxTopk(
+      in.data(), num_rows, num_cols, prior.data(), boost_begin.data(),
+      boost_col.data(), boost_value.data(), k, index.data(), value.data());
+
+  assert(n == static_cast<int32_t>(expected_index.size()));
+
+  for (int32_t i = 0; i != n; ++i) {
+    assert(std::abs(value[i] - expected[index[i]]) < 1e-4);
+    assert(std::abs(value[i] - expected[expected_index[i]]) < 1e-4);
+    if (i > 0) {
+      // Each entry is found once
+      assert(std::find(index.begin(), index.begin() + i, index[i]) ==
+             index.begin() + i);
+    }
+  }
+}
+
+int main() {
+  for (int32_t n : {1, 3, 4, 7, 8, 9, 17, 500, 5537}) {
+    TestLogSoftmax(n);
+  }
+
+  for (bool use_prior : {false, true}) {
+    TestLogSoftmaxTopk(1, 1, 1, use_prior);
+    TestLogSoftmaxTopk(1, 3, 4, use_prior);
+    TestLogSoftmaxTopk(1, 500, 4, use_prior);
+    TestLogSoftmaxTopk(4, 500, 4, use_prior);
+    TestLogSoftmaxTopk(4, 6254, 4, use_prior);
+    TestLogSoftmaxTopk(8, 5537, 8, use_prior);
+    TestLogSoftmaxTopk(10, 33, 100, use_prior);
+    TestLogSoftmaxTopk(3, 7, 30, use_prior);
+  }
+
+  TestLogSoftmaxTopkBoost(1, 3, 4);
+  TestLogSoftmaxTopkBoost(4, 500, 4);
+  TestLogSoftmaxTopkBoost(8, 5537, 8);
+  TestLogSoftmaxTopkBoost(10, 33, 100);
+
+  return 0;
+}
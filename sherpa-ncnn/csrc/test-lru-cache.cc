@@ -0,0 +1,52 @@
+// sherpa-ncnn/csrc/test-lru-cache.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <cassert>
+#include <string>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/lru-cache.h"
+
+static void TestEviction() {
+  sherpa_ncnn::LruCache<std::string, std::vector<int32_t>> cache(2);
+
+  cache.Put("a", {1});
+  cache.Put("b", {2});
+
+  std::vector<int32_t> v;
+  assert(cache.Get("a", &v) && v == std::vector<int32_t>{1});
+
+  // b is the least recently used one
+  cache.Put("c", {3});
+  assert(cache.Size() == 2);
+  assert(!cache.Get("b", &v));
+  assert(cache.Get("a", &v) && v == std::vector<int32_t>{1});
+  assert(cache.Get("c", &v) && v == std::vector<int32_t>{3});
+
+  // Replacing a value does not evict anything
+  cache.Put("a", {4, 5});
+  assert(cache.Size() == 2);
+  assert(cache.Get("a", &v) && v == (std::vector<int32_t>{4, 5}));
+  assert(cache.Get("c", &v));
+
+  cache.Clear();
+  assert(cache.Size() == 0);
+  assert(!cache.Get("a", &v));
+}
+
+static void TestDisabled() {
+  sherpa_ncnn::LruCache<int32_t, int32_t> cache(0);
+  cache.Put(1, 2);
+
+  int32_t v = 0;
+  assert(!cache.Get(1, &v));
+  assert(cache.Size() == 0);
+}
+
+int32_t main() {
+  TestEviction();
+  TestDisabled();
+
+  return 0;
+}
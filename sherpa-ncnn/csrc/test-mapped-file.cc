@@ -0,0 +1,56 @@
+// sherpa-ncnn/csrc/test-mapped-file.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <assert.h>
+#include <stdio.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#include "sherpa-ncnn/csrc/mapped-file.h"
+
+int32_t main() {
+  std::string filename = "test-mapped-file.bin";
+
+  std::string content;
+  for (int32_t i = 0; i != 10000; ++i) {
+    content.push_back(static_cast<char>(i * 31));
+  }
+
+  {
+    std::ofstream os(filename, std::ios::binary);
+    os.write(content.data(), content.size());
+  }
+
+  {
+    auto f = sherpa_ncnn::MappedFile::Open(filename);
+    assert(f);
+    assert(f->Size() == content.size());
+    assert(std::memcmp(f->Data(), content.data(), content.size()) == 0);
+  }
+
+  {
+    auto f = sherpa_ncnn::MappedFile::ReadIntoHugePages(filename);
+    assert(f);
+    assert(f->Size() == content.size());
+    assert(std::memcmp(f->Data(), content.data(), content.size()) == 0);
+  }
+
+  // The mapping is released, so the file can be truncated
+  {
+    std::ofstream os(filename, std::ios::binary);
+  }
+  assert(!sherpa_ncnn::MappedFile::Open(filename));
+  assert(!sherpa_ncnn::MappedFile::ReadIntoHugePages(filename));
+
+  remove(filename.c_str());
+  assert(!sherpa_ncnn::MappedFile::Open(filename));
+  assert(!sherpa_ncnn::MappedFile::ReadIntoHugePages(filename));
+
+  fprintf(stderr, "Done\n");
+
+  return 0;
+}
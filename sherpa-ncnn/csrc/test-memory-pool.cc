@@ -0,0 +1,197 @@
+// sherpa-ncnn/csrc/test-memory-pool.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <assert.h>
+#include <stdio.h>
+
+#include <cstdint>
+#include <thread>  // NOLINT
+
+#include "mat.h"  // NOLINT
+#include "sherpa-ncnn/csrc/huge-pages.h"
+#include "sherpa-ncnn/csrc/memory-pool.h"
+
+static void TestReuse() {
+  sherpa_ncnn::MemoryPool pool(true, 0);
+
+  void *a = pool.fastMalloc(1000);
+  void *b = pool.fastMalloc(3000);
+  assert(pool.NumBytes() == 4000);
+
+  pool.fastFree(a);
+  pool.fastFree(b);
+
+  // The smallest chunk that is large enough is used
+  void *c = pool.fastMalloc(500);
+  assert(c == a);
+
+  void *d = pool.fastMalloc(2000);
+  assert(d == b);
+
+  assert(pool.NumBytes() == 4000);
+  assert(pool.HighWaterMark() == 4000);
+
+  pool.fastFree(c);
+  pool.fastFree(d);
+}
+
+static void TestLimit() {
+  sherpa_ncnn::MemoryPool pool(false, 2500);
+
+  void *a = pool.fastMalloc(1000);
+  void *b = pool.fastMalloc(2000);
+  assert(pool.NumBytes() == 3000);
+
+  // The pool is over the limit, so the chunk is released
+  pool.fastFree(b);
+  assert(pool.NumBytes() == 1000);
+
+  pool.fastFree(a);
+  assert(pool.NumBytes() == 1000);
+
+  // A larger chunk releases the free one that is too small
+  void *c = pool.fastMalloc(2000);
+  assert(pool.NumBytes() == 2000);
+  assert(pool.HighWaterMark() == 3000);
+
+  pool.fastFree(c);
+}
+
+// Large chunks are in huge pages and small ones are not, and both are
+// reused and released
+static void TestHugePages() {
+  std::size_t large = sherpa_ncnn::kHugePageSize + 1000;
+
+  {
+    sherpa_ncnn::MemoryPool pool(true, 0, true);
+    auto *a = static_cast<char *>(pool.fastMalloc(large));
+    auto *b = static_cast<char *>(pool.fastMalloc(100));
+    a[0] = 1;
+    a[large - 1] = 2;
+    b[99] = 3;
+
+    pool.fastFree(a);
+    assert(pool.fastMalloc(large) == a);
+    assert(pool.NumBytes() == large + 100);
+
+    pool.fastFree(a);
+    pool.fastFree(b);
+  }
+
+  {
+    sherpa_ncnn::MemoryPool pool(false, 1 << 20, true);
+    void *a = pool.fastMalloc(large);
+
+    // Over the limit, so it is released
+    pool.fastFree(a);
+    assert(pool.NumBytes() == 0);
+  }
+}
+
+static void TestArena() {
+  sherpa_ncnn::MemoryArena arena(4096);
+  assert(arena.Capacity() == 4096);
+
+  void *a = arena.fastMalloc(1000);
+  void *b = arena.fastMalloc(1000);
+  assert(a && b);
+  assert(reinterpret_cast<std::uintptr_t>(a) % 64 == 0);
+  assert(arena.NumBytes() > 2000);
+
+  // Over the capacity
+  assert(arena.fastMalloc(4000) == nullptr);
+  assert(arena.NumFailures() == 1);
+
+  // Freed blocks are merged, so that a larger request fits
+  arena.fastFree(a);
+  arena.fastFree(b);
+  assert(arena.NumBytes() == 0);
+
+  void *c = arena.fastMalloc(3000);
+  assert(c == a);
+
+  // The smallest free block that fits is used
+  void *d = arena.fastMalloc(100);
+  arena.fastFree(c);
+  void *e = arena.fastMalloc(2000);
+  void *f = arena.fastMalloc(100);
+  assert(e == a);
+  assert(f != nullptr && f != d);
+
+  arena.fastFree(d);
+  arena.fastFree(e);
+  arena.fastFree(f);
+  assert(arena.NumBytes() == 0);
+  assert(arena.HighWaterMark() > 3000);
+}
+
+// Memory provided by the caller, which need not be aligned
+static void TestArenaWithBuffer() {
+  static char buffer[10000];
+  sherpa_ncnn::MemoryArena arena(buffer + 1, sizeof(buffer) - 1);
+  assert(arena.Capacity() <= sizeof(buffer) - 1);
+
+  ncnn::Mat m(100, 10, 4u, &arena);
+  assert(!m.empty());
+  auto *p = static_cast<char *>(m.data);
+  assert(p > buffer && p < buffer + sizeof(buffer));
+}
+
+static void TestModelMemoryPools(bool per_thread) {
+  sherpa_ncnn::ModelMemoryPools pools(per_thread, 0);
+
+  ncnn::Mat m(16, 4);
+  assert(!pools.Owns(m));
+
+  ncnn::Mat state;
+  auto run = [&]() {
+    ncnn::Mat out(16, 4, 4u, pools.BlobPool());
+    out.fill(1.0f);
+    assert(pools.Owns(out));
+
+    ncnn::Mat d = pools.Detach(out);
+    assert(!pools.Owns(d));
+    assert(d[0] == 1.0f);
+
+    // The second copy reuses the memory of the first one
+    pools.CopyTo(out, &state);
+    void *p = state.data;
+    pools.CopyTo(out, &state);
+    assert(state.data == p);
+    assert(!pools.Owns(state));
+  };
+
+  run();
+
+  // The pools of another thread
+  std::thread t(run);
+  t.join();
+
+  assert(pools.HighWaterMark() > 0);
+}
+
+static void TestModelMemoryPoolsWithArena() {
+  sherpa_ncnn::ModelMemoryPools pools(true, 0, false, 1);
+  assert(pools.Arena() != nullptr);
+  assert(pools.BlobPool() == pools.Arena());
+  assert(pools.WorkspacePool() == pools.Arena());
+
+  ncnn::Mat out(16, 4, 4u, pools.BlobPool());
+  assert(pools.Owns(out));
+  assert(!pools.Owns(pools.Detach(out)));
+  assert(pools.HighWaterMark() > 0);
+}
+
+int32_t main() {
+  TestReuse();
+  TestLimit();
+  TestHugePages();
+  TestModelMemoryPools(false);
+  TestModelMemoryPools(true);
+  TestArena();
+  TestArenaWithBuffer();
+  TestModelMemoryPoolsWithArena();
+
+  return 0;
+}
@@ -0,0 +1,77 @@
+// sherpa-ncnn/csrc/test-memory-usage.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <assert.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/memory-usage.h"
+#include "sherpa-ncnn/csrc/stream.h"
+
+static void TestMemoryBudget() {
+  auto budget = std::make_shared<sherpa_ncnn::MemoryBudget>(1000);
+
+  auto a = sherpa_ncnn::MemoryReservation::Create(budget, 600);
+  assert(a);
+  assert(budget->Used() == 600);
+
+  // It does not fit, so nothing is reserved
+  auto b = sherpa_ncnn::MemoryReservation::Create(budget, 600);
+  assert(!b);
+  assert(budget->Used() == 600);
+
+  auto c = sherpa_ncnn::MemoryReservation::Create(budget, 400);
+  assert(c);
+  assert(budget->Used() == 1000);
+
+  a.reset();
+  assert(budget->Used() == 400);
+
+  b = sherpa_ncnn::MemoryReservation::Create(budget, 600);
+  assert(b);
+
+  b.reset();
+  c.reset();
+  assert(budget->Used() == 0);
+}
+
+static void TestStreamMemoryUsage() {
+  sherpa_ncnn::FeatureExtractorConfig feat_config;
+  auto graph = std::make_shared<sherpa_ncnn::ContextGraph>(
+      std::vector<std::vector<int32_t>>{{1, 2, 3}, {1, 4}}, 1.5f);
+
+  sherpa_ncnn::Stream s(feat_config, graph);
+
+  std::vector<ncnn::Mat> states = {ncnn::Mat(16, 4), ncnn::Mat(8)};
+  for (auto &m : states) {
+    m.fill(0.0f);
+  }
+  s.SetStates(states);
+
+  auto usage = s.GetMemoryUsage();
+  assert(usage.encoder_states == (16 * 4 + 8) * sizeof(float));
+  assert(usage.context_graph == graph->NumBytes());
+  assert(usage.context_graph > 0);
+
+  // One second of audio is buffered as fbank frames
+  std::vector<float> samples(16000);
+  s.AcceptWaveform(16000, samples.data(), samples.size());
+
+  auto usage2 = s.GetMemoryUsage();
+  assert(usage2.features >= static_cast<std::size_t>(s.NumFramesReady()) *
+                                feat_config.feature_dim * sizeof(float));
+  assert(usage2.Total() > usage.Total());
+
+  (void)usage;
+  (void)usage2;
+}
+
+int32_t main() {
+  TestMemoryBudget();
+  TestStreamMemoryUsage();
+
+  return 0;
+}
@@ -0,0 +1,105 @@
+// sherpa-ncnn/csrc/test-metrics.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <assert.h>
+
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "sherpa-ncnn/csrc/metrics.h"
+
+using sherpa_ncnn::MetricCounter;
+using sherpa_ncnn::MetricGauge;
+using sherpa_ncnn::MetricHistogram;
+using sherpa_ncnn::Metrics;
+using sherpa_ncnn::Stage;
+
+static bool Contains(const std::string &s, const std::string &t) {
+  return s.find(t) != std::string::npos;
+}
+
+// Updates of different threads go to different shards and are summed up
+static void TestThreads() {
+  Metrics::Reset();
+
+  std::vector<std::thread> threads;
+  for (int32_t i = 0; i != 8; ++i) {
+    threads.emplace_back([]() {
+      for (int32_t k = 0; k != 1000; ++k) {
+        Metrics::Add(MetricCounter::kChunksDecoded);
+        Metrics::ObserveStage(Stage::kEncoder, 0.003);
+      }
+    });
+  }
+
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  assert(Metrics::Get(MetricCounter::kChunksDecoded) == 8000);
+  assert(Metrics::Count(Stage::kEncoder) == 8000);
+}
+
+static void TestDisabled() {
+  Metrics::Reset();
+  Metrics::Enable(false);
+
+  Metrics::Add(MetricCounter::kEndpoints);
+  Metrics::Observe(MetricHistogram::kChunkRealTimeFactor, 0.1);
+  Metrics::Add(MetricGauge::kStreamsActive, 1);
+
+  assert(Metrics::Get(MetricCounter::kEndpoints) == 0);
+  assert(Metrics::Count(MetricHistogram::kChunkRealTimeFactor) == 0);
+
+  // Gauges stay consistent
+  assert(Metrics::Get(MetricGauge::kStreamsActive) == 1);
+  Metrics::Add(MetricGauge::kStreamsActive, -1);
+
+  Metrics::Enable(true);
+}
+
+static void TestOpenMetrics() {
+  Metrics::Reset();
+
+  Metrics::Add(MetricCounter::kVadSegments, 3);
+  Metrics::Observe(MetricHistogram::kTtsRealTimeFactor, 0.15);
+  Metrics::Observe(MetricHistogram::kTtsRealTimeFactor, 0.6);
+  Metrics::ObserveStage(Stage::kJoiner, 0.002);
+
+  std::string s = Metrics::ToOpenMetrics();
+
+  assert(Contains(s, "# TYPE sherpa_ncnn_vad_segments counter\n"));
+  assert(Contains(s, "\nsherpa_ncnn_vad_segments_total 3\n"));
+  assert(Contains(s, "\nsherpa_ncnn_streams_active 0\n"));
+
+  // Buckets are cumulative
+  assert(Contains(
+      s, "sherpa_ncnn_tts_real_time_factor_bucket{le=\"0.1\"} 0\n"));
+  assert(Contains(
+      s, "sherpa_ncnn_tts_real_time_factor_bucket{le=\"0.2\"} 1\n"));
+  assert(Contains(
+      s, "sherpa_ncnn_tts_real_time_factor_bucket{le=\"+Inf\"} 2\n"));
+  assert(Contains(s, "sherpa_ncnn_tts_real_time_factor_count 2\n"));
+  assert(Contains(s, "sherpa_ncnn_tts_real_time_factor_sum 0.75\n"));
+
+  assert(Contains(s, "sherpa_ncnn_stage_seconds_bucket{stage=\"joiner\","
+                     "le=\"0.0025\"} 1\n"));
+  assert(Contains(s, "sherpa_ncnn_stage_seconds_count{stage=\"joiner\"} 1\n"));
+
+  // Stages without samples are skipped
+  assert(!Contains(s, "stage=\"encoder\""));
+
+  assert(s.size() > 6 && s.compare(s.size() - 6, 6, "# EOF\n") == 0);
+}
+
+int32_t main() {
+  Metrics::Enable(true);
+
+  TestThreads();
+  TestDisabled();
+  TestOpenMetrics();
+
+  return 0;
+}
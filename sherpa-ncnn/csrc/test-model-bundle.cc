@@ -0,0 +1,207 @@
+// sherpa-ncnn/csrc/test-model-bundle.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <assert.h>
+#include <stdio.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/model-bundle.h"
+#include "sherpa-ncnn/csrc/symbol-table.h"
+
+static void TestSections() {
+  std::string filename = "test-model-bundle.bundle";
+
+  std::string large(10007, 'x');
+  for (int32_t i = 0; i != static_cast<int32_t>(large.size()); ++i) {
+    large[i] = static_cast<char>(i * 13);
+  }
+
+  {
+    sherpa_ncnn::ModelBundleWriter writer;
+    writer.AddSection("a.param", "7767517\n1 1\n");
+    writer.AddSection("empty", "");
+    writer.AddSection("large", large);
+    assert(writer.Write(filename));
+  }
+
+  {
+    auto bundle = sherpa_ncnn::ModelBundle::Open(filename);
+    assert(bundle);
+
+    std::size_t size = 0;
+    const unsigned char *p = bundle->GetSection("a.param", &size);
+    assert(p);
+    assert(size == 12);
+    assert(std::memcmp(p, "7767517\n1 1\n", size) == 0);
+    assert(p[size] == 0);
+
+    p = bundle->GetSection("empty", &size);
+    assert(p);
+    assert(size == 0);
+    assert(p[0] == 0);
+
+    const unsigned char *base = bundle->GetSection("a.param");
+    p = bundle->GetSection("large", &size);
+    assert(p);
+    assert(size == large.size());
+    assert(std::memcmp(p, large.data(), size) == 0);
+    assert((p - base) % sherpa_ncnn::kModelBundleAlignment == 0);
+
+    assert(!bundle->HasSection("missing"));
+  }
+
+  // Not a bundle
+  {
+    std::ofstream os(filename, std::ios::binary);
+    os << "7767517\n";
+  }
+  assert(!sherpa_ncnn::ModelBundle::Open(filename));
+
+  remove(filename.c_str());
+}
+
+static void TestInMemory() {
+  std::string filename = "test-model-bundle.bundle";
+  {
+    sherpa_ncnn::ModelBundleWriter writer;
+    writer.AddSection("a.param", "7767517\n1 1\n");
+    writer.AddSection("a.bin", "weights");
+    assert(writer.Write(filename));
+  }
+
+  std::string content;
+  {
+    std::ifstream is(filename, std::ios::binary);
+    content.assign(std::istreambuf_iterator<char>(is),
+                   std::istreambuf_iterator<char>());
+  }
+  remove(filename.c_str());
+
+  auto bundle =
+      sherpa_ncnn::ModelBundle::FromMemory(content.data(), content.size());
+  assert(bundle);
+
+  std::size_t size = 0;
+  const unsigned char *p = bundle->GetSection("a.bin", &size);
+  assert(p);
+  assert(size == 7);
+  assert(std::memcmp(p, "weights", size) == 0);
+  assert(p >= reinterpret_cast<const unsigned char *>(content.data()) &&
+         p < reinterpret_cast<const unsigned char *>(content.data()) +
+                 content.size());
+
+  assert(!sherpa_ncnn::ModelBundle::FromMemory("7767517\n", 8));
+
+  // The .param is copied so that it is NUL terminated; the others are not
+  std::string param = "7767517\n1 1\n";
+  std::string bin = "weights";
+  std::string tokens = "<blk> 0\nHELLO 1\n";
+  std::vector<sherpa_ncnn::ModelBuffer> buffers = {
+      {"a.param", param.data(), param.size()},
+      {"a.bin", bin.data(), bin.size()},
+      {"tokens", tokens.data(), tokens.size()},
+  };
+
+  bundle = sherpa_ncnn::ModelBundle::FromBuffers(buffers);
+  assert(bundle);
+
+  p = bundle->GetSection("a.param", &size);
+  assert(p);
+  assert(size == param.size());
+  assert(std::memcmp(p, param.data(), size) == 0);
+  assert(p[size] == 0);
+  assert(p != reinterpret_cast<const unsigned char *>(param.data()));
+
+  p = bundle->GetSection("a.bin", &size);
+  assert(p == reinterpret_cast<const unsigned char *>(bin.data()));
+  assert(size == bin.size());
+
+  // Tokens in memory may be the content of tokens.txt
+  p = bundle->GetSection("tokens", &size);
+  sherpa_ncnn::SymbolTable sym(p, size, bundle);
+  assert(sym.NumSymbols() == 2);
+  assert(sym[1] == "HELLO");
+  assert(sym["<blk>"] == 0);
+}
+
+static void TestSymbolTable() {
+  std::string filename = "test-model-bundle-tokens.txt";
+  {
+    std::ofstream os(filename);
+    os << "<blk> 0\n";
+    os << "\xe2\x96\x81HELLO 1\n";
+    os << "WORLD 2\n";
+    os << "\xe4\xbd\xa0 3\n";
+  }
+
+  sherpa_ncnn::SymbolTable sym(filename);
+  std::string binary = sym.ToBinary();
+
+  sherpa_ncnn::SymbolTable sym2(
+      reinterpret_cast<const unsigned char *>(binary.data()), binary.size());
+
+  for (int32_t i = 0; i != 4; ++i) {
+    assert(sym2.contains(i));
+    assert(sym2[i] == sym[i]);
+    assert(sym2[sym[i]] == i);
+  }
+  assert(!sym2.contains(4));
+  assert(sym2[1] == " HELLO");
+  assert(sym2.contains("WORLD"));
+  assert(!sym2.contains("HELLO"));
+  assert(!sym2.contains(""));
+  assert(sym2.NumSymbols() == 4);
+
+  // The binary form can be used in place of tokens.txt
+  {
+    std::ofstream os(filename, std::ios::binary);
+    os.write(binary.data(), binary.size());
+  }
+
+  sherpa_ncnn::SymbolTable sym3(filename);
+  assert(sym3.ToString() == sym.ToString());
+  assert(sym3.ToBinary() == binary);
+
+  remove(filename.c_str());
+}
+
+// IDs need not be contiguous and the table is larger than one bucket
+static void TestLargeSymbolTable() {
+  std::string filename = "test-model-bundle-tokens.txt";
+  {
+    std::ofstream os(filename);
+    for (int32_t i = 0; i != 30000; ++i) {
+      os << "sym" << i << " " << 2 * i << "\n";
+    }
+  }
+
+  sherpa_ncnn::SymbolTable sym(filename);
+  assert(sym.NumSymbols() == 30000);
+  for (int32_t i = 0; i != 30000; ++i) {
+    std::string s = "sym" + std::to_string(i);
+    assert(sym[2 * i] == s);
+    assert(sym[s] == 2 * i);
+    assert(!sym.contains(2 * i + 1));
+  }
+  assert(!sym.contains("sym30000"));
+
+  remove(filename.c_str());
+}
+
+int32_t main() {
+  TestSections();
+  TestInMemory();
+  TestSymbolTable();
+  TestLargeSymbolTable();
+
+  fprintf(stderr, "Done\n");
+
+  return 0;
+}
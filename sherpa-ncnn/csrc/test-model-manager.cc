@@ -0,0 +1,83 @@
+// sherpa-ncnn/csrc/test-model-manager.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <cassert>
+#include <memory>
+
+#include "sherpa-ncnn/csrc/model-manager.h"
+
+namespace {
+
+int32_t num_alive = 0;
+
+struct FakeStream {
+  int32_t id;
+};
+
+// It stands in for a recognizer. id identifies the model.
+class FakeRecognizer {
+ public:
+  explicit FakeRecognizer(int32_t id) : id_(id) { ++num_alive; }
+  ~FakeRecognizer() { --num_alive; }
+
+  std::unique_ptr<FakeStream> CreateStream() const {
+    return std::make_unique<FakeStream>(FakeStream{id_});
+  }
+
+  int32_t Id() const { return id_; }
+
+ private:
+  int32_t id_;
+};
+
+}  // namespace
+
+static void TestReload() {
+  sherpa_ncnn::ModelManager<FakeRecognizer> manager(
+      std::make_shared<FakeRecognizer>(1));
+  assert(manager.Version() == 0);
+  assert(manager.Get()->Id() == 1);
+
+  {
+    auto s = manager.CreateStream();
+    assert(s.stream->id == 1);
+
+    bool ok = manager.Reload([]() {
+                return std::make_shared<FakeRecognizer>(2);
+              }).get();
+    assert(ok);
+    assert(manager.Version() == 1);
+    assert(manager.Get()->Id() == 2);
+
+    // The old recognizer is kept alive by the stream
+    assert(num_alive == 2);
+    assert(s.recognizer->Id() == 1);
+
+    auto s2 = manager.CreateStream();
+    assert(s2.stream->id == 2);
+  }
+
+  // and released with it
+  assert(num_alive == 1);
+}
+
+static void TestFailedReload() {
+  sherpa_ncnn::ModelManager<FakeRecognizer> manager(
+      std::make_shared<FakeRecognizer>(1));
+
+  bool ok = manager.Reload([]() {
+              return std::shared_ptr<const FakeRecognizer>();
+            }).get();
+  assert(!ok);
+  assert(manager.Version() == 0);
+  assert(manager.Get()->Id() == 1);
+}
+
+int32_t main() {
+  TestReload();
+  TestFailedReload();
+  assert(num_alive == 0);
+
+  return 0;
+}
@@ -0,0 +1,114 @@
+// sherpa-ncnn/csrc/test-ngram-lm.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "sherpa-ncnn/csrc/ngram-lm.h"
+#include "sherpa-ncnn/csrc/symbol-table.h"
+
+static const char *kTokens = R"(<blk> 0
+a 1
+b 2
+c 3
+)";
+
+static const char *kArpa = R"(
+\data\
+ngram 1=5
+ngram 2=4
+ngram 3=1
+
+\1-grams:
+-99 <s> -0.3
+-0.5 a -0.2
+-0.7 b -0.1
+-0.9 c
+-99 </s>
+
+\2-grams:
+-0.2 <s> a -0.05
+-0.3 a b -0.4
+-0.4 b c
+-0.6 b a
+
+\3-grams:
+-0.1 <s> a b
+
+\end\
+)";
+
+static bool Near(float score, float log10_prob) {
+  return std::abs(score - log10_prob * std::log(10.0f)) < 1e-4;
+}
+
+static void TestScore(const sherpa_ncnn::NgramLm &lm) {
+  assert(lm.Order() == 3);
+  assert(lm.NumNodes() == 11);
+
+  int32_t s0 = lm.StartState();
+  int32_t s1 = 0, s2 = 0, s3 = 0, s4 = 0;
+
+  // P(a | <s>)
+  assert(Near(lm.Score(s0, 1, &s1), -0.2));
+
+  // P(b | <s> a)
+  assert(Near(lm.Score(s1, 2, &s2), -0.1));
+
+  // <s> a b has no children, so the state is a b. P(c | a b) backs off
+  // to P(c | b).
+  assert(Near(lm.Score(s2, 3, &s3), -0.4 - 0.4));
+
+  // b c and c have no children and no backoff, so the state is empty
+  assert(s3 == 0);
+  assert(Near(lm.Score(s3, 3, &s4), -0.9));
+
+  // Backoff of <s>, then P(c)
+  assert(Near(lm.Score(s0, 3, &s4), -0.3 - 0.9));
+
+  // Tokens that are not in the model get the lowest unigram probability
+  assert(Near(lm.Score(0, 0, &s4), -0.9));
+  assert(s4 == 0);
+
+  sherpa_ncnn::NgramLmScorer scorer(&lm);
+  int32_t states[3] = {s0, s2, s0};
+  int32_t tokens[3] = {1, 3, 1};
+  float scores[3];
+  int32_t next[3];
+  scorer.Score(states, tokens, 3, scores, next);
+  assert(Near(scores[0], -0.2) && next[0] == s1);
+  assert(Near(scores[1], -0.8) && next[1] == 0);
+  assert(scores[2] == scores[0] && next[2] == next[0]);
+}
+
+int32_t main() {
+  std::string tokens(kTokens);
+  sherpa_ncnn::SymbolTable sym(
+      reinterpret_cast<const unsigned char *>(tokens.data()), tokens.size());
+
+  std::string arpa = "test-ngram-lm.arpa";
+  std::string compiled = "test-ngram-lm.bin";
+  {
+    std::ofstream os(arpa);
+    os << kArpa;
+  }
+
+  auto lm = sherpa_ncnn::NgramLm::Load(arpa, sym);
+  assert(lm);
+  TestScore(*lm);
+
+  assert(sherpa_ncnn::NgramLm::Compile(arpa, sym, compiled));
+  lm = sherpa_ncnn::NgramLm::Load(compiled, sym);
+  assert(lm);
+  TestScore(*lm);
+
+  std::remove(arpa.c_str());
+  std::remove(compiled.c_str());
+
+  return 0;
+}
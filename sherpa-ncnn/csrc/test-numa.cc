@@ -0,0 +1,51 @@
+// sherpa-ncnn/csrc/test-numa.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <assert.h>
+
+#include <string>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/numa.h"
+
+static void TestParseCpuList() {
+  std::vector<int32_t> cores;
+
+  assert(sherpa_ncnn::ParseCpuList("0-3,8-9", &cores));
+  assert((cores == std::vector<int32_t>{0, 1, 2, 3, 8, 9}));
+
+  assert(sherpa_ncnn::ParseCpuList("5", &cores));
+  assert((cores == std::vector<int32_t>{5}));
+
+  assert(sherpa_ncnn::ParseCpuList("0,2,4-5", &cores));
+  assert((cores == std::vector<int32_t>{0, 2, 4, 5}));
+
+  // A node without cores has an empty list
+  assert(!sherpa_ncnn::ParseCpuList("", &cores));
+  assert(!sherpa_ncnn::ParseCpuList("3-1", &cores));
+  assert(!sherpa_ncnn::ParseCpuList("1-2-3", &cores));
+  assert(!sherpa_ncnn::ParseCpuList("a", &cores));
+}
+
+// Every core is on at most one node
+static void TestGetNumaNodeCores() {
+  std::vector<int32_t> all;
+  for (const auto &s : sherpa_ncnn::GetNumaNodeCores()) {
+    std::vector<int32_t> cores;
+    assert(sherpa_ncnn::ParseCpuList(s, &cores));
+    for (int32_t c : cores) {
+      for (int32_t d : all) {
+        assert(c != d);
+      }
+      all.push_back(c);
+    }
+  }
+}
+
+int32_t main() {
+  TestParseCpuList();
+  TestGetNumaNodeCores();
+
+  return 0;
+}
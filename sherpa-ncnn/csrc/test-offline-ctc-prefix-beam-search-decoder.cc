@@ -0,0 +1,140 @@
+// sherpa-ncnn/csrc/test-offline-ctc-prefix-beam-search-decoder.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <assert.h>
+#include <math.h>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "mat.h"  // NOLINT
+#include "sherpa-ncnn/csrc/context-graph.h"
+#include "sherpa-ncnn/csrc/offline-ctc-greedy-search-decoder.h"
+#include "sherpa-ncnn/csrc/offline-ctc-prefix-beam-search-decoder.h"
+
+// Return log probabilities of shape (num_frames, vocab_size)
+static ncnn::Mat LogProbs(const std::vector<std::vector<float>> &probs) {
+  int32_t num_frames = probs.size();
+  int32_t vocab_size = probs[0].size();
+
+  ncnn::Mat ans(vocab_size, num_frames);
+  for (int32_t t = 0; t != num_frames; ++t) {
+    for (int32_t i = 0; i != vocab_size; ++i) {
+      ans.row(t)[i] = logf(probs[t][i]);
+    }
+  }
+
+  return ans;
+}
+
+// Greedy search picks blank twice, but the paths "aa", "a-" and "-a" of
+// the prefix "a" together are more likely than "--"
+static void TestBeatsGreedy() {
+  ncnn::Mat logits = LogProbs({{0.6, 0.4}, {0.6, 0.4}});
+
+  sherpa_ncnn::OfflineCtcGreedySearchDecoder greedy(0);
+  assert(greedy.Decode(logits).tokens.empty());
+
+  sherpa_ncnn::OfflineCtcPrefixBeamSearchDecoder beam(0, 4);
+  auto r = beam.Decode(logits);
+  assert(r.tokens.size() == 1);
+  assert(r.tokens[0] == 1);
+  assert(r.timestamps[0] == 0);
+}
+
+// Repeats are merged unless a blank separates them
+static void TestRepeats() {
+  float h = 0.9;
+  float l = 0.05;
+  ncnn::Mat logits = LogProbs({
+      {l, h, l},
+      {l, h, l},
+      {h, l, l},
+      {l, h, l},
+      {l, l, h},
+      {h, l, l},
+  });
+
+  sherpa_ncnn::OfflineCtcPrefixBeamSearchDecoder beam(0, 4);
+  auto r = beam.Decode(logits);
+  assert((r.tokens == std::vector<int32_t>{1, 1, 2}));
+  assert((r.timestamps == std::vector<int32_t>{0, 3, 4}));
+}
+
+// For peaky outputs, the result equals that of greedy search, even if
+// most frames are skipped as blank
+static void TestPeaky() {
+  int32_t num_frames = 200;
+  int32_t vocab_size = 500;
+
+  std::mt19937 gen(20250101);
+  std::uniform_int_distribution<int32_t> token(1, vocab_size - 1);
+  std::uniform_real_distribution<float> noise(-2, 2);
+
+  ncnn::Mat logits(vocab_size, num_frames);
+  for (int32_t t = 0; t != num_frames; ++t) {
+    float *p = logits.row(t);
+    for (int32_t i = 0; i != vocab_size; ++i) {
+      p[i] = noise(gen);
+    }
+
+    // Most frames are blank
+    int32_t y = t % 4 == 0 ? token(gen) : 0;
+    p[y] = 30;
+  }
+
+  sherpa_ncnn::OfflineCtcGreedySearchDecoder greedy(0);
+  sherpa_ncnn::OfflineCtcPrefixBeamSearchDecoder beam(0, 4);
+
+  auto expected = greedy.Decode(logits);
+  auto r = beam.Decode(logits);
+
+  assert(r.tokens == expected.tokens);
+  assert(r.timestamps == expected.timestamps);
+}
+
+// A hotword wins over a slightly more likely token, but a partial match
+// gets no bonus
+static void TestHotwords() {
+  ncnn::Mat logits = LogProbs({{0.1, 0.46, 0.44}, {0.9, 0.05, 0.05}});
+
+  sherpa_ncnn::OfflineCtcPrefixBeamSearchDecoder beam(0, 4);
+  assert((beam.Decode(logits).tokens == std::vector<int32_t>{1}));
+
+  sherpa_ncnn::ContextGraph graph({{2}}, 1.5);
+  assert((beam.Decode(logits, &graph).tokens == std::vector<int32_t>{2}));
+
+  sherpa_ncnn::ContextGraph partial({{2, 1}}, 1.5);
+  assert((beam.Decode(logits, &partial).tokens == std::vector<int32_t>{1}));
+}
+
+// The bonus of a hotword is kept when the paths "22-", "2--" and "-2-" of
+// its prefix are merged on the frames after it
+static void TestHotwordsMergedPaths() {
+  ncnn::Mat logits = LogProbs({
+      {0.5, 0.26, 0.24},
+      {0.5, 0.26, 0.24},
+      {0.9, 0.05, 0.05},
+      {0.9, 0.05, 0.05},
+  });
+
+  sherpa_ncnn::OfflineCtcPrefixBeamSearchDecoder beam(0, 4);
+  assert((beam.Decode(logits).tokens == std::vector<int32_t>{1}));
+
+  sherpa_ncnn::ContextGraph graph({{2}}, 1.5);
+  auto r = beam.Decode(logits, &graph);
+  assert((r.tokens == std::vector<int32_t>{2}));
+  assert((r.timestamps == std::vector<int32_t>{0}));
+}
+
+int32_t main() {
+  TestBeatsGreedy();
+  TestRepeats();
+  TestPeaky();
+  TestHotwords();
+  TestHotwordsMergedPaths();
+
+  return 0;
+}
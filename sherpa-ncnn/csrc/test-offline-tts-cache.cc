@@ -0,0 +1,82 @@
+// sherpa-ncnn/csrc/test-offline-tts-cache.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <assert.h>
+#include <stdio.h>
+
+#include <cstdint>
+#include <string>
+
+#include "sherpa-ncnn/csrc/offline-tts-cache.h"
+
+static sherpa_ncnn::GeneratedAudio MakeAudio(int32_t n) {
+  sherpa_ncnn::GeneratedAudio audio;
+  audio.sample_rate = 22050;
+  for (int32_t i = 0; i != n; ++i) {
+    audio.samples.push_back(i * 0.25f);
+  }
+  return audio;
+}
+
+int32_t main() {
+  sherpa_ncnn::OfflineTtsConfig config;
+  config.model.vits.model_dir = "./vits";
+  config.audio_cache_size = 2;
+  config.audio_cache_dir = ".";
+
+  sherpa_ncnn::TtsArgs args;
+  args.text = "Please hold";
+
+  sherpa_ncnn::GeneratedAudio audio;
+
+  {
+    sherpa_ncnn::OfflineTtsCache cache(config);
+
+    std::string key = cache.GetKey(args);
+    assert(!cache.Get(key, &audio));
+
+    cache.Put(key, MakeAudio(101));
+    assert(cache.Get(key, &audio));
+    assert(audio.sample_rate == 22050);
+    assert(audio.samples.size() == 101 && audio.samples[100] == 25);
+
+    // Other arguments give other keys
+    sherpa_ncnn::TtsArgs args2 = args;
+    args2.speed = 1.5;
+    assert(cache.GetKey(args2) != key);
+    assert(!cache.Get(cache.GetKey(args2), &audio));
+
+    // A custom embedding of the speaker gives another key
+    cache.SetSpeakerEmbedding(args.sid, {0.5f, 0.25f});
+    std::string key2 = cache.GetKey(args);
+    assert(key2 != key);
+    assert(!cache.Get(key2, &audio));
+
+    cache.SetSpeakerEmbedding(args.sid, {0.5f, 0.125f});
+    assert(cache.GetKey(args) != key2);
+
+    // It does not affect other speakers
+    args2 = args;
+    args2.sid = args.sid + 1;
+    cache.SetSpeakerEmbedding(args2.sid, {0.5f, 0.25f});
+    assert(cache.GetKey(args2) != key2);
+  }
+
+  {
+    // A new cache, e.g., of another process, finds it on disk
+    sherpa_ncnn::OfflineTtsCache cache(config);
+
+    assert(cache.Get(cache.GetKey(args), &audio));
+    assert(audio.samples.size() == 101 && audio.samples[3] == 0.75f);
+
+    // It depends on the model
+    config.seed = 1;
+    sherpa_ncnn::OfflineTtsCache cache2(config);
+    assert(!cache2.Get(cache2.GetKey(args), &audio));
+
+    remove(cache.GetFilename(cache.GetKey(args)).c_str());
+  }
+
+  return 0;
+}
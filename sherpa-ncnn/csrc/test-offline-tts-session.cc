@@ -0,0 +1,39 @@
+// sherpa-ncnn/csrc/test-offline-tts-session.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <assert.h>
+
+#include <cstdint>
+#include <string>
+
+#include "sherpa-ncnn/csrc/offline-tts-session.h"
+
+using sherpa_ncnn::TakeCompleteClauses;
+
+int32_t main() {
+  std::string text = "Hello, wor";
+  assert(TakeCompleteClauses(&text) == "Hello,");
+  assert(text == " wor");
+
+  // An ASCII punctuation needs the character after it
+  text += "ld. It costs 3.";
+  assert(TakeCompleteClauses(&text) == " world.");
+  assert(text == " It costs 3.");
+
+  text += "14 dollars";
+  assert(TakeCompleteClauses(&text).empty());
+  assert(text == " It costs 3.14 dollars");
+
+  text = "第一句。第二句，第三";
+  assert(TakeCompleteClauses(&text) == "第一句。第二句，");
+  assert(text == "第三");
+
+  text = "line one\nline two";
+  assert(TakeCompleteClauses(&text) == "line one\n");
+
+  assert(TakeCompleteClauses(&text, true) == "line two");
+  assert(text.empty());
+
+  return 0;
+}
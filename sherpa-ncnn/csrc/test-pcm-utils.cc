@@ -0,0 +1,124 @@
+// sherpa-ncnn/csrc/test-pcm-utils.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <assert.h>
+#include <stdio.h>
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/pcm-utils.h"
+
+static void TestEnergy() {
+  for (int32_t n : {0, 1, 3, 4, 5, 64, 1003}) {
+    std::vector<float> in(n);
+    for (int32_t i = 0; i != n; ++i) {
+      in[i] = std::sin(i * 0.7f) * (i % 5 == 0 ? 0 : 0.3f);
+    }
+
+    double sum = 0;
+    int32_t num_crossings = 0;
+    for (int32_t i = 0; i != n; ++i) {
+      sum += in[i] * in[i];
+      if (i > 0 && (in[i - 1] < 0) != (in[i] < 0)) {
+        ++num_crossings;
+      }
+    }
+
+    float expected = n ? sum / n : 0;
+    assert(std::abs(sherpa_ncnn::MeanSquare(in.data(), n) - expected) <=
+           1e-6f);
+    assert(sherpa_ncnn::NumZeroCrossings(in.data(), n) == num_crossings);
+  }
+}
+
+static void TestFloatToInt16() {
+  for (int32_t n : {0, 1, 7, 8, 9, 64, 1003}) {
+    std::vector<float> in(n);
+    for (int32_t i = 0; i != n; ++i) {
+      in[i] = std::sin(i * 0.3f) * 1.2f;
+    }
+
+    std::vector<int16_t> out(n + 1, 123);
+    sherpa_ncnn::FloatToInt16(in.data(), n, out.data());
+
+    for (int32_t i = 0; i != n; ++i) {
+      float x = in[i] < -1 ? -1 : (in[i] > 1 ? 1 : in[i]);
+      assert(out[i] == static_cast<int16_t>(x * 32767));
+    }
+    assert(out[n] == 123);
+  }
+}
+
+static void TestDeinterleave() {
+  for (int32_t num_channels : {1, 2, 3}) {
+    for (int32_t n : {0, 1, 3, 4, 5, 64, 1003}) {
+      std::vector<float> in(n * num_channels);
+      std::vector<int16_t> in16(n * num_channels);
+      for (int32_t i = 0; i != n * num_channels; ++i) {
+        in[i] = std::sin(i * 0.3f);
+        in16[i] = static_cast<int16_t>(i * 7919 - 32768);
+      }
+
+      std::vector<std::vector<float>> out(num_channels,
+                                          std::vector<float>(n + 1, 123.0f));
+      std::vector<float *> p(num_channels);
+      for (int32_t c = 0; c != num_channels; ++c) {
+        p[c] = out[c].data();
+      }
+
+      float scale = 0.5f;
+      sherpa_ncnn::Deinterleave(in.data(), num_channels, n, scale, p.data());
+      for (int32_t c = 0; c != num_channels; ++c) {
+        for (int32_t i = 0; i != n; ++i) {
+          assert(out[c][i] == in[i * num_channels + c] * scale);
+        }
+        assert(out[c][n] == 123.0f);
+      }
+
+      scale = 1.0f / 32768;
+      sherpa_ncnn::DeinterleaveInt16(in16.data(), num_channels, n, scale,
+                                     p.data());
+      for (int32_t c = 0; c != num_channels; ++c) {
+        for (int32_t i = 0; i != n; ++i) {
+          assert(out[c][i] == in16[i * num_channels + c] * scale);
+        }
+        assert(out[c][n] == 123.0f);
+      }
+    }
+  }
+}
+
+int32_t main() {
+  TestEnergy();
+  TestFloatToInt16();
+  TestDeinterleave();
+
+  // Cover the SIMD body, the scalar tail and the extreme values
+  for (int32_t n : {0, 1, 7, 8, 9, 64, 1003}) {
+    std::vector<int16_t> in(n);
+    for (int32_t i = 0; i != n; ++i) {
+      in[i] = static_cast<int16_t>(i * 7919 - 32768);
+    }
+    if (n > 2) {
+      in[0] = -32768;
+      in[1] = 32767;
+    }
+
+    for (float scale : {1.0f, 1.0f / 32768}) {
+      std::vector<float> out(n + 1, 123.0f);
+      sherpa_ncnn::Int16ToFloat(in.data(), n, scale, out.data());
+
+      for (int32_t i = 0; i != n; ++i) {
+        assert(out[i] == in[i] * scale);
+      }
+      assert(out[n] == 123.0f);
+    }
+  }
+
+  fprintf(stderr, "Passed\n");
+
+  return 0;
+}
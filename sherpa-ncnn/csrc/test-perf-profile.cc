@@ -0,0 +1,75 @@
+// sherpa-ncnn/csrc/test-perf-profile.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <assert.h>
+#include <stdio.h>
+
+#include <fstream>
+#include <string>
+
+#include "sherpa-ncnn/csrc/perf-profile.h"
+
+using sherpa_ncnn::NetTuning;
+using sherpa_ncnn::PerfProfile;
+
+int32_t main() {
+  std::string filename = "test-perf-profile.txt";
+
+  NetTuning encoder;
+  encoder.precision = "balanced";
+  encoder.num_threads = 4;
+  encoder.use_winograd_convolution = false;
+
+  NetTuning joiner;
+  joiner.precision = "speed";
+  joiner.use_sgemm_convolution = false;
+
+  PerfProfile profile;
+  profile.SetFingerprint(PerfProfile::DeviceFingerprint());
+  profile.Set("encoder", encoder);
+  profile.Set("joiner", joiner);
+
+  bool ok = profile.Write(filename);
+  assert(ok);
+
+  PerfProfile p;
+  ok = p.Read(filename);
+  assert(ok);
+  assert(p.Fingerprint() == PerfProfile::DeviceFingerprint());
+  assert(p.Nets().size() == 2);
+  assert(p.Get("decoder") == nullptr);
+
+  const NetTuning *t = p.Get("encoder");
+  assert(t != nullptr);
+  assert(t->device == "cpu");
+  assert(t->precision == "balanced");
+  assert(t->num_threads == 4);
+  assert(!t->use_winograd_convolution);
+  assert(t->use_sgemm_convolution);
+
+  t = p.Get("joiner");
+  assert(t != nullptr);
+  assert(t->precision == "speed");
+  assert(t->num_threads == 1);
+  assert(t->use_winograd_convolution);
+  assert(!t->use_sgemm_convolution);
+
+  assert(p.ToString() == profile.ToString());
+
+  // A malformed file leaves the profile unchanged
+  {
+    std::ofstream os(filename);
+    os << "encoder device=npu\n";
+  }
+  ok = p.Read(filename);
+  assert(!ok);
+  assert(p.Nets().size() == 2);
+
+  remove(filename.c_str());
+  ok = p.Read(filename);
+  assert(!ok);
+
+  (void)ok;
+  return 0;
+}
@@ -0,0 +1,84 @@
+// sherpa-ncnn/csrc/test-philox.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/philox.h"
+
+using sherpa_ncnn::Philox;
+
+// Known answers from the Random123 library, kat_vectors
+static void TestBlock() {
+  using C = std::array<uint32_t, 4>;
+  using K = std::array<uint32_t, 2>;
+
+  assert((Philox::Block(C{0, 0, 0, 0}, K{0, 0}) ==
+          C{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}));
+
+  assert((Philox::Block(C{0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff},
+                        K{0xffffffff, 0xffffffff}) ==
+          C{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}));
+
+  assert((Philox::Block(C{0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344},
+                        K{0xa4093822, 0x299f31d0}) ==
+          C{0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}));
+}
+
+// A number depends only on its position, whatever is generated around it
+static void TestPositions() {
+  Philox rng(20250101, 3);
+
+  int32_t n = 103;
+  std::vector<float> all(n);
+  rng.Fill(all.data(), n, -1, 2);
+
+  for (float f : all) {
+    assert(f >= -1 && f < 2);
+  }
+
+  for (int32_t offset : {0, 1, 3, 4, 5, 17, 60}) {
+    for (int32_t len : {0, 1, 2, 3, 5, 16, 33}) {
+      if (offset + len > n) continue;
+
+      std::vector<float> part(len);
+      rng.Fill(part.data(), len, -1, 2, offset);
+      for (int32_t i = 0; i != len; ++i) {
+        assert(part[i] == all[offset + i]);
+      }
+    }
+  }
+
+  // Other streams and seeds give other numbers
+  std::vector<float> other(n);
+  rng.Stream(4).Fill(other.data(), n, -1, 2);
+  assert(other != all);
+
+  Philox(20250102, 3).Fill(other.data(), n, -1, 2);
+  assert(other != all);
+}
+
+static void TestMean() {
+  int32_t n = 100000;
+  std::vector<float> v(n);
+  Philox(1).Fill(v.data(), n);
+
+  double sum = 0;
+  for (float f : v) {
+    assert(f >= 0 && f < 1);
+    sum += f;
+  }
+
+  double mean = sum / n;
+  assert(mean > 0.49 && mean < 0.51);
+}
+
+int32_t main() {
+  TestBlock();
+  TestPositions();
+  TestMean();
+
+  return 0;
+}
@@ -0,0 +1,224 @@
+// sherpa-ncnn/csrc/test-recognizer-pipeline.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <assert.h>
+#include <stdio.h>
+
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/model.h"
+#include "sherpa-ncnn/csrc/recognizer.h"
+#include "sherpa-ncnn/csrc/stream.h"
+
+namespace {
+
+constexpr int32_t kEncoderDim = 4;
+constexpr int32_t kVocabSize = 5;
+
+// A model whose outputs depend on all of its inputs, including the encoder
+// states, so that results differ if chunks are searched out of order or
+// with the wrong states
+class FakeModel : public sherpa_ncnn::Model {
+ public:
+  ncnn::Net &GetEncoder() override { return net_; }
+  ncnn::Net &GetDecoder() override { return net_; }
+  ncnn::Net &GetJoiner() override { return net_; }
+
+  std::vector<ncnn::Mat> GetEncoderInitStates() const override {
+    ncnn::Mat s(kEncoderDim);
+    s.fill(0.0f);
+    return {s};
+  }
+
+  std::pair<ncnn::Mat, std::vector<ncnn::Mat>> RunEncoder(
+      ncnn::Mat &features, const std::vector<ncnn::Mat> &states) override {
+    std::vector<ncnn::Mat> next_states;
+    ncnn::Mat encoder_out =
+        RunEncoder(features, states, nullptr, &next_states);
+    return {encoder_out, next_states};
+  }
+
+  std::pair<ncnn::Mat, std::vector<ncnn::Mat>> RunEncoder(
+      ncnn::Mat &features, const std::vector<ncnn::Mat> &states,
+      ncnn::Extractor * /*extractor*/) override {
+    return RunEncoder(features, states);
+  }
+
+  ncnn::Mat RunEncoder(ncnn::Mat &features,
+                       const std::vector<ncnn::Mat> &states,
+                       ncnn::Extractor * /*extractor*/,
+                       std::vector<ncnn::Mat> *next_states) override {
+    const float *state = states[0];
+
+    int32_t num_out_frames = Offset() / SubsamplingFactor();
+    ncnn::Mat encoder_out(kEncoderDim, num_out_frames);
+    for (int32_t t = 0; t != num_out_frames; ++t) {
+      float *p = encoder_out.row(t);
+      for (int32_t d = 0; d != kEncoderDim; ++d) {
+        float sum = 0;
+        for (int32_t k = 0; k != SubsamplingFactor(); ++k) {
+          sum += features.row(t * SubsamplingFactor() + k)[d * 7];
+        }
+        p[d] = 0.05f * sum + 0.5f * state[d];
+      }
+    }
+
+    ncnn::Mat next(kEncoderDim);
+    for (int32_t d = 0; d != kEncoderDim; ++d) {
+      float sum = 0;
+      for (int32_t t = 0; t != Offset(); ++t) {
+        sum += features.row(t)[d * 7];
+      }
+      next[d] = 0.5f * state[d] + 0.01f * sum;
+    }
+
+    *next_states = {next};
+
+    return encoder_out;
+  }
+
+  // decoder_input contains the token IDs of the context as int32
+  ncnn::Mat RunDecoder(ncnn::Mat &decoder_input) override {
+    const int32_t *p = decoder_input;
+    int32_t n = decoder_input.w;
+
+    ncnn::Mat ans(kEncoderDim);
+    for (int32_t d = 0; d != kEncoderDim; ++d) {
+      ans[d] = std::sin(p[n - 1] * (d + 1.0f)) + 0.5f * std::cos(p[n - 2] + d);
+    }
+    return ans;
+  }
+
+  ncnn::Mat RunDecoder(ncnn::Mat &decoder_input,
+                       ncnn::Extractor * /*extractor*/) override {
+    return RunDecoder(decoder_input);
+  }
+
+  ncnn::Mat RunJoiner(ncnn::Mat &encoder_out,
+                      ncnn::Mat &decoder_out) override {
+    ncnn::Mat ans(kVocabSize);
+    for (int32_t k = 0; k != kVocabSize; ++k) {
+      float sum = 0;
+      for (int32_t d = 0; d != kEncoderDim; ++d) {
+        sum += std::cos(k * 1.3f + d) * encoder_out[d] +
+               std::sin(k * 0.7f + d) * decoder_out[d];
+      }
+      ans[k] = sum;
+    }
+
+    // Make blank win about half of the time
+    ans[0] += 0.5f;
+
+    return ans;
+  }
+
+  ncnn::Mat RunJoiner(ncnn::Mat &encoder_out, ncnn::Mat &decoder_out,
+                      ncnn::Extractor * /*extractor*/) override {
+    return RunJoiner(encoder_out, decoder_out);
+  }
+
+  int32_t Segment() const override { return 39; }
+  int32_t Offset() const override { return 32; }
+
+ private:
+  ncnn::Net net_;
+};
+
+}  // namespace
+
+static std::vector<float> Samples(int32_t n, float f) {
+  std::vector<float> ans(n);
+  for (int32_t i = 0; i != n; ++i) {
+    ans[i] = 0.3f * std::sin(f * i) + 0.1f * std::sin(0.37f * f * i * i / n);
+  }
+  return ans;
+}
+
+// Decode 3 streams that receive audio in pieces and return the tokens and
+// timestamps of each
+static std::vector<std::pair<std::vector<int32_t>, std::vector<int32_t>>>
+Decode(std::shared_ptr<sherpa_ncnn::Model> model, bool pipeline_search,
+       const std::string &tokens) {
+  sherpa_ncnn::RecognizerConfig config;
+  config.model_config.tokens = tokens;
+  config.decoder_config.method = "greedy_search";
+  config.pipeline_search = pipeline_search;
+
+  sherpa_ncnn::Recognizer recognizer(config, std::move(model));
+
+  std::vector<std::unique_ptr<sherpa_ncnn::Stream>> streams;
+  std::vector<sherpa_ncnn::Stream *> ss;
+  for (int32_t i = 0; i != 3; ++i) {
+    streams.push_back(recognizer.CreateStream());
+    ss.push_back(streams.back().get());
+  }
+
+  int32_t num_chunks = 0;
+  for (int32_t piece = 0; piece != 3; ++piece) {
+    for (int32_t i = 0; i != 3; ++i) {
+      // Streams get different amounts of audio, so the rounds of
+      // DecodeReadyStreams() have different streams
+      std::vector<float> samples =
+          Samples(8000 * (i + 1) + 1234 * piece, 0.02f * (i + 1) + piece);
+      ss[i]->AcceptWaveform(16000, samples.data(), samples.size());
+    }
+
+    num_chunks += recognizer.DecodeReadyStreams(ss.data(), ss.size());
+  }
+
+  for (auto s : ss) {
+    s->InputFinished();
+  }
+  recognizer.DecodeRemainingFrames(ss.data(), ss.size());
+
+  assert(num_chunks > 10);
+  (void)num_chunks;
+
+  std::vector<std::pair<std::vector<int32_t>, std::vector<int32_t>>> ans;
+  for (auto s : ss) {
+    const auto &r = s->GetResult();
+    ans.emplace_back(r.tokens, r.timestamps);
+  }
+
+  return ans;
+}
+
+int32_t main() {
+  std::string tokens = "./test-recognizer-pipeline-tokens.txt";
+  {
+    std::ofstream os(tokens);
+    for (int32_t i = 0; i != kVocabSize; ++i) {
+      os << (i == 0 ? std::string("<blk>") : std::string(1, 'a' + i)) << " "
+         << i << "\n";
+    }
+  }
+
+  auto model = std::make_shared<FakeModel>();
+
+  auto expected = Decode(model, false, tokens);
+  auto actual = Decode(model, true, tokens);
+
+  // The searches of each stream run in order on another thread, so the
+  // results are the same
+  assert(actual == expected);
+
+  // It would not test anything if nothing were decoded. The tokens start
+  // with the blanks of the decoder context.
+  int32_t num_tokens = 0;
+  for (const auto &r : expected) {
+    num_tokens += r.first.size() - model->ContextSize();
+  }
+  assert(num_tokens > 3);
+  (void)num_tokens;
+
+  remove(tokens.c_str());
+
+  return 0;
+}
@@ -0,0 +1,99 @@
+// sherpa-ncnn/csrc/test-remote-encoder.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <assert.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/remote-encoder.h"
+
+using sherpa_ncnn::RemoteEncoderChunk;
+using sherpa_ncnn::RemoteEncoderHandle;
+
+static void TestHandle() {
+  ncnn::Mat m(RemoteEncoderHandle::kSize);
+
+  for (uint64_t session : {uint64_t(0), uint64_t(1), uint64_t(2047),
+                           uint64_t(2048), uint64_t(123456789),
+                           RemoteEncoderHandle::kMaxSession - 1}) {
+    for (int32_t seq : {0, 1, RemoteEncoderHandle::kMaxSeq - 1}) {
+      RemoteEncoderHandle{session, seq}.ToMat(&m);
+
+      // It must survive the rounding of the states to fp16
+      float *p = m;
+      for (int32_t i = 0; i != RemoteEncoderHandle::kSize; ++i) {
+        p[i] = ncnn::float16_to_float32(ncnn::float32_to_float16(p[i]));
+      }
+
+      auto h = RemoteEncoderHandle::FromMat(m);
+      assert(h.session == session);
+      assert(h.seq == seq);
+    }
+  }
+}
+
+static void TestMessage() {
+  std::vector<RemoteEncoderChunk> chunks(3);
+
+  chunks[0].session = 5;
+  chunks[0].seq = 7;
+  chunks[0].data.create(80, 39);
+  float *p = chunks[0].data;
+  for (int32_t i = 0; i != 80 * 39; ++i) {
+    p[i] = i * 0.5f - 100;
+  }
+
+  chunks[1].session = RemoteEncoderHandle::kMaxSession - 1;
+  chunks[1].status = sherpa_ncnn::kRemoteEncoderBadInput;
+
+  chunks[2].data.create(3, 1);
+  chunks[2].data.fill(2.5f);
+
+  std::vector<uint8_t> buf;
+  sherpa_ncnn::WriteRemoteEncoderMessage(chunks, &buf);
+
+  uint32_t size = 0;
+  std::memcpy(&size, buf.data(), sizeof(size));
+  assert(size + sizeof(size) == buf.size());
+
+  std::vector<RemoteEncoderChunk> parsed;
+  bool ok = sherpa_ncnn::ParseRemoteEncoderMessage(buf.data() + sizeof(size),
+                                                    size, &parsed);
+  assert(ok);
+  assert(parsed.size() == chunks.size());
+
+  for (size_t i = 0; i != chunks.size(); ++i) {
+    const auto &a = chunks[i];
+    const auto &b = parsed[i];
+    assert(a.session == b.session);
+    assert(a.seq == b.seq);
+    assert(a.status == b.status);
+    assert(a.data.w == b.data.w);
+    assert(a.data.h == b.data.h);
+
+    const float *pa = a.data;
+    const float *pb = b.data;
+    for (int32_t k = 0; k != a.data.w * a.data.h; ++k) {
+      assert(pa[k] == pb[k]);
+    }
+  }
+
+  // Truncated messages are rejected
+  for (uint32_t n : {0u, 7u, 8u, 20u, size - 1}) {
+    ok = sherpa_ncnn::ParseRemoteEncoderMessage(buf.data() + sizeof(size), n,
+                                                &parsed);
+    assert(!ok);
+  }
+
+  (void)ok;
+}
+
+int32_t main() {
+  TestHandle();
+  TestMessage();
+
+  return 0;
+}
@@ -0,0 +1,92 @@
+// sherpa-ncnn/csrc/test-session-recorder.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <assert.h>
+#include <stdio.h>
+
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/features.h"
+#include "sherpa-ncnn/csrc/session-recorder.h"
+#include "sherpa-ncnn/csrc/stream.h"
+
+using sherpa_ncnn::SessionEvent;
+using sherpa_ncnn::SessionEventType;
+using sherpa_ncnn::SessionRecorder;
+
+int32_t main() {
+  std::string filename = "test-session-recorder.bin";
+  sherpa_ncnn::FeatureExtractorConfig config;
+
+  // Nothing is recorded before Start()
+  sherpa_ncnn::Stream before(config);
+
+  bool ok = SessionRecorder::Start(filename);
+  assert(ok);
+  assert(SessionRecorder::Enabled());
+
+  std::vector<float> samples(160);
+  for (int32_t i = 0; i != 160; ++i) {
+    samples[i] = (i % 7) * 0.01f;
+  }
+
+  int64_t id = 0;
+  {
+    sherpa_ncnn::Stream s(config);
+    id = s.GetId();
+    s.AcceptWaveform(16000, samples.data(), samples.size());
+    SessionRecorder::RecordResult(SessionEventType::kIsReady, id, true);
+
+    sherpa_ncnn::Stream *ss[2] = {&s, &before};
+    auto start = sherpa_ncnn::StageClock::now();
+    SessionRecorder::RecordDecode(SessionEventType::kDecodeStreams, ss, 2,
+                                  start,
+                                  start + std::chrono::milliseconds(3));
+    SessionRecorder::Record(SessionEventType::kReset, id);
+    s.InputFinished();
+  }
+
+  ok = SessionRecorder::Stop();
+  assert(ok);
+  assert(!SessionRecorder::Enabled());
+  assert(!SessionRecorder::Stop());
+
+  std::vector<SessionEvent> events;
+  ok = sherpa_ncnn::ReadSession(filename, &events);
+  assert(ok);
+  assert(events.size() == 7);
+
+  assert(events[0].type == SessionEventType::kCreateStream);
+  assert(events[0].stream_id == id);
+
+  assert(events[1].type == SessionEventType::kAcceptWaveform);
+  assert(events[1].sampling_rate == 16000);
+  assert(events[1].samples == samples);
+
+  assert(events[2].type == SessionEventType::kIsReady);
+  assert(events[2].result);
+
+  assert(events[3].type == SessionEventType::kDecodeStreams);
+  assert(events[3].stream_id == -1);
+  assert(events[3].stream_ids.size() == 2);
+  assert(events[3].stream_ids[0] == id);
+  assert(events[3].stream_ids[1] == before.GetId());
+  assert(events[3].duration_us == 3000);
+
+  assert(events[4].type == SessionEventType::kReset);
+  assert(events[5].type == SessionEventType::kInputFinished);
+  assert(events[6].type == SessionEventType::kDestroyStream);
+
+  for (size_t i = 1; i != events.size(); ++i) {
+    assert(events[i].time_us >= events[i - 1].time_us);
+  }
+
+  remove(filename.c_str());
+
+  (void)ok;
+  return 0;
+}
@@ -0,0 +1,51 @@
+// sherpa-ncnn/csrc/test-slots.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <assert.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "sherpa-ncnn/csrc/slots.h"
+
+int32_t main() {
+  // A null guard does nothing
+  { sherpa_ncnn::SlotGuard guard(nullptr); }
+
+  int32_t num_slots = 3;
+  sherpa_ncnn::Slots slots(num_slots);
+
+  std::atomic<int32_t> active{0};
+  std::atomic<int32_t> peak{0};
+
+  std::vector<std::thread> threads;
+  for (int32_t i = 0; i != 16; ++i) {
+    threads.emplace_back([&]() {
+      for (int32_t k = 0; k != 20; ++k) {
+        sherpa_ncnn::SlotGuard guard(&slots);
+
+        int32_t n = ++active;
+        int32_t p = peak;
+        while (n > p && !peak.compare_exchange_weak(p, n)) {
+        }
+
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        --active;
+      }
+    });
+  }
+
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  assert(active == 0);
+  assert(peak >= 1 && peak <= num_slots);
+
+  return 0;
+}
@@ -0,0 +1,84 @@
+// sherpa-ncnn/csrc/test-spsc-ring-buffer.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <numeric>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "sherpa-ncnn/csrc/spsc-ring-buffer.h"
+
+static void TestWrapAround() {
+  sherpa_ncnn::SpscRingBuffer buffer(6);
+  assert(buffer.Capacity() == 8);
+
+  std::vector<float> in(8);
+  std::iota(in.begin(), in.end(), 0);
+  std::vector<float> out(8);
+
+  assert(buffer.Push(in.data(), 6) == 6);
+  assert(buffer.Pop(out.data(), 5) == 5);
+  assert(out[4] == 4);
+
+  // Two samples at the end and four at the beginning
+  assert(buffer.Push(in.data(), 6) == 6);
+  assert(buffer.Size() == 7);
+
+  // Only one sample fits
+  assert(buffer.Push(in.data(), 3) == 1);
+  assert(buffer.Size() == 8);
+
+  assert(buffer.Pop(out.data(), 8) == 8);
+  std::vector<float> expected = {5, 0, 1, 2, 3, 4, 5, 0};
+  assert(out == expected);
+
+  assert(buffer.Pop(out.data(), 1) == 0);
+  assert(buffer.Size() == 0);
+}
+
+static void TestThreads() {
+  constexpr int32_t kNum = 100000;
+  sherpa_ncnn::SpscRingBuffer buffer(1000);
+
+  std::thread producer([&buffer]() {
+    std::vector<float> block(37);
+    int32_t next = 0;
+    while (next < kNum) {
+      int32_t n = std::min<int32_t>(block.size(), kNum - next);
+      for (int32_t i = 0; i != n; ++i) {
+        block[i] = next + i;
+      }
+
+      int32_t k = 0;
+      while (k < n) {
+        int32_t m = buffer.Push(block.data() + k, n - k);
+        if (m == 0) std::this_thread::yield();
+        k += m;
+      }
+      next += n;
+    }
+  });
+
+  std::vector<float> block(53);
+  int32_t expected = 0;
+  while (expected < kNum) {
+    int32_t n = buffer.Pop(block.data(), block.size());
+    if (n == 0) std::this_thread::yield();
+    for (int32_t i = 0; i != n; ++i) {
+      assert(block[i] == expected);
+      ++expected;
+    }
+  }
+
+  producer.join();
+}
+
+int32_t main() {
+  TestWrapAround();
+  TestThreads();
+
+  return 0;
+}
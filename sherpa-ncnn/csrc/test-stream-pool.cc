@@ -0,0 +1,160 @@
+// sherpa-ncnn/csrc/test-stream-pool.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <assert.h>
+
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/memory-usage.h"
+#include "sherpa-ncnn/csrc/stream-pool.h"
+#include "sherpa-ncnn/csrc/stream.h"
+
+static std::vector<float> Samples(int32_t n) {
+  std::vector<float> ans(n);
+  for (int32_t i = 0; i != n; ++i) {
+    ans[i] = 0.3f * std::sin(0.05f * i) + 0.1f * std::sin(0.7f * i);
+  }
+  return ans;
+}
+
+static bool SameFrames(const sherpa_ncnn::Stream &a,
+                       const sherpa_ncnn::Stream &b) {
+  if (a.NumFramesReady() != b.NumFramesReady()) {
+    return false;
+  }
+
+  int32_t n = a.NumFramesReady();
+  ncnn::Mat fa = a.GetFrames(0, n);
+  ncnn::Mat fb = b.GetFrames(0, n);
+  for (int32_t i = 0; i != n * fa.w; ++i) {
+    if (static_cast<const float *>(fa)[i] !=
+        static_cast<const float *>(fb)[i]) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// A pooled stream must not keep its reservation, or idle streams use up
+// the budget and a new stream cannot be created although one is pooled
+static void TestPoolWithBudget() {
+  const std::size_t kStreamBytes = 1000;
+  auto budget = std::make_shared<sherpa_ncnn::MemoryBudget>(kStreamBytes);
+  sherpa_ncnn::StreamPool pool(2);
+
+  auto s = std::make_unique<sherpa_ncnn::Stream>();
+  s->SetMemoryReservation(
+      sherpa_ncnn::MemoryReservation::Create(budget, kStreamBytes));
+  assert(budget->Used() == kStreamBytes);
+  assert(!sherpa_ncnn::MemoryReservation::Create(budget, kStreamBytes));
+
+  pool.Put(std::move(s));
+  assert(pool.Size() == 1);
+  assert(budget->Used() == 0);
+
+  // What Recognizer::CreateStream() does
+  auto r = sherpa_ncnn::MemoryReservation::Create(budget, kStreamBytes);
+  assert(r);
+  s = pool.Take(0, nullptr);
+  assert(s);
+  s->SetMemoryReservation(std::move(r));
+  assert(pool.Size() == 0);
+  assert(budget->Used() == kStreamBytes);
+
+  s.reset();
+  assert(budget->Used() == 0);
+}
+
+static void TestTake() {
+  sherpa_ncnn::StreamPool pool(2);
+  assert(!pool.Take(0, nullptr));
+
+  auto a = std::make_unique<sherpa_ncnn::Stream>();
+  auto b = std::make_unique<sherpa_ncnn::Stream>();
+  auto c = std::make_unique<sherpa_ncnn::Stream>();
+  b->SetEncoderIndex(1);
+
+  pool.Put(std::move(a));
+  pool.Put(std::move(b));
+
+  // The pool is full, so c is destroyed
+  pool.Put(std::move(c));
+  assert(pool.Size() == 2);
+
+  // Only a stream of the same encoder is reused
+  assert(!pool.Take(2, nullptr));
+  auto s = pool.Take(1, nullptr);
+  assert(s && s->GetEncoderIndex() == 1);
+  assert(pool.Size() == 1);
+
+  sherpa_ncnn::StreamPool disabled(0);
+  disabled.Put(std::move(s));
+  assert(disabled.Size() == 0);
+}
+
+// A reused stream is decoded as a new one
+static void TestRecycledStream() {
+  sherpa_ncnn::StreamPool pool(1);
+  std::vector<float> samples = Samples(16000);
+
+  auto s = std::make_unique<sherpa_ncnn::Stream>();
+  s->AcceptWaveform(16000, samples.data(), samples.size());
+  s->InputFinished();
+  s->GetNumProcessedFrames() = 20;
+
+  std::vector<ncnn::Mat> states = {ncnn::Mat(16, 4), ncnn::Mat(8)};
+  for (auto &m : states) {
+    m.fill(1.0f);
+  }
+  s->SetStates(states);
+
+  int64_t id = s->GetId();
+  pool.Put(std::move(s));
+
+  auto graph = std::make_shared<sherpa_ncnn::ContextGraph>(
+      std::vector<std::vector<int32_t>>{{1, 2, 3}}, 1.5f);
+  auto recycled = pool.Take(0, graph);
+  assert(recycled);
+  assert(recycled->GetId() != id);
+  assert(recycled->GetContextGraph() == graph);
+  assert(recycled->NumFramesReady() == 0);
+  assert(recycled->GetNumProcessedFrames() == 0);
+  assert(recycled->GetResult().tokens.empty());
+
+  sherpa_ncnn::Stream fresh({}, graph);
+
+  // A half of the audio, so that the feature extractor of the recycled
+  // stream is not the finished one of the old stream
+  int32_t n = samples.size() / 2;
+  recycled->AcceptWaveform(16000, samples.data(), n);
+  fresh.AcceptWaveform(16000, samples.data(), n);
+  assert(recycled->NumFramesReady() > 0);
+  assert(!recycled->IsLastFrame(recycled->NumFramesReady() - 1));
+  assert(SameFrames(*recycled, fresh));
+
+  recycled->InputFinished();
+  fresh.InputFinished();
+  assert(SameFrames(*recycled, fresh));
+  assert(recycled->IsLastFrame(recycled->NumFramesReady() - 1));
+
+  for (auto &m : states) {
+    m.fill(0.0f);
+  }
+  recycled->SetStates(states);
+  assert(recycled->GetStates().size() == 2);
+  assert(recycled->GetStates()[0].w == 16);
+  assert(static_cast<const float *>(recycled->GetStates()[1])[0] == 0.0f);
+}
+
+int32_t main() {
+  TestPoolWithBudget();
+  TestTake();
+  TestRecycledStream();
+
+  return 0;
+}
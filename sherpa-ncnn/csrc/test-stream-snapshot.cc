@@ -0,0 +1,217 @@
+// sherpa-ncnn/csrc/test-stream-snapshot.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <assert.h>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/model.h"
+#include "sherpa-ncnn/csrc/stream-snapshot.h"
+#include "sherpa-ncnn/csrc/stream.h"
+
+namespace {
+
+// Only the shapes of the encoder states are used by RestoreStreamState()
+class FakeModel : public sherpa_ncnn::Model {
+ public:
+  ncnn::Net &GetEncoder() override { return net_; }
+  ncnn::Net &GetDecoder() override { return net_; }
+  ncnn::Net &GetJoiner() override { return net_; }
+
+  std::vector<ncnn::Mat> GetEncoderInitStates() const override {
+    ncnn::Mat a(16, 4);
+    ncnn::Mat b(8);
+    a.fill(0.0f);
+    b.fill(0.0f);
+    return {a, b};
+  }
+
+  std::pair<ncnn::Mat, std::vector<ncnn::Mat>> RunEncoder(
+      ncnn::Mat &, const std::vector<ncnn::Mat> &) override {
+    return {};
+  }
+
+  std::pair<ncnn::Mat, std::vector<ncnn::Mat>> RunEncoder(
+      ncnn::Mat &, const std::vector<ncnn::Mat> &,
+      ncnn::Extractor *) override {
+    return {};
+  }
+
+  ncnn::Mat RunEncoder(ncnn::Mat &, const std::vector<ncnn::Mat> &,
+                       ncnn::Extractor *,
+                       std::vector<ncnn::Mat> *) override {
+    return {};
+  }
+
+  ncnn::Mat RunDecoder(ncnn::Mat &) override { return {}; }
+
+  ncnn::Mat RunDecoder(ncnn::Mat &, ncnn::Extractor *) override {
+    return {};
+  }
+
+  ncnn::Mat RunJoiner(ncnn::Mat &, ncnn::Mat &) override { return {}; }
+
+  ncnn::Mat RunJoiner(ncnn::Mat &, ncnn::Mat &, ncnn::Extractor *) override {
+    return {};
+  }
+
+  int32_t Segment() const override { return 39; }
+  int32_t Offset() const override { return 32; }
+
+ private:
+  ncnn::Net net_;
+};
+
+}  // namespace
+
+static std::vector<float> Samples(int32_t n) {
+  std::vector<float> ans(n);
+  for (int32_t i = 0; i != n; ++i) {
+    ans[i] = 0.3f * std::sin(0.05f * i) + 0.1f * std::sin(0.7f * i);
+  }
+  return ans;
+}
+
+static bool SameMat(const ncnn::Mat &a, const ncnn::Mat &b) {
+  if (a.w != b.w || a.h != b.h || a.c != b.c) {
+    return false;
+  }
+
+  for (int32_t i = 0; i != static_cast<int32_t>(a.total()); ++i) {
+    if (static_cast<const float *>(a)[i] != static_cast<const float *>(b)[i]) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// A stream that has decoded some chunks
+static void InitStream(const FakeModel &model, sherpa_ncnn::Stream *s) {
+  std::vector<float> samples = Samples(16000);
+  s->AcceptWaveform(16000, samples.data(), samples.size());
+  s->GetNumProcessedFrames() = 64;
+
+  sherpa_ncnn::DecoderResult r;
+  r.tokens = {0, 0, 25, 31};
+  r.timestamps = {3, 9};
+  r.frame_offset = 16;
+  r.num_trailing_blanks = 2;
+  r.decoder_out.create(4);
+  r.decoder_out.fill(0.5f);
+
+  sherpa_ncnn::Hypothesis hyp;
+  hyp.log_prob = -1.25;
+  hyp.AddToken(25, 3);
+  hyp.AddToken(31, 9);
+  r.hyps.Add(std::move(hyp));
+  s->SetResult(r);
+  s->GetResult().frame_offset = r.frame_offset;
+
+  std::vector<ncnn::Mat> states = model.GetEncoderInitStates();
+  for (auto &m : states) {
+    for (int32_t i = 0; i != static_cast<int32_t>(m.total()); ++i) {
+      static_cast<float *>(m)[i] = 0.01f * i;
+    }
+  }
+  s->SetStates(states);
+}
+
+static void TestSaveAndRestore() {
+  FakeModel model;
+  sherpa_ncnn::Stream saved;
+  InitStream(model, &saved);
+
+  std::string data = sherpa_ncnn::SaveStreamState(&saved);
+  assert(!data.empty());
+
+  sherpa_ncnn::Stream s;
+  int32_t feature_dim = 80;
+  bool ok = sherpa_ncnn::RestoreStreamState(data.data(), data.size(), model,
+                                            feature_dim, &s);
+  assert(ok);
+
+  assert(s.GetNumProcessedFrames() == saved.GetNumProcessedFrames());
+  assert(s.NumFramesReady() == saved.NumFramesReady());
+
+  // The frames that are not processed yet are the same
+  int32_t start = saved.GetNumProcessedFrames();
+  int32_t n = saved.NumFramesReady() - start;
+  assert(n > 0);
+  assert(SameMat(s.GetFrames(start, n), saved.GetFrames(start, n)));
+
+  const auto &r = s.GetResult();
+  const auto &expected = saved.GetResult();
+  assert(r.tokens == expected.tokens);
+  assert(r.timestamps == expected.timestamps);
+  assert(r.frame_offset == expected.frame_offset);
+  assert(r.num_trailing_blanks == expected.num_trailing_blanks);
+  assert(SameMat(r.decoder_out, expected.decoder_out));
+  assert(r.hyps.Size() == 1);
+  for (const auto &hyp : r.hyps) {
+    assert(hyp.log_prob == -1.25);
+    assert((hyp.Ys() == std::vector<int32_t>{25, 31}));
+    assert((hyp.Timestamps() == std::vector<int32_t>{3, 9}));
+  }
+
+  assert(s.GetStates().size() == saved.GetStates().size());
+  for (int32_t i = 0; i != static_cast<int32_t>(s.GetStates().size()); ++i) {
+    assert(SameMat(s.GetStates()[i], saved.GetStates()[i]));
+  }
+
+  // Audio after restoring continues after the saved frames
+  std::vector<float> samples = Samples(8000);
+  s.AcceptWaveform(16000, samples.data(), samples.size());
+  assert(s.NumFramesReady() > saved.NumFramesReady());
+
+  (void)ok;
+}
+
+static void TestRejectInvalidSnapshot() {
+  FakeModel model;
+  sherpa_ncnn::Stream saved;
+  InitStream(model, &saved);
+
+  std::string data = sherpa_ncnn::SaveStreamState(&saved);
+  assert(!data.empty());
+
+  // Every truncation is rejected and leaves the stream unchanged
+  for (std::size_t n : {std::size_t(0), std::size_t(11), std::size_t(40),
+                        data.size() / 2, data.size() - 1}) {
+    sherpa_ncnn::Stream s;
+    bool ok = sherpa_ncnn::RestoreStreamState(data.data(), n, model, 80, &s);
+    assert(!ok);
+    assert(s.GetNumProcessedFrames() == 0);
+    assert(s.NumFramesReady() == 0);
+    (void)ok;
+  }
+
+  // Trailing bytes
+  std::string longer = data + "x";
+  sherpa_ncnn::Stream s;
+  assert(!sherpa_ncnn::RestoreStreamState(longer.data(), longer.size(), model,
+                                          80, &s));
+
+  // A wrong magic
+  std::string bad = data;
+  bad[0] = 'X';
+  assert(!sherpa_ncnn::RestoreStreamState(bad.data(), bad.size(), model, 80,
+                                          &s));
+
+  // A wrong feature dim
+  assert(!sherpa_ncnn::RestoreStreamState(data.data(), data.size(), model,
+                                          40, &s));
+}
+
+int32_t main() {
+  TestSaveAndRestore();
+  TestRejectInvalidSnapshot();
+
+  return 0;
+}
@@ -0,0 +1,115 @@
+// sherpa-ncnn/csrc/test-stream.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <assert.h>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/stream.h"
+
+static std::vector<float> Samples(int32_t n) {
+  std::vector<float> ans(n);
+  for (int32_t i = 0; i != n; ++i) {
+    ans[i] = 0.3f * std::sin(0.05f * i) + 0.1f * std::sin(0.7f * i);
+  }
+  return ans;
+}
+
+// Frame indexes start at the last Reset(), so the last frame must be found
+// relative to it, e.g., to decode the tail of an utterance
+static void TestIsLastFrameAfterReset() {
+  std::vector<float> samples = Samples(16000);
+
+  sherpa_ncnn::Stream s;
+  s.AcceptWaveform(16000, samples.data(), samples.size());
+
+  // As after decoding some chunks and an endpoint
+  int32_t n = s.NumFramesReady();
+  assert(n > 40);
+  s.GetNumProcessedFrames() = n - 10;
+  s.Reset();
+  assert(s.NumFramesReady() == 10);
+
+  s.AcceptWaveform(16000, samples.data(), samples.size());
+  s.InputFinished();
+
+  int32_t num_frames = s.NumFramesReady();
+  assert(num_frames > 10);
+  assert(s.IsLastFrame(num_frames - 1));
+  assert(!s.IsLastFrame(num_frames - 2));
+  assert(!s.IsLastFrame(0));
+}
+
+static bool SameFrames(const ncnn::Mat &a, const ncnn::Mat &b) {
+  if (a.w != b.w || a.h != b.h) {
+    return false;
+  }
+
+  for (int32_t i = 0; i != a.w * a.h; ++i) {
+    if (static_cast<const float *>(a)[i] != static_cast<const float *>(b)[i]) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static void TestParkAndUnpark() {
+  std::vector<float> samples = Samples(16000);
+
+  sherpa_ncnn::Stream s;
+  s.AcceptWaveform(16000, samples.data(), samples.size());
+  s.GetNumProcessedFrames() = 32;
+
+  std::vector<ncnn::Mat> states = {ncnn::Mat(16, 4), ncnn::Mat(8)};
+  for (auto &m : states) {
+    for (int32_t i = 0; i != m.w * m.h; ++i) {
+      static_cast<float *>(m)[i] = 0.25f * i - 3;
+    }
+  }
+  s.SetStates(states);
+
+  int32_t num_frames = s.NumFramesReady();
+  int32_t n = num_frames - 32;
+  ncnn::Mat frames = s.GetFrames(32, n).clone();
+  std::size_t total = s.GetMemoryUsage().Total();
+
+  s.Park();
+  assert(s.IsParked());
+  assert(s.GetMemoryUsage().Total() < total);
+
+  // The frames that are not processed yet are kept
+  assert(s.NumFramesReady() == num_frames);
+  assert(s.GetNumProcessedFrames() == 32);
+  assert(SameFrames(s.GetFrames(32, n), frames));
+
+  // New audio unparks it
+  s.AcceptWaveform(16000, samples.data(), samples.size());
+  assert(!s.IsParked());
+  assert(s.NumFramesReady() > num_frames);
+  assert(SameFrames(s.GetFrames(32, n), frames));
+
+  // The states are rounded to fp16, which is exact for these values
+  auto &unparked = s.GetStates();
+  assert(unparked.size() == states.size());
+  for (std::size_t k = 0; k != states.size(); ++k) {
+    assert(unparked[k].w == states[k].w && unparked[k].h == states[k].h);
+    for (int32_t i = 0; i != states[k].w * states[k].h; ++i) {
+      assert(static_cast<const float *>(unparked[k])[i] ==
+             static_cast<const float *>(states[k])[i]);
+    }
+  }
+
+  (void)total;
+}
+
+int32_t main() {
+  TestIsLastFrameAfterReset();
+  TestParkAndUnpark();
+
+  return 0;
+}
@@ -0,0 +1,59 @@
+// sherpa-ncnn/csrc/test-trace.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <assert.h>
+#include <stdio.h>
+
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>  // NOLINT
+
+#include "sherpa-ncnn/csrc/latency-stats.h"
+#include "sherpa-ncnn/csrc/trace.h"
+
+static std::string ReadFile(const std::string &filename) {
+  std::ifstream is(filename);
+  std::ostringstream os;
+  os << is.rdbuf();
+  return os.str();
+}
+
+int32_t main() {
+  std::string filename = "test-trace.json";
+
+  // Nothing is recorded before Start()
+  { sherpa_ncnn::TraceSpan span("before_start"); }
+
+  sherpa_ncnn::Tracer::Start(filename);
+  assert(sherpa_ncnn::Tracer::Enabled());
+
+  {
+    sherpa_ncnn::TraceStreamScope scope(7);
+    sherpa_ncnn::TraceSpan span("outer");
+    sherpa_ncnn::ScopedStageTimer timer(sherpa_ncnn::Stage::kJoiner);
+  }
+
+  std::thread t([]() { sherpa_ncnn::TraceSpan span("other_thread"); });
+  t.join();
+
+  bool ok = sherpa_ncnn::Tracer::Stop();
+  assert(ok);
+  assert(!sherpa_ncnn::Tracer::Enabled());
+  assert(!sherpa_ncnn::Tracer::Stop());
+
+  std::string s = ReadFile(filename);
+  assert(s.find("\"traceEvents\"") != std::string::npos);
+  assert(s.find("before_start") == std::string::npos);
+  assert(s.find("\"name\":\"outer\"") != std::string::npos);
+  assert(s.find("\"name\":\"joiner\"") != std::string::npos);
+  assert(s.find("\"stream\":7") != std::string::npos);
+  assert(s.find("\"name\":\"other_thread\"") != std::string::npos);
+
+  remove(filename.c_str());
+
+  (void)ok;
+  return 0;
+}
@@ -0,0 +1,193 @@
+// sherpa-ncnn/csrc/test-wave-reader.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/wave-reader.h"
+
+static void Append(std::string *s, const void *p, int32_t n) {
+  s->append(reinterpret_cast<const char *>(p), n);
+}
+
+static void Append16(std::string *s, uint16_t v) { Append(s, &v, 2); }
+
+static void Append32(std::string *s, uint32_t v) { Append(s, &v, 4); }
+
+// Return a wave file with the given encoding and interleaved samples. If
+// extensible is true, the fmt chunk is WAVE_FORMAT_EXTENSIBLE. If
+// with_list is true, a chunk of odd size precedes the fmt chunk.
+static std::string MakeWave(int32_t audio_format, int32_t bits_per_sample,
+                            int32_t num_channels, const std::string &samples,
+                            bool extensible = false, bool with_list = true) {
+  int32_t sample_rate = 16000;
+  int32_t block_align = num_channels * bits_per_sample / 8;
+
+  std::string fmt;
+  Append16(&fmt, extensible ? 0xfffe : audio_format);
+  Append16(&fmt, num_channels);
+  Append32(&fmt, sample_rate);
+  Append32(&fmt, sample_rate * block_align);
+  Append16(&fmt, block_align);
+  Append16(&fmt, bits_per_sample);
+  if (extensible) {
+    Append16(&fmt, 22);
+    Append16(&fmt, bits_per_sample);
+    Append32(&fmt, 0);
+    Append16(&fmt, audio_format);
+    fmt.append(14, '\0');
+  }
+
+  std::string ans = "RIFF";
+  Append32(&ans, 0);
+  ans += "WAVE";
+
+  if (with_list) {
+    ans += "LIST";
+    Append32(&ans, 3);
+    ans += "abc";
+    ans.push_back('\0');  // padding
+  }
+
+  ans += "fmt ";
+  Append32(&ans, fmt.size());
+  ans += fmt;
+
+  ans += "data";
+  Append32(&ans, samples.size());
+  ans += samples;
+
+  return ans;
+}
+
+static std::vector<float> ReadAll(sherpa_ncnn::WaveFileReader *reader) {
+  std::vector<float> ans;
+  float block[3];
+  int32_t n;
+  while ((n = reader->Read(block, 3)) > 0) {
+    ans.insert(ans.end(), block, block + n);
+  }
+  return ans;
+}
+
+static void AssertNear(const std::vector<float> &a,
+                       const std::vector<float> &b) {
+  assert(a.size() == b.size());
+  for (size_t i = 0; i != a.size(); ++i) {
+    assert(fabsf(a[i] - b[i]) < 1e-6f);
+  }
+}
+
+static void TestInt16Stereo() {
+  std::string samples;
+  std::vector<int16_t> v = {0, 16384, -32768, 32767, 100, -100, 8, 8};
+  Append(&samples, v.data(), v.size() * 2);
+
+  std::string wave = MakeWave(1, 16, 2, samples);
+  auto reader = sherpa_ncnn::WaveFileReader::Open(wave.data(), wave.size());
+  assert(reader);
+  assert(reader->SampleRate() == 16000);
+  assert(reader->NumChannels() == 2);
+  assert(reader->NumFrames() == 4);
+
+  AssertNear(ReadAll(reader.get()),
+             {0.25f, -0.5f / 32768, 0, 8 / 32768.0f});
+  assert(reader->Tell() == 4);
+
+  reader->Seek(3);
+  float x;
+  assert(reader->Read(&x, 1) == 1);
+  assert(fabsf(x - 8 / 32768.0f) < 1e-6f);
+  assert(reader->Read(&x, 1) == 0);
+}
+
+static void TestInt24() {
+  // 1, -1, the max and the min
+  const unsigned char v[] = {1, 0, 0, 0xff, 0xff, 0xff,
+                             0xff, 0xff, 0x7f, 0, 0, 0x80};
+  std::string samples(reinterpret_cast<const char *>(v), sizeof(v));
+
+  std::string wave = MakeWave(1, 24, 1, samples, true);
+  auto reader = sherpa_ncnn::WaveFileReader::Open(wave.data(), wave.size());
+  assert(reader);
+  assert(reader->BitsPerSample() == 24);
+
+  AssertNear(ReadAll(reader.get()),
+             {1 / 8388608.0f, -1 / 8388608.0f, 8388607 / 8388608.0f, -1});
+}
+
+static void TestFloat32() {
+  std::vector<float> v = {0.5f, -0.25f, 1, 0};
+  std::string samples;
+  Append(&samples, v.data(), v.size() * 4);
+
+  // three channels; the last frame is truncated
+  std::string wave = MakeWave(3, 32, 3, samples);
+  auto reader = sherpa_ncnn::WaveFileReader::Open(wave.data(), wave.size());
+  assert(reader);
+  assert(reader->NumFrames() == 1);
+  AssertNear(ReadAll(reader.get()), {1.25f / 3});
+}
+
+static void TestFile() {
+  std::string samples;
+  std::vector<int16_t> v;
+  for (int32_t i = 0; i != 1000; ++i) {
+    v.push_back(i * 37 - 16000);
+  }
+  Append(&samples, v.data(), v.size() * 2);
+
+  std::string filename = "test-wave-reader.wav";
+  {
+    std::ofstream os(filename, std::ios::binary);
+    // ReadWave() supports no chunk before the fmt chunk
+    std::string wave = MakeWave(1, 16, 1, samples, false, false);
+    os.write(wave.data(), wave.size());
+  }
+
+  auto reader = sherpa_ncnn::WaveFileReader::Open(filename);
+  assert(reader);
+
+  int32_t sampling_rate = 0;
+  bool is_ok = false;
+  std::vector<float> expected =
+      sherpa_ncnn::ReadWave(filename, &sampling_rate, &is_ok);
+  assert(is_ok);
+  assert(sampling_rate == reader->SampleRate());
+
+  AssertNear(ReadAll(reader.get()), expected);
+
+  reader.reset();
+  remove(filename.c_str());
+}
+
+static void TestInvalid() {
+  std::string wave = MakeWave(1, 12, 1, "ab");
+  assert(!sherpa_ncnn::WaveFileReader::Open(wave.data(), wave.size()));
+
+  std::string no_data = MakeWave(1, 16, 1, "");
+  no_data.resize(no_data.size() - 8);
+  assert(!sherpa_ncnn::WaveFileReader::Open(no_data.data(), no_data.size()));
+
+  assert(!sherpa_ncnn::WaveFileReader::Open("RIFF", 4));
+}
+
+int32_t main() {
+  TestInt16Stereo();
+  TestInt24();
+  TestFloat32();
+  TestFile();
+  TestInvalid();
+
+  fprintf(stderr, "Done\n");
+
+  return 0;
+}
@@ -15,6 +15,7 @@
 #include <locale>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -170,7 +171,7 @@ template bool SplitStringToFloats(const std::string &full, const char *delim,
                                   std::vector<double> *out);
 
 static bool IsPunct(char c) { return c != '\'' && std::ispunct(c); }
-static bool IsGermanUmlaut(const std::string &word) {
+static bool IsGermanUmlaut(std::string_view word) {
   // ä 0xC3 0xA4
   // ö 0xC3 0xB6
   // ü 0xC3 0xBC
@@ -194,7 +195,7 @@ static bool IsGermanUmlaut(const std::string &word) {
 
 // see https://www.tandem.net/blog/spanish-accents
 // https://www.compart.com/en/unicode/U+00DC
-static bool IsSpanishDiacritic(const std::string &word) {
+static bool IsSpanishDiacritic(std::string_view word) {
   // á 0xC3 0xA1
   // é 0xC3 0xA9
   // í 0xC3 0xAD
@@ -228,7 +229,7 @@ static bool IsSpanishDiacritic(const std::string &word) {
 }
 
 // see https://www.busuu.com/en/french/accent-marks
-static bool IsFrenchDiacritic(const std::string &word) {
+static bool IsFrenchDiacritic(std::string_view word) {
   // acute accent
   // é 0xC3 0xA9
   //
@@ -283,7 +284,7 @@ static bool IsFrenchDiacritic(const std::string &word) {
   return false;
 }
 
-static bool IsSpecial(const std::string &w) {
+static bool IsSpecial(std::string_view w) {
   bool ans = IsGermanUmlaut(w) || IsSpanishDiacritic(w) || IsFrenchDiacritic(w);
 
   // for french d’impossible
@@ -301,66 +302,46 @@ static bool IsSpecial(const std::string &w) {
   return ans || ans2;
 }
 
-static std::vector<std::string> MergeCharactersIntoWords(
-    const std::vector<std::string> &words) {
-  std::vector<std::string> ans;
+std::vector<std::string_view> SplitUtf8View(std::string_view text) {
+  const uint8_t *begin = reinterpret_cast<const uint8_t *>(text.data());
+  const uint8_t *end = begin + text.size();
 
-  int32_t n = static_cast<int32_t>(words.size());
-  int32_t i = 0;
-  int32_t prev = -1;
+  std::vector<std::string_view> ans;
 
-  while (i < n) {
-    const auto &w = words[i];
+  // Letters of the word being merged, e.g., English words, which are
+  // split into single characters below. It ends before a letter that does
+  // not follow it directly, i.e., after an invalid byte that is skipped.
+  const char *word_begin = nullptr;
+  const char *word_end = nullptr;
+  auto flush = [&]() {
+    if (word_begin) {
+      ans.emplace_back(word_begin, word_end - word_begin);
+      word_begin = nullptr;
+    }
+  };
+
+  auto add = [&](std::string_view w) {
     if (w.size() >= 3 || (w.size() == 2 && !IsSpecial(w)) ||
         (w.size() == 1 &&
          (IsPunct(w[0]) || std::isspace(static_cast<uint8_t>(w[0]))))) {
-      if (prev != -1) {
-        std::string t;
-        for (; prev < i; ++prev) {
-          t.append(words[prev]);
-        }
-        prev = -1;
-        ans.push_back(std::move(t));
-      }
+      flush();
 
       if (!std::isspace(static_cast<uint8_t>(w[0]))) {
         ans.push_back(w);
       }
-      ++i;
-      continue;
+      return;
     }
 
     // e.g., öffnen
-    if (w.size() == 1 || (w.size() == 2 && IsSpecial(w))) {
-      if (prev == -1) {
-        prev = i;
-      }
-      ++i;
-      continue;
+    if (word_begin && word_end != w.data()) {
+      flush();
     }
 
-    SHERPA_NCNN_LOGE("Ignore %s", w.c_str());
-    ++i;
-  }
-
-  if (prev != -1) {
-    std::string t;
-    for (; prev < i; ++prev) {
-      t.append(words[prev]);
+    if (!word_begin) {
+      word_begin = w.data();
     }
-    ans.push_back(std::move(t));
-  }
-
-  return ans;
-}
-
-std::vector<std::string> SplitUtf8(const std::string &text) {
-  const uint8_t *begin = reinterpret_cast<const uint8_t *>(text.c_str());
-  const uint8_t *end = begin + text.size();
-
-  // Note that English words are split into single characters.
-  // We need to invoke MergeCharactersIntoWords() to merge them
-  std::vector<std::string> ans;
+    word_end = w.data() + w.size();
+  };
 
   auto start = begin;
   while (start < end) {
@@ -376,10 +357,12 @@ std::vector<std::string> SplitUtf8(const std::string &text) {
 
     if (num_bytes == 0) {
       // this is an ascii
-      ans.emplace_back(reinterpret_cast<const char *>(start), 1);
+      add(std::string_view(reinterpret_cast<const char *>(start), 1));
       ++start;
-    } else if (2 <= num_bytes && num_bytes <= 4) {
-      ans.emplace_back(reinterpret_cast<const char *>(start), num_bytes);
+    } else if (2 <= num_bytes && num_bytes <= 4 &&
+               num_bytes <= end - start) {
+      add(std::string_view(reinterpret_cast<const char *>(start),
+                           num_bytes));
       start += num_bytes;
     } else {
       SHERPA_NCNN_LOGE("Invalid byte at position: %d",
@@ -388,8 +371,14 @@ std::vector<std::string> SplitUtf8(const std::string &text) {
       ++start;
     }
   }
+  flush();
+
+  return ans;
+}
 
-  return MergeCharactersIntoWords(ans);
+std::vector<std::string> SplitUtf8(const std::string &text) {
+  std::vector<std::string_view> words = SplitUtf8View(text);
+  return std::vector<std::string>(words.begin(), words.end());
 }
 
 std::string ToLowerCase(const std::string &s) {
@@ -703,4 +692,57 @@ std::vector<std::string> SplitString(const std::string &s, int32_t chunk_size) {
   return ans;
 }
 
+uint64_t Fnv1a(const std::string &s) {
+  uint64_t h = 14695981039346656037ull;
+  for (unsigned char c : s) {
+    h ^= c;
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+
+std::string ToJsonString(const std::string &s) {
+  std::string ans;
+  ans.reserve(s.size() + 2);
+  ans.push_back('"');
+
+  for (unsigned char c : s) {
+    switch (c) {
+      case '"':
+        ans += "\\\"";
+        break;
+      case '\\':
+        ans += "\\\\";
+        break;
+      case '\b':
+        ans += "\\b";
+        break;
+      case '\f':
+        ans += "\\f";
+        break;
+      case '\n':
+        ans += "\\n";
+        break;
+      case '\r':
+        ans += "\\r";
+        break;
+      case '\t':
+        ans += "\\t";
+        break;
+      default:
+        if (c < 0x20) {
+          static const char kHex[] = "0123456789abcdef";
+          ans += "\\u00";
+          ans.push_back(kHex[c >> 4]);
+          ans.push_back(kHex[c & 0xf]);
+        } else {
+          ans.push_back(static_cast<char>(c));
+        }
+    }
+  }
+
+  ans.push_back('"');
+  return ans;
+}
+
 }  // namespace sherpa_ncnn
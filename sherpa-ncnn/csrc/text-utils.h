@@ -10,6 +10,7 @@
 #include <cstdint>
 #include <limits>
 #include <string>
+#include <string_view>
 #include <type_traits>
 #include <vector>
 
@@ -120,8 +121,16 @@ bool SplitStringToFloats(const std::string &full, const char *delim,
 template <typename T>
 bool ConvertStringToReal(const std::string &str, T *out);
 
+/** Split text into words for the lexicon of a TTS model. Letters that
+ * form a word, e.g., of English or German, are kept together. Any other
+ * character, e.g., a Chinese character or a punctuation, is a word of its
+ * own. Whitespace is dropped.
+ */
 std::vector<std::string> SplitUtf8(const std::string &text);
 
+// Same as SplitUtf8(), but the words refer to text instead of being copied
+std::vector<std::string_view> SplitUtf8View(std::string_view text);
+
 std::string ToLowerCase(const std::string &s);
 void ToLowerCase(std::string *in_out);
 
@@ -150,6 +159,14 @@ bool EndsWith(const std::string &haystack, const std::string &needle);
 
 std::vector<std::string> SplitString(const std::string &s, int32_t chunk_size);
 
+// 64-bit FNV-1a. Unlike std::hash, it is the same on all platforms, so
+// it can be used in the names of files that are kept across runs.
+uint64_t Fnv1a(const std::string &s);
+
+// Return s as a JSON string, i.e., in double quotes with ", \ and control
+// characters escaped. s should be UTF-8; other bytes are copied as is.
+std::string ToJsonString(const std::string &s);
+
 }  // namespace sherpa_ncnn
 
 #endif  // SHERPA_NCNN_CSRC_TEXT_UTILS_H_
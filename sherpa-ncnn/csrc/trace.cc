@@ -0,0 +1,179 @@
+// sherpa-ncnn/csrc/trace.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/trace.h"
+
+#include <chrono>  // NOLINT
+#include <cstdlib>
+#include <fstream>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/macros.h"
+
+namespace sherpa_ncnn {
+
+namespace {
+
+struct Span {
+  const char *name;
+  int64_t start_us;  // since TracerState::origin
+  int64_t dur_us;
+  int32_t tid;
+  int64_t stream_id;
+};
+
+struct TracerState {
+  std::mutex mutex;
+  std::string filename;
+  StageClock::time_point origin;
+  std::vector<Span> spans;
+  int64_t num_dropped = 0;
+};
+
+TracerState &GetState() {
+  static TracerState state;
+  return state;
+}
+
+int64_t ToUs(StageClock::duration d) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+}
+
+// A small id for the current thread, in the order threads record spans
+int32_t ThreadId() {
+  static std::atomic<int32_t> next{1};
+  static thread_local int32_t id = next++;
+  return id;
+}
+
+thread_local int64_t current_stream_id = -1;
+
+// Start recording if SHERPA_NCNN_TRACE is set and write the spans at exit
+struct AutoStart {
+  AutoStart() {
+    // Construct the state first so that it is destroyed after this object
+    GetState();
+
+    const char *filename = std::getenv("SHERPA_NCNN_TRACE");
+    if (filename && *filename) {
+      Tracer::Start(filename);
+    }
+  }
+
+  ~AutoStart() {
+    if (Tracer::Enabled()) {
+      Tracer::Stop();
+    }
+  }
+};
+
+}  // namespace
+
+std::atomic<bool> Tracer::enabled_{false};
+
+static AutoStart auto_start;
+
+void Tracer::Start(const std::string &filename) {
+  TracerState &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+
+  state.filename = filename;
+  if (!enabled_) {
+    state.origin = StageClock::now();
+    state.spans.clear();
+    state.num_dropped = 0;
+  }
+
+  enabled_ = true;
+}
+
+bool Tracer::Stop() {
+  TracerState &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+
+  if (!enabled_) {
+    return false;
+  }
+  enabled_ = false;
+
+  std::ofstream os(state.filename);
+  if (!os) {
+    SHERPA_NCNN_LOGE("Failed to open %s for the trace",
+                     state.filename.c_str());
+    return false;
+  }
+
+  os << "{\"traceEvents\":[\n";
+  std::string sep;
+  for (const auto &s : state.spans) {
+    os << sep << "{\"name\":\"" << s.name
+       << "\",\"cat\":\"sherpa-ncnn\",\"ph\":\"X\",\"ts\":" << s.start_us
+       << ",\"dur\":" << s.dur_us << ",\"pid\":1,\"tid\":" << s.tid;
+    if (s.stream_id >= 0) {
+      os << ",\"args\":{\"stream\":" << s.stream_id << "}";
+    }
+    os << "}";
+    sep = ",\n";
+  }
+  os << "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_spans\":"
+     << state.num_dropped << "}}\n";
+
+  state.spans.clear();
+  state.spans.shrink_to_fit();
+
+  if (!os) {
+    SHERPA_NCNN_LOGE("Failed to write the trace to %s",
+                     state.filename.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+void Tracer::AddSpan(const char *name, StageClock::time_point start,
+                     StageClock::time_point end, int64_t stream_id) {
+  int32_t tid = ThreadId();
+
+  TracerState &state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  if (!enabled_) {
+    return;
+  }
+
+  if (static_cast<int32_t>(state.spans.size()) >= kMaxSpans) {
+    state.num_dropped += 1;
+    return;
+  }
+
+  state.spans.push_back({name, ToUs(start - state.origin), ToUs(end - start),
+                         tid, stream_id});
+}
+
+TraceSpan::TraceSpan(const char *name, int64_t stream_id)
+    : name_(name),
+      stream_id_(stream_id >= 0 ? stream_id : TraceStreamScope::Current()),
+      enabled_(Tracer::Enabled()) {
+  if (enabled_) {
+    start_ = StageClock::now();
+  }
+}
+
+TraceSpan::~TraceSpan() {
+  if (enabled_) {
+    Tracer::AddSpan(name_, start_, StageClock::now(), stream_id_);
+  }
+}
+
+TraceStreamScope::TraceStreamScope(int64_t stream_id)
+    : prev_(current_stream_id) {
+  current_stream_id = stream_id;
+}
+
+TraceStreamScope::~TraceStreamScope() { current_stream_id = prev_; }
+
+int64_t TraceStreamScope::Current() { return current_stream_id; }
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,93 @@
+// sherpa-ncnn/csrc/trace.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_TRACE_H_
+#define SHERPA_NCNN_CSRC_TRACE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "sherpa-ncnn/csrc/latency-stats.h"
+
+namespace sherpa_ncnn {
+
+/** A process-wide recorder of spans, e.g., of AcceptWaveform(), fbank,
+ * the networks, search, VAD windows and the stages of TTS, for finding
+ * out where the time of a slow request went.
+ *
+ * The spans are written in the Chrome trace event format, which
+ * chrome://tracing and https://ui.perfetto.dev open. Each span has the
+ * thread that ran it and, if any, the id of the stream, see
+ * Stream::GetId().
+ *
+ * Recording is off by default and costs one atomic load per span then.
+ * Set the environment variable SHERPA_NCNN_TRACE to a filename to record
+ * from the start of the process until it exits, or call Start() and
+ * Stop(). At most kMaxSpans spans are kept; later ones are dropped.
+ *
+ * It is thread-safe.
+ */
+class Tracer {
+ public:
+  static constexpr int32_t kMaxSpans = 1 << 20;
+
+  // Start recording. The spans are written to filename by Stop() or at
+  // exit. If it is already recording, the spans so far are kept and
+  // written to the new filename instead.
+  static void Start(const std::string &filename);
+
+  // Stop recording and write the spans. Return false if it is not
+  // recording or the file cannot be written.
+  static bool Stop();
+
+  static bool Enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+  // Record a span. name must outlive the tracer, e.g., a string literal.
+  static void AddSpan(const char *name, StageClock::time_point start,
+                      StageClock::time_point end, int64_t stream_id);
+
+ private:
+  static std::atomic<bool> enabled_;
+};
+
+// Record the lifetime of this object as a span if the tracer is enabled
+class TraceSpan {
+ public:
+  // If stream_id is negative, the stream of the current TraceStreamScope,
+  // if any, is used
+  explicit TraceSpan(const char *name, int64_t stream_id = -1);
+  ~TraceSpan();
+
+  TraceSpan(const TraceSpan &) = delete;
+  TraceSpan &operator=(const TraceSpan &) = delete;
+
+ private:
+  const char *name_;
+  int64_t stream_id_;
+  bool enabled_;
+  StageClock::time_point start_;
+};
+
+// Tag the spans of the current thread with the id of a stream while it is
+// alive, e.g., for the decoder and joiner runs of beam search, which do
+// not know the stream they decode. Scopes can be nested.
+class TraceStreamScope {
+ public:
+  explicit TraceStreamScope(int64_t stream_id);
+  ~TraceStreamScope();
+
+  TraceStreamScope(const TraceStreamScope &) = delete;
+  TraceStreamScope &operator=(const TraceStreamScope &) = delete;
+
+  // Return the stream of the innermost scope of the current thread or -1
+  static int64_t Current();
+
+ private:
+  int64_t prev_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_TRACE_H_
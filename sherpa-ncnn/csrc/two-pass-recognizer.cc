@@ -0,0 +1,196 @@
+// sherpa-ncnn/csrc/two-pass-recognizer.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/two-pass-recognizer.h"
+
+#include <atomic>
+#include <memory>
+#include <sstream>
+#include <utility>
+
+#include "sherpa-ncnn/csrc/macros.h"
+
+namespace sherpa_ncnn {
+
+std::string TwoPassRecognizerConfig::ToString() const {
+  std::ostringstream os;
+
+  os << "TwoPassRecognizerConfig(";
+  os << "queue_config=" << queue_config.ToString() << ", ";
+  os << "max_pending=" << max_pending << ", ";
+  os << "max_utterance_seconds=" << max_utterance_seconds << ")";
+
+  return os.str();
+}
+
+class TwoPassRecognizer::Impl {
+  // An utterance in the second pass
+  struct Job {
+    std::unique_ptr<OfflineStream> s;
+    TwoPassResult result;
+    Callback callback;
+  };
+
+ public:
+  Impl(const Recognizer *recognizer,
+       const OfflineRecognizer *offline_recognizer,
+       const TwoPassRecognizerConfig &config)
+      : recognizer_(recognizer),
+        offline_recognizer_(offline_recognizer),
+        config_(config),
+        queue_(offline_recognizer, config.queue_config) {
+    if (config_.max_pending < 0 || config_.max_utterance_seconds < 0) {
+      SHERPA_NCNN_LOGE("Invalid config: %s", config_.ToString().c_str());
+      SHERPA_NCNN_EXIT(-1);
+    }
+  }
+
+  std::unique_ptr<TwoPassStream> CreateStream(Callback callback) const {
+    auto s = std::make_unique<TwoPassStream>();
+    s->stream_ = recognizer_->CreateStream();
+    s->offline_stream_ = offline_recognizer_->CreateStream();
+    s->callback_ = std::move(callback);
+
+    return s;
+  }
+
+  void AcceptWaveform(TwoPassStream *s, int32_t sampling_rate,
+                      const float *samples, int32_t n) const {
+    s->stream_->AcceptWaveform(sampling_rate, samples, n);
+
+    if (!s->offline_stream_) return;
+
+    s->num_samples_ += n;
+    if (config_.max_utterance_seconds > 0 &&
+        s->num_samples_ > config_.max_utterance_seconds * sampling_rate) {
+      // Too long to rescore. Free its features now.
+      s->offline_stream_.reset();
+      return;
+    }
+
+    s->offline_stream_->AcceptWaveform(sampling_rate, samples, n);
+  }
+
+  bool CheckEndpoint(TwoPassStream *s) {
+    if (!recognizer_->IsEndpoint(s->stream_.get())) {
+      return false;
+    }
+
+    FinishUtterance(s);
+    return true;
+  }
+
+  void FinishUtterance(TwoPassStream *s) {
+    Stream *stream = s->stream_.get();
+    stream->Finalize();
+
+    TwoPassResult result;
+    result.first_pass_text = recognizer_->GetResult(stream).text;
+    result.text = result.first_pass_text;
+
+    std::unique_ptr<OfflineStream> offline_stream =
+        std::move(s->offline_stream_);
+
+    recognizer_->Reset(stream);
+    s->offline_stream_ = offline_recognizer_->CreateStream();
+    s->num_samples_ = 0;
+
+    if (result.first_pass_text.empty()) {
+      // Most endpoints end a stretch of silence. There is nothing to
+      // rescore and nothing to report.
+      return;
+    }
+
+    result.segment = s->segment_++;
+
+    if (!offline_stream || !Reserve()) {
+      ++num_skipped_;
+      s->callback_(result);
+      return;
+    }
+
+    auto job = std::make_shared<Job>();
+    job->s = std::move(offline_stream);
+    job->result = std::move(result);
+    job->callback = s->callback_;
+
+    queue_.Submit(job->s.get(), [this, job](OfflineStream *os) {
+      job->result.text = os->GetResult().text;
+      job->result.rescored = true;
+      job->callback(job->result);
+
+      ++num_rescored_;
+      --num_pending_;
+    });
+  }
+
+  void WaitIdle() { queue_.WaitIdle(); }
+
+  int32_t NumPending() const { return num_pending_; }
+
+  int64_t NumRescored() const { return num_rescored_; }
+
+  int64_t NumSkipped() const { return num_skipped_; }
+
+ private:
+  // Count an utterance as pending unless max_pending are pending already
+  bool Reserve() {
+    if (num_pending_.fetch_add(1) >= config_.max_pending) {
+      --num_pending_;
+      return false;
+    }
+    return true;
+  }
+
+ private:
+  const Recognizer *recognizer_;
+  const OfflineRecognizer *offline_recognizer_;
+  TwoPassRecognizerConfig config_;
+
+  std::atomic<int32_t> num_pending_{0};
+  std::atomic<int64_t> num_rescored_{0};
+  std::atomic<int64_t> num_skipped_{0};
+
+  // Declared last, so that it is destroyed, and the callbacks of the
+  // queued utterances are invoked, before the counters above
+  OfflineJobQueue queue_;
+};
+
+TwoPassRecognizer::TwoPassRecognizer(
+    const Recognizer *recognizer, const OfflineRecognizer *offline_recognizer,
+    const TwoPassRecognizerConfig &config)
+    : impl_(std::make_unique<Impl>(recognizer, offline_recognizer, config)) {}
+
+TwoPassRecognizer::~TwoPassRecognizer() = default;
+
+std::unique_ptr<TwoPassStream> TwoPassRecognizer::CreateStream(
+    Callback callback) const {
+  return impl_->CreateStream(std::move(callback));
+}
+
+void TwoPassRecognizer::AcceptWaveform(TwoPassStream *s,
+                                       int32_t sampling_rate,
+                                       const float *samples, int32_t n) const {
+  impl_->AcceptWaveform(s, sampling_rate, samples, n);
+}
+
+bool TwoPassRecognizer::CheckEndpoint(TwoPassStream *s) {
+  return impl_->CheckEndpoint(s);
+}
+
+void TwoPassRecognizer::FinishUtterance(TwoPassStream *s) {
+  impl_->FinishUtterance(s);
+}
+
+void TwoPassRecognizer::WaitIdle() { impl_->WaitIdle(); }
+
+int32_t TwoPassRecognizer::NumPending() const { return impl_->NumPending(); }
+
+int64_t TwoPassRecognizer::NumRescored() const {
+  return impl_->NumRescored();
+}
+
+int64_t TwoPassRecognizer::NumSkipped() const { return impl_->NumSkipped(); }
+
+}  // namespace sherpa_ncnn
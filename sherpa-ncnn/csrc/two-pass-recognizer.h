@@ -0,0 +1,178 @@
+// sherpa-ncnn/csrc/two-pass-recognizer.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_TWO_PASS_RECOGNIZER_H_
+#define SHERPA_NCNN_CSRC_TWO_PASS_RECOGNIZER_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "sherpa-ncnn/csrc/offline-job-queue.h"
+#include "sherpa-ncnn/csrc/offline-recognizer.h"
+#include "sherpa-ncnn/csrc/offline-stream.h"
+#include "sherpa-ncnn/csrc/recognizer.h"
+
+namespace sherpa_ncnn {
+
+struct TwoPassRecognizerConfig {
+  // Worker pool of the second pass
+  OfflineJobQueueConfig queue_config;
+
+  // The second pass is skipped, i.e., the result of the first pass is
+  // final, while this many utterances are waiting for or in the second
+  // pass. It keeps the delay of the final results bounded when the
+  // second pass cannot keep up.
+  int32_t max_pending = 8;
+
+  // Utterances that are longer than this many seconds are not rescored.
+  // Their samples are no longer passed to the second pass once they get
+  // too long, so an endpoint that never comes does not use unbounded
+  // memory. 0 means no limit.
+  float max_utterance_seconds = 30;
+
+  TwoPassRecognizerConfig() = default;
+
+  TwoPassRecognizerConfig(const OfflineJobQueueConfig &queue_config,
+                          int32_t max_pending, float max_utterance_seconds)
+      : queue_config(queue_config),
+        max_pending(max_pending),
+        max_utterance_seconds(max_utterance_seconds) {}
+
+  std::string ToString() const;
+};
+
+struct TwoPassResult {
+  // Index of the utterance in its stream, starting from 0
+  int32_t segment = 0;
+
+  // The final result of the first pass
+  std::string first_pass_text;
+
+  // The text of the second pass if rescored is true; otherwise, the same
+  // as first_pass_text
+  std::string text;
+
+  bool rescored = false;
+};
+
+class TwoPassRecognizer;
+
+/** A stream of the first pass together with an OfflineStream that
+ * receives the samples of its current utterance. See TwoPassRecognizer.
+ */
+class TwoPassStream {
+ public:
+  // Decode it with the Recognizer of the TwoPassRecognizer, e.g., with
+  // DecodeStreams() in a batch with other streams
+  Stream *GetStream() const { return stream_.get(); }
+
+ private:
+  friend class TwoPassRecognizer;
+
+  std::unique_ptr<Stream> stream_;
+
+  // For the current utterance. It is null if the utterance got longer
+  // than max_utterance_seconds.
+  std::unique_ptr<OfflineStream> offline_stream_;
+  int32_t num_samples_ = 0;
+
+  int32_t segment_ = 0;
+  std::function<void(const TwoPassResult &)> callback_;
+};
+
+/** Two-pass decoding: partial results come from a streaming model and the
+ * final result of each utterance from an offline model, e.g., SenseVoice.
+ *
+ * Only utterances are rescored, so the offline model runs once per
+ * endpoint instead of on every chunk. The samples of the current
+ * utterance go to an OfflineStream as they arrive, so its features are
+ * ready at the endpoint; the streaming model cannot share its fbank
+ * frames with it, since SenseVoice uses a different window and scaling.
+ * At the endpoint, the OfflineStream is queued on an OfflineJobQueue and
+ * the first pass continues with the next utterance right away. The final
+ * result arrives later on a worker thread.
+ *
+ * Usage:
+ *
+ *   TwoPassRecognizer two_pass(&recognizer, &offline_recognizer, config);
+ *   auto s = two_pass.CreateStream([](const TwoPassResult &r) {
+ *     // Replace the partial result of segment r.segment with r.text
+ *   });
+ *
+ *   while (...) {
+ *     two_pass.AcceptWaveform(s.get(), 16000, samples, n);
+ *     while (recognizer.IsReady(s->GetStream())) {
+ *       recognizer.DecodeStream(s->GetStream());
+ *     }
+ *     // Display recognizer.GetResult(s->GetStream()).text as partial
+ *     two_pass.CheckEndpoint(s.get());
+ *   }
+ *
+ *   // At the end of the input
+ *   s->GetStream()->InputFinished();
+ *   while (recognizer.IsReady(s->GetStream())) {
+ *     recognizer.DecodeStream(s->GetStream());
+ *   }
+ *   two_pass.FinishUtterance(s.get());
+ */
+class TwoPassRecognizer {
+ public:
+  // Invoked once per utterance in which the first pass found text. If the
+  // utterance is rescored, it is invoked on a worker thread, otherwise on
+  // the thread that ends the utterance. It may be invoked after its stream
+  // is destroyed.
+  using Callback = std::function<void(const TwoPassResult &result)>;
+
+  // Both recognizers must outlive this object
+  TwoPassRecognizer(const Recognizer *recognizer,
+                    const OfflineRecognizer *offline_recognizer,
+                    const TwoPassRecognizerConfig &config);
+
+  // Rescore the utterances that are still queued
+  ~TwoPassRecognizer();
+
+  TwoPassRecognizer(const TwoPassRecognizer &) = delete;
+  TwoPassRecognizer &operator=(const TwoPassRecognizer &) = delete;
+
+  std::unique_ptr<TwoPassStream> CreateStream(Callback callback) const;
+
+  // Pass samples to the stream of the first pass and to the second pass
+  void AcceptWaveform(TwoPassStream *s, int32_t sampling_rate,
+                      const float *samples, int32_t n) const;
+
+  /** If the first pass detects an endpoint, end the current utterance
+   * with FinishUtterance() and return true.
+   */
+  bool CheckEndpoint(TwoPassStream *s);
+
+  /** End the current utterance, e.g., at the end of the input.
+   *
+   * The utterance is queued for the second pass unless the first pass
+   * found no text, it is longer than max_utterance_seconds or max_pending
+   * utterances are pending. The stream of the first pass is reset for the
+   * next utterance.
+   */
+  void FinishUtterance(TwoPassStream *s);
+
+  // Wait until all queued utterances are rescored
+  void WaitIdle();
+
+  // Number of utterances that are queued or being rescored
+  int32_t NumPending() const;
+
+  int64_t NumRescored() const;
+
+  // Number of utterances with text that were not rescored
+  int64_t NumSkipped() const;
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_TWO_PASS_RECOGNIZER_H_
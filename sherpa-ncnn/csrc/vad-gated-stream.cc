@@ -0,0 +1,116 @@
+// sherpa-ncnn/csrc/vad-gated-stream.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/vad-gated-stream.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace sherpa_ncnn {
+
+VadGatedStream::VadGatedStream(const Recognizer *recognizer,
+                               const SileroVadModelConfig &vad_config,
+                               std::shared_ptr<SileroVadModel> vad_model)
+    : recognizer_(recognizer),
+      stream_(recognizer->CreateStream()),
+      sample_rate_(vad_config.sample_rate) {
+  if (vad_model) {
+    vad_ = std::make_unique<VoiceActivityDetector>(vad_config,
+                                                   std::move(vad_model));
+  } else {
+    vad_ = std::make_unique<VoiceActivityDetector>(vad_config);
+  }
+
+  // Enough feature frames for the model to decode the last frames of a
+  // segment. The frame shift is 10 ms.
+  int32_t segment = recognizer->GetModel()->Segment();
+  tail_padding_.resize(segment * sample_rate_ / 100);
+
+  VadCallbacks callbacks;
+  callbacks.on_speech_start = [this](int32_t start) { OnSpeechStart(start); };
+  callbacks.on_speech_samples = [this](const CircularBufferView &samples) {
+    OnSpeechSamples(samples);
+  };
+  callbacks.on_speech_end = [this](int32_t, int32_t) { OnSpeechEnd(); };
+  vad_->SetCallbacks(std::move(callbacks));
+}
+
+VadGatedStream::~VadGatedStream() = default;
+
+void VadGatedStream::AcceptWaveform(const float *samples, int32_t n) {
+  vad_->AcceptWaveform(samples, n);
+}
+
+void VadGatedStream::AcceptWaveformInt16(const int16_t *samples, int32_t n) {
+  vad_->AcceptWaveformInt16(samples, n);
+}
+
+void VadGatedStream::InputFinished() {
+  vad_->Flush();
+  stream_->InputFinished();
+}
+
+bool VadGatedStream::IsEndpoint() const {
+  return segment_ended_ && !recognizer_->IsReady(stream_.get());
+}
+
+RecognitionResult VadGatedStream::GetResult() const {
+  RecognitionResult r = recognizer_->GetResult(stream_.get());
+  for (auto &t : r.timestamps) {
+    t = ToInputTime(t);
+  }
+
+  return r;
+}
+
+void VadGatedStream::Reset() {
+  recognizer_->Reset(stream_.get());
+  segment_ended_ = false;
+
+  // Only the offset of the current segment, if any, is still needed
+  if (offsets_.size() > 1) {
+    offsets_.erase(offsets_.begin(), offsets_.end() - 1);
+  }
+}
+
+void VadGatedStream::OnSpeechStart(int32_t start) {
+  offsets_.push_back({static_cast<float>(num_stream_samples_) / sample_rate_,
+                      static_cast<float>(start) / sample_rate_});
+}
+
+void VadGatedStream::OnSpeechSamples(const CircularBufferView &samples) {
+  if (samples.size1 > 0) {
+    stream_->AcceptWaveform(sample_rate_, samples.data1, samples.size1);
+  }
+
+  if (samples.size2 > 0) {
+    stream_->AcceptWaveform(sample_rate_, samples.data2, samples.size2);
+  }
+
+  num_stream_samples_ += samples.Size();
+}
+
+void VadGatedStream::OnSpeechEnd() {
+  stream_->AcceptWaveform(sample_rate_, tail_padding_.data(),
+                          tail_padding_.size());
+  num_stream_samples_ += tail_padding_.size();
+
+  segment_ended_ = true;
+}
+
+float VadGatedStream::ToInputTime(float t) const {
+  // The last segment that starts at or before t
+  auto it = std::upper_bound(
+      offsets_.begin(), offsets_.end(), t,
+      [](float t, const Offset &o) { return t < o.stream_time; });
+
+  if (it == offsets_.begin()) {
+    return t;
+  }
+
+  --it;
+  return t - it->stream_time + it->input_time;
+}
+
+}  // namespace sherpa_ncnn
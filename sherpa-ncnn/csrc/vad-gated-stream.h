@@ -0,0 +1,128 @@
+// sherpa-ncnn/csrc/vad-gated-stream.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_VAD_GATED_STREAM_H_
+#define SHERPA_NCNN_CSRC_VAD_GATED_STREAM_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/recognizer.h"
+#include "sherpa-ncnn/csrc/silero-vad-model-config.h"
+#include "sherpa-ncnn/csrc/silero-vad-model.h"
+#include "sherpa-ncnn/csrc/stream.h"
+#include "sherpa-ncnn/csrc/voice-activity-detector.h"
+
+namespace sherpa_ncnn {
+
+/** A stream of a streaming recognizer with a voice activity detector in
+ * front of it.
+ *
+ * Only the samples of speech segments reach the underlying Stream, so
+ * Recognizer::IsReady() stays false during silence and no encoder or
+ * joiner work is done for it. The samples of a segment are passed on while
+ * the segment is still going on, see VadCallbacks, so recognition starts
+ * with the first speech samples.
+ *
+ * At the end of a segment, a little silence is appended so that its last
+ * frames can be decoded. The encoder states are carried over to the next
+ * segment. Timestamps of GetResult() are in seconds of the input audio,
+ * i.e., the skipped silence is accounted for.
+ *
+ * Usage:
+ *
+ *   VadGatedStream s(&recognizer, vad_config, vad_model);
+ *   s.AcceptWaveform(samples, n);
+ *   while (recognizer.IsReady(s.GetStream())) {
+ *     recognizer.DecodeStream(s.GetStream());  // or DecodeStreams()
+ *   }
+ *   if (s.IsEndpoint()) {
+ *     auto r = s.GetResult();
+ *     s.Reset();
+ *   }
+ */
+class VadGatedStream {
+ public:
+  /**
+   * @param recognizer It must outlive this object.
+   * @param vad_config The config of the detector.
+   * @param vad_model  If not null, it is shared instead of loading the
+   *                   model of vad_config, see VoiceActivityDetector.
+   */
+  VadGatedStream(const Recognizer *recognizer,
+                 const SileroVadModelConfig &vad_config,
+                 std::shared_ptr<SileroVadModel> vad_model = nullptr);
+
+  ~VadGatedStream();
+
+  VadGatedStream(const VadGatedStream &) = delete;
+  VadGatedStream &operator=(const VadGatedStream &) = delete;
+
+  /**
+   * @param samples Audio samples at the sample rate of the VAD config,
+   *                normalized to [-1, 1].
+   * @param n Number of samples.
+   */
+  void AcceptWaveform(const float *samples, int32_t n);
+
+  // Same as AcceptWaveform() but for 16-bit PCM samples
+  void AcceptWaveformInt16(const int16_t *samples, int32_t n);
+
+  // Finish the current segment, if any, and the underlying stream
+  void InputFinished();
+
+  // The stream to decode with the recognizer. Do not feed it samples
+  // directly.
+  Stream *GetStream() const { return stream_.get(); }
+
+  // Return true if a speech segment has ended and all of its frames are
+  // decoded. Invoke Reset() afterwards.
+  bool IsEndpoint() const;
+
+  // Same as Recognizer::GetResult() but the timestamps are in seconds of
+  // the input audio
+  RecognitionResult GetResult() const;
+
+  // Start a new result, see Recognizer::Reset()
+  void Reset();
+
+  // Return true if the detector is in a speech segment
+  bool IsSpeechDetected() const { return vad_->IsSpeechDetected(); }
+
+ private:
+  void OnSpeechStart(int32_t start);
+  void OnSpeechSamples(const CircularBufferView &samples);
+  void OnSpeechEnd();
+
+  // Map a time of the underlying stream to a time of the input, both in
+  // seconds
+  float ToInputTime(float t) const;
+
+ private:
+  const Recognizer *recognizer_;
+  std::unique_ptr<Stream> stream_;
+  std::unique_ptr<VoiceActivityDetector> vad_;
+  int32_t sample_rate_;
+
+  // Number of samples passed to stream_, including the padding
+  int64_t num_stream_samples_ = 0;
+
+  // Samples of silence appended to a segment
+  std::vector<float> tail_padding_;
+
+  // For each segment, its start in stream_ and in the input, in seconds
+  struct Offset {
+    float stream_time;
+    float input_time;
+  };
+  std::vector<Offset> offsets_;
+
+  // True if a segment has ended since the last Reset()
+  bool segment_ended_ = false;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_VAD_GATED_STREAM_H_
@@ -18,10 +18,16 @@
 #include "sherpa-ncnn/csrc/voice-activity-detector.h"
 
 #include <algorithm>
-#include <queue>
+#include <cmath>
+#include <deque>
+#include <memory>
+#include <thread>  // NOLINT
 #include <utility>
+#include <vector>
 
 #include "sherpa-ncnn/csrc/circular-buffer.h"
+#include "sherpa-ncnn/csrc/metrics.h"
+#include "sherpa-ncnn/csrc/pcm-utils.h"
 #include "sherpa-ncnn/csrc/silero-vad-model.h"
 
 namespace sherpa_ncnn {
@@ -30,144 +36,546 @@ class VoiceActivityDetector::Impl {
  public:
   explicit Impl(const SileroVadModelConfig &config,
                 float buffer_size_in_seconds = 60)
-      : model_(std::make_unique<SileroVadModel>(config)),
+      : model_(std::make_shared<SileroVadModel>(config)),
+        stream_(std::make_unique<SileroVadStream>(config)),
         config_(config),
         buffer_(buffer_size_in_seconds * config.sample_rate) {}
 
 #if __ANDROID_API__ >= 9
   Impl(AAssetManager *mgr, const SileroVadModelConfig &config,
        float buffer_size_in_seconds = 60)
-      : model_(std::make_unique<SileroVadModel>(mgr, config)),
+      : model_(std::make_shared<SileroVadModel>(mgr, config)),
+        stream_(std::make_unique<SileroVadStream>(config)),
         config_(config),
         buffer_(buffer_size_in_seconds * config.sample_rate) {}
 #endif
 
+  Impl(const SileroVadModelConfig &config,
+       std::shared_ptr<SileroVadModel> model,
+       float buffer_size_in_seconds = 60)
+      : model_(std::move(model)),
+        stream_(std::make_unique<SileroVadStream>(config)),
+        config_(config),
+        buffer_(buffer_size_in_seconds * config.sample_rate) {}
+
   void AcceptWaveform(const float *samples, int32_t n) {
-    if (buffer_.Size() > max_utterance_length_) {
-      model_->SetMinSilenceDuration(new_min_silence_duration_s_);
-      model_->SetThreshold(new_threshold_);
+    if (last_.empty()) {
+      // note n is usually window_size. The complete windows are processed
+      // in place and only the rest is kept for the next call.
+      int32_t k = NumWindows(n);
+      ComputeWindows(samples, k);
+      ProcessWindows(samples, probs_.data(), k);
+
+      last_.assign(samples + k * model_->WindowShift(), samples + n);
+      return;
+    }
+
+    Append(samples, n);
+
+    ProcessLast();
+  }
+
+  void AcceptFile(const float *samples, int32_t n) {
+    const float *p = samples;
+    if (!last_.empty()) {
+      Append(samples, n);
+      p = last_.data();
+      n = static_cast<int32_t>(last_.size());
+    }
+
+    int32_t k = NumWindows(n);
+    ComputeFileWindows(p, k);
+
+    // Segments are popped only after the whole file, so make room for all
+    // of its samples at once instead of growing buffer_ window by window
+    int32_t window_shift = model_->WindowShift();
+    int32_t size = buffer_.Size() + k * window_shift;
+    if (size > buffer_.Capacity()) {
+      buffer_.Resize(size);
+    }
+
+    // One window at a time, as with AcceptWaveform() for each window
+    for (int32_t i = 0; i != k; ++i) {
+      ProcessWindows(p + i * window_shift, probs_.data() + i, 1);
+    }
+
+    if (p == samples) {
+      last_.assign(samples + k * window_shift, samples + n);
     } else {
-      model_->SetMinSilenceDuration(config_.min_silence_duration);
-      model_->SetThreshold(config_.threshold);
+      last_.erase(last_.begin(), last_.begin() + k * window_shift);
     }
 
+    Flush();
+  }
+
+  void Append(const float *samples, int32_t n) {
+    last_.insert(last_.end(), samples, samples + n);
+  }
+
+  void AcceptWaveformInt16(const int16_t *samples, int32_t n) {
+    // Convert directly into last_, which keeps its capacity across calls
+    size_t size = last_.size();
+    last_.resize(size + n);
+    Int16ToFloat(samples, n, 1.0f / 32768, last_.data() + size);
+
+    ProcessLast();
+  }
+
+  // Run the model on the complete windows in last_
+  void ProcessLast() {
+    int32_t k = NumPendingWindows();
+    ComputeWindows(last_.data(), k);
+    ProcessPendingWindows(probs_.data(), k);
+  }
+
+  // Number of complete windows in n samples
+  int32_t NumWindows(int32_t n) const {
     int32_t window_size = model_->WindowSize();
     int32_t window_shift = model_->WindowShift();
 
-    // note n is usually window_size and there is no need to use
-    // an extra buffer here
-    last_.insert(last_.end(), samples, samples + n);
+    if (n < window_size) {
+      return 0;
+    }
+
+    // Note: For v4, window_shift == window_size
+    return (n - window_size) / window_shift + 1;
+  }
+
+  // Number of complete windows in last_
+  int32_t NumPendingWindows() const { return NumWindows(last_.size()); }
+
+  const float *PendingWindow(int32_t i) const {
+    return last_.data() + i * model_->WindowShift();
+  }
+
+  const std::shared_ptr<SileroVadModel> &GetModel() const { return model_; }
+
+  SileroVadStream *GetStream() { return stream_.get(); }
+
+  /* Return true if the window at p is quiet enough to be treated as
+   * silence without running the model, see
+   * SileroVadModelConfig::energy_gate_db. Its speech probability is then
+   * 0.
+   *
+   * The recurrent states are reset for such windows, so that the model
+   * starts from the states of a new stream once the audio gets louder,
+   * instead of from the states of the audio before the gap.
+   */
+  bool SkipWindow(const float *p) {
+    if (!IsQuiet(p)) {
+      return false;
+    }
 
-    if (last_.size() < window_size) {
+    stream_->ResetStates();
+    return true;
+  }
+
+  // Return true if the energy gate skips the window at p
+  bool IsQuiet(const float *p) const {
+    if (energy_floor_ <= 0) {
+      return false;
+    }
+
+    int32_t window_size = model_->WindowSize();
+    return MeanSquare(p, window_size) < energy_floor_ &&
+           NumZeroCrossings(p, window_size) <=
+               config_.energy_gate_max_zcr * (window_size - 1);
+  }
+
+  // Consume the first k windows of last_, which have the given speech
+  // probabilities
+  void ProcessPendingWindows(const float *probs, int32_t k) {
+    ProcessWindows(last_.data(), probs, k);
+    last_.erase(last_.begin(), last_.begin() + k * model_->WindowShift());
+  }
+
+ private:
+  // Set probs_ to the speech probabilities of the k windows starting at p
+  void ComputeWindows(const float *p, int32_t k) {
+    int32_t window_size = model_->WindowSize();
+    int32_t window_shift = model_->WindowShift();
+
+    probs_.resize(k);
+    for (int32_t i = 0; i != k; ++i, p += window_shift) {
+      probs_[i] =
+          SkipWindow(p) ? 0 : model_->Compute(p, window_size, stream_.get());
+    }
+  }
+
+  /* Same as ComputeWindows(), but the windows are split into parts that
+   * run in parallel, see AcceptFile(). The first part continues from
+   * stream_. The others start from reset states file_warm_up seconds
+   * earlier, and stream_ ends with the states of the last one.
+   */
+  void ComputeFileWindows(const float *p, int32_t k) {
+    int32_t window_size = model_->WindowSize();
+    int32_t window_shift = model_->WindowShift();
+    int32_t num_threads = std::max(config_.num_threads, 1);
+
+    int32_t warm_up = static_cast<int32_t>(
+        std::ceil(config_.file_warm_up * config_.sample_rate / window_shift));
+
+    // A part should be much longer than its warm-up
+    constexpr int32_t kMinPartWarmUps = 8;
+    int32_t num_parts = std::min(
+        num_threads, std::max(k / std::max(kMinPartWarmUps * warm_up, 1), 1));
+    if (num_parts == 1) {
+      ComputeWindows(p, k);
+      return;
+    }
+
+    probs_.resize(k);
+
+    // The threads of ncnn are shared among the parts
+    int32_t threads_per_part = std::max(num_threads / num_parts, 1);
+
+    std::vector<std::unique_ptr<SileroVadStream>> streams(num_parts);
+    auto run = [&](int32_t j) {
+      int32_t begin = static_cast<int64_t>(k) * j / num_parts;
+      int32_t end = static_cast<int64_t>(k) * (j + 1) / num_parts;
+
+      SileroVadStream *s = stream_.get();
+      int32_t i = begin;
+      if (j > 0) {
+        streams[j] = model_->CreateStream();
+        s = streams[j].get();
+        i = std::max(begin - warm_up, 0);
+      }
+
+      for (; i != end; ++i) {
+        const float *w = p + static_cast<int64_t>(i) * window_shift;
+        float prob = 0;
+        if (IsQuiet(w)) {
+          s->ResetStates();
+        } else {
+          prob = model_->Compute(w, window_size, s, threads_per_part);
+        }
+
+        if (i >= begin) {
+          probs_[i] = prob;
+        }
+      }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(num_parts - 1);
+    for (int32_t j = 1; j < num_parts; ++j) {
+      workers.emplace_back(run, j);
+    }
+    run(0);
+
+    for (auto &t : workers) {
+      t.join();
+    }
+
+    // Continue after the file with the states at its end
+    stream_->H() = streams.back()->H().clone();
+    stream_->C() = streams.back()->C().clone();
+  }
+
+  // Append the k windows starting at p, which have the given speech
+  // probabilities, to buffer_ and update the speech segments
+  void ProcessWindows(const float *p, const float *probs, int32_t k) {
+    if (buffer_.Tail() - head_ > max_utterance_length_) {
+      stream_->SetMinSilenceDuration(new_min_silence_duration_s_);
+      stream_->SetThreshold(new_threshold_);
+    } else {
+      stream_->SetMinSilenceDuration(config_.min_silence_duration);
+      stream_->SetThreshold(config_.threshold);
+    }
+
+    int32_t window_shift = model_->WindowShift();
+
+    if (k == 0) {
       return;
     }
 
-    // Note: For v4, window_shift == window_size
-    int32_t k =
-        (static_cast<int32_t>(last_.size()) - window_size) / window_shift + 1;
-    const float *p = last_.data();
     bool is_speech = false;
 
     for (int32_t i = 0; i < k; ++i, p += window_shift) {
       buffer_.Push(p, window_shift);
       // NOTE(fangjun): Please don't use a very large n.
-      bool this_window_is_speech = model_->IsSpeech(p, window_size);
+      bool this_window_is_speech = stream_->IsSpeech(probs[i]);
       is_speech = is_speech || this_window_is_speech;
-    }
 
-    last_ = std::vector<float>(
-        p, static_cast<const float *>(last_.data()) + last_.size());
+      if (callbacks_.on_speech_probability) {
+        callbacks_.on_speech_probability(probs[i], window_shift);
+      }
+
+      if (max_segment_samples_ > 0) {
+        window_probs_.push_back(
+            {buffer_.Tail() - window_shift / 2, probs[i]});
+      }
+    }
 
     if (is_speech) {
       if (start_ == -1) {
         // beginning of speech
         start_ = std::max(buffer_.Tail() - 2 * model_->WindowSize() -
-                              model_->MinSpeechDurationSamples(),
-                          buffer_.Head());
+                              stream_->MinSpeechDurationSamples(),
+                          head_);
+        delivered_ = start_;
+
+        if (callbacks_.on_speech_start) {
+          callbacks_.on_speech_start(start_);
+        }
+      }
+
+      SplitLongSegment();
+
+      // A segment ends at least MinSilenceDurationSamples() before the
+      // current tail, so the samples before it belong to the segment.
+      // The samples in which a long segment may be cut are held back
+      // until it is cut.
+      int32_t end = buffer_.Tail() - stream_->MinSilenceDurationSamples();
+      if (max_segment_samples_ > 0) {
+        end = std::min(end, start_ + max_segment_samples_ -
+                                max_segment_search_samples_);
       }
+      Deliver(end);
     } else {
       // non-speech
-      if (start_ != -1 && buffer_.Size()) {
+      if (start_ != -1 && buffer_.Tail() > head_) {
         // end of speech, save the speech segment
-        int32_t end = buffer_.Tail() - model_->MinSilenceDurationSamples();
+        int32_t end = buffer_.Tail() - stream_->MinSilenceDurationSamples();
 
-        std::vector<float> s = buffer_.Get(start_, end - start_);
-        SpeechSegment segment;
-
-        segment.start = start_;
-        segment.samples = std::move(s);
-
-        segments_.push(std::move(segment));
-
-        buffer_.Pop(end - buffer_.Head());
+        EndSegment(end);
       }
 
       if (start_ == -1) {
         int32_t end = buffer_.Tail() - 2 * model_->WindowSize() -
-                      model_->MinSpeechDurationSamples();
-        int32_t n = std::max(0, end - buffer_.Head());
-        if (n > 0) {
-          buffer_.Pop(n);
+                      stream_->MinSpeechDurationSamples();
+        if (end > head_) {
+          Consume(end);
         }
       }
 
       start_ = -1;
     }
+
+    while (!window_probs_.empty() && window_probs_.front().pos < head_) {
+      window_probs_.pop_front();
+    }
+  }
+
+  /* Cut the current segment while it is longer than max_segment_samples_
+   * and all of its windows that may end it are older than the minimum
+   * silence duration. It ends at the center of the window with the lowest
+   * speech probability among the last max_segment_search_samples_ before
+   * the limit, and a new segment starts right there.
+   */
+  void SplitLongSegment() {
+    if (max_segment_samples_ <= 0) {
+      return;
+    }
+
+    while (buffer_.Tail() - stream_->MinSilenceDurationSamples() - start_ >=
+           max_segment_samples_) {
+      int32_t limit = start_ + max_segment_samples_;
+      int32_t cut = limit;
+      float min_prob = 2;
+      for (const auto &w : window_probs_) {
+        if (w.pos > limit) {
+          break;
+        }
+
+        if (w.pos >= limit - max_segment_search_samples_ &&
+            w.prob < min_prob) {
+          min_prob = w.prob;
+          cut = w.pos;
+        }
+      }
+
+      EndSegment(cut);
+
+      start_ = cut;
+      delivered_ = cut;
+      if (callbacks_.on_speech_start) {
+        callbacks_.on_speech_start(start_);
+      }
+    }
+  }
+
+  // Pass the samples of the current segment in [delivered_, end) to
+  // on_speech_samples
+  void Deliver(int32_t end) {
+    if (end <= delivered_) {
+      return;
+    }
+
+    if (callbacks_.on_speech_samples) {
+      callbacks_.on_speech_samples(
+          buffer_.GetView(delivered_, end - delivered_));
+    }
+
+    delivered_ = end;
+  }
+
+  // Finish the current segment, which is [start_, end)
+  void EndSegment(int32_t end) {
+    Metrics::Add(MetricCounter::kVadSegments);
+
+    if (HasCallbacks()) {
+      Deliver(end);
+
+      if (callbacks_.on_speech_end) {
+        callbacks_.on_speech_end(start_, end - start_);
+      }
+    } else {
+      segments_.push_back({start_, end - start_});
+    }
+
+    Consume(end);
+  }
+
+  bool HasCallbacks() const {
+    return callbacks_.on_speech_start || callbacks_.on_speech_samples ||
+           callbacks_.on_speech_end;
   }
 
+  // Mark the samples before end as processed. They are removed from
+  // buffer_ once no queued segment refers to them.
+  void Consume(int32_t end) {
+    head_ = end;
+    PopBuffer();
+  }
+
+  void PopBuffer() {
+    int32_t keep = segments_.empty() ? head_ : segments_.front().start;
+    int32_t n = std::min(keep, head_) - buffer_.Head();
+    if (n > 0) {
+      buffer_.Pop(n);
+    }
+  }
+
+ public:
   bool Empty() const { return segments_.empty(); }
 
-  void Pop() { segments_.pop(); }
+  void Pop() {
+    segments_.pop_front();
+    front_valid_ = false;
+    PopBuffer();
+  }
 
-  void Clear() { std::queue<SpeechSegment>().swap(segments_); }
+  void Clear() {
+    segments_.clear();
+    front_valid_ = false;
+    PopBuffer();
+  }
 
-  const SpeechSegment &Front() const { return segments_.front(); }
+  const SpeechSegment &Front() const {
+    if (!front_valid_) {
+      const auto &segment = segments_.front();
+      front_.start = segment.start;
+      front_.samples = buffer_.Get(segment.start, segment.n);
+      front_valid_ = true;
+    }
+
+    return front_;
+  }
+
+  SpeechSegmentView FrontView() const {
+    const auto &segment = segments_.front();
+    return {segment.start, buffer_.GetView(segment.start, segment.n)};
+  }
 
   void Reset() {
-    std::queue<SpeechSegment>().swap(segments_);
+    segments_.clear();
+    front_valid_ = false;
 
-    model_->Reset();
+    stream_->Reset();
     buffer_.Reset();
 
+    head_ = 0;
     start_ = -1;
+    window_probs_.clear();
   }
 
   void Flush() {
-    if (start_ == -1 || buffer_.Size() == 0) {
+    if (start_ == -1 || buffer_.Tail() == head_) {
       return;
     }
 
-    int32_t end = buffer_.Tail() - model_->MinSilenceDurationSamples();
+    int32_t end = buffer_.Tail() - stream_->MinSilenceDurationSamples();
     if (end <= start_) {
       return;
     }
 
-    std::vector<float> s = buffer_.Get(start_, end - start_);
-
-    SpeechSegment segment;
-
-    segment.start = start_;
-    segment.samples = std::move(s);
-
-    segments_.push(std::move(segment));
-
-    buffer_.Pop(end - buffer_.Head());
+    EndSegment(end);
     start_ = -1;
   }
 
+  void SetCallbacks(VadCallbacks callbacks) {
+    callbacks_ = std::move(callbacks);
+  }
+
   bool IsSpeechDetected() const { return start_ != -1; }
 
   const SileroVadModelConfig &GetConfig() const { return config_; }
 
+  std::size_t NumBytes() const {
+    return (static_cast<std::size_t>(buffer_.Capacity()) + last_.capacity() +
+            front_.samples.capacity()) *
+           sizeof(float);
+  }
+
  private:
-  std::queue<SpeechSegment> segments_;
+  struct Segment {
+    int32_t start;  // in samples
+    int32_t n;
+  };
 
-  std::unique_ptr<SileroVadModel> model_;
+  // The samples of the segments stay in buffer_ until they are popped
+  std::deque<Segment> segments_;
+
+  // Cache of Front()
+  mutable SpeechSegment front_;
+  mutable bool front_valid_ = false;
+
+  std::shared_ptr<SileroVadModel> model_;  // may be shared with others
+  std::unique_ptr<SileroVadStream> stream_;
   SileroVadModelConfig config_;
+
+  // The mean square of samples below which a window may skip the model.
+  // 0 if the gate is disabled.
+  float energy_floor_ = config_.energy_gate_db < 0
+                            ? std::pow(10.0f, config_.energy_gate_db / 10)
+                            : 0;
+
   CircularBuffer buffer_;
   std::vector<float> last_;
 
+  // Speech probabilities of the windows being processed. It is kept to
+  // reuse its memory.
+  std::vector<float> probs_;
+
   int max_utterance_length_ = 16000 * 20;  // in samples
+
+  // See SileroVadModelConfig::max_segment_duration. 0 if disabled.
+  int32_t max_segment_samples_ =
+      config_.max_segment_duration * config_.sample_rate;
+  int32_t max_segment_search_samples_ =
+      config_.max_segment_search * config_.sample_rate;
+
+  struct WindowProb {
+    int32_t pos;  // center of the window, in samples
+    float prob;
+  };
+
+  // Speech probabilities of the windows after head_ if max_segment_samples_
+  // is positive, for choosing where to cut a long segment
+  std::deque<WindowProb> window_probs_;
+
+  VadCallbacks callbacks_;
+
+  // The samples of the current segment before it are passed to
+  // on_speech_samples
+  int32_t delivered_ = 0;
+
+  // The samples before it are processed. buffer_ may keep older samples
+  // for the queued segments.
+  int32_t head_ = 0;
+
   float new_min_silence_duration_s_ = 0.1;
   float new_threshold_ = 1.10;
 
@@ -185,12 +593,106 @@ VoiceActivityDetector::VoiceActivityDetector(
     : impl_(std::make_unique<Impl>(mgr, config, buffer_size_in_seconds)) {}
 #endif
 
+VoiceActivityDetector::VoiceActivityDetector(
+    const SileroVadModelConfig &config, std::shared_ptr<SileroVadModel> model,
+    float buffer_size_in_seconds /*= 60*/)
+    : impl_(std::make_unique<Impl>(config, std::move(model),
+                                   buffer_size_in_seconds)) {}
+
 VoiceActivityDetector::~VoiceActivityDetector() = default;
 
 void VoiceActivityDetector::AcceptWaveform(const float *samples, int32_t n) {
   impl_->AcceptWaveform(samples, n);
 }
 
+void VoiceActivityDetector::AcceptWaveformInt16(const int16_t *samples,
+                                                int32_t n) {
+  impl_->AcceptWaveformInt16(samples, n);
+}
+
+void VoiceActivityDetector::AcceptFile(const float *samples, int32_t n) {
+  impl_->AcceptFile(samples, n);
+}
+
+void VoiceActivityDetector::AcceptWaveforms(VoiceActivityDetector **vads,
+                                            const float *const *samples,
+                                            const int32_t *n,
+                                            int32_t num_vads) {
+  std::vector<int32_t> num_windows(num_vads);
+  int32_t max_num_windows = 0;
+  for (int32_t i = 0; i != num_vads; ++i) {
+    Impl *impl = vads[i]->impl_.get();
+    impl->Append(samples[i], n[i]);
+    num_windows[i] = impl->NumPendingWindows();
+    max_num_windows = std::max(max_num_windows, num_windows[i]);
+  }
+
+  // probs[i][j] is the speech probability of the j-th window of vads[i]
+  std::vector<std::vector<float>> probs(num_vads);
+  for (int32_t i = 0; i != num_vads; ++i) {
+    probs[i].resize(num_windows[i]);
+  }
+
+  // Detectors are grouped by their models. Usually all of them share one.
+  struct Group {
+    const SileroVadModel *model;
+    std::vector<SileroVadStream *> streams;
+    std::vector<const float *> windows;
+    std::vector<int32_t> indexes;
+    std::vector<float> probs;
+  };
+  std::vector<Group> groups;
+
+  // The states of a stream depend on its previous window, so the j-th
+  // windows of all detectors form one batch
+  for (int32_t j = 0; j != max_num_windows; ++j) {
+    for (auto &g : groups) {
+      g.streams.clear();
+      g.windows.clear();
+      g.indexes.clear();
+    }
+
+    for (int32_t i = 0; i != num_vads; ++i) {
+      if (j >= num_windows[i]) continue;
+
+      Impl *impl = vads[i]->impl_.get();
+      const float *window = impl->PendingWindow(j);
+      if (impl->SkipWindow(window)) {
+        probs[i][j] = 0;
+        continue;
+      }
+
+      const SileroVadModel *model = impl->GetModel().get();
+
+      auto it =
+          std::find_if(groups.begin(), groups.end(),
+                       [model](const Group &g) { return g.model == model; });
+      if (it == groups.end()) {
+        groups.push_back({model});
+        it = groups.end() - 1;
+      }
+
+      it->streams.push_back(impl->GetStream());
+      it->windows.push_back(window);
+      it->indexes.push_back(i);
+    }
+
+    for (auto &g : groups) {
+      int32_t n = g.streams.size();
+      g.probs.resize(n);
+      g.model->Compute(g.streams.data(), g.windows.data(), n, g.probs.data());
+
+      for (int32_t k = 0; k != n; ++k) {
+        probs[g.indexes[k]][j] = g.probs[k];
+      }
+    }
+  }
+
+  for (int32_t i = 0; i != num_vads; ++i) {
+    vads[i]->impl_->ProcessPendingWindows(probs[i].data(), num_windows[i]);
+  }
+}
+
 bool VoiceActivityDetector::Empty() const { return impl_->Empty(); }
 
 void VoiceActivityDetector::Pop() { impl_->Pop(); }
@@ -201,6 +703,14 @@ const SpeechSegment &VoiceActivityDetector::Front() const {
   return impl_->Front();
 }
 
+SpeechSegmentView VoiceActivityDetector::FrontView() const {
+  return impl_->FrontView();
+}
+
+void VoiceActivityDetector::SetCallbacks(VadCallbacks callbacks) {
+  impl_->SetCallbacks(std::move(callbacks));
+}
+
 void VoiceActivityDetector::Reset() const { impl_->Reset(); }
 
 void VoiceActivityDetector::Flush() const { impl_->Flush(); }
@@ -213,4 +723,12 @@ const SileroVadModelConfig &VoiceActivityDetector::GetConfig() const {
   return impl_->GetConfig();
 }
 
+std::size_t VoiceActivityDetector::NumBytes() const {
+  return impl_->NumBytes();
+}
+
+std::shared_ptr<SileroVadModel> VoiceActivityDetector::GetSharedModel() const {
+  return impl_->GetModel();
+}
+
 }  // namespace sherpa_ncnn
@@ -18,6 +18,9 @@
 #ifndef SHERPA_NCNN_CSRC_VOICE_ACTIVITY_DETECTOR_H_
 #define SHERPA_NCNN_CSRC_VOICE_ACTIVITY_DETECTOR_H_
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <vector>
 
@@ -26,7 +29,9 @@
 #include "android/asset_manager_jni.h"
 #endif
 
+#include "sherpa-ncnn/csrc/circular-buffer.h"
 #include "sherpa-ncnn/csrc/silero-vad-model-config.h"
+#include "sherpa-ncnn/csrc/silero-vad-model.h"
 
 namespace sherpa_ncnn {
 
@@ -35,6 +40,44 @@ struct SpeechSegment {
   std::vector<float> samples;
 };
 
+// Same as SpeechSegment but the samples are not copied, see
+// VoiceActivityDetector::FrontView()
+struct SpeechSegmentView {
+  int32_t start;  // in samples
+  CircularBufferView samples;
+};
+
+// Events of VoiceActivityDetector::SetCallbacks(). They are invoked from
+// AcceptWaveform(), AcceptWaveformInt16(), AcceptWaveforms() and Flush() on
+// the calling thread. Any of them may be empty.
+//
+// For each segment, on_speech_start is followed by zero or more
+// on_speech_samples and one on_speech_end. The samples passed to
+// on_speech_samples are those of SpeechSegment::samples, in order, so
+// downstream processing of a segment can start with its first samples.
+// They lag the input by min_silence_duration since the end of a segment is
+// at most that far behind the latest samples.
+struct VadCallbacks {
+  // @param start The start of the segment in samples
+  std::function<void(int32_t start)> on_speech_start;
+
+  // @param samples The next samples of the current segment. The view is
+  //                valid only during the call.
+  std::function<void(const CircularBufferView &samples)> on_speech_samples;
+
+  // @param start The start of the segment in samples
+  // @param n The number of samples of the segment
+  std::function<void(int32_t start, int32_t n)> on_speech_end;
+
+  // Invoked for every window with its speech probability, e.g., for
+  // Stream::AcceptSpeechProbability(). Unlike the callbacks above, it does
+  // not stop segments from being queued.
+  //
+  // @param prob The speech probability of the window
+  // @param n The window shift in samples
+  std::function<void(float prob, int32_t n)> on_speech_probability;
+};
+
 class VoiceActivityDetector {
  public:
   explicit VoiceActivityDetector(const SileroVadModelConfig &config,
@@ -45,14 +88,78 @@ class VoiceActivityDetector {
                         float buffer_size_in_seconds = 60);
 #endif
 
+  /** Create a detector that uses an existing model instead of loading it
+   * again, e.g., one detector per call for many concurrent calls. A
+   * detector then owns only a small SileroVadStream and its buffers.
+   *
+   * @param config  The thresholds and durations of the new detector. The
+   *                window size and the sample rate must match the model.
+   *                model_dir is not used.
+   * @param model  It is kept alive until all detectors that use it are
+   *               destroyed, see also GetSharedModel().
+   */
+  VoiceActivityDetector(const SileroVadModelConfig &config,
+                        std::shared_ptr<SileroVadModel> model,
+                        float buffer_size_in_seconds = 60);
+
   ~VoiceActivityDetector();
 
   void AcceptWaveform(const float *samples, int32_t n);
+
+  // Same as AcceptWaveform() but for 16-bit PCM samples, which are scaled
+  // by 1/32768
+  void AcceptWaveformInt16(const int16_t *samples, int32_t n);
+
+  /** Accept samples for many detectors at once.
+   *
+   * It has the same effect as calling vads[i]->AcceptWaveform(samples[i],
+   * n[i]) for each i, but the model runs on the pending windows of all
+   * detectors together: the j-th windows of all detectors that share a
+   * model are passed to one SileroVadModel::Compute() call, which spreads
+   * them over the worker threads, and the probabilities are then applied
+   * to the state machine of each detector in order.
+   *
+   * @param vads  Pointer to an array of num_vads distinct detectors.
+   * @param samples  samples[i] is for vads[i]. It may be null if n[i] is 0.
+   * @param n  n[i] is the number of samples in samples[i].
+   * @param num_vads  Number of detectors.
+   */
+  static void AcceptWaveforms(VoiceActivityDetector **vads,
+                              const float *const *samples, const int32_t *n,
+                              int32_t num_vads);
+
+  /** Detect the speech of a whole file, e.g., before offline recognition.
+   *
+   * It is the same as calling AcceptWaveform() window by window and then
+   * Flush(), except that the model runs on up to num_threads parts of the
+   * file in parallel, see SileroVadModelConfig. Since the model is
+   * recurrent, each part after the first starts file_warm_up seconds
+   * earlier from reset states, so the probabilities near the start of a
+   * part may differ slightly. The segments are then found in one pass over
+   * all probabilities, so a segment can span several parts.
+   *
+   * Short files are processed in one part.
+   */
+  void AcceptFile(const float *samples, int32_t n);
   bool Empty() const;
   void Pop();
   void Clear();
+
+  // The samples are copied on the first call for a segment. Prefer
+  // FrontView() for long segments.
   const SpeechSegment &Front() const;
 
+  // Return the first segment without copying its samples. The samples stay
+  // in the internal buffer until the segment is popped. The view is valid
+  // until samples are accepted again or until Pop(), Clear() or Reset(),
+  // e.g., it can be passed to OfflineStream::AcceptWaveform() before Pop().
+  SpeechSegmentView FrontView() const;
+
+  // Report segments as they are detected instead of queuing them. If any
+  // callback other than on_speech_probability is set, segments are no
+  // longer queued, i.e., Empty() is true. Call it before accepting samples.
+  void SetCallbacks(VadCallbacks callbacks);
+
   bool IsSpeechDetected() const;
 
   void Reset() const;
@@ -63,6 +170,14 @@ class VoiceActivityDetector {
 
   const SileroVadModelConfig &GetConfig() const;
 
+  // Return the bytes of the samples held by this detector: its circular
+  // buffer, which grows for long segments, and the copy made by Front()
+  std::size_t NumBytes() const;
+
+  // Return the model so that it can be passed to the constructor of
+  // another detector
+  std::shared_ptr<SileroVadModel> GetSharedModel() const;
+
  private:
   class Impl;
   std::unique_ptr<Impl> impl_;
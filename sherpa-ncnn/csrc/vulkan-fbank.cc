@@ -0,0 +1,244 @@
+// sherpa-ncnn/csrc/vulkan-fbank.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/vulkan-fbank.h"
+
+#if NCNN_VULKAN
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <mutex>  // NOLINT
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "command.h"  // NOLINT
+#include "sherpa-ncnn/csrc/batch-fbank.h"
+#include "sherpa-ncnn/csrc/vulkan-pipeline.h"
+
+namespace sherpa_ncnn {
+
+// A workgroup computes one frame. N is the padded window size, M = N / 2
+// is the number of bins of the power spectrum that the mel banks use, and
+// NUM_BINS is the number of mel bins. They are filled in by Init().
+static const char kFbankShader[] = R"(
+#version 450
+
+#define N %d
+#define M %d
+#define NUM_BINS %d
+
+layout (binding = 0) readonly buffer windows { float windows_data[]; };
+layout (binding = 1) readonly buffer twiddles { float twiddles_data[]; };
+layout (binding = 2) readonly buffer mel_offset { int mel_offset_data[]; };
+layout (binding = 3) readonly buffer mel_begin { int mel_begin_data[]; };
+layout (binding = 4) readonly buffer mel_weights { float mel_weights_data[]; };
+layout (binding = 5) writeonly buffer features { float features_data[]; };
+
+layout (push_constant) uniform parameter
+{
+    int num_frames;
+} p;
+
+shared float x[N];
+shared float tw_cos[N];
+shared float tw_sin[N];
+shared float power[M];
+
+void main()
+{
+    int frame = int(gl_WorkGroupID.y);
+    int tid = int(gl_LocalInvocationID.x);
+    int size = int(gl_WorkGroupSize.x);
+
+    // The same for the whole workgroup, so no invocation misses a barrier
+    if (frame >= p.num_frames)
+        return;
+
+    for (int i = tid; i < N; i += size)
+    {
+        x[i] = windows_data[frame * N + i];
+        tw_cos[i] = twiddles_data[i];
+        tw_sin[i] = twiddles_data[N + i];
+    }
+
+    barrier();
+
+    // |X[k]|^2 with X[k] = sum_n x[n] exp(-2 pi i k n / N)
+    for (int k = tid; k < M; k += size)
+    {
+        float re = 0.f;
+        float im = 0.f;
+        for (int n = 0; n < N; n++)
+        {
+            int j = (k * n) & (N - 1);
+            re += x[n] * tw_cos[j];
+            im -= x[n] * tw_sin[j];
+        }
+
+        power[k] = re * re + im * im;
+    }
+
+    barrier();
+
+    for (int b = tid; b < NUM_BINS; b += size)
+    {
+        int begin = mel_begin_data[b];
+        int end = mel_begin_data[b + 1];
+        int offset = mel_offset_data[b] - begin;
+
+        float sum = 0.f;
+        for (int i = begin; i < end; i++)
+        {
+            sum += mel_weights_data[i] * power[offset + i];
+        }
+
+        // FLT_EPSILON
+        features_data[frame * NUM_BINS + b] = log(max(sum, 1.1920929e-07));
+    }
+}
+)";
+
+const VulkanFbank *VulkanFbank::Get(const BatchFbank &fbank) {
+  static std::mutex mutex;
+
+  // Never destroyed, since ncnn may destroy the GPU instance before
+  // static objects are destroyed
+  static auto *cache = new std::unordered_map<std::string, VulkanFbank *>;
+
+  std::string key = fbank.GetOptions().ToString();
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = cache->find(key);
+  if (it != cache->end()) {
+    return it->second;
+  }
+
+  VulkanFbank *ans = nullptr;
+  if (ncnn::get_gpu_count() > 0) {
+    ans = new VulkanFbank(
+        ncnn::get_gpu_device(ncnn::get_default_gpu_index()), fbank);
+    if (!ans->Init(fbank)) {
+      delete ans;
+      ans = nullptr;
+    }
+  }
+
+  if (!ans) {
+    NCNN_LOGE("Failed to create the Vulkan fbank. Use the CPU instead");
+  }
+
+  // A failure is cached as well, so it is reported only once
+  (*cache)[key] = ans;
+
+  return ans;
+}
+
+VulkanFbank::VulkanFbank(const ncnn::VulkanDevice *vkdev,
+                         const BatchFbank &fbank)
+    : vkdev_(vkdev),
+      window_size_(fbank.PaddedWindowSize()),
+      num_bins_(fbank.Dim()) {
+  // The shader reads and writes fp32 rows as they are
+  opt_.use_vulkan_compute = true;
+  opt_.use_fp16_packed = false;
+  opt_.use_fp16_storage = false;
+  opt_.use_fp16_arithmetic = false;
+  opt_.use_int8_storage = false;
+  opt_.use_packing_layout = false;
+}
+
+VulkanFbank::~VulkanFbank() = default;
+
+bool VulkanFbank::Init(const BatchFbank &fbank) {
+  int32_t n = window_size_;
+  int32_t m = fbank.half_size_;
+
+  std::vector<char> shader(sizeof(kFbankShader) + 64);
+  snprintf(shader.data(), shader.size(), kFbankShader, n, m, num_bins_);
+
+  pipeline_.reset(CreateVulkanPipeline(vkdev_, shader.data(), opt_, 64, 1, 1));
+  if (!pipeline_) {
+    return false;
+  }
+
+  std::vector<float> twiddles(2 * n);
+  for (int32_t k = 0; k != n; ++k) {
+    double a = 2 * M_PI * k / n;
+    twiddles[k] = std::cos(a);
+    twiddles[n + k] = std::sin(a);
+  }
+
+  weight_vkallocator_ = std::make_unique<ncnn::VkWeightAllocator>(vkdev_);
+  ncnn::VkWeightStagingAllocator staging_vkallocator(vkdev_);
+
+  ncnn::Option opt = opt_;
+  opt.blob_vkallocator = weight_vkallocator_.get();
+  opt.staging_vkallocator = &staging_vkallocator;
+
+  // Mat does not copy the data, which outlives submit_and_wait()
+  auto *offset = const_cast<int32_t *>(fbank.mel_offset_.data());
+  auto *begin = const_cast<int32_t *>(fbank.mel_begin_.data());
+  auto *weights = const_cast<float *>(fbank.mel_weights_.data());
+
+  ncnn::VkCompute cmd(vkdev_);
+  cmd.record_upload(ncnn::Mat(2 * n, twiddles.data()), twiddles_, opt);
+  cmd.record_upload(ncnn::Mat(num_bins_, offset), mel_offset_, opt);
+  cmd.record_upload(ncnn::Mat(num_bins_ + 1, begin), mel_begin_, opt);
+  cmd.record_upload(
+      ncnn::Mat(static_cast<int32_t>(fbank.mel_weights_.size()), weights),
+      mel_weights_, opt);
+
+  return cmd.submit_and_wait() == 0;
+}
+
+void VulkanFbank::Compute(const float *windows, int32_t num_frames,
+                          float *features) const {
+  ncnn::VkAllocator *blob_vkallocator = vkdev_->acquire_blob_allocator();
+  ncnn::VkAllocator *staging_vkallocator = vkdev_->acquire_staging_allocator();
+
+  ncnn::Option opt = opt_;
+  opt.blob_vkallocator = blob_vkallocator;
+  opt.workspace_vkallocator = blob_vkallocator;
+  opt.staging_vkallocator = staging_vkallocator;
+
+  ncnn::Mat out;
+  {
+    ncnn::VkCompute cmd(vkdev_);
+
+    ncnn::VkMat in;
+    cmd.record_upload(
+        ncnn::Mat(window_size_, num_frames, const_cast<float *>(windows)), in,
+        opt);
+
+    ncnn::VkMat out_gpu;
+    out_gpu.create(num_bins_, num_frames, 4u, 1, blob_vkallocator);
+
+    std::vector<ncnn::VkMat> bindings = {in,         twiddles_,    mel_offset_,
+                                         mel_begin_, mel_weights_, out_gpu};
+
+    std::vector<ncnn::vk_constant_type> constants(1);
+    constants[0].i = num_frames;
+
+    // One workgroup per frame
+    ncnn::VkMat dispatcher;
+    dispatcher.w = pipeline_->local_size_x;
+    dispatcher.h = num_frames;
+    dispatcher.c = 1;
+
+    cmd.record_pipeline(pipeline_.get(), bindings, constants, dispatcher);
+    cmd.record_download(out_gpu, out, opt);
+    cmd.submit_and_wait();
+  }
+
+  vkdev_->reclaim_blob_allocator(blob_vkallocator);
+  vkdev_->reclaim_staging_allocator(staging_vkallocator);
+
+  const float *p = out;
+  std::copy(p, p + num_frames * num_bins_, features);
+}
+
+}  // namespace sherpa_ncnn
+
+#endif  // NCNN_VULKAN
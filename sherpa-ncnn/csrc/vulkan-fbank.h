@@ -0,0 +1,82 @@
+// sherpa-ncnn/csrc/vulkan-fbank.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_VULKAN_FBANK_H_
+#define SHERPA_NCNN_CSRC_VULKAN_FBANK_H_
+
+#include "platform.h"  // NOLINT
+
+#if NCNN_VULKAN
+#include <cstdint>
+#include <memory>
+
+#include "gpu.h"       // NOLINT
+#include "mat.h"       // NOLINT
+#include "option.h"    // NOLINT
+#include "pipeline.h"  // NOLINT
+
+namespace sherpa_ncnn {
+
+class BatchFbank;
+
+/** Compute the features of a BatchFbank on a GPU with Vulkan.
+ *
+ * The windows of all frames passed to Compute(), e.g., the pending frames
+ * of every stream of a batch, are uploaded at once and processed in one
+ * dispatch with a workgroup per frame: the power spectrum of the window
+ * is computed as a DFT in shared memory, followed by the mel projection
+ * and the log. It is meant for servers that decode many streams on a GPU,
+ * where computing the fbank of a batch on the CPU is the bottleneck.
+ *
+ * Windows are still extracted on the CPU, see BatchFbank::ExtractWindow(),
+ * and the features are downloaded, since streams keep them on the host.
+ */
+class VulkanFbank {
+ public:
+  /** Return the object for the options of fbank on the default GPU. It is
+   * created on the first call and shared by all BatchFbank objects with
+   * the same options. It is never destroyed.
+   *
+   * @return Return nullptr if there is no GPU or the shader cannot be
+   *         created.
+   */
+  static const VulkanFbank *Get(const BatchFbank &fbank);
+
+  ~VulkanFbank();
+
+  VulkanFbank(const VulkanFbank &) = delete;
+  VulkanFbank &operator=(const VulkanFbank &) = delete;
+
+  // Same as BatchFbank::Compute(). It is thread-safe.
+  void Compute(const float *windows, int32_t num_frames,
+               float *features) const;
+
+ private:
+  VulkanFbank(const ncnn::VulkanDevice *vkdev, const BatchFbank &fbank);
+
+  // Return false on error
+  bool Init(const BatchFbank &fbank);
+
+ private:
+  const ncnn::VulkanDevice *vkdev_;
+  ncnn::Option opt_;
+
+  int32_t window_size_ = 0;
+  int32_t num_bins_ = 0;
+
+  std::unique_ptr<ncnn::Pipeline> pipeline_;
+
+  // The tables of the shader, uploaded once
+  std::unique_ptr<ncnn::VkAllocator> weight_vkallocator_;
+  ncnn::VkMat twiddles_;    // cos and then sin of 2 pi k / window_size_
+  ncnn::VkMat mel_offset_;  // int32, see BatchFbank
+  ncnn::VkMat mel_begin_;   // int32
+  ncnn::VkMat mel_weights_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // NCNN_VULKAN
+
+#endif  // SHERPA_NCNN_CSRC_VULKAN_FBANK_H_
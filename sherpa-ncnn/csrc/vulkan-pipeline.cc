@@ -0,0 +1,38 @@
+// sherpa-ncnn/csrc/vulkan-pipeline.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/vulkan-pipeline.h"
+
+#if NCNN_VULKAN
+#include <vector>
+
+namespace sherpa_ncnn {
+
+ncnn::Pipeline *CreateVulkanPipeline(const ncnn::VulkanDevice *vkdev,
+                                     const char *shader,
+                                     const ncnn::Option &opt, int32_t local_x,
+                                     int32_t local_y, int32_t local_z) {
+  std::vector<uint32_t> spirv;
+  if (ncnn::compile_spirv_module(shader, opt, spirv) != 0) {
+    NCNN_LOGE("Failed to compile the shader of a custom layer");
+    return nullptr;
+  }
+
+  auto *pipeline = new ncnn::Pipeline(vkdev);
+  pipeline->set_optimal_local_size_xyz(local_x, local_y, local_z);
+
+  std::vector<ncnn::vk_specialization_type> specializations;
+  if (pipeline->create(spirv.data(), spirv.size() * sizeof(uint32_t),
+                       specializations) != 0) {
+    NCNN_LOGE("Failed to create the pipeline of a custom layer");
+    delete pipeline;
+    return nullptr;
+  }
+
+  return pipeline;
+}
+
+}  // namespace sherpa_ncnn
+
+#endif  // NCNN_VULKAN
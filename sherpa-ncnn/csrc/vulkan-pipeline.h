@@ -0,0 +1,34 @@
+// sherpa-ncnn/csrc/vulkan-pipeline.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_VULKAN_PIPELINE_H_
+#define SHERPA_NCNN_CSRC_VULKAN_PIPELINE_H_
+
+#include "platform.h"  // NOLINT
+
+#if NCNN_VULKAN
+#include "gpu.h"       // NOLINT
+#include "option.h"    // NOLINT
+#include "pipeline.h"  // NOLINT
+
+namespace sherpa_ncnn {
+
+/** Compile the compute shader of a custom layer and create its pipeline.
+ *
+ * The shader is compiled with ncnn::compile_spirv_module(), so it can use
+ * the macros of ncnn for the storage type of the blobs, e.g., sfp, afp,
+ * buffer_ld1() and buffer_st1(), and works with and without fp16 storage.
+ *
+ * @return Return nullptr on error. Otherwise, the caller owns the pipeline.
+ */
+ncnn::Pipeline *CreateVulkanPipeline(const ncnn::VulkanDevice *vkdev,
+                                     const char *shader,
+                                     const ncnn::Option &opt, int32_t local_x,
+                                     int32_t local_y, int32_t local_z);
+
+}  // namespace sherpa_ncnn
+
+#endif  // NCNN_VULKAN
+
+#endif  // SHERPA_NCNN_CSRC_VULKAN_PIPELINE_H_
@@ -18,13 +18,16 @@
 
 #include "sherpa-ncnn/csrc/wave-reader.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <utility>
 #include <vector>
 
 #include "platform.h"  // NOLINT
+#include "sherpa-ncnn/csrc/mapped-file.h"
 
 namespace sherpa_ncnn {
 namespace {
@@ -320,6 +323,35 @@ std::vector<float> ReadWaveImpl(std::istream &is, int32_t *sampling_rate,
   return ans;
 }
 
+template <typename T>
+T Load(const unsigned char *p) {
+  T ans;
+  std::memcpy(&ans, p, sizeof(T));
+  return ans;
+}
+
+// Average n frames of num_channels samples each that start at p. Each
+// sample has num_bytes bytes and is converted to float by to_float.
+template <typename ToFloat>
+void Downmix(const unsigned char *p, int32_t n, int32_t num_channels,
+             int32_t num_bytes, ToFloat to_float, float *samples) {
+  if (num_channels == 1) {
+    for (int32_t i = 0; i != n; ++i, p += num_bytes) {
+      samples[i] = to_float(p);
+    }
+    return;
+  }
+
+  float scale = 1.0f / num_channels;
+  for (int32_t i = 0; i != n; ++i) {
+    float sum = 0;
+    for (int32_t c = 0; c != num_channels; ++c, p += num_bytes) {
+      sum += to_float(p);
+    }
+    samples[i] = sum * scale;
+  }
+}
+
 }  // namespace
 
 std::vector<float> ReadWave(const std::string &filename, int32_t *sampling_rate,
@@ -360,4 +392,191 @@ std::vector<float> ReadWave(std::istream &is, int32_t expected_sampling_rate,
   return samples;
 }
 
+std::unique_ptr<WaveFileReader> WaveFileReader::Open(
+    const std::string &filename) {
+  auto file = MappedFile::Open(filename);
+  if (!file) {
+    NCNN_LOGE("Failed to map %s", filename.c_str());
+    return nullptr;
+  }
+
+  std::unique_ptr<WaveFileReader> ans(new WaveFileReader);
+  if (!ans->Init(file->Data(), file->Size())) {
+    NCNN_LOGE("Failed to read %s", filename.c_str());
+    return nullptr;
+  }
+  ans->file_ = std::move(file);
+
+  return ans;
+}
+
+std::unique_ptr<WaveFileReader> WaveFileReader::Open(const void *data,
+                                                     std::size_t size) {
+  std::unique_ptr<WaveFileReader> ans(new WaveFileReader);
+  if (!ans->Init(static_cast<const unsigned char *>(data), size)) {
+    return nullptr;
+  }
+
+  return ans;
+}
+
+WaveFileReader::~WaveFileReader() = default;
+
+bool WaveFileReader::Init(const unsigned char *data, std::size_t size) {
+  //                                          F F I R
+  if (size < 12 || Load<uint32_t>(data) != 0x46464952) {
+    NCNN_LOGE("Expected chunk_id RIFF");
+    return false;
+  }
+
+  //                               E V A W
+  if (Load<uint32_t>(data + 8) != 0x45564157) {
+    NCNN_LOGE("Expected format WAVE");
+    return false;
+  }
+
+  bool has_fmt = false;
+  int32_t block_align = 0;
+  const unsigned char *samples = nullptr;
+  uint64_t num_bytes = 0;
+
+  // Visit the chunks until the data chunk. Unknown chunks are skipped.
+  uint64_t offset = 12;
+  while (offset + 8 <= size) {
+    uint32_t id = Load<uint32_t>(data + offset);
+    uint32_t chunk_size = Load<uint32_t>(data + offset + 4);
+    const unsigned char *p = data + offset + 8;
+    uint64_t remaining = size - offset - 8;
+
+    if (id == 0x20746d66) {  // fmt
+      if (chunk_size < 16 || chunk_size > remaining) {
+        NCNN_LOGE("Invalid fmt chunk size: %u", chunk_size);
+        return false;
+      }
+
+      audio_format_ = Load<uint16_t>(p);
+      num_channels_ = Load<uint16_t>(p + 2);
+      sample_rate_ = Load<uint32_t>(p + 4);
+      block_align = Load<uint16_t>(p + 12);
+      bits_per_sample_ = Load<uint16_t>(p + 14);
+
+      // WAVE_FORMAT_EXTENSIBLE. The first 2 bytes of the sub format GUID
+      // are the actual format.
+      if (audio_format_ == 0xfffe && chunk_size >= 40) {
+        audio_format_ = Load<uint16_t>(p + 24);
+      }
+
+      has_fmt = true;
+    } else if (id == 0x61746164) {  // data
+      samples = p;
+
+      // Files that are written while recording may have a size of 0 or
+      // 0xffffffff, and truncated files have less data. Use what is there.
+      num_bytes = std::min<uint64_t>(chunk_size, remaining);
+      if (chunk_size == 0 || chunk_size == 0xffffffff) {
+        num_bytes = remaining;
+      }
+      break;
+    }
+
+    // Chunks are padded to an even size
+    offset += 8 + static_cast<uint64_t>(chunk_size) + (chunk_size & 1);
+  }
+
+  if (!has_fmt || !samples) {
+    NCNN_LOGE("No %s chunk is found", has_fmt ? "data" : "fmt");
+    return false;
+  }
+
+  bool is_int = audio_format_ == 1 &&
+                (bits_per_sample_ == 8 || bits_per_sample_ == 16 ||
+                 bits_per_sample_ == 24 || bits_per_sample_ == 32);
+  bool is_float = audio_format_ == 3 &&
+                  (bits_per_sample_ == 32 || bits_per_sample_ == 64);
+  if (!is_int && !is_float) {
+    NCNN_LOGE(
+        "Unsupported %d bits per sample and audio format: %d. Supported "
+        "values are 8, 16, 24, 32 for format 1 and 32, 64 for format 3",
+        bits_per_sample_, audio_format_);
+    return false;
+  }
+
+  if (num_channels_ < 1 || sample_rate_ < 1) {
+    NCNN_LOGE("Invalid number of channels %d or sample rate %d",
+              num_channels_, sample_rate_);
+    return false;
+  }
+
+  if (block_align != num_channels_ * bits_per_sample_ / 8) {
+    NCNN_LOGE("Incorrect block align: %d. Expected: %d", block_align,
+              num_channels_ * bits_per_sample_ / 8);
+    return false;
+  }
+
+  data_ = samples;
+  num_frames_ = num_bytes / block_align;
+  pos_ = 0;
+
+  return true;
+}
+
+void WaveFileReader::Seek(int64_t frame) {
+  pos_ = std::max<int64_t>(0, std::min(frame, num_frames_));
+}
+
+int32_t WaveFileReader::Read(float *samples, int32_t n) {
+  n = static_cast<int32_t>(
+      std::min<int64_t>(std::max(n, 0), num_frames_ - pos_));
+  if (n == 0) {
+    return 0;
+  }
+
+  int32_t num_bytes = bits_per_sample_ / 8;
+  const unsigned char *p = data_ + pos_ * num_channels_ * num_bytes;
+
+  if (audio_format_ == 3 && bits_per_sample_ == 32) {
+    Downmix(
+        p, n, num_channels_, num_bytes,
+        [](const unsigned char *p) { return Load<float>(p); }, samples);
+  } else if (audio_format_ == 3) {
+    Downmix(
+        p, n, num_channels_, num_bytes,
+        [](const unsigned char *p) {
+          return static_cast<float>(Load<double>(p));
+        },
+        samples);
+  } else if (bits_per_sample_ == 16) {
+    Downmix(
+        p, n, num_channels_, num_bytes,
+        [](const unsigned char *p) { return Load<int16_t>(p) / 32768.0f; },
+        samples);
+  } else if (bits_per_sample_ == 24) {
+    Downmix(
+        p, n, num_channels_, num_bytes,
+        [](const unsigned char *p) {
+          // The most significant byte carries the sign
+          int32_t v =
+              p[0] | (p[1] << 8) | (static_cast<int8_t>(p[2]) * 65536);
+          return v / 8388608.0f;
+        },
+        samples);
+  } else if (bits_per_sample_ == 32) {
+    Downmix(
+        p, n, num_channels_, num_bytes,
+        [](const unsigned char *p) {
+          return Load<int32_t>(p) / 2147483648.0f;
+        },
+        samples);
+  } else {
+    // 8-bit samples are unsigned
+    Downmix(
+        p, n, num_channels_, num_bytes,
+        [](const unsigned char *p) { return p[0] / 128.0f - 1; }, samples);
+  }
+
+  pos_ += n;
+
+  return n;
+}
+
 }  // namespace sherpa_ncnn
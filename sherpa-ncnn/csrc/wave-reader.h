@@ -18,7 +18,10 @@
 #ifndef SHERPA_NCNN_CSRC_WAVE_READER_H_
 #define SHERPA_NCNN_CSRC_WAVE_READER_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <istream>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -45,6 +48,96 @@ std::vector<float> ReadWave(const std::string &filename,
 std::vector<float> ReadWave(std::istream &is, int32_t expected_sampling_rate,
                             bool *is_ok);
 
+class MappedFile;
+
+/** Read a wave file block by block instead of all at once.
+ *
+ * A file is memory-mapped, so opening it reads only the header and
+ * memory does not grow with the length of the file. Samples are converted
+ * to float and downmixed to mono, i.e., averaged over the channels, as
+ * they are read, so the blocks can be passed to Stream::AcceptWaveform()
+ * or OfflineStream::AcceptWaveform() directly:
+ *
+ *   auto reader = WaveFileReader::Open(filename);
+ *   std::vector<float> block(reader->SampleRate() / 10);
+ *   int32_t n;
+ *   while ((n = reader->Read(block.data(), block.size())) > 0) {
+ *     s->AcceptWaveform(reader->SampleRate(), block.data(), n);
+ *   }
+ *
+ * Supported encodings are 8/16/24/32-bit integer and 32/64-bit float PCM
+ * with any number of channels, including WAVE_FORMAT_EXTENSIBLE files.
+ * Like ReadWave(), it assumes a little endian host.
+ */
+class WaveFileReader {
+ public:
+  // Return nullptr if the file cannot be mapped or is not a supported
+  // wave file
+  static std::unique_ptr<WaveFileReader> Open(const std::string &filename);
+
+  // Same as the above one, but for a wave file in memory, e.g., an Android
+  // asset. data must outlive the reader.
+  static std::unique_ptr<WaveFileReader> Open(const void *data,
+                                              std::size_t size);
+
+  ~WaveFileReader();
+
+  WaveFileReader(const WaveFileReader &) = delete;
+  WaveFileReader &operator=(const WaveFileReader &) = delete;
+
+  int32_t SampleRate() const { return sample_rate_; }
+
+  int32_t NumChannels() const { return num_channels_; }
+
+  int32_t BitsPerSample() const { return bits_per_sample_; }
+
+  // Number of samples per channel
+  int64_t NumFrames() const { return num_frames_; }
+
+  float Duration() const {
+    return static_cast<float>(num_frames_) / sample_rate_;
+  }
+
+  // Index of the frame that the next Read() starts at
+  int64_t Tell() const { return pos_; }
+
+  // Continue reading at the given frame. It is clamped to the file.
+  void Seek(int64_t frame);
+
+  /** Read the next frames.
+   *
+   * @param samples On return, it contains the frames downmixed to mono and
+   *                normalized to [-1, 1].
+   * @param n  The maximum number of frames to read.
+   *
+   * @return Return the number of frames read. It is 0 at the end of the
+   *         file.
+   */
+  int32_t Read(float *samples, int32_t n);
+
+ private:
+  WaveFileReader() = default;
+
+  // Parse the header of the wave file in [data, data + size)
+  bool Init(const unsigned char *data, std::size_t size);
+
+ private:
+  std::unique_ptr<MappedFile> file_;
+
+  // Start of the samples
+  const unsigned char *data_ = nullptr;
+
+  int64_t num_frames_ = 0;
+  int64_t pos_ = 0;
+
+  int32_t sample_rate_ = 0;
+  int32_t num_channels_ = 0;
+  int32_t bits_per_sample_ = 0;
+
+  // 1 for integer PCM and 3 for floating point PCM
+  int32_t audio_format_ = 0;
+};
+
 }  // namespace sherpa_ncnn
 
 #endif  // SHERPA_NCNN_CSRC_WAVE_READER_H_
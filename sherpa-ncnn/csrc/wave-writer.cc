@@ -22,6 +22,7 @@
 #include <vector>
 
 #include "platform.h"  //NOLINT
+#include "sherpa-ncnn/csrc/pcm-utils.h"
 
 namespace sherpa_ncnn {
 namespace {
@@ -48,8 +49,8 @@ struct WaveHeader {
 
 }  // namespace
 
-bool WriteWave(const std::string &filename, int32_t sampling_rate,
-               const float *samples, int32_t n) {
+// Return the header of a file with n samples
+static WaveHeader MakeHeader(int32_t sampling_rate, int32_t n) {
   WaveHeader header{};
   header.chunk_id = 0x46464952;      // FFIR
   header.format = 0x45564157;        // EVAW
@@ -69,10 +70,15 @@ bool WriteWave(const std::string &filename, int32_t sampling_rate,
 
   header.chunk_size = 36 + header.subchunk2_size;
 
+  return header;
+}
+
+bool WriteWave(const std::string &filename, int32_t sampling_rate,
+               const float *samples, int32_t n) {
+  WaveHeader header = MakeHeader(sampling_rate, n);
+
   std::vector<int16_t> samples_int16(n);
-  for (int32_t i = 0; i != n; ++i) {
-    samples_int16[i] = samples[i] * 32676;
-  }
+  FloatToInt16(samples, n, samples_int16.data());
 
   std::ofstream os(filename, std::ios::binary);
   if (!os) {
@@ -92,4 +98,56 @@ bool WriteWave(const std::string &filename, int32_t sampling_rate,
   return true;
 }
 
+WaveWriter::WaveWriter(const std::string &filename, int32_t sampling_rate)
+    : filename_(filename),
+      os_(filename, std::ios::binary),
+      sampling_rate_(sampling_rate) {
+  if (!os_) {
+    NCNN_LOGE("Failed to create %s", filename.c_str());
+    return;
+  }
+
+  // The sizes are not known yet
+  WaveHeader header = MakeHeader(sampling_rate, 0);
+  os_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+}
+
+WaveWriter::~WaveWriter() { Close(); }
+
+bool WaveWriter::Write(const int16_t *samples, int32_t n) {
+  os_.write(reinterpret_cast<const char *>(samples), n * sizeof(int16_t));
+  num_samples_ += n;
+
+  return Ok();
+}
+
+bool WaveWriter::Write(const float *samples, int32_t n) {
+  buf_.resize(n);
+  FloatToInt16(samples, n, buf_.data());
+
+  return Write(buf_.data(), n);
+}
+
+bool WaveWriter::Close() {
+  if (!os_.is_open()) {
+    // Already closed, or it failed to open
+    return Ok();
+  }
+
+  if (os_) {
+    WaveHeader header = MakeHeader(sampling_rate_, num_samples_);
+    os_.seekp(0);
+    os_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  }
+
+  bool ok = Ok();
+  os_.close();
+
+  if (!ok) {
+    NCNN_LOGE("Write %s failed", filename_.c_str());
+  }
+
+  return ok;
+}
+
 }  // namespace sherpa_ncnn
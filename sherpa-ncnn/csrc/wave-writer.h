@@ -19,7 +19,9 @@
 #define SHERPA_NCNN_CSRC_WAVE_WRITER_H_
 
 #include <cstdint>
+#include <fstream>
 #include <string>
+#include <vector>
 
 namespace sherpa_ncnn {
 
@@ -35,6 +37,42 @@ namespace sherpa_ncnn {
 bool WriteWave(const std::string &filename, int32_t sampling_rate,
                const float *samples, int32_t n);
 
+// Write a single channel wave file piece by piece, e.g., while the audio is
+// being generated, so that the whole audio is never held in memory. The
+// sizes in the header are filled in by Close().
+class WaveWriter {
+ public:
+  WaveWriter(const std::string &filename, int32_t sampling_rate);
+
+  // It calls Close()
+  ~WaveWriter();
+
+  WaveWriter(const WaveWriter &) = delete;
+  WaveWriter &operator=(const WaveWriter &) = delete;
+
+  // Return false if the file cannot be written
+  bool Ok() const { return static_cast<bool>(os_); }
+
+  bool Write(const int16_t *samples, int32_t n);
+
+  // The samples are in the range [-1, 1], see WriteWave()
+  bool Write(const float *samples, int32_t n);
+
+  // Return false if any write failed
+  bool Close();
+
+  int64_t NumSamples() const { return num_samples_; }
+
+ private:
+  std::string filename_;
+  std::ofstream os_;
+  int32_t sampling_rate_;
+  int64_t num_samples_ = 0;
+
+  // Converted samples of Write(const float *, int32_t), reused across calls
+  std::vector<int16_t> buf_;
+};
+
 }  // namespace sherpa_ncnn
 
 #endif  // SHERPA_NCNN_CSRC_WAVE_WRITER_H_
@@ -4,6 +4,7 @@
 
 #include "sherpa-ncnn/csrc/zipformer-model.h"
 
+#include <cstring>
 #include <regex>  // NOLINT
 #include <string>
 #include <utility>
@@ -11,30 +12,24 @@
 
 #include "net.h"       // NOLINT
 #include "platform.h"  // NOLINT
+#if NCNN_VULKAN
+#include "command.h"     // NOLINT
+#include "gpu.h"         // NOLINT
+#include "layer_type.h"  // NOLINT
+#endif
 #include "sherpa-ncnn/csrc/meta-data.h"
 
 namespace sherpa_ncnn {
 
-ZipformerModel::ZipformerModel(const ModelConfig &config) {
+ZipformerModel::ZipformerModel(const ModelConfig &config,
+                               std::shared_ptr<const ModelBundle> bundle) {
   encoder_.opt = config.encoder_opt;
   decoder_.opt = config.decoder_opt;
   joiner_.opt = config.joiner_opt;
 
-  bool has_gpu = false;
-#if NCNN_VULKAN
-  has_gpu = ncnn::get_gpu_count() > 0;
-#endif
+  InitDevices(config);
 
-  if (has_gpu && config.use_vulkan_compute) {
-    encoder_.opt.use_vulkan_compute = true;
-    decoder_.opt.use_vulkan_compute = true;
-    joiner_.opt.use_vulkan_compute = true;
-    NCNN_LOGE("Use GPU");
-  } else {
-    // NCNN_LOGE("Don't Use GPU. has_gpu: %d, config.use_vulkan_compute: %d",
-    //           static_cast<int32_t>(has_gpu),
-    //           static_cast<int32_t>(config.use_vulkan_compute));
-  }
+  InitOptions(config, std::move(bundle));
 
   InitEncoder(config.encoder_param, config.encoder_bin);
   InitDecoder(config.decoder_param, config.decoder_bin);
@@ -43,6 +38,13 @@ ZipformerModel::ZipformerModel(const ModelConfig &config) {
   InitEncoderInputOutputIndexes();
   InitDecoderInputOutputIndexes();
   InitJoinerInputOutputIndexes();
+
+  InitEarlyExit(config.early_exit_threshold, encoder_,
+                encoder_output_indexes_.size());
+
+#if NCNN_VULKAN
+  InitVulkanStates();
+#endif
 }
 
 #if __ANDROID_API__ >= 9
@@ -51,21 +53,9 @@ ZipformerModel::ZipformerModel(AAssetManager *mgr, const ModelConfig &config) {
   decoder_.opt = config.decoder_opt;
   joiner_.opt = config.joiner_opt;
 
-  bool has_gpu = false;
-#if NCNN_VULKAN
-  has_gpu = ncnn::get_gpu_count() > 0;
-#endif
+  InitDevices(config);
 
-  if (has_gpu && config.use_vulkan_compute) {
-    encoder_.opt.use_vulkan_compute = true;
-    decoder_.opt.use_vulkan_compute = true;
-    joiner_.opt.use_vulkan_compute = true;
-    NCNN_LOGE("Use GPU");
-  } else {
-    // NCNN_LOGE("Don't Use GPU. has_gpu: %d, config.use_vulkan_compute: %d",
-    //           static_cast<int32_t>(has_gpu),
-    //           static_cast<int32_t>(config.use_vulkan_compute));
-  }
+  InitOptions(config);
 
   InitEncoder(mgr, config.encoder_param, config.encoder_bin);
   InitDecoder(mgr, config.decoder_param, config.decoder_bin);
@@ -74,18 +64,144 @@ ZipformerModel::ZipformerModel(AAssetManager *mgr, const ModelConfig &config) {
   InitEncoderInputOutputIndexes();
   InitDecoderInputOutputIndexes();
   InitJoinerInputOutputIndexes();
+
+  InitEarlyExit(config.early_exit_threshold, encoder_,
+                encoder_output_indexes_.size());
+
+#if NCNN_VULKAN
+  InitVulkanStates();
+#endif
 }
 #endif
 
+#if NCNN_VULKAN
+namespace {
+
+// The encoder states of a stream on the GPU, in the shapes of
+// ZipformerModel::GetEncoderInitStates()
+class VulkanStates : public DeviceStates {
+ public:
+  VulkanStates(const ncnn::VulkanDevice *vkdev, const ncnn::Option &opt,
+               std::shared_ptr<ncnn::VkAllocator> allocator,
+               int32_t num_states)
+      : vkdev_(vkdev),
+        opt_(opt),
+        allocator_(std::move(allocator)),
+        mats_(num_states) {}
+
+  void Download(std::vector<ncnn::Mat> *states) const override {
+    ncnn::VkAllocator *staging_vkallocator =
+        vkdev_->acquire_staging_allocator();
+
+    ncnn::Option opt = opt_;
+    opt.staging_vkallocator = staging_vkallocator;
+    opt.blob_allocator = nullptr;
+
+    std::vector<ncnn::Mat> host(mats_.size());
+    {
+      ncnn::VkCompute cmd(vkdev_);
+      for (std::size_t i = 0; i != mats_.size(); ++i) {
+        cmd.record_download(mats_[i], host[i], opt);
+      }
+      cmd.submit_and_wait();
+    }
+
+    vkdev_->reclaim_staging_allocator(staging_vkallocator);
+
+    states->resize(host.size());
+    for (std::size_t i = 0; i != host.size(); ++i) {
+      const ncnn::Mat &src = host[i];
+      ncnn::Mat &dst = (*states)[i];
+
+      bool same_shape = !dst.empty() && dst.dims == src.dims &&
+                        dst.w == src.w && dst.h == src.h && dst.d == src.d &&
+                        dst.c == src.c && dst.elemsize == src.elemsize &&
+                        dst.elempack == src.elempack && dst.cstep == src.cstep;
+
+      // Keep packed states packed, see EncoderStateLayout
+      if (same_shape && IsWritablePackedState(dst)) {
+        std::memcpy(dst.data, src.data, src.total() * src.elemsize);
+      } else {
+        dst = src;
+      }
+    }
+  }
+
+  std::vector<ncnn::VkMat> &Mats() { return mats_; }
+  const std::vector<ncnn::VkMat> &Mats() const { return mats_; }
+
+ private:
+  const ncnn::VulkanDevice *vkdev_;
+  ncnn::Option opt_;
+
+  // It must outlive mats_
+  std::shared_ptr<ncnn::VkAllocator> allocator_;
+  std::vector<ncnn::VkMat> mats_;
+};
+
+ncnn::Layer *CreateReshapeLayer(const ncnn::VulkanDevice *vkdev,
+                                const ncnn::ParamDict &pd,
+                                const ncnn::Option &opt) {
+  ncnn::Layer *layer = ncnn::create_layer_vulkan(ncnn::LayerType::Reshape);
+  layer->vkdev = vkdev;
+  layer->load_param(pd);
+  layer->create_pipeline(opt);
+  return layer;
+}
+
+}  // namespace
+
+void ZipformerModel::InitVulkanStates() {
+  if (!encoder_.opt.use_vulkan_compute) {
+    return;
+  }
+
+  const ncnn::VulkanDevice *vkdev = encoder_.vulkan_device();
+  state_vkallocator_ = std::make_shared<ncnn::VkBlobAllocator>(vkdev);
+
+  // For Reshape, 0 is w and 1 is h. A value of 0 keeps the dim of the
+  // input and -1 infers it.
+  ncnn::ParamDict cached_avg;
+  cached_avg.set(0, -1);
+  reshape_cached_avg_ = CreateReshapeLayer(vkdev, cached_avg, encoder_.opt);
+
+  ncnn::ParamDict cached_len;
+  cached_len.set(0, 0);
+  cached_len.set(1, -1);
+  reshape_cached_len_ = CreateReshapeLayer(vkdev, cached_len, encoder_.opt);
+}
+#endif
+
+ZipformerModel::~ZipformerModel() {
+#if NCNN_VULKAN
+  for (ncnn::Layer *layer : {reshape_cached_avg_, reshape_cached_len_}) {
+    if (layer) {
+      layer->destroy_pipeline(encoder_.opt);
+      delete layer;
+    }
+  }
+#endif
+}
+
 std::pair<ncnn::Mat, std::vector<ncnn::Mat>> ZipformerModel::RunEncoder(
     ncnn::Mat &features, const std::vector<ncnn::Mat> &states) {
-  ncnn::Extractor encoder_ex = encoder_.create_extractor();
+  ncnn::Extractor encoder_ex = CreateExtractor(encoder_);
   return RunEncoder(features, states, &encoder_ex);
 }
 
 std::pair<ncnn::Mat, std::vector<ncnn::Mat>> ZipformerModel::RunEncoder(
     ncnn::Mat &features, const std::vector<ncnn::Mat> &states,
     ncnn::Extractor *encoder_ex) {
+  std::vector<ncnn::Mat> next_states;
+  ncnn::Mat encoder_out =
+      RunEncoder(features, states, encoder_ex, &next_states);
+  return {encoder_out, next_states};
+}
+
+ncnn::Mat ZipformerModel::RunEncoder(ncnn::Mat &features,
+                                     const std::vector<ncnn::Mat> &states,
+                                     ncnn::Extractor *encoder_ex,
+                                     std::vector<ncnn::Mat> *next_states) {
   std::vector<ncnn::Mat> _states;
 
   const ncnn::Mat *p;
@@ -102,30 +218,215 @@ std::pair<ncnn::Mat, std::vector<ncnn::Mat>> ZipformerModel::RunEncoder(
     encoder_ex->input(encoder_input_indexes_[i], p[i - 1]);
   }
 
+  // For a confidently blank chunk, only the layers up to the early blank
+  // head are run
+  const std::vector<int32_t> *early = EarlyExit(encoder_ex);
+  const std::vector<int32_t> &output_indexes =
+      early ? *early : encoder_output_indexes_;
+
   ncnn::Mat encoder_out;
-  encoder_ex->extract(encoder_output_indexes_[0], encoder_out);
+  encoder_ex->extract(output_indexes[0], encoder_out);
+
+  int32_t num_layers = static_cast<int32_t>(num_encoder_layers_.size());
+  next_states->resize(num_layers * 7);
+  for (int32_t i = 1; i != output_indexes.size(); ++i) {
+    ncnn::Mat s;
+    encoder_ex->extract(output_indexes[i], s);
+    SetNextState(i - 1, s, next_states);
+  }
 
-  std::vector<ncnn::Mat> next_states(num_encoder_layers_.size() * 7);
-  for (int32_t i = 1; i != encoder_output_indexes_.size(); ++i) {
-    encoder_ex->extract(encoder_output_indexes_[i], next_states[i - 1]);
+  return Detach(encoder_out);
+}
+
+void ZipformerModel::SetNextState(int32_t k, ncnn::Mat s,
+                                  std::vector<ncnn::Mat> *next_states) const {
+  int32_t num_layers = static_cast<int32_t>(num_encoder_layers_.size());
+  if (k < num_layers) {
+    // reshape cached_avg to 1-D tensors; remove the w dim, which is 1
+    s = s.reshape(s.h);
+  } else if (k < num_layers * 2) {
+    // reshape cached_len to 2-D tensors, remove the h dim, which is 1
+    s = s.reshape(s.w, s.c);
   }
 
-  // reshape cached_avg to 1-D tensors; remove the w dim, which is 1
-  for (size_t i = 0; i != num_encoder_layers_.size(); ++i) {
-    next_states[i] = next_states[i].reshape(next_states[i].h);
+  // The states are kept in the stream, so they must not refer to the
+  // memory pool of the model
+  CopyTo(s, &(*next_states)[k]);
+}
+
+std::vector<ncnn::Mat> ZipformerModel::RunEncoderBatch(
+    std::vector<ncnn::Mat> &features,
+    const std::vector<const std::vector<ncnn::Mat> *> &states,
+    const std::vector<std::vector<ncnn::Mat> *> &next_states) {
+#if NCNN_VULKAN
+  if (encoder_.opt.use_vulkan_compute && features.size() > 1) {
+    return RunEncoderBatchVulkan(features, states, next_states, nullptr);
   }
+#endif
+
+  return Model::RunEncoderBatch(features, states, next_states);
+}
 
-  // reshape cached_len to 2-D tensors, remove the h dim, which is 1
-  for (size_t i = num_encoder_layers_.size();
-       i != num_encoder_layers_.size() * 2; ++i) {
-    next_states[i] = next_states[i].reshape(next_states[i].w, next_states[i].c);
+std::vector<ncnn::Mat> ZipformerModel::RunEncoderBatch(
+    std::vector<ncnn::Mat> &features,
+    const std::vector<const std::vector<ncnn::Mat> *> &states,
+    const std::vector<std::vector<ncnn::Mat> *> &next_states,
+    const std::vector<std::unique_ptr<DeviceStates> *> &device_states) {
+#if NCNN_VULKAN
+  if (encoder_.opt.use_vulkan_compute) {
+    return RunEncoderBatchVulkan(features, states, next_states,
+                                 &device_states);
   }
+#endif
 
-  return {encoder_out, next_states};
+  return Model::RunEncoderBatch(features, states, next_states);
+}
+
+#if NCNN_VULKAN
+// Running the streams one after another costs one submission, and a wait
+// for it, per stream; the GPU is idle while we upload the inputs of the
+// next stream and read back the outputs of the previous one. Instead, the
+// uploads, the encoders and the downloads of all streams are recorded into
+// one command buffer, which is submitted once.
+//
+// With device_states, the next states are not downloaded but copied into
+// new VkMats, which are the inputs of the next chunk. Only the features
+// are uploaded and only encoder_out is downloaded.
+std::vector<ncnn::Mat> ZipformerModel::RunEncoderBatchVulkan(
+    std::vector<ncnn::Mat> &features,
+    const std::vector<const std::vector<ncnn::Mat> *> &states,
+    const std::vector<std::vector<ncnn::Mat> *> &next_states,
+    const std::vector<std::unique_ptr<DeviceStates> *> *device_states) {
+  int32_t n = static_cast<int32_t>(features.size());
+  int32_t num_inputs = static_cast<int32_t>(encoder_input_indexes_.size());
+  int32_t num_outputs = static_cast<int32_t>(encoder_output_indexes_.size());
+  int32_t num_layers = static_cast<int32_t>(num_encoder_layers_.size());
+
+  const ncnn::VulkanDevice *vkdev = encoder_.vulkan_device();
+  ncnn::VkAllocator *blob_vkallocator = vkdev->acquire_blob_allocator();
+  ncnn::VkAllocator *staging_vkallocator = vkdev->acquire_staging_allocator();
+
+  ncnn::Option opt = encoder_.opt;
+  opt.blob_vkallocator = blob_vkallocator;
+  opt.workspace_vkallocator = blob_vkallocator;
+  opt.staging_vkallocator = staging_vkallocator;
+
+  // The outputs are kept in the streams, so they are downloaded into
+  // mats that do not use the memory pool of the model
+  opt.blob_allocator = nullptr;
+
+  ncnn::Option state_opt = opt;
+  state_opt.blob_vkallocator = state_vkallocator_.get();
+
+  std::vector<ncnn::Mat> init_states;
+
+  // outputs[i * num_outputs + j] is the j-th output of the i-th stream
+  std::vector<ncnn::Mat> outputs(n * num_outputs);
+
+  std::vector<std::unique_ptr<VulkanStates>> new_device_states(n);
+
+  {
+    ncnn::VkCompute cmd(vkdev);
+
+    // The extractors own the blobs on the device until the command buffer
+    // has been run
+    std::vector<ncnn::Extractor> extractors;
+    extractors.reserve(n);
+
+    for (int32_t i = 0; i != n; ++i) {
+      // Only this model creates the device states of its streams
+      const VulkanStates *dev =
+          device_states
+              ? static_cast<const VulkanStates *>((*device_states)[i]->get())
+              : nullptr;
+
+      const ncnn::Mat *p = nullptr;
+      if (dev) {
+        // The states are on the device
+      } else if (states[i]->empty()) {
+        if (init_states.empty()) {
+          init_states = GetEncoderInitStates();
+        }
+        p = init_states.data();
+      } else {
+        p = states[i]->data();
+      }
+
+      extractors.push_back(CreateExtractor(encoder_));
+      ncnn::Extractor &ex = extractors.back();
+      ex.set_blob_vkallocator(blob_vkallocator);
+      ex.set_workspace_vkallocator(blob_vkallocator);
+      ex.set_staging_vkallocator(staging_vkallocator);
+
+      for (int32_t j = 0; j != num_inputs; ++j) {
+        if (j > 0 && dev) {
+          ex.input(encoder_input_indexes_[j], dev->Mats()[j - 1]);
+          continue;
+        }
+
+        ncnn::VkMat m;
+        cmd.record_upload(j == 0 ? features[i] : p[j - 1], m, opt);
+        ex.input(encoder_input_indexes_[j], m);
+      }
+
+      if (device_states) {
+        new_device_states[i] = std::make_unique<VulkanStates>(
+            vkdev, encoder_.opt, state_vkallocator_, num_outputs - 1);
+      }
+
+      for (int32_t j = 0; j != num_outputs; ++j) {
+        ncnn::VkMat m;
+        ex.extract(encoder_output_indexes_[j], m, cmd);
+
+        if (j == 0 || !device_states) {
+          cmd.record_download(m, outputs[i * num_outputs + j], opt);
+          continue;
+        }
+
+        // Reshape the state as SetNextState() does and copy it out of the
+        // memory of the extractor
+        int32_t k = j - 1;
+        ncnn::VkMat s;
+        if (k < num_layers) {
+          reshape_cached_avg_->forward(m, s, cmd, opt);
+        } else if (k < num_layers * 2) {
+          reshape_cached_len_->forward(m, s, cmd, opt);
+        } else {
+          s = m;
+        }
+
+        cmd.record_clone(s, new_device_states[i]->Mats()[k], state_opt);
+      }
+    }
+
+    cmd.submit_and_wait();
+  }
+
+  vkdev->reclaim_blob_allocator(blob_vkallocator);
+  vkdev->reclaim_staging_allocator(staging_vkallocator);
+
+  std::vector<ncnn::Mat> encoder_out(n);
+  for (int32_t i = 0; i != n; ++i) {
+    const ncnn::Mat *out = outputs.data() + i * num_outputs;
+    encoder_out[i] = out[0];
+
+    if (device_states) {
+      *(*device_states)[i] = std::move(new_device_states[i]);
+      continue;
+    }
+
+    next_states[i]->resize(num_layers * 7);
+    for (int32_t j = 1; j != num_outputs; ++j) {
+      SetNextState(j - 1, out[j], next_states[i]);
+    }
+  }
+
+  return encoder_out;
 }
+#endif
 
 ncnn::Mat ZipformerModel::RunDecoder(ncnn::Mat &decoder_input) {
-  ncnn::Extractor decoder_ex = decoder_.create_extractor();
+  ncnn::Extractor decoder_ex = CreateExtractor(decoder_);
   return RunDecoder(decoder_input, &decoder_ex);
 }
 
@@ -134,14 +435,19 @@ ncnn::Mat ZipformerModel::RunDecoder(ncnn::Mat &decoder_input,
   ncnn::Mat decoder_out;
   decoder_ex->input(decoder_input_indexes_[0], decoder_input);
   decoder_ex->extract(decoder_output_indexes_[0], decoder_out);
-  decoder_out = decoder_out.reshape(decoder_out.w);
 
-  return decoder_out;
+  // decoder_out.h is 1 unless the contexts of several hypotheses are
+  // concatenated in decoder_input. See Model::RunDecoder2D()
+  if (decoder_out.h == 1) {
+    decoder_out = decoder_out.reshape(decoder_out.w);
+  }
+
+  return Detach(decoder_out);
 }
 
 ncnn::Mat ZipformerModel::RunJoiner(ncnn::Mat &encoder_out,
                                     ncnn::Mat &decoder_out) {
-  auto joiner_ex = joiner_.create_extractor();
+  auto joiner_ex = CreateExtractor(joiner_);
   return RunJoiner(encoder_out, decoder_out, &joiner_ex);
 }
 
@@ -156,6 +462,18 @@ ncnn::Mat ZipformerModel::RunJoiner(ncnn::Mat &encoder_out,
   return joiner_out;
 }
 
+ncnn::Mat ZipformerModel::RunJoinerRaw(ncnn::Mat &encoder_out,
+                                       ncnn::Mat &decoder_out) {
+  auto joiner_ex = CreateExtractor(joiner_);
+  joiner_ex.input(joiner_input_indexes_[0], encoder_out);
+  joiner_ex.input(joiner_input_indexes_[1], decoder_out);
+
+  // type 1: keep the storage precision and the packing
+  ncnn::Mat joiner_out;
+  joiner_ex.extract(joiner_output_indexes_[0], joiner_out, 1);
+  return joiner_out;
+}
+
 void ZipformerModel::InitEncoderPostProcessing() {
   // Now load parameters for member variables
   for (const auto *layer : encoder_.layers()) {
@@ -169,6 +487,11 @@ void ZipformerModel::InitEncoderPostProcessing() {
       num_left_chunks_ = meta_data->arg2;
       pad_length_ = meta_data->arg3;
 
+      // Models exported before arg4 was added are subsampled by 4
+      if (meta_data->arg4 > 0) {
+        subsampling_factor_ = meta_data->arg4;
+      }
+
       num_encoder_layers_ = std::vector<int32_t>(
           static_cast<const int32_t *>(meta_data->arg16),
           static_cast<const int32_t *>(meta_data->arg16) + meta_data->arg16.w);
@@ -192,23 +515,25 @@ void ZipformerModel::InitEncoderPostProcessing() {
       break;
     }
   }
+
+  InitEncoderStateLayout();
 }
 
 void ZipformerModel::InitEncoder(const std::string &encoder_param,
                                  const std::string &encoder_bin) {
   RegisterCustomLayers(encoder_);
-  InitNet(encoder_, encoder_param, encoder_bin);
+  LoadNet(encoder_, encoder_param, encoder_bin);
   InitEncoderPostProcessing();
 }
 
 void ZipformerModel::InitDecoder(const std::string &decoder_param,
                                  const std::string &decoder_bin) {
-  InitNet(decoder_, decoder_param, decoder_bin);
+  LoadNet(decoder_, decoder_param, decoder_bin);
 }
 
 void ZipformerModel::InitJoiner(const std::string &joiner_param,
                                 const std::string &joiner_bin) {
-  InitNet(joiner_, joiner_param, joiner_bin);
+  LoadNet(joiner_, joiner_param, joiner_bin);
 }
 
 #if __ANDROID_API__ >= 9
@@ -4,6 +4,7 @@
 
 #ifndef SHERPA_NCNN_CSRC_ZIPFORMER_MODEL_H_
 #define SHERPA_NCNN_CSRC_ZIPFORMER_MODEL_H_
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -16,11 +17,16 @@ namespace sherpa_ncnn {
 // for how the model is converted from icefall to ncnn
 class ZipformerModel : public Model {
  public:
-  explicit ZipformerModel(const ModelConfig &config);
+  // If bundle is not nullptr, the .param and .bin fields of config are
+  // names of its sections
+  explicit ZipformerModel(const ModelConfig &config,
+                          std::shared_ptr<const ModelBundle> bundle = nullptr);
 #if __ANDROID_API__ >= 9
   ZipformerModel(AAssetManager *mgr, const ModelConfig &config);
 #endif
 
+  ~ZipformerModel() override;
+
   ncnn::Net &GetEncoder() override { return encoder_; }
   ncnn::Net &GetDecoder() override { return decoder_; }
   ncnn::Net &GetJoiner() override { return joiner_; }
@@ -34,6 +40,24 @@ class ZipformerModel : public Model {
       ncnn::Mat &features, const std::vector<ncnn::Mat> &states,
       ncnn::Extractor *extractor) override;
 
+  ncnn::Mat RunEncoder(ncnn::Mat &features,
+                       const std::vector<ncnn::Mat> &states,
+                       ncnn::Extractor *extractor,
+                       std::vector<ncnn::Mat> *next_states) override;
+
+  std::vector<ncnn::Mat> RunEncoderBatch(
+      std::vector<ncnn::Mat> &features,
+      const std::vector<const std::vector<ncnn::Mat> *> &states,
+      const std::vector<std::vector<ncnn::Mat> *> &next_states) override;
+
+  // With Vulkan, the states are kept on the GPU
+  std::vector<ncnn::Mat> RunEncoderBatch(
+      std::vector<ncnn::Mat> &features,
+      const std::vector<const std::vector<ncnn::Mat> *> &states,
+      const std::vector<std::vector<ncnn::Mat> *> &next_states,
+      const std::vector<std::unique_ptr<DeviceStates> *> &device_states)
+      override;
+
   ncnn::Mat RunDecoder(ncnn::Mat &decoder_input) override;
 
   ncnn::Mat RunDecoder(ncnn::Mat &decoder_input,
@@ -44,6 +68,9 @@ class ZipformerModel : public Model {
   ncnn::Mat RunJoiner(ncnn::Mat &encoder_out, ncnn::Mat &decoder_out,
                       ncnn::Extractor *extractor) override;
 
+  ncnn::Mat RunJoinerRaw(ncnn::Mat &encoder_out,
+                         ncnn::Mat &decoder_out) override;
+
   int32_t Segment() const override {
     // pad_length 7, because the subsampling expression is
     // ((x_len - 7) // 2 + 1)//2, we need to pad 7 frames
@@ -58,6 +85,8 @@ class ZipformerModel : public Model {
   // running the encoder network
   int32_t Offset() const override { return decode_chunk_length_; }
 
+  int32_t SubsamplingFactor() const override { return subsampling_factor_; }
+
  private:
   void InitEncoder(const std::string &encoder_param,
                    const std::string &encoder_bin);
@@ -77,6 +106,24 @@ class ZipformerModel : public Model {
                   const std::string &joiner_bin);
 #endif
 
+  // Reshape the k-th state output of the encoder and save it in
+  // (*next_states)[k]
+  void SetNextState(int32_t k, ncnn::Mat s,
+                    std::vector<ncnn::Mat> *next_states) const;
+
+#if NCNN_VULKAN
+  void InitVulkanStates();
+
+  // Run the encoder for all streams with a single command buffer. If
+  // device_states is not null, the states are kept on the GPU, see
+  // RunEncoderBatch().
+  std::vector<ncnn::Mat> RunEncoderBatchVulkan(
+      std::vector<ncnn::Mat> &features,
+      const std::vector<const std::vector<ncnn::Mat> *> &states,
+      const std::vector<std::vector<ncnn::Mat> *> &next_states,
+      const std::vector<std::unique_ptr<DeviceStates> *> *device_states);
+#endif
+
   void InitEncoderInputOutputIndexes();
   void InitDecoderInputOutputIndexes();
   void InitJoinerInputOutputIndexes();
@@ -89,6 +136,7 @@ class ZipformerModel : public Model {
   int32_t decode_chunk_length_ = 32;  // arg1, before subsampling
   int32_t num_left_chunks_ = 4;       // arg2
   int32_t pad_length_ = 7;            // arg3
+  int32_t subsampling_factor_ = 4;    // arg4, if it is positive
 
   std::vector<int32_t> num_encoder_layers_;              // arg16
   std::vector<int32_t> encoder_dims_;                    // arg17
@@ -104,6 +152,17 @@ class ZipformerModel : public Model {
 
   std::vector<int32_t> joiner_input_indexes_;
   std::vector<int32_t> joiner_output_indexes_;
+
+#if NCNN_VULKAN
+  // The states kept on the GPU are allocated from it. It is shared with
+  // them, since a stream may outlive the model.
+  std::shared_ptr<ncnn::VkAllocator> state_vkallocator_;
+
+  // On the host, the state outputs of cached_avg and cached_len are
+  // reshaped with ncnn::Mat::reshape(). On the GPU, these layers do it.
+  ncnn::Layer *reshape_cached_avg_ = nullptr;
+  ncnn::Layer *reshape_cached_len_ = nullptr;
+#endif
 };
 
 }  // namespace sherpa_ncnn
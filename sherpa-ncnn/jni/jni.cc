@@ -24,6 +24,9 @@
 // android-ndk/toolchains/llvm/prebuilt/linux-x86_64/sysroot/usr/include
 #include "jni.h"  // NOLINT
 
+#include <chrono>  // NOLINT
+#include <future>  // NOLINT
+#include <mutex>   // NOLINT
 #include <strstream>
 
 #if __ANDROID_API__ >= 9
@@ -44,48 +47,134 @@ class SherpaNcnn {
  public:
 #if __ANDROID_API__ >= 9
   SherpaNcnn(AAssetManager *mgr, const sherpa_ncnn::RecognizerConfig &config)
-      : recognizer_(mgr, config),
-        stream_(recognizer_.CreateStream()),
+      : recognizer_(std::make_unique<Recognizer>(mgr, config)),
+        stream_(NewStream(*recognizer_)),
         tail_padding_(16000 * 0.32, 0) {}
 #endif
 
   explicit SherpaNcnn(const sherpa_ncnn::RecognizerConfig &config)
-      : recognizer_(config),
-        stream_(recognizer_.CreateStream()),
+      : recognizer_(std::make_unique<Recognizer>(config)),
+        stream_(NewStream(*recognizer_)),
         tail_padding_(16000 * 0.32, 0) {}
 
+  // The recognizer is being created by CreateRecognizerAsync(). The other
+  // methods wait for it.
+  explicit SherpaNcnn(std::future<std::unique_ptr<Recognizer>> recognizer)
+      : pending_(std::move(recognizer)), tail_padding_(16000 * 0.32, 0) {}
+
+  // It may be called from any thread, e.g., to poll the loading from the
+  // UI thread while another thread waits for the recognizer
+  bool IsLoaded() const {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    return !pending_.valid() || pending_.wait_for(std::chrono::seconds(0)) ==
+                                    std::future_status::ready;
+  }
+
+  void WarmUp() { GetRecognizer().WarmUp(); }
+
   void AcceptWaveform(float sample_rate, const float *samples, int32_t n) {
+    GetRecognizer();
     stream_->AcceptWaveform(sample_rate, samples, n);
   }
 
+  void AcceptWaveformInt16(float sample_rate, const int16_t *samples,
+                           int32_t n) {
+    GetRecognizer();
+    stream_->AcceptWaveformInt16(sample_rate, samples, n);
+  }
+
   void InputFinished() {
+    GetRecognizer();
     stream_->AcceptWaveform(16000, tail_padding_.data(), tail_padding_.size());
     stream_->InputFinished();
   }
 
-  bool IsReady() const { return recognizer_.IsReady(stream_.get()); }
+  bool IsReady() { return GetRecognizer().IsReady(stream_.get()); }
+
+  void DecodeStream() { return GetRecognizer().DecodeStream(stream_.get()); }
+
+  // Return the number of decoded chunks
+  int32_t DecodeUntilNotReady() {
+    Recognizer &recognizer = GetRecognizer();
+
+    int32_t n = 0;
+    while (recognizer.IsReady(stream_.get())) {
+      recognizer.DecodeStream(stream_.get());
+      ++n;
+    }
+    return n;
+  }
+
+  // Return false if the text has not changed since the last call, in
+  // which case text is not set. The text changes only if the decoded
+  // tokens do.
+  bool GetTextIfChanged(std::string *text) {
+    GetRecognizer();
 
-  void DecodeStream() const { return recognizer_.DecodeStream(stream_.get()); }
+    const auto &tokens = stream_->GetResult().tokens;
+    if (has_last_tokens_ && tokens == last_tokens_) {
+      return false;
+    }
 
-  const std::string GetText() const {
-    auto result = recognizer_.GetResult(stream_.get());
+    *text = GetText();
+
+    // GetText() may change the tokens at an endpoint
+    last_tokens_ = stream_->GetResult().tokens;
+    has_last_tokens_ = true;
+
+    return true;
+  }
+
+  const std::string GetText() {
+    auto result = GetRecognizer().GetResult(stream_.get());
     return result.text;
   }
 
-  bool IsEndpoint() const { return recognizer_.IsEndpoint(stream_.get()); }
+  bool IsEndpoint() { return GetRecognizer().IsEndpoint(stream_.get()); }
 
   void Reset(bool recreate) {
     if (recreate) {
-      stream_ = recognizer_.CreateStream();
+      stream_ = NewStream(GetRecognizer());
     } else {
-      recognizer_.Reset(stream_.get());
+      GetRecognizer().Reset(stream_.get());
     }
   }
 
  private:
-  Recognizer recognizer_;
+  // The methods use stream_ without checking it, so a stream that cannot be
+  // created, e.g., due to RecognizerConfig::memory_budget, is fatal
+  static std::unique_ptr<Stream> NewStream(const Recognizer &recognizer) {
+    auto s = recognizer.CreateStream();
+    if (!s) {
+      NCNN_LOGE("Failed to create a stream");
+      exit(-1);
+    }
+    return s;
+  }
+
+  Recognizer &GetRecognizer() {
+    if (pending_.valid()) {
+      // Wait without the lock so that IsLoaded() does not block. Only
+      // get() modifies pending_, and it is called on this thread.
+      pending_.wait();
+
+      std::lock_guard<std::mutex> lock(pending_mutex_);
+      recognizer_ = pending_.get();
+      stream_ = NewStream(*recognizer_);
+    }
+    return *recognizer_;
+  }
+
+  // Guards get() of pending_ against IsLoaded()
+  mutable std::mutex pending_mutex_;
+  std::future<std::unique_ptr<Recognizer>> pending_;
+  std::unique_ptr<Recognizer> recognizer_;
   std::unique_ptr<Stream> stream_;
   std::vector<float> tail_padding_;
+
+  // The decoded tokens of the last GetTextIfChanged()
+  std::vector<int32_t> last_tokens_;
+  bool has_last_tokens_ = false;
 };
 
 static FeatureExtractorConfig GetFeatureExtractorConfig(JNIEnv *env,
@@ -170,6 +259,29 @@ static ModelConfig GetModelConfig(JNIEnv *env, jobject config) {
   fid = env->GetFieldID(model_config_cls, "useGPU", "Z");
   ans.use_vulkan_compute = env->GetBooleanField(model_config, fid);
 
+  fid = env->GetFieldID(model_config_cls, "encoderPowersave", "I");
+  ans.encoder_powersave = env->GetIntField(model_config, fid);
+
+  fid = env->GetFieldID(model_config_cls, "decoderPowersave", "I");
+  ans.decoder_powersave = env->GetIntField(model_config, fid);
+
+  fid = env->GetFieldID(model_config_cls, "joinerPowersave", "I");
+  ans.joiner_powersave = env->GetIntField(model_config, fid);
+
+  fid = env->GetFieldID(model_config_cls, "cpuCores", "Ljava/lang/String;");
+  s = (jstring)env->GetObjectField(model_config, fid);
+  p = env->GetStringUTFChars(s, nullptr);
+  ans.cpu_cores = p;
+  env->ReleaseStringUTFChars(s, p);
+
+  fid = env->GetFieldID(model_config_cls, "precision", "Ljava/lang/String;");
+  s = (jstring)env->GetObjectField(model_config, fid);
+  p = env->GetStringUTFChars(s, nullptr);
+  ans.encoder_precision = p;
+  ans.decoder_precision = p;
+  ans.joiner_precision = p;
+  env->ReleaseStringUTFChars(s, p);
+
   return ans;
 }
 
@@ -312,6 +424,49 @@ JNIEXPORT jlong JNICALL Java_com_k2fsa_sherpa_ncnn_SherpaNcnn_newFromAsset(
   return (jlong)model;
 }
 
+SHERPA_EXTERN_C
+JNIEXPORT jlong JNICALL Java_com_k2fsa_sherpa_ncnn_SherpaNcnn_newFromFileAsync(
+    JNIEnv *env, jobject /*obj*/, jobject _config) {
+  sherpa_ncnn::RecognizerConfig config = sherpa_ncnn::ParseConfig(env, _config);
+  auto model = new sherpa_ncnn::SherpaNcnn(
+      sherpa_ncnn::CreateRecognizerAsync(config));
+
+  return (jlong)model;
+}
+
+SHERPA_EXTERN_C
+JNIEXPORT jlong JNICALL Java_com_k2fsa_sherpa_ncnn_SherpaNcnn_newFromAssetAsync(
+    JNIEnv *env, jobject /*obj*/, jobject asset_manager, jobject _config) {
+#if __ANDROID_API__ >= 9
+  AAssetManager *mgr = AAssetManager_fromJava(env, asset_manager);
+  if (!mgr) {
+    NCNN_LOGE("Failed to get asset manager: %p", mgr);
+  }
+#endif
+
+  sherpa_ncnn::RecognizerConfig config = sherpa_ncnn::ParseConfig(env, _config);
+  auto model = new sherpa_ncnn::SherpaNcnn(sherpa_ncnn::CreateRecognizerAsync(
+#if __ANDROID_API__ >= 9
+      mgr,
+#endif
+      config));
+
+  return (jlong)model;
+}
+
+SHERPA_EXTERN_C
+JNIEXPORT bool JNICALL Java_com_k2fsa_sherpa_ncnn_SherpaNcnn_isLoaded(
+    JNIEnv *env, jobject /*obj*/, jlong ptr) {
+  auto model = reinterpret_cast<sherpa_ncnn::SherpaNcnn *>(ptr);
+  return model->IsLoaded();
+}
+
+SHERPA_EXTERN_C
+JNIEXPORT void JNICALL Java_com_k2fsa_sherpa_ncnn_SherpaNcnn_warmUp(
+    JNIEnv *env, jobject /*obj*/, jlong ptr) {
+  reinterpret_cast<sherpa_ncnn::SherpaNcnn *>(ptr)->WarmUp();
+}
+
 SHERPA_EXTERN_C
 JNIEXPORT void JNICALL Java_com_k2fsa_sherpa_ncnn_SherpaNcnn_delete(
     JNIEnv *env, jobject /*obj*/, jlong ptr) {
@@ -360,6 +515,45 @@ JNIEXPORT void JNICALL Java_com_k2fsa_sherpa_ncnn_SherpaNcnn_acceptWaveform(
   env->ReleaseFloatArrayElements(samples, p, JNI_ABORT);
 }
 
+// buffer is a direct ByteBuffer in the native byte order with n samples,
+// which are 16-bit PCM samples if is_int16 is true or floats otherwise.
+// They are used in place.
+SHERPA_EXTERN_C
+JNIEXPORT void JNICALL
+Java_com_k2fsa_sherpa_ncnn_SherpaNcnn_acceptWaveformDirect(
+    JNIEnv *env, jobject /*obj*/, jlong ptr, jobject buffer, jint n,
+    jboolean is_int16, jfloat sample_rate) {
+  auto model = reinterpret_cast<sherpa_ncnn::SherpaNcnn *>(ptr);
+
+  const void *p = env->GetDirectBufferAddress(buffer);
+  if (!p) {
+    NCNN_LOGE("acceptWaveformDirect() expects a direct ByteBuffer");
+    return;
+  }
+
+  jlong num_bytes = static_cast<jlong>(n) * (is_int16 ? 2 : 4);
+  if (n < 0 || num_bytes > env->GetDirectBufferCapacity(buffer)) {
+    NCNN_LOGE("There are fewer than %d samples in the buffer", n);
+    return;
+  }
+
+  if (is_int16) {
+    model->AcceptWaveformInt16(sample_rate, static_cast<const int16_t *>(p),
+                               n);
+  } else {
+    model->AcceptWaveform(sample_rate, static_cast<const float *>(p), n);
+  }
+}
+
+SHERPA_EXTERN_C
+JNIEXPORT jint JNICALL
+Java_com_k2fsa_sherpa_ncnn_SherpaNcnn_decodeUntilNotReady(JNIEnv *env,
+                                                         jobject /*obj*/,
+                                                         jlong ptr) {
+  auto model = reinterpret_cast<sherpa_ncnn::SherpaNcnn *>(ptr);
+  return model->DecodeUntilNotReady();
+}
+
 SHERPA_EXTERN_C
 JNIEXPORT void JNICALL Java_com_k2fsa_sherpa_ncnn_SherpaNcnn_inputFinished(
     JNIEnv *env, jobject /*obj*/, jlong ptr) {
@@ -375,6 +569,22 @@ JNIEXPORT jstring JNICALL Java_com_k2fsa_sherpa_ncnn_SherpaNcnn_getText(
   return env->NewStringUTF(text.c_str());
 }
 
+// Return null if the text has not changed since the last call, so that no
+// string is created while polling
+SHERPA_EXTERN_C
+JNIEXPORT jstring JNICALL
+Java_com_k2fsa_sherpa_ncnn_SherpaNcnn_getTextIfChanged(JNIEnv *env,
+                                                      jobject /*obj*/,
+                                                      jlong ptr) {
+  std::string text;
+  if (!reinterpret_cast<sherpa_ncnn::SherpaNcnn *>(ptr)->GetTextIfChanged(
+          &text)) {
+    return nullptr;
+  }
+
+  return env->NewStringUTF(text.c_str());
+}
+
 SHERPA_EXTERN_C
 JNIEXPORT jfloatArray JNICALL
 Java_com_k2fsa_sherpa_ncnn_WaveReader_00024Companion_readWave(
@@ -4,6 +4,8 @@
 
 #include "sherpa-ncnn/csrc/offline-recognizer.h"
 
+#include <vector>
+
 #include "sherpa-ncnn/csrc/macros.h"
 #include "sherpa-ncnn/csrc/text-utils.h"
 #include "sherpa-ncnn/jni/common.h"
@@ -20,6 +22,9 @@ static OfflineRecognizerConfig GetOfflineConfig(JNIEnv *env, jobject config,
   //---------- decoding ----------
   SHERPA_NCNN_JNI_READ_STRING(ans.decoding_method, decodingMethod, cls, config);
   SHERPA_NCNN_JNI_READ_FLOAT(ans.blank_penalty, blankPenalty, cls, config);
+  SHERPA_NCNN_JNI_READ_INT(ans.max_active_paths, maxActivePaths, cls, config);
+  SHERPA_NCNN_JNI_READ_STRING(ans.hotwords_file, hotwordsFile, cls, config);
+  SHERPA_NCNN_JNI_READ_FLOAT(ans.hotwords_score, hotwordsScore, cls, config);
 
   //---------- feat config ----------
   fid = env->GetFieldID(cls, "featConfig",
@@ -215,10 +220,15 @@ Java_com_k2fsa_sherpa_ncnn_OfflineRecognizer_decodeStreams(
     jlong *p = env->GetLongArrayElements(stream_ptrs, nullptr);
     jsize n = env->GetArrayLength(stream_ptrs);
 
-    auto ss = reinterpret_cast<sherpa_ncnn::OfflineStream **>(p);
-    recognizer->DecodeStreams(ss, n);
+    // A jlong is 64-bit, but a pointer may be 32-bit
+    std::vector<sherpa_ncnn::OfflineStream *> ss(n);
+    for (jsize i = 0; i != n; ++i) {
+      ss[i] = reinterpret_cast<sherpa_ncnn::OfflineStream *>(p[i]);
+    }
 
     env->ReleaseLongArrayElements(stream_ptrs, p, JNI_ABORT);
+
+    recognizer->DecodeStreams(ss.data(), n);
   });
 }
 
@@ -23,3 +23,48 @@ JNIEXPORT void JNICALL Java_com_k2fsa_sherpa_ncnn_OfflineStream_acceptWaveform(
   stream->AcceptWaveform(sample_rate, p, n);
   env->ReleaseFloatArrayElements(samples, p, JNI_ABORT);
 }
+
+// The samples are read from a direct buffer in place, so they are not
+// copied from the Java heap. offset and n are in samples.
+SHERPA_NCNN_EXTERN_C
+JNIEXPORT void JNICALL
+Java_com_k2fsa_sherpa_ncnn_OfflineStream_acceptWaveformDirect(
+    JNIEnv *env, jobject /*obj*/, jlong ptr, jobject samples, jint offset,
+    jint n, jint sample_rate) {
+  SafeJNI(env, "OfflineStream_acceptWaveformDirect", [&] {
+    auto p = static_cast<const float *>(env->GetDirectBufferAddress(samples));
+    if (!p) {
+      jclass exClass = env->FindClass("java/lang/IllegalArgumentException");
+      env->ThrowNew(exClass, "The samples must be in a direct buffer");
+      return;
+    }
+
+    auto stream = reinterpret_cast<sherpa_ncnn::OfflineStream *>(ptr);
+    stream->AcceptWaveform(sample_rate, p + offset, n);
+  });
+}
+
+// Same as acceptWaveformDirect() but for 16-bit PCM samples
+SHERPA_NCNN_EXTERN_C
+JNIEXPORT void JNICALL
+Java_com_k2fsa_sherpa_ncnn_OfflineStream_acceptWaveformInt16Direct(
+    JNIEnv *env, jobject /*obj*/, jlong ptr, jobject samples, jint offset,
+    jint n, jint sample_rate) {
+  SafeJNI(env, "OfflineStream_acceptWaveformInt16Direct", [&] {
+    auto p = static_cast<const int16_t *>(env->GetDirectBufferAddress(samples));
+    if (!p) {
+      jclass exClass = env->FindClass("java/lang/IllegalArgumentException");
+      env->ThrowNew(exClass, "The samples must be in a direct buffer");
+      return;
+    }
+
+    auto stream = reinterpret_cast<sherpa_ncnn::OfflineStream *>(ptr);
+    stream->AcceptWaveformInt16(sample_rate, p + offset, n);
+  });
+}
+
+SHERPA_NCNN_EXTERN_C
+JNIEXPORT void JNICALL Java_com_k2fsa_sherpa_ncnn_OfflineStream_inputFinished(
+    JNIEnv * /*env*/, jobject /*obj*/, jlong ptr) {
+  reinterpret_cast<sherpa_ncnn::OfflineStream *>(ptr)->InputFinished();
+}
@@ -35,6 +35,9 @@ data class OfflineRecognizerConfig(
     var modelConfig: OfflineModelConfig = OfflineModelConfig(),
     var decodingMethod: String = "greedy_search",
     var blankPenalty: Float = 0.0f,
+    var maxActivePaths: Int = 4,
+    var hotwordsFile: String = "",
+    var hotwordsScore: Float = 1.5f,
 )
 
 class OfflineRecognizer(
@@ -88,6 +91,11 @@ class OfflineRecognizer(
 
     fun decode(stream: OfflineStream) = decode(ptr, stream.ptr)
 
+    // Decode all streams with one JNI call. They are batched natively, which
+    // is faster than calling decode() for each of them.
+    fun decodeStreams(streams: Array<OfflineStream>) =
+        decodeStreams(ptr, LongArray(streams.size) { streams[it].ptr })
+
     fun setConfig(config: OfflineRecognizerConfig) = setConfig(ptr, config)
 
     private external fun delete(ptr: Long)
@@ -107,6 +115,8 @@ class OfflineRecognizer(
 
     private external fun decode(ptr: Long, streamPtr: Long)
 
+    private external fun decodeStreams(ptr: Long, streamPtrs: LongArray)
+
     private external fun getResult(streamPtr: Long): Array<Any>
 
     companion object {
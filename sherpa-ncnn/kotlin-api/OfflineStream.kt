@@ -1,9 +1,42 @@
 package com.k2fsa.sherpa.ncnn
 
+import java.nio.FloatBuffer
+import java.nio.ShortBuffer
+
 class OfflineStream(var ptr: Long) {
     fun acceptWaveform(samples: FloatArray, sampleRate: Int) =
         acceptWaveform(ptr, samples, sampleRate)
 
+    // The remaining samples of a direct buffer, e.g., one from
+    // ByteBuffer.allocateDirect(n * 4).order(ByteOrder.nativeOrder())
+    // .asFloatBuffer(), are read in place without a copy. The position of
+    // the buffer is not changed.
+    fun acceptWaveform(samples: FloatBuffer, sampleRate: Int) {
+        require(samples.isDirect) { "samples must be a direct buffer" }
+        acceptWaveformDirect(
+            ptr,
+            samples,
+            samples.position(),
+            samples.remaining(),
+            sampleRate,
+        )
+    }
+
+    // Same as above, but for 16-bit PCM samples, e.g., from AudioRecord or
+    // a decoded voice note
+    fun acceptWaveform(samples: ShortBuffer, sampleRate: Int) {
+        require(samples.isDirect) { "samples must be a direct buffer" }
+        acceptWaveformInt16Direct(
+            ptr,
+            samples,
+            samples.position(),
+            samples.remaining(),
+            sampleRate,
+        )
+    }
+
+    fun inputFinished() = inputFinished(ptr)
+
     protected fun finalize() {
         if (ptr != 0L) {
             delete(ptr)
@@ -22,6 +55,23 @@ class OfflineStream(var ptr: Long) {
     }
 
     private external fun acceptWaveform(ptr: Long, samples: FloatArray, sampleRate: Int)
+    private external fun acceptWaveformDirect(
+        ptr: Long,
+        samples: FloatBuffer,
+        offset: Int,
+        n: Int,
+        sampleRate: Int,
+    )
+
+    private external fun acceptWaveformInt16Direct(
+        ptr: Long,
+        samples: ShortBuffer,
+        offset: Int,
+        n: Int,
+        sampleRate: Int,
+    )
+
+    private external fun inputFinished(ptr: Long)
     private external fun delete(ptr: Long)
 
     companion object {
@@ -0,0 +1,958 @@
+// sherpa-ncnn/node-addon/sherpa-ncnn-node-addon.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+// A native Node.js addon built on the C API. Unlike the WASM build, ncnn
+// uses all of its threads, and the *Async() functions decode on the libuv
+// thread pool so that the event loop is not blocked.
+//
+// Recognizers and streams are passed to JavaScript as externals holding a
+// std::shared_ptr. A stream shares the ownership of its recognizer, so the
+// recognizer is destroyed after its last stream no matter in which order
+// they are freed or garbage collected. See scripts/node-addon/index.js for
+// the JavaScript API.
+
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "node_api.h"  // NOLINT
+#include "sherpa-ncnn/c-api/c-api.h"
+
+#define SHERPA_NCNN_NAPI_CALL(env, call)                     \
+  do {                                                       \
+    if ((call) != napi_ok) {                                 \
+      ThrowLastError(env, #call);                            \
+      return nullptr;                                        \
+    }                                                        \
+  } while (0)
+
+namespace {
+
+void ThrowLastError(napi_env env, const char *call) {
+  bool pending = false;
+  napi_is_exception_pending(env, &pending);
+  if (pending) {
+    return;
+  }
+
+  const napi_extended_error_info *info = nullptr;
+  napi_get_last_error_info(env, &info);
+
+  std::string msg = call;
+  if (info && info->error_message) {
+    msg += ": ";
+    msg += info->error_message;
+  }
+
+  napi_throw_error(env, nullptr, msg.c_str());
+}
+
+struct Recognizer {
+  explicit Recognizer(SherpaNcnnRecognizer *impl) : impl(impl) {}
+  ~Recognizer() { DestroyRecognizer(impl); }
+
+  SherpaNcnnRecognizer *impl;
+
+  // Decoding with a recognizer is serialized
+  std::mutex mutex;
+};
+
+struct Stream {
+  Stream(std::shared_ptr<Recognizer> recognizer, SherpaNcnnStream *impl)
+      : recognizer(std::move(recognizer)), impl(impl) {}
+
+  ~Stream() { DestroyStream(impl); }
+
+  // It is declared first, so the recognizer outlives impl
+  std::shared_ptr<Recognizer> recognizer;
+  SherpaNcnnStream *impl;
+
+  // True while the stream is decoded in a worker thread. It is accessed
+  // only in the main thread.
+  bool busy = false;
+};
+
+struct OfflineRecognizer {
+  explicit OfflineRecognizer(SherpaNcnnOfflineRecognizer *impl)
+      : impl(impl) {}
+  ~OfflineRecognizer() { SherpaNcnnDestroyOfflineRecognizer(impl); }
+
+  SherpaNcnnOfflineRecognizer *impl;
+  std::mutex mutex;
+};
+
+struct OfflineStream {
+  OfflineStream(std::shared_ptr<OfflineRecognizer> recognizer,
+                SherpaNcnnOfflineStream *impl)
+      : recognizer(std::move(recognizer)), impl(impl) {}
+
+  ~OfflineStream() { SherpaNcnnDestroyOfflineStream(impl); }
+
+  std::shared_ptr<OfflineRecognizer> recognizer;
+  SherpaNcnnOfflineStream *impl;
+  bool busy = false;
+};
+
+template <typename T>
+napi_value Wrap(napi_env env, std::shared_ptr<T> p) {
+  auto box = new std::shared_ptr<T>(std::move(p));
+
+  napi_value ans;
+  napi_status status = napi_create_external(
+      env, box,
+      [](napi_env /*env*/, void *data, void * /*hint*/) {
+        delete static_cast<std::shared_ptr<T> *>(data);
+      },
+      nullptr, &ans);
+
+  if (status != napi_ok) {
+    delete box;
+    ThrowLastError(env, "napi_create_external");
+    return nullptr;
+  }
+
+  return ans;
+}
+
+// Return nullptr and throw if v is not a live object created by Wrap()
+template <typename T>
+std::shared_ptr<T> *Unwrap(napi_env env, napi_value v) {
+  void *data = nullptr;
+  if (napi_get_value_external(env, v, &data) != napi_ok || !data) {
+    napi_throw_type_error(env, nullptr, "Expect a handle");
+    return nullptr;
+  }
+
+  auto box = static_cast<std::shared_ptr<T> *>(data);
+  if (!*box) {
+    napi_throw_error(env, nullptr, "It has been freed");
+    return nullptr;
+  }
+
+  return box;
+}
+
+// Also throw if the stream is being decoded
+template <typename T>
+T *GetIdleStream(napi_env env, napi_value v) {
+  auto box = Unwrap<T>(env, v);
+  if (!box) {
+    return nullptr;
+  }
+
+  if ((*box)->busy) {
+    napi_throw_error(env, nullptr,
+                     "The stream is being decoded. Please wait for the "
+                     "promise of decodeAsync()");
+    return nullptr;
+  }
+
+  return box->get();
+}
+
+// Read the fields of a config object. Missing fields are 0 or nullptr, so
+// that the C API uses its defaults.
+class ConfigReader {
+ public:
+  ConfigReader(napi_env env, napi_value obj, std::deque<std::string> *strings)
+      : env_(env), obj_(obj), strings_(strings) {}
+
+  ConfigReader Child(const char *key) const {
+    return ConfigReader(env_, Get(key), strings_);
+  }
+
+  // The returned pointer is valid as long as strings
+  const char *GetString(const char *key, const char *default_value = nullptr) {
+    napi_value v = Get(key);
+    if (!v) {
+      return default_value;
+    }
+
+    size_t n = 0;
+    if (napi_get_value_string_utf8(env_, v, nullptr, 0, &n) != napi_ok) {
+      return default_value;
+    }
+
+    std::string s(n, '\0');
+    napi_get_value_string_utf8(env_, v, &s[0], n + 1, &n);
+    strings_->push_back(std::move(s));
+
+    return strings_->back().c_str();
+  }
+
+  int32_t GetInt32(const char *key, int32_t default_value = 0) const {
+    napi_value v = Get(key);
+    if (!v) {
+      return default_value;
+    }
+
+    // true and false are accepted as 1 and 0
+    bool b;
+    if (napi_get_value_bool(env_, v, &b) == napi_ok) {
+      return b;
+    }
+
+    int32_t ans = default_value;
+    napi_get_value_int32(env_, v, &ans);
+    return ans;
+  }
+
+  float GetFloat(const char *key, float default_value = 0) const {
+    napi_value v = Get(key);
+    if (!v) {
+      return default_value;
+    }
+
+    double ans = default_value;
+    napi_get_value_double(env_, v, &ans);
+    return ans;
+  }
+
+ private:
+  // Return nullptr if obj_ is not an object or has no such field
+  napi_value Get(const char *key) const {
+    napi_valuetype type = napi_undefined;
+    if (!obj_ || napi_typeof(env_, obj_, &type) != napi_ok ||
+        type != napi_object) {
+      return nullptr;
+    }
+
+    napi_value v;
+    if (napi_get_named_property(env_, obj_, key, &v) != napi_ok ||
+        napi_typeof(env_, v, &type) != napi_ok || type == napi_undefined ||
+        type == napi_null) {
+      return nullptr;
+    }
+
+    return v;
+  }
+
+ private:
+  napi_env env_;
+  napi_value obj_;
+  std::deque<std::string> *strings_;
+};
+
+// Get the arguments of a call. Return false and throw if there are fewer
+// than n.
+bool GetArgs(napi_env env, napi_callback_info info, size_t n,
+             napi_value *args) {
+  size_t argc = n;
+  if (napi_get_cb_info(env, info, &argc, args, nullptr, nullptr) != napi_ok) {
+    ThrowLastError(env, "napi_get_cb_info");
+    return false;
+  }
+
+  if (argc < n) {
+    napi_throw_type_error(env, nullptr, "Too few arguments");
+    return false;
+  }
+
+  return true;
+}
+
+// Samples from a Float32Array, an Int16Array or a Buffer of 16-bit PCM.
+// They point into the memory of the array, so they are not copied.
+struct Samples {
+  const float *f = nullptr;
+  const int16_t *i16 = nullptr;
+  int32_t n = 0;
+
+  // Only for a Buffer at an odd byte offset, which cannot be read as
+  // int16_t in place
+  std::vector<int16_t> copy;
+};
+
+bool GetSamples(napi_env env, napi_value v, Samples *ans) {
+  bool is_typed_array = false;
+  napi_is_typedarray(env, v, &is_typed_array);
+  if (!is_typed_array) {
+    napi_throw_type_error(env, nullptr,
+                          "Expect a Float32Array, an Int16Array or a Buffer");
+    return false;
+  }
+
+  napi_typedarray_type type;
+  size_t length = 0;
+  void *data = nullptr;
+  if (napi_get_typedarray_info(env, v, &type, &length, &data, nullptr,
+                               nullptr) != napi_ok) {
+    ThrowLastError(env, "napi_get_typedarray_info");
+    return false;
+  }
+
+  switch (type) {
+    case napi_float32_array:
+      ans->f = static_cast<const float *>(data);
+      ans->n = length;
+      return true;
+    case napi_int16_array:
+      ans->i16 = static_cast<const int16_t *>(data);
+      ans->n = length;
+      return true;
+    case napi_uint8_array:
+      ans->n = length / 2;
+      if (reinterpret_cast<uintptr_t>(data) % alignof(int16_t) == 0) {
+        ans->i16 = static_cast<const int16_t *>(data);
+      } else {
+        ans->copy.resize(ans->n);
+        std::memcpy(ans->copy.data(), data, ans->n * sizeof(int16_t));
+        ans->i16 = ans->copy.data();
+      }
+      return true;
+    default:
+      napi_throw_type_error(env, nullptr,
+                            "Expect a Float32Array, an Int16Array or a Buffer");
+      return false;
+  }
+}
+
+napi_value Undefined(napi_env env) {
+  napi_value ans;
+  napi_get_undefined(env, &ans);
+  return ans;
+}
+
+napi_value Boolean(napi_env env, bool b) {
+  napi_value ans;
+  napi_get_boolean(env, b, &ans);
+  return ans;
+}
+
+napi_value String(napi_env env, const char *s) {
+  napi_value ans;
+  napi_create_string_utf8(env, s, NAPI_AUTO_LENGTH, &ans);
+  return ans;
+}
+
+// Return {text, tokens, timestamps} and free r
+napi_value ResultToObject(napi_env env, SherpaNcnnResult *r) {
+  napi_value ans, tokens, timestamps;
+  napi_create_object(env, &ans);
+  napi_create_array_with_length(env, r->count, &tokens);
+  napi_create_array_with_length(env, r->count, &timestamps);
+
+  const char *p = r->tokens;
+  for (int32_t i = 0; i != r->count; ++i) {
+    napi_value t;
+    napi_create_double(env, r->timestamps[i], &t);
+
+    napi_set_element(env, tokens, i, String(env, p));
+    napi_set_element(env, timestamps, i, t);
+
+    p += std::strlen(p) + 1;
+  }
+
+  napi_set_named_property(env, ans, "text", String(env, r->text));
+  napi_set_named_property(env, ans, "tokens", tokens);
+  napi_set_named_property(env, ans, "timestamps", timestamps);
+
+  DestroyResult(r);
+
+  return ans;
+}
+
+// Get the streams of a JavaScript array. Return false and throw if one of
+// them is invalid or busy.
+template <typename T>
+bool GetStreams(napi_env env, napi_value v,
+                std::vector<std::shared_ptr<T>> *streams) {
+  bool is_array = false;
+  napi_is_array(env, v, &is_array);
+  if (!is_array) {
+    napi_throw_type_error(env, nullptr, "Expect an array of streams");
+    return false;
+  }
+
+  uint32_t n = 0;
+  napi_get_array_length(env, v, &n);
+  streams->reserve(n);
+
+  for (uint32_t i = 0; i != n; ++i) {
+    napi_value e;
+    napi_get_element(env, v, i, &e);
+
+    auto box = Unwrap<T>(env, e);
+    if (!box) {
+      return false;
+    }
+
+    if ((*box)->busy) {
+      napi_throw_error(env, nullptr, "A stream is already being decoded");
+      return false;
+    }
+
+    streams->push_back(*box);
+  }
+
+  return true;
+}
+
+// ============================================================
+// Streaming recognizer
+// ============================================================
+
+napi_value CreateRecognizerWrapper(napi_env env, napi_callback_info info) {
+  napi_value args[1];
+  if (!GetArgs(env, info, 1, args)) {
+    return nullptr;
+  }
+
+  std::deque<std::string> strings;
+  ConfigReader reader(env, args[0], &strings);
+  ConfigReader feat = reader.Child("featConfig");
+  ConfigReader model = reader.Child("modelConfig");
+  ConfigReader decoder = reader.Child("decoderConfig");
+
+  SherpaNcnnRecognizerConfig config;
+  std::memset(&config, 0, sizeof(config));
+
+  config.feat_config.sampling_rate = feat.GetFloat("samplingRate");
+  config.feat_config.feature_dim = feat.GetInt32("featureDim");
+
+  config.model_config.encoder_param = model.GetString("encoderParam");
+  config.model_config.encoder_bin = model.GetString("encoderBin");
+  config.model_config.decoder_param = model.GetString("decoderParam");
+  config.model_config.decoder_bin = model.GetString("decoderBin");
+  config.model_config.joiner_param = model.GetString("joinerParam");
+  config.model_config.joiner_bin = model.GetString("joinerBin");
+  config.model_config.tokens = model.GetString("tokens");
+  config.model_config.use_vulkan_compute = model.GetInt32("useVulkanCompute");
+  config.model_config.num_threads = model.GetInt32("numThreads");
+  config.model_config.decoder_num_threads =
+      model.GetInt32("decoderNumThreads");
+  config.model_config.joiner_num_threads = model.GetInt32("joinerNumThreads");
+  config.model_config.cpu_cores = model.GetString("cpuCores");
+  config.model_config.encoder_variants = model.GetString("encoderVariants");
+  config.model_config.arena_mb = model.GetInt32("arenaMb");
+
+  config.decoder_config.decoding_method =
+      decoder.GetString("decodingMethod", "greedy_search");
+  config.decoder_config.num_active_paths =
+      decoder.GetInt32("numActivePaths", 4);
+
+  config.enable_endpoint = reader.GetInt32("enableEndpoint");
+  config.rule1_min_trailing_silence =
+      reader.GetFloat("rule1MinTrailingSilence", 2.4);
+  config.rule2_min_trailing_silence =
+      reader.GetFloat("rule2MinTrailingSilence", 1.4);
+
+  // The WASM API spells it rule3MinUtternceLength
+  config.rule3_min_utterance_length = reader.GetFloat(
+      "rule3MinUtteranceLength", reader.GetFloat("rule3MinUtternceLength", 20));
+
+  config.hotwords_file = reader.GetString("hotwordsFile");
+  config.hotwords_score = reader.GetFloat("hotwordsScore");
+  config.enable_profiling = reader.GetInt32("enableProfiling");
+
+  SherpaNcnnRecognizer *p = CreateRecognizer(&config);
+  if (!p) {
+    napi_throw_error(env, nullptr,
+                     "Failed to create the recognizer. Please check your "
+                     "config");
+    return nullptr;
+  }
+
+  return Wrap(env, std::make_shared<Recognizer>(p));
+}
+
+// Drop the reference of JavaScript. It is destroyed after its last stream.
+template <typename T>
+napi_value Free(napi_env env, napi_callback_info info) {
+  napi_value args[1];
+  if (!GetArgs(env, info, 1, args)) {
+    return nullptr;
+  }
+
+  void *data = nullptr;
+  if (napi_get_value_external(env, args[0], &data) != napi_ok || !data) {
+    napi_throw_type_error(env, nullptr, "Expect a handle");
+    return nullptr;
+  }
+
+  static_cast<std::shared_ptr<T> *>(data)->reset();
+
+  return Undefined(env);
+}
+
+napi_value CreateStreamWrapper(napi_env env, napi_callback_info info) {
+  napi_value args[1];
+  if (!GetArgs(env, info, 1, args)) {
+    return nullptr;
+  }
+
+  auto recognizer = Unwrap<Recognizer>(env, args[0]);
+  if (!recognizer) {
+    return nullptr;
+  }
+
+  SherpaNcnnStream *s = CreateStream((*recognizer)->impl);
+  return Wrap(env, std::make_shared<Stream>(*recognizer, s));
+}
+
+// acceptWaveform(stream, sampleRate, samples)
+napi_value AcceptWaveformWrapper(napi_env env, napi_callback_info info) {
+  napi_value args[3];
+  if (!GetArgs(env, info, 3, args)) {
+    return nullptr;
+  }
+
+  Stream *s = GetIdleStream<Stream>(env, args[0]);
+  if (!s) {
+    return nullptr;
+  }
+
+  double sample_rate = 0;
+  SHERPA_NCNN_NAPI_CALL(env, napi_get_value_double(env, args[1], &sample_rate));
+
+  Samples samples;
+  if (!GetSamples(env, args[2], &samples)) {
+    return nullptr;
+  }
+
+  if (samples.f) {
+    AcceptWaveform(s->impl, sample_rate, samples.f, samples.n);
+  } else {
+    AcceptWaveformInt16(s->impl, sample_rate, samples.i16, samples.n);
+  }
+
+  return Undefined(env);
+}
+
+napi_value InputFinishedWrapper(napi_env env, napi_callback_info info) {
+  napi_value args[1];
+  if (!GetArgs(env, info, 1, args)) {
+    return nullptr;
+  }
+
+  Stream *s = GetIdleStream<Stream>(env, args[0]);
+  if (!s) {
+    return nullptr;
+  }
+
+  InputFinished(s->impl);
+
+  return Undefined(env);
+}
+
+napi_value IsReadyWrapper(napi_env env, napi_callback_info info) {
+  napi_value args[1];
+  if (!GetArgs(env, info, 1, args)) {
+    return nullptr;
+  }
+
+  Stream *s = GetIdleStream<Stream>(env, args[0]);
+  if (!s) {
+    return nullptr;
+  }
+
+  return Boolean(env, IsReady(s->recognizer->impl, s->impl));
+}
+
+napi_value IsEndpointWrapper(napi_env env, napi_callback_info info) {
+  napi_value args[1];
+  if (!GetArgs(env, info, 1, args)) {
+    return nullptr;
+  }
+
+  Stream *s = GetIdleStream<Stream>(env, args[0]);
+  if (!s) {
+    return nullptr;
+  }
+
+  return Boolean(env, IsEndpoint(s->recognizer->impl, s->impl));
+}
+
+napi_value ResetWrapper(napi_env env, napi_callback_info info) {
+  napi_value args[1];
+  if (!GetArgs(env, info, 1, args)) {
+    return nullptr;
+  }
+
+  Stream *s = GetIdleStream<Stream>(env, args[0]);
+  if (!s) {
+    return nullptr;
+  }
+
+  Reset(s->recognizer->impl, s->impl);
+
+  return Undefined(env);
+}
+
+napi_value GetResultWrapper(napi_env env, napi_callback_info info) {
+  napi_value args[1];
+  if (!GetArgs(env, info, 1, args)) {
+    return nullptr;
+  }
+
+  Stream *s = GetIdleStream<Stream>(env, args[0]);
+  if (!s) {
+    return nullptr;
+  }
+
+  return ResultToObject(env, GetResult(s->recognizer->impl, s->impl));
+}
+
+// Decode all ready chunks of the streams in batches. All streams must
+// belong to the same recognizer.
+int32_t DecodeReady(const std::vector<std::shared_ptr<Stream>> &streams) {
+  if (streams.empty()) {
+    return 0;
+  }
+
+  std::vector<SherpaNcnnStream *> ss(streams.size());
+  for (size_t i = 0; i != streams.size(); ++i) {
+    ss[i] = streams[i]->impl;
+  }
+
+  Recognizer *r = streams[0]->recognizer.get();
+  std::lock_guard<std::mutex> lock(r->mutex);
+  return DecodeReadyStreams(r->impl, ss.data(), ss.size());
+}
+
+bool SameRecognizer(napi_env env,
+                    const std::vector<std::shared_ptr<Stream>> &s,
+                    const std::shared_ptr<Recognizer> &r) {
+  for (const auto &p : s) {
+    if (p->recognizer != r) {
+      napi_throw_error(env, nullptr,
+                       "The streams must be created by the recognizer");
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// decode(recognizer, streams). Return the number of decoded chunks.
+napi_value DecodeWrapper(napi_env env, napi_callback_info info) {
+  napi_value args[2];
+  if (!GetArgs(env, info, 2, args)) {
+    return nullptr;
+  }
+
+  auto recognizer = Unwrap<Recognizer>(env, args[0]);
+  std::vector<std::shared_ptr<Stream>> streams;
+  if (!recognizer || !GetStreams(env, args[1], &streams) ||
+      !SameRecognizer(env, streams, *recognizer)) {
+    return nullptr;
+  }
+
+  napi_value ans;
+  napi_create_int32(env, DecodeReady(streams), &ans);
+  return ans;
+}
+
+struct DecodeWork {
+  napi_async_work work = nullptr;
+  napi_deferred deferred = nullptr;
+
+  // They are kept alive until the work is complete, even if they are
+  // freed in JavaScript in the meantime
+  std::vector<std::shared_ptr<Stream>> streams;
+  std::vector<std::shared_ptr<OfflineStream>> offline_streams;
+
+  int32_t num_decoded = 0;
+};
+
+void CompleteDecode(napi_env env, napi_status status, void *data) {
+  auto w = static_cast<DecodeWork *>(data);
+
+  for (auto &s : w->streams) {
+    s->busy = false;
+  }
+
+  for (auto &s : w->offline_streams) {
+    s->busy = false;
+  }
+
+  if (status == napi_ok) {
+    napi_value ans;
+    napi_create_int32(env, w->num_decoded, &ans);
+    napi_resolve_deferred(env, w->deferred, ans);
+  } else {
+    napi_value msg, error;
+    napi_create_string_utf8(env, "Failed to decode", NAPI_AUTO_LENGTH, &msg);
+    napi_create_error(env, nullptr, msg, &error);
+    napi_reject_deferred(env, w->deferred, error);
+  }
+
+  napi_delete_async_work(env, w->work);
+  delete w;
+}
+
+// Queue w. Return its promise.
+napi_value QueueDecode(napi_env env, std::unique_ptr<DecodeWork> w,
+                       napi_async_execute_callback execute) {
+  napi_value promise, name;
+  SHERPA_NCNN_NAPI_CALL(env, napi_create_promise(env, &w->deferred, &promise));
+  napi_create_string_utf8(env, "sherpa-ncnn decode", NAPI_AUTO_LENGTH, &name);
+
+  SHERPA_NCNN_NAPI_CALL(
+      env, napi_create_async_work(env, nullptr, name, execute, CompleteDecode,
+                                  w.get(), &w->work));
+  SHERPA_NCNN_NAPI_CALL(env, napi_queue_async_work(env, w->work));
+
+  for (auto &s : w->streams) {
+    s->busy = true;
+  }
+
+  for (auto &s : w->offline_streams) {
+    s->busy = true;
+  }
+
+  w.release();
+
+  return promise;
+}
+
+// decodeAsync(recognizer, streams). Like decode(), but it runs in a worker
+// thread and returns a promise of the number of decoded chunks.
+napi_value DecodeAsyncWrapper(napi_env env, napi_callback_info info) {
+  napi_value args[2];
+  if (!GetArgs(env, info, 2, args)) {
+    return nullptr;
+  }
+
+  auto w = std::make_unique<DecodeWork>();
+
+  auto recognizer = Unwrap<Recognizer>(env, args[0]);
+  if (!recognizer || !GetStreams(env, args[1], &w->streams) ||
+      !SameRecognizer(env, w->streams, *recognizer)) {
+    return nullptr;
+  }
+
+  return QueueDecode(env, std::move(w), [](napi_env /*env*/, void *data) {
+    auto w = static_cast<DecodeWork *>(data);
+    w->num_decoded = DecodeReady(w->streams);
+  });
+}
+
+// ============================================================
+// Non-streaming recognizer
+// ============================================================
+
+napi_value CreateOfflineRecognizerWrapper(napi_env env,
+                                          napi_callback_info info) {
+  napi_value args[1];
+  if (!GetArgs(env, info, 1, args)) {
+    return nullptr;
+  }
+
+  std::deque<std::string> strings;
+  ConfigReader reader(env, args[0], &strings);
+  ConfigReader model = reader.Child("modelConfig");
+  ConfigReader sense_voice = model.Child("senseVoice");
+
+  SherpaNcnnOfflineRecognizerConfig config;
+  std::memset(&config, 0, sizeof(config));
+
+  config.sense_voice.model_dir = sense_voice.GetString("modelDir");
+  config.sense_voice.language = sense_voice.GetString("language");
+  config.sense_voice.use_itn =
+      sense_voice.GetInt32("useInverseTextNormalization");
+
+  config.tokens = model.GetString("tokens");
+  config.num_threads = model.GetInt32("numThreads");
+
+  config.decoding_method = reader.GetString("decodingMethod");
+  config.max_active_paths = reader.GetInt32("maxActivePaths");
+  config.hotwords_file = reader.GetString("hotwordsFile");
+  config.hotwords_score = reader.GetFloat("hotwordsScore");
+  config.chunk_duration = reader.GetFloat("chunkDuration");
+  config.chunk_overlap = reader.GetFloat("chunkOverlap");
+  config.length_bucket = reader.GetFloat("lengthBucket");
+
+  SherpaNcnnOfflineRecognizer *p = SherpaNcnnCreateOfflineRecognizer(&config);
+  if (!p) {
+    napi_throw_error(env, nullptr,
+                     "Failed to create the offline recognizer. Please check "
+                     "your config");
+    return nullptr;
+  }
+
+  return Wrap(env, std::make_shared<OfflineRecognizer>(p));
+}
+
+napi_value CreateOfflineStreamWrapper(napi_env env, napi_callback_info info) {
+  napi_value args[1];
+  if (!GetArgs(env, info, 1, args)) {
+    return nullptr;
+  }
+
+  auto recognizer = Unwrap<OfflineRecognizer>(env, args[0]);
+  if (!recognizer) {
+    return nullptr;
+  }
+
+  SherpaNcnnOfflineStream *s =
+      SherpaNcnnCreateOfflineStream((*recognizer)->impl);
+  return Wrap(env, std::make_shared<OfflineStream>(*recognizer, s));
+}
+
+// acceptWaveformOffline(stream, sampleRate, samples)
+napi_value AcceptWaveformOfflineWrapper(napi_env env,
+                                        napi_callback_info info) {
+  napi_value args[3];
+  if (!GetArgs(env, info, 3, args)) {
+    return nullptr;
+  }
+
+  OfflineStream *s = GetIdleStream<OfflineStream>(env, args[0]);
+  if (!s) {
+    return nullptr;
+  }
+
+  int32_t sample_rate = 0;
+  SHERPA_NCNN_NAPI_CALL(env, napi_get_value_int32(env, args[1], &sample_rate));
+
+  Samples samples;
+  if (!GetSamples(env, args[2], &samples)) {
+    return nullptr;
+  }
+
+  if (samples.f) {
+    SherpaNcnnAcceptWaveformOffline(s->impl, sample_rate, samples.f,
+                                    samples.n);
+  } else {
+    SherpaNcnnAcceptWaveformInt16Offline(s->impl, sample_rate, samples.i16,
+                                         samples.n);
+  }
+
+  return Undefined(env);
+}
+
+// Decode the streams in batches. All streams must belong to the same
+// recognizer.
+void DecodeOffline(
+    const std::vector<std::shared_ptr<OfflineStream>> &streams) {
+  if (streams.empty()) {
+    return;
+  }
+
+  std::vector<SherpaNcnnOfflineStream *> ss(streams.size());
+  for (size_t i = 0; i != streams.size(); ++i) {
+    ss[i] = streams[i]->impl;
+  }
+
+  OfflineRecognizer *r = streams[0]->recognizer.get();
+  std::lock_guard<std::mutex> lock(r->mutex);
+  SherpaNcnnDecodeMultipleOfflineStreams(r->impl, ss.data(), ss.size());
+}
+
+bool SameRecognizer(napi_env env,
+                    const std::vector<std::shared_ptr<OfflineStream>> &s,
+                    const std::shared_ptr<OfflineRecognizer> &r) {
+  for (const auto &p : s) {
+    if (p->recognizer != r) {
+      napi_throw_error(env, nullptr,
+                       "The streams must be created by the recognizer");
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// decodeOffline(recognizer, streams)
+napi_value DecodeOfflineWrapper(napi_env env, napi_callback_info info) {
+  napi_value args[2];
+  if (!GetArgs(env, info, 2, args)) {
+    return nullptr;
+  }
+
+  auto recognizer = Unwrap<OfflineRecognizer>(env, args[0]);
+  std::vector<std::shared_ptr<OfflineStream>> streams;
+  if (!recognizer || !GetStreams(env, args[1], &streams) ||
+      !SameRecognizer(env, streams, *recognizer)) {
+    return nullptr;
+  }
+
+  DecodeOffline(streams);
+
+  return Undefined(env);
+}
+
+// decodeOfflineAsync(recognizer, streams). Return a promise.
+napi_value DecodeOfflineAsyncWrapper(napi_env env, napi_callback_info info) {
+  napi_value args[2];
+  if (!GetArgs(env, info, 2, args)) {
+    return nullptr;
+  }
+
+  auto w = std::make_unique<DecodeWork>();
+
+  auto recognizer = Unwrap<OfflineRecognizer>(env, args[0]);
+  if (!recognizer || !GetStreams(env, args[1], &w->offline_streams) ||
+      !SameRecognizer(env, w->offline_streams, *recognizer)) {
+    return nullptr;
+  }
+
+  w->num_decoded = w->offline_streams.size();
+
+  return QueueDecode(env, std::move(w), [](napi_env /*env*/, void *data) {
+    DecodeOffline(static_cast<DecodeWork *>(data)->offline_streams);
+  });
+}
+
+// Return the result as a JSON string
+napi_value GetOfflineResultWrapper(napi_env env, napi_callback_info info) {
+  napi_value args[1];
+  if (!GetArgs(env, info, 1, args)) {
+    return nullptr;
+  }
+
+  OfflineStream *s = GetIdleStream<OfflineStream>(env, args[0]);
+  if (!s) {
+    return nullptr;
+  }
+
+  const char *json = SherpaNcnnGetOfflineStreamResultAsJson(s->impl);
+  napi_value ans = String(env, json);
+  SherpaNcnnDestroyOfflineStreamResultJson(json);
+
+  return ans;
+}
+
+napi_property_descriptor Method(const char *name, napi_callback f) {
+  return {name, nullptr, f, nullptr, nullptr, nullptr, napi_enumerable,
+          nullptr};
+}
+
+}  // namespace
+
+NAPI_MODULE_INIT() {
+  napi_property_descriptor desc[] = {
+      Method("createRecognizer", CreateRecognizerWrapper),
+      Method("freeRecognizer", Free<Recognizer>),
+      Method("createStream", CreateStreamWrapper),
+      Method("freeStream", Free<Stream>),
+      Method("acceptWaveform", AcceptWaveformWrapper),
+      Method("inputFinished", InputFinishedWrapper),
+      Method("isReady", IsReadyWrapper),
+      Method("isEndpoint", IsEndpointWrapper),
+      Method("reset", ResetWrapper),
+      Method("getResult", GetResultWrapper),
+      Method("decode", DecodeWrapper),
+      Method("decodeAsync", DecodeAsyncWrapper),
+
+      Method("createOfflineRecognizer", CreateOfflineRecognizerWrapper),
+      Method("freeOfflineRecognizer", Free<OfflineRecognizer>),
+      Method("createOfflineStream", CreateOfflineStreamWrapper),
+      Method("freeOfflineStream", Free<OfflineStream>),
+      Method("acceptWaveformOffline", AcceptWaveformOfflineWrapper),
+      Method("decodeOffline", DecodeOfflineWrapper),
+      Method("decodeOfflineAsync", DecodeOfflineAsyncWrapper),
+      Method("getOfflineResult", GetOfflineResultWrapper),
+  };
+
+  napi_define_properties(env, exports, sizeof(desc) / sizeof(desc[0]), desc);
+
+  return exports;
+}
@@ -0,0 +1,322 @@
+// sherpa-ncnn/python/csrc/async.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+#include "sherpa-ncnn/python/csrc/async.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#endif
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <cstdint>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <stdexcept>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/offline-tts.h"
+#include "sherpa-ncnn/csrc/recognizer.h"
+
+namespace sherpa_ncnn {
+
+#ifndef _WIN32
+
+// Wake up an asyncio event loop from a native thread. The loop watches
+// Fd() with add_reader() and calls Drain() before it takes the events.
+// It is an eventfd on Linux and a pipe elsewhere.
+class EventNotifier {
+ public:
+  EventNotifier() {
+#if defined(__linux__)
+    read_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    write_fd_ = read_fd_;
+    if (read_fd_ < 0) {
+      throw std::runtime_error("eventfd() failed");
+    }
+#else
+    int fds[2];
+    if (pipe(fds) != 0) {
+      throw std::runtime_error("pipe() failed");
+    }
+
+    for (int fd : fds) {
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+      fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    read_fd_ = fds[0];
+    write_fd_ = fds[1];
+#endif
+  }
+
+  ~EventNotifier() {
+    close(read_fd_);
+    if (write_fd_ != read_fd_) {
+      close(write_fd_);
+    }
+  }
+
+  EventNotifier(const EventNotifier &) = delete;
+  EventNotifier &operator=(const EventNotifier &) = delete;
+
+  int32_t Fd() const { return read_fd_; }
+
+  void Notify() {
+    uint64_t one = 1;
+    // If it fails, the pipe is full and thus already readable
+#if defined(__linux__)
+    ssize_t n = write(write_fd_, &one, sizeof(one));
+#else
+    ssize_t n = write(write_fd_, &one, 1);
+#endif
+    (void)n;
+  }
+
+  void Drain() {
+    uint64_t buf[8];
+    while (read(read_fd_, buf, sizeof(buf)) > 0) {
+    }
+  }
+
+ private:
+  int read_fd_;
+  int write_fd_;
+};
+
+// Decode the streams of all pending Submit() calls together on one native
+// thread, so that the streams of many callers share batches.
+class AsyncDecoder {
+ public:
+  AsyncDecoder(const Recognizer *recognizer, int32_t max_batch_size)
+      : recognizer_(recognizer), max_batch_size_(max_batch_size) {
+    if (max_batch_size_ < 1) {
+      throw py::value_error("max_batch_size must be positive");
+    }
+
+    thread_ = std::thread([this]() { Run(); });
+  }
+
+  // Pending calls are dropped
+  ~AsyncDecoder() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+  }
+
+  AsyncDecoder(const AsyncDecoder &) = delete;
+  AsyncDecoder &operator=(const AsyncDecoder &) = delete;
+
+  // Decode ss until none of them is ready. The streams must outlive it.
+  // Return an id that TakeCompleted() returns once it is done.
+  int64_t Submit(std::vector<Stream *> ss) {
+    int64_t id = 0;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      id = next_id_++;
+      jobs_.push_back({id, std::move(ss)});
+    }
+    cv_.notify_one();
+    return id;
+  }
+
+  std::vector<int64_t> TakeCompleted() {
+    notifier_.Drain();
+
+    std::vector<int64_t> ans;
+    std::lock_guard<std::mutex> lock(mutex_);
+    ans.swap(completed_);
+    return ans;
+  }
+
+  int32_t Fd() const { return notifier_.Fd(); }
+
+ private:
+  struct Job {
+    int64_t id;
+    std::vector<Stream *> streams;
+  };
+
+  void Run() {
+    std::vector<Job> jobs;
+    std::vector<Stream *> ss;
+    std::vector<Stream *> ready;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return stop_ || !jobs_.empty(); });
+        if (stop_) {
+          return;
+        }
+        jobs.swap(jobs_);
+      }
+
+      // A stream may be passed by several calls
+      ss.clear();
+      for (const auto &job : jobs) {
+        ss.insert(ss.end(), job.streams.begin(), job.streams.end());
+      }
+      std::sort(ss.begin(), ss.end());
+      ss.erase(std::unique(ss.begin(), ss.end()), ss.end());
+
+      while (true) {
+        ready.clear();
+        for (auto *s : ss) {
+          if (recognizer_->IsReady(s)) {
+            ready.push_back(s);
+          }
+        }
+
+        if (ready.empty()) {
+          break;
+        }
+
+        int32_t num_ready = static_cast<int32_t>(ready.size());
+        for (int32_t i = 0; i < num_ready; i += max_batch_size_) {
+          int32_t n = std::min(max_batch_size_, num_ready - i);
+          recognizer_->DecodeStreams(ready.data() + i, n);
+        }
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto &job : jobs) {
+          completed_.push_back(job.id);
+        }
+      }
+      jobs.clear();
+      notifier_.Notify();
+    }
+  }
+
+ private:
+  const Recognizer *recognizer_;
+  int32_t max_batch_size_;
+  EventNotifier notifier_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<Job> jobs_;
+  std::vector<int64_t> completed_;
+  int64_t next_id_ = 0;
+  bool stop_ = false;
+
+  std::thread thread_;
+};
+
+// Generate the audio of one text on a native thread. Each piece of audio
+// passed to the callback of OfflineTts::Generate() is queued for Take().
+class AsyncTtsGeneration {
+ public:
+  AsyncTtsGeneration(const OfflineTts *tts, const TtsArgs &args)
+      : thread_([this, tts, args]() { Run(tts, args); }) {}
+
+  ~AsyncTtsGeneration() {
+    Cancel();
+    thread_.join();
+  }
+
+  AsyncTtsGeneration(const AsyncTtsGeneration &) = delete;
+  AsyncTtsGeneration &operator=(const AsyncTtsGeneration &) = delete;
+
+  // Stop after the current sentences
+  void Cancel() { cancelled_ = true; }
+
+  // Take the audio queued so far. done is set to true once the
+  // generation has finished and all of its audio is taken.
+  std::vector<std::vector<float>> Take(bool *done) {
+    notifier_.Drain();
+
+    std::vector<std::vector<float>> ans;
+    std::lock_guard<std::mutex> lock(mutex_);
+    ans.swap(chunks_);
+    *done = done_;
+    return ans;
+  }
+
+  int32_t Fd() const { return notifier_.Fd(); }
+
+ private:
+  void Run(const OfflineTts *tts, const TtsArgs &args) {
+    tts->Generate(args, [this](const float *samples, int32_t n,
+                               int32_t /*processed*/, int32_t /*total*/,
+                               void * /*arg*/) -> int32_t {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        chunks_.emplace_back(samples, samples + n);
+      }
+      notifier_.Notify();
+      return cancelled_ ? 0 : 1;
+    });
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      done_ = true;
+    }
+    notifier_.Notify();
+  }
+
+ private:
+  EventNotifier notifier_;
+  std::atomic<bool> cancelled_{false};
+
+  std::mutex mutex_;
+  std::vector<std::vector<float>> chunks_;
+  bool done_ = false;
+
+  // It is the last member so that the others are constructed before the
+  // thread starts
+  std::thread thread_;
+};
+
+static void PybindAsyncDecoder(py::module *m) {
+  using PyClass = AsyncDecoder;
+  py::class_<PyClass>(*m, "AsyncDecoder")
+      .def(py::init<const Recognizer *, int32_t>(), py::arg("recognizer"),
+           py::arg("max_batch_size") = 32, py::keep_alive<1, 2>())
+      .def("submit", &PyClass::Submit, py::arg("ss"))
+      .def("take_completed", &PyClass::TakeCompleted)
+      .def("fileno", &PyClass::Fd);
+}
+
+static void PybindAsyncTtsGeneration(py::module *m) {
+  using PyClass = AsyncTtsGeneration;
+  py::class_<PyClass>(*m, "AsyncTtsGeneration")
+      .def(py::init<const OfflineTts *, const TtsArgs &>(), py::arg("tts"),
+           py::arg("args"), py::keep_alive<1, 2>())
+      .def("cancel", &PyClass::Cancel)
+      .def("take",
+           [](PyClass &self) {
+             bool done = false;
+             std::vector<std::vector<float>> chunks = self.Take(&done);
+
+             py::list ans;
+             for (const auto &c : chunks) {
+               ans.append(py::array_t<float>(c.size(), c.data()));
+             }
+             return py::make_tuple(ans, done);
+           })
+      .def("fileno", &PyClass::Fd);
+}
+
+void PybindAsync(py::module *m) {
+  PybindAsyncDecoder(m);
+  PybindAsyncTtsGeneration(m);
+}
+
+#else
+
+void PybindAsync(py::module * /*m*/) {}
+
+#endif
+
+}  // namespace sherpa_ncnn
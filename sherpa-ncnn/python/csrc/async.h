@@ -0,0 +1,18 @@
+// sherpa-ncnn/python/csrc/async.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_PYTHON_CSRC_ASYNC_H_
+#define SHERPA_NCNN_PYTHON_CSRC_ASYNC_H_
+
+#include "sherpa-ncnn/python/csrc/sherpa-ncnn.h"
+
+namespace sherpa_ncnn {
+
+// Native helpers of sherpa_ncnn/aio.py. They are not available on Windows,
+// whose default event loop cannot watch a file descriptor.
+void PybindAsync(py::module *m);
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_PYTHON_CSRC_ASYNC_H_
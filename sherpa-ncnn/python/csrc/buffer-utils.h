@@ -0,0 +1,127 @@
+// sherpa-ncnn/python/csrc/buffer-utils.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_PYTHON_CSRC_BUFFER_UTILS_H_
+#define SHERPA_NCNN_PYTHON_CSRC_BUFFER_UTILS_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "sherpa-ncnn/python/csrc/sherpa-ncnn.h"
+
+namespace sherpa_ncnn {
+
+/** Pass the samples of waveform to s->AcceptWaveform() or, for int16
+ * samples, s->AcceptWaveformInt16(). A 1-D contiguous buffer of float32 or
+ * int16 samples, e.g., a numpy array or a memoryview, is used in place.
+ * Others, e.g., float64 arrays, are converted to float32 first. The GIL is
+ * released while the stream processes the samples.
+ *
+ * float32 samples must be normalized to [-1, 1]. int16 samples are scaled
+ * by 1/32768.
+ */
+template <typename Stream>
+void AcceptWaveformBuffer(Stream *s, float sample_rate,
+                          const py::buffer &waveform) {
+  py::buffer_info info = waveform.request();
+  if (info.ndim != 1) {
+    throw py::value_error("Expect a 1-D waveform. Given: " +
+                          std::to_string(info.ndim) + "-D");
+  }
+
+  int32_t n = static_cast<int32_t>(info.shape[0]);
+  bool contiguous = n < 2 || info.strides[0] == info.itemsize;
+
+  // info keeps the memory alive and is released after the GIL is taken
+  // back
+  if (contiguous && info.item_type_is_equivalent_to<float>()) {
+    py::gil_scoped_release release;
+    s->AcceptWaveform(sample_rate, static_cast<const float *>(info.ptr), n);
+    return;
+  }
+
+  if (contiguous && info.item_type_is_equivalent_to<int16_t>()) {
+    py::gil_scoped_release release;
+    s->AcceptWaveformInt16(sample_rate, static_cast<const int16_t *>(info.ptr),
+                           n);
+    return;
+  }
+
+  auto samples =
+      py::array_t<float, py::array::c_style | py::array::forcecast>::ensure(
+          waveform);
+  if (!samples) {
+    throw py::error_already_set();
+  }
+
+  py::gil_scoped_release release;
+  s->AcceptWaveform(sample_rate, samples.data(), n);
+}
+
+/** Pass channel c of waveform, a 2-D buffer of shape (num_frames,
+ * num_channels), to streams[c]. As with AcceptWaveformBuffer(), C-contiguous
+ * float32 and int16 buffers are used in place and the GIL is released.
+ */
+template <typename Stream>
+void AcceptInterleavedWaveformBuffer(std::vector<Stream *> streams,
+                                     float sample_rate,
+                                     const py::buffer &waveform) {
+  py::buffer_info info = waveform.request();
+  if (info.ndim != 2) {
+    throw py::value_error("Expect a 2-D waveform. Given: " +
+                          std::to_string(info.ndim) + "-D");
+  }
+
+  int32_t n = static_cast<int32_t>(info.shape[0]);
+  int32_t num_channels = static_cast<int32_t>(info.shape[1]);
+  if (num_channels != static_cast<int32_t>(streams.size())) {
+    throw py::value_error("Expect " + std::to_string(streams.size()) +
+                          " channels. Given: " + std::to_string(num_channels));
+  }
+
+  Stream **ss = streams.data();
+  bool contiguous = info.strides[1] == info.itemsize &&
+                    info.strides[0] == info.itemsize * num_channels;
+
+  if (contiguous && info.item_type_is_equivalent_to<float>()) {
+    py::gil_scoped_release release;
+    Stream::AcceptInterleavedWaveform(ss, num_channels, sample_rate,
+                                      static_cast<const float *>(info.ptr), n);
+    return;
+  }
+
+  if (contiguous && info.item_type_is_equivalent_to<int16_t>()) {
+    py::gil_scoped_release release;
+    Stream::AcceptInterleavedWaveformInt16(
+        ss, num_channels, sample_rate, static_cast<const int16_t *>(info.ptr),
+        n);
+    return;
+  }
+
+  auto samples =
+      py::array_t<float, py::array::c_style | py::array::forcecast>::ensure(
+          waveform);
+  if (!samples) {
+    throw py::error_already_set();
+  }
+
+  py::gil_scoped_release release;
+  Stream::AcceptInterleavedWaveform(ss, num_channels, sample_rate,
+                                    samples.data(), n);
+}
+
+/** Return a read-only numpy array that refers to v. owner is the Python
+ * object that owns v and is kept alive by the array.
+ */
+template <typename T>
+py::array_t<T> ToArrayView(const std::vector<T> &v, py::handle owner) {
+  py::array_t<T> ans(v.size(), v.data(), owner);
+  ans.attr("setflags")(py::arg("write") = false);
+  return ans;
+}
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_PYTHON_CSRC_BUFFER_UTILS_H_
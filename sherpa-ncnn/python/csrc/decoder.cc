@@ -31,6 +31,15 @@ void PybindDecoder(py::module *m) {
            py::arg("num_active_paths"))
       .def_readwrite("method", &PyClass::method)
       .def_readwrite("num_active_paths", &PyClass::num_active_paths)
+      .def_readwrite("decoder_cache_size", &PyClass::decoder_cache_size)
+      .def_readwrite("blank_skip_threshold", &PyClass::blank_skip_threshold)
+      .def_readwrite("speculative_joiner", &PyClass::speculative_joiner)
+      .def_readwrite("token_shortlist", &PyClass::token_shortlist)
+      .def_readwrite("lm", &PyClass::lm)
+      .def_readwrite("lm_scale", &PyClass::lm_scale)
+      .def_readwrite("beam", &PyClass::beam)
+      .def_readwrite("min_active_paths", &PyClass::min_active_paths)
+      .def_readwrite("hotwords_before_topk", &PyClass::hotwords_before_topk)
       .def("__str__", &PyClass::ToString);
 }
 
@@ -36,6 +36,10 @@ void PybindFeatures(py::module *m) {
            py::arg("sampling_rate"), py::arg("feature_dim"))
       .def_readwrite("sampling_rate", &PyClass::sampling_rate)
       .def_readwrite("feature_dim", &PyClass::feature_dim)
+      .def_readwrite("lock_free", &PyClass::lock_free)
+      .def_readwrite("use_batch_fbank", &PyClass::use_batch_fbank)
+      .def_readwrite("use_vulkan_fbank", &PyClass::use_vulkan_fbank)
+      .def_readwrite("feature_storage", &PyClass::feature_storage)
       .def("__str__", &PyClass::ToString);
 }
 
@@ -0,0 +1,59 @@
+// sherpa-ncnn/python/csrc/latency-stats.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/python/csrc/latency-stats.h"
+
+#include "sherpa-ncnn/csrc/latency-stats.h"
+#include "sherpa-ncnn/csrc/metrics.h"
+#include "sherpa-ncnn/csrc/trace.h"
+
+namespace sherpa_ncnn {
+
+static void PybindStage(py::module *m) {
+  py::enum_<Stage>(*m, "Stage")
+      .value("feature_extraction", Stage::kFeatureExtraction)
+      .value("encoder", Stage::kEncoder)
+      .value("decoder", Stage::kDecoder)
+      .value("joiner", Stage::kJoiner)
+      .value("search", Stage::kSearch)
+      .value("tts_front_end", Stage::kTtsFrontEnd)
+      .value("tts_encoder", Stage::kTtsEncoder)
+      .value("tts_duration_predictor", Stage::kTtsDurationPredictor)
+      .value("tts_path_attention", Stage::kTtsPathAttention)
+      .value("tts_flow", Stage::kTtsFlow)
+      .value("tts_vocoder", Stage::kTtsVocoder);
+}
+
+static void PybindStageSummary(py::module *m) {
+  using PyClass = StageSummary;
+  py::class_<PyClass>(*m, "StageSummary")
+      .def_readonly("count", &PyClass::count)
+      .def_readonly("total_ms", &PyClass::total_ms)
+      .def_readonly("mean_ms", &PyClass::mean_ms)
+      .def_readonly("p50_ms", &PyClass::p50_ms)
+      .def_readonly("p99_ms", &PyClass::p99_ms)
+      .def_readonly("max_ms", &PyClass::max_ms)
+      .def("__str__", &PyClass::ToString);
+}
+
+void PybindLatencyStats(py::module *m) {
+  PybindStage(m);
+  PybindStageSummary(m);
+
+  using PyClass = LatencyStats;
+  py::class_<PyClass>(*m, "LatencyStats")
+      .def("summary", &PyClass::Summary, py::arg("stage"))
+      .def("reset", &PyClass::Reset)
+      .def("__str__", &PyClass::ToString);
+
+  // See Tracer. The spans are written in the Chrome trace event format.
+  m->def("start_trace", &Tracer::Start, py::arg("filename"));
+  m->def("stop_trace", &Tracer::Stop);
+
+  // See Metrics. get_metrics() returns the OpenMetrics text format.
+  m->def("enable_metrics", &Metrics::Enable, py::arg("enabled"));
+  m->def("get_metrics", &Metrics::ToOpenMetrics);
+}
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,16 @@
+// sherpa-ncnn/python/csrc/latency-stats.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_PYTHON_CSRC_LATENCY_STATS_H_
+#define SHERPA_NCNN_PYTHON_CSRC_LATENCY_STATS_H_
+
+#include "sherpa-ncnn/python/csrc/sherpa-ncnn.h"
+
+namespace sherpa_ncnn {
+
+void PybindLatencyStats(py::module *m);
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_PYTHON_CSRC_LATENCY_STATS_H_
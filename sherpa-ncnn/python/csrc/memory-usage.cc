@@ -0,0 +1,48 @@
+// sherpa-ncnn/python/csrc/memory-usage.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/python/csrc/memory-usage.h"
+
+#include <memory>
+
+#include "sherpa-ncnn/csrc/memory-usage.h"
+
+namespace sherpa_ncnn {
+
+static void PybindModelMemoryUsage(py::module *m) {
+  using PyClass = ModelMemoryUsage;
+  py::class_<PyClass>(*m, "ModelMemoryUsage")
+      .def_readonly("encoder_weights", &PyClass::encoder_weights)
+      .def_readonly("decoder_weights", &PyClass::decoder_weights)
+      .def_readonly("joiner_weights", &PyClass::joiner_weights)
+      .def_readonly("blob_high_water_mark", &PyClass::blob_high_water_mark)
+      .def_readonly("workspace_high_water_mark",
+                    &PyClass::workspace_high_water_mark)
+      .def_property_readonly("total", &PyClass::Total)
+      .def("__str__", &PyClass::ToString);
+}
+
+static void PybindStreamMemoryUsage(py::module *m) {
+  using PyClass = StreamMemoryUsage;
+  py::class_<PyClass>(*m, "StreamMemoryUsage")
+      .def_readonly("encoder_states", &PyClass::encoder_states)
+      .def_readonly("features", &PyClass::features)
+      .def_readonly("hypotheses", &PyClass::hypotheses)
+      .def_readonly("context_graph", &PyClass::context_graph)
+      .def_property_readonly("total", &PyClass::Total)
+      .def("__str__", &PyClass::ToString);
+}
+
+void PybindMemoryUsage(py::module *m) {
+  PybindModelMemoryUsage(m);
+  PybindStreamMemoryUsage(m);
+
+  using PyClass = MemoryBudget;
+  py::class_<PyClass, std::shared_ptr<PyClass>>(*m, "MemoryBudget")
+      .def(py::init<std::size_t>(), py::arg("limit"))
+      .def_property_readonly("used", &PyClass::Used)
+      .def_property_readonly("limit", &PyClass::Limit);
+}
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,16 @@
+// sherpa-ncnn/python/csrc/memory-usage.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_PYTHON_CSRC_MEMORY_USAGE_H_
+#define SHERPA_NCNN_PYTHON_CSRC_MEMORY_USAGE_H_
+
+#include "sherpa-ncnn/python/csrc/sherpa-ncnn.h"
+
+namespace sherpa_ncnn {
+
+void PybindMemoryUsage(py::module *m);
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_PYTHON_CSRC_MEMORY_USAGE_H_
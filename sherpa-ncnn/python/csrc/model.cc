@@ -20,6 +20,8 @@
 
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "sherpa-ncnn/csrc/model.h"
 
@@ -81,7 +83,59 @@ static void PybindModelConfig(py::module *m) {
            py::arg("encoder_param"), py::arg("encoder_bin"),
            py::arg("decoder_param"), py::arg("decoder_bin"),
            py::arg("joiner_param"), py::arg("joiner_bin"),
-           py::arg("num_threads"), py::arg("tokens"), kModelConfigInitDoc);
+           py::arg("num_threads"), py::arg("tokens"), kModelConfigInitDoc)
+      .def_readwrite("use_vulkan_compute", &PyClass::use_vulkan_compute)
+      .def_readwrite("encoder_device", &PyClass::encoder_device)
+      .def_readwrite("decoder_device", &PyClass::decoder_device)
+      .def_readwrite("joiner_device", &PyClass::joiner_device)
+      .def_readwrite("encoder_powersave", &PyClass::encoder_powersave)
+      .def_readwrite("decoder_powersave", &PyClass::decoder_powersave)
+      .def_readwrite("joiner_powersave", &PyClass::joiner_powersave)
+      .def_readwrite("cpu_cores", &PyClass::cpu_cores)
+      .def_readwrite("encoder_precision", &PyClass::encoder_precision)
+      .def_readwrite("decoder_precision", &PyClass::decoder_precision)
+      .def_readwrite("joiner_precision", &PyClass::joiner_precision)
+      .def_readwrite("cache_dir", &PyClass::cache_dir)
+      .def_readwrite("perf_profile", &PyClass::perf_profile)
+      .def_property(
+          "encoder_variants",
+          [](const PyClass &self) {
+            std::vector<std::pair<std::string, std::string>> ans;
+            for (const auto &v : self.encoder_variants) {
+              ans.emplace_back(v.param, v.bin);
+            }
+            return ans;
+          },
+          [](PyClass &self,
+             const std::vector<std::pair<std::string, std::string>> &v) {
+            self.encoder_variants.clear();
+            for (const auto &p : v) {
+              self.encoder_variants.push_back({p.first, p.second});
+            }
+          })
+      .def_property(
+          "encoder_num_threads",
+          [](const PyClass &self) { return self.encoder_opt.num_threads; },
+          [](PyClass &self, int32_t n) { self.encoder_opt.num_threads = n; })
+      .def_property(
+          "decoder_num_threads",
+          [](const PyClass &self) { return self.decoder_opt.num_threads; },
+          [](PyClass &self, int32_t n) { self.decoder_opt.num_threads = n; })
+      .def_property(
+          "joiner_num_threads",
+          [](const PyClass &self) { return self.joiner_opt.num_threads; },
+          [](PyClass &self, int32_t n) { self.joiner_opt.num_threads = n; })
+      .def_readwrite("use_pool_allocator", &PyClass::use_pool_allocator)
+      .def_readwrite("pool_per_thread", &PyClass::pool_per_thread)
+      .def_readwrite("pool_limit_mb", &PyClass::pool_limit_mb)
+      .def_readwrite("arena_mb", &PyClass::arena_mb)
+      .def_readwrite("use_mmap", &PyClass::use_mmap)
+      .def_readwrite("use_huge_pages", &PyClass::use_huge_pages)
+      .def_readwrite("lstm_chunks_per_run", &PyClass::lstm_chunks_per_run)
+      .def_readwrite("early_exit_threshold", &PyClass::early_exit_threshold)
+      .def_readwrite("remote_encoder", &PyClass::remote_encoder)
+      .def_readwrite("bundle", &PyClass::bundle)
+      .def("__str__", &PyClass::ToString);
 }
 
 void PybindModel(py::module *m) { PybindModelConfig(m); }
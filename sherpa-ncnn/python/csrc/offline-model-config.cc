@@ -26,6 +26,14 @@ void PybindOfflineModelConfig(py::module *m) {
       .def_readwrite("tokens", &PyClass::tokens)
       .def_readwrite("num_threads", &PyClass::num_threads)
       .def_readwrite("debug", &PyClass::debug)
+      .def_readwrite("device", &PyClass::device)
+      .def_readwrite("precision", &PyClass::precision)
+      .def_readwrite("perf_profile", &PyClass::perf_profile)
+      .def_readwrite("use_mmap", &PyClass::use_mmap)
+      .def_readwrite("use_huge_pages", &PyClass::use_huge_pages)
+      .def_readwrite("use_pool_allocator", &PyClass::use_pool_allocator)
+      .def_readwrite("pool_per_thread", &PyClass::pool_per_thread)
+      .def_readwrite("pool_limit_mb", &PyClass::pool_limit_mb)
       .def("validate", &PyClass::Validate)
       .def("__str__", &PyClass::ToString);
 }
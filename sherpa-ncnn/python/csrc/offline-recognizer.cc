@@ -18,15 +18,24 @@ static void PybindOfflineRecognizerConfig(py::module *m) {
   using PyClass = OfflineRecognizerConfig;
   py::class_<PyClass>(*m, "OfflineRecognizerConfig")
       .def(py::init<const FeatureExtractorConfig &, const OfflineModelConfig &,
+                    const std::string &, float, float, float, int32_t,
                     const std::string &, float>(),
            py::arg("feat_config") = FeatureExtractorConfig(),
            py::arg("model_config") = OfflineModelConfig(),
            py::arg("decoding_method") = "greedy_search",
-           py::arg("blank_penalty") = 0.0)
+           py::arg("blank_penalty") = 0.0, py::arg("chunk_duration") = 0,
+           py::arg("chunk_overlap") = 2, py::arg("max_active_paths") = 4,
+           py::arg("hotwords_file") = "", py::arg("hotwords_score") = 1.5)
       .def_readwrite("feat_config", &PyClass::feat_config)
       .def_readwrite("model_config", &PyClass::model_config)
       .def_readwrite("decoding_method", &PyClass::decoding_method)
       .def_readwrite("blank_penalty", &PyClass::blank_penalty)
+      .def_readwrite("chunk_duration", &PyClass::chunk_duration)
+      .def_readwrite("chunk_overlap", &PyClass::chunk_overlap)
+      .def_readwrite("length_bucket", &PyClass::length_bucket)
+      .def_readwrite("max_active_paths", &PyClass::max_active_paths)
+      .def_readwrite("hotwords_file", &PyClass::hotwords_file)
+      .def_readwrite("hotwords_score", &PyClass::hotwords_score)
       .def("validate", &PyClass::Validate)
       .def("__str__", &PyClass::ToString);
 }
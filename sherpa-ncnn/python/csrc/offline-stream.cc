@@ -7,6 +7,7 @@
 #include <vector>
 
 #include "sherpa-ncnn/csrc/offline-stream.h"
+#include "sherpa-ncnn/python/csrc/buffer-utils.h"
 
 namespace sherpa_ncnn {
 
@@ -18,8 +19,12 @@ Args:
     Sample rate of the input samples. If it is different from the one
     expected by the model, we will do resampling inside.
   waveform:
-    A 1-D float32 tensor containing audio samples. It must be normalized
-    to the range [-1, 1].
+    A 1-D contiguous float32 or int16 array, e.g., a numpy array or a
+    memoryview, which is used without copying it, or a list of floats.
+    float32 samples must be normalized to the range [-1, 1]. int16
+    samples are scaled by 1/32768.
+
+It can be called many times. Call input_finished() after the last call.
 )";
 
 static void PybindOfflineRecognizerResult(py::module *m) {  // NOLINT
@@ -40,8 +45,13 @@ static void PybindOfflineRecognizerResult(py::module *m) {  // NOLINT
                              [](const PyClass &self) { return self.event; })
       .def_property_readonly("tokens",
                              [](const PyClass &self) { return self.tokens; })
-      .def_property_readonly(
-          "timestamps", [](const PyClass &self) { return self.timestamps; });
+      // A copy, since the result is replaced if the stream is decoded again
+      .def_property_readonly("timestamps",
+                             [](const PyClass &self) {
+                               return py::array_t<float>(
+                                   self.timestamps.size(),
+                                   self.timestamps.data());
+                             });
 }
 
 void PybindOfflineStream(py::module *m) {
@@ -49,6 +59,12 @@ void PybindOfflineStream(py::module *m) {
 
   using PyClass = OfflineStream;
   py::class_<PyClass>(*m, "OfflineStream")
+      .def(
+          "accept_waveform",
+          [](PyClass &self, float sample_rate, py::buffer waveform) {
+            AcceptWaveformBuffer(&self, sample_rate, waveform);
+          },
+          py::arg("sample_rate"), py::arg("waveform"), kAcceptWaveformUsage)
       .def(
           "accept_waveform",
           [](PyClass &self, float sample_rate,
@@ -57,6 +73,8 @@ void PybindOfflineStream(py::module *m) {
           },
           py::arg("sample_rate"), py::arg("waveform"), kAcceptWaveformUsage,
           py::call_guard<py::gil_scoped_release>())
+      .def("input_finished", &PyClass::InputFinished,
+           py::call_guard<py::gil_scoped_release>())
       .def_property_readonly("result", &PyClass::GetResult);
 }
 
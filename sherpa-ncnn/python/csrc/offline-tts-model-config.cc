@@ -23,7 +23,18 @@ void PybindOfflineTtsModelConfig(py::module *m) {
            py::arg("num_threads") = 1, py::arg("debug") = false)
       .def_readwrite("vits", &PyClass::vits)
       .def_readwrite("num_threads", &PyClass::num_threads)
+      .def_readwrite("encoder_num_threads", &PyClass::encoder_num_threads)
+      .def_readwrite("decoder_num_threads", &PyClass::decoder_num_threads)
+      .def_readwrite("encoder_device", &PyClass::encoder_device)
+      .def_readwrite("decoder_device", &PyClass::decoder_device)
+      .def_readwrite("encoder_precision", &PyClass::encoder_precision)
+      .def_readwrite("decoder_precision", &PyClass::decoder_precision)
+      .def_readwrite("perf_profile", &PyClass::perf_profile)
       .def_readwrite("debug", &PyClass::debug)
+      .def_readwrite("use_mmap", &PyClass::use_mmap)
+      .def_readwrite("use_pool_allocator", &PyClass::use_pool_allocator)
+      .def_readwrite("pool_per_thread", &PyClass::pool_per_thread)
+      .def_readwrite("pool_limit_mb", &PyClass::pool_limit_mb)
       .def("__str__", &PyClass::ToString)
       .def("validate", &PyClass::Validate);
 }
@@ -17,6 +17,10 @@ void PybindOfflineTtsVitsModelConfig(py::module *m) {
       .def(py::init<>())
       .def(py::init<const std::string &>(), py::arg("model_dir") = "")
       .def_readwrite("model_dir", &PyClass::model_dir)
+      .def_readwrite("bundle", &PyClass::bundle)
+      .def_readwrite("precompute_speaker_embeddings",
+                     &PyClass::precompute_speaker_embeddings)
+      .def_readwrite("use_int8", &PyClass::use_int8)
       .def("__str__", &PyClass::ToString)
       .def("validate", &PyClass::Validate);
 }
@@ -43,6 +43,7 @@ static void PybindTtsArgs(py::module *m) {
       .def_readwrite("speed", &PyClass::speed)
       .def_readwrite("noise_scale", &PyClass::noise_scale)
       .def_readwrite("noise_scale_w", &PyClass::noise_scale_w)
+      .def_readwrite("seed", &PyClass::seed)
       .def("__str__", [](PyClass &self) {
         std::ostringstream os;
         os << "TtsArgs(";
@@ -70,6 +71,7 @@ static void PybindTtsArgs(py::module *m) {
         os << ", speed=" << self.speed;
         os << ", noise_scale=" << self.noise_scale;
         os << ", noise_scale_w=" << self.noise_scale_w;
+        os << ", seed=" << self.seed;
         os << ")";
         return os.str();
       });
@@ -90,6 +92,17 @@ static void PybindOfflineTtsConfig(py::module *m) {
       .def_readwrite("rule_fsts", &PyClass::rule_fsts)
       .def_readwrite("rule_fars", &PyClass::rule_fars)
       .def_readwrite("max_num_sentences", &PyClass::max_num_sentences)
+      .def_readwrite("num_workers", &PyClass::num_workers)
+      .def_readwrite("enable_pipeline", &PyClass::enable_pipeline)
+      .def_readwrite("max_concurrent_requests",
+                     &PyClass::max_concurrent_requests)
+      .def_readwrite("decoder_chunk_size", &PyClass::decoder_chunk_size)
+      .def_readwrite("decoder_chunk_overlap", &PyClass::decoder_chunk_overlap)
+      .def_readwrite("token_cache_size", &PyClass::token_cache_size)
+      .def_readwrite("seed", &PyClass::seed)
+      .def_readwrite("audio_cache_size", &PyClass::audio_cache_size)
+      .def_readwrite("audio_cache_dir", &PyClass::audio_cache_dir)
+      .def_readwrite("enable_profiling", &PyClass::enable_profiling)
       .def_readwrite("silence_scale", &PyClass::silence_scale)
       .def("validate", &PyClass::Validate)
       .def("__str__", &PyClass::ToString);
@@ -106,6 +119,12 @@ void PybindOfflineTts(py::module *m) {
            py::call_guard<py::gil_scoped_release>())
       .def_property_readonly("sample_rate", &PyClass::SampleRate)
       .def_property_readonly("num_speakers", &PyClass::NumSpeakers)
+      .def(
+          "get_latency_stats",
+          [](const PyClass &self) { return self.GetLatencyStats(); },
+          py::return_value_policy::reference_internal)
+      .def("set_speaker_embedding", &PyClass::SetSpeakerEmbedding,
+           py::arg("sid"), py::arg("embedding"))
       .def(
           "generate",
           [](const PyClass &self, const TtsArgs &args,
@@ -135,7 +154,9 @@ void PybindOfflineTts(py::module *m) {
             return self.Generate(args, callback_wrapper);
           },
           py::arg("args"), py::arg("callback") = py::none(),
-          py::call_guard<py::gil_scoped_release>());
+          py::call_guard<py::gil_scoped_release>())
+      .def("generate_batch", &PyClass::GenerateBatch, py::arg("args"),
+           py::call_guard<py::gil_scoped_release>());
 }
 
 }  // namespace sherpa_ncnn
@@ -19,13 +19,30 @@
 #include "sherpa-ncnn/python/csrc/recognizer.h"
 
 #include <memory>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
 #include "sherpa-ncnn/csrc/recognizer.h"
+#include "sherpa-ncnn/python/csrc/buffer-utils.h"
 
 namespace sherpa_ncnn {
 
+// CreateStream*() returns nullptr if the hotwords are invalid or if
+// RecognizerConfig::memory_budget cannot afford another stream
+static std::unique_ptr<Stream> CheckStream(std::unique_ptr<Stream> s,
+                                           const std::string &hotwords) {
+  if (!s) {
+    if (!hotwords.empty()) {
+      throw py::value_error("Invalid hotwords or the memory budget is "
+                            "exhausted. Given hotwords: " +
+                            hotwords);
+    }
+    throw std::runtime_error("The memory budget is exhausted");
+  }
+  return s;
+}
+
 static constexpr const char *kRecognizerConfigInitDoc = R"doc(
 Constructor for RecognizerConfig.
 
@@ -47,16 +64,19 @@ static void PybindRecognitionResult(py::module *m) {
   py::class_<PyClass>(*m, "RecognitionResult")
       .def_property_readonly(
           "text", [](PyClass &self) -> std::string { return self.text; })
-      .def_property_readonly(
-          "tokens",
-          [](PyClass &self) -> std::vector<int> { return self.tokens; })
+      // Read-only numpy arrays that refer to the result
+      .def_property_readonly("tokens",
+                             [](py::object self) {
+                               return ToArrayView(
+                                   self.cast<const PyClass &>().tokens, self);
+                             })
       .def_property_readonly("stokens",
                              [](PyClass &self) -> std::vector<std::string> {
                                return self.stokens;
                              })
-      .def_property_readonly(
-          "timestamps",
-          [](PyClass &self) -> std::vector<float> { return self.timestamps; });
+      .def_property_readonly("timestamps", [](py::object self) {
+        return ToArrayView(self.cast<const PyClass &>().timestamps, self);
+      });
 }
 
 static void PybindRecognizerConfig(py::module *m) {
@@ -76,7 +96,12 @@ static void PybindRecognizerConfig(py::module *m) {
       .def_readwrite("endpoint_config", &PyClass::endpoint_config)
       .def_readwrite("enable_endpoint", &PyClass::enable_endpoint)
       .def_readwrite("hotwords_file", &PyClass::hotwords_file)
-      .def_readwrite("hotwords_score", &PyClass::hotwords_score);
+      .def_readwrite("hotwords_score", &PyClass::hotwords_score)
+      .def_readwrite("enable_profiling", &PyClass::enable_profiling)
+      .def_readwrite("fp16_states", &PyClass::fp16_states)
+      .def_readwrite("pipeline_search", &PyClass::pipeline_search)
+      .def_readwrite("publish_results", &PyClass::publish_results)
+      .def_readwrite("memory_budget", &PyClass::memory_budget);
 }
 
 void PybindRecognizer(py::module *m) {
@@ -85,13 +110,75 @@ void PybindRecognizer(py::module *m) {
 
   using PyClass = Recognizer;
   py::class_<PyClass>(*m, "Recognizer")
-      .def(py::init<const RecognizerConfig &>(), py::arg("config"))
-      .def("create_stream", &PyClass::CreateStream)
-      .def("decode_stream", &PyClass::DecodeStream, py::arg("s"))
-      .def("is_ready", &PyClass::IsReady, py::arg("s"))
-      .def("reset", &PyClass::Reset, py::arg("s"))
-      .def("is_endpoint", &PyClass::IsEndpoint, py::arg("s"))
-      .def("get_result", &PyClass::GetResult, py::arg("s"));
+      .def(py::init<const RecognizerConfig &>(), py::arg("config"),
+           py::call_guard<py::gil_scoped_release>())
+      .def(py::init([](const RecognizerConfig &config, const PyClass &other) {
+             // Share the weights of other instead of loading them again
+             return std::make_unique<PyClass>(config, other.GetSharedModel());
+           }),
+           py::arg("config"), py::arg("model_from"),
+           py::call_guard<py::gil_scoped_release>())
+      .def(
+          "create_stream",
+          [](const PyClass &self) {
+            return CheckStream(self.CreateStream(), "");
+          },
+          py::call_guard<py::gil_scoped_release>())
+      .def(
+          "create_stream",
+          [](const PyClass &self, const std::string &hotwords) {
+            return CheckStream(self.CreateStream(hotwords), hotwords);
+          },
+          py::arg("hotwords"), py::call_guard<py::gil_scoped_release>())
+      .def(
+          "create_stream_with_chunk_size",
+          [](const PyClass &self, int32_t chunk_size) {
+            return CheckStream(self.CreateStreamWithChunkSize(chunk_size), "");
+          },
+          py::arg("chunk_size"), py::call_guard<py::gil_scoped_release>())
+      .def_property_readonly("chunk_sizes", &PyClass::GetChunkSizes)
+      .def("set_hotwords", &PyClass::SetHotwords, py::arg("s"),
+           py::arg("hotwords"), py::call_guard<py::gil_scoped_release>())
+      .def("decode_stream", &PyClass::DecodeStream, py::arg("s"),
+           py::call_guard<py::gil_scoped_release>())
+      .def(
+          "decode_streams",
+          [](const PyClass &self, std::vector<Stream *> ss) {
+            self.DecodeStreams(ss.data(), ss.size());
+          },
+          py::arg("ss"), py::call_guard<py::gil_scoped_release>())
+      .def(
+          "decode_remaining_frames",
+          [](const PyClass &self, std::vector<Stream *> ss) {
+            return self.DecodeRemainingFrames(ss.data(), ss.size());
+          },
+          py::arg("ss"), py::call_guard<py::gil_scoped_release>())
+      .def("is_ready", &PyClass::IsReady, py::arg("s"),
+           py::call_guard<py::gil_scoped_release>())
+      .def("reset", &PyClass::Reset, py::arg("s"),
+           py::call_guard<py::gil_scoped_release>())
+      .def("is_endpoint", &PyClass::IsEndpoint, py::arg("s"),
+           py::call_guard<py::gil_scoped_release>())
+      .def("warm_up", &PyClass::WarmUp,
+           py::call_guard<py::gil_scoped_release>())
+      .def("get_result", &PyClass::GetResult, py::arg("s"),
+           py::call_guard<py::gil_scoped_release>())
+      .def(
+          "get_result_snapshot",
+          [](const PyClass &self, const Stream *s) {
+            return *self.GetResultSnapshot(s);
+          },
+          py::arg("s"), py::call_guard<py::gil_scoped_release>())
+      .def("set_greedy_search", &PyClass::SetGreedySearch, py::arg("s"),
+           py::arg("greedy"), py::call_guard<py::gil_scoped_release>())
+      .def("is_greedy_search", &PyClass::IsGreedySearch, py::arg("s"))
+      .def(
+          "get_latency_stats",
+          [](const PyClass &self) { return self.GetLatencyStats(); },
+          py::return_value_policy::reference_internal)
+      .def("get_model_memory_usage", [](const PyClass &self) {
+        return self.GetModel()->GetMemoryUsage();
+      });
 }
 
 }  // namespace sherpa_ncnn
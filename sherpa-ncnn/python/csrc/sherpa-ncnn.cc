@@ -19,10 +19,13 @@
 #include "sherpa-ncnn/python/csrc/sherpa-ncnn.h"
 
 #include "sherpa-ncnn/python/csrc/alsa.h"
+#include "sherpa-ncnn/python/csrc/async.h"
 #include "sherpa-ncnn/python/csrc/decoder.h"
 #include "sherpa-ncnn/python/csrc/display.h"
 #include "sherpa-ncnn/python/csrc/endpoint.h"
 #include "sherpa-ncnn/python/csrc/features.h"
+#include "sherpa-ncnn/python/csrc/latency-stats.h"
+#include "sherpa-ncnn/python/csrc/memory-usage.h"
 #include "sherpa-ncnn/python/csrc/model.h"
 #include "sherpa-ncnn/python/csrc/offline-recognizer.h"
 #include "sherpa-ncnn/python/csrc/offline-stream.h"
@@ -39,6 +42,8 @@ PYBIND11_MODULE(_sherpa_ncnn, m) {
   PybindFeatures(&m);
   PybindModel(&m);
   PybindDecoder(&m);
+  PybindLatencyStats(&m);
+  PybindMemoryUsage(&m);
   PybindStream(&m);
   PybindRecognizer(&m);
 
@@ -49,6 +54,8 @@ PYBIND11_MODULE(_sherpa_ncnn, m) {
   PybindOfflineTts(&m);
   PybindOfflineStream(&m);
   PybindOfflineRecognizer(&m);
+
+  PybindAsync(&m);
 }
 
 }  // namespace sherpa_ncnn
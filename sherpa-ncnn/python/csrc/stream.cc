@@ -18,15 +18,24 @@
 
 #include "sherpa-ncnn/python/csrc/stream.h"
 
+#include <utility>
 #include <vector>
 
 #include "sherpa-ncnn/csrc/stream.h"
+#include "sherpa-ncnn/python/csrc/buffer-utils.h"
 
 namespace sherpa_ncnn {
 
 void PybindStream(py::module *m) {
   using PyClass = Stream;
   py::class_<PyClass>(*m, "Stream")
+      // Numpy arrays and other buffers of float32 or int16 are used in place
+      .def(
+          "accept_waveform",
+          [](PyClass &self, float sample_rate, py::buffer waveform) {
+            AcceptWaveformBuffer(&self, sample_rate, waveform);
+          },
+          py::arg("sample_rate"), py::arg("waveform"))
       .def(
           "accept_waveform",
           [](PyClass &self, float sample_rate,
@@ -34,8 +43,24 @@ void PybindStream(py::module *m) {
             self.AcceptWaveform(sample_rate, waveform.data(), waveform.size());
           },
           py::call_guard<py::gil_scoped_release>())
+      // waveform has shape (num_frames, num_channels), e.g., from
+      // soundfile.read(filename, dtype="int16", always_2d=True). Channel c
+      // is passed to streams[c].
+      .def_static(
+          "accept_interleaved_waveform",
+          [](std::vector<PyClass *> streams, float sample_rate,
+             const py::buffer &waveform) {
+            AcceptInterleavedWaveformBuffer(std::move(streams), sample_rate,
+                                            waveform);
+          },
+          py::arg("streams"), py::arg("sample_rate"), py::arg("waveform"))
       .def("input_finished", &PyClass::InputFinished,
-           py::call_guard<py::gil_scoped_release>());
+           py::call_guard<py::gil_scoped_release>())
+      .def(
+          "get_latency_stats",
+          [](const PyClass &self) { return self.GetLatencyStats(); },
+          py::return_value_policy::reference_internal)
+      .def("get_memory_usage", &PyClass::GetMemoryUsage);
 }
 
 }  // namespace sherpa_ncnn
@@ -9,6 +9,7 @@ from sherpa_ncnn.lib._sherpa_ncnn import (
     OfflineTtsConfig,
     OfflineTtsModelConfig,
     OfflineTtsVitsModelConfig,
+    Stage,
     TtsArgs,
 )
 
@@ -0,0 +1,161 @@
+"""asyncio support.
+
+The decoding and the synthesis run on native threads, which wake up the
+event loop through a file descriptor when they are done, so an asyncio
+server does not need a thread per connection. It is not available on
+Windows, whose default event loop cannot watch a file descriptor.
+
+**Usage example**
+
+.. code-block:: python3
+
+    import sherpa_ncnn
+    from sherpa_ncnn.aio import AsyncRecognizer, AsyncTts
+
+    recognizer = AsyncRecognizer(sherpa_ncnn.Recognizer(...))
+
+    async def handle(websocket):
+        stream = recognizer.create_stream()
+        async for samples in websocket:
+            stream.accept_waveform(16000, samples)
+            await recognizer.decode_streams_async([stream])
+            print(recognizer.get_result(stream).text)
+
+    tts = AsyncTts(sherpa_ncnn.OfflineTts(config))
+
+    async def speak(text):
+        async for samples in tts.generate(sherpa_ncnn.TtsArgs(text=text)):
+            ...  # play or send samples
+"""
+
+import asyncio
+from typing import AsyncIterator, Dict, List, Sequence, Tuple
+
+import numpy as np
+from sherpa_ncnn.lib._sherpa_ncnn import AsyncDecoder as _AsyncDecoder
+from sherpa_ncnn.lib._sherpa_ncnn import (
+    AsyncTtsGeneration as _AsyncTtsGeneration,
+)
+from sherpa_ncnn.lib._sherpa_ncnn import (
+    OfflineTts,
+    Recognizer,
+    Stream,
+    TtsArgs,
+)
+
+
+class AsyncRecognizer(object):
+    """Decode streams of a recognizer from coroutines.
+
+    Streams passed to :meth:`decode_streams_async` by all coroutines that
+    are waiting at the same time are decoded together in batches of at
+    most ``max_batch_size`` streams.
+
+    Other methods, e.g., ``create_stream`` and ``get_result``, are those of
+    the wrapped recognizer.
+    """
+
+    def __init__(self, recognizer, max_batch_size: int = 32):
+        """
+        Args:
+          recognizer:
+            A :class:`sherpa_ncnn.Recognizer` or the ``Recognizer`` of
+            ``sherpa_ncnn.lib._sherpa_ncnn``.
+          max_batch_size:
+            Maximum number of streams decoded in one batch.
+        """
+        if not isinstance(recognizer, Recognizer):
+            recognizer = recognizer.recognizer
+
+        self.recognizer = recognizer
+        self._decoder = _AsyncDecoder(recognizer, max_batch_size)
+        self._loop = None
+
+        # id -> (future, streams). The streams are kept alive until they
+        # are decoded, even if the caller is cancelled.
+        self._pending: Dict[int, Tuple[asyncio.Future, List[Stream]]] = {}
+
+    def __getattr__(self, name):
+        return getattr(self.recognizer, name)
+
+    async def decode_streams_async(self, streams: Sequence[Stream]) -> None:
+        """Decode the given streams until none of them is ready, i.e., until
+        all of their complete chunks are decoded.
+
+        Endpoints are not handled. Check ``is_endpoint()`` and call
+        ``reset()`` afterwards as with the synchronous API.
+        """
+        loop = asyncio.get_running_loop()
+        self._attach(loop)
+
+        streams = list(streams)
+        future = loop.create_future()
+        self._pending[self._decoder.submit(streams)] = (future, streams)
+        await future
+
+    def close(self):
+        """Stop watching the decoder in the event loop. Coroutines that are
+        waiting in :meth:`decode_streams_async` never return."""
+        if self._loop is not None:
+            self._loop.remove_reader(self._decoder.fileno())
+            self._loop = None
+
+    def _attach(self, loop):
+        if self._loop is loop:
+            return
+
+        if self._loop is not None:
+            raise RuntimeError("It is already used by another event loop")
+
+        loop.add_reader(self._decoder.fileno(), self._on_completed)
+        self._loop = loop
+
+    def _on_completed(self):
+        for i in self._decoder.take_completed():
+            future, _ = self._pending.pop(i)
+            if not future.done():
+                future.set_result(None)
+
+
+class AsyncTts(object):
+    """Generate speech from coroutines.
+
+    Each call of :meth:`generate` runs on its own native thread. Set
+    ``max_concurrent_requests`` in the config of the TTS to limit how many
+    of them run at the same time.
+    """
+
+    def __init__(self, tts: OfflineTts):
+        self.tts = tts
+
+    def __getattr__(self, name):
+        return getattr(self.tts, name)
+
+    async def generate(self, args: TtsArgs) -> AsyncIterator[np.ndarray]:
+        """Yield the audio of args as it is generated, one piece every
+        ``max_num_sentences`` sentences, as 1-D float32 arrays at
+        ``sample_rate``.
+
+        If the caller stops iterating, the generation stops after the
+        current sentences.
+        """
+        loop = asyncio.get_running_loop()
+        generation = _AsyncTtsGeneration(self.tts, args)
+        event = asyncio.Event()
+
+        fd = generation.fileno()
+        loop.add_reader(fd, event.set)
+        try:
+            while True:
+                await event.wait()
+                event.clear()
+
+                chunks, done = generation.take()
+                for c in chunks:
+                    yield c
+
+                if done:
+                    return
+        finally:
+            loop.remove_reader(fd)
+            generation.cancel()
@@ -1,4 +1,5 @@
 from pathlib import Path
+from typing import List, Union
 
 import numpy as np
 from sherpa_ncnn.lib._sherpa_ncnn import (
@@ -62,9 +63,6 @@ class Recognizer(object):
 
             recognizer.accept_waveform(recognizer.sample_rate, samples_float32)
 
-            tail_paddings = np.zeros(int(recognizer.sample_rate * 0.5), dtype=np.float32)
-            recognizer.accept_waveform(recognizer.sample_rate, tail_paddings)
-
             recognizer.input_finished()
 
             print(recognizer.text)
@@ -93,6 +91,10 @@ class Recognizer(object):
         model_sample_rate: int = 16000,
         hotwords_file: str = "",
         hotwords_score: float = 1.5,
+        enable_profiling: bool = False,
+        powersave: int = 0,
+        cpu_cores: str = "",
+        precision: str = "",
     ):
         """
         Please refer to
@@ -153,6 +155,23 @@ class Recognizer(object):
           hotwords_score:
             The scale applied to hotwords score. Used only
             when hotwords_file is not empty.
+          enable_profiling:
+            True to record the wall time of each stage of recognition.
+            See :attr:`latency_stats`.
+          powersave:
+            The CPU cores the neural networks run on: 0 for all cores,
+            1 for the little cores and 2 for the big cores.
+          cpu_cores:
+            Optional. Comma separated ids of the CPU cores the neural networks
+            run on, e.g., ``"4,5,6,7"``. If not empty, it overrides
+            ``powersave`` and ``num_threads`` is at most the number of cores.
+            Give each recognizer of a process its own cores so that they do
+            not compete for the same ones.
+          precision:
+            Optional. The precision of the neural networks: ``accuracy``
+            (fp32), ``balanced`` (fp16 or bf16 storage, fp32 arithmetic) or
+            ``speed`` (also fp16 arithmetic where supported, e.g., on
+            ARMv8.2). If empty, the defaults of ncnn are used.
         """
         _assert_file_exists(tokens)
         _assert_file_exists(encoder_param)
@@ -182,6 +201,13 @@ class Recognizer(object):
             num_threads=num_threads,
             tokens=tokens,
         )
+        model_config.encoder_powersave = powersave
+        model_config.decoder_powersave = powersave
+        model_config.joiner_powersave = powersave
+        model_config.cpu_cores = cpu_cores
+        model_config.encoder_precision = precision
+        model_config.decoder_precision = precision
+        model_config.joiner_precision = precision
 
         endpoint_config = EndpointConfig(
             rule1_min_trailing_silence=rule1_min_trailing_silence,
@@ -203,6 +229,7 @@ class Recognizer(object):
             hotwords_file=hotwords_file,
             hotwords_score=hotwords_score,
         )
+        self.config.enable_profiling = enable_profiling
 
         self.sample_rate = self.config.feat_config.sampling_rate
 
@@ -225,9 +252,10 @@ class Recognizer(object):
         self._decode()
 
     def input_finished(self):
-        """Signal that no more audio samples are available."""
+        """Signal that no more audio samples are available and decode the
+        rest of the audio. No tail padding is needed."""
         self.stream.input_finished()
-        self._decode()
+        self.recognizer.decode_remaining_frames([self.stream])
 
     def _decode(self):
         while self.recognizer.is_ready(self.stream):
@@ -249,9 +277,38 @@ class Recognizer(object):
     def timestamps(self):
         return self.recognizer.get_result(self.stream).timestamps
 
+    @property
+    def latency_stats(self):
+        """Return the latency statistics of each stage, e.g.,
+        ``latency_stats.summary(Stage.encoder).p99_ms``.
+
+        Return None if enable_profiling is False.
+        """
+        return self.recognizer.get_latency_stats()
+
     @property
     def is_endpoint(self):
         return self.recognizer.is_endpoint(self.stream)
 
     def reset(self):
         self.recognizer.reset(self.stream)
+
+    def set_hotwords(self, hotwords: Union[str, List[str]]):
+        """Replace the hotwords of the current stream without reloading the
+        model. It is best called before decoding or right after
+        :meth:`reset`. Used only with modified_beam_search.
+
+        Args:
+          hotwords:
+            Hotwords in the format of the hotwords file. It is either a
+            string with one hotword per line or a list of hotwords. An
+            empty string or list removes the hotwords.
+
+        Raises:
+          ValueError: If a hotword contains a token that is not in the
+            symbol table. The hotwords of the stream are not changed.
+        """
+        if not isinstance(hotwords, str):
+            hotwords = "\n".join(hotwords)
+        if not self.recognizer.set_hotwords(self.stream, hotwords):
+            raise ValueError(f"Invalid hotwords: {hotwords}")
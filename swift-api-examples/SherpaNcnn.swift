@@ -14,6 +14,7 @@
 /// See the License for the specific language governing permissions and
 /// limitations under the License.
 
+import AVFoundation  // For AVAudioPCMBuffer
 import Foundation  // For NSString
 
 /// Convert a String from swift to a `const char*` so that we can pass it to
@@ -48,6 +49,8 @@ func toCPointer(_ s: String) -> UnsafePointer<Int8>! {
 ///                       Otherwise, it uses CPU for computation.
 ///   - numThreads.txt:  Number of threads to use for neural
 ///                      network computation.
+///   - powersave: The CPU cores of all networks: 0 for all cores, 1 for the
+///                little cores and 2 for the big cores.
 ///
 /// - Returns: Return an instance of SherpaNcnnModelConfig
 func sherpaNcnnModelConfig(
@@ -59,7 +62,8 @@ func sherpaNcnnModelConfig(
     joinerBin: String,
     tokens: String,
     numThreads: Int = 4,
-    useVulkanCompute: Bool = true
+    useVulkanCompute: Bool = true,
+    powersave: Int = 0
 ) -> SherpaNcnnModelConfig {
     return SherpaNcnnModelConfig(
         encoder_param: toCPointer(encoderParam),
@@ -70,7 +74,22 @@ func sherpaNcnnModelConfig(
         joiner_bin: toCPointer(joinerBin),
         tokens: toCPointer(tokens),
         use_vulkan_compute: useVulkanCompute ? 1 : 0,
-        num_threads: Int32(numThreads))
+        num_threads: Int32(numThreads),
+        decoder_num_threads: 0,
+        joiner_num_threads: 0,
+        encoder_powersave: Int32(powersave),
+        decoder_powersave: Int32(powersave),
+        joiner_powersave: Int32(powersave),
+        cpu_cores: nil,
+        buffers: nil,
+        num_buffers: 0,
+        encoder_variants: nil,
+        encoder_precision: nil,
+        decoder_precision: nil,
+        joiner_precision: nil,
+        arena_mb: 0,
+        remote_encoder: nil,
+        perf_profile: nil)
 }
 
 func sherpaNcnnFeatureExtractorConfig(
@@ -120,7 +139,10 @@ func sherpaNcnnRecognizerConfig(
     rule2MinTrailingSilence: Float = 1.2,
     rule3MinUtteranceLength: Float = 30,
     hotwordsFile: String = "",
-    hotwordsScore: Float = 1.5
+    hotwordsScore: Float = 1.5,
+    enableProfiling: Bool = false,
+    publishResults: Bool = false,
+    streamPoolSize: Int = 0
 ) -> SherpaNcnnRecognizerConfig {
     return SherpaNcnnRecognizerConfig(
         feat_config: featConfig,
@@ -131,7 +153,10 @@ func sherpaNcnnRecognizerConfig(
         rule2_min_trailing_silence: rule2MinTrailingSilence,
         rule3_min_utterance_length: rule3MinUtteranceLength,
         hotwords_file: toCPointer(hotwordsFile),
-        hotwords_score: hotwordsScore)
+        hotwords_score: hotwordsScore,
+        enable_profiling: enableProfiling ? 1 : 0,
+        publish_results: publishResults ? 1 : 0,
+        stream_pool_size: Int32(streamPoolSize))
 }
 
 /// Wrapper for recognition result.
@@ -199,6 +224,43 @@ class SherpaNcnnRecognizer {
         AcceptWaveform(stream, sampleRate, samples, Int32(samples.count))
     }
 
+    /// Like the above one, but the samples are read in place, e.g., from
+    /// the memory of an audio buffer, instead of from an array.
+    func acceptWaveform(
+        samples: UnsafeBufferPointer<Float>, sampleRate: Float = 16000
+    ) {
+        guard let p = samples.baseAddress else { return }
+        AcceptWaveform(stream, sampleRate, p, Int32(samples.count))
+    }
+
+    /// 16-bit PCM samples. They are converted to float in C.
+    func acceptWaveform(
+        samples: UnsafeBufferPointer<Int16>, sampleRate: Float = 16000
+    ) {
+        guard let p = samples.baseAddress else { return }
+        AcceptWaveformInt16(stream, sampleRate, p, Int32(samples.count))
+    }
+
+    /// Decode the first channel of a buffer, e.g., from AVAudioFile or
+    /// AVAudioEngine, without copying it to an array. Its format must be
+    /// float32 or int16.
+    func acceptWaveform(buffer: AVAudioPCMBuffer) {
+        let n = Int(buffer.frameLength)
+        let sampleRate = Float(buffer.format.sampleRate)
+
+        if let data = buffer.floatChannelData {
+            acceptWaveform(
+                samples: UnsafeBufferPointer(start: data[0], count: n),
+                sampleRate: sampleRate)
+        } else if let data = buffer.int16ChannelData {
+            acceptWaveform(
+                samples: UnsafeBufferPointer(start: data[0], count: n),
+                sampleRate: sampleRate)
+        } else {
+            print("Unsupported audio format: \(buffer.format)")
+        }
+    }
+
     func isReady() -> Bool {
         return IsReady(recognizer, stream) == 1
     }
@@ -215,6 +277,28 @@ class SherpaNcnnRecognizer {
         return SherpaNcnnRecongitionResult(result: result)
     }
 
+    /// It increases whenever the result changes
+    func getResultRevision() -> Int32 {
+        return GetResultRevision(stream)
+    }
+
+    /// Return the text if the revision of the result differs from
+    /// `revision`, which is then updated, and nil otherwise.
+    ///
+    /// Unlike getResult(), the result in C is owned by the stream and
+    /// nothing is allocated when it has not changed, so it is cheap to call
+    /// after every decode().
+    func getTextIfChanged(revision: inout Int32) -> String? {
+        if GetResultRevision(stream) == revision {
+            return nil
+        }
+
+        guard let result = GetBorrowedResult(recognizer, stream, &revision)
+        else { return nil }
+
+        return String(cString: result.pointee.text)
+    }
+
     /// Reset the recognizer, which clears the neural network model state
     /// and the state for decoding.
     func reset() {
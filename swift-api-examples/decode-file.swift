@@ -1,17 +1,5 @@
 import AVFoundation
 
-extension AudioBuffer {
-    func array() -> [Float] {
-        return Array(UnsafeBufferPointer(self))
-    }
-}
-
-extension AVAudioPCMBuffer {
-    func array() -> [Float] {
-        return self.audioBufferList.pointee.mBuffers.array()
-    }
-}
-
 func run() {
     let encoderParam =
     "./sherpa-ncnn-conv-emformer-transducer-2022-12-06/encoder_jit_trace-pnnx.ncnn.param"
@@ -69,8 +57,7 @@ func run() {
     let audioFileBuffer = AVAudioPCMBuffer(pcmFormat: audioFormat, frameCapacity: audioFrameCount)
 
     try! audioFile.read(into: audioFileBuffer!)
-    let array: [Float]! = audioFileBuffer?.array()
-    recognizer.acceptWaveform(samples: array)
+    recognizer.acceptWaveform(buffer: audioFileBuffer!)
 
     let tailPadding = [Float](repeating: 0.0, count: 3200)
     recognizer.acceptWaveform(samples: tailPadding)
@@ -9,8 +9,15 @@ set(CMAKE_FIND_ROOT_PATH_MODE_PROGRAM NEVER)
 set(CMAKE_FIND_ROOT_PATH_MODE_LIBRARY ONLY)
 set(CMAKE_FIND_ROOT_PATH_MODE_INCLUDE ONLY)
 
-set(CMAKE_C_FLAGS "-march=rv64gc")
-set(CMAKE_CXX_FLAGS "-march=rv64gc")
+# Use -DRISCV_MARCH=rv64gcv to enable the vector extension, see
+# build-riscv64-linux-gnu.sh
+if(NOT DEFINED RISCV_MARCH)
+  set(RISCV_MARCH "rv64gc")
+endif()
+list(APPEND CMAKE_TRY_COMPILE_PLATFORM_VARIABLES RISCV_MARCH)
+
+set(CMAKE_C_FLAGS "-march=${RISCV_MARCH}")
+set(CMAKE_CXX_FLAGS "-march=${RISCV_MARCH}")
 
 # cache flags
 set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS}" CACHE STRING "c flags")
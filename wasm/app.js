@@ -38,15 +38,46 @@ function getDisplayResult() {
 }
 
 
+// If the page is opened with ?model=<url>, the model is downloaded from
+// <url> and cached in IndexedDB instead of using the preloaded assets. See
+// sherpa-ncnn-model-loader.js
+const modelUrl = new URLSearchParams(window.location.search).get('model');
+
+function onRecognizerCreated() {
+  hint.innerText = 'Model loaded! Please click start';
+
+  startBtn.disabled = false;
+
+  console.log('recognizer is created!', recognizer);
+}
+
+async function createRecognizerFromUrl() {
+  let buffers = await loadModelBuffers(modelUrl, {
+    onProgress: (received) => {
+      hint.innerText =
+          'Loading model ... ' + (received / 1024 / 1024).toFixed(1) + ' MB';
+    },
+  });
+
+  let config = getDefaultRecognizerConfig(Module);
+  config.modelConfig.buffers = buffers;
+  recognizer = createRecognizer(Module, config);
+}
+
 Module = {};
 Module.onRuntimeInitialized = function() {
   console.log('inited!');
-  hint.innerText = 'Model loaded! Please click start';
 
-  startBtn.disabled = false;
+  if (modelUrl) {
+    createRecognizerFromUrl().then(onRecognizerCreated, (e) => {
+      console.log(e);
+      hint.innerText = 'Failed to load the model from ' + modelUrl;
+    });
+    return;
+  }
 
   recognizer = createRecognizer(Module);
-  console.log('recognizer is created!', recognizer);
+  onRecognizerCreated();
 };
 
 let audioCtx;
@@ -62,6 +93,67 @@ let recordingLength = 0;  // number of samples so far
 let recognizer = null;
 let recognizer_stream = null;
 
+// Used only if the module is built with threads. The microphone is then
+// recorded by an AudioWorklet into ring and decoded every decodeInterval ms
+let worklet = null;
+let ring = null;
+let decodeTimer = null;
+const decodeInterval = 100;
+
+function decodeAndShowResult() {
+  while (recognizer.isReady(recognizer_stream)) {
+    recognizer.decode(recognizer_stream);
+  }
+
+  let isEndpoint = recognizer.isEndpoint(recognizer_stream);
+  let result = recognizer.getResult(recognizer_stream);
+
+
+  if (result.length > 0 && lastResult != result) {
+    lastResult = result;
+  }
+
+  if (isEndpoint) {
+    if (lastResult.length > 0) {
+      resultList.push(lastResult);
+      lastResult = '';
+    }
+    recognizer.reset(recognizer_stream);
+  }
+
+  textArea.value = getDisplayResult();
+  textArea.scrollTop = textArea.scrollHeight;  // auto scroll
+}
+
+function decodeRing() {
+  recognizer_stream.acceptWaveformFromRing(audioCtx.sampleRate, ring);
+  decodeAndShowResult();
+}
+
+async function startWorklet() {
+  if (!worklet) {
+    await audioCtx.audioWorklet.addModule('sherpa-ncnn-audio-worklet.js');
+    worklet = new AudioWorkletNode(audioCtx, 'sherpa-ncnn-recorder');
+
+    // 10 seconds of audio
+    ring = new AudioRing(audioCtx.sampleRate * 10, Module);
+    worklet.port.postMessage({buffer: Module.HEAPF32.buffer, ring: ring.ptr});
+  }
+
+  if (recognizer_stream == null) {
+    recognizer_stream = recognizer.createStream();
+  }
+
+  mediaStream.connect(worklet);
+  decodeTimer = setInterval(decodeRing, decodeInterval);
+}
+
+function stopWorklet() {
+  clearInterval(decodeTimer);
+  decodeTimer = null;
+  mediaStream.disconnect(worklet);
+}
+
 if (navigator.mediaDevices.getUserMedia) {
   console.log('getUserMedia supported.');
 
@@ -103,28 +195,7 @@ if (navigator.mediaDevices.getUserMedia) {
       }
 
       recognizer_stream.acceptWaveform(expectedSampleRate, samples);
-      while (recognizer.isReady(recognizer_stream)) {
-        recognizer.decode(recognizer_stream);
-      }
-
-      let isEndpoint = recognizer.isEndpoint(recognizer_stream);
-      let result = recognizer.getResult(recognizer_stream);
-
-
-      if (result.length > 0 && lastResult != result) {
-        lastResult = result;
-      }
-
-      if (isEndpoint) {
-        if (lastResult.length > 0) {
-          resultList.push(lastResult);
-          lastResult = '';
-        }
-        recognizer.reset(recognizer_stream);
-      }
-
-      textArea.value = getDisplayResult();
-      textArea.scrollTop = textArea.scrollHeight;  // auto scroll
+      decodeAndShowResult();
 
       let buf = new Int16Array(samples.length);
       for (var i = 0; i < samples.length; ++i) {
@@ -142,17 +213,41 @@ if (navigator.mediaDevices.getUserMedia) {
       recordingLength += bufferSize;
     };
 
+    // The page has to be served with the headers
+    //   Cross-Origin-Opener-Policy: same-origin
+    //   Cross-Origin-Embedder-Policy: require-corp
+    // for the heap of a module built with threads to be shared
+    let useWorklet = false;
+
     startBtn.onclick = function() {
+      stopBtn.disabled = false;
+      startBtn.disabled = true;
+
+      // The module is initialized before the button is enabled
+      useWorklet = isSharedMemory(Module) && !!audioCtx.audioWorklet;
+      if (useWorklet) {
+        // Audio clips are not saved in this mode
+        startWorklet();
+        console.log('worklet started');
+        return;
+      }
+
       mediaStream.connect(recorder);
       recorder.connect(audioCtx.destination);
 
       console.log('recorder started');
-
-      stopBtn.disabled = false;
-      startBtn.disabled = true;
     };
 
     stopBtn.onclick = function() {
+      if (useWorklet) {
+        stopWorklet();
+        console.log('worklet stopped');
+
+        stopBtn.disabled = true;
+        startBtn.disabled = false;
+        return;
+      }
+
       console.log('recorder stopped');
 
       // stopBtn recording
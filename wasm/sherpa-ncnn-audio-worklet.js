@@ -0,0 +1,55 @@
+// Copyright (c)  2025  Xiaomi Corporation
+//
+// It writes the samples of the microphone into a ring buffer in the heap
+// of a module built with ./build-wasm-simd-mt.sh, where the heap is a
+// SharedArrayBuffer. See CreateRing() in sherpa-ncnn-wasm-main.cc for the
+// layout of the ring.
+//
+// The main thread passes the ring to the processor with
+//
+//   node.port.postMessage({buffer: Module.HEAPF32.buffer, ring: ring.ptr});
+//
+// and reads the samples with stream.acceptWaveformFromRing().
+
+class SherpaNcnnRecorderProcessor extends AudioWorkletProcessor {
+  constructor() {
+    super();
+    this.header = null;
+    this.samples = null;
+    this.capacity = 0;
+
+    this.port.onmessage = (e) => {
+      this.header = new Int32Array(e.data.buffer, e.data.ring, 4);
+      this.capacity = this.header[0];
+      this.samples =
+          new Float32Array(e.data.buffer, e.data.ring + 16, this.capacity);
+    };
+  }
+
+  process(inputs, outputs, parameters) {
+    if (!this.header || inputs.length == 0 || inputs[0].length == 0) {
+      return true;
+    }
+
+    const input = inputs[0][0];
+    const read = Atomics.load(this.header, 2);
+    let write = this.header[1];
+
+    for (let i = 0; i < input.length; ++i) {
+      let next = (write + 1) % this.capacity;
+      if (next == read) {
+        // The ring is full. Drop the remaining samples
+        break;
+      }
+
+      this.samples[write] = input[i];
+      write = next;
+    }
+
+    Atomics.store(this.header, 1, write);
+
+    return true;
+  }
+}
+
+registerProcessor('sherpa-ncnn-recorder', SherpaNcnnRecorderProcessor);
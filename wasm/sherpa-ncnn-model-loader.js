@@ -0,0 +1,163 @@
+// Copyright (c)  2025  Xiaomi Corporation
+//
+// Download the files of a model and keep them in IndexedDB, so that a
+// repeated visit of a page does not download them again. The files are
+// passed to the recognizer as buffers in memory, without the Emscripten
+// file system. See modelConfig.buffers in sherpa-ncnn.js
+
+// The names of the buffers and the files they are downloaded from
+const kModelFiles = [
+  {name: 'encoder.ncnn.param', file: 'encoder_jit_trace-pnnx.ncnn.param'},
+  {name: 'encoder.ncnn.bin', file: 'encoder_jit_trace-pnnx.ncnn.bin'},
+  {name: 'decoder.ncnn.param', file: 'decoder_jit_trace-pnnx.ncnn.param'},
+  {name: 'decoder.ncnn.bin', file: 'decoder_jit_trace-pnnx.ncnn.bin'},
+  {name: 'joiner.ncnn.param', file: 'joiner_jit_trace-pnnx.ncnn.param'},
+  {name: 'joiner.ncnn.bin', file: 'joiner_jit_trace-pnnx.ncnn.bin'},
+  {name: 'tokens', file: 'tokens.txt'},
+];
+
+const kModelCacheStore = 'files';
+
+function openModelCache(dbName) {
+  return new Promise((resolve, reject) => {
+    if (typeof indexedDB == 'undefined') {
+      resolve(null);
+      return;
+    }
+
+    let request = indexedDB.open(dbName, 1);
+    request.onupgradeneeded = () => {
+      request.result.createObjectStore(kModelCacheStore);
+    };
+    request.onsuccess = () => resolve(request.result);
+
+    // e.g., in a private window. The files are downloaded every time
+    request.onerror = () => resolve(null);
+  });
+}
+
+function getCachedFile(db, key) {
+  return new Promise((resolve) => {
+    let request = db.transaction(kModelCacheStore, 'readonly')
+                      .objectStore(kModelCacheStore)
+                      .get(key);
+    request.onsuccess = () => resolve(request.result || null);
+    request.onerror = () => resolve(null);
+  });
+}
+
+function putCachedFile(db, key, data) {
+  return new Promise((resolve) => {
+    let t = db.transaction(kModelCacheStore, 'readwrite');
+    t.objectStore(kModelCacheStore).put(data, key);
+    t.oncomplete = () => resolve();
+
+    // e.g., if the quota is exceeded. It is not cached then
+    t.onerror = () => resolve();
+  });
+}
+
+// Download a file into one Uint8Array. If the server gives its size, the
+// chunks are written into the array as they arrive, without keeping a
+// list of them. onProgress(received) is called for each chunk.
+async function fetchModelFile(url, onProgress) {
+  let response = await fetch(url);
+  if (!response.ok) {
+    throw new Error(`Failed to download ${url}: ${response.status}`);
+  }
+
+  let size = parseInt(response.headers.get('Content-Length') || '0');
+
+  // A compressed response has a different size
+  if (!response.body || !size || response.headers.get('Content-Encoding')) {
+    let data = new Uint8Array(await response.arrayBuffer());
+    onProgress(data.length);
+    return data;
+  }
+
+  let data = new Uint8Array(size);
+  let received = 0;
+  let reader = response.body.getReader();
+  while (true) {
+    let {done, value} = await reader.read();
+    if (done) {
+      break;
+    }
+
+    if (received + value.length > data.length) {
+      let larger = new Uint8Array(2 * (received + value.length));
+      larger.set(data.subarray(0, received));
+      data = larger;
+    }
+
+    data.set(value, received);
+    received += value.length;
+    onProgress(received);
+  }
+
+  // A view would keep all of data when it is cached
+  return received == data.length ? data : data.slice(0, received);
+}
+
+/**
+ * Load the files of a model from baseUrl, or from IndexedDB if they have
+ * been loaded before. All files are downloaded in parallel.
+ *
+ * @param baseUrl {String} The URL of the directory of the files, e.g.,
+ *                         'https://example.com/models/zipformer'. It is
+ *                         also the key of the files in the cache, so use a
+ *                         new one after updating the files.
+ * @param options {Object} Optional.
+ *   - files: An array of {name, file}. Default to kModelFiles
+ *   - dbName: The name of the IndexedDB database. Default to 'sherpa-ncnn'
+ *   - onProgress: A function onProgress(received) called with the number
+ *                 of bytes downloaded so far.
+ * @returns {Promise<Array>} The buffers of modelConfig, i.e., an array of
+ *                           {name: String, data: Uint8Array}
+ */
+async function loadModelBuffers(baseUrl, options) {
+  options = options || {};
+  let files = options.files || kModelFiles;
+  let dbName = options.dbName || 'sherpa-ncnn';
+  let onProgress = options.onProgress || function() {};
+
+  let db = await openModelCache(dbName);
+  let received = new Array(files.length).fill(0);
+
+  let report = () => {
+    onProgress(received.reduce((a, b) => a + b, 0));
+  };
+
+  let load = async (f, i) => {
+    let url = baseUrl.replace(/\/$/, '') + '/' + f.file;
+
+    let data = db ? await getCachedFile(db, url) : null;
+    if (!data) {
+      data = await fetchModelFile(url, (n) => {
+        received[i] = n;
+        report();
+      });
+
+      if (db) {
+        await putCachedFile(db, url, data);
+      }
+    }
+
+    return {name: f.name, data: data};
+  };
+
+  let buffers = await Promise.all(files.map(load));
+
+  if (db) {
+    db.close();
+  }
+
+  return buffers;
+}
+
+if (typeof process == 'object' && typeof process.versions == 'object' &&
+    typeof process.versions.node == 'string') {
+  module.exports = {
+    loadModelBuffers,
+  };
+}
@@ -15,6 +15,8 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <stdlib.h>
+
 #include <algorithm>
 #include <memory>
 
@@ -26,13 +28,67 @@
 extern "C" {
 
 static_assert(sizeof(SherpaNcnnFeatureExtractorConfig) == 4 * 2, "");
-static_assert(sizeof(SherpaNcnnModelConfig) == 4 * 9, "");
+static_assert(sizeof(SherpaNcnnModelBuffer) == 4 * 3, "");
+static_assert(sizeof(SherpaNcnnModelConfig) == 4 * 24, "");
 static_assert(sizeof(SherpaNcnnDecoderConfig) == 4 * 2, "");
 static_assert(sizeof(SherpaNcnnRecognizerConfig) ==
-                  4 * 2 + 4 * 9 + 4 * 2 + 4 * 4 + 4 * 2,
+                  4 * 2 + 4 * 24 + 4 * 2 + 4 * 4 + 4 * 5,
               "");
 
 void CopyHeap(const char *src, int32_t num_bytes, char *dst) {
   std::copy(src, src + num_bytes, dst);
 }
+
+// A ring buffer of samples in the heap. If the module is built with
+// threads, the heap is a SharedArrayBuffer and an AudioWorklet writes the
+// samples of the microphone into it directly. See
+// sherpa-ncnn-audio-worklet.js
+//
+// It consists of 4 int32 followed by the samples:
+//  - ring[0] the number of samples it can hold
+//  - ring[1] the index of the next sample to write. Only the writer
+//            changes it
+//  - ring[2] the index of the next sample to read. Only the reader
+//            changes it
+//  - ring[3] unused
+//
+// It is empty if ring[1] == ring[2]. One sample is always left empty, so
+// that a full ring can be told apart from an empty one.
+int32_t *CreateRing(int32_t capacity) {
+  auto ring = static_cast<int32_t *>(
+      malloc(sizeof(int32_t) * 4 + sizeof(float) * capacity));
+  ring[0] = capacity;
+  ring[1] = 0;
+  ring[2] = 0;
+  ring[3] = 0;
+  return ring;
+}
+
+void DestroyRing(int32_t *ring) { free(ring); }
+
+// Pass all samples in the ring to the stream, without copying them to a
+// temporary buffer. Return the number of samples read.
+int32_t AcceptWaveformFromRing(SherpaNcnnStream *s, float sample_rate,
+                               int32_t *ring) {
+  int32_t capacity = ring[0];
+  int32_t write = __atomic_load_n(ring + 1, __ATOMIC_ACQUIRE);
+  int32_t read = ring[2];
+  const float *samples = reinterpret_cast<const float *>(ring + 4);
+
+  int32_t n = 0;
+  if (write < read) {
+    AcceptWaveform(s, sample_rate, samples + read, capacity - read);
+    n += capacity - read;
+    read = 0;
+  }
+
+  if (read < write) {
+    AcceptWaveform(s, sample_rate, samples + read, write - read);
+    n += write - read;
+  }
+
+  __atomic_store_n(ring + 2, write, __ATOMIC_RELEASE);
+
+  return n;
+}
 }
@@ -20,47 +20,115 @@ function freeConfig(config, Module) {
   Module._free(config.ptr);
 }
 
-// The user should free the returned pointers
-function initSherpaNcnnModelConfig(config, Module) {
-  let encoderParamLen = Module.lengthBytesUTF8(config.encoderParam) + 1;
-  let decoderParamLen = Module.lengthBytesUTF8(config.decoderParam) + 1;
-  let joinerParamLen = Module.lengthBytesUTF8(config.joinerParam) + 1;
+// buffers is an array of {name: String, data: Uint8Array}, e.g.,
+// {name: 'encoder.ncnn.bin', data: ...}. The recognizer refers to the
+// copies in the heap, so they are freed with freeModelBuffers() after it
+function initSherpaNcnnModelBuffers(buffers, Module) {
+  let n = buffers.length;
+  let ptr = n > 0 ? Module._malloc(4 * 3 * n) : 0;
+  let pointers = [];
+
+  for (let i = 0; i < n; ++i) {
+    let nameLen = Module.lengthBytesUTF8(buffers[i].name) + 1;
+    let name = Module._malloc(nameLen);
+    Module.stringToUTF8(buffers[i].name, name, nameLen);
+
+    let data = Module._malloc(buffers[i].data.length);
+    Module.HEAPU8.set(buffers[i].data, data);
+
+    Module.setValue(ptr + 12 * i, name, 'i8*');
+    Module.setValue(ptr + 12 * i + 4, data, 'i8*');
+    Module.setValue(ptr + 12 * i + 8, buffers[i].data.length, 'i32');
+
+    pointers.push(name, data);
+  }
 
-  let encoderBinLen = Module.lengthBytesUTF8(config.encoderBin) + 1;
-  let decoderBinLen = Module.lengthBytesUTF8(config.decoderBin) + 1;
-  let joinerBinLen = Module.lengthBytesUTF8(config.joinerBin) + 1;
+  return {
+    ptr: ptr, n: n, pointers: pointers,
+  }
+}
 
-  let tokensLen = Module.lengthBytesUTF8(config.tokens) + 1;
+function freeModelBuffers(modelBuffers, Module) {
+  for (let p of modelBuffers.pointers) {
+    Module._free(p);
+  }
+
+  if (modelBuffers.ptr) {
+    Module._free(modelBuffers.ptr);
+  }
+}
+
+// The user should free the returned pointers. modelBuffers must be freed
+// after the recognizer
+function initSherpaNcnnModelConfig(config, Module) {
+  let encoderParamLen = Module.lengthBytesUTF8(config.encoderParam || '') + 1;
+  let decoderParamLen = Module.lengthBytesUTF8(config.decoderParam || '') + 1;
+  let joinerParamLen = Module.lengthBytesUTF8(config.joinerParam || '') + 1;
+
+  let encoderBinLen = Module.lengthBytesUTF8(config.encoderBin || '') + 1;
+  let decoderBinLen = Module.lengthBytesUTF8(config.decoderBin || '') + 1;
+  let joinerBinLen = Module.lengthBytesUTF8(config.joinerBin || '') + 1;
+
+  let tokensLen = Module.lengthBytesUTF8(config.tokens || '') + 1;
+  let cpuCoresLen = Module.lengthBytesUTF8(config.cpuCores || '') + 1;
+  let encoderVariantsLen =
+      Module.lengthBytesUTF8(config.encoderVariants || '') + 1;
+  let precisionLen = Module.lengthBytesUTF8(config.precision || '') + 1;
+  let remoteEncoderLen =
+      Module.lengthBytesUTF8(config.remoteEncoder || '') + 1;
+  let perfProfileLen = Module.lengthBytesUTF8(config.perfProfile || '') + 1;
 
   let n = encoderParamLen + decoderParamLen + joinerParamLen;
   n += encoderBinLen + decoderBinLen + joinerBinLen;
-  n += tokensLen;
+  n += tokensLen + cpuCoresLen + encoderVariantsLen + precisionLen;
+  n += remoteEncoderLen + perfProfileLen;
 
   let buffer = Module._malloc(n);
-  let ptr = Module._malloc(4 * 9);
+  let ptr = Module._malloc(4 * 24);
 
   let offset = 0;
-  Module.stringToUTF8(config.encoderParam, buffer + offset, encoderParamLen);
+  Module.stringToUTF8(
+      config.encoderParam || '', buffer + offset, encoderParamLen);
   offset += encoderParamLen;
 
-  Module.stringToUTF8(config.encoderBin, buffer + offset, encoderBinLen);
+  Module.stringToUTF8(config.encoderBin || '', buffer + offset, encoderBinLen);
   offset += encoderBinLen;
 
-  Module.stringToUTF8(config.decoderParam, buffer + offset, decoderParamLen);
+  Module.stringToUTF8(
+      config.decoderParam || '', buffer + offset, decoderParamLen);
   offset += decoderParamLen;
 
-  Module.stringToUTF8(config.decoderBin, buffer + offset, decoderBinLen);
+  Module.stringToUTF8(config.decoderBin || '', buffer + offset, decoderBinLen);
   offset += decoderBinLen;
 
-  Module.stringToUTF8(config.joinerParam, buffer + offset, joinerParamLen);
+  Module.stringToUTF8(
+      config.joinerParam || '', buffer + offset, joinerParamLen);
   offset += joinerParamLen;
 
-  Module.stringToUTF8(config.joinerBin, buffer + offset, joinerBinLen);
+  Module.stringToUTF8(config.joinerBin || '', buffer + offset, joinerBinLen);
   offset += joinerBinLen;
 
-  Module.stringToUTF8(config.tokens, buffer + offset, tokensLen);
+  Module.stringToUTF8(config.tokens || '', buffer + offset, tokensLen);
   offset += tokensLen;
 
+  Module.stringToUTF8(config.cpuCores || '', buffer + offset, cpuCoresLen);
+  offset += cpuCoresLen;
+
+  Module.stringToUTF8(
+      config.encoderVariants || '', buffer + offset, encoderVariantsLen);
+  offset += encoderVariantsLen;
+
+  Module.stringToUTF8(config.precision || '', buffer + offset, precisionLen);
+  offset += precisionLen;
+
+  Module.stringToUTF8(
+      config.remoteEncoder || '', buffer + offset, remoteEncoderLen);
+  offset += remoteEncoderLen;
+
+  Module.stringToUTF8(
+      config.perfProfile || '', buffer + offset, perfProfileLen);
+  offset += perfProfileLen;
+
   offset = 0;
   Module.setValue(ptr, buffer + offset, 'i8*');  // encoderParam
   offset += encoderParamLen;
@@ -85,9 +153,35 @@ function initSherpaNcnnModelConfig(config, Module) {
 
   Module.setValue(ptr + 28, config.useVulkanCompute, 'i32');
   Module.setValue(ptr + 32, config.numThreads, 'i32');
+  Module.setValue(ptr + 36, config.decoderNumThreads || 0, 'i32');
+  Module.setValue(ptr + 40, config.joinerNumThreads || 0, 'i32');
+  Module.setValue(ptr + 44, config.encoderPowersave || 0, 'i32');
+  Module.setValue(ptr + 48, config.decoderPowersave || 0, 'i32');
+  Module.setValue(ptr + 52, config.joinerPowersave || 0, 'i32');
+  Module.setValue(ptr + 56, buffer + offset, 'i8*');  // cpuCores
+  offset += cpuCoresLen;
+
+  let modelBuffers = initSherpaNcnnModelBuffers(config.buffers || [], Module);
+  Module.setValue(ptr + 60, modelBuffers.ptr, 'i8*');
+  Module.setValue(ptr + 64, modelBuffers.n, 'i32');
+  Module.setValue(ptr + 68, buffer + offset, 'i8*');  // encoderVariants
+  offset += encoderVariantsLen;
+
+  // The same precision for the encoder, decoder and joiner
+  Module.setValue(ptr + 72, buffer + offset, 'i8*');
+  Module.setValue(ptr + 76, buffer + offset, 'i8*');
+  Module.setValue(ptr + 80, buffer + offset, 'i8*');
+  offset += precisionLen;
+
+  Module.setValue(ptr + 84, config.arenaMb || 0, 'i32');
+  Module.setValue(ptr + 88, buffer + offset, 'i8*');  // remoteEncoder
+  offset += remoteEncoderLen;
+
+  Module.setValue(ptr + 92, buffer + offset, 'i8*');  // perfProfile
+  offset += perfProfileLen;
 
   return {
-    buffer: buffer, ptr: ptr, len: 36,
+    buffer: buffer, ptr: ptr, len: 96, modelBuffers: modelBuffers,
   }
 }
 
@@ -122,7 +216,7 @@ function initSherpaNcnnRecognizerConfig(config, Module) {
   let decoderConfig = initSherpaNcnnDecoderConfig(config.decoderConfig, Module);
 
   let numBytes =
-      featConfig.len + modelConfig.len + decoderConfig.len + 4 * 4 + 4 * 2;
+      featConfig.len + modelConfig.len + decoderConfig.len + 4 * 4 + 4 * 5;
 
   let ptr = Module._malloc(numBytes);
   let offset = 0;
@@ -160,6 +254,15 @@ function initSherpaNcnnRecognizerConfig(config, Module) {
       ptr + offset, config.hotwordsScore || 0.5, 'float');  // hotwords_score
   offset += 4;
 
+  Module.setValue(ptr + offset, config.enableProfiling || 0, 'i32');
+  offset += 4;
+
+  Module.setValue(ptr + offset, config.publishResults || 0, 'i32');
+  offset += 4;
+
+  Module.setValue(ptr + offset, config.streamPoolSize || 0, 'i32');
+  offset += 4;
+
   return {
     ptr: ptr, len: numBytes, featConfig: featConfig, modelConfig: modelConfig,
         decoderConfig: decoderConfig, buffer: buffer,
@@ -201,17 +304,59 @@ class Stream {
         this.handle, sampleRate, this.pointer, samples.length);
   }
 
+  /**
+   * Pass all samples in the ring to the stream. They are not copied in
+   * JavaScript.
+   *
+   * @param sampleRate {Number}
+   * @param ring {AudioRing}
+   * @returns {Number} The number of samples read
+   */
+  acceptWaveformFromRing(sampleRate, ring) {
+    return this.Module._AcceptWaveformFromRing(
+        this.handle, sampleRate, ring.ptr);
+  }
+
   inputFinished() {
     _InputFinished(this.handle);
   }
 };
 
+// Return true if the module is built with threads by
+// ./build-wasm-simd-mt.sh. Its heap is then a SharedArrayBuffer that an
+// AudioWorklet can write into.
+function isSharedMemory(Module) {
+  return typeof SharedArrayBuffer != 'undefined' &&
+      Module.HEAPF32.buffer instanceof SharedArrayBuffer;
+}
+
+// A ring buffer of samples in the heap. See sherpa-ncnn-audio-worklet.js
+class AudioRing {
+  /**
+   * @param capacity {Number} The number of samples it can hold
+   */
+  constructor(capacity, Module) {
+    this.ptr = Module._CreateRing(capacity);
+    this.Module = Module;
+  }
+
+  free() {
+    if (this.ptr) {
+      this.Module._DestroyRing(this.ptr);
+      this.ptr = 0;
+    }
+  }
+};
+
 class Recognizer {
   constructor(configObj, Module) {
     this.config = configObj;
     let config = initSherpaNcnnRecognizerConfig(configObj, Module)
     let handle = Module._CreateRecognizer(config.ptr);
 
+    // The model may refer to them
+    this.modelBuffers = config.modelConfig.modelBuffers;
+
     freeConfig(config.featConfig, Module);
     freeConfig(config.modelConfig, Module);
     freeConfig(config.decoderConfig, Module);
@@ -224,6 +369,9 @@ class Recognizer {
   free() {
     this.Module._DestroyRecognizer(this.handle);
     this.handle = 0
+
+    freeModelBuffers(this.modelBuffers, this.Module);
+    this.modelBuffers = {ptr: 0, n: 0, pointers: []};
   }
 
   createStream() {
@@ -243,6 +391,43 @@ class Recognizer {
     return this.Module._Decode(this.handle, stream.handle);
   }
 
+  // Return the streams that are ready for decoding, in their order in
+  // streams
+  isReadyMultiple(streams) {
+    let n = streams.length;
+    let ptr = this.Module._malloc(4 * n + Math.ceil(n / 8));
+    let ready = ptr + 4 * n;
+    for (let i = 0; i < n; ++i) {
+      this.Module.setValue(ptr + 4 * i, streams[i].handle, 'i8*');
+    }
+
+    this.Module._IsReadyMultiple(this.handle, ptr, n, ready);
+
+    let ans = [];
+    for (let i = 0; i < n; ++i) {
+      let byte = this.Module.getValue(ready + Math.floor(i / 8), 'i8');
+      if (byte & (1 << (i % 8))) {
+        ans.push(streams[i]);
+      }
+    }
+
+    this.Module._free(ptr);
+    return ans;
+  }
+
+  // Decode the streams in one batch, which is faster than calling decode()
+  // for each of them. Each stream must be ready.
+  decodeMultipleStreams(streams) {
+    let n = streams.length;
+    let ptr = this.Module._malloc(4 * n);
+    for (let i = 0; i < n; ++i) {
+      this.Module.setValue(ptr + 4 * i, streams[i].handle, 'i8*');
+    }
+
+    this.Module._DecodeMultipleStreams(this.handle, ptr, n);
+    this.Module._free(ptr);
+  }
+
   reset(stream) {
     this.Module._Reset(this.handle, stream.handle);
   }
@@ -256,7 +441,10 @@ class Recognizer {
   }
 }
 
-function createRecognizer(Module, myConfig) {
+// The config of the model in the assets of the demo. To load the model
+// from memory instead, set modelConfig.buffers, see
+// sherpa-ncnn-model-loader.js
+function getDefaultRecognizerConfig(Module) {
   let modelConfig = {
     encoderParam: './encoder_jit_trace-pnnx.ncnn.param',
     encoderBin: './encoder_jit_trace-pnnx.ncnn.bin',
@@ -266,7 +454,8 @@ function createRecognizer(Module, myConfig) {
     joinerBin: './joiner_jit_trace-pnnx.ncnn.bin',
     tokens: './tokens.txt',
     useVulkanCompute: 0,
-    numThreads: 1,
+    // It should not exceed PTHREAD_POOL_SIZE in ./CMakeLists.txt
+    numThreads: isSharedMemory(Module) ? 4 : 1,
   };
 
   let decoderConfig = {
@@ -279,7 +468,7 @@ function createRecognizer(Module, myConfig) {
     featureDim: 80,
   };
 
-  let configObj = {
+  return {
     featConfig: featConfig,
     modelConfig: modelConfig,
     decoderConfig: decoderConfig,
@@ -288,11 +477,10 @@ function createRecognizer(Module, myConfig) {
     rule2MinTrailingSilence: 2.4,
     rule3MinUtternceLength: 20,
   };
+}
 
-  if (myConfig) {
-    configObj = myConfig;
-  }
-
+function createRecognizer(Module, myConfig) {
+  let configObj = myConfig || getDefaultRecognizerConfig(Module);
   return new Recognizer(configObj, Module);
 }
 
@@ -300,5 +488,7 @@ if (typeof process == 'object' && typeof process.versions == 'object' &&
     typeof process.versions.node == 'string') {
   module.exports = {
     createRecognizer,
+    getDefaultRecognizerConfig,
+    isSharedMemory,
   };
 }